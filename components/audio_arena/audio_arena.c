@@ -0,0 +1,241 @@
+#include "audio_arena.h"
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "metrics.h"
+
+#ifndef CONFIG_AUDIO_ARENA_KB
+#define CONFIG_AUDIO_ARENA_KB 64
+#endif
+#ifndef CONFIG_AUDIO_ARENA_MAX_BLOCKS
+#define CONFIG_AUDIO_ARENA_MAX_BLOCKS 24
+#endif
+
+#define ARENA_ALIGN 16u
+
+static const char *TAG = "audio_arena";
+
+static const char *const s_kind_names[AUDIO_ARENA_KIND_COUNT] = {
+    [AUDIO_ARENA_JITTER]  = "jitter",
+    [AUDIO_ARENA_OUTPUT]  = "output",
+    [AUDIO_ARENA_CAPTURE] = "capture",
+    [AUDIO_ARENA_CODEC]   = "codec",
+    [AUDIO_ARENA_SYNC]    = "sync",
+};
+
+// Live blocks, sorted by offset; the gaps between them are the free space
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    uint8_t kind;
+} arena_block_t;
+
+static uint8_t *s_base = NULL;
+static uint32_t s_size = 0;
+static arena_block_t s_blocks[CONFIG_AUDIO_ARENA_MAX_BLOCKS];
+static uint32_t s_block_count = 0;
+static uint32_t s_used = 0;
+static uint32_t s_peak_used = 0;
+static uint32_t s_fallbacks = 0;
+static uint32_t s_failures = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t read_arena_free(void)
+{
+    return (int64_t)s_size - s_used;
+}
+
+static int64_t read_heap_largest(void)
+{
+    return (int64_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+static metrics_gauge_t arena_free_gauge =
+    METRICS_GAUGE_INIT("audio_arena_free_bytes", "Audio arena bytes not handed out", read_arena_free);
+static metrics_gauge_t heap_largest_gauge =
+    METRICS_GAUGE_INIT("heap_internal_largest_free_bytes", "Largest free internal heap block", read_heap_largest);
+
+// Caller holds s_lock
+static uint32_t gap_before(uint32_t i)
+{
+    uint32_t start = i == 0 ? 0 : s_blocks[i - 1].offset + s_blocks[i - 1].size;
+    uint32_t end = i == s_block_count ? s_size : s_blocks[i].offset;
+    return end - start;
+}
+
+esp_err_t audio_arena_init(void)
+{
+    metrics_register(&arena_free_gauge.base);
+    metrics_register(&heap_largest_gauge.base);
+    if (s_base || CONFIG_AUDIO_ARENA_KB == 0) {
+        return ESP_OK;
+    }
+    size_t bytes = (size_t)CONFIG_AUDIO_ARENA_KB * 1024u;
+    s_base = heap_caps_aligned_alloc(ARENA_ALIGN, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    if (!s_base) {
+        ESP_LOGE(TAG, "Failed to carve %u KB audio arena, audio buffers come from the heap",
+                 (unsigned)CONFIG_AUDIO_ARENA_KB);
+        return ESP_ERR_NO_MEM;
+    }
+    s_size = (uint32_t)bytes;
+    ESP_LOGI(TAG, "Audio arena: %u KB internal DMA RAM at %p", (unsigned)CONFIG_AUDIO_ARENA_KB, s_base);
+#if CONFIG_SPIRAM
+    size_t psram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    ESP_LOGI(TAG, "PSRAM: %u KB for cold buffers%s", (unsigned)(psram / 1024u), psram ? "" : " (none found)");
+#endif
+    return ESP_OK;
+}
+
+void *audio_arena_alloc(audio_arena_kind_t kind, size_t bytes, uint32_t fallback_caps)
+{
+    if (bytes == 0 || kind >= AUDIO_ARENA_KIND_COUNT) {
+        return NULL;
+    }
+    uint32_t need = (uint32_t)((bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1));
+    void *ptr = NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_base && bytes <= s_size && s_block_count < CONFIG_AUDIO_ARENA_MAX_BLOCKS) {
+        for (uint32_t i = 0; i <= s_block_count; i++) {
+            if (gap_before(i) < need) {
+                continue;
+            }
+            uint32_t offset = i == 0 ? 0 : s_blocks[i - 1].offset + s_blocks[i - 1].size;
+            memmove(&s_blocks[i + 1], &s_blocks[i], (s_block_count - i) * sizeof(s_blocks[0]));
+            s_blocks[i] = (arena_block_t){ .offset = offset, .size = need, .kind = (uint8_t)kind };
+            s_block_count++;
+            s_used += need;
+            if (s_used > s_peak_used) {
+                s_peak_used = s_used;
+            }
+            ptr = s_base + offset;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (ptr) {
+        return ptr;
+    }
+
+    if (fallback_caps) {
+        ptr = heap_caps_aligned_alloc(ARENA_ALIGN, bytes, fallback_caps);
+    }
+    portENTER_CRITICAL(&s_lock);
+    if (ptr) {
+        s_fallbacks++;
+    } else {
+        s_failures++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (s_base) {
+        ESP_LOGW(TAG, "%u byte %s buffer does not fit the arena, %s", (unsigned)bytes, s_kind_names[kind],
+                 ptr ? "taken from the heap" : "no memory");
+    }
+    return ptr;
+}
+
+void *audio_arena_calloc(audio_arena_kind_t kind, size_t bytes, uint32_t fallback_caps)
+{
+    void *ptr = audio_arena_alloc(kind, bytes, fallback_caps);
+    if (ptr) {
+        memset(ptr, 0, bytes);
+    }
+    return ptr;
+}
+
+void *audio_arena_alloc_cold(size_t bytes)
+{
+    void *ptr = NULL;
+#if CONFIG_SPIRAM
+    ptr = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+    if (!ptr) {
+        ptr = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+    return ptr;
+}
+
+void *audio_arena_calloc_cold(size_t bytes)
+{
+    void *ptr = audio_arena_alloc_cold(bytes);
+    if (ptr) {
+        memset(ptr, 0, bytes);
+    }
+    return ptr;
+}
+
+bool audio_arena_owns(const void *ptr)
+{
+    return s_base && (const uint8_t *)ptr >= s_base && (const uint8_t *)ptr < s_base + s_size;
+}
+
+void audio_arena_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    if (!audio_arena_owns(ptr)) {
+        heap_caps_free(ptr);
+        return;
+    }
+    uint32_t offset = (uint32_t)((uint8_t *)ptr - s_base);
+    bool found = false;
+    portENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < s_block_count; i++) {
+        if (s_blocks[i].offset == offset) {
+            s_used -= s_blocks[i].size;
+            memmove(&s_blocks[i], &s_blocks[i + 1], (s_block_count - i - 1) * sizeof(s_blocks[0]));
+            s_block_count--;
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (!found) {
+        ESP_LOGE(TAG, "Free of %p, not an arena block", ptr);
+    }
+}
+
+void audio_arena_get_stats(audio_arena_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    portENTER_CRITICAL(&s_lock);
+    out->size = s_size;
+    out->used = s_used;
+    out->peak_used = s_peak_used;
+    out->blocks = s_block_count;
+    out->fallbacks = s_fallbacks;
+    out->failures = s_failures;
+    for (uint32_t i = 0; s_base && i <= s_block_count; i++) {
+        uint32_t gap = gap_before(i);
+        if (gap > out->largest_free) {
+            out->largest_free = gap;
+        }
+        if (i < s_block_count) {
+            out->kind_bytes[s_blocks[i].kind] += s_blocks[i].size;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    out->heap_internal_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    out->heap_internal_largest_free = (uint32_t)read_heap_largest();
+    if (out->heap_internal_free > 0) {
+        out->heap_internal_frag_pct =
+            (uint8_t)(100u - (uint32_t)((uint64_t)out->heap_internal_largest_free * 100u / out->heap_internal_free));
+    }
+#if CONFIG_SPIRAM
+    out->psram_size = (uint32_t)heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    out->psram_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    out->psram_largest_free = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+#endif
+}
+
+const char *audio_arena_kind_name(audio_arena_kind_t kind)
+{
+    return kind < AUDIO_ARENA_KIND_COUNT ? s_kind_names[kind] : "unknown";
+}
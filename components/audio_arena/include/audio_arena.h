@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Boot-time arena for the audio buffers a mode sets up and tears down.
+ *
+ * audio_arena_init() takes CONFIG_AUDIO_ARENA_KB of internal, DMA-capable RAM
+ * once, before Wi-Fi and the web server start cutting up the heap. The jitter
+ * ring, output driver queues, capture rings and codec buffers are then placed
+ * in it first-fit, each tagged with its kind. The output queues go back when
+ * a mode stops and the jitter ring just before the next mode takes its own, so
+ * each mode starts from the same arena however many switches came before. Heap allocations made in between (HTTP requests, JSON, sockets) can
+ * no longer land between two audio buffers and leave the next large ring
+ * nowhere to go. The RTCP source tables are taken right after the arena and
+ * kept, so they sit below every mode's buffers.
+ *
+ * Allocations are 16-byte aligned. One that does not fit (no room, or the
+ * block table is full) goes to the heap with the caller's capabilities
+ * instead, or fails if those are 0; audio_arena_free() takes either. The
+ * arena is not for use from ISRs.
+ *
+ * Placement: the arena and everything the audio path touches per chunk (ring
+ * slots, DMA descriptors and buffers, task stacks) stays in internal RAM.
+ * Large buffers touched rarely or off the audio path (log rings, the SAP table,
+ * the frozen event trace, the OTA inflate window, cJSON trees, jitter-ring
+ * extensions past CONFIG_RX_BUFFER_INTERNAL_MAX_KB) go to PSRAM on boards that
+ * have it, through audio_arena_alloc_cold(). These are heap allocations rather
+ * than EXT_RAM_BSS_ATTR statics so one image still boots on boards without
+ * PSRAM (CONFIG_SPIRAM_IGNORE_NOTFOUND).
+ */
+
+typedef enum {
+    AUDIO_ARENA_JITTER = 0,   // Receiver jitter ring: slots, states, chunk memory
+    AUDIO_ARENA_OUTPUT,       // Output driver queues (S/PDIF, USB host)
+    AUDIO_ARENA_CAPTURE,      // Capture PCM rings (USB device, S/PDIF in)
+    AUDIO_ARENA_CODEC,        // Codec work buffers (Opus)
+    AUDIO_ARENA_SYNC,         // RTCP per-source sync tables, held from boot
+    AUDIO_ARENA_KIND_COUNT
+} audio_arena_kind_t;
+
+typedef struct {
+    uint32_t size;              // Arena bytes; 0 when not carved
+    uint32_t used;              // Bytes handed out now
+    uint32_t peak_used;         // Most bytes ever handed out at once
+    uint32_t largest_free;      // Biggest allocation that would fit now
+    uint32_t blocks;            // Live allocations
+    uint32_t fallbacks;         // Allocations sent to the heap since boot
+    uint32_t failures;          // Allocations that got nothing since boot
+    uint32_t kind_bytes[AUDIO_ARENA_KIND_COUNT];    // Bytes held per kind now
+    uint32_t heap_internal_free;            // Internal heap outside the arena
+    uint32_t heap_internal_largest_free;
+    uint8_t heap_internal_frag_pct;         // 100 - largest block / free
+    uint32_t psram_size;                    // 0 without PSRAM
+    uint32_t psram_free;
+    uint32_t psram_largest_free;
+} audio_arena_stats_t;
+
+/**
+ * @brief Carve the arena; once, at boot
+ * @return ESP_ERR_NO_MEM if the block could not be had (callers then get heap
+ *         memory throughout), ESP_OK otherwise, also with the arena off
+ */
+esp_err_t audio_arena_init(void);
+
+/**
+ * @brief Take a buffer from the arena
+ * @param kind What it is for (statistics only)
+ * @param bytes Size
+ * @param fallback_caps heap_caps capabilities to fall back to; 0 for none
+ * @return The buffer, or NULL
+ */
+void *audio_arena_alloc(audio_arena_kind_t kind, size_t bytes, uint32_t fallback_caps);
+
+/**
+ * @brief audio_arena_alloc(), zeroed
+ */
+void *audio_arena_calloc(audio_arena_kind_t kind, size_t bytes, uint32_t fallback_caps);
+
+/**
+ * @brief Give back an audio_arena_alloc() buffer (arena or heap); NULL is ignored
+ */
+void audio_arena_free(void *ptr);
+
+/**
+ * @brief Take a cold buffer: PSRAM when present, else the internal heap
+ * @return The buffer, or NULL; free with audio_arena_free()
+ */
+void *audio_arena_alloc_cold(size_t bytes);
+
+/**
+ * @brief audio_arena_alloc_cold(), zeroed
+ */
+void *audio_arena_calloc_cold(size_t bytes);
+
+/**
+ * @brief Whether ptr lies inside the arena
+ */
+bool audio_arena_owns(const void *ptr);
+
+void audio_arena_get_stats(audio_arena_stats_t *out);
+
+const char *audio_arena_kind_name(audio_arena_kind_t kind);
+
+#ifdef __cplusplus
+}
+#endif
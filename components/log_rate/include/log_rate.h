@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*
+ * Rate-limited logging for per-packet / per-chunk paths.
+ *
+ * Each LOG_RATE_x() call site owns a static token bucket: CONFIG_LOG_RATE_BURST
+ * lines may go out back to back, then one per CONFIG_LOG_RATE_INTERVAL_MS.
+ * Lines dropped in between are counted and appended to the next one that gets
+ * through as "(N suppressed)", so an overflow storm costs one line a second
+ * instead of a blocked UART. Calls above CONFIG_LOG_RATE_LEVEL (or
+ * LOG_LOCAL_LEVEL) are removed at compile time, arguments included.
+ *
+ * The bucket is not locked: two tasks sharing a call site can at worst let an
+ * extra line through.
+ */
+
+#ifndef CONFIG_LOG_RATE_LEVEL
+#define CONFIG_LOG_RATE_LEVEL 3
+#endif
+#ifndef CONFIG_LOG_RATE_BURST
+#define CONFIG_LOG_RATE_BURST 5
+#endif
+#ifndef CONFIG_LOG_RATE_INTERVAL_MS
+#define CONFIG_LOG_RATE_INTERVAL_MS 1000
+#endif
+
+typedef struct {
+    int64_t refill_us;      // Time the next token is due
+    uint32_t suppressed;    // Lines dropped since the last one emitted
+    uint16_t tokens;
+    bool primed;
+} log_rate_state_t;
+
+// Take a token; on success *suppressed gets (and clears) the dropped count
+static inline bool log_rate_take(log_rate_state_t *s, uint32_t *suppressed) {
+    const int64_t interval_us = (int64_t)CONFIG_LOG_RATE_INTERVAL_MS * 1000;
+    int64_t now = esp_timer_get_time();
+    if (!s->primed) {
+        s->primed = true;
+        s->tokens = CONFIG_LOG_RATE_BURST;
+        s->refill_us = now + interval_us;
+    } else if (now >= s->refill_us) {
+        int64_t due = (now - s->refill_us) / interval_us + 1;
+        if (due >= CONFIG_LOG_RATE_BURST - s->tokens) {
+            s->tokens = CONFIG_LOG_RATE_BURST;
+            s->refill_us = now + interval_us;
+        } else {
+            s->tokens += (uint16_t)due;
+            s->refill_us += due * interval_us;
+        }
+    }
+    if (s->tokens == 0) {
+        s->suppressed++;
+        return false;
+    }
+    s->tokens--;
+    *suppressed = s->suppressed;
+    s->suppressed = 0;
+    return true;
+}
+
+#define LOG_RATE_ENABLED(level) \
+    ((level) <= CONFIG_LOG_RATE_LEVEL && (level) <= LOG_LOCAL_LEVEL)
+
+#define LOG_RATE(level, tag, format, ...) do {                                          \
+        if (LOG_RATE_ENABLED(level)) {                                                  \
+            static log_rate_state_t _log_rate_state;                                    \
+            uint32_t _log_rate_dropped;                                                 \
+            if (log_rate_take(&_log_rate_state, &_log_rate_dropped)) {                  \
+                if (_log_rate_dropped) {                                                \
+                    ESP_LOG_LEVEL(level, tag, format " (%" PRIu32 " suppressed)",       \
+                                  ##__VA_ARGS__, _log_rate_dropped);                    \
+                } else {                                                                \
+                    ESP_LOG_LEVEL(level, tag, format, ##__VA_ARGS__);                   \
+                }                                                                       \
+            }                                                                           \
+        }                                                                               \
+    } while (0)
+
+#define LOG_RATE_E(tag, format, ...) LOG_RATE(ESP_LOG_ERROR,   tag, format, ##__VA_ARGS__)
+#define LOG_RATE_W(tag, format, ...) LOG_RATE(ESP_LOG_WARN,    tag, format, ##__VA_ARGS__)
+#define LOG_RATE_I(tag, format, ...) LOG_RATE(ESP_LOG_INFO,    tag, format, ##__VA_ARGS__)
+#define LOG_RATE_D(tag, format, ...) LOG_RATE(ESP_LOG_DEBUG,   tag, format, ##__VA_ARGS__)
+#define LOG_RATE_V(tag, format, ...) LOG_RATE(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
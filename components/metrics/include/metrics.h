@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_cpu.h"
+#include "soc/soc_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free metrics registry, exported in Prometheus text format.
+ *
+ * A counter or histogram holds one set of cells per core. An update is a
+ * relaxed atomic add to the cell of the core the caller runs on, so writers on
+ * different cores never touch the same word and no update takes a lock; a
+ * reader sums the cells. Gauges are read through a callback at scrape time.
+ *
+ * Metrics are static objects registered once (metrics_register() is
+ * idempotent) and never removed. Cells are 32 bits: counters and sums wrap at
+ * 2^32, which Prometheus' rate() treats as a counter reset. Histograms take
+ * non-negative observations. With CONFIG_METRICS_ENABLED off, counters are
+ * plain increments, histograms are no-ops and nothing is registered.
+ *
+ *   static metrics_counter_t s_rx = METRICS_COUNTER_INIT("rtp_rx_packets_total", "RTP packets received");
+ *   metrics_register(&s_rx.base);   // at init
+ *   metrics_counter_inc(&s_rx);     // hot path
+ */
+
+#ifndef CONFIG_METRICS_HIST_MAX_BUCKETS
+#define CONFIG_METRICS_HIST_MAX_BUCKETS 16
+#endif
+
+#define METRICS_CORES SOC_CPU_CORES_NUM
+
+typedef enum {
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+} metric_type_t;
+
+typedef struct metric {
+    const char *name;             // Prometheus name (counters end in _total)
+    const char *help;
+    metric_type_t type;
+    bool registered;
+    struct metric *next;          // Registry order
+} metric_t;
+
+typedef struct {
+    metric_t base;
+    uint32_t per_core[METRICS_CORES];
+} metrics_counter_t;
+
+typedef struct {
+    metric_t base;
+    int64_t (*read)(void);        // Called at scrape time, from the HTTP server task
+} metrics_gauge_t;
+
+typedef struct {
+    metric_t base;
+    const uint32_t *bounds;       // Ascending bucket upper bounds (le), +Inf implied
+    uint8_t n_bounds;
+    uint32_t counts[METRICS_CORES][CONFIG_METRICS_HIST_MAX_BUCKETS + 1];
+    uint32_t sum[METRICS_CORES];
+} metrics_histogram_t;
+
+#define METRICS_COUNTER_INIT(n, h) \
+    { .base = { .name = (n), .help = (h), .type = METRIC_COUNTER } }
+#define METRICS_GAUGE_INIT(n, h, fn) \
+    { .base = { .name = (n), .help = (h), .type = METRIC_GAUGE }, .read = (fn) }
+// b must be an array (its length is taken with sizeof)
+#define METRICS_HISTOGRAM_INIT(n, h, b) \
+    { .base = { .name = (n), .help = (h), .type = METRIC_HISTOGRAM }, \
+      .bounds = (b), .n_bounds = (uint8_t)(sizeof(b) / sizeof((b)[0])) }
+
+static inline void metrics_counter_add(metrics_counter_t *c, uint32_t n)
+{
+#ifdef CONFIG_METRICS_ENABLED
+    __atomic_fetch_add(&c->per_core[esp_cpu_get_core_id()], n, __ATOMIC_RELAXED);
+#else
+    // Modules still read their counters back for logs and the JSON APIs
+    c->per_core[0] += n;
+#endif
+}
+
+static inline void metrics_counter_inc(metrics_counter_t *c)
+{
+    metrics_counter_add(c, 1);
+}
+
+static inline void metrics_histogram_observe(metrics_histogram_t *h, uint32_t value)
+{
+#ifdef CONFIG_METRICS_ENABLED
+    uint32_t i = 0;
+    while (i < h->n_bounds && value > h->bounds[i]) {
+        i++;
+    }
+    int core = esp_cpu_get_core_id();
+    __atomic_fetch_add(&h->counts[core][i], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum[core], value, __ATOMIC_RELAXED);
+#else
+    (void)h;
+    (void)value;
+#endif
+}
+
+/**
+ * @brief Counter value: the sum of its per-core cells (wraps at 2^32)
+ */
+uint32_t metrics_counter_get(const metrics_counter_t *c);
+
+/**
+ * @brief Histogram bucket counts summed over cores (not cumulative)
+ *
+ * @param counts n_bounds + 1 entries; the last is the +Inf bucket
+ */
+void metrics_histogram_get(const metrics_histogram_t *h, uint32_t *counts);
+
+/**
+ * @brief Add a metric to the registry; a second call for the same metric is a no-op
+ *
+ * @return ESP_OK, or ESP_ERR_INVALID_SIZE for a histogram with more than
+ *         CONFIG_METRICS_HIST_MAX_BUCKETS bounds
+ */
+esp_err_t metrics_register(metric_t *metric);
+
+// Sink for exported text; a non-ESP_OK return stops the export
+typedef esp_err_t (*metrics_write_fn)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Write every registered metric in Prometheus text format (version 0.0.4)
+ *
+ * Calls write once per line, from a small stack buffer; nothing is allocated.
+ * Safe alongside writers and registration.
+ */
+esp_err_t metrics_write_prometheus(metrics_write_fn write, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
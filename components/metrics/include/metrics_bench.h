@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Regression check for the startup benchmarks (CONFIG_METRICS_BENCH_BASELINE).
+ *
+ * Each benchmark reports its figures as lower-is-better values (cycles per
+ * call, microseconds to settle) under a short key. The best value seen for a
+ * key is kept in NVS as its baseline; a later run more than
+ * CONFIG_METRICS_BENCH_TOLERANCE_PCT above it logs a warning, so a firmware
+ * that got slower on the same board shows up in the first boot log. With the
+ * option off the check does nothing.
+ */
+
+/**
+ * @brief Compare a benchmark figure with its stored baseline, then keep the best
+ * @param key   NVS key, at most 15 characters
+ * @param value Figure from this run, lower is better
+ */
+void metrics_bench_check(const char *key, uint32_t value);
+
+#ifdef __cplusplus
+}
+#endif
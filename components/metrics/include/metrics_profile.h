@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_cpu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hot-path cycle profiler (CONFIG_METRICS_PROFILER).
+ *
+ * A stage is a static object bracketing one step of the audio path with the
+ * CPU cycle counter; each completed bracket lands in a log2 histogram
+ * (bucket b holds durations below 2^b cycles) along with count, min, max and
+ * sum. A stage is timed from a single task on a single core, so its cells
+ * have one writer and take no atomics; a reader may see the sample in flight
+ * half-applied. Cycles do not depend on the clock the CPU governor picks:
+ * divide by the MHz the stage ran at for time.
+ *
+ * Resetting bumps a generation number; every stage clears itself on its next
+ * sample, so the reader never writes cells the hot path owns. With the option
+ * off, begin/end compile to nothing and stages are empty names.
+ *
+ *   static metrics_profile_t s_prof_parse = METRICS_PROFILE_INIT("rx_parse", "RTP header checks");
+ *   metrics_profile_register(&s_prof_parse);             // at init
+ *   uint32_t t = metrics_profile_begin();                // hot path
+ *   ...
+ *   metrics_profile_end(&s_prof_parse, t);
+ */
+
+#define METRICS_PROFILE_BUCKETS 33      // 0 cycles, then one per bit of a 32-bit count
+
+typedef struct metrics_profile {
+    const char *name;
+    const char *help;
+    bool registered;
+    struct metrics_profile *next;       // Registry order
+#ifdef CONFIG_METRICS_PROFILER
+    uint32_t gen;                       // Reset generation the cells belong to
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[METRICS_PROFILE_BUCKETS];
+#endif
+} metrics_profile_t;
+
+#define METRICS_PROFILE_INIT(n, h) { .name = (n), .help = (h) }
+
+typedef struct {
+    const char *name;
+    const char *help;
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t avg_cycles;
+    uint32_t p99_cycles;                // Upper edge of the bucket holding the 99th percentile
+    uint32_t max_cycles;
+    uint32_t buckets[METRICS_PROFILE_BUCKETS];
+} metrics_profile_stats_t;
+
+#ifdef CONFIG_METRICS_PROFILER
+void metrics_profile_record(metrics_profile_t *p, uint32_t cycles);
+
+static inline uint32_t metrics_profile_begin(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static inline void metrics_profile_end(metrics_profile_t *p, uint32_t start)
+{
+    metrics_profile_record(p, esp_cpu_get_cycle_count() - start);
+}
+#else
+static inline uint32_t metrics_profile_begin(void)
+{
+    return 0;
+}
+
+static inline void metrics_profile_end(metrics_profile_t *p, uint32_t start)
+{
+    (void)p;
+    (void)start;
+}
+#endif
+
+/**
+ * @brief Add a stage to the registry; a second call for the same stage is a no-op
+ */
+esp_err_t metrics_profile_register(metrics_profile_t *p);
+
+/**
+ * @brief Copy out every registered stage's statistics, in registry order
+ *
+ * @return Stages copied (at most max; 0 with the profiler off)
+ */
+size_t metrics_profile_snapshot(metrics_profile_stats_t *out, size_t max);
+
+/**
+ * @brief Start every stage over from its next sample
+ */
+void metrics_profile_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,164 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+
+// Registry: a singly linked list that only grows. A metric's next pointer is
+// set before it is published with a release store, so the exporter walks the
+// list without the lock while modules are still registering.
+static metric_t *s_head = NULL;
+#ifdef CONFIG_METRICS_ENABLED
+static metric_t *s_tail = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+#define METRICS_LINE_MAX 160
+
+uint32_t metrics_counter_get(const metrics_counter_t *c)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < METRICS_CORES; i++) {
+        total += __atomic_load_n(&c->per_core[i], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+void metrics_histogram_get(const metrics_histogram_t *h, uint32_t *counts)
+{
+    for (uint32_t b = 0; b <= h->n_bounds; b++) {
+        uint32_t total = 0;
+        for (int c = 0; c < METRICS_CORES; c++) {
+            total += __atomic_load_n(&h->counts[c][b], __ATOMIC_RELAXED);
+        }
+        counts[b] = total;
+    }
+}
+
+esp_err_t metrics_register(metric_t *metric)
+{
+    if (!metric || !metric->name) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (metric->type == METRIC_HISTOGRAM &&
+        ((metrics_histogram_t *)metric)->n_bounds > CONFIG_METRICS_HIST_MAX_BUCKETS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+#ifdef CONFIG_METRICS_ENABLED
+    portENTER_CRITICAL(&s_lock);
+    if (!metric->registered) {
+        metric->registered = true;
+        metric->next = NULL;
+        if (s_tail) {
+            __atomic_store_n(&s_tail->next, metric, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&s_head, metric, __ATOMIC_RELEASE);
+        }
+        s_tail = metric;
+    }
+    portEXIT_CRITICAL(&s_lock);
+#endif
+    return ESP_OK;
+}
+
+static esp_err_t write_line(metrics_write_fn write, void *ctx, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static esp_err_t write_line(metrics_write_fn write, void *ctx, const char *fmt, ...)
+{
+    char line[METRICS_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+    if ((size_t)len >= sizeof(line)) {
+        // Names and help are short literals; keep the line well-formed if one is not
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+    return write(ctx, line, (size_t)len);
+}
+
+static const char *type_name(metric_type_t type)
+{
+    switch (type) {
+        case METRIC_COUNTER:   return "counter";
+        case METRIC_GAUGE:     return "gauge";
+        case METRIC_HISTOGRAM: return "histogram";
+        default:               return "untyped";
+    }
+}
+
+static esp_err_t write_histogram(metrics_write_fn write, void *ctx, const metrics_histogram_t *h)
+{
+    // Buckets are cumulative; the +Inf bucket is the count
+    uint32_t cumulative = 0;
+    uint32_t sum = 0;
+    esp_err_t ret = ESP_OK;
+
+    for (int c = 0; c < METRICS_CORES; c++) {
+        sum += __atomic_load_n(&h->sum[c], __ATOMIC_RELAXED);
+    }
+    for (uint32_t b = 0; b <= h->n_bounds && ret == ESP_OK; b++) {
+        for (int c = 0; c < METRICS_CORES; c++) {
+            cumulative += __atomic_load_n(&h->counts[c][b], __ATOMIC_RELAXED);
+        }
+        if (b < h->n_bounds) {
+            ret = write_line(write, ctx, "%s_bucket{le=\"%" PRIu32 "\"} %" PRIu32 "\n",
+                             h->base.name, h->bounds[b], cumulative);
+        } else {
+            ret = write_line(write, ctx, "%s_bucket{le=\"+Inf\"} %" PRIu32 "\n",
+                             h->base.name, cumulative);
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = write_line(write, ctx, "%s_sum %" PRIu32 "\n", h->base.name, sum);
+    }
+    if (ret == ESP_OK) {
+        ret = write_line(write, ctx, "%s_count %" PRIu32 "\n", h->base.name, cumulative);
+    }
+    return ret;
+}
+
+esp_err_t metrics_write_prometheus(metrics_write_fn write, void *ctx)
+{
+    if (!write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (const metric_t *m = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+         m && ret == ESP_OK;
+         m = __atomic_load_n(&m->next, __ATOMIC_ACQUIRE)) {
+        if (m->help) {
+            ret = write_line(write, ctx, "# HELP %s %s\n", m->name, m->help);
+        }
+        if (ret == ESP_OK) {
+            ret = write_line(write, ctx, "# TYPE %s %s\n", m->name, type_name(m->type));
+        }
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        switch (m->type) {
+            case METRIC_COUNTER:
+                ret = write_line(write, ctx, "%s %" PRIu32 "\n", m->name,
+                                 metrics_counter_get((const metrics_counter_t *)m));
+                break;
+            case METRIC_GAUGE: {
+                const metrics_gauge_t *g = (const metrics_gauge_t *)m;
+                ret = write_line(write, ctx, "%s %" PRId64 "\n", m->name, g->read ? g->read() : 0);
+                break;
+            }
+            case METRIC_HISTOGRAM:
+                ret = write_histogram(write, ctx, (const metrics_histogram_t *)m);
+                break;
+            default:
+                break;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,46 @@
+#include "metrics_bench.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+#ifndef CONFIG_METRICS_BENCH_TOLERANCE_PCT
+#define CONFIG_METRICS_BENCH_TOLERANCE_PCT 10
+#endif
+
+#ifdef CONFIG_METRICS_BENCH_BASELINE
+#define BENCH_NVS_NAMESPACE "bench"
+
+static const char *TAG = "bench";
+
+void metrics_bench_check(const char *key, uint32_t value)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(BENCH_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    uint32_t base = 0;
+    esp_err_t err = nvs_get_u32(nvs, key, &base);
+#ifdef CONFIG_METRICS_BENCH_REBASE
+    err = ESP_ERR_NVS_NOT_FOUND;
+#endif
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "%s: %u (new baseline)", key, (unsigned)value);
+        base = UINT32_MAX;
+    } else if ((uint64_t)value * 100u > (uint64_t)base * (100u + CONFIG_METRICS_BENCH_TOLERANCE_PCT)) {
+        ESP_LOGW(TAG, "%s: %u regressed %u%% from baseline %u", key, (unsigned)value,
+                 (unsigned)(((uint64_t)value - base) * 100u / (base ? base : 1u)), (unsigned)base);
+    } else {
+        ESP_LOGI(TAG, "%s: %u (baseline %u)", key, (unsigned)value, (unsigned)base);
+    }
+    if (value < base) {
+        nvs_set_u32(nvs, key, value);
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+}
+#else
+void metrics_bench_check(const char *key, uint32_t value)
+{
+    (void)key;
+    (void)value;
+}
+#endif
@@ -0,0 +1,121 @@
+#include "metrics_profile.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef CONFIG_METRICS_PROFILER
+// Same scheme as the metrics registry: a grow-only list published with release
+// stores, walked by readers without the lock
+static metrics_profile_t *s_head = NULL;
+static metrics_profile_t *s_tail = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Starts at 1 so a stage's zeroed cells read as stale until its first sample
+static uint32_t s_gen = 1;
+
+void metrics_profile_record(metrics_profile_t *p, uint32_t cycles)
+{
+    uint32_t gen = __atomic_load_n(&s_gen, __ATOMIC_RELAXED);
+    if (p->gen != gen) {
+        memset(p->buckets, 0, sizeof(p->buckets));
+        p->count = 0;
+        p->sum = 0;
+        p->min = UINT32_MAX;
+        p->max = 0;
+        p->gen = gen;
+    }
+    unsigned b = cycles ? 32u - (unsigned)__builtin_clz(cycles) : 0u;
+    p->buckets[b]++;
+    p->count++;
+    p->sum += cycles;
+    if (cycles < p->min) {
+        p->min = cycles;
+    }
+    if (cycles > p->max) {
+        p->max = cycles;
+    }
+}
+
+static uint32_t bucket_upper(unsigned b)
+{
+    return b >= 32u ? UINT32_MAX : (1u << b) - 1u;
+}
+#endif
+
+esp_err_t metrics_profile_register(metrics_profile_t *p)
+{
+    if (!p || !p->name) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#ifdef CONFIG_METRICS_PROFILER
+    portENTER_CRITICAL(&s_lock);
+    if (!p->registered) {
+        p->registered = true;
+        p->next = NULL;
+        if (s_tail) {
+            __atomic_store_n(&s_tail->next, p, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&s_head, p, __ATOMIC_RELEASE);
+        }
+        s_tail = p;
+    }
+    portEXIT_CRITICAL(&s_lock);
+#endif
+    return ESP_OK;
+}
+
+size_t metrics_profile_snapshot(metrics_profile_stats_t *out, size_t max)
+{
+    size_t n = 0;
+#ifdef CONFIG_METRICS_PROFILER
+    uint32_t gen = __atomic_load_n(&s_gen, __ATOMIC_RELAXED);
+    for (metrics_profile_t *p = __atomic_load_n(&s_head, __ATOMIC_ACQUIRE); p && n < max;
+         p = __atomic_load_n(&p->next, __ATOMIC_ACQUIRE)) {
+        metrics_profile_stats_t *s = &out[n++];
+        memset(s, 0, sizeof(*s));
+        s->name = p->name;
+        s->help = p->help;
+        if (p->gen != gen) {
+            continue;   // Nothing since the last reset
+        }
+        memcpy(s->buckets, p->buckets, sizeof(s->buckets));
+        uint64_t sum = p->sum;
+        s->min_cycles = p->min;
+        s->max_cycles = p->max;
+
+        // Count from the copied buckets, so the percentile matches the histogram returned
+        uint32_t count = 0;
+        for (unsigned b = 0; b < METRICS_PROFILE_BUCKETS; b++) {
+            count += s->buckets[b];
+        }
+        s->count = count;
+        if (count == 0) {
+            s->min_cycles = 0;
+            continue;
+        }
+        s->avg_cycles = (uint32_t)(sum / count);
+        uint64_t target = ((uint64_t)count * 99u + 99u) / 100u;
+        uint64_t seen = 0;
+        for (unsigned b = 0; b < METRICS_PROFILE_BUCKETS; b++) {
+            seen += s->buckets[b];
+            if (seen >= target) {
+                s->p99_cycles = bucket_upper(b);
+                break;
+            }
+        }
+        if (s->p99_cycles > s->max_cycles) {
+            s->p99_cycles = s->max_cycles;
+        }
+    }
+#else
+    (void)out;
+    (void)max;
+#endif
+    return n;
+}
+
+void metrics_profile_reset(void)
+{
+#ifdef CONFIG_METRICS_PROFILER
+    __atomic_fetch_add(&s_gen, 1, __ATOMIC_RELAXED);
+#endif
+}
@@ -351,41 +351,48 @@ esp_err_t bq25895_reset_watchdog(void)
 }
 
 /**
- * @brief Get the current status of the BQ25895
+ * @brief Read consecutive registers in one transaction
  */
-esp_err_t bq25895_get_status(bq25895_status_t *status)
+esp_err_t bq25895_read_regs(bq25895_reg_t start, uint8_t *buf, size_t len)
 {
-    if (!is_initialized || status == NULL) {
+    if (!is_initialized || i2c_dev_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (buf == NULL || len == 0 || start + len > BQ25895_REG_COUNT) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    uint8_t reg_0b, reg_0c, reg_0e, reg_0f, reg_10, reg_11, reg_12, reg_13;
-    esp_err_t ret;
-
-    // Read status registers
-    ret = bq25895_read_reg(BQ25895_REG_0B, &reg_0b);
-    if (ret != ESP_OK) return ret;
-
-    ret = bq25895_read_reg(BQ25895_REG_0C, &reg_0c);
-    if (ret != ESP_OK) return ret;
-
-    ret = bq25895_read_reg(BQ25895_REG_0E, &reg_0e);
-    if (ret != ESP_OK) return ret;
+    if (xSemaphoreTake(i2c_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to take I2C mutex");
+        return ESP_ERR_TIMEOUT;
+    }
 
-    ret = bq25895_read_reg(BQ25895_REG_0F, &reg_0f);
-    if (ret != ESP_OK) return ret;
+    // The register pointer auto-increments, so one repeated-start read covers the range
+    uint8_t write_buf = start;
+    esp_err_t ret = i2c_master_transmit_receive(i2c_dev_handle, &write_buf, 1, buf, len, pdMS_TO_TICKS(100));
 
-    ret = bq25895_read_reg(BQ25895_REG_10, &reg_10);
-    if (ret != ESP_OK) return ret;
+    xSemaphoreGive(i2c_mutex);
 
-    ret = bq25895_read_reg(BQ25895_REG_11, &reg_11);
-    if (ret != ESP_OK) return ret;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read registers 0x%02x..0x%02x, err = %d (%s)",
+                 start, (unsigned)(start + len - 1), ret, esp_err_to_name(ret));
+    }
 
-    ret = bq25895_read_reg(BQ25895_REG_12, &reg_12);
-    if (ret != ESP_OK) return ret;
+    return ret;
+}
 
-    ret = bq25895_read_reg(BQ25895_REG_13, &reg_13);
-    if (ret != ESP_OK) return ret;
+/**
+ * @brief Decode a register snapshot into a status structure
+ */
+void bq25895_parse_status(const uint8_t regs[BQ25895_REG_COUNT], bq25895_status_t *status)
+{
+    uint8_t reg_0b = regs[BQ25895_REG_0B];
+    uint8_t reg_0c = regs[BQ25895_REG_0C];
+    uint8_t reg_0e = regs[BQ25895_REG_0E];
+    uint8_t reg_0f = regs[BQ25895_REG_0F];
+    uint8_t reg_10 = regs[BQ25895_REG_10];
+    uint8_t reg_11 = regs[BQ25895_REG_11];
+    uint8_t reg_12 = regs[BQ25895_REG_12];
 
     // Parse status registers
     status->vbus_stat = (reg_0b >> 5) & 0x07;
@@ -408,7 +415,22 @@ esp_err_t bq25895_get_status(bq25895_status_t *status)
     status->ts_voltage = 0.21f + ((reg_10 & 0x7F) * 0.00465f);
     status->vbus_voltage = 2.6f + ((reg_11 & 0x7F) * 0.1f);
     status->charge_current = (reg_12 & 0x7F) * 0.05f;
+}
+
+/**
+ * @brief Get the current status of the BQ25895
+ */
+esp_err_t bq25895_get_status(bq25895_status_t *status)
+{
+    if (!is_initialized || status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t regs[BQ25895_REG_COUNT];
+    esp_err_t ret = bq25895_read_regs(BQ25895_REG_00, regs, sizeof(regs));
+    if (ret != ESP_OK) return ret;
 
+    bq25895_parse_status(regs, status);
     return ESP_OK;
 }
 
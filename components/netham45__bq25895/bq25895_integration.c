@@ -9,6 +9,14 @@
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_attr.h"
+
+#ifndef CONFIG_BQ25895_INT_GPIO
+#define CONFIG_BQ25895_INT_GPIO -1
+#endif
+#ifndef CONFIG_BQ25895_REFRESH_MS
+#define CONFIG_BQ25895_REFRESH_MS 10000
+#endif
 
 static const char *TAG = "bq25895_integration";
 
@@ -39,6 +47,119 @@ static const bq25895_charge_params_t default_charge_params = {
 
 // I2C master initialization is now handled by the BQ25895 driver
 
+// Status snapshot, refreshed by the monitor task and read by every consumer.
+// INT pulses on charge state and fault changes; the ADC values drift without
+// one, so the task also refreshes every CONFIG_BQ25895_REFRESH_MS.
+static portMUX_TYPE s_status_lock = portMUX_INITIALIZER_UNLOCKED;
+static bq25895_status_t s_status;
+static bool s_status_valid = false;
+static TaskHandle_t s_monitor_task = NULL;
+static uint8_t s_last_fault = 0;
+
+static void refresh_status(void)
+{
+    uint8_t regs[BQ25895_REG_COUNT];
+    if (bq25895_read_regs(BQ25895_REG_00, regs, sizeof(regs)) != ESP_OK) {
+        return;
+    }
+    bq25895_status_t status;
+    bq25895_parse_status(regs, &status);
+
+    taskENTER_CRITICAL(&s_status_lock);
+    bq25895_status_t prev = s_status;
+    bool had_status = s_status_valid;
+    s_status = status;
+    s_status_valid = true;
+    taskEXIT_CRITICAL(&s_status_lock);
+
+    if (!had_status || prev.vbus_stat != status.vbus_stat || prev.chg_stat != status.chg_stat ||
+        prev.pg_stat != status.pg_stat) {
+        ESP_LOGI(TAG, "VBUS %d, charge %d, power good %d", status.vbus_stat, status.chg_stat,
+                 status.pg_stat);
+    }
+    if (regs[BQ25895_REG_0C] != s_last_fault) {
+        s_last_fault = regs[BQ25895_REG_0C];
+        if (s_last_fault != 0) {
+            ESP_LOGW(TAG, "Fault register 0x%02x", s_last_fault);
+        }
+    }
+}
+
+// Wake the monitor task to re-read the snapshot, e.g. after a configuration write
+static void request_refresh(void)
+{
+    if (s_monitor_task) {
+        xTaskNotifyGive(s_monitor_task);
+    }
+}
+
+#if CONFIG_BQ25895_INT_GPIO >= 0
+static void IRAM_ATTR bq25895_int_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_monitor_task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static esp_err_t install_int_pin(void)
+{
+    // INT is open drain and pulses low for 256 us on every change
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << CONFIG_BQ25895_INT_GPIO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // Another driver may have installed the service already
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+    return gpio_isr_handler_add(CONFIG_BQ25895_INT_GPIO, bq25895_int_isr, NULL);
+}
+#endif
+
+static void bq25895_monitor_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_BQ25895_REFRESH_MS));
+        refresh_status();
+    }
+}
+
+// Pinned to core 0 with the ISR: none of the charger's I2C traffic lands on the audio core
+static esp_err_t start_monitor(void)
+{
+    if (s_monitor_task) {
+        return ESP_OK;
+    }
+    refresh_status();
+    if (xTaskCreatePinnedToCore(bq25895_monitor_task, "bq25895_mon", 3072, NULL, 2,
+                                &s_monitor_task, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create monitor task");
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_BQ25895_INT_GPIO >= 0
+    esp_err_t ret = install_int_pin();
+    if (ret != ESP_OK) {
+        // Still refreshed on the timer
+        ESP_LOGW(TAG, "Failed to set up INT on GPIO %d: %s", CONFIG_BQ25895_INT_GPIO,
+                 esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Monitoring INT on GPIO %d, refresh every %d ms", CONFIG_BQ25895_INT_GPIO,
+                 CONFIG_BQ25895_REFRESH_MS);
+    }
+#else
+    ESP_LOGI(TAG, "No INT pin, refresh every %d ms", CONFIG_BQ25895_REFRESH_MS);
+#endif
+    return ESP_OK;
+}
+
 static TickType_t s_last_watchdog_reset = 0;
 static bool s_watchdog_tick_enabled = false;
 static const TickType_t WATCHDOG_RESET_INTERVAL_TICKS = pdMS_TO_TICKS(30000);
@@ -102,7 +223,7 @@ esp_err_t bq25895_integration_init(void)
         .i2c_freq = BQ25895_DEFAULT_I2C_FREQ_HZ,
         .sda_gpio = BQ25895_DEFAULT_SDA_GPIO,
         .scl_gpio = BQ25895_DEFAULT_SCL_GPIO,
-        .int_gpio = -1,  // Not used
+        .int_gpio = CONFIG_BQ25895_INT_GPIO,
         .stat_gpio = -1  // Not used
     };
     ret = bq25895_init(&config);
@@ -167,6 +288,11 @@ esp_err_t bq25895_integration_init(void)
         return ret;
     }
 
+    ret = start_monitor();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
     ESP_LOGI(TAG, "BQ25895 integration initialized successfully");
     return ESP_OK;
 }
@@ -176,8 +302,15 @@ esp_err_t bq25895_integration_get_status(bq25895_status_t *status)
     if (status == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    return bq25895_get_status(status);
+
+    taskENTER_CRITICAL(&s_status_lock);
+    bool valid = s_status_valid;
+    if (valid) {
+        *status = s_status;
+    }
+    taskEXIT_CRITICAL(&s_status_lock);
+
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
 }
 
 esp_err_t bq25895_integration_get_charge_params(bq25895_charge_params_t *params)
@@ -194,8 +327,10 @@ esp_err_t bq25895_integration_set_charge_params(const bq25895_charge_params_t *p
     if (params == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    return bq25895_set_charge_params(params);
+
+    esp_err_t ret = bq25895_set_charge_params(params);
+    request_refresh();
+    return ret;
 }
 
 esp_err_t bq25895_integration_reset(void)
@@ -213,6 +348,7 @@ esp_err_t bq25895_integration_reset(void)
         return ret;
     }
     
+    request_refresh();
     ESP_LOGI(TAG, "BQ25895 reset successfully");
     return ESP_OK;
 }
@@ -245,5 +381,7 @@ esp_err_t bq25895_integration_read_register(uint8_t reg, uint8_t *value)
 
 esp_err_t bq25895_integration_write_register(uint8_t reg, uint8_t value)
 {
-    return bq25895_write_reg((bq25895_reg_t)reg, value);
+    esp_err_t ret = bq25895_write_reg((bq25895_reg_t)reg, value);
+    request_refresh();
+    return ret;
 }
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "driver/i2c_master.h"
 
@@ -50,6 +51,9 @@ typedef enum {
     BQ25895_REG_14                     = 0x14,  /* Device ID/Reset Control */
 } bq25895_reg_t;
 
+/** @brief Number of registers, 0x00 through 0x14 */
+#define BQ25895_REG_COUNT              0x15
+
 /** @brief Boost mode specific register aliases for clarity */
 #define BQ25895_REG_CONTROL1           BQ25895_REG_03  /* OTG_CONFIG, CHG_CONFIG */
 #define BQ25895_REG_BOOST_VOLTAGE      BQ25895_REG_0A  /* BOOSTV[3:0] bits 7-4 */
@@ -179,6 +183,14 @@ esp_err_t bq25895_reset(void);
  */
 esp_err_t bq25895_get_status(bq25895_status_t *status);
 
+/**
+ * @brief Decode a register snapshot into a status structure
+ *
+ * @param regs All registers, indexed by address
+ * @param status Pointer to status structure to fill
+ */
+void bq25895_parse_status(const uint8_t regs[BQ25895_REG_COUNT], bq25895_status_t *status);
+
 /**
  * @brief Get the current charge parameters of the BQ25895
  * 
@@ -267,6 +279,16 @@ esp_err_t bq25895_reset_watchdog(void);
  */
 esp_err_t bq25895_read_reg(bq25895_reg_t reg, uint8_t *value);
 
+/**
+ * @brief Read consecutive registers in a single I2C transaction
+ *
+ * @param start First register address
+ * @param buf Buffer for the values
+ * @param len Number of registers; start + len must not pass the last register
+ * @return ESP_OK on success
+ */
+esp_err_t bq25895_read_regs(bq25895_reg_t start, uint8_t *buf, size_t len);
+
 /**
  * @brief Write a register to the BQ25895
  * 
@@ -22,8 +22,13 @@ esp_err_t bq25895_integration_init(void);
 /**
  * @brief Get the current status of the BQ25895 charger.
  *
+ * Returns the cached snapshot without touching the bus. A core 0 monitor task
+ * refreshes it with one burst read when the INT pin (CONFIG_BQ25895_INT_GPIO)
+ * signals a change, after configuration writes, and every
+ * CONFIG_BQ25895_REFRESH_MS.
+ *
  * @param status Pointer to a structure where the status will be stored.
- * @return ESP_OK on success, or an error code otherwise.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before the first snapshot.
  */
 esp_err_t bq25895_integration_get_status(bq25895_status_t *status);
 
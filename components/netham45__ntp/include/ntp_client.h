@@ -15,7 +15,7 @@ extern "C" {
  * - Query mDNS for "screamrouter.local" NTP server
  * - Initialize SNTP for wall-clock time synchronization
  * - Run high-rate NTP micro-probes for precision audio synchronization
- * - Maintain a PLL for offset and skew tracking
+ * - Track offset and skew with a min-RTT windowed Kalman filter
  *
  * This function is safe to call multiple times - it will only initialize once.
  */
@@ -76,27 +76,44 @@ int64_t ntp_local_to_master(int64_t local_mono_us);
  */
 bool ntp_get_pll_state(double *offset_us, double *skew_ppm);
 
+typedef struct {
+    bool valid;                 // Filter initialized from at least one sample
+    bool converged;             // Offset uncertainty and last innovation within bounds
+    double offset_sigma_us;     // Filter's 1-sigma offset uncertainty
+    double skew_ppm;            // Estimated skew
+    double skew_sigma_ppm;      // 1-sigma skew uncertainty
+    int64_t last_innovation_us; // Last sample minus the filter's prediction
+    int64_t rtt_floor_us;       // Minimum RTT over the sample window
+    int64_t last_rtt_us;        // RTT of the last burst's best sample
+    uint32_t probe_interval_ms; // Current interval between probe bursts
+    uint32_t samples;           // Samples accepted by the filter
+    uint32_t rejected;          // Samples skipped (excess delay) or gated (outlier)
+    uint32_t resets;            // Filter restarts after repeated outliers
+    int corrections_applied;    // System clock slews/steps
+    int64_t total_correction_us;// Sum of system clock corrections
+    int64_t current_error_us;   // System clock error vs filtered master time at the last update
+} ntp_convergence_status_t;
+
 /**
- * @brief Get current PLL convergence status
+ * @brief Get the offset/skew filter's convergence status
  *
- * Returns the current convergence status of the PLL including correction history.
- * Useful for monitoring convergence and determining when the clock is stable.
+ * Each probe burst's minimum-RTT sample is weighed against the smallest RTT
+ * in a sliding window and fed to a two-state (offset, skew) Kalman filter;
+ * the probe interval doubles while converged and halves otherwise.
  *
- * @param corrections_applied Output: total number of corrections applied (can be NULL)
- * @param total_correction_us Output: total correction amount in microseconds (can be NULL)
- * @param current_error_us Output: current error in microseconds (can be NULL)
- * @return true if PLL is valid and converged (error < 500µs), false otherwise
+ * @param status Output: filter and system clock metrics (can be NULL)
+ * @return true if the filter is valid and converged, false otherwise
  *
- * @note A converged clock typically has error < 500µs. During convergence, multiple
- *       corrections may be applied, especially for offsets in the 500µs - 100ms range.
+ * @note Converged means at least 4 samples, a 1-sigma offset uncertainty
+ *       under 250 µs and a last innovation within the gate at that sigma.
  */
-bool ntp_get_convergence_status(int *corrections_applied, int64_t *total_correction_us, int64_t *current_error_us);
+bool ntp_get_convergence_status(ntp_convergence_status_t *status);
 
 /**
  * @brief Manually trigger an NTP micro-probe burst
  *
- * Immediately performs a burst of NTP queries (8 samples) and updates the PLL
- * with the min-RTT sample. Useful for:
+ * Immediately performs a burst of NTP queries (8 samples) and feeds the
+ * min-RTT sample to the filter. Useful for:
  * - Testing the sync system
  * - Getting a fresh offset measurement before critical audio timing
  * - Recovering from network interruptions
@@ -104,7 +121,8 @@ bool ntp_get_convergence_status(int *corrections_applied, int64_t *total_correct
  * @return true if successful and PLL was updated, false otherwise
  *
  * @note This is a blocking call that takes ~100ms to complete (burst + network latency).
- *       The background task already does this periodically (5 Hz initially, then 1 Hz).
+ *       The background task already does this periodically, every
+ *       CONFIG_NTP_PROBE_MIN_INTERVAL_MS to CONFIG_NTP_PROBE_MAX_INTERVAL_MS.
  */
 /**
  * @brief Dynamically set NTP client configuration
@@ -32,6 +32,14 @@
 #define NTP_PROBE_BURST_SIZE 8       // Number of samples per burst
 #define NTP_PROBE_TIMEOUT_MS 100     // Timeout per probe
 
+// Adaptive probe interval bounds (between bursts)
+#ifndef CONFIG_NTP_PROBE_MIN_INTERVAL_MS
+#define CONFIG_NTP_PROBE_MIN_INTERVAL_MS 250
+#endif
+#ifndef CONFIG_NTP_PROBE_MAX_INTERVAL_MS
+#define CONFIG_NTP_PROBE_MAX_INTERVAL_MS 8000
+#endif
+
 static const char *TAG = "ntp_client";
 
 // Clock correction thresholds
@@ -71,44 +79,90 @@ static int64_t last_known_time_us = 0;  // Timestamp in microseconds when last_k
 // NTP MICRO-PROBE & PLL for precision audio synchronization
 // ============================================================================
 
-// Simple PLL state for local_mono ≈ a * master_us + b
+// Mapping published to the audio path: master_us = a * local_mono + b
 typedef struct {
     double a;           // Skew factor (≈ 1.0 + small ppm error)
     double b;           // Offset in microseconds
-    int64_t last_update_mono_us;  // When PLL was last updated (local monotonic)
-    int64_t last_master_us;       // Last master time used for update
-    bool valid;         // Whether PLL has been initialized
-    int sample_count;   // Number of samples incorporated
-    int64_t total_correction_us;  // Total corrections applied
-    int correction_count;         // Number of corrections
-    int64_t last_error_us;       // Last error magnitude for convergence tracking
+    bool valid;         // Whether the filter has been initialized
+    int64_t total_correction_us;  // Total system clock corrections applied
+    int correction_count;         // Number of system clock corrections
+    int64_t last_error_us;        // System clock error at the last update
 } ntp_pll_t;
 
 static ntp_pll_t pll = {
     .a = 1.0,
     .b = 0.0,
-    .last_update_mono_us = 0,
-    .last_master_us = 0,
     .valid = false,
-    .sample_count = 0,
     .total_correction_us = 0,
     .correction_count = 0,
     .last_error_us = 0
 };
 
-// Single NTP probe sample
+// Single NTP probe sample, timed on the monotonic clock
 typedef struct {
-    int64_t theta_us;   // Clock offset (client - server) in microseconds
-    int64_t rtt_us;     // Round-trip time in microseconds
+    int64_t mono_us;    // Local monotonic time at the probe midpoint
+    int64_t theta_us;   // Offset: master - monotonic at mono_us
+    int64_t rtt_us;     // Round trip less the server's hold time
     bool valid;         // Whether this sample is valid
 } ntp_sample_t;
 
+/*
+ * Offset/skew filter
+ *
+ * Each burst's minimum-RTT sample enters a sliding window whose smallest RTT
+ * is the reference path delay. On Wi-Fi the error of an NTP offset is bounded
+ * by half the delay above that floor (the asymmetric part), so a sample's
+ * measurement noise grows with its excess delay and samples far above the
+ * floor are skipped. Accepted samples drive a two-state Kalman filter over
+ * offset (us) and skew (ppm) with a constant-skew model; innovations beyond
+ * NTP_KF_GATE_SIGMA are treated as outliers, and NTP_KF_MAX_REJECTS of them
+ * in a row restart the filter (the server stepped). The probe interval
+ * doubles while the filter would stay converged over the longer wait and
+ * halves when it is not converged.
+ */
+#define NTP_FILTER_WINDOW        8          // Burst winners kept for the RTT floor
+#define NTP_FILTER_RTT_GATE_US   5000LL     // Skip samples this far above the floor
+#define NTP_FILTER_BASE_SIGMA_US 100.0      // Measurement noise of a sample on the floor
+#define NTP_KF_Q_OFFSET          25.0       // Offset random walk, us^2 per second (5 us/√s)
+#define NTP_KF_Q_SKEW            1.0e-3     // Skew random walk, ppm^2 per second (0.03 ppm/√s)
+#define NTP_KF_INIT_SKEW_SIGMA   50.0       // Prior skew uncertainty (ppm)
+#define NTP_KF_SKEW_LIMIT_PPM    500.0      // Crystal error larger than this is not believed
+#define NTP_KF_GATE_SIGMA        4.0        // Innovation gate
+#define NTP_KF_MAX_REJECTS       3          // Consecutive outliers before a restart
+#define NTP_CONVERGED_SIGMA_US   250.0      // Converged: offset uncertainty below this...
+#define NTP_CONVERGED_SAMPLES    4          // ...after at least this many samples
+
+typedef struct {
+    bool valid;
+    double theta_us;        // Offset at t_us
+    double skew_ppm;
+    double p[2][2];         // Covariance (us^2, us*ppm, ppm^2)
+    int64_t t_us;           // Monotonic time of the state
+    int64_t last_innovation_us;
+    uint32_t samples;
+    uint32_t rejected;
+    uint32_t resets;
+    int consecutive_rejects;
+    int64_t window_rtt[NTP_FILTER_WINDOW];
+    int window_count;
+    int window_next;
+    int64_t rtt_floor_us;
+    int64_t last_rtt_us;
+    uint32_t probe_interval_ms;
+    bool converged;
+} ntp_filter_t;
+
+static ntp_filter_t kf = {};
+
 // Mutex for PLL access from multiple threads
 static SemaphoreHandle_t pll_mutex = NULL;
 
 /**
  * @brief Sends a single NTP query and returns offset + RTT
  *
+ * T1 and T4 are taken on the monotonic clock, so the offset is master time
+ * against esp_timer and does not move when the system clock is stepped.
+ *
  * @param server_ip NTP server IP address string
  * @param sample Output sample structure
  * @return true if successful, false otherwise
@@ -141,15 +195,7 @@ static bool ntp_query_single(const char *server_ip, ntp_sample_t *sample, uint16
     ntp_packet[0] = 0x23; // LI=0, Version=4, Mode=3 (client)
 
     // Capture T1 (client transmit time)
-    struct timeval t1_tv;
-    gettimeofday(&t1_tv, NULL);
-    int64_t t1_us = (int64_t)t1_tv.tv_sec * 1000000LL + (int64_t)t1_tv.tv_usec;
-    
-    // If system time is not initialized yet (year < 2020), use monotonic time
-    bool use_monotonic = (t1_tv.tv_sec < 1577836800); // Jan 1, 2020
-    if (use_monotonic) {
-        t1_us = esp_timer_get_time();
-    }
+    int64_t t1_us = esp_timer_get_time();
 
     // Send NTP request
     if (sendto(sock, ntp_packet, sizeof(ntp_packet), 0,
@@ -165,24 +211,31 @@ static bool ntp_query_single(const char *server_ip, ntp_sample_t *sample, uint16
                      (struct sockaddr*)&server_addr, &socklen);
 
     // Capture T4 (client receive time)
-    int64_t t4_us;
-    if (use_monotonic) {
-        t4_us = esp_timer_get_time();
-    } else {
-        struct timeval t4_tv;
-        gettimeofday(&t4_tv, NULL);
-        t4_us = (int64_t)t4_tv.tv_sec * 1000000LL + (int64_t)t4_tv.tv_usec;
-    }
+    int64_t t4_us = esp_timer_get_time();
 
     close(sock);
 
     if (r != sizeof(ntp_response)) {
         return false;
     }
+    // Server mode, not a kiss-o'-death (stratum 0)
+    if ((ntp_response[0] & 0x07) != 4 || ntp_response[1] == 0) {
+        return false;
+    }
 
     // Extract server timestamps from NTP response
     // T2 = receive timestamp (bytes 32-39)
     // T3 = transmit timestamp (bytes 40-47)
+    uint32_t t2_sec = ((uint32_t)ntp_response[32] << 24) |
+                      ((uint32_t)ntp_response[33] << 16) |
+                      ((uint32_t)ntp_response[34] << 8) |
+                      (uint32_t)ntp_response[35];
+
+    uint32_t t2_frac = ((uint32_t)ntp_response[36] << 24) |
+                       ((uint32_t)ntp_response[37] << 16) |
+                       ((uint32_t)ntp_response[38] << 8) |
+                       (uint32_t)ntp_response[39];
+
     uint32_t t3_sec = ((uint32_t)ntp_response[40] << 24) |
                       ((uint32_t)ntp_response[41] << 16) |
                       ((uint32_t)ntp_response[42] << 8) |
@@ -192,37 +245,29 @@ static bool ntp_query_single(const char *server_ip, ntp_sample_t *sample, uint16
                        ((uint32_t)ntp_response[45] << 16) |
                        ((uint32_t)ntp_response[46] << 8) |
                        (uint32_t)ntp_response[47];
+    if (t3_sec == 0) {
+        return false;
+    }
 
     // Convert NTP time to Unix microseconds
     // NTP epoch is 1900-01-01, Unix epoch is 1970-01-01 (difference: 2208988800 seconds)
     int64_t t3_unix_us = ((int64_t)(t3_sec - 2208988800UL) * 1000000LL) +
                          ((int64_t)t3_frac * 1000000LL / 4294967296LL);
-
-    // Calculate offset using NTP algorithm: theta = ((T2-T1) + (T3-T4)) / 2
-    // We assume T2 ≈ T3 for simplicity (server processing time negligible)
-    // So: theta ≈ T3 - (T1 + T4)/2
-    if (use_monotonic) {
-        // When using monotonic time, we need to calculate offset differently
-        // We can't directly compare monotonic time to Unix time
-        // Instead, set the offset to the full Unix time minus half RTT
-        int64_t rtt_us = t4_us - t1_us;
-        int64_t midpoint_us = t1_us + rtt_us / 2;
-        
-        // Get current system time to calculate how to adjust
-        struct timeval now_tv;
-        gettimeofday(&now_tv, NULL);
-        int64_t now_unix_us = (int64_t)now_tv.tv_sec * 1000000LL + (int64_t)now_tv.tv_usec;
-        int64_t now_mono_us = esp_timer_get_time();
-        
-        // The server time at midpoint was t3_unix_us
-        // Our monotonic time at midpoint was midpoint_us
-        // So offset = server_time - (system_time - mono_time + midpoint_mono)
-        sample->theta_us = t3_unix_us - now_unix_us + (now_mono_us - midpoint_us);
-        sample->rtt_us = rtt_us;
-    } else {
-        sample->theta_us = t3_unix_us - (t1_us + t4_us) / 2;
-        sample->rtt_us = t4_us - t1_us;
+    int64_t t2_unix_us = t3_unix_us;
+    if (t2_sec != 0) {
+        t2_unix_us = ((int64_t)(t2_sec - 2208988800UL) * 1000000LL) +
+                     ((int64_t)t2_frac * 1000000LL / 4294967296LL);
+    }
+    int64_t hold_us = t3_unix_us - t2_unix_us;
+    if (hold_us < 0 || hold_us > t4_us - t1_us) {
+        hold_us = 0;  // Server without a usable receive timestamp: assume T2 ≈ T3
+        t2_unix_us = t3_unix_us;
     }
+
+    // theta = ((T2 - T1) + (T3 - T4)) / 2, delta = (T4 - T1) - (T3 - T2)
+    sample->mono_us = t1_us + (t4_us - t1_us) / 2;
+    sample->theta_us = (t2_unix_us - t1_us + t3_unix_us - t4_us) / 2;
+    sample->rtt_us = (t4_us - t1_us) - hold_us;
     sample->valid = true;
 
     return true;
@@ -261,15 +306,118 @@ static bool ntp_micro_probe_burst(const char *server_ip, uint16_t port, ntp_samp
     }
 
     if (valid_count > 0) {
-        ESP_LOGI(TAG, "NTP micro-probe: %d/%d valid, best RTT=%" PRId64 " µs, offset=%+" PRId64 " µs",
+        ESP_LOGD(TAG, "NTP micro-probe: %d/%d valid, best RTT=%" PRId64 " µs, offset=%+" PRId64 " µs",
                  valid_count, NTP_PROBE_BURST_SIZE, best_sample->rtt_us, best_sample->theta_us);
     }
 
     return best_sample->valid;
 }
 
+// Forget the filter (server change); must hold pll_mutex
+static void pll_reset_locked(void) {
+    uint32_t resets = kf.resets;
+    kf = {};
+    kf.resets = resets;
+    kf.probe_interval_ms = CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
+    pll.valid = false;
+    pll.a = 1.0;
+    pll.b = 0.0;
+    pll.total_correction_us = 0;
+    pll.correction_count = 0;
+    pll.last_error_us = 0;
+}
+
+static void kf_init_locked(const ntp_sample_t *sample, double r) {
+    kf.valid = true;
+    kf.theta_us = (double)sample->theta_us;
+    kf.skew_ppm = 0.0;
+    kf.p[0][0] = r;
+    kf.p[0][1] = 0.0;
+    kf.p[1][0] = 0.0;
+    kf.p[1][1] = NTP_KF_INIT_SKEW_SIGMA * NTP_KF_INIT_SKEW_SIGMA;
+    kf.t_us = sample->mono_us;
+    kf.last_innovation_us = 0;
+    kf.consecutive_rejects = 0;
+}
+
+static bool kf_converged_locked(void) {
+    return kf.valid && kf.samples >= NTP_CONVERGED_SAMPLES &&
+           kf.p[0][0] < NTP_CONVERGED_SIGMA_US * NTP_CONVERGED_SIGMA_US &&
+           llabs(kf.last_innovation_us) < (int64_t)(NTP_KF_GATE_SIGMA * NTP_CONVERGED_SIGMA_US);
+}
+
+// Offset variance the filter would have after coasting for interval_ms
+static double kf_predicted_var_locked(uint32_t interval_ms) {
+    double dt_s = (double)interval_ms / 1000.0;
+    return kf.p[0][0] + dt_s * (2.0 * kf.p[0][1] + dt_s * kf.p[1][1]) + NTP_KF_Q_OFFSET * dt_s +
+           NTP_KF_Q_SKEW * dt_s * dt_s * dt_s / 3.0;
+}
+
+// Update the RTT window; returns the sample's measurement variance, or < 0 to skip it
+static double kf_window_locked(const ntp_sample_t *sample) {
+    kf.window_rtt[kf.window_next] = sample->rtt_us;
+    kf.window_next = (kf.window_next + 1) % NTP_FILTER_WINDOW;
+    if (kf.window_count < NTP_FILTER_WINDOW) {
+        kf.window_count++;
+    }
+    int64_t floor_us = INT64_MAX;
+    for (int i = 0; i < kf.window_count; i++) {
+        if (kf.window_rtt[i] < floor_us) {
+            floor_us = kf.window_rtt[i];
+        }
+    }
+    kf.rtt_floor_us = floor_us;
+    kf.last_rtt_us = sample->rtt_us;
+
+    int64_t excess_us = sample->rtt_us - floor_us;
+    if (kf.window_count >= 3 && excess_us > NTP_FILTER_RTT_GATE_US) {
+        return -1.0;
+    }
+    double sigma = NTP_FILTER_BASE_SIGMA_US + (double)excess_us / 2.0;
+    return sigma * sigma;
+}
+
+// Step or slew the system clock (SNTP clients, logs, wall-clock users) toward the filtered
+// master time. The audio path reads the filter's mapping directly and is unaffected.
+static void pll_discipline_system_clock_locked(int64_t now_mono_us) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t system_us = (int64_t)tv.tv_sec * 1000000LL + (int64_t)tv.tv_usec;
+    int64_t master_us = (int64_t)(pll.a * (double)now_mono_us + pll.b);
+    int64_t offset_to_correct = master_us - system_us;
+    pll.last_error_us = offset_to_correct;
+
+    if (llabs(offset_to_correct) <= MIN_CORRECTION_US) {
+        return;
+    }
+
+    int64_t correction_us = offset_to_correct;
+    if (llabs(offset_to_correct) < SLEW_THRESHOLD_US && tv.tv_sec >= 1577836800) {  // Jan 1, 2020
+        // SLEWING: gradual correction for small offsets, faster if it persists
+        int64_t max_correction = MAX_SLEW_RATE_US;
+        if (pll.correction_count > 5 && llabs(offset_to_correct) > 2000) {
+            max_correction = MAX_SLEW_RATE_US * 2;
+        }
+        if (correction_us > max_correction) correction_us = max_correction;
+        if (correction_us < -max_correction) correction_us = -max_correction;
+        ESP_LOGD(TAG, "Clock slew: applied %+" PRId64 " µs correction (offset was %+" PRId64 " µs)",
+                 correction_us, offset_to_correct);
+    } else if (llabs(offset_to_correct) < STEP_THRESHOLD_US) {
+        ESP_LOGI(TAG, "Clock step: corrected %+.3f ms offset", (double)offset_to_correct / 1000.0);
+    } else {
+        ESP_LOGW(TAG, "Large time offset detected: %.3f seconds", (double)offset_to_correct / 1e6);
+    }
+
+    int64_t corrected_us = system_us + correction_us;
+    tv.tv_sec = corrected_us / 1000000LL;
+    tv.tv_usec = corrected_us % 1000000LL;
+    settimeofday(&tv, NULL);
+    pll.total_correction_us += correction_us;
+    pll.correction_count++;
+}
+
 /**
- * @brief Updates the PLL with a new offset measurement
+ * @brief Feeds a burst's min-RTT sample to the offset/skew filter
  *
  * @param sample NTP sample with offset and RTT
  */
@@ -278,164 +426,91 @@ static void pll_update(const ntp_sample_t *sample) {
 
     xSemaphoreTake(pll_mutex, portMAX_DELAY);
 
-    // Check if system time is initialized
-    struct timeval now_tv;
-    gettimeofday(&now_tv, NULL);
-    bool system_time_valid = (now_tv.tv_sec >= 1577836800); // Jan 1, 2020
-    
-    // If system time not valid and we have a large offset, set it first
-    if (!system_time_valid && llabs(sample->theta_us) > 1000000LL) {  // > 1 second
-        int64_t now_mono_us = esp_timer_get_time();
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        int64_t current_unix_us = (int64_t)tv.tv_sec * 1000000LL + (int64_t)tv.tv_usec;
-        int64_t corrected_unix_us = current_unix_us + sample->theta_us;
-        
-        tv.tv_sec = corrected_unix_us / 1000000LL;
-        tv.tv_usec = corrected_unix_us % 1000000LL;
-        settimeofday(&tv, NULL);
-        ESP_LOGI(TAG, "System clock initialized from NTP: %ld.%06ld", tv.tv_sec, tv.tv_usec);
-        
-        // After setting system time, recalculate using the new system time
-        gettimeofday(&now_tv, NULL);
-    }
-
-    int64_t now_mono_us = esp_timer_get_time();
-    int64_t now_unix_us = (int64_t)now_tv.tv_sec * 1000000LL + (int64_t)now_tv.tv_usec;
-    
-    // For PLL, we track the relationship between monotonic time and Unix time
-    // This allows us to maintain precision even if system time jumps
-    
-    if (!pll.valid) {
-        // First sample: initialize PLL
-        // The offset represents: unix_time = mono_time + offset
-        pll.a = 1.0;  // No skew initially
-        pll.b = (double)(now_unix_us - now_mono_us);
-        pll.last_update_mono_us = now_mono_us;
-        pll.last_master_us = now_unix_us;
-        pll.valid = true;
-        pll.sample_count = 1;
-
-        ESP_LOGI(TAG, "PLL initialized: offset=%.1f µs (system-mono delta)", pll.b);
+    double r = kf_window_locked(sample);
+    if (r < 0.0) {
+        kf.rejected++;
+        ESP_LOGD(TAG, "NTP sample skipped: RTT %" PRId64 " µs, floor %" PRId64 " µs",
+                 sample->rtt_us, kf.rtt_floor_us);
+        xSemaphoreGive(pll_mutex);
+        return;
+    }
+
+    if (!kf.valid) {
+        kf_init_locked(sample, r);
+        kf.samples = 1;
+        ESP_LOGI(TAG, "NTP filter initialized: offset=%+" PRId64 " µs, RTT=%" PRId64 " µs",
+                 sample->theta_us, sample->rtt_us);
     } else {
-        // Subsequent samples: update PLL based on new measurement
-        // The sample offset tells us how much to adjust our current time estimate
-        
-        int64_t expected_unix_us = (int64_t)(pll.a * (double)now_mono_us + pll.b);
-        int64_t actual_unix_us = now_unix_us + sample->theta_us;
-        int64_t error_us = actual_unix_us - expected_unix_us;
-        
-        // Apply clock corrections based on the raw NTP offset BEFORE updating PLL state
-        // Use sample->theta_us for corrections, not the PLL error
-        bool correction_applied = false;
-        int64_t correction_us = 0;
-        int64_t offset_to_correct = sample->theta_us;  // Use raw NTP offset for corrections
-        
-        if (llabs(offset_to_correct) > MIN_CORRECTION_US) {
-            if (llabs(offset_to_correct) < SLEW_THRESHOLD_US) {
-                // SLEWING: Apply gradual correction for small offsets
-                // Be more aggressive for persistent offsets
-                correction_us = offset_to_correct;
-                
-                // Increase correction rate if offset persists
-                int64_t max_correction = MAX_SLEW_RATE_US;
-                if (pll.correction_count > 5 && llabs(offset_to_correct) > 2000) {
-                    // Double the correction rate for persistent offsets > 2ms
-                    max_correction = MAX_SLEW_RATE_US * 2;
-                }
-                
-                if (llabs(correction_us) > max_correction) {
-                    correction_us = (error_us > 0) ? max_correction : -max_correction;
-                }
-                
-                // Apply partial correction
-                struct timeval tv;
-                gettimeofday(&tv, NULL);
-                int64_t current_us = (int64_t)tv.tv_sec * 1000000LL + (int64_t)tv.tv_usec;
-                int64_t corrected_us = current_us + correction_us;
-                
-                tv.tv_sec = corrected_us / 1000000LL;
-                tv.tv_usec = corrected_us % 1000000LL;
-                settimeofday(&tv, NULL);
-                
-                pll.total_correction_us += correction_us;
-                pll.correction_count++;
-                correction_applied = true;
-                
-                ESP_LOGD(TAG, "Clock slew: applied %+" PRId64 " µs correction (offset was %+" PRId64 " µs, total corrections: %+" PRId64 " µs)",
-                         correction_us, offset_to_correct, pll.total_correction_us);
-                
-                // Log convergence progress periodically
-                if (pll.correction_count % 10 == 0) {
-                    ESP_LOGI(TAG, "Clock slewing in progress: current offset=%+.3f ms, corrections applied=%d, total correction=%+.3f ms",
-                             (double)offset_to_correct / 1000.0, pll.correction_count, (double)pll.total_correction_us / 1000.0);
-                }
-                
-            } else if (llabs(offset_to_correct) < STEP_THRESHOLD_US) {
-                // STEPPING: Immediate correction for medium offsets
-                struct timeval tv;
-                tv.tv_sec = actual_unix_us / 1000000LL;
-                tv.tv_usec = actual_unix_us % 1000000LL;
-                settimeofday(&tv, NULL);
-                
-                correction_us = error_us;
-                pll.total_correction_us += error_us;
-                pll.correction_count++;
-                correction_applied = true;
-                
-                ESP_LOGI(TAG, "Clock step: corrected %+.3f ms offset (total corrections: %+" PRId64 " µs)",
-                         (double)offset_to_correct / 1000.0, pll.total_correction_us);
-                
-            } else {
-                // Large offset - step with warning
-                ESP_LOGW(TAG, "Large time offset detected: %.3f seconds", (double)offset_to_correct / 1e6);
-                
-                struct timeval tv;
-                tv.tv_sec = actual_unix_us / 1000000LL;
-                tv.tv_usec = actual_unix_us % 1000000LL;
-                settimeofday(&tv, NULL);
-                
-                correction_us = error_us;
-                pll.total_correction_us += error_us;
-                pll.correction_count++;
-                correction_applied = true;
-                
-                ESP_LOGI(TAG, "System clock adjusted from NTP: %ld.%06ld (large step)", tv.tv_sec, tv.tv_usec);
+        // Predict to the sample time: theta += skew * dt
+        double dt_s = (double)(sample->mono_us - kf.t_us) / 1e6;
+        if (dt_s < 0.0) dt_s = 0.0;
+        double p00 = kf.p[0][0], p01 = kf.p[0][1], p11 = kf.p[1][1];
+        double theta = kf.theta_us + kf.skew_ppm * dt_s;
+        p00 += dt_s * (2.0 * p01 + dt_s * p11) + NTP_KF_Q_OFFSET * dt_s +
+               NTP_KF_Q_SKEW * dt_s * dt_s * dt_s / 3.0;
+        p01 += dt_s * p11 + NTP_KF_Q_SKEW * dt_s * dt_s / 2.0;
+        p11 += NTP_KF_Q_SKEW * dt_s;
+
+        double y = (double)sample->theta_us - theta;
+        double s = p00 + r;
+        if (y * y > NTP_KF_GATE_SIGMA * NTP_KF_GATE_SIGMA * s) {
+            kf.rejected++;
+            kf.last_innovation_us = (int64_t)y;
+            if (++kf.consecutive_rejects >= NTP_KF_MAX_REJECTS) {
+                ESP_LOGW(TAG, "NTP filter restart: %d outliers in a row (innovation %+.0f µs)",
+                         kf.consecutive_rejects, y);
+                kf_init_locked(sample, r);
+                kf.resets++;
+                kf.samples = 1;
             }
-            
-            // Don't reduce PLL error - let it track naturally
         } else {
-            // Offset below minimum threshold - log convergence if we were correcting
-            if (pll.correction_count > 0 && llabs(pll.last_error_us) > MIN_CORRECTION_US) {
-                ESP_LOGI(TAG, "Clock converged: offset now within %+" PRId64 " µs (below %lld µs threshold)",
-                         offset_to_correct, MIN_CORRECTION_US);
-            }
+            double k0 = p00 / s;
+            double k1 = p01 / s;
+            kf.theta_us = theta + k0 * y;
+            kf.skew_ppm += k1 * y;
+            if (kf.skew_ppm > NTP_KF_SKEW_LIMIT_PPM) kf.skew_ppm = NTP_KF_SKEW_LIMIT_PPM;
+            if (kf.skew_ppm < -NTP_KF_SKEW_LIMIT_PPM) kf.skew_ppm = -NTP_KF_SKEW_LIMIT_PPM;
+            kf.p[0][0] = (1.0 - k0) * p00;
+            kf.p[0][1] = kf.p[1][0] = (1.0 - k0) * p01;
+            kf.p[1][1] = p11 - k1 * p01;
+            kf.t_us = sample->mono_us;
+            kf.last_innovation_us = (int64_t)y;
+            kf.consecutive_rejects = 0;
+            kf.samples++;
         }
-        
-        // Update offset with exponential smoothing using the original PLL error
-        double alpha_offset = 0.3;
-        pll.b += alpha_offset * (double)error_us;  // Use original PLL error for tracking
-        
-        // Update skew if enough time has passed
-        int64_t dt_mono = now_mono_us - pll.last_update_mono_us;
-        if (dt_mono > 1000000) {  // At least 1 second
-            int64_t dt_master = actual_unix_us - pll.last_master_us;
-            double new_a = (double)dt_master / (double)dt_mono;
-            
-            double alpha_skew = 0.1;
-            pll.a = (1.0 - alpha_skew) * pll.a + alpha_skew * new_a;
-            
-            pll.last_update_mono_us = now_mono_us;
-            pll.last_master_us = actual_unix_us;
+    }
+
+    // Publish: master = mono + theta + skew * (mono - t)
+    pll.a = 1.0 + kf.skew_ppm * 1e-6;
+    pll.b = kf.theta_us - kf.skew_ppm * 1e-6 * (double)kf.t_us;
+    pll.valid = true;
+
+    // Stretch the interval only if the offset would still be within bounds after waiting
+    // twice as long; otherwise hold it while converged and shorten it while not
+    bool converged = kf_converged_locked();
+    uint32_t longer_ms = kf.probe_interval_ms * 2;
+    if (longer_ms > CONFIG_NTP_PROBE_MAX_INTERVAL_MS) {
+        longer_ms = CONFIG_NTP_PROBE_MAX_INTERVAL_MS;
+    }
+    if (converged && kf_predicted_var_locked(longer_ms) < NTP_CONVERGED_SIGMA_US * NTP_CONVERGED_SIGMA_US) {
+        kf.probe_interval_ms = longer_ms;
+    } else if (!converged) {
+        kf.probe_interval_ms /= 2;
+        if (kf.probe_interval_ms < CONFIG_NTP_PROBE_MIN_INTERVAL_MS) {
+            kf.probe_interval_ms = CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
         }
-        
-        pll.sample_count++;
-        pll.last_error_us = error_us;  // Store the adjusted error after correction
-        
-        double skew_ppm = (pll.a - 1.0) * 1e6;
-        ESP_LOGD(TAG, "PLL updated: offset=%.1f µs, skew=%.1f ppm, error=%.1f µs (after correction), samples=%d",
-                 pll.b, skew_ppm, (double)error_us, pll.sample_count);
     }
+    if (converged && !kf.converged) {
+        ESP_LOGI(TAG, "NTP converged: ±%.0f µs, skew %+.2f ppm, RTT floor %" PRId64 " µs",
+                 sqrt(kf.p[0][0]), kf.skew_ppm, kf.rtt_floor_us);
+    }
+    kf.converged = converged;
+
+    pll_discipline_system_clock_locked(esp_timer_get_time());
+
+    ESP_LOGD(TAG, "NTP filter: offset=%.1f µs ±%.1f, skew=%.3f ppm, innovation=%+" PRId64 " µs, next probe %u ms",
+             kf.theta_us, sqrt(kf.p[0][0]), kf.skew_ppm, kf.last_innovation_us,
+             (unsigned)kf.probe_interval_ms);
 
     xSemaphoreGive(pll_mutex);
 }
@@ -539,11 +614,8 @@ static void ntp_client_task(void *pvParameters) {
     TickType_t last_mdns_check = 0;
     TickType_t last_probe_time = 0;
 
-    // Probe rate control (start with fast probes for initial lock)
-    uint32_t probe_interval_ms = 200;  // Start with 200ms (5 Hz)
-    const uint32_t initial_probe_count = 10;  // Number of fast initial probes
-    const uint32_t steady_probe_interval_ms = 1000;  // 1 Hz steady-state
-    uint32_t probe_count = 0;
+    // Probe rate follows the filter's convergence (see pll_update)
+    uint32_t probe_interval_ms = CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
 
     // Main Loop
     while (1) {
@@ -580,15 +652,11 @@ static void ntp_client_task(void *pvParameters) {
 
                             ESP_LOGI(TAG, "NTP server IP updated and cached (mDNS): %s", ntp_server_address);
 
-                            // Reset PLL on server change
+                            // Reset the filter on server change
                             xSemaphoreTake(pll_mutex, portMAX_DELAY);
-                            pll.valid = false;
-                            pll.sample_count = 0;
-                            pll.total_correction_us = 0;
-                            pll.correction_count = 0;
-                            pll.last_error_us = 0;
-                            probe_count = 0;  // Restart fast probing
+                            pll_reset_locked();
                             xSemaphoreGive(pll_mutex);
+                            probe_interval_ms = CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
                         } else {
                             ip_found = true;
                         }
@@ -632,15 +700,11 @@ static void ntp_client_task(void *pvParameters) {
                                 ESP_LOGI(TAG, "NTP server IP updated and cached (DNS): %s (%s:%u)",
                                          ntp_server_address, s_custom_host, (unsigned)s_custom_port);
 
-                                // Reset PLL on server change
+                                // Reset the filter on server change
                                 xSemaphoreTake(pll_mutex, portMAX_DELAY);
-                                pll.valid = false;
-                                pll.sample_count = 0;
-                                pll.total_correction_us = 0;
-                                pll.correction_count = 0;
-                                pll.last_error_us = 0;
-                                probe_count = 0;  // Restart fast probing
+                                pll_reset_locked();
                                 xSemaphoreGive(pll_mutex);
+                                probe_interval_ms = CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
                             } else {
                                 ip_found = true;
                             }
@@ -702,13 +766,12 @@ static void ntp_client_task(void *pvParameters) {
                 uint16_t probe_port = s_use_mdns ? 123 : s_custom_port;
                 if (ntp_micro_probe_burst(ntp_server_address, probe_port, &sample)) {
                     pll_update(&sample);
-                    probe_count++;
-
-                    // After initial fast probing, slow down to steady-state rate
-                    if (probe_count >= initial_probe_count && probe_interval_ms < steady_probe_interval_ms) {
-                        probe_interval_ms = steady_probe_interval_ms;
-                        ESP_LOGI(TAG, "Switching to steady-state probe rate (%u ms)", probe_interval_ms);
-                    }
+                    xSemaphoreTake(pll_mutex, portMAX_DELAY);
+                    probe_interval_ms = kf.probe_interval_ms;
+                    xSemaphoreGive(pll_mutex);
+                } else {
+                    // Lost the server: look again soon
+                    probe_interval_ms = CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
                 }
 
                 last_probe_time = now;
@@ -792,27 +855,38 @@ extern "C" bool ntp_get_pll_state(double *offset_us, double *skew_ppm) {
 }
 
 /**
- * @brief Get current PLL convergence status
+ * @brief Get the offset/skew filter's convergence status
  *
- * @param corrections_applied Output: total number of corrections applied (can be NULL)
- * @param total_correction_us Output: total correction amount in microseconds (can be NULL)
- * @param current_error_us Output: current error in microseconds (can be NULL)
- * @return true if PLL is valid and converged (error < MIN_CORRECTION_US), false otherwise
+ * @param status Output: filter and system clock metrics (can be NULL)
+ * @return true if the filter is valid and converged, false otherwise
  */
-extern "C" bool ntp_get_convergence_status(int *corrections_applied, int64_t *total_correction_us, int64_t *current_error_us) {
-    if (!pll_mutex) return false;
-    
+extern "C" bool ntp_get_convergence_status(ntp_convergence_status_t *status) {
+    if (!pll_mutex) {
+        if (status) memset(status, 0, sizeof(*status));
+        return false;
+    }
+
     xSemaphoreTake(pll_mutex, portMAX_DELAY);
-    
-    bool converged = false;
-    if (pll.valid) {
-        if (corrections_applied) *corrections_applied = pll.correction_count;
-        if (total_correction_us) *total_correction_us = pll.total_correction_us;
-        if (current_error_us) *current_error_us = pll.last_error_us;
-        
-        converged = (llabs(pll.last_error_us) < MIN_CORRECTION_US);
+
+    bool converged = kf_converged_locked();
+    if (status) {
+        status->valid = kf.valid;
+        status->converged = converged;
+        status->offset_sigma_us = kf.valid ? sqrt(kf.p[0][0]) : 0.0;
+        status->skew_ppm = kf.skew_ppm;
+        status->skew_sigma_ppm = kf.valid ? sqrt(kf.p[1][1]) : 0.0;
+        status->last_innovation_us = kf.last_innovation_us;
+        status->rtt_floor_us = kf.window_count ? kf.rtt_floor_us : 0;
+        status->last_rtt_us = kf.last_rtt_us;
+        status->probe_interval_ms = kf.probe_interval_ms ? kf.probe_interval_ms : CONFIG_NTP_PROBE_MIN_INTERVAL_MS;
+        status->samples = kf.samples;
+        status->rejected = kf.rejected;
+        status->resets = kf.resets;
+        status->corrections_applied = pll.correction_count;
+        status->total_correction_us = pll.total_correction_us;
+        status->current_error_us = pll.last_error_us;
     }
-    
+
     xSemaphoreGive(pll_mutex);
     return converged;
 }
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * IEEE 1588-2008 (PTPv2) slave-only ordinary clock over UDP/IPv4
+ *
+ * Listens on the event (319) and general (320) ports of 224.0.1.129, picks a
+ * grandmaster from the Announce messages with the standard dataset
+ * comparison, and measures offset with Sync/Follow_Up (one- or two-step) and
+ * the end-to-end Delay_Req/Delay_Resp mechanism. There is no hardware time
+ * stamping on the ESP32's Wi-Fi, so receive timestamps are esp_timer reads in
+ * the lwIP udp_recv callback, the first code that sees the packet after the
+ * driver, and the Delay_Req timestamp is taken in the lwIP thread right
+ * before the send.
+ *
+ * A PI servo steers a line from esp_timer to the grandmaster's timescale
+ * (TAI for a PTP timescale master). Offset samples are filtered by keeping
+ * the least delayed Sync of each window, since queueing only ever delays a
+ * packet; the path delay is the minimum of recent Delay_Resp exchanges.
+ */
+
+#define PTP_EVENT_PORT      319
+#define PTP_GENERAL_PORT    320
+#define PTP_PRIMARY_GROUP   "224.0.1.129"
+#define PTP_DEFAULT_UTC_OFFSET_S  37
+
+typedef struct {
+    bool locked;                    // servo error under CONFIG_PTP_LOCK_THRESHOLD_US
+    bool have_master;               // a grandmaster is selected and announcing
+    uint8_t domain;
+    uint8_t gm_identity[8];         // selected grandmaster clockIdentity
+    uint8_t gm_clock_class;
+    uint8_t gm_priority1;
+    bool ptp_timescale;             // grandmaster runs TAI (otherwise ARB)
+    int16_t utc_offset_s;           // TAI - UTC in use
+    int64_t offset_ns;              // last servo error (filtered)
+    int64_t path_delay_ns;          // mean path delay in use
+    int32_t skew_ppb;               // grandmaster advances (1 + skew) per local ns
+    uint32_t syncs;                 // Sync (plus Follow_Up) pairs used
+    uint32_t delay_resps;           // Delay_Resp matched to our requests
+    uint32_t announces;
+    uint32_t master_changes;
+    uint32_t steps;                 // servo steps (offset beyond the step threshold)
+    uint32_t timeouts;              // announce or sync timeouts
+    uint32_t rx_overflows;          // packets dropped with the queue full
+} ptp_slave_stats_t;
+
+/*
+ * start the slave: open the sockets, join the PTP group and start the task
+ *   safe to call before the network is up; the group is joined again when
+ *   nothing has been heard for an announce timeout
+ *   returns ESP_OK on success, or error code on failure
+ */
+esp_err_t ptp_slave_start(void);
+
+/*
+ * stop the task and close the sockets
+ */
+void ptp_slave_stop(void);
+
+/*
+ * follow another domain (e.g. the one an SDP's a=ts-refclk names);
+ * drops the current master and resets the servo if it changes
+ */
+void ptp_slave_set_domain(uint8_t domain);
+
+/*
+ * whether the servo is locked to a grandmaster
+ */
+bool ptp_slave_is_locked(void);
+
+/*
+ * grandmaster time at a local monotonic (esp_timer) time
+ *   mono_us: esp_timer time
+ *   ptp_ns: grandmaster timescale in ns since 1970 (TAI for a PTP timescale)
+ *   skew_ppb: optional, the line's skew
+ *   returns false unless locked
+ */
+bool ptp_slave_mono_to_ptp(int64_t mono_us, int64_t *ptp_ns, int32_t *skew_ppb);
+
+/*
+ * UTC microseconds at a local monotonic time (the PTP time less the UTC offset)
+ *   returns false unless locked
+ */
+bool ptp_slave_mono_to_utc(int64_t mono_us, int64_t *utc_us, int32_t *skew_ppb);
+
+/*
+ * TAI - UTC in seconds, as announced (0 for an ARB timescale master); lock free
+ */
+int16_t ptp_slave_utc_offset(void);
+
+void ptp_slave_get_stats(ptp_slave_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
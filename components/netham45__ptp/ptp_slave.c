@@ -0,0 +1,774 @@
+#include "ptp_slave.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/igmp.h"
+#include "lwip/ip_addr.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"  // tcpip_api_call
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static const char *TAG = "ptp_slave";
+
+#ifndef CONFIG_PTP_DOMAIN
+#define CONFIG_PTP_DOMAIN 0
+#endif
+#ifndef CONFIG_PTP_LOCK_THRESHOLD_US
+#define CONFIG_PTP_LOCK_THRESHOLD_US 200
+#endif
+#ifndef CONFIG_PTP_TASK_PRIORITY
+#define CONFIG_PTP_TASK_PRIORITY 6
+#endif
+#ifndef CONFIG_PTP_TASK_CORE
+#define CONFIG_PTP_TASK_CORE 0
+#endif
+
+#define PTP_TASK_STACK          4096
+#define PTP_QUEUE_PACKETS       16
+#define PTP_MAX_MESSAGE         64      // Longest body read (Announce); TLVs past it are ignored
+#define PTP_EVENT_DSCP          46      // EF, as AES67 recommends for PTP event messages
+
+// messageType (low nibble of byte 0)
+#define PTP_MSG_SYNC            0x0
+#define PTP_MSG_DELAY_REQ       0x1
+#define PTP_MSG_FOLLOW_UP       0x8
+#define PTP_MSG_DELAY_RESP      0x9
+#define PTP_MSG_ANNOUNCE        0xB
+
+#define PTP_HEADER_LEN          34
+#define PTP_SYNC_LEN            44      // Sync, Delay_Req and Follow_Up
+#define PTP_DELAY_RESP_LEN      54
+#define PTP_ANNOUNCE_LEN        64
+#define PTP_PORT_ID_LEN         10
+
+// flagField, read as a big-endian u16
+#define PTP_FLAG_TWO_STEP       0x0200
+#define PTP_FLAG_UTC_VALID      0x0004
+#define PTP_FLAG_PTP_TIMESCALE  0x0008
+
+// Servo: one PI update per window, on the least delayed Sync in it
+// Gains are well below the usual 0.7/0.3 of a wired slave: Wi-Fi spreads Sync
+// arrivals over milliseconds, and even the least delayed one of a window wanders
+#define PTP_SERVO_WINDOW        16      // Syncs (two seconds at the AES67 default of 8/s)
+#define PTP_SERVO_WINDOW_MS     2000    // Or this long, for slower masters
+#define PTP_SERVO_KP            0.2
+#define PTP_SERVO_KI            0.02
+#define PTP_STEP_NS             2000000LL
+#define PTP_SKEW_LIMIT_PPB      500000.0
+#define PTP_LOCK_UPDATES        3
+#define PTP_UNLOCK_FACTOR       4       // Error beyond this many lock thresholds drops the lock
+#define PTP_DELAY_WINDOW        8       // Path delay: minimum of this many exchanges
+
+#define PTP_ANNOUNCE_RECEIPT_TIMEOUT  3     // Announce intervals
+#define PTP_SYNC_TIMEOUT_MS     3000
+#define PTP_REJOIN_MS           10000   // Re-send the IGMP join after this long with no master
+#define PTP_DEFAULT_DELAY_REQ_MS 1000
+
+#define PTP_ARG_EVENT           ((void *)0)
+#define PTP_ARG_GENERAL         ((void *)1)
+
+typedef struct {
+    uint8_t data[PTP_MAX_MESSAGE];
+    uint16_t len;
+    int64_t rx_us;                  // esp_timer at the lwIP callback
+} ptp_packet_t;
+
+typedef struct {
+    struct tcpip_api_call_data call;  // Must be first
+    const uint8_t *data;
+    uint16_t len;
+    int64_t tx_us;                  // Out: esp_timer taken right before the send
+} ptp_send_t;
+
+// Ordered so memcmp() over it is the IEEE 1588 dataset comparison (smaller is better)
+typedef struct {
+    uint8_t key[16];                // priority1, class, accuracy, variance(2), priority2, gm identity(8), stepsRemoved(2)
+    uint8_t port_id[PTP_PORT_ID_LEN];
+} ptp_dataset_t;
+
+typedef struct {
+    // Selected master
+    bool have_master;
+    ptp_dataset_t master;
+    int64_t announce_us;
+    int64_t announce_timeout_us;
+    int16_t utc_offset_s;
+    bool ptp_timescale;
+
+    // Two-step Sync waiting for its Follow_Up
+    bool sync_pending;
+    uint16_t sync_seq;
+    int64_t sync_rx_ns;
+    int64_t sync_corr_ns;
+    int64_t last_sync_us;
+
+    // t2 - t1 of the last complete Sync
+    bool have_ms;
+    int64_t ms_ns;
+
+    // Delay_Req / Delay_Resp
+    bool delay_pending;
+    uint16_t delay_seq;
+    int64_t delay_tx_ns;
+    int64_t delay_sent_us;
+    int64_t delay_interval_us;
+    int64_t delay_win[PTP_DELAY_WINDOW];
+    int delay_count;
+    int delay_next;
+    bool have_delay;
+    int64_t path_delay_ns;
+    bool have_down;
+    int64_t min_down_ns;            // Least delayed Sync of the last servo window: predicted(t2) - t1
+
+    // Servo: ptp(mono) = anchor_ptp + d + d * skew, d = mono - anchor_mono (ns)
+    bool servo_valid;
+    bool servo_stepped;
+    int64_t anchor_mono_ns;
+    int64_t anchor_ptp_ns;
+    double skew_ppb;
+    int64_t win_max_ns;
+    int64_t win_min_down_ns;
+    int win_n;
+    int64_t win_start_us;
+    int64_t last_error_ns;
+    int good_updates;
+    bool locked;
+
+    int64_t last_rx_us;
+    int64_t joined_us;
+    ptp_slave_stats_t stats;
+} ptp_state_t;
+
+static ptp_state_t s_ptp;
+static SemaphoreHandle_t s_lock = NULL;
+static QueueHandle_t s_queue = NULL;
+static TaskHandle_t s_task = NULL;
+static struct udp_pcb *s_event_pcb = NULL;
+static struct udp_pcb *s_general_pcb = NULL;
+static ip4_addr_t s_group;
+static bool s_joined = false;
+static uint8_t s_port_id[PTP_PORT_ID_LEN];   // clockIdentity (EUI-64 from the MAC) + port 1
+static uint8_t s_domain = CONFIG_PTP_DOMAIN;
+static atomic_bool s_stop_requested = false;
+static atomic_int s_utc_offset_s = PTP_DEFAULT_UTC_OFFSET_S;   // Mirror of the state's, read without the lock
+static atomic_uint_fast32_t s_rx_overflows = 0;
+
+// ---------------------------------------------------------------------------
+// Wire helpers
+// ---------------------------------------------------------------------------
+
+static inline uint16_t rd16(const uint8_t *b) {
+    return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+static inline int64_t rd_correction_ns(const uint8_t *b) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | b[i];
+    }
+    return (int64_t)v >> 16;   // Scaled nanoseconds
+}
+
+// 48-bit seconds + 32-bit nanoseconds
+static inline int64_t rd_timestamp_ns(const uint8_t *b) {
+    uint64_t sec = 0;
+    for (int i = 0; i < 6; i++) {
+        sec = (sec << 8) | b[i];
+    }
+    uint32_t ns = ((uint32_t)b[6] << 24) | ((uint32_t)b[7] << 16) | ((uint32_t)b[8] << 8) | b[9];
+    return (int64_t)sec * 1000000000LL + ns;
+}
+
+static inline int64_t clamp_log_interval_us(int8_t log_interval, int8_t lo, int8_t hi) {
+    if (log_interval < lo) log_interval = lo;
+    if (log_interval > hi) log_interval = hi;
+    return log_interval >= 0 ? 1000000LL << log_interval : 1000000LL >> -log_interval;
+}
+
+// ---------------------------------------------------------------------------
+// lwIP (tcpip thread)
+// ---------------------------------------------------------------------------
+
+static void ptp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    // Timestamp first: this is as close to the driver as software gets
+    int64_t rx_us = esp_timer_get_time();
+    (void)arg;
+    (void)pcb;
+    (void)addr;
+    (void)port;
+    ptp_packet_t pkt;
+    pkt.rx_us = rx_us;
+    pkt.len = pbuf_copy_partial(p, pkt.data, sizeof(pkt.data), 0);
+    pbuf_free(p);
+    if (xQueueSend(s_queue, &pkt, 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&s_rx_overflows, 1, memory_order_relaxed);
+    }
+}
+
+static err_t bind_pcb(struct udp_pcb **pcb, uint16_t port, void *arg) {
+    *pcb = udp_new();
+    if (!*pcb) {
+        return ERR_MEM;
+    }
+    ip_set_option(*pcb, SOF_REUSEADDR);
+    (*pcb)->tos = PTP_EVENT_DSCP << 2;
+    udp_set_multicast_ttl(*pcb, 1);
+    err_t err = udp_bind(*pcb, IP_ADDR_ANY, port);
+    if (err != ERR_OK) {
+        udp_remove(*pcb);
+        *pcb = NULL;
+        return err;
+    }
+    udp_recv(*pcb, ptp_recv_cb, arg);
+    return ERR_OK;
+}
+
+static void remove_pcb(struct udp_pcb **pcb) {
+    if (*pcb) {
+        udp_remove(*pcb);
+        *pcb = NULL;
+    }
+}
+
+static err_t leave_fn(struct tcpip_api_call_data *call) {
+    (void)call;
+    if (s_joined) {
+        igmp_leavegroup(IP4_ADDR_ANY4, &s_group);
+        s_joined = false;
+    }
+    return ERR_OK;
+}
+
+// (Re)join: a join made before the station had an address never reached the network
+static err_t join_fn(struct tcpip_api_call_data *call) {
+    leave_fn(call);
+    err_t err = igmp_joingroup(IP4_ADDR_ANY4, &s_group);
+    s_joined = (err == ERR_OK);
+    return err;
+}
+
+static err_t open_fn(struct tcpip_api_call_data *call) {
+    err_t err = bind_pcb(&s_event_pcb, PTP_EVENT_PORT, PTP_ARG_EVENT);
+    if (err == ERR_OK) {
+        err = bind_pcb(&s_general_pcb, PTP_GENERAL_PORT, PTP_ARG_GENERAL);
+        if (err != ERR_OK) {
+            remove_pcb(&s_event_pcb);
+            return err;
+        }
+    }
+    if (err == ERR_OK) {
+        join_fn(call);   // May fail until the network is up; retried from the task
+    }
+    return err;
+}
+
+static err_t close_fn(struct tcpip_api_call_data *call) {
+    leave_fn(call);
+    remove_pcb(&s_event_pcb);
+    remove_pcb(&s_general_pcb);
+    return ERR_OK;
+}
+
+static err_t send_event_fn(struct tcpip_api_call_data *call) {
+    ptp_send_t *msg = (ptp_send_t *)call;
+    if (!s_event_pcb) {
+        return ERR_CONN;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, msg->len, PBUF_RAM);
+    if (!p) {
+        return ERR_MEM;
+    }
+    memcpy(p->payload, msg->data, msg->len);
+    ip_addr_t dst;
+    ip_addr_copy_from_ip4(dst, s_group);
+    msg->tx_us = esp_timer_get_time();
+    err_t err = udp_sendto(s_event_pcb, p, &dst, PTP_EVENT_PORT);
+    pbuf_free(p);
+    return err;
+}
+
+// ---------------------------------------------------------------------------
+// Servo (PTP task, s_lock held)
+// ---------------------------------------------------------------------------
+
+static inline int64_t servo_predict(const ptp_state_t *st, int64_t mono_ns) {
+    int64_t d = mono_ns - st->anchor_mono_ns;
+    return st->anchor_ptp_ns + d + (int64_t)((double)d * st->skew_ppb * 1e-9);
+}
+
+static void servo_reset(ptp_state_t *st) {
+    if (st->locked) {
+        ESP_LOGW(TAG, "Unlocked");
+    }
+    st->servo_valid = false;
+    st->servo_stepped = false;
+    st->skew_ppb = 0.0;
+    st->win_n = 0;
+    st->good_updates = 0;
+    st->locked = false;
+    st->sync_pending = false;
+    st->have_ms = false;
+    st->delay_pending = false;
+    st->have_delay = false;
+    st->delay_count = 0;
+    st->delay_next = 0;
+    st->path_delay_ns = 0;
+    st->have_down = false;
+    st->delay_interval_us = PTP_DEFAULT_DELAY_REQ_MS * 1000LL;
+}
+
+// One Sync: the master sent it at t1_ns and it arrived at local mono_ns
+static void servo_sample(ptp_state_t *st, int64_t mono_ns, int64_t t1_ns, int64_t now_us) {
+    int64_t ptp_ns = t1_ns + st->path_delay_ns;
+    if (!st->servo_valid) {
+        st->anchor_mono_ns = mono_ns;
+        st->anchor_ptp_ns = ptp_ns;
+        st->servo_valid = true;
+        st->win_n = 0;
+        st->win_start_us = now_us;
+        return;
+    }
+    // Queueing only delays a Sync, so the largest residual in the window is the least delayed one
+    int64_t pred = servo_predict(st, mono_ns);
+    int64_t r = ptp_ns - pred;
+    int64_t down = pred - t1_ns;
+    if (st->win_n == 0 || r > st->win_max_ns) {
+        st->win_max_ns = r;
+    }
+    if (st->win_n == 0 || down < st->win_min_down_ns) {
+        st->win_min_down_ns = down;
+    }
+    st->win_n++;
+    if (st->win_n < PTP_SERVO_WINDOW && now_us - st->win_start_us < PTP_SERVO_WINDOW_MS * 1000LL) {
+        return;
+    }
+
+    int64_t e = st->win_max_ns;
+    double dt_s = (double)(mono_ns - st->anchor_mono_ns) * 1e-9;
+    st->win_n = 0;
+    st->win_start_us = now_us;
+    st->last_error_ns = e;
+    st->min_down_ns = st->win_min_down_ns;
+    st->have_down = true;
+
+    if (!st->servo_stepped || e > PTP_STEP_NS || e < -PTP_STEP_NS) {
+        if (st->servo_stepped) {
+            ESP_LOGW(TAG, "Offset %lld us, stepping", (long long)(e / 1000));
+            if (st->locked) {
+                ESP_LOGW(TAG, "Unlocked");
+            }
+            st->locked = false;
+        }
+        st->anchor_ptp_ns = pred + e;
+        st->anchor_mono_ns = mono_ns;
+        st->servo_stepped = true;
+        st->good_updates = 0;
+        st->stats.steps++;
+        // One-way delays measured against the old line no longer pair up
+        st->have_down = false;
+        st->delay_count = 0;
+        st->delay_next = 0;
+        return;
+    }
+
+    if (dt_s > 0.0) {
+        st->skew_ppb += PTP_SERVO_KI * (double)e / dt_s;
+        if (st->skew_ppb > PTP_SKEW_LIMIT_PPB) st->skew_ppb = PTP_SKEW_LIMIT_PPB;
+        if (st->skew_ppb < -PTP_SKEW_LIMIT_PPB) st->skew_ppb = -PTP_SKEW_LIMIT_PPB;
+    }
+    st->anchor_ptp_ns = pred + (int64_t)(PTP_SERVO_KP * (double)e);
+    st->anchor_mono_ns = mono_ns;
+
+    int64_t abs_e = e < 0 ? -e : e;
+    const int64_t threshold_ns = (int64_t)CONFIG_PTP_LOCK_THRESHOLD_US * 1000LL;
+    if (abs_e < threshold_ns && st->have_delay) {
+        if (st->good_updates < PTP_LOCK_UPDATES) {
+            st->good_updates++;
+        }
+        if (!st->locked && st->good_updates >= PTP_LOCK_UPDATES) {
+            st->locked = true;
+            ESP_LOGI(TAG, "Locked: offset %lld ns, path delay %lld us, skew %ld ppb",
+                     (long long)e, (long long)(st->path_delay_ns / 1000), (long)st->skew_ppb);
+        }
+    } else if (abs_e > threshold_ns * PTP_UNLOCK_FACTOR) {
+        st->good_updates = 0;
+        if (st->locked) {
+            st->locked = false;
+            ESP_LOGW(TAG, "Unlocked: offset %lld us", (long long)(e / 1000));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Protocol (PTP task, s_lock held)
+// ---------------------------------------------------------------------------
+
+static void send_delay_req(ptp_state_t *st, int64_t now_us) {
+    uint8_t msg[PTP_SYNC_LEN];
+    memset(msg, 0, sizeof(msg));
+    uint16_t seq = (uint16_t)(st->delay_seq + 1U);
+    msg[0] = PTP_MSG_DELAY_REQ;
+    msg[1] = 2;                        // versionPTP
+    msg[2] = 0;
+    msg[3] = PTP_SYNC_LEN;
+    msg[4] = s_domain;
+    memcpy(&msg[20], s_port_id, PTP_PORT_ID_LEN);
+    msg[30] = (uint8_t)(seq >> 8);
+    msg[31] = (uint8_t)seq;
+    msg[32] = 1;                       // controlField: Delay_Req
+    msg[33] = 0x7F;
+    // originTimestamp left zero: t3 is our own timestamp, not what we send
+
+    ptp_send_t call = { .data = msg, .len = sizeof(msg) };
+    if (tcpip_api_call(send_event_fn, &call.call) != ERR_OK) {
+        return;
+    }
+    st->delay_seq = seq;
+    st->delay_tx_ns = call.tx_us * 1000LL;
+    st->delay_sent_us = now_us;
+    st->delay_pending = true;
+}
+
+static void sync_complete(ptp_state_t *st, int64_t t1_ns, int64_t t2_ns, int64_t now_us) {
+    st->ms_ns = t2_ns - t1_ns;
+    st->have_ms = true;
+    st->last_sync_us = now_us;
+    st->stats.syncs++;
+    if (st->have_delay) {
+        servo_sample(st, t2_ns, t1_ns, now_us);
+    }
+    // A lost request or response is abandoned after two intervals
+    bool due = now_us - st->delay_sent_us >= st->delay_interval_us;
+    if (due && (!st->delay_pending || now_us - st->delay_sent_us >= 2 * st->delay_interval_us)) {
+        send_delay_req(st, now_us);
+    }
+}
+
+static void handle_announce(ptp_state_t *st, const uint8_t *m, uint16_t len, int64_t now_us) {
+    if (len < PTP_ANNOUNCE_LEN) {
+        return;
+    }
+    uint16_t steps_removed = rd16(&m[61]);
+    if (steps_removed >= 255) {
+        return;
+    }
+    ptp_dataset_t ds;
+    ds.key[0] = m[47];                 // grandmasterPriority1
+    ds.key[1] = m[48];                 // clockClass
+    ds.key[2] = m[49];                 // clockAccuracy
+    ds.key[3] = m[50];                 // offsetScaledLogVariance
+    ds.key[4] = m[51];
+    ds.key[5] = m[52];                 // grandmasterPriority2
+    memcpy(&ds.key[6], &m[53], 8);     // grandmasterIdentity
+    ds.key[14] = m[61];
+    ds.key[15] = m[62];
+    memcpy(ds.port_id, &m[20], PTP_PORT_ID_LEN);
+    st->stats.announces++;
+
+    bool same = st->have_master && memcmp(ds.port_id, st->master.port_id, PTP_PORT_ID_LEN) == 0;
+    if (!same) {
+        if (st->have_master && memcmp(ds.key, st->master.key, sizeof(ds.key)) >= 0) {
+            return;   // Not better than the master we follow
+        }
+        const uint8_t *gm = &ds.key[6];
+        ESP_LOGI(TAG, "Grandmaster %02x%02x%02x.%02x%02x.%02x%02x%02x (priority1 %u, class %u, domain %u)",
+                 gm[0], gm[1], gm[2], gm[3], gm[4], gm[5], gm[6], gm[7], ds.key[0], ds.key[1], s_domain);
+        if (st->have_master) {
+            st->stats.master_changes++;
+        }
+        servo_reset(st);
+        st->have_master = true;
+    }
+    st->master = ds;
+    st->announce_us = now_us;
+    st->announce_timeout_us = PTP_ANNOUNCE_RECEIPT_TIMEOUT * clamp_log_interval_us((int8_t)m[33], -3, 4);
+
+    uint16_t flags = rd16(&m[6]);
+    st->ptp_timescale = (flags & PTP_FLAG_PTP_TIMESCALE) != 0;
+    if (!st->ptp_timescale) {
+        st->utc_offset_s = 0;
+    } else if (flags & PTP_FLAG_UTC_VALID) {
+        st->utc_offset_s = (int16_t)rd16(&m[44]);
+    } else {
+        st->utc_offset_s = PTP_DEFAULT_UTC_OFFSET_S;
+    }
+    atomic_store_explicit(&s_utc_offset_s, st->utc_offset_s, memory_order_relaxed);
+}
+
+static bool from_master(const ptp_state_t *st, const uint8_t *m) {
+    return st->have_master && memcmp(&m[20], st->master.port_id, PTP_PORT_ID_LEN) == 0;
+}
+
+static void handle_message(ptp_state_t *st, const ptp_packet_t *pkt) {
+    const uint8_t *m = pkt->data;
+    if (pkt->len < PTP_HEADER_LEN || (m[1] & 0x0F) != 2 || m[4] != s_domain) {
+        return;
+    }
+    uint16_t msg_len = rd16(&m[2]);
+    uint16_t len = msg_len < pkt->len ? msg_len : pkt->len;
+    uint8_t type = m[0] & 0x0F;
+    uint16_t seq = rd16(&m[30]);
+    int64_t now_us = esp_timer_get_time();
+    st->last_rx_us = now_us;
+
+    switch (type) {
+    case PTP_MSG_ANNOUNCE:
+        handle_announce(st, m, len, now_us);
+        break;
+    case PTP_MSG_SYNC:
+        if (len < PTP_SYNC_LEN || !from_master(st, m)) {
+            break;
+        }
+        if (rd16(&m[6]) & PTP_FLAG_TWO_STEP) {
+            st->sync_pending = true;
+            st->sync_seq = seq;
+            st->sync_rx_ns = pkt->rx_us * 1000LL;
+            st->sync_corr_ns = rd_correction_ns(&m[8]);
+        } else {
+            st->sync_pending = false;
+            sync_complete(st, rd_timestamp_ns(&m[34]) + rd_correction_ns(&m[8]), pkt->rx_us * 1000LL, now_us);
+        }
+        break;
+    case PTP_MSG_FOLLOW_UP:
+        if (len < PTP_SYNC_LEN || !from_master(st, m) || !st->sync_pending || seq != st->sync_seq) {
+            break;
+        }
+        st->sync_pending = false;
+        sync_complete(st, rd_timestamp_ns(&m[34]) + st->sync_corr_ns + rd_correction_ns(&m[8]),
+                      st->sync_rx_ns, now_us);
+        break;
+    case PTP_MSG_DELAY_RESP: {
+        if (len < PTP_DELAY_RESP_LEN || !from_master(st, m) || !st->delay_pending || seq != st->delay_seq ||
+            memcmp(&m[44], s_port_id, PTP_PORT_ID_LEN) != 0) {
+            break;
+        }
+        st->delay_pending = false;
+        st->delay_interval_us = clamp_log_interval_us((int8_t)m[33], -4, 6);
+        if (!st->have_ms) {
+            break;
+        }
+        int64_t t4_ns = rd_timestamp_ns(&m[34]) - rd_correction_ns(&m[8]);
+        int64_t d;
+        if (!st->have_down) {
+            // Bootstrap from this exchange and the last Sync until the servo runs
+            d = (st->ms_ns + (t4_ns - st->delay_tx_ns)) / 2;
+        } else {
+            // Each leg against the servo's line, least delayed of recent samples; the
+            // line's own offset error cancels in the sum
+            st->delay_win[st->delay_next] = t4_ns - servo_predict(st, st->delay_tx_ns);
+            st->delay_next = (st->delay_next + 1) % PTP_DELAY_WINDOW;
+            if (st->delay_count < PTP_DELAY_WINDOW) {
+                st->delay_count++;
+            }
+            int64_t min_up = st->delay_win[0];
+            for (int i = 1; i < st->delay_count; i++) {
+                if (st->delay_win[i] < min_up) {
+                    min_up = st->delay_win[i];
+                }
+            }
+            d = (st->min_down_ns + min_up) / 2;
+        }
+        if (d < 0) {
+            d = 0;   // Asymmetry larger than the path; treat as back to back
+        }
+        st->path_delay_ns = d;
+        st->have_delay = true;
+        st->stats.delay_resps++;
+        break;
+    }
+    default:
+        break;   // Signaling, management, peer delay: not used by an E2E slave
+    }
+}
+
+static void check_timeouts(ptp_state_t *st, int64_t now_us) {
+    if (st->have_master && now_us - st->announce_us > st->announce_timeout_us) {
+        ESP_LOGW(TAG, "Announce timeout, dropping grandmaster");
+        servo_reset(st);
+        st->have_master = false;
+        st->stats.timeouts++;
+    } else if (st->servo_valid && now_us - st->last_sync_us > PTP_SYNC_TIMEOUT_MS * 1000LL) {
+        ESP_LOGW(TAG, "Sync timeout");
+        servo_reset(st);
+        st->stats.timeouts++;
+    }
+}
+
+static void ptp_task(void *arg) {
+    (void)arg;
+    ptp_packet_t pkt;
+    while (!atomic_load(&s_stop_requested)) {
+        bool got = xQueueReceive(s_queue, &pkt, pdMS_TO_TICKS(100)) == pdTRUE;
+        int64_t now_us = esp_timer_get_time();
+        bool rejoin = false;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        if (got) {
+            handle_message(&s_ptp, &pkt);
+        }
+        check_timeouts(&s_ptp, now_us);
+        if (!s_ptp.have_master && now_us - s_ptp.joined_us > PTP_REJOIN_MS * 1000LL) {
+            s_ptp.joined_us = now_us;
+            rejoin = true;
+        }
+        xSemaphoreGive(s_lock);
+        if (rejoin) {
+            struct tcpip_api_call_data call;
+            tcpip_api_call(join_fn, &call);
+        }
+    }
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+// ---------------------------------------------------------------------------
+// API
+// ---------------------------------------------------------------------------
+
+esp_err_t ptp_slave_start(void) {
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        s_queue = xQueueCreate(PTP_QUEUE_PACKETS, sizeof(ptp_packet_t));
+        if (!s_lock || !s_queue) {
+            ESP_LOGE(TAG, "Failed to allocate PTP queue");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    const uint8_t id[PTP_PORT_ID_LEN] = { mac[0], mac[1], mac[2], 0xFF, 0xFE, mac[3], mac[4], mac[5], 0, 1 };
+    memcpy(s_port_id, id, sizeof(id));
+    ip4addr_aton(PTP_PRIMARY_GROUP, &s_group);
+
+    memset(&s_ptp, 0, sizeof(s_ptp));
+    servo_reset(&s_ptp);
+    s_ptp.utc_offset_s = PTP_DEFAULT_UTC_OFFSET_S;
+    s_ptp.joined_us = esp_timer_get_time();
+
+    struct tcpip_api_call_data call;
+    err_t err = tcpip_api_call(open_fn, &call);
+    if (err != ERR_OK) {
+        ESP_LOGE(TAG, "Unable to bind PTP ports: err %d", err);
+        return err == ERR_MEM ? ESP_ERR_NO_MEM : ESP_FAIL;
+    }
+
+    atomic_store(&s_stop_requested, false);
+    if (xTaskCreatePinnedToCore(ptp_task, "ptp", PTP_TASK_STACK, NULL, CONFIG_PTP_TASK_PRIORITY,
+                                &s_task, CONFIG_PTP_TASK_CORE) != pdPASS) {
+        tcpip_api_call(close_fn, &call);
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "PTPv2 slave on domain %u, clock %02x%02x%02x.fffe.%02x%02x%02x",
+             s_domain, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return ESP_OK;
+}
+
+void ptp_slave_stop(void) {
+    if (!s_task) {
+        return;
+    }
+    atomic_store(&s_stop_requested, true);
+    for (int i = 0; i < 50 && s_task; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    struct tcpip_api_call_data call;
+    tcpip_api_call(close_fn, &call);
+    ptp_packet_t pkt;
+    while (xQueueReceive(s_queue, &pkt, 0) == pdTRUE) {
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    servo_reset(&s_ptp);
+    s_ptp.have_master = false;
+    xSemaphoreGive(s_lock);
+}
+
+void ptp_slave_set_domain(uint8_t domain) {
+    if (!s_lock) {
+        s_domain = domain;
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (domain != s_domain) {
+        ESP_LOGI(TAG, "Domain %u -> %u", s_domain, domain);
+        s_domain = domain;
+        servo_reset(&s_ptp);
+        s_ptp.have_master = false;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+bool ptp_slave_is_locked(void) {
+    if (!s_lock) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool locked = s_ptp.locked;
+    xSemaphoreGive(s_lock);
+    return locked;
+}
+
+bool ptp_slave_mono_to_ptp(int64_t mono_us, int64_t *ptp_ns, int32_t *skew_ppb) {
+    if (!s_lock || !ptp_ns) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool locked = s_ptp.locked;
+    if (locked) {
+        *ptp_ns = servo_predict(&s_ptp, mono_us * 1000LL);
+        if (skew_ppb) {
+            *skew_ppb = (int32_t)s_ptp.skew_ppb;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return locked;
+}
+
+bool ptp_slave_mono_to_utc(int64_t mono_us, int64_t *utc_us, int32_t *skew_ppb) {
+    int64_t ptp_ns;
+    if (!utc_us || !ptp_slave_mono_to_ptp(mono_us, &ptp_ns, skew_ppb)) {
+        return false;
+    }
+    *utc_us = ptp_ns / 1000LL - (int64_t)ptp_slave_utc_offset() * 1000000LL;
+    return true;
+}
+
+int16_t ptp_slave_utc_offset(void) {
+    return (int16_t)atomic_load_explicit(&s_utc_offset_s, memory_order_relaxed);
+}
+
+void ptp_slave_get_stats(ptp_slave_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_ptp.stats;
+    stats->locked = s_ptp.locked;
+    stats->have_master = s_ptp.have_master;
+    stats->domain = s_domain;
+    memcpy(stats->gm_identity, &s_ptp.master.key[6], sizeof(stats->gm_identity));
+    stats->gm_priority1 = s_ptp.master.key[0];
+    stats->gm_clock_class = s_ptp.master.key[1];
+    stats->ptp_timescale = s_ptp.ptp_timescale;
+    stats->utc_offset_s = s_ptp.utc_offset_s;
+    stats->offset_ns = s_ptp.last_error_ns;
+    stats->path_delay_ns = s_ptp.path_delay_ns;
+    stats->skew_ppb = (int32_t)s_ptp.skew_ppb;
+    xSemaphoreGive(s_lock);
+    stats->rx_overflows = (uint32_t)atomic_load_explicit(&s_rx_overflows, memory_order_relaxed);
+}
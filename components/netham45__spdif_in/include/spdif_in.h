@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "pcm_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * S/PDIF (IEC 60958) receiver feeding the sender's capture ring
+ *
+ * The input pin is oversampled by an I2S RX channel at a fixed 40 MHz into
+ * DMA buffers, so capture never stops between reads. A decoder task turns
+ * the bitstream into run lengths, quantises them to biphase half-cells with a
+ * rounding residual carried from run to run, syncs on the B/M/W preambles and
+ * writes 16-bit stereo frames into the same kind of lock-free ring as usb_in.
+ * The line rate is measured from the spacing of the block (B) preambles.
+ *
+ * The ring is always 48 kHz, the rate the sender announces: a 48 kHz input
+ * is passed through, 96 kHz is decimated by two, and any other detected rate
+ * (32, 44.1, 88.2 kHz) is reported but not written. Streams whose channel
+ * status flags non-audio data (AC-3, DTS) are written as silence.
+ */
+
+#define SPDIF_IN_OUTPUT_RATE    48000
+#define SPDIF_IN_FRAME_BYTES    4       // 16-bit stereo
+
+/*
+ * called from the decoder task when the detected input rate changes
+ *   sample_rate: new line rate in Hz, or 0 when the signal is lost
+ */
+typedef void (*spdif_in_rate_cb_t)(uint32_t sample_rate);
+
+typedef struct {
+    uint32_t sample_rate;       // detected line rate, 0 while unlocked
+    bool locked;                // frames are being decoded
+    bool non_audio;             // channel status flags compressed data; written as silence
+    uint32_t frames;            // frames decoded at the line rate
+    uint32_t parity_errors;     // subframes concealed by repeating the previous sample
+    uint32_t coding_errors;     // biphase or preamble violations that lost sync
+    uint32_t relocks;           // times the half-cell estimate was rebuilt from scratch
+    uint16_t cpu_permille;      // decoder share of its core over the last second
+} spdif_in_stats_t;
+
+/*
+ * initialize S/PDIF receiver
+ *   gpio_num: input pin (optical or coaxial receiver output, logic level)
+ *   rate_cb: optional rate change callback, may be NULL
+ *   the capture ring is created once and kept across deinit, so a sender
+ *   holding it survives a pin change
+ *   returns ESP_OK on success, or error code on failure
+ */
+esp_err_t spdif_receiver_init(int gpio_num, spdif_in_rate_cb_t rate_cb);
+
+/*
+ * start capture and the decoder task
+ *   returns ESP_OK on success, or error code on failure
+ */
+esp_err_t spdif_receiver_start(void);
+
+/*
+ * stop the decoder task and capture but keep the driver installed
+ *   returns ESP_OK on success, or error code on failure
+ */
+esp_err_t spdif_receiver_stop(void);
+
+/*
+ * release the I2S channel (stops first if running)
+ *   returns ESP_OK on success, or error code on failure
+ */
+esp_err_t spdif_receiver_deinit(void);
+
+/*
+ * capture ring read by the sender (16-bit stereo at SPDIF_IN_OUTPUT_RATE),
+ * or NULL before the first spdif_receiver_init()
+ */
+pcm_ring_t *spdif_in_get_capture_ring(void);
+
+/*
+ * detected line rate in Hz, 0 while unlocked
+ */
+uint32_t spdif_in_get_sample_rate(void);
+
+/*
+ * read receiver counters (cumulative since spdif_receiver_start)
+ */
+void spdif_in_get_stats(spdif_in_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,677 @@
+#include <stdbool.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/i2s_std.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "spdif_in.h"
+
+#define TAG "spdif_in"
+
+#ifndef CONFIG_SPDIF_IN_PCM_RING_FRAMES
+#define CONFIG_SPDIF_IN_PCM_RING_FRAMES 2048
+#endif
+#ifndef CONFIG_SPDIF_IN_DMA_DESC_NUM
+#define CONFIG_SPDIF_IN_DMA_DESC_NUM 6
+#endif
+#ifndef CONFIG_SPDIF_IN_DMA_FRAME_NUM
+#define CONFIG_SPDIF_IN_DMA_FRAME_NUM 480
+#endif
+#ifndef CONFIG_SPDIF_IN_DECODER_TASK_STACK
+#define CONFIG_SPDIF_IN_DECODER_TASK_STACK 4096
+#endif
+#ifndef CONFIG_SPDIF_IN_DECODER_TASK_PRIORITY
+#define CONFIG_SPDIF_IN_DECODER_TASK_PRIORITY 10
+#endif
+#ifndef CONFIG_SPDIF_IN_DECODER_TASK_CORE
+#define CONFIG_SPDIF_IN_DECODER_TASK_CORE 1
+#endif
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#endif
+
+// The line is sampled as the data bits of a 32-bit stereo I2S RX stream: 64 samples a frame
+#define CAPTURE_HZ              40000000u
+#define CAPTURE_FRAME_HZ        (CAPTURE_HZ / 64)
+#define CAPTURE_WORDS           (CONFIG_SPDIF_IN_DMA_FRAME_NUM * 2)
+
+#define HALF_CELLS_PER_FRAME    128     // 2 subframes x 32 time slots x 2
+#define BLOCK_FRAMES            192     // channel status block, starts at a B preamble
+#define BLOCK_HALF_CELLS        (BLOCK_FRAMES * HALF_CELLS_PER_FRAME)
+// A frame is at least 128 half-cells of RUN_MIN_3T / 3 samples; 2 samples each bounds it
+#define OUT_MAX_FRAMES          (CAPTURE_WORDS * 32 / (HALF_CELLS_PER_FRAME * 2) + 2)
+
+#define RUN_MAX                 40      // samples; longer than 3T at 32 kHz means no signal
+#define RUN_MIN_3T              8       // shortest preamble run told apart from 2T (~115 kHz)
+#define HUNT_RUNS               2048    // runs measured per half-cell estimate
+#define BAD_SUBFRAMES_MAX       64      // consecutive losses before the estimate is rebuilt
+#define SIGNAL_LOSS_MS          50
+
+// Preambles as their four run lengths in half-cells, two bits each
+#define PRE_B                   ((3 << 6) | (1 << 4) | (1 << 2) | 3)
+#define PRE_M                   ((3 << 6) | (3 << 4) | (1 << 2) | 1)
+#define PRE_W                   ((3 << 6) | (2 << 4) | (1 << 2) | 2)
+
+enum {
+    DEC_HUNT,           // waiting for a 3T run
+    DEC_PREAMBLE,       // inside a preamble
+    DEC_DATA,           // time slots 4-31
+    DEC_GAP,            // subframe complete, the next run must open a preamble
+};
+
+typedef struct {
+    // Run quantiser: capture samples -> biphase half-cells (1T)
+    uint32_t t_q8;              // 1T in capture samples, Q8; 0 while hunting
+    uint32_t recip;             // 2^24 / t_q8
+    int32_t resid;              // rounding error carried into the next run, Q8
+    uint32_t run;               // samples in the run being measured
+    uint32_t last;              // previous line sample
+    uint32_t hunt_runs;
+    uint32_t hunt_max;          // longest run seen while hunting: a preamble's 3T
+    uint32_t hunt_sum;          // then the runs within 3/4 of it, averaged
+    uint32_t hunt_count;
+    bool hunt_refine;
+    // BMC framing
+    uint8_t state;
+    uint8_t pre_len;            // half-cells of the preamble so far
+    uint8_t pre_code;           // its runs, two bits each
+    uint8_t kind;               // preamble of the subframe being received
+    uint8_t nbits;              // time slots received from slot 4
+    bool half;                  // first half of a '1' cell seen
+    uint32_t sub;               // slots 4-31, slot 4 in bit 0
+    uint16_t bad;               // consecutive coding errors
+    // Frame assembly
+    int16_t left;
+    bool have_left;
+    int16_t last_l, last_r;     // for concealing parity errors
+    uint16_t frame;             // frames since the last B preamble
+    uint32_t cs;                // channel status bits 0-31 of the block
+    bool non_audio;
+    // Rate measurement
+    uint32_t pos;               // capture samples consumed (wraps)
+    uint32_t block_pos;         // pos at the last B preamble
+    bool block_seen;
+    bool block_clean;           // no errors since block_pos
+    uint32_t rate;              // line rate, 0 until a clean block was measured
+    bool rate_changed;
+    bool output;                // rate the ring can take
+    // 96 -> 48 kHz: [1 2 1] / 4 low-pass on every other frame
+    bool decimate;
+    bool odd;
+    int32_t mid_l, mid_r, prev_l, prev_r;
+    // Output of the current dec_process() call
+    int16_t *out;
+    size_t out_n;
+    // Counters
+    uint32_t frames;
+    uint32_t parity_errors;
+    uint32_t coding_errors;
+    uint32_t relocks;
+} spdif_dec_t;
+
+static struct {
+    bool initialized;
+    volatile bool running;
+    i2s_chan_handle_t rx;
+    TaskHandle_t task;
+    spdif_in_rate_cb_t rate_cb;
+    int gpio_num;
+    uint16_t cpu_permille;
+} s_state;
+
+// Kept across deinit: the sender holds it for as long as it runs
+static pcm_ring_t *s_ring;
+static spdif_dec_t s_dec;
+static uint32_t s_capture[CAPTURE_WORDS];
+static int16_t s_out[OUT_MAX_FRAMES * 2];
+
+static const uint32_t s_rates[] = { 32000, 44100, 48000, 88200, 96000, 176400, 192000 };
+
+static void dec_set_t(spdif_dec_t *d, uint32_t t_q8)
+{
+    d->t_q8 = t_q8;
+    d->recip = (1u << 24) / t_q8;
+}
+
+// Forget the half-cell estimate and the rate; the next runs rebuild them
+static void dec_lose(spdif_dec_t *d)
+{
+    if (d->rate) {
+        d->rate_changed = true;
+    }
+    d->t_q8 = 0;
+    d->resid = 0;
+    d->hunt_runs = 0;
+    d->hunt_max = 0;
+    d->hunt_sum = 0;
+    d->hunt_count = 0;
+    d->hunt_refine = false;
+    d->state = DEC_HUNT;
+    d->bad = 0;
+    d->have_left = false;
+    d->block_seen = false;
+    d->rate = 0;
+    d->output = false;
+    d->non_audio = false;
+}
+
+static void IRAM_ATTR dec_error(spdif_dec_t *d)
+{
+    d->coding_errors++;
+    d->state = DEC_HUNT;
+    d->half = false;
+    d->have_left = false;
+    d->block_clean = false;
+    if (++d->bad >= BAD_SUBFRAMES_MAX) {
+        dec_lose(d);
+    }
+}
+
+// A clean block of n capture samples: exact 1T for the quantiser and the line rate
+static void dec_measure(spdif_dec_t *d, uint32_t n)
+{
+    dec_set_t(d, (uint32_t)(((uint64_t)n << 8) / BLOCK_HALF_CELLS));
+
+    uint32_t measured = (uint32_t)((uint64_t)CAPTURE_HZ * BLOCK_FRAMES / n);
+    uint32_t rate = 0;
+    for (size_t i = 0; i < sizeof(s_rates) / sizeof(s_rates[0]); i++) {
+        uint32_t tol = s_rates[i] / 100;
+        if (measured + tol >= s_rates[i] && measured <= s_rates[i] + tol) {
+            rate = s_rates[i];
+            break;
+        }
+    }
+    if (rate != d->rate) {
+        d->rate = rate;
+        d->rate_changed = true;
+        d->output = rate == SPDIF_IN_OUTPUT_RATE || rate == 2 * SPDIF_IN_OUTPUT_RATE;
+        d->decimate = rate == 2 * SPDIF_IN_OUTPUT_RATE;
+        d->odd = false;
+    }
+}
+
+static void IRAM_ATTR dec_block_start(spdif_dec_t *d)
+{
+    if (d->block_seen && d->block_clean && d->frame == BLOCK_FRAMES) {
+        // Channel status byte 0 bit 1: not linear PCM
+        d->non_audio = (d->cs & 0x2) != 0;
+        dec_measure(d, d->pos - d->block_pos);
+    }
+    d->block_seen = true;
+    d->block_clean = true;
+    d->block_pos = d->pos;
+    d->frame = 0;
+    d->cs = 0;
+}
+
+static inline void IRAM_ATTR dec_emit(spdif_dec_t *d, int32_t l, int32_t r)
+{
+    d->frames++;
+    if (!d->output) {
+        return;
+    }
+    if (d->non_audio) {
+        l = 0;
+        r = 0;
+    }
+    if (d->decimate) {
+        if (!d->odd) {
+            d->mid_l = l;
+            d->mid_r = r;
+            d->odd = true;
+            return;
+        }
+        d->odd = false;
+        int32_t out_l = (d->prev_l + 2 * d->mid_l + l) >> 2;
+        int32_t out_r = (d->prev_r + 2 * d->mid_r + r) >> 2;
+        d->prev_l = l;
+        d->prev_r = r;
+        l = out_l;
+        r = out_r;
+    }
+    if (d->out_n < OUT_MAX_FRAMES) {
+        d->out[2 * d->out_n] = (int16_t)l;
+        d->out[2 * d->out_n + 1] = (int16_t)r;
+        d->out_n++;
+    }
+}
+
+static inline void IRAM_ATTR dec_subframe(spdif_dec_t *d)
+{
+    uint32_t sub = d->sub;
+    bool right = d->kind == PRE_W;
+    int16_t s;
+    d->bad = 0;
+    // Even parity over slots 4-31; a bad sample repeats the channel's previous one
+    if (__builtin_parity(sub)) {
+        d->parity_errors++;
+        s = right ? d->last_r : d->last_l;
+    } else {
+        s = (int16_t)(sub >> 8);    // top 16 of the 24 audio bits
+    }
+    if (!right) {
+        if (d->frame < 32) {
+            d->cs |= ((sub >> 26) & 1u) << d->frame;
+        }
+        d->left = s;
+        d->last_l = s;
+        d->have_left = true;
+    } else if (d->have_left) {
+        d->last_r = s;
+        d->have_left = false;
+        d->frame++;
+        dec_emit(d, d->left, s);
+    }
+}
+
+static inline void IRAM_ATTR dec_preamble_start(spdif_dec_t *d)
+{
+    d->state = DEC_PREAMBLE;
+    d->pre_len = 3;
+    d->pre_code = 3;
+}
+
+static inline void IRAM_ATTR dec_preamble_done(spdif_dec_t *d, uint8_t code)
+{
+    if (code != PRE_W && d->have_left) {
+        d->have_left = false;       // left without its right
+        d->block_clean = false;
+    }
+    if (code == PRE_B) {
+        dec_block_start(d);
+    }
+    d->kind = code;
+    d->state = DEC_DATA;
+    d->nbits = 0;
+    d->sub = 0;
+    d->half = false;
+}
+
+// One run of n half-cells through the biphase mark decoder
+static inline void IRAM_ATTR dec_bmc(spdif_dec_t *d, uint32_t n)
+{
+    switch (d->state) {
+    case DEC_HUNT:
+        if (n == 3) {
+            dec_preamble_start(d);
+        }
+        break;
+    case DEC_GAP:
+        if (n == 3) {
+            dec_preamble_start(d);
+        } else {
+            dec_error(d);
+        }
+        break;
+    case DEC_PREAMBLE:
+        d->pre_len += n;
+        d->pre_code = (uint8_t)((d->pre_code << 2) | n);
+        if (d->pre_len < 8) {
+            break;
+        }
+        if (d->pre_len == 8 && (d->pre_code == PRE_B || d->pre_code == PRE_M || d->pre_code == PRE_W)) {
+            dec_preamble_done(d, d->pre_code);
+        } else {
+            dec_error(d);
+            if (n == 3) {
+                dec_preamble_start(d);
+            }
+        }
+        break;
+    case DEC_DATA: {
+        uint32_t bit;
+        if (n == 3) {
+            dec_error(d);           // a preamble where a bit belonged: resync on it
+            dec_preamble_start(d);
+            break;
+        }
+        if (n == 2) {
+            if (d->half) {
+                dec_error(d);
+                break;
+            }
+            bit = 0;
+        } else {
+            if (!d->half) {
+                d->half = true;
+                break;
+            }
+            d->half = false;
+            bit = 1;
+        }
+        d->sub |= bit << d->nbits;
+        if (++d->nbits == 28) {
+            dec_subframe(d);
+            d->state = DEC_GAP;
+        }
+        break;
+    }
+    }
+}
+
+// Quantise a run of capture samples to half-cells
+static inline void IRAM_ATTR dec_run(spdif_dec_t *d, uint32_t samples)
+{
+    if (samples > RUN_MAX) {
+        if (d->state != DEC_HUNT) {
+            dec_error(d);
+        }
+        d->resid = 0;
+        return;
+    }
+    if (d->t_q8 == 0) {
+        // No estimate yet. The longest runs are the preambles' 3T, but the very longest
+        // carries the most jitter: find it, then average the runs that are near it
+        if (d->hunt_refine) {
+            if (samples * 4 >= d->hunt_max * 3) {
+                d->hunt_sum += samples;
+                d->hunt_count++;
+            }
+        } else if (samples > d->hunt_max) {
+            d->hunt_max = samples;
+        }
+        if (++d->hunt_runs < HUNT_RUNS) {
+            return;
+        }
+        d->hunt_runs = 0;
+        if (!d->hunt_refine && d->hunt_max >= RUN_MIN_3T) {
+            d->hunt_refine = true;
+            return;
+        }
+        if (d->hunt_refine && d->hunt_count) {
+            dec_set_t(d, (d->hunt_sum << 8) / (3 * d->hunt_count));
+            d->relocks++;
+        }
+        d->hunt_refine = false;
+        d->hunt_max = 0;
+        d->hunt_sum = 0;
+        d->hunt_count = 0;
+        return;
+    }
+    int32_t acc = (int32_t)(samples << 8) + d->resid;
+    uint32_t n = acc > 0 ? ((uint32_t)acc * d->recip + (1u << 23)) >> 24 : 0;
+    if (n == 0) {
+        d->resid = acc;             // glitch: fold it into the next run
+        return;
+    }
+    // Carry most of the rounding error: sampling jitter averages out, a clock offset decays
+    int32_t err = acc - (int32_t)(n * d->t_q8);
+    d->resid = err - err / 4;
+    if (n > 3) {
+        dec_error(d);
+        return;
+    }
+    dec_bmc(d, n);
+}
+
+/*
+ * Decode count captured words into out; returns frames written (at the ring rate).
+ * Each word holds 32 line samples, first in the MSB. XOR with the word shifted by one
+ * sample marks where the level changes, and CLZ (NSAU on the S3) steps from one change
+ * to the next, so the cost is per transition rather than per sample.
+ */
+static size_t IRAM_ATTR dec_process(spdif_dec_t *d, const uint32_t *words, size_t count, int16_t *out)
+{
+    uint32_t last = d->last;
+    uint32_t run = d->run;
+    d->out = out;
+    d->out_n = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t w = words[i];
+        uint32_t t = w ^ ((w >> 1) | (last << 31));
+        uint32_t left = 32;
+        last = w & 1u;
+        while (t) {
+            uint32_t z = (uint32_t)__builtin_clz(t);
+            dec_run(d, run + z);
+            run = 1;                // the changed sample opens the next run
+            t = (t << z) << 1;
+            left -= z + 1;
+        }
+        run += left;
+        if (run > RUN_MAX + 1) {
+            run = RUN_MAX + 1;
+        }
+        d->pos += 32;
+    }
+    d->last = last;
+    d->run = run;
+    return d->out_n;
+}
+
+static void spdif_in_report_rate(uint32_t rate)
+{
+    if (rate == 0) {
+        ESP_LOGW(TAG, "S/PDIF input lost");
+    } else if (rate == SPDIF_IN_OUTPUT_RATE || rate == 2 * SPDIF_IN_OUTPUT_RATE) {
+        ESP_LOGI(TAG, "S/PDIF input locked at %lu Hz", (unsigned long)rate);
+    } else {
+        ESP_LOGW(TAG, "S/PDIF input at %lu Hz is not sent; the source must output 48 or 96 kHz",
+                 (unsigned long)rate);
+    }
+    if (s_state.rate_cb) {
+        s_state.rate_cb(rate);
+    }
+}
+
+static void spdif_in_task(void *arg)
+{
+    ESP_LOGI(TAG, "Decoder task started on core %d", xPortGetCoreID());
+
+    TickType_t window_start = xTaskGetTickCount();
+    TickType_t last_frame_tick = window_start;
+    uint32_t window_cycles = 0;
+    uint32_t last_frames = 0;
+
+    while (s_state.running) {
+        size_t got = 0;
+        esp_err_t err = i2s_channel_read(s_state.rx, s_capture, sizeof(s_capture), &got,
+                                         pdMS_TO_TICKS(SIGNAL_LOSS_MS));
+        TickType_t now = xTaskGetTickCount();
+        if (err == ESP_OK && got > 0) {
+            uint32_t start = esp_cpu_get_cycle_count();
+            size_t frames = dec_process(&s_dec, s_capture, got / sizeof(uint32_t), s_out);
+            if (frames) {
+                // Never blocks; what does not fit is counted by the ring
+                pcm_ring_write(s_ring, s_out, frames * SPDIF_IN_FRAME_BYTES);
+            }
+            window_cycles += esp_cpu_get_cycle_count() - start;
+        }
+
+        if (s_dec.frames != last_frames) {
+            last_frames = s_dec.frames;
+            last_frame_tick = now;
+        } else if ((s_dec.rate || s_dec.t_q8) && now - last_frame_tick >= pdMS_TO_TICKS(SIGNAL_LOSS_MS)) {
+            dec_lose(&s_dec);
+        }
+        if (s_dec.rate_changed) {
+            s_dec.rate_changed = false;
+            spdif_in_report_rate(s_dec.rate);
+        }
+
+        TickType_t elapsed = now - window_start;
+        if (elapsed >= pdMS_TO_TICKS(1000)) {
+            uint32_t elapsed_ms = elapsed * portTICK_PERIOD_MS;
+            s_state.cpu_permille = (uint16_t)(window_cycles / ((uint32_t)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * elapsed_ms));
+            window_cycles = 0;
+            window_start = now;
+        }
+    }
+
+    ESP_LOGI(TAG, "Decoder task exiting");
+    s_state.task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t spdif_receiver_init(int gpio_num, spdif_in_rate_cb_t rate_cb)
+{
+    if (s_state.initialized) {
+        ESP_LOGW(TAG, "S/PDIF receiver already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!s_ring) {
+        s_ring = pcm_ring_create(CONFIG_SPDIF_IN_PCM_RING_FRAMES, SPDIF_IN_FRAME_BYTES);
+        if (!s_ring) {
+            ESP_LOGE(TAG, "Failed to allocate %d frame capture ring", CONFIG_SPDIF_IN_PCM_RING_FRAMES);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t err;
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_AUTO, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = CONFIG_SPDIF_IN_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = CONFIG_SPDIF_IN_DMA_FRAME_NUM;
+
+    err = i2s_new_channel(&chan_cfg, NULL, &s_state.rx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // 625 kHz x 64 bits = 40 MHz BCLK from the 160 MHz PLL; only DIN is routed
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = {
+            .sample_rate_hz = CAPTURE_FRAME_HZ,
+            .clk_src = I2S_CLK_SRC_PLL_160M,
+            .mclk_multiple = I2S_MCLK_MULTIPLE_128,
+        },
+        .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = I2S_GPIO_UNUSED,
+            .ws = I2S_GPIO_UNUSED,
+            .dout = I2S_GPIO_UNUSED,
+            .din = gpio_num,
+        },
+    };
+
+    err = i2s_channel_init_std_mode(s_state.rx, &std_cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure I2S channel (din=%d): %s", gpio_num, esp_err_to_name(err));
+        i2s_del_channel(s_state.rx);
+        s_state.rx = NULL;
+        return err;
+    }
+
+    s_state.rate_cb = rate_cb;
+    s_state.gpio_num = gpio_num;
+    s_state.initialized = true;
+    ESP_LOGI(TAG, "S/PDIF receiver initialized on GPIO %d (%lu MHz oversampling)", gpio_num,
+             (unsigned long)(CAPTURE_HZ / 1000000));
+    return ESP_OK;
+}
+
+esp_err_t spdif_receiver_start(void)
+{
+    if (!s_state.initialized) {
+        ESP_LOGE(TAG, "Cannot start S/PDIF receiver: not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_state.running) {
+        return ESP_OK;
+    }
+
+    memset(&s_dec, 0, sizeof(s_dec));
+    s_state.cpu_permille = 0;
+
+    esp_err_t err = i2s_channel_enable(s_state.rx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    s_state.running = true;
+    if (xTaskCreatePinnedToCore(spdif_in_task, "spdif_in", CONFIG_SPDIF_IN_DECODER_TASK_STACK, NULL,
+                                CONFIG_SPDIF_IN_DECODER_TASK_PRIORITY, &s_state.task,
+                                CONFIG_SPDIF_IN_DECODER_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create S/PDIF decoder task");
+        s_state.running = false;
+        i2s_channel_disable(s_state.rx);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t spdif_receiver_stop(void)
+{
+    if (!s_state.initialized) {
+        ESP_LOGE(TAG, "Cannot stop S/PDIF receiver: not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_state.running) {
+        return ESP_OK;
+    }
+
+    s_state.running = false;
+    // The task sees the flag after its current read, at most SIGNAL_LOSS_MS
+    for (int i = 0; i < 20 && s_state.task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (s_state.task != NULL) {
+        ESP_LOGE(TAG, "S/PDIF decoder task did not exit");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t err = i2s_channel_disable(s_state.rx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to disable I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    pcm_ring_stats_t ring_stats;
+    pcm_ring_get_stats(s_ring, &ring_stats);
+    ESP_LOGI(TAG, "S/PDIF receiver stopped: %lu frames, %lu parity / %lu coding errors, %lu dropped",
+             (unsigned long)s_dec.frames, (unsigned long)s_dec.parity_errors,
+             (unsigned long)s_dec.coding_errors, (unsigned long)ring_stats.dropped_frames);
+    return ESP_OK;
+}
+
+esp_err_t spdif_receiver_deinit(void)
+{
+    if (!s_state.initialized) {
+        return ESP_OK;
+    }
+    esp_err_t err = spdif_receiver_stop();
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = i2s_del_channel(s_state.rx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_state.rx = NULL;
+    s_state.initialized = false;
+    ESP_LOGI(TAG, "S/PDIF receiver deinitialized");
+    return ESP_OK;
+}
+
+pcm_ring_t *spdif_in_get_capture_ring(void)
+{
+    return s_ring;
+}
+
+uint32_t spdif_in_get_sample_rate(void)
+{
+    return s_dec.rate;
+}
+
+void spdif_in_get_stats(spdif_in_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->sample_rate = s_dec.rate;
+    stats->locked = s_dec.rate != 0;
+    stats->non_audio = s_dec.non_audio;
+    stats->frames = s_dec.frames;
+    stats->parity_errors = s_dec.parity_errors;
+    stats->coding_errors = s_dec.coding_errors;
+    stats->relocks = s_dec.relocks;
+    stats->cpu_permille = s_state.cpu_permille;
+}
@@ -2,12 +2,14 @@
 
 */
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/types.h>
 #include "esp_err.h"
 
 /*
  * initialize S/PDIF driver
- *   rate: sampling rate, 44100Hz, 48000Hz etc.
+ *   rate: sampling rate, 44100Hz, 48000Hz etc. up to 192000Hz; channel status
+ *         carries the rate code for 32k/44.1k/48k/88.2k/96k/176.4k/192k
  *   returns ESP_OK on success, or error code on failure
  */
 esp_err_t spdif_init(int rate, int pin);
@@ -34,9 +36,69 @@ esp_err_t spdif_deinit(void);
  * send PCM data to S/PDIF transmitter
  *   src: pointer to 16bit PCM stereo data
  *   size: number of data bytes
+ *   the data is queued for the encoder task; waits up to
+ *   CONFIG_SPDIF_WRITE_TIMEOUT_MS for room, then drops it
  */
 void spdif_write(const void *src, size_t size);
 
+/*
+ * send 24-bit PCM data to S/PDIF transmitter
+ *   src: pointer to packed 24bit PCM stereo data (3 bytes per sample, little endian)
+ *   size: number of data bytes
+ *   channel status switches to a 24-bit word length once the queued 16-bit
+ *   data has played
+ */
+void spdif_write_s24(const void *src, size_t size);
+
+/*
+ * send PCM data without waiting longer than the caller allows
+ *   s24: packed 24-bit data when true, 16-bit otherwise
+ *   wait_ms: longest wait for ring space; 0 drops whatever does not fit now
+ *   returns ESP_OK, ESP_ERR_TIMEOUT if the data was dropped for lack of
+ *   room, or ESP_ERR_INVALID_STATE while the transmitter is stopped
+ */
+esp_err_t spdif_write_timeout(const void *src, size_t size, bool s24, uint32_t wait_ms);
+
+typedef struct {
+    uint32_t underruns;         // times the PCM ring ran dry and a block was padded with silence
+    uint32_t dma_overflows;     // times the DMA queue emptied and a cleared block went out
+    uint32_t dropped_bytes;     // PCM bytes spdif_write() gave up on after its timeout
+    int32_t clock_offset_ppb;   // last offset applied by spdif_set_clock_offset_ppb()
+} spdif_stats_t;
+
+/*
+ * read transmitter counters (cumulative since spdif_init)
+ */
+void spdif_get_stats(spdif_stats_t *stats);
+
+/*
+ * playout delay between spdif_write() and the wire once the PCM ring is kept
+ * full, in microseconds at the current rate and sample width; 0 before init
+ */
+uint32_t spdif_get_latency_us(void);
+
+/*
+ * set how much the transmitter buffers, for low-latency playout
+ *   ring_ms: PCM ring length; 0 for CONFIG_SPDIF_PCM_BUFFER_MS. The ring
+ *            never shrinks below two half blocks
+ *   dma_desc_num: half-block DMA descriptors, 2-16; 0 for
+ *                 CONFIG_SPDIF_DMA_DESC_NUM
+ *   applies from the next spdif_init() and is kept across
+ *   spdif_set_sample_rates() and spdif_deinit()
+ *   returns ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_INVALID_STATE while
+ *   initialized
+ */
+esp_err_t spdif_set_depth(uint32_t ring_ms, int dma_desc_num);
+
+/*
+ * pull the output clock off nominal, for tracking a remote sender's clock
+ *   ppb: offset in parts per billion, positive runs faster; clamped to +-1000 ppm
+ *   returns ESP_OK, ESP_ERR_NOT_SUPPORTED on targets without an audio PLL
+ *   (ESP32-S3), or ESP_ERR_INVALID_STATE if the APLL is shared
+ *   the offset is dropped by spdif_set_sample_rates() and spdif_deinit()
+ */
+esp_err_t spdif_set_clock_offset_ppb(int32_t ppb);
+
 /*
  * change sampling rate
  *   rate: sampling rate, 44100Hz, 48000Hz etc.
@@ -0,0 +1,198 @@
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "spdif_bmc.h"
+#ifdef CONFIG_SPDIF_ENCODER_BENCHMARK
+#include "esp_cpu.h"
+#include "metrics_bench.h"
+#endif
+
+#define TAG "spdif_bmc"
+
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#endif
+
+/*
+ * 8bit PCM to 16bit BMC conversion table, LSb first, 1 end
+ * (in DRAM: the encoder must not stall on flash cache misses)
+ */
+static DRAM_ATTR const int16_t bmc_tab[256] = {
+    0x3333, 0xb333, 0xd333, 0x5333, 0xcb33, 0x4b33, 0x2b33, 0xab33,
+    0xcd33, 0x4d33, 0x2d33, 0xad33, 0x3533, 0xb533, 0xd533, 0x5533,
+    0xccb3, 0x4cb3, 0x2cb3, 0xacb3, 0x34b3, 0xb4b3, 0xd4b3, 0x54b3,
+    0x32b3, 0xb2b3, 0xd2b3, 0x52b3, 0xcab3, 0x4ab3, 0x2ab3, 0xaab3,
+    0xccd3, 0x4cd3, 0x2cd3, 0xacd3, 0x34d3, 0xb4d3, 0xd4d3, 0x54d3,
+    0x32d3, 0xb2d3, 0xd2d3, 0x52d3, 0xcad3, 0x4ad3, 0x2ad3, 0xaad3,
+    0x3353, 0xb353, 0xd353, 0x5353, 0xcb53, 0x4b53, 0x2b53, 0xab53,
+    0xcd53, 0x4d53, 0x2d53, 0xad53, 0x3553, 0xb553, 0xd553, 0x5553,
+    0xcccb, 0x4ccb, 0x2ccb, 0xaccb, 0x34cb, 0xb4cb, 0xd4cb, 0x54cb,
+    0x32cb, 0xb2cb, 0xd2cb, 0x52cb, 0xcacb, 0x4acb, 0x2acb, 0xaacb,
+    0x334b, 0xb34b, 0xd34b, 0x534b, 0xcb4b, 0x4b4b, 0x2b4b, 0xab4b,
+    0xcd4b, 0x4d4b, 0x2d4b, 0xad4b, 0x354b, 0xb54b, 0xd54b, 0x554b,
+    0x332b, 0xb32b, 0xd32b, 0x532b, 0xcb2b, 0x4b2b, 0x2b2b, 0xab2b,
+    0xcd2b, 0x4d2b, 0x2d2b, 0xad2b, 0x352b, 0xb52b, 0xd52b, 0x552b,
+    0xccab, 0x4cab, 0x2cab, 0xacab, 0x34ab, 0xb4ab, 0xd4ab, 0x54ab,
+    0x32ab, 0xb2ab, 0xd2ab, 0x52ab, 0xcaab, 0x4aab, 0x2aab, 0xaaab,
+    0xcccd, 0x4ccd, 0x2ccd, 0xaccd, 0x34cd, 0xb4cd, 0xd4cd, 0x54cd,
+    0x32cd, 0xb2cd, 0xd2cd, 0x52cd, 0xcacd, 0x4acd, 0x2acd, 0xaacd,
+    0x334d, 0xb34d, 0xd34d, 0x534d, 0xcb4d, 0x4b4d, 0x2b4d, 0xab4d,
+    0xcd4d, 0x4d4d, 0x2d4d, 0xad4d, 0x354d, 0xb54d, 0xd54d, 0x554d,
+    0x332d, 0xb32d, 0xd32d, 0x532d, 0xcb2d, 0x4b2d, 0x2b2d, 0xab2d,
+    0xcd2d, 0x4d2d, 0x2d2d, 0xad2d, 0x352d, 0xb52d, 0xd52d, 0x552d,
+    0xccad, 0x4cad, 0x2cad, 0xacad, 0x34ad, 0xb4ad, 0xd4ad, 0x54ad,
+    0x32ad, 0xb2ad, 0xd2ad, 0x52ad, 0xcaad, 0x4aad, 0x2aad, 0xaaad,
+    0x3335, 0xb335, 0xd335, 0x5335, 0xcb35, 0x4b35, 0x2b35, 0xab35,
+    0xcd35, 0x4d35, 0x2d35, 0xad35, 0x3535, 0xb535, 0xd535, 0x5535,
+    0xccb5, 0x4cb5, 0x2cb5, 0xacb5, 0x34b5, 0xb4b5, 0xd4b5, 0x54b5,
+    0x32b5, 0xb2b5, 0xd2b5, 0x52b5, 0xcab5, 0x4ab5, 0x2ab5, 0xaab5,
+    0xccd5, 0x4cd5, 0x2cd5, 0xacd5, 0x34d5, 0xb4d5, 0xd4d5, 0x54d5,
+    0x32d5, 0xb2d5, 0xd2d5, 0x52d5, 0xcad5, 0x4ad5, 0x2ad5, 0xaad5,
+    0x3355, 0xb355, 0xd355, 0x5355, 0xcb55, 0x4b55, 0x2b55, 0xab55,
+    0xcd55, 0x4d55, 0x2d55, 0xad55, 0x3555, 0xb555, 0xd555, 0x5555,
+};
+
+/*
+ * bmc_tab shifted into the high half of a word (low half zero). A subframe's
+ * slots 12-27 are then bmc_hi[lo byte] ^ bmc_tab[hi byte]: the sign extension
+ * of the second entry chains its polarity into the first, as the former
+ * (bmc_tab[a] << 16) ^ bmc_tab[b] did, one shift fewer per subframe.
+ */
+static DRAM_ATTR uint32_t bmc_hi[256];
+
+// BMC preamble
+#define BMC_B		0x33173333	// block start
+#define BMC_M		0x331d3333	// left ch
+#define BMC_W		0x331b3333	// right ch
+#define BMC_AUX		0x0000ffffu	// aux slots 4-11 in the first word
+#define BMC_VUCP_SHIFT	24
+#define VUCP_ZERO	0x33		// V=0 U=0 C=0 P=0
+#define VUCP_C		0x35		// V=0 U=0 C=1 P=1 (parity stays even)
+
+// IEC 60958-3 consumer channel status, byte 3 (sampling frequency)
+static uint8_t spdif_cs_fs(int rate)
+{
+    switch (rate) {
+        case 32000:  return 0x03;
+        case 44100:  return 0x00;
+        case 48000:  return 0x02;
+        case 88200:  return 0x08;
+        case 96000:  return 0x0a;
+        case 176400: return 0x0c;
+        case 192000: return 0x0e;
+        default:     return 0x01;   // not indicated
+    }
+}
+
+void spdif_bmc_build_block(uint32_t pre[SPDIF_BUF_DIV][SPDIF_BUF_ARRAY_SIZE / 2], int rate, bool s24)
+{
+    uint8_t cs[SPDIF_BLOCK_SAMPLES / 8] = {0};
+    cs[0] = 0x04;                           // consumer, PCM, copying permitted, no emphasis
+    cs[1] = 0x00;                           // category: general
+    cs[3] = spdif_cs_fs(rate);              // clock accuracy level II
+    cs[4] = s24 ? 0x0b : 0x02;              // 24 of 24 bits / 16 of 20 bits
+
+    if (!bmc_hi[0]) {
+        for (int i = 0; i < 256; i++) {
+            bmc_hi[i] = (uint32_t)(uint16_t)bmc_tab[i] << 16;
+        }
+    }
+
+    const int subframes = SPDIF_BLOCK_SAMPLES * I2S_CHANNELS;
+    for (int sf = 0; sf < subframes; sf++) {
+        // this word carries the VUCP slots of the subframe before it
+        int prev_frame = ((sf + subframes - 1) % subframes) / I2S_CHANNELS;
+        bool c = (cs[prev_frame >> 3] >> (prev_frame & 7)) & 1;
+        uint32_t preamble = sf == 0 ? BMC_B : (sf & 1) ? BMC_W : BMC_M;
+        uint32_t word = (preamble & ~(0xffu << BMC_VUCP_SHIFT)) |
+                        ((uint32_t)(c ? VUCP_C : VUCP_ZERO) << BMC_VUCP_SHIFT);
+        pre[sf / (subframes / SPDIF_BUF_DIV)][sf % (subframes / SPDIF_BUF_DIV)] = word;
+    }
+}
+
+IRAM_ATTR void spdif_bmc_encode_s16(uint32_t *out, const uint8_t *p, const uint32_t *pre)
+{
+    uint32_t *ptr = out;
+    const uint32_t *end = &out[SPDIF_BUF_ARRAY_SIZE];
+
+    while (ptr < end) {
+        *ptr = *pre++;
+        *(ptr + 1) = (bmc_hi[*p] ^ (uint32_t)(int32_t)bmc_tab[*(p + 1)]) & 0x7fffffffu;
+
+        p += 2;
+        ptr += 2;
+    }
+}
+
+IRAM_ATTR void spdif_bmc_encode_s24(uint32_t *out, const uint8_t *p, const uint32_t *pre)
+{
+    uint32_t *ptr = out;
+    const uint32_t *end = &out[SPDIF_BUF_ARRAY_SIZE];
+
+    while (ptr < end) {
+        // Time slots 12-27 (sample bits 8-23), polarity chained as in spdif_bmc_encode_s16()
+        uint32_t hi = bmc_hi[*(p + 1)] ^ (uint32_t)(int32_t)bmc_tab[*(p + 2)];
+        // Time slots 4-11 (sample bits 0-7) share the preamble word. They must end
+        // opposite to where the high word starts, and start low after the preamble;
+        // the latter flips the LSB when needed, which also keeps the parity even.
+        uint32_t lo = ((uint16_t)bmc_tab[*p] ^ (uint32_t)((int32_t)hi >> 31)) & 0x7fffu;
+
+        *ptr = (*pre++ & ~BMC_AUX) | lo;
+        *(ptr + 1) = hi;
+
+        p += 3;
+        ptr += 2;
+    }
+}
+
+#ifdef CONFIG_SPDIF_ENCODER_BENCHMARK
+#define SPDIF_BENCH_BLOCKS	64
+
+// The encoder loop spdif_out.c used before bmc_hi[], kept only as the benchmark's baseline
+__attribute__((noinline)) void spdif_bmc_encode_s16_bytes(uint32_t *out, const uint8_t *p)
+{
+    for (uint32_t *ptr = out; ptr < &out[SPDIF_BUF_ARRAY_SIZE]; ptr += 2, p += 2) {
+        *(ptr + 1) = (uint32_t)(((bmc_tab[*p] << 16) ^ bmc_tab[*(p + 1)]) << 1) >> 1;
+    }
+}
+
+// Cycles per stereo frame for each encoder, and the share of one core at the configured rate
+void spdif_bmc_benchmark(int rate)
+{
+    static uint32_t out[SPDIF_BUF_ARRAY_SIZE];
+    static uint32_t pre[SPDIF_BUF_DIV][SPDIF_BUF_ARRAY_SIZE / 2];
+    static uint8_t pcm[SPDIF_BUF_FRAMES * PCM_FRAME_S24];
+
+    uint32_t x = 0x12345678u;
+    for (size_t i = 0; i < sizeof(pcm); i++) {
+        x = x * 1664525u + 1013904223u;
+        pcm[i] = (uint8_t)(x >> 24);
+    }
+    spdif_bmc_build_block(pre, rate, false);
+
+    uint32_t cycles[3];
+    for (int kind = 0; kind < 3; kind++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (int i = 0; i < SPDIF_BENCH_BLOCKS; i++) {
+            if (kind == 0) {
+                spdif_bmc_encode_s16_bytes(out, pcm);
+            } else if (kind == 1) {
+                spdif_bmc_encode_s16(out, pcm, pre[i & 1]);
+            } else {
+                spdif_bmc_encode_s24(out, pcm, pre[i & 1]);
+            }
+        }
+        cycles[kind] = (esp_cpu_get_cycle_count() - t0) / (SPDIF_BENCH_BLOCKS * SPDIF_BUF_FRAMES);
+    }
+
+    // cycles/frame * frames/s over cycles/s, in hundredths of a percent
+    uint32_t load = (uint32_t)((uint64_t)cycles[2] * rate / (CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 100u));
+    ESP_LOGI(TAG, "Encoder benchmark: s16 %u cycles/frame (byte tables %u), s24 %u cycles/frame, "
+             "s24 at %d Hz uses %u.%02u%% of a core",
+             (unsigned)cycles[1], (unsigned)cycles[0], (unsigned)cycles[2], rate,
+             (unsigned)(load / 100), (unsigned)(load % 100));
+    metrics_bench_check("spdif_s16", cycles[1]);
+    metrics_bench_check("spdif_s24", cycles[2]);
+}
+#endif
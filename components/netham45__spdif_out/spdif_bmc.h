@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * IEC 60958 biphase-mark (BMC) encoder behind spdif_out.c, kept free of the
+ * I2S driver so the host build (host_test/audio_core) runs the same code.
+ *
+ * Each subframe is one 32-bit slot pair: the first word holds the VUCP slots
+ * of the previous subframe, the preamble and aux slots 4-11, the second the
+ * sample's time slots 12-27. The encoder works half a block (96 frames) at a
+ * time against a precomputed first word per subframe (spdif_bmc_build_block()).
+ */
+
+#define I2S_BITS_PER_SAMPLE	(32)
+#define I2S_CHANNELS		2
+#define BMC_BITS_PER_SAMPLE	64
+#define BMC_BITS_FACTOR		(BMC_BITS_PER_SAMPLE / I2S_BITS_PER_SAMPLE)
+#define SPDIF_BLOCK_SAMPLES	192
+#define SPDIF_BUF_DIV		2	// encode half a block at a time
+#define SPDIF_BLOCK_SIZE	(SPDIF_BLOCK_SAMPLES * (BMC_BITS_PER_SAMPLE/8) * I2S_CHANNELS)
+#define SPDIF_BUF_SIZE		(SPDIF_BLOCK_SIZE / SPDIF_BUF_DIV)
+#define SPDIF_BUF_ARRAY_SIZE	(SPDIF_BUF_SIZE / sizeof(uint32_t))
+#define SPDIF_BUF_FRAMES	(SPDIF_BLOCK_SAMPLES / SPDIF_BUF_DIV)	// PCM frames per half block
+
+#define PCM_FRAME_S16		4	// bytes per stereo frame, 16-bit
+#define PCM_FRAME_S24		6	// bytes per stereo frame, packed 24-bit
+
+/**
+ * @brief Rebuild the first word of every subframe for a rate and sample width
+ * @param pre  One row per half block
+ * @param rate Sample rate announced in the channel status
+ * @param s24  Packed 24-bit samples (else 16-bit)
+ */
+void spdif_bmc_build_block(uint32_t pre[SPDIF_BUF_DIV][SPDIF_BUF_ARRAY_SIZE / 2], int rate, bool s24);
+
+/**
+ * @brief Encode one half block of 16-bit PCM
+ * @param out SPDIF_BUF_ARRAY_SIZE words
+ * @param p   SPDIF_BUF_FRAMES frames of little-endian stereo samples
+ * @param pre The half block's row of spdif_bmc_build_block()
+ */
+void spdif_bmc_encode_s16(uint32_t *out, const uint8_t *p, const uint32_t *pre);
+
+/**
+ * @brief Encode one half block of packed 24-bit PCM (as spdif_bmc_encode_s16())
+ */
+void spdif_bmc_encode_s24(uint32_t *out, const uint8_t *p, const uint32_t *pre);
+
+#ifdef CONFIG_SPDIF_ENCODER_BENCHMARK
+/**
+ * @brief Encode 16-bit PCM with the byte-table loop spdif_bmc_encode_s16() replaced
+ * The benchmark's baseline and a reference output; only the sample words are written.
+ */
+void spdif_bmc_encode_s16_bytes(uint32_t *out, const uint8_t *p);
+
+/**
+ * @brief Log cycles per stereo frame for each encoder and the share of a core at a rate
+ */
+void spdif_bmc_benchmark(int rate);
+#endif
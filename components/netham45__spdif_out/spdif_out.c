@@ -6,106 +6,221 @@
     CONDITIONS OF ANY KIND, either express or implied.
 */
 #include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
-#include "driver/i2s.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include "driver/i2s_std.h"
+#include "soc/soc_caps.h"
+#if SOC_I2S_SUPPORTS_APLL
+#include "clk_ctrl_os.h"
+#include "esp_clk_tree.h"
+#endif
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "log_rate.h"
+#include "metrics_profile.h"
+#include "audio_arena.h"
+#include "esp_heap_caps.h"
 #include "esp_err.h"
+#include "spdif_out.h"
+#include "spdif_bmc.h"
 
 #define TAG "spdif_out"
 
-#define I2S_NUM			(0)
-
-#define I2S_BITS_PER_SAMPLE	(32)
-#define I2S_CHANNELS		2
-#define BMC_BITS_PER_SAMPLE	64
-#define BMC_BITS_FACTOR		(BMC_BITS_PER_SAMPLE / I2S_BITS_PER_SAMPLE)
-#define SPDIF_BLOCK_SAMPLES	192
-#define SPDIF_BUF_DIV		2	// double buffering
-#define DMA_BUF_COUNT		2
-#define DMA_BUF_LEN		(SPDIF_BLOCK_SAMPLES * BMC_BITS_PER_SAMPLE / I2S_BITS_PER_SAMPLE / SPDIF_BUF_DIV)
-#define I2S_BUG_MAGIC		(26 * 1000 * 1000)	// magic number for avoiding I2S bug
-#define SPDIF_BLOCK_SIZE	(SPDIF_BLOCK_SAMPLES * (BMC_BITS_PER_SAMPLE/8) * I2S_CHANNELS)
-#define SPDIF_BUF_SIZE		(SPDIF_BLOCK_SIZE / SPDIF_BUF_DIV)
-#define SPDIF_BUF_ARRAY_SIZE	(SPDIF_BUF_SIZE / sizeof(uint32_t))
+#ifndef CONFIG_SPDIF_DMA_DESC_NUM
+#define CONFIG_SPDIF_DMA_DESC_NUM 6
+#endif
+#ifndef CONFIG_SPDIF_PCM_BUFFER_MS
+#define CONFIG_SPDIF_PCM_BUFFER_MS 40
+#endif
+#ifndef CONFIG_SPDIF_WRITE_TIMEOUT_MS
+#define CONFIG_SPDIF_WRITE_TIMEOUT_MS 50
+#endif
+#ifndef CONFIG_SPDIF_ENCODER_TASK_PRIORITY
+#define CONFIG_SPDIF_ENCODER_TASK_PRIORITY 6
+#endif
+#ifndef CONFIG_SPDIF_ENCODER_TASK_CORE
+#define CONFIG_SPDIF_ENCODER_TASK_CORE 1
+#endif
+
+#define I2S_NUM			I2S_NUM_0
+
+// one I2S frame is a 32-bit slot pair, i.e. one BMC-encoded subframe
+#define DMA_FRAME_NUM		(SPDIF_BUF_SIZE / (I2S_BITS_PER_SAMPLE / 8 * I2S_CHANNELS))
+
+#define SPDIF_MAX_RATE		192000
+#define SPDIF_CLOCK_MAX_PPB	1000000		// IEC 60958 level II: +-1000 ppm
+
+#define ENCODER_TASK_STACK	3072
+#define STOP_TIMEOUT_MS		500
 
+/*
+ * Data path: spdif_write() only copies PCM into pcm_ring. The encoder task
+ * pulls half a block (96 frames) at a time, BMC-encodes it into spdif_buf and
+ * queues it on the I2S channel, which owns CONFIG_SPDIF_DMA_DESC_NUM (or
+ * spdif_set_depth())
+ * half-block descriptors. Only the encoder task ever waits on the hardware;
+ * the writer waits at most CONFIG_SPDIF_WRITE_TIMEOUT_MS for ring space,
+ * which is what paces it. If the ring runs dry the encoder pads the half block
+ * with silence rather than leaving the DMA queue to drain.
+ */
 static uint32_t spdif_buf[SPDIF_BUF_ARRAY_SIZE];
+static uint8_t pcm_block[SPDIF_BUF_FRAMES * PCM_FRAME_S24];
+
+/*
+ * First word of every subframe, per half block: VUCP of the subframe before
+ * it, then the preamble, then aux slots 4-11 (zero; 24-bit blocks overwrite
+ * them). Channel status is one bit per frame, so the 192-frame block is fixed
+ * for a given rate and width and is rebuilt only when either changes.
+ */
+static uint32_t spdif_pre[SPDIF_BUF_DIV][SPDIF_BUF_ARRAY_SIZE / 2];
 
 typedef struct {
     bool initialized;
-    bool started;
+    atomic_bool started;
     int rate;
     int pin;
-    uint32_t *ptr;
+    i2s_chan_handle_t tx;
+    RingbufHandle_t pcm_ring;
+    StaticRingbuffer_t ring_struct;
+    uint8_t *ring_storage;          // audio arena
+    size_t ring_size;
+    TaskHandle_t task;
+    SemaphoreHandle_t task_done;
+    TickType_t underrun_wait;       // how long the encoder waits for PCM before padding
+    atomic_bool s24;                // sample width the writer is producing
+    atomic_bool enc_s24;            // sample width of the block being encoded
+    atomic_uint_fast32_t underruns; // times the ring ran dry mid-stream
+    atomic_uint_fast32_t dma_overflows;
+    atomic_uint_fast32_t dropped;   // bytes the writer gave up on
+    uint32_t apll_nominal_hz;       // APLL as the I2S driver set it; 0 when not steerable
+    int32_t clock_ppb;              // offset applied by spdif_set_clock_offset_ppb()
 } spdif_state_t;
 
 static spdif_state_t s_spdif = {0};
 
-/*
- * 8bit PCM to 16bit BMC conversion table, LSb first, 1 end
- */
-static const int16_t bmc_tab[256] = {
-    0x3333, 0xb333, 0xd333, 0x5333, 0xcb33, 0x4b33, 0x2b33, 0xab33,
-    0xcd33, 0x4d33, 0x2d33, 0xad33, 0x3533, 0xb533, 0xd533, 0x5533,
-    0xccb3, 0x4cb3, 0x2cb3, 0xacb3, 0x34b3, 0xb4b3, 0xd4b3, 0x54b3,
-    0x32b3, 0xb2b3, 0xd2b3, 0x52b3, 0xcab3, 0x4ab3, 0x2ab3, 0xaab3,
-    0xccd3, 0x4cd3, 0x2cd3, 0xacd3, 0x34d3, 0xb4d3, 0xd4d3, 0x54d3,
-    0x32d3, 0xb2d3, 0xd2d3, 0x52d3, 0xcad3, 0x4ad3, 0x2ad3, 0xaad3,
-    0x3353, 0xb353, 0xd353, 0x5353, 0xcb53, 0x4b53, 0x2b53, 0xab53,
-    0xcd53, 0x4d53, 0x2d53, 0xad53, 0x3553, 0xb553, 0xd553, 0x5553,
-    0xcccb, 0x4ccb, 0x2ccb, 0xaccb, 0x34cb, 0xb4cb, 0xd4cb, 0x54cb,
-    0x32cb, 0xb2cb, 0xd2cb, 0x52cb, 0xcacb, 0x4acb, 0x2acb, 0xaacb,
-    0x334b, 0xb34b, 0xd34b, 0x534b, 0xcb4b, 0x4b4b, 0x2b4b, 0xab4b,
-    0xcd4b, 0x4d4b, 0x2d4b, 0xad4b, 0x354b, 0xb54b, 0xd54b, 0x554b,
-    0x332b, 0xb32b, 0xd32b, 0x532b, 0xcb2b, 0x4b2b, 0x2b2b, 0xab2b,
-    0xcd2b, 0x4d2b, 0x2d2b, 0xad2b, 0x352b, 0xb52b, 0xd52b, 0x552b,
-    0xccab, 0x4cab, 0x2cab, 0xacab, 0x34ab, 0xb4ab, 0xd4ab, 0x54ab,
-    0x32ab, 0xb2ab, 0xd2ab, 0x52ab, 0xcaab, 0x4aab, 0x2aab, 0xaaab,
-    0xcccd, 0x4ccd, 0x2ccd, 0xaccd, 0x34cd, 0xb4cd, 0xd4cd, 0x54cd,
-    0x32cd, 0xb2cd, 0xd2cd, 0x52cd, 0xcacd, 0x4acd, 0x2acd, 0xaacd,
-    0x334d, 0xb34d, 0xd34d, 0x534d, 0xcb4d, 0x4b4d, 0x2b4d, 0xab4d,
-    0xcd4d, 0x4d4d, 0x2d4d, 0xad4d, 0x354d, 0xb54d, 0xd54d, 0x554d,
-    0x332d, 0xb32d, 0xd32d, 0x532d, 0xcb2d, 0x4b2d, 0x2b2d, 0xab2d,
-    0xcd2d, 0x4d2d, 0x2d2d, 0xad2d, 0x352d, 0xb52d, 0xd52d, 0x552d,
-    0xccad, 0x4cad, 0x2cad, 0xacad, 0x34ad, 0xb4ad, 0xd4ad, 0x54ad,
-    0x32ad, 0xb2ad, 0xd2ad, 0x52ad, 0xcaad, 0x4aad, 0x2aad, 0xaaad,
-    0x3335, 0xb335, 0xd335, 0x5335, 0xcb35, 0x4b35, 0x2b35, 0xab35,
-    0xcd35, 0x4d35, 0x2d35, 0xad35, 0x3535, 0xb535, 0xd535, 0x5535,
-    0xccb5, 0x4cb5, 0x2cb5, 0xacb5, 0x34b5, 0xb4b5, 0xd4b5, 0x54b5,
-    0x32b5, 0xb2b5, 0xd2b5, 0x52b5, 0xcab5, 0x4ab5, 0x2ab5, 0xaab5,
-    0xccd5, 0x4cd5, 0x2cd5, 0xacd5, 0x34d5, 0xb4d5, 0xd4d5, 0x54d5,
-    0x32d5, 0xb2d5, 0xd2d5, 0x52d5, 0xcad5, 0x4ad5, 0x2ad5, 0xaad5,
-    0x3355, 0xb355, 0xd355, 0x5355, 0xcb55, 0x4b55, 0x2b55, 0xab55,
-    0xcd55, 0x4d55, 0x2d55, 0xad55, 0x3555, 0xb555, 0xd555, 0x5555,
-};
-
-// BMC preamble
-#define BMC_B		0x33173333	// block start
-#define BMC_M		0x331d3333	// left ch
-#define BMC_W		0x331b3333	// right ch
-#define BMC_MW_DIF	(BMC_M ^ BMC_W)
-#define SYNC_OFFSET	2		// byte offset of SYNC
-#define SYNC_FLIP	((BMC_B ^ BMC_M) >> (SYNC_OFFSET * 8))
-
-// initialize S/PDIF buffer
-static void spdif_buf_init(void)
+// output depth for the next spdif_init(); survives spdif_release() (see spdif_set_depth())
+static uint32_t s_ring_ms = CONFIG_SPDIF_PCM_BUFFER_MS;
+static int s_dma_desc_num = CONFIG_SPDIF_DMA_DESC_NUM;
+
+// encoder task stages (CONFIG_METRICS_PROFILER); the write includes the wait for a free DMA buffer
+static metrics_profile_t prof_encode = METRICS_PROFILE_INIT("spdif_encode", "S/PDIF BMC encode of one block");
+static metrics_profile_t prof_i2s_write = METRICS_PROFILE_INIT("spdif_i2s_write", "i2s_channel_write of one block");
+
+// fill pcm_block from the ring; returns the bytes that arrived in time
+static size_t spdif_fill_block(size_t need, size_t frame)
 {
-    if (s_spdif.ptr)
-        return;
-    int i;
-    uint32_t bmc_mw = BMC_W;
+    size_t got = 0;
+
+    while (got < need) {
+        size_t n = 0;
+        uint8_t *item = xRingbufferReceiveUpTo(s_spdif.pcm_ring, &n, s_spdif.underrun_wait, need - got);
+        if (!item) {
+            // stay frame aligned: a wrapped frame's tail is already in the ring
+            if (got % frame == 0 || !atomic_load(&s_spdif.started)) {
+                break;
+            }
+            continue;
+        }
+        memcpy(pcm_block + got, item, n);
+        vRingbufferReturnItem(s_spdif.pcm_ring, item);
+        got += n;
+    }
+    return got;
+}
+
+static bool spdif_ring_empty(void)
+{
+    return xRingbufferGetCurFreeSize(s_spdif.pcm_ring) >= s_spdif.ring_size;
+}
+
+static void spdif_encoder_task(void *arg)
+{
+    (void)arg;
+    bool starved = true;    // nothing played yet, or already counted
+    bool s24 = atomic_load(&s_spdif.enc_s24);
+    int half = 0;
+
+    spdif_bmc_build_block(spdif_pre, s_spdif.rate, s24);
+
+    while (atomic_load(&s_spdif.started)) {
+        // take up a width change only once the old samples are gone
+        if (s24 != atomic_load(&s_spdif.s24) && spdif_ring_empty()) {
+            s24 = !s24;
+            spdif_bmc_build_block(spdif_pre, s_spdif.rate, s24);
+            atomic_store(&s_spdif.enc_s24, s24);
+        }
 
-    for (i = 0; i < SPDIF_BUF_ARRAY_SIZE; i += 2) {
-        spdif_buf[i] = bmc_mw ^= BMC_MW_DIF;
+        size_t frame = s24 ? PCM_FRAME_S24 : PCM_FRAME_S16;
+        size_t need = SPDIF_BUF_FRAMES * frame;
+        size_t got = spdif_fill_block(need, frame);
+        if (got < need) {
+            memset(pcm_block + got, 0, need - got);
+            // count the stream running dry, not every idle block after it
+            if (!starved) {
+                atomic_fetch_add(&s_spdif.underruns, 1);
+            }
+        }
+        starved = (got < need);
+
+        uint32_t prof_start = metrics_profile_begin();
+        if (s24) {
+            spdif_bmc_encode_s24(spdif_buf, pcm_block, spdif_pre[half]);
+        } else {
+            spdif_bmc_encode_s16(spdif_buf, pcm_block, spdif_pre[half]);
+        }
+        metrics_profile_end(&prof_encode, prof_start);
+        half = (half + 1) % SPDIF_BUF_DIV;
+
+        size_t written = 0;
+        prof_start = metrics_profile_begin();
+        esp_err_t err = i2s_channel_write(s_spdif.tx, spdif_buf, sizeof(spdif_buf), &written,
+                                          pdMS_TO_TICKS(STOP_TIMEOUT_MS));
+        metrics_profile_end(&prof_i2s_write, prof_start);
+        if (err != ESP_OK) {
+            LOG_RATE_W(TAG, "i2s_channel_write failed: %s (%u of %u bytes)",
+                       esp_err_to_name(err), (unsigned)written, (unsigned)sizeof(spdif_buf));
+        }
     }
 
-    s_spdif.ptr = spdif_buf;
+    xSemaphoreGive(s_spdif.task_done);
+    vTaskDelete(NULL);
+}
+
+// DMA ran out of encoded blocks and re-sent a cleared one
+static IRAM_ATTR bool spdif_on_send_q_ovf(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    (void)handle;
+    (void)event;
+    (void)user_ctx;
+    atomic_fetch_add(&s_spdif.dma_overflows, 1);
+    return false;
+}
+
+static void spdif_release(void)
+{
+    if (s_spdif.tx) {
+        i2s_del_channel(s_spdif.tx);
+    }
+    if (s_spdif.pcm_ring) {
+        vRingbufferDelete(s_spdif.pcm_ring);
+    }
+    audio_arena_free(s_spdif.ring_storage);
+    if (s_spdif.task_done) {
+        vSemaphoreDelete(s_spdif.task_done);
+    }
+    s_spdif = (spdif_state_t){0};
 }
 
 // initialize I2S for S/PDIF transmission
 // Returns ESP_OK on success, or an error code on failure
 esp_err_t spdif_init(int rate, int pin)
 {
-    if (rate <= 0) {
+    if (rate <= 0 || rate > SPDIF_MAX_RATE) {
         ESP_LOGE(TAG, "Invalid sample rate: %d", rate);
         return ESP_ERR_INVALID_ARG;
     }
@@ -116,176 +231,337 @@ esp_err_t spdif_init(int rate, int pin)
     }
 
     esp_err_t err;
-    int sample_rate = rate * BMC_BITS_FACTOR;
-    int bclk = sample_rate * I2S_BITS_PER_SAMPLE * I2S_CHANNELS;
-    int mclk = (I2S_BUG_MAGIC / bclk) * bclk; // use mclk for avoiding I2S bug
-    i2s_config_t i2s_config = {
-        .mode = I2S_MODE_MASTER | I2S_MODE_TX,
-        .sample_rate = sample_rate,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE,
-        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
-        .communication_format = I2S_COMM_FORMAT_I2S,
-        .intr_alloc_flags = 0,
-        .dma_buf_count = DMA_BUF_COUNT,
-        .dma_buf_len = DMA_BUF_LEN,
-        .use_apll = true,
-        .tx_desc_auto_clear = true,
-        .fixed_mclk = mclk, // avoiding I2S bug
-    };
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = -1,
-        .ws_io_num = -1,
-        .data_out_num = pin,
-        .data_in_num = -1,
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = s_dma_desc_num;
+    chan_cfg.dma_frame_num = DMA_FRAME_NUM;
+    chan_cfg.auto_clear = true;     // send silence rather than stale blocks on underrun
+
+    err = i2s_new_channel(&chan_cfg, &s_spdif.tx, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(rate * BMC_BITS_FACTOR),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = I2S_GPIO_UNUSED,
+            .ws = I2S_GPIO_UNUSED,
+            .dout = pin,
+            .din = I2S_GPIO_UNUSED,
+        },
     };
+#if SOC_I2S_SUPPORTS_APLL
+    std_cfg.clk_cfg.clk_src = I2S_CLK_SRC_APLL;
+#endif
+    if (rate > 48000) {
+        // 88.2 kHz and up: keep MCLK (and its divider from the clock source) sane
+        std_cfg.clk_cfg.mclk_multiple = I2S_MCLK_MULTIPLE_128;
+    }
 
-    err = i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL);
+    err = i2s_channel_init_std_mode(s_spdif.tx, &std_cfg);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to install I2S driver: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to configure I2S channel (dout=%d): %s", pin, esp_err_to_name(err));
+        spdif_release();
         return err;
     }
 
-    err = i2s_set_pin(I2S_NUM, &pin_config);
+#if SOC_I2S_SUPPORTS_APLL
+    // the driver picked the APLL frequency for this rate; offsets are relative to it
+    if (esp_clk_tree_src_get_freq_hz(SOC_MOD_CLK_APLL, ESP_CLK_TREE_SRC_FREQ_PRECISION_EXACT,
+                                     &s_spdif.apll_nominal_hz) != ESP_OK) {
+        s_spdif.apll_nominal_hz = 0;
+    }
+#endif
+
+    i2s_event_callbacks_t cbs = {
+        .on_send_q_ovf = spdif_on_send_q_ovf,
+    };
+    err = i2s_channel_register_event_callback(s_spdif.tx, &cbs, NULL);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set I2S pins (data_out_num=%d): %s",
-                 pin_config.data_out_num, esp_err_to_name(err));
-        i2s_driver_uninstall(I2S_NUM);
+        ESP_LOGE(TAG, "Failed to register I2S callbacks: %s", esp_err_to_name(err));
+        spdif_release();
         return err;
     }
 
-    spdif_buf_init();
+    // sized for the wider sample format so a width change needs no realloc
+    s_spdif.ring_size = ((size_t)rate * PCM_FRAME_S24 * s_ring_ms / 1000 + 3) & ~(size_t)3;
+    if (s_spdif.ring_size < 2 * sizeof(pcm_block)) {
+        s_spdif.ring_size = 2 * sizeof(pcm_block);
+    }
+    s_spdif.ring_storage = audio_arena_alloc(AUDIO_ARENA_OUTPUT, s_spdif.ring_size,
+                                             MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (s_spdif.ring_storage) {
+        s_spdif.pcm_ring = xRingbufferCreateStatic(s_spdif.ring_size, RINGBUF_TYPE_BYTEBUF,
+                                                   s_spdif.ring_storage, &s_spdif.ring_struct);
+    }
+    s_spdif.task_done = xSemaphoreCreateBinary();
+    if (!s_spdif.pcm_ring || !s_spdif.task_done) {
+        ESP_LOGE(TAG, "Failed to allocate %u byte PCM ring", (unsigned)s_spdif.ring_size);
+        spdif_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // wait up to half of what the DMA queue still holds once a block is queued
+    uint32_t queued_us = (uint32_t)((uint64_t)(s_dma_desc_num - 1) * SPDIF_BUF_FRAMES * 1000000u / rate);
+    s_spdif.underrun_wait = pdMS_TO_TICKS(queued_us / 2000);
+    if (s_spdif.underrun_wait == 0) {
+        s_spdif.underrun_wait = 1;
+    }
 
     s_spdif.initialized = true;
-    s_spdif.started = false;
+    atomic_store(&s_spdif.started, false);
     s_spdif.rate = rate;
     s_spdif.pin = pin;
+#ifdef CONFIG_SPDIF_ENCODER_BENCHMARK
+    spdif_bmc_benchmark(rate);
+#endif
+    ESP_LOGI(TAG, "S/PDIF %d Hz on GPIO %d: %d DMA descriptors, %u byte PCM ring",
+             rate, pin, s_dma_desc_num, (unsigned)s_spdif.ring_size);
     return ESP_OK;
 }
 
 esp_err_t spdif_start(void)
 {
-if (!s_spdif.initialized) {
-    ESP_LOGE(TAG, "Cannot start S/PDIF: not initialized");
-    return ESP_ERR_INVALID_STATE;
-}
+    if (!s_spdif.initialized) {
+        ESP_LOGE(TAG, "Cannot start S/PDIF: not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
 
-if (s_spdif.started) {
-    return ESP_OK;
-}
+    if (atomic_load(&s_spdif.started)) {
+        return ESP_OK;
+    }
 
-spdif_buf_init();
+    atomic_store(&s_spdif.enc_s24, atomic_load(&s_spdif.s24));
+    metrics_profile_register(&prof_encode);
+    metrics_profile_register(&prof_i2s_write);
 
-esp_err_t err = i2s_zero_dma_buffer(I2S_NUM);
-if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to zero I2S DMA buffer: %s", esp_err_to_name(err));
-    return err;
-}
+    esp_err_t err = i2s_channel_enable(s_spdif.tx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
 
-err = i2s_start(I2S_NUM);
-if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to start I2S: %s", esp_err_to_name(err));
-    return err;
-}
+    atomic_store(&s_spdif.started, true);
+    if (xTaskCreatePinnedToCore(spdif_encoder_task, "spdif_enc", ENCODER_TASK_STACK, NULL,
+                                CONFIG_SPDIF_ENCODER_TASK_PRIORITY, &s_spdif.task,
+                                CONFIG_SPDIF_ENCODER_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create S/PDIF encoder task");
+        atomic_store(&s_spdif.started, false);
+        i2s_channel_disable(s_spdif.tx);
+        return ESP_ERR_NO_MEM;
+    }
 
-s_spdif.started = true;
-return ESP_OK;
+    return ESP_OK;
 }
 
 esp_err_t spdif_stop(void)
 {
-if (!s_spdif.initialized) {
-    ESP_LOGE(TAG, "Cannot stop S/PDIF: not initialized");
-    return ESP_ERR_INVALID_STATE;
-}
+    if (!s_spdif.initialized) {
+        ESP_LOGE(TAG, "Cannot stop S/PDIF: not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
 
-if (!s_spdif.started) {
-    return ESP_OK;
-}
+    if (!atomic_load(&s_spdif.started)) {
+        return ESP_OK;
+    }
 
-esp_err_t err = i2s_stop(I2S_NUM);
-if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to stop I2S: %s", esp_err_to_name(err));
-    return err;
-}
+    atomic_store(&s_spdif.started, false);
+    if (xSemaphoreTake(s_spdif.task_done, pdMS_TO_TICKS(2 * STOP_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGE(TAG, "S/PDIF encoder task did not exit");
+        return ESP_ERR_TIMEOUT;
+    }
+    s_spdif.task = NULL;
 
-err = i2s_zero_dma_buffer(I2S_NUM);
-if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to clear I2S DMA buffer: %s", esp_err_to_name(err));
-    return err;
-}
+    esp_err_t err = i2s_channel_disable(s_spdif.tx);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to disable I2S channel: %s", esp_err_to_name(err));
+        return err;
+    }
 
-s_spdif.started = false;
-s_spdif.ptr = spdif_buf;
+    // drop what the encoder never got to
+    size_t n;
+    void *item;
+    while ((item = xRingbufferReceiveUpTo(s_spdif.pcm_ring, &n, 0, s_spdif.ring_size)) != NULL) {
+        vRingbufferReturnItem(s_spdif.pcm_ring, item);
+    }
 
-return ESP_OK;
+    return ESP_OK;
 }
 
 esp_err_t spdif_deinit(void)
 {
-if (!s_spdif.initialized) {
-    return ESP_ERR_INVALID_STATE;
-}
+    if (!s_spdif.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-esp_err_t err = ESP_OK;
+    esp_err_t err = ESP_OK;
 
-if (s_spdif.started) {
-    err = spdif_stop();
-    if (err != ESP_OK) {
-        return err;
+    if (atomic_load(&s_spdif.started)) {
+        err = spdif_stop();
+        if (err != ESP_OK) {
+            return err;
+        }
     }
-}
 
-err = i2s_driver_uninstall(I2S_NUM);
-if (err != ESP_OK) {
-    ESP_LOGE(TAG, "Failed to uninstall I2S driver: %s", esp_err_to_name(err));
-    return err;
+    spdif_release();
+
+    return ESP_OK;
 }
 
-s_spdif = (spdif_state_t){0};
+// queue PCM for the encoder task, waiting at most wait ticks for ring space
+static esp_err_t spdif_queue(const uint8_t *p, size_t size, size_t frame, bool s24, TickType_t wait)
+{
+    if (atomic_load(&s_spdif.s24) != s24) {
+        atomic_store(&s_spdif.s24, s24);
+        // keep the new width out of the ring until the encoder has switched over
+        TickType_t deadline = xTaskGetTickCount() + wait;
+        while (atomic_load(&s_spdif.enc_s24) != s24) {
+            if ((int32_t)(xTaskGetTickCount() - deadline) >= 0) {
+                atomic_fetch_add(&s_spdif.dropped, size);
+                return ESP_ERR_TIMEOUT;
+            }
+            vTaskDelay(1);
+        }
+    }
 
-return ESP_OK;
+    // whole frames, and no more than half the ring per send so a send can always fit
+    size_t max_piece = (s_spdif.ring_size / 2) / frame * frame;
+    while (size > 0) {
+        size_t piece = size < max_piece ? size : max_piece;
+        if (xRingbufferSend(s_spdif.pcm_ring, p, piece, wait) != pdTRUE) {
+            atomic_fetch_add(&s_spdif.dropped, size);
+            LOG_RATE_W(TAG, "S/PDIF PCM ring full, dropped %u bytes", (unsigned)size);
+            return ESP_ERR_TIMEOUT;
+        }
+        p += piece;
+        size -= piece;
+    }
+    return ESP_OK;
 }
 
-
-// write audio data to I2S buffer
+// write audio data to the S/PDIF encoder
 void spdif_write(const void *src, size_t size)
 {
-    if (!s_spdif.started) {
-        ESP_LOGW(TAG, "spdif_write called while transmitter stopped");
+    if (!atomic_load(&s_spdif.started)) {
+        LOG_RATE_W(TAG, "spdif_write called while transmitter stopped");
         return;
     }
 
-    if (size & 1) {
-        ESP_LOGW(TAG, "spdif_write size must be even, truncating trailing byte");
-        size -= 1;
+    if (size % PCM_FRAME_S16) {
+        LOG_RATE_W(TAG, "spdif_write size must be whole stereo frames, truncating");
+        size -= size % PCM_FRAME_S16;
     }
 
     if (size == 0) {
         return;
     }
 
-    const uint8_t *p = src;
-    const uint8_t *end = (const uint8_t *)src + size;
-    uint32_t *ptr = s_spdif.ptr;
+    spdif_queue(src, size, PCM_FRAME_S16, false, pdMS_TO_TICKS(CONFIG_SPDIF_WRITE_TIMEOUT_MS));
+}
 
-    while (p < end) {
-        *(ptr + 1) = (uint32_t)(((bmc_tab[*p] << 16) ^ bmc_tab[*(p + 1)]) << 1) >> 1;
+// write packed 24-bit audio (3 bytes per sample, little endian) to the S/PDIF encoder
+void spdif_write_s24(const void *src, size_t size)
+{
+    if (!atomic_load(&s_spdif.started)) {
+        LOG_RATE_W(TAG, "spdif_write_s24 called while transmitter stopped");
+        return;
+    }
 
-        p += 2;
-        ptr += 2;
+    size -= size % PCM_FRAME_S24;
+    if (size == 0) {
+        return;
+    }
 
-        if (ptr >= &spdif_buf[SPDIF_BUF_ARRAY_SIZE]) {
-            size_t i2s_write_len;
+    spdif_queue(src, size, PCM_FRAME_S24, true, pdMS_TO_TICKS(CONFIG_SPDIF_WRITE_TIMEOUT_MS));
+}
 
-            ((uint8_t *)spdif_buf)[SYNC_OFFSET] ^= SYNC_FLIP;
+// either width, with the caller's wait instead of CONFIG_SPDIF_WRITE_TIMEOUT_MS
+esp_err_t spdif_write_timeout(const void *src, size_t size, bool s24, uint32_t wait_ms)
+{
+    if (!atomic_load(&s_spdif.started)) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-            i2s_write(I2S_NUM, spdif_buf, sizeof(spdif_buf), &i2s_write_len, portMAX_DELAY);
+    size_t frame = s24 ? PCM_FRAME_S24 : PCM_FRAME_S16;
+    size -= size % frame;
+    if (size == 0) {
+        return ESP_OK;
+    }
 
-            ptr = spdif_buf;
-        }
+    return spdif_queue(src, size, frame, s24, pdMS_TO_TICKS(wait_ms));
+}
+
+void spdif_get_stats(spdif_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->underruns = atomic_load(&s_spdif.underruns);
+    stats->dma_overflows = atomic_load(&s_spdif.dma_overflows);
+    stats->dropped_bytes = atomic_load(&s_spdif.dropped);
+    stats->clock_offset_ppb = s_spdif.clock_ppb;
+}
+
+// full PCM ring at the writer's width, plus the half block being encoded and the DMA queue
+uint32_t spdif_get_latency_us(void)
+{
+    if (!s_spdif.initialized || s_spdif.rate <= 0) {
+        return 0;
+    }
+    size_t frame = atomic_load(&s_spdif.s24) ? PCM_FRAME_S24 : PCM_FRAME_S16;
+    uint64_t frames = s_spdif.ring_size / frame + (uint64_t)(s_dma_desc_num + 1) * SPDIF_BUF_FRAMES;
+    return (uint32_t)(frames * 1000000u / (uint32_t)s_spdif.rate);
+}
+
+// ring and DMA queue for the next spdif_init(); 0 keeps the Kconfig default
+esp_err_t spdif_set_depth(uint32_t ring_ms, int dma_desc_num)
+{
+    if (s_spdif.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if ((ring_ms && ring_ms > 200) || (dma_desc_num && (dma_desc_num < 2 || dma_desc_num > 16))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ring_ms = ring_ms ? ring_ms : CONFIG_SPDIF_PCM_BUFFER_MS;
+    s_dma_desc_num = dma_desc_num ? dma_desc_num : CONFIG_SPDIF_DMA_DESC_NUM;
+    return ESP_OK;
+}
+
+// retune the APLL behind the I2S clock; takes effect without stopping the stream
+esp_err_t spdif_set_clock_offset_ppb(int32_t ppb)
+{
+    if (!s_spdif.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if SOC_I2S_SUPPORTS_APLL
+    if (!s_spdif.apll_nominal_hz) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (ppb > SPDIF_CLOCK_MAX_PPB) {
+        ppb = SPDIF_CLOCK_MAX_PPB;
+    } else if (ppb < -SPDIF_CLOCK_MAX_PPB) {
+        ppb = -SPDIF_CLOCK_MAX_PPB;
     }
 
-    s_spdif.ptr = ptr;
+    uint32_t target = (uint32_t)((int64_t)s_spdif.apll_nominal_hz +
+                                 (int64_t)s_spdif.apll_nominal_hz * ppb / 1000000000LL);
+    uint32_t real = 0;
+    // refused (ESP_ERR_INVALID_STATE) while another peripheral holds the APLL too
+    esp_err_t err = periph_rtc_apll_freq_set(target, &real);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_spdif.clock_ppb = ppb;
+    return ESP_OK;
+#else
+    // the I2S clock comes from an integer/fractional divider of a fixed PLL
+    (void)ppb;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
 }
 
 // change S/PDIF sample rate
@@ -297,7 +573,7 @@ esp_err_t spdif_set_sample_rates(int rate)
         return ESP_ERR_INVALID_STATE;
     }
 
-    bool was_started = s_spdif.started;
+    bool was_started = atomic_load(&s_spdif.started);
     int pin = s_spdif.pin;
 
     esp_err_t err = ESP_OK;
@@ -309,15 +585,8 @@ esp_err_t spdif_set_sample_rates(int rate)
         }
     }
 
-    err = i2s_driver_uninstall(I2S_NUM);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to uninstall I2S driver: %s", esp_err_to_name(err));
-        return err;
-    }
-
-    s_spdif.initialized = false;
-    s_spdif.started = false;
-    s_spdif.ptr = spdif_buf;
+    // the ring and underrun wait scale with the rate, so rebuild everything
+    spdif_release();
 
     err = spdif_init(rate, pin);
     if (err != ESP_OK) {
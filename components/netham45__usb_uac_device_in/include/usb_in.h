@@ -4,7 +4,7 @@
 #include "sdkconfig.h"
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/ringbuf.h"
+#include "pcm_ring.h"
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -22,40 +22,52 @@ extern "C" {
 #define USB_BUFFER_SIZE         CONFIG_USB_IN_BUFFER_SIZE
 #define USB_TASK_STACK_SIZE     CONFIG_USB_IN_TASK_STACK_SIZE
 #define USB_TASK_PRIORITY       CONFIG_USB_IN_TASK_PRIORITY
-#define USB_PCM_BUFFER_SIZE         CONFIG_USB_IN_PCM_BUFFER_SIZE
+#define USB_PCM_RING_FRAMES     CONFIG_USB_IN_PCM_RING_FRAMES
+#define USB_FRAME_BYTES         (USB_CHANNEL_NUM * USB_BYTES_PER_SAMPLE)
 
-// External PCM buffer shared with network_out
-extern RingbufHandle_t usb_in_pcm_buffer;
+// Capture ring shared with network_out (SPSC: UAC output callback -> sender)
+extern pcm_ring_t *usb_in_pcm_ring;
 
 // Public API functions
 esp_err_t usb_in_init(void (*init_done_cb)(void));
 esp_err_t usb_in_start(void);
 esp_err_t usb_in_stop(void);
 void usb_in_deinit(void);
+// TinyUSB holds the OTG controller (from the first usb_in_init() until reset), so the
+// USB host stack (usb_out) cannot start
+bool usb_in_holds_controller(void);
 uint32_t usb_in_get_sample_rate(void);
+// Correction the feedback endpoint asks of the host, ppm of the nominal rate (0 unless CONFIG_USB_IN_ASYNC_FEEDBACK)
+int32_t usb_in_get_feedback_ppm(void);
 bool usb_in_is_connected(void);
 
-inline int usb_in_read(uint8_t *buffer, size_t size)
+// Copy up to size bytes (whole frames) out of the capture ring, waiting up to 10 ms for a frame
+static inline int usb_in_read(uint8_t *buffer, size_t size)
 {
-    if (!usb_in_pcm_buffer)
+    if (!usb_in_pcm_ring)
     {
         return 0;
     }
-    size_t received_size = 0;
-    uint8_t *data = (uint8_t *)xRingbufferReceiveUpTo(
-        usb_in_pcm_buffer, &received_size, pdMS_TO_TICKS(10), size);
-    if (data && received_size > 0)
+    pcm_ring_wait(usb_in_pcm_ring, USB_FRAME_BYTES, pdMS_TO_TICKS(10));
+    size_t copied = 0;
+    while (copied < size)
     {
-        memcpy(buffer, data, received_size);
-        vRingbufferReturnItem(usb_in_pcm_buffer, (void *)data);
-        return received_size;
+        const uint8_t *data = NULL;
+        size_t n = pcm_ring_peek(usb_in_pcm_ring, &data, size - copied);
+        if (n == 0)
+        {
+            break;
+        }
+        memcpy(buffer + copied, data, n);
+        pcm_ring_consume(usb_in_pcm_ring, n);
+        copied += n;
     }
-    return 0;
+    return (int)copied;
 }
 
-static inline RingbufHandle_t usb_in_get_ringbuf()
+static inline pcm_ring_t *usb_in_get_capture_ring(void)
 {
-    return usb_in_pcm_buffer;
+    return usb_in_pcm_ring;
 }
 
 #ifdef __cplusplus
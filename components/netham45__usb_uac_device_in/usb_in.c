@@ -5,13 +5,26 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/ringbuf.h"
 #include "esp_heap_caps.h"
 #include "usb_device_uac.h"
+#include "metrics.h"
+#include <stdatomic.h>
+#ifdef CONFIG_USB_IN_ASYNC_FEEDBACK
+#include "tusb.h"
+#if !CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+#error "CONFIG_USB_IN_ASYNC_FEEDBACK needs usb_device_uac built with an asynchronous OUT endpoint and a feedback endpoint"
+#endif
+#endif
 
 static const char *TAG = "usb_in";
 
-RingbufHandle_t usb_in_pcm_buffer = NULL;
+// Monitor task period while the feedback servo runs (it also paces the 1 s status checks)
+#define USB_FEEDBACK_TICK_MS 16
+// Integral gain 1/8192 per tick (~130 s): well behind the proportional loop, whose
+// time constant is half the ring over max_ppm of the rate (~20 s at the defaults)
+#define USB_FEEDBACK_INTEGRAL_SHIFT 13
+
+pcm_ring_t *usb_in_pcm_ring = NULL;
 
 // State management structure
 static struct {
@@ -23,43 +36,114 @@ static struct {
     void (*init_done_cb)(void);
     
     
-    // Statistics
+    // Statistics (frames dropped are counted by the capture ring)
     uint32_t packets_sent;
     uint32_t packets_dropped;
     uint32_t buffer_underruns;
 } g_usb_state = {0};
 
+// The UAC device component has no uninstall: TinyUSB keeps the OTG controller
+// from the first usb_in_init() until reset, and later inits reuse it
+static bool s_uac_installed = false;
+
+// Lifetime count behind /metrics; packets_dropped above is per session
+static metrics_counter_t s_dropped_metric =
+    METRICS_COUNTER_INIT("usb_in_packets_dropped_total", "USB host packets that did not fit the capture ring");
+
+// Rate correction last reported to the host, in ppm of the nominal rate (0 without feedback)
+static atomic_int_fast32_t s_feedback_ppm = 0;
+
+static int64_t read_feedback_ppm(void)
+{
+    return atomic_load_explicit(&s_feedback_ppm, memory_order_relaxed);
+}
+
+static metrics_gauge_t s_feedback_metric =
+    METRICS_GAUGE_INIT("usb_in_feedback_ppm", "Rate correction asked of the USB host, ppm", read_feedback_ppm);
+
+#ifdef CONFIG_USB_IN_ASYNC_FEEDBACK
+// Servo state, monitor task only
+static struct {
+    int32_t avg_fill;       // Smoothed ring fill, frames << 4
+    int32_t integral;       // Summed proportional term, ppm << USB_FEEDBACK_INTEGRAL_SHIFT
+} s_servo;
+
+static void feedback_reset(void)
+{
+    s_servo.avg_fill = (int32_t)(pcm_ring_size(usb_in_pcm_ring) / USB_FRAME_BYTES / 2) << 4;
+    s_servo.integral = 0;
+}
+
+/*
+ * Asynchronous sink: the sender drains the ring at the network's pace (the
+ * ESP32 clock), so the ring's fill level is the difference between the two
+ * clocks integrated over time. Keep it at half full by telling the host how
+ * many samples per USB frame to send: proportional to the fill error, plus
+ * a slow integral that soaks up the steady-state drift so the fill returns
+ * to target instead of settling off it.
+ */
+static void feedback_update(void)
+{
+    const int32_t max_ppm = CONFIG_USB_IN_FEEDBACK_MAX_PPM;
+    const int32_t target = (int32_t)(pcm_ring_size(usb_in_pcm_ring) / USB_FRAME_BYTES / 2);
+    int32_t fill = (int32_t)(pcm_ring_fill(usb_in_pcm_ring) / USB_FRAME_BYTES);
+
+    // The sender takes whole packets at a time; smooth over that sawtooth (1/8 per tick)
+    s_servo.avg_fill += ((fill << 4) - s_servo.avg_fill) / 8;
+
+    // Ring empty (or full) asks for the whole range
+    int32_t p = (int32_t)(((int64_t)(target - (s_servo.avg_fill >> 4)) * max_ppm) / target);
+    const int32_t max_integral = max_ppm << USB_FEEDBACK_INTEGRAL_SHIFT;
+    s_servo.integral += p;
+    if (s_servo.integral > max_integral) {
+        s_servo.integral = max_integral;
+    } else if (s_servo.integral < -max_integral) {
+        s_servo.integral = -max_integral;
+    }
+    int32_t ppm = p + (s_servo.integral >> USB_FEEDBACK_INTEGRAL_SHIFT);
+    if (ppm > max_ppm) {
+        ppm = max_ppm;
+    } else if (ppm < -max_ppm) {
+        ppm = -max_ppm;
+    }
+
+    // Samples per (micro)frame: 10.14 on full speed, 16.16 per 125 us on high speed
+    // (TinyUSB converts 16.16 itself when its format correction is on)
+    uint64_t rate = (uint64_t)USB_SAMPLE_RATE * (uint64_t)(1000000 + ppm);
+    uint32_t fb;
+#if CFG_TUD_AUDIO_ENABLE_FEEDBACK_FORMAT_CORRECTION
+    fb = (uint32_t)((rate << 16) / (1000000ULL * 1000ULL));
+#else
+    if (tud_speed_get() == TUSB_SPEED_HIGH) {
+        fb = (uint32_t)((rate << 16) / (1000000ULL * 8000ULL));
+    } else {
+        fb = (uint32_t)((rate << 14) / (1000000ULL * 1000ULL));
+    }
+#endif
+    tud_audio_fb_set(fb);
+    atomic_store_explicit(&s_feedback_ppm, ppm, memory_order_relaxed);
+}
+#endif
+
 // UAC Callback Functions
 // Called when host sends audio to device (speaker output)
 // This RECEIVES audio FROM host and writes TO our PCM buffer
 static esp_err_t usb_audio_output_callback(uint8_t *buf, size_t len, void *ctx)
 {
     // Check if we're running
-    if (!g_usb_state.running || !usb_in_pcm_buffer) {
+    if (!g_usb_state.running || !usb_in_pcm_ring) {
         // Discard audio if not running
         return ESP_OK;
     }
     
-    
-    // Write the received audio data to PCM ring buffer
-    BaseType_t result = xRingbufferSend(usb_in_pcm_buffer, buf, len, 0);
-    
-    if (result == pdTRUE) {
-        g_usb_state.packets_sent++;  // Actually packets received from host
-        g_usb_state.receiving_audio = true;
-        
-        // Debug log periodically
-        static int log_count = 0;
-        if (++log_count % 1000 == 0) {
-            ESP_LOGD(TAG, "USB audio received: %zu bytes, total packets: %lu",
-                     len, g_usb_state.packets_sent);
-        }
-    } else {
-        // Buffer full, drop the data
+    // Lock-free copy into the capture ring; wakes the sender once its packet is complete.
+    // What does not fit is dropped and counted by the ring, reported by the monitoring task.
+    g_usb_state.packets_sent++;  // Actually packets received from host
+    if (pcm_ring_write(usb_in_pcm_ring, buf, len) < len) {
         g_usb_state.packets_dropped++;
-        ESP_LOGW(TAG, "PCM buffer full, dropped %zu bytes (total dropped: %lu)",
-                 len, g_usb_state.packets_dropped);
+        metrics_counter_inc(&s_dropped_metric);
     }
+    g_usb_state.receiving_audio = true;
     
     return ESP_OK;
 }
@@ -82,10 +166,36 @@ static void usb_audio_task(void *arg)
     ESP_LOGI(TAG, "USB audio monitoring task started on core %d", xPortGetCoreID());
     
     uint32_t last_packets_sent = 0;
+    uint32_t last_dropped_frames = 0;
     
+#ifdef CONFIG_USB_IN_ASYNC_FEEDBACK
+    feedback_reset();
+    uint32_t ticks = 0;
+    while (g_usb_state.running) {
+        // Steer the host every tick, check activity every second
+        vTaskDelay(pdMS_TO_TICKS(USB_FEEDBACK_TICK_MS));
+        if (g_usb_state.receiving_audio) {
+            feedback_update();
+        }
+        if (++ticks < 1000 / USB_FEEDBACK_TICK_MS) {
+            continue;
+        }
+        ticks = 0;
+#else
     while (g_usb_state.running) {
         // Check activity every second
         vTaskDelay(pdMS_TO_TICKS(1000));
+#endif
+        
+        // One line a second for overflow, however many writes it hit
+        pcm_ring_stats_t ring_stats;
+        pcm_ring_get_stats(usb_in_pcm_ring, &ring_stats);
+        if (ring_stats.dropped_frames != last_dropped_frames) {
+            ESP_LOGW(TAG, "Capture ring full: %lu frames dropped in the last second (high water %lu/%lu bytes)",
+                     (unsigned long)(ring_stats.dropped_frames - last_dropped_frames),
+                     (unsigned long)ring_stats.peak_fill, (unsigned long)ring_stats.size);
+            last_dropped_frames = ring_stats.dropped_frames;
+        }
         
         // Log statistics if there's activity
         if (g_usb_state.packets_sent != last_packets_sent) {
@@ -96,6 +206,11 @@ static void usb_audio_task(void *arg)
         } else if (g_usb_state.receiving_audio) {
             g_usb_state.receiving_audio = false;
             ESP_LOGD(TAG, "USB audio inactive");
+#ifdef CONFIG_USB_IN_ASYNC_FEEDBACK
+            // Start the next stream from the nominal rate
+            feedback_reset();
+            atomic_store_explicit(&s_feedback_ppm, 0, memory_order_relaxed);
+#endif
         }
     }
     
@@ -114,10 +229,13 @@ esp_err_t usb_in_init(void (*init_done_cb)(void))
         return ESP_OK;
     }
 
-    usb_in_pcm_buffer = xRingbufferCreate(USB_PCM_BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
-    if (!usb_in_pcm_buffer)
+    metrics_register(&s_dropped_metric.base);
+    metrics_register(&s_feedback_metric.base);
+
+    usb_in_pcm_ring = pcm_ring_create(USB_PCM_RING_FRAMES, USB_FRAME_BYTES);
+    if (!usb_in_pcm_ring)
     {
-        return ESP_FAIL;
+        return ESP_ERR_NO_MEM;
     }
     
     ESP_LOGI(TAG, "Initializing USB audio input (USB speaker device)");
@@ -135,14 +253,19 @@ esp_err_t usb_in_init(void (*init_done_cb)(void))
         .cb_ctx = NULL
     };
     
-    ret = uac_device_init(&uac_config);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize UAC device: %s", esp_err_to_name(ret));
-        goto cleanup;
+    if (s_uac_installed) {
+        // Callbacks still point here; they were ignored while stopped
+        ESP_LOGI(TAG, "UAC device still installed, reusing it");
+    } else {
+        ret = uac_device_init(&uac_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize UAC device: %s", esp_err_to_name(ret));
+            goto cleanup;
+        }
+        s_uac_installed = true;
+        ESP_LOGI(TAG, "UAC device initialized");
     }
     
-    ESP_LOGI(TAG, "UAC device initialized");
-    
     // Clear statistics
     g_usb_state.packets_sent = 0;
     g_usb_state.packets_dropped = 0;
@@ -180,14 +303,15 @@ void usb_in_deinit(void)
         usb_in_stop();
     }
     
-    // UAC component handles USB PHY cleanup internally
+    // The UAC device stays installed (see s_uac_installed); with the task stopped
+    // its output callback discards what the host sends
     
     
-    // Delete PCM buffer
-    if (usb_in_pcm_buffer) {
-        vRingbufferDelete(usb_in_pcm_buffer);
-        usb_in_pcm_buffer = NULL;
-        ESP_LOGI(TAG, "PCM buffer deleted");
+    // Delete the capture ring
+    if (usb_in_pcm_ring) {
+        pcm_ring_delete(usb_in_pcm_ring);
+        usb_in_pcm_ring = NULL;
+        ESP_LOGI(TAG, "PCM capture ring deleted");
     }
     
     // Clear initialized flag and other state
@@ -237,7 +361,11 @@ esp_err_t usb_in_start(void)
         return ESP_FAIL;
     }
     
+#ifdef CONFIG_USB_IN_ASYNC_FEEDBACK
+    ESP_LOGI(TAG, "USB input started (asynchronous, feedback within +/-%d ppm)", CONFIG_USB_IN_FEEDBACK_MAX_PPM);
+#else
     ESP_LOGI(TAG, "USB input started");
+#endif
     return ESP_OK;
 }
 
@@ -278,7 +406,12 @@ esp_err_t usb_in_stop(void)
     ESP_LOGI(TAG, "USB input stopped - Statistics:");
     ESP_LOGI(TAG, "  Packets received from host: %lu", g_usb_state.packets_sent);
     ESP_LOGI(TAG, "  Packets dropped: %lu", g_usb_state.packets_dropped);
+    pcm_ring_stats_t ring_stats;
+    pcm_ring_get_stats(usb_in_pcm_ring, &ring_stats);
+    ESP_LOGI(TAG, "  Frames dropped: %lu in %lu writes", (unsigned long)ring_stats.dropped_frames,
+             (unsigned long)ring_stats.dropped_writes);
     ESP_LOGI(TAG, "  Buffer underruns: %lu", g_usb_state.buffer_underruns);
+    atomic_store_explicit(&s_feedback_ppm, 0, memory_order_relaxed);
     
     return ESP_OK;
 }
@@ -289,6 +422,18 @@ uint32_t usb_in_get_sample_rate(void)
     return USB_SAMPLE_RATE;
 }
 
+// Whether TinyUSB owns the OTG controller
+bool usb_in_holds_controller(void)
+{
+    return s_uac_installed;
+}
+
+// Get the rate correction reported to the host
+int32_t usb_in_get_feedback_ppm(void)
+{
+    return (int32_t)atomic_load_explicit(&s_feedback_ppm, memory_order_relaxed);
+}
+
 // Check if USB is connected
 bool usb_in_is_connected(void)
 {
@@ -2,13 +2,22 @@
 #include <stdbool.h>
 #pragma once
 
+#include "sdkconfig.h"
 #include "esp_err.h"
 #include "usb/uac_host.h"
+#include <stddef.h>
 #include <stdint.h>
 
 // Define PCM chunk size for USB output
 #define USB_OUT_PCM_CHUNK_SIZE 1024
 
+// DACs driven at once behind a hub; device 0 is the first to enumerate and the one the
+// unnumbered functions below address (usb_out_is_connected() excepted: any device)
+#ifndef CONFIG_USB_OUT_MAX_DEVICES
+#define CONFIG_USB_OUT_MAX_DEVICES 1
+#endif
+#define USB_OUT_MAX_DEVICES CONFIG_USB_OUT_MAX_DEVICES
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -19,12 +28,38 @@ esp_err_t usb_out_stop(void);
 esp_err_t usb_out_deinit(void);
 uac_host_device_handle_t usb_out_get_device_handle(void);
 bool usb_out_is_connected(void);
+bool usb_out_device_is_connected(size_t dev);
 
 // Audio write functions
+// Queues data for the USB tx task and returns once it is copied. Waits for queue space
+// up to timeout, capped at CONFIG_USB_OUT_WRITE_TIMEOUT_MS; ESP_ERR_TIMEOUT drops the data.
+// Data is in the stream's format; a DAC that negotiated another sample width gets it converted.
 esp_err_t usb_out_write(const uint8_t *data, size_t size, TickType_t timeout);
+esp_err_t usb_out_write_device(size_t dev, const uint8_t *data, size_t size, TickType_t timeout);
+// Stop every DAC (or one) and drop what is queued for it
 esp_err_t usb_out_stop_playback(void);
+esp_err_t usb_out_stop_device_playback(size_t dev);
+// Switch the stream to a new sample rate: connected DACs are renegotiated and restarted at it
+// (what is queued is dropped), otherwise it applies when a DAC enumerates. Device 0's result.
+esp_err_t usb_out_set_sample_rate(uint32_t sample_rate);
+
+typedef struct {
+    size_t queued_bytes;        // Waiting in the transmit queue
+    size_t queue_size;
+    uint32_t dropped_bytes;     // Refused by usb_out_write() on a full queue
+    uint32_t failed_bytes;      // Lost to transfer errors or a disconnect
+    uint32_t tx_done_events;    // Times the driver's buffer drained below one chunk
+    uint8_t bus_bits;           // Sample width negotiated with the DAC, 0 while none is connected
+} usb_out_tx_stats_t;
+
+void usb_out_get_tx_stats(usb_out_tx_stats_t *stats);
+void usb_out_get_device_tx_stats(size_t dev, usb_out_tx_stats_t *stats);
+// Playout delay between usb_out_write() and the bus once the queue is kept full, in
+// microseconds at the configured format; 0 while no stream is configured
+uint32_t usb_out_get_latency_us(void);
+uint32_t usb_out_get_device_latency_us(size_t dev);
 
-// Volume control functions
+// Volume control functions (every connected DAC)
 esp_err_t usb_out_set_volume(float volume);
 esp_err_t usb_out_get_volume(float *volume);
 
@@ -1,10 +1,16 @@
 #include "usb_out.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "log_rate.h"
+#include "metrics.h"
+#include "audio_arena.h"
+#include "esp_heap_caps.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
 #include "usb/usb_host.h"
 #include "usb/uac_host.h"
 #include <string.h>
@@ -12,7 +18,7 @@
 #define TAG "usb_out"
 #define PCM_CHUNK_SIZE USB_OUT_PCM_CHUNK_SIZE
 
-// Global USB speaker device handle (exposed for web_server.c power management)
+// Global USB speaker device handle, the first connected DAC (exposed for web_server.c power management)
 uac_host_device_handle_t s_spk_dev_handle = NULL;
 
 #define USB_HOST_TASK_PRIORITY   CONFIG_USB_HOST_TASK_PRIO
@@ -30,6 +36,15 @@ uac_host_device_handle_t s_spk_dev_handle = NULL;
 #define USB_RECONNECT_MAX_ATTEMPTS   CONFIG_USB_RECONNECT_MAX_ATTEMPTS   // Maximum reconnection attempts
 #define USB_INIT_MAX_RETRIES         CONFIG_USB_INIT_MAX_RETRIES         // Maximum USB host initialization retries
 
+// Transmit queue: usb_out_write() only copies into tx_ring, the usb_tx task hands it to the UAC driver
+#define USB_TX_QUEUE_MS              CONFIG_USB_OUT_QUEUE_MS             // PCM held between the caller and the driver
+#define USB_TX_WRITE_TIMEOUT_MS      CONFIG_USB_OUT_WRITE_TIMEOUT_MS     // Longest usb_out_write() waits for queue space
+#define USB_TX_TASK_PRIORITY         CONFIG_USB_OUT_TX_TASK_PRIO
+#define USB_TX_TASK_STACK_SIZE       3072
+#define USB_TX_POLL_MS               10                                  // tx task re-checks for shutdown this often
+#define USB_TX_DRIVER_TIMEOUT_MS     100                                 // Wait for room in the driver's own buffer
+#define USB_UAC_BUFFER_SIZE          (PCM_CHUNK_SIZE * 4)                // The UAC driver's own transmit buffer
+
 typedef enum {
     APP_EVENT = 0,
     UAC_DRIVER_EVENT,
@@ -44,21 +59,37 @@ typedef struct {
     bool valid;
 } saved_usb_device_t;
 
+// One DAC and the transmit queue feeding it
+typedef struct {
+    uac_host_device_handle_t handle;
+    saved_usb_device_t saved_device;  // Saved device parameters for sleep/wake
+    uint8_t bus_bits;                 // Sample width negotiated with the DAC
+    uint32_t transfer_retry_count;
+    uint32_t reconnect_attempts;
+    TickType_t last_reconnect_time;
+    // Transmit queue
+    RingbufHandle_t tx_ring;
+    StaticRingbuffer_t tx_ring_struct;
+    uint8_t *tx_ring_storage;       // audio arena
+    size_t tx_ring_size;
+    TaskHandle_t tx_task_handle;
+    SemaphoreHandle_t tx_task_done;
+    uint32_t tx_dropped_bytes;      // Given up on by usb_out_write() after its timeout
+    uint32_t tx_failed_bytes;       // Lost to transfer errors after all retries
+    uint32_t tx_done_events;        // Driver buffer drained below threshold
+} usb_out_dev_t;
+
 // USB Host and UAC state management
 typedef struct {
-    uac_host_device_handle_t spk_dev_handle;
+    usb_out_dev_t dev[USB_OUT_MAX_DEVICES];   // Slot 0 is the primary, the others are filled as DACs enumerate
     QueueHandle_t event_queue;
     TaskHandle_t usb_host_task_handle;
     TaskHandle_t uac_task_handle;
     bool usb_host_running;
     bool initialized;
-    saved_usb_device_t saved_device;  // Saved device parameters for sleep/wake
     // Error handling and recovery
     uint32_t transfer_error_count;
-    uint32_t transfer_retry_count;
-    uint32_t reconnect_attempts;
     TickType_t last_error_time;
-    TickType_t last_reconnect_time;
     bool device_enumeration_complete;
     TickType_t enumeration_start_time;
     // Configuration parameters
@@ -68,18 +99,13 @@ typedef struct {
 } usb_out_state_t;
 
 static usb_out_state_t s_usb_state = {
-    .spk_dev_handle = NULL,
     .event_queue = NULL,
     .usb_host_task_handle = NULL,
     .uac_task_handle = NULL,
     .usb_host_running = false,
     .initialized = false,
-    .saved_device = { .valid = false },
     .transfer_error_count = 0,
-    .transfer_retry_count = 0,
-    .reconnect_attempts = 0,
     .last_error_time = 0,
-    .last_reconnect_time = 0,
     .device_enumeration_complete = false,
     .enumeration_start_time = 0,
     .configured_sample_rate = 48000,
@@ -87,6 +113,13 @@ static usb_out_state_t s_usb_state = {
     .configured_volume = 0.5f
 };
 
+// Staging for usb_out_write() when the DAC's sample width differs from the stream's
+static uint8_t s_convert_buf[PCM_CHUNK_SIZE];
+
+// Lifetime count behind /metrics; transfer_error_count above is per session
+static metrics_counter_t s_transfer_error_metric =
+    METRICS_COUNTER_INIT("usb_out_transfer_errors_total", "UAC transfer errors and writes failed after retries");
+
 typedef struct {
     event_group_t event_group;
     union {
@@ -105,12 +138,126 @@ typedef struct {
 } s_event_queue_t;
 
 // Forward declarations for new functions
-static esp_err_t usb_out_save_device_params(uint8_t addr, uint8_t iface_num, const uac_host_stream_config_t *stream_config);
-static esp_err_t usb_out_restore_device(void);
-static esp_err_t usb_out_handle_transfer_error(void);
-static esp_err_t usb_out_attempt_reconnection(void);
+static esp_err_t usb_out_save_device_params(usb_out_dev_t *dev, uint8_t addr, uint8_t iface_num, const uac_host_stream_config_t *stream_config);
+static esp_err_t usb_out_restore_device(usb_out_dev_t *dev);
+static esp_err_t usb_out_handle_transfer_error(usb_out_dev_t *dev);
+static esp_err_t usb_out_attempt_reconnection(usb_out_dev_t *dev);
 static bool usb_out_validate_handle(uac_host_device_handle_t handle);
-static void usb_out_reset_error_counters(void);
+static void usb_out_reset_error_counters(usb_out_dev_t *dev);
+
+// Slot holding a device handle, NULL if it is not one of ours
+static usb_out_dev_t *usb_out_find_dev(uac_host_device_handle_t handle) {
+    if (handle == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].handle == handle) {
+            return &s_usb_state.dev[i];
+        }
+    }
+    return NULL;
+}
+
+// Keep the global handle (web_server.c) on the first connected DAC
+static void usb_out_publish_handle(void) {
+    s_spk_dev_handle = NULL;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].handle != NULL) {
+            s_spk_dev_handle = s_usb_state.dev[i].handle;
+            return;
+        }
+    }
+}
+
+// ---- Format negotiation ----
+
+// Whether one alternate setting plays the rate
+static bool usb_out_alt_has_rate(const uac_host_dev_alt_param_t *alt, uint32_t rate) {
+    if (alt->sample_freq_type == 0) {
+        // Continuous range
+        return rate >= alt->sample_freq_lower && rate <= alt->sample_freq_upper;
+    }
+    uint8_t n = alt->sample_freq_type < CONFIG_UAC_FREQ_NUM_MAX ? alt->sample_freq_type : CONFIG_UAC_FREQ_NUM_MAX;
+    for (uint8_t i = 0; i < n; i++) {
+        if (alt->sample_freq[i] == rate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Exact width first, then the narrowest wider one (padding loses nothing), then the widest narrower one
+static int usb_out_bits_rank(uint8_t dac_bits, uint8_t stream_bits) {
+    if (dac_bits == stream_bits) {
+        return 100;
+    }
+    if (dac_bits > stream_bits) {
+        return 80 - dac_bits;
+    }
+    return dac_bits;
+}
+
+/*
+ * Pick the DAC's alternate setting for the stream: stereo at the stream's
+ * rate is required (the pipeline does not resample to suit the DAC), and the
+ * sample width is matched exactly when any setting has it, so the queue is
+ * written as it arrives. Otherwise the closest width is taken and
+ * usb_out_write() pads or truncates each sample on the way in.
+ */
+static esp_err_t usb_out_negotiate(uac_host_device_handle_t handle, uint32_t rate, uac_host_stream_config_t *out) {
+    uac_host_dev_info_t dev_info;
+    esp_err_t err = uac_host_get_device_info(handle, &dev_info);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    const uint8_t stream_bits = s_usb_state.configured_bit_depth;
+    int best_rank = -1;
+    for (uint8_t alt = 1; alt <= dev_info.iface_alt_num; alt++) {
+        uac_host_dev_alt_param_t param;
+        if (uac_host_get_device_alt_param(handle, alt, &param) != ESP_OK) {
+            continue;
+        }
+        bool width_ok = param.bit_resolution == 16 || param.bit_resolution == 24 || param.bit_resolution == 32;
+        bool usable = param.channels == 2 && width_ok && usb_out_alt_has_rate(&param, rate);
+        ESP_LOGD(TAG, "  alt %u: %u ch, %u bits, %s", alt, param.channels, param.bit_resolution,
+                 usable ? "usable" : "skipped");
+        if (!usable) {
+            continue;
+        }
+        int rank = usb_out_bits_rank(param.bit_resolution, stream_bits);
+        if (rank > best_rank) {
+            best_rank = rank;
+            out->channels = 2;
+            out->bit_resolution = param.bit_resolution;
+            out->sample_freq = rate;
+        }
+    }
+
+    if (best_rank < 0) {
+        ESP_LOGE(TAG, "DAC has no stereo setting at %lu Hz", (unsigned long)rate);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (out->bit_resolution != stream_bits) {
+        ESP_LOGW(TAG, "DAC has no %u-bit setting at %lu Hz, converting to %u bits",
+                 stream_bits, (unsigned long)rate, out->bit_resolution);
+    }
+    return ESP_OK;
+}
+
+// Widen or narrow little-endian samples, keeping the most significant bytes
+static void usb_out_convert(uint8_t *dst, size_t out_bytes, const uint8_t *src, size_t in_bytes, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        if (out_bytes > in_bytes) {
+            memset(dst, 0, out_bytes - in_bytes);
+            memcpy(dst + out_bytes - in_bytes, src, in_bytes);
+        } else {
+            memcpy(dst, src + in_bytes - out_bytes, out_bytes);
+        }
+        dst += out_bytes;
+        src += in_bytes;
+    }
+}
 
 static void uac_device_callback(uac_host_device_handle_t uac_device_handle, const uac_host_device_event_t event, void *arg)
 {
@@ -119,20 +266,21 @@ static void uac_device_callback(uac_host_device_handle_t uac_device_handle, cons
         ESP_LOGE(TAG, "Invalid device handle in callback");
         return;
     }
+    usb_out_dev_t *dev = usb_out_find_dev(uac_device_handle);
     
     // Handle disconnect event immediately
     if (event == UAC_HOST_DRIVER_EVENT_DISCONNECTED) {
-        ESP_LOGI(TAG, "UAC Device disconnected, attempting recovery");
+        ESP_LOGI(TAG, "UAC Device %u disconnected, attempting recovery", (unsigned)(dev - s_usb_state.dev));
         
         // Save device parameters before disconnection if we're entering sleep mode
         // Note: These will be saved properly when device is first configured
-        if (s_usb_state.saved_device.valid) {
+        if (dev->saved_device.valid) {
             ESP_LOGI(TAG, "Device parameters already saved for reconnection");
         }
         
         // Clear device handle
-        s_usb_state.spk_dev_handle = NULL;
-        s_spk_dev_handle = NULL;  // Update global handle for web_server.c
+        dev->handle = NULL;
+        usb_out_publish_handle();  // Update global handle for web_server.c
         // Note: External playback control should be handled by the caller
         
         // Close the device handle
@@ -142,17 +290,17 @@ static void uac_device_callback(uac_host_device_handle_t uac_device_handle, cons
         }
         
         // Schedule reconnection attempt
-        s_usb_state.last_reconnect_time = xTaskGetTickCount();
-        if (s_usb_state.reconnect_attempts < USB_RECONNECT_MAX_ATTEMPTS) {
+        dev->last_reconnect_time = xTaskGetTickCount();
+        if (dev->reconnect_attempts < USB_RECONNECT_MAX_ATTEMPTS) {
             ESP_LOGI(TAG, "Scheduling reconnection attempt %lu/%d in %d ms",
-                     (unsigned long)(s_usb_state.reconnect_attempts + 1),
+                     (unsigned long)(dev->reconnect_attempts + 1),
                      USB_RECONNECT_MAX_ATTEMPTS,
                      USB_RECONNECT_DELAY_MS);
                      vTaskDelay(pdMS_TO_TICKS(USB_RECONNECT_DELAY_MS));
                      
                      // Always attempt reconnection if within limits
-                     s_usb_state.reconnect_attempts++;
-                     usb_out_attempt_reconnection();
+                     dev->reconnect_attempts++;
+                     usb_out_attempt_reconnection(dev);
         } else {
             ESP_LOGW(TAG, "Maximum reconnection attempts reached (%d), giving up",
                      USB_RECONNECT_MAX_ATTEMPTS);
@@ -224,6 +372,97 @@ static void usb_lib_task(void *arg)
     vTaskDelete(NULL);
 }
 
+// Open, negotiate and start a newly enumerated speaker in a free slot; runs on the UAC task
+static void usb_out_device_connected(uint8_t addr, uint8_t iface_num) {
+    usb_out_dev_t *dev = NULL;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].handle == NULL) {
+            dev = &s_usb_state.dev[i];
+            break;
+        }
+    }
+    if (dev == NULL) {
+        ESP_LOGW(TAG, "All %d DAC slots in use, ignoring speaker at address %u", USB_OUT_MAX_DEVICES, addr);
+        return;
+    }
+
+    uac_host_dev_info_t dev_info;
+    uac_host_device_handle_t uac_device_handle = NULL;
+
+    // Configure device with proper buffer size
+    const uac_host_device_config_t dev_config = {
+        .addr = addr,
+        .iface_num = iface_num,
+        .buffer_size = USB_UAC_BUFFER_SIZE,
+        .buffer_threshold = PCM_CHUNK_SIZE,
+        .callback = uac_device_callback,
+        .callback_arg = NULL,
+    };
+
+    // Open the UAC device
+    esp_err_t err = uac_host_device_open(&dev_config, &uac_device_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open UAC device: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "UAC Speaker device opened successfully (DAC %u)", (unsigned)(dev - s_usb_state.dev));
+
+    // Get and log device information
+    err = uac_host_get_device_info(uac_device_handle, &dev_info);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "UAC Device connected: SPK");
+        ESP_LOGI(TAG, "  VID: 0x%04X, PID: 0x%04X", dev_info.VID, dev_info.PID);
+        ESP_LOGI(TAG, "  iProduct: %s", dev_info.iProduct ? (char*)dev_info.iProduct : "N/A");
+        ESP_LOGI(TAG, "  iManufacturer: %s", dev_info.iManufacturer ? (char*)dev_info.iManufacturer : "N/A");
+
+        // Print detailed device parameters
+        uac_host_printf_device_param(uac_device_handle);
+    } else {
+        ESP_LOGW(TAG, "Failed to get device info: %s", esp_err_to_name(err));
+    }
+
+    // Choose the alternate setting closest to the stream
+    uac_host_stream_config_t stm_config = {0};
+    err = usb_out_negotiate(uac_device_handle, s_usb_state.configured_sample_rate, &stm_config);
+    if (err != ESP_OK) {
+        uac_host_device_close(uac_device_handle);
+        return;
+    }
+
+    ESP_LOGI(TAG, "Starting device with SR: %lu Hz, BD: %d bits",
+             (unsigned long)stm_config.sample_freq, stm_config.bit_resolution);
+
+    // Start the device with the stream configuration
+    err = uac_host_device_start(uac_device_handle, &stm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start UAC device: %s", esp_err_to_name(err));
+        // Close the device if we couldn't start it
+        uac_host_device_close(uac_device_handle);
+        return;
+    }
+    // Save device parameters for potential reconnection after sleep
+    usb_out_save_device_params(dev, addr, iface_num, &stm_config);
+    dev->bus_bits = stm_config.bit_resolution;
+
+    // Set volume from internal configuration
+    float volume_percent = s_usb_state.configured_volume * 100.0f;
+    err = uac_host_device_set_volume(uac_device_handle, volume_percent);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Volume set to %.0f%%", volume_percent);
+    } else {
+        ESP_LOGW(TAG, "Failed to set volume: %s", esp_err_to_name(err));
+    }
+
+    // Save the device handle and start playback
+    dev->handle = uac_device_handle;
+    usb_out_publish_handle();  // Update global handle for web_server.c
+    s_usb_state.device_enumeration_complete = true;
+    dev->reconnect_attempts = 0;  // Reset reconnection counter on success
+    usb_out_reset_error_counters(dev);
+    ESP_LOGI(TAG, "USB audio device ready for playback");
+    // Note: External playback control should be handled by the caller
+}
+
 static void uac_lib_task(void *arg)
 {
     // Wait for USB host to be ready
@@ -246,91 +485,12 @@ static void uac_lib_task(void *arg)
         if (xQueueReceive(s_usb_state.event_queue, &evt_queue, portMAX_DELAY)) {
             if (UAC_DRIVER_EVENT == evt_queue.event_group) {
                 uac_host_driver_event_t event = evt_queue.driver_evt.event;
-                uint8_t addr = evt_queue.driver_evt.addr;
-                uint8_t iface_num = evt_queue.driver_evt.iface_num;
                 
                 switch (event) {
-                    case UAC_HOST_DRIVER_EVENT_TX_CONNECTED: {
+                    case UAC_HOST_DRIVER_EVENT_TX_CONNECTED:
                         // Audio output device connected
-                        if (s_usb_state.spk_dev_handle == NULL) {
-                            uac_host_dev_info_t dev_info;
-                            uac_host_device_handle_t uac_device_handle = NULL;
-                            
-                            // Configure device with proper buffer size
-                            const uac_host_device_config_t dev_config = {
-                                .addr = addr,
-                                .iface_num = iface_num,
-                                .buffer_size = PCM_CHUNK_SIZE * 4,
-                                .buffer_threshold = 0,
-                                .callback = uac_device_callback,
-                                .callback_arg = NULL,
-                            };
-                            
-                            // Open the UAC device
-                            esp_err_t err = uac_host_device_open(&dev_config, &uac_device_handle);
-                            if (err == ESP_OK) {
-                                ESP_LOGI(TAG, "UAC Speaker device opened successfully");
-                                
-                                // Get and log device information
-                                err = uac_host_get_device_info(uac_device_handle, &dev_info);
-                                if (err == ESP_OK) {
-                                    ESP_LOGI(TAG, "UAC Device connected: SPK");
-                                    ESP_LOGI(TAG, "  VID: 0x%04X, PID: 0x%04X", dev_info.VID, dev_info.PID);
-                                    ESP_LOGI(TAG, "  iProduct: %s", dev_info.iProduct ? (char*)dev_info.iProduct : "N/A");
-                                    ESP_LOGI(TAG, "  iManufacturer: %s", dev_info.iManufacturer ? (char*)dev_info.iManufacturer : "N/A");
-                                    
-                                    // Print detailed device parameters
-                                    uac_host_printf_device_param(uac_device_handle);
-                                } else {
-                                    ESP_LOGW(TAG, "Failed to get device info: %s", esp_err_to_name(err));
-                                }
-                                
-                                // Configure the audio stream using internal configuration
-                                uac_host_stream_config_t stm_config = {
-                                    .channels = 2,
-                                    .bit_resolution = s_usb_state.configured_bit_depth,
-                                    .sample_freq = s_usb_state.configured_sample_rate,
-                                };
-                                
-                                ESP_LOGI(TAG, "Starting device with SR: %lu Hz, BD: %d bits",
-                                         (unsigned long)s_usb_state.configured_sample_rate, s_usb_state.configured_bit_depth);
-                                
-                                // Start the device with the stream configuration
-                                err = uac_host_device_start(uac_device_handle, &stm_config);
-                                if (err == ESP_OK) {
-                                    // Save device parameters for potential reconnection after sleep
-                                    usb_out_save_device_params(addr, iface_num, &stm_config);
-                                    
-                                    // Set volume from internal configuration
-                                    float volume_percent = s_usb_state.configured_volume * 100.0f;
-                                    err = uac_host_device_set_volume(uac_device_handle, volume_percent);
-                                    if (err == ESP_OK) {
-                                        ESP_LOGI(TAG, "Volume set to %.0f%%", volume_percent);
-                                    } else {
-                                        ESP_LOGW(TAG, "Failed to set volume: %s", esp_err_to_name(err));
-                                    }
-                                    
-                                    // Save the device handle and start playback
-                                    s_usb_state.spk_dev_handle = uac_device_handle;
-                                    s_spk_dev_handle = uac_device_handle;  // Update global handle for web_server.c
-                                    s_usb_state.device_enumeration_complete = true;
-                                    s_usb_state.reconnect_attempts = 0;  // Reset reconnection counter on success
-                                    usb_out_reset_error_counters();
-                                    ESP_LOGI(TAG, "USB audio device ready for playback");
-                                    // Note: External playback control should be handled by the caller
-                                } else {
-                                    ESP_LOGE(TAG, "Failed to start UAC device: %s", esp_err_to_name(err));
-                                    // Close the device if we couldn't start it
-                                    uac_host_device_close(uac_device_handle);
-                                }
-                            } else {
-                                ESP_LOGE(TAG, "Failed to open UAC device: %s", esp_err_to_name(err));
-                            }
-                        } else {
-                            ESP_LOGW(TAG, "Speaker device already connected");
-                        }
+                        usb_out_device_connected(evt_queue.driver_evt.addr, evt_queue.driver_evt.iface_num);
                         break;
-                    }
                     
                     case UAC_HOST_DRIVER_EVENT_RX_CONNECTED:
                         // Microphone connected (not supported in this implementation)
@@ -344,18 +504,20 @@ static void uac_lib_task(void *arg)
             } else if (UAC_DEVICE_EVENT == evt_queue.event_group) {
                 // Handle device-specific events
                 uac_host_device_event_t event = evt_queue.device_evt.event;
-                uac_host_device_handle_t device_handle = evt_queue.device_evt.handle;
+                usb_out_dev_t *dev = usb_out_find_dev(evt_queue.device_evt.handle);
+                if (dev == NULL) {
+                    // Closed since the event was queued
+                    continue;
+                }
                 
                 switch (event) {
                     case UAC_HOST_DRIVER_EVENT_DISCONNECTED:
                         ESP_LOGI(TAG, "UAC Device disconnected (from device event)");
                         // Clean up device handle properly
-                        if (device_handle == s_usb_state.spk_dev_handle) {
-                            s_usb_state.spk_dev_handle = NULL;
-                            s_spk_dev_handle = NULL;  // Update global handle for web_server.c
-                            // Device parameters remain saved for potential reconnection
-                            ESP_LOGI(TAG, "Device handle cleaned up, parameters saved for reconnection");
-                        }
+                        dev->handle = NULL;
+                        usb_out_publish_handle();  // Update global handle for web_server.c
+                        // Device parameters remain saved for potential reconnection
+                        ESP_LOGI(TAG, "Device handle cleaned up, parameters saved for reconnection");
                         break;
                         
                     case UAC_HOST_DEVICE_EVENT_RX_DONE:
@@ -363,25 +525,29 @@ static void uac_lib_task(void *arg)
                         break;
                         
                     case UAC_HOST_DEVICE_EVENT_TX_DONE:
-                        // Audio data sent successfully
-                        ESP_LOGD(TAG, "Audio TX completed");
+                        // Driver buffer below threshold: wake the tx task if it is waiting for room
+                        dev->tx_done_events++;
+                        if (dev->tx_task_handle) {
+                            xTaskNotifyGive(dev->tx_task_handle);
+                        }
                         break;
                         
                     case UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR:
                         ESP_LOGW(TAG, "UAC Transfer error occurred (count: %lu)",
                                 (unsigned long)++s_usb_state.transfer_error_count);
+                        metrics_counter_inc(&s_transfer_error_metric);
                         s_usb_state.last_error_time = xTaskGetTickCount();
                         
                         // Attempt recovery with exponential backoff
-                        esp_err_t recovery_result = usb_out_handle_transfer_error();
+                        esp_err_t recovery_result = usb_out_handle_transfer_error(dev);
                         if (recovery_result != ESP_OK) {
                             ESP_LOGE(TAG, "Transfer error recovery failed after %lu attempts",
-                                    (unsigned long)s_usb_state.transfer_retry_count);
+                                    (unsigned long)dev->transfer_retry_count);
                             
                             // If recovery fails, try device reconnection
-                            if (s_usb_state.reconnect_attempts < USB_RECONNECT_MAX_ATTEMPTS) {
+                            if (dev->reconnect_attempts < USB_RECONNECT_MAX_ATTEMPTS) {
                                 ESP_LOGI(TAG, "Attempting device reconnection");
-                                usb_out_attempt_reconnection();
+                                usb_out_attempt_reconnection(dev);
                             }
                         }
                         break;
@@ -398,18 +564,171 @@ static void uac_lib_task(void *arg)
     }
 
     // Cleanup: Close any open devices
-    if (s_usb_state.spk_dev_handle != NULL) {
-        ESP_LOGI(TAG, "Closing speaker device");
-        uac_host_device_close(s_usb_state.spk_dev_handle);
-        s_usb_state.spk_dev_handle = NULL;
-        s_spk_dev_handle = NULL;  // Update global handle for web_server.c
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].handle != NULL) {
+            ESP_LOGI(TAG, "Closing speaker device %u", (unsigned)i);
+            uac_host_device_close(s_usb_state.dev[i].handle);
+            s_usb_state.dev[i].handle = NULL;
+        }
     }
+    usb_out_publish_handle();  // Update global handle for web_server.c
     
     ESP_LOGI(TAG, "Uninstalling UAC driver");
     ESP_ERROR_CHECK(uac_host_uninstall());
     vTaskDelete(NULL);
 }
 
+// Hand one piece to the driver, retrying with backoff; runs on the device's tx task only
+static void usb_out_tx_submit(usb_out_dev_t *dev, uint8_t *data, size_t size) {
+    int retry_count = 0;
+    uint32_t retry_delay = USB_TRANSFER_RETRY_DELAY_MS;
+
+    while (s_usb_state.usb_host_running) {
+        uac_host_device_handle_t handle = dev->handle;
+        if (handle == NULL) {
+            // Device went away with data queued; nothing will play it
+            dev->tx_failed_bytes += size;
+            return;
+        }
+
+        esp_err_t err = uac_host_device_write(handle, data, size, pdMS_TO_TICKS(USB_TX_DRIVER_TIMEOUT_MS));
+        if (err == ESP_OK) {
+            if (retry_count > 0) {
+                ESP_LOGI(TAG, "USB write succeeded after %d retries", retry_count);
+                dev->transfer_retry_count = 0;  // Reset retry counter on success
+            }
+            return;
+        }
+        if (err == ESP_ERR_TIMEOUT) {
+            // Driver buffer still full; TX_DONE wakes us as soon as it drains
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(USB_TX_POLL_MS));
+            continue;
+        }
+
+        LOG_RATE_W(TAG, "USB audio write failed (attempt %d/%d): %s",
+                   retry_count + 1, USB_TRANSFER_RETRY_COUNT + 1, esp_err_to_name(err));
+        if (retry_count >= USB_TRANSFER_RETRY_COUNT) {
+            LOG_RATE_E(TAG, "USB write failed after all retries");
+            s_usb_state.transfer_error_count++;
+            metrics_counter_inc(&s_transfer_error_metric);
+            dev->tx_failed_bytes += size;
+            return;
+        }
+        // Backoff happens here, on the tx task; usb_out_write() keeps queueing meanwhile
+        vTaskDelay(pdMS_TO_TICKS(retry_delay));
+        retry_delay *= 2;
+        retry_count++;
+        dev->transfer_retry_count++;
+    }
+}
+
+static void usb_tx_task(void *arg) {
+    usb_out_dev_t *dev = (usb_out_dev_t *)arg;
+
+    while (s_usb_state.usb_host_running) {
+        size_t n = 0;
+        uint8_t *item = xRingbufferReceiveUpTo(dev->tx_ring, &n, pdMS_TO_TICKS(USB_TX_POLL_MS),
+                                               PCM_CHUNK_SIZE);
+        if (item == NULL) {
+            continue;
+        }
+        usb_out_tx_submit(dev, item, n);
+        vRingbufferReturnItem(dev->tx_ring, item);
+    }
+
+    xSemaphoreGive(dev->tx_task_done);
+    vTaskDelete(NULL);
+}
+
+// Release one device's queue; its tx task must have exited (or never started)
+static void usb_out_tx_free(usb_out_dev_t *dev) {
+    if (dev->tx_ring) {
+        vRingbufferDelete(dev->tx_ring);
+        dev->tx_ring = NULL;
+    }
+    audio_arena_free(dev->tx_ring_storage);
+    dev->tx_ring_storage = NULL;
+    if (dev->tx_task_done) {
+        vSemaphoreDelete(dev->tx_task_done);
+        dev->tx_task_done = NULL;
+    }
+}
+
+// Call after usb_host_running has been cleared
+static void usb_out_tx_stop(void) {
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        usb_out_dev_t *dev = &s_usb_state.dev[i];
+        if (dev->tx_task_handle) {
+            if (xSemaphoreTake(dev->tx_task_done, pdMS_TO_TICKS(USB_TX_DRIVER_TIMEOUT_MS * 4)) != pdTRUE) {
+                // Still inside the driver; leaking the queue beats freeing it under the task
+                ESP_LOGE(TAG, "USB tx task %u did not exit", (unsigned)i);
+                continue;
+            }
+            dev->tx_task_handle = NULL;
+        }
+        usb_out_tx_free(dev);
+    }
+}
+
+static esp_err_t usb_out_tx_start(void) {
+    // Sized for the configured stream, at least four driver chunks
+    size_t frame_bytes = 2u * ((s_usb_state.configured_bit_depth + 7u) / 8u);
+    size_t size = (size_t)s_usb_state.configured_sample_rate * frame_bytes * USB_TX_QUEUE_MS / 1000u;
+    if (size < PCM_CHUNK_SIZE * 4) {
+        size = PCM_CHUNK_SIZE * 4;
+    }
+    size = (size + 3u) & ~(size_t)3u;
+
+    // One queue and tx task per DAC slot, so a stalled DAC never holds up another
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        usb_out_dev_t *dev = &s_usb_state.dev[i];
+        dev->tx_ring_storage = audio_arena_alloc(AUDIO_ARENA_OUTPUT, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (dev->tx_ring_storage) {
+            dev->tx_ring = xRingbufferCreateStatic(size, RINGBUF_TYPE_BYTEBUF, dev->tx_ring_storage,
+                                                   &dev->tx_ring_struct);
+        }
+        dev->tx_task_done = xSemaphoreCreateBinary();
+        if (dev->tx_ring == NULL || dev->tx_task_done == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate %u byte USB transmit queue", (unsigned)size);
+            goto fail;
+        }
+        dev->tx_ring_size = size;
+        dev->tx_dropped_bytes = 0;
+        dev->tx_failed_bytes = 0;
+        dev->tx_done_events = 0;
+
+        if (xTaskCreatePinnedToCore(usb_tx_task, "usb_tx", USB_TX_TASK_STACK_SIZE, dev,
+                                    USB_TX_TASK_PRIORITY, &dev->tx_task_handle, 0) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create USB tx task");
+            dev->tx_task_handle = NULL;
+            goto fail;
+        }
+    }
+    ESP_LOGI(TAG, "USB transmit queue: %u bytes x %d", (unsigned)size, USB_OUT_MAX_DEVICES);
+    return ESP_OK;
+
+fail:
+    // Tasks already running see usb_host_running cleared by the caller and exit
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].tx_task_handle == NULL) {
+            usb_out_tx_free(&s_usb_state.dev[i]);
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+// Drop everything queued but not yet handed to the driver
+static void usb_out_tx_flush(usb_out_dev_t *dev) {
+    if (dev->tx_ring == NULL) {
+        return;
+    }
+    size_t n;
+    void *item;
+    while ((item = xRingbufferReceiveUpTo(dev->tx_ring, &n, 0, dev->tx_ring_size)) != NULL) {
+        vRingbufferReturnItem(dev->tx_ring, item);
+    }
+}
+
 esp_err_t usb_out_init(void) {
     if (s_usb_state.initialized) {
         ESP_LOGW(TAG, "USB output already initialized");
@@ -417,6 +736,7 @@ esp_err_t usb_out_init(void) {
     }
     
     ESP_LOGI(TAG, "Initializing USB output subsystem");
+    metrics_register(&s_transfer_error_metric.base);
     
     // Create event queue for USB/UAC events
     s_usb_state.event_queue = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(s_event_queue_t));
@@ -426,7 +746,7 @@ esp_err_t usb_out_init(void) {
     }
     
     // Initialize state
-    s_usb_state.spk_dev_handle = NULL;
+    memset(s_usb_state.dev, 0, sizeof(s_usb_state.dev));
     s_spk_dev_handle = NULL;  // Initialize global handle for web_server.c
     s_usb_state.usb_host_task_handle = NULL;
     s_usb_state.uac_task_handle = NULL;
@@ -434,7 +754,8 @@ esp_err_t usb_out_init(void) {
     s_usb_state.initialized = true;
     s_usb_state.device_enumeration_complete = false;
     s_usb_state.enumeration_start_time = 0;
-    usb_out_reset_error_counters();
+    s_usb_state.transfer_error_count = 0;
+    s_usb_state.last_error_time = 0;
     
     // Wait for device enumeration with timeout
     ESP_LOGI(TAG, "Waiting for USB device enumeration (timeout: %d ms)", USB_ENUMERATION_TIMEOUT_MS);
@@ -520,6 +841,15 @@ esp_err_t usb_out_start(uint32_t sample_rate, uint8_t bit_depth, float initial_v
             continue;
         }
         
+        err = usb_out_tx_start();
+        if (err != ESP_OK) {
+            // Host tasks are up; without the queue nothing can play, so stop them again
+            s_usb_state.usb_host_running = false;
+            s_event_queue_t evt_queue = { .event_group = APP_EVENT };
+            xQueueSend(s_usb_state.event_queue, &evt_queue, 0);
+            return err;
+        }
+
         // Success
         ESP_LOGI(TAG, "USB output started successfully");
         return ESP_OK;
@@ -564,6 +894,7 @@ esp_err_t usb_out_stop(void) {
     
     // Wait for tasks to complete (with timeout)
     vTaskDelay(pdMS_TO_TICKS(100));
+    usb_out_tx_stop();
     
     // Tasks should delete themselves, but we'll clear the handles
     s_usb_state.usb_host_task_handle = NULL;
@@ -574,11 +905,15 @@ esp_err_t usb_out_stop(void) {
 }
 
 uac_host_device_handle_t usb_out_get_device_handle(void) {
-    return s_usb_state.spk_dev_handle;
+    return s_usb_state.dev[0].handle;
 }
 
 bool usb_out_is_connected(void) {
-    return s_usb_state.spk_dev_handle != NULL;
+    return s_spk_dev_handle != NULL;
+}
+
+bool usb_out_device_is_connected(size_t dev) {
+    return dev < USB_OUT_MAX_DEVICES && s_usb_state.dev[dev].handle != NULL;
 }
 
 esp_err_t usb_out_deinit(void) {
@@ -606,7 +941,7 @@ esp_err_t usb_out_deinit(void) {
 }
 
 esp_err_t usb_out_set_volume(float volume) {
-    if (s_usb_state.spk_dev_handle == NULL) {
+    if (!usb_out_is_connected()) {
         ESP_LOGW(TAG, "Cannot set volume - no device connected");
         return ESP_ERR_INVALID_STATE;
     }
@@ -618,13 +953,22 @@ esp_err_t usb_out_set_volume(float volume) {
     // UAC expects volume in percentage * 100 (0-10000)
     float volume_percent = volume * 100.0f;
     
-    esp_err_t err = uac_host_device_set_volume(s_usb_state.spk_dev_handle, volume_percent);
+    // Every DAC follows the one volume
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].handle == NULL) {
+            continue;
+        }
+        esp_err_t dev_err = uac_host_device_set_volume(s_usb_state.dev[i].handle, volume_percent);
+        if (dev_err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set volume on DAC %u: %s", (unsigned)i, esp_err_to_name(dev_err));
+            err = dev_err;
+        }
+    }
     if (err == ESP_OK) {
         // Update internal configuration
         s_usb_state.configured_volume = volume / 100.0f;
         ESP_LOGI(TAG, "Volume set to %.1f%%", volume);
-    } else {
-        ESP_LOGE(TAG, "Failed to set volume: %s", esp_err_to_name(err));
     }
     
     return err;
@@ -635,7 +979,7 @@ esp_err_t usb_out_get_volume(float *volume) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (s_usb_state.spk_dev_handle == NULL) {
+    if (!usb_out_is_connected()) {
         ESP_LOGW(TAG, "Cannot get volume - no device connected");
         return ESP_ERR_INVALID_STATE;
     }
@@ -648,10 +992,10 @@ esp_err_t usb_out_get_volume(float *volume) {
     return ESP_OK;
 }
 
-esp_err_t usb_out_write(const uint8_t *data, size_t size, TickType_t timeout) {
+esp_err_t usb_out_write_device(size_t idx, const uint8_t *data, size_t size, TickType_t timeout) {
     // Input validation
-    if (data == NULL || size == 0) {
-        ESP_LOGE(TAG, "Invalid write parameters: data=%p, size=%u", data, (unsigned)size);
+    if (data == NULL || size == 0 || idx >= USB_OUT_MAX_DEVICES) {
+        LOG_RATE_E(TAG, "Invalid write parameters: data=%p, size=%u", data, (unsigned)size);
         return ESP_ERR_INVALID_ARG;
     }
     
@@ -662,60 +1006,110 @@ esp_err_t usb_out_write(const uint8_t *data, size_t size, TickType_t timeout) {
         return ESP_ERR_INVALID_SIZE;
     }
     
+    usb_out_dev_t *dev = &s_usb_state.dev[idx];
     // Validate device handle
-    if (!usb_out_validate_handle(s_usb_state.spk_dev_handle)) {
+    if (!usb_out_validate_handle(dev->handle)) {
         ESP_LOGD(TAG, "Cannot write audio - no device connected");
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Write audio data to the USB device with retry logic
-    esp_err_t err = ESP_FAIL;
-    int retry_count = 0;
-    uint32_t retry_delay = USB_TRANSFER_RETRY_DELAY_MS;
-    
-    while (retry_count <= USB_TRANSFER_RETRY_COUNT) {
-        // Cast away const qualifier (UAC API limitation)
-        err = uac_host_device_write(s_usb_state.spk_dev_handle, (uint8_t *)data, size, timeout);
-        
-        if (err == ESP_OK || err == ESP_ERR_TIMEOUT) {
-            // Success or timeout (not a critical error)
-            if (retry_count > 0) {
-                ESP_LOGI(TAG, "USB write succeeded after %d retries", retry_count);
-                s_usb_state.transfer_retry_count = 0;  // Reset retry counter on success
-            }
-            break;
+    if (dev->tx_ring == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Queue for the tx task; the caller only ever waits for queue space, never on the bus
+    TickType_t wait = pdMS_TO_TICKS(USB_TX_WRITE_TIMEOUT_MS);
+    if (timeout < wait) {
+        wait = timeout;
+    }
+    const size_t in_bytes = s_usb_state.configured_bit_depth / 8u;
+    const size_t out_bytes = dev->bus_bits / 8u;
+    const bool convert = out_bytes != in_bytes && out_bytes > 0;
+    size_t max_piece = (dev->tx_ring_size / 2) & ~(size_t)3u;
+    if (convert) {
+        // Whole frames that fit the staging buffer once converted
+        size_t out_frames = sizeof(s_convert_buf) / (2u * out_bytes);
+        max_piece = out_frames * 2u * in_bytes;
+    }
+    while (size > 0) {
+        size_t piece = size < max_piece ? size : max_piece;
+        const uint8_t *queued = data;
+        size_t queued_len = piece;
+        if (convert) {
+            size_t samples = piece / in_bytes;
+            usb_out_convert(s_convert_buf, out_bytes, data, in_bytes, samples);
+            queued = s_convert_buf;
+            queued_len = samples * out_bytes;
         }
-        
-        // Transfer failed
-        ESP_LOGW(TAG, "USB audio write failed (attempt %d/%d): %s",
-                retry_count + 1, USB_TRANSFER_RETRY_COUNT + 1, esp_err_to_name(err));
-        
-        if (retry_count < USB_TRANSFER_RETRY_COUNT) {
-            // Apply exponential backoff
-            vTaskDelay(pdMS_TO_TICKS(retry_delay));
-            retry_delay *= 2;  // Double the delay for next retry
-            retry_count++;
-            s_usb_state.transfer_retry_count++;
-        } else {
-            // All retries exhausted
-            ESP_LOGE(TAG, "USB write failed after all retries");
-            s_usb_state.transfer_error_count++;
-            break;
+        if (xRingbufferSend(dev->tx_ring, queued, queued_len, wait) != pdTRUE) {
+            dev->tx_dropped_bytes += size;
+            LOG_RATE_W(TAG, "USB transmit queue full, dropped %u bytes", (unsigned)size);
+            return ESP_ERR_TIMEOUT;
         }
+        data += piece;
+        size -= piece;
     }
-    
-    return err;
+
+    return ESP_OK;
 }
 
-esp_err_t usb_out_stop_playback(void) {
-    if (s_usb_state.spk_dev_handle == NULL) {
-        ESP_LOGW(TAG, "Cannot stop playback - no device connected");
+esp_err_t usb_out_write(const uint8_t *data, size_t size, TickType_t timeout) {
+    return usb_out_write_device(0, data, size, timeout);
+}
+
+void usb_out_get_device_tx_stats(size_t idx, usb_out_tx_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (idx >= USB_OUT_MAX_DEVICES) {
+        return;
+    }
+    const usb_out_dev_t *dev = &s_usb_state.dev[idx];
+    stats->queued_bytes = dev->tx_ring ?
+        dev->tx_ring_size - xRingbufferGetCurFreeSize(dev->tx_ring) : 0;
+    stats->queue_size = dev->tx_ring_size;
+    stats->dropped_bytes = dev->tx_dropped_bytes;
+    stats->failed_bytes = dev->tx_failed_bytes;
+    stats->tx_done_events = dev->tx_done_events;
+    stats->bus_bits = dev->handle ? dev->bus_bits : 0;
+}
+
+void usb_out_get_tx_stats(usb_out_tx_stats_t *stats) {
+    usb_out_get_device_tx_stats(0, stats);
+}
+
+uint32_t usb_out_get_device_latency_us(size_t idx) {
+    if (idx >= USB_OUT_MAX_DEVICES) {
+        return 0;
+    }
+    const usb_out_dev_t *dev = &s_usb_state.dev[idx];
+    // The queue holds the DAC's width, which is the stream's until one negotiates otherwise
+    uint8_t bits = (dev->handle && dev->bus_bits) ? dev->bus_bits : s_usb_state.configured_bit_depth;
+    size_t frame_bytes = 2u * ((bits + 7u) / 8u);
+    uint64_t bytes_per_sec = (uint64_t)s_usb_state.configured_sample_rate * frame_bytes;
+    if (dev->tx_ring == NULL || bytes_per_sec == 0) {
+        return 0;
+    }
+    // Full transmit queue plus the driver buffer; the device's own FIFO is not visible
+    return (uint32_t)((uint64_t)(dev->tx_ring_size + USB_UAC_BUFFER_SIZE) * 1000000u / bytes_per_sec);
+}
+
+uint32_t usb_out_get_latency_us(void) {
+    return usb_out_get_device_latency_us(0);
+}
+
+esp_err_t usb_out_stop_device_playback(size_t idx) {
+    if (idx >= USB_OUT_MAX_DEVICES || s_usb_state.dev[idx].handle == NULL) {
+        ESP_LOGD(TAG, "Cannot stop playback - no device connected");
         return ESP_OK; // Not an error if already stopped
     }
+    usb_out_dev_t *dev = &s_usb_state.dev[idx];
     
-    ESP_LOGI(TAG, "Stopping USB playback");
+    ESP_LOGI(TAG, "Stopping USB playback on DAC %u", (unsigned)idx);
+    usb_out_tx_flush(dev);
     
-    esp_err_t err = uac_host_device_stop(s_usb_state.spk_dev_handle);
+    esp_err_t err = uac_host_device_stop(dev->handle);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "Failed to stop USB device: %s", esp_err_to_name(err));
     }
@@ -723,8 +1117,70 @@ esp_err_t usb_out_stop_playback(void) {
     return err;
 }
 
+esp_err_t usb_out_stop_playback(void) {
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        esp_err_t err = usb_out_stop_device_playback(i);
+        if (err != ESP_OK) {
+            ret = err;
+        }
+    }
+    return ret;
+}
+
+// Restart one DAC at the configured rate, renegotiating its setting
+static esp_err_t usb_out_restart_device(usb_out_dev_t *dev) {
+    uac_host_stream_config_t stm_config = {0};
+    esp_err_t err = usb_out_negotiate(dev->handle, s_usb_state.configured_sample_rate, &stm_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGI(TAG, "Restarting USB stream at %lu Hz, %u bits",
+             (unsigned long)stm_config.sample_freq, stm_config.bit_resolution);
+    usb_out_tx_flush(dev);
+    err = uac_host_device_stop(dev->handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to stop USB device: %s", esp_err_to_name(err));
+    }
+    err = uac_host_device_start(dev->handle, &stm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "DAC refused %lu Hz: %s", (unsigned long)stm_config.sample_freq, esp_err_to_name(err));
+        return err;
+    }
+    dev->saved_device.stream_config = stm_config;
+    dev->bus_bits = stm_config.bit_resolution;
+    uac_host_device_set_volume(dev->handle, s_usb_state.configured_volume * 100.0f);
+    return ESP_OK;
+}
+
+esp_err_t usb_out_set_sample_rate(uint32_t sample_rate) {
+    if (sample_rate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sample_rate == s_usb_state.configured_sample_rate) {
+        return ESP_OK;
+    }
+    s_usb_state.configured_sample_rate = sample_rate;
+
+    // Device 0 paces playout, so its result is the one reported
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        usb_out_dev_t *dev = &s_usb_state.dev[i];
+        if (dev->handle == NULL) {
+            // Enumeration and wake restore start the stream at the new rate
+            dev->saved_device.stream_config.sample_freq = sample_rate;
+            continue;
+        }
+        esp_err_t err = usb_out_restart_device(dev);
+        if (err != ESP_OK && i == 0) {
+            ret = err;
+        }
+    }
+    return ret;
+}
+
 // Save device parameters for reconnection after sleep
-static esp_err_t usb_out_save_device_params(uint8_t addr, uint8_t iface_num, const uac_host_stream_config_t *stream_config) {
+static esp_err_t usb_out_save_device_params(usb_out_dev_t *dev, uint8_t addr, uint8_t iface_num, const uac_host_stream_config_t *stream_config) {
     if (stream_config == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
@@ -735,40 +1191,40 @@ static esp_err_t usb_out_save_device_params(uint8_t addr, uint8_t iface_num, con
              stream_config->bit_resolution,
              stream_config->channels);
     
-    s_usb_state.saved_device.addr = addr;
-    s_usb_state.saved_device.iface_num = iface_num;
-    memcpy(&s_usb_state.saved_device.stream_config, stream_config, sizeof(uac_host_stream_config_t));
-    s_usb_state.saved_device.valid = true;
+    dev->saved_device.addr = addr;
+    dev->saved_device.iface_num = iface_num;
+    memcpy(&dev->saved_device.stream_config, stream_config, sizeof(uac_host_stream_config_t));
+    dev->saved_device.valid = true;
     
     return ESP_OK;
 }
 
 // Restore device using saved parameters (for fast reconnection after sleep)
-static esp_err_t usb_out_restore_device(void) {
-    if (!s_usb_state.saved_device.valid) {
+static esp_err_t usb_out_restore_device(usb_out_dev_t *dev) {
+    if (!dev->saved_device.valid) {
         ESP_LOGW(TAG, "No saved device parameters available");
         return ESP_ERR_INVALID_STATE;
     }
     
-    if (s_usb_state.spk_dev_handle != NULL) {
+    if (dev->handle != NULL) {
         ESP_LOGW(TAG, "Device already connected, cannot restore");
         return ESP_ERR_INVALID_STATE;
     }
     
     ESP_LOGI(TAG, "Attempting to restore USB device with saved parameters");
     ESP_LOGI(TAG, "  addr=%d, iface=%d, SR=%lu, BD=%d, CH=%d",
-             s_usb_state.saved_device.addr,
-             s_usb_state.saved_device.iface_num,
-             (unsigned long)s_usb_state.saved_device.stream_config.sample_freq,
-             s_usb_state.saved_device.stream_config.bit_resolution,
-             s_usb_state.saved_device.stream_config.channels);
+             dev->saved_device.addr,
+             dev->saved_device.iface_num,
+             (unsigned long)dev->saved_device.stream_config.sample_freq,
+             dev->saved_device.stream_config.bit_resolution,
+             dev->saved_device.stream_config.channels);
     
     // Configure device with saved parameters
     const uac_host_device_config_t dev_config = {
-        .addr = s_usb_state.saved_device.addr,
-        .iface_num = s_usb_state.saved_device.iface_num,
-        .buffer_size = PCM_CHUNK_SIZE * 4,
-        .buffer_threshold = 0,
+        .addr = dev->saved_device.addr,
+        .iface_num = dev->saved_device.iface_num,
+        .buffer_size = USB_UAC_BUFFER_SIZE,
+        .buffer_threshold = PCM_CHUNK_SIZE,
         .callback = uac_device_callback,
         .callback_arg = NULL,
     };
@@ -781,7 +1237,7 @@ static esp_err_t usb_out_restore_device(void) {
     }
     
     // Start the device with saved stream configuration
-    err = uac_host_device_start(uac_device_handle, &s_usb_state.saved_device.stream_config);
+    err = uac_host_device_start(uac_device_handle, &dev->saved_device.stream_config);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start device with saved parameters: %s", esp_err_to_name(err));
         uac_host_device_close(uac_device_handle);
@@ -793,8 +1249,9 @@ static esp_err_t usb_out_restore_device(void) {
     uac_host_device_set_volume(uac_device_handle, volume_percent);
     
     // Save the device handle and start playback
-    s_usb_state.spk_dev_handle = uac_device_handle;
-    s_spk_dev_handle = uac_device_handle;  // Update global handle for web_server.c
+    dev->handle = uac_device_handle;
+    dev->bus_bits = dev->saved_device.stream_config.bit_resolution;
+    usb_out_publish_handle();  // Update global handle for web_server.c
     ESP_LOGI(TAG, "USB device restored successfully");
     // Note: External playback control should be handled by the caller
     
@@ -803,7 +1260,7 @@ static esp_err_t usb_out_restore_device(void) {
 
 // Public function to prepare device for sleep mode
 esp_err_t usb_out_prepare_for_sleep(void) {
-    if (s_usb_state.spk_dev_handle == NULL) {
+    if (!usb_out_is_connected()) {
         ESP_LOGW(TAG, "No device to prepare for sleep");
         return ESP_OK;
     }
@@ -811,123 +1268,141 @@ esp_err_t usb_out_prepare_for_sleep(void) {
     ESP_LOGI(TAG, "Preparing USB device for sleep mode");
     // Note: External playback control should be handled by the caller
     
-    // Stop the device but keep it open
-    esp_err_t err = uac_host_device_stop(s_usb_state.spk_dev_handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to stop device for sleep: %s", esp_err_to_name(err));
+    // Stop the devices but keep them open
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        if (s_usb_state.dev[i].handle == NULL) {
+            continue;
+        }
+        esp_err_t err = uac_host_device_stop(s_usb_state.dev[i].handle);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to stop device for sleep: %s", esp_err_to_name(err));
+            ret = err;
+        }
     }
     
-    return err;
+    return ret;
 }
 
 // Public function to restore device after wake from sleep
 esp_err_t usb_out_restore_after_wake(void) {
-    if (s_usb_state.spk_dev_handle == NULL) {
-        // Try to restore using saved parameters
-        return usb_out_restore_device();
-    }
-    
-    if (!s_usb_state.saved_device.valid) {
-        ESP_LOGW(TAG, "No saved device parameters to restore");
-        return ESP_ERR_INVALID_STATE;
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+        usb_out_dev_t *dev = &s_usb_state.dev[i];
+        esp_err_t err;
+        if (dev->handle == NULL) {
+            if (!dev->saved_device.valid) {
+                continue;
+            }
+            // Try to restore using saved parameters
+            err = usb_out_restore_device(dev);
+        } else if (!dev->saved_device.valid) {
+            ESP_LOGW(TAG, "No saved device parameters to restore");
+            continue;
+        } else {
+            ESP_LOGI(TAG, "Restoring USB device %u after wake", (unsigned)i);
+
+            // Restart the device with saved parameters
+            err = uac_host_device_start(dev->handle, &dev->saved_device.stream_config);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to restart device after wake: %s", esp_err_to_name(err));
+            } else {
+                // Restore volume from internal configuration
+                float volume_percent = s_usb_state.configured_volume * 100.0f;
+                uac_host_device_set_volume(dev->handle, volume_percent);
+                // Note: External playback control should be handled by the caller
+            }
+        }
+        // Device 0 decides, as it paces playout
+        if (i == 0 || ret == ESP_ERR_INVALID_STATE) {
+            ret = err;
+        }
     }
-    
-    ESP_LOGI(TAG, "Restoring USB device after wake");
-    
-    // Restart the device with saved parameters
-    esp_err_t err = uac_host_device_start(s_usb_state.spk_dev_handle, &s_usb_state.saved_device.stream_config);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to restart device after wake: %s", esp_err_to_name(err));
-        return err;
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "No saved device parameters available");
+    } else if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "USB device restored after wake");
     }
-    
-    // Restore volume from internal configuration
-    float volume_percent = s_usb_state.configured_volume * 100.0f;
-    uac_host_device_set_volume(s_usb_state.spk_dev_handle, volume_percent);
-    // Note: External playback control should be handled by the caller
-    
-    ESP_LOGI(TAG, "USB device restored after wake");
-    return ESP_OK;
+    return ret;
 }
 
 // Error handling helper functions
 
-static esp_err_t usb_out_handle_transfer_error(void) {
+static esp_err_t usb_out_handle_transfer_error(usb_out_dev_t *dev) {
     // Check if we've exceeded the retry limit
-    if (s_usb_state.transfer_retry_count >= USB_TRANSFER_RETRY_COUNT) {
+    if (dev->transfer_retry_count >= USB_TRANSFER_RETRY_COUNT) {
         ESP_LOGE(TAG, "Transfer error retry limit exceeded");
         return ESP_FAIL;
     }
     
     // Calculate exponential backoff delay
-    uint32_t backoff_delay = USB_TRANSFER_RETRY_DELAY_MS * (1 << s_usb_state.transfer_retry_count);
+    uint32_t backoff_delay = USB_TRANSFER_RETRY_DELAY_MS * (1 << dev->transfer_retry_count);
     ESP_LOGI(TAG, "Handling transfer error with %lu ms backoff delay", (unsigned long)backoff_delay);
     
     // Wait before retry
     vTaskDelay(pdMS_TO_TICKS(backoff_delay));
     
     // Validate device is still connected
-    if (!usb_out_validate_handle(s_usb_state.spk_dev_handle)) {
+    if (!usb_out_validate_handle(dev->handle)) {
         ESP_LOGE(TAG, "Device disconnected during error recovery");
         return ESP_ERR_INVALID_STATE;
     }
     
     // Attempt to recover by restarting the stream
-    if (s_usb_state.saved_device.valid) {
+    if (dev->saved_device.valid) {
         ESP_LOGI(TAG, "Attempting to restart stream for error recovery");
-        esp_err_t err = uac_host_device_stop(s_usb_state.spk_dev_handle);
+        esp_err_t err = uac_host_device_stop(dev->handle);
         if (err == ESP_OK) {
             vTaskDelay(pdMS_TO_TICKS(100));  // Brief pause
-            err = uac_host_device_start(s_usb_state.spk_dev_handle,
-                                       &s_usb_state.saved_device.stream_config);
+            err = uac_host_device_start(dev->handle, &dev->saved_device.stream_config);
             if (err == ESP_OK) {
                 ESP_LOGI(TAG, "Stream restarted successfully");
-                s_usb_state.transfer_retry_count = 0;
+                dev->transfer_retry_count = 0;
                 return ESP_OK;
             }
         }
         ESP_LOGE(TAG, "Failed to restart stream: %s", esp_err_to_name(err));
     }
     
-    s_usb_state.transfer_retry_count++;
+    dev->transfer_retry_count++;
     return ESP_FAIL;
 }
 
-static esp_err_t usb_out_attempt_reconnection(void) {
+static esp_err_t usb_out_attempt_reconnection(usb_out_dev_t *dev) {
     ESP_LOGI(TAG, "Attempting USB device reconnection (attempt %lu/%d)",
-             (unsigned long)(s_usb_state.reconnect_attempts + 1),
+             (unsigned long)(dev->reconnect_attempts + 1),
              USB_RECONNECT_MAX_ATTEMPTS);
     
     // Check if we have saved device parameters
-    if (!s_usb_state.saved_device.valid) {
+    if (!dev->saved_device.valid) {
         ESP_LOGW(TAG, "No saved device parameters for reconnection");
         return ESP_ERR_INVALID_STATE;
     }
     
     // Check reconnection attempt limit
-    if (s_usb_state.reconnect_attempts >= USB_RECONNECT_MAX_ATTEMPTS) {
+    if (dev->reconnect_attempts >= USB_RECONNECT_MAX_ATTEMPTS) {
         ESP_LOGE(TAG, "Maximum reconnection attempts reached");
         return ESP_FAIL;
     }
     
     // Apply reconnection delay with exponential backoff
     TickType_t current_time = xTaskGetTickCount();
-    TickType_t time_since_last = current_time - s_usb_state.last_reconnect_time;
-    uint32_t required_delay = USB_RECONNECT_DELAY_MS * (1 << s_usb_state.reconnect_attempts);
+    TickType_t time_since_last = current_time - dev->last_reconnect_time;
+    uint32_t required_delay = USB_RECONNECT_DELAY_MS * (1 << dev->reconnect_attempts);
     
     if (time_since_last < pdMS_TO_TICKS(required_delay)) {
         vTaskDelay(pdMS_TO_TICKS(required_delay) - time_since_last);
     }
     
-    s_usb_state.last_reconnect_time = xTaskGetTickCount();
-    s_usb_state.reconnect_attempts++;
+    dev->last_reconnect_time = xTaskGetTickCount();
+    dev->reconnect_attempts++;
     
     // Try to restore the device
-    esp_err_t err = usb_out_restore_device();
+    esp_err_t err = usb_out_restore_device(dev);
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "Device reconnected successfully");
-        s_usb_state.reconnect_attempts = 0;  // Reset counter on success
-        usb_out_reset_error_counters();
+        dev->reconnect_attempts = 0;  // Reset counter on success
+        usb_out_reset_error_counters(dev);
     } else {
         ESP_LOGE(TAG, "Reconnection attempt failed: %s", esp_err_to_name(err));
     }
@@ -941,10 +1416,9 @@ static bool usb_out_validate_handle(uac_host_device_handle_t handle) {
         return false;
     }
     
-    // Check if this is our current device handle
-    if (handle != s_usb_state.spk_dev_handle) {
-        ESP_LOGW(TAG, "Handle mismatch: expected %p, got %p",
-                s_usb_state.spk_dev_handle, handle);
+    // Check if this is one of our device handles
+    if (usb_out_find_dev(handle) == NULL) {
+        ESP_LOGW(TAG, "Handle mismatch: %p is not an open DAC", handle);
         return false;
     }
     
@@ -957,9 +1431,9 @@ static bool usb_out_validate_handle(uac_host_device_handle_t handle) {
     return true;
 }
 
-static void usb_out_reset_error_counters(void) {
+static void usb_out_reset_error_counters(usb_out_dev_t *dev) {
     s_usb_state.transfer_error_count = 0;
-    s_usb_state.transfer_retry_count = 0;
+    dev->transfer_retry_count = 0;
     s_usb_state.last_error_time = 0;
 }
 
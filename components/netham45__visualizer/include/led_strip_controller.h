@@ -3,7 +3,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
-#include "led_strip.h"
+#include "driver/rmt_tx.h"
 
 // LED strip physical layout configuration
 #define LED_STRIP_NUM_LEDS      129     // Total number of LEDs (128 + 1 to skip LED #0)
@@ -12,6 +12,13 @@
 #define LED_STRIP_LEFT_COLS     32      // Left speaker columns (0-31)
 #define LED_STRIP_RIGHT_COLS    32      // Right speaker columns (32-63)
 
+// WS2812 transmit
+#define LED_STRIP_RMT_RESOLUTION_HZ  (10 * 1000 * 1000)   // 0.1us RMT ticks
+#define LED_STRIP_FRAME_BYTES        (LED_STRIP_NUM_LEDS * 3)   // GRB per LED
+#define LED_STRIP_DMA_SYMBOLS        1024    // RMT DMA buffer; a frame is 3096 symbols
+#define LED_STRIP_RESET_US           300     // Low time that latches a frame (WS2812B: >= 280us)
+#define LED_STRIP_TX_TIMEOUT_MS      20      // Longest wait for the previous frame (~4ms on the wire)
+
 // LED indexing:
 // Physical layout: 64 columns × 2 rows = 128 LEDs
 // LED #0 is skipped (ESP32 built-in LED)
@@ -51,8 +58,23 @@ typedef struct {
 } rgb_color_t;
 
 // LED controller state
+//
+// The frame is sent by our own RMT TX channel and bytes encoder, whose ISR and
+// encode function run from IRAM (CONFIG_RMT_TX_ISR_CACHE_SAFE), so a transmit
+// in flight survives a flash write. Frames are built into two GRB buffers in
+// internal RAM: the next frame is built while the previous one may still be on
+// the wire, and a frame identical to the one showing is not sent at all.
 typedef struct {
-    led_strip_handle_t strip;
+    rmt_channel_handle_t channel;
+    rmt_encoder_handle_t encoder;
+    uint8_t* tx_buffers[2];         // GRB frames; tx_buffers[tx_next ^ 1] is showing
+    uint8_t tx_next;                // Buffer the next frame is built in
+    bool tx_valid;                  // Something has been sent since init
+    volatile bool tx_busy;          // A transmit is in flight (cleared by the TX done ISR)
+    bool last_frame_unchanged;      // The last render matched the frame showing and was skipped
+    uint32_t frames_sent;
+    uint32_t frames_skipped;
+    uint32_t tx_errors;
     rgb_color_t frame_buffer[LED_STRIP_NUM_LEDS];
     float smoothed_left;   // Smoothed loudness for left channel
     float smoothed_right;  // Smoothed loudness for right channel
@@ -92,11 +114,35 @@ esp_err_t led_controller_update_from_loudness_ex(led_controller_t* controller,
                                                   const void* loudness_struct);
 
 /**
- * @brief Render the current frame buffer to the LED strip
+ * @brief Update LED visualization from spectrum bands (with peak hold)
+ *
+ * Each side shows one channel, lowest band at the centre: left grows towards
+ * column 0 and right towards column 63. A band's level fills row 0 then row 1
+ * and sets its colour; a held peak above the level is a dim white LED.
  *
  * @param controller Pointer to controller structure
+ * @param left Left channel band levels (0.0-1.0), lowest band first
+ * @param right Right channel band levels (0.0-1.0)
+ * @param left_peak Left channel peak hold (0.0-1.0)
+ * @param right_peak Right channel peak hold (0.0-1.0)
+ * @param bands Number of bands (spread across the 32 columns of a side)
  * @return ESP_OK on success
  */
+esp_err_t led_controller_update_from_spectrum(led_controller_t* controller,
+                                               const float* left, const float* right,
+                                               const float* left_peak, const float* right_peak,
+                                               uint8_t bands);
+
+/**
+ * @brief Render the current frame buffer to the LED strip
+ *
+ * Converts the frame to GRB in the idle buffer and queues it, unless it is the
+ * frame already showing (last_frame_unchanged is then set). Waits only if the
+ * previous frame is still being sent, as the strip latches on a low gap.
+ *
+ * @param controller Pointer to controller structure
+ * @return ESP_OK on success (sent or skipped)
+ */
 esp_err_t led_controller_render(led_controller_t* controller);
 
 /**
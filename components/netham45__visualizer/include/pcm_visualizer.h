@@ -40,6 +40,16 @@
 // Smoothing (reduced from 0.7)
 #define PCM_VIZ_SMOOTH_COEFF (CONFIG_VIZ_SMOOTH_COEFF_MPCT / 1000.0f)
 
+// Spectrum analyzer (CONFIG_VIZ_MODE_SPECTRUM)
+#define PCM_VIZ_SPECTRUM_BANDS   32        // One per LED column on each side
+#define PCM_VIZ_SPECTRUM_MIN_HZ  40.0f     // Lower edge of the lowest band
+#define PCM_VIZ_SPECTRUM_MAX_HZ  16000.0f  // Upper edge of the highest band (capped below Nyquist)
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+#define PCM_VIZ_FFT_SIZE         CONFIG_VIZ_FFT_SIZE
+#define PCM_VIZ_SPECTRUM_RATE_HZ CONFIG_VIZ_SPECTRUM_RATE_HZ
+#define PCM_VIZ_SPECTRUM_MIN_DB  (CONFIG_VIZ_SPECTRUM_MIN_DB_TENTHS / 10.0f)
+#endif
+
 // PPM Loudness Analysis
 typedef struct {
     float left;                  // Left channel PPM level (0.0-1.0)
@@ -57,11 +67,23 @@ typedef struct {
     float right_peak;            // DEPRECATED: kept for compatibility
 } pcm_viz_loudness_t;
 
+// Spectrum bands, lowest frequency first; levels use the PPM scale's top with the
+// spectrum floor at 0.0
+typedef struct {
+    float left[PCM_VIZ_SPECTRUM_BANDS];         // Band level (0.0-1.0)
+    float right[PCM_VIZ_SPECTRUM_BANDS];
+    float left_peak[PCM_VIZ_SPECTRUM_BANDS];    // Peak hold (0.0-1.0)
+    float right_peak[PCM_VIZ_SPECTRUM_BANDS];
+} pcm_viz_spectrum_t;
+
 // Visualizer statistics
 typedef struct {
     uint32_t samples_processed;
     uint32_t buffer_overruns;
     size_t buffer_level;
+    uint32_t fft_runs;           // Spectrum updates that ran the FFT
+    uint32_t fft_cycles;         // CPU cycles of the last one (window, FFT, bands)
+    uint32_t fft_cycles_max;
 } pcm_viz_stats_t;
 
 /**
@@ -85,12 +107,15 @@ esp_err_t pcm_viz_deinit(void);
 /**
  * @brief Write PCM data to the visualizer ring buffer
  *
- * This function is thread-safe and can be called from any context.
- * Data is 16-bit stereo PCM at 48kHz.
+ * Lock-free tap for the RTP tasks: at most two memcpy calls into a frame
+ * ring (or a strided copy with CONFIG_VIZ_DECIMATION > 1) and one atomic
+ * store. Single producer: only one task may write at a time (the receive
+ * or the send path, never both). Frames that do not fit are dropped and
+ * counted in buffer_overruns. Data is 16-bit stereo PCM at 48kHz.
  *
  * @param data Pointer to PCM data
- * @param len Length of data in bytes
- * @return ESP_OK on success, ESP_ERR_NO_MEM if buffer is full
+ * @param len Length of data in bytes (whole 4-byte frames)
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before pcm_viz_init()
  */
 esp_err_t pcm_viz_write(const uint8_t* data, size_t len);
 
@@ -104,6 +129,18 @@ esp_err_t pcm_viz_write(const uint8_t* data, size_t len);
  */
 esp_err_t pcm_viz_get_loudness(pcm_viz_loudness_t* loudness);
 
+/**
+ * @brief Get the current spectrum bands and their peak hold
+ *
+ * Updated CONFIG_VIZ_SPECTRUM_RATE_HZ times a second by the PCM visualizer
+ * task: a Hann-windowed CONFIG_VIZ_FFT_SIZE-point FFT of the latest frames,
+ * with both channels in one complex FFT, folded into log-spaced bands.
+ *
+ * @param spectrum Pointer to spectrum structure to fill
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED without CONFIG_VIZ_MODE_SPECTRUM
+ */
+esp_err_t pcm_viz_get_spectrum(pcm_viz_spectrum_t* spectrum);
+
 /**
  * @brief Get visualizer statistics
  *
@@ -13,9 +13,12 @@ extern "C" {
 typedef struct {
     uint32_t samples_processed;
     uint32_t fft_runs;
+    uint32_t fft_cycles;        // CPU cycles of the last spectrum update
+    uint32_t fft_cycles_max;
     uint32_t buffer_level;
     uint32_t buffer_overruns;
-    uint32_t led_updates;
+    uint32_t led_updates;       // Frames sent to the strip
+    uint32_t led_skipped;       // Frames identical to the one showing, not sent
     uint32_t led_errors;
     bool task_running;
 } visualizer_stats_t;
@@ -94,7 +97,8 @@ bool visualizer_is_active(void);
 /**
  * Temporarily suspend/resume LED updates safely.
  * Safe to call even if visualizer is not initialized.
- * Used to avoid calling RMT/LED code while flash cache is disabled (e.g., during NVS writes).
+ * Flash writes no longer need it: the RMT TX path is cache safe (IRAM ISR and
+ * encoder, frames in internal RAM). Kept for callers that want the LEDs frozen.
  */
 esp_err_t visualizer_suspend(void);
 esp_err_t visualizer_resume(void);
@@ -3,6 +3,11 @@
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "driver/rmt_encoder.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_rom_sys.h"
+#include "soc/soc_caps.h"
 #include <string.h>
 #include <math.h>
 
@@ -20,6 +25,32 @@ static inline uint8_t get_led_index(uint8_t column, uint8_t row) {
     return column + (row * LED_STRIP_NUM_COLUMNS) + 1;
 }
 
+// TX done ISR (IRAM, cache safe): the frame on the wire has been sent
+static bool IRAM_ATTR led_tx_done_cb(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t* edata,
+                                     void* user_ctx) {
+    led_controller_t* controller = (led_controller_t*)user_ctx;
+    controller->tx_busy = false;
+    return false;
+}
+
+static void led_controller_release(led_controller_t* controller) {
+    if (controller->channel != NULL) {
+        if (controller->initialized) {
+            rmt_disable(controller->channel);
+        }
+        rmt_del_channel(controller->channel);
+        controller->channel = NULL;
+    }
+    if (controller->encoder != NULL) {
+        rmt_del_encoder(controller->encoder);
+        controller->encoder = NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        heap_caps_free(controller->tx_buffers[i]);
+        controller->tx_buffers[i] = NULL;
+    }
+}
+
 // Initialize the LED strip controller
 esp_err_t led_controller_init(led_controller_t* controller, const visualizer_led_config_t* config) {
     if (controller == NULL || config == NULL) {
@@ -31,25 +62,68 @@ esp_err_t led_controller_init(led_controller_t* controller, const visualizer_led
 
     // Store configuration
     memcpy(&controller->config, config, sizeof(visualizer_led_config_t));
+    controller->channel = NULL;
+    controller->encoder = NULL;
+
+    // Frames must stay readable with the cache off, so internal RAM, never PSRAM
+    for (int i = 0; i < 2; i++) {
+        controller->tx_buffers[i] = heap_caps_calloc(1, LED_STRIP_FRAME_BYTES,
+                                                     MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (controller->tx_buffers[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate LED frame buffers");
+            led_controller_release(controller);
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
-    // Configure LED strip
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = config->gpio_pin,
-        .max_leds = config->num_leds,
-        .led_model = LED_MODEL_WS2812,
-        .flags.invert_out = false,
-    };
-
-    led_strip_rmt_config_t rmt_config = {
+    // Configure the RMT TX channel, with DMA when asked for and one is free
+    rmt_tx_channel_config_t tx_config = {
+        .gpio_num = config->gpio_pin,
         .clk_src = RMT_CLK_SRC_DEFAULT,
-        .resolution_hz = 10 * 1000 * 1000,  // 10MHz
+        .resolution_hz = LED_STRIP_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = config->enable_dma ? LED_STRIP_DMA_SYMBOLS : SOC_RMT_MEM_WORDS_PER_CHANNEL,
+        .trans_queue_depth = 2,
         .flags.with_dma = config->enable_dma,
     };
+    esp_err_t ret = rmt_new_tx_channel(&tx_config, &controller->channel);
+    if (ret != ESP_OK && config->enable_dma) {
+        ESP_LOGW(TAG, "No RMT DMA channel (%s), using ping-pong memory", esp_err_to_name(ret));
+        tx_config.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+        tx_config.flags.with_dma = false;
+        controller->config.enable_dma = false;
+        ret = rmt_new_tx_channel(&tx_config, &controller->channel);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create RMT channel: %s", esp_err_to_name(ret));
+        controller->channel = NULL;
+        led_controller_release(controller);
+        return ret;
+    }
+
+    // WS2812 bits at 0.1us ticks: 0 = 0.3us high + 0.9us low, 1 = 0.9us high + 0.3us low
+    rmt_bytes_encoder_config_t encoder_config = {
+        .bit0 = {.level0 = 1, .duration0 = 3, .level1 = 0, .duration1 = 9},
+        .bit1 = {.level0 = 1, .duration0 = 9, .level1 = 0, .duration1 = 3},
+        .flags.msb_first = 1,
+    };
+    ret = rmt_new_bytes_encoder(&encoder_config, &controller->encoder);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create RMT encoder: %s", esp_err_to_name(ret));
+        controller->encoder = NULL;
+        led_controller_release(controller);
+        return ret;
+    }
 
-    // Create LED strip instance
-    esp_err_t ret = led_strip_new_rmt_device(&strip_config, &rmt_config, &controller->strip);
+    rmt_tx_event_callbacks_t callbacks = {
+        .on_trans_done = led_tx_done_cb,
+    };
+    ret = rmt_tx_register_event_callbacks(controller->channel, &callbacks, controller);
+    if (ret == ESP_OK) {
+        ret = rmt_enable(controller->channel);
+    }
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create LED strip: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to start RMT channel: %s", esp_err_to_name(ret));
+        led_controller_release(controller);
         return ret;
     }
 
@@ -57,12 +131,20 @@ esp_err_t led_controller_init(led_controller_t* controller, const visualizer_led
     memset(controller->frame_buffer, 0, sizeof(controller->frame_buffer));
     controller->smoothed_left = 0.0f;
     controller->smoothed_right = 0.0f;
-
-    // Clear the strip
-    led_strip_clear(controller->strip);
+    controller->tx_next = 0;
+    controller->tx_valid = false;
+    controller->tx_busy = false;
+    controller->last_frame_unchanged = false;
+    controller->frames_sent = 0;
+    controller->frames_skipped = 0;
+    controller->tx_errors = 0;
 
     controller->initialized = true;
-    ESP_LOGI(TAG, "LED strip controller initialized");
+
+    // Clear the strip
+    led_controller_render(controller);
+    ESP_LOGI(TAG, "LED strip controller initialized (%s)",
+             controller->config.enable_dma ? "RMT DMA" : "RMT");
 
     return ESP_OK;
 }
@@ -268,22 +350,117 @@ esp_err_t led_controller_update_from_loudness_ex(led_controller_t* controller,
     return ESP_OK;
 }
 
+// Draw one channel's bands on one side, band 0 next to the centre
+static void draw_spectrum_side(led_controller_t* controller, const float* level, const float* peak,
+                               uint8_t bands, bool left_side) {
+    const uint8_t side_cols = left_side ? LED_STRIP_LEFT_COLS : LED_STRIP_RIGHT_COLS;
+    for (uint8_t col = 0; col < side_cols; col++) {
+        uint8_t band = (uint8_t)((uint32_t)col * bands / side_cols);
+        float value = fminf(fmaxf(level[band], 0.0f), 1.0f);
+        uint8_t actual_col = left_side ? (LED_STRIP_LEFT_COLS - 1) - col : LED_STRIP_LEFT_COLS + col;
+
+        rgb_color_t color;
+        switch (controller->config.color_scheme) {
+            case LED_COLOR_RAINBOW:
+                // Hue by frequency
+                color = get_rainbow_color((uint8_t)(col * 8));
+                break;
+
+            case LED_COLOR_MONOCHROME:
+                color = (rgb_color_t){0, 255, 0};
+                break;
+
+            case LED_COLOR_HEAT:
+            default:
+                // Hue by level
+                color = get_heat_color(value);
+                break;
+        }
+
+        // Two rows as a bar: row 0 fills over the bottom half of the scale, row 1 the top
+        for (uint8_t row = 0; row < LED_STRIP_NUM_ROWS; row++) {
+            float fill = fminf(fmaxf(value * LED_STRIP_NUM_ROWS - row, 0.0f), 1.0f);
+            controller->frame_buffer[get_led_index(actual_col, row)] =
+                scale_color(color, (uint8_t)(controller->config.brightness * fill));
+        }
+
+        // Held peak above the bar: dim white on the row it reaches
+        float held = fminf(fmaxf(peak[band], 0.0f), 1.0f);
+        if (held > value + 1.0f / LED_STRIP_NUM_ROWS / 4.0f) {
+            uint8_t row = held >= 1.0f / LED_STRIP_NUM_ROWS ? 1 : 0;
+            if (value * LED_STRIP_NUM_ROWS < row + 0.5f) {
+                controller->frame_buffer[get_led_index(actual_col, row)] =
+                    scale_color((rgb_color_t){255, 255, 255}, controller->config.brightness / 3);
+            }
+        }
+    }
+}
+
+// Update LED visualization from spectrum bands
+esp_err_t led_controller_update_from_spectrum(led_controller_t* controller,
+                                               const float* left, const float* right,
+                                               const float* left_peak, const float* right_peak,
+                                               uint8_t bands) {
+    if (!controller->initialized || !left || !right || !left_peak || !right_peak || bands == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(controller->frame_buffer, 0, sizeof(controller->frame_buffer));
+    draw_spectrum_side(controller, left, left_peak, bands, true);
+    draw_spectrum_side(controller, right, right_peak, bands, false);
+
+    return ESP_OK;
+}
+
 // Render the current frame buffer to the LED strip
 esp_err_t led_controller_render(led_controller_t* controller) {
     if (!controller->initialized) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Update each LED
+    // Build the frame in the buffer that is not showing (WS2812 wants GRB)
+    uint8_t* next = controller->tx_buffers[controller->tx_next];
     for (int i = 0; i < LED_STRIP_NUM_LEDS; i++) {
-        led_strip_set_pixel(controller->strip, i,
-                           controller->frame_buffer[i].r,
-                           controller->frame_buffer[i].g,
-                           controller->frame_buffer[i].b);
+        next[i * 3 + 0] = controller->frame_buffer[i].g;
+        next[i * 3 + 1] = controller->frame_buffer[i].r;
+        next[i * 3 + 2] = controller->frame_buffer[i].b;
+    }
+
+    // Nothing changed: no RMT burst at all
+    controller->last_frame_unchanged = controller->tx_valid &&
+        memcmp(next, controller->tx_buffers[controller->tx_next ^ 1], LED_STRIP_FRAME_BYTES) == 0;
+    if (controller->last_frame_unchanged) {
+        controller->frames_skipped++;
+        return ESP_OK;
+    }
+
+    // Never queue behind a frame still on the wire: the strip would see no reset gap
+    if (controller->tx_busy) {
+        esp_err_t ret = rmt_tx_wait_all_done(controller->channel, LED_STRIP_TX_TIMEOUT_MS);
+        if (ret != ESP_OK) {
+            controller->tx_errors++;
+            return ret;
+        }
+        esp_rom_delay_us(LED_STRIP_RESET_US);
+    }
+
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0,
+    };
+    controller->tx_busy = true;
+    esp_err_t ret = rmt_transmit(controller->channel, controller->encoder, next,
+                                 LED_STRIP_FRAME_BYTES, &tx_config);
+    if (ret != ESP_OK) {
+        controller->tx_busy = false;
+        controller->tx_errors++;
+        return ret;
     }
 
-    // Refresh the strip
-    return led_strip_refresh(controller->strip);
+    // The buffer just queued is now the one showing
+    controller->tx_next ^= 1;
+    controller->tx_valid = true;
+    controller->frames_sent++;
+    return ESP_OK;
 }
 
 // Set brightness level
@@ -310,9 +487,7 @@ esp_err_t led_controller_clear(led_controller_t* controller) {
     memset(controller->frame_buffer, 0, sizeof(controller->frame_buffer));
 
     // Clear the physical strip
-    led_strip_clear(controller->strip);
-
-    return ESP_OK;
+    return led_controller_render(controller);
 }
 
 // Play a power-on animation (red sweep)
@@ -383,7 +558,8 @@ esp_err_t led_controller_power_on_animation(led_controller_t* controller) {
 void led_controller_deinit(led_controller_t* controller) {
     if (controller != NULL && controller->initialized) {
         led_controller_clear(controller);
-        led_strip_del(controller->strip);
+        rmt_tx_wait_all_done(controller->channel, LED_STRIP_TX_TIMEOUT_MS);
+        led_controller_release(controller);
         controller->initialized = false;
         ESP_LOGI(TAG, "LED strip controller deinitialized");
     }
@@ -6,27 +6,73 @@
 #include "esp_timer.h"
 #include <string.h>
 #include <math.h>
+#include <stdatomic.h>
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+#include "esp_dsp.h"
+#include "esp_cpu.h"
+#endif
 
 static const char* TAG = "pcm_viz";
 
+#ifndef CONFIG_VIZ_DECIMATION
+#define CONFIG_VIZ_DECIMATION 1
+#endif
+
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+// Below the RTP, decoder and I2S tasks, so the FFT only ever runs in their idle time
+#define PCM_VIZ_TASK_PRIORITY 2
+#else
+#define PCM_VIZ_TASK_PRIORITY 5
+#endif
+
 // Auto-gain tracking
 static float s_peak_history[100] = {0};  // Store last 100 peak measurements
 static int s_peak_history_idx = 0;
 static uint32_t s_last_gain_adjust_time = 0;
 
-// Ring buffer for PCM data
-static uint8_t ring_buffer[PCM_VIZ_RING_SIZE];
-static volatile uint32_t write_ptr = 0;
-static volatile uint32_t read_ptr = 0;
-
-// Sample windows for RMS calculation
-static float samples_left[PCM_VIZ_WINDOW_SIZE];
-static float samples_right[PCM_VIZ_WINDOW_SIZE];
+// Ring of 16-bit stereo frames: single producer (the active RX or TX task) and the
+// viz task as the single consumer. Indices stay in [0, PCM_VIZ_RING_FRAMES); one
+// slot is kept empty so full and empty differ. Only the producer writes write_idx
+// and only the consumer writes read_idx; when full, new frames are dropped.
+#define PCM_VIZ_RING_FRAMES (PCM_VIZ_RING_SIZE / 4)
+static uint32_t ring_buffer[PCM_VIZ_RING_FRAMES];
+static atomic_uint_fast32_t write_idx = 0;
+static atomic_uint_fast32_t read_idx = 0;
+static atomic_bool clear_requested = false;
+#if CONFIG_VIZ_DECIMATION > 1
+static uint32_t decim_phase = 0;     // Producer: frames to skip before the next kept one
+#endif
+
+// RMS window: integer sums of squares, accumulated as frames leave the ring. A
+// full-scale window is 2^30 per frame, so 64 bits cover any CONFIG_VIZ_WINDOW_SIZE.
+static uint64_t sum_sq_left = 0;
+static uint64_t sum_sq_right = 0;
 static uint32_t sample_index = 0;
 
 // Loudness values
 static pcm_viz_loudness_t current_loudness = {0};
 
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+_Static_assert((PCM_VIZ_FFT_SIZE & (PCM_VIZ_FFT_SIZE - 1)) == 0,
+               "CONFIG_VIZ_FFT_SIZE must be a power of two");
+#define PCM_VIZ_FFT_SAMPLE_RATE (48000.0f / CONFIG_VIZ_DECIMATION)
+
+// Latest PCM_VIZ_FFT_SIZE frames (the oldest at fft_hist_pos); viz task only
+static uint32_t fft_history[PCM_VIZ_FFT_SIZE];
+static uint32_t fft_hist_pos = 0;
+static uint32_t fft_new_frames = 0;     // Frames appended since the last update
+static float fft_window[PCM_VIZ_FFT_SIZE];
+// Left in the real parts and right in the imaginary; split into two half spectra after the FFT
+static float fft_buf[PCM_VIZ_FFT_SIZE * 2] __attribute__((aligned(16)));
+static uint16_t band_lo[PCM_VIZ_SPECTRUM_BANDS];    // First bin of each band
+static uint16_t band_hi[PCM_VIZ_SPECTRUM_BANDS];    // One past the last
+static float band_db[2][PCM_VIZ_SPECTRUM_BANDS];
+static float band_peak_db[2][PCM_VIZ_SPECTRUM_BANDS];
+static int64_t band_peak_us[2][PCM_VIZ_SPECTRUM_BANDS];
+static int64_t last_spectrum_us = 0;
+static pcm_viz_spectrum_t current_spectrum = {0};   // Published under data_mutex
+#endif
+
 // Configuration
 static float viz_gain = 1.0f;  // Unit gain for PPM meter
 static bool is_initialized = false;
@@ -51,19 +97,23 @@ static pcm_viz_stats_t viz_stats = {0};
 // Internal functions
 static void pcm_viz_task(void* param);
 static void process_ring_buffer(void);
-static void calculate_rms_loudness(void);
+static void calculate_rms_loudness(uint64_t sum_left, uint64_t sum_right);
 static size_t get_buffer_bytes_available(void);
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+static esp_err_t spectrum_init(void);
+static void fft_history_append(const uint32_t* frames, uint32_t n);
+static void update_spectrum(int64_t now_us, float dt);
+#endif
+
+static inline uint32_t ring_used(uint32_t w, uint32_t r) {
+    return w >= r ? w - r : PCM_VIZ_RING_FRAMES - r + w;
+}
 
 // Get number of bytes available in ring buffer
 static size_t get_buffer_bytes_available(void) {
-    uint32_t w = write_ptr;
-    uint32_t r = read_ptr;
-
-    if (w >= r) {
-        return w - r;
-    } else {
-        return PCM_VIZ_RING_SIZE - r + w;
-    }
+    uint32_t w = atomic_load_explicit(&write_idx, memory_order_acquire);
+    uint32_t r = atomic_load_explicit(&read_idx, memory_order_acquire);
+    return (size_t)ring_used(w, r) * 4u;
 }
 
 esp_err_t pcm_viz_init(void) {
@@ -72,7 +122,11 @@ esp_err_t pcm_viz_init(void) {
         return ESP_OK;
     }
 
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+    ESP_LOGI(TAG, "Initializing PCM visualizer (loudness and spectrum mode)");
+#else
     ESP_LOGI(TAG, "Initializing PCM visualizer (loudness mode)");
+#endif
 
     // Create mutex for thread safety
     data_mutex = xSemaphoreCreateMutex();
@@ -83,10 +137,11 @@ esp_err_t pcm_viz_init(void) {
 
     // Initialize buffers
     memset(ring_buffer, 0, sizeof(ring_buffer));
-    memset(samples_left, 0, sizeof(samples_left));
-    memset(samples_right, 0, sizeof(samples_right));
-    write_ptr = 0;
-    read_ptr = 0;
+    sum_sq_left = 0;
+    sum_sq_right = 0;
+    atomic_store(&write_idx, 0);
+    atomic_store(&read_idx, 0);
+    atomic_store(&clear_requested, false);
     sample_index = 0;
 
     // Initialize loudness values
@@ -106,26 +161,38 @@ esp_err_t pcm_viz_init(void) {
     s_last_gain_adjust_time = esp_timer_get_time() / 1000;
     memset(s_peak_history, 0, sizeof(s_peak_history));
 
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+    esp_err_t ret = spectrum_init();
+    if (ret != ESP_OK) {
+        vSemaphoreDelete(data_mutex);
+        data_mutex = NULL;
+        return ret;
+    }
+#endif
+
     // Create processing task
     BaseType_t task_ret = xTaskCreatePinnedToCore(
         pcm_viz_task,
         "pcm_viz",
         4096,
         NULL,
-        5,  // Priority
+        PCM_VIZ_TASK_PRIORITY,
         &viz_task_handle,
         0   // Core 0
     );
 
     if (task_ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create visualizer task");
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+        dsps_fft2r_deinit_fc32();
+#endif
         vSemaphoreDelete(data_mutex);
         return ESP_FAIL;
     }
 
     is_initialized = true;
     ESP_LOGI(TAG, "PCM visualizer initialized (Memory: ~%.1fKB)",
-             (sizeof(ring_buffer) + sizeof(samples_left) + sizeof(samples_right)) / 1024.0f);
+             sizeof(ring_buffer) / 1024.0f);
 
     return ESP_OK;
 }
@@ -147,6 +214,10 @@ esp_err_t pcm_viz_deinit(void) {
         data_mutex = NULL;
     }
 
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+    dsps_fft2r_deinit_fc32();
+#endif
+
     is_initialized = false;
     ESP_LOGI(TAG, "PCM visualizer deinitialized");
 
@@ -158,62 +229,105 @@ esp_err_t pcm_viz_write(const uint8_t* data, size_t len) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    // CRITICAL: Align write pointer to 4-byte boundary (stereo frame)
-    // This ensures every chunk starts with LEFT channel
-    if (write_ptr % 4 != 0) {
-        write_ptr = ((write_ptr + 3) / 4) * 4;  // Round up to next frame boundary
-        write_ptr %= PCM_VIZ_RING_SIZE;
-    }
-
-    // Check for buffer space
-    size_t available = PCM_VIZ_RING_SIZE - get_buffer_bytes_available() - 1;
-    if (len > available) {
+    uint32_t frames = (uint32_t)(len / 4);   // Whole stereo frames; every chunk starts on LEFT
+    uint32_t w = atomic_load_explicit(&write_idx, memory_order_relaxed);
+    uint32_t r = atomic_load_explicit(&read_idx, memory_order_acquire);
+    uint32_t space = PCM_VIZ_RING_FRAMES - 1u - ring_used(w, r);
+
+#if CONFIG_VIZ_DECIMATION > 1
+    // Keep every CONFIG_VIZ_DECIMATION-th frame, phase carried across chunks
+    uint32_t first = decim_phase < frames ? decim_phase : frames;
+    uint32_t kept = frames > first ? (frames - first + CONFIG_VIZ_DECIMATION - 1u) / CONFIG_VIZ_DECIMATION : 0u;
+    decim_phase = first + kept * CONFIG_VIZ_DECIMATION - frames;
+    if (kept > space) {
         viz_stats.buffer_overruns++;
-        // Allow overwrite of old data
+        kept = space;
     }
-
-    // Write data to ring buffer
-    for (size_t i = 0; i < len; i++) {
-        ring_buffer[write_ptr] = data[i];
-        write_ptr = (write_ptr + 1) % PCM_VIZ_RING_SIZE;
-
-        // Handle overrun by moving read pointer to next frame boundary (4 bytes = 1 stereo frame)
-        if (write_ptr == read_ptr) {
-            // Advance by 4 bytes to maintain stereo frame alignment
-            read_ptr = (read_ptr + 4) % PCM_VIZ_RING_SIZE;
+    const uint8_t *src = data + (size_t)first * 4u;
+    for (uint32_t n = 0; n < kept; n++) {
+        memcpy(&ring_buffer[w], src, 4);
+        src += 4u * CONFIG_VIZ_DECIMATION;
+        if (++w == PCM_VIZ_RING_FRAMES) {
+            w = 0;
         }
     }
+#else
+    if (frames > space) {
+        viz_stats.buffer_overruns++;
+        frames = space;   // The reader fell behind; drop the newest rather than race it
+    }
+    // At most two segments: up to the end of the ring, then from its start
+    uint32_t head = PCM_VIZ_RING_FRAMES - w;
+    if (head > frames) {
+        head = frames;
+    }
+    memcpy(&ring_buffer[w], data, (size_t)head * 4u);
+    memcpy(&ring_buffer[0], data + (size_t)head * 4u, (size_t)(frames - head) * 4u);
+    w += frames;
+    if (w >= PCM_VIZ_RING_FRAMES) {
+        w -= PCM_VIZ_RING_FRAMES;
+    }
+#endif
 
+    atomic_store_explicit(&write_idx, w, memory_order_release);
     return ESP_OK;
 }
 
 static void process_ring_buffer(void) {
-    // Process available samples
-    while (get_buffer_bytes_available() >= 4) {  // Need at least 2 samples (L+R)
-        // Read 16-bit stereo samples
-        int16_t left, right;
-
-        // Read left channel
-        left = (int16_t)(ring_buffer[read_ptr] | (ring_buffer[(read_ptr + 1) % PCM_VIZ_RING_SIZE] << 8));
-        read_ptr = (read_ptr + 2) % PCM_VIZ_RING_SIZE;
-
-        // Read right channel
-        right = (int16_t)(ring_buffer[read_ptr] | (ring_buffer[(read_ptr + 1) % PCM_VIZ_RING_SIZE] << 8));
-        read_ptr = (read_ptr + 2) % PCM_VIZ_RING_SIZE;
-
-        // Normalize to -1.0 to 1.0 (gain applied during RMS calculation)
-        samples_left[sample_index] = left / 32768.0f;
-        samples_right[sample_index] = right / 32768.0f;
-
-        sample_index++;
+    if (atomic_exchange_explicit(&clear_requested, false, memory_order_acq_rel)) {
+        atomic_store_explicit(&read_idx, atomic_load_explicit(&write_idx, memory_order_acquire),
+                              memory_order_release);
+        sample_index = 0;
+        sum_sq_left = 0;
+        sum_sq_right = 0;
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+        memset(fft_history, 0, sizeof(fft_history));
+#endif
+    }
 
-        // Calculate RMS when window is full
-        if (sample_index >= PCM_VIZ_WINDOW_SIZE) {
-            calculate_rms_loudness();
-            sample_index = 0;
+    uint32_t w = atomic_load_explicit(&write_idx, memory_order_acquire);
+    uint32_t r = atomic_load_explicit(&read_idx, memory_order_relaxed);
+    while (r != w) {
+        // Contiguous run up to the writer or the end of the ring
+        uint32_t end = (w > r) ? w : PCM_VIZ_RING_FRAMES;
+        viz_stats.samples_processed += end - r;
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+        fft_history_append(&ring_buffer[r], end - r);
+#endif
+        while (r < end) {
+            // Up to the end of the run or of the RMS window
+            uint32_t n = end - r;
+            if (n > PCM_VIZ_WINDOW_SIZE - sample_index) {
+                n = PCM_VIZ_WINDOW_SIZE - sample_index;
+            }
+            uint64_t acc_left = sum_sq_left;
+            uint64_t acc_right = sum_sq_right;
+            for (uint32_t i = 0; i < n; i++) {
+                uint32_t frame = ring_buffer[r + i];   // Little-endian: left in the low half
+                int32_t left = (int16_t)(frame & 0xFFFFu);
+                int32_t right = (int16_t)(frame >> 16);
+                acc_left += (uint32_t)(left * left);
+                acc_right += (uint32_t)(right * right);
+            }
+            r += n;
+            sample_index += n;
+
+            // Calculate RMS when window is full
+            if (sample_index >= PCM_VIZ_WINDOW_SIZE) {
+                calculate_rms_loudness(acc_left, acc_right);
+                acc_left = 0;
+                acc_right = 0;
+                sample_index = 0;
+            }
+            sum_sq_left = acc_left;
+            sum_sq_right = acc_right;
         }
-
-        viz_stats.samples_processed++;
+        if (r == PCM_VIZ_RING_FRAMES) {
+            r = 0;
+        }
+        // Hand the space back before re-reading the writer
+        atomic_store_explicit(&read_idx, r, memory_order_release);
+        w = atomic_load_explicit(&write_idx, memory_order_acquire);
     }
 }
 
@@ -351,22 +465,11 @@ static void apply_ppm_ballistics(float current_db, float *ppm_db,
     *overload = (*ppm_db >= PCM_VIZ_PPM_OVERLOAD_DB);
 }
 
-static void calculate_rms_loudness(void) {
-    // Calculate RMS for left channel
-    float sum_sq_left = 0.0f;
-    for (uint32_t i = 0; i < PCM_VIZ_WINDOW_SIZE; i++) {
-        float sample = samples_left[i] * viz_gain;  // Remove auto-gain multiplication
-        sum_sq_left += sample * sample;
-    }
-    float rms_left = sqrtf(sum_sq_left / PCM_VIZ_WINDOW_SIZE);
-
-    // Calculate RMS for right channel
-    float sum_sq_right = 0.0f;
-    for (uint32_t i = 0; i < PCM_VIZ_WINDOW_SIZE; i++) {
-        float sample = samples_right[i] * viz_gain;  // Remove auto-gain multiplication
-        sum_sq_right += sample * sample;
-    }
-    float rms_right = sqrtf(sum_sq_right / PCM_VIZ_WINDOW_SIZE);
+static void calculate_rms_loudness(uint64_t sum_left, uint64_t sum_right) {
+    // RMS of the window, normalized to full scale (auto-gain not applied)
+    const float scale = viz_gain / 32768.0f;
+    float rms_left = sqrtf((float)sum_left / PCM_VIZ_WINDOW_SIZE) * scale;
+    float rms_right = sqrtf((float)sum_right / PCM_VIZ_WINDOW_SIZE) * scale;
 
     // Convert to dB
     float left_db = rms_to_db(rms_left);
@@ -420,6 +523,166 @@ static void calculate_rms_loudness(void) {
     }
 }
 
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+static esp_err_t spectrum_init(void) {
+    esp_err_t ret = dsps_fft2r_init_fc32(NULL, PCM_VIZ_FFT_SIZE);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize %d-point FFT: %s", PCM_VIZ_FFT_SIZE, esp_err_to_name(ret));
+        return ret;
+    }
+    dsps_wind_hann_f32(fft_window, PCM_VIZ_FFT_SIZE);
+
+    // Log-spaced band edges in bins; a band narrower than a bin still gets one
+    float hz_per_bin = PCM_VIZ_FFT_SAMPLE_RATE / PCM_VIZ_FFT_SIZE;
+    float max_hz = fminf(PCM_VIZ_SPECTRUM_MAX_HZ, PCM_VIZ_FFT_SAMPLE_RATE * 0.45f);
+    float ratio = max_hz / PCM_VIZ_SPECTRUM_MIN_HZ;
+    for (int b = 0; b < PCM_VIZ_SPECTRUM_BANDS; b++) {
+        float lo_hz = PCM_VIZ_SPECTRUM_MIN_HZ * powf(ratio, (float)b / PCM_VIZ_SPECTRUM_BANDS);
+        float hi_hz = PCM_VIZ_SPECTRUM_MIN_HZ * powf(ratio, (float)(b + 1) / PCM_VIZ_SPECTRUM_BANDS);
+        uint32_t lo = (uint32_t)(lo_hz / hz_per_bin + 0.5f);
+        uint32_t hi = (uint32_t)(hi_hz / hz_per_bin + 0.5f);
+        if (lo < 1) {
+            lo = 1;   // Skip DC
+        }
+        if (hi <= lo) {
+            hi = lo + 1;
+        }
+        if (hi > PCM_VIZ_FFT_SIZE / 2) {
+            hi = PCM_VIZ_FFT_SIZE / 2;
+        }
+        band_lo[b] = (uint16_t)lo;
+        band_hi[b] = (uint16_t)hi;
+    }
+
+    memset(fft_history, 0, sizeof(fft_history));
+    fft_hist_pos = 0;
+    fft_new_frames = 0;
+    for (int ch = 0; ch < 2; ch++) {
+        for (int b = 0; b < PCM_VIZ_SPECTRUM_BANDS; b++) {
+            band_db[ch][b] = PCM_VIZ_SPECTRUM_MIN_DB;
+            band_peak_db[ch][b] = PCM_VIZ_SPECTRUM_MIN_DB;
+            band_peak_us[ch][b] = 0;
+        }
+    }
+    memset(&current_spectrum, 0, sizeof(current_spectrum));
+    last_spectrum_us = 0;
+
+    ESP_LOGI(TAG, "Spectrum: %d-point FFT at %.0f Hz, %.1f Hz/bin, %d bands %.0f-%.0f Hz, %d Hz",
+             PCM_VIZ_FFT_SIZE, PCM_VIZ_FFT_SAMPLE_RATE, hz_per_bin, PCM_VIZ_SPECTRUM_BANDS,
+             PCM_VIZ_SPECTRUM_MIN_HZ, max_hz, PCM_VIZ_SPECTRUM_RATE_HZ);
+    return ESP_OK;
+}
+
+// Keep the latest PCM_VIZ_FFT_SIZE frames: at most two memcpy calls per ring run
+static void fft_history_append(const uint32_t* frames, uint32_t n) {
+    fft_new_frames += n;
+    if (n >= PCM_VIZ_FFT_SIZE) {
+        memcpy(fft_history, frames + (n - PCM_VIZ_FFT_SIZE), sizeof(fft_history));
+        fft_hist_pos = 0;
+        return;
+    }
+    uint32_t head = PCM_VIZ_FFT_SIZE - fft_hist_pos;
+    if (head > n) {
+        head = n;
+    }
+    memcpy(&fft_history[fft_hist_pos], frames, (size_t)head * 4u);
+    memcpy(&fft_history[0], frames + head, (size_t)(n - head) * 4u);
+    fft_hist_pos = (fft_hist_pos + n) & (PCM_VIZ_FFT_SIZE - 1u);
+}
+
+static inline float spectrum_normalized(float db) {
+    float normalized = (db - PCM_VIZ_SPECTRUM_MIN_DB) / (PCM_VIZ_PPM_MAX_DB - PCM_VIZ_SPECTRUM_MIN_DB);
+    return fminf(fmaxf(normalized, 0.0f), 1.0f);
+}
+
+/**
+ * One spectrum update: window, FFT and band levels, then peak hold and publish.
+ * With no new frames (stream stopped) the FFT is skipped and the bands decay to
+ * the floor, so an idle visualizer costs next to nothing here.
+ */
+static void update_spectrum(int64_t now_us, float dt) {
+    float level_db[2][PCM_VIZ_SPECTRUM_BANDS];
+    bool ran_fft = fft_new_frames > 0;
+    uint32_t cycles = 0;
+
+    if (ran_fft) {
+        fft_new_frames = 0;
+        uint32_t start = esp_cpu_get_cycle_count();
+
+        // Oldest to newest under the window; left real, right imaginary
+        for (uint32_t i = 0; i < PCM_VIZ_FFT_SIZE; i++) {
+            uint32_t frame = fft_history[(fft_hist_pos + i) & (PCM_VIZ_FFT_SIZE - 1u)];
+            fft_buf[i * 2 + 0] = (float)(int16_t)(frame & 0xFFFFu) * fft_window[i];
+            fft_buf[i * 2 + 1] = (float)(int16_t)(frame >> 16) * fft_window[i];
+        }
+        dsps_fft2r_fc32(fft_buf, PCM_VIZ_FFT_SIZE);
+        dsps_bit_rev_fc32(fft_buf, PCM_VIZ_FFT_SIZE);
+        // Two real spectra of N/2 complex bins: left at [0, N), right at [N, 2N)
+        dsps_cplx2reC_fc32(fft_buf, PCM_VIZ_FFT_SIZE);
+
+        // A full-scale sine under a Hann window peaks at 32768 * N / 4 in its bin
+        const float ref = 32768.0f * PCM_VIZ_FFT_SIZE / 4.0f;
+        const float gain_db = 20.0f * log10f(viz_gain + 1e-10f) - 20.0f * log10f(ref);
+        for (int ch = 0; ch < 2; ch++) {
+            const float* spec = &fft_buf[ch * PCM_VIZ_FFT_SIZE];
+            for (int b = 0; b < PCM_VIZ_SPECTRUM_BANDS; b++) {
+                // Loudest bin, so a tone reads the same whatever the band's width
+                float power = 0.0f;
+                for (uint32_t k = band_lo[b]; k < band_hi[b]; k++) {
+                    float p = spec[k * 2] * spec[k * 2] + spec[k * 2 + 1] * spec[k * 2 + 1];
+                    if (p > power) {
+                        power = p;
+                    }
+                }
+                level_db[ch][b] = 10.0f * log10f(power + 1e-10f) + gain_db;
+            }
+        }
+        cycles = esp_cpu_get_cycle_count() - start;
+    } else {
+        for (int ch = 0; ch < 2; ch++) {
+            for (int b = 0; b < PCM_VIZ_SPECTRUM_BANDS; b++) {
+                level_db[ch][b] = PCM_VIZ_SPECTRUM_MIN_DB;
+            }
+        }
+    }
+
+    // Instant attack, PPM decay; peak hold then decay as the loudness meter does
+    for (int ch = 0; ch < 2; ch++) {
+        for (int b = 0; b < PCM_VIZ_SPECTRUM_BANDS; b++) {
+            float db = fmaxf(level_db[ch][b], PCM_VIZ_SPECTRUM_MIN_DB);
+            float fallen = band_db[ch][b] - PCM_VIZ_PPM_DECAY_DB_PER_SEC * dt;
+            band_db[ch][b] = fmaxf(db, fallen);
+
+            if (band_db[ch][b] >= band_peak_db[ch][b]) {
+                band_peak_db[ch][b] = band_db[ch][b];
+                band_peak_us[ch][b] = now_us;
+            } else if (now_us - band_peak_us[ch][b] > (int64_t)PCM_VIZ_PEAK_HOLD_MS * 1000) {
+                band_peak_db[ch][b] = fmaxf(band_peak_db[ch][b] - PCM_VIZ_PEAK_DECAY_DB_PER_SEC * dt,
+                                            band_db[ch][b]);
+            }
+        }
+    }
+
+    if (xSemaphoreTake(data_mutex, portMAX_DELAY) == pdTRUE) {
+        for (int b = 0; b < PCM_VIZ_SPECTRUM_BANDS; b++) {
+            current_spectrum.left[b] = spectrum_normalized(band_db[0][b]);
+            current_spectrum.right[b] = spectrum_normalized(band_db[1][b]);
+            current_spectrum.left_peak[b] = spectrum_normalized(band_peak_db[0][b]);
+            current_spectrum.right_peak[b] = spectrum_normalized(band_peak_db[1][b]);
+        }
+        xSemaphoreGive(data_mutex);
+    }
+
+    if (ran_fft) {
+        viz_stats.fft_runs++;
+        viz_stats.fft_cycles = cycles;
+        if (cycles > viz_stats.fft_cycles_max) {
+            viz_stats.fft_cycles_max = cycles;
+        }
+    }
+}
+#endif
+
 static void pcm_viz_task(void* param) {
     ESP_LOGI(TAG, "Visualizer task started");
 
@@ -427,6 +690,15 @@ static void pcm_viz_task(void* param) {
         // Process available data
         process_ring_buffer();
 
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+        int64_t now_us = esp_timer_get_time();
+        if (now_us - last_spectrum_us >= 1000000 / PCM_VIZ_SPECTRUM_RATE_HZ) {
+            float dt = last_spectrum_us ? (float)(now_us - last_spectrum_us) / 1000000.0f : 0.0f;
+            last_spectrum_us = now_us;
+            update_spectrum(now_us, fminf(dt, 1.0f));
+        }
+#endif
+
         // Update buffer level stat
         viz_stats.buffer_level = get_buffer_bytes_available();
 
@@ -449,6 +721,25 @@ esp_err_t pcm_viz_get_loudness(pcm_viz_loudness_t* loudness) {
     return ESP_ERR_TIMEOUT;
 }
 
+esp_err_t pcm_viz_get_spectrum(pcm_viz_spectrum_t* spectrum) {
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+    if (!is_initialized || spectrum == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (xSemaphoreTake(data_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        memcpy(spectrum, &current_spectrum, sizeof(pcm_viz_spectrum_t));
+        xSemaphoreGive(data_mutex);
+        return ESP_OK;
+    }
+
+    return ESP_ERR_TIMEOUT;
+#else
+    (void)spectrum;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 esp_err_t pcm_viz_get_stats(pcm_viz_stats_t* stats) {
     if (stats == NULL) {
         return ESP_ERR_INVALID_ARG;
@@ -463,13 +754,13 @@ size_t pcm_viz_get_buffer_level(void) {
 }
 
 void pcm_viz_clear_buffers(void) {
+    // The ring and sample windows belong to the viz task; it drops them on its next pass
+    atomic_store_explicit(&clear_requested, true, memory_order_release);
     if (xSemaphoreTake(data_mutex, portMAX_DELAY) == pdTRUE) {
-        write_ptr = 0;
-        read_ptr = 0;
-        sample_index = 0;
-        memset(samples_left, 0, sizeof(samples_left));
-        memset(samples_right, 0, sizeof(samples_right));
         memset(&current_loudness, 0, sizeof(current_loudness));
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+        memset(&current_spectrum, 0, sizeof(current_spectrum));
+#endif
         xSemaphoreGive(data_mutex);
     }
 }
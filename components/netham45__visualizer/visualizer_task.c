@@ -9,6 +9,13 @@
 
 static const char* TAG = "visualizer_task";
 
+#ifndef CONFIG_VIZ_LED_IDLE_MS
+#define CONFIG_VIZ_LED_IDLE_MS 500
+#endif
+#ifndef CONFIG_VIZ_LED_IDLE_FPS
+#define CONFIG_VIZ_LED_IDLE_FPS 10
+#endif
+
 // Task handle
 static TaskHandle_t visualizer_task_handle = NULL;
 static bool task_running = false;
@@ -27,10 +34,19 @@ static void visualizer_task(void* param) {
     ESP_LOGI(TAG, "LED Visualizer task started");
 
     // Buffer for loudness data
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+    pcm_viz_spectrum_t spectrum;
+#else
     pcm_viz_loudness_t loudness;
+#endif
 
     // LED update period for 60 FPS
     const TickType_t update_period = pdMS_TO_TICKS(16); // ~60Hz
+    // Once the frame has not changed for CONFIG_VIZ_LED_IDLE_MS (silence, a held level),
+    // wake less often; the first changed frame brings back the full rate
+    const TickType_t idle_period = pdMS_TO_TICKS(1000 / CONFIG_VIZ_LED_IDLE_FPS);
+    const uint32_t idle_after_frames = CONFIG_VIZ_LED_IDLE_MS / 16;
+    uint32_t unchanged_frames = 0;
     TickType_t last_wake_time = xTaskGetTickCount();
 
     while (task_running) {
@@ -41,8 +57,19 @@ static void visualizer_task(void* param) {
             continue;
         }
 
-        // Get loudness values from PCM visualizer
         s_rendering = true;
+#ifdef CONFIG_VIZ_MODE_SPECTRUM
+        // Get spectrum bands from PCM visualizer
+        esp_err_t ret = pcm_viz_get_spectrum(&spectrum);
+
+        if (ret == ESP_OK) {
+            led_controller_update_from_spectrum(led_controller, spectrum.left, spectrum.right,
+                                                spectrum.left_peak, spectrum.right_peak,
+                                                PCM_VIZ_SPECTRUM_BANDS);
+            led_controller_render(led_controller);
+        }
+#else
+        // Get loudness values from PCM visualizer
         esp_err_t ret = pcm_viz_get_loudness(&loudness);
 
         if (ret == ESP_OK) {
@@ -50,10 +77,20 @@ static void visualizer_task(void* param) {
             led_controller_update_from_loudness_ex(led_controller, &loudness);
             led_controller_render(led_controller);
         }
+#endif
         s_rendering = false;
 
+        if (ret == ESP_OK && led_controller->last_frame_unchanged) {
+            if (unchanged_frames < idle_after_frames) {
+                unchanged_frames++;
+            }
+        } else {
+            unchanged_frames = 0;
+        }
+
         // Wait until next update period
-        vTaskDelayUntil(&last_wake_time, update_period);
+        vTaskDelayUntil(&last_wake_time,
+                        unchanged_frames >= idle_after_frames ? idle_period : update_period);
     }
 
     ESP_LOGI(TAG, "LED Visualizer task stopped");
@@ -80,12 +117,13 @@ esp_err_t visualizer_init(void) {
     }
 
     // Configure LED strip
-    // Disable RMT DMA to avoid ISR-driven encoding while flash cache can be disabled (e.g. during NVS reads)
+    // The RMT TX ISR and bytes encoder run from IRAM (CONFIG_RMT_TX_ISR_CACHE_SAFE), so a
+    // DMA transmit in flight is safe while the flash cache is disabled (e.g. NVS commits)
     visualizer_led_config_t led_config = {
         .gpio_pin = 48,  // Default GPIO for LED strip
         .num_leds = LED_STRIP_NUM_LEDS,
         .brightness = 128,
-        .enable_dma = false,  // critical: avoid dma_tx_eof ISR path calling encoder when cache may be off
+        .enable_dma = true,
         .color_scheme = color_scheme,
         .smoothing_factor = smoothing
     };
@@ -216,14 +254,17 @@ esp_err_t visualizer_get_stats(visualizer_stats_t* stats) {
 
     // Fill in stats
     stats->samples_processed = pcm_stats.samples_processed;
-    stats->fft_runs = 0;  // No FFT in loudness mode
+    stats->fft_runs = pcm_stats.fft_runs;  // Stays 0 in loudness mode
+    stats->fft_cycles = pcm_stats.fft_cycles;
+    stats->fft_cycles_max = pcm_stats.fft_cycles_max;
     stats->buffer_level = pcm_stats.buffer_level;
     stats->buffer_overruns = pcm_stats.buffer_overruns;
     stats->task_running = task_running;
 
-    // LED stats not implemented yet, set to 0
-    stats->led_updates = 0;
-    stats->led_errors = 0;
+    // LED stats
+    stats->led_updates = led_controller ? led_controller->frames_sent : 0;
+    stats->led_skipped = led_controller ? led_controller->frames_skipped : 0;
+    stats->led_errors = led_controller ? led_controller->tx_errors : 0;
 
     return ESP_OK;
 }
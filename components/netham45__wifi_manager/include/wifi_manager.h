@@ -216,3 +216,64 @@ esp_err_t wifi_manager_connect_to_strongest(void);
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t wifi_manager_set_band_preference(uint8_t preference);
+
+/**
+ * @brief Audio a roam can play through
+ *
+ * @return Milliseconds of audio buffered ahead of playout, UINT32_MAX when
+ *         nothing is playing from the network
+ */
+typedef uint32_t (*wifi_manager_roam_headroom_cb_t)(void);
+
+/**
+ * @brief Gate proactive roaming on buffered audio
+ *
+ * With CONFIG_WIFI_MANAGER_ROAM, the signal dropping below
+ * CONFIG_WIFI_MANAGER_ROAM_RSSI first asks an 802.11v AP to steer the station
+ * (Fast Transition when the AP supports 802.11r); otherwise the SSID is
+ * scanned, returning to the home channel between channels, and the station
+ * moves to an AP at least CONFIG_WIFI_MANAGER_ROAM_HYSTERESIS_DB stronger.
+ * Either only starts while cb reports CONFIG_WIFI_MANAGER_ROAM_MIN_HEADROOM_MS
+ * or more, so the jitter buffer covers the gap; until then it is retried
+ * every second. Without a callback roams are not gated.
+ *
+ * @param cb Headroom source, called from the event loop task; NULL to clear
+ */
+void wifi_manager_set_roam_headroom_cb(wifi_manager_roam_headroom_cb_t cb);
+
+/**
+ * @brief Switch the low-latency streaming profile on or off
+ *
+ * While audio is flowing, modem sleep is disabled (WIFI_PS_NONE) so downlink
+ * packets are not held at the AP until the next DTIM beacon; switching off
+ * returns to WIFI_PS_MIN_MODEM. Does nothing to power save when
+ * CONFIG_WIFI_MANAGER_STREAM_NO_MODEM_SLEEP is disabled.
+ *
+ * @param active true while audio is being played or sent
+ * @return esp_err_t ESP_OK on success, or the esp_wifi_set_ps() error
+ */
+esp_err_t wifi_manager_set_streaming(bool active);
+
+/**
+ * @brief Whether the streaming profile is on
+ */
+bool wifi_manager_is_streaming(void);
+
+/**
+ * @brief IP TOS byte for audio traffic: CONFIG_WIFI_MANAGER_STREAM_DSCP << 2
+ *
+ * For sockets and raw lwIP PCBs alike (udp_pcb->tos).
+ */
+uint8_t wifi_manager_audio_tos(void);
+
+/**
+ * @brief Mark a UDP socket as real-time audio
+ *
+ * Sets IP_TOS to wifi_manager_audio_tos(). The Wi-Fi driver picks the WMM
+ * access category of each frame from the IP precedence bits, and APs and
+ * switches that honour DSCP prioritize the stream on the way in.
+ *
+ * @param sock Socket descriptor
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if setsockopt() failed
+ */
+esp_err_t wifi_manager_mark_audio_socket(int sock);
@@ -9,11 +9,35 @@
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "freertos/timers.h"
+#include "lwip/sockets.h"
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+#include "esp_wnm.h"
+#endif
 #include <string.h>
+#include <errno.h>
 #include <inttypes.h>
 
 static const char *TAG = "wifi_manager";
 
+#ifndef CONFIG_WIFI_MANAGER_STREAM_DSCP
+#define CONFIG_WIFI_MANAGER_STREAM_DSCP 46
+#endif
+#ifndef CONFIG_WIFI_MANAGER_LISTEN_INTERVAL
+#define CONFIG_WIFI_MANAGER_LISTEN_INTERVAL 3
+#endif
+#ifndef CONFIG_WIFI_MANAGER_ROAM_RSSI
+#define CONFIG_WIFI_MANAGER_ROAM_RSSI -70
+#endif
+#ifndef CONFIG_WIFI_MANAGER_ROAM_HYSTERESIS_DB
+#define CONFIG_WIFI_MANAGER_ROAM_HYSTERESIS_DB 8
+#endif
+#ifndef CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS
+#define CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS 20000
+#endif
+#ifndef CONFIG_WIFI_MANAGER_ROAM_MIN_HEADROOM_MS
+#define CONFIG_WIFI_MANAGER_ROAM_MIN_HEADROOM_MS 80
+#endif
+
 // WiFi band definitions
 #define WIFI_BAND_2_4GHZ 0
 #define WIFI_BAND_5GHZ   1
@@ -39,6 +63,7 @@ static const char *TAG = "wifi_manager";
 #define WIFI_NVS_NAMESPACE "wifi_config"
 #define WIFI_NVS_KEY_SSID "ssid"
 #define WIFI_NVS_KEY_PASSWORD "password"
+#define WIFI_NVS_KEY_LAST_AP "last_ap"
 
 // Event group to signal WiFi connection events
 static EventGroupHandle_t s_wifi_event_group;
@@ -64,6 +89,37 @@ static int s_retry_num = 0;
 // Timer callback forward declaration
 static void wifi_reconnect_timer_cb(TimerHandle_t xTimer);
 
+// Streaming profile on: modem sleep is off while audio flows
+static bool s_streaming = false;
+
+// An AP by BSSID and channel: the last one joined, or where a roam goes
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_manager_bss_t;
+
+// Reconnects go straight to the last AP (one channel, no full scan). The driver keeps the
+// PMK derived for the stored SSID/password, so the handshake skips that as well.
+static wifi_manager_bss_t s_last_ap;
+static bool s_last_ap_valid = false;
+// The connect in flight is pinned to one BSSID and channel
+static bool s_attempt_pinned = false;
+// Got an IP since the last disconnect
+static bool s_link_up = false;
+
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+// Gap between retries while the buffered audio would not cover a roam
+#define WIFI_ROAM_HEADROOM_RETRY_MS 1000
+#define WIFI_ROAM_SCAN_MAX_RECORDS  16
+
+static TimerHandle_t s_roam_timer = NULL;       // Re-arms the low-RSSI trigger
+static wifi_manager_roam_headroom_cb_t s_roam_headroom_cb = NULL;
+static bool s_roam_scanning = false;
+static bool s_roam_pending = false;             // Disconnected on purpose to move to s_roam_target
+static wifi_manager_bss_t s_roam_target;
+static TickType_t s_last_roam_tick = 0;
+#endif
+
 // Callback for event notifications
 static wifi_manager_event_cb_t s_event_callback = NULL;
 static void* s_event_callback_user_data = NULL;
@@ -82,6 +138,193 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                               int32_t event_id, void *event_data);
 static esp_err_t start_ap_mode(void);
 
+static void last_ap_load(void) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return;
+    }
+    size_t size = sizeof(s_last_ap);
+    s_last_ap_valid = nvs_get_blob(nvs_handle, WIFI_NVS_KEY_LAST_AP, &s_last_ap, &size) == ESP_OK &&
+                      size == sizeof(s_last_ap) && s_last_ap.channel != 0;
+    nvs_close(nvs_handle);
+}
+
+// Remember the AP just joined; flash is only written when it changed
+static void last_ap_store(const uint8_t *bssid, uint8_t channel) {
+    if (s_last_ap_valid && s_last_ap.channel == channel && memcmp(s_last_ap.bssid, bssid, 6) == 0) {
+        return;
+    }
+    memcpy(s_last_ap.bssid, bssid, 6);
+    s_last_ap.channel = channel;
+    s_last_ap_valid = channel != 0;
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK) {
+        if (nvs_set_blob(nvs_handle, WIFI_NVS_KEY_LAST_AP, &s_last_ap, sizeof(s_last_ap)) == ESP_OK) {
+            nvs_commit(nvs_handle);
+        }
+        nvs_close(nvs_handle);
+    }
+}
+
+/**
+ * Options every STA config gets: 802.11k/v/r, so the AP can steer us and roams use Fast
+ * Transition where it supports it, and a full scan sorted by signal, so an unpinned
+ * connect joins the strongest AP for the SSID rather than the first one heard
+ */
+static void sta_config_apply_defaults(wifi_config_t *cfg) {
+    cfg->sta.listen_interval = CONFIG_WIFI_MANAGER_LISTEN_INTERVAL;
+    cfg->sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    cfg->sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    cfg->sta.rm_enabled = 1;
+    cfg->sta.btm_enabled = 1;
+    cfg->sta.mbo_enabled = 1;
+    cfg->sta.ft_enabled = 1;
+}
+
+// Point the next connect at one AP (probing only its channel), or back to a full scan
+static void sta_config_pin(wifi_config_t *cfg, const wifi_manager_bss_t *bss) {
+    if (bss) {
+        cfg->sta.bssid_set = 1;
+        memcpy(cfg->sta.bssid, bss->bssid, 6);
+        cfg->sta.channel = bss->channel;
+        cfg->sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        cfg->sta.bssid_set = 0;
+        cfg->sta.channel = 0;
+        cfg->sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    }
+    s_attempt_pinned = bss != NULL;
+}
+
+// As sta_config_pin, on the running STA config (only while disconnected)
+static void sta_pin(const wifi_manager_bss_t *bss) {
+    wifi_config_t cfg;
+    if (esp_wifi_get_config(WIFI_IF_STA, &cfg) != ESP_OK) {
+        return;
+    }
+    sta_config_pin(&cfg, bss);
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to update STA config: %s", esp_err_to_name(err));
+        s_attempt_pinned = false;
+    }
+}
+
+static void schedule_reconnect(int delay_ms) {
+    if (s_reconnect_timer) {
+        TickType_t ticks = pdMS_TO_TICKS(delay_ms);
+        xTimerStop(s_reconnect_timer, 0);
+        xTimerChangePeriod(s_reconnect_timer, ticks > 0 ? ticks : 1, 0);
+        xTimerStart(s_reconnect_timer, 0);
+    }
+}
+
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+// Low-RSSI events are one-shot: ask for the next one now, or after delay_ms
+static void roam_arm(uint32_t delay_ms) {
+    if (delay_ms == 0 || !s_roam_timer) {
+        esp_wifi_set_rssi_threshold(CONFIG_WIFI_MANAGER_ROAM_RSSI);
+        return;
+    }
+    xTimerStop(s_roam_timer, 0);
+    xTimerChangePeriod(s_roam_timer, pdMS_TO_TICKS(delay_ms) > 0 ? pdMS_TO_TICKS(delay_ms) : 1, 0);
+    xTimerStart(s_roam_timer, 0);
+}
+
+static void roam_timer_cb(TimerHandle_t xTimer) {
+    if (s_link_up) {
+        roam_arm(0);
+    }
+}
+
+// Whether the audio buffered ahead of playout would cover a roam
+static bool roam_headroom_ok(void) {
+    return !s_roam_headroom_cb || s_roam_headroom_cb() >= CONFIG_WIFI_MANAGER_ROAM_MIN_HEADROOM_MS;
+}
+
+static void roam_on_rssi_low(int32_t rssi) {
+    if (!s_link_up || s_in_scan_mode || s_roam_scanning || s_roam_pending) {
+        return;
+    }
+    TickType_t since = xTaskGetTickCount() - s_last_roam_tick;
+    if (s_last_roam_tick != 0 && since < pdMS_TO_TICKS(CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS)) {
+        roam_arm(CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS - pdTICKS_TO_MS(since));
+        return;
+    }
+    if (!roam_headroom_ok()) {
+        roam_arm(WIFI_ROAM_HEADROOM_RETRY_MS);
+        return;
+    }
+    s_last_roam_tick = xTaskGetTickCount();
+    ESP_LOGI(TAG, "Signal down to %" PRId32 " dBm, looking for a better AP", rssi);
+
+    // An 802.11v AP knows its neighbours and their load: ask it to steer us
+    if (esp_wnm_is_btm_supported_connection() &&
+        esp_wnm_send_bss_transition_mgmt_query(REASON_FRAME_LOSS, NULL, 0) == 0) {
+        roam_arm(CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS);
+        return;
+    }
+
+    // Otherwise scan for our SSID, back on the home channel between channels so audio keeps flowing
+    wifi_ap_record_t current;
+    if (esp_wifi_sta_get_ap_info(&current) != ESP_OK) {
+        return;
+    }
+    wifi_scan_config_t scan = {
+        .ssid = current.ssid,
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = { .min = 10, .max = 40 },
+        .home_chan_dwell_time = 30,
+    };
+    if (esp_wifi_scan_start(&scan, false) == ESP_OK) {
+        s_roam_scanning = true;
+    } else {
+        roam_arm(CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS);
+    }
+}
+
+static void roam_on_scan_done(void) {
+    static wifi_ap_record_t records[WIFI_ROAM_SCAN_MAX_RECORDS];
+    uint16_t count = WIFI_ROAM_SCAN_MAX_RECORDS;
+    s_roam_scanning = false;
+    if (esp_wifi_scan_get_ap_records(&count, records) != ESP_OK) {
+        roam_arm(CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS);
+        return;
+    }
+    wifi_ap_record_t current;
+    if (esp_wifi_sta_get_ap_info(&current) != ESP_OK) {
+        return;
+    }
+    const wifi_ap_record_t *best = NULL;
+    for (uint16_t i = 0; i < count; i++) {
+        const wifi_ap_record_t *r = &records[i];
+        if (strcmp((const char *)r->ssid, (const char *)current.ssid) != 0 ||
+            memcmp(r->bssid, current.bssid, 6) == 0 ||
+            r->rssi < current.rssi + CONFIG_WIFI_MANAGER_ROAM_HYSTERESIS_DB) {
+            continue;
+        }
+        if (!best || r->rssi > best->rssi) {
+            best = r;
+        }
+    }
+    if (!best || !roam_headroom_ok()) {
+        ESP_LOGD(TAG, "No roam: %s", best ? "buffer too low" : "no stronger AP");
+        roam_arm(CONFIG_WIFI_MANAGER_ROAM_INTERVAL_MS);
+        return;
+    }
+    memcpy(s_roam_target.bssid, best->bssid, 6);
+    s_roam_target.channel = best->primary;
+    s_roam_pending = true;
+    ESP_LOGI(TAG, "Roaming from %d dBm to %02x:%02x:%02x:%02x:%02x:%02x (%d dBm, channel %u)",
+             current.rssi, best->bssid[0], best->bssid[1], best->bssid[2], best->bssid[3],
+             best->bssid[4], best->bssid[5], best->rssi, best->primary);
+    // Reconnects pinned to the target from the disconnect event
+    esp_wifi_disconnect();
+}
+#endif
+
 /**
  * Notify registered callback of WiFi events
  */
@@ -160,6 +403,10 @@ esp_err_t wifi_manager_init(void) {
         ESP_LOGE(TAG, "Failed to create WiFi reconnect timer");
         // Continue without timer; reconnect attempts will be skipped if timer is unavailable
     }
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+    s_roam_timer = xTimerCreate("wifi_roam", pdMS_TO_TICKS(1000), pdFALSE, NULL, roam_timer_cb);
+#endif
+    last_ap_load();
     
     // Initialize the TCP/IP stack (safely - it might be initialized already)
     esp_err_t net_err = esp_netif_init();
@@ -227,8 +474,19 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                 ESP_LOGD(TAG, "STA started, but not connecting yet (scan_mode=%d, init_complete=%d, state=%d)",
                          s_in_scan_mode, s_initialization_complete, s_wifi_manager_state);
             }
+        } else if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            wifi_event_sta_connected_t *conn = event_data;
+            s_attempt_pinned = false;
+            last_ap_store(conn->bssid, conn->channel);
+#if CONFIG_LWIP_IPV6
+            // Link-local address: MLD reports for IPv6 multicast are sent from it
+            esp_netif_create_ip6_linklocal(s_sta_netif);
+#endif
+            wifi_manager_notify_event(WIFI_MANAGER_EVENT_STA_CONNECTED, conn);
         } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
             wifi_event_sta_disconnected_t *disconn = event_data;
+            bool was_up = s_link_up;
+            s_link_up = false;
             wifi_manager_notify_event(WIFI_MANAGER_EVENT_STA_DISCONNECTED, disconn);
             
             // Re-enable AP mode if it was hidden while connected
@@ -236,6 +494,36 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                 ESP_LOGI(TAG, "Re-enabling AP interface after disconnection");
                 esp_wifi_set_mode(WIFI_MODE_APSTA);
             }
+
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+            if (s_roam_pending) {
+                // Our own roam: straight on to the chosen AP
+                s_roam_pending = false;
+                sta_pin(&s_roam_target);
+                schedule_reconnect(0);
+                return;
+            }
+#endif
+            if (s_attempt_pinned) {
+                // The pinned AP did not take us: scan every channel at once, not counted as a failure
+                ESP_LOGI(TAG, "Pinned AP unavailable (reason %" PRIu16 "), scanning all channels", disconn->reason);
+                sta_pin(NULL);
+                schedule_reconnect(0);
+                return;
+            }
+#ifdef CONFIG_WIFI_MANAGER_FAST_RECONNECT
+            if (was_up && s_last_ap_valid && !s_in_scan_mode) {
+                // A working link dropped: rejoin the AP we were on without scanning or backing off
+                ESP_LOGI(TAG, "Link lost (reason %" PRIu16 "), rejoining last AP on channel %u",
+                         disconn->reason, s_last_ap.channel);
+                s_retry_num = 0;
+                sta_pin(&s_last_ap);
+                schedule_reconnect(0);
+                return;
+            }
+#else
+            (void)was_up;
+#endif
             
             // Increment retry count and compute backoff delay (exponential, capped)
             s_retry_num++;
@@ -255,11 +543,17 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                     s_retry_num, disconn->reason, delay_ms);
 
             // Schedule reconnect via timer to avoid blocking the event loop
-            if (s_reconnect_timer) {
-                xTimerStop(s_reconnect_timer, 0);
-                xTimerChangePeriod(s_reconnect_timer, pdMS_TO_TICKS(delay_ms), 0);
-                xTimerStart(s_reconnect_timer, 0);
+            schedule_reconnect(delay_ms);
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+        } else if (event_id == WIFI_EVENT_STA_BSS_RSSI_LOW) {
+            wifi_event_bss_rssi_low_t *low = event_data;
+            roam_on_rssi_low(low->rssi);
+        } else if (event_id == WIFI_EVENT_SCAN_DONE) {
+            // Scans started elsewhere are read by whoever started them
+            if (s_roam_scanning) {
+                roam_on_scan_done();
             }
+#endif
         } else if (event_id == WIFI_EVENT_AP_STACONNECTED) {
             wifi_event_ap_staconnected_t *event = (wifi_event_ap_staconnected_t*) event_data;
             ESP_LOGI(TAG, "Station connected to AP, MAC: %02x:%02x:%02x:%02x:%02x:%02x",
@@ -279,6 +573,10 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "Got IP address: " IPSTR,
                     IP2STR(&event->ip_info.ip));
             s_retry_num = 0;
+            s_link_up = true;
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+            roam_arm(0);
+#endif
             xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
             s_wifi_manager_state = WIFI_MANAGER_STATE_CONNECTED;
             wifi_manager_notify_event(WIFI_MANAGER_EVENT_STA_GOT_IP, event);
@@ -370,6 +668,11 @@ esp_err_t wifi_manager_start(void) {
         
         strncpy((char*)wifi_sta_config.sta.ssid, ssid, sizeof(wifi_sta_config.sta.ssid));
         strncpy((char*)wifi_sta_config.sta.password, password, sizeof(wifi_sta_config.sta.password));
+        sta_config_apply_defaults(&wifi_sta_config);
+#ifdef CONFIG_WIFI_MANAGER_FAST_RECONNECT
+        // Boot straight onto the AP we last used; if it is gone the disconnect falls back to a scan
+        sta_config_pin(&wifi_sta_config, s_last_ap_valid ? &s_last_ap : NULL);
+#endif
         
         // ESP-IDF 5.5 fix: Stop WiFi before reconfiguring to avoid state conflicts
         esp_err_t stop_ret = esp_wifi_stop();
@@ -601,6 +904,10 @@ esp_err_t wifi_manager_save_credentials(const char *ssid, const char *password)
         nvs_close(nvs_handle);
         return ret;
     }
+
+    // The cached AP belongs to the previous network
+    nvs_erase_key(nvs_handle, WIFI_NVS_KEY_LAST_AP);
+    s_last_ap_valid = false;
     
     // Commit the changes
     ret = nvs_commit(nvs_handle);
@@ -659,6 +966,7 @@ esp_err_t wifi_manager_clear_credentials(void) {
     }
     
     ret = nvs_erase_all(nvs_handle);
+    s_last_ap_valid = false;
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Error erasing NVS namespace: %s", esp_err_to_name(ret));
         nvs_close(nvs_handle);
@@ -709,7 +1017,9 @@ esp_err_t wifi_manager_connect(const char *ssid, const char *password) {
     if (password) {
         strncpy((char*)wifi_sta_config.sta.password, password, sizeof(wifi_sta_config.sta.password));
     }
-    
+    sta_config_apply_defaults(&wifi_sta_config);
+    s_attempt_pinned = false;
+
     // Get AP configuration from stored config
     const char* ap_ssid = s_ap_config.ssid;
     const char* ap_password = s_ap_config.password;
@@ -1154,6 +1464,8 @@ esp_err_t wifi_manager_connect_to_strongest(void) {
     
     strncpy((char*)wifi_sta_config.sta.ssid, networks[selected_index].ssid, sizeof(wifi_sta_config.sta.ssid));
     strncpy((char*)wifi_sta_config.sta.password, stored_password, sizeof(wifi_sta_config.sta.password));
+    sta_config_apply_defaults(&wifi_sta_config);
+    s_attempt_pinned = false;
     
     // Update WiFi configuration (can be done while WiFi is running)
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_sta_config));
@@ -1257,3 +1569,50 @@ esp_err_t wifi_manager_set_ap_config(const wifi_manager_ap_config_t* ap_config)
     return ESP_OK;
 }
 
+/**
+ * Streaming profile: modem sleep off while audio flows
+ */
+esp_err_t wifi_manager_set_streaming(bool active) {
+    if (active == s_streaming) {
+        return ESP_OK;
+    }
+#ifdef CONFIG_WIFI_MANAGER_STREAM_NO_MODEM_SLEEP
+    esp_err_t err = esp_wifi_set_ps(active ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to %s modem sleep: %s", active ? "disable" : "restore", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Streaming profile %s (modem sleep %s)", active ? "on" : "off",
+             active ? "disabled" : "enabled");
+#endif
+    s_streaming = active;
+    return ESP_OK;
+}
+
+bool wifi_manager_is_streaming(void) {
+    return s_streaming;
+}
+
+uint8_t wifi_manager_audio_tos(void) {
+    return (uint8_t)(CONFIG_WIFI_MANAGER_STREAM_DSCP << 2);
+}
+
+/**
+ * Mark a socket's traffic with the audio DSCP
+ */
+esp_err_t wifi_manager_mark_audio_socket(int sock) {
+    int tos = wifi_manager_audio_tos();
+    if (setsockopt(sock, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) < 0) {
+        ESP_LOGW(TAG, "Failed to set IP_TOS 0x%02x on socket %d: errno %d", tos, sock, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void wifi_manager_set_roam_headroom_cb(wifi_manager_roam_headroom_cb_t cb) {
+#ifdef CONFIG_WIFI_MANAGER_ROAM
+    s_roam_headroom_cb = cb;
+#else
+    (void)cb;
+#endif
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free single-producer, single-consumer PCM ring between a capture source
+ * (usb_in, spdif_in) and the sender.
+ *
+ * The capacity is a whole number of frames. A write that does not fit keeps
+ * the frames that do and drops the rest; drops are counted, never logged, so
+ * the capture callback neither blocks, locks nor formats. The consumer reads
+ * in place: pcm_ring_peek() returns the contiguous readable span and
+ * pcm_ring_consume() releases it, so samples are touched once on their way
+ * into a packet.
+ *
+ * The consumer blocks in pcm_ring_wait() for a watermark (typically the rest
+ * of its packet); the producer wakes it with one task notification when a
+ * write brings the fill up to it, rather than on every write. The wait uses
+ * the task's default notification, so other notifications to the consumer
+ * (e.g. a pacing timer) only make it look again: every wait rechecks the fill.
+ *
+ * Positions run over [0, 2*size) so a full ring is told apart from an empty
+ * one without giving up a frame; head is written only by the producer, tail
+ * only by the consumer.
+ */
+
+typedef struct {
+    uint32_t writes;          // Producer writes
+    uint32_t dropped_writes;  // Writes that lost frames to a full ring
+    uint32_t dropped_frames;  // Frames lost to a full ring
+    uint32_t wakeups;         // Consumer notifications sent
+    uint32_t fill;            // Bytes waiting now
+    uint32_t peak_fill;       // Most bytes ever waiting (high-water mark)
+    uint32_t size;            // Capacity in bytes
+} pcm_ring_stats_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;                        // Bytes, a whole number of frames
+    size_t frame_bytes;
+    atomic_size_t head;                 // Write position (producer)
+    atomic_size_t tail;                 // Read position (consumer)
+    atomic_size_t watermark;            // Fill the waiting consumer wants
+    _Atomic(TaskHandle_t) waiter;       // Consumer blocked in pcm_ring_wait(), or NULL
+    atomic_uint_fast32_t writes;
+    atomic_uint_fast32_t dropped_writes;
+    atomic_uint_fast32_t dropped_frames;
+    atomic_uint_fast32_t wakeups;
+    atomic_size_t peak_fill;
+} pcm_ring_t;
+
+/**
+ * @brief Allocate a ring in internal RAM (the audio arena when it has room)
+ * @param frames Capacity in frames
+ * @param frame_bytes Bytes per frame (all channels)
+ * @return The ring, or NULL without memory
+ */
+pcm_ring_t *pcm_ring_create(size_t frames, size_t frame_bytes);
+
+void pcm_ring_delete(pcm_ring_t *ring);
+
+/**
+ * @brief Append PCM (producer only; never blocks)
+ * @param data Interleaved frames
+ * @param len Bytes; a trailing partial frame is ignored
+ * @return Bytes written; the remainder was dropped
+ */
+size_t pcm_ring_write(pcm_ring_t *ring, const void *data, size_t len);
+
+/**
+ * @brief Contiguous readable span (consumer only)
+ * @param data Set to the first readable byte
+ * @param max Most bytes wanted; rounded down to whole frames
+ * @return Bytes available at *data (0 if empty); release them with pcm_ring_consume()
+ */
+size_t pcm_ring_peek(pcm_ring_t *ring, const uint8_t **data, size_t max);
+
+/**
+ * @brief Release bytes returned by pcm_ring_peek() (consumer only)
+ */
+void pcm_ring_consume(pcm_ring_t *ring, size_t len);
+
+/**
+ * @brief Block until at least bytes are waiting (consumer only)
+ * @param bytes Watermark; clamped to the capacity
+ * @param timeout Longest wait
+ * @return true if the fill reached bytes
+ */
+bool pcm_ring_wait(pcm_ring_t *ring, size_t bytes, TickType_t timeout);
+
+/**
+ * @brief Drop everything waiting (consumer only)
+ */
+void pcm_ring_reset(pcm_ring_t *ring);
+
+/**
+ * @brief Bytes waiting (either side)
+ */
+size_t pcm_ring_fill(const pcm_ring_t *ring);
+
+static inline size_t pcm_ring_size(const pcm_ring_t *ring)
+{
+    return ring ? ring->size : 0;
+}
+
+/**
+ * @brief Snapshot the counters (any task); a NULL ring reads as all zero
+ */
+void pcm_ring_get_stats(pcm_ring_t *ring, pcm_ring_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,168 @@
+#include "pcm_ring.h"
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "audio_arena.h"
+
+static inline size_t ring_distance(const pcm_ring_t *ring, size_t head, size_t tail)
+{
+    return head >= tail ? head - tail : head + 2 * ring->size - tail;
+}
+
+static inline size_t ring_advance(const pcm_ring_t *ring, size_t pos, size_t len)
+{
+    pos += len;
+    return pos >= 2 * ring->size ? pos - 2 * ring->size : pos;
+}
+
+static inline size_t ring_index(const pcm_ring_t *ring, size_t pos)
+{
+    return pos >= ring->size ? pos - ring->size : pos;
+}
+
+pcm_ring_t *pcm_ring_create(size_t frames, size_t frame_bytes)
+{
+    if (frames == 0 || frame_bytes == 0) {
+        return NULL;
+    }
+    pcm_ring_t *ring = audio_arena_calloc(AUDIO_ARENA_CAPTURE, sizeof(*ring), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!ring) {
+        return NULL;
+    }
+    ring->size = frames * frame_bytes;
+    ring->frame_bytes = frame_bytes;
+    // Internal RAM: the capture callback and the sender both touch every byte
+    ring->buf = audio_arena_alloc(AUDIO_ARENA_CAPTURE, ring->size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!ring->buf) {
+        audio_arena_free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void pcm_ring_delete(pcm_ring_t *ring)
+{
+    if (!ring) {
+        return;
+    }
+    audio_arena_free(ring->buf);
+    audio_arena_free(ring);
+}
+
+size_t pcm_ring_write(pcm_ring_t *ring, const void *data, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    size_t want = len - len % ring->frame_bytes;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t fill = ring_distance(ring, head, tail);
+    size_t n = want < ring->size - fill ? want : ring->size - fill;
+
+    size_t at = ring_index(ring, head);
+    size_t first = ring->size - at < n ? ring->size - at : n;
+    memcpy(ring->buf + at, src, first);
+    memcpy(ring->buf, src + first, n - first);
+    head = ring_advance(ring, head, n);
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+
+    atomic_fetch_add_explicit(&ring->writes, 1, memory_order_relaxed);
+    if (n < want) {
+        atomic_fetch_add_explicit(&ring->dropped_writes, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->dropped_frames, (want - n) / ring->frame_bytes, memory_order_relaxed);
+    }
+    fill += n;
+    if (fill > atomic_load_explicit(&ring->peak_fill, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->peak_fill, fill, memory_order_relaxed);
+    }
+
+    // Pairs with the fence in pcm_ring_wait(): either we see the waiter, or it sees our head
+    atomic_thread_fence(memory_order_seq_cst);
+    TaskHandle_t waiter = atomic_load_explicit(&ring->waiter, memory_order_relaxed);
+    if (waiter && fill >= atomic_load_explicit(&ring->watermark, memory_order_relaxed) &&
+        atomic_compare_exchange_strong(&ring->waiter, &waiter, NULL)) {
+        xTaskNotifyGive(waiter);
+        atomic_fetch_add_explicit(&ring->wakeups, 1, memory_order_relaxed);
+    }
+    return n;
+}
+
+size_t pcm_ring_peek(pcm_ring_t *ring, const uint8_t **data, size_t max)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t fill = ring_distance(ring, head, tail);
+    size_t at = ring_index(ring, tail);
+    size_t n = ring->size - at;
+    max -= max % ring->frame_bytes;
+    if (n > fill) {
+        n = fill;
+    }
+    if (n > max) {
+        n = max;
+    }
+    *data = ring->buf + at;
+    return n;
+}
+
+void pcm_ring_consume(pcm_ring_t *ring, size_t len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, ring_advance(ring, tail, len), memory_order_release);
+}
+
+bool pcm_ring_wait(pcm_ring_t *ring, size_t bytes, TickType_t timeout)
+{
+    if (bytes > ring->size) {
+        bytes = ring->size;
+    }
+    const TickType_t start = xTaskGetTickCount();
+    while (pcm_ring_fill(ring) < bytes) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        atomic_store_explicit(&ring->watermark, bytes, memory_order_relaxed);
+        atomic_store_explicit(&ring->waiter, xTaskGetCurrentTaskHandle(), memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (pcm_ring_fill(ring) < bytes) {
+            ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+        }
+        // Cleared by the producer if it notified; a notification still in flight only
+        // costs the next wait one extra look
+        atomic_store_explicit(&ring->waiter, NULL, memory_order_relaxed);
+    }
+    return true;
+}
+
+void pcm_ring_reset(pcm_ring_t *ring)
+{
+    atomic_store_explicit(&ring->tail, atomic_load_explicit(&ring->head, memory_order_acquire),
+                          memory_order_release);
+}
+
+size_t pcm_ring_fill(const pcm_ring_t *ring)
+{
+    if (!ring) {
+        return 0;
+    }
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return ring_distance(ring, head, tail);
+}
+
+void pcm_ring_get_stats(pcm_ring_t *ring, pcm_ring_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!ring) {
+        return;
+    }
+    stats->writes = (uint32_t)atomic_load_explicit(&ring->writes, memory_order_relaxed);
+    stats->dropped_writes = (uint32_t)atomic_load_explicit(&ring->dropped_writes, memory_order_relaxed);
+    stats->dropped_frames = (uint32_t)atomic_load_explicit(&ring->dropped_frames, memory_order_relaxed);
+    stats->wakeups = (uint32_t)atomic_load_explicit(&ring->wakeups, memory_order_relaxed);
+    stats->fill = (uint32_t)pcm_ring_fill(ring);
+    stats->peak_fill = (uint32_t)atomic_load_explicit(&ring->peak_fill, memory_order_relaxed);
+    stats->size = (uint32_t)ring->size;
+}
@@ -0,0 +1,19 @@
+/*
+ * Baselines for the host benchmarks: HOST_BASELINE(key, value, tolerance_pct).
+ *
+ * Timing figures are nanoseconds per call on the host that recorded them (see
+ * README.md); a run more than tolerance_pct and HOST_BENCH_SLACK_NS above one
+ * fails. The PLL settling times come from a fixed-seed simulation and must
+ * match exactly, so they take a tolerance of 0 and fail on any change.
+ *
+ * Update by pasting the lines a run prints after "baselines.h:".
+ */
+HOST_BASELINE("buf_push",        92, 100)
+HOST_BASELINE("buf_pop",        165, 100)
+HOST_BASELINE("rtcp_playout",    37, 100)
+HOST_BASELINE("rtcp_unwrap",      4, 100)
+HOST_BASELINE("pll_settle+0",     0,   0)
+HOST_BASELINE("pll_settle+50",    0,   0)
+HOST_BASELINE("pll_settle-100",   0,   0)
+HOST_BASELINE("spdif_s16",        1, 100)
+HOST_BASELINE("spdif_s24",        2, 100)
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "metrics_bench.h"
+#include "host_bench.h"
+
+static const char *TAG = "bench";
+
+// Timing figures of a few nanoseconds move by this much from run to run alone
+#define HOST_BENCH_SLACK_NS 5
+
+typedef struct {
+    const char *key;
+    uint32_t value;
+    uint32_t tolerance_pct;
+    uint32_t seen;
+    bool reported;
+} host_baseline_t;
+
+static host_baseline_t baselines[] = {
+#define HOST_BASELINE(key, value, tolerance_pct) { key, value, tolerance_pct, 0, false },
+#include "baselines.h"
+#undef HOST_BASELINE
+};
+
+#define HOST_BASELINE_COUNT (sizeof(baselines) / sizeof(baselines[0]))
+
+static int failures;
+
+void host_bench_fail(void)
+{
+    failures++;
+}
+
+void metrics_bench_check(const char *key, uint32_t value)
+{
+    host_baseline_t *b = NULL;
+    for (size_t i = 0; i < HOST_BASELINE_COUNT; i++) {
+        if (strcmp(baselines[i].key, key) == 0) {
+            b = &baselines[i];
+            break;
+        }
+    }
+    if (!b) {
+        ESP_LOGE(TAG, "%s: %u (no baseline in baselines.h)", key, (unsigned)value);
+        failures++;
+        return;
+    }
+    b->seen = value;
+    b->reported = true;
+
+    if (b->tolerance_pct == 0 && value != b->value) {
+        ESP_LOGE(TAG, "%s: %u changed from baseline %u", key, (unsigned)value, (unsigned)b->value);
+        failures++;
+    } else if (b->tolerance_pct != 0 && value > b->value + HOST_BENCH_SLACK_NS &&
+               (uint64_t)value * 100u > (uint64_t)b->value * (100u + b->tolerance_pct)) {
+        ESP_LOGE(TAG, "%s: %u regressed %u%% from baseline %u", key, (unsigned)value,
+                 (unsigned)(((uint64_t)value - b->value) * 100u / (b->value ? b->value : 1u)),
+                 (unsigned)b->value);
+        failures++;
+    } else if (value + HOST_BENCH_SLACK_NS < b->value &&
+               (uint64_t)value * (100u + b->tolerance_pct) < (uint64_t)b->value * 100u) {
+        ESP_LOGI(TAG, "%s: %u improved on baseline %u, consider updating it", key, (unsigned)value,
+                 (unsigned)b->value);
+    } else {
+        ESP_LOGI(TAG, "%s: %u (baseline %u)", key, (unsigned)value, (unsigned)b->value);
+    }
+}
+
+int host_bench_report(void)
+{
+    ESP_LOGI(TAG, "baselines.h:");
+    for (size_t i = 0; i < HOST_BASELINE_COUNT; i++) {
+        host_baseline_t *b = &baselines[i];
+        if (!b->reported) {
+            ESP_LOGE(TAG, "%s: not reported by any benchmark", b->key);
+            failures++;
+            continue;
+        }
+        printf("HOST_BASELINE(\"%s\", %u, %u)\n", b->key, (unsigned)b->seen, (unsigned)b->tolerance_pct);
+    }
+    return failures;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * metrics_bench_check() for the host build: figures are compared with the
+ * checked-in table in baselines.h instead of the best value kept in NVS.
+ */
+
+/**
+ * @brief Count a failed correctness check (logged by the caller)
+ */
+void host_bench_fail(void);
+
+/**
+ * @brief Log the figures of this run as baselines.h lines
+ * @return Failed checks and regressed figures so far
+ */
+int host_bench_report(void);
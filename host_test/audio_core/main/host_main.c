@@ -0,0 +1,159 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "audio_arena.h"
+#include "buffer.h"
+#include "rtcp_receiver.h"
+#include "metrics_bench.h"
+#include "spdif_bmc.h"
+#include "host_bench.h"
+
+/*
+ * Host run of the audio core's startup benchmarks plus the correctness checks
+ * they rely on. setup_buffer() and rtcp_init() run the buffer, playout and PLL
+ * benchmarks themselves, as they do at boot with the options on; the encoder
+ * and the RTP timestamp unwrap are driven from here. Exits non-zero when a
+ * check fails or a figure regressed from baselines.h.
+ */
+
+static const char *TAG = "host";
+
+#define HOST_UNWRAP_SSRC   0x0BADCAFEu
+#define HOST_BENCH_SSRC    0x0BADF00Du
+#define HOST_UNWRAP_ITERS  20000
+#define HOST_UNWRAP_STEP   288u     // One 6 ms packet at 48 kHz
+
+// CRC-32 of both encoded half blocks of the fixed test signal, from the encoder
+// as it stands; a change to the encoder's output shows up here
+#define HOST_BMC_CRC_S16   0x53f5eec5u
+#define HOST_BMC_CRC_S24   0x94556073u
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            ESP_LOGE(TAG, __VA_ARGS__); \
+            host_bench_fail(); \
+        } \
+    } while (0)
+
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1u));
+        }
+    }
+    return ~crc;
+}
+
+// Both half blocks of a fixed signal through each encoder: the sample words of the
+// 16-bit encoder must match the byte-table reference, and the output its CRC
+static void check_bmc(void)
+{
+    static uint32_t out[SPDIF_BUF_ARRAY_SIZE];
+    static uint32_t ref[SPDIF_BUF_ARRAY_SIZE];
+    static uint32_t pre[SPDIF_BUF_DIV][SPDIF_BUF_ARRAY_SIZE / 2];
+    static uint8_t pcm[SPDIF_BUF_FRAMES * PCM_FRAME_S24];
+
+    uint32_t x = 0xC0FFEE01u;
+    for (size_t i = 0; i < sizeof(pcm); i++) {
+        x = x * 1664525u + 1013904223u;
+        pcm[i] = (uint8_t)(x >> 24);
+    }
+
+    uint32_t crc = 0;
+    spdif_bmc_build_block(pre, 48000, false);
+    for (int half = 0; half < SPDIF_BUF_DIV; half++) {
+        spdif_bmc_encode_s16(out, pcm, pre[half]);
+        memcpy(ref, out, sizeof(ref));
+        spdif_bmc_encode_s16_bytes(ref, pcm);
+        CHECK(memcmp(out, ref, sizeof(out)) == 0, "BMC s16: half %d differs from the byte-table encoder", half);
+        CHECK(out[0] == pre[half][0], "BMC s16: half %d lost its preamble word", half);
+        crc = crc32_update(crc, out, sizeof(out));
+    }
+    CHECK(crc == HOST_BMC_CRC_S16, "BMC s16: CRC 0x%08x, expected 0x%08x", (unsigned)crc, (unsigned)HOST_BMC_CRC_S16);
+
+    crc = 0;
+    spdif_bmc_build_block(pre, 48000, true);
+    for (int half = 0; half < SPDIF_BUF_DIV; half++) {
+        spdif_bmc_encode_s24(out, pcm, pre[half]);
+        crc = crc32_update(crc, out, sizeof(out));
+    }
+    CHECK(crc == HOST_BMC_CRC_S24, "BMC s24: CRC 0x%08x, expected 0x%08x", (unsigned)crc, (unsigned)HOST_BMC_CRC_S24);
+}
+
+static uint64_t unwrap(uint32_t ssrc, uint32_t rtp32)
+{
+    uint64_t rtp64 = 0;
+    esp_err_t err = rtcp_unwrap_rtp_timestamp(ssrc, rtp32, &rtp64);
+    CHECK(err == ESP_OK, "unwrap of %u failed: %s", (unsigned)rtp32, esp_err_to_name(err));
+    return rtp64;
+}
+
+// A stream crossing the 32-bit wrap, forward and with a packet reordered across it
+static void check_unwrap(void)
+{
+    static const struct {
+        uint32_t rtp32;
+        uint64_t rtp64;
+    } steps[] = {
+        { 0xFFFFF000u, 0x0FFFFF000ull },
+        { 0xFFFFF120u, 0x0FFFFF120ull },
+        { 0x00000040u, 0x100000040ull },   // wrapped
+        { 0xFFFFF800u, 0x0FFFFF800ull },   // late packet from before the wrap
+        { 0x00000160u, 0x100000160ull },
+        { 0x3FFFFFFFu, 0x13FFFFFFFull },
+    };
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        uint64_t got = unwrap(HOST_UNWRAP_SSRC, steps[i].rtp32);
+        CHECK(got == steps[i].rtp64, "unwrap step %u: 0x%08x -> 0x%llx, expected 0x%llx", (unsigned)i,
+              (unsigned)steps[i].rtp32, (unsigned long long)got, (unsigned long long)steps[i].rtp64);
+    }
+}
+
+// Cycles per unwrap on an in-order stream that wraps a few times along the way
+static void benchmark_unwrap(void)
+{
+    uint32_t rtp32 = 0;
+    uint64_t last = unwrap(HOST_BENCH_SSRC, rtp32);
+    bool monotonic = true;
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < HOST_UNWRAP_ITERS; i++) {
+        rtp32 += HOST_UNWRAP_STEP * 0x10000u;   // Skip ahead so the loop wraps
+        uint64_t rtp64 = 0;
+        rtcp_unwrap_rtp_timestamp(HOST_BENCH_SSRC, rtp32, &rtp64);
+        monotonic &= rtp64 > last;
+        last = rtp64;
+    }
+    uint32_t cycles = (esp_cpu_get_cycle_count() - t0) / HOST_UNWRAP_ITERS;
+    CHECK(monotonic, "unwrap benchmark: timeline went backwards");
+    ESP_LOGI(TAG, "Unwrap benchmark: %u cycles/call, %u wraps", (unsigned)cycles, (unsigned)(last >> 32));
+    metrics_bench_check("rtcp_unwrap", cycles);
+}
+
+void app_main(void)
+{
+    CHECK(audio_arena_init() == ESP_OK, "audio_arena_init failed");
+    setup_buffer();
+
+    CHECK(rtcp_init() == ESP_OK, "rtcp_init failed");
+    check_unwrap();
+    benchmark_unwrap();
+    rtcp_deinit();
+
+    check_bmc();
+    spdif_bmc_benchmark(48000);
+
+    int failures = host_bench_report();
+    if (failures) {
+        ESP_LOGE(TAG, "%d check(s) failed", failures);
+    } else {
+        ESP_LOGI(TAG, "All checks passed");
+    }
+    exit(failures ? 1 : 0);
+}
@@ -0,0 +1,90 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "config.h"
+#include "lifecycle_manager.h"
+#include "audio_out.h"
+#include "clock/clock_service.h"
+
+/*
+ * What the benchmarked code reads from the rest of the firmware, answered with
+ * the firmware's default settings (config.h) and a clock service that is not
+ * locked to any master.
+ */
+
+// Master time runs this far ahead of the monotonic clock (about 2024 in Unix microseconds)
+#define HOST_MASTER_OFFSET_US  1700000000000000LL
+// Seconds from the NTP epoch (1900) to the Unix epoch (1970)
+#define HOST_NTP_UNIX_OFFSET_S 2208988800ULL
+
+uint32_t lifecycle_get_sample_rate(void)
+{
+    return SAMPLE_RATE;
+}
+
+uint8_t lifecycle_get_ptime_ms(void)
+{
+    return PTIME_MS;
+}
+
+bool lifecycle_get_low_latency(void)
+{
+    return false;
+}
+
+uint8_t lifecycle_get_initial_buffer_size(void)
+{
+    return INITIAL_BUFFER_SIZE;
+}
+
+uint8_t lifecycle_get_max_buffer_size(void)
+{
+    return MAX_BUFFER_SIZE;
+}
+
+uint8_t lifecycle_get_buffer_grow_step_size(void)
+{
+    return BUFFER_GROW_STEP_SIZE;
+}
+
+uint8_t lifecycle_get_max_grow_size(void)
+{
+    return MAX_GROW_SIZE;
+}
+
+uint16_t lifecycle_get_buffer_target_ms(void)
+{
+    return BUFFER_TARGET_MS;
+}
+
+uint16_t lifecycle_get_buffer_max_ms(void)
+{
+    return BUFFER_MAX_MS;
+}
+
+uint8_t audio_out_sample_bits(void)
+{
+    return 16;
+}
+
+int64_t clock_service_mono_to_master(int64_t mono_us)
+{
+    return mono_us + HOST_MASTER_OFFSET_US;
+}
+
+int64_t clock_service_master_to_mono(int64_t master_us)
+{
+    return master_us - HOST_MASTER_OFFSET_US;
+}
+
+uint64_t clock_service_ntp64_at(int64_t mono_us)
+{
+    uint64_t unix_us = (uint64_t)clock_service_mono_to_master(mono_us);
+    uint64_t sec = unix_us / 1000000u + HOST_NTP_UNIX_OFFSET_S;
+    uint64_t frac = ((unix_us % 1000000u) << 32) / 1000000u;
+    return (sec << 32) | frac;
+}
+
+bool clock_service_is_locked(void)
+{
+    return false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * The linux target has no cycle counter: "cycles" on the host are nanoseconds
+ * of CLOCK_MONOTONIC, and everything runs on core 0.
+ */
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static inline int esp_cpu_get_core_id(void)
+{
+    return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-seed xorshift on the host, so runs are repeatable
+static inline uint32_t esp_random(void)
+{
+    static uint32_t x = 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The setting getters the jitter buffer reads, answered by host_stubs.c
+uint32_t lifecycle_get_sample_rate(void);
+uint8_t lifecycle_get_ptime_ms(void);
+bool lifecycle_get_low_latency(void);
+uint8_t lifecycle_get_initial_buffer_size(void);
+uint8_t lifecycle_get_max_buffer_size(void);
+uint8_t lifecycle_get_buffer_grow_step_size(void);
+uint8_t lifecycle_get_max_grow_size(void);
+uint16_t lifecycle_get_buffer_target_ms(void);
+uint16_t lifecycle_get_buffer_max_ms(void);
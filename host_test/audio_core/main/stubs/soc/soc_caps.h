@@ -0,0 +1,4 @@
+#pragma once
+
+// One core on the host (metrics keep a counter slot per core)
+#define SOC_CPU_CORES_NUM 1
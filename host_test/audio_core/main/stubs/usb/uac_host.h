@@ -0,0 +1,4 @@
+#pragma once
+
+// global.h declares the USB speaker handle; no USB host on the linux target
+typedef struct uac_host_device *uac_host_device_handle_t;
@@ -11,6 +11,249 @@
 #ifndef CONFIG_PCM_CHUNK_SIZE
 #define CONFIG_PCM_CHUNK_SIZE 1152
 #endif
+#ifndef CONFIG_PCM_CHUNK_MAX_SIZE
+#define CONFIG_PCM_CHUNK_MAX_SIZE 3840   /* 20 ms at 48 kHz, 16-bit stereo */
+#endif
+#ifndef CONFIG_RTP_PTIME_MS
+#define CONFIG_RTP_PTIME_MS 6
+#endif
+#ifndef CONFIG_RX_CHANNEL_LEFT
+#define CONFIG_RX_CHANNEL_LEFT 0
+#endif
+#ifndef CONFIG_RX_CHANNEL_RIGHT
+#define CONFIG_RX_CHANNEL_RIGHT 1
+#endif
+
+/* Receiver packet loss concealment */
+#if !defined(CONFIG_RX_PLC_MODE_SILENCE) && !defined(CONFIG_RX_PLC_MODE_REPEAT_FADE) && \
+    !defined(CONFIG_RX_PLC_MODE_WSOLA)
+#define CONFIG_RX_PLC_MODE_REPEAT_FADE 1
+#endif
+#ifndef CONFIG_RX_PLC_FADE_CHUNKS
+#define CONFIG_RX_PLC_FADE_CHUNKS 3
+#endif
+
+/* Receiver jitter buffer sizing */
+#ifndef CONFIG_RX_BUFFER_TARGET_MS
+#define CONFIG_RX_BUFFER_TARGET_MS 0
+#endif
+#ifndef CONFIG_RX_BUFFER_MAX_MS
+#define CONFIG_RX_BUFFER_MAX_MS 0
+#endif
+#ifndef CONFIG_RX_BUFFER_INTERNAL_MAX_KB
+#define CONFIG_RX_BUFFER_INTERNAL_MAX_KB 48
+#endif
+
+/* Receiver latency controller */
+#ifndef CONFIG_RX_LATENCY_SHRINK_CLEAN_MS
+#define CONFIG_RX_LATENCY_SHRINK_CLEAN_MS 30000
+#endif
+#ifndef CONFIG_RX_LATENCY_JITTER_MULT
+#define CONFIG_RX_LATENCY_JITTER_MULT 4
+#endif
+#ifndef CONFIG_RX_LATENCY_DRAIN_FRAMES
+#define CONFIG_RX_LATENCY_DRAIN_FRAMES 8
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_PTIME_MS
+#define CONFIG_RX_LOW_LATENCY_PTIME_MS 2
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_TARGET_CHUNKS
+#define CONFIG_RX_LOW_LATENCY_TARGET_CHUNKS 1
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_MAX_CHUNKS
+#define CONFIG_RX_LOW_LATENCY_MAX_CHUNKS 2
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_PLAYOUT_MS
+#define CONFIG_RX_LOW_LATENCY_PLAYOUT_MS 5
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_LATE_MS
+#define CONFIG_RX_LOW_LATENCY_LATE_MS 10
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_SPDIF_RING_MS
+#define CONFIG_RX_LOW_LATENCY_SPDIF_RING_MS 4
+#endif
+#ifndef CONFIG_RX_LOW_LATENCY_SPDIF_DMA_DESC
+#define CONFIG_RX_LOW_LATENCY_SPDIF_DMA_DESC 3
+#endif
+
+/* Receiver drift resampler (CONFIG_RX_RESAMPLER_ENABLED) */
+#ifndef CONFIG_RX_RESAMPLER_MAX_PPM
+#define CONFIG_RX_RESAMPLER_MAX_PPM 500
+#endif
+#ifndef CONFIG_RX_RESAMPLER_FILL_GAIN_PPM
+#define CONFIG_RX_RESAMPLER_FILL_GAIN_PPM 100
+#endif
+
+/* Receiver output clock steering (CONFIG_RX_CLOCK_STEER_ENABLED) */
+#ifndef CONFIG_RX_CLOCK_STEER_MAX_PPM
+#define CONFIG_RX_CLOCK_STEER_MAX_PPM 200
+#endif
+#ifndef CONFIG_RX_CLOCK_STEER_FILL_GAIN_PPM
+#define CONFIG_RX_CLOCK_STEER_FILL_GAIN_PPM 50
+#endif
+
+/* Receiver software volume (CONFIG_RX_VOLUME_SOFTWARE) */
+#ifndef CONFIG_RX_VOLUME_RAMP_MS
+#define CONFIG_RX_VOLUME_RAMP_MS 20
+#endif
+
+/* Receiver Scream ingest (CONFIG_RX_SCREAM_ENABLED) */
+#ifndef CONFIG_RX_SCREAM_PORT
+#define CONFIG_RX_SCREAM_PORT 0
+#endif
+
+/* Receiver Opus decoding (CONFIG_RX_OPUS_ENABLED) */
+#ifndef CONFIG_RX_OPUS_QUEUE_PACKETS
+#define CONFIG_RX_OPUS_QUEUE_PACKETS 8
+#endif
+
+/* lwIP raw receive backend (CONFIG_RTP_RX_BACKEND_LWIP_RAW) */
+#ifndef CONFIG_RTP_RX_LWIP_QUEUE_PACKETS
+#define CONFIG_RTP_RX_LWIP_QUEUE_PACKETS 16
+#endif
+
+/* RTCP source table (CONFIG_RTCP_ENABLED) */
+#ifndef CONFIG_RTCP_MAX_SSRC_SOURCES
+#define CONFIG_RTCP_MAX_SSRC_SOURCES 4
+#endif
+
+/* RTCP playout (CONFIG_RTCP_ENABLED) */
+#ifndef CONFIG_RTCP_TARGET_LATENCY_MS
+#define CONFIG_RTCP_TARGET_LATENCY_MS 50
+#endif
+
+/* RTCP receiver reports (CONFIG_RTCP_SEND_RR) */
+#ifndef CONFIG_RTCP_RR_MIN_INTERVAL_MS
+#define CONFIG_RTCP_RR_MIN_INTERVAL_MS 5000
+#endif
+
+/* RTCP generic NACK (CONFIG_RTCP_SEND_NACK) */
+#ifndef CONFIG_RTCP_NACK_MIN_BUFFER_MS
+#define CONFIG_RTCP_NACK_MIN_BUFFER_MS 40
+#endif
+#ifndef CONFIG_RTCP_NACK_RETRY_MS
+#define CONFIG_RTCP_NACK_RETRY_MS 20
+#endif
+
+/* RTCP sender reports (CONFIG_RTCP_SEND_SR) */
+#ifndef CONFIG_RTCP_SR_INTERVAL_MS
+#define CONFIG_RTCP_SR_INTERVAL_MS 2000
+#endif
+
+/* Sender retransmission on NACK (CONFIG_RTP_TX_RTX_ENABLED) */
+#ifndef CONFIG_RTP_TX_RTX_CACHE_PACKETS
+#define CONFIG_RTP_TX_RTX_CACHE_PACKETS 32
+#endif
+#ifndef CONFIG_RTP_TX_RTX_MAX_PER_SEC
+#define CONFIG_RTP_TX_RTX_MAX_PER_SEC 100
+#endif
+
+/* Sender adaptation to receiver reports (CONFIG_RTP_TX_ADAPT) */
+#ifndef CONFIG_RTP_TX_ADAPT_LOSS_UP_PERMILLE
+#define CONFIG_RTP_TX_ADAPT_LOSS_UP_PERMILLE 30
+#endif
+#ifndef CONFIG_RTP_TX_ADAPT_LOSS_DOWN_PERMILLE
+#define CONFIG_RTP_TX_ADAPT_LOSS_DOWN_PERMILLE 5
+#endif
+#ifndef CONFIG_RTP_TX_ADAPT_JITTER_UP_MS
+#define CONFIG_RTP_TX_ADAPT_JITTER_UP_MS 10
+#endif
+#ifndef CONFIG_RTP_TX_ADAPT_HOLD_REPORTS
+#define CONFIG_RTP_TX_ADAPT_HOLD_REPORTS 8
+#endif
+#ifndef CONFIG_RTP_TX_ADAPT_MAX_PTIME_MS
+#define CONFIG_RTP_TX_ADAPT_MAX_PTIME_MS 20
+#endif
+
+/* Sender packet pacing */
+#ifndef CONFIG_RTP_TX_PACE_MAX_PPM
+#define CONFIG_RTP_TX_PACE_MAX_PPM 5000
+#endif
+
+/* Sender discontinuous transmission */
+#ifndef CONFIG_RTP_TX_DTX_HANGOVER_MS
+#define CONFIG_RTP_TX_DTX_HANGOVER_MS 500
+#endif
+#ifndef CONFIG_RTP_TX_DTX_KEEPALIVE_MS
+#define CONFIG_RTP_TX_DTX_KEEPALIVE_MS 0
+#endif
+
+/* Sender unicast fan-out */
+#ifndef CONFIG_RTP_TX_FANOUT_MAX
+#define CONFIG_RTP_TX_FANOUT_MAX 8
+#endif
+#ifndef CONFIG_RTP_TX_FANOUT_MAX_FAILS
+#define CONFIG_RTP_TX_FANOUT_MAX_FAILS 50
+#endif
+#ifndef CONFIG_RTP_TX_FANOUT_RETRY_MS
+#define CONFIG_RTP_TX_FANOUT_RETRY_MS 30000
+#endif
+#ifndef CONFIG_RTP_TX_FANOUT_REFRESH_MS
+#define CONFIG_RTP_TX_FANOUT_REFRESH_MS 5000
+#endif
+
+/* Sender Opus encoding (CONFIG_RTP_TX_OPUS_ENABLED) */
+#ifndef CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE
+#define CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE 96
+#endif
+#ifndef CONFIG_RTP_TX_OPUS_FRAME_MS
+#define CONFIG_RTP_TX_OPUS_FRAME_MS 20
+#endif
+#ifndef CONFIG_RTP_TX_OPUS_BITRATE_KBPS
+#define CONFIG_RTP_TX_OPUS_BITRATE_KBPS 128
+#endif
+#ifndef CONFIG_RTP_TX_OPUS_COMPLEXITY
+#define CONFIG_RTP_TX_OPUS_COMPLEXITY 5
+#endif
+
+/* RTP parity FEC (CONFIG_RTP_FEC_ENABLED) */
+#ifndef CONFIG_RTP_FEC_PAYLOAD_TYPE
+#define CONFIG_RTP_FEC_PAYLOAD_TYPE 126
+#endif
+#ifndef CONFIG_RTP_FEC_GROUP_PACKETS
+#define CONFIG_RTP_FEC_GROUP_PACKETS 8
+#endif
+#ifndef CONFIG_RTP_FEC_WINDOW_PACKETS
+#define CONFIG_RTP_FEC_WINDOW_PACKETS 24
+#endif
+
+/* Receiver overlay mixer (CONFIG_RX_MIX_ENABLED) */
+#ifndef CONFIG_RX_MIX_MAX_STREAMS
+#define CONFIG_RX_MIX_MAX_STREAMS 2
+#endif
+#ifndef CONFIG_RX_MIX_STREAM_CHUNKS
+#define CONFIG_RX_MIX_STREAM_CHUNKS 32
+#endif
+#ifndef CONFIG_RX_MIX_IDLE_MS
+#define CONFIG_RX_MIX_IDLE_MS 1000
+#endif
+
+/* Gapless multicast stream switching (CONFIG_RX_GAPLESS_SWITCH) */
+#ifndef CONFIG_RX_SWITCH_FADE_MS
+#define CONFIG_RX_SWITCH_FADE_MS 50
+#endif
+#ifndef CONFIG_RX_SWITCH_QUEUE_CHUNKS
+#define CONFIG_RX_SWITCH_QUEUE_CHUNKS 32
+#endif
+#ifndef CONFIG_RX_SWITCH_TIMEOUT_MS
+#define CONFIG_RX_SWITCH_TIMEOUT_MS 2000
+#endif
+
+/* ESP-NOW relay (CONFIG_RTP_RELAY_ENABLED) */
+#ifndef CONFIG_RTP_RELAY_QUEUE_PACKETS
+#define CONFIG_RTP_RELAY_QUEUE_PACKETS 16
+#endif
+
+/* Wired Ethernet (CONFIG_NET_ETHERNET_ENABLED) */
+#ifndef CONFIG_NET_ETH_SPI_POLL_MS
+#define CONFIG_NET_ETH_SPI_POLL_MS 2
+#endif
+#ifndef CONFIG_NET_ETH_SPI_CLOCK_MHZ
+#define CONFIG_NET_ETH_SPI_CLOCK_MHZ 20
+#endif
+#ifndef CONFIG_NET_ETH_PHY_RST_GPIO
+#define CONFIG_NET_ETH_PHY_RST_GPIO -1
+#endif
 
 /* Networking (RTP/SAP) */
 #ifndef CONFIG_RTP_PORT
@@ -22,6 +265,9 @@
 #ifndef CONFIG_SAP_PULSEAUDIO_ADDR
 #define CONFIG_SAP_PULSEAUDIO_ADDR "224.0.0.56"
 #endif
+#ifndef CONFIG_RTP_RX_SELECT_TIMEOUT_MS
+#define CONFIG_RTP_RX_SELECT_TIMEOUT_MS 100
+#endif
 #ifndef CONFIG_SAP_PORT
 #define CONFIG_SAP_PORT 9875
 #endif
@@ -49,4 +295,179 @@
 #endif
 #ifndef CONFIG_VIZ_RING_SIZE
 #define CONFIG_VIZ_RING_SIZE (CONFIG_VIZ_CHUNK_SIZE * 4)
-#endif
\ No newline at end of file
+#endif
+/* Logging */
+#ifndef CONFIG_LOG_BUFFER_RING_SIZE
+#define CONFIG_LOG_BUFFER_RING_SIZE 4096
+#endif
+#ifndef CONFIG_LOG_BUFFER_DRAIN_PRIORITY
+#define CONFIG_LOG_BUFFER_DRAIN_PRIORITY 1
+#endif
+#ifndef CONFIG_LOG_BUFFER_DRAIN_INTERVAL_MS
+#define CONFIG_LOG_BUFFER_DRAIN_INTERVAL_MS 50
+#endif
+#ifndef CONFIG_EVENT_TRACE_DEPTH
+#define CONFIG_EVENT_TRACE_DEPTH 1024
+#endif
+#ifndef CONFIG_EVENT_TRACE_POST_MS
+#define CONFIG_EVENT_TRACE_POST_MS 250
+#endif
+#ifndef CONFIG_RTP_CAPTURE_RING_KB
+#define CONFIG_RTP_CAPTURE_RING_KB 256
+#endif
+#ifndef CONFIG_RTP_CAPTURE_SNAPLEN
+#define CONFIG_RTP_CAPTURE_SNAPLEN 64
+#endif
+/* Web Server */
+#ifndef CONFIG_WEB_STREAM_MAX_CLIENTS
+#define CONFIG_WEB_STREAM_MAX_CLIENTS 2
+#endif
+#ifndef CONFIG_WEB_STREAM_DEFAULT_HZ
+#define CONFIG_WEB_STREAM_DEFAULT_HZ 2
+#endif
+#ifndef CONFIG_WEB_STREAM_TASK_PRIORITY
+#define CONFIG_WEB_STREAM_TASK_PRIORITY 2
+#endif
+#ifndef CONFIG_WEB_CONTROL_MAX_CLIENTS
+#define CONFIG_WEB_CONTROL_MAX_CLIENTS 2
+#endif
+#ifndef CONFIG_WEB_ASYNC_WORKERS
+#define CONFIG_WEB_ASYNC_WORKERS 2
+#endif
+#ifndef CONFIG_WEB_ASYNC_QUEUE_LEN
+#define CONFIG_WEB_ASYNC_QUEUE_LEN 4
+#endif
+#ifndef CONFIG_WEB_ASYNC_TASK_PRIORITY
+#define CONFIG_WEB_ASYNC_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_WEB_SCAN_CACHE_TTL_MS
+#define CONFIG_WEB_SCAN_CACHE_TTL_MS 15000
+#endif
+/* Settings Storage */
+#ifndef CONFIG_SETTINGS_SAVE_DEBOUNCE_MS
+#define CONFIG_SETTINGS_SAVE_DEBOUNCE_MS 1000
+#endif
+#ifndef CONFIG_SETTINGS_SAVE_MAX_DELAY_MS
+#define CONFIG_SETTINGS_SAVE_MAX_DELAY_MS 5000
+#endif
+/* OTA Updates */
+#ifndef CONFIG_OTA_PIPELINE_BUFFERS
+#define CONFIG_OTA_PIPELINE_BUFFERS 2
+#endif
+#ifndef CONFIG_OTA_PIPELINE_CHUNK_KB
+#define CONFIG_OTA_PIPELINE_CHUNK_KB 16
+#endif
+#ifndef CONFIG_OTA_WRITER_CORE
+#define CONFIG_OTA_WRITER_CORE 0
+#endif
+#ifndef CONFIG_OTA_WRITER_TASK_PRIORITY
+#define CONFIG_OTA_WRITER_TASK_PRIORITY 4
+#endif
+#ifndef CONFIG_OTA_PROGRESS_INTERVAL_MS
+#define CONFIG_OTA_PROGRESS_INTERVAL_MS 250
+#endif
+#ifndef CONFIG_OTA_PLAY_SECTOR_GAP_MS
+#define CONFIG_OTA_PLAY_SECTOR_GAP_MS 10
+#endif
+#ifndef CONFIG_OTA_PLAY_MAX_WAIT_MS
+#define CONFIG_OTA_PLAY_MAX_WAIT_MS 500
+#endif
+
+/* Idle Power */
+#ifndef CONFIG_RX_IDLE_BACKGROUND_TICK_MS
+#define CONFIG_RX_IDLE_BACKGROUND_TICK_MS 1000
+#endif
+#ifndef CONFIG_USB_ATTACH_WAKE_GPIO
+#define CONFIG_USB_ATTACH_WAKE_GPIO 20
+#endif
+#ifndef CONFIG_USB_ATTACH_WAKE_IDLE_S
+#define CONFIG_USB_ATTACH_WAKE_IDLE_S 60
+#endif
+#ifndef CONFIG_USB_ATTACH_WAKE_SETTLE_MS
+#define CONFIG_USB_ATTACH_WAKE_SETTLE_MS 50
+#endif
+
+/* CPU Governor */
+#ifndef CONFIG_CPU_GOV_LOW_LOAD_PCT
+#define CONFIG_CPU_GOV_LOW_LOAD_PCT 50
+#endif
+#ifndef CONFIG_CPU_GOV_WINDOW_MS
+#define CONFIG_CPU_GOV_WINDOW_MS 500
+#endif
+#ifndef CONFIG_CPU_GOV_DOWN_HOLD_MS
+#define CONFIG_CPU_GOV_DOWN_HOLD_MS 5000
+#endif
+#ifndef CONFIG_CPU_GOV_UNDERRUN_HOLD_MS
+#define CONFIG_CPU_GOV_UNDERRUN_HOLD_MS 30000
+#endif
+
+/* Pipeline Topology */
+#ifndef CONFIG_PIPELINE_TOPOLOGY_DEFAULT_ID
+#define CONFIG_PIPELINE_TOPOLOGY_DEFAULT_ID 1
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_INGEST_CORE
+#define CONFIG_PIPELINE_CUSTOM_INGEST_CORE 0
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_INGEST_PRIORITY
+#define CONFIG_PIPELINE_CUSTOM_INGEST_PRIORITY 6
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_PLAYOUT_CORE
+#define CONFIG_PIPELINE_CUSTOM_PLAYOUT_CORE 1
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_PLAYOUT_PRIORITY
+#define CONFIG_PIPELINE_CUSTOM_PLAYOUT_PRIORITY 6
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_SEND_CORE
+#define CONFIG_PIPELINE_CUSTOM_SEND_CORE 0
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_SEND_PRIORITY
+#define CONFIG_PIPELINE_CUSTOM_SEND_PRIORITY 6
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_DECODE_CORE
+#define CONFIG_PIPELINE_CUSTOM_DECODE_CORE 1
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_DECODE_PRIORITY
+#define CONFIG_PIPELINE_CUSTOM_DECODE_PRIORITY 5
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_ENCODE_CORE
+#define CONFIG_PIPELINE_CUSTOM_ENCODE_CORE 1
+#endif
+#ifndef CONFIG_PIPELINE_CUSTOM_ENCODE_PRIORITY
+#define CONFIG_PIPELINE_CUSTOM_ENCODE_PRIORITY 5
+#endif
+
+/* Boot and Lifecycle */
+#ifndef CONFIG_BOOT_AUDIO_FIRST_MAX_WAIT_MS
+#define CONFIG_BOOT_AUDIO_FIRST_MAX_WAIT_MS 4000
+#endif
+#ifndef CONFIG_BOOT_WORKER_STACK_SIZE
+#define CONFIG_BOOT_WORKER_STACK_SIZE 8192
+#endif
+#ifndef CONFIG_LIFECYCLE_TRACE_DEPTH
+#define CONFIG_LIFECYCLE_TRACE_DEPTH 64
+#endif
+#ifndef CONFIG_TASK_STATS_PERIOD_MS
+#define CONFIG_TASK_STATS_PERIOD_MS 1000
+#endif
+
+/* Sender auto-selection (CONFIG_RTP_TX_AUTO_SELECT) */
+#ifndef CONFIG_RTP_TX_AUTO_SELECT_EVAL_MS
+#define CONFIG_RTP_TX_AUTO_SELECT_EVAL_MS 5000
+#endif
+#ifndef CONFIG_RTP_TX_AUTO_SELECT_PROBE_MS
+#define CONFIG_RTP_TX_AUTO_SELECT_PROBE_MS 2000
+#endif
+#ifndef CONFIG_RTP_TX_AUTO_SELECT_MARGIN
+#define CONFIG_RTP_TX_AUTO_SELECT_MARGIN 150
+#endif
+#ifndef CONFIG_RTP_TX_AUTO_SELECT_HOLD
+#define CONFIG_RTP_TX_AUTO_SELECT_HOLD 3
+#endif
+
+/* End-to-end latency probes (CONFIG_RTP_LATENCY_PROBE) */
+#ifndef CONFIG_RTP_LATENCY_PROBE_INTERVAL
+#define CONFIG_RTP_LATENCY_PROBE_INTERVAL 50
+#endif
+#ifndef CONFIG_RTP_LATENCY_PROBE_EXT_ID
+#define CONFIG_RTP_LATENCY_PROBE_EXT_ID 5
+#endif
@@ -0,0 +1,202 @@
+#include "clock_service.h"
+#include "receiver/rtcp_receiver.h"   // NTP epoch and fraction helpers
+#include "ntp_client.h"
+#ifdef CONFIG_PTP_ENABLED
+#include "ptp_slave.h"
+#endif
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#include <sys/time.h>
+
+static const char *TAG = "clock_service";
+
+// Largest skew taken from the PLL; beyond this it is not tracking a real crystal
+#define CLOCK_SERVICE_SKEW_LIMIT_PPB  1000000
+#define CLOCK_SERVICE_READ_RETRIES    4
+
+// master(mono) = master_anchor + d + d * skew, d = mono - mono_anchor
+typedef struct {
+    int64_t mono_anchor_us;
+    int64_t master_anchor_us;
+    int32_t skew_ppb;
+    clock_source_t source;
+    int64_t refreshed_us;       // Monotonic time of the refresh; 0 before the first
+    uint32_t refreshes;
+    uint32_t source_changes;
+    uint32_t steps;
+} clock_map_t;
+
+// Published mapping: seqlock (odd while written) so the RTP path never blocks on a refresh.
+// One writer at a time, chosen by s_refreshing.
+static atomic_uint s_seq;
+static clock_map_t s_map;
+static atomic_flag s_refreshing = ATOMIC_FLAG_INIT;
+
+static inline int64_t clock_apply(const clock_map_t *m, int64_t mono_us) {
+    int64_t d = mono_us - m->mono_anchor_us;
+    return m->master_anchor_us + d + d * m->skew_ppb / 1000000000LL;
+}
+
+// Current mapping from the PTP servo, else the NTP PLL, else the wall clock
+static void clock_build(int64_t now_mono, clock_map_t *m) {
+    double offset_us = 0.0;
+    double skew_ppm = 0.0;
+    m->mono_anchor_us = now_mono;
+    m->refreshed_us = now_mono;
+#ifdef CONFIG_PTP_ENABLED
+    int64_t utc_us = 0;
+    int32_t ptp_ppb = 0;
+    if (ptp_slave_mono_to_utc(now_mono, &utc_us, &ptp_ppb)) {
+        if (ptp_ppb > CLOCK_SERVICE_SKEW_LIMIT_PPB) ptp_ppb = CLOCK_SERVICE_SKEW_LIMIT_PPB;
+        if (ptp_ppb < -CLOCK_SERVICE_SKEW_LIMIT_PPB) ptp_ppb = -CLOCK_SERVICE_SKEW_LIMIT_PPB;
+        m->master_anchor_us = utc_us;
+        m->skew_ppb = ptp_ppb;
+        m->source = CLOCK_SOURCE_PTP;
+        return;
+    }
+#endif
+    if (ntp_get_pll_state(&offset_us, &skew_ppm)) {
+        // Same line the PLL uses: master = (1 + skew) * mono + offset
+        double a = 1.0 + skew_ppm * 1e-6;
+        double ppb = skew_ppm * 1000.0;
+        if (ppb > CLOCK_SERVICE_SKEW_LIMIT_PPB) ppb = CLOCK_SERVICE_SKEW_LIMIT_PPB;
+        if (ppb < -CLOCK_SERVICE_SKEW_LIMIT_PPB) ppb = -CLOCK_SERVICE_SKEW_LIMIT_PPB;
+        m->master_anchor_us = (int64_t)(a * (double)now_mono + offset_us);
+        m->skew_ppb = (int32_t)ppb;
+        m->source = CLOCK_SOURCE_NTP_PLL;
+    } else {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        int64_t wall_us = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+        m->master_anchor_us = wall_us - (esp_timer_get_time() - now_mono);
+        m->skew_ppb = 0;
+        m->source = CLOCK_SOURCE_SYSTEM;
+    }
+}
+
+static bool clock_read(clock_map_t *out) {
+    for (int i = 0; i < CLOCK_SERVICE_READ_RETRIES; i++) {
+        unsigned seq = atomic_load_explicit(&s_seq, memory_order_acquire);
+        if (seq & 1U) {
+            continue;
+        }
+        *out = s_map;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s_seq, memory_order_relaxed) == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rebuild and publish; false if another task is already doing it
+static bool clock_refresh(int64_t now_mono, clock_map_t *out) {
+    if (atomic_flag_test_and_set_explicit(&s_refreshing, memory_order_acquire)) {
+        return false;
+    }
+    // Sole writer: s_map is stable here
+    const clock_map_t prev = s_map;
+    clock_map_t next;
+    clock_build(now_mono, &next);
+    next.refreshes = prev.refreshes + 1U;
+    next.source_changes = prev.source_changes;
+    next.steps = prev.steps;
+    if (prev.refreshed_us != 0) {
+        if (next.source != prev.source) {
+            next.source_changes++;
+            if (next.source == CLOCK_SOURCE_PTP) {
+                ESP_LOGI(TAG, "Master clock: PTP locked (skew %ld ppb)", (long)next.skew_ppb);
+            } else if (next.source == CLOCK_SOURCE_NTP_PLL) {
+                ESP_LOGI(TAG, "Master clock: NTP PLL locked (skew %ld ppb)", (long)next.skew_ppb);
+            } else {
+                ESP_LOGW(TAG, "Master clock: NTP PLL lost, using the system clock");
+            }
+        } else {
+            int64_t jump = next.master_anchor_us - clock_apply(&prev, now_mono);
+            if (jump > CLOCK_SERVICE_STEP_US || jump < -CLOCK_SERVICE_STEP_US) {
+                next.steps++;
+                ESP_LOGD(TAG, "Master clock stepped %lld us", (long long)jump);
+            }
+        }
+    }
+
+    unsigned seq = atomic_load_explicit(&s_seq, memory_order_relaxed);
+    atomic_store_explicit(&s_seq, seq + 1U, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s_map = next;
+    atomic_store_explicit(&s_seq, seq + 2U, memory_order_release);
+    atomic_flag_clear_explicit(&s_refreshing, memory_order_release);
+    *out = next;
+    return true;
+}
+
+static void clock_snapshot(clock_map_t *m) {
+    int64_t now = esp_timer_get_time();
+    bool have = clock_read(m) && m->refreshed_us != 0;
+    if (have && now - m->refreshed_us < (int64_t)CLOCK_SERVICE_REFRESH_MS * 1000LL) {
+        return;
+    }
+    if (clock_refresh(now, m)) {
+        return;
+    }
+    if (!have) {
+        // Nothing published yet, or the writer was preempted mid-copy: build a private one
+        clock_build(now, m);
+    }
+}
+
+int64_t clock_service_mono_to_master(int64_t mono_us) {
+    clock_map_t m;
+    clock_snapshot(&m);
+    return clock_apply(&m, mono_us);
+}
+
+int64_t clock_service_master_to_mono(int64_t master_us) {
+    clock_map_t m;
+    clock_snapshot(&m);
+    // d / (1 + s) ~= d - d*s + d*s^2
+    int64_t d = master_us - m.master_anchor_us;
+    int64_t c1 = d * m.skew_ppb / 1000000000LL;
+    int64_t c2 = c1 * m.skew_ppb / 1000000000LL;
+    return m.mono_anchor_us + d - c1 + c2;
+}
+
+int64_t clock_service_master_now(void) {
+    return clock_service_mono_to_master(esp_timer_get_time());
+}
+
+uint64_t clock_service_ntp64_at(int64_t mono_us) {
+    int64_t us = clock_service_mono_to_master(mono_us);
+    if (us < 0) {
+        us = 0;
+    }
+    uint64_t sec = (uint64_t)us / 1000000ULL + NTP_EPOCH_OFFSET;
+    return (sec << 32) | USEC_TO_NTP_FRAC((uint64_t)us % 1000000ULL);
+}
+
+bool clock_service_is_locked(void) {
+    clock_map_t m;
+    clock_snapshot(&m);
+    return m.source != CLOCK_SOURCE_SYSTEM;
+}
+
+clock_source_t clock_service_source(void) {
+    clock_map_t m;
+    clock_snapshot(&m);
+    return m.source;
+}
+
+void clock_service_get_status(clock_service_status_t *status) {
+    if (!status) {
+        return;
+    }
+    clock_map_t m;
+    clock_snapshot(&m);
+    status->source = m.source;
+    status->offset_us = m.master_anchor_us - m.mono_anchor_us;
+    status->skew_ppb = m.skew_ppb;
+    status->refreshes = m.refreshes;
+    status->source_changes = m.source_changes;
+    status->steps = m.steps;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Master clock <-> local monotonic (esp_timer) mapping: the one place the
+ * firmware converts between the network's shared timeline and the clock its
+ * timers run on.
+ *
+ * While the NTP client's PLL is locked the mapping is its offset and skew, so
+ * every device synced to the same server agrees on master time within the
+ * PLL's error. A locked PTP slave (CONFIG_PTP_ENABLED) takes precedence,
+ * converted from its TAI timescale to UTC, so the firmware shares time with
+ * an AES67 venue's grandmaster. With neither it falls back to the system
+ * wall clock, which SNTP may step. The mapping is cached as an anchor plus a
+ * fixed-point skew and refreshed from the PLL every CLOCK_SERVICE_REFRESH_MS,
+ * so conversions are a seqlock read and integer arithmetic; only the caller
+ * that finds the cache stale pays for the PLL query.
+ *
+ * Users: RTCP playout mapping (rtcp_receiver.c), which the jitter buffer's
+ * playout scheduler consumes; RR/XR timestamps; the sender's SRs.
+ */
+
+#define CLOCK_SERVICE_REFRESH_MS   250    // Longest a cached mapping is used
+#define CLOCK_SERVICE_STEP_US      1000   // A refresh moving master time further than this is a step
+
+typedef enum {
+    CLOCK_SOURCE_SYSTEM = 0,   // System wall clock (gettimeofday); NTP PLL not locked
+    CLOCK_SOURCE_NTP_PLL,      // NTP client PLL
+    CLOCK_SOURCE_PTP,          // PTPv2 slave servo (UTC from the grandmaster's TAI)
+} clock_source_t;
+
+typedef struct {
+    clock_source_t source;
+    int64_t offset_us;         // master - monotonic at the last refresh
+    int32_t skew_ppb;          // Master advances (1 + skew) us per monotonic us
+    uint32_t refreshes;        // Mapping refreshes
+    uint32_t source_changes;   // PTP or PLL lock gained or lost
+    uint32_t steps;            // Refreshes that moved "master now" by more than CLOCK_SERVICE_STEP_US
+} clock_service_status_t;
+
+/**
+ * @brief Master time (Unix microseconds) at a local monotonic time
+ */
+int64_t clock_service_mono_to_master(int64_t mono_us);
+
+/**
+ * @brief Local monotonic time at a master time (Unix microseconds)
+ *
+ * The skew is inverted to second order, so the result is exact to well under
+ * a microsecond for any time within hours of the last refresh.
+ */
+int64_t clock_service_master_to_mono(int64_t master_us);
+
+/**
+ * @brief Master time now (Unix microseconds)
+ */
+int64_t clock_service_master_now(void);
+
+/**
+ * @brief Master time at a monotonic time as 64-bit NTP (seconds since 1900 << 32 | fraction)
+ */
+uint64_t clock_service_ntp64_at(int64_t mono_us);
+
+/**
+ * @brief Whether master time comes from a locked PTP slave or NTP PLL (shared with other devices)
+ */
+bool clock_service_is_locked(void);
+
+/**
+ * @brief Where master time currently comes from
+ */
+clock_source_t clock_service_source(void);
+
+void clock_service_get_status(clock_service_status_t *status);
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Pre-compress the web UI for embedding into the ESP32 RTP firmware
+
+Each file is gzipped (level 9, no timestamp, so the output only changes when
+the input does) into <out_dir>/<name>.gz, which the firmware serves as-is
+with Content-Encoding: gzip.
+
+HTML pages get ?v=<FIRMWARE_VERSION_STRING> appended to their local
+stylesheet and script references, so the browser may cache those
+"immutable" and still fetch new ones after an update.
+"""
+
+import gzip
+import re
+import sys
+from pathlib import Path
+
+ASSET_REF = re.compile(r'(<link[^>]*\bhref="|<script[^>]*\bsrc=")([^"#:?]+)(")')
+
+
+def read_version(version_file):
+    content = Path(version_file).read_text(encoding='utf-8')
+    match = re.search(r'#define FIRMWARE_VERSION_STRING\s+"([^"]+)"', content)
+    if not match:
+        print(f"Error: FIRMWARE_VERSION_STRING not found in {version_file}", file=sys.stderr)
+        return None
+    return match.group(1)
+
+
+def compress_file(src, out_dir, version):
+    src_path = Path(src)
+    data = src_path.read_bytes()
+
+    if src_path.suffix == '.html':
+        text = data.decode('utf-8')
+        text = ASSET_REF.sub(lambda m: f'{m.group(1)}{m.group(2)}?v={version}{m.group(3)}', text)
+        data = text.encode('utf-8')
+
+    packed = gzip.compress(data, compresslevel=9, mtime=0)
+    out_path = Path(out_dir) / (src_path.name + '.gz')
+
+    # Leave an unchanged file alone so the embed step is not rerun
+    if not out_path.exists() or out_path.read_bytes() != packed:
+        out_path.write_bytes(packed)
+
+    return len(data), len(packed)
+
+
+def main(argv):
+    if len(argv) < 4:
+        print(f"Usage: {argv[0]} <version.h> <out_dir> <files...>", file=sys.stderr)
+        return 1
+
+    version = read_version(argv[1])
+    if version is None:
+        return 1
+
+    out_dir = Path(argv[2])
+    out_dir.mkdir(parents=True, exist_ok=True)
+
+    raw_total = 0
+    packed_total = 0
+    for src in argv[3:]:
+        raw, packed = compress_file(src, out_dir, version)
+        raw_total += raw
+        packed_total += packed
+
+    print(f"Web assets compressed: {raw_total} -> {packed_total} bytes (v{version})")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
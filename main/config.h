@@ -12,18 +12,28 @@
 #define  MAX_BUFFER_SIZE 24
 // Max number of chunks to be targeted for buffer
 #define MAX_GROW_SIZE 16
+// Time-based buffer sizing; when non-zero these override the chunk counts above (from Kconfig)
+#define BUFFER_TARGET_MS CONFIG_RX_BUFFER_TARGET_MS
+#define BUFFER_MAX_MS CONFIG_RX_BUFFER_MAX_MS
+
+// RTP packet time in ms (from Kconfig)
+#define PTIME_MS CONFIG_RTP_PTIME_MS
 
 // Sample rate for incoming PCM (from Kconfig)
 #define SAMPLE_RATE CONFIG_SAMPLE_RATE
-// Bit depth for incoming PCM (from Kconfig)
-#define BIT_DEPTH 48000
+// Bit depth for incoming PCM (L16; L24/L32 are picked up from SAP or settings)
+#define BIT_DEPTH 16
+// Channels per frame of incoming PCM (stereo; 5.1/7.1 streams are picked up from SAP or settings)
+#define STREAM_CHANNELS 2
+// Stream channels played on the left/right outputs, 0-based (from Kconfig)
+#define CHANNEL_LEFT CONFIG_RX_CHANNEL_LEFT
+#define CHANNEL_RIGHT CONFIG_RX_CHANNEL_RIGHT
+// RTP payload type carrying Opus (0 = streams are linear PCM; set from SAP or settings)
+#define OPUS_PT 0
 // Volume 0.0f-1.0f (from Kconfig percent)
 #define CONFIG_DEFAULT_VOLUME_PCT 100
 #define VOLUME (CONFIG_DEFAULT_VOLUME_PCT / 100.0f)
 
-// Time to wake from deep sleep to check for DAC (in ms)
-#define DAC_CHECK_SLEEP_TIME_MS 2000
-
 // Sleep on silence configuration
 #define SILENCE_THRESHOLD_MS 30000       // Sleep after 10 seconds of silence
 #define NETWORK_CHECK_INTERVAL_MS 1000   // Check network every 1 second during light sleep
@@ -1,16 +1,105 @@
 #include "config_manager.h"
 #include "config.h"
+#include "logging/event_trace.h"
+#include "lifecycle/pipeline_topology.h"
+#include "rtp/rtp_relay.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_wifi.h"
+#include "esp_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stddef.h>
+#include <stdio.h>
 #include <string.h>
-#include "visualizer_task.h"
+
+/*
+ * Persistence: the whole app_config_t is stored as one versioned blob
+ * (NVS_KEY_CONFIG_BLOB), so a save is a single NVS write whatever changed.
+ * Setters update RAM and schedule a save; a low-priority task waits until
+ * the settings have been quiet for CONFIG_SETTINGS_SAVE_DEBOUNCE_MS (at most
+ * CONFIG_SETTINGS_SAVE_MAX_DELAY_MS) and writes only if the config differs
+ * from the image last saved. Dragging the volume slider costs one flash write
+ * at the end instead of one per step, and flash writes stall the cache (and
+ * the audio and LED paths with it) as rarely as possible.
+ *
+ * Builds before the blob stored one NVS key per field; those are read once,
+ * written back as a blob and erased.
+ *
+ * Layout changes only append fields to the end of app_config_t, and each one
+ * bumps CONFIG_BLOB_VERSION and adds the new end to s_blob_layout_end. A blob
+ * of an older version is then loaded over the defaults up to the end of its
+ * own layout, so a firmware update keeps the settings it knew about (the AP
+ * password among them) and defaults only what it adds. A newer or damaged
+ * blob is ignored and the device starts from defaults.
+ */
 
 // Store the active configuration
 static app_config_t s_app_config;
 
+#define NVS_KEY_CONFIG_BLOB "cfg"
+#define CONFIG_BLOB_MAGIC   0x4346u   // "CF"
+#define CONFIG_BLOB_VERSION 6u
+
+// End of the last field of app_config_t a blob of each version carries
+#define CONFIG_FIELD_END(f) (offsetof(app_config_t, f) + sizeof(((app_config_t *)0)->f))
+static const uint32_t s_blob_layout_end[CONFIG_BLOB_VERSION] = {
+    CONFIG_FIELD_END(sap_stream_name),      // 1: the first blob layout
+    CONFIG_FIELD_END(pipeline_topology),    // 2: + pipeline_topology
+    CONFIG_FIELD_END(srtp_crypto),          // 3: + srtp_crypto
+    CONFIG_FIELD_END(relay_peers),          // 4: + relay_role, relay_peers
+    CONFIG_FIELD_END(channel_right),        // 5: + stream_channels, channel_left/right
+    CONFIG_FIELD_END(sender_mix_gain_usb),  // 6: + sender_mix_usb, sender_mix_gain_*
+};
+// A field added past the last recorded end needs a new version above
+_Static_assert(sizeof(app_config_t) - CONFIG_FIELD_END(sender_mix_gain_usb) < _Alignof(app_config_t),
+               "app_config_t grew: bump CONFIG_BLOB_VERSION and extend s_blob_layout_end");
+
+typedef struct {
+    uint16_t magic;
+    uint16_t version;
+    uint32_t size;            // sizeof(app_config_t) of the build that wrote it
+    uint32_t crc;             // CRC-32 of the first `size` bytes of config
+    app_config_t config;
+} config_blob_t;
+
+// Staging for blob reads and writes (keeps it off the callers' stacks)
+static config_blob_t s_blob;
+// Image last read from or written to NVS; a save is skipped when nothing differs
+static app_config_t s_saved_config;
+static bool s_saved_valid = false;
+static SemaphoreHandle_t s_save_lock = NULL;
+static TaskHandle_t s_save_task = NULL;
+
+#define CONFIG_SAVE_TASK_STACK 4096
+
+/*
+ * Read-side snapshots: the audio paths read settings per packet or per chunk
+ * while the web server and lifecycle task change them. A publish copies
+ * s_app_config into the next slot of a small ring and swaps one pointer, so
+ * a reader does a single acquire load and sees one consistent version, never
+ * a half-applied batch. A slot is rewritten only after CONFIG_SNAPSHOT_SLOTS - 1
+ * later publishes; settings change at human speed, so a reader that just
+ * reads a few fields (and does not keep the pointer across a blocking call)
+ * never sees its slot reused.
+ */
+#define CONFIG_SNAPSHOT_SLOTS 4
+
+typedef struct {
+    app_config_t config;
+    uint32_t version;
+} config_snapshot_t;
+
+static config_snapshot_t s_snapshots[CONFIG_SNAPSHOT_SLOTS];
+static const config_snapshot_t *s_snapshot = NULL;
+static uint32_t s_snapshot_version = 0;
+static SemaphoreHandle_t s_publish_lock = NULL;
+
 // NVS keys for different config parameters
 #define NVS_KEY_PORT "port"
 #define NVS_KEY_HOSTNAME "hostname"
@@ -21,10 +110,18 @@ static app_config_t s_app_config;
 #define NVS_KEY_BUF_GROW_STEP "buf_grow_step"
 #define NVS_KEY_MAX_BUF_SIZE "max_buf_sz"
 #define NVS_KEY_MAX_GROW_SIZE "max_grow_sz"
+#define NVS_KEY_BUF_TARGET_MS "buf_target_ms"
+#define NVS_KEY_BUF_MAX_MS "buf_max_ms"
 #define NVS_KEY_SAMPLE_RATE "sample_rate"
 #define NVS_KEY_BIT_DEPTH "bit_depth"
+#define NVS_KEY_STREAM_CHANNELS "stream_ch"
+#define NVS_KEY_CHANNEL_LEFT "ch_left"
+#define NVS_KEY_CHANNEL_RIGHT "ch_right"
+#define NVS_KEY_PTIME_MS "ptime_ms"
+#define NVS_KEY_OPUS_PT "opus_pt"
 #define NVS_KEY_VOLUME "volume"
 #define NVS_KEY_SPDIF_DATA_PIN "spdif_pin"
+#define NVS_KEY_EQ "eq"
 #define NVS_KEY_SILENCE_THRES_MS "silence_ms"
 #define NVS_KEY_NET_CHECK_MS "net_check_ms"
 #define NVS_KEY_ACTIVITY_PACKETS "act_packets"
@@ -34,6 +131,13 @@ static app_config_t s_app_config;
 #define NVS_KEY_ENABLE_USB_SENDER "usb_sender"
 #define NVS_KEY_SENDER_DEST_IP "sender_ip"
 #define NVS_KEY_SENDER_DEST_PORT "sender_port"
+#define NVS_KEY_SENDER_FANOUT_IPS "fanout_ips"
+#define NVS_KEY_SENDER_FANOUT_MDNS "fanout_mdns"
+#define NVS_KEY_SENDER_OPUS "sender_opus"
+#define NVS_KEY_SENDER_OPUS_CPLX "opus_cplx"
+#define NVS_KEY_SENDER_MIX_USB "mix_usb"
+#define NVS_KEY_SENDER_MIX_GAIN_SPDIF "mix_gain_spdif"
+#define NVS_KEY_SENDER_MIX_GAIN_USB "mix_gain_usb"
 
 // S/PDIF Scream Sender key
 #define NVS_KEY_ENABLE_SPDIF_SENDER "spdif_sender"
@@ -46,6 +150,8 @@ static app_config_t s_app_config;
 
 // Audio processing keys
 #define NVS_KEY_USE_DIRECT_WRITE "direct_write"
+#define NVS_KEY_LOW_LATENCY "low_latency"
+#define NVS_KEY_PIPELINE_TOPOLOGY "topology"
 
 // mDNS discovery keys
 #define NVS_KEY_ENABLE_MDNS_DISCOVERY "mdns_discovery"
@@ -58,10 +164,99 @@ static app_config_t s_app_config;
 // SAP keys
 #define NVS_KEY_SAP_STREAM_NAME "sap_stream"
 
+// SRTP keys
+#define NVS_KEY_SRTP_CRYPTO "srtp_crypto"
+
+// ESP-NOW relay keys
+#define NVS_KEY_RELAY_ROLE "relay_role"
+#define NVS_KEY_RELAY_PEERS "relay_peers"
+
 // NTP configuration keys
 #define NVS_KEY_NTP_SCREAMROUTER "ntp_mdns"
 #define NVS_KEY_NTP_SERVER_HOST  "ntp_host"
 #define NVS_KEY_NTP_SERVER_PORT  "ntp_srv_port"
+// Per-field keys: the names used by config_manager_save_setting() and the
+// per-key NVS layout of builds before the blob
+typedef enum {
+    FIELD_U8,
+    FIELD_U16,
+    FIELD_U32,
+    FIELD_BOOL,
+    FIELD_MODE,      // device_mode_t, stored as u8
+    FIELD_VOLUME,    // float, stored as u32 percent
+    FIELD_STR,
+    FIELD_BLOB,
+} config_field_type_t;
+
+typedef struct {
+    const char *key;       // NVS key (15 chars at most)
+    const char *name;      // app_config_t member name, accepted as an alias
+    uint16_t offset;
+    uint16_t size;
+    config_field_type_t type;
+} config_field_t;
+
+#define FIELD(k, member, t) \
+    { (k), #member, offsetof(app_config_t, member), sizeof(((app_config_t *)0)->member), (t) }
+
+static const config_field_t s_fields[] = {
+    FIELD(NVS_KEY_PORT,                  port,                          FIELD_U16),
+    FIELD(NVS_KEY_HOSTNAME,              hostname,                      FIELD_STR),
+    FIELD(NVS_KEY_AP_SSID,               ap_ssid,                       FIELD_STR),
+    FIELD(NVS_KEY_AP_PASSWORD,           ap_password,                   FIELD_STR),
+    FIELD(NVS_KEY_HIDE_AP_CONNECTED,     hide_ap_when_connected,        FIELD_BOOL),
+    FIELD(NVS_KEY_AP_ONLY_MODE,          ap_only_mode,                  FIELD_BOOL),
+    FIELD(NVS_KEY_INIT_BUF_SIZE,         initial_buffer_size,           FIELD_U8),
+    FIELD(NVS_KEY_BUF_GROW_STEP,         buffer_grow_step_size,         FIELD_U8),
+    FIELD(NVS_KEY_MAX_BUF_SIZE,          max_buffer_size,               FIELD_U8),
+    FIELD(NVS_KEY_MAX_GROW_SIZE,         max_grow_size,                 FIELD_U8),
+    FIELD(NVS_KEY_BUF_TARGET_MS,         buffer_target_ms,              FIELD_U16),
+    FIELD(NVS_KEY_BUF_MAX_MS,            buffer_max_ms,                 FIELD_U16),
+    FIELD(NVS_KEY_SAMPLE_RATE,           sample_rate,                   FIELD_U32),
+    FIELD(NVS_KEY_BIT_DEPTH,             bit_depth,                     FIELD_U8),
+    FIELD(NVS_KEY_STREAM_CHANNELS,       stream_channels,               FIELD_U8),
+    FIELD(NVS_KEY_CHANNEL_LEFT,          channel_left,                  FIELD_U8),
+    FIELD(NVS_KEY_CHANNEL_RIGHT,         channel_right,                 FIELD_U8),
+    FIELD(NVS_KEY_PTIME_MS,              ptime_ms,                      FIELD_U8),
+    FIELD(NVS_KEY_OPUS_PT,               opus_pt,                       FIELD_U8),
+    FIELD(NVS_KEY_VOLUME,                volume,                        FIELD_VOLUME),
+    FIELD(NVS_KEY_SPDIF_DATA_PIN,        spdif_data_pin,                FIELD_U8),
+    FIELD(NVS_KEY_EQ,                    eq,                            FIELD_BLOB),
+    FIELD(NVS_KEY_SILENCE_THRES_MS,      silence_threshold_ms,          FIELD_U32),
+    FIELD(NVS_KEY_NET_CHECK_MS,          network_check_interval_ms,     FIELD_U32),
+    FIELD(NVS_KEY_ACTIVITY_PACKETS,      activity_threshold_packets,    FIELD_U8),
+    FIELD(NVS_KEY_SILENCE_AMPLT,         silence_amplitude_threshold,   FIELD_U16),
+    FIELD(NVS_KEY_NET_INACT_MS,          network_inactivity_timeout_ms, FIELD_U32),
+    FIELD(NVS_KEY_DEVICE_MODE,           device_mode,                   FIELD_MODE),
+    FIELD(NVS_KEY_ENABLE_USB_SENDER,     enable_usb_sender,             FIELD_BOOL),
+    FIELD(NVS_KEY_ENABLE_SPDIF_SENDER,   enable_spdif_sender,           FIELD_BOOL),
+    FIELD(NVS_KEY_SENDER_DEST_IP,        sender_destination_ip,         FIELD_STR),
+    FIELD(NVS_KEY_SENDER_DEST_PORT,      sender_destination_port,       FIELD_U16),
+    FIELD(NVS_KEY_SENDER_FANOUT_IPS,     sender_fanout_ips,             FIELD_STR),
+    FIELD(NVS_KEY_SENDER_FANOUT_MDNS,    sender_fanout_mdns,            FIELD_BOOL),
+    FIELD(NVS_KEY_SENDER_OPUS,           sender_opus,                   FIELD_BOOL),
+    FIELD(NVS_KEY_SENDER_OPUS_CPLX,      sender_opus_complexity,        FIELD_U8),
+    FIELD(NVS_KEY_SENDER_MIX_USB,        sender_mix_usb,                FIELD_BOOL),
+    FIELD(NVS_KEY_SENDER_MIX_GAIN_SPDIF, sender_mix_gain_spdif,         FIELD_U8),
+    FIELD(NVS_KEY_SENDER_MIX_GAIN_USB,   sender_mix_gain_usb,           FIELD_U8),
+    FIELD(NVS_KEY_USE_DIRECT_WRITE,      use_direct_write,              FIELD_BOOL),
+    FIELD(NVS_KEY_LOW_LATENCY,           low_latency,                   FIELD_BOOL),
+    FIELD(NVS_KEY_PIPELINE_TOPOLOGY,     pipeline_topology,             FIELD_U8),
+    FIELD(NVS_KEY_ENABLE_MDNS_DISCOVERY, enable_mdns_discovery,         FIELD_BOOL),
+    FIELD(NVS_KEY_DISCOVERY_INTERVAL_MS, discovery_interval_ms,         FIELD_U32),
+    FIELD(NVS_KEY_AUTO_SELECT_DEVICE,    auto_select_best_device,       FIELD_BOOL),
+    FIELD(NVS_KEY_NTP_SCREAMROUTER,      ntp_screamrouter_mode,         FIELD_BOOL),
+    FIELD(NVS_KEY_NTP_SERVER_HOST,       ntp_server_host,               FIELD_STR),
+    FIELD(NVS_KEY_NTP_SERVER_PORT,       ntp_server_port,               FIELD_U16),
+    FIELD(NVS_KEY_SETUP_WIZARD_COMPLETED, setup_wizard_completed,       FIELD_BOOL),
+    FIELD(NVS_KEY_SAP_STREAM_NAME,       sap_stream_name,               FIELD_STR),
+    FIELD(NVS_KEY_SRTP_CRYPTO,           srtp_crypto,                   FIELD_STR),
+    FIELD(NVS_KEY_RELAY_ROLE,            relay_role,                    FIELD_U8),
+    FIELD(NVS_KEY_RELAY_PEERS,           relay_peers,                   FIELD_STR),
+};
+
+#define CONFIG_FIELD_COUNT (sizeof(s_fields) / sizeof(s_fields[0]))
+
 /**
  * Initialize with default values from config.h
  */
@@ -109,10 +304,18 @@ static void set_default_config(void) {
     s_app_config.buffer_grow_step_size = BUFFER_GROW_STEP_SIZE;
     s_app_config.max_buffer_size = MAX_BUFFER_SIZE;
     s_app_config.max_grow_size = MAX_GROW_SIZE;
+    s_app_config.buffer_target_ms = BUFFER_TARGET_MS;
+    s_app_config.buffer_max_ms = BUFFER_MAX_MS;
     s_app_config.sample_rate = SAMPLE_RATE;
     s_app_config.bit_depth = BIT_DEPTH;
+    s_app_config.stream_channels = STREAM_CHANNELS;
+    s_app_config.channel_left = CHANNEL_LEFT;
+    s_app_config.channel_right = CHANNEL_RIGHT;
+    s_app_config.ptime_ms = PTIME_MS;
+    s_app_config.opus_pt = OPUS_PT;
     s_app_config.volume = VOLUME;
     s_app_config.spdif_data_pin = 17; // Default SPDIF pin
+    memset(&s_app_config.eq, 0, sizeof(s_app_config.eq)); // EQ off, flat
     s_app_config.silence_threshold_ms = SILENCE_THRESHOLD_MS;
     s_app_config.network_check_interval_ms = NETWORK_CHECK_INTERVAL_MS;
     s_app_config.activity_threshold_packets = ACTIVITY_THRESHOLD_PACKETS;
@@ -124,9 +327,18 @@ static void set_default_config(void) {
     s_app_config.enable_spdif_sender = false; // Default S/PDIF sender to disabled
     strcpy(s_app_config.sender_destination_ip, "192.168.1.255"); // Default to broadcast
     s_app_config.sender_destination_port = 40000; // Default ScreamRouter RTP port
+    s_app_config.sender_fanout_ips[0] = '\0';     // No extra destinations
+    s_app_config.sender_fanout_mdns = false;
+    s_app_config.sender_opus = false;             // L16 unless asked
+    s_app_config.sender_opus_complexity = CONFIG_RTP_TX_OPUS_COMPLEXITY;
+    s_app_config.sender_mix_usb = false;          // S/PDIF only unless asked
+    s_app_config.sender_mix_gain_spdif = 100;
+    s_app_config.sender_mix_gain_usb = 100;
     
     // Audio processing defaults
     s_app_config.use_direct_write = true; // Default to direct write mode
+    s_app_config.low_latency = false;     // Normal jitter buffering
+    s_app_config.pipeline_topology = CONFIG_PIPELINE_TOPOLOGY_DEFAULT_ID;
     
     // mDNS discovery defaults
     s_app_config.enable_mdns_discovery = true;       // Enable mDNS discovery by default
@@ -144,252 +356,397 @@ static void set_default_config(void) {
 
     // SAP defaults
     s_app_config.sap_stream_name[0] = '\0';          // No stream selected by default
+    s_app_config.srtp_crypto[0] = '\0';              // Plain RTP by default
+
+    // ESP-NOW relay defaults
+    s_app_config.relay_role = RTP_RELAY_OFF;
+    s_app_config.relay_peers[0] = '\0';              // Broadcast / take from any forwarder
 
     // Device mode defaults based on build type
     s_app_config.device_mode = MODE_RECEIVER_USB; // Default fallback
 }
 
-/**
- * Initialize configuration manager and load settings
- */
-esp_err_t config_manager_init(void) {
-    ESP_LOGI(TAG, "Initializing configuration manager");
-    
-    // Set default values first
-    set_default_config();
-    
-    // Open NVS handle
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    
-    if (err != ESP_OK) {
-        if (err == ESP_ERR_NVS_NOT_FOUND) {
-            ESP_LOGI(TAG, "No saved configuration found, using defaults");
-            return ESP_OK;
+static const config_field_t *find_field(const char *key) {
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (strcmp(key, s_fields[i].key) == 0 || strcmp(key, s_fields[i].name) == 0) {
+            return &s_fields[i];
         }
-        
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    // Read network settings
-    uint16_t port;
-    err = nvs_get_u16(nvs_handle, NVS_KEY_PORT, &port);
-    if (err == ESP_OK) {
-        s_app_config.port = port;
     }
+    return NULL;
+}
 
-    // Read hostname
-    size_t hostname_len = sizeof(s_app_config.hostname);
-    err = nvs_get_str(nvs_handle, NVS_KEY_HOSTNAME, s_app_config.hostname, &hostname_len);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error reading hostname: %s", esp_err_to_name(err));
+// Integer from a caller value of 1, 2 or 4 bytes (enums and bools arrive in any of these)
+static bool read_uint(const void *value, size_t size, uint32_t *out) {
+    switch (size) {
+        case 1: *out = *(const uint8_t *)value; return true;
+        case 2: *out = *(const uint16_t *)value; return true;
+        case 4: *out = *(const uint32_t *)value; return true;
+        default: return false;
     }
-    
-    // Read AP SSID
-    size_t ssid_len = WIFI_SSID_MAX_LENGTH;
-    err = nvs_get_str(nvs_handle, NVS_KEY_AP_SSID, s_app_config.ap_ssid, &ssid_len);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error reading AP SSID: %s", esp_err_to_name(err));
-    }
-    
-    // Read AP password
-    size_t len = WIFI_PASSWORD_MAX_LENGTH;
-    err = nvs_get_str(nvs_handle, NVS_KEY_AP_PASSWORD, s_app_config.ap_password, &len);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error reading AP password: %s", esp_err_to_name(err));
+}
+
+static void write_uint(uint8_t *dst, size_t size, uint32_t v) {
+    switch (size) {
+        case 1: *dst = (uint8_t)v; break;
+        case 2: { uint16_t u = (uint16_t)v; memcpy(dst, &u, 2); break; }
+        case 4: memcpy(dst, &v, 4); break;
+        default: break;
     }
-    
-    // Read hide AP when connected setting
-    uint8_t hide_ap;
-    err = nvs_get_u8(nvs_handle, NVS_KEY_HIDE_AP_CONNECTED, &hide_ap);
-    if (err == ESP_OK) {
-        s_app_config.hide_ap_when_connected = (bool)hide_ap;
+}
+
+// Legacy enable_*_sender flags follow device_mode
+static void sync_legacy_mode_flags(void) {
+    switch (s_app_config.device_mode) {
+        case MODE_RECEIVER_USB:
+        case MODE_RECEIVER_SPDIF:
+            s_app_config.enable_usb_sender = false;
+            s_app_config.enable_spdif_sender = false;
+            break;
+        case MODE_SENDER_USB:
+            s_app_config.enable_usb_sender = true;
+            s_app_config.enable_spdif_sender = false;
+            break;
+        case MODE_SENDER_SPDIF:
+            s_app_config.enable_usb_sender = false;
+            s_app_config.enable_spdif_sender = true;
+            break;
     }
-    
-    // Read AP-only mode setting
-    uint8_t ap_only;
-    err = nvs_get_u8(nvs_handle, NVS_KEY_AP_ONLY_MODE, &ap_only);
-    if (err == ESP_OK) {
-        s_app_config.ap_only_mode = (bool)ap_only;
+}
+
+/**
+ * Read the per-key layout of older builds into s_app_config
+ *
+ * @return true if any key was found
+ */
+static bool load_legacy_keys(nvs_handle_t nvs_handle) {
+    bool found_any = false;
+    bool found_mode = false;
+
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const config_field_t *f = &s_fields[i];
+        uint8_t *dst = (uint8_t *)&s_app_config + f->offset;
+        esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+
+        switch (f->type) {
+            case FIELD_U8:
+            case FIELD_BOOL:
+            case FIELD_MODE:
+                err = nvs_get_u8(nvs_handle, f->key, &u8);
+                if (err == ESP_OK) {
+                    write_uint(dst, f->size, f->type == FIELD_BOOL ? (u8 != 0) : u8);
+                }
+                break;
+            case FIELD_U16:
+                err = nvs_get_u16(nvs_handle, f->key, &u16);
+                if (err == ESP_OK) {
+                    write_uint(dst, f->size, u16);
+                }
+                break;
+            case FIELD_U32:
+                err = nvs_get_u32(nvs_handle, f->key, &u32);
+                if (err == ESP_OK) {
+                    write_uint(dst, f->size, u32);
+                }
+                break;
+            case FIELD_VOLUME:
+                err = nvs_get_u32(nvs_handle, f->key, &u32);
+                if (err == ESP_OK) {
+                    s_app_config.volume = (float)u32 / 100.0f;
+                }
+                break;
+            case FIELD_STR: {
+                size_t len = f->size;
+                err = nvs_get_str(nvs_handle, f->key, (char *)dst, &len);
+                dst[f->size - 1] = '\0';
+                break;
+            }
+            case FIELD_BLOB: {
+                // EQ: ignored if its layout doesn't match this build
+                eq_config_t eq;
+                size_t len = sizeof(eq);
+                err = nvs_get_blob(nvs_handle, f->key, &eq, &len);
+                if (err == ESP_OK && len == sizeof(eq) && eq.band_count <= EQ_MAX_BANDS) {
+                    s_app_config.eq = eq;
+                }
+                break;
+            }
+        }
+
+        if (err == ESP_OK) {
+            found_any = true;
+            found_mode |= f->type == FIELD_MODE;
+        } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGE(TAG, "Error reading %s: %s", f->key, esp_err_to_name(err));
+        }
     }
-    
-    // Read buffer settings
-    uint8_t u8_value;
-    err = nvs_get_u8(nvs_handle, NVS_KEY_INIT_BUF_SIZE, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.initial_buffer_size = u8_value;
+
+    if (s_app_config.sender_opus_complexity > 10) {
+        s_app_config.sender_opus_complexity = CONFIG_RTP_TX_OPUS_COMPLEXITY;
     }
-    
-    err = nvs_get_u8(nvs_handle, NVS_KEY_BUF_GROW_STEP, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.buffer_grow_step_size = u8_value;
+    if (s_app_config.sender_mix_gain_spdif > 100) {
+        s_app_config.sender_mix_gain_spdif = 100;
     }
-    
-    err = nvs_get_u8(nvs_handle, NVS_KEY_MAX_BUF_SIZE, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.max_buffer_size = u8_value;
+    if (s_app_config.sender_mix_gain_usb > 100) {
+        s_app_config.sender_mix_gain_usb = 100;
     }
-    
-    err = nvs_get_u8(nvs_handle, NVS_KEY_MAX_GROW_SIZE, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.max_grow_size = u8_value;
+    if (s_app_config.pipeline_topology >= PIPELINE_TOPOLOGY_COUNT) {
+        s_app_config.pipeline_topology = CONFIG_PIPELINE_TOPOLOGY_DEFAULT_ID;
     }
-    
-    // Read audio settings
-    uint32_t sample_rate;
-    err = nvs_get_u32(nvs_handle, NVS_KEY_SAMPLE_RATE, &sample_rate);
-    if (err == ESP_OK) {
-        s_app_config.sample_rate = sample_rate;
+    if (s_app_config.relay_role >= RTP_RELAY_ROLE_COUNT) {
+        s_app_config.relay_role = RTP_RELAY_OFF;
     }
-    
-    err = nvs_get_u8(nvs_handle, NVS_KEY_BIT_DEPTH, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.bit_depth = u8_value;
+
+    // If device_mode is not found, derive it from legacy boolean fields
+    if (!found_mode) {
+        if (s_app_config.enable_usb_sender) {
+            s_app_config.device_mode = MODE_SENDER_USB;
+        } else if (s_app_config.enable_spdif_sender) {
+            s_app_config.device_mode = MODE_SENDER_SPDIF;
+        } else {
+            s_app_config.device_mode = MODE_RECEIVER_USB;
+        }
+        ESP_LOGI(TAG, "Derived device_mode from legacy: %d", s_app_config.device_mode);
     }
-    
-    // Read volume as u32 (stored as integer representation of float * 100)
-    uint32_t volume_int;
-    err = nvs_get_u32(nvs_handle, NVS_KEY_VOLUME, &volume_int);
-    if (err == ESP_OK) {
-        s_app_config.volume = (float)volume_int / 100.0f;
+    return found_any;
+}
+
+/**
+ * Load the config blob into s_app_config
+ *
+ * A blob of an older version fills its own part of the config; the rest keeps the
+ * defaults s_app_config holds on entry.
+ *
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND if there is none, or
+ *         ESP_ERR_INVALID_VERSION / ESP_ERR_INVALID_CRC for a blob this build can't use
+ */
+static esp_err_t load_blob(nvs_handle_t nvs_handle) {
+    size_t len = sizeof(s_blob);
+    esp_err_t err = nvs_get_blob(nvs_handle, NVS_KEY_CONFIG_BLOB, &s_blob, &len);
+    if (err == ESP_ERR_NVS_INVALID_LENGTH) {
+        return ESP_ERR_INVALID_VERSION;  // Larger than this build's layout
     }
-    
-    // Read SPDIF data pin
-    err = nvs_get_u8(nvs_handle, NVS_KEY_SPDIF_DATA_PIN, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.spdif_data_pin = u8_value;
-        ESP_LOGI(TAG, "Loaded SPDIF data pin: %d", s_app_config.spdif_data_pin);
+    if (err != ESP_OK) {
+        return err;
     }
-    
-    // Read sleep settings
-    uint32_t u32_value;
-    err = nvs_get_u32(nvs_handle, NVS_KEY_SILENCE_THRES_MS, &u32_value);
-    if (err == ESP_OK) {
-        s_app_config.silence_threshold_ms = u32_value;
+    const size_t header = offsetof(config_blob_t, config);
+    if (len < header || s_blob.magic != CONFIG_BLOB_MAGIC ||
+        s_blob.version == 0 || s_blob.version > CONFIG_BLOB_VERSION ||
+        s_blob.size > sizeof(app_config_t) || len != header + s_blob.size) {
+        return ESP_ERR_INVALID_VERSION;
     }
-    
-    err = nvs_get_u32(nvs_handle, NVS_KEY_NET_CHECK_MS, &u32_value);
-    if (err == ESP_OK) {
-        s_app_config.network_check_interval_ms = u32_value;
+    if (s_blob.crc != esp_crc32_le(0, (const uint8_t *)&s_blob.config, s_blob.size)) {
+        return ESP_ERR_INVALID_CRC;
     }
-    
-    err = nvs_get_u8(nvs_handle, NVS_KEY_ACTIVITY_PACKETS, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.activity_threshold_packets = u8_value;
+    // An older layout covers a prefix: later fields keep the defaults already in place
+    size_t keep = s_blob_layout_end[s_blob.version - 1];
+    if (s_blob.size < keep) {
+        return ESP_ERR_INVALID_VERSION;
     }
-    
-    uint16_t u16_value;
-    err = nvs_get_u16(nvs_handle, NVS_KEY_SILENCE_AMPLT, &u16_value);
-    if (err == ESP_OK) {
-        s_app_config.silence_amplitude_threshold = u16_value;
+    memcpy(&s_app_config, &s_blob.config, keep);
+    if (s_blob.version != CONFIG_BLOB_VERSION) {
+        ESP_LOGI(TAG, "Configuration blob version %u carried over to %u",
+                 (unsigned)s_blob.version, (unsigned)CONFIG_BLOB_VERSION);
     }
-    
-    err = nvs_get_u32(nvs_handle, NVS_KEY_NET_INACT_MS, &u32_value);
-    if (err == ESP_OK) {
-        s_app_config.network_inactivity_timeout_ms = u32_value;
+    return ESP_OK;
+}
+
+// Log which fields a save is writing
+static void log_dirty_fields(void) {
+    char names[128];
+    size_t used = 0;
+    int count = 0;
+    names[0] = '\0';
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const config_field_t *f = &s_fields[i];
+        if (memcmp((const uint8_t *)&s_app_config + f->offset,
+                   (const uint8_t *)&s_saved_config + f->offset, f->size) != 0) {
+            count++;
+            int n = snprintf(names + used, sizeof(names) - used, "%s%s", used ? "," : "", f->key);
+            if (n > 0 && used + (size_t)n < sizeof(names)) {
+                used += (size_t)n;
+            }
+        }
     }
-    
-    // Read USB Scream Sender settings
-    err = nvs_get_u8(nvs_handle, NVS_KEY_ENABLE_USB_SENDER, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.enable_usb_sender = (bool)u8_value;
+    ESP_LOGI(TAG, "Saving configuration (%d changed: %s)", count, names);
+}
+
+/**
+ * Write s_app_config as one blob if it differs from the saved image
+ *
+ * @param erase_legacy Also drop the per-key entries of older builds
+ */
+static esp_err_t config_flush(bool erase_legacy) {
+    if (s_save_lock) {
+        xSemaphoreTake(s_save_lock, portMAX_DELAY);
     }
-    
-    // Read S/PDIF Scream Sender setting
-    err = nvs_get_u8(nvs_handle, NVS_KEY_ENABLE_SPDIF_SENDER, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.enable_spdif_sender = (bool)u8_value;
-        ESP_LOGI(TAG, "Loaded enable_spdif_sender: %d", s_app_config.enable_spdif_sender);
+
+    esp_err_t err = ESP_OK;
+    if (!erase_legacy && s_saved_valid &&
+        memcmp(&s_app_config, &s_saved_config, sizeof(s_app_config)) == 0) {
+        goto out;  // Nothing changed: no flash access at all
     }
-    
-    char ip_str[16];
-    size_t ip_len = sizeof(ip_str);
-    err = nvs_get_str(nvs_handle, NVS_KEY_SENDER_DEST_IP, ip_str, &ip_len);
-    if (err == ESP_OK) {
-        strncpy(s_app_config.sender_destination_ip, ip_str, 15);
-        s_app_config.sender_destination_ip[15] = '\0'; // Ensure null termination
+
+    if (s_saved_valid) {
+        log_dirty_fields();
+    } else {
+        ESP_LOGI(TAG, "Saving configuration");
     }
-    
-    err = nvs_get_u16(nvs_handle, NVS_KEY_SENDER_DEST_PORT, &u16_value);
-    if (err == ESP_OK) {
-        s_app_config.sender_destination_port = u16_value;
+
+    s_blob.magic = CONFIG_BLOB_MAGIC;
+    s_blob.version = CONFIG_BLOB_VERSION;
+    s_blob.size = sizeof(app_config_t);
+    s_blob.config = s_app_config;
+    s_blob.crc = esp_crc32_le(0, (const uint8_t *)&s_blob.config, sizeof(s_blob.config));
+
+    nvs_handle_t nvs_handle;
+    err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        goto out;
     }
-    
-    // Read audio processing settings
-    err = nvs_get_u8(nvs_handle, NVS_KEY_USE_DIRECT_WRITE, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.use_direct_write = (bool)u8_value;
+    if (erase_legacy) {
+        err = nvs_erase_all(nvs_handle);
     }
-    
-    // Read mDNS discovery settings
-    err = nvs_get_u8(nvs_handle, NVS_KEY_ENABLE_MDNS_DISCOVERY, &u8_value);
+    int64_t write_start_us = esp_timer_get_time();
     if (err == ESP_OK) {
-        s_app_config.enable_mdns_discovery = (bool)u8_value;
+        err = nvs_set_blob(nvs_handle, NVS_KEY_CONFIG_BLOB, &s_blob, sizeof(s_blob));
     }
-    
-    err = nvs_get_u32(nvs_handle, NVS_KEY_DISCOVERY_INTERVAL_MS, &u32_value);
     if (err == ESP_OK) {
-        s_app_config.discovery_interval_ms = u32_value;
+        err = nvs_commit(nvs_handle);
     }
-    
-    err = nvs_get_u8(nvs_handle, NVS_KEY_AUTO_SELECT_DEVICE, &u8_value);
+    nvs_close(nvs_handle);
+    event_trace_add(EVENT_TRACE_FLASH, EVENT_TRACE_FLASH_NVS, event_trace_u16(sizeof(s_blob) / 1024),
+                    (int32_t)(esp_timer_get_time() - write_start_us));
+
     if (err == ESP_OK) {
-        s_app_config.auto_select_best_device = (bool)u8_value;
+        s_saved_config = s_blob.config;
+        s_saved_valid = true;
+    } else {
+        ESP_LOGE(TAG, "Error saving configuration: %s", esp_err_to_name(err));
     }
 
-    // Read NTP settings
-    err = nvs_get_u8(nvs_handle, NVS_KEY_NTP_SCREAMROUTER, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.ntp_screamrouter_mode = (bool)u8_value;
+out:
+    if (s_save_lock) {
+        xSemaphoreGive(s_save_lock);
     }
-    size_t host_len = sizeof(s_app_config.ntp_server_host);
-    err = nvs_get_str(nvs_handle, NVS_KEY_NTP_SERVER_HOST, s_app_config.ntp_server_host, &host_len);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error reading NTP server host: %s", esp_err_to_name(err));
+    return err;
+}
+
+/**
+ * Copy the live config into the next snapshot slot and make it current
+ */
+void config_manager_publish(void) {
+    if (s_publish_lock) {
+        xSemaphoreTake(s_publish_lock, portMAX_DELAY);
+    }
+    uint32_t version = s_snapshot_version + 1;
+    config_snapshot_t *slot = &s_snapshots[version % CONFIG_SNAPSHOT_SLOTS];
+    slot->config = s_app_config;
+    slot->version = version;
+    s_snapshot_version = version;
+    // Release: the copy is complete before any reader can load the pointer
+    __atomic_store_n(&s_snapshot, slot, __ATOMIC_RELEASE);
+    if (s_publish_lock) {
+        xSemaphoreGive(s_publish_lock);
     }
-    err = nvs_get_u16(nvs_handle, NVS_KEY_NTP_SERVER_PORT, &u16_value);
-    if (err == ESP_OK) {
-        s_app_config.ntp_server_port = u16_value;
+}
+
+const app_config_t* config_manager_snapshot(void) {
+    const config_snapshot_t *snap = __atomic_load_n(&s_snapshot, __ATOMIC_ACQUIRE);
+    // Before the first publish (early boot) the live config is all there is
+    return snap ? &snap->config : &s_app_config;
+}
+
+uint32_t config_manager_snapshot_version(void) {
+    const config_snapshot_t *snap = __atomic_load_n(&s_snapshot, __ATOMIC_ACQUIRE);
+    return snap ? snap->version : 0;
+}
+
+// Debounced saver: waits for a quiet period after the last request, then flushes
+static void config_save_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t first_us = esp_timer_get_time();
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_SETTINGS_SAVE_DEBOUNCE_MS)) > 0) {
+            // A continuous stream of changes still gets saved now and then
+            if ((esp_timer_get_time() - first_us) / 1000 >= CONFIG_SETTINGS_SAVE_MAX_DELAY_MS) {
+                break;
+            }
+        }
+        config_flush(false);
     }
-    
-    // Read setup wizard status
-    err = nvs_get_u8(nvs_handle, NVS_KEY_SETUP_WIZARD_COMPLETED, &u8_value);
-    if (err == ESP_OK) {
-        s_app_config.setup_wizard_completed = (bool)u8_value;
+}
+
+// esp_restart() (reset button, OTA, etc.) must not lose a pending change
+static void config_shutdown_handler(void) {
+    config_flush(false);
+}
+
+/**
+ * Initialize configuration manager and load settings
+ */
+esp_err_t config_manager_init(void) {
+    ESP_LOGI(TAG, "Initializing configuration manager");
+
+    if (!s_save_lock) {
+        s_save_lock = xSemaphoreCreateMutex();
+        s_publish_lock = xSemaphoreCreateMutex();
+        if (!s_save_lock || !s_publish_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+        if (xTaskCreate(config_save_task, "cfg_save", CONFIG_SAVE_TASK_STACK, NULL,
+                        tskIDLE_PRIORITY + 1, &s_save_task) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to start config save task, settings save immediately");
+            s_save_task = NULL;
+        }
+        esp_register_shutdown_handler(config_shutdown_handler);
     }
 
-    // Read SAP stream name
-    size_t sap_len = sizeof(s_app_config.sap_stream_name);
-    err = nvs_get_str(nvs_handle, NVS_KEY_SAP_STREAM_NAME, s_app_config.sap_stream_name, &sap_len);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error reading SAP stream name: %s", esp_err_to_name(err));
+    // Set default values first
+    set_default_config();
+    s_saved_valid = false;
+
+    // Open NVS handle
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+
+    if (err != ESP_OK) {
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGI(TAG, "No saved configuration found, using defaults");
+            config_manager_publish();
+            return ESP_OK;
+        }
+
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
+        return err;
     }
 
-    // Read device mode (new enum-based configuration)
-    err = nvs_get_u8(nvs_handle, NVS_KEY_DEVICE_MODE, &u8_value);
+    bool migrate = false;
+    err = load_blob(nvs_handle);
     if (err == ESP_OK) {
-        s_app_config.device_mode = (device_mode_t)u8_value;
-        ESP_LOGI(TAG, "Loaded device_mode: %d", s_app_config.device_mode);
+        s_saved_config = s_app_config;
+        s_saved_valid = true;
     } else if (err == ESP_ERR_NVS_NOT_FOUND) {
-        // If device_mode is not found, derive it from legacy boolean fields
-        if (s_app_config.enable_usb_sender) {
-            s_app_config.device_mode = MODE_SENDER_USB;
-            ESP_LOGI(TAG, "Derived device_mode from legacy: MODE_SENDER_USB");
-        } else if (s_app_config.enable_spdif_sender) {
-            s_app_config.device_mode = MODE_SENDER_SPDIF;
-            ESP_LOGI(TAG, "Derived device_mode from legacy: MODE_SENDER_SPDIF");
-        } else {
-            // Default to receiver mode based on build type
-            s_app_config.device_mode = MODE_RECEIVER_USB;
-            ESP_LOGI(TAG, "Derived device_mode from legacy: MODE_RECEIVER_USB");
-        }
+        migrate = load_legacy_keys(nvs_handle);
+    } else {
+        ESP_LOGW(TAG, "Saved configuration unusable (%s), using defaults", esp_err_to_name(err));
+        set_default_config();
     }
-    
+
     // Close NVS handle
     nvs_close(nvs_handle);
-    
-    ESP_LOGI(TAG, "Configuration loaded");
+
+    if (migrate) {
+        ESP_LOGI(TAG, "Converting per-key configuration to a single blob");
+        config_flush(true);
+    }
+    config_manager_publish();
+
+    ESP_LOGI(TAG, "Configuration loaded (device_mode %d)", s_app_config.device_mode);
     return ESP_OK;
 }
 
@@ -405,522 +762,98 @@ app_config_t* config_manager_get_config(void) {
  */
 esp_err_t config_manager_reload(void) {
     ESP_LOGI(TAG, "Reloading configuration from NVS");
-    
+
     // Store current values in case we need to fall back
     app_config_t backup_config = s_app_config;
-    
+
     // Try to load all settings from NVS
     esp_err_t err = config_manager_init();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to reload configuration: %s", esp_err_to_name(err));
         // Restore previous values
         s_app_config = backup_config;
+        config_manager_publish();
         return err;
     }
-    
+
     ESP_LOGI(TAG, "Configuration reloaded successfully");
     return ESP_OK;
 }
 
 /**
- * Save configuration to NVS
+ * Save configuration to NVS now
  */
 esp_err_t config_manager_save_config(void) {
-    ESP_LOGI(TAG, "Saving configuration to NVS");
-    
-    // Open NVS handle
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    // Save network settings
-    err = nvs_set_u16(nvs_handle, NVS_KEY_PORT, s_app_config.port);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving port: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-
-    // Save hostname
-    err = nvs_set_str(nvs_handle, NVS_KEY_HOSTNAME, s_app_config.hostname);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving hostname: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save AP SSID
-    err = nvs_set_str(nvs_handle, NVS_KEY_AP_SSID, s_app_config.ap_ssid);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving AP SSID: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save AP password
-    err = nvs_set_str(nvs_handle, NVS_KEY_AP_PASSWORD, s_app_config.ap_password);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving AP password: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save hide AP when connected setting
-    err = nvs_set_u8(nvs_handle, NVS_KEY_HIDE_AP_CONNECTED, (uint8_t)s_app_config.hide_ap_when_connected);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving hide AP setting: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save AP-only mode setting
-    err = nvs_set_u8(nvs_handle, NVS_KEY_AP_ONLY_MODE, (uint8_t)s_app_config.ap_only_mode);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving AP-only mode setting: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save buffer settings
-    err = nvs_set_u8(nvs_handle, NVS_KEY_INIT_BUF_SIZE, s_app_config.initial_buffer_size);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving initial buffer size: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u8(nvs_handle, NVS_KEY_BUF_GROW_STEP, s_app_config.buffer_grow_step_size);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving buffer grow step: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u8(nvs_handle, NVS_KEY_MAX_BUF_SIZE, s_app_config.max_buffer_size);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving max buffer size: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u8(nvs_handle, NVS_KEY_MAX_GROW_SIZE, s_app_config.max_grow_size);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving max grow size: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save audio settings
-    err = nvs_set_u32(nvs_handle, NVS_KEY_SAMPLE_RATE, s_app_config.sample_rate);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving sample rate: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u8(nvs_handle, NVS_KEY_BIT_DEPTH, s_app_config.bit_depth);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving bit depth: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Store volume as integer (float * 100) for NVS
-    uint32_t volume_int = (uint32_t)(s_app_config.volume * 100.0f);
-    err = nvs_set_u32(nvs_handle, NVS_KEY_VOLUME, volume_int);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving volume: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save SPDIF data pin
-    err = nvs_set_u8(nvs_handle, NVS_KEY_SPDIF_DATA_PIN, s_app_config.spdif_data_pin);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving SPDIF data pin: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    ESP_LOGI(TAG, "Saved SPDIF data pin: %d", s_app_config.spdif_data_pin);
-    
-    // Save sleep settings
-    err = nvs_set_u32(nvs_handle, NVS_KEY_SILENCE_THRES_MS, s_app_config.silence_threshold_ms);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving silence threshold: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u32(nvs_handle, NVS_KEY_NET_CHECK_MS, s_app_config.network_check_interval_ms);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving network check interval: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u8(nvs_handle, NVS_KEY_ACTIVITY_PACKETS, s_app_config.activity_threshold_packets);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving activity threshold packets: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u16(nvs_handle, NVS_KEY_SILENCE_AMPLT, s_app_config.silence_amplitude_threshold);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving silence amplitude threshold: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u32(nvs_handle, NVS_KEY_NET_INACT_MS, s_app_config.network_inactivity_timeout_ms);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving network inactivity timeout: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save USB Scream Sender settings
-    err = nvs_set_u8(nvs_handle, NVS_KEY_ENABLE_USB_SENDER, (uint8_t)s_app_config.enable_usb_sender);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving USB sender enable: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save S/PDIF Scream Sender setting
-    err = nvs_set_u8(nvs_handle, NVS_KEY_ENABLE_SPDIF_SENDER, (uint8_t)s_app_config.enable_spdif_sender);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving S/PDIF sender enable: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    ESP_LOGI(TAG, "Saved enable_spdif_sender: %d", s_app_config.enable_spdif_sender);
-    
-    err = nvs_set_str(nvs_handle, NVS_KEY_SENDER_DEST_IP, s_app_config.sender_destination_ip);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving sender destination IP: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u16(nvs_handle, NVS_KEY_SENDER_DEST_PORT, s_app_config.sender_destination_port);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving sender destination port: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save direct write setting
-    err = nvs_set_u8(nvs_handle, NVS_KEY_USE_DIRECT_WRITE, (uint8_t)s_app_config.use_direct_write);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving direct write setting: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    ESP_LOGI(TAG, "Saved direct write setting: %d", s_app_config.use_direct_write);
-    
-    // Commit the changes (fully stop visualizer to avoid RMT during flash commit)
-//    bool viz_was_active = visualizer_is_active();
-    //if (viz_was_active) {
-//        visualizer_deinit();
-   // }
-    err = nvs_commit(nvs_handle);
-  //  if (viz_was_active) {
-//        visualizer_init();
-   // }
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing changes to NVS: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Verify the save by reading back the value
-    uint8_t saved_value;
-    err = nvs_get_u8(nvs_handle, NVS_KEY_USE_DIRECT_WRITE, &saved_value);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error verifying direct write setting: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    if (saved_value != (uint8_t)s_app_config.use_direct_write) {
-        ESP_LOGE(TAG, "Direct write setting verification failed: saved=%d, expected=%d", 
-                 saved_value, (uint8_t)s_app_config.use_direct_write);
-        nvs_close(nvs_handle);
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Direct write setting verified: %d", saved_value);
-    
-    // Save mDNS discovery settings
-    err = nvs_set_u8(nvs_handle, NVS_KEY_ENABLE_MDNS_DISCOVERY, (uint8_t)s_app_config.enable_mdns_discovery);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving mDNS discovery enable: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u32(nvs_handle, NVS_KEY_DISCOVERY_INTERVAL_MS, s_app_config.discovery_interval_ms);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving discovery interval: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    err = nvs_set_u8(nvs_handle, NVS_KEY_AUTO_SELECT_DEVICE, (uint8_t)s_app_config.auto_select_best_device);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving auto select device: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-
-    // Save NTP settings
-    err = nvs_set_u8(nvs_handle, NVS_KEY_NTP_SCREAMROUTER, (uint8_t)s_app_config.ntp_screamrouter_mode);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving NTP screamrouter mode: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    err = nvs_set_str(nvs_handle, NVS_KEY_NTP_SERVER_HOST, s_app_config.ntp_server_host);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving NTP server host: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    err = nvs_set_u16(nvs_handle, NVS_KEY_NTP_SERVER_PORT, s_app_config.ntp_server_port);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving NTP server port: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    
-    // Save setup wizard status
-    err = nvs_set_u8(nvs_handle, NVS_KEY_SETUP_WIZARD_COMPLETED, (uint8_t)s_app_config.setup_wizard_completed);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving setup wizard status: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-
-    // Save SAP stream name
-    err = nvs_set_str(nvs_handle, NVS_KEY_SAP_STREAM_NAME, s_app_config.sap_stream_name);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving SAP stream name: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
+    config_manager_publish();
+    return config_flush(false);
+}
 
-    // Save device mode (new enum-based configuration)
-    err = nvs_set_u8(nvs_handle, NVS_KEY_DEVICE_MODE, (uint8_t)s_app_config.device_mode);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving device mode: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-    ESP_LOGI(TAG, "Saved device_mode: %d", s_app_config.device_mode);
-    
-    // Commit the changes (fully stop visualizer to avoid RMT during flash commit)
-//    viz_was_active = visualizer_is_active();
-   // if (viz_was_active) {
-//        visualizer_deinit();
-//    }
-    err = nvs_commit(nvs_handle);
-  //  if (viz_was_active) {
-//        visualizer_init();
-   // }
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing changes to NVS: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
+/**
+ * Schedule a debounced save
+ */
+void config_manager_request_save(void) {
+    config_manager_publish();
+    if (s_save_task) {
+        xTaskNotifyGive(s_save_task);
+    } else {
+        config_flush(false);
     }
-    
-    // Close NVS handle
-    nvs_close(nvs_handle);
-    
-    ESP_LOGI(TAG, "Configuration saved and verified successfully");
-    return ESP_OK;
 }
 
 /**
- * Save a specific setting to NVS
+ * Update a specific setting and schedule a save
  */
 esp_err_t config_manager_save_setting(const char* key, void* value, size_t size) {
     if (!key || !value) {
         return ESP_ERR_INVALID_ARG;
     }
-    
-    ESP_LOGI(TAG, "Saving setting %s to NVS", key);
-    
-    // Open NVS handle
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return err;
-    }
-    
-    // Update in-memory configuration
-    if (strcmp(key, NVS_KEY_PORT) == 0 && size == sizeof(uint16_t)) {
-        s_app_config.port = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, *(uint16_t*)value);
-    } else if (strcmp(key, NVS_KEY_HOSTNAME) == 0) {
-        strncpy(s_app_config.hostname, (char*)value, sizeof(s_app_config.hostname) - 1);
-        s_app_config.hostname[sizeof(s_app_config.hostname) - 1] = '\0';
-        err = nvs_set_str(nvs_handle, key, s_app_config.hostname);
-    } else if (strcmp(key, NVS_KEY_AP_SSID) == 0) {
-        strncpy(s_app_config.ap_ssid, (char*)value, WIFI_SSID_MAX_LENGTH);
-        s_app_config.ap_ssid[WIFI_SSID_MAX_LENGTH] = '\0'; // Ensure null termination
-        err = nvs_set_str(nvs_handle, key, s_app_config.ap_ssid);
-    } else if (strcmp(key, NVS_KEY_AP_PASSWORD) == 0) {
-        strncpy(s_app_config.ap_password, (char*)value, WIFI_PASSWORD_MAX_LENGTH);
-        s_app_config.ap_password[WIFI_PASSWORD_MAX_LENGTH] = '\0'; // Ensure null termination
-        err = nvs_set_str(nvs_handle, key, s_app_config.ap_password);
-    } else if (strcmp(key, NVS_KEY_HIDE_AP_CONNECTED) == 0 && size == sizeof(bool)) {
-        s_app_config.hide_ap_when_connected = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.hide_ap_when_connected);
-    } else if (strcmp(key, NVS_KEY_AP_ONLY_MODE) == 0 && size == sizeof(bool)) {
-        s_app_config.ap_only_mode = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.ap_only_mode);
-    } else if (strcmp(key, NVS_KEY_INIT_BUF_SIZE) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.initial_buffer_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
-    } else if (strcmp(key, NVS_KEY_BUF_GROW_STEP) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.buffer_grow_step_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
-    } else if (strcmp(key, NVS_KEY_MAX_BUF_SIZE) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.max_buffer_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
-    } else if (strcmp(key, NVS_KEY_MAX_GROW_SIZE) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.max_grow_size = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
-    } else if (strcmp(key, NVS_KEY_SAMPLE_RATE) == 0 && size == sizeof(uint32_t)) {
-        s_app_config.sample_rate = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
-    } else if (strcmp(key, NVS_KEY_BIT_DEPTH) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.bit_depth = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
-    } else if (strcmp(key, NVS_KEY_VOLUME) == 0 && size == sizeof(float)) {
-        s_app_config.volume = *(float*)value;
-        uint32_t volume_int = (uint32_t)(s_app_config.volume * 100.0f);
-        err = nvs_set_u32(nvs_handle, key, volume_int);
-    } else if (strcmp(key, NVS_KEY_SPDIF_DATA_PIN) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.spdif_data_pin = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, s_app_config.spdif_data_pin);
-        ESP_LOGI(TAG, "Saving SPDIF data pin value: %d", s_app_config.spdif_data_pin);
-    } else if (strcmp(key, NVS_KEY_SILENCE_THRES_MS) == 0 && size == sizeof(uint32_t)) {
-        s_app_config.silence_threshold_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
-    } else if (strcmp(key, NVS_KEY_NET_CHECK_MS) == 0 && size == sizeof(uint32_t)) {
-        s_app_config.network_check_interval_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
-    } else if (strcmp(key, NVS_KEY_ACTIVITY_PACKETS) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.activity_threshold_packets = *(uint8_t*)value;
-        err = nvs_set_u8(nvs_handle, key, *(uint8_t*)value);
-    } else if (strcmp(key, NVS_KEY_SILENCE_AMPLT) == 0 && size == sizeof(uint16_t)) {
-        s_app_config.silence_amplitude_threshold = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, *(uint16_t*)value);
-    } else if (strcmp(key, NVS_KEY_NET_INACT_MS) == 0 && size == sizeof(uint32_t)) {
-        s_app_config.network_inactivity_timeout_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, *(uint32_t*)value);
-    } else if (strcmp(key, NVS_KEY_ENABLE_USB_SENDER) == 0 && size == sizeof(bool)) {
-        s_app_config.enable_usb_sender = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_usb_sender);
-    } else if (strcmp(key, NVS_KEY_ENABLE_SPDIF_SENDER) == 0 && size == sizeof(bool)) {
-        s_app_config.enable_spdif_sender = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_spdif_sender);
-        ESP_LOGI(TAG, "Updating enable_spdif_sender to: %d", s_app_config.enable_spdif_sender);
-    } else if (strcmp(key, NVS_KEY_SENDER_DEST_IP) == 0) {
-        strncpy(s_app_config.sender_destination_ip, (char*)value, 15);
-        s_app_config.sender_destination_ip[15] = '\0'; // Ensure null termination
-        err = nvs_set_str(nvs_handle, key, s_app_config.sender_destination_ip);
-    } else if (strcmp(key, NVS_KEY_SENDER_DEST_PORT) == 0 && size == sizeof(uint16_t)) {
-        s_app_config.sender_destination_port = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, s_app_config.sender_destination_port);
-    } else if (strcmp(key, NVS_KEY_USE_DIRECT_WRITE) == 0 && size == sizeof(bool)) {
-        s_app_config.use_direct_write = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.use_direct_write);
-    } else if (strcmp(key, NVS_KEY_ENABLE_MDNS_DISCOVERY) == 0 && size == sizeof(bool)) {
-        s_app_config.enable_mdns_discovery = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.enable_mdns_discovery);
-    } else if (strcmp(key, NVS_KEY_DISCOVERY_INTERVAL_MS) == 0 && size == sizeof(uint32_t)) {
-        s_app_config.discovery_interval_ms = *(uint32_t*)value;
-        err = nvs_set_u32(nvs_handle, key, s_app_config.discovery_interval_ms);
-    } else if (strcmp(key, NVS_KEY_AUTO_SELECT_DEVICE) == 0 && size == sizeof(bool)) {
-        s_app_config.auto_select_best_device = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.auto_select_best_device);
-    } else if (strcmp(key, NVS_KEY_SETUP_WIZARD_COMPLETED) == 0 && size == sizeof(bool)) {
-        s_app_config.setup_wizard_completed = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.setup_wizard_completed);
-    } else if (strcmp(key, NVS_KEY_SAP_STREAM_NAME) == 0) {
-        strncpy(s_app_config.sap_stream_name, (char*)value, sizeof(s_app_config.sap_stream_name) - 1);
-        s_app_config.sap_stream_name[sizeof(s_app_config.sap_stream_name) - 1] = '\0';
-        err = nvs_set_str(nvs_handle, key, s_app_config.sap_stream_name);
-    } else if (strcmp(key, NVS_KEY_DEVICE_MODE) == 0 && size == sizeof(uint8_t)) {
-        s_app_config.device_mode = (device_mode_t)(*(uint8_t*)value);
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.device_mode);
-        ESP_LOGI(TAG, "Updating device_mode to: %d", s_app_config.device_mode);
-        
-        // Update legacy boolean fields based on new device_mode
-        switch (s_app_config.device_mode) {
-            case MODE_RECEIVER_USB:
-            case MODE_RECEIVER_SPDIF:
-                s_app_config.enable_usb_sender = false;
-                s_app_config.enable_spdif_sender = false;
-                break;
-            case MODE_SENDER_USB:
-                s_app_config.enable_usb_sender = true;
-                s_app_config.enable_spdif_sender = false;
-                break;
-            case MODE_SENDER_SPDIF:
-                s_app_config.enable_usb_sender = false;
-                s_app_config.enable_spdif_sender = true;
-                break;
-        }
-        // Also save the legacy fields to NVS
-        nvs_set_u8(nvs_handle, NVS_KEY_ENABLE_USB_SENDER, (uint8_t)s_app_config.enable_usb_sender);
-        nvs_set_u8(nvs_handle, NVS_KEY_ENABLE_SPDIF_SENDER, (uint8_t)s_app_config.enable_spdif_sender);
-    } else if (strcmp(key, NVS_KEY_NTP_SCREAMROUTER) == 0 && size == sizeof(bool)) {
-        s_app_config.ntp_screamrouter_mode = *(bool*)value;
-        err = nvs_set_u8(nvs_handle, key, (uint8_t)s_app_config.ntp_screamrouter_mode);
-    } else if (strcmp(key, NVS_KEY_NTP_SERVER_HOST) == 0) {
-        strncpy(s_app_config.ntp_server_host, (char*)value, sizeof(s_app_config.ntp_server_host) - 1);
-        s_app_config.ntp_server_host[sizeof(s_app_config.ntp_server_host) - 1] = '\0';
-        err = nvs_set_str(nvs_handle, key, s_app_config.ntp_server_host);
-    } else if (strcmp(key, NVS_KEY_NTP_SERVER_PORT) == 0 && size == sizeof(uint16_t)) {
-        s_app_config.ntp_server_port = *(uint16_t*)value;
-        err = nvs_set_u16(nvs_handle, key, s_app_config.ntp_server_port);
-    } else {
-        err = ESP_ERR_INVALID_ARG;
+
+    const config_field_t *f = find_field(key);
+    if (!f) {
+        ESP_LOGE(TAG, "Unknown setting %s", key);
+        return ESP_ERR_INVALID_ARG;
     }
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving setting %s: %s", key, esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
+
+    uint8_t *dst = (uint8_t *)&s_app_config + f->offset;
+    uint32_t v;
+    switch (f->type) {
+        case FIELD_U8:
+        case FIELD_U16:
+        case FIELD_U32:
+        case FIELD_BOOL:
+        case FIELD_MODE:
+            if (!read_uint(value, size, &v)) {
+                ESP_LOGE(TAG, "Bad size %u for setting %s", (unsigned)size, key);
+                return ESP_ERR_INVALID_SIZE;
+            }
+            write_uint(dst, f->size, f->type == FIELD_BOOL ? (v != 0) : v);
+            break;
+        case FIELD_VOLUME:
+            if (size != sizeof(float)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            memcpy(&s_app_config.volume, value, sizeof(float));
+            break;
+        case FIELD_STR:
+            strncpy((char *)dst, (const char *)value, f->size - 1);
+            dst[f->size - 1] = '\0';
+            break;
+        case FIELD_BLOB:
+            if (size != f->size) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            memcpy(dst, value, f->size);
+            break;
     }
-    
-    // Commit the changes (fully stop visualizer to avoid RMT during flash commit)
-//    bool viz_was_active2 = visualizer_is_active();
-   // if (viz_was_active2) {
-//        visualizer_deinit();
-//    }
-    err = nvs_commit(nvs_handle);
-   // if (viz_was_active2) {
-//        visualizer_init();
-  //  }
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing changes to NVS: %s", esp_err_to_name(err));
+
+    if (f->type == FIELD_MODE) {
+        ESP_LOGI(TAG, "Updating device_mode to: %d", s_app_config.device_mode);
+        sync_legacy_mode_flags();
     }
-    
-    // Close NVS handle
-    nvs_close(nvs_handle);
-    
-    return err;
+
+    ESP_LOGD(TAG, "Setting %s updated, save scheduled", f->key);
+    config_manager_request_save();
+    return ESP_OK;
 }
 
 /**
@@ -928,48 +861,44 @@ esp_err_t config_manager_save_setting(const char* key, void* value, size_t size)
  */
 esp_err_t config_manager_reset(void) {
     ESP_LOGI(TAG, "Resetting configuration to defaults");
-    
-    // Reset in-memory configuration to defaults
+
+    if (s_save_lock) {
+        xSemaphoreTake(s_save_lock, portMAX_DELAY);
+    }
+
+    // Reset in-memory configuration to defaults; an empty namespace loads as the same
     set_default_config();
-    
+    s_saved_config = s_app_config;
+    s_saved_valid = true;
+    config_manager_publish();
+
     // Open NVS handle
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    
-    if (err != ESP_OK) {
-        if (err == ESP_ERR_NVS_NOT_FOUND) {
-            // Namespace doesn't exist, so already at defaults
-            return ESP_OK;
+
+    if (err == ESP_OK) {
+        // Erase all settings in this namespace
+        err = nvs_erase_all(nvs_handle);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle);
         }
-        
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Error erasing NVS namespace: %s", esp_err_to_name(err));
+        }
+        nvs_close(nvs_handle);
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // Namespace doesn't exist, so already at defaults
+        err = ESP_OK;
+    } else {
         ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return err;
     }
-    
-    // Erase all settings in this namespace
-    err = nvs_erase_all(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error erasing NVS namespace: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
+
+    if (s_save_lock) {
+        xSemaphoreGive(s_save_lock);
     }
-    
-    // Commit the changes (fully stop visualizer to avoid RMT during flash commit)
-//    bool viz_was_active3 = visualizer_is_active();
-  //if (viz_was_active3) {
-//        visualizer_deinit();
-  //  }
-    err = nvs_commit(nvs_handle);
-   // if (viz_was_active3) {
-//        visualizer_init();
-   // }
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing changes to NVS: %s", esp_err_to_name(err));
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Configuration reset to defaults");
     }
-    
-    // Close NVS handle
-    nvs_close(nvs_handle);
-    
-    ESP_LOGI(TAG, "Configuration reset to defaults");
-    return ESP_OK;
+    return err;
 }
@@ -16,6 +16,16 @@ typedef enum {
     MODE_SENDER_SPDIF,        // Capture audio via SPDIF and stream to network
 } device_mode_t;
 
+// Receiver EQ: biquads per channel, each b0 b1 b2 a1 a2 with a0 normalised to 1
+#define EQ_MAX_BANDS 8
+#define EQ_COEFFS_PER_BAND 5
+
+typedef struct {
+    uint8_t band_count;                    // Active bands (0 = EQ off)
+    uint16_t crossover_hz;                 // 2-way crossover: left = low, right = high (0 = off)
+    float coeffs[EQ_MAX_BANDS][EQ_COEFFS_PER_BAND];
+} eq_config_t;
+
 typedef struct {
     // Network
     uint16_t port;
@@ -31,12 +41,17 @@ typedef struct {
     uint8_t buffer_grow_step_size;
     uint8_t max_buffer_size;
     uint8_t max_grow_size;
+    uint16_t buffer_target_ms;              // Initial latency target in ms (0 = use initial_buffer_size chunks)
+    uint16_t buffer_max_ms;                 // Ring depth in ms (0 = use max_buffer_size chunks)
     
     // Audio configuration
     uint32_t sample_rate;
     uint8_t bit_depth;
+    uint8_t ptime_ms;                       // RTP packet time (PCM_PTIME_MIN_MS..PCM_PTIME_MAX_MS)
+    uint8_t opus_pt;                        // Payload type of an Opus stream (0 = linear PCM)
     float volume;
     uint8_t spdif_data_pin; 
+    eq_config_t eq;                         // Receiver playout EQ / crossover (CONFIG_RX_EQ_ENABLED)
     
     // Sleep configuration
     uint32_t silence_threshold_ms;
@@ -51,12 +66,17 @@ typedef struct {
     bool enable_spdif_sender;              // Legacy: Enable SPDIF sender mode (deprecated, use device_mode)
     char sender_destination_ip[16];        // Destination IP for audio packets (sender modes only)
     uint16_t sender_destination_port;      // Destination port for audio packets
+    char sender_fanout_ips[128];           // Extra unicast destinations, comma-separated IPv4 (same port)
+    bool sender_fanout_mdns;               // Also unicast to every receiver mDNS discovery finds
+    bool sender_opus;                      // Send Opus (not L16) to the destination, untagged fan-out and mDNS
+    uint8_t sender_opus_complexity;        // Opus encoder complexity 0-10: CPU (battery) against quality
     
     // AP-Only mode configuration
     bool ap_only_mode;                     // Enable AP-Only mode (no WiFi client connection)
     
     // Audio processing configuration
     bool use_direct_write;                 // Use direct write instead of buffering
+    bool low_latency;                      // Low-latency playout: 1-2 chunk buffer, late chunks dropped
     
     // mDNS discovery configuration
     bool enable_mdns_discovery;            // Enable mDNS discovery of Scream devices
@@ -74,6 +94,26 @@ typedef struct {
 
     // SAP configuration
     char sap_stream_name[64];              // Name of SAP stream to automatically connect to
+
+    // Fields below are appended in blob layout order (config_manager.c); new ones go last
+    uint8_t pipeline_topology;             // pipeline_topology_t: core/priority preset of the audio tasks
+
+    // SRTP
+    char srtp_crypto[96];                  // SDES crypto value "<suite> inline:<key||salt>" (empty = plain RTP)
+
+    // ESP-NOW relay
+    uint8_t relay_role;                    // rtp_relay_role_t: pass the stream on to peers, or take it from one
+    char relay_peers[128];                 // Peer MACs, comma-separated (empty = broadcast / any sender)
+
+    // Multichannel streams
+    uint8_t stream_channels;               // Channels per frame of the stream (2..PCM_CHANNELS_MAX)
+    uint8_t channel_left;                  // Stream channel on the left output (0-based)
+    uint8_t channel_right;                 // Stream channel on the right output (0-based)
+
+    // Sender input mix
+    bool sender_mix_usb;                   // S/PDIF sender also captures USB and sends the mix
+    uint8_t sender_mix_gain_spdif;         // Mix gain of the S/PDIF input, percent
+    uint8_t sender_mix_gain_usb;           // Mix gain of the USB input, percent
 } app_config_t;
 
 // Initialize configuration (load from NVS or use defaults)
@@ -82,12 +122,28 @@ esp_err_t config_manager_init(void);
 // Get current configuration
 app_config_t* config_manager_get_config(void);
 
-// Save configuration to NVS
+// Save configuration to NVS now: one blob write, none if nothing changed since the last save
 esp_err_t config_manager_save_config(void);
 
-// Save specific configuration to NVS
+// Update one setting in memory and schedule a debounced save. key is the NVS key
+// or the app_config_t member name; integers may be passed as 1, 2 or 4 bytes.
 esp_err_t config_manager_save_setting(const char* key, void* value, size_t size);
 
+// Schedule a debounced save after changing fields through config_manager_get_config()
+// (publishes a new snapshot first)
+void config_manager_request_save(void);
+
+// Read-only, consistent copy of the config for lock-free readers. Valid for a
+// few publishes: read the fields needed, do not keep the pointer across a block.
+const app_config_t* config_manager_snapshot(void);
+
+// Version of the current snapshot; increments on every publish (0 before the first)
+uint32_t config_manager_snapshot_version(void);
+
+// Make the live config the current snapshot. Saving and save_setting() already
+// do this; call it after changing fields through config_manager_get_config() alone.
+void config_manager_publish(void);
+
 // Reset configuration to defaults
 esp_err_t config_manager_reset(void);
 
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+Print a glitch trace downloaded from the ESP32 RTP firmware
+
+    decode_trace.py <trace.bin>
+
+The file is what GET /api/trace (or /api/trace?live=1) returns: the
+event_trace_header_t of logging/event_trace.h followed by its records,
+oldest first. Times are printed in ms relative to the record that froze the
+ring (or to the newest record for a live trace).
+"""
+
+import struct
+import sys
+from pathlib import Path
+
+MAGIC = 0x43525445
+HEADER = struct.Struct('<IBBBBIIqqII')
+RECORD = struct.Struct('<IBBHi')
+
+TYPES = ['none', 'rx', 'play', 'conceal', 'underrun', 'overflow', 'resync',
+         'pll', 'steer', 'out_write', 'wifi', 'flash', 'pause']
+FLASH = ['nvs', 'ota']
+
+
+def describe(kind, a8, a16, value):
+    name = TYPES[kind] if kind < len(TYPES) else f'type{kind}'
+    if name == 'rx':
+        return f'rx        seq={a16} bytes={value}' + (' fec' if a8 else '')
+    if name == 'play':
+        return f'play      depth={a16} late={value}us'
+    if name in ('conceal', 'overflow'):
+        return f'{name:<9} depth={a16} chunk={value}'
+    if name == 'underrun':
+        return f'underrun  target={a16}'
+    if name == 'pause':
+        return f'pause     chunk={value}'
+    if name == 'pll':
+        return f'pll       error={value}us step={a16}us'
+    if name == 'steer':
+        return f'steer     {value}ppb'
+    if name == 'out_write':
+        return f'out_write bytes={a16} took={value}us' + (' ERROR' if a8 else '')
+    if name == 'wifi':
+        return f'wifi      event={a8} value={value}'
+    if name == 'flash':
+        what = FLASH[a8] if a8 < len(FLASH) else str(a8)
+        return f'flash     {what} {a16}KiB took={value}us'
+    return f'{name:<9} a8={a8} a16={a16} value={value}'
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+    data = Path(sys.argv[1]).read_bytes()
+    if len(data) < HEADER.size:
+        print(f"Error: {sys.argv[1]} is too short", file=sys.stderr)
+        return 1
+    (magic, version, record_size, trigger_type, _, count, trigger_index,
+     trigger_us, captured_us, freezes, written) = HEADER.unpack_from(data)
+    if magic != MAGIC or record_size != RECORD.size:
+        print(f"Error: {sys.argv[1]} is not a glitch trace", file=sys.stderr)
+        return 1
+    count = min(count, (len(data) - HEADER.size) // RECORD.size)
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(count)]
+
+    live = trigger_type == 0
+    print(f"# v{version}: {count} records, {written} written since boot, {freezes} freezes")
+    if not live:
+        print(f"# frozen by {TYPES[trigger_type] if trigger_type < len(TYPES) else trigger_type} "
+              f"at {trigger_us / 1e6:.3f}s, copied {(captured_us - trigger_us) / 1000:.1f}ms later")
+    if not records:
+        return 0
+
+    # Records carry the low 32 bits of the timer; wrap-safe deltas against the reference
+    ref_index = trigger_index if not live and trigger_index < count else count - 1
+    ref = records[ref_index][0]
+    for i, (t_us, kind, a8, a16, value) in enumerate(records):
+        delta = ((t_us - ref + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+        mark = '>' if i == ref_index and not live else ' '
+        print(f"{mark}{delta / 1000:+10.3f}ms  {describe(kind, a8, a16, value)}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
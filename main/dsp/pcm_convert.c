@@ -0,0 +1,194 @@
+#include "pcm_convert.h"
+#include "pcm_kernels.h"
+
+#include "esp_attr.h"
+
+#include <string.h>
+
+// All routines walk forward and never write ahead of what they have read,
+// so in-place use is safe for these same-width or narrowing conversions.
+
+// Fold a sample's top 16 bits (network order: hi, lo) into the running peak
+static inline uint32_t peak_hi16(uint32_t peak, uint8_t hi, uint8_t lo) {
+    int32_t s = (int16_t)((uint16_t)hi << 8 | lo);
+    uint32_t m = (uint32_t)(s < 0 ? -s : s);
+    return m > peak ? m : peak;
+}
+
+static uint16_t IRAM_ATTR l16_to_s16(uint8_t *dst, const uint8_t *src, size_t samples) {
+    return pcm_swap16_peak((int16_t *)dst, (const int16_t *)src, samples);
+}
+
+static uint16_t IRAM_ATTR l24_to_s24(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 3, dst += 3) {
+        uint8_t hi = src[0];
+        uint8_t mid = src[1];
+        uint8_t lo = src[2];
+        peak = peak_hi16(peak, hi, mid);
+        dst[1] = mid;
+        dst[0] = lo;
+        dst[2] = hi;
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR l24_to_s16(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 3, dst += 2) {
+        uint8_t hi = src[0];
+        uint8_t mid = src[1];
+        peak = peak_hi16(peak, hi, mid);
+        dst[0] = mid;
+        dst[1] = hi;
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR l32_to_s32(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 4, dst += 4) {
+        uint8_t b0 = src[0];
+        uint8_t b1 = src[1];
+        uint8_t b2 = src[2];
+        uint8_t b3 = src[3];
+        peak = peak_hi16(peak, b0, b1);
+        dst[0] = b3;
+        dst[1] = b2;
+        dst[2] = b1;
+        dst[3] = b0;
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR l32_to_s24(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 4, dst += 3) {
+        uint8_t b0 = src[0];
+        uint8_t b1 = src[1];
+        uint8_t b2 = src[2];
+        peak = peak_hi16(peak, b0, b1);
+        dst[0] = b2;
+        dst[1] = b1;
+        dst[2] = b0;
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR l32_to_s16(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 4, dst += 2) {
+        uint8_t b0 = src[0];
+        uint8_t b1 = src[1];
+        peak = peak_hi16(peak, b0, b1);
+        dst[0] = b1;
+        dst[1] = b0;
+    }
+    return (uint16_t)peak;
+}
+
+pcm_convert_fn pcm_convert_select(uint8_t in_bits, uint8_t out_bits) {
+    switch (in_bits) {
+    case 16:
+        return out_bits == 16 ? l16_to_s16 : NULL;
+    case 24:
+        if (out_bits == 24) return l24_to_s24;
+        if (out_bits == 16) return l24_to_s16;
+        return NULL;
+    case 32:
+        if (out_bits == 32) return l32_to_s32;
+        if (out_bits == 24) return l32_to_s24;
+        if (out_bits == 16) return l32_to_s16;
+        return NULL;
+    default:
+        return NULL;
+    }
+}
+
+// Little-endian payloads: already in host order, so same-width pairs only measure the
+// peak (and copy if not in place) and narrowing pairs keep each sample's top bytes
+
+static uint16_t IRAM_ATTR s16_to_s16(uint8_t *dst, const uint8_t *src, size_t samples) {
+    if (dst != src) {
+        memcpy(dst, src, samples * 2);
+    }
+    return pcm_peak_s16((const int16_t *)src, samples);
+}
+
+static uint16_t IRAM_ATTR s24_to_s24(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples * 3; i += 3) {
+        peak = peak_hi16(peak, src[i + 2], src[i + 1]);
+    }
+    if (dst != src) {
+        memcpy(dst, src, samples * 3);
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR s24_to_s16(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 3, dst += 2) {
+        uint8_t mid = src[1];
+        uint8_t hi = src[2];
+        peak = peak_hi16(peak, hi, mid);
+        dst[0] = mid;
+        dst[1] = hi;
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR s32_to_s32(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples * 4; i += 4) {
+        peak = peak_hi16(peak, src[i + 3], src[i + 2]);
+    }
+    if (dst != src) {
+        memcpy(dst, src, samples * 4);
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR s32_to_s24(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 4, dst += 3) {
+        uint8_t b1 = src[1];
+        uint8_t b2 = src[2];
+        uint8_t b3 = src[3];
+        peak = peak_hi16(peak, b3, b2);
+        dst[0] = b1;
+        dst[1] = b2;
+        dst[2] = b3;
+    }
+    return (uint16_t)peak;
+}
+
+static uint16_t IRAM_ATTR s32_to_s16(uint8_t *dst, const uint8_t *src, size_t samples) {
+    uint32_t peak = 0;
+    for (size_t i = 0; i < samples; i++, src += 4, dst += 2) {
+        uint8_t b2 = src[2];
+        uint8_t b3 = src[3];
+        peak = peak_hi16(peak, b3, b2);
+        dst[0] = b2;
+        dst[1] = b3;
+    }
+    return (uint16_t)peak;
+}
+
+pcm_convert_fn pcm_convert_select_le(uint8_t in_bits, uint8_t out_bits) {
+    switch (in_bits) {
+    case 16:
+        return out_bits == 16 ? s16_to_s16 : NULL;
+    case 24:
+        if (out_bits == 24) return s24_to_s24;
+        if (out_bits == 16) return s24_to_s16;
+        return NULL;
+    case 32:
+        if (out_bits == 32) return s32_to_s32;
+        if (out_bits == 24) return s32_to_s24;
+        if (out_bits == 16) return s32_to_s16;
+        return NULL;
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * RTP payload -> playout format conversion.
+ *
+ * Input is network-order linear PCM (RFC 3551 L16/L24, and L32). Output is
+ * host-order PCM in the sink's container: S16LE, packed S24LE (3 bytes) or
+ * S32LE. Each (input, output) pair has its own routine, picked once per
+ * stream with pcm_convert_select() instead of branching per sample.
+ *
+ * Only narrowing or same-width pairs exist (sinks never play more bits than
+ * the stream carries), so every routine is safe with dst == src.
+ *
+ * Each routine also returns the payload's peak level, taken from the top 16
+ * bits of every sample in the same pass, for content-based silence detection.
+ *
+ * Scream payloads carry little-endian PCM instead; pcm_convert_select_le()
+ * returns the matching routines, which only narrow (or just measure the peak).
+ */
+
+/**
+ * @brief Convert samples from a network-order payload to the playout format
+ *
+ * @param dst Output samples (may equal src)
+ * @param src Input payload
+ * @param samples Number of samples (frames * channels)
+ * @return Largest |sample| in 16-bit full scale (0-32768)
+ */
+typedef uint16_t (*pcm_convert_fn)(uint8_t *dst, const uint8_t *src, size_t samples);
+
+/**
+ * @brief Pick the conversion routine for a stream
+ *
+ * @param in_bits Payload sample width (16, 24 or 32)
+ * @param out_bits Playout sample width (16, 24 or 32, <= in_bits)
+ * @return Conversion routine, or NULL if the pair is not supported
+ */
+pcm_convert_fn pcm_convert_select(uint8_t in_bits, uint8_t out_bits);
+
+/**
+ * @brief Pick the conversion routine for a little-endian (Scream) payload
+ *
+ * @param in_bits Payload sample width (16, 24 or 32)
+ * @param out_bits Playout sample width (16, 24 or 32, <= in_bits)
+ * @return Conversion routine, or NULL if the pair is not supported
+ */
+pcm_convert_fn pcm_convert_select_le(uint8_t in_bits, uint8_t out_bits);
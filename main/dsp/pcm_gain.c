@@ -0,0 +1,93 @@
+#include "pcm_gain.h"
+
+#include "esp_attr.h"
+
+#define S24_MAX 0x7FFFFF
+#define S24_MIN (-0x800000)
+
+static inline uint32_t xorshift32(uint32_t x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// TPDF dither spanning +-1 output LSB at 'shift' fractional bits (shift <= 30)
+static inline int32_t tpdf(pcm_gain_dither_t *d, unsigned shift) {
+    uint32_t r = d->rng = xorshift32(d->rng);
+    int32_t a = (int32_t)(r & 0x7FFFu);
+    int32_t b = (int32_t)((r >> 16) & 0x7FFFu);
+    // a - b is triangular over +-2^15
+    return (a - b) << (shift - 15);
+}
+
+static inline int32_t sat(int64_t v, int32_t lo, int32_t hi) {
+    return v > hi ? hi : (v < lo ? lo : (int32_t)v);
+}
+
+// Per-frame gain increment; the last frame lands on to_q30
+static inline int32_t ramp_step(int32_t from_q30, int32_t to_q30, size_t frames) {
+    return frames ? (int32_t)(((int64_t)to_q30 - from_q30) / (int64_t)frames) : 0;
+}
+
+void IRAM_ATTR pcm_gain_ramp_s16(int16_t *buf, size_t frames, int32_t from_q30, int32_t to_q30,
+                                 pcm_gain_dither_t *d) {
+    const int32_t step = ramp_step(from_q30, to_q30, frames);
+    int32_t g = from_q30;
+    for (size_t i = 0; i < frames; i++, buf += 2) {
+        g += step;
+        int32_t g15 = g >> 15;
+        // Rounding offset, or dither centred on it
+        int32_t r0 = 1 << 14;
+        int32_t r1 = 1 << 14;
+        if (d->dither) {
+            r0 += tpdf(d, 15);
+            r1 += tpdf(d, 15);
+        }
+        buf[0] = (int16_t)sat(((int32_t)buf[0] * g15 + r0) >> 15, INT16_MIN, INT16_MAX);
+        buf[1] = (int16_t)sat(((int32_t)buf[1] * g15 + r1) >> 15, INT16_MIN, INT16_MAX);
+    }
+}
+
+static inline int32_t load_s24(const uint8_t *p) {
+    return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+}
+
+static inline void store_s24(uint8_t *p, int32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+}
+
+void IRAM_ATTR pcm_gain_ramp_s24(uint8_t *buf, size_t frames, int32_t from_q30, int32_t to_q30,
+                                 pcm_gain_dither_t *d) {
+    const int32_t step = ramp_step(from_q30, to_q30, frames);
+    int32_t g = from_q30;
+    for (size_t i = 0; i < frames; i++, buf += 6) {
+        g += step;
+        for (int ch = 0; ch < 2; ch++) {
+            int64_t r = (int64_t)1 << 29;
+            if (d->dither) {
+                r += tpdf(d, 30);
+            }
+            int64_t v = ((int64_t)load_s24(buf + 3 * ch) * g + r) >> 30;
+            store_s24(buf + 3 * ch, sat(v, S24_MIN, S24_MAX));
+        }
+    }
+}
+
+void IRAM_ATTR pcm_gain_ramp_s32(int32_t *buf, size_t frames, int32_t from_q30, int32_t to_q30,
+                                 pcm_gain_dither_t *d) {
+    const int32_t step = ramp_step(from_q30, to_q30, frames);
+    int32_t g = from_q30;
+    for (size_t i = 0; i < frames; i++, buf += 2) {
+        g += step;
+        for (int ch = 0; ch < 2; ch++) {
+            int64_t r = (int64_t)1 << 29;
+            if (d->dither) {
+                r += tpdf(d, 30);
+            }
+            buf[ch] = sat(((int64_t)buf[ch] * g + r) >> 30, INT32_MIN, INT32_MAX);
+        }
+    }
+}
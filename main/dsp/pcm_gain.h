@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Ramped gain for host-order playout PCM (S16LE, packed S24LE, S32LE).
+ *
+ * Gains are Q30 (PCM_GAIN_Q30_UNITY = 1.0) and move linearly from one value
+ * to the next across the buffer, frame by frame, so a volume change never
+ * steps mid-waveform. 16-bit samples take a 32-bit multiply by the Q15 part
+ * of the gain; wider samples a 32x32->64 multiply by the full Q30 gain.
+ *
+ * Scaling leaves fractional bits that the output word can't hold. With
+ * dither enabled they are requantized with TPDF dither (two uniform values,
+ * +-1 LSB triangular) instead of being truncated, which turns the
+ * level-dependent distortion of quiet passages into a constant noise floor.
+ * Callers should skip the kernels at unity gain to stay bit-exact.
+ */
+
+#define PCM_GAIN_Q30_UNITY (1 << 30)
+
+typedef struct {
+    uint32_t rng;       // xorshift32 state; must not be 0
+    bool dither;
+} pcm_gain_dither_t;
+
+/**
+ * @param buf Stereo frames, scaled in place
+ * @param frames Number of frames
+ * @param from_q30 Gain for the first frame
+ * @param to_q30 Gain reached at the end of the buffer
+ * @param d Dither state, updated
+ */
+void pcm_gain_ramp_s16(int16_t *buf, size_t frames, int32_t from_q30, int32_t to_q30, pcm_gain_dither_t *d);
+
+void pcm_gain_ramp_s24(uint8_t *buf, size_t frames, int32_t from_q30, int32_t to_q30, pcm_gain_dither_t *d);
+
+void pcm_gain_ramp_s32(int32_t *buf, size_t frames, int32_t from_q30, int32_t to_q30, pcm_gain_dither_t *d);
@@ -0,0 +1,334 @@
+#include "pcm_kernels.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "esp_attr.h"
+
+// Swap the bytes of both 16-bit lanes of a 32-bit word
+#define SWAP16X2(w) ((((w) & 0x00FF00FFu) << 8) | (((w) >> 8) & 0x00FF00FFu))
+
+static inline uint16_t swap16(uint16_t v) {
+    return (uint16_t)((v << 8) | (v >> 8));
+}
+
+static inline int16_t apply_gain(int16_t s, int32_t gain_q15) {
+    // |s * gain| >> 15 stays within int16 for gain <= unity
+    return (int16_t)(((int32_t)s * gain_q15) >> 15);
+}
+
+static inline bool both_word_aligned(const void *a, const void *b) {
+    return ((((uintptr_t)a) | ((uintptr_t)b)) & 3u) == 0;
+}
+
+static inline int32_t clamp_gain(int32_t gain_q15) {
+    if (gain_q15 < 0) {
+        return 0;
+    }
+    if (gain_q15 > PCM_GAIN_Q15_UNITY) {
+        return PCM_GAIN_Q15_UNITY;
+    }
+    return gain_q15;
+}
+
+int32_t pcm_gain_to_q15(float volume) {
+    if (!(volume > 0.0f)) {
+        return 0;
+    }
+    if (volume >= 1.0f) {
+        return PCM_GAIN_Q15_UNITY;
+    }
+    return (int32_t)(volume * (float)PCM_GAIN_Q15_UNITY + 0.5f);
+}
+
+void IRAM_ATTR pcm_swap16(int16_t *dst, const int16_t *src, size_t count) {
+    size_t i = 0;
+
+    if (both_word_aligned(dst, src)) {
+        const uint32_t *s32 = (const uint32_t *)src;
+        uint32_t *d32 = (uint32_t *)dst;
+        size_t words = count / 2;
+        size_t w = 0;
+        // Unrolled by 4 words (8 samples) to keep the loop overhead off the critical path
+        for (; w + 4 <= words; w += 4) {
+            uint32_t a = s32[w];
+            uint32_t b = s32[w + 1];
+            uint32_t c = s32[w + 2];
+            uint32_t d = s32[w + 3];
+            d32[w]     = SWAP16X2(a);
+            d32[w + 1] = SWAP16X2(b);
+            d32[w + 2] = SWAP16X2(c);
+            d32[w + 3] = SWAP16X2(d);
+        }
+        for (; w < words; w++) {
+            uint32_t a = s32[w];
+            d32[w] = SWAP16X2(a);
+        }
+        i = words * 2;
+    }
+
+    const uint16_t *s16 = (const uint16_t *)src;
+    uint16_t *d16 = (uint16_t *)dst;
+    for (; i < count; i++) {
+        d16[i] = swap16(s16[i]);
+    }
+}
+
+// Running max of |s|; abs and max are single instructions on Xtensa, so this stays branch-free
+static inline uint32_t peak_max(uint32_t peak, int32_t s) {
+    uint32_t m = (uint32_t)(s < 0 ? -s : s);
+    return m > peak ? m : peak;
+}
+
+uint16_t IRAM_ATTR pcm_swap16_peak(int16_t *dst, const int16_t *src, size_t count) {
+    uint32_t peak = 0;
+    size_t i = 0;
+
+    if (both_word_aligned(dst, src)) {
+        const uint32_t *s32 = (const uint32_t *)src;
+        uint32_t *d32 = (uint32_t *)dst;
+        size_t words = count / 2;
+        size_t w = 0;
+        for (; w + 4 <= words; w += 4) {
+            uint32_t a = SWAP16X2(s32[w]);
+            uint32_t b = SWAP16X2(s32[w + 1]);
+            uint32_t c = SWAP16X2(s32[w + 2]);
+            uint32_t d = SWAP16X2(s32[w + 3]);
+            d32[w]     = a;
+            d32[w + 1] = b;
+            d32[w + 2] = c;
+            d32[w + 3] = d;
+            peak = peak_max(peak, (int16_t)a);
+            peak = peak_max(peak, (int16_t)(a >> 16));
+            peak = peak_max(peak, (int16_t)b);
+            peak = peak_max(peak, (int16_t)(b >> 16));
+            peak = peak_max(peak, (int16_t)c);
+            peak = peak_max(peak, (int16_t)(c >> 16));
+            peak = peak_max(peak, (int16_t)d);
+            peak = peak_max(peak, (int16_t)(d >> 16));
+        }
+        for (; w < words; w++) {
+            uint32_t a = SWAP16X2(s32[w]);
+            d32[w] = a;
+            peak = peak_max(peak, (int16_t)a);
+            peak = peak_max(peak, (int16_t)(a >> 16));
+        }
+        i = words * 2;
+    }
+
+    const uint16_t *s16 = (const uint16_t *)src;
+    uint16_t *d16 = (uint16_t *)dst;
+    for (; i < count; i++) {
+        uint16_t v = swap16(s16[i]);
+        d16[i] = v;
+        peak = peak_max(peak, (int16_t)v);
+    }
+    return (uint16_t)peak;
+}
+
+uint16_t IRAM_ATTR pcm_peak_s16(const int16_t *src, size_t count) {
+    uint32_t p0 = 0;
+    uint32_t p1 = 0;
+    size_t i = 0;
+    // Two accumulators keep the max chains independent
+    for (; i + 4 <= count; i += 4) {
+        p0 = peak_max(p0, src[i]);
+        p1 = peak_max(p1, src[i + 1]);
+        p0 = peak_max(p0, src[i + 2]);
+        p1 = peak_max(p1, src[i + 3]);
+    }
+    for (; i < count; i++) {
+        p0 = peak_max(p0, src[i]);
+    }
+    return (uint16_t)(p0 > p1 ? p0 : p1);
+}
+
+void IRAM_ATTR pcm_gain_q15_swap16(int16_t *dst, const int16_t *src, size_t count, int32_t gain_q15) {
+    gain_q15 = clamp_gain(gain_q15);
+    if (gain_q15 == PCM_GAIN_Q15_UNITY) {
+        pcm_swap16(dst, src, count);
+        return;
+    }
+
+    uint16_t *d16 = (uint16_t *)dst;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int16_t a = apply_gain(src[i], gain_q15);
+        int16_t b = apply_gain(src[i + 1], gain_q15);
+        int16_t c = apply_gain(src[i + 2], gain_q15);
+        int16_t d = apply_gain(src[i + 3], gain_q15);
+        d16[i]     = swap16((uint16_t)a);
+        d16[i + 1] = swap16((uint16_t)b);
+        d16[i + 2] = swap16((uint16_t)c);
+        d16[i + 3] = swap16((uint16_t)d);
+    }
+    for (; i < count; i++) {
+        d16[i] = swap16((uint16_t)apply_gain(src[i], gain_q15));
+    }
+}
+
+uint16_t IRAM_ATTR pcm_gain_q15_swap16_any(int16_t *dst, const int16_t *src, size_t count, int32_t gain_q15) {
+    gain_q15 = clamp_gain(gain_q15);
+    uint32_t any = 0;
+    size_t i = 0;
+
+    if (gain_q15 == PCM_GAIN_Q15_UNITY) {
+        if (both_word_aligned(dst, src)) {
+            // The swap moves bytes without changing whether a word is zero, so OR the input
+            const uint32_t *s32 = (const uint32_t *)src;
+            uint32_t *d32 = (uint32_t *)dst;
+            size_t words = count / 2;
+            size_t w = 0;
+            for (; w + 4 <= words; w += 4) {
+                uint32_t a = s32[w];
+                uint32_t b = s32[w + 1];
+                uint32_t c = s32[w + 2];
+                uint32_t d = s32[w + 3];
+                d32[w]     = SWAP16X2(a);
+                d32[w + 1] = SWAP16X2(b);
+                d32[w + 2] = SWAP16X2(c);
+                d32[w + 3] = SWAP16X2(d);
+                any |= a | b | c | d;
+            }
+            for (; w < words; w++) {
+                uint32_t a = s32[w];
+                d32[w] = SWAP16X2(a);
+                any |= a;
+            }
+            i = words * 2;
+        }
+        const uint16_t *s16 = (const uint16_t *)src;
+        uint16_t *d16 = (uint16_t *)dst;
+        for (; i < count; i++) {
+            any |= s16[i];
+            d16[i] = swap16(s16[i]);
+        }
+        return (uint16_t)(any | (any >> 16));
+    }
+
+    uint16_t *d16 = (uint16_t *)dst;
+    for (; i + 4 <= count; i += 4) {
+        uint16_t a = (uint16_t)apply_gain(src[i], gain_q15);
+        uint16_t b = (uint16_t)apply_gain(src[i + 1], gain_q15);
+        uint16_t c = (uint16_t)apply_gain(src[i + 2], gain_q15);
+        uint16_t d = (uint16_t)apply_gain(src[i + 3], gain_q15);
+        d16[i]     = swap16(a);
+        d16[i + 1] = swap16(b);
+        d16[i + 2] = swap16(c);
+        d16[i + 3] = swap16(d);
+        any |= (uint32_t)(a | b | c | d);
+    }
+    for (; i < count; i++) {
+        uint16_t a = (uint16_t)apply_gain(src[i], gain_q15);
+        d16[i] = swap16(a);
+        any |= a;
+    }
+    return (uint16_t)any;
+}
+
+void IRAM_ATTR pcm_swap16_gain_q15(int16_t *dst, const int16_t *src, size_t count, int32_t gain_q15) {
+    gain_q15 = clamp_gain(gain_q15);
+    if (gain_q15 == PCM_GAIN_Q15_UNITY) {
+        pcm_swap16(dst, src, count);
+        return;
+    }
+
+    const uint16_t *s16 = (const uint16_t *)src;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int16_t a = (int16_t)swap16(s16[i]);
+        int16_t b = (int16_t)swap16(s16[i + 1]);
+        int16_t c = (int16_t)swap16(s16[i + 2]);
+        int16_t d = (int16_t)swap16(s16[i + 3]);
+        dst[i]     = apply_gain(a, gain_q15);
+        dst[i + 1] = apply_gain(b, gain_q15);
+        dst[i + 2] = apply_gain(c, gain_q15);
+        dst[i + 3] = apply_gain(d, gain_q15);
+    }
+    for (; i < count; i++) {
+        dst[i] = apply_gain((int16_t)swap16(s16[i]), gain_q15);
+    }
+}
+
+void IRAM_ATTR pcm_swap16_to_s32(int32_t *dst, const int16_t *src, size_t count) {
+    const uint16_t *s16 = (const uint16_t *)src;
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = (int32_t)((uint32_t)swap16(s16[i]) << 16);
+    }
+}
+
+void IRAM_ATTR pcm_extract_pair(uint8_t *dst, const uint8_t *src, size_t frames, uint8_t channels,
+                                uint8_t left, uint8_t right, uint8_t sample_bytes) {
+    size_t i = 0;
+
+    if (sample_bytes == 2 && right == left + 1 && (left & 1u) == 0 && (channels & 1u) == 0 &&
+        both_word_aligned(dst, src)) {
+        // The pair is one word of every frame: a strided word gather
+        const uint32_t *s32 = (const uint32_t *)src + left / 2u;
+        uint32_t *d32 = (uint32_t *)dst;
+        size_t stride = channels / 2u;
+        for (; i + 4 <= frames; i += 4) {
+            uint32_t a = s32[i * stride];
+            uint32_t b = s32[(i + 1) * stride];
+            uint32_t c = s32[(i + 2) * stride];
+            uint32_t d = s32[(i + 3) * stride];
+            d32[i]     = a;
+            d32[i + 1] = b;
+            d32[i + 2] = c;
+            d32[i + 3] = d;
+        }
+        for (; i < frames; i++) {
+            d32[i] = s32[i * stride];
+        }
+        return;
+    }
+
+    if (sample_bytes == 4 && both_word_aligned(dst, src)) {
+        const uint32_t *s32 = (const uint32_t *)src;
+        uint32_t *d32 = (uint32_t *)dst;
+        for (; i < frames; i++) {
+            // Both loads before the stores: frame 0 may overlap its own output
+            uint32_t l = s32[i * channels + left];
+            uint32_t r = s32[i * channels + right];
+            d32[2 * i]     = l;
+            d32[2 * i + 1] = r;
+        }
+        return;
+    }
+
+    size_t frame_bytes = (size_t)channels * sample_bytes;
+    for (; i < frames; i++) {
+        const uint8_t *in = src + i * frame_bytes;
+        uint8_t pair[8];
+        memcpy(pair, in + (size_t)left * sample_bytes, sample_bytes);
+        memcpy(pair + sample_bytes, in + (size_t)right * sample_bytes, sample_bytes);
+        memcpy(dst + i * 2u * sample_bytes, pair, 2u * sample_bytes);
+    }
+}
+
+static inline int16_t sat16(int32_t v) {
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+void IRAM_ATTR pcm_mix_add_sat16(int16_t *dst, const int16_t *src, size_t count) {
+    size_t i = 0;
+    // Unrolled by 4 so the compiler can keep the clamps branch-free (min/max)
+    for (; i + 4 <= count; i += 4) {
+        int32_t a = (int32_t)dst[i] + src[i];
+        int32_t b = (int32_t)dst[i + 1] + src[i + 1];
+        int32_t c = (int32_t)dst[i + 2] + src[i + 2];
+        int32_t d = (int32_t)dst[i + 3] + src[i + 3];
+        dst[i]     = sat16(a);
+        dst[i + 1] = sat16(b);
+        dst[i + 2] = sat16(c);
+        dst[i + 3] = sat16(d);
+    }
+    for (; i < count; i++) {
+        dst[i] = sat16((int32_t)dst[i] + src[i]);
+    }
+}
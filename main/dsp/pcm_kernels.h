@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * PCM sample kernels shared by the receiver and sender hot loops.
+ *
+ * All kernels accept dst == src (in-place). When both pointers are 32-bit
+ * aligned the bulk of the work is done two samples per word (SWAR); other
+ * buffers and the tail fall back to the scalar path.
+ */
+
+// Unity gain in Q15 (1.0). Gains are clamped to [0, PCM_GAIN_Q15_UNITY].
+#define PCM_GAIN_Q15_UNITY 32768
+
+/**
+ * @brief Convert a 0.0-1.0 volume to a Q15 gain
+ *
+ * @param volume Linear volume (values outside 0.0-1.0 are clamped)
+ * @return Gain in Q15, PCM_GAIN_Q15_UNITY for full scale
+ */
+int32_t pcm_gain_to_q15(float volume);
+
+/**
+ * @brief Byte-swap 16-bit samples (network <-> host order)
+ *
+ * @param dst Destination samples
+ * @param src Source samples
+ * @param count Number of 16-bit samples
+ */
+void pcm_swap16(int16_t *dst, const int16_t *src, size_t count);
+
+/**
+ * @brief Byte-swap 16-bit samples and measure their peak in the same pass
+ *
+ * @param dst Destination samples
+ * @param src Source samples
+ * @param count Number of 16-bit samples
+ * @return Largest |sample| after the swap (0-32768)
+ */
+uint16_t pcm_swap16_peak(int16_t *dst, const int16_t *src, size_t count);
+
+/**
+ * @brief Peak magnitude of host-order 16-bit samples
+ *
+ * @param src Samples (host order)
+ * @param count Number of 16-bit samples
+ * @return Largest |sample| (0-32768)
+ */
+uint16_t pcm_peak_s16(const int16_t *src, size_t count);
+
+/**
+ * @brief Scale host-order samples by a Q15 gain, then byte-swap (TX direction)
+ *
+ * @param dst Destination samples (network order)
+ * @param src Source samples (host order)
+ * @param count Number of 16-bit samples
+ * @param gain_q15 Gain in Q15; PCM_GAIN_Q15_UNITY degenerates to pcm_swap16()
+ */
+void pcm_gain_q15_swap16(int16_t *dst, const int16_t *src, size_t count, int32_t gain_q15);
+
+/**
+ * @brief pcm_gain_q15_swap16() that also reports whether the output is digital silence
+ *
+ * @return The OR of every output sample: 0 exactly when all of them are zero
+ */
+uint16_t pcm_gain_q15_swap16_any(int16_t *dst, const int16_t *src, size_t count, int32_t gain_q15);
+
+/**
+ * @brief Byte-swap network-order samples, then scale by a Q15 gain (RX direction)
+ *
+ * @param dst Destination samples (host order)
+ * @param src Source samples (network order)
+ * @param count Number of 16-bit samples
+ * @param gain_q15 Gain in Q15; PCM_GAIN_Q15_UNITY degenerates to pcm_swap16()
+ */
+void pcm_swap16_gain_q15(int16_t *dst, const int16_t *src, size_t count, int32_t gain_q15);
+
+/**
+ * @brief Convert network-order 16-bit samples to left-justified host 32-bit
+ *
+ * @param dst Destination samples (may not alias src)
+ * @param src Source samples (network order)
+ * @param count Number of samples
+ */
+void pcm_swap16_to_s32(int32_t *dst, const int16_t *src, size_t count);
+
+/**
+ * @brief Pick two channels out of interleaved multichannel frames (channel map)
+ *
+ * Gathers channels `left` and `right` of each frame into consecutive stereo
+ * frames, before any byte-order conversion (samples are moved as-is). When
+ * the pair is an adjacent, even-aligned L16 pair of an even-width frame, each
+ * output frame is a single 32-bit word move; L32 moves two words per frame.
+ * In place (dst == src) is safe: the output never overtakes the input.
+ *
+ * @param dst Stereo frames (2 * sample_bytes each)
+ * @param src Interleaved frames (channels * sample_bytes each)
+ * @param frames Number of frames
+ * @param channels Channels per source frame (2 or more)
+ * @param left Source channel for the left output (< channels)
+ * @param right Source channel for the right output (< channels)
+ * @param sample_bytes Bytes per sample (2, 3 or 4)
+ */
+void pcm_extract_pair(uint8_t *dst, const uint8_t *src, size_t frames, uint8_t channels,
+                      uint8_t left, uint8_t right, uint8_t sample_bytes);
+
+/**
+ * @brief Mix host-order samples into dst with saturation (dst = sat16(dst + src))
+ *
+ * @param dst Samples to mix into (host order)
+ * @param src Samples to add (host order)
+ * @param count Number of 16-bit samples
+ */
+void pcm_mix_add_sat16(int16_t *dst, const int16_t *src, size_t count);
@@ -17,7 +17,11 @@
 #include "config/config_manager.h"
 #include "wifi_manager.h"
 #include "lifecycle_manager.h"
+#include "lifecycle/attach_wake.h"
 #include "logging/log_buffer.h"
+#include "audio_arena.h"
+#include "receiver/rtcp_receiver.h"
+#include "cJSON.h"
 #include "bq25895_integration.h"
 #include "TS3USB30ERSWR.h"
 
@@ -30,6 +34,9 @@ bool is_gpio_pressed(gpio_num_t pin) {
 
 void app_main(void)
 {
+    // Woken by a USB attach glitch: straight back to deep sleep
+    attach_wake_boot_check();
+
     // Initialize NVS (required for USB subsystem)
     BaseType_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -38,6 +45,15 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    // Audio buffers' RAM, taken before Wi-Fi and the web server cut up the heap
+    audio_arena_init();
+#ifdef CONFIG_RTCP_ENABLED
+    rtcp_alloc_tables();
+#endif
+    // JSON trees and printed responses are cold: PSRAM when present
+    cJSON_Hooks json_hooks = { .malloc_fn = audio_arena_alloc_cold, .free_fn = audio_arena_free };
+    cJSON_InitHooks(&json_hooks);
+
     // Initialize log buffer system
     ESP_LOGI(TAG, "Initializing log buffer system");
     esp_err_t log_err = log_buffer_init();
@@ -7,7 +7,40 @@
 #include "freertos/event_groups.h"
 
 // PCM bytes per chunk (from Kconfig to keep single source of truth)
+// Default chunk (6 ms at 48 kHz/16-bit/stereo); the active size follows the ptime setting
 #define PCM_CHUNK_SIZE CONFIG_PCM_CHUNK_SIZE
+// Largest chunk any ptime may produce; sizes static packet/staging buffers
+#define PCM_CHUNK_MAX_SIZE CONFIG_PCM_CHUNK_MAX_SIZE
+
+// Supported RTP payload sample widths (L16/L24/L32)
+#define PCM_BIT_DEPTH_VALID(bits) ((bits) == 16 || (bits) == 24 || (bits) == 32)
+
+// Channels a linear PCM stream may carry; the receiver plays two of them (the channel map)
+#define PCM_CHANNELS_MAX 8
+#define PCM_CHANNELS_VALID(ch) ((ch) >= 2 && (ch) <= PCM_CHANNELS_MAX)
+
+// RTP dynamic payload types (RFC 3551); Opus is always announced with one
+#define RTP_PT_DYNAMIC_VALID(pt) ((pt) >= 96 && (pt) <= 127)
+
+// Supported packet time range (ms)
+#define PCM_PTIME_MIN_MS 1
+#define PCM_PTIME_MAX_MS 20
+
+// Bytes of interleaved PCM in one packet of ptime_ms, in whole frames, clamped to
+// PCM_CHUNK_MAX_SIZE. Falls back to PCM_CHUNK_SIZE when the format is unknown.
+static inline uint32_t pcm_chunk_bytes_for_ptime(uint32_t ptime_ms, uint32_t sample_rate,
+                                                 uint32_t bytes_per_frame) {
+    if (ptime_ms == 0 || sample_rate == 0 || bytes_per_frame == 0) {
+        return PCM_CHUNK_SIZE;
+    }
+    if (ptime_ms < PCM_PTIME_MIN_MS) ptime_ms = PCM_PTIME_MIN_MS;
+    if (ptime_ms > PCM_PTIME_MAX_MS) ptime_ms = PCM_PTIME_MAX_MS;
+    uint32_t frames = (sample_rate * ptime_ms) / 1000u;
+    uint32_t max_frames = PCM_CHUNK_MAX_SIZE / bytes_per_frame;
+    if (frames > max_frames) frames = max_frames;
+    if (frames == 0) frames = 1;
+    return frames * bytes_per_frame;
+}
 
 // Network activity monitoring
 #define NETWORK_PACKET_RECEIVED_BIT BIT0
@@ -0,0 +1,116 @@
+#include "attach_wake.h"
+#include "sdkconfig.h"
+#include "../build_config.h"
+
+#ifdef CONFIG_USB_ATTACH_WAKE
+#include "lifecycle_internal.h"
+#include "../config/config_manager.h"
+#include "usb_out.h"
+#include "TS3USB30ERSWR.h"
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#undef TAG
+#define TAG "attach_wake"
+
+#define ATTACH_PIN ((gpio_num_t)CONFIG_USB_ATTACH_WAKE_GPIO)
+#ifdef CONFIG_USB_ATTACH_WAKE_ACTIVE_HIGH
+#define ATTACH_ACTIVE_LEVEL 1
+#else
+#define ATTACH_ACTIVE_LEVEL 0
+#endif
+
+static int64_t s_no_dac_since_us = 0;   // USB receiver without a DAC since (0: has one, or other mode)
+static bool s_held_logged = false;
+
+static bool attach_pin_active(void) {
+    return rtc_gpio_get_level(ATTACH_PIN) == ATTACH_ACTIVE_LEVEL;
+}
+
+static void attach_pin_setup(void) {
+    rtc_gpio_init(ATTACH_PIN);
+    rtc_gpio_set_direction(ATTACH_PIN, RTC_GPIO_MODE_INPUT_ONLY);
+    // Idle level from the opposite pull, so an open line reads detached
+    if (ATTACH_ACTIVE_LEVEL) {
+        rtc_gpio_pullup_dis(ATTACH_PIN);
+        rtc_gpio_pulldown_en(ATTACH_PIN);
+    } else {
+        rtc_gpio_pulldown_dis(ATTACH_PIN);
+        rtc_gpio_pullup_en(ATTACH_PIN);
+    }
+}
+
+// Pin and switch are set up (or still held from the last sleep)
+static void attach_wake_sleep(void) {
+    // No timer: only an attach wakes the device
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    esp_sleep_enable_ext0_wakeup(ATTACH_PIN, ATTACH_ACTIVE_LEVEL);
+    esp_deep_sleep_start();
+}
+#endif
+
+void attach_wake_boot_check(void) {
+#ifdef CONFIG_USB_ATTACH_WAKE
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT0) {
+        return;
+    }
+    // The pin is still an RTC input with its pull from before the sleep
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_USB_ATTACH_WAKE_SETTLE_MS));
+    if (!attach_pin_active()) {
+        // Spurious: back to sleep before NVS, Wi-Fi or any service costs power
+        attach_wake_sleep();
+    }
+    ESP_LOGI(TAG, "Woken by a USB attach on GPIO %d", CONFIG_USB_ATTACH_WAKE_GPIO);
+    rtc_gpio_deinit(ATTACH_PIN);
+    gpio_hold_dis((gpio_num_t)USB_SWITCH_SEL_PIN);
+    gpio_hold_dis((gpio_num_t)USB_SWITCH_OE_PIN);
+    gpio_deep_sleep_hold_dis();
+#endif
+}
+
+void attach_wake_tick(void) {
+#ifdef CONFIG_USB_ATTACH_WAKE
+    if (lifecycle_get_current_state() != LIFECYCLE_STATE_MODE_RECEIVER_USB || usb_out_is_connected()) {
+        s_no_dac_since_us = 0;
+        s_held_logged = false;
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (s_no_dac_since_us == 0) {
+        s_no_dac_since_us = now;
+        return;
+    }
+    if (now - s_no_dac_since_us < (int64_t)CONFIG_USB_ATTACH_WAKE_IDLE_S * 1000000) {
+        return;
+    }
+
+    // Read through the GPIO matrix: the pad may still belong to the USB PHY
+    if (gpio_get_level(ATTACH_PIN) == ATTACH_ACTIVE_LEVEL) {
+        // Would wake at once: a device is there but did not enumerate
+        if (!s_held_logged) {
+            ESP_LOGW(TAG, "No DAC for %d s, but the attach signal is active; staying awake",
+                     CONFIG_USB_ATTACH_WAKE_IDLE_S);
+            s_held_logged = true;
+        }
+        return;
+    }
+
+    ESP_LOGI(TAG, "No DAC for %d s, deep sleeping until one is attached (GPIO %d)",
+             CONFIG_USB_ATTACH_WAKE_IDLE_S, CONFIG_USB_ATTACH_WAKE_GPIO);
+    // Pending settings are written now: deep sleep does not run the shutdown handlers
+    config_manager_save_config();
+    attach_pin_setup();
+    // The DAC's lines stay routed to this device while it sleeps
+    usb_switch_set_port(USB_SWITCH_PORT_1);
+    usb_switch_set_enable(true);
+    gpio_hold_en((gpio_num_t)USB_SWITCH_SEL_PIN);
+    gpio_hold_en((gpio_num_t)USB_SWITCH_OE_PIN);
+    gpio_deep_sleep_hold_en();
+    attach_wake_sleep();
+#endif
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * @file attach_wake.h
+ * @brief Deep sleep while no USB DAC is attached (CONFIG_USB_ATTACH_WAKE)
+ *
+ * A USB receiver with no DAC for CONFIG_USB_ATTACH_WAKE_IDLE_S has nothing to
+ * play on, so it deep sleeps with the attach signal as its only wake
+ * source. Both calls are no-ops without the option.
+ */
+
+/**
+ * @brief Check-only boot path, first thing in app_main()
+ *
+ * After a wake by the attach pin, waits CONFIG_USB_ATTACH_WAKE_SETTLE_MS and
+ * deep sleeps again at once if the signal is no longer active; otherwise
+ * releases the pins held through the sleep and lets the boot go on.
+ */
+void attach_wake_boot_check(void);
+
+// Lifecycle background tick: counts the time without a DAC in USB receiver mode
+void attach_wake_tick(void);
@@ -0,0 +1,187 @@
+#include "boot_graph.h"
+#include "lifecycle_internal.h"
+#include "hw_init.h"
+#include "services.h"
+#include "../global.h"
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#define BOOT_WORKER_PRIORITY 5
+
+typedef struct {
+    const char *name;
+    esp_err_t (*start)(void);   // NULL for a milestone
+    uint32_t deps;              // BOOT_BIT()s that must be done first
+    BaseType_t core;
+    bool critical;              // Boot cannot continue without it
+} boot_service_t;
+
+#define DEP(id) BOOT_BIT(BOOT_SVC_##id)
+
+// Services that install interrupts stay on core 0: an ISR is allocated on the
+// core that installs it, and core 1 belongs to audio once a mode starts.
+static const boot_service_t s_services[BOOT_SVC_COUNT] = {
+    [BOOT_SVC_NVS]        = { "nvs",        lifecycle_hw_init_nvs,                  0,                       0, true  },
+    [BOOT_SVC_CONFIG]     = { "config",     lifecycle_hw_init_config,               DEP(NVS),                0, true  },
+    [BOOT_SVC_OTA]        = { "ota",        lifecycle_hw_init_ota,                  DEP(NVS),                1, false },
+    [BOOT_SVC_BATTERY]    = { "battery",    lifecycle_hw_init_battery,              0,                       0, false },
+    [BOOT_SVC_POWER]      = { "power",      lifecycle_hw_init_power_management,     0,                       1, false },
+    [BOOT_SVC_DAC_DETECT] = { "dac_detect", lifecycle_hw_init_dac_detection,        DEP(CONFIG),             1, false },
+    // Power management is configured before the Wi-Fi driver starts, as it always was
+    [BOOT_SVC_WIFI]       = { "wifi",       lifecycle_services_init_wifi,           DEP(CONFIG) | DEP(POWER), 0, true  },
+    // Needs the netif layer and event loop the Wi-Fi manager creates
+    [BOOT_SVC_ETH]        = { "ethernet",   lifecycle_services_init_ethernet,       DEP(WIFI),               0, false },
+    // After Wi-Fi, whose crypto must claim its GDMA channels before the RMT does
+    [BOOT_SVC_SPDIF_RX]   = { "spdif_rx",   lifecycle_services_init_spdif_receiver, DEP(WIFI),               0, false },
+    [BOOT_SVC_AUDIO_PATH] = { "audio_path", NULL,                                   0,                       0, false },
+    [BOOT_SVC_WEB]        = { "web",        lifecycle_services_init_web_server,     DEP(WIFI) | DEP(AUDIO_PATH), 0, false },
+    [BOOT_SVC_MDNS]       = { "mdns",       lifecycle_services_init_mdns,           DEP(WIFI) | DEP(AUDIO_PATH), 0, false },
+};
+
+#define BOOT_ALL_SERVICES (BOOT_BIT(BOOT_SVC_COUNT) - 1)
+
+static EventGroupHandle_t s_done = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static esp_timer_handle_t s_audio_timer = NULL;
+static uint32_t s_started = 0;          // Under s_lock
+static uint32_t s_failed = 0;           // Under s_lock
+static esp_err_t s_result[BOOT_SVC_COUNT];
+static int64_t s_boot_start_us = 0;
+
+static void boot_worker(void *arg);
+
+// Record a service as finished; the caller holds s_lock
+static void finish_locked(boot_service_id_t id, esp_err_t err)
+{
+    s_result[id] = err;
+    if (err != ESP_OK) {
+        s_failed |= BOOT_BIT(id);
+    }
+    EventBits_t done = xEventGroupSetBits(s_done, BOOT_BIT(id));
+    if ((done & BOOT_ALL_SERVICES) == BOOT_ALL_SERVICES) {
+        ESP_LOGI(TAG, "Boot: all services up %lld ms after start",
+                 (esp_timer_get_time() - s_boot_start_us) / 1000);
+    }
+}
+
+// Start everything whose dependencies are done
+static void dispatch(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool progressed = true;
+    while (progressed) {
+        progressed = false;
+        uint32_t done = xEventGroupGetBits(s_done);
+        for (int id = 0; id < BOOT_SVC_COUNT; id++) {
+            const boot_service_t *svc = &s_services[id];
+            if (!svc->start || (s_started & BOOT_BIT(id)) || (svc->deps & ~done)) {
+                continue;
+            }
+            s_started |= BOOT_BIT(id);
+            if (svc->deps & s_failed) {
+                // Nothing to build on: fail it too, so waiters are not left hanging
+                ESP_LOGE(TAG, "Boot: skipping %s, a dependency failed", svc->name);
+                finish_locked(id, ESP_ERR_INVALID_STATE);
+                progressed = true;
+                continue;
+            }
+            if (xTaskCreatePinnedToCore(boot_worker, svc->name, CONFIG_BOOT_WORKER_STACK_SIZE,
+                                        (void *)(intptr_t)id, BOOT_WORKER_PRIORITY, NULL,
+                                        svc->core) != pdPASS) {
+                ESP_LOGE(TAG, "Boot: no memory for the %s task", svc->name);
+                finish_locked(id, ESP_ERR_NO_MEM);
+                progressed = true;
+            }
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static void boot_worker(void *arg)
+{
+    boot_service_id_t id = (boot_service_id_t)(intptr_t)arg;
+    const boot_service_t *svc = &s_services[id];
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = svc->start();
+    int64_t end_us = esp_timer_get_time();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Boot: %s up in %lld ms (+%lld ms)", svc->name,
+                 (end_us - start_us) / 1000, (end_us - s_boot_start_us) / 1000);
+    } else {
+        ESP_LOGW(TAG, "Boot: %s failed after %lld ms: %s", svc->name,
+                 (end_us - start_us) / 1000, esp_err_to_name(err));
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    finish_locked(id, err);
+    xSemaphoreGive(s_lock);
+    dispatch();
+    vTaskDelete(NULL);
+}
+
+static void audio_wait_expired(void *arg)
+{
+    (void)arg;
+    if (!(xEventGroupGetBits(s_done) & BOOT_BIT(BOOT_SVC_AUDIO_PATH))) {
+        ESP_LOGI(TAG, "Boot: no audio path after %d ms, starting the web UI and discovery anyway",
+                 CONFIG_BOOT_AUDIO_FIRST_MAX_WAIT_MS);
+    }
+    lifecycle_boot_mark_done(BOOT_SVC_AUDIO_PATH);
+}
+
+esp_err_t lifecycle_boot_run_until(uint32_t wait_mask)
+{
+    if (!s_done) {
+        s_done = xEventGroupCreate();
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_done || !s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+        s_boot_start_us = esp_timer_get_time();
+
+        const esp_timer_create_args_t timer_args = {
+            .callback = audio_wait_expired,
+            .name = "boot_audio_wait",
+        };
+        if (esp_timer_create(&timer_args, &s_audio_timer) == ESP_OK) {
+            esp_timer_start_once(s_audio_timer, (uint64_t)CONFIG_BOOT_AUDIO_FIRST_MAX_WAIT_MS * 1000);
+        } else {
+            // Without the fallback the web UI could wait forever: do not hold it back
+            lifecycle_boot_mark_done(BOOT_SVC_AUDIO_PATH);
+        }
+        dispatch();
+    }
+
+    xEventGroupWaitBits(s_done, wait_mask, pdFALSE, pdTRUE, portMAX_DELAY);
+    for (int id = 0; id < BOOT_SVC_COUNT; id++) {
+        if ((wait_mask & BOOT_BIT(id)) && s_services[id].critical && s_result[id] != ESP_OK) {
+            return s_result[id];
+        }
+    }
+    return ESP_OK;
+}
+
+void lifecycle_boot_mark_done(boot_service_id_t id)
+{
+    if (!s_done || id >= BOOT_SVC_COUNT) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool newly_done = !(xEventGroupGetBits(s_done) & BOOT_BIT(id));
+    if (newly_done) {
+        s_started |= BOOT_BIT(id);
+        ESP_LOGI(TAG, "Boot: %s reached at +%lld ms", s_services[id].name,
+                 (esp_timer_get_time() - s_boot_start_us) / 1000);
+        finish_locked(id, ESP_OK);
+    }
+    xSemaphoreGive(s_lock);
+    if (newly_done) {
+        dispatch();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @file boot_graph.h
+ * @brief Dependency-ordered, concurrent startup of the boot services
+ * 
+ * Each boot service lists the services it needs. A service starts in its own
+ * short-lived task, pinned to its core, as soon as all of those are done, so
+ * independent work (charger probe, OTA bookkeeping, power management) overlaps
+ * the configuration load and the Wi-Fi start.
+ * 
+ * The web UI and mDNS/NTP additionally wait for BOOT_SVC_AUDIO_PATH, marked
+ * once the operating mode has its receive socket and jitter buffer (or its
+ * capture path) up. So audio comes first after a power cycle; the milestone
+ * is forced after CONFIG_BOOT_AUDIO_FIRST_MAX_WAIT_MS, or at once without
+ * Wi-Fi credentials, so the configuration portal never waits on a stream.
+ */
+
+typedef enum {
+    BOOT_SVC_NVS = 0,
+    BOOT_SVC_CONFIG,
+    BOOT_SVC_OTA,
+    BOOT_SVC_BATTERY,
+    BOOT_SVC_POWER,
+    BOOT_SVC_DAC_DETECT,
+    BOOT_SVC_WIFI,
+    BOOT_SVC_ETH,           // Wired Ethernet (CONFIG_NET_ETHERNET_ENABLED), else a no-op
+    BOOT_SVC_SPDIF_RX,
+    BOOT_SVC_AUDIO_PATH,    // Milestone, marked by the state machine
+    BOOT_SVC_WEB,
+    BOOT_SVC_MDNS,
+    BOOT_SVC_COUNT
+} boot_service_id_t;
+
+#define BOOT_BIT(id) (1u << (id))
+
+// What HW_INIT and STARTING_SERVICES wait for before moving on
+#define BOOT_HW_SERVICES (BOOT_BIT(BOOT_SVC_NVS) | BOOT_BIT(BOOT_SVC_CONFIG) | \
+                          BOOT_BIT(BOOT_SVC_DAC_DETECT))
+#define BOOT_NET_SERVICES (BOOT_BIT(BOOT_SVC_WIFI) | BOOT_BIT(BOOT_SVC_SPDIF_RX))
+
+/**
+ * @brief Start every service whose dependencies are met, and wait for some
+ * 
+ * The first call starts the graph; later calls only wait. Services outside
+ * wait_mask keep starting in the background as their dependencies complete.
+ * 
+ * @param wait_mask BOOT_BIT()s to wait for
+ * @return ESP_OK, or the error of the first critical service in wait_mask
+ *         that failed (NVS, configuration, Wi-Fi)
+ */
+esp_err_t lifecycle_boot_run_until(uint32_t wait_mask);
+
+/**
+ * @brief Mark a milestone done, releasing the services waiting on it
+ * 
+ * Safe to call repeatedly and from any task.
+ */
+void lifecycle_boot_mark_done(boot_service_id_t id);
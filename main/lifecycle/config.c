@@ -8,9 +8,18 @@
 #include "../mdns/mdns_service.h"
 #include "../mdns/mdns_discovery.h"
 #include "../sender/network_out.h"
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+#include "../sender/opus_out.h"
+#endif
 #include "../receiver/network_in.h"
 #include "../receiver/audio_out.h"
 #include "../receiver/buffer.h"
+#include "../receiver/eq.h"
+#include "pipeline_topology.h"
+#include "modes.h"
+#include "reconfig.h"
+#include "rtp/rtp_srtp.h"
+#include "rtp/rtp_relay.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include <string.h>
@@ -26,10 +35,13 @@ extern void resume_playback(void);
 
 // ============================================================================
 // CONFIGURATION GETTER FUNCTIONS
+// Scalar getters read the published snapshot (one atomic load, no lock), so the
+// audio paths can call them per packet; getters that return a pointer into the
+// config keep using the live copy, which outlives any snapshot slot.
 // ============================================================================
 
 uint16_t lifecycle_get_port(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->port;
 }
 
@@ -39,32 +51,80 @@ const char* lifecycle_get_hostname(void) {
 }
 
 uint32_t lifecycle_get_sample_rate(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->sample_rate;
 }
 
 uint8_t lifecycle_get_bit_depth(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
+    if (!PCM_BIT_DEPTH_VALID(config->bit_depth)) {
+        return BIT_DEPTH;
+    }
     return config->bit_depth;
 }
 
-float lifecycle_get_volume(void) {
+uint8_t lifecycle_get_stream_channels(void) {
+    const app_config_t *config = config_manager_snapshot();
+    if (!PCM_CHANNELS_VALID(config->stream_channels)) {
+        return STREAM_CHANNELS;
+    }
+    return config->stream_channels;
+}
+
+uint8_t lifecycle_get_channel_left(void) {
+    const app_config_t *config = config_manager_snapshot();
+    if (config->channel_left >= PCM_CHANNELS_MAX) {
+        return CHANNEL_LEFT;
+    }
+    return config->channel_left;
+}
+
+uint8_t lifecycle_get_channel_right(void) {
+    const app_config_t *config = config_manager_snapshot();
+    if (config->channel_right >= PCM_CHANNELS_MAX) {
+        return CHANNEL_RIGHT;
+    }
+    return config->channel_right;
+}
+
+uint8_t lifecycle_get_ptime_ms(void) {
+    const app_config_t *config = config_manager_snapshot();
+    if (config->ptime_ms < PCM_PTIME_MIN_MS || config->ptime_ms > PCM_PTIME_MAX_MS) {
+        return PTIME_MS;
+    }
+    return config->ptime_ms;
+}
+
+uint8_t lifecycle_get_opus_pt(void) {
+    const app_config_t *config = config_manager_snapshot();
+    if (!RTP_PT_DYNAMIC_VALID(config->opus_pt)) {
+        return 0;
+    }
+    return config->opus_pt;
+}
+
+const char* lifecycle_get_srtp_crypto(void) {
     app_config_t *config = config_manager_get_config();
+    return config->srtp_crypto;
+}
+
+float lifecycle_get_volume(void) {
+    const app_config_t *config = config_manager_snapshot();
     return config->volume;
 }
 
 device_mode_t lifecycle_get_device_mode(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->device_mode;
 }
 
 bool lifecycle_get_enable_usb_sender(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->device_mode == MODE_SENDER_USB;
 }
 
 bool lifecycle_get_enable_spdif_sender(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->device_mode == MODE_SENDER_SPDIF;
 }
 
@@ -79,7 +139,7 @@ const char* lifecycle_get_ap_password(void) {
 }
 
 bool lifecycle_get_hide_ap_when_connected(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->hide_ap_when_connected;
 }
 
@@ -88,84 +148,155 @@ const char* lifecycle_get_sender_destination_ip(void) {
     return config->sender_destination_ip;
 }
 
-uint16_t lifecycle_get_sender_destination_port(void) {
+const char* lifecycle_get_sender_fanout_ips(void) {
     app_config_t *config = config_manager_get_config();
+    return config->sender_fanout_ips;
+}
+
+bool lifecycle_get_sender_fanout_mdns(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->sender_fanout_mdns;
+}
+
+bool lifecycle_get_sender_opus(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->sender_opus;
+}
+
+uint8_t lifecycle_get_sender_opus_complexity(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->sender_opus_complexity <= 10 ? config->sender_opus_complexity : CONFIG_RTP_TX_OPUS_COMPLEXITY;
+}
+
+bool lifecycle_get_sender_mix_usb(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->sender_mix_usb;
+}
+
+uint8_t lifecycle_get_sender_mix_gain_spdif(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->sender_mix_gain_spdif;
+}
+
+uint8_t lifecycle_get_sender_mix_gain_usb(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->sender_mix_gain_usb;
+}
+
+uint16_t lifecycle_get_sender_destination_port(void) {
+    const app_config_t *config = config_manager_snapshot();
     return config->sender_destination_port;
 }
 
 uint8_t lifecycle_get_initial_buffer_size(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->initial_buffer_size;
 }
 
 uint8_t lifecycle_get_max_buffer_size(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->max_buffer_size;
 }
 
 uint8_t lifecycle_get_buffer_grow_step_size(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->buffer_grow_step_size;
 }
 
 uint8_t lifecycle_get_max_grow_size(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->max_grow_size;
 }
 
+uint16_t lifecycle_get_buffer_target_ms(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->buffer_target_ms;
+}
+
+uint16_t lifecycle_get_buffer_max_ms(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->buffer_max_ms;
+}
+
 uint8_t lifecycle_get_spdif_data_pin(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->spdif_data_pin;
 }
 
-bool lifecycle_get_use_direct_write(void) {
+const eq_config_t* lifecycle_get_eq(void) {
     app_config_t *config = config_manager_get_config();
+    return &config->eq;
+}
+
+bool lifecycle_get_use_direct_write(void) {
+    const app_config_t *config = config_manager_snapshot();
     return config->use_direct_write;
 }
 
+uint8_t lifecycle_get_pipeline_topology(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->pipeline_topology < PIPELINE_TOPOLOGY_COUNT ? config->pipeline_topology
+                                                               : CONFIG_PIPELINE_TOPOLOGY_DEFAULT_ID;
+}
+
+uint8_t lifecycle_get_relay_role(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->relay_role < RTP_RELAY_ROLE_COUNT ? config->relay_role : RTP_RELAY_OFF;
+}
+
+const char* lifecycle_get_relay_peers(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->relay_peers;
+}
+
+bool lifecycle_get_low_latency(void) {
+    const app_config_t *config = config_manager_snapshot();
+    return config->low_latency;
+}
+
 uint32_t lifecycle_get_silence_threshold_ms(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->silence_threshold_ms;
 }
 
 uint32_t lifecycle_get_network_check_interval_ms(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->network_check_interval_ms;
 }
 
 uint8_t lifecycle_get_activity_threshold_packets(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->activity_threshold_packets;
 }
 
 uint16_t lifecycle_get_silence_amplitude_threshold(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->silence_amplitude_threshold;
 }
 
 uint32_t lifecycle_get_network_inactivity_timeout_ms(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->network_inactivity_timeout_ms;
 }
 
 bool lifecycle_get_enable_mdns_discovery(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->enable_mdns_discovery;
 }
 
 uint32_t lifecycle_get_discovery_interval_ms(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->discovery_interval_ms;
 }
 
 bool lifecycle_get_auto_select_best_device(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->auto_select_best_device;
 }
 
 // ----- NTP configuration getters -----
 bool lifecycle_get_ntp_screamrouter_mode(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->ntp_screamrouter_mode;
 }
 
@@ -175,7 +306,7 @@ const char* lifecycle_get_ntp_server_host(void) {
 }
 
 uint16_t lifecycle_get_ntp_server_port(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->ntp_server_port;
 }
 
@@ -224,6 +355,131 @@ esp_err_t lifecycle_set_hostname(const char* hostname) {
     return ESP_OK;
 }
 
+esp_err_t lifecycle_set_ptime_ms(uint8_t ptime_ms) {
+    if (ptime_ms < PCM_PTIME_MIN_MS || ptime_ms > PCM_PTIME_MAX_MS) {
+        ESP_LOGE(TAG, "Invalid ptime: %u ms", ptime_ms);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t *config = config_manager_get_config();
+    if (config->ptime_ms != ptime_ms) {
+        ESP_LOGI(TAG, "Setting ptime to %u ms", ptime_ms);
+        config->ptime_ms = ptime_ms;
+        esp_err_t ret = config_manager_save_setting("ptime_ms", &ptime_ms, sizeof(ptime_ms));
+        if (ret == ESP_OK) {
+            // Chunk sizes are fixed when a mode starts; the change handler restarts it
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lifecycle_set_opus_pt(uint8_t opus_pt) {
+    if (opus_pt != 0 && !RTP_PT_DYNAMIC_VALID(opus_pt)) {
+        ESP_LOGE(TAG, "Invalid Opus payload type: %u", opus_pt);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t *config = config_manager_get_config();
+    if (config->opus_pt != opus_pt) {
+        ESP_LOGI(TAG, "Setting Opus payload type to %u", opus_pt);
+        config->opus_pt = opus_pt;
+        esp_err_t ret = config_manager_save_setting("opus_pt", &opus_pt, sizeof(opus_pt));
+        if (ret == ESP_OK) {
+            // The decoder is started (or not) when a receiver mode starts
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lifecycle_set_srtp_crypto(const char* crypto) {
+    if (!crypto) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (crypto[0] != '\0' && rtp_srtp_parse(crypto) == RTP_SRTP_NONE) {
+        ESP_LOGE(TAG, "Invalid SRTP crypto value");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t *config = config_manager_get_config();
+    if (strcmp(config->srtp_crypto, crypto) != 0) {
+        ESP_LOGI(TAG, "Setting SRTP suite to %s", rtp_srtp_suite_name(rtp_srtp_parse(crypto)));
+        esp_err_t ret = config_manager_save_setting("srtp_crypto", (void*)crypto, strlen(crypto) + 1);
+        if (ret == ESP_OK) {
+            // Session keys are derived when the receiver or sender starts
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lifecycle_set_stream_channels(uint8_t channels) {
+    if (!PCM_CHANNELS_VALID(channels)) {
+        ESP_LOGE(TAG, "Invalid stream channel count: %u", channels);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t *config = config_manager_get_config();
+    if (config->stream_channels != channels) {
+        ESP_LOGI(TAG, "Setting stream channels to %u", channels);
+        config->stream_channels = channels;
+        esp_err_t ret = config_manager_save_setting("stream_ch", &channels, sizeof(channels));
+        if (ret == ESP_OK) {
+            // The payload layout is fixed when a mode starts, like the sample width
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lifecycle_set_channel_map(uint8_t left, uint8_t right) {
+    if (left >= PCM_CHANNELS_MAX || right >= PCM_CHANNELS_MAX) {
+        ESP_LOGE(TAG, "Invalid channel map: %u/%u", left, right);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t *config = config_manager_get_config();
+    if (config->channel_left != left || config->channel_right != right) {
+        ESP_LOGI(TAG, "Setting channel map to %u/%u", left, right);
+        config->channel_left = left;
+        config->channel_right = right;
+        esp_err_t ret = config_manager_save_setting("ch_left", &left, sizeof(left));
+        if (ret == ESP_OK) {
+            ret = config_manager_save_setting("ch_right", &right, sizeof(right));
+        }
+        if (ret == ESP_OK) {
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lifecycle_set_bit_depth(uint8_t bit_depth) {
+    if (!PCM_BIT_DEPTH_VALID(bit_depth)) {
+        ESP_LOGE(TAG, "Invalid bit depth: %u", bit_depth);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    app_config_t *config = config_manager_get_config();
+    if (config->bit_depth != bit_depth) {
+        ESP_LOGI(TAG, "Setting bit depth to %u", bit_depth);
+        config->bit_depth = bit_depth;
+        esp_err_t ret = config_manager_save_setting("bit_depth", &bit_depth, sizeof(bit_depth));
+        if (ret == ESP_OK) {
+            // Sample conversion and sink formats are fixed when a mode starts
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
 esp_err_t lifecycle_set_volume(float volume) {
     if (volume < 0.0f || volume > 1.0f) {
         ESP_LOGE(TAG, "Invalid volume value: %f", volume);
@@ -236,9 +492,13 @@ esp_err_t lifecycle_set_volume(float volume) {
         config->volume = volume;
         esp_err_t ret = config_manager_save_setting("volume", &volume, sizeof(volume));
         if (ret == ESP_OK) {
-            // Apply volume change immediately if in receiver USB mode
+            // Apply volume change immediately if in receiver USB mode (any receiver mode with software volume)
             lifecycle_state_t state = lifecycle_get_current_state();
-            if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB) {
+            if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+                || state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF
+#endif
+                ) {
                 audio_out_update_volume();
             }
             // Post event for notification
@@ -507,6 +767,48 @@ esp_err_t lifecycle_set_max_grow_size(uint8_t size) {
     return ESP_OK;
 }
 
+esp_err_t lifecycle_set_buffer_target_ms(uint16_t ms) {
+    app_config_t *config = config_manager_get_config();
+    if (config->buffer_target_ms != ms) {
+        ESP_LOGI(TAG, "Setting buffer_target_ms to %u", ms);
+        config->buffer_target_ms = ms;
+        esp_err_t ret = config_manager_save_setting("buf_target_ms", &ms, sizeof(ms));
+        if (ret == ESP_OK) {
+            // If in receiver mode, retarget the playing buffer immediately
+            lifecycle_state_t state = lifecycle_get_current_state();
+            if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB ||
+                state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
+                ESP_LOGI(TAG, "Updating buffer target immediately");
+                buffer_retarget();
+            }
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t lifecycle_set_buffer_max_ms(uint16_t ms) {
+    app_config_t *config = config_manager_get_config();
+    if (config->buffer_max_ms != ms) {
+        ESP_LOGI(TAG, "Setting buffer_max_ms to %u", ms);
+        config->buffer_max_ms = ms;
+        esp_err_t ret = config_manager_save_setting("buf_max_ms", &ms, sizeof(ms));
+        if (ret == ESP_OK) {
+            // If in receiver mode, reconfigure buffer immediately
+            lifecycle_state_t state = lifecycle_get_current_state();
+            if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB ||
+                state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
+                ESP_LOGI(TAG, "Updating buffer configuration immediately");
+                buffer_size_reconfigure();
+            }
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
+        }
+        return ret;
+    }
+    return ESP_OK;
+}
+
 esp_err_t lifecycle_set_spdif_data_pin(uint8_t pin) {
     if (pin > 39) { // ESP32 GPIO range
         ESP_LOGE(TAG, "Invalid SPDIF data pin: %d", pin);
@@ -704,7 +1006,9 @@ esp_err_t lifecycle_set_ntp_server_port(uint16_t port) {
 // ============================================================================
 // BATCH UPDATE FUNCTION
 // Batch update implementation
-// Applies provided fields atomically to the in-memory config and persists to NVS.
+// Applies provided fields to the in-memory config and persists to NVS. Readers of
+// the lifecycle_get_* accessors see the whole batch at once: the save publishes
+// one new config snapshot after every field is written.
 // Keeps legacy flags in sync with device_mode and triggers runtime updates where applicable.
 // ============================================================================
 
@@ -770,16 +1074,49 @@ esp_err_t lifecycle_update_config_batch(const lifecycle_config_update_t* updates
     if (updates->update_max_grow_size) {
         config->max_grow_size = updates->max_grow_size;
     }
+    if (updates->update_buffer_target_ms) {
+        config->buffer_target_ms = updates->buffer_target_ms;
+    }
+    if (updates->update_buffer_max_ms) {
+        config->buffer_max_ms = updates->buffer_max_ms;
+    }
 
-    // Audio settings (volume handled here; sample_rate handled separately by caller)
+    // Audio settings
     if (updates->update_volume) {
         config->volume = updates->volume;
     }
+    if (updates->update_sample_rate && updates->sample_rate > 0) {
+        config->sample_rate = updates->sample_rate;
+    }
+    if (updates->update_ptime_ms &&
+        updates->ptime_ms >= PCM_PTIME_MIN_MS && updates->ptime_ms <= PCM_PTIME_MAX_MS) {
+        config->ptime_ms = updates->ptime_ms;
+    }
+    if (updates->update_bit_depth && PCM_BIT_DEPTH_VALID(updates->bit_depth)) {
+        config->bit_depth = updates->bit_depth;
+    }
+    if (updates->update_stream_channels && PCM_CHANNELS_VALID(updates->stream_channels)) {
+        config->stream_channels = updates->stream_channels;
+    }
+    if (updates->update_channel_left && updates->channel_left < PCM_CHANNELS_MAX) {
+        config->channel_left = updates->channel_left;
+    }
+    if (updates->update_channel_right && updates->channel_right < PCM_CHANNELS_MAX) {
+        config->channel_right = updates->channel_right;
+    }
+    if (updates->update_opus_pt &&
+        (updates->opus_pt == 0 || RTP_PT_DYNAMIC_VALID(updates->opus_pt))) {
+        config->opus_pt = updates->opus_pt;
+    }
 
     if (updates->update_spdif_data_pin) {
         config->spdif_data_pin = updates->spdif_data_pin;
     }
 
+    if (updates->update_eq && updates->eq.band_count <= EQ_MAX_BANDS) {
+        config->eq = updates->eq;
+    }
+
     // Sender settings
     if (updates->update_sender_destination_ip && updates->sender_destination_ip) {
         strncpy(config->sender_destination_ip, updates->sender_destination_ip, sizeof(config->sender_destination_ip) - 1);
@@ -788,6 +1125,28 @@ esp_err_t lifecycle_update_config_batch(const lifecycle_config_update_t* updates
     if (updates->update_sender_destination_port) {
         config->sender_destination_port = updates->sender_destination_port;
     }
+    if (updates->update_sender_fanout_ips && updates->sender_fanout_ips) {
+        strncpy(config->sender_fanout_ips, updates->sender_fanout_ips, sizeof(config->sender_fanout_ips) - 1);
+        config->sender_fanout_ips[sizeof(config->sender_fanout_ips) - 1] = '\0';
+    }
+    if (updates->update_sender_fanout_mdns) {
+        config->sender_fanout_mdns = updates->sender_fanout_mdns;
+    }
+    if (updates->update_sender_opus) {
+        config->sender_opus = updates->sender_opus;
+    }
+    if (updates->update_sender_opus_complexity && updates->sender_opus_complexity <= 10) {
+        config->sender_opus_complexity = updates->sender_opus_complexity;
+    }
+    if (updates->update_sender_mix_usb) {
+        config->sender_mix_usb = updates->sender_mix_usb;
+    }
+    if (updates->update_sender_mix_gain_spdif && updates->sender_mix_gain_spdif <= 100) {
+        config->sender_mix_gain_spdif = updates->sender_mix_gain_spdif;
+    }
+    if (updates->update_sender_mix_gain_usb && updates->sender_mix_gain_usb <= 100) {
+        config->sender_mix_gain_usb = updates->sender_mix_gain_usb;
+    }
 
     // Sleep settings
     if (updates->update_silence_threshold_ms) {
@@ -810,6 +1169,12 @@ esp_err_t lifecycle_update_config_batch(const lifecycle_config_update_t* updates
     if (updates->update_use_direct_write) {
         config->use_direct_write = updates->use_direct_write;
     }
+    if (updates->update_low_latency) {
+        config->low_latency = updates->low_latency;
+    }
+    if (updates->update_pipeline_topology && updates->pipeline_topology < PIPELINE_TOPOLOGY_COUNT) {
+        config->pipeline_topology = updates->pipeline_topology;
+    }
 
     // mDNS discovery
     if (updates->update_enable_mdns_discovery) {
@@ -845,6 +1210,21 @@ esp_err_t lifecycle_update_config_batch(const lifecycle_config_update_t* updates
         config->sap_stream_name[sizeof(config->sap_stream_name) - 1] = '\0';
     }
 
+    // SRTP keys (validated by the caller)
+    if (updates->update_srtp_crypto && updates->srtp_crypto) {
+        strncpy(config->srtp_crypto, updates->srtp_crypto, sizeof(config->srtp_crypto) - 1);
+        config->srtp_crypto[sizeof(config->srtp_crypto) - 1] = '\0';
+    }
+
+    // ESP-NOW relay (peer list validated by the caller)
+    if (updates->update_relay_role && updates->relay_role < RTP_RELAY_ROLE_COUNT) {
+        config->relay_role = updates->relay_role;
+    }
+    if (updates->update_relay_peers && updates->relay_peers) {
+        strncpy(config->relay_peers, updates->relay_peers, sizeof(config->relay_peers) - 1);
+        config->relay_peers[sizeof(config->relay_peers) - 1] = '\0';
+    }
+
     // Apply resolved device mode and keep legacy fields in sync
     config->device_mode = resolved_mode;
     switch (resolved_mode) {
@@ -873,7 +1253,7 @@ esp_err_t lifecycle_update_config_batch(const lifecycle_config_update_t* updates
 // ============================================================================
 
 bool lifecycle_get_setup_wizard_completed(void) {
-    app_config_t *config = config_manager_get_config();
+    const app_config_t *config = config_manager_snapshot();
     return config->setup_wizard_completed;
 }
 
@@ -998,11 +1378,64 @@ bool lifecycle_config_handle_configuration_changed(void) {
         }
     }
 
-    // Buffer parameter changes
-    if (current_config->initial_buffer_size != previous_config.initial_buffer_size ||
+    // Fan-out destinations: the sender list is rebuilt on the next lifecycle tick
+    if (strcmp(current_config->sender_fanout_ips, previous_config.sender_fanout_ips) != 0 ||
+        current_config->sender_fanout_mdns != previous_config.sender_fanout_mdns) {
+        ESP_LOGI(TAG, "Sender fan-out changed: \"%s\" (mDNS %d) -> \"%s\" (mDNS %d)",
+                 previous_config.sender_fanout_ips, previous_config.sender_fanout_mdns,
+                 current_config->sender_fanout_ips, current_config->sender_fanout_mdns);
+        any_changes = true;
+        rtp_sender_reload_fanout();
+    }
+
+    // Codec selection follows the fan-out rebuild; complexity applies from the next frame
+    if (current_config->sender_opus != previous_config.sender_opus) {
+        ESP_LOGI(TAG, "Sender codec changed to %s", current_config->sender_opus ? "Opus" : "L16");
+        any_changes = true;
+        rtp_sender_reload_fanout();
+    }
+    if (current_config->sender_opus_complexity != previous_config.sender_opus_complexity) {
+        ESP_LOGI(TAG, "Sender Opus complexity changed from %u to %u",
+                 previous_config.sender_opus_complexity, current_config->sender_opus_complexity);
+        any_changes = true;
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+        opus_out_set_complexity(current_config->sender_opus_complexity);
+#endif
+    }
+
+    // Mixing sender: USB capture is brought up with the S/PDIF sender; gains apply from the next packet
+    if (current_config->sender_mix_usb != previous_config.sender_mix_usb) {
+        ESP_LOGI(TAG, "Sender USB mix %s", current_config->sender_mix_usb ? "enabled" : "disabled");
+        any_changes = true;
+        if (state == LIFECYCLE_STATE_MODE_SENDER_SPDIF) {
+            restart_required = true;
+        }
+    }
+    if (current_config->sender_mix_gain_spdif != previous_config.sender_mix_gain_spdif ||
+        current_config->sender_mix_gain_usb != previous_config.sender_mix_gain_usb) {
+        ESP_LOGI(TAG, "Sender mix gains changed from %u/%u to %u/%u %% (S/PDIF/USB)",
+                 previous_config.sender_mix_gain_spdif, previous_config.sender_mix_gain_usb,
+                 current_config->sender_mix_gain_spdif, current_config->sender_mix_gain_usb);
+        any_changes = true;
+    }
+
+    // Buffer parameter changes; a new target alone retargets without a flush
+    bool buffer_geometry_changed =
+        current_config->initial_buffer_size != previous_config.initial_buffer_size ||
         current_config->max_buffer_size != previous_config.max_buffer_size ||
         current_config->buffer_grow_step_size != previous_config.buffer_grow_step_size ||
-        current_config->max_grow_size != previous_config.max_grow_size) {
+        current_config->max_grow_size != previous_config.max_grow_size ||
+        current_config->buffer_max_ms != previous_config.buffer_max_ms;
+    if (!buffer_geometry_changed &&
+        current_config->buffer_target_ms != previous_config.buffer_target_ms) {
+        ESP_LOGI(TAG, "Buffer target changed from %u to %u ms",
+                 previous_config.buffer_target_ms, current_config->buffer_target_ms);
+        any_changes = true;
+        if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB ||
+            state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
+            buffer_retarget();
+        }
+    } else if (buffer_geometry_changed) {
         ESP_LOGI(TAG, "Buffer parameters changed");
         any_changes = true;
 
@@ -1025,17 +1458,96 @@ bool lifecycle_config_handle_configuration_changed(void) {
         restart_required = true;
     }
 
+    // Packet time changes: ring slots and sender packets are sized at mode start
+    if (current_config->ptime_ms != previous_config.ptime_ms) {
+        ESP_LOGI(TAG, "ptime changed from %u to %u ms", previous_config.ptime_ms, current_config->ptime_ms);
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // Bit depth changes: payload conversion and sink formats are set up at mode start
+    if (current_config->bit_depth != previous_config.bit_depth) {
+        ESP_LOGI(TAG, "Bit depth changed from %u to %u", previous_config.bit_depth, current_config->bit_depth);
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // Channel layout changes: the channel map is resolved against the stream at mode start
+    if (current_config->stream_channels != previous_config.stream_channels ||
+        current_config->channel_left != previous_config.channel_left ||
+        current_config->channel_right != previous_config.channel_right) {
+        ESP_LOGI(TAG, "Channels changed from %u (map %u/%u) to %u (map %u/%u)",
+                 previous_config.stream_channels, previous_config.channel_left, previous_config.channel_right,
+                 current_config->stream_channels, current_config->channel_left, current_config->channel_right);
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // Codec changes: the Opus decoder is set up at mode start
+    if (current_config->opus_pt != previous_config.opus_pt) {
+        ESP_LOGI(TAG, "Opus payload type changed from %u to %u", previous_config.opus_pt, current_config->opus_pt);
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // SRTP session keys are derived when the receiver or sender starts
+    if (strcmp(current_config->srtp_crypto, previous_config.srtp_crypto) != 0) {
+        ESP_LOGI(TAG, "SRTP keys changed (now %s)",
+                 rtp_srtp_suite_name(rtp_srtp_parse(current_config->srtp_crypto)));
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // ESP-NOW relay: brought up with the receiver or sender
+    if (current_config->relay_role != previous_config.relay_role ||
+        strcmp(current_config->relay_peers, previous_config.relay_peers) != 0) {
+        ESP_LOGI(TAG, "Relay changed to %s (peers: %s)",
+                 rtp_relay_role_name((rtp_relay_role_t)current_config->relay_role),
+                 current_config->relay_peers[0] ? current_config->relay_peers : "broadcast");
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // Sample rate changes: the receivers move over at the next chunk, senders restart
+    if (current_config->sample_rate != previous_config.sample_rate) {
+        ESP_LOGI(TAG, "Sample rate changed from %lu to %lu Hz",
+                 (unsigned long)previous_config.sample_rate, (unsigned long)current_config->sample_rate);
+        any_changes = true;
+        if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB ||
+            state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
+            if (lifecycle_reconfig_sample_rate(current_config->sample_rate) != ESP_OK) {
+                restart_required = true;
+            }
+        } else {
+            restart_required = true;
+        }
+    }
+
     // Volume changes
     if (current_config->volume != previous_config.volume) {
         ESP_LOGI(TAG, "Volume changed from %.2f to %.2f",
                  previous_config.volume, current_config->volume);
         any_changes = true;
-        if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB) {
+        if (state == LIFECYCLE_STATE_MODE_RECEIVER_USB
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+            || state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF
+#endif
+            ) {
             ESP_LOGI(TAG, "Applying volume change immediately");
             audio_out_update_volume();
         }
     }
 
+    // EQ changes: picked up by pcm_handler at its next chunk
+    if (memcmp(&current_config->eq, &previous_config.eq, sizeof(eq_config_t)) != 0) {
+        ESP_LOGI(TAG, "EQ changed: %u band(s), crossover %u Hz",
+                 current_config->eq.band_count, current_config->eq.crossover_hz);
+        any_changes = true;
+#ifdef CONFIG_RX_EQ_ENABLED
+        eq_reload();
+#endif
+    }
+
     // Direct write changes
     if (current_config->use_direct_write != previous_config.use_direct_write) {
         ESP_LOGI(TAG, "Direct write mode changed from %d to %d",
@@ -1044,6 +1556,23 @@ bool lifecycle_config_handle_configuration_changed(void) {
         // No immediate action required here
     }
 
+    // Low-latency mode: chunk size, buffer depth and S/PDIF depth are set at mode start
+    if (current_config->low_latency != previous_config.low_latency) {
+        ESP_LOGI(TAG, "Low latency mode changed from %d to %d",
+                 previous_config.low_latency, current_config->low_latency);
+        any_changes = true;
+        restart_required = true;
+    }
+
+    // Pipeline topology: tasks are pinned when the mode starts them
+    if (current_config->pipeline_topology != previous_config.pipeline_topology) {
+        ESP_LOGI(TAG, "Pipeline topology changed from %s to %s",
+                 pipeline_topology_name((pipeline_topology_t)previous_config.pipeline_topology),
+                 pipeline_topology_name((pipeline_topology_t)current_config->pipeline_topology));
+        any_changes = true;
+        restart_required = true;
+    }
+
     // Sleep monitoring parameter changes
     if (current_config->silence_threshold_ms != previous_config.silence_threshold_ms ||
         current_config->network_check_interval_ms != previous_config.network_check_interval_ms ||
@@ -1064,9 +1593,15 @@ bool lifecycle_config_handle_configuration_changed(void) {
         }
     }
 
-    // Device mode changes always require restart
+    // Everything above that needs a restart is read when the receiver core is set up,
+    // which mode switches otherwise keep
+    if (restart_required) {
+        lifecycle_mode_invalidate();
+    }
+
+    // Device mode changes switch modes; only the sources and sinks are swapped
     if (current_config->device_mode != previous_config.device_mode) {
-        ESP_LOGI(TAG, "Device mode changed from %d to %d - restart required",
+        ESP_LOGI(TAG, "Device mode changed from %d to %d - switching modes",
                  previous_config.device_mode, current_config->device_mode);
         any_changes = true;
         restart_required = true;
@@ -18,6 +18,11 @@ uint16_t lifecycle_get_port(void);
 const char* lifecycle_get_hostname(void);
 uint32_t lifecycle_get_sample_rate(void);
 uint8_t lifecycle_get_bit_depth(void);
+uint8_t lifecycle_get_stream_channels(void);
+uint8_t lifecycle_get_channel_left(void);
+uint8_t lifecycle_get_channel_right(void);
+uint8_t lifecycle_get_ptime_ms(void);
+uint8_t lifecycle_get_opus_pt(void);
 float lifecycle_get_volume(void);
 device_mode_t lifecycle_get_device_mode(void);
 bool lifecycle_get_enable_usb_sender(void);
@@ -27,12 +32,26 @@ const char* lifecycle_get_ap_password(void);
 bool lifecycle_get_hide_ap_when_connected(void);
 const char* lifecycle_get_sender_destination_ip(void);
 uint16_t lifecycle_get_sender_destination_port(void);
+const char* lifecycle_get_sender_fanout_ips(void);
+bool lifecycle_get_sender_fanout_mdns(void);
+bool lifecycle_get_sender_opus(void);
+uint8_t lifecycle_get_sender_opus_complexity(void);
+bool lifecycle_get_sender_mix_usb(void);
+uint8_t lifecycle_get_sender_mix_gain_spdif(void);
+uint8_t lifecycle_get_sender_mix_gain_usb(void);
 uint8_t lifecycle_get_initial_buffer_size(void);
 uint8_t lifecycle_get_max_buffer_size(void);
 uint8_t lifecycle_get_buffer_grow_step_size(void);
 uint8_t lifecycle_get_max_grow_size(void);
+uint16_t lifecycle_get_buffer_target_ms(void);
+uint16_t lifecycle_get_buffer_max_ms(void);
 uint8_t lifecycle_get_spdif_data_pin(void);
+const eq_config_t* lifecycle_get_eq(void);
 bool lifecycle_get_use_direct_write(void);
+bool lifecycle_get_low_latency(void);
+uint8_t lifecycle_get_pipeline_topology(void);
+uint8_t lifecycle_get_relay_role(void);
+const char* lifecycle_get_relay_peers(void);
 uint32_t lifecycle_get_silence_threshold_ms(void);
 uint32_t lifecycle_get_network_check_interval_ms(void);
 uint8_t lifecycle_get_activity_threshold_packets(void);
@@ -50,6 +69,12 @@ uint16_t lifecycle_get_ntp_server_port(void);
 esp_err_t lifecycle_set_port(uint16_t port);
 esp_err_t lifecycle_set_hostname(const char* hostname);
 esp_err_t lifecycle_set_volume(float volume);
+esp_err_t lifecycle_set_ptime_ms(uint8_t ptime_ms);
+esp_err_t lifecycle_set_bit_depth(uint8_t bit_depth);
+esp_err_t lifecycle_set_stream_channels(uint8_t channels);
+esp_err_t lifecycle_set_channel_map(uint8_t left, uint8_t right);
+esp_err_t lifecycle_set_opus_pt(uint8_t opus_pt);
+esp_err_t lifecycle_set_srtp_crypto(const char* crypto);
 esp_err_t lifecycle_set_device_mode(device_mode_t mode);
 esp_err_t lifecycle_set_enable_usb_sender(bool enable);
 esp_err_t lifecycle_set_enable_spdif_sender(bool enable);
@@ -62,6 +87,8 @@ esp_err_t lifecycle_set_initial_buffer_size(uint8_t size);
 esp_err_t lifecycle_set_max_buffer_size(uint8_t size);
 esp_err_t lifecycle_set_buffer_grow_step_size(uint8_t size);
 esp_err_t lifecycle_set_max_grow_size(uint8_t size);
+esp_err_t lifecycle_set_buffer_target_ms(uint16_t ms);
+esp_err_t lifecycle_set_buffer_max_ms(uint16_t ms);
 esp_err_t lifecycle_set_spdif_data_pin(uint8_t pin);
 esp_err_t lifecycle_set_silence_threshold_ms(uint32_t threshold_ms);
 esp_err_t lifecycle_set_network_check_interval_ms(uint32_t interval_ms);
@@ -87,6 +114,27 @@ typedef struct lifecycle_config_update {
 
     bool update_volume;
     float volume;
+
+    bool update_sample_rate;  // Applied live by the receiver modes, like lifecycle_manager_change_sample_rate()
+    uint32_t sample_rate;
+
+    bool update_ptime_ms;
+    uint8_t ptime_ms;
+
+    bool update_bit_depth;
+    uint8_t bit_depth;
+
+    bool update_stream_channels;
+    uint8_t stream_channels;
+
+    bool update_channel_left;
+    uint8_t channel_left;
+
+    bool update_channel_right;
+    uint8_t channel_right;
+
+    bool update_opus_pt;
+    uint8_t opus_pt;
     
     bool update_device_mode;
     device_mode_t device_mode;
@@ -111,6 +159,27 @@ typedef struct lifecycle_config_update {
     
     bool update_sender_destination_port;
     uint16_t sender_destination_port;
+
+    bool update_sender_fanout_ips;
+    const char* sender_fanout_ips;
+
+    bool update_sender_fanout_mdns;
+    bool sender_fanout_mdns;
+
+    bool update_sender_opus;
+    bool sender_opus;
+
+    bool update_sender_opus_complexity;
+    uint8_t sender_opus_complexity;
+
+    bool update_sender_mix_usb;
+    bool sender_mix_usb;
+
+    bool update_sender_mix_gain_spdif;
+    uint8_t sender_mix_gain_spdif;
+
+    bool update_sender_mix_gain_usb;
+    uint8_t sender_mix_gain_usb;
     
     bool update_initial_buffer_size;
     uint8_t initial_buffer_size;
@@ -123,12 +192,24 @@ typedef struct lifecycle_config_update {
     
     bool update_max_grow_size;
     uint8_t max_grow_size;
+
+    bool update_buffer_target_ms;
+    uint16_t buffer_target_ms;
+
+    bool update_buffer_max_ms;
+    uint16_t buffer_max_ms;
     
     bool update_spdif_data_pin;
     uint8_t spdif_data_pin;
     
     bool update_use_direct_write;
     bool use_direct_write;
+
+    bool update_low_latency;
+    bool low_latency;
+
+    bool update_pipeline_topology;
+    uint8_t pipeline_topology;
     
     bool update_silence_threshold_ms;
     uint32_t silence_threshold_ms;
@@ -169,6 +250,17 @@ typedef struct lifecycle_config_update {
 
     bool update_sap_stream_name;
     const char* sap_stream_name;
+
+    bool update_srtp_crypto;
+    const char* srtp_crypto;
+
+    bool update_relay_role;
+    uint8_t relay_role;
+    bool update_relay_peers;
+    const char* relay_peers;
+
+    bool update_eq;
+    eq_config_t eq;
 } lifecycle_config_update_t;
 
 // Batch update function
@@ -0,0 +1,186 @@
+#include "cpu_governor.h"
+#include <inttypes.h>
+#include "../receiver/buffer.h"
+#include "metrics.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#undef TAG
+#define TAG "cpu_governor"
+
+// Clock of the lower level: what ESP_PM_APB_FREQ_MAX holds the CPU at
+#define GOV_LOW_MHZ 80
+
+#ifdef CONFIG_CPU_GOVERNOR
+uint32_t cpu_governor_cycles[SOC_CPU_CORES_NUM];
+#endif
+
+#if CONFIG_PM_ENABLE
+typedef enum {
+    GOV_LEVEL_NONE = 0,     // Idle: no lock, DFS minimum
+    GOV_LEVEL_LOW,          // ESP_PM_APB_FREQ_MAX: 80 MHz
+    GOV_LEVEL_MAX,          // ESP_PM_CPU_FREQ_MAX: full speed
+} gov_level_t;
+
+static esp_pm_lock_handle_t s_max_lock = NULL;
+static esp_pm_lock_handle_t s_low_lock = NULL;
+static gov_level_t s_level = GOV_LEVEL_NONE;
+static bool s_idle = false;
+
+#ifdef CONFIG_CPU_GOVERNOR
+static int64_t s_window_start_us = 0;
+static uint64_t s_window_cycles[SOC_CPU_CORES_NUM];
+static int64_t s_light_since_us = 0;    // Load has fit the low level since (0: not)
+static int64_t s_pinned_until_us = 0;   // Full speed after an underrun until
+static uint32_t s_last_underruns = 0;
+static uint32_t s_demand_mhz = 0;       // Busiest core over the last window
+
+static int64_t read_demand_mhz(void)
+{
+    return s_demand_mhz;
+}
+
+static metrics_gauge_t demand_gauge =
+    METRICS_GAUGE_INIT("cpu_governor_demand_mhz", "Pipeline cycles per microsecond on the busiest core",
+                       read_demand_mhz);
+#endif
+
+static int64_t read_level_mhz(void)
+{
+    return cpu_governor_get_level_mhz();
+}
+
+static metrics_gauge_t level_gauge =
+    METRICS_GAUGE_INIT("cpu_governor_level_mhz", "CPU clock held by the governor (0 while idle)",
+                       read_level_mhz);
+
+// Take the new level's lock before dropping the old one, so the clock never dips between
+static void set_level(gov_level_t level)
+{
+    if (level == s_level) {
+        return;
+    }
+    if (level == GOV_LEVEL_MAX) {
+        esp_pm_lock_acquire(s_max_lock);
+    } else if (level == GOV_LEVEL_LOW) {
+        esp_pm_lock_acquire(s_low_lock);
+    }
+    if (s_level == GOV_LEVEL_MAX) {
+        esp_pm_lock_release(s_max_lock);
+    } else if (s_level == GOV_LEVEL_LOW) {
+        esp_pm_lock_release(s_low_lock);
+    }
+    s_level = level;
+    ESP_LOGI(TAG, "CPU clock: %" PRIu32 " MHz", cpu_governor_get_level_mhz());
+}
+#endif
+
+void cpu_governor_init(void)
+{
+#if CONFIG_PM_ENABLE
+    if (s_max_lock) {
+        return;
+    }
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "gov_max", &s_max_lock) != ESP_OK ||
+        esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "gov_low", &s_low_lock) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create governor locks");
+        return;
+    }
+    set_level(GOV_LEVEL_MAX);
+    metrics_register(&level_gauge.base);
+#ifdef CONFIG_CPU_GOVERNOR
+    metrics_register(&demand_gauge.base);
+    s_window_start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Governor: %d MHz when the busiest core needs <= %d%% of it, else full speed",
+             GOV_LOW_MHZ, CONFIG_CPU_GOV_LOW_LOAD_PCT);
+#endif
+#endif
+}
+
+void cpu_governor_set_idle(bool idle)
+{
+#if CONFIG_PM_ENABLE
+    if (!s_max_lock || idle == s_idle) {
+        return;
+    }
+    s_idle = idle;
+    // Waking starts at full speed; the measurements bring it down again
+    set_level(idle ? GOV_LEVEL_NONE : GOV_LEVEL_MAX);
+#ifdef CONFIG_CPU_GOVERNOR
+    s_light_since_us = 0;
+    s_window_start_us = esp_timer_get_time();
+    for (int c = 0; c < SOC_CPU_CORES_NUM; c++) {
+        __atomic_store_n(&cpu_governor_cycles[c], 0, __ATOMIC_RELAXED);
+        s_window_cycles[c] = 0;
+    }
+#endif
+#else
+    (void)idle;
+#endif
+}
+
+void cpu_governor_tick(void)
+{
+#if CONFIG_PM_ENABLE && defined(CONFIG_CPU_GOVERNOR)
+    if (!s_max_lock || s_idle) {
+        return;
+    }
+    // Drain the hot-path cells every tick so a 32-bit cell cannot wrap within a window
+    for (int c = 0; c < SOC_CPU_CORES_NUM; c++) {
+        s_window_cycles[c] += __atomic_exchange_n(&cpu_governor_cycles[c], 0, __ATOMIC_RELAXED);
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_us = now - s_window_start_us;
+    if (elapsed_us < (int64_t)CONFIG_CPU_GOV_WINDOW_MS * 1000) {
+        return;
+    }
+
+    uint64_t busiest = 0;
+    for (int c = 0; c < SOC_CPU_CORES_NUM; c++) {
+        if (s_window_cycles[c] > busiest) {
+            busiest = s_window_cycles[c];
+        }
+        s_window_cycles[c] = 0;
+    }
+    s_window_start_us = now;
+    // Cycles per microsecond is the clock in MHz this work needs without headroom
+    s_demand_mhz = (uint32_t)((busiest + (uint64_t)elapsed_us - 1) / (uint64_t)elapsed_us);
+
+    uint32_t underruns = buffer_get_underrun_count();
+    if (underruns != s_last_underruns) {
+        s_last_underruns = underruns;
+        s_pinned_until_us = now + (int64_t)CONFIG_CPU_GOV_UNDERRUN_HOLD_MS * 1000;
+    }
+
+    bool fits_low = s_demand_mhz * 100u <= GOV_LOW_MHZ * CONFIG_CPU_GOV_LOW_LOAD_PCT &&
+                    now >= s_pinned_until_us;
+    if (!fits_low) {
+        s_light_since_us = 0;
+        if (s_level != GOV_LEVEL_MAX) {
+            ESP_LOGI(TAG, "Pipeline needs %" PRIu32 " MHz, stepping up", s_demand_mhz);
+        }
+        set_level(GOV_LEVEL_MAX);
+        return;
+    }
+    if (s_light_since_us == 0) {
+        s_light_since_us = now;
+    }
+    if (now - s_light_since_us >= (int64_t)CONFIG_CPU_GOV_DOWN_HOLD_MS * 1000) {
+        set_level(GOV_LEVEL_LOW);
+    }
+#endif
+}
+
+uint32_t cpu_governor_get_level_mhz(void)
+{
+#if CONFIG_PM_ENABLE
+    switch (s_level) {
+        case GOV_LEVEL_MAX: return CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+        case GOV_LEVEL_LOW: return GOV_LOW_MHZ;
+        default:            return 0;
+    }
+#else
+    return CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+#endif
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_cpu.h"
+#include "soc/soc_caps.h"
+
+/**
+ * @file cpu_governor.h
+ * @brief Stream-aware CPU clock for the awake device
+ * 
+ * The audio hot paths (receive and decode, playout DSP, Opus encode) bracket
+ * their per-chunk work with cpu_governor_begin()/cpu_governor_end(). From
+ * those cycle counts the governor works out what the busiest core needs and
+ * holds a power management lock for the clock that covers it: full speed
+ * for heavy payloads (Opus, resampler, EQ), 80 MHz when the work fits the
+ * chunk budget at 80 MHz with CONFIG_CPU_GOV_LOW_LOAD_PCT headroom (plain
+ * L16 passthrough). It steps up at once and down only after
+ * CONFIG_CPU_GOV_DOWN_HOLD_MS of light load; an underrun pins full speed for
+ * CONFIG_CPU_GOV_UNDERRUN_HOLD_MS. Silence sleep drops every level lock, so
+ * the clock falls to the DFS minimum.
+ * 
+ * Without CONFIG_CPU_GOVERNOR the device stays at full speed while awake.
+ */
+
+#ifdef CONFIG_CPU_GOVERNOR
+// Cycles of pipeline work per core since the last governor tick
+extern uint32_t cpu_governor_cycles[SOC_CPU_CORES_NUM];
+
+static inline uint32_t cpu_governor_begin(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static inline void cpu_governor_end(uint32_t start)
+{
+    __atomic_fetch_add(&cpu_governor_cycles[esp_cpu_get_core_id()],
+                       esp_cpu_get_cycle_count() - start, __ATOMIC_RELAXED);
+}
+#else
+static inline uint32_t cpu_governor_begin(void)
+{
+    return 0;
+}
+
+static inline void cpu_governor_end(uint32_t start)
+{
+    (void)start;
+}
+#endif
+
+/**
+ * @brief Create the level locks and start at full speed
+ * 
+ * Called by the power management setup, before esp_pm_configure().
+ */
+void cpu_governor_init(void);
+
+/**
+ * @brief Silence sleep: release the level lock (idle) or take full speed back
+ */
+void cpu_governor_set_idle(bool idle);
+
+/**
+ * @brief Evaluate the measured load (lifecycle background tick)
+ */
+void cpu_governor_tick(void);
+
+// Clock the governor currently asks for, in MHz (0 while idle)
+uint32_t cpu_governor_get_level_mhz(void);
@@ -1,4 +1,5 @@
 #include "hw_init.h"
+#include "cpu_governor.h"
 #include "lifecycle_internal.h"
 #include "../global.h"
 #include "../config/config_manager.h"
@@ -67,22 +68,26 @@ esp_err_t lifecycle_hw_init_battery(void) {
     return ESP_OK;
 }
 
+#if CONFIG_PM_ENABLE
+// Held while the device is awake: no automatic light sleep. Only silence sleep
+// releases it, so tickless light sleep applies to idle only; the clock while
+// awake is the CPU governor's.
+static esp_pm_lock_handle_t s_awake_sleep_lock = NULL;
+#ifdef CONFIG_RX_IDLE_LIGHT_SLEEP
+static bool s_idle = false;
+static bool s_light_sleep = false;  // Idle released the sleep lock too
+#endif
+#endif
+
 esp_err_t lifecycle_hw_init_power_management(void) {
     #if CONFIG_PM_ENABLE
-    ESP_LOGI(TAG, "Configuring power management (reduced CPU clock)");
+    ESP_LOGI(TAG, "Configuring power management (governed clock while awake, reduced when idle)");
     #if CONFIG_IDF_TARGET_ESP32
     esp_pm_config_esp32_t pm_config = {
-        .max_freq_mhz = 80,
-        .min_freq_mhz = 40,
-    #if CONFIG_FREERTOS_USE_TICKLESS_IDLE
-        .light_sleep_enable = true
-    #else
-        .light_sleep_enable = false
-    #endif
-    };
     #elif CONFIG_IDF_TARGET_ESP32S3
     esp_pm_config_esp32s3_t pm_config = {
-        .max_freq_mhz = 80,
+    #endif
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
         .min_freq_mhz = 40,
     #if CONFIG_FREERTOS_USE_TICKLESS_IDLE
         .light_sleep_enable = true
@@ -90,8 +95,16 @@ esp_err_t lifecycle_hw_init_power_management(void) {
         .light_sleep_enable = false
     #endif
     };
-    #endif
-    esp_err_t err = esp_pm_configure(&pm_config);
+    // Take the awake locks before the new limits apply, so nothing slows down meanwhile
+    cpu_governor_init();
+    esp_err_t err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "awake_sleep", &s_awake_sleep_lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create power management lock: %s", esp_err_to_name(err));
+        return err;
+    }
+    esp_pm_lock_acquire(s_awake_sleep_lock);
+
+    err = esp_pm_configure(&pm_config);
     if (err == ESP_ERR_NOT_SUPPORTED) {
         ESP_LOGW(TAG, "Power management not supported or not enabled in menuconfig");
         return err;
@@ -103,6 +116,32 @@ esp_err_t lifecycle_hw_init_power_management(void) {
     #endif
 }
 
+void lifecycle_hw_power_set_idle(bool idle, bool light_sleep) {
+    #if CONFIG_PM_ENABLE && defined(CONFIG_RX_IDLE_LIGHT_SLEEP)
+    if (!s_awake_sleep_lock || idle == s_idle) {
+        return;
+    }
+    s_idle = idle;
+    if (idle) {
+        s_light_sleep = light_sleep;
+        if (light_sleep) {
+            esp_pm_lock_release(s_awake_sleep_lock);
+        }
+        cpu_governor_set_idle(true);
+    } else {
+        cpu_governor_set_idle(false);
+        if (s_light_sleep) {
+            esp_pm_lock_acquire(s_awake_sleep_lock);
+        }
+    }
+    ESP_LOGI(TAG, "Power: %s", !idle ? "awake (full clock)" :
+             light_sleep ? "idle (reduced clock, automatic light sleep)" : "idle (reduced clock)");
+    #else
+    (void)idle;
+    (void)light_sleep;
+    #endif
+}
+
 esp_err_t lifecycle_hw_init_dac_detection(void) {
     app_config_t *config = config_manager_get_config();
     
@@ -132,9 +171,8 @@ esp_err_t lifecycle_hw_init_dac_detection(void) {
         ESP_LOGI(TAG, "Non-USB mode configured, no USB initialization needed");
     }
     
-    // Note: Deep sleep for DAC detection is disabled with lazy initialization
-    // If deep sleep behavior is still desired, implement a lightweight USB detection
-    // method that doesn't require full USB host initialization
+    // No polling deep sleep for DAC detection: with CONFIG_USB_ATTACH_WAKE a USB
+    // receiver without a DAC sleeps until the attach signal wakes it (attach_wake.c)
 
     return ESP_OK;
 }
\ No newline at end of file
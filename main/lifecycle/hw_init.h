@@ -1,6 +1,7 @@
 #ifndef LIFECYCLE_HW_INIT_H
 #define LIFECYCLE_HW_INIT_H
 
+#include <stdbool.h>
 #include "esp_err.h"
 
 /**
@@ -56,12 +57,26 @@ esp_err_t lifecycle_hw_init_battery(void);
  * @brief Configure power management
  * 
  * Configures ESP32 power management settings including CPU frequency
- * scaling and light sleep mode if enabled in menuconfig.
+ * scaling and light sleep mode if enabled in menuconfig. The device
+ * starts awake, at full clock with light sleep held off.
  * 
  * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if PM not enabled
  */
 esp_err_t lifecycle_hw_init_power_management(void);
 
+/**
+ * @brief Enter or leave the idle power mode
+ * 
+ * Idle releases the awake locks, letting the clock scale down and the
+ * tickless idle task light sleep between Wi-Fi beacons. A no-op unless
+ * CONFIG_RX_IDLE_LIGHT_SLEEP and power management are enabled.
+ * 
+ * @param idle true on entering silence sleep, false on leaving it
+ * @param light_sleep Entering idle: allow light sleep as well (not with
+ *        a USB device attached, whose bus would stop)
+ */
+void lifecycle_hw_power_set_idle(bool idle, bool light_sleep);
+
 /**
  * @brief Perform DAC detection logic
  * 
@@ -6,7 +6,9 @@
 #include "lifecycle_wifi_adapter.h"
 #include "wifi_manager.h"
 #include "../lifecycle_manager.h"
+#include "receiver/buffer.h"
 #include "esp_log.h"
+#include <stdint.h>
 #include <string.h>
 
 static const char *TAG = "lifecycle_wifi_adapter";
@@ -76,6 +78,18 @@ static void wifi_event_to_lifecycle_handler(wifi_manager_event_t* event, void* u
     }
 }
 
+// Audio the jitter buffer would play through a roam. Senders hold none: the receivers'
+// buffers cover their gap, so they roam whenever the signal calls for it.
+static uint32_t roam_headroom_ms(void) {
+    if (!wifi_manager_is_streaming() || lifecycle_get_enable_usb_sender() ||
+        lifecycle_get_enable_spdif_sender()) {
+        return UINT32_MAX;
+    }
+    buffer_depth_t depth;
+    buffer_get_depth(&depth);
+    return (uint32_t)(((uint64_t)depth.fill * depth.chunk_us) / 1000U);
+}
+
 esp_err_t lifecycle_wifi_adapter_init(void) {
     ESP_LOGI(TAG, "Initializing WiFi adapter with lifecycle configuration");
     
@@ -127,6 +141,8 @@ esp_err_t lifecycle_wifi_adapter_init(void) {
         return ret;
     }
     
+    wifi_manager_set_roam_headroom_cb(roam_headroom_ms);
+
     ESP_LOGI(TAG, "WiFi adapter initialized successfully");
     return ESP_OK;
 }
@@ -3,12 +3,17 @@
 #include "../global.h"
 #include "../receiver/audio_out.h"
 #include "../receiver/buffer.h"
+#include "../receiver/mixer.h"
+#include "../receiver/stream_switch.h"
 #include "../receiver/network_in.h"
 #include "../receiver/sap_listener.h"
 #include "../sender/network_out.h"
 #include "visualizer_task.h"
+#include "trace.h"
 #include "../config/config_manager.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "wifi_manager.h"
 
 #include "usb_in.h"
 #include "usb_out.h"
@@ -30,6 +35,8 @@ static esp_err_t start_mode_receiver_usb(void);
 static esp_err_t stop_mode_receiver_usb(void);
 static esp_err_t start_mode_receiver_spdif(void);
 static esp_err_t stop_mode_receiver_spdif(void);
+static esp_err_t suspend_mode_receiver(lifecycle_state_t mode);
+static esp_err_t resume_mode_receiver(lifecycle_state_t mode);
 
 /**
  * Start the specified operational mode
@@ -69,14 +76,42 @@ esp_err_t lifecycle_mode_stop(lifecycle_state_t mode) {
     }
 }
 
+/**
+ * Park a receiver mode for silence sleep
+ */
+esp_err_t lifecycle_mode_suspend(lifecycle_state_t mode) {
+    switch (mode) {
+        case LIFECYCLE_STATE_MODE_RECEIVER_USB:
+        case LIFECYCLE_STATE_MODE_RECEIVER_SPDIF:
+            return suspend_mode_receiver(mode);
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+/**
+ * Resume a parked receiver mode
+ */
+esp_err_t lifecycle_mode_resume(lifecycle_state_t mode) {
+    switch (mode) {
+        case LIFECYCLE_STATE_MODE_RECEIVER_USB:
+        case LIFECYCLE_STATE_MODE_RECEIVER_SPDIF:
+            return resume_mode_receiver(mode);
+        default:
+            return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
 // ==================== USB Sender Mode ====================
 
 static esp_err_t start_mode_sender_usb(void) {
     ESP_LOGI(TAG, "Starting USB sender mode...");
+    int64_t lap = esp_timer_get_time();
     
     // Switch USB to Port 2 for USB sender mode
     ESP_LOGI(TAG, "Setting USB switch to Port 2 for USB sender mode");
     esp_err_t ret = usb_switch_set_port(USB_SWITCH_PORT_2);
+    lifecycle_trace_step("usb_switch", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set USB switch to Port 2: %s", esp_err_to_name(ret));
         // Non-critical, continue
@@ -87,6 +122,7 @@ static esp_err_t start_mode_sender_usb(void) {
     // Initialize network sender first (reads from pcm_buffer)
     
     ret = rtp_sender_init();
+    lifecycle_trace_step("rtp_sender_init", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize RTP sender: %s", esp_err_to_name(ret));
         return ret;
@@ -96,6 +132,7 @@ static esp_err_t start_mode_sender_usb(void) {
     ESP_LOGI(TAG, "Initializing USB audio input (USB speaker device)");
     
     ret = usb_in_init(NULL);
+    lifecycle_trace_step("usb_in_init", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize USB input: %s", esp_err_to_name(ret));
         return ret;
@@ -114,6 +151,7 @@ static esp_err_t start_mode_sender_usb(void) {
     // Start USB input to begin receiving audio from host
     ESP_LOGI(TAG, "Starting USB audio input");
     ret = usb_in_start();
+    lifecycle_trace_step("usb_in_start", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start USB input: %s", esp_err_to_name(ret));
         usb_in_deinit();
@@ -123,6 +161,7 @@ static esp_err_t start_mode_sender_usb(void) {
     // Start network sender to transmit over RTP
     ESP_LOGI(TAG, "Starting RTP network sender");
     ret = rtp_sender_start();
+    lifecycle_trace_step("rtp_sender_start", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start RTP sender: %s", esp_err_to_name(ret));
         usb_in_stop();
@@ -173,8 +212,55 @@ static esp_err_t stop_mode_sender_usb(void) {
 
 // ==================== SPDIF Sender Mode ====================
 
+#ifdef CONFIG_SENDER_MIX_ENABLED
+static bool s_sender_mix_usb = false;    // USB input running alongside the S/PDIF sender
+
+// Mixing sender: also a USB speaker on Port 2. Without it the S/PDIF sender goes on alone
+static void sender_spdif_start_usb_mix(void) {
+    if (!lifecycle_get_sender_mix_usb()) {
+        return;
+    }
+    ESP_LOGI(TAG, "Starting USB audio input to mix into the S/PDIF stream");
+    esp_err_t ret = usb_switch_set_port(USB_SWITCH_PORT_2);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set USB switch to Port 2: %s", esp_err_to_name(ret));
+        // Non-critical, continue
+    }
+    ret = usb_in_init(NULL);
+    if (ret == ESP_OK) {
+        ret = usb_in_start();
+        if (ret != ESP_OK) {
+            usb_in_deinit();
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start USB input, sending S/PDIF only: %s", esp_err_to_name(ret));
+        usb_switch_set_port(USB_SWITCH_PORT_1);
+        return;
+    }
+    s_sender_mix_usb = true;
+}
+
+static void sender_spdif_stop_usb_mix(void) {
+    if (!s_sender_mix_usb) {
+        return;
+    }
+    s_sender_mix_usb = false;
+    esp_err_t ret = usb_in_stop();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stop USB input: %s", esp_err_to_name(ret));
+    }
+    usb_in_deinit();
+    ret = usb_switch_set_port(USB_SWITCH_PORT_1);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set USB switch to Port 1: %s", esp_err_to_name(ret));
+    }
+}
+#endif
+
 static esp_err_t start_mode_sender_spdif(void) {
     ESP_LOGI(TAG, "Starting S/PDIF sender mode...");
+    int64_t lap = esp_timer_get_time();
     
     // Ensure USB switch is in default state (Port 1)
     ESP_LOGI(TAG, "Ensuring USB switch is set to Port 1 (default)");
@@ -187,6 +273,7 @@ static esp_err_t start_mode_sender_spdif(void) {
     ESP_LOGI(TAG, "Initializing Scream sender");
     
     ret = rtp_sender_init();
+    lifecycle_trace_step("rtp_sender_init", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize Scream sender: %s", esp_err_to_name(ret));
         return ret;
@@ -202,14 +289,23 @@ static esp_err_t start_mode_sender_spdif(void) {
     
     ESP_LOGI(TAG, "Starting S/PDIF receiver");
     ret = spdif_receiver_start();
+    lifecycle_trace_step("spdif_receiver_start", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start S/PDIF receiver: %s", esp_err_to_name(ret));
         return ret;
     }
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    sender_spdif_start_usb_mix();
+    lifecycle_trace_step("usb_in_mix", &lap);
+#endif
     ESP_LOGI(TAG, "Starting RTP sender");
     ret = rtp_sender_start();
+    lifecycle_trace_step("rtp_sender_start", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start RTP sender: %s", esp_err_to_name(ret));
+#ifdef CONFIG_SENDER_MIX_ENABLED
+        sender_spdif_stop_usb_mix();
+#endif
         spdif_receiver_stop();
         return ret;
     }
@@ -223,6 +319,9 @@ static esp_err_t stop_mode_sender_spdif(void) {
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to stop Scream sender: %s", esp_err_to_name(ret));
     }
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    sender_spdif_stop_usb_mix();
+#endif
     ret = spdif_receiver_stop();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to stop S/PDIF receiver: %s", esp_err_to_name(ret));
@@ -234,10 +333,121 @@ static esp_err_t stop_mode_sender_spdif(void) {
     return ESP_OK;
 }
 
+// S/PDIF transmitter depth for the receiver modes: shallow in low-latency mode
+static void receiver_spdif_set_depth(void) {
+    if (lifecycle_get_low_latency()) {
+        spdif_set_depth(CONFIG_RX_LOW_LATENCY_SPDIF_RING_MS, CONFIG_RX_LOW_LATENCY_SPDIF_DMA_DESC);
+    } else {
+        spdif_set_depth(0, 0);
+    }
+}
+
+// ==================== Receiver Core ====================
+
+// What both receiver modes share: jitter buffer, playout task, RTP/RTCP receiver
+// and SAP listener. The first receiver mode brings it up; after that mode
+// switches (to a sender mode and back included) only swap the outputs while the
+// sockets, clock mapping and arena allocations stay.
+static bool s_rx_core_up = false;
+static bool s_rx_core_stale = false;    // Start-time settings changed (lifecycle_mode_invalidate())
+static uint8_t s_rx_core_bits = 0;      // Playout width the ring and RX conversion were set up for
+static bool s_sap_ready = false;
+
+static void receiver_core_start(int64_t *lap) {
+    uint8_t bits = audio_out_sample_bits();
+    if (s_rx_core_up && !s_rx_core_stale && bits == s_rx_core_bits) {
+        // What queued while another mode played is stale: refill before playing
+        empty_buffer();
+        lifecycle_trace_step("receiver_core_reuse", lap);
+    } else {
+        if (s_rx_core_up) {
+            // Slots and the RX conversion are sized for the old settings (or 32-bit
+            // USB vs 24-bit S/PDIF playout); playout is parked while they change
+            ESP_LOGI(TAG, "Rebuilding receiver core (playout %u -> %u bits)", s_rx_core_bits, bits);
+            network_deinit();
+            lifecycle_trace_step("network_deinit", lap);
+        }
+
+        // Setup buffer for network->output streaming
+        setup_buffer();
+#ifdef CONFIG_RX_MIX_ENABLED
+        mixer_setup();
+#endif
+#ifdef CONFIG_RX_GAPLESS_SWITCH
+        stream_switch_setup();
+#endif
+        lifecycle_trace_step("setup_buffer", lap);
+
+        if (!s_rx_core_up) {
+            // The playout task lives on; later modes only reopen its outputs
+            setup_audio();
+            lifecycle_trace_step("setup_audio", lap);
+        }
+
+        // Setup network receiver
+        network_init();
+        lifecycle_trace_step("network_init", lap);
+
+        s_rx_core_up = true;
+        s_rx_core_stale = false;
+        s_rx_core_bits = bits;
+    }
+
+    // Initialize (once) and start SAP listener
+    esp_err_t ret = ESP_OK;
+    if (!s_sap_ready) {
+        ret = sap_listener_init();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to initialize SAP listener: %s", esp_err_to_name(ret));
+        } else {
+            s_sap_ready = true;
+        }
+    }
+    if (s_sap_ready) {
+        ret = sap_listener_start();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start SAP listener: %s", esp_err_to_name(ret));
+        } else {
+            ESP_LOGI(TAG, "SAP listener started successfully");
+        }
+    }
+    lifecycle_trace_step("sap_listener", lap);
+}
+
+// The mode's outputs are up: playout opens them and starts pulling chunks
+static void receiver_core_play(void) {
+    audio_out_outputs_changed();
+    audio_out_set_parked(false);
+}
+
+// Leaving a receiver mode: playout stops before its outputs go, the core stays
+static void receiver_core_park(void) {
+    audio_out_set_parked(true);
+}
+
+static void receiver_core_stop_listener(void) {
+    esp_err_t ret = sap_listener_stop();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stop SAP listener: %s", esp_err_to_name(ret));
+    }
+}
+
+void lifecycle_mode_invalidate(void) {
+    s_rx_core_stale = true;
+}
+
 // ==================== USB Receiver Mode ====================
 
 static esp_err_t start_mode_receiver_usb(void) {
     ESP_LOGI(TAG, "Starting USB receiver mode...");
+    int64_t lap = esp_timer_get_time();
+
+    if (usb_in_holds_controller()) {
+        // USB sender mode left TinyUSB on the OTG controller and it cannot be
+        // uninstalled: the host stack only gets it after a reset. The mode is saved.
+        ESP_LOGW(TAG, "USB controller held by the USB sender, restarting into USB receiver mode");
+        esp_restart();
+    }
     
     // Ensure USB switch is in default state (Port 1)
     ESP_LOGI(TAG, "Ensuring USB switch is set to Port 1 (default)");
@@ -247,33 +457,13 @@ static esp_err_t start_mode_receiver_usb(void) {
         // Non-critical, continue
     }
     
-    // Setup audio output first
-    setup_audio();
-
-    // Setup buffer for network->USB streaming
-    setup_buffer();
-
-    // Setup network receiver
-    
-    network_init();
-
-    // Initialize and start SAP listener
-    
-    ret = sap_listener_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize SAP listener: %s", esp_err_to_name(ret));
-    } else {
-        ret = sap_listener_start();
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to start SAP listener: %s", esp_err_to_name(ret));
-        } else {
-            ESP_LOGI(TAG, "SAP listener started successfully");
-        }
-    }
+    // Jitter buffer, playout task, network receiver and SAP listener (kept if already up)
+    receiver_core_start(&lap);
 
     // Initialize USB host subsystem
     
     ret = usb_out_init();
+    lifecycle_trace_step("usb_out_init", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize USB host: %s", esp_err_to_name(ret));
         return ret;
@@ -283,13 +473,34 @@ static esp_err_t start_mode_receiver_usb(void) {
     uint32_t sample_rate = lifecycle_get_sample_rate();
     uint8_t bit_depth = lifecycle_get_bit_depth();
     float volume = lifecycle_get_volume() * 100.0f; // Convert to percentage
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+    volume = 100.0f;    // Playout applies the volume itself
+#endif
 
     // Start USB host for DAC output with audio parameters
     ret = usb_out_start(sample_rate, bit_depth, volume);
+    lifecycle_trace_step("usb_out_start", &lap);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start USB host: %s", esp_err_to_name(ret));
         return ret;
     }
+
+#ifdef CONFIG_RX_SPDIF_MIRROR
+    // Second output; the USB DAC still works if this fails
+    receiver_spdif_set_depth();
+    ret = spdif_init(sample_rate, lifecycle_get_spdif_data_pin());
+    if (ret == ESP_OK) {
+        ret = spdif_start();
+        if (ret != ESP_OK) {
+            spdif_deinit();
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "S/PDIF mirror output unavailable: %s", esp_err_to_name(ret));
+        ret = ESP_OK;
+    }
+    lifecycle_trace_step("spdif_mirror", &lap);
+#endif
     
     // Initialize visualizer for audio visualization
     
@@ -301,6 +512,10 @@ static esp_err_t start_mode_receiver_usb(void) {
         ESP_LOGI(TAG, "Visualizer initialized successfully");
     }
     
+    receiver_core_play();
+
+    // Modem sleep off until silence sleep: audio is not held at the AP for a DTIM
+    wifi_manager_set_streaming(true);
     ESP_LOGI(TAG, "USB receiver mode started successfully");
     return ESP_OK;
 }
@@ -315,6 +530,9 @@ static esp_err_t stop_mode_receiver_usb(void) {
         ESP_LOGE(TAG, "Failed to stop visualizer: %s", esp_err_to_name(ret));
     }
     
+    // Playout first, so nothing is written to the DAC while it goes away
+    receiver_core_park();
+
     ret = usb_out_stop();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to stop USB host: %s", esp_err_to_name(ret));
@@ -325,19 +543,17 @@ static esp_err_t stop_mode_receiver_usb(void) {
         ESP_LOGE(TAG, "Failed to deinitialize USB host: %s", esp_err_to_name(ret));
     }
 
-    // Stop SAP listener
-    ret = sap_listener_stop();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop SAP listener: %s", esp_err_to_name(ret));
-    }
-    
-    ret = sap_listener_deinit();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to deinitialize SAP listener: %s", esp_err_to_name(ret));
-    }
+#ifdef CONFIG_RX_SPDIF_MIRROR
+    // Covers stop as well; harmless if the mirror never started
+    spdif_deinit();
+#endif
+
+    // Stop SAP listener; its announcement table stays for the next receiver mode
+    receiver_core_stop_listener();
 
-    // TODO: Stop network and audio tasks properly
-    // For now, these don't have clean stop functions
+    wifi_manager_set_streaming(false);
+
+    // The jitter buffer, RTP receiver and playout task stay up (receiver_core_start())
     return ESP_OK;
 }
 
@@ -345,6 +561,7 @@ static esp_err_t stop_mode_receiver_usb(void) {
 
 static esp_err_t start_mode_receiver_spdif(void) {
     ESP_LOGI(TAG, "Starting S/PDIF receiver mode...");
+    int64_t lap = esp_timer_get_time();
     
     // Ensure USB switch is in default state (Port 1)
     ESP_LOGI(TAG, "Ensuring USB switch is set to Port 1 (default)");
@@ -357,17 +574,15 @@ static esp_err_t start_mode_receiver_spdif(void) {
     uint32_t sample_rate = lifecycle_get_sample_rate();
     uint8_t spdif_data_pin = lifecycle_get_spdif_data_pin();
 
-    // Setup buffer for network->S/PDIF streaming
-    setup_buffer();
-
-    setup_audio();
-
+    // Jitter buffer, playout task, network receiver and SAP listener (kept if already up)
+    receiver_core_start(&lap);
         
     ESP_LOGI(TAG, "Initializing SPDIF output with pin %d and sample rate %lu",
         spdif_data_pin, sample_rate);
         
     //
 
+    receiver_spdif_set_depth();
     esp_err_t err = spdif_init(sample_rate, spdif_data_pin);
     if (err == ESP_OK) {
         ESP_LOGI(TAG, "SPDIF initialized successfully");
@@ -386,25 +601,7 @@ static esp_err_t start_mode_receiver_spdif(void) {
         ESP_LOGE(TAG, "Failed to initialize SPDIF: %s", esp_err_to_name(err));
         ESP_LOGW(TAG, "Audio output will not be available. Please check the SPDIF pin configuration in the web UI.");
     }
-
-    
-    // Setup network receiver
-    
-    network_init();
-    
-    // Initialize and start SAP listener
-    
-    ret = sap_listener_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize SAP listener: %s", esp_err_to_name(ret));
-    } else {
-        ret = sap_listener_start();
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to start SAP listener: %s", esp_err_to_name(ret));
-        } else {
-            ESP_LOGI(TAG, "SAP listener started successfully");
-        }
-    }
+    lifecycle_trace_step("spdif_output", &lap);
     
     // Initialize visualizer for audio visualization
     
@@ -416,6 +613,10 @@ static esp_err_t start_mode_receiver_spdif(void) {
         ESP_LOGI(TAG, "Visualizer initialized successfully");
     }
     
+    receiver_core_play();
+
+    // Modem sleep off until silence sleep: audio is not held at the AP for a DTIM
+    wifi_manager_set_streaming(true);
     ESP_LOGI(TAG, "S/PDIF receiver mode started successfully");
     return ESP_OK;
 }
@@ -430,16 +631,11 @@ static esp_err_t stop_mode_receiver_spdif(void) {
         ESP_LOGE(TAG, "Failed to stop visualizer: %s", esp_err_to_name(ret));
     }
     
-    // Stop SAP listener
-    ret = sap_listener_stop();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop SAP listener: %s", esp_err_to_name(ret));
-    }
+    // Stop SAP listener; its announcement table stays for the next receiver mode
+    receiver_core_stop_listener();
     
-    ret = sap_listener_deinit();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to deinitialize SAP listener: %s", esp_err_to_name(ret));
-    }
+    // Playout first, so nothing is written to the transmitter while it goes away
+    receiver_core_park();
     
     // Stop and deinitialize S/PDIF output
     ret = spdif_stop();
@@ -453,6 +649,91 @@ static esp_err_t stop_mode_receiver_spdif(void) {
     }
     
     ESP_LOGI(TAG, "S/PDIF output stopped and deinitialized");
-    // TODO: Stop network and buffer tasks properly
+    wifi_manager_set_streaming(false);
+    // The jitter buffer, RTP receiver and playout task stay up (receiver_core_start())
+    return ESP_OK;
+}
+
+// ==================== Receiver Sleep/Wake ====================
+
+#ifdef CONFIG_RX_IDLE_LIGHT_SLEEP
+static bool s_spdif_parked = false;     // S/PDIF output stopped for idle light sleep
+
+// S/PDIF carries a receiver mode's output (directly or as the USB mirror)
+static bool receiver_has_spdif(lifecycle_state_t mode) {
+#ifdef CONFIG_RX_SPDIF_MIRROR
+    (void)mode;
+    return true;
+#else
+    return mode == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF;
+#endif
+}
+#endif
+
+static esp_err_t suspend_mode_receiver(lifecycle_state_t mode) {
+    ESP_LOGI(TAG, "Parking receiver mode for sleep...");
+
+    // Playout stops pulling; the receiver keeps filling the jitter buffer
+    audio_out_set_parked(true);
+
+    if (mode == LIFECYCLE_STATE_MODE_RECEIVER_USB) {
+        // Stop the stream but keep the DAC open and enumerated, with its stream config cached
+        esp_err_t ret = usb_out_prepare_for_sleep();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to park USB output: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+#ifdef CONFIG_RX_IDLE_LIGHT_SLEEP
+    // A running I2S channel holds a PM lock and would keep the CPU out of light sleep
+    s_spdif_parked = receiver_has_spdif(mode) && spdif_stop() == ESP_OK;
+#else
+    // S/PDIF keeps its carrier (silence) so the downstream receiver stays locked
+#endif
+
+    esp_err_t ret = sap_listener_stop();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to stop SAP listener for sleep: %s", esp_err_to_name(ret));
+    }
+    ESP_LOGI(TAG, "Receiver mode parked");
+    return ESP_OK;
+}
+
+static esp_err_t resume_mode_receiver(lifecycle_state_t mode) {
+    ESP_LOGI(TAG, "Resuming parked receiver mode...");
+    int64_t lap = esp_timer_get_time();
+
+    // Audio first; the listener is not needed for the stream that woke us
+    wifi_manager_set_streaming(true);
+    if (mode == LIFECYCLE_STATE_MODE_RECEIVER_USB) {
+        // Restart the stream from the cached config: no enumeration or format negotiation
+        esp_err_t ret = usb_out_restore_after_wake();
+        lifecycle_trace_step("usb_out_restore", &lap);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to restore USB output: %s", esp_err_to_name(ret));
+            return ret;
+        }
+    }
+#ifdef CONFIG_RX_IDLE_LIGHT_SLEEP
+    if (s_spdif_parked) {
+        s_spdif_parked = false;
+        esp_err_t ret = spdif_start();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to restart S/PDIF output: %s", esp_err_to_name(ret));
+            if (mode == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
+                return ret;
+            }
+        }
+    }
+#endif
+    audio_out_set_parked(false);
+    lifecycle_trace_step("resume_outputs", &lap);
+
+    esp_err_t ret = sap_listener_start();
+    lifecycle_trace_step("sap_listener", &lap);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to restart SAP listener after sleep: %s", esp_err_to_name(ret));
+    }
+    ESP_LOGI(TAG, "Receiver mode resumed");
     return ESP_OK;
 }
\ No newline at end of file
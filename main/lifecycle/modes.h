@@ -30,11 +30,48 @@ esp_err_t lifecycle_mode_start(lifecycle_state_t mode);
  * @brief Stop the specified operational mode
  * 
  * Maps the lifecycle state to the appropriate mode stop function
- * and cleans up all resources associated with that mode.
+ * and stops the mode's input or output drivers. Wi-Fi, the sender's
+ * sockets and the receiver core (see lifecycle_mode_invalidate()) stay
+ * up, so the next mode start only brings up its own drivers.
  * 
  * @param mode The mode to stop
  * @return ESP_OK on success, or an error code on failure
  */
 esp_err_t lifecycle_mode_stop(lifecycle_state_t mode);
 
+/**
+ * @brief Have the next receiver mode start rebuild its shared core
+ * 
+ * The receiver modes share the jitter buffer, RTP receiver, playout task
+ * and SAP listener, which stay up across mode switches (a sender mode in
+ * between included) so only the outputs are swapped. Settings read when
+ * they are set up (packet time, bit depth, codec, keys, ...) call this so
+ * the next start sets them up again instead.
+ */
+void lifecycle_mode_invalidate(void);
+
+/**
+ * @brief Park a receiver mode for silence sleep
+ * 
+ * Playout stops and the SAP listener goes down, but the RTP socket,
+ * jitter buffer and outputs stay configured: packets that arrive while
+ * asleep are buffered, and lifecycle_mode_resume() plays them without
+ * a full mode start. A parked mode that is not resumed must still be
+ * stopped with lifecycle_mode_stop().
+ * 
+ * @param mode The receiver mode to park
+ * @return ESP_OK if parked, ESP_ERR_NOT_SUPPORTED for sender modes, or
+ *         an error code (the mode then needs a full stop)
+ */
+esp_err_t lifecycle_mode_suspend(lifecycle_state_t mode);
+
+/**
+ * @brief Resume a mode parked by lifecycle_mode_suspend()
+ * 
+ * @param mode The parked mode
+ * @return ESP_OK on success, or an error code (the mode then needs a
+ *         full stop and start)
+ */
+esp_err_t lifecycle_mode_resume(lifecycle_state_t mode);
+
 #endif // LIFECYCLE_MODES_H
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "net_iface.h"
+#include "sdkconfig.h"
+#include "../build_config.h"
+#include "../global.h"
+#include "../lifecycle_manager.h"
+#include "wifi_manager.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#ifdef CONFIG_NET_ETHERNET_ENABLED
+#include "esp_eth.h"
+#include "esp_event.h"
+#include "esp_mac.h"
+#include "driver/gpio.h"
+#ifdef CONFIG_NET_ETH_W5500
+#include "driver/spi_master.h"
+#endif
+#endif
+
+// Above the station's (100): the cable is the default route whenever it has an address
+#define NET_IFACE_ETH_ROUTE_PRIO 150
+
+static atomic_bool s_eth_up = false;
+
+#ifdef CONFIG_NET_ETHERNET_ENABLED
+static esp_eth_handle_t s_eth = NULL;
+static esp_netif_t *s_eth_netif = NULL;
+
+static void eth_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    if (base == ETH_EVENT) {
+        switch (id) {
+            case ETHERNET_EVENT_CONNECTED:
+                ESP_LOGI(TAG, "Ethernet link up");
+                break;
+            case ETHERNET_EVENT_DISCONNECTED:
+                ESP_LOGW(TAG, "Ethernet link down");
+                if (atomic_exchange(&s_eth_up, false)) {
+                    // The station (if connected) is the default route again
+                    lifecycle_manager_post_event(wifi_manager_get_state() == WIFI_MANAGER_STATE_CONNECTED
+                                                 ? LIFECYCLE_EVENT_WIFI_CONNECTED
+                                                 : LIFECYCLE_EVENT_WIFI_DISCONNECTED);
+                }
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+
+    if (id == IP_EVENT_ETH_GOT_IP) {
+        const ip_event_got_ip_t *got = (const ip_event_got_ip_t *)data;
+        ESP_LOGI(TAG, "Ethernet got IP " IPSTR " (GW " IPSTR ")",
+                 IP2STR(&got->ip_info.ip), IP2STR(&got->ip_info.gw));
+        atomic_store(&s_eth_up, true);
+        lifecycle_manager_post_event(LIFECYCLE_EVENT_WIFI_CONNECTED);
+    } else if (id == IP_EVENT_ETH_LOST_IP) {
+        ESP_LOGW(TAG, "Ethernet lost its IP address");
+        if (atomic_exchange(&s_eth_up, false) && wifi_manager_get_state() != WIFI_MANAGER_STATE_CONNECTED) {
+            lifecycle_manager_post_event(LIFECYCLE_EVENT_WIFI_DISCONNECTED);
+        }
+    }
+}
+
+static esp_err_t eth_new_driver(esp_eth_mac_t **mac, esp_eth_phy_t **phy) {
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    eth_phy_config_t phy_config = ETH_PHY_DEFAULT_CONFIG();
+    phy_config.reset_gpio_num = CONFIG_NET_ETH_PHY_RST_GPIO;
+
+#ifdef CONFIG_NET_ETH_W5500
+    spi_host_device_t host = CONFIG_NET_ETH_SPI_HOST == 2 ? SPI3_HOST : SPI2_HOST;
+    spi_bus_config_t bus = {
+        .sclk_io_num = CONFIG_NET_ETH_SPI_SCLK_GPIO,
+        .mosi_io_num = CONFIG_NET_ETH_SPI_MOSI_GPIO,
+        .miso_io_num = CONFIG_NET_ETH_SPI_MISO_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+    };
+    esp_err_t err = spi_bus_initialize(host, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Ethernet: SPI bus init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    spi_device_interface_config_t dev = {
+        .mode = 0,
+        .clock_speed_hz = CONFIG_NET_ETH_SPI_CLOCK_MHZ * 1000 * 1000,
+        .queue_size = 16,
+        .spics_io_num = CONFIG_NET_ETH_SPI_CS_GPIO,
+    };
+    eth_w5500_config_t w5500_config = ETH_W5500_DEFAULT_CONFIG(host, &dev);
+    w5500_config.int_gpio_num = CONFIG_NET_ETH_SPI_INT_GPIO;
+    if (CONFIG_NET_ETH_SPI_INT_GPIO < 0) {
+        w5500_config.poll_period_ms = CONFIG_NET_ETH_SPI_POLL_MS;
+    } else {
+        // The driver's interrupt handler goes through the GPIO ISR service
+        err = gpio_install_isr_service(0);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            spi_bus_free(host);
+            return err;
+        }
+    }
+    *mac = esp_eth_mac_new_w5500(&w5500_config, &mac_config);
+    *phy = esp_eth_phy_new_w5500(&phy_config);
+    if (!*mac || !*phy) {
+        spi_bus_free(host);
+    }
+#else
+    eth_esp32_emac_config_t emac_config = ETH_ESP32_EMAC_DEFAULT_CONFIG();
+    emac_config.smi_gpio.mdc_num = CONFIG_NET_ETH_RMII_MDC_GPIO;
+    emac_config.smi_gpio.mdio_num = CONFIG_NET_ETH_RMII_MDIO_GPIO;
+    phy_config.phy_addr = CONFIG_NET_ETH_PHY_ADDR;
+    *mac = esp_eth_mac_new_esp32(&emac_config, &mac_config);
+    *phy = esp_eth_phy_new_generic(&phy_config);
+#endif
+    if (!*mac || !*phy) {
+        ESP_LOGE(TAG, "Ethernet: could not create the MAC or PHY driver");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+#endif
+
+esp_err_t net_iface_eth_start(void) {
+#ifdef CONFIG_NET_ETHERNET_ENABLED
+    if (s_eth) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Starting wired Ethernet (%s)",
+#ifdef CONFIG_NET_ETH_W5500
+             "W5500 over SPI"
+#else
+             "RMII PHY"
+#endif
+    );
+
+    esp_eth_mac_t *mac = NULL;
+    esp_eth_phy_t *phy = NULL;
+    esp_err_t err = eth_new_driver(&mac, &phy);
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(mac, phy);
+    err = esp_eth_driver_install(&eth_config, &s_eth);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Ethernet: driver install failed: %s", esp_err_to_name(err));
+        s_eth = NULL;
+        return err;
+    }
+
+#ifdef CONFIG_NET_ETH_W5500
+    // The W5500 has no address of its own: use the one eFuse reserves for Ethernet
+    uint8_t mac_addr[6];
+    if (esp_read_mac(mac_addr, ESP_MAC_ETH) == ESP_OK) {
+        esp_eth_ioctl(s_eth, ETH_CMD_S_MAC_ADDR, mac_addr);
+    }
+#endif
+
+    esp_netif_inherent_config_t base = ESP_NETIF_INHERENT_DEFAULT_ETH();
+    base.route_prio = NET_IFACE_ETH_ROUTE_PRIO;
+    esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_ETH();
+    netif_config.base = &base;
+    s_eth_netif = esp_netif_new(&netif_config);
+    if (!s_eth_netif) {
+        esp_eth_driver_uninstall(s_eth);
+        s_eth = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    esp_netif_attach(s_eth_netif, esp_eth_new_netif_glue(s_eth));
+
+    esp_event_handler_register(ETH_EVENT, ESP_EVENT_ANY_ID, eth_event_handler, NULL);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, eth_event_handler, NULL);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_ETH_LOST_IP, eth_event_handler, NULL);
+
+    err = esp_eth_start(s_eth);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Ethernet: start failed: %s", esp_err_to_name(err));
+    }
+    return err;
+#else
+    return ESP_OK;
+#endif
+}
+
+bool net_iface_eth_up(void) {
+    return atomic_load_explicit(&s_eth_up, memory_order_relaxed);
+}
+
+esp_netif_t *net_iface_primary(void) {
+#ifdef CONFIG_NET_ETHERNET_ENABLED
+    if (s_eth_netif && net_iface_eth_up()) {
+        return s_eth_netif;
+    }
+#endif
+    return esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+}
+
+bool net_iface_connected(void) {
+    return net_iface_eth_up() || wifi_manager_get_state() == WIFI_MANAGER_STATE_CONNECTED;
+}
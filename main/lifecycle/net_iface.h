@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+
+/**
+ * @file net_iface.h
+ * @brief The network interface the device streams on: wired Ethernet or Wi-Fi
+ *
+ * With CONFIG_NET_ETHERNET_ENABLED a W5500 (SPI) or RMII PHY comes up next to
+ * Wi-Fi. Its netif has a higher route priority than the station, so once it
+ * has an address lwIP routes everything bound to INADDR_ANY over the cable,
+ * multicast joins and sends included, and falls back to Wi-Fi when the link
+ * drops. Code that needs the device's own address asks net_iface_primary()
+ * rather than assuming the station.
+ *
+ * Ethernet getting (or losing) its address is posted to the lifecycle as
+ * LIFECYCLE_EVENT_WIFI_CONNECTED (or _DISCONNECTED, unless Wi-Fi still has
+ * one), so receiver modes start on the cable alone.
+ */
+
+/**
+ * @brief Install the Ethernet driver and start the interface
+ *
+ * Needs the default event loop and esp_netif, which the Wi-Fi manager sets up.
+ * A no-op returning ESP_OK without CONFIG_NET_ETHERNET_ENABLED.
+ *
+ * @return ESP_OK, or the error of the driver step that failed
+ */
+esp_err_t net_iface_eth_start(void);
+
+// Ethernet link is up and has an IPv4 address
+bool net_iface_eth_up(void);
+
+/**
+ * @brief The interface the device is reached on
+ *
+ * @return Ethernet while it has an address, otherwise the Wi-Fi station
+ *         (NULL before Wi-Fi is initialized)
+ */
+esp_netif_t *net_iface_primary(void);
+
+// Some interface carries the streams: Ethernet has an address or the station is connected
+bool net_iface_connected(void);
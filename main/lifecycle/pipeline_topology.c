@@ -0,0 +1,67 @@
+#include "pipeline_topology.h"
+#include "build_config.h"
+#include "lifecycle_manager.h"
+#include "esp_log.h"
+
+#undef TAG
+#define TAG "topology"
+
+static const pipeline_placement_t s_presets[PIPELINE_TOPOLOGY_COUNT][PIPELINE_STAGE_COUNT] = {
+    [PIPELINE_TOPOLOGY_SINGLE_CORE] = {
+        [PIPELINE_STAGE_INGEST]  = { 1, 5 },
+        [PIPELINE_STAGE_PLAYOUT] = { 1, 5 },
+        [PIPELINE_STAGE_SEND]    = { 1, 5 },
+        [PIPELINE_STAGE_DECODE]  = { 0, 5 },
+        [PIPELINE_STAGE_ENCODE]  = { 0, 5 },
+    },
+    [PIPELINE_TOPOLOGY_SPLIT] = {
+        [PIPELINE_STAGE_INGEST]  = { 0, 6 },
+        [PIPELINE_STAGE_PLAYOUT] = { 1, 6 },
+        [PIPELINE_STAGE_SEND]    = { 0, 6 },
+        [PIPELINE_STAGE_DECODE]  = { 1, 5 },
+        [PIPELINE_STAGE_ENCODE]  = { 1, 5 },
+    },
+    [PIPELINE_TOPOLOGY_CUSTOM] = {
+        [PIPELINE_STAGE_INGEST]  = { CONFIG_PIPELINE_CUSTOM_INGEST_CORE, CONFIG_PIPELINE_CUSTOM_INGEST_PRIORITY },
+        [PIPELINE_STAGE_PLAYOUT] = { CONFIG_PIPELINE_CUSTOM_PLAYOUT_CORE, CONFIG_PIPELINE_CUSTOM_PLAYOUT_PRIORITY },
+        [PIPELINE_STAGE_SEND]    = { CONFIG_PIPELINE_CUSTOM_SEND_CORE, CONFIG_PIPELINE_CUSTOM_SEND_PRIORITY },
+        [PIPELINE_STAGE_DECODE]  = { CONFIG_PIPELINE_CUSTOM_DECODE_CORE, CONFIG_PIPELINE_CUSTOM_DECODE_PRIORITY },
+        [PIPELINE_STAGE_ENCODE]  = { CONFIG_PIPELINE_CUSTOM_ENCODE_CORE, CONFIG_PIPELINE_CUSTOM_ENCODE_PRIORITY },
+    },
+};
+
+static const char *const s_names[PIPELINE_TOPOLOGY_COUNT] = {
+    [PIPELINE_TOPOLOGY_SINGLE_CORE] = "single_core",
+    [PIPELINE_TOPOLOGY_SPLIT]       = "split",
+    [PIPELINE_TOPOLOGY_CUSTOM]      = "custom",
+};
+
+pipeline_placement_t pipeline_topology_placement(pipeline_stage_t stage)
+{
+    pipeline_topology_t topology = (pipeline_topology_t)lifecycle_get_pipeline_topology();
+    if (stage >= PIPELINE_STAGE_COUNT) {
+        stage = PIPELINE_STAGE_PLAYOUT;
+    }
+    pipeline_placement_t p = s_presets[topology][stage];
+    if (p.core >= portNUM_PROCESSORS) {
+        p.core = portNUM_PROCESSORS - 1;
+    }
+    return p;
+}
+
+BaseType_t pipeline_task_create(pipeline_stage_t stage, TaskFunction_t fn, const char *name,
+                                uint32_t stack_bytes, void *arg, TaskHandle_t *handle)
+{
+    pipeline_placement_t p = pipeline_topology_placement(stage);
+    BaseType_t ret = xTaskCreatePinnedToCore(fn, name, stack_bytes, arg, p.priority, handle, p.core);
+    if (ret == pdPASS) {
+        ESP_LOGI(TAG, "%s: core %u, priority %u (%s)", name, (unsigned)p.core, (unsigned)p.priority,
+                 pipeline_topology_name((pipeline_topology_t)lifecycle_get_pipeline_topology()));
+    }
+    return ret;
+}
+
+const char *pipeline_topology_name(pipeline_topology_t topology)
+{
+    return topology < PIPELINE_TOPOLOGY_COUNT ? s_names[topology] : "unknown";
+}
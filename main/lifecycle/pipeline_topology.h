@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @file pipeline_topology.h
+ * @brief Core and priority of each audio pipeline task
+ *
+ * The pipeline_topology setting (NVS, /api/settings) picks one of the
+ * presets below; each stage's task is created with the core and priority the
+ * preset gives it. Tasks are created at mode start, so a change applies at
+ * the next one.
+ *
+ * - Single core: ingest, playout and sending all on core 1 at priority 5,
+ *   codecs on core 0 (the layout before presets existed).
+ * - Split: ingest and sending on core 0, next to Wi-Fi and lwIP, so a
+ *   datagram does not cross cores between the stack and the task that takes
+ *   it; playout, DSP and the codecs on core 1 with nothing from the network
+ *   stack competing for it. Playout sits one level above the decoder so a
+ *   long decode cannot push an output write past its deadline.
+ * - Custom: the CONFIG_PIPELINE_CUSTOM_* cores and priorities.
+ *
+ * GET /api/tasks shows where each task landed and what share of its core it
+ * takes.
+ */
+
+typedef enum {
+    PIPELINE_STAGE_INGEST = 0,  // udp_handler: RTP receive, reorder, commit to the ring
+    PIPELINE_STAGE_PLAYOUT,     // pcm_handler: pop, DSP, output sinks
+    PIPELINE_STAGE_SEND,        // rtp_sender_task: capture ring to RTP
+    PIPELINE_STAGE_DECODE,      // opus_dec
+    PIPELINE_STAGE_ENCODE,      // opus_enc
+    PIPELINE_STAGE_COUNT
+} pipeline_stage_t;
+
+typedef enum {
+    PIPELINE_TOPOLOGY_SINGLE_CORE = 0,
+    PIPELINE_TOPOLOGY_SPLIT,
+    PIPELINE_TOPOLOGY_CUSTOM,
+    PIPELINE_TOPOLOGY_COUNT
+} pipeline_topology_t;
+
+typedef struct {
+    uint8_t core;
+    uint8_t priority;
+} pipeline_placement_t;
+
+/**
+ * @brief Where a stage runs under the configured topology
+ */
+pipeline_placement_t pipeline_topology_placement(pipeline_stage_t stage);
+
+/**
+ * @brief xTaskCreatePinnedToCore() with the stage's core and priority
+ */
+BaseType_t pipeline_task_create(pipeline_stage_t stage, TaskFunction_t fn, const char *name,
+                                uint32_t stack_bytes, void *arg, TaskHandle_t *handle);
+
+const char *pipeline_topology_name(pipeline_topology_t topology);
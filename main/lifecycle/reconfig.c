@@ -4,6 +4,7 @@
 #include "../config/config_manager.h"
 #include "../receiver/audio_out.h"
 #include "../receiver/buffer.h"
+#include "../receiver/rtcp_receiver.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -33,43 +34,16 @@ esp_err_t lifecycle_reconfig_sample_rate(uint32_t new_rate) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    esp_err_t ret = ESP_OK;
-    
-    // Temporarily pause audio output
-    ESP_LOGI(TAG, "Pausing audio output for reconfiguration");
-    stop_playback();
+    // Chunks received from now on carry the new rate; playout keeps going through
+    // what is buffered and the PCM handler moves the outputs over at the first of them
+    buffer_set_stream_rate(new_rate);
+#ifdef CONFIG_RTCP_ENABLED
+    // Keep the sender mappings, counted in the new tick length
+    rtcp_set_clock_rate(new_rate);
+#endif
     
-    // Small delay to ensure audio has stopped
-    vTaskDelay(pdMS_TO_TICKS(100));
-    
-    // Reconfigure based on current mode
-    if (current_state == LIFECYCLE_STATE_MODE_RECEIVER_USB) {
-        ESP_LOGI(TAG, "Reconfiguring USB audio output for sample rate %lu Hz", new_rate);
-        // Note: USB audio typically handles sample rate changes automatically
-        // If a specific reconfiguration function exists, call it here
-        // For now, we rely on the USB audio subsystem to adapt
-        ESP_LOGI(TAG, "USB audio will adapt to new sample rate on resume");
-    } else if (current_state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
-        ESP_LOGI(TAG, "Reconfiguring SPDIF output for sample rate %lu Hz", new_rate);
-        ret = spdif_set_sample_rates((int)new_rate);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to reconfigure SPDIF sample rate: 0x%x", ret);
-        } else {
-            ESP_LOGI(TAG, "SPDIF sample rate reconfigured successfully");
-        }
-    }
-    
-    // Resume audio output
-    ESP_LOGI(TAG, "Resuming audio output after reconfiguration");
-    resume_playback();
-    
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Sample rate reconfiguration completed successfully");
-    } else {
-        ESP_LOGE(TAG, "Sample rate reconfiguration failed: 0x%x", ret);
-    }
-    
-    return ret;
+    ESP_LOGI(TAG, "Sample rate %lu Hz applies from the next received chunk", new_rate);
+    return ESP_OK;
 }
 
 /**
@@ -183,6 +157,8 @@ esp_err_t lifecycle_reconfig_buffer_params(void) {
     ESP_LOGI(TAG, "Reconfiguring buffer with parameters:");
     ESP_LOGI(TAG, "  initial_buffer_size: %d", config->initial_buffer_size);
     ESP_LOGI(TAG, "  max_buffer_size: %d", config->max_buffer_size);
+    ESP_LOGI(TAG, "  buffer_target_ms: %u", config->buffer_target_ms);
+    ESP_LOGI(TAG, "  buffer_max_ms: %u", config->buffer_max_ms);
     ESP_LOGI(TAG, "  buffer_grow_step_size: %d", config->buffer_grow_step_size);
     ESP_LOGI(TAG, "  max_grow_size: %d", config->max_grow_size);
     
@@ -16,8 +16,10 @@
 /**
  * @brief Reconfigure sample rate for active receiver modes without restart
  * 
- * This function temporarily pauses audio output, reconfigures the appropriate
- * subsystem (USB or SPDIF), and resumes playback.
+ * Playback is not interrupted: chunks received from now on are stamped with
+ * the new rate, and the PCM handler reconfigures the output (USB DAC or S/PDIF
+ * transmitter) at the boundary where they begin. RTCP mappings are rescaled
+ * rather than reset.
  * 
  * @param new_rate The new sample rate in Hz
  * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not in receiver mode,
@@ -4,21 +4,33 @@
 #include "../config/config_manager.h"
 #include "../receiver/network_in.h"
 #include "../receiver/sap_listener.h"
+#include "../receiver/media_clock.h"
 #include "../lifecycle_manager.h"
 #include "esp_log.h"
 #include <string.h>
+#ifdef CONFIG_PTP_ENABLED
+#include "ptp_slave.h"
+#endif
 
 esp_err_t lifecycle_manager_notify_sap_stream(const char* stream_name,
                                               const char* multicast_ip,
                                               const char* source_ip,
                                               uint16_t port,
-                                              uint32_t sample_rate) {
+                                              uint32_t sample_rate,
+                                              uint8_t bit_depth,
+                                              uint8_t channels,
+                                              uint8_t opus_pt,
+                                              uint8_t ptime_ms,
+                                              bool ptp_clock,
+                                              uint8_t ptp_domain,
+                                              uint32_t mediaclk_offset,
+                                              const char* srtp_crypto) {
     if (!stream_name || !multicast_ip || !source_ip) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGI(TAG, "SAP stream notification: name='%s', multicast=%s, source=%s, port=%d, rate=%lu",
-             stream_name, multicast_ip, source_ip, port, sample_rate);
+    ESP_LOGI(TAG, "SAP stream notification: name='%s', multicast=%s, source=%s, port=%d, rate=%lu, bits=%u, channels=%u, opus_pt=%u, ptime=%u",
+             stream_name, multicast_ip, source_ip, port, sample_rate, bit_depth, channels, opus_pt, ptime_ms);
     
     // Check if this stream matches our configured stream name
     const char* configured_stream = lifecycle_get_sap_stream_name();
@@ -41,6 +53,56 @@ esp_err_t lifecycle_manager_notify_sap_stream(const char* stream_name,
         ESP_LOGI(TAG, "SAP stream indicates sample rate %lu Hz, updating configuration", sample_rate);
         lifecycle_manager_change_sample_rate(sample_rate);
     }
+
+    // Follow the payload encoding (L16/L24/L32) so samples are converted correctly
+    if (PCM_BIT_DEPTH_VALID(bit_depth) && lifecycle_get_bit_depth() != bit_depth) {
+        ESP_LOGI(TAG, "SAP stream indicates L%u, updating configuration", bit_depth);
+        lifecycle_set_bit_depth(bit_depth);
+    }
+
+    // Follow the channel layout so frames are split correctly; the channel map picks the pair
+    if (PCM_CHANNELS_VALID(channels) && lifecycle_get_stream_channels() != channels) {
+        ESP_LOGI(TAG, "SAP stream indicates %u channels, updating configuration", channels);
+        lifecycle_set_stream_channels(channels);
+    }
+
+    // Follow the codec: an Opus rtpmap names the payload type to decode, L16/L24/L32 clears it
+    if (lifecycle_get_opus_pt() != opus_pt) {
+        ESP_LOGI(TAG, "SAP stream indicates %s, updating configuration", opus_pt ? "Opus" : "linear PCM");
+        lifecycle_set_opus_pt(opus_pt);
+    }
+
+    // Follow the sender's packet time so its packets map 1:1 onto jitter-buffer chunks
+    if (ptime_ms >= PCM_PTIME_MIN_MS && ptime_ms <= PCM_PTIME_MAX_MS &&
+        lifecycle_get_ptime_ms() != ptime_ms) {
+        ESP_LOGI(TAG, "SAP stream indicates ptime %u ms, updating configuration", ptime_ms);
+        lifecycle_set_ptime_ms(ptime_ms);
+    }
+
+    // AES67: RTP timestamps are PTP time, so playout follows the grandmaster, not RTCP
+#ifdef CONFIG_PTP_ENABLED
+    if (ptp_clock && ptp_domain != SAP_PTP_DOMAIN_UNSET) {
+        ptp_slave_set_domain(ptp_domain);
+    }
+#else
+    if (ptp_clock) {
+        ESP_LOGW(TAG, "SAP stream is PTP-referenced but PTP is disabled; timing it from RTCP");
+    }
+    (void)ptp_domain;
+#endif
+    media_clock_configure(ptp_clock, mediaclk_offset);
+
+    // Follow the stream's keys when the SDP carries them; the change restarts the receiver
+    if (srtp_crypto && strcmp(lifecycle_get_srtp_crypto(), srtp_crypto) != 0) {
+#ifdef CONFIG_RTP_SRTP_ENABLED
+        ESP_LOGI(TAG, "SAP stream indicates %s, updating configuration", srtp_crypto[0] ? "SRTP" : "plain RTP");
+        lifecycle_set_srtp_crypto(srtp_crypto);
+#else
+        if (srtp_crypto[0]) {
+            ESP_LOGW(TAG, "SAP stream is SRTP but SRTP is disabled; its packets will not play");
+        }
+#endif
+    }
     
     // Configure the network for this stream (will determine multicast vs unicast)
     esp_err_t ret = network_configure_stream(multicast_ip, source_ip, port);
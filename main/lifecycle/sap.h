@@ -23,13 +23,30 @@
  * @param source_ip The source IP of the announcement
  * @param port The port number
  * @param sample_rate The sample rate
+ * @param bit_depth Sample width from the SDP rtpmap encoding (L16/L24/L32, 0 if unknown)
+ * @param channels Channel count from the SDP rtpmap encoding (0 if unknown)
+ * @param opus_pt Payload type when the rtpmap encoding is Opus (0 for linear PCM)
+ * @param ptime_ms Packet time from SDP a=ptime (0 if not announced)
+ * @param ptp_clock SDP a=ts-refclk names a PTP (IEEE 1588-2008) reference clock
+ * @param ptp_domain PTP domain from a=ts-refclk (SAP_PTP_DOMAIN_UNSET if not given)
+ * @param mediaclk_offset RTP timestamp at PTP time zero, from a=mediaclk:direct
+ * @param srtp_crypto SDES value from a=crypto, "" for a plain RTP/AVP stream, or NULL when
+ *                    the stream is SRTP but its keys are not announced (the configured ones stay)
  * @return ESP_OK on success, or an error code on failure
  */
 esp_err_t lifecycle_manager_notify_sap_stream(const char* stream_name,
                                                const char* destination_ip,
                                                const char* source_ip,
                                                uint16_t port,
-                                               uint32_t sample_rate);
+                                               uint32_t sample_rate,
+                                               uint8_t bit_depth,
+                                               uint8_t channels,
+                                               uint8_t opus_pt,
+                                               uint8_t ptime_ms,
+                                               bool ptp_clock,
+                                               uint8_t ptp_domain,
+                                               uint32_t mediaclk_offset,
+                                               const char* srtp_crypto);
 
 /**
  * @brief Get the SAP stream name to automatically connect to
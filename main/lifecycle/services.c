@@ -3,11 +3,15 @@
 #include "../global.h"
 #include "../config/config_manager.h"
 #include "lifecycle_wifi_adapter.h"
+#include "net_iface.h"
 #include "wifi_manager.h"
 #include "../web/web_server.h"
 #include "../mdns/mdns_discovery.h"
 #include "../mdns/mdns_service.h"
 #include "ntp_client.h"
+#ifdef CONFIG_PTP_ENABLED
+#include "ptp_slave.h"
+#endif
 #include "spdif_in.h"
 #include "esp_log.h"
 
@@ -40,6 +44,14 @@ esp_err_t lifecycle_services_init_wifi(void) {
     return ESP_OK;
 }
 
+esp_err_t lifecycle_services_init_ethernet(void) {
+    esp_err_t ret = net_iface_eth_start();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start Ethernet, continuing on Wi-Fi: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
 esp_err_t lifecycle_services_init_web_server(void) {
     // Start the web server (works in both AP mode and STA mode)
     ESP_LOGI(TAG, "Starting web server for configuration...");
@@ -53,7 +65,7 @@ esp_err_t lifecycle_services_init_spdif_receiver(void) {
     if (config->device_mode == MODE_SENDER_SPDIF) {
         ESP_LOGI(TAG, "Initializing S/PDIF receiver with pin %d", config->spdif_data_pin);
         
-        esp_err_t ret = spdif_receiver_init(6, NULL); // Use hardcoded pin from original implementation
+        esp_err_t ret = spdif_receiver_init(config->spdif_data_pin, NULL);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to initialize S/PDIF receiver: %s", esp_err_to_name(ret));
             return ret;
@@ -94,6 +106,14 @@ esp_err_t lifecycle_services_init_mdns(void) {
     // Apply initial NTP configuration (screamrouter via mDNS or custom server)
     app_config_t *cfg = config_manager_get_config();
     ntp_client_set_config(cfg->ntp_screamrouter_mode, cfg->ntp_server_host, cfg->ntp_server_port);
+
+#ifdef CONFIG_PTP_ENABLED
+    // PTP slave: master clock for AES67 streams, ahead of NTP once locked
+    ret = ptp_slave_start();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start PTP slave: %s", esp_err_to_name(ret));
+    }
+#endif
     
     return ESP_OK;
 }
\ No newline at end of file
@@ -21,6 +21,16 @@
  */
 esp_err_t lifecycle_services_init_wifi(void);
 
+/**
+ * @brief Start wired Ethernet
+ * 
+ * Brings up the W5500 or RMII interface when CONFIG_NET_ETHERNET_ENABLED;
+ * once it has an address it carries the streams in place of Wi-Fi.
+ * 
+ * @return ESP_OK on success (or when Ethernet is not built in), or an error code
+ */
+esp_err_t lifecycle_services_init_ethernet(void);
+
 /**
  * @brief Start the web server
  * 
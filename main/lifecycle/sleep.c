@@ -1,13 +1,16 @@
 #include "sleep.h"
 #include "lifecycle_internal.h"
+#include "hw_init.h"
 #include "../global.h"
 #include "../config/config_manager.h"
 #include "../receiver/sap_listener.h"
+#include "../receiver/audio_out.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
+#include "wifi_manager.h"
 #include "esp_err.h"
 #include "esp_timer.h"
 
@@ -17,7 +20,10 @@ extern EventGroupHandle_t s_network_activity_event_group;
 // Forward declarations for external audio tracking variables
 extern bool is_silent;
 extern uint32_t silence_duration_ms;
-extern uint64_t last_audio_time;
+extern TickType_t last_audio_time;
+
+// Last tick a packet carried audio above the silence amplitude threshold
+static volatile TickType_t last_audible_tick = 0;
 
 // Get lifecycle context and state
 extern lifecycle_context_t* lifecycle_get_context(void);
@@ -45,7 +51,13 @@ static void network_monitor_task(void *params) {
     while (true) {
         if (ctx->monitoring_active) {
             // Use cached interval value for thread-safe access
-            uint32_t check_interval = ctx->cached_network_check_interval_ms;
+#ifdef CONFIG_RX_IDLE_LIGHT_SLEEP
+            // No polling: the packet that wakes the radio wakes this task, and
+            // the CPU light sleeps in between
+            TickType_t check_wait = portMAX_DELAY;
+#else
+            TickType_t check_wait = pdMS_TO_TICKS(ctx->cached_network_check_interval_ms);
+#endif
             
             // Wait for a packet notification OR timeout
             EventBits_t bits = xEventGroupWaitBits(
@@ -53,7 +65,7 @@ static void network_monitor_task(void *params) {
                 NETWORK_PACKET_RECEIVED_BIT,      // The bits within the event group to wait for.
                 pdTRUE,                           // NETWORK_PACKET_RECEIVED_BIT should be cleared before returning.
                 pdFALSE,                          // Don't wait for all bits, any bit will do (we only have one).
-                pdMS_TO_TICKS(check_interval)     // Use cached value for wait time
+                check_wait                        // Use cached value for wait time
             );
 
             // Check if still monitoring after the wait (could have been disabled by exit_silence_sleep_mode)
@@ -76,6 +88,7 @@ static void network_monitor_task(void *params) {
                 if (ctx->packet_counter >= activity_threshold) {
                     ESP_LOGI(TAG, "Network activity threshold met (%" PRIu32 " packets >= %d), exiting sleep mode",
                             ctx->packet_counter, activity_threshold);
+                    audio_out_mark_wake();
                     lifecycle_manager_post_event(LIFECYCLE_EVENT_WAKE_UP);
                 } else {
                     ESP_LOGD(TAG, "Monitor: Packet count %" PRIu32 " < threshold %d", ctx->packet_counter, activity_threshold);
@@ -153,8 +166,14 @@ void lifecycle_sleep_enter_silence_mode(void) {
              ctx->cached_activity_threshold_packets, ctx->cached_silence_amplitude_threshold,
              ctx->cached_network_inactivity_timeout_ms);
     
-    // Configure WiFi for max power saving
+    // Leave the streaming profile, then configure WiFi power saving: waking for
+    // every DTIM beacon catches the first multicast RTP packet the AP releases
+    wifi_manager_set_streaming(false);
+#ifdef CONFIG_RX_IDLE_WAKE_EVERY_DTIM
+    esp_err_t ret = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+#else
     esp_err_t ret = esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+#endif
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set WiFi power save mode: %s", esp_err_to_name(ret));
     }
@@ -186,6 +205,8 @@ void lifecycle_sleep_enter_silence_mode(void) {
         vTaskResume(ctx->network_monitor_task_handle);
     }
     
+    // The USB host stops in light sleep and the DAC would drop off the bus; clock down only
+    lifecycle_hw_power_set_idle(true, config->device_mode != MODE_RECEIVER_USB);
     ESP_LOGI(TAG, "Entered light sleep mode with network monitoring");
 }
 
@@ -193,10 +214,13 @@ void lifecycle_sleep_exit_silence_mode(void) {
     ESP_LOGI(TAG, "Exiting silence sleep mode");
     lifecycle_context_t *ctx = get_ctx();
     
+    // Full clock again before the outputs restart
+    lifecycle_hw_power_set_idle(false, false);
+
     // Stop the network monitoring
     ctx->monitoring_active = false;
     
-    // Set WiFi back to normal power saving mode
+    // Set WiFi back to normal power saving mode; the receiver mode start turns the streaming profile back on
     esp_err_t ret = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set WiFi normal mode: %s", esp_err_to_name(ret));
@@ -205,21 +229,10 @@ void lifecycle_sleep_exit_silence_mode(void) {
     // Reset silence tracking variables to prevent immediate re-entry into sleep mode
     is_silent = false;
     silence_duration_ms = 0;
-    last_audio_time = esp_timer_get_time() / 1000; // Reset to current time
+    last_audio_time = xTaskGetTickCount(); // Reset to current time
+    last_audible_tick = last_audio_time;
     
-    // Restart SAP listener if we're in a receiver mode
-    lifecycle_state_t current_state = lifecycle_get_current_state();
-    if (current_state == LIFECYCLE_STATE_MODE_RECEIVER_USB ||
-        current_state == LIFECYCLE_STATE_MODE_RECEIVER_SPDIF) {
-        if (!sap_listener_is_running()) {
-            ret = sap_listener_start();
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to restart SAP listener after sleep: %s", esp_err_to_name(ret));
-            } else {
-                ESP_LOGI(TAG, "SAP listener restarted after sleep");
-            }
-        }
-    }
+    // The receiver mode's resume (or full start) brings the SAP listener back
     
     ESP_LOGI(TAG, "Resumed normal operation");
 }
@@ -236,6 +249,18 @@ void lifecycle_sleep_report_network_activity(void) {
     }
 }
 
+void lifecycle_sleep_report_audio_peak(uint16_t peak) {
+    if (peak <= lifecycle_get_silence_amplitude_threshold()) {
+        return;
+    }
+    last_audible_tick = xTaskGetTickCount();
+    lifecycle_sleep_report_network_activity();
+}
+
+uint32_t lifecycle_sleep_get_content_silence_ms(void) {
+    return (uint32_t)(xTaskGetTickCount() - last_audible_tick) * portTICK_PERIOD_MS;
+}
+
 void lifecycle_sleep_update_params(void) {
     app_config_t *config = config_manager_get_config();
     lifecycle_context_t *ctx = get_ctx();
@@ -20,6 +20,24 @@
  */
 void lifecycle_sleep_report_network_activity(void);
 
+/**
+ * @brief Report the peak level of a received packet
+ * 
+ * Packets above the silence amplitude threshold restart the content-silence
+ * timer and count as network activity for waking; packets of (near) digital
+ * silence do neither, so a sender streaming zeros lets the device sleep.
+ * 
+ * @param peak Largest |sample| in the packet, 16-bit full scale
+ */
+void lifecycle_sleep_report_audio_peak(uint16_t peak);
+
+/**
+ * @brief Time since a packet last carried audio above the amplitude threshold
+ * 
+ * @return Milliseconds of content silence
+ */
+uint32_t lifecycle_sleep_get_content_silence_ms(void);
+
 /**
  * @brief Enter silence sleep mode
  * 
@@ -4,12 +4,21 @@
 #include "services.h"
 #include "modes.h"
 #include "sleep.h"
+#include "attach_wake.h"
+#include "cpu_governor.h"
+#include "task_stats.h"
+#include "boot_graph.h"
+#include "trace.h"
 #include "config.h"
 #include "../global.h"
+#include "../logging/event_trace.h"
 #include "../config/config_manager.h"
 #include "wifi_manager.h"
+#include "net_iface.h"
 #include "../mdns/mdns_discovery.h"
 #include "../mdns/mdns_service.h"
+#include "../sender/network_out.h"
+#include "../sender/auto_select.h"
 #include "bq25895_integration.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -18,11 +27,21 @@
 
 #define LIFECYCLE_EVENT_QUEUE_SIZE 10
 
+// Queue entry: the event and when it was posted, for the trace
+typedef struct {
+    lifecycle_event_t event;
+    int64_t posted_us;
+} queued_event_t;
+
 #undef TAG
 #define TAG "lifecycle_sm"
 
 static QueueHandle_t s_lifecycle_event_queue = NULL;
 static lifecycle_state_t s_current_state = LIFECYCLE_STATE_INITIALIZING;
+// Receiver mode parked by silence sleep (LIFECYCLE_STATE_SLEEPING when none)
+static lifecycle_state_t s_parked_mode = LIFECYCLE_STATE_SLEEPING;
+// Settings changed while parked: wake through a full mode start so they apply
+static bool s_parked_stale = false;
 
 // Forward declarations for state handlers
 static void handle_state_initializing(lifecycle_event_t event);
@@ -41,8 +60,9 @@ static void lifecycle_run_background_tasks(void);
 // Forward declarations for state transition helpers
 static void set_state(lifecycle_state_t new_state);
 static void handle_state_entry(lifecycle_state_t state);
-static void handle_state_exit(lifecycle_state_t state);
+static void handle_state_exit(lifecycle_state_t state, lifecycle_state_t next_state);
 static void evaluate_and_transition(void);
+static void restart_mode(void);
 
 /**
  * State entry handler - called when entering a new state
@@ -53,32 +73,19 @@ static void handle_state_entry(lifecycle_state_t state) {
     
     switch (state) {
         case LIFECYCLE_STATE_HW_INIT: {
-            // Use extracted hardware initialization functions
-            ESP_ERROR_CHECK(lifecycle_hw_init_nvs());
-            ESP_ERROR_CHECK(lifecycle_hw_init_config());
-            
-            // Non-critical initializations
-            lifecycle_hw_init_ota();  // Continue on failure
-            lifecycle_hw_init_battery();  // Continue on failure
-            lifecycle_hw_init_power_management();  // Continue on failure
-            
-            // DAC detection logic
-            lifecycle_hw_init_dac_detection();
+            // NVS and configuration are critical; OTA, charger and power
+            // management start alongside and may finish in the background
+            ESP_ERROR_CHECK(lifecycle_boot_run_until(BOOT_HW_SERVICES));
             
             // Proceed to starting services
             set_state(LIFECYCLE_STATE_STARTING_SERVICES);
             break;
         }
         case LIFECYCLE_STATE_STARTING_SERVICES: {
-            // Use extracted service initialization functions
-            ESP_ERROR_CHECK(lifecycle_services_init_wifi());
-            lifecycle_services_init_spdif_receiver();  // Only initializes in SPDIF sender mode
-            ESP_ERROR_CHECK(lifecycle_services_init_web_server());
-            
-            // Initialize mDNS immediately after WiFi, regardless of connection state
-            // This allows mDNS to work in AP mode as well
-            ESP_LOGI(TAG, "Initializing mDNS services (works in both AP and STA modes)");
-            lifecycle_services_init_mdns();
+            // Wi-Fi and the S/PDIF receiver (SPDIF sender mode only). The web
+            // UI and mDNS/NTP follow once the mode's audio path is up, in AP
+            // mode as well (see boot_graph.h)
+            ESP_ERROR_CHECK(lifecycle_boot_run_until(BOOT_NET_SERVICES));
             
             set_state(LIFECYCLE_STATE_AWAITING_MODE_CONFIG);
             break;
@@ -88,6 +95,11 @@ static void handle_state_entry(lifecycle_state_t state) {
             // Instead, immediately check if we can transition
             ESP_LOGI(TAG, "Entered AWAITING_MODE_CONFIG, checking for immediate transition");
             
+            if (!wifi_manager_has_credentials()) {
+                // Configuration portal: no stream to come, the web UI is what matters
+                lifecycle_boot_mark_done(BOOT_SVC_AUDIO_PATH);
+            }
+            
             // For sender modes that don't require WiFi, transition immediately
             // For receiver modes, wait for WiFi connection event
             evaluate_and_transition();
@@ -95,9 +107,23 @@ static void handle_state_entry(lifecycle_state_t state) {
         }
         case LIFECYCLE_STATE_MODE_SENDER_USB:
         case LIFECYCLE_STATE_MODE_SENDER_SPDIF:
+            lifecycle_mode_start(state);
+            lifecycle_boot_mark_done(BOOT_SVC_AUDIO_PATH);
+            break;
         case LIFECYCLE_STATE_MODE_RECEIVER_USB:
         case LIFECYCLE_STATE_MODE_RECEIVER_SPDIF:
+            if (s_parked_mode == state) {
+                // Back from silence sleep: the buffered packets play as soon as the output is up
+                s_parked_mode = LIFECYCLE_STATE_SLEEPING;
+                if (lifecycle_mode_resume(state) == ESP_OK) {
+                    break;
+                }
+                ESP_LOGW(TAG, "Fast resume failed, restarting mode %d", state);
+                lifecycle_mode_stop(state);
+            }
             lifecycle_mode_start(state);
+            // Socket and jitter buffer are up: let the web UI and discovery start
+            lifecycle_boot_mark_done(BOOT_SVC_AUDIO_PATH);
             break;
         case LIFECYCLE_STATE_SLEEPING:
             lifecycle_sleep_enter_silence_mode();
@@ -115,18 +141,31 @@ static void handle_state_entry(lifecycle_state_t state) {
 /**
  * State exit handler - called when leaving a state
  */
-static void handle_state_exit(lifecycle_state_t state) {
+static void handle_state_exit(lifecycle_state_t state, lifecycle_state_t next_state) {
     ESP_LOGI(TAG, "LIFECYCLE: Exiting state %d", state);
     
     switch (state) {
         case LIFECYCLE_STATE_MODE_SENDER_USB:
         case LIFECYCLE_STATE_MODE_SENDER_SPDIF:
+            lifecycle_mode_stop(state);
+            break;
         case LIFECYCLE_STATE_MODE_RECEIVER_USB:
         case LIFECYCLE_STATE_MODE_RECEIVER_SPDIF:
-            lifecycle_mode_stop(state);
+            // Silence sleep parks the mode so waking does not pay for a full start
+            if (next_state == LIFECYCLE_STATE_SLEEPING && lifecycle_mode_suspend(state) == ESP_OK) {
+                s_parked_mode = state;
+                s_parked_stale = false;
+            } else {
+                lifecycle_mode_stop(state);
+            }
             break;
         case LIFECYCLE_STATE_SLEEPING:
             lifecycle_sleep_exit_silence_mode();
+            if (s_parked_mode != LIFECYCLE_STATE_SLEEPING && s_parked_mode != next_state) {
+                // Not waking into the parked mode: finish stopping it
+                lifecycle_mode_stop(s_parked_mode);
+                s_parked_mode = LIFECYCLE_STATE_SLEEPING;
+            }
             break;
         case LIFECYCLE_STATE_PAIRING:
             ESP_LOGI(TAG, "Exiting pairing mode");
@@ -145,10 +184,16 @@ static void set_state(lifecycle_state_t new_state) {
     if (s_current_state == new_state) {
         return;
     }
-    handle_state_exit(s_current_state);
-    ESP_LOGI(TAG, "LIFECYCLE: Transitioning from state %d to %d", s_current_state, new_state);
+    lifecycle_state_t old_state = s_current_state;
+    int64_t start_us = esp_timer_get_time();
+    handle_state_exit(old_state, new_state);
+    lifecycle_trace_add(LIFECYCLE_TRACE_EXIT, old_state, new_state, NULL, start_us, 0);
+
+    ESP_LOGI(TAG, "LIFECYCLE: Transitioning from state %d to %d", old_state, new_state);
     s_current_state = new_state;
-    handle_state_entry(s_current_state);
+    start_us = esp_timer_get_time();
+    handle_state_entry(new_state);
+    lifecycle_trace_add(LIFECYCLE_TRACE_ENTRY, new_state, old_state, NULL, start_us, 0);
 }
 
 /**
@@ -172,10 +217,10 @@ static void evaluate_and_transition(void) {
     wifi_manager_state_t wifi_state = wifi_manager_get_state();
     ESP_LOGI(TAG, "Current WiFi state: %d", wifi_state);
     
-    // Only transition to operational modes if WiFi is connected or we're in sender mode
-    if (wifi_state != WIFI_MANAGER_STATE_CONNECTED &&
+    // Only transition to operational modes if the network is up (Wi-Fi or Ethernet) or we're in sender mode
+    if (!net_iface_connected() &&
         (config->device_mode == MODE_RECEIVER_USB || config->device_mode == MODE_RECEIVER_SPDIF)) {
-        ESP_LOGI(TAG, "WiFi not connected and in receiver mode, staying in AWAITING_MODE_CONFIG");
+        ESP_LOGI(TAG, "No network connection and in receiver mode, staying in AWAITING_MODE_CONFIG");
         return;
     }
 
@@ -200,6 +245,34 @@ static void evaluate_and_transition(void) {
     }
 }
 
+/**
+ * Apply settings that are read at mode start: switch modes if the device
+ * mode changed, otherwise stop and start the current one around them
+ */
+static void restart_mode(void) {
+    static const lifecycle_state_t mode_states[] = {
+        [MODE_SENDER_USB] = LIFECYCLE_STATE_MODE_SENDER_USB,
+        [MODE_SENDER_SPDIF] = LIFECYCLE_STATE_MODE_SENDER_SPDIF,
+        [MODE_RECEIVER_USB] = LIFECYCLE_STATE_MODE_RECEIVER_USB,
+        [MODE_RECEIVER_SPDIF] = LIFECYCLE_STATE_MODE_RECEIVER_SPDIF,
+    };
+    lifecycle_state_t before = s_current_state;
+    evaluate_and_transition();
+    device_mode_t mode = config_manager_get_config()->device_mode;
+    if (s_current_state != before || (unsigned)mode >= sizeof(mode_states) / sizeof(mode_states[0]) ||
+        mode_states[mode] != before) {
+        // Switched, or the configured mode waits for the network
+        return;
+    }
+    ESP_LOGI(TAG, "Restarting mode %d for the new settings", before);
+    int64_t start_us = esp_timer_get_time();
+    handle_state_exit(before, before);
+    lifecycle_trace_add(LIFECYCLE_TRACE_EXIT, before, before, NULL, start_us, 0);
+    start_us = esp_timer_get_time();
+    handle_state_entry(before);
+    lifecycle_trace_add(LIFECYCLE_TRACE_ENTRY, before, before, NULL, start_us, 0);
+}
+
 /**
  * State event handlers
  */
@@ -279,7 +352,7 @@ static void handle_state_mode_sender_usb(lifecycle_event_t event) {
         // Only re-evaluate/restart if necessary
         if (restart_required) {
             ESP_LOGI(TAG, "Configuration changes require restart, re-evaluating state");
-            evaluate_and_transition();
+            restart_mode();
         } else {
             ESP_LOGI(TAG, "Configuration changes applied immediately without restart");
         }
@@ -300,7 +373,7 @@ static void handle_state_mode_sender_spdif(lifecycle_event_t event) {
         // Only re-evaluate/restart if necessary
         if (restart_required) {
             ESP_LOGI(TAG, "Configuration changes require restart, re-evaluating state");
-            evaluate_and_transition();
+            restart_mode();
         } else {
             ESP_LOGI(TAG, "Configuration changes applied immediately without restart");
         }
@@ -323,7 +396,7 @@ static void handle_state_mode_receiver_usb(lifecycle_event_t event) {
         // Only re-evaluate/restart if necessary
         if (restart_required) {
             ESP_LOGI(TAG, "Configuration changes require restart, re-evaluating state");
-            evaluate_and_transition();
+            restart_mode();
         } else {
             ESP_LOGI(TAG, "Configuration changes applied immediately without restart");
         }
@@ -348,7 +421,7 @@ static void handle_state_mode_receiver_spdif(lifecycle_event_t event) {
         // Only re-evaluate/restart if necessary
         if (restart_required) {
             ESP_LOGI(TAG, "Configuration changes require restart, re-evaluating state");
-            evaluate_and_transition();
+            restart_mode();
         } else {
             ESP_LOGI(TAG, "Configuration changes applied immediately without restart");
         }
@@ -365,7 +438,13 @@ static void handle_state_mode_receiver_spdif(lifecycle_event_t event) {
 static void handle_state_sleeping(lifecycle_event_t event) {
     ESP_LOGI(TAG, "LIFECYCLE: Handling state: SLEEPING");
     if (event == LIFECYCLE_EVENT_WAKE_UP) {
-        set_state(LIFECYCLE_STATE_AWAITING_MODE_CONFIG);
+        if (s_parked_mode != LIFECYCLE_STATE_SLEEPING && !s_parked_stale) {
+            set_state(s_parked_mode);
+        } else {
+            set_state(LIFECYCLE_STATE_AWAITING_MODE_CONFIG);
+        }
+    } else if (event == LIFECYCLE_EVENT_CONFIGURATION_CHANGED) {
+        s_parked_stale = true;
     }
 }
 
@@ -397,6 +476,12 @@ static void lifecycle_run_background_tasks(void) {
     mdns_discovery_tick();
     mdns_service_txt_update_tick();
     bq25895_integration_tick();
+    cpu_governor_tick();
+    task_stats_tick();
+    event_trace_tick();
+    rtp_sender_fanout_tick();
+    rtp_sender_auto_select_tick();
+    attach_wake_tick();
 }
 
 /**
@@ -409,8 +494,18 @@ static void lifecycle_manager_task(void *pvParameters) {
     set_state(LIFECYCLE_STATE_HW_INIT);
 
     while (1) {
-        lifecycle_event_t event;
-        if (xQueueReceive(s_lifecycle_event_queue, &event, pdMS_TO_TICKS(50)) == pdPASS) {
+        queued_event_t queued;
+        TickType_t tick_wait = pdMS_TO_TICKS(50);
+#ifdef CONFIG_RX_IDLE_LIGHT_SLEEP
+        if (s_current_state == LIFECYCLE_STATE_SLEEPING) {
+            // Background ticks at idle pace, so light sleep is not cut short every 50 ms
+            tick_wait = pdMS_TO_TICKS(CONFIG_RX_IDLE_BACKGROUND_TICK_MS);
+        }
+#endif
+        if (xQueueReceive(s_lifecycle_event_queue, &queued, tick_wait) == pdPASS) {
+            lifecycle_event_t event = queued.event;
+            lifecycle_state_t event_state = s_current_state;
+            int64_t start_us = esp_timer_get_time();
             ESP_LOGI(TAG, "LIFECYCLE: Received event %d in state %d", event, s_current_state);
             switch (s_current_state) {
                 case LIFECYCLE_STATE_INITIALIZING:
@@ -447,6 +542,8 @@ static void lifecycle_manager_task(void *pvParameters) {
                     handle_state_pairing(event);
                     break;
             }
+            lifecycle_trace_add(LIFECYCLE_TRACE_EVENT, event_state, event, NULL, start_us,
+                                (uint32_t)(start_us - queued.posted_us));
         }
 
         lifecycle_run_background_tasks();
@@ -458,7 +555,7 @@ static void lifecycle_manager_task(void *pvParameters) {
  */
 
 esp_err_t lifecycle_state_machine_init(void) {
-    s_lifecycle_event_queue = xQueueCreate(LIFECYCLE_EVENT_QUEUE_SIZE, sizeof(lifecycle_event_t));
+    s_lifecycle_event_queue = xQueueCreate(LIFECYCLE_EVENT_QUEUE_SIZE, sizeof(queued_event_t));
     if (s_lifecycle_event_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create lifecycle event queue");
         return ESP_FAIL;
@@ -479,7 +576,8 @@ esp_err_t lifecycle_state_machine_post_event(lifecycle_event_t event) {
         return ESP_FAIL;
     }
 
-    if (xQueueSend(s_lifecycle_event_queue, &event, 0) != pdPASS) {
+    queued_event_t queued = { .event = event, .posted_us = esp_timer_get_time() };
+    if (xQueueSend(s_lifecycle_event_queue, &queued, 0) != pdPASS) {
         ESP_LOGE(TAG, "Failed to post event to lifecycle queue");
         return ESP_FAIL;
     }
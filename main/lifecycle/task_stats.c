@@ -0,0 +1,125 @@
+#include "task_stats.h"
+#include "build_config.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include <string.h>
+
+#ifdef CONFIG_TASK_STATS
+// Walked by the lifecycle task only; readers see the published snapshot
+static TaskStatus_t s_status[TASK_STATS_MAX_TASKS];
+static struct {
+    TaskHandle_t handle;
+    uint32_t runtime;
+} s_prev[TASK_STATS_MAX_TASKS];
+static uint32_t s_prev_count = 0;
+static uint32_t s_prev_total = 0;
+static int64_t s_next_us = 0;
+static int64_t s_last_us = 0;
+
+static task_stats_snapshot_t s_snapshot;
+static bool s_have_snapshot = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint16_t share_permille(uint32_t part, uint32_t whole)
+{
+    uint32_t p = (uint32_t)(((uint64_t)part * 1000u + whole / 2) / whole);
+    return (uint16_t)(p > 1000u ? 1000u : p);
+}
+#endif
+
+void task_stats_tick(void)
+{
+#ifdef CONFIG_TASK_STATS
+    int64_t now = esp_timer_get_time();
+    if (now < s_next_us) {
+        return;
+    }
+    s_next_us = now + (int64_t)CONFIG_TASK_STATS_PERIOD_MS * 1000;
+
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(s_status, TASK_STATS_MAX_TASKS, &total);
+
+    // Built aside, published in one copy
+    static task_stats_snapshot_t snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.truncated = count == 0;
+    uint32_t dt = total - s_prev_total;
+    bool have_period = count > 0 && s_prev_total != 0 && dt != 0;
+    if (have_period) {
+        snap.period_ms = (uint32_t)((now - s_last_us) / 1000);
+    }
+
+    uint32_t idle_delta[SOC_CPU_CORES_NUM] = {0};
+    bool idle_seen[SOC_CPU_CORES_NUM] = {false};
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *st = &s_status[i];
+        uint32_t prev = st->ulRunTimeCounter;   // New task: no share until the next period
+        for (uint32_t j = 0; j < s_prev_count; j++) {
+            if (s_prev[j].handle == st->xHandle) {
+                prev = s_prev[j].runtime;
+                break;
+            }
+        }
+        uint32_t delta = st->ulRunTimeCounter - prev;
+
+        task_stats_task_t *t = &snap.tasks[i];
+        strlcpy(t->name, st->pcTaskName, sizeof(t->name));
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        t->core = st->xCoreID == tskNO_AFFINITY ? TASK_STATS_NO_CORE : (uint8_t)st->xCoreID;
+#else
+        t->core = TASK_STATS_NO_CORE;
+#endif
+        t->priority = (uint8_t)st->uxCurrentPriority;
+        t->load_permille = have_period ? share_permille(delta, dt) : 0;
+        t->stack_free_bytes = st->usStackHighWaterMark;     // StackType_t is a byte here
+
+        for (int c = 0; c < SOC_CPU_CORES_NUM; c++) {
+            if (st->xHandle == xTaskGetIdleTaskHandleForCore(c)) {
+                idle_delta[c] = delta;
+                idle_seen[c] = true;
+            }
+        }
+    }
+    snap.task_count = (uint8_t)count;
+
+    for (int c = 0; have_period && c < SOC_CPU_CORES_NUM; c++) {
+        // Each core's elapsed run time is the same dt; whatever its idle task did not use was load
+        snap.core_load_permille[c] = idle_seen[c] ? (uint16_t)(1000u - share_permille(idle_delta[c], dt)) : 0;
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        s_prev[i].handle = s_status[i].xHandle;
+        s_prev[i].runtime = s_status[i].ulRunTimeCounter;
+    }
+    if (count > 0) {
+        s_prev_count = count;
+        s_prev_total = total;
+        s_last_us = now;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_snapshot = snap;
+    s_have_snapshot = true;
+    portEXIT_CRITICAL(&s_lock);
+#endif
+}
+
+bool task_stats_get(task_stats_snapshot_t *out)
+{
+#ifdef CONFIG_TASK_STATS
+    if (!out) {
+        return false;
+    }
+    portENTER_CRITICAL(&s_lock);
+    bool have = s_have_snapshot;
+    if (have) {
+        *out = s_snapshot;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return have;
+#else
+    (void)out;
+    return false;
+#endif
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "soc/soc_caps.h"
+
+/**
+ * @file task_stats.h
+ * @brief Per-task CPU load and stack high-water marks
+ *
+ * Every CONFIG_TASK_STATS_PERIOD_MS the lifecycle task takes one
+ * uxTaskGetSystemState() pass and turns the run time counters into each
+ * task's share of one core over the period, each core's load (everything but
+ * its idle task) and each task's least free stack since it started. Readers
+ * (GET /api/tasks, the stats stream's cpu event) copy the last snapshot, so
+ * any number of them cost one walk of the task lists per period.
+ *
+ * Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS; without CONFIG_TASK_STATS
+ * task_stats_get() reports nothing.
+ */
+
+#define TASK_STATS_MAX_TASKS  32
+#define TASK_STATS_NO_CORE    0xFF   // Task not pinned (or core IDs not recorded)
+
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint8_t core;               // Affinity, or TASK_STATS_NO_CORE
+    uint8_t priority;           // Current (inherited) priority
+    uint16_t load_permille;     // Share of one core over the period
+    uint32_t stack_free_bytes;  // Least free stack seen
+} task_stats_task_t;
+
+typedef struct {
+    uint32_t period_ms;         // Time the loads cover; 0 until the second sample
+    uint16_t core_load_permille[SOC_CPU_CORES_NUM];
+    uint8_t task_count;
+    bool truncated;             // More tasks than TASK_STATS_MAX_TASKS; none listed
+    task_stats_task_t tasks[TASK_STATS_MAX_TASKS];
+} task_stats_snapshot_t;
+
+/**
+ * @brief Take a new snapshot when the period is up; lifecycle background tick
+ */
+void task_stats_tick(void);
+
+/**
+ * @brief Copy out the last snapshot
+ *
+ * @return false with CONFIG_TASK_STATS off or before the first snapshot
+ */
+bool task_stats_get(task_stats_snapshot_t *out);
@@ -0,0 +1,87 @@
+#include "trace.h"
+#include "lifecycle_internal.h"
+#include "../global.h"
+#include "freertos/FreeRTOS.h"
+
+static lifecycle_trace_record_t s_ring[CONFIG_LIFECYCLE_TRACE_DEPTH];
+static uint32_t s_next_seq = 0;     // Records ever written
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void lifecycle_trace_add(lifecycle_trace_kind_t kind, lifecycle_state_t state, uint8_t arg,
+                         const char *step, int64_t start_us, uint32_t wait_us)
+{
+    int64_t elapsed = esp_timer_get_time() - start_us;
+    lifecycle_trace_record_t rec = {
+        .start_us = start_us,
+        .duration_us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed,
+        .wait_us = wait_us,
+        .step = step,
+        .kind = (uint8_t)kind,
+        .state = (uint8_t)state,
+        .arg = arg,
+    };
+
+    portENTER_CRITICAL(&s_lock);
+    rec.seq = s_next_seq++;
+    s_ring[rec.seq % CONFIG_LIFECYCLE_TRACE_DEPTH] = rec;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void lifecycle_trace_step(const char *step, int64_t *lap_us)
+{
+    lifecycle_trace_add(LIFECYCLE_TRACE_STEP, lifecycle_get_current_state(), 0, step, *lap_us, 0);
+    *lap_us = esp_timer_get_time();
+}
+
+size_t lifecycle_trace_snapshot(lifecycle_trace_record_t *out, size_t max)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t total = s_next_seq;
+    uint32_t avail = total < CONFIG_LIFECYCLE_TRACE_DEPTH ? total : CONFIG_LIFECYCLE_TRACE_DEPTH;
+    size_t n = avail < max ? avail : max;
+    // The newest n, oldest first
+    for (size_t i = 0; i < n; i++) {
+        out[i] = s_ring[(total - n + i) % CONFIG_LIFECYCLE_TRACE_DEPTH];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+const char *lifecycle_trace_state_name(lifecycle_state_t state)
+{
+    switch (state) {
+        case LIFECYCLE_STATE_INITIALIZING:          return "INITIALIZING";
+        case LIFECYCLE_STATE_HW_INIT:               return "HW_INIT";
+        case LIFECYCLE_STATE_STARTING_SERVICES:     return "STARTING_SERVICES";
+        case LIFECYCLE_STATE_AWAITING_MODE_CONFIG:  return "AWAITING_MODE_CONFIG";
+        case LIFECYCLE_STATE_MODE_SENDER_USB:       return "MODE_SENDER_USB";
+        case LIFECYCLE_STATE_MODE_SENDER_SPDIF:     return "MODE_SENDER_SPDIF";
+        case LIFECYCLE_STATE_MODE_RECEIVER_USB:     return "MODE_RECEIVER_USB";
+        case LIFECYCLE_STATE_MODE_RECEIVER_SPDIF:   return "MODE_RECEIVER_SPDIF";
+        case LIFECYCLE_STATE_PAIRING:               return "PAIRING";
+        case LIFECYCLE_STATE_SLEEPING:              return "SLEEPING";
+        case LIFECYCLE_STATE_ERROR:                 return "ERROR";
+    }
+    return "UNKNOWN";
+}
+
+const char *lifecycle_trace_event_name(lifecycle_event_t event)
+{
+    switch (event) {
+        case LIFECYCLE_EVENT_WIFI_CONNECTED:        return "WIFI_CONNECTED";
+        case LIFECYCLE_EVENT_WIFI_DISCONNECTED:     return "WIFI_DISCONNECTED";
+        case LIFECYCLE_EVENT_USB_DAC_CONNECTED:     return "USB_DAC_CONNECTED";
+        case LIFECYCLE_EVENT_USB_DAC_DISCONNECTED:  return "USB_DAC_DISCONNECTED";
+        case LIFECYCLE_EVENT_CONFIGURATION_CHANGED: return "CONFIGURATION_CHANGED";
+        case LIFECYCLE_EVENT_ENTER_SLEEP:           return "ENTER_SLEEP";
+        case LIFECYCLE_EVENT_WAKE_UP:               return "WAKE_UP";
+        case LIFECYCLE_EVENT_START_PAIRING:         return "START_PAIRING";
+        case LIFECYCLE_EVENT_PAIRING_COMPLETE:      return "PAIRING_COMPLETE";
+        case LIFECYCLE_EVENT_CANCEL_PAIRING:        return "CANCEL_PAIRING";
+        case LIFECYCLE_EVENT_MDNS_DEVICE_FOUND:     return "MDNS_DEVICE_FOUND";
+        case LIFECYCLE_EVENT_MDNS_DEVICE_LOST:      return "MDNS_DEVICE_LOST";
+        case LIFECYCLE_EVENT_SAMPLE_RATE_CHANGE:    return "SAMPLE_RATE_CHANGE";
+        case LIFECYCLE_EVENT_SAP_STREAM_FOUND:      return "SAP_STREAM_FOUND";
+    }
+    return "UNKNOWN";
+}
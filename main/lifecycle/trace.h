@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_timer.h"
+#include "../lifecycle_manager.h"
+
+/**
+ * @file trace.h
+ * @brief Timing trace of the lifecycle state machine
+ * 
+ * A small ring of timestamped records: every event with the time it sat in
+ * the queue and the time its handler took, every state exit and entry, and
+ * the steps of each mode start. Records are written when the work finishes,
+ * so work nested inside an entry (HW_INIT entering STARTING_SERVICES, say)
+ * appears before the entry that contains it. Served at /api/lifecycle/trace.
+ */
+
+typedef enum {
+    LIFECYCLE_TRACE_EVENT = 0,  // arg: the event; wait_us: time queued
+    LIFECYCLE_TRACE_EXIT,       // arg: the state being entered next
+    LIFECYCLE_TRACE_ENTRY,      // arg: the state left
+    LIFECYCLE_TRACE_STEP,       // step: what ran, inside the current state
+} lifecycle_trace_kind_t;
+
+typedef struct {
+    uint32_t seq;
+    int64_t start_us;           // esp_timer time the work began
+    uint32_t duration_us;
+    uint32_t wait_us;
+    const char *step;           // Static string, steps only
+    uint8_t kind;               // lifecycle_trace_kind_t
+    uint8_t state;              // lifecycle_state_t it ran in
+    uint8_t arg;
+} lifecycle_trace_record_t;
+
+/**
+ * @brief Record finished work that began at start_us
+ */
+void lifecycle_trace_add(lifecycle_trace_kind_t kind, lifecycle_state_t state, uint8_t arg,
+                         const char *step, int64_t start_us, uint32_t wait_us);
+
+/**
+ * @brief Record a mode start step that ran since *lap_us, and restart the lap
+ * 
+ *   int64_t lap = esp_timer_get_time();
+ *   setup_audio();
+ *   lifecycle_trace_step("setup_audio", &lap);
+ */
+void lifecycle_trace_step(const char *step, int64_t *lap_us);
+
+/**
+ * @brief Copy out the ring, oldest first
+ * 
+ * @return Records copied (at most max)
+ */
+size_t lifecycle_trace_snapshot(lifecycle_trace_record_t *out, size_t max);
+
+const char *lifecycle_trace_state_name(lifecycle_state_t state);
+const char *lifecycle_trace_event_name(lifecycle_event_t event);
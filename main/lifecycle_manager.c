@@ -88,6 +88,14 @@ void lifecycle_manager_report_network_activity(void) {
     lifecycle_sleep_report_network_activity();
 }
 
+void lifecycle_manager_report_audio_peak(uint16_t peak) {
+    lifecycle_sleep_report_audio_peak(peak);
+}
+
+uint32_t lifecycle_manager_get_content_silence_ms(void) {
+    return lifecycle_sleep_get_content_silence_ms();
+}
+
 // All configuration getter/setter functions are implemented in lifecycle/config.c
 
 // SAP notification is delegated to lifecycle/sap.c
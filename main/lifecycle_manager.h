@@ -78,13 +78,30 @@ esp_err_t lifecycle_manager_change_sample_rate(uint32_t new_rate);
  * @param source_ip The source IP of the announcement
  * @param port The port number
  * @param sample_rate The sample rate
+ * @param bit_depth Sample width from the SDP rtpmap encoding (L16/L24/L32, 0 if unknown)
+ * @param channels Channel count from the SDP rtpmap encoding (0 if unknown)
+ * @param opus_pt Payload type when the rtpmap encoding is Opus (0 for linear PCM)
+ * @param ptime_ms Packet time from SDP a=ptime (0 if not announced)
+ * @param ptp_clock SDP a=ts-refclk names a PTP (IEEE 1588-2008) reference clock
+ * @param ptp_domain PTP domain from a=ts-refclk (SAP_PTP_DOMAIN_UNSET if not given)
+ * @param mediaclk_offset RTP timestamp at PTP time zero, from a=mediaclk:direct
+ * @param srtp_crypto SDES value from a=crypto, "" for a plain RTP/AVP stream, or NULL when
+ *                    the stream is SRTP but its keys are not announced (the configured ones stay)
  * @return ESP_OK on success, or an error code on failure.
  */
 esp_err_t lifecycle_manager_notify_sap_stream(const char* stream_name,
                                               const char* destination_ip,
                                               const char* source_ip,
                                               uint16_t port,
-                                              uint32_t sample_rate);
+                                              uint32_t sample_rate,
+                                              uint8_t bit_depth,
+                                              uint8_t channels,
+                                              uint8_t opus_pt,
+                                              uint8_t ptime_ms,
+                                              bool ptp_clock,
+                                              uint8_t ptp_domain,
+                                              uint32_t mediaclk_offset,
+                                              const char* srtp_crypto);
 
 /**
  * @brief Report network activity to the lifecycle manager.
@@ -94,6 +111,24 @@ esp_err_t lifecycle_manager_notify_sap_stream(const char* stream_name,
  */
 void lifecycle_manager_report_network_activity(void);
 
+/**
+ * @brief Report the peak level of a received audio packet.
+ *
+ * Called by the network input module for every packet, with the peak measured
+ * while converting it. Only packets above the silence amplitude threshold count
+ * as activity, so digital silence from a live sender still lets the device sleep.
+ *
+ * @param peak Largest |sample| in the packet, 16-bit full scale
+ */
+void lifecycle_manager_report_audio_peak(uint16_t peak);
+
+/**
+ * @brief Get how long received audio has stayed below the silence amplitude threshold.
+ *
+ * @return Milliseconds since the last audible packet
+ */
+uint32_t lifecycle_manager_get_content_silence_ms(void);
+
 // Configuration getter functions
 /**
  * @brief Get the configured port number
@@ -119,6 +154,37 @@ uint32_t lifecycle_get_sample_rate(void);
  */
 uint8_t lifecycle_get_bit_depth(void);
 
+/**
+ * @brief Get the channels per frame of the stream
+ * @return 2..PCM_CHANNELS_MAX
+ */
+uint8_t lifecycle_get_stream_channels(void);
+
+/**
+ * @brief Get the channel map: the stream channels played on the left and right outputs
+ * @return 0-based stream channel
+ */
+uint8_t lifecycle_get_channel_left(void);
+uint8_t lifecycle_get_channel_right(void);
+
+/**
+ * @brief Get the RTP packet time
+ * @return Packet time in ms (PCM_PTIME_MIN_MS..PCM_PTIME_MAX_MS)
+ */
+uint8_t lifecycle_get_ptime_ms(void);
+
+/**
+ * @brief Get the RTP payload type of an Opus stream
+ * @return Dynamic payload type (96-127), or 0 when streams are linear PCM
+ */
+uint8_t lifecycle_get_opus_pt(void);
+
+/**
+ * @brief Get the SRTP keys for the RTP media path
+ * @return SDES crypto value ("<suite> inline:<key||salt>"), or empty for plain RTP
+ */
+const char* lifecycle_get_srtp_crypto(void);
+
 /**
  * @brief Get the configured volume
  * @return The volume level
@@ -173,6 +239,48 @@ const char* lifecycle_get_sender_destination_ip(void);
  */
 uint16_t lifecycle_get_sender_destination_port(void);
 
+/**
+ * @brief Get the extra unicast destinations the sender fans out to
+ * @return Comma-separated IPv4 addresses (may be empty); sent on the destination port
+ */
+const char* lifecycle_get_sender_fanout_ips(void);
+
+/**
+ * @brief Get whether the sender also unicasts to every receiver found by mDNS discovery
+ * @return true if discovered receivers are added as fan-out destinations
+ */
+bool lifecycle_get_sender_fanout_mdns(void);
+
+/**
+ * @brief Get whether the sender sends Opus to its destination
+ * @return true for Opus to the destination, untagged fan-out addresses and mDNS receivers
+ */
+bool lifecycle_get_sender_opus(void);
+
+/**
+ * @brief Get the sender's Opus encoder complexity
+ * @return 0 (least CPU) to 10 (best quality)
+ */
+uint8_t lifecycle_get_sender_opus_complexity(void);
+
+/**
+ * @brief Get whether the S/PDIF sender also captures USB audio and sends the mix
+ * @return true to mix USB into the S/PDIF sender (CONFIG_SENDER_MIX_ENABLED)
+ */
+bool lifecycle_get_sender_mix_usb(void);
+
+/**
+ * @brief Get the mixing sender's gain for the S/PDIF input
+ * @return 0-100 percent
+ */
+uint8_t lifecycle_get_sender_mix_gain_spdif(void);
+
+/**
+ * @brief Get the mixing sender's gain for the USB input
+ * @return 0-100 percent
+ */
+uint8_t lifecycle_get_sender_mix_gain_usb(void);
+
 /**
  * @brief Get the initial buffer size
  * @return The initial buffer size
@@ -197,18 +305,60 @@ uint8_t lifecycle_get_buffer_grow_step_size(void);
  */
 uint8_t lifecycle_get_max_grow_size(void);
 
+/**
+ * @brief Get the time-based initial buffer target
+ * @return Target latency in ms, or 0 to use the initial buffer size in chunks
+ */
+uint16_t lifecycle_get_buffer_target_ms(void);
+
+/**
+ * @brief Get the time-based maximum buffer depth
+ * @return Ring depth in ms, or 0 to use the maximum buffer size in chunks
+ */
+uint16_t lifecycle_get_buffer_max_ms(void);
+
 /**
  * @brief Get the SPDIF data pin number
  * @return The SPDIF data pin number
  */
 uint8_t lifecycle_get_spdif_data_pin(void);
 
+/**
+ * @brief Get the playout EQ / crossover settings
+ * @return Pointer to the stored EQ configuration
+ */
+const eq_config_t* lifecycle_get_eq(void);
+
 /**
  * @brief Get whether to use direct write mode
  * @return true if direct write is enabled, false otherwise
  */
 bool lifecycle_get_use_direct_write(void);
 
+/**
+ * @brief Get whether low-latency playout is enabled
+ * @return true for 1-2 chunk buffering with late chunks dropped
+ */
+bool lifecycle_get_low_latency(void);
+
+/**
+ * @brief Get the audio pipeline topology
+ * @return A pipeline_topology_t: the core/priority preset of the audio tasks
+ */
+uint8_t lifecycle_get_pipeline_topology(void);
+
+/**
+ * @brief Get the ESP-NOW relay role
+ * @return An rtp_relay_role_t: off, forward the stream to peers, or listen to a forwarder
+ */
+uint8_t lifecycle_get_relay_role(void);
+
+/**
+ * @brief Get the ESP-NOW relay peers
+ * @return Comma-separated peer MAC addresses, empty for broadcast
+ */
+const char* lifecycle_get_relay_peers(void);
+
 /**
  * @brief Get the silence threshold in milliseconds
  * @return The silence threshold in ms
@@ -279,6 +429,49 @@ esp_err_t lifecycle_set_hostname(const char* hostname);
  */
 esp_err_t lifecycle_set_volume(float volume);
 
+/**
+ * @brief Set the RTP packet time
+ * @param ptime_ms Packet time in ms (PCM_PTIME_MIN_MS..PCM_PTIME_MAX_MS); applied on mode restart
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_ptime_ms(uint8_t ptime_ms);
+
+/**
+ * @brief Set the stream bit depth (L16/L24/L32)
+ * @param bit_depth 16, 24 or 32; applied on mode restart
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_bit_depth(uint8_t bit_depth);
+
+/**
+ * @brief Set the channels per frame of the stream
+ * @param channels 2..PCM_CHANNELS_MAX; applied on mode restart
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_stream_channels(uint8_t channels);
+
+/**
+ * @brief Set the channel map
+ * @param left Stream channel (0-based) for the left output
+ * @param right Stream channel (0-based) for the right output; applied on mode restart
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_channel_map(uint8_t left, uint8_t right);
+
+/**
+ * @brief Set the RTP payload type of an Opus stream
+ * @param opus_pt Dynamic payload type (96-127), or 0 for linear PCM; applied on mode restart
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_opus_pt(uint8_t opus_pt);
+
+/**
+ * @brief Set the SRTP keys for the RTP media path
+ * @param crypto SDES crypto value, or empty for plain RTP; applied on mode restart
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a malformed value
+ */
+esp_err_t lifecycle_set_srtp_crypto(const char* crypto);
+
 /**
  * @brief Set the device mode
  * @param mode The new device mode
@@ -363,6 +556,20 @@ esp_err_t lifecycle_set_buffer_grow_step_size(uint8_t size);
  */
 esp_err_t lifecycle_set_max_grow_size(uint8_t size);
 
+/**
+ * @brief Set the time-based initial buffer target
+ * @param ms Target latency in ms (0 = use the initial buffer size in chunks)
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_buffer_target_ms(uint16_t ms);
+
+/**
+ * @brief Set the time-based maximum buffer depth
+ * @param ms Ring depth in ms (0 = use the maximum buffer size in chunks)
+ * @return ESP_OK on success, or an error code on failure
+ */
+esp_err_t lifecycle_set_buffer_max_ms(uint16_t ms);
+
 /**
  * @brief Set the SPDIF data pin number
  * @param pin The new SPDIF data pin number
@@ -0,0 +1,171 @@
+#include "event_trace.h"
+#include "build_config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_event.h"
+#include "esp_wifi_types.h"
+#include "audio_arena.h"
+#include <string.h>
+
+#ifdef CONFIG_EVENT_TRACE
+event_trace_record_t event_trace_ring[CONFIG_EVENT_TRACE_DEPTH];
+uint32_t event_trace_written = 0;
+
+// Copy taken at the last freeze; behind s_frozen_mutex while it is being copied or read.
+// Read only after a glitch, so cold memory (PSRAM when present)
+static event_trace_record_t *s_frozen = NULL;
+static event_trace_header_t s_frozen_header;
+static bool s_have_frozen = false;
+static SemaphoreHandle_t s_frozen_mutex = NULL;
+
+// Trigger waiting for the tick to copy: claimed by the first freeze, ready once its fields
+// are written, both cleared by the copy
+static bool s_pending = false;
+static bool s_ready = false;
+static uint32_t s_trigger_seq = 0;
+static int64_t s_trigger_us = 0;
+static uint8_t s_trigger_type = EVENT_TRACE_NONE;
+static uint32_t s_freezes = 0;
+static bool s_wifi_hooked = false;
+
+void event_trace_freeze(event_trace_type_t type, uint16_t a16, int32_t value)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t seq = __atomic_fetch_add(&event_trace_written, 1, __ATOMIC_RELAXED);
+    event_trace_record_t *r = &event_trace_ring[seq & (CONFIG_EVENT_TRACE_DEPTH - 1)];
+    r->t_us = (uint32_t)now;
+    r->type = (uint8_t)type;
+    r->a8 = 0;
+    r->a16 = a16;
+    r->value = value;
+
+    bool idle = false;
+    if (__atomic_compare_exchange_n(&s_pending, &idle, true, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        s_trigger_seq = seq;
+        s_trigger_us = now;
+        s_trigger_type = (uint8_t)type;
+        __atomic_store_n(&s_ready, true, __ATOMIC_RELEASE);
+    }
+}
+
+// The newest records, oldest first; returns how many
+static uint32_t copy_ring(event_trace_record_t *out, uint32_t *first_seq)
+{
+    uint32_t total = __atomic_load_n(&event_trace_written, __ATOMIC_RELAXED);
+    uint32_t n = total < CONFIG_EVENT_TRACE_DEPTH ? total : CONFIG_EVENT_TRACE_DEPTH;
+    uint32_t start = total - n;
+    for (uint32_t k = 0; k < n; k++) {
+        out[k] = event_trace_ring[(start + k) & (CONFIG_EVENT_TRACE_DEPTH - 1)];
+    }
+    *first_seq = start;
+    return n;
+}
+
+static void fill_header(event_trace_header_t *h, uint32_t count)
+{
+    memset(h, 0, sizeof(*h));
+    h->magic = EVENT_TRACE_MAGIC;
+    h->version = EVENT_TRACE_VERSION;
+    h->record_size = sizeof(event_trace_record_t);
+    h->count = count;
+    h->captured_us = esp_timer_get_time();
+    h->freezes = s_freezes;
+    h->written = __atomic_load_n(&event_trace_written, __ATOMIC_RELAXED);
+}
+
+static void wifi_event_cb(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    (void)arg;
+    (void)base;
+    int32_t value = 0;
+    if (id == WIFI_EVENT_STA_DISCONNECTED && data) {
+        value = ((const wifi_event_sta_disconnected_t *)data)->reason;
+    } else if (id == WIFI_EVENT_STA_BSS_RSSI_LOW && data) {
+        value = ((const wifi_event_bss_rssi_low_t *)data)->rssi;
+    }
+    event_trace_add(EVENT_TRACE_WIFI, (uint8_t)id, 0, value);
+}
+#endif
+
+void event_trace_tick(void)
+{
+#ifdef CONFIG_EVENT_TRACE
+    if (!s_frozen) {
+        s_frozen = audio_arena_alloc_cold(sizeof(event_trace_record_t) * CONFIG_EVENT_TRACE_DEPTH);
+        if (!s_frozen) {
+            return;
+        }
+    }
+    if (!s_frozen_mutex) {
+        s_frozen_mutex = xSemaphoreCreateMutex();
+        if (!s_frozen_mutex) {
+            return;
+        }
+    }
+    if (!s_wifi_hooked) {
+        // The default event loop comes up with Wi-Fi; keep trying until it exists
+        s_wifi_hooked = esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_cb, NULL) == ESP_OK;
+    }
+
+    if (!__atomic_load_n(&s_ready, __ATOMIC_ACQUIRE) ||
+        esp_timer_get_time() - s_trigger_us < (int64_t)CONFIG_EVENT_TRACE_POST_MS * 1000) {
+        return;
+    }
+    // A download in progress keeps its copy; the trigger waits for the next tick
+    if (xSemaphoreTake(s_frozen_mutex, 0) != pdTRUE) {
+        return;
+    }
+    uint32_t first = 0;
+    uint32_t n = copy_ring(s_frozen, &first);
+    s_freezes++;
+    fill_header(&s_frozen_header, n);
+    s_frozen_header.trigger_type = s_trigger_type;
+    s_frozen_header.trigger_us = s_trigger_us;
+    // Overwritten already if more than a ring's worth followed it
+    int32_t at = (int32_t)(s_trigger_seq - first);
+    s_frozen_header.trigger_index = at > 0 ? (uint32_t)at : 0;
+    s_have_frozen = true;
+    __atomic_store_n(&s_ready, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_pending, false, __ATOMIC_RELEASE);
+    xSemaphoreGive(s_frozen_mutex);
+#endif
+}
+
+bool event_trace_read(bool live, event_trace_header_t *header, const event_trace_record_t **records,
+                      event_trace_record_t *live_buf)
+{
+#ifdef CONFIG_EVENT_TRACE
+    if (live) {
+        uint32_t first = 0;
+        uint32_t n = copy_ring(live_buf, &first);
+        fill_header(header, n);
+        *records = live_buf;
+        return true;
+    }
+    if (!s_frozen_mutex || xSemaphoreTake(s_frozen_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return false;
+    }
+    if (!s_have_frozen) {
+        xSemaphoreGive(s_frozen_mutex);
+        return false;
+    }
+    *header = s_frozen_header;
+    *records = s_frozen;
+    return true;    // Held until event_trace_release()
+#else
+    (void)live;
+    (void)header;
+    (void)records;
+    (void)live_buf;
+    return false;
+#endif
+}
+
+void event_trace_release(void)
+{
+#ifdef CONFIG_EVENT_TRACE
+    if (s_frozen_mutex) {
+        xSemaphoreGive(s_frozen_mutex);
+    }
+#endif
+}
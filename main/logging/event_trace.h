@@ -0,0 +1,142 @@
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+
+/*
+ * Glitch trace (CONFIG_EVENT_TRACE): an always-on ring of the last
+ * CONFIG_EVENT_TRACE_DEPTH binary events around the audio path.
+ *
+ * A record is 12 bytes: the low 32 bits of esp_timer time, a type and three
+ * type-specific arguments. Writers on either core claim a slot with one
+ * atomic add and fill it in place, so an event costs a timer read and a few
+ * stores; a reader copying the ring may see the record being written
+ * half-filled. Nothing is formatted on the device.
+ *
+ * An underrun or overflow in the jitter buffer freezes the ring: from the
+ * lifecycle background tick CONFIG_EVENT_TRACE_POST_MS later (so the
+ * recovery is in it too) the ring is copied aside, where it stays until the
+ * next freeze. GET /api/trace serves the frozen copy, ?live=1 the ring as it
+ * is now, as an event_trace_header_t followed by the records oldest first;
+ * decode_trace.py turns the file into text.
+ */
+
+typedef enum {
+    EVENT_TRACE_NONE = 0,
+    EVENT_TRACE_RX,         // RTP packet in; a16: sequence number, value: datagram bytes
+    EVENT_TRACE_PLAY,       // Chunk released to playout; a16: depth behind it, value: lateness us
+    EVENT_TRACE_CONCEAL,    // Missing chunk concealed; a16: depth, value: chunk sequence
+    EVENT_TRACE_UNDERRUN,   // Buffer ran dry; a16: new target depth
+    EVENT_TRACE_OVERFLOW,   // Chunk too far ahead; a16: depth, value: chunk sequence
+    EVENT_TRACE_RESYNC,     // Sequence jumped outside the window; ring re-anchored
+    EVENT_TRACE_PLL,        // RTCP PLL applied; value: error us, a16: |offset step| us (clamped)
+    EVENT_TRACE_STEER,      // Output clock retuned; value: ppb
+    EVENT_TRACE_OUT_WRITE,  // Chunk written to the outputs; a8: 1 on error, a16: bytes, value: us taken
+    EVENT_TRACE_WIFI,       // Wi-Fi event; a8: wifi_event_t, value: reason (disconnect) or RSSI
+    EVENT_TRACE_FLASH,      // Flash write; a8: event_trace_flash_t, value: us taken, a16: KiB
+    EVENT_TRACE_PAUSE,      // Buffer drained on digital silence (sender DTX), not an underrun; value: next sequence
+    EVENT_TRACE_TYPE_COUNT
+} event_trace_type_t;
+
+typedef enum {
+    EVENT_TRACE_FLASH_NVS = 0,
+    EVENT_TRACE_FLASH_OTA,
+} event_trace_flash_t;
+
+typedef struct {
+    uint32_t t_us;          // esp_timer_get_time(), low 32 bits
+    uint8_t type;           // event_trace_type_t
+    uint8_t a8;
+    uint16_t a16;
+    int32_t value;
+} event_trace_record_t;
+
+#define EVENT_TRACE_MAGIC   0x43525445u     // "ETRC" little endian
+#define EVENT_TRACE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t record_size;
+    uint8_t trigger_type;   // What froze it (EVENT_TRACE_NONE for the live ring)
+    uint8_t reserved;
+    uint32_t count;         // Records that follow
+    uint32_t trigger_index; // Record that froze it
+    int64_t trigger_us;     // esp_timer time of the trigger (full width)
+    int64_t captured_us;    // esp_timer time of the copy
+    uint32_t freezes;       // Freezes since boot
+    uint32_t written;       // Records written since boot
+} event_trace_header_t;
+
+#ifdef CONFIG_EVENT_TRACE
+_Static_assert((CONFIG_EVENT_TRACE_DEPTH & (CONFIG_EVENT_TRACE_DEPTH - 1)) == 0,
+               "CONFIG_EVENT_TRACE_DEPTH must be a power of two");
+
+extern event_trace_record_t event_trace_ring[CONFIG_EVENT_TRACE_DEPTH];
+extern uint32_t event_trace_written;
+
+static inline void event_trace_add(event_trace_type_t type, uint8_t a8, uint16_t a16, int32_t value)
+{
+    uint32_t i = __atomic_fetch_add(&event_trace_written, 1, __ATOMIC_RELAXED) & (CONFIG_EVENT_TRACE_DEPTH - 1);
+    event_trace_record_t *r = &event_trace_ring[i];
+    r->t_us = (uint32_t)esp_timer_get_time();
+    r->type = (uint8_t)type;
+    r->a8 = a8;
+    r->a16 = a16;
+    r->value = value;
+}
+
+/**
+ * @brief Record an event and freeze the ring around it
+ *
+ * A trigger while the last one is still waiting to be copied only records.
+ */
+void event_trace_freeze(event_trace_type_t type, uint16_t a16, int32_t value);
+#else
+static inline void event_trace_add(event_trace_type_t type, uint8_t a8, uint16_t a16, int32_t value)
+{
+    (void)type;
+    (void)a8;
+    (void)a16;
+    (void)value;
+}
+
+static inline void event_trace_freeze(event_trace_type_t type, uint16_t a16, int32_t value)
+{
+    (void)type;
+    (void)a16;
+    (void)value;
+}
+#endif
+
+// Clamp for the 16-bit argument
+static inline uint16_t event_trace_u16(int64_t v)
+{
+    return v < 0 ? 0 : v > UINT16_MAX ? UINT16_MAX : (uint16_t)v;
+}
+
+/**
+ * @brief Copy a pending freeze aside and hook Wi-Fi events; lifecycle background tick
+ */
+void event_trace_tick(void);
+
+/**
+ * @brief Fill a header and point at records for the frozen copy or the live ring
+ *
+ * The live ring is copied into the caller's buffer (CONFIG_EVENT_TRACE_DEPTH
+ * records); the frozen copy is pointed at directly and stays valid until
+ * event_trace_release().
+ *
+ * @return false if there is nothing (no freeze yet, or the trace is off)
+ */
+bool event_trace_read(bool live, event_trace_header_t *header, const event_trace_record_t **records,
+                      event_trace_record_t *live_buf);
+
+// End of a read of the frozen copy; a freeze is not copied over it while it is being read
+void event_trace_release(void);
+
+#endif // EVENT_TRACE_H
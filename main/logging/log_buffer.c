@@ -1,10 +1,17 @@
 #include "log_buffer.h"
+#include "build_config.h"
 #include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
 #include "esp_log.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_memory_utils.h"
+#include "audio_arena.h"
 
 // Ensure you have this defined in the header file (e.g., log_buffer.h)
 // #define LOG_LINE_MAX_LENGTH 256
@@ -12,6 +19,65 @@
 
 static const char *TAG = "log_buffer";
 
+#define LOG_RING_SIZE        CONFIG_LOG_BUFFER_RING_SIZE
+#define LOG_RING_MASK        (LOG_RING_SIZE - 1u)
+#define LOG_RECORD_MAX       (LOG_LINE_MAX_LENGTH + 64)   // Larger records fall back to text
+#define LOG_STR_ARG_MAX      96                           // Longest RAM string argument kept
+#define LOG_SPEC_MAX         24                           // Longest conversion spec formatted
+#define LOG_DRAIN_STACK      4096
+
+_Static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "CONFIG_LOG_BUFFER_RING_SIZE must be a power of two");
+_Static_assert(LOG_RING_SIZE >= 2 * LOG_RECORD_MAX, "CONFIG_LOG_BUFFER_RING_SIZE too small");
+
+// Record kinds; 0 until the writer commits, so a reserved record is never read early
+enum {
+    LOG_REC_PENDING = 0,
+    LOG_REC_PAD,      // Skip to the start of the ring
+    LOG_REC_BINARY,   // fmt plus encoded arguments
+    LOG_REC_TEXT,     // Preformatted, NUL-terminated
+};
+
+#define LOG_REC_ON_SERIAL   0x01    // Already printed (errors)
+#define LOG_REC_LEVEL_SHIFT 4
+
+// Argument classes; integers are stored as 8 bytes and passed back as their own type
+enum {
+    LOG_ARG_INT, LOG_ARG_LONG, LOG_ARG_LLONG, LOG_ARG_SIZE, LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE, LOG_ARG_LDOUBLE, LOG_ARG_PTR, LOG_ARG_STR,
+    LOG_ARG_COUNT,    // %n: consumed, never written
+    LOG_ARG_PERCENT,  // %%
+    LOG_ARG_BAD,
+};
+
+#define LOG_STR_INLINE 0    // uint16 length, then the bytes
+#define LOG_STR_FLASH  1    // Pointer into flash, valid forever
+
+typedef struct {
+    uint16_t len;         // Whole record, header included, multiple of 4
+    uint8_t kind;         // Stored last, with release ordering
+    uint8_t flags;        // Level << LOG_REC_LEVEL_SHIFT | LOG_REC_ON_SERIAL
+    uint32_t ts_us;       // esp_timer time (wraps after 71 minutes; compared as a difference)
+    const char *fmt;      // LOG_REC_BINARY only
+} log_rec_t;
+
+typedef struct {
+    uint8_t cls;
+    uint8_t stars;        // '*' width and precision ints before the value
+    uint8_t len;          // Spec length from '%' through the conversion
+} log_spec_t;
+
+// Multi-producer ring: writers reserve with a CAS on head; the (single, mutex-held)
+// consumer clears what it read before moving tail, so reserved space reads as pending
+typedef struct {
+    uint8_t buf[LOG_RING_SIZE] __attribute__((aligned(4)));
+    atomic_uint head;     // Bytes reserved, ever
+    atomic_uint tail;     // Bytes consumed, ever
+    atomic_uint dropped;  // Records that did not fit
+} log_ring_t;
+
+// One per core; cold (PSRAM when present), taken at init
+static log_ring_t *s_rings = NULL;
+
 // Global log buffer instance
 static log_buffer_t log_buffer = {
     .buffer = NULL,
@@ -19,22 +85,27 @@ static log_buffer_t log_buffer = {
     .head = 0,
     .tail = 0,
     .bytes_written = 0,
+    .stream_end = 0,
     .mutex = NULL,
     .initialized = false,
     .serial_output_enabled = true,
     .timestamps_enabled = false,
     .original_vprintf = NULL,
-    .min_level = ESP_LOG_INFO  // Default to INFO level
+    .min_level = ESP_LOG_INFO,  // Default to INFO level
+    .drain_task = NULL
 };
 
 // Static buffer allocation to avoid fragmentation
 static char *static_log_buffer;
+static uint32_t s_dropped_total = 0;
 
 // Forward declaration of custom vprintf handler
 static int log_buffer_vprintf(const char *fmt, va_list args);
+static void log_drain_task(void *arg);
+static void drain_locked(void);
 
 esp_err_t log_buffer_init(void) {
-    static_log_buffer = malloc(LOG_BUFFER_SIZE_DEFAULT);
+    static_log_buffer = audio_arena_alloc_cold(LOG_BUFFER_SIZE_DEFAULT);
     log_buffer_config_t config = {
         .buffer_size = LOG_BUFFER_SIZE_DEFAULT,
         .enable_serial_output = true,
@@ -61,11 +132,11 @@ esp_err_t log_buffer_init_with_config(const log_buffer_config_t *config) {
         return ESP_ERR_NO_MEM;
     }
 
-    if (config->buffer_size <= LOG_BUFFER_SIZE_DEFAULT) {
+    if (config->buffer_size <= LOG_BUFFER_SIZE_DEFAULT && static_log_buffer != NULL) {
         log_buffer.buffer = static_log_buffer;
         log_buffer.size = config->buffer_size;
     } else {
-        log_buffer.buffer = (char *)malloc(config->buffer_size);
+        log_buffer.buffer = (char *)audio_arena_alloc_cold(config->buffer_size);
         if (log_buffer.buffer == NULL) {
             vSemaphoreDelete(log_buffer.mutex);
             ESP_LOGE(TAG, "Failed to allocate buffer");
@@ -80,112 +151,608 @@ esp_err_t log_buffer_init_with_config(const log_buffer_config_t *config) {
     log_buffer.serial_output_enabled = config->enable_serial_output;
     log_buffer.timestamps_enabled = config->add_timestamps;
     log_buffer.min_level = config->min_level;
-    log_buffer.initialized = true;
+
+    if (!s_rings) {
+        s_rings = audio_arena_alloc_cold(sizeof(log_ring_t) * portNUM_PROCESSORS);
+    }
+    if (!s_rings) {
+        if (log_buffer.buffer != static_log_buffer) {
+            audio_arena_free(log_buffer.buffer);
+        }
+        log_buffer.buffer = NULL;
+        vSemaphoreDelete(log_buffer.mutex);
+        log_buffer.mutex = NULL;
+        ESP_LOGE(TAG, "Failed to allocate record rings");
+        return ESP_ERR_NO_MEM;
+    }
 
     memset(log_buffer.buffer, 0, log_buffer.size);
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        memset(s_rings[i].buf, 0, sizeof(s_rings[i].buf));
+        atomic_store(&s_rings[i].head, 0);
+        atomic_store(&s_rings[i].tail, 0);
+        atomic_store(&s_rings[i].dropped, 0);
+    }
+    s_dropped_total = 0;
+
+    if (xTaskCreate(log_drain_task, "log_drain", LOG_DRAIN_STACK, NULL,
+                    CONFIG_LOG_BUFFER_DRAIN_PRIORITY, &log_buffer.drain_task) != pdPASS) {
+        if (log_buffer.buffer != static_log_buffer) {
+            audio_arena_free(log_buffer.buffer);
+        }
+        log_buffer.buffer = NULL;
+        vSemaphoreDelete(log_buffer.mutex);
+        log_buffer.mutex = NULL;
+        ESP_LOGE(TAG, "Failed to create log drain task");
+        return ESP_ERR_NO_MEM;
+    }
 
+    log_buffer.initialized = true;
     log_buffer.original_vprintf = esp_log_set_vprintf(log_buffer_vprintf);
 
-    ESP_LOGI(TAG, "Log buffer initialized with %zu bytes", log_buffer.size);
+    ESP_LOGI(TAG, "Log buffer initialized with %zu bytes (%d x %d byte record rings)",
+             log_buffer.size, portNUM_PROCESSORS, LOG_RING_SIZE);
     return ESP_OK;
 }
 
-// Helper function to check if a log message should be captured based on level
-// This version checks the format string, which is more efficient.
-static bool should_capture_log(const char *fmt) {
-    if (!fmt) return true; // Capture if format is null
+// Level from the ESP-IDF prefix ("X (%lu) %s: ...", X = E/W/I/D/V); unprefixed output
+// counts as INFO
+static esp_log_level_t log_level_of(const char *fmt) {
+    if (!fmt || fmt[0] == '\0' || fmt[1] != ' ') {
+        return ESP_LOG_INFO;
+    }
+    switch (fmt[0]) {
+        case 'E': return ESP_LOG_ERROR;
+        case 'W': return ESP_LOG_WARN;
+        case 'I': return ESP_LOG_INFO;
+        case 'D': return ESP_LOG_DEBUG;
+        case 'V': return ESP_LOG_VERBOSE;
+        default:  return ESP_LOG_INFO;
+    }
+}
+
+// Parse one conversion; p points just past the '%'. Returns the class and the spec length.
+static void parse_spec(const char *p, log_spec_t *spec) {
+    const char *start = p - 1;
+    char lmod = 0;
+
+    spec->stars = 0;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        p++;
+    }
+    if (*p == '*') {
+        spec->stars++;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->stars++;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+    }
+    switch (*p) {
+        case 'h':
+            p++;
+            if (*p == 'h') {
+                p++;
+            }
+            break;
+        case 'l':
+            p++;
+            lmod = 'l';
+            if (*p == 'l') {
+                p++;
+                lmod = 'q';
+            }
+            break;
+        case 'j':
+        case 'q':
+            p++;
+            lmod = 'q';
+            break;
+        case 'z':
+        case 't':
+        case 'L':
+            lmod = *p++;
+            break;
+        default:
+            break;
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            spec->cls = lmod == 'q' ? LOG_ARG_LLONG :
+                        lmod == 'l' ? LOG_ARG_LONG :
+                        lmod == 'z' ? LOG_ARG_SIZE :
+                        lmod == 't' ? LOG_ARG_PTRDIFF : LOG_ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec->cls = lmod == 'L' ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+            break;
+        case 'p':
+            spec->cls = LOG_ARG_PTR;
+            break;
+        case 's':
+            spec->cls = LOG_ARG_STR;
+            break;
+        case 'n':
+            spec->cls = LOG_ARG_COUNT;
+            break;
+        case '%':
+            spec->cls = spec->stars ? LOG_ARG_BAD : LOG_ARG_PERCENT;
+            break;
+        default:
+            spec->cls = LOG_ARG_BAD;
+            break;
+    }
+    ptrdiff_t len = (*p ? p + 1 : p) - start;
+    if (spec->cls != LOG_ARG_PERCENT && len > LOG_SPEC_MAX - 1) {
+        spec->cls = LOG_ARG_BAD;
+    }
+    spec->len = (uint8_t)(len > 255 ? 255 : len);
+}
+
+static inline uint8_t *put(uint8_t *dst, const void *src, size_t n) {
+    memcpy(dst, src, n);
+    return dst + n;
+}
+
+// Encode the arguments after hdr; dst NULL only measures. Returns the payload size,
+// or -1 if the format has a conversion this encoder does not handle.
+static int encode_args(const char *fmt, va_list args, uint8_t *dst) {
+    size_t size = 0;
+    const char *p = fmt;
+    while ((p = strchr(p, '%')) != NULL) {
+        log_spec_t spec;
+        parse_spec(p + 1, &spec);
+        p += spec.len;
+        if (spec.cls == LOG_ARG_BAD) {
+            return -1;
+        }
+        for (int i = 0; i < spec.stars; i++) {
+            long long v = va_arg(args, int);
+            if (dst) dst = put(dst, &v, sizeof(v));
+            size += sizeof(v);
+        }
+        long long iv;
+        double dv;
+        switch (spec.cls) {
+            case LOG_ARG_INT:     iv = va_arg(args, int); goto put_int;
+            case LOG_ARG_LONG:    iv = va_arg(args, long); goto put_int;
+            case LOG_ARG_LLONG:   iv = va_arg(args, long long); goto put_int;
+            case LOG_ARG_SIZE:    iv = (long long)va_arg(args, size_t); goto put_int;
+            case LOG_ARG_PTRDIFF: iv = va_arg(args, ptrdiff_t); goto put_int;
+            case LOG_ARG_PTR:     iv = (long long)(uintptr_t)va_arg(args, void *);
+            put_int:
+                if (dst) dst = put(dst, &iv, sizeof(iv));
+                size += sizeof(iv);
+                break;
+            case LOG_ARG_DOUBLE:
+                dv = va_arg(args, double);
+                if (dst) dst = put(dst, &dv, sizeof(dv));
+                size += sizeof(dv);
+                break;
+            case LOG_ARG_LDOUBLE:
+                dv = (double)va_arg(args, long double);
+                if (dst) dst = put(dst, &dv, sizeof(dv));
+                size += sizeof(dv);
+                break;
+            case LOG_ARG_STR: {
+                const char *s = va_arg(args, const char *);
+                if (s == NULL || esp_ptr_in_drom(s)) {
+                    uint8_t tag = LOG_STR_FLASH;
+                    if (dst) {
+                        dst = put(dst, &tag, 1);
+                        dst = put(dst, &s, sizeof(s));
+                    }
+                    size += 1 + sizeof(s);
+                } else {
+                    uint8_t tag = LOG_STR_INLINE;
+                    uint16_t n = (uint16_t)strnlen(s, LOG_STR_ARG_MAX);
+                    if (dst) {
+                        dst = put(dst, &tag, 1);
+                        dst = put(dst, &n, sizeof(n));
+                        dst = put(dst, s, n);
+                    }
+                    size += 1 + sizeof(n) + n;
+                }
+                break;
+            }
+            case LOG_ARG_COUNT:
+                (void)va_arg(args, int *);
+                break;
+            default:
+                break;
+        }
+    }
+    return (int)size;
+}
 
-    // Check for ESP-IDF log level prefixes in the format string
-    // Format is typically: "X (%d) %s: " where X is E/W/I/D/V
-    if (fmt[0] == 'E' && fmt[1] == ' ') {
-        return ESP_LOG_ERROR >= log_buffer.min_level;
-    } else if (fmt[0] == 'W' && fmt[1] == ' ') {
-        return ESP_LOG_WARN >= log_buffer.min_level;
-    } else if (fmt[0] == 'I' && fmt[1] == ' ') {
-        return ESP_LOG_INFO >= log_buffer.min_level;
-    } else if (fmt[0] == 'D' && fmt[1] == ' ') {
-        return ESP_LOG_DEBUG >= log_buffer.min_level;
-    } else if (fmt[0] == 'V' && fmt[1] == ' ') {
-        return ESP_LOG_VERBOSE >= log_buffer.min_level;
+// Reserve len bytes (multiple of 4) in a ring; NULL when full. Never blocks.
+static log_rec_t *ring_reserve(log_ring_t *ring, uint32_t len) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;) {
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        uint32_t off = head & LOG_RING_MASK;
+        uint32_t pad = (off + len > LOG_RING_SIZE) ? LOG_RING_SIZE - off : 0;
+        if (head + pad + len - tail > LOG_RING_SIZE) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return NULL;
+        }
+        if (atomic_compare_exchange_weak_explicit(&ring->head, &head, head + pad + len,
+                                                  memory_order_acq_rel, memory_order_relaxed)) {
+            if (pad) {
+                log_rec_t *skip = (log_rec_t *)&ring->buf[off];
+                skip->len = (uint16_t)pad;
+                __atomic_store_n(&skip->kind, LOG_REC_PAD, __ATOMIC_RELEASE);
+                off = 0;
+            }
+            return (log_rec_t *)&ring->buf[off];
+        }
     }
+}
 
-    // If no recognized level prefix, capture it by default
-    return true;
+static inline void ring_commit(log_ring_t *ring, log_rec_t *rec, uint8_t kind) {
+    __atomic_store_n(&rec->kind, kind, __ATOMIC_RELEASE);
+    // Wake the drain early rather than drop under a burst
+    uint32_t used = atomic_load_explicit(&ring->head, memory_order_relaxed) -
+                    atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (used > LOG_RING_SIZE / 2 && log_buffer.drain_task && !xPortInIsrContext()) {
+        xTaskNotifyGive(log_buffer.drain_task);
+    }
 }
 
 static int log_buffer_vprintf(const char *fmt, va_list args) {
-    if (!log_buffer.initialized) {
+    if (!log_buffer.initialized || !fmt) {
         return 0;
     }
 
     int written = 0;
-    
-    // First, check if we should capture this log based on its format string
-    bool should_capture = should_capture_log(fmt);
+    esp_log_level_t level = log_level_of(fmt);
+    uint8_t flags = (uint8_t)(level << LOG_REC_LEVEL_SHIFT);
 
-    // Pass through to serial output if enabled. This uses the original vprintf correctly.
-    if (log_buffer.serial_output_enabled && log_buffer.original_vprintf) {
+    // Errors reach the console now: they are rare, and a crash may follow them
+    if (level == ESP_LOG_ERROR && log_buffer.serial_output_enabled && log_buffer.original_vprintf) {
         va_list args_copy;
         va_copy(args_copy, args);
         written = log_buffer.original_vprintf(fmt, args_copy);
         va_end(args_copy);
+        flags |= LOG_REC_ON_SERIAL;
+    }
+
+    log_ring_t *ring = &s_rings[xPortGetCoreID()];
+    uint32_t ts_us = (uint32_t)esp_timer_get_time();
+
+    // Binary record when the format lives in flash and every conversion is known
+    int payload = -1;
+    if (esp_ptr_in_drom(fmt)) {
+        va_list measure;
+        va_copy(measure, args);
+        payload = encode_args(fmt, measure, NULL);
+        va_end(measure);
+    }
+    if (payload >= 0 && sizeof(log_rec_t) + (size_t)payload <= LOG_RECORD_MAX) {
+        uint32_t len = (uint32_t)((sizeof(log_rec_t) + (size_t)payload + 3u) & ~3u);
+        log_rec_t *rec = ring_reserve(ring, len);
+        if (rec) {
+            rec->len = (uint16_t)len;
+            rec->flags = flags;
+            rec->ts_us = ts_us;
+            rec->fmt = fmt;
+            va_list encode;
+            va_copy(encode, args);
+            encode_args(fmt, encode, (uint8_t *)(rec + 1));
+            va_end(encode);
+            ring_commit(ring, rec, LOG_REC_BINARY);
+        }
+        return written > 0 ? written : (int)len;
     }
-    
-    // If we shouldn't capture it in our buffer, we're done.
-    if (!should_capture) {
+
+    // Fallback: format now, into a text record
+    va_list measure;
+    va_copy(measure, args);
+    int msg_len = vsnprintf(NULL, 0, fmt, measure);
+    va_end(measure);
+    if (msg_len < 0) {
         return written;
     }
-    
-    // Use a static buffer to format the message for the ring buffer, avoiding the stack.
-    static char log_line[LOG_LINE_MAX_LENGTH];
-    int len_for_buffer = 0;
-    
-    // Lock the mutex to protect the static log_line and the ring buffer
-    if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) != pdTRUE) {
-        return written; // Could not get mutex, bail out
+    if (msg_len > LOG_LINE_MAX_LENGTH - 1) {
+        msg_len = LOG_LINE_MAX_LENGTH - 1;
+    }
+    uint32_t len = (uint32_t)((sizeof(log_rec_t) + (size_t)msg_len + 1u + 3u) & ~3u);
+    log_rec_t *rec = ring_reserve(ring, len);
+    if (rec) {
+        rec->len = (uint16_t)len;
+        rec->flags = flags;
+        rec->ts_us = ts_us;
+        rec->fmt = NULL;
+        vsnprintf((char *)(rec + 1), (size_t)msg_len + 1u, fmt, args);
+        ring_commit(ring, rec, LOG_REC_TEXT);
+    }
+
+    // If serial was disabled, we return the length of the message that would have been written
+    return written > 0 ? written : msg_len;
+}
+
+// Oldest committed record of a ring, or NULL (empty, or its writer has not committed)
+static log_rec_t *ring_peek(log_ring_t *ring) {
+    for (;;) {
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == head) {
+            return NULL;
+        }
+        log_rec_t *rec = (log_rec_t *)&ring->buf[tail & LOG_RING_MASK];
+        uint8_t kind = __atomic_load_n(&rec->kind, __ATOMIC_ACQUIRE);
+        if (kind == LOG_REC_PENDING) {
+            return NULL;
+        }
+        if (kind != LOG_REC_PAD) {
+            return rec;
+        }
+        uint32_t len = rec->len;
+        memset(rec, 0, len);
+        atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+    }
+}
+
+// Hand a record's space back, zeroed so the next writer's record reads as pending
+static void ring_release(log_ring_t *ring, log_rec_t *rec) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t len = rec->len;
+    memset(rec, 0, len);
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+}
+
+static inline const uint8_t *get(void *dst, const uint8_t *src, size_t n) {
+    memcpy(dst, src, n);
+    return src + n;
+}
+
+// Format a binary record into out (always NUL-terminated); returns the length
+static size_t format_record(const log_rec_t *rec, char *out, size_t cap) {
+    if (rec->kind == LOG_REC_TEXT) {
+        size_t n = strnlen((const char *)(rec + 1), cap - 1);
+        memcpy(out, rec + 1, n);
+        out[n] = '\0';
+        return n;
+    }
+
+    const uint8_t *a = (const uint8_t *)(rec + 1);
+    const char *p = rec->fmt;
+    size_t pos = 0;
+    out[0] = '\0';
+    while (*p && pos < cap - 1) {
+        const char *pct = strchr(p, '%');
+        size_t lit = pct ? (size_t)(pct - p) : strlen(p);
+        if (lit > cap - 1 - pos) {
+            lit = cap - 1 - pos;
+        }
+        memcpy(out + pos, p, lit);
+        pos += lit;
+        out[pos] = '\0';
+        if (!pct || pos >= cap - 1) {
+            break;
+        }
+
+        log_spec_t spec;
+        parse_spec(pct + 1, &spec);
+        p = pct + spec.len;
+        if (spec.cls == LOG_ARG_PERCENT) {
+            out[pos++] = '%';
+            out[pos] = '\0';
+            continue;
+        }
+        if (spec.cls == LOG_ARG_COUNT) {
+            continue;
+        }
+
+        char sp[LOG_SPEC_MAX];
+        memcpy(sp, pct, spec.len);
+        sp[spec.len] = '\0';
+        int st[2] = {0, 0};
+        for (int i = 0; i < spec.stars; i++) {
+            long long v;
+            a = get(&v, a, sizeof(v));
+            st[i] = (int)v;
+        }
+
+        char *o = out + pos;
+        size_t room = cap - pos;
+        int n = 0;
+        long long iv = 0;
+        double dv = 0.0;
+        const char *sv = NULL;
+        char str_buf[LOG_STR_ARG_MAX + 1];
+        switch (spec.cls) {
+            case LOG_ARG_INT: case LOG_ARG_LONG: case LOG_ARG_LLONG:
+            case LOG_ARG_SIZE: case LOG_ARG_PTRDIFF: case LOG_ARG_PTR:
+                a = get(&iv, a, sizeof(iv));
+                break;
+            case LOG_ARG_DOUBLE: case LOG_ARG_LDOUBLE:
+                a = get(&dv, a, sizeof(dv));
+                break;
+            case LOG_ARG_STR: {
+                uint8_t tag;
+                a = get(&tag, a, 1);
+                if (tag == LOG_STR_FLASH) {
+                    a = get(&sv, a, sizeof(sv));
+                } else {
+                    uint16_t sn;
+                    a = get(&sn, a, sizeof(sn));
+                    memcpy(str_buf, a, sn);
+                    str_buf[sn] = '\0';
+                    a += sn;
+                    sv = str_buf;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+// One snprintf with the conversion's own argument type, after any '*' ints
+#define LOG_EMIT(val) \
+        (spec.stars == 0 ? snprintf(o, room, sp, val) : \
+         spec.stars == 1 ? snprintf(o, room, sp, st[0], val) : \
+                           snprintf(o, room, sp, st[0], st[1], val))
+        switch (spec.cls) {
+            case LOG_ARG_INT:     n = LOG_EMIT((int)iv); break;
+            case LOG_ARG_LONG:    n = LOG_EMIT((long)iv); break;
+            case LOG_ARG_LLONG:   n = LOG_EMIT(iv); break;
+            case LOG_ARG_SIZE:    n = LOG_EMIT((size_t)iv); break;
+            case LOG_ARG_PTRDIFF: n = LOG_EMIT((ptrdiff_t)iv); break;
+            case LOG_ARG_PTR:     n = LOG_EMIT((void *)(uintptr_t)iv); break;
+            case LOG_ARG_DOUBLE:  n = LOG_EMIT(dv); break;
+            case LOG_ARG_LDOUBLE: n = LOG_EMIT((long double)dv); break;
+            case LOG_ARG_STR:     n = LOG_EMIT(sv); break;
+            default: break;
+        }
+#undef LOG_EMIT
+        if (n > 0) {
+            pos += ((size_t)n < room) ? (size_t)n : room - 1;
+        }
+    }
+    return pos;
+}
+
+// Append text to the history ring (mutex held); the oldest bytes are overwritten
+static void history_append_locked(const char *data, size_t len) {
+    size_t size = log_buffer.size;
+    if (!log_buffer.buffer || size < 2 || len == 0) {
+        return;
+    }
+    log_buffer.bytes_written += len;
+    log_buffer.stream_end += len;
+    if (len > size - 1) {
+        data += len - (size - 1);
+        len = size - 1;
+    }
+    size_t used = (log_buffer.head + size - log_buffer.tail) % size;
+    size_t first = size - log_buffer.head;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(log_buffer.buffer + log_buffer.head, data, first);
+    memcpy(log_buffer.buffer, data + first, len - first);
+    log_buffer.head = (log_buffer.head + len) % size;
+    if (used + len > size - 1) {
+        log_buffer.tail = (log_buffer.head + 1) % size;
+    }
+}
+
+static int serial_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int n = log_buffer.original_vprintf ? log_buffer.original_vprintf(fmt, args) : 0;
+    va_end(args);
+    return n;
+}
+
+// Output one formatted line to the console and (at the capture level) the history
+static void emit_line(const char *line, size_t len, uint8_t flags, int64_t wall_us) {
+    if (log_buffer.serial_output_enabled && !(flags & LOG_REC_ON_SERIAL)) {
+        serial_printf("%.*s", (int)len, line);
+    }
+    esp_log_level_t level = (esp_log_level_t)(flags >> LOG_REC_LEVEL_SHIFT);
+    if (level > log_buffer.min_level) {
+        return;
     }
-    
-    // Add timestamp if enabled
     if (log_buffer.timestamps_enabled) {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
+        time_t sec = (time_t)(wall_us / 1000000);
         struct tm timeinfo;
-        localtime_r(&tv.tv_sec, &timeinfo);
-        
-        len_for_buffer = snprintf(log_line, sizeof(log_line),
-                                  "[%02d:%02d:%02d.%03ld] ",
-                                  timeinfo.tm_hour,
-                                  timeinfo.tm_min,
-                                  timeinfo.tm_sec,
-                                  tv.tv_usec / 1000);
-    }
-
-    // Format the actual log message into our static buffer
-    int msg_len = vsnprintf(log_line + len_for_buffer, sizeof(log_line) - len_for_buffer, fmt, args);
-    if (msg_len > 0) {
-        len_for_buffer += msg_len;
-    }
-
-    // Write the final formatted string to the ring buffer
-    if (len_for_buffer > 0) {
-        for (int i = 0; i < len_for_buffer; i++) {
-            log_buffer.buffer[log_buffer.head] = log_line[i];
-            log_buffer.head = (log_buffer.head + 1) % log_buffer.size;
-            
-            // Handle overflow by moving the tail forward
-            if (log_buffer.head == log_buffer.tail) {
-                log_buffer.tail = (log_buffer.tail + 1) % log_buffer.size;
+        localtime_r(&sec, &timeinfo);
+        char stamp[20];
+        int n = snprintf(stamp, sizeof(stamp), "[%02d:%02d:%02d.%03ld] ",
+                         timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
+                         (long)((wall_us % 1000000) / 1000));
+        if (n > 0) {
+            history_append_locked(stamp, (size_t)n);
+        }
+    }
+    history_append_locked(line, len);
+}
+
+// Format and hand on every committed record, oldest first across the cores' rings.
+// Caller holds log_buffer.mutex, which makes it the only consumer.
+static void drain_locked(void) {
+    char line[LOG_LINE_MAX_LENGTH];
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t wall_now = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+    uint32_t mono_now = (uint32_t)esp_timer_get_time();
+
+    for (;;) {
+        log_ring_t *ring = NULL;
+        log_rec_t *rec = NULL;
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            log_rec_t *r = ring_peek(&s_rings[i]);
+            if (r && (!rec || (int32_t)(r->ts_us - rec->ts_us) < 0)) {
+                rec = r;
+                ring = &s_rings[i];
             }
         }
-        log_buffer.bytes_written += len_for_buffer;
+        if (!rec) {
+            break;
+        }
+        size_t len = format_record(rec, line, sizeof(line));
+        uint8_t flags = rec->flags;
+        int64_t wall_us = wall_now - (int64_t)(uint32_t)(mono_now - rec->ts_us);
+        ring_release(ring, rec);
+        emit_line(line, len, flags, wall_us);
+    }
+
+    uint32_t dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        dropped += atomic_exchange_explicit(&s_rings[i].dropped, 0, memory_order_relaxed);
+    }
+    if (dropped) {
+        s_dropped_total += dropped;
+        int n = snprintf(line, sizeof(line), "W (%lu) %s: %lu log messages dropped (ring full)\n",
+                         (unsigned long)esp_log_timestamp(), TAG, (unsigned long)dropped);
+        if (n > 0) {
+            emit_line(line, (size_t)n, (uint8_t)(ESP_LOG_WARN << LOG_REC_LEVEL_SHIFT), wall_now);
+        }
     }
+}
 
-    xSemaphoreGive(log_buffer.mutex);
+static void log_drain_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_LOG_BUFFER_DRAIN_INTERVAL_MS));
+        if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
+            drain_locked();
+            xSemaphoreGive(log_buffer.mutex);
+        }
+    }
+}
 
-    // If serial was disabled, we return the length of the message that would have been written
-    return written > 0 ? written : msg_len;
+void log_buffer_flush(void) {
+    if (!log_buffer.initialized) {
+        return;
+    }
+    if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
+        drain_locked();
+        xSemaphoreGive(log_buffer.mutex);
+    }
 }
 
+uint32_t log_buffer_get_dropped(void) {
+    uint32_t dropped = s_dropped_total;
+    for (int i = 0; s_rings && i < portNUM_PROCESSORS; i++) {
+        dropped += atomic_load_explicit(&s_rings[i].dropped, memory_order_relaxed);
+    }
+    return dropped;
+}
 
 size_t log_buffer_write(const char *data, size_t len) {
     if (!log_buffer.initialized || !data || len == 0) {
@@ -196,22 +763,25 @@ size_t log_buffer_write(const char *data, size_t len) {
         return 0;
     }
 
-    size_t written = 0;
-    
-    for (size_t i = 0; i < len; i++) {
-        log_buffer.buffer[log_buffer.head] = data[i];
-        log_buffer.head = (log_buffer.head + 1) % log_buffer.size;
-        
-        if (log_buffer.head == log_buffer.tail) {
-            log_buffer.tail = (log_buffer.tail + 1) % log_buffer.size;
-        }
-        
-        written++;
-        log_buffer.bytes_written++;
-    }
+    drain_locked();
+    history_append_locked(data, len);
 
     xSemaphoreGive(log_buffer.mutex);
-    return written;
+    return len;
+}
+
+// Copy from the history ring starting at tail, up to max_len bytes; returns the count
+static size_t history_copy_locked(size_t from, char *dest, size_t max_len) {
+    size_t size = log_buffer.size;
+    size_t available = (log_buffer.head + size - from) % size;
+    size_t n = available < max_len ? available : max_len;
+    size_t first = size - from;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(dest, log_buffer.buffer + from, first);
+    memcpy(dest + first, log_buffer.buffer, n - first);
+    return n;
 }
 
 size_t log_buffer_read(char *dest, size_t max_len) {
@@ -223,13 +793,9 @@ size_t log_buffer_read(char *dest, size_t max_len) {
         return 0;
     }
 
-    size_t read = 0;
-    
-    while (log_buffer.tail != log_buffer.head && read < max_len) {
-        dest[read] = log_buffer.buffer[log_buffer.tail];
-        log_buffer.tail = (log_buffer.tail + 1) % log_buffer.size;
-        read++;
-    }
+    drain_locked();
+    size_t read = history_copy_locked(log_buffer.tail, dest, max_len);
+    log_buffer.tail = (log_buffer.tail + read) % log_buffer.size;
 
     xSemaphoreGive(log_buffer.mutex);
     return read;
@@ -244,14 +810,8 @@ size_t log_buffer_peek(char *dest, size_t max_len) {
         return 0;
     }
 
-    size_t read = 0;
-    size_t temp_tail = log_buffer.tail;
-    
-    while (temp_tail != log_buffer.head && read < max_len) {
-        dest[read] = log_buffer.buffer[temp_tail];
-        temp_tail = (temp_tail + 1) % log_buffer.size;
-        read++;
-    }
+    drain_locked();
+    size_t read = history_copy_locked(log_buffer.tail, dest, max_len);
 
     xSemaphoreGive(log_buffer.mutex);
     return read;
@@ -266,12 +826,8 @@ size_t log_buffer_peek_latest(char *dest, size_t max_len) {
         return 0;
     }
 
-    size_t available = 0;
-    if (log_buffer.head >= log_buffer.tail) {
-        available = log_buffer.head - log_buffer.tail;
-    } else {
-        available = log_buffer.size - log_buffer.tail + log_buffer.head;
-    }
+    drain_locked();
+    size_t available = (log_buffer.head + log_buffer.size - log_buffer.tail) % log_buffer.size;
 
     // If we have more data than requested, start from a later position
     size_t start_offset = 0;
@@ -279,26 +835,57 @@ size_t log_buffer_peek_latest(char *dest, size_t max_len) {
         start_offset = available - max_len;
     }
 
-    // Calculate the starting position
-    size_t temp_tail = (log_buffer.tail + start_offset) % log_buffer.size;
+    size_t read = history_copy_locked((log_buffer.tail + start_offset) % log_buffer.size, dest, max_len);
 
-    size_t read = 0;
-    while (temp_tail != log_buffer.head && read < max_len) {
-        dest[read] = log_buffer.buffer[temp_tail];
-        temp_tail = (temp_tail + 1) % log_buffer.size;
-        read++;
+    xSemaphoreGive(log_buffer.mutex);
+    return read;
+}
+
+size_t log_buffer_read_from(uint64_t *cursor, char *dest, size_t max_len) {
+    if (!log_buffer.initialized || !cursor || !dest || max_len == 0) {
+        return 0;
+    }
+
+    if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+
+    drain_locked();
+    size_t used = (log_buffer.head + log_buffer.size - log_buffer.tail) % log_buffer.size;
+    uint64_t oldest = log_buffer.stream_end - used;
+    if (*cursor < oldest || *cursor > log_buffer.stream_end) {
+        *cursor = oldest;
     }
+    size_t skip = (size_t)(*cursor - oldest);
+    size_t read = history_copy_locked((log_buffer.tail + skip) % log_buffer.size, dest, max_len);
+    *cursor += read;
 
     xSemaphoreGive(log_buffer.mutex);
     return read;
 }
 
+uint64_t log_buffer_get_cursor(void) {
+    if (!log_buffer.initialized) {
+        return 0;
+    }
+
+    uint64_t cursor = 0;
+    if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
+        drain_locked();
+        cursor = log_buffer.stream_end;
+        xSemaphoreGive(log_buffer.mutex);
+    }
+    return cursor;
+}
+
 void log_buffer_clear(void) {
     if (!log_buffer.initialized) {
         return;
     }
 
     if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
+        // Pending records go to the console first, then the history is dropped with them
+        drain_locked();
         log_buffer.head = 0;
         log_buffer.tail = 0;
         log_buffer.bytes_written = 0;
@@ -314,11 +901,8 @@ size_t log_buffer_get_used(void) {
 
     size_t used = 0;
     if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
-        if (log_buffer.head >= log_buffer.tail) {
-            used = log_buffer.head - log_buffer.tail;
-        } else {
-            used = log_buffer.size - log_buffer.tail + log_buffer.head;
-        }
+        drain_locked();
+        used = (log_buffer.head + log_buffer.size - log_buffer.tail) % log_buffer.size;
         xSemaphoreGive(log_buffer.mutex);
     }
     return used;
@@ -352,17 +936,17 @@ esp_err_t log_buffer_set_min_level(esp_log_level_t level) {
     if (!log_buffer.initialized) {
         return ESP_ERR_INVALID_STATE;
     }
-    
+
     if (level > ESP_LOG_VERBOSE) { // ESP_LOG_NONE is 0
         return ESP_ERR_INVALID_ARG;
     }
-    
+
     if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
         log_buffer.min_level = level;
         xSemaphoreGive(log_buffer.mutex);
         return ESP_OK;
     }
-    
+
     return ESP_ERR_TIMEOUT;
 }
 
@@ -370,23 +954,22 @@ esp_log_level_t log_buffer_get_min_level(void) {
     if (!log_buffer.initialized) {
         return ESP_LOG_INFO;
     }
-    
+
     esp_log_level_t level = ESP_LOG_INFO;
     if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
         level = log_buffer.min_level;
         xSemaphoreGive(log_buffer.mutex);
     }
-    
+
     return level;
 }
 
 void log_buffer_deinit(void) {
-    if (static_log_buffer) {
-        free(static_log_buffer);
-        static_log_buffer = NULL;
-    }
-
     if (!log_buffer.initialized) {
+        if (static_log_buffer) {
+            free(static_log_buffer);
+            static_log_buffer = NULL;
+        }
         return;
     }
 
@@ -394,14 +977,28 @@ void log_buffer_deinit(void) {
         esp_log_set_vprintf(log_buffer.original_vprintf);
     }
 
+    // Nothing new arrives now; hand the console what is left
+    if (xSemaphoreTake(log_buffer.mutex, portMAX_DELAY) == pdTRUE) {
+        drain_locked();
+        if (log_buffer.drain_task) {
+            vTaskDelete(log_buffer.drain_task);
+            log_buffer.drain_task = NULL;
+        }
+        xSemaphoreGive(log_buffer.mutex);
+    }
+
     if (log_buffer.mutex) {
         vSemaphoreDelete(log_buffer.mutex);
     }
 
     if (log_buffer.buffer != static_log_buffer && log_buffer.buffer != NULL) {
-        free(log_buffer.buffer);
+        audio_arena_free(log_buffer.buffer);
+    }
+    if (static_log_buffer) {
+        audio_arena_free(static_log_buffer);
+        static_log_buffer = NULL;
     }
 
     // Reset all fields
     memset(&log_buffer, 0, sizeof(log_buffer));
-}
\ No newline at end of file
+}
@@ -6,8 +6,29 @@
 #include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
 
+/*
+ * Log capture with deferred formatting.
+ *
+ * The esp_log vprintf hook does not format. It stores the format pointer, a
+ * timestamp and the raw arguments as a binary record in a lock-free ring for
+ * the calling core. A string argument in flash is kept as a pointer and one in
+ * RAM is copied. A writer reserves its record with one compare-and-swap and
+ * never waits, so logging from an audio task costs a copy, not a vsnprintf.
+ * A task blocked behind the web server can no longer hold it up either.
+ *
+ * A low-priority drain task (or a reader, before it reads) merges the rings in
+ * time order and formats each record once. The text goes to the console, if
+ * serial output is on, and to the text history ring that the read functions
+ * below serve. The history ring and its mutex belong to consumers only.
+ *
+ * Errors are also printed to the console at once, so the lines before a crash
+ * are not left in a ring. A format string outside flash (rare) is formatted
+ * straight into a text record instead.
+ */
+
 #define LOG_BUFFER_SIZE_DEFAULT (1024) // 4KB
 #define LOG_LINE_MAX_LENGTH 256
 
@@ -24,12 +45,14 @@ typedef struct {
     size_t head;                  // Write position
     size_t tail;                  // Read position
     size_t bytes_written;         // Total bytes written (for overflow detection)
-    SemaphoreHandle_t mutex;      // Mutex for thread-safe access
+    uint64_t stream_end;          // Bytes appended since boot; cursor of the newest byte + 1
+    SemaphoreHandle_t mutex;      // Consumers only: history ring and draining the record rings
     bool initialized;             // Initialization flag
     bool serial_output_enabled;   // Whether to continue serial output
     bool timestamps_enabled;      // Whether to add timestamps
     vprintf_like_t original_vprintf; // Original vprintf handler
     esp_log_level_t min_level;    // Minimum log level to capture
+    TaskHandle_t drain_task;      // Formats records for the console and history
 } log_buffer_t;
 
 // Initialize the log buffer system with default configuration
@@ -54,6 +77,21 @@ size_t log_buffer_peek_latest(char *dest, size_t max_len);
 // Clear the log buffer
 void log_buffer_clear(void);
 
+// Copy history from an absolute stream offset (see log_buffer_get_cursor) and
+// advance *cursor past the bytes copied. A cursor that is older than the history
+// (overwritten, cleared) or newer than it (from before a reboot) restarts at the
+// oldest byte still held. Returns the number of bytes copied.
+size_t log_buffer_read_from(uint64_t *cursor, char *dest, size_t max_len);
+
+// Stream offset just past the newest byte in the history
+uint64_t log_buffer_get_cursor(void);
+
+// Format every pending record now (e.g. before a restart)
+void log_buffer_flush(void);
+
+// Messages dropped because their core's record ring was full
+uint32_t log_buffer_get_dropped(void);
+
 // Get the number of bytes currently in the buffer
 size_t log_buffer_get_used(void);
 
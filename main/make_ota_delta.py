@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+Build a compressed OTA delta for the ESP32 RTP firmware
+
+    make_ota_delta.py <old.bin> <new.bin> <out.delta.gz> [--no-gzip]
+
+<old.bin> must be the exact image the devices run: the patch carries its
+CRC-32 and the firmware refuses it against anything else. The output is the
+"EDP1" patch format of ota/ota_decode.h (bsdiff control tuples, interleaved
+so the device applies it in one pass), gzipped so the mostly-zero diff bytes
+cost almost nothing. Upload it like a normal .bin; a plain gzipped image
+(gzip -9 firmware.bin) is accepted the same way.
+"""
+
+import gzip
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+MAGIC = b'EDP1'
+WINDOW = 32        # Bytes hashed to find a match
+INDEX_STEP = 4     # Old image offsets indexed
+MAX_FUZZ = 64      # Give up extending a fuzzy match this far past its last gain
+
+
+def build_index(old):
+    index = {}
+    for i in range(0, len(old) - WINDOW + 1, INDEX_STEP):
+        index.setdefault(old[i:i + WINDOW], i)
+    return index
+
+
+def extend(old, new, op, np):
+    """Length of the run from (op, np), allowing mismatches while >50% match"""
+    limit = min(len(old) - op, len(new) - np)
+    score = best_score = best_len = 0
+    for i in range(limit):
+        if old[op + i] == new[np + i]:
+            score += 1
+            if score * 2 - (i + 1) > best_score * 2 - best_len:
+                best_score, best_len = score, i + 1
+        elif i - best_len > MAX_FUZZ:
+            break
+    return best_len
+
+
+def find_matches(old, new):
+    """Yield (new_start, old_start, length) in new order, not overlapping"""
+    index = build_index(old)
+    np = 0
+    last_end = 0
+    while np + WINDOW <= len(new):
+        op = index.get(new[np:np + WINDOW])
+        if op is None:
+            np += 1
+            continue
+        # Grow backwards into the unmatched gap, then forwards
+        back = 0
+        while np - back > last_end and op - back > 0 and new[np - back - 1] == old[op - back - 1]:
+            back += 1
+        start_new, start_old = np - back, op - back
+        length = extend(old, new, start_old, start_new)
+        yield start_new, start_old, length
+        np = last_end = start_new + length
+
+
+def make_delta(old, new):
+    out = bytearray(MAGIC)
+    out += struct.pack('<III', len(old), zlib.crc32(old) & 0xFFFFFFFF, len(new))
+
+    # Each record: diff for the previous match, then the literal gap to the
+    # next, then the seek from the previous match end to the next match start
+    prev_new = prev_old = prev_len = 0
+    matched = 0
+    for start_new, start_old, length in list(find_matches(old, new)) + [(len(new), None, 0)]:
+        diff = bytes((new[prev_new + i] - old[prev_old + i]) & 0xFF for i in range(prev_len))
+        extra = new[prev_new + prev_len:start_new]
+        src_end = prev_old + prev_len
+        seek = (start_old - src_end) if start_old is not None else 0
+        out += struct.pack('<IIi', prev_len, len(extra), seek)
+        out += diff
+        out += extra
+        matched += prev_len
+        prev_new, prev_old, prev_len = start_new, start_old or 0, length
+    return bytes(out), matched
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith('--')]
+    if len(args) != 3:
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+    old = Path(args[0]).read_bytes()
+    new = Path(args[1]).read_bytes()
+    if not new or new[0] != 0xE9:
+        print(f"Error: {args[1]} is not an app image", file=sys.stderr)
+        return 1
+
+    patch, matched = make_delta(old, new)
+    if '--no-gzip' not in sys.argv:
+        patch = gzip.compress(patch, compresslevel=9, mtime=0)
+    Path(args[2]).write_bytes(patch)
+
+    print(f"{args[2]}: {len(patch)} bytes for a {len(new)} byte image "
+          f"({100 * matched // max(len(new), 1)}% from the old image, "
+          f"{100 * len(patch) // max(len(new), 1)}% of full size)")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -3,6 +3,7 @@
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "mdns.h"
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include "freertos/FreeRTOS.h"
@@ -16,130 +17,184 @@ static const char *TAG = "mdns_discovery";
 #define MDNS_QUERY_TIMEOUT_MS 3000
 #define MDNS_MAX_RESULTS 10
 
-// Discovery runtime state
+// Devices expire at their record TTL, capped so one that vanishes without a
+// goodbye drops out as quickly as it used to
+#define DEVICE_MAX_LIFETIME_SEC 120
+// A device is re-queried once this share of its lifetime has passed
+#define DEVICE_REFRESH_PCT 80
+// With nothing found, ask again this often in case an announcement was lost
+#define IDLE_QUERY_INTERVAL_SEC 60
+
+// Browse state: the mDNS task adds, refreshes and removes devices as
+// answers and goodbyes arrive; the tick only expires them and, when one is
+// due, sends a single non-blocking refresh query
 static SemaphoreHandle_t s_device_mutex = NULL;
 static discovered_device_t s_devices[MAX_DISCOVERED_DEVICES];
+static time_t s_expires_at[MAX_DISCOVERED_DEVICES];
+static time_t s_refresh_at[MAX_DISCOVERED_DEVICES];
 static size_t s_device_count = 0;
 static volatile bool s_task_running = false;
-static bool s_runtime_initialized = false;
+static mdns_browse_t *s_browse = NULL;
+static mdns_search_once_t *s_refresh_query = NULL;
 static time_t s_last_query_time = 0;
-static time_t s_last_cleanup_time = 0;
 static time_t s_last_heartbeat_time = 0;
 
-// Helper function to remove stale devices (older than 2 minutes)
-static void remove_stale_devices(void) {
-    time_t current_time = time(NULL);
-    const int STALE_TIMEOUT = 120; // 2 minutes in seconds
-
-    size_t initial_count = s_device_count;
-    size_t write_idx = 0;
-    for (size_t read_idx = 0; read_idx < s_device_count; read_idx++) {
-        if ((current_time - s_devices[read_idx].last_seen) < STALE_TIMEOUT) {
-            // Device is not stale, keep it
-            if (write_idx != read_idx) {
-                s_devices[write_idx] = s_devices[read_idx];
-            }
-            write_idx++;
-        } else {
-            ESP_LOGD(TAG, "Removing stale device: %s (%s) - last seen %d seconds ago",
-                     s_devices[read_idx].hostname,
-                     inet_ntoa(s_devices[read_idx].ip_addr),
-                     (int)(current_time - s_devices[read_idx].last_seen));
-        }
+// Drop device i; the caller holds the mutex
+static void remove_device_locked(size_t i) {
+    ESP_LOGI(TAG, "Device gone: %s (%s)", s_devices[i].hostname, inet_ntoa(s_devices[i].ip_addr));
+    s_device_count--;
+    if (i != s_device_count) {
+        s_devices[i] = s_devices[s_device_count];
+        s_expires_at[i] = s_expires_at[s_device_count];
+        s_refresh_at[i] = s_refresh_at[s_device_count];
     }
-    s_device_count = write_idx;
+}
 
-    if (initial_count != s_device_count) {
-        ESP_LOGD(TAG, "Removed %d stale device(s), %d active device(s) remaining",
-                (int)(initial_count - s_device_count), (int)s_device_count);
+// Remove devices past their TTL; the caller holds the mutex
+static void remove_expired_devices(time_t now) {
+    for (size_t i = 0; i < s_device_count; ) {
+        if (now >= s_expires_at[i]) {
+            remove_device_locked(i);
+        } else {
+            i++;
+        }
     }
 }
 
-// Process mDNS query results and add to device list
-static void process_mdns_results(mdns_result_t *results) {
-    ESP_LOGD(TAG, "=== PROCESSING MDNS RESULTS ===");
-    time_t current_time = time(NULL);
-    mdns_result_t *r = results;
-    int result_num = 0;
-
-    while (r) {
-        result_num++;
-        ESP_LOGD(TAG, "Processing result #%d:", result_num);
-        ESP_LOGD(TAG, "  Instance: %s", r->instance_name ? r->instance_name : "NULL");
-        ESP_LOGD(TAG, "  Hostname: %s", r->hostname ? r->hostname : "NULL");
-        ESP_LOGD(TAG, "  Port: %d", r->port);
-
-        // Take mutex to access device list
-        if (xSemaphoreTake(s_device_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            // Check if device already exists (by IP)
-            bool device_exists = false;
-            esp_ip4_addr_t ip4_addr = {0};
-
-            // Get IPv4 address from result
-            mdns_ip_addr_t *addr = r->addr;
-            while (addr) {
-                if (addr->addr.type == ESP_IPADDR_TYPE_V4) {
-                    ip4_addr.addr = addr->addr.u_addr.ip4.addr;
-                    ESP_LOGD(TAG, "    Found IPv4: %s", inet_ntoa(ip4_addr));
-                    break;
+// Capabilities from the TXT record (mdns_service.c); an answer without one leaves them
+static void apply_txt(discovered_device_t *dev, const mdns_result_t *r) {
+    for (size_t t = 0; t < r->txt_count; t++) {
+        const char *key = r->txt[t].key;
+        const char *value = r->txt[t].value;
+        if (!key || !value) {
+            continue;
+        }
+        if (strcmp(key, "mode") == 0) {
+            dev->is_sender = strcmp(value, "sender") == 0;
+        } else if (strcmp(key, "battery") == 0) {
+            int pct = atoi(value);
+            dev->battery = (uint8_t)(pct < 0 ? 0 : pct > 100 ? 100 : pct);
+        } else if (strcmp(key, "rssi") == 0) {
+            int rssi = atoi(value);
+            dev->rssi = (int8_t)(rssi < -127 ? -127 : rssi > 0 ? 0 : rssi);
+        } else if (strcmp(key, "samplerates") == 0) {
+            uint8_t rates = 0;
+            for (const char *p = value; *p; ) {
+                switch (atoi(p)) {
+                    case 44100: rates |= DISCOVERED_RATE_44100; break;
+                    case 48000: rates |= DISCOVERED_RATE_48000; break;
+                    case 88200: rates |= DISCOVERED_RATE_88200; break;
+                    case 96000: rates |= DISCOVERED_RATE_96000; break;
+                    default: break;
                 }
-                addr = addr->next;
+                const char *comma = strchr(p, ',');
+                p = comma ? comma + 1 : p + strlen(p);
             }
+            dev->rates = rates;
+        }
+    }
+}
 
-            if (ip4_addr.addr != 0) {
-                // Check if device exists
-                for (size_t i = 0; i < s_device_count; i++) {
-                    if (s_devices[i].ip_addr.addr == ip4_addr.addr) {
-                        // Update existing device timestamp
-                        s_devices[i].last_seen = current_time;
-                        device_exists = true;
-                        ESP_LOGD(TAG, "  Updated existing device: %s (%s)",
-                                s_devices[i].hostname, inet_ntoa(s_devices[i].ip_addr));
-                        break;
-                    }
-                }
+// Apply one answer: add, refresh or (TTL 0, a goodbye) remove its device
+static void apply_result(const mdns_result_t *r, time_t now) {
+    esp_ip4_addr_t ip4_addr = {0};
+    for (const mdns_ip_addr_t *addr = r->addr; addr; addr = addr->next) {
+        if (addr->addr.type == ESP_IPADDR_TYPE_V4) {
+            ip4_addr.addr = addr->addr.u_addr.ip4.addr;
+            break;
+        }
+    }
 
-                // Add new device if not exists and there's room
-                if (!device_exists && s_device_count < MAX_DISCOVERED_DEVICES) {
-                    discovered_device_t new_device = {0};
-
-                    // Set hostname - use instance name if available, otherwise hostname
-                    if (r->instance_name) {
-                        strncpy(new_device.hostname, r->instance_name, sizeof(new_device.hostname) - 1);
-                    } else if (r->hostname) {
-                        strncpy(new_device.hostname, r->hostname, sizeof(new_device.hostname) - 1);
-                    } else {
-                        snprintf(new_device.hostname, sizeof(new_device.hostname),
-                                "scream_%08x", (unsigned int)ip4_addr.addr);
-                    }
-                    new_device.hostname[sizeof(new_device.hostname) - 1] = '\0';
-
-                    // Set IP address
-                    new_device.ip_addr = ip4_addr;
-
-                    // Set port (use service port if available, otherwise default from config)
-                    new_device.port = r->port ? r->port : lifecycle_get_port();
-
-                    // Set last seen time
-                    new_device.last_seen = current_time;
-
-                    // Add to device list
-                    s_devices[s_device_count++] = new_device;
-                    ESP_LOGI(TAG, "*** NEW DEVICE: %s (%s:%d) ***",
-                            new_device.hostname, inet_ntoa(new_device.ip_addr), new_device.port);
-                    ESP_LOGI(TAG, "Total devices: %d", s_device_count);
-                }
-            }
+    // Instance name when the answer has one (a goodbye may carry no address), else the address
+    size_t i = 0;
+    for (; i < s_device_count; i++) {
+        if (r->instance_name ? strncmp(s_devices[i].hostname, r->instance_name,
+                                       sizeof(s_devices[i].hostname) - 1) == 0
+                             : (ip4_addr.addr != 0 && s_devices[i].ip_addr.addr == ip4_addr.addr)) {
+            break;
+        }
+    }
+    bool known = i < s_device_count;
 
-            // Release mutex
-            xSemaphoreGive(s_device_mutex);
+    if (r->ttl == 0) {
+        if (known) {
+            remove_device_locked(i);
+        }
+        return;
+    }
+    if (!known) {
+        if (ip4_addr.addr == 0) {
+            // PTR ahead of its address records: the device is added once they arrive
+            return;
+        }
+        if (s_device_count >= MAX_DISCOVERED_DEVICES) {
+            return;
+        }
+        discovered_device_t *dev = &s_devices[s_device_count++];
+        memset(dev, 0, sizeof(*dev));
+
+        // Set hostname - use instance name if available, otherwise hostname
+        if (r->instance_name) {
+            strncpy(dev->hostname, r->instance_name, sizeof(dev->hostname) - 1);
+        } else if (r->hostname) {
+            strncpy(dev->hostname, r->hostname, sizeof(dev->hostname) - 1);
         } else {
-            ESP_LOGE(TAG, "Failed to take device mutex!");
+            snprintf(dev->hostname, sizeof(dev->hostname), "scream_%08x", (unsigned int)ip4_addr.addr);
+        }
+        dev->ip_addr = ip4_addr;
+        dev->battery = 0xFF;
+        // Set port (use service port if available, otherwise default from config)
+        dev->port = r->port ? r->port : lifecycle_get_port();
+        ESP_LOGI(TAG, "*** NEW DEVICE: %s (%s:%d) ***", dev->hostname, inet_ntoa(dev->ip_addr), dev->port);
+        ESP_LOGI(TAG, "Total devices: %d", s_device_count);
+    } else {
+        if (ip4_addr.addr != 0) {
+            s_devices[i].ip_addr = ip4_addr;
         }
+        if (r->port) {
+            s_devices[i].port = r->port;
+        }
+    }
+
+    apply_txt(&s_devices[i], r);
+
+    uint32_t lifetime = r->ttl < DEVICE_MAX_LIFETIME_SEC ? r->ttl : DEVICE_MAX_LIFETIME_SEC;
+    s_devices[i].last_seen = now;
+    s_expires_at[i] = now + lifetime;
+    s_refresh_at[i] = now + (time_t)lifetime * DEVICE_REFRESH_PCT / 100;
+}
 
-        r = r->next;
+static void apply_results(const mdns_result_t *results) {
+    time_t now = time(NULL);
+    if (!s_device_mutex || xSemaphoreTake(s_device_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGE(TAG, "Failed to take device mutex!");
+        return;
+    }
+    for (const mdns_result_t *r = results; r; r = r->next) {
+        apply_result(r, now);
+    }
+    xSemaphoreGive(s_device_mutex);
+}
+
+// Runs on the mDNS task for every change to the browsed service
+static void browse_notify(mdns_result_t *results) {
+    if (s_task_running) {
+        apply_results(results);
     }
-    ESP_LOGD(TAG, "=== RESULT PROCESSING COMPLETE ===");
+}
+
+// Finish a refresh query if its answers are in (never blocks)
+static void poll_refresh_query(void) {
+    mdns_result_t *results = NULL;
+    if (!s_refresh_query || !mdns_query_async_get_results(s_refresh_query, 0, &results, NULL)) {
+        return;
+    }
+    if (results) {
+        apply_results(results);
+        mdns_query_results_free(results);
+    }
+    mdns_query_async_delete(s_refresh_query);
+    s_refresh_query = NULL;
 }
 
 // Periodic discovery worker
@@ -153,17 +208,20 @@ void mdns_discovery_tick(void) {
         return;
     }
 
-    const int QUERY_INTERVAL = 10;      // Send query every 10 seconds
-    const int CLEANUP_INTERVAL = 30;    // Clean up stale devices every 30 seconds
     const int HEARTBEAT_INTERVAL = 30;  // Heartbeat every 30 seconds
 
-    if (!s_runtime_initialized) {
-        ESP_LOGI(TAG, "Starting discovery loop (query every %ds, cleanup every %ds)",
-                 QUERY_INTERVAL, CLEANUP_INTERVAL);
-        s_last_query_time = 0;
-        s_last_cleanup_time = current_time;
-        s_last_heartbeat_time = current_time;
-        s_runtime_initialized = true;
+    poll_refresh_query();
+
+    bool refresh_due = false;
+    if (xSemaphoreTake(s_device_mutex, 0) == pdTRUE) {
+        remove_expired_devices(current_time);
+        for (size_t i = 0; i < s_device_count && !refresh_due; i++) {
+            refresh_due = current_time >= s_refresh_at[i];
+        }
+        if (s_device_count == 0) {
+            refresh_due = (current_time - s_last_query_time) >= IDLE_QUERY_INTERVAL_SEC;
+        }
+        xSemaphoreGive(s_device_mutex);
     }
 
     // Heartbeat log
@@ -172,45 +230,16 @@ void mdns_discovery_tick(void) {
         s_last_heartbeat_time = current_time;
     }
 
-    // Send mDNS query at the configured interval
-    if ((current_time - s_last_query_time) >= QUERY_INTERVAL) {
-        ESP_LOGD(TAG, "Querying for _scream._udp services...");
-
-        // Perform service discovery query for _scream._udp
-        mdns_result_t *results = NULL;
-        esp_err_t err = mdns_query_ptr("_scream", "_udp",
-                                      MDNS_QUERY_TIMEOUT_MS, MDNS_MAX_RESULTS, &results);
-
-        if (err == ESP_OK) {
-            if (results) {
-                int result_count = 0;
-                mdns_result_t *r = results;
-                while (r) {
-                    result_count++;
-                    r = r->next;
-                }
-                ESP_LOGI(TAG, "Found %d _scream._udp service(s)", result_count);
-                process_mdns_results(results);
-                mdns_query_results_free(results);
-            } else {
-                ESP_LOGD(TAG, "No _scream._udp services found");
-            }
-        } else {
-            ESP_LOGW(TAG, "Query failed: %s", esp_err_to_name(err));
+    // One query refreshes every device due; answers arrive through poll_refresh_query()
+    if (refresh_due && !s_refresh_query) {
+        ESP_LOGD(TAG, "Refreshing _scream._udp services...");
+        s_refresh_query = mdns_query_async_new(NULL, "_scream", "_udp", MDNS_TYPE_PTR,
+                                               MDNS_QUERY_TIMEOUT_MS, MDNS_MAX_RESULTS, NULL);
+        if (!s_refresh_query) {
+            ESP_LOGW(TAG, "Refresh query failed to start");
         }
-
         s_last_query_time = current_time;
     }
-
-    // Periodic cleanup
-    if ((current_time - s_last_cleanup_time) >= CLEANUP_INTERVAL) {
-        ESP_LOGD(TAG, "Performing stale device cleanup");
-        if (xSemaphoreTake(s_device_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            remove_stale_devices();
-            xSemaphoreGive(s_device_mutex);
-        }
-        s_last_cleanup_time = current_time;
-    }
 }
 
 /**
@@ -241,14 +270,22 @@ esp_err_t mdns_discovery_start(void) {
 
     // Initialize device count
     s_device_count = 0;
+    time_t now = time(NULL);
+    s_last_query_time = now;
+    s_last_heartbeat_time = now;
 
-    // Set task running flag
+    // Set task running flag before the first answers can arrive
     s_task_running = true;
 
-    // Initialise runtime state so the next tick performs work immediately
-    s_runtime_initialized = false;
+    // The browse sends the initial query and then follows announcements and goodbyes
+    s_browse = mdns_browse_new("_scream", "_udp", browse_notify);
+    if (!s_browse) {
+        ESP_LOGE(TAG, "Failed to start mDNS browse");
+        s_task_running = false;
+        return ESP_FAIL;
+    }
 
-    ESP_LOGI(TAG, "mDNS discovery worker enabled");
+    ESP_LOGI(TAG, "mDNS discovery browsing _scream._udp");
     return ESP_OK;
 }
 
@@ -265,17 +302,23 @@ esp_err_t mdns_discovery_stop(void) {
 
     // Set flag to stop worker
     s_task_running = false;
-    s_runtime_initialized = false;
 
-    // Delete the device mutex
-    if (s_device_mutex != NULL) {
-        vSemaphoreDelete(s_device_mutex);
-        s_device_mutex = NULL;
+    if (s_browse) {
+        mdns_browse_delete("_scream", "_udp");
+        s_browse = NULL;
+    }
+    if (s_refresh_query) {
+        mdns_query_async_delete(s_refresh_query);
+        s_refresh_query = NULL;
     }
 
-    // Clear device list
-    s_device_count = 0;
-    memset(s_devices, 0, sizeof(s_devices));
+    // The browse is torn down on the mDNS task, so a last notification may
+    // still be in flight: keep the mutex for it and only clear the list
+    if (xSemaphoreTake(s_device_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        s_device_count = 0;
+        memset(s_devices, 0, sizeof(s_devices));
+        xSemaphoreGive(s_device_mutex);
+    }
 
     ESP_LOGI(TAG, "mDNS discovery stopped");
     return ESP_OK;
@@ -301,10 +344,7 @@ esp_err_t mdns_discovery_get_devices(discovered_device_t *out_devices, size_t ma
         return ESP_ERR_TIMEOUT;
     }
 
-    // Remove stale devices first
-    remove_stale_devices();
-
-    // Copy devices to output
+    // Copy the cached devices to output; expiry happens on the tick
     size_t copy_count = (s_device_count < max_devices) ? s_device_count : max_devices;
     memcpy(out_devices, s_devices, copy_count * sizeof(discovered_device_t));
     *out_count = copy_count;
@@ -314,4 +354,4 @@ esp_err_t mdns_discovery_get_devices(discovered_device_t *out_devices, size_t ma
 
     ESP_LOGD(TAG, "Returning %d discovered device(s)", copy_count);
     return ESP_OK;
-}
\ No newline at end of file
+}
@@ -4,6 +4,7 @@
 #include "esp_err.h"
 #include "esp_netif.h"
 #include <stdint.h>
+#include <stdbool.h>
 #include <time.h>
 #include "build_config.h"
 
@@ -13,19 +14,31 @@ extern "C" {
 
 #define MAX_DISCOVERED_DEVICES CONFIG_MDNS_MAX_DEVICES
 
+// Sample rates a device advertises (TXT "samplerates")
+#define DISCOVERED_RATE_44100 (1u << 0)
+#define DISCOVERED_RATE_48000 (1u << 1)
+#define DISCOVERED_RATE_88200 (1u << 2)
+#define DISCOVERED_RATE_96000 (1u << 3)
+
 // Holds information for a device discovered via mDNS
 typedef struct {
     char hostname[64];
     esp_ip4_addr_t ip_addr;
     uint16_t port;
     time_t last_seen;  // Timestamp when device was last seen
+    // From its TXT record, once one has arrived
+    bool is_sender;    // TXT mode=sender
+    uint8_t rates;     // DISCOVERED_RATE_* bits; 0 = not advertised
+    uint8_t battery;   // Percent; 0xFF = not advertised
+    int8_t rssi;       // dBm of its own Wi-Fi link; 0 = not advertised
 } discovered_device_t;
 
 /**
  * @brief Start the continuous mDNS discovery task
  *
- * Starts a background task that periodically queries the network for
- * _scream._udp services and maintains a list of discovered devices.
+ * Starts an mDNS browse of _scream._udp: devices are added, refreshed and
+ * removed as answers, announcements and goodbyes arrive, with no blocking
+ * queries. Each device expires at its record TTL (capped at 2 minutes).
  *
  * Note: mdns_service_init() must be called before starting discovery.
  *
@@ -36,7 +49,8 @@ esp_err_t mdns_discovery_start(void);
 /**
  * @brief Stop the continuous mDNS discovery task
  *
- * Stops the discovery task and clears the list of discovered devices.
+ * Ends the browse and any refresh query and clears the list of discovered
+ * devices.
  *
  * @return ESP_OK on success, or an error code on failure
  */
@@ -45,17 +59,18 @@ esp_err_t mdns_discovery_stop(void);
 /**
  * @brief Run a single iteration of the mDNS discovery worker.
  *
- * This function performs any pending discovery work when discovery has been
- * started. It is inexpensive to call frequently and is intended to be invoked
- * from a cooperative background loop rather than a dedicated FreeRTOS task.
+ * Expires devices past their TTL and, once a device nears expiry, starts one
+ * asynchronous refresh query whose answers are collected on later ticks. It
+ * never blocks and is intended to be invoked from a cooperative background
+ * loop rather than a dedicated FreeRTOS task.
  */
 void mdns_discovery_tick(void);
 
 /**
  * @brief Get the list of discovered devices
  *
- * Returns a snapshot of the currently discovered devices. Automatically
- * removes stale devices (not seen for 2 minutes) before returning.
+ * Returns a snapshot of the cached device list, kept current by the browse
+ * and mdns_discovery_tick().
  *
  * @param out_devices Array to store discovered devices
  * @param max_devices Maximum number of devices that can be stored
@@ -8,6 +8,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "lifecycle_manager.h"
+#include "lifecycle/net_iface.h"
 #include "bq25895_integration.h"
 #include "esp_timer.h"
 
@@ -29,6 +30,7 @@ static bool s_advertisement_enabled = false;
 // Static buffers for TXT record strings that need to persist
 static char s_battery_level_str[8];
 static char s_mac_str[18];  // xx:xx:xx:xx:xx:xx + null terminator
+static char s_rssi_str[8];
 
 // Periodic TXT record update state
 static volatile bool s_txt_task_running = false;
@@ -56,6 +58,16 @@ static void get_battery_level_string(char *buf, size_t buf_size) {
     }
 }
 
+// Signal of our own AP link, so senders can prefer well-connected receivers; "0" when unknown
+static void get_rssi_string(char *buf, size_t buf_size) {
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        snprintf(buf, buf_size, "%d", ap.rssi);
+    } else {
+        snprintf(buf, buf_size, "0");
+    }
+}
+
 /**
  * @brief Generate instance name and hostname using configured hostname
  */
@@ -110,6 +122,12 @@ static void generate_instance_name(void) {
     ESP_LOGD(TAG, "Generated fallback hostname: %s", g_hostname);
 }
 
+// S/PDIF output carries up to 96 kHz; USB DACs are only assumed to take the base rates
+static const char *advertised_samplerates(void) {
+    return lifecycle_get_device_mode() == MODE_RECEIVER_SPDIF ?
+           "44100,48000,88200,96000" : "44100,48000";
+}
+
 /**
  * @brief Update TXT records for the mDNS service
  */
@@ -133,6 +151,7 @@ static esp_err_t update_txt_records(void) {
 
     // Get current battery level (use static buffer)
     get_battery_level_string(s_battery_level_str, sizeof(s_battery_level_str));
+    get_rssi_string(s_rssi_str, sizeof(s_rssi_str));
 
     // Get MAC address for TXT record (use static buffer)
     uint8_t mac[6];
@@ -147,8 +166,8 @@ static esp_err_t update_txt_records(void) {
         strncpy(s_mac_str, "unknown", sizeof(s_mac_str));
     }
 
-    // Hard-coded values that don't change
-    const char *samplerates = "44100,48000";
+    // Values that only change with the device mode
+    const char *samplerates = advertised_samplerates();
     const char *codecs = "lpcm";
     const char *channels = "2";
 
@@ -160,7 +179,8 @@ static esp_err_t update_txt_records(void) {
         {"mac", s_mac_str},
         {"samplerates", samplerates},
         {"codecs", codecs},
-        {"channels", channels}
+        {"channels", channels},
+        {"rssi", s_rssi_str}
     };
 
     // Update the TXT records for the service
@@ -258,9 +278,9 @@ void mdns_service_start(void) {
     generate_instance_name();
 
     // Check network interface and ensure we have a valid IP
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_t *netif = net_iface_primary();
     if (!netif) {
-        ESP_LOGE(TAG, "No STA network interface found!");
+        ESP_LOGE(TAG, "No network interface found!");
         return;
     }
 
@@ -294,8 +314,9 @@ void mdns_service_start(void) {
         type = "receiver";
     }
 
-    // Get battery level and MAC address
+    // Get battery level, link signal and MAC address
     get_battery_level_string(s_battery_level_str, sizeof(s_battery_level_str));
+    get_rssi_string(s_rssi_str, sizeof(s_rssi_str));
     uint8_t mac[6];
     esp_err_t mac_err = esp_wifi_get_mac(WIFI_IF_STA, mac);
     if (mac_err != ESP_OK) {
@@ -309,7 +330,7 @@ void mdns_service_start(void) {
     }
 
     // Prepare TXT records
-    const char *samplerates = "44100,48000";
+    const char *samplerates = advertised_samplerates();
     const char *codecs = "lpcm";
     const char *channels = "2";
 
@@ -320,7 +341,8 @@ void mdns_service_start(void) {
         {"mac", s_mac_str},
         {"samplerates", samplerates},
         {"codecs", codecs},
-        {"channels", channels}
+        {"channels", channels},
+        {"rssi", s_rssi_str}
     };
 
     ESP_LOGI(TAG, "TXT: mode=%s, type=%s, battery=%s, mac=%s", mode, type, s_battery_level_str, s_mac_str);
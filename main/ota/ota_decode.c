@@ -0,0 +1,536 @@
+#include "ota_decode.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_crc.h"
+#include "rom/miniz.h"
+#include "audio_arena.h"
+
+static const char *TAG = "OTA_DECODE";
+
+#define ESP_IMAGE_MAGIC     0xE9
+#define GZIP_ID1            0x1F
+#define GZIP_ID2            0x8B
+#define GZIP_CM_DEFLATE     8
+#define GZIP_FHCRC          0x02
+#define GZIP_FEXTRA         0x04
+#define GZIP_FNAME          0x08
+#define GZIP_FCOMMENT       0x10
+
+#define DELTA_HEADER_SIZE   16
+#define DELTA_RECORD_SIZE   12
+#define DECODE_OUT_SIZE     4096   // Delta output staging, also the CRC scratch
+
+// Container layer: plain bytes, or gzip around them
+typedef enum {
+    OUTER_DETECT = 0,
+    OUTER_PLAIN,
+    OUTER_GZ_FIXED,
+    OUTER_GZ_XLEN,
+    OUTER_GZ_EXTRA,
+    OUTER_GZ_NAME,
+    OUTER_GZ_COMMENT,
+    OUTER_GZ_HCRC,
+    OUTER_INFLATE,
+    OUTER_TRAILER,
+    OUTER_DONE,
+} outer_state_t;
+
+// Payload layer: the app image itself, or a delta patch producing it
+typedef enum {
+    INNER_DETECT = 0,
+    INNER_IMAGE,
+    INNER_DELTA_HEADER,
+    INNER_DELTA_RECORD,
+    INNER_DELTA_DIFF,
+    INNER_DELTA_EXTRA,
+} inner_state_t;
+
+struct ota_decoder {
+    const esp_partition_t *source;
+    ota_decode_sink_t sink;
+    void *ctx;
+    uint32_t output_size;
+
+    outer_state_t outer;
+    uint8_t outer_hdr[10];
+    size_t outer_len;
+    uint32_t gz_skip;
+    uint8_t gz_flags;
+
+    tinfl_decompressor *inflator;
+    uint8_t *dict;                 // TINFL_LZ_DICT_SIZE, wrapping
+    size_t dict_ofs;
+    uint32_t gz_crc;
+    uint32_t gz_size;
+
+    inner_state_t inner;
+    uint8_t inner_hdr[DELTA_HEADER_SIZE];
+    size_t inner_len;
+
+    uint32_t source_size;
+    uint32_t target_size;
+    uint32_t src_pos;
+    uint32_t diff_left;
+    uint32_t extra_left;
+    int32_t seek;
+    uint8_t out[DECODE_OUT_SIZE];
+    size_t out_len;
+};
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Copy into a header buffer until it holds need bytes; returns bytes consumed
+static size_t collect(uint8_t *hdr, size_t *have, size_t need, const uint8_t *data, size_t len) {
+    size_t take = need - *have;
+    if (take > len) {
+        take = len;
+    }
+    memcpy(hdr + *have, data, take);
+    *have += take;
+    return take;
+}
+
+static esp_err_t emit(ota_decoder_t *dec, const uint8_t *data, size_t len) {
+    if (len == 0) {
+        return ESP_OK;
+    }
+    dec->output_size += len;
+    return dec->sink(dec->ctx, data, len);
+}
+
+static esp_err_t flush_out(ota_decoder_t *dec) {
+    esp_err_t err = emit(dec, dec->out, dec->out_len);
+    dec->out_len = 0;
+    return err;
+}
+
+// ----------------------------------------------------------------------------
+// Delta patch
+// ----------------------------------------------------------------------------
+
+static esp_err_t delta_check_source(ota_decoder_t *dec, uint32_t expected_crc) {
+    if (!dec->source || dec->source_size > dec->source->size) {
+        ESP_LOGE(TAG, "Delta source of %lu bytes does not fit the running partition",
+                 (unsigned long)dec->source_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint32_t crc = 0;
+    for (uint32_t ofs = 0; ofs < dec->source_size; ) {
+        uint32_t n = dec->source_size - ofs;
+        if (n > sizeof(dec->out)) {
+            n = sizeof(dec->out);
+        }
+        esp_err_t err = esp_partition_read(dec->source, ofs, dec->out, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        crc = esp_crc32_le(crc, dec->out, n);
+        ofs += n;
+    }
+    if (crc != expected_crc) {
+        ESP_LOGE(TAG, "Delta was made against other firmware (source CRC %08lx, running %08lx)",
+                 (unsigned long)expected_crc, (unsigned long)crc);
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+// Add diff bytes to the source at src_pos, staging the result in out
+static esp_err_t delta_diff(ota_decoder_t *dec, const uint8_t *data, size_t len) {
+    size_t room = sizeof(dec->out) - dec->out_len;
+    if (len > room) {
+        len = room;
+    }
+    if (len > dec->diff_left) {
+        len = dec->diff_left;
+    }
+    if ((uint64_t)dec->src_pos + len > dec->source_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t *dst = dec->out + dec->out_len;
+    esp_err_t err = esp_partition_read(dec->source, dec->src_pos, dst, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (size_t i = 0; i < len; i++) {
+        dst[i] += data[i];
+    }
+    dec->out_len += len;
+    dec->src_pos += len;
+    dec->diff_left -= len;
+    return ESP_OK;
+}
+
+static esp_err_t delta_feed(ota_decoder_t *dec, const uint8_t *data, size_t len) {
+    esp_err_t err = ESP_OK;
+    while (len > 0 && err == ESP_OK) {
+        size_t used = 0;
+        switch (dec->inner) {
+            case INNER_DELTA_HEADER:
+                used = collect(dec->inner_hdr, &dec->inner_len, DELTA_HEADER_SIZE, data, len);
+                if (dec->inner_len == DELTA_HEADER_SIZE) {
+                    dec->source_size = get_le32(dec->inner_hdr + 4);
+                    dec->target_size = get_le32(dec->inner_hdr + 12);
+                    ESP_LOGI(TAG, "Delta patch: %lu byte source -> %lu byte image",
+                             (unsigned long)dec->source_size, (unsigned long)dec->target_size);
+                    err = delta_check_source(dec, get_le32(dec->inner_hdr + 8));
+                    dec->inner = INNER_DELTA_RECORD;
+                    dec->inner_len = 0;
+                }
+                break;
+            case INNER_DELTA_RECORD:
+                used = collect(dec->inner_hdr, &dec->inner_len, DELTA_RECORD_SIZE, data, len);
+                if (dec->inner_len == DELTA_RECORD_SIZE) {
+                    dec->diff_left = get_le32(dec->inner_hdr);
+                    dec->extra_left = get_le32(dec->inner_hdr + 4);
+                    dec->seek = (int32_t)get_le32(dec->inner_hdr + 8);
+                    dec->inner_len = 0;
+                    uint64_t produced = (uint64_t)dec->output_size + dec->out_len;
+                    if (produced + dec->diff_left + dec->extra_left > dec->target_size) {
+                        ESP_LOGE(TAG, "Delta record runs past the image end");
+                        err = ESP_ERR_INVALID_SIZE;
+                    }
+                    dec->inner = INNER_DELTA_DIFF;
+                }
+                break;
+            case INNER_DELTA_DIFF:
+                if (dec->diff_left == 0) {
+                    dec->inner = INNER_DELTA_EXTRA;
+                    continue;
+                }
+                used = dec->out_len;
+                err = delta_diff(dec, data, len);
+                used = dec->out_len - used;
+                break;
+            case INNER_DELTA_EXTRA:
+                if (dec->extra_left == 0) {
+                    int64_t pos = (int64_t)dec->src_pos + dec->seek;
+                    if (pos < 0 || pos > dec->source_size) {
+                        ESP_LOGE(TAG, "Delta seek outside the source");
+                        err = ESP_ERR_INVALID_SIZE;
+                        break;
+                    }
+                    dec->src_pos = (uint32_t)pos;
+                    dec->inner = INNER_DELTA_RECORD;
+                    continue;
+                }
+                used = sizeof(dec->out) - dec->out_len;
+                if (used > len) {
+                    used = len;
+                }
+                if (used > dec->extra_left) {
+                    used = dec->extra_left;
+                }
+                memcpy(dec->out + dec->out_len, data, used);
+                dec->out_len += used;
+                dec->extra_left -= used;
+                break;
+            default:
+                return ESP_ERR_INVALID_STATE;
+        }
+        if (err == ESP_OK && dec->out_len == sizeof(dec->out)) {
+            err = flush_out(dec);
+        }
+        data += used;
+        len -= used;
+    }
+    return err;
+}
+
+// ----------------------------------------------------------------------------
+// Payload layer
+// ----------------------------------------------------------------------------
+
+static esp_err_t inner_feed(ota_decoder_t *dec, const uint8_t *data, size_t len) {
+    if (dec->inner == INNER_IMAGE) {
+        return emit(dec, data, len);
+    }
+    if (dec->inner != INNER_DETECT) {
+        return delta_feed(dec, data, len);
+    }
+
+    // An image is known from its first byte, a patch from its four-byte magic
+    size_t used = collect(dec->inner_hdr, &dec->inner_len, 4, data, len);
+    if (dec->inner_hdr[0] == ESP_IMAGE_MAGIC) {
+        dec->inner = INNER_IMAGE;
+        esp_err_t err = emit(dec, dec->inner_hdr, dec->inner_len);
+        return err == ESP_OK ? emit(dec, data + used, len - used) : err;
+    }
+    if (dec->inner_len < 4) {
+        return ESP_OK;
+    }
+    if (memcmp(dec->inner_hdr, OTA_DELTA_MAGIC, 4) != 0) {
+        ESP_LOGE(TAG, "Upload is not an app image, gzip file or delta patch");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    dec->inner = INNER_DELTA_HEADER;
+    // The magic stays at the front of the header buffer
+    return delta_feed(dec, data + used, len - used);
+}
+
+// ----------------------------------------------------------------------------
+// Container layer
+// ----------------------------------------------------------------------------
+
+static esp_err_t gzip_start(ota_decoder_t *dec) {
+    dec->inflator = malloc(sizeof(tinfl_decompressor));
+    // 32 KB window, touched once per byte inflated: PSRAM when present
+    dec->dict = audio_arena_alloc_cold(TINFL_LZ_DICT_SIZE);
+    if (!dec->inflator || !dec->dict) {
+        ESP_LOGE(TAG, "No memory for the gzip window");
+        return ESP_ERR_NO_MEM;
+    }
+    tinfl_init(dec->inflator);
+    dec->dict_ofs = 0;
+    dec->gz_crc = 0;
+    dec->gz_size = 0;
+    return ESP_OK;
+}
+
+static esp_err_t gzip_inflate(ota_decoder_t *dec, const uint8_t *data, size_t len, size_t *consumed) {
+    const uint8_t *in = data;
+    size_t in_left = len;
+    for (;;) {
+        size_t in_bytes = in_left;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - dec->dict_ofs;
+        tinfl_status status = tinfl_decompress(dec->inflator, in, &in_bytes,
+                                               dec->dict, dec->dict + dec->dict_ofs, &out_bytes,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_bytes;
+        in_left -= in_bytes;
+
+        if (out_bytes > 0) {
+            const uint8_t *out = dec->dict + dec->dict_ofs;
+            dec->gz_crc = esp_crc32_le(dec->gz_crc, out, out_bytes);
+            dec->gz_size += out_bytes;
+            dec->dict_ofs = (dec->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+            esp_err_t err = inner_feed(dec, out, out_bytes);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+
+        if (status == TINFL_STATUS_DONE) {
+            dec->outer = OUTER_TRAILER;
+            dec->outer_len = 0;
+            break;
+        }
+        if (status < TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "Corrupt gzip data (%d)", (int)status);
+            return ESP_ERR_INVALID_CRC;
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT && in_left == 0) {
+            break;
+        }
+    }
+    *consumed = len - in_left;
+    return ESP_OK;
+}
+
+static esp_err_t outer_feed(ota_decoder_t *dec, const uint8_t *data, size_t len) {
+    esp_err_t err = ESP_OK;
+    while (len > 0 && err == ESP_OK) {
+        size_t used = 1;
+        switch (dec->outer) {
+            case OUTER_DETECT:
+                used = collect(dec->outer_hdr, &dec->outer_len, 2, data, len);
+                if (dec->outer_len < 2) {
+                    break;
+                }
+                if (dec->outer_hdr[0] == GZIP_ID1 && dec->outer_hdr[1] == GZIP_ID2) {
+                    dec->outer = OUTER_GZ_FIXED;
+                    err = gzip_start(dec);
+                } else {
+                    dec->outer = OUTER_PLAIN;
+                    err = inner_feed(dec, dec->outer_hdr, dec->outer_len);
+                }
+                break;
+            case OUTER_PLAIN:
+                used = len;
+                err = inner_feed(dec, data, len);
+                break;
+            case OUTER_GZ_FIXED:
+                used = collect(dec->outer_hdr, &dec->outer_len, 10, data, len);
+                if (dec->outer_len == 10) {
+                    if (dec->outer_hdr[2] != GZIP_CM_DEFLATE) {
+                        return ESP_ERR_NOT_SUPPORTED;
+                    }
+                    dec->gz_flags = dec->outer_hdr[3];
+                    dec->outer_len = 0;
+                    dec->outer = OUTER_GZ_XLEN;
+                }
+                break;
+            case OUTER_GZ_XLEN:
+                if (!(dec->gz_flags & GZIP_FEXTRA)) {
+                    dec->outer = OUTER_GZ_NAME;
+                    continue;
+                }
+                used = collect(dec->outer_hdr, &dec->outer_len, 2, data, len);
+                if (dec->outer_len == 2) {
+                    dec->gz_skip = dec->outer_hdr[0] | (dec->outer_hdr[1] << 8);
+                    dec->outer = OUTER_GZ_EXTRA;
+                }
+                break;
+            case OUTER_GZ_EXTRA:
+                used = len < dec->gz_skip ? len : dec->gz_skip;
+                dec->gz_skip -= used;
+                if (dec->gz_skip == 0) {
+                    dec->outer = OUTER_GZ_NAME;
+                }
+                break;
+            case OUTER_GZ_NAME:
+            case OUTER_GZ_COMMENT: {
+                uint8_t flag = dec->outer == OUTER_GZ_NAME ? GZIP_FNAME : GZIP_FCOMMENT;
+                outer_state_t next = dec->outer == OUTER_GZ_NAME ? OUTER_GZ_COMMENT : OUTER_GZ_HCRC;
+                dec->gz_skip = 2;
+                if (!(dec->gz_flags & flag)) {
+                    dec->outer = next;
+                    continue;
+                }
+                // Zero-terminated: skip through the terminator
+                const uint8_t *end = memchr(data, 0, len);
+                if (!end) {
+                    used = len;
+                    break;
+                }
+                used = end - data + 1;
+                dec->outer = next;
+                break;
+            }
+            case OUTER_GZ_HCRC:
+                if (!(dec->gz_flags & GZIP_FHCRC)) {
+                    dec->outer = OUTER_INFLATE;
+                    continue;
+                }
+                used = len < dec->gz_skip ? len : dec->gz_skip;
+                dec->gz_skip -= used;
+                if (dec->gz_skip == 0) {
+                    dec->outer = OUTER_INFLATE;
+                }
+                break;
+            case OUTER_INFLATE:
+                err = gzip_inflate(dec, data, len, &used);
+                break;
+            case OUTER_TRAILER:
+                used = collect(dec->outer_hdr, &dec->outer_len, 8, data, len);
+                if (dec->outer_len == 8) {
+                    if (get_le32(dec->outer_hdr) != dec->gz_crc ||
+                        get_le32(dec->outer_hdr + 4) != dec->gz_size) {
+                        ESP_LOGE(TAG, "gzip CRC or length mismatch");
+                        return ESP_ERR_INVALID_CRC;
+                    }
+                    dec->outer = OUTER_DONE;
+                }
+                break;
+            case OUTER_DONE:
+                used = len;  // Anything after the gzip member is ignored
+                break;
+        }
+        data += used;
+        len -= used;
+    }
+    return err;
+}
+
+// ----------------------------------------------------------------------------
+// Public API
+// ----------------------------------------------------------------------------
+
+esp_err_t ota_decoder_create(const esp_partition_t *source, ota_decode_sink_t sink, void *ctx,
+                             ota_decoder_t **out) {
+    if (!sink || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ota_decoder_t *dec = calloc(1, sizeof(*dec));
+    if (!dec) {
+        return ESP_ERR_NO_MEM;
+    }
+    dec->source = source;
+    dec->sink = sink;
+    dec->ctx = ctx;
+    *out = dec;
+    return ESP_OK;
+}
+
+esp_err_t ota_decoder_feed(ota_decoder_t *dec, const uint8_t *data, size_t len) {
+    if (!dec || (!data && len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return outer_feed(dec, data, len);
+}
+
+esp_err_t ota_decoder_finish(ota_decoder_t *dec) {
+    if (!dec) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    switch (dec->outer) {
+        case OUTER_PLAIN:
+        case OUTER_DONE:
+            break;
+        case OUTER_TRAILER:
+            // Older inflaters read the trailer as lookahead; the app image
+            // checksum (esp_ota_end) still validates what was written
+            ESP_LOGD(TAG, "gzip trailer not seen, skipping its CRC check");
+            break;
+        default:
+            ESP_LOGE(TAG, "Upload ended inside the %s", dec->outer >= OUTER_INFLATE ? "gzip data" : "header");
+            return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = flush_out(dec);
+    if (err != ESP_OK) {
+        return err;
+    }
+    switch (dec->inner) {
+        case INNER_IMAGE:
+            return ESP_OK;
+        case INNER_DELTA_RECORD:
+            if (dec->inner_len == 0 && dec->output_size == dec->target_size) {
+                return ESP_OK;
+            }
+            break;
+        case INNER_DELTA_DIFF:
+        case INNER_DELTA_EXTRA:
+            if (dec->diff_left == 0 && dec->extra_left == 0 && dec->output_size == dec->target_size) {
+                return ESP_OK;
+            }
+            break;
+        default:
+            break;
+    }
+    ESP_LOGE(TAG, "Upload ended early (%lu of %lu image bytes)",
+             (unsigned long)dec->output_size, (unsigned long)dec->target_size);
+    return ESP_ERR_INVALID_SIZE;
+}
+
+ota_format_t ota_decoder_format(const ota_decoder_t *dec) {
+    if (!dec) {
+        return OTA_FORMAT_UNKNOWN;
+    }
+    bool gzip = dec->outer >= OUTER_GZ_FIXED;
+    switch (dec->inner) {
+        case INNER_DETECT:
+            return gzip ? OTA_FORMAT_GZIP : OTA_FORMAT_UNKNOWN;
+        case INNER_IMAGE:
+            return gzip ? OTA_FORMAT_GZIP : OTA_FORMAT_IMAGE;
+        default:
+            return gzip ? OTA_FORMAT_GZIP_DELTA : OTA_FORMAT_DELTA;
+    }
+}
+
+uint32_t ota_decoder_output_size(const ota_decoder_t *dec) {
+    return dec ? dec->output_size : 0;
+}
+
+void ota_decoder_destroy(ota_decoder_t *dec) {
+    if (!dec) {
+        return;
+    }
+    free(dec->inflator);
+    audio_arena_free(dec->dict);
+    free(dec);
+}
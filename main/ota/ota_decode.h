@@ -0,0 +1,85 @@
+#ifndef OTA_DECODE_H
+#define OTA_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming decoder for uploaded OTA images.
+ *
+ * An upload is one of:
+ *   - a plain app image (first byte 0xE9), passed through untouched
+ *   - a gzip file holding an app image or a delta patch
+ *   - a delta patch against the running partition (see make_ota_delta.py)
+ *
+ * The format is detected from the first bytes, so the upload route and the
+ * OTA state machine do not change. RAM is bounded whatever the image size:
+ * only gzip allocates, its 32 KB window plus the inflater state, and a delta
+ * reads the old image from flash a small block at a time.
+ *
+ * Delta patch layout (little-endian):
+ *   header:  "EDP1", u32 source_size, u32 source_crc32, u32 target_size
+ *   records: u32 diff_len, u32 extra_len, i32 seek, then diff_len bytes added
+ *            bytewise to the source at the current source offset, then
+ *            extra_len literal bytes; the source offset advances by diff_len
+ *            and then by seek (bsdiff control tuples, interleaved)
+ * source_crc32 is the CRC-32 of the first source_size bytes of the running
+ * partition; a patch made against other firmware is refused up front.
+ */
+
+#define OTA_DELTA_MAGIC "EDP1"
+
+typedef enum {
+    OTA_FORMAT_UNKNOWN = 0,
+    OTA_FORMAT_IMAGE,
+    OTA_FORMAT_GZIP,
+    OTA_FORMAT_DELTA,
+    OTA_FORMAT_GZIP_DELTA,
+} ota_format_t;
+
+// Receives decoded app image bytes in order
+typedef esp_err_t (*ota_decode_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct ota_decoder ota_decoder_t;
+
+/**
+ * @brief Create a decoder feeding sink
+ *
+ * @param source Partition a delta patch applies to (the running app)
+ */
+esp_err_t ota_decoder_create(const esp_partition_t *source, ota_decode_sink_t sink, void *ctx,
+                             ota_decoder_t **out);
+
+/**
+ * @brief Decode the next piece of the upload, calling the sink as output is ready
+ *
+ * @return ESP_OK, ESP_ERR_NOT_SUPPORTED for an unknown format,
+ *         ESP_ERR_INVALID_CRC for a patch against other firmware or a corrupt
+ *         gzip, ESP_ERR_INVALID_SIZE for a malformed patch, or a sink error
+ */
+esp_err_t ota_decoder_feed(ota_decoder_t *dec, const uint8_t *data, size_t len);
+
+/**
+ * @brief Flush buffered output and check the upload ended where its format says
+ */
+esp_err_t ota_decoder_finish(ota_decoder_t *dec);
+
+// Format detected so far (UNKNOWN until the first bytes arrive)
+ota_format_t ota_decoder_format(const ota_decoder_t *dec);
+
+// Bytes handed to the sink
+uint32_t ota_decoder_output_size(const ota_decoder_t *dec);
+
+void ota_decoder_destroy(ota_decoder_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OTA_DECODE_H
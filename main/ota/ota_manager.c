@@ -1,4 +1,11 @@
 #include "ota_manager.h"
+#include "ota_decode.h"
+#include "build_config.h"
+#ifdef CONFIG_OTA_WHILE_PLAYING
+#include "../receiver/audio_out.h"
+#include "../receiver/buffer.h"
+#include "../logging/event_trace.h"
+#endif
 #include <string.h>
 #include <sys/time.h>
 #include "esp_log.h"
@@ -7,8 +14,11 @@
 #include "esp_flash_partitions.h"
 #include "esp_partition.h"
 #include "esp_crc.h"
+#include "esp_heap_caps.h"
+#include "spi_flash_mmap.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
 
 static const char *TAG = "OTA_MANAGER";
@@ -22,9 +32,16 @@ typedef struct {
     esp_ota_handle_t update_handle;
     const esp_partition_t *update_partition;
     const esp_partition_t *running_partition;
-    uint32_t bytes_written;
-    uint32_t expected_size;
+    uint32_t bytes_written;           // Upload bytes taken (compressed or patch bytes)
+    uint32_t expected_size;           // Upload size, so progress follows the transfer
+    ota_decoder_t *decoder;           // Turns the upload into the app image
+    uint32_t image_written;           // App image bytes in the partition
+#ifdef CONFIG_OTA_WHILE_PLAYING
+    uint32_t play_gap_ms;             // Pause before the next sector while playing
+    uint32_t play_underruns;          // Underrun count at the last sector
+#endif
     uint32_t start_time;
+    uint32_t last_progress_ms;
     SemaphoreHandle_t mutex;
     void (*progress_callback)(uint8_t, uint32_t, uint32_t);
     void (*state_callback)(ota_state_t, ota_error_code_t);
@@ -37,6 +54,28 @@ typedef struct {
 // Global OTA manager context
 static ota_manager_ctx_t *g_ota_ctx = NULL;
 
+// Pipelined writer: the uploader fills one buffer while the writer task
+// programs flash from another. Buffers circulate between the two queues.
+#define OTA_PIPELINE_CHUNK_SIZE \
+    ((CONFIG_OTA_PIPELINE_CHUNK_KB * 1024u) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE)
+#define OTA_WRITER_TASK_STACK 4096
+
+typedef struct {
+    uint8_t *data;      // NULL ends the writer
+    size_t len;
+} ota_chunk_t;
+
+typedef struct {
+    uint8_t *buffers[CONFIG_OTA_PIPELINE_BUFFERS];
+    QueueHandle_t free_q;       // uint8_t *: buffers the uploader may fill
+    QueueHandle_t full_q;       // ota_chunk_t: buffers waiting for flash
+    SemaphoreHandle_t done;     // Given by the writer as it exits
+    TaskHandle_t task;
+    volatile esp_err_t err;     // First write error; later chunks are dropped
+} ota_pipeline_t;
+
+static ota_pipeline_t s_pipe;
+
 // Default configuration
 static const ota_config_t default_config = {
     .buffer_size = 4096,
@@ -92,16 +131,98 @@ static void update_state(ota_state_t new_state) {
     ESP_LOGI(TAG, "OTA State changed to: %d", new_state);
 }
 
-// Helper function to update progress
+#ifdef CONFIG_OTA_WHILE_PLAYING
+#define OTA_PLAY_POLL_MS     5
+#define OTA_PLAY_MAX_GAP_MS  200
+
+/*
+ * Each sector write stops both CPUs for the erase and program (tens of ms);
+ * only the output DMA and IRAM-safe ISRs keep running. While a stream plays,
+ * sectors go out one at a time, each after a pause that lets the jitter
+ * buffer refill to its target. An underrun during the update doubles the
+ * pause, and it decays back once playback is clean.
+ */
+static void playback_throttle(void) {
+    if (!is_playing()) {
+        return;
+    }
+    ota_manager_ctx_t *ctx = g_ota_ctx;
+    uint32_t underruns = buffer_get_underrun_count();
+    if (underruns != ctx->play_underruns) {
+        ctx->play_gap_ms = ctx->play_gap_ms * 2 > OTA_PLAY_MAX_GAP_MS ? OTA_PLAY_MAX_GAP_MS : ctx->play_gap_ms * 2;
+        ctx->play_underruns = underruns;
+        ESP_LOGW(TAG, "Underrun during OTA, sector gap now %u ms", (unsigned)ctx->play_gap_ms);
+    } else if (ctx->play_gap_ms > CONFIG_OTA_PLAY_SECTOR_GAP_MS) {
+        ctx->play_gap_ms -= (ctx->play_gap_ms - CONFIG_OTA_PLAY_SECTOR_GAP_MS + 7) / 8;
+    }
+    if (ctx->play_gap_ms) {
+        vTaskDelay(pdMS_TO_TICKS(ctx->play_gap_ms));
+    }
+    for (uint32_t waited = 0;
+         waited < CONFIG_OTA_PLAY_MAX_WAIT_MS && buffer_get_fill_level() < buffer_get_target_size();
+         waited += OTA_PLAY_POLL_MS) {
+        vTaskDelay(pdMS_TO_TICKS(OTA_PLAY_POLL_MS));
+    }
+}
+#endif
+
+// Flash write, timed into the glitch trace
+static esp_err_t traced_ota_write(const uint8_t *data, size_t len) {
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_ota_write(g_ota_ctx->update_handle, data, len);
+    event_trace_add(EVENT_TRACE_FLASH, EVENT_TRACE_FLASH_OTA, event_trace_u16((int64_t)(len / 1024)),
+                    (int32_t)(esp_timer_get_time() - start_us));
+    return err;
+}
+
+// Decoder sink: app image bytes go to the update partition
+static esp_err_t flash_sink(void *ctx, const uint8_t *data, size_t len) {
+    (void)ctx;
+#ifdef CONFIG_OTA_WHILE_PLAYING
+    // Split at sector boundaries so each write erases at most one sector
+    while (len > 0) {
+        size_t n = SPI_FLASH_SEC_SIZE - g_ota_ctx->image_written % SPI_FLASH_SEC_SIZE;
+        if (n > len) {
+            n = len;
+        }
+        playback_throttle();
+        esp_err_t err = traced_ota_write(data, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        g_ota_ctx->image_written += n;
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+#else
+    g_ota_ctx->image_written += len;
+    return traced_ota_write(data, len);
+#endif
+}
+
+static void release_decoder(void) {
+    ota_decoder_destroy(g_ota_ctx->decoder);
+    g_ota_ctx->decoder = NULL;
+}
+
+// Helper function to update progress (at most every CONFIG_OTA_PROGRESS_INTERVAL_MS, and at the end)
 static void update_progress(void) {
     if (!g_ota_ctx || g_ota_ctx->expected_size == 0) return;
     
+    uint32_t now = get_time_ms();
+    if (g_ota_ctx->bytes_written < g_ota_ctx->expected_size &&
+        now - g_ota_ctx->last_progress_ms < CONFIG_OTA_PROGRESS_INTERVAL_MS) {
+        return;
+    }
+    g_ota_ctx->last_progress_ms = now;
+    
     uint8_t percent = (g_ota_ctx->bytes_written * 100) / g_ota_ctx->expected_size;
     
     xSemaphoreTake(g_ota_ctx->mutex, portMAX_DELAY);
     g_ota_ctx->status.received_size = g_ota_ctx->bytes_written;
     g_ota_ctx->status.progress_percent = percent;
-    g_ota_ctx->status.update_duration_ms = get_time_ms() - g_ota_ctx->start_time;
+    g_ota_ctx->status.update_duration_ms = now - g_ota_ctx->start_time;
     xSemaphoreGive(g_ota_ctx->mutex);
     
     if (g_ota_ctx->progress_callback) {
@@ -243,19 +364,36 @@ esp_err_t ota_manager_start(uint32_t expected_size, const ota_firmware_info_t *f
         return ESP_ERR_INVALID_SIZE;
     }
     
-    // Begin OTA update
+    // Begin OTA update. Sectors are erased as they are written rather than all
+    // up front, so the erase overlaps the download instead of stalling it.
     esp_err_t err = esp_ota_begin(g_ota_ctx->update_partition, 
-                                   expected_size ? expected_size : OTA_SIZE_UNKNOWN, 
+                                   OTA_WITH_SEQUENTIAL_WRITES,
                                    &g_ota_ctx->update_handle);
     if (err != ESP_OK) {
         set_error_state(OTA_ERR_WRITE_FAILED, "Failed to begin OTA update");
         return err;
     }
     
+    // Deltas patch the running image; the format is known from the first bytes
+    release_decoder();
+    err = ota_decoder_create(g_ota_ctx->running_partition, flash_sink, NULL, &g_ota_ctx->decoder);
+    if (err != ESP_OK) {
+        esp_ota_abort(g_ota_ctx->update_handle);
+        g_ota_ctx->update_handle = 0;
+        set_error_state(OTA_ERR_MEMORY_ALLOC, "Failed to allocate OTA decoder");
+        return err;
+    }
+    
     // Initialize update context
     g_ota_ctx->expected_size = expected_size;
     g_ota_ctx->bytes_written = 0;
     g_ota_ctx->start_time = get_time_ms();
+    g_ota_ctx->last_progress_ms = g_ota_ctx->start_time;
+    g_ota_ctx->image_written = 0;
+#ifdef CONFIG_OTA_WHILE_PLAYING
+    g_ota_ctx->play_gap_ms = CONFIG_OTA_PLAY_SECTOR_GAP_MS;
+    g_ota_ctx->play_underruns = buffer_get_underrun_count();
+#endif
     
     // Update status
     xSemaphoreTake(g_ota_ctx->mutex, portMAX_DELAY);
@@ -302,11 +440,19 @@ esp_err_t ota_manager_write(const uint8_t *data, size_t size) {
         return ESP_ERR_TIMEOUT;
     }
     
-    // Write data to partition
-    esp_err_t err = esp_ota_write(g_ota_ctx->update_handle, data, size);
+    // Decode (gunzip, patch or pass through) and write to partition
+    esp_err_t err = ota_decoder_feed(g_ota_ctx->decoder, data, size);
     if (err != ESP_OK) {
-        set_error_state(OTA_ERR_WRITE_FAILED, "Failed to write OTA data");
-        ESP_LOGE(TAG, "esp_ota_write failed: %s", esp_err_to_name(err));
+        if (err == ESP_ERR_NOT_SUPPORTED || err == ESP_ERR_INVALID_CRC) {
+            set_error_state(OTA_ERR_INVALID_MAGIC, err == ESP_ERR_INVALID_CRC
+                            ? "Delta does not match the running firmware, or corrupt data"
+                            : "Not a firmware image, gzip file or delta patch");
+        } else if (err == ESP_ERR_NO_MEM) {
+            set_error_state(OTA_ERR_MEMORY_ALLOC, "Out of memory decoding OTA data");
+        } else {
+            set_error_state(OTA_ERR_WRITE_FAILED, "Failed to write OTA data");
+        }
+        ESP_LOGE(TAG, "OTA write failed: %s", esp_err_to_name(err));
         return err;
     }
     
@@ -320,6 +466,124 @@ esp_err_t ota_manager_write(const uint8_t *data, size_t size) {
     return ESP_OK;
 }
 
+// Flash side of the pipeline: write each full buffer, then hand it back
+static void ota_writer_task(void *arg) {
+    (void)arg;
+    ota_chunk_t chunk;
+    while (xQueueReceive(s_pipe.full_q, &chunk, portMAX_DELAY) == pdTRUE && chunk.data) {
+        if (s_pipe.err == ESP_OK) {
+            esp_err_t err = ota_manager_write(chunk.data, chunk.len);
+            if (err != ESP_OK) {
+                s_pipe.err = err;
+            }
+        }
+        xQueueSend(s_pipe.free_q, &chunk.data, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_pipe.done);
+    vTaskDelete(NULL);
+}
+
+static void pipeline_free(void) {
+    for (int i = 0; i < CONFIG_OTA_PIPELINE_BUFFERS; i++) {
+        free(s_pipe.buffers[i]);
+    }
+    if (s_pipe.free_q) {
+        vQueueDelete(s_pipe.free_q);
+    }
+    if (s_pipe.full_q) {
+        vQueueDelete(s_pipe.full_q);
+    }
+    if (s_pipe.done) {
+        vSemaphoreDelete(s_pipe.done);
+    }
+    memset(&s_pipe, 0, sizeof(s_pipe));
+}
+
+// Start the writer task for the update begun with ota_manager_start()
+esp_err_t ota_manager_pipeline_begin(void) {
+    if (!g_ota_ctx || g_ota_ctx->state != OTA_STATE_DOWNLOADING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_pipe.task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    s_pipe.err = ESP_OK;
+    s_pipe.free_q = xQueueCreate(CONFIG_OTA_PIPELINE_BUFFERS, sizeof(uint8_t *));
+    // One extra slot so the end marker never waits
+    s_pipe.full_q = xQueueCreate(CONFIG_OTA_PIPELINE_BUFFERS + 1, sizeof(ota_chunk_t));
+    s_pipe.done = xSemaphoreCreateBinary();
+    if (!s_pipe.free_q || !s_pipe.full_q || !s_pipe.done) {
+        pipeline_free();
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Internal RAM: flash writes from PSRAM would bounce through another copy
+    for (int i = 0; i < CONFIG_OTA_PIPELINE_BUFFERS; i++) {
+        s_pipe.buffers[i] = heap_caps_malloc(OTA_PIPELINE_CHUNK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!s_pipe.buffers[i]) {
+            ESP_LOGE(TAG, "Failed to allocate %u byte OTA buffer", (unsigned)OTA_PIPELINE_CHUNK_SIZE);
+            pipeline_free();
+            return ESP_ERR_NO_MEM;
+        }
+        xQueueSend(s_pipe.free_q, &s_pipe.buffers[i], 0);
+    }
+    
+    if (xTaskCreatePinnedToCore(ota_writer_task, "ota_writer", OTA_WRITER_TASK_STACK, NULL,
+                                CONFIG_OTA_WRITER_TASK_PRIORITY, &s_pipe.task,
+                                CONFIG_OTA_WRITER_CORE) != pdPASS) {
+        pipeline_free();
+        return ESP_ERR_NO_MEM;
+    }
+    
+    ESP_LOGI(TAG, "OTA pipeline: %d x %u byte buffers, writer on core %d",
+             CONFIG_OTA_PIPELINE_BUFFERS, (unsigned)OTA_PIPELINE_CHUNK_SIZE, CONFIG_OTA_WRITER_CORE);
+    return ESP_OK;
+}
+
+// Next empty buffer; waits while both are with the writer
+uint8_t *ota_manager_pipeline_get_buffer(size_t *capacity) {
+    uint8_t *buffer = NULL;
+    if (!s_pipe.task || !g_ota_ctx) {
+        return NULL;
+    }
+    if (xQueueReceive(s_pipe.free_q, &buffer, pdMS_TO_TICKS(g_ota_ctx->config.timeout_ms)) != pdTRUE) {
+        return NULL;
+    }
+    if (s_pipe.err != ESP_OK) {
+        // The writer failed; stop the upload rather than receive into the void
+        xQueueSend(s_pipe.free_q, &buffer, 0);
+        return NULL;
+    }
+    if (capacity) {
+        *capacity = OTA_PIPELINE_CHUNK_SIZE;
+    }
+    return buffer;
+}
+
+// Queue a filled buffer for writing
+esp_err_t ota_manager_pipeline_submit(uint8_t *buffer, size_t len) {
+    if (!s_pipe.task || !buffer || len == 0 || len > OTA_PIPELINE_CHUNK_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ota_chunk_t chunk = { .data = buffer, .len = len };
+    xQueueSend(s_pipe.full_q, &chunk, portMAX_DELAY);
+    return s_pipe.err;
+}
+
+// Wait for every queued write, stop the writer and free the buffers
+esp_err_t ota_manager_pipeline_end(void) {
+    if (!s_pipe.task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ota_chunk_t end = { .data = NULL, .len = 0 };
+    xQueueSend(s_pipe.full_q, &end, portMAX_DELAY);
+    xSemaphoreTake(s_pipe.done, portMAX_DELAY);
+    esp_err_t err = s_pipe.err;
+    pipeline_free();
+    return err;
+}
+
 // Complete OTA update and validate image
 esp_err_t ota_manager_complete(void) {
     if (!g_ota_ctx || !g_ota_ctx->initialized) {
@@ -334,10 +598,24 @@ esp_err_t ota_manager_complete(void) {
     
     ESP_LOGI(TAG, "Completing OTA update, total bytes written: %u", g_ota_ctx->bytes_written);
     
+    // Flush the decoder and check the upload was not cut short
+    esp_err_t err = ota_decoder_finish(g_ota_ctx->decoder);
+    ota_format_t format = ota_decoder_format(g_ota_ctx->decoder);
+    uint32_t image_size = ota_decoder_output_size(g_ota_ctx->decoder);
+    release_decoder();
+    if (err != ESP_OK) {
+        set_error_state(OTA_ERR_INVALID_SIZE, "Incomplete OTA image");
+        return err;
+    }
+    if (format != OTA_FORMAT_IMAGE) {
+        ESP_LOGI(TAG, "Decoded %u byte image from %u upload bytes (format %d)",
+                 image_size, g_ota_ctx->bytes_written, format);
+    }
+    
     update_state(OTA_STATE_VERIFYING);
     
     // End OTA update
-    esp_err_t err = esp_ota_end(g_ota_ctx->update_handle);
+    err = esp_ota_end(g_ota_ctx->update_handle);
     if (err != ESP_OK) {
         if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
             set_error_state(OTA_ERR_VERIFY_FAILED, "Image validation failed");
@@ -416,6 +694,7 @@ esp_err_t ota_manager_abort(void) {
         esp_ota_abort(g_ota_ctx->update_handle);
         g_ota_ctx->update_handle = 0;
     }
+    release_decoder();
     
     // Update statistics
     if (g_ota_ctx->state != OTA_STATE_SUCCESS) {
@@ -107,6 +107,44 @@ esp_err_t ota_manager_start(uint32_t expected_size, const ota_firmware_info_t *f
  */
 esp_err_t ota_manager_write(const uint8_t *data, size_t size);
 
+/**
+ * @brief Start the pipelined writer for the update begun with ota_manager_start()
+ *
+ * A writer task on CONFIG_OTA_WRITER_CORE programs flash from one buffer while
+ * the caller receives into another. Fill buffers from
+ * ota_manager_pipeline_get_buffer(), queue them with ota_manager_pipeline_submit()
+ * and finish with ota_manager_pipeline_end() before ota_manager_complete() or
+ * ota_manager_abort(). The caller must not call ota_manager_write() meanwhile.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the buffers or task cannot be created
+ */
+esp_err_t ota_manager_pipeline_begin(void);
+
+/**
+ * @brief Take an empty pipeline buffer, waiting while all are being written
+ *
+ * @param capacity Set to the buffer size, a whole number of flash sectors
+ * @return Buffer to fill, or NULL after a write error or the OTA timeout
+ */
+uint8_t *ota_manager_pipeline_get_buffer(size_t *capacity);
+
+/**
+ * @brief Queue a filled buffer for writing; ownership passes to the writer
+ *
+ * Only the last buffer of an image should be short of capacity, so every
+ * write starts on a sector boundary.
+ *
+ * @return ESP_OK, or the error of an earlier write
+ */
+esp_err_t ota_manager_pipeline_submit(uint8_t *buffer, size_t len);
+
+/**
+ * @brief Wait for queued writes, then stop the writer and free its buffers
+ *
+ * @return ESP_OK if every write succeeded, else the first write error
+ */
+esp_err_t ota_manager_pipeline_end(void);
+
 /**
  * @brief Complete OTA update and validate image
  * 
@@ -0,0 +1,78 @@
+#include "audio_gain.h"
+#include "build_config.h"
+#include "dsp/pcm_gain.h"
+#include <stdatomic.h>
+#include <string.h>
+
+static atomic_int_fast32_t target_q30 = PCM_GAIN_Q30_UNITY;
+static int32_t current_q30 = PCM_GAIN_Q30_UNITY;
+static pcm_gain_dither_t dither = {
+    .rng = 0x2545F491u,
+#ifdef CONFIG_RX_VOLUME_DITHER
+    .dither = true,
+#else
+    .dither = false,
+#endif
+};
+
+void audio_gain_set(float volume) {
+    int32_t q30;
+    if (!(volume > 0.0f)) {
+        q30 = 0;
+    } else if (volume >= 1.0f) {
+        q30 = PCM_GAIN_Q30_UNITY;
+    } else {
+        q30 = (int32_t)(volume * (float)PCM_GAIN_Q30_UNITY);
+    }
+    atomic_store_explicit(&target_q30, q30, memory_order_relaxed);
+}
+
+void audio_gain_reset(void) {
+    current_q30 = (int32_t)atomic_load_explicit(&target_q30, memory_order_relaxed);
+}
+
+void audio_gain_process(uint8_t *buf, size_t len, uint8_t bits, uint32_t sample_rate) {
+    const int32_t target = (int32_t)atomic_load_explicit(&target_q30, memory_order_relaxed);
+    const size_t frame = 2u * (bits / 8u);
+    const size_t frames = frame ? len / frame : 0;
+    if (frames == 0) {
+        return;
+    }
+
+    if (current_q30 == target) {
+        if (target == PCM_GAIN_Q30_UNITY) {
+            return;     // Bit-exact at full volume
+        }
+        if (target == 0) {
+            memset(buf, 0, frames * frame);
+            return;
+        }
+    }
+
+    // Move at most a full-scale swing per CONFIG_RX_VOLUME_RAMP_MS
+    int32_t next = target;
+    uint64_t ramp_frames = (uint64_t)sample_rate * CONFIG_RX_VOLUME_RAMP_MS / 1000u;
+    if (ramp_frames > frames) {
+        int32_t max_step = (int32_t)((uint64_t)PCM_GAIN_Q30_UNITY * frames / ramp_frames);
+        if (next > current_q30 + max_step) {
+            next = current_q30 + max_step;
+        } else if (next < current_q30 - max_step) {
+            next = current_q30 - max_step;
+        }
+    }
+
+    switch (bits) {
+        case 16:
+            pcm_gain_ramp_s16((int16_t *)buf, frames, current_q30, next, &dither);
+            break;
+        case 24:
+            pcm_gain_ramp_s24(buf, frames, current_q30, next, &dither);
+            break;
+        case 32:
+            pcm_gain_ramp_s32((int32_t *)buf, frames, current_q30, next, &dither);
+            break;
+        default:
+            break;
+    }
+    current_q30 = next;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Software volume for receiver playout (CONFIG_RX_VOLUME_SOFTWARE).
+ *
+ * Scales each playout chunk once, before the sinks, so USB and S/PDIF play
+ * the same level. A new setting is reached over CONFIG_RX_VOLUME_RAMP_MS
+ * with a per-frame ramp; at full volume chunks pass through untouched.
+ * Requantization after scaling is TPDF-dithered when CONFIG_RX_VOLUME_DITHER
+ * is set. audio_gain_set() may be called from any task; the rest is
+ * consumer (pcm_handler) only.
+ */
+
+/**
+ * @brief Set the target volume
+ *
+ * @param volume Linear 0.0-1.0, as lifecycle_get_volume()
+ */
+void audio_gain_set(float volume);
+
+/**
+ * @brief Jump straight to the target (stream start), skipping the ramp
+ */
+void audio_gain_reset(void);
+
+/**
+ * @brief Apply the volume to one playout chunk in place
+ *
+ * @param buf Host-order stereo PCM at the playout width
+ * @param len Bytes
+ * @param bits Playout sample width (16, 24 or 32)
+ * @param sample_rate Playout rate, for the ramp length
+ */
+void audio_gain_process(uint8_t *buf, size_t len, uint8_t bits, uint32_t sample_rate);
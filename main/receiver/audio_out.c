@@ -5,17 +5,38 @@
 #include <inttypes.h>
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "log_rate.h"
 #include "audio_out.h"
+#include "audio_sink.h"
+#include "audio_gain.h"
+#include "eq.h"
+#include "plc.h"
+#include "mixer.h"
+#include "stream_switch.h"
+#include "resampler.h"
+#include "clock_steer.h"
 #include "config/config_manager.h"
-#include "spdif_out.h"
 #include "usb_out.h"
+#include "metrics.h"
+#include "metrics_profile.h"
+#include "lifecycle/cpu_governor.h"
+#include "lifecycle/pipeline_topology.h"
 #include "sdkconfig.h"
 #include "esp_timer.h"
+#include <stdatomic.h>
+#include <string.h>
+#ifdef CONFIG_RTP_LATENCY_PROBE
+#include "clock/clock_service.h"
+#endif
 
 // Low-rate summary interval default if not provided by Kconfig (declared in rtcp_receiver.c as well)
 #ifndef CONFIG_AUDIO_OUT_LOG_SUMMARY_INTERVAL_MS
 #define CONFIG_AUDIO_OUT_LOG_SUMMARY_INTERVAL_MS 10000
 #endif
+// Upper bound on how long pcm_handler sleeps on an empty buffer; keeps silence tracking ticking
+#ifndef AUDIO_OUT_IDLE_WAIT_MS
+#define AUDIO_OUT_IDLE_WAIT_MS 10
+#endif
 // USB out component now manages its own device handle internally
 // We don't need to store the handle here anymore
 
@@ -23,10 +44,46 @@ bool playing = true;
 
 uint8_t volume = 100;
 uint8_t silence[32] = {0};
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+// Resampled chunk; a frame or two longer than the input at most
+static uint8_t resample_buf[PCM_CHUNK_MAX_SIZE + RESAMPLER_OUT_SLACK_BYTES];
+#endif
+// Running average of a latency over 2^n chunks, min/max since the last read
+#define AUDIO_OUT_LATENCY_AVG_SHIFT 4
+typedef struct {
+    atomic_uint_fast32_t avg_us;
+    atomic_uint_fast32_t min_us;
+    atomic_uint_fast32_t max_us;
+} latency_stat_t;
+#define LATENCY_STAT_INIT { 0, UINT32_MAX, 0 }
+// Wire-to-output latency of every chunk that crossed the network
+static latency_stat_t wire_latency = LATENCY_STAT_INIT;
+#ifdef CONFIG_RTP_LATENCY_PROBE
+static latency_stat_t probe_network = LATENCY_STAT_INIT;
+static latency_stat_t probe_buffer = LATENCY_STAT_INIT;
+static latency_stat_t probe_output = LATENCY_STAT_INIT;
+static latency_stat_t probe_total = LATENCY_STAT_INIT;
+static atomic_uint_fast32_t probe_count = 0;
+#endif
 bool is_silent = false;
 uint32_t silence_duration_ms = 0;
 TickType_t last_audio_time = 0;
 
+static TaskHandle_t pcm_task = NULL;
+static atomic_bool parked = false;
+static atomic_bool outputs_changed = false;   // audio_out_outputs_changed() not yet picked up
+static atomic_bool muted = false;             // audio_out_set_muted(); not a stored setting
+// esp_timer milliseconds of the last wake from silence sleep, 0 once the first chunk played
+static atomic_uint_fast32_t wake_ms = 0;
+static const uint32_t wake_bounds_ms[] = {10, 25, 50, 100, 250, 500, 1000, 2500};
+// Dequeue of the next chunk, ring handback included (CONFIG_METRICS_PROFILER)
+static metrics_profile_t prof_pop = METRICS_PROFILE_INIT("out_pop_chunk", "Jitter buffer dequeue");
+
+static metrics_histogram_t wake_hist =
+    METRICS_HISTOGRAM_INIT("audio_wake_to_first_sample_ms",
+                           "Wake from silence sleep to the first chunk written to the outputs",
+                           wake_bounds_ms);
+
 // Low-rate Audio structured summary; prints once per CONFIG_AUDIO_OUT_LOG_SUMMARY_INTERVAL_MS
 static void audio_log_summary_if_due(void) {
     static uint64_t last_sum_us = 0;
@@ -55,28 +112,208 @@ static void audio_log_summary_if_due(void) {
 
     ESP_LOGI(TAG, "Audio sum: playing=%d mode=%s last_ms=%u silent_ms=%u",
              playing ? 1 : 0, mode_str, last_ms, silent_ms);
+    // Peek without restarting min/max; the web UI reads them through audio_out_get_latency()
+    uint32_t lat_avg = atomic_load_explicit(&wire_latency.avg_us, memory_order_relaxed);
+    if (lat_avg) {
+        ESP_LOGI(TAG, "Audio latency: wire-to-output avg=%u us%s",
+                 (unsigned)lat_avg, lifecycle_get_low_latency() ? " (low-latency mode)" : "");
+    }
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    uint32_t e2e_avg = atomic_load_explicit(&probe_total.avg_us, memory_order_relaxed);
+    if (e2e_avg) {
+        ESP_LOGI(TAG, "Audio latency: capture-to-output avg=%u us (network %u, buffer %u, output %u)",
+                 (unsigned)e2e_avg,
+                 (unsigned)atomic_load_explicit(&probe_network.avg_us, memory_order_relaxed),
+                 (unsigned)atomic_load_explicit(&probe_buffer.avg_us, memory_order_relaxed),
+                 (unsigned)atomic_load_explicit(&probe_output.avg_us, memory_order_relaxed));
+    }
+#endif
+    if (mode == MODE_RECEIVER_USB) {
+        for (size_t i = 0; i < USB_OUT_MAX_DEVICES; i++) {
+            if (i > 0 && !usb_out_device_is_connected(i)) {
+                continue;
+            }
+            usb_out_tx_stats_t us;
+            usb_out_get_device_tx_stats(i, &us);
+            ESP_LOGI(TAG, "Audio usb%u: queued=%u/%u dropped=%u failed=%u tx_done=%u bits=%u",
+                     (unsigned)i, (unsigned)us.queued_bytes, (unsigned)us.queue_size, (unsigned)us.dropped_bytes,
+                     (unsigned)us.failed_bytes, (unsigned)us.tx_done_events, (unsigned)us.bus_bits);
+        }
+    }
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+    resampler_stats_t rs;
+    resampler_get_stats(&rs);
+    ESP_LOGI(TAG, "Audio resample: rate=%+.3f ppm pll=%+.3f ppm in=%u out=%u frames",
+             rs.ratio_ppb / 1000.0f, rs.pll_ppb / 1000.0f,
+             (unsigned)rs.frames_in, (unsigned)rs.frames_out);
+#endif
+#ifdef CONFIG_RX_EQ_ENABLED
+    eq_stats_t es;
+    eq_get_stats(&es);
+    if (es.bands || es.crossover_hz) {
+        ESP_LOGI(TAG, "Audio eq: bands=%u xover=%u Hz cycles avg=%u max=%u budget=%u (%u%% load)",
+                 es.bands, es.crossover_hz, (unsigned)es.cycles_avg, (unsigned)es.cycles_max,
+                 (unsigned)es.budget_cycles,
+                 (unsigned)(es.budget_cycles ? (uint64_t)es.cycles_avg * 100u / es.budget_cycles : 0));
+    }
+#endif
+#ifdef CONFIG_RX_CLOCK_STEER_ENABLED
+    clock_steer_stats_t cs;
+    clock_steer_get_stats(&cs);
+    ESP_LOGI(TAG, "Audio clock: offset=%+.3f ppm pll=%+.3f ppm retunes=%u",
+             cs.applied_ppb / 1000.0f, cs.pll_ppb / 1000.0f, (unsigned)cs.retunes);
+#endif
+}
+// pcm_handler is the only writer; readers restart min/max
+static void latency_stat_observe(latency_stat_t *stat, uint32_t lat) {
+    uint32_t avg = atomic_load_explicit(&stat->avg_us, memory_order_relaxed);
+    avg = avg ? (uint32_t)((int64_t)avg + (((int64_t)lat - avg) >> AUDIO_OUT_LATENCY_AVG_SHIFT)) : lat;
+    atomic_store_explicit(&stat->avg_us, avg, memory_order_relaxed);
+    if (lat < atomic_load_explicit(&stat->min_us, memory_order_relaxed)) {
+        atomic_store_explicit(&stat->min_us, lat, memory_order_relaxed);
+    }
+    if (lat > atomic_load_explicit(&stat->max_us, memory_order_relaxed)) {
+        atomic_store_explicit(&stat->max_us, lat, memory_order_relaxed);
+    }
+}
+
+static void latency_stat_read(latency_stat_t *stat, audio_out_latency_t *out) {
+    out->avg_us = atomic_load_explicit(&stat->avg_us, memory_order_relaxed);
+    uint32_t min_us = atomic_exchange_explicit(&stat->min_us, UINT32_MAX, memory_order_relaxed);
+    out->min_us = min_us == UINT32_MAX ? 0 : min_us;
+    out->max_us = atomic_exchange_explicit(&stat->max_us, 0, memory_order_relaxed);
+}
+
+static uint32_t elapsed_us(int64_t from_us, int64_t to_us) {
+    return to_us > from_us ? (uint32_t)(to_us - from_us) : 0;
 }
+
+// A chunk that arrived at arrival_us has just been queued; it reaches the wire after the sinks' delay
+static void audio_out_track_latency(const packet_with_ts_t *packet) {
+    if (packet->arrival_us == 0) {
+        return;     // Concealment never crossed the wire
+    }
+    int64_t now_us = esp_timer_get_time();
+    uint32_t buffered = elapsed_us((int64_t)packet->arrival_us, now_us);
+    uint32_t output = audio_sinks_latency_us();
+    latency_stat_observe(&wire_latency, buffered + output);
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    // The sender's capture time is only comparable with ours on a shared master clock
+    if (packet->capture_us != 0 && clock_service_is_locked()) {
+        uint32_t network = elapsed_us((int64_t)packet->capture_us, (int64_t)packet->arrival_us);
+        latency_stat_observe(&probe_network, network);
+        latency_stat_observe(&probe_buffer, buffered);
+        latency_stat_observe(&probe_output, output);
+        latency_stat_observe(&probe_total, network + buffered + output);
+        atomic_fetch_add_explicit(&probe_count, 1, memory_order_relaxed);
+    }
+#endif
+}
+
+// First chunk out after a wake: how long the listener waited
+static void audio_out_track_wake(void) {
+    uint32_t woke = atomic_exchange_explicit(&wake_ms, 0, memory_order_relaxed);
+    if (woke == 0) {
+        return;
+    }
+    uint32_t waited = (uint32_t)(esp_timer_get_time() / 1000) - woke;
+    metrics_histogram_observe(&wake_hist, waited);
+    ESP_LOGI(TAG, "Wake to first sample: %" PRIu32 " ms", waited);
+}
+
+void audio_out_mark_wake(void) {
+    // The monitor repeats the wake request until it is handled; keep the first one
+    uint_fast32_t none = 0;
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    atomic_compare_exchange_strong_explicit(&wake_ms, &none, now ? now : 1,
+                                            memory_order_relaxed, memory_order_relaxed);
+}
+
+void audio_out_set_parked(bool park) {
+    atomic_store(&parked, park);
+    if (park) {
+        // Nothing more goes out; drop what the sinks still hold
+        atomic_store_explicit(&wake_ms, 0, memory_order_relaxed);
+        audio_sinks_drain();
+    } else if (pcm_task) {
+        xTaskNotifyGive(pcm_task);
+    }
+}
+
+void audio_out_get_latency(audio_out_latency_t *latency) {
+    if (!latency) {
+        return;
+    }
+    latency_stat_read(&wire_latency, latency);
+}
+
+void audio_out_get_probe_latency(audio_out_probe_latency_t *probe) {
+    if (!probe) {
+        return;
+    }
+    memset(probe, 0, sizeof(*probe));
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    probe->probes = atomic_load_explicit(&probe_count, memory_order_relaxed);
+    latency_stat_read(&probe_network, &probe->network);
+    latency_stat_read(&probe_buffer, &probe->buffer);
+    latency_stat_read(&probe_output, &probe->output);
+    latency_stat_read(&probe_total, &probe->total);
+#endif
+}
+
+// Volume the outputs play at: the setting, or silence while muted
+static float playout_volume(void) {
+    return atomic_load(&muted) ? 0.0f : lifecycle_get_volume();
+}
+
+// DAC volume in usb_out_set_volume()'s 0-100 range; fixed at full when the gain is applied in software
+static float usb_dac_volume(void) {
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+    return 100.0f;
+#else
+    return playout_volume() * 100.0f;
+#endif
+}
+
 // Configuration change handler for audio output
 esp_err_t audio_out_update_volume(void) {
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+    // Every sink plays the scaled stream; pcm_handler ramps to the new level
+    float new_volume = playout_volume();
+    ESP_LOGI(TAG, "Updating playout volume to %.2f", new_volume);
+    audio_gain_set(new_volume);
+#else
     device_mode_t mode = lifecycle_get_device_mode();
     
     if (mode == MODE_RECEIVER_USB) {
         if (usb_out_is_connected() && playing) {
-            float new_volume = lifecycle_get_volume();
-            ESP_LOGI(TAG, "Updating USB volume to %.2f", new_volume);
-            // usb_out_set_volume expects 0-100 range
+            float new_volume = usb_dac_volume();
+            ESP_LOGI(TAG, "Updating USB volume to %.0f%%", new_volume);
             return usb_out_set_volume(new_volume);
         }
     } else if (mode == MODE_RECEIVER_SPDIF) {
         // SPDIF doesn't support volume control directly
         ESP_LOGD(TAG, "SPDIF output does not support volume control");
     }
+#endif
     
     return ESP_OK;
 }
 
+esp_err_t audio_out_set_muted(bool mute) {
+    if (atomic_exchange(&muted, mute) == mute) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Playout %s", mute ? "muted" : "unmuted");
+    return audio_out_update_volume();
+}
+
+bool audio_out_is_muted(void) {
+    return atomic_load(&muted);
+}
+
 bool is_playing() {
-    return playing;
+    return playing && !atomic_load(&parked);
 }
 
 void resume_playback() {
@@ -91,7 +328,7 @@ void resume_playback() {
                      lifecycle_get_sample_rate(), lifecycle_get_bit_depth());
             
             // Update volume to current setting
-            usb_out_set_volume(lifecycle_get_volume());
+            usb_out_set_volume(usb_dac_volume());
             playing = true;
         } else {
             ESP_LOGI(TAG, "Cannot resume USB playback - No DAC connected");
@@ -131,16 +368,21 @@ void stop_playback() {
     playing = false;
     ESP_LOGI(TAG, "Stop Playback");
     
+    // USB flushes its queue; S/PDIF needs no explicit stop
+    audio_sinks_drain();
+}
+
+uint8_t audio_out_sample_bits(void) {
+    uint8_t bits = lifecycle_get_bit_depth();
     device_mode_t mode = lifecycle_get_device_mode();
-    
-    if (mode == MODE_RECEIVER_USB) {
-        if (usb_out_is_connected()) {
-            usb_out_stop_playback();
-        }
-    } else if (mode == MODE_RECEIVER_SPDIF) {
-        // SPDIF doesn't need explicit stop
-        ESP_LOGD(TAG, "SPDIF output stopped");
+    bool spdif = (mode == MODE_RECEIVER_SPDIF);
+#ifdef CONFIG_RX_SPDIF_MIRROR
+    spdif = spdif || mode == MODE_RECEIVER_USB;
+#endif
+    if (spdif && bits > 24) {
+        bits = 24;
     }
+    return bits;
 }
 
 void audio_direct_write(uint8_t *data) {
@@ -149,20 +391,79 @@ void audio_direct_write(uint8_t *data) {
     silence_duration_ms = 0;
     last_audio_time = xTaskGetTickCount();
     
+#ifdef CONFIG_RX_EQ_ENABLED
+    eq_process(data, buffer_get_chunk_size(), audio_out_sample_bits(), lifecycle_get_sample_rate());
+#endif
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+    audio_gain_process(data, buffer_get_chunk_size(), audio_out_sample_bits(), lifecycle_get_sample_rate());
+#endif
+    if (audio_sinks_write(data, buffer_get_chunk_size()) == ESP_ERR_INVALID_STATE) {
+        // Output is gone - we should be in sleep mode
+        ESP_LOGD(TAG, "Direct write with no output available");
+    }
+}
+
+// First chunk at a new stream rate: the outputs switch at this boundary while the
+// ring keeps its depth. Rate-dependent playout state starts over.
+static void audio_out_change_rate(uint32_t from, uint32_t to, bool steer) {
+    ESP_LOGI(TAG, "Stream rate %" PRIu32 " -> %" PRIu32 " Hz at chunk boundary", from, to);
+    if (audio_sinks_set_rate(to) != ESP_OK) {
+        // The output can't play the rate; restart the mode around it as before
+        ESP_LOGE(TAG, "Output cannot switch to %" PRIu32 " Hz, restarting playout", to);
+        lifecycle_manager_post_event(LIFECYCLE_EVENT_SAMPLE_RATE_CHANGE);
+    }
+    plc_reset();
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+    resampler_reset();
+#endif
+#ifdef CONFIG_RX_EQ_ENABLED
+    eq_reset();
+#endif
+    if (steer) {
+        // The transmitter came back at its nominal clock
+        clock_steer_reset();
+    }
+}
+
+// Open the mode's outputs and reset the playout state that depends on them
+static void pcm_handler_open_outputs(uint32_t *out_rate, bool *steer, bool *resample) {
     device_mode_t mode = lifecycle_get_device_mode();
-    
-    if (mode == MODE_RECEIVER_USB) {
-        // Check if USB device is connected before writing
-        if (usb_out_is_connected()) {
-            usb_out_write(data, PCM_CHUNK_SIZE, portMAX_DELAY);
-        } else {
-            // DAC is not connected - we should be in sleep mode
-            ESP_LOGD(TAG, "Attempted USB write with no DAC");
-        }
-    } else if (mode == MODE_RECEIVER_SPDIF) {
-        spdif_write(data, PCM_CHUNK_SIZE);
-    } else {
-        ESP_LOGW(TAG, "Direct write attempted in unsupported mode: %d", mode);
+    // Outputs are fixed until the mode changes (audio_out_outputs_changed())
+    if (audio_sinks_open() != ESP_OK) {
+        ESP_LOGE(TAG, "No audio output for mode %d", mode);
+    }
+    // Rate the outputs play at; follows the chunks' stamped rate
+    *out_rate = lifecycle_get_sample_rate();
+    plc_reset();
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+    audio_gain_set(playout_volume());
+    audio_gain_reset();
+#endif
+#ifdef CONFIG_RX_CLOCK_STEER_ENABLED
+    // Moving the output clock beats resampling when the hardware allows it
+    clock_steer_reset();
+    *steer = clock_steer_available();
+    ESP_LOGI(TAG, "Output clock steering %s", *steer ? "active" : "unavailable on this output");
+#else
+    *steer = false;
+#endif
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+    resampler_reset();
+    *resample = !*steer && resampler_available();
+    ESP_LOGI(TAG, "Drift resampler %s", *resample ? "active" :
+             *steer ? "idle (clock steered)" : "unavailable at this sample width");
+#else
+    *resample = false;
+#endif
+#ifdef CONFIG_RX_EQ_ENABLED
+    eq_reset();
+#endif
+}
+
+void audio_out_outputs_changed(void) {
+    atomic_store(&outputs_changed, true);
+    if (pcm_task) {
+        xTaskNotifyGive(pcm_task);
     }
 }
 
@@ -170,40 +471,115 @@ void pcm_handler(void* pvParams) {
     // Initialize the last audio time to current time
     last_audio_time = xTaskGetTickCount();
     
-    device_mode_t mode = lifecycle_get_device_mode();
-    ESP_LOGI(TAG, "PCM handler started for mode: %d", mode);
+    ESP_LOGI(TAG, "PCM handler started for mode: %d", lifecycle_get_device_mode());
+    atomic_store(&outputs_changed, false);
+    uint32_t out_rate;
+    bool steer;
+    bool resample;
+    pcm_handler_open_outputs(&out_rate, &steer, &resample);
+    // Playout bytes per second, for reporting trims in microseconds
+    uint32_t out_bytes_per_sec = out_rate * 2u * (audio_out_sample_bits() / 8u);
+    bool content_sleep_posted = false;  // Sleep already requested for this stretch of silent content
     
     while (true) {
         // Periodic Audio summary (low rate)
         audio_log_summary_if_due();
 
-        if (playing) {
+        if (atomic_exchange(&outputs_changed, false)) {
+            // Switched to the other receiver mode under this task: play on its outputs
+            ESP_LOGI(TAG, "PCM handler reopening outputs for mode: %d", lifecycle_get_device_mode());
+            pcm_handler_open_outputs(&out_rate, &steer, &resample);
+            out_bytes_per_sec = out_rate * 2u * (audio_out_sample_bits() / 8u);
+        }
+
+        if (playing && !atomic_load(&parked)) {
+            uint32_t prof_start = metrics_profile_begin();
+#ifdef CONFIG_RX_GAPLESS_SWITCH
+            // Mid-switch the new stream's prebuffer plays while the ring refills with it
+            packet_with_ts_t *packet = stream_switch_playing() ? stream_switch_pop() : pop_chunk();
+#else
             packet_with_ts_t *packet = pop_chunk();
+#endif
+            metrics_profile_end(&prof_pop, prof_start);
             TickType_t current_time = xTaskGetTickCount();
             
             if (packet) {
+                uint32_t work_start = cpu_governor_begin();
                 if (is_silent) {
                     is_silent = false;
                 }
                 silence_duration_ms = 0;
                 last_audio_time = xTaskGetTickCount(); // Reset to current time
+
+                // A sender streaming digital silence still delivers chunks; sleep on the
+                // content instead. The chunks keep playing so the buffer resumes instantly.
+                uint32_t content_silence_ms = lifecycle_manager_get_content_silence_ms();
+                if (content_silence_ms >= lifecycle_get_silence_threshold_ms()) {
+                    if (!content_sleep_posted) {
+                        ESP_LOGI(TAG, "Stream below amplitude %u for %" PRIu32 " ms, entering sleep mode",
+                                 lifecycle_get_silence_amplitude_threshold(), content_silence_ms);
+                        content_sleep_posted = true;
+                        lifecycle_manager_post_event(LIFECYCLE_EVENT_ENTER_SLEEP);
+                    }
+                } else {
+                    content_sleep_posted = false;
+                }
                 
                 // Validate skip_bytes doesn't exceed chunk size
-                if (packet->skip_bytes >= PCM_CHUNK_SIZE) {
-                    ESP_LOGE(TAG, "Invalid skip_bytes %u >= chunk size %d, dropping packet",
-                            packet->skip_bytes, PCM_CHUNK_SIZE);
+                const uint32_t chunk_bytes = buffer_get_chunk_size();
+                if (packet->skip_bytes >= chunk_bytes) {
+                    LOG_RATE_E(TAG, "Invalid skip_bytes %u >= chunk size %u, dropping packet",
+                               packet->skip_bytes, chunk_bytes);
                     continue;
                 }
+
+                if (packet->sample_rate != 0 && packet->sample_rate != out_rate) {
+                    audio_out_change_rate(out_rate, packet->sample_rate, steer);
+                    out_rate = packet->sample_rate;
+                    out_bytes_per_sec = out_rate * 2u * (audio_out_sample_bits() / 8u);
+                }
                 
+                // Conceal chunks that never arrived; remember good ones for the next loss
+                plc_process(packet->packet_buffer, chunk_bytes,
+                            (packet->flags & PACKET_FLAG_CONCEALED) != 0);
+#ifdef CONFIG_RX_GAPLESS_SWITCH
+                // Fade toward the stream being switched to
+                stream_switch_mix(packet->packet_buffer, chunk_bytes);
+#endif
+#ifdef CONFIG_RX_MIX_ENABLED
+                // Overlay other sources due at the same time
+                mixer_mix(packet->packet_buffer, chunk_bytes, packet->timestamp);
+#endif
+
                 // Get audio start position and length based on skip_bytes
                 uint8_t *audio_start = packet->packet_buffer + packet->skip_bytes;
-                int audio_len = PCM_CHUNK_SIZE - packet->skip_bytes;
+                int audio_len = (int)chunk_bytes - packet->skip_bytes;
+                if (steer) {
+                    clock_steer_update();
+                }
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+                if (resample && audio_len > 0) {
+                    resampler_update();
+                    audio_len = (int)resampler_process(audio_start, (size_t)audio_len,
+                                                       resample_buf, sizeof(resample_buf));
+                    audio_start = resample_buf;
+                }
+#endif
+#ifdef CONFIG_RX_EQ_ENABLED
+                if (audio_len > 0) {
+                    eq_process(audio_start, (size_t)audio_len, audio_out_sample_bits(), out_rate);
+                }
+#endif
+#ifdef CONFIG_RX_VOLUME_SOFTWARE
+                if (audio_len > 0) {
+                    audio_gain_process(audio_start, (size_t)audio_len, audio_out_sample_bits(), out_rate);
+                }
+#endif
                 
                 if (packet->skip_bytes > 0) {
-                    // Log every skip event with details
-                    ESP_LOGI(TAG, "Audio trim: skipping %u bytes, playing %d bytes (%.2f ms trimmed)",
-                            packet->skip_bytes, audio_len,
-                            (float)packet->skip_bytes / 192.0f);  // 192 bytes/ms at 48kHz stereo 16-bit
+                    LOG_RATE_D(TAG, "Audio trim: skipping %u bytes, playing %d bytes (%u us trimmed)",
+                               packet->skip_bytes, audio_len,
+                               (unsigned)(out_bytes_per_sec ? (uint64_t)packet->skip_bytes * 1000000u / out_bytes_per_sec : 0));
                     
                     // Periodic summary
                     static uint32_t total_skipped_bytes = 0;
@@ -212,41 +588,45 @@ void pcm_handler(void* pvParams) {
                     skip_count++;
                     
                     if (skip_count % 100 == 0) {
-                        ESP_LOGI(TAG, "Trim summary: %u packets trimmed, avg %u bytes/packet (%.2f ms/packet)",
-                                skip_count, total_skipped_bytes / skip_count,
-                                (float)(total_skipped_bytes / skip_count) / 192.0f);
+                        uint32_t avg_bytes = total_skipped_bytes / skip_count;
+                        ESP_LOGI(TAG, "Trim summary: %u packets trimmed, avg %u bytes/packet (%u us/packet)",
+                                skip_count, avg_bytes,
+                                (unsigned)(out_bytes_per_sec ? (uint64_t)avg_bytes * 1000000u / out_bytes_per_sec : 0));
                     }
                 }
                 
-                // Process the audio data based on current mode
-                if (mode == MODE_RECEIVER_USB) {
-                    if (usb_out_is_connected()) {
-                        // USB output - handle partial chunks properly
-                        if (audio_len > 0) {
-                            usb_out_write(audio_start, audio_len, portMAX_DELAY);
-                        } else {
-                            ESP_LOGW(TAG, "No audio data to write after skipping %u bytes", packet->skip_bytes);
-                        }
-                    } else {
-                        // DAC is not connected but we're trying to play - should enter sleep
-                        ESP_LOGW(TAG, "PCM handler tried to write with no USB DAC");
+                if (audio_len <= 0) {
+                    LOG_RATE_W(TAG, "No audio data to write after skipping %u bytes", packet->skip_bytes);
+                } else {
+                    // DSP done; the write may block on the outputs, which is not work
+                    cpu_governor_end(work_start);
+                    esp_err_t wr = audio_sinks_write(audio_start, (size_t)audio_len);
+                    if (wr == ESP_ERR_INVALID_STATE) {
+                        // Primary output is gone (DAC unplugged) - should enter sleep
+                        ESP_LOGW(TAG, "PCM handler tried to write with no output");
                         playing = false; // Force playback to stop
+                    } else if (wr == ESP_OK) {
+                        audio_out_track_latency(packet);
+                        if (!(packet->flags & PACKET_FLAG_CONCEALED)) {
+                            audio_out_track_wake();
+                        }
                     }
-                } else if (mode == MODE_RECEIVER_SPDIF) {
-                    // SPDIF output - handle partial chunks properly
-                    if (audio_len > 0) {
-                        spdif_write(audio_start, audio_len);
-                    } else {
-                        ESP_LOGW(TAG, "No audio data to write after skipping %u bytes", packet->skip_bytes);
-                    }
-                } else {
-                    ESP_LOGW(TAG, "PCM handler running in unsupported mode: %d", mode);
                 }
             } else {
                 // pop_chunk() returned NULL - NO PACKETS RECEIVED - THIS IS SILENCE!
                 if (!is_silent) {
                     is_silent = true;
                     last_audio_time = current_time; // Start the silence timer
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+                    // Stream will restart after rebuffering; don't interpolate across the gap
+                    resampler_reset();
+#endif
+#ifdef CONFIG_RX_EQ_ENABLED
+                    eq_reset();
+#endif
+                    if (steer) {
+                        clock_steer_reset();
+                    }
                 }
                 
                 // Calculate how long we've been in silence, handling tick counter rollover
@@ -277,11 +657,12 @@ void pcm_handler(void* pvParams) {
                             silence_duration_ms);
                     last_audio_time = current_time;
                 }
-                  vTaskDelay(pdMS_TO_TICKS(0));
+                // Sleep until the receiver commits another chunk (or the silence tick elapses)
+                buffer_wait_for_data(AUDIO_OUT_IDLE_WAIT_MS);
             }
         } else {
-            // Not playing, wait longer
-            vTaskDelay(pdMS_TO_TICKS(100));
+            // Not playing: wait longer. Parked: wait for the unpark, so idle light sleep is not cut short
+            ulTaskNotifyTake(pdTRUE, atomic_load(&parked) ? portMAX_DELAY : pdMS_TO_TICKS(100));
         }
     }
 }
@@ -290,9 +671,13 @@ void setup_audio() {
     device_mode_t mode = lifecycle_get_device_mode();
     ESP_LOGI(TAG, "Setting up audio for mode: %d", mode);
     
+    metrics_register(&wake_hist.base);
+    metrics_profile_register(&prof_pop);
+    atomic_store(&parked, false);
+
     // Create PCM handler task for all receiver modes
     if (mode == MODE_RECEIVER_USB || mode == MODE_RECEIVER_SPDIF) {
-        xTaskCreatePinnedToCore(pcm_handler, "pcm_handler", 4096, NULL, 5, NULL, 1);
+        pipeline_task_create(PIPELINE_STAGE_PLAYOUT, pcm_handler, "pcm_handler", 4096, NULL, &pcm_task);
         ESP_LOGI(TAG, "PCM handler task created");
     }
 }
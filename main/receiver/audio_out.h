@@ -1,6 +1,7 @@
 #pragma once
 #include "config.h"
 #include "esp_err.h"
+#include <stdint.h>
 
 // Forward declaration to avoid circular dependencies
 typedef void* audio_device_handle_t;
@@ -16,9 +17,50 @@ void stop_playback();
 void resume_playback();
 bool is_playing();
 
+// Silence sleep: a parked pcm_handler stops pulling chunks, so packets that arrive
+// while asleep wait in the jitter buffer (the outputs stay configured)
+void audio_out_set_parked(bool parked);
+// Switching between receiver modes keeps pcm_handler running: it reopens the
+// sinks for the new mode before its next chunk
+void audio_out_outputs_changed(void);
+// Start the wake-to-first-sample clock; the next chunk played observes it
+void audio_out_mark_wake(void);
+
+// Sample width of the playout (jitter buffer) format for the current receiver mode:
+// USB plays the stream's width, S/PDIF (or USB mirrored to S/PDIF) at most 24 bits.
+// Samples are host order, 24-bit packed in 3 bytes.
+uint8_t audio_out_sample_bits(void);
+
 // Audio data functions
 void audio_write(uint8_t* data);
 void audio_direct_write(uint8_t* data);
 
 // Volume control
-esp_err_t audio_out_update_volume(void);
\ No newline at end of file
+esp_err_t audio_out_update_volume(void);
+// Mute the outputs through the same path as the volume (the gain ramp or the DAC);
+// held in memory only, the stored volume is left alone
+esp_err_t audio_out_set_muted(bool mute);
+bool audio_out_is_muted(void);
+
+// Measured wire-to-output latency: chunk arrival to the moment it plays on the outputs
+typedef struct {
+    uint32_t avg_us;    // Running average
+    uint32_t min_us;    // Since the last read (0 if nothing played)
+    uint32_t max_us;
+} audio_out_latency_t;
+
+// Read the latency; min/max restart from the next chunk
+void audio_out_get_latency(audio_out_latency_t *latency);
+
+// Per-stage latency of chunks carrying a sender's latency probe (CONFIG_RTP_LATENCY_PROBE),
+// recorded while the master clock is locked
+typedef struct {
+    uint32_t probes;                // Probed chunks played since boot
+    audio_out_latency_t network;    // Sender capture to arrival in the jitter buffer
+    audio_out_latency_t buffer;     // Arrival to handoff to the outputs
+    audio_out_latency_t output;     // Output queue (DMA / USB ring) to the wire
+    audio_out_latency_t total;      // Capture to the wire
+} audio_out_probe_latency_t;
+
+// Read the probe latencies; min/max restart from the next probe
+void audio_out_get_probe_latency(audio_out_probe_latency_t *probe);
\ No newline at end of file
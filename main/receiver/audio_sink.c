@@ -0,0 +1,355 @@
+#include "audio_sink.h"
+#include "audio_out.h"
+#include "global.h"
+#include "build_config.h"
+#include "lifecycle_manager.h"
+#include "spdif_out.h"
+#include "usb_out.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "metrics_profile.h"
+#include "logging/event_trace.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <string.h>
+
+// Longest delay line; a larger latency gap means something is misconfigured
+#define AUDIO_SINK_MAX_DELAY_MS 200
+
+typedef struct {
+    const audio_sink_t *sink;
+    uint32_t latency_us;    // What the sink reported when the delay was planned
+    uint8_t *delay;         // Delay line, NULL when the sink needs none
+    size_t delay_len;
+    size_t delay_pos;
+} sink_slot_t;
+
+static sink_slot_t slots[AUDIO_SINK_MAX];
+static size_t slot_count = 0;
+static uint32_t sink_rate = 0;          // Rate the sinks play at (audio_sinks_set_rate)
+static uint32_t plan_rate = 0;
+static uint8_t plan_bits = 0;
+static uint32_t plan_latency_us = 0;    // Deepest sink; every output plays this far behind write
+static atomic_bool drained = false;
+
+// ---- USB DAC ----
+
+// Queueing for the USB tx task, waits for ring space included (CONFIG_METRICS_PROFILER)
+static metrics_profile_t prof_usb_write = METRICS_PROFILE_INIT("out_usb_write", "usb_out_write into the tx queue");
+
+static esp_err_t usb_sink_open(void) {
+    metrics_profile_register(&prof_usb_write);
+    // The DAC may enumerate later; write() reports it missing until then
+    return ESP_OK;
+}
+
+static esp_err_t usb_sink_write(const uint8_t *data, size_t len, TickType_t timeout) {
+    if (!usb_out_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t prof_start = metrics_profile_begin();
+    esp_err_t err = usb_out_write(data, len, timeout);
+    metrics_profile_end(&prof_usb_write, prof_start);
+    return err;
+}
+
+static void usb_sink_drain(void) {
+    if (usb_out_is_connected()) {
+        usb_out_stop_playback();
+    }
+}
+
+static esp_err_t usb_sink_set_rate(uint32_t sample_rate) {
+    return usb_out_set_sample_rate(sample_rate);
+}
+
+const audio_sink_t audio_sink_usb = {
+    .name = "usb",
+    .open = usb_sink_open,
+    .write = usb_sink_write,
+    .latency_us = usb_out_get_latency_us,
+    .drain = usb_sink_drain,
+    .set_rate = usb_sink_set_rate,
+};
+
+// ---- Further DACs behind a hub ----
+
+// Secondary DAC n: written without waiting like any secondary sink. usb_sink_set_rate()
+// on the primary already moves every DAC, so these have no set_rate of their own.
+#define USB_SINK_SECONDARY(n)                                                                   \
+    static esp_err_t usb##n##_sink_write(const uint8_t *data, size_t len, TickType_t timeout) { \
+        if (!usb_out_device_is_connected(n)) {                                                  \
+            return ESP_ERR_INVALID_STATE;                                                       \
+        }                                                                                       \
+        return usb_out_write_device(n, data, len, timeout);                                     \
+    }                                                                                           \
+    static uint32_t usb##n##_sink_latency_us(void) {                                            \
+        return usb_out_get_device_latency_us(n);                                                \
+    }                                                                                           \
+    static void usb##n##_sink_drain(void) {                                                     \
+        usb_out_stop_device_playback(n);                                                        \
+    }                                                                                           \
+    static const audio_sink_t audio_sink_usb##n = {                                             \
+        .name = "usb" #n,                                                                       \
+        .open = usb_sink_open,                                                                  \
+        .write = usb##n##_sink_write,                                                           \
+        .latency_us = usb##n##_sink_latency_us,                                                 \
+        .drain = usb##n##_sink_drain,                                                           \
+        .set_rate = NULL,                                                                       \
+    };
+
+#if USB_OUT_MAX_DEVICES > 1
+USB_SINK_SECONDARY(1)
+#endif
+#if USB_OUT_MAX_DEVICES > 2
+USB_SINK_SECONDARY(2)
+#endif
+
+static const audio_sink_t *const usb_secondary_sinks[] = {
+#if USB_OUT_MAX_DEVICES > 1
+    &audio_sink_usb1,
+#endif
+#if USB_OUT_MAX_DEVICES > 2
+    &audio_sink_usb2,
+#endif
+    NULL,
+};
+
+// ---- S/PDIF transmitter ----
+
+static esp_err_t spdif_sink_open(void) {
+    // Modes start the transmitter after pcm_handler; latency_us() reads 0 until
+    // then and the delay plan follows once it reports
+    return ESP_OK;
+}
+
+static esp_err_t spdif_sink_write(const uint8_t *data, size_t len, TickType_t timeout) {
+    bool s24 = audio_out_sample_bits() != 16;
+    if (timeout == 0) {
+        return spdif_write_timeout(data, len, s24, 0);
+    }
+    // As a primary, the transmitter's own CONFIG_SPDIF_WRITE_TIMEOUT_MS bound applies
+    if (s24) {
+        spdif_write_s24(data, len);
+    } else {
+        spdif_write(data, len);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t spdif_sink_set_rate(uint32_t sample_rate) {
+    // Rebuilds the transmitter; its buffering depth is kept
+    return spdif_set_sample_rates((int)sample_rate);
+}
+
+const audio_sink_t audio_sink_spdif = {
+    .name = "spdif",
+    .open = spdif_sink_open,
+    .write = spdif_sink_write,
+    .latency_us = spdif_get_latency_us,
+    .drain = NULL,      // The ring plays out in a few tens of ms
+    .set_rate = spdif_sink_set_rate,
+};
+
+// ---- Fan-out ----
+
+static void slot_free_delay(sink_slot_t *slot) {
+    heap_caps_free(slot->delay);
+    slot->delay = NULL;
+    slot->delay_len = 0;
+    slot->delay_pos = 0;
+}
+
+// Size every delay line so each sink's total latency matches the deepest one
+static void audio_sinks_plan(void) {
+    plan_rate = sink_rate;
+    plan_bits = audio_out_sample_bits();
+    const size_t frame = 2u * (plan_bits / 8u);
+    const uint64_t bytes_per_sec = (uint64_t)plan_rate * frame;
+
+    uint32_t max_us = 0;
+    for (size_t i = 0; i < slot_count; i++) {
+        slots[i].latency_us = slots[i].sink->latency_us();
+        if (slots[i].latency_us > max_us) {
+            max_us = slots[i].latency_us;
+        }
+    }
+    plan_latency_us = max_us;
+
+    for (size_t i = 0; i < slot_count; i++) {
+        sink_slot_t *slot = &slots[i];
+        slot_free_delay(slot);
+        uint32_t gap_us = max_us - slot->latency_us;
+        if (gap_us > AUDIO_SINK_MAX_DELAY_MS * 1000u) {
+            ESP_LOGW(TAG, "Sink %s: %" PRIu32 " us latency gap capped at %u ms",
+                     slot->sink->name, gap_us, AUDIO_SINK_MAX_DELAY_MS);
+            gap_us = AUDIO_SINK_MAX_DELAY_MS * 1000u;
+        }
+        size_t len = frame ? (size_t)(bytes_per_sec * gap_us / 1000000u) / frame * frame : 0;
+        if (len > 0) {
+            // Starts zeroed: the first gap_us of the stream plays as silence
+            slot->delay = heap_caps_calloc(1, len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!slot->delay) {
+                slot->delay = heap_caps_calloc(1, len, MALLOC_CAP_8BIT);
+            }
+            if (!slot->delay) {
+                ESP_LOGE(TAG, "Sink %s: no memory for %u byte delay line, playing undelayed",
+                         slot->sink->name, (unsigned)len);
+                len = 0;
+            }
+            slot->delay_len = len;
+        }
+        ESP_LOGI(TAG, "Sink %s: latency %" PRIu32 " us, delayed %u bytes",
+                 slot->sink->name, slot->latency_us, (unsigned)slot->delay_len);
+    }
+}
+
+static bool audio_sinks_plan_stale(void) {
+    if (plan_rate != sink_rate || plan_bits != audio_out_sample_bits()) {
+        return true;
+    }
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].sink->latency_us() != slots[i].latency_us) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void audio_sinks_add(const audio_sink_t *sink) {
+    esp_err_t err = sink->open();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Sink %s unavailable: %s", sink->name, esp_err_to_name(err));
+        return;
+    }
+    slots[slot_count++] = (sink_slot_t){ .sink = sink };
+}
+
+esp_err_t audio_sinks_open(void) {
+    for (size_t i = 0; i < slot_count; i++) {
+        slot_free_delay(&slots[i]);
+    }
+    slot_count = 0;
+
+    device_mode_t mode = lifecycle_get_device_mode();
+    if (mode == MODE_RECEIVER_USB) {
+        audio_sinks_add(&audio_sink_usb);
+        for (size_t i = 0; usb_secondary_sinks[i]; i++) {
+            audio_sinks_add(usb_secondary_sinks[i]);
+        }
+#ifdef CONFIG_RX_SPDIF_MIRROR
+        audio_sinks_add(&audio_sink_spdif);
+#endif
+    } else if (mode == MODE_RECEIVER_SPDIF) {
+        audio_sinks_add(&audio_sink_spdif);
+    }
+    if (slot_count == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    atomic_store(&drained, false);
+    sink_rate = lifecycle_get_sample_rate();
+    audio_sinks_plan();
+    return ESP_OK;
+}
+
+// Feed a sink through its delay line: play the oldest bytes, keep the new ones
+static esp_err_t slot_write(sink_slot_t *slot, const uint8_t *data, size_t len, TickType_t timeout) {
+    if (!slot->delay) {
+        return slot->sink->write(data, len, timeout);
+    }
+    esp_err_t ret = ESP_OK;
+    while (len > 0) {
+        size_t n = slot->delay_len - slot->delay_pos;
+        if (n > len) {
+            n = len;
+        }
+        // Sinks copy on write, so the slot can be refilled straight after
+        esp_err_t err = slot->sink->write(slot->delay + slot->delay_pos, n, timeout);
+        if (err != ESP_OK) {
+            ret = err;
+        }
+        memcpy(slot->delay + slot->delay_pos, data, n);
+        slot->delay_pos += n;
+        if (slot->delay_pos == slot->delay_len) {
+            slot->delay_pos = 0;
+        }
+        data += n;
+        len -= n;
+    }
+    return ret;
+}
+
+esp_err_t audio_sinks_write(const uint8_t *data, size_t len) {
+    if (slot_count == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    bool restart = atomic_exchange(&drained, false);
+    if (audio_sinks_plan_stale()) {
+        audio_sinks_plan();
+    } else if (restart) {
+        for (size_t i = 0; i < slot_count; i++) {
+            if (slots[i].delay) {
+                memset(slots[i].delay, 0, slots[i].delay_len);
+                slots[i].delay_pos = 0;
+            }
+        }
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = slot_write(&slots[0], data, len, portMAX_DELAY);
+    for (size_t i = 1; i < slot_count; i++) {
+        slot_write(&slots[i], data, len, 0);
+    }
+    event_trace_add(EVENT_TRACE_OUT_WRITE, ret != ESP_OK, event_trace_u16((int64_t)len),
+                    (int32_t)(esp_timer_get_time() - start_us));
+    return ret;
+}
+
+esp_err_t audio_sinks_set_rate(uint32_t sample_rate) {
+    if (slot_count == 0 || sample_rate == sink_rate) {
+        sink_rate = sample_rate;
+        return ESP_OK;
+    }
+    // What the outputs hold is old-rate audio; let it reach the wire first
+    if (plan_latency_us > 0) {
+        vTaskDelay(pdMS_TO_TICKS((plan_latency_us + 999u) / 1000u));
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < slot_count; i++) {
+        if (!slots[i].sink->set_rate) {
+            continue;
+        }
+        esp_err_t err = slots[i].sink->set_rate(sample_rate);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Sink %s: cannot play %" PRIu32 " Hz: %s",
+                     slots[i].sink->name, sample_rate, esp_err_to_name(err));
+            if (i == 0) {
+                ret = err;
+            }
+        }
+    }
+    ESP_LOGI(TAG, "Sinks now at %" PRIu32 " Hz (was %" PRIu32 ")", sample_rate, sink_rate);
+    sink_rate = sample_rate;
+    audio_sinks_plan();
+    return ret;
+}
+
+void audio_sinks_drain(void) {
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].sink->drain) {
+            slots[i].sink->drain();
+        }
+    }
+    atomic_store(&drained, true);
+}
+
+size_t audio_sinks_count(void) {
+    return slot_count;
+}
+
+uint32_t audio_sinks_latency_us(void) {
+    return plan_latency_us;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "esp_err.h"
+#include "usb_out.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Playout outputs behind pcm_handler.
+ *
+ * Each output (USB DAC, S/PDIF transmitter) is an audio_sink_t; with
+ * CONFIG_USB_OUT_MAX_DEVICES above 1, every further DAC behind a hub is one too. The sinks for
+ * the receiver mode are picked once by audio_sinks_open(), so the chunk loop
+ * makes a single audio_sinks_write() call instead of branching on the mode.
+ * Every sink gets the same playout-format chunk (see audio_out_sample_bits()).
+ *
+ * The first sink is the primary: it is written with a blocking wait and paces
+ * pcm_handler. Any further sink is written without waiting, so a slow or
+ * drifting secondary drops data instead of stalling the primary. Sinks buffer
+ * different amounts before the wire; each one that buffers less than the
+ * deepest is fed through a delay line holding the difference, so all outputs
+ * play a given sample together. Consumer (pcm_handler) only, apart from
+ * audio_sinks_drain().
+ */
+
+typedef struct {
+    const char *name;
+    // Prepare for playout; an error leaves the sink out of the mode
+    esp_err_t (*open)(void);
+    // Queue whole frames; ESP_ERR_INVALID_STATE means the output has gone away
+    esp_err_t (*write)(const uint8_t *data, size_t len, TickType_t timeout);
+    // Delay from write() to the wire when the sink's queue is kept full, microseconds
+    uint32_t (*latency_us)(void);
+    // Drop what is queued (playback stopped); may be NULL
+    void (*drain)(void);
+    // Move the output to a new sample rate; what is queued may be dropped. NULL if fixed
+    esp_err_t (*set_rate)(uint32_t sample_rate);
+} audio_sink_t;
+
+// Every DAC slot and the S/PDIF transmitter
+#define AUDIO_SINK_MAX (USB_OUT_MAX_DEVICES + 1)
+
+extern const audio_sink_t audio_sink_usb;
+extern const audio_sink_t audio_sink_spdif;
+
+/**
+ * @brief Pick and open the sinks for the current receiver mode
+ *
+ * USB mode plays to the DAC (the first one to enumerate, plus every further
+ * DAC slot), and the S/PDIF transmitter when CONFIG_RX_SPDIF_MIRROR is set;
+ * S/PDIF mode plays to the transmitter.
+ *
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if no sink could be opened
+ */
+esp_err_t audio_sinks_open(void);
+
+/**
+ * @brief Play one chunk on every open sink
+ *
+ * Delay lines are re-planned when the playout format or a sink's latency
+ * changes.
+ *
+ * @return The primary sink's result
+ */
+esp_err_t audio_sinks_write(const uint8_t *data, size_t len);
+
+/**
+ * @brief Move every sink to a new sample rate at a chunk boundary
+ *
+ * Waits for the sinks to play out what they hold at the old rate, then
+ * reconfigures them and re-plans the delay lines. Consumer only; sinks start
+ * at the configured rate when opened.
+ *
+ * @return The primary sink's result
+ */
+esp_err_t audio_sinks_set_rate(uint32_t sample_rate);
+
+/**
+ * @brief Drop queued audio on every sink; delay lines restart silent
+ *
+ * Safe to call from outside pcm_handler.
+ */
+void audio_sinks_drain(void);
+
+// Sinks opened by the last audio_sinks_open()
+size_t audio_sinks_count(void);
+
+// Delay from audio_sinks_write() to the wire, the same on every sink once delay lines are planned
+uint32_t audio_sinks_latency_us(void);
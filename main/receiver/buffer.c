@@ -1,188 +1,1135 @@
 #include "buffer.h"
-#include "esp_psram.h"
+#include "audio_out.h"
+#include "resampler.h"
 #include "global.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
+#include <stdatomic.h>
 #include "esp_log.h"
-#include "esp_psram.h"
+#include "log_rate.h"
+#include "metrics.h"
+#include "metrics_bench.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
 #include "esp_timer.h"
+#include "audio_arena.h"
 #include "lifecycle_manager.h"
+#include "build_config.h"
+#include "logging/event_trace.h"
+
+/*
+ * Sequence-indexed jitter ring, single producer / single consumer.
+ *
+ * Producer: udp_handler (push/reserve/commit). Consumer: pcm_handler (pop_chunk).
+ * Chunks are placed by chunk sequence number (derived from the RTP timestamp by the
+ * receiver): slot = seq & ring_mask. The consumer plays read_seq, read_seq + 1, ...
+ * so a packet that arrives out of order but before its turn lands in the right place.
+ *
+ * Each slot has one atomic state word holding the low bits of the sequence it was
+ * last used for (tag) plus a state. Producer and consumer only ever claim a slot by
+ * CAS on that word, which is what arbitrates a late write against the consumer
+ * concealing the same sequence. A slot whose tag is older than the sequence being
+ * written is stale and free for reuse, so advancing read_seq (trim) never needs to
+ * touch slots.
+ *
+ * read_seq is consumer-owned while the ring is anchored. When unanchored (after setup
+ * or a flush/resync) the producer seeds read_seq/head from the first chunk it sees
+ * and then publishes `anchored`, handing read_seq back to the consumer.
+ *
+ * Playout scheduling: pop_chunk() never spins. If the next chunk is not due yet it
+ * arms a one-shot esp_timer for the chunk's playout time and blocks on a task
+ * notification; chunks that are already late are released immediately. A missing
+ * chunk is held open until its expected playout time (derived from the next chunk
+ * that did arrive) and is then handed out zeroed with PACKET_FLAG_CONCEALED set.
+ * When the ring is empty the consumer parks in buffer_wait_for_data().
+ *
+ * Latency control: an underrun grows target_buffer_size by the configured step. After
+ * CONFIG_RX_LATENCY_SHRINK_CLEAN_MS without an underrun the target drops by one chunk,
+ * never below the initial size or what the reported interarrival jitter needs. The
+ * surplus is drained gradually by trimming a few frames (skip_bytes) off chunks that
+ * are already due, so the depth comes down without an audible jump. With the drift
+ * resampler (resampler.c) active, trimming is off and the playout rate does it.
+ *
+ * Low-latency mode (low_latency setting, fixed at setup_buffer() time): chunks are
+ * CONFIG_RX_LOW_LATENCY_PTIME_MS long, the target starts at
+ * CONFIG_RX_LOW_LATENCY_TARGET_CHUNKS and grows to CONFIG_RX_LOW_LATENCY_MAX_CHUNKS at
+ * most. A due chunk more than CONFIG_RX_LOW_LATENCY_LATE_MS late is dropped whenever a
+ * newer chunk is already waiting, so a stall costs audio rather than added delay.
+ */
+
+// Slot state word: (tag << SLOT_STATE_BITS) | state
+#define SLOT_STATE_BITS    3
+#define SLOT_STATE_MASK    ((1u << SLOT_STATE_BITS) - 1u)
+#define SLOT_TAG_MASK      (0xFFFFFFFFu >> SLOT_STATE_BITS)
+#define SLOT_TAG(seq)      ((uint32_t)(seq) & SLOT_TAG_MASK)
+#define SLOT_WORD(seq, st) ((SLOT_TAG(seq) << SLOT_STATE_BITS) | (uint32_t)(st))
+
+enum {
+  SLOT_EMPTY    = 0,  // Never used since last reset
+  SLOT_WRITING  = 1,  // Claimed by the producer
+  SLOT_READY    = 2,  // Filled, waiting for playout
+  SLOT_PLAYING  = 3,  // Handed to the consumer (played or concealed)
+  SLOT_CONSUMED = 4,  // Released by the consumer
+};
+
+// Sequences further behind read_seq than this are treated as a new stream
+#define LATE_WINDOW_SLOTS(cap) ((cap) * 4u)
+
+// Upper bound on ring depth (chunks); keeps the slot arrays and late window sane
+#define BUFFER_MAX_CHUNKS 4096u
 
 // Flag if the stream is currently underrun and rebuffering
-bool is_underrun                            = true;
+static atomic_bool underrun                 = true;
+// Transitions into underrun since boot
+static metrics_counter_t underrun_count =
+    METRICS_COUNTER_INIT("jitter_buffer_underruns_total", "Transitions into underrun");
+// Ring ran dry right after a chunk of digital silence (a DTX sender pausing): rebuffering
+// like an underrun, but neither counted nor growing the target
+static atomic_bool paused                   = false;
+static metrics_counter_t pause_count =
+    METRICS_COUNTER_INIT("jitter_buffer_pauses_total", "Drains after digital silence, not counted as underruns");
 // Number of received packets since last underflow
-uint64_t received_packets                   = 0;
-// Number of packets in ring buffer
-uint64_t packet_buffer_size                 = 0;
-// Position of ring buffer read head
-uint64_t packet_buffer_pos                  = 0;
-// Number of bytes to buffer
-uint64_t target_buffer_size                 = 0;
-// Buffer of packets to send
-packet_with_ts_t *packet_buffer = NULL;
+static atomic_uint_fast32_t received_packets = 0;
+// Number of chunks to buffer before playback (re)starts
+static atomic_uint_fast32_t target_buffer_size = 0;
+
+// Ring position (see ownership notes above)
+static atomic_bool anchored                 = false;
+static atomic_uint_fast32_t read_seq        = 0;  // next sequence to play (consumer)
+static atomic_uint_fast32_t ring_head       = 0;  // newest sequence + 1 (producer)
+// Pending read-side requests from the producer / control tasks
+static atomic_bool trim_pending             = false;
+static atomic_bool flush_pending            = false;
+static atomic_bool resync_pending           = false;
+static atomic_bool reanchor_pending         = false;  // buffer_request_reanchor()
+static atomic_uint_fast32_t retarget_size   = 0;  // buffer_retarget(): new initial target (0: none)
+// Slot handed out by the last pop_chunk(); released on the next pop
+static bool consumer_holds_slot             = false;
+
+// Producer's in-place reservation (buffer_reserve_slot)
+static bool reservation_active              = false;
+static uint32_t reservation_seq             = 0;
+static uint32_t reservation_prev_word       = 0;
+// Latency probe capture time stamped on published chunks (buffer_set_capture_time)
+static uint64_t pending_capture_us          = 0;
+// Sample rate stamped on published chunks (buffer_set_stream_rate)
+static atomic_uint_fast32_t stream_rate     = 0;
 
-portMUX_TYPE buffer_mutex = portMUX_INITIALIZER_UNLOCKED;
+// Consumer wakeup: playout timer and producer notifications
+static esp_timer_handle_t playout_timer     = NULL;
+static TaskHandle_t consumer_task           = NULL;
+// What the blocked consumer is waiting for; the producer notifies once it holds, not per commit
+typedef enum {
+  CONSUMER_WAIT_NONE = 0,
+  CONSUMER_WAIT_COMMIT,  // Any committed chunk (pop_chunk() waiting on a slot or gap)
+  CONSUMER_WAIT_READY,   // Fill back at the target after an underrun (buffer_wait_for_data())
+} consumer_wait_t;
+static atomic_uint_fast8_t consumer_wait    = CONSUMER_WAIT_NONE;
+
+// Nominal chunk duration, used to time concealment of missing chunks
+static atomic_uint_fast32_t chunk_duration_us = 6000;
+
+// Latency controller (consumer-owned except jitter_us)
+static atomic_uint_fast32_t jitter_us       = 0;  // Interarrival jitter reported by the receiver
+static int64_t clean_since_us               = 0;  // Start of the current underrun-free period
+static uint32_t min_target_size             = 0;  // Never shrink below the initial size
+static uint16_t drain_step_bytes            = 0;  // Bytes trimmed per chunk while draining
+static atomic_uint_fast32_t stat_drained_bytes = 0;
+
+// Scrape-time distributions (see metrics.h): ring depth when a chunk is released,
+// and how far past its playout time it was released
+static const uint32_t depth_bounds[] = { 0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 64 };
+static const uint32_t lateness_bounds[] = { 50, 100, 250, 500, 1000, 2000, 5000, 10000, 20000, 50000 };
+static metrics_histogram_t depth_hist =
+    METRICS_HISTOGRAM_INIT("jitter_buffer_depth_chunks", "Chunks queued behind the one being played", depth_bounds);
+static metrics_histogram_t lateness_hist =
+    METRICS_HISTOGRAM_INIT("jitter_buffer_playout_late_us", "Release time past the chunk's playout time", lateness_bounds);
+
+static int64_t metrics_read_fill(void);
+static int64_t metrics_read_target(void);
+static metrics_gauge_t fill_gauge =
+    METRICS_GAUGE_INIT("jitter_buffer_fill_chunks", "Chunks currently buffered", metrics_read_fill);
+static metrics_gauge_t target_gauge =
+    METRICS_GAUGE_INIT("jitter_buffer_target_chunks", "Target buffer depth", metrics_read_target);
+
+// Reorder statistics
+static atomic_uint_fast32_t stat_reordered  = 0;
+static atomic_uint_fast32_t stat_duplicates = 0;
+static atomic_uint_fast32_t stat_late       = 0;
+static atomic_uint_fast32_t stat_concealed  = 0;
+static atomic_uint_fast32_t stat_skipped    = 0;
+
+// Ring geometry, fixed at setup_buffer() time
+static uint32_t ring_chunk_bytes            = PCM_CHUNK_SIZE;  // slot size, from the ptime setting
+static uint32_t ring_capacity               = 0;  // power of two >= ring_limit
+static uint32_t ring_mask                   = 0;
+static uint32_t ring_limit                  = 0;  // configured max_buffer_size
+static bool low_latency                     = false;  // low_latency setting at setup time
+// Buffer of packets to send
+static packet_with_ts_t *packet_buffer      = NULL;
+static uint8_t *packet_memory               = NULL;
+static _Atomic uint32_t *slot_state         = NULL;
 
 // Cached buffer growth parameters for thread-safe access
-static uint8_t buffer_grow_step_size = 0;
-static uint8_t buffer_max_grow_size = 0;
+static atomic_uint_fast32_t buffer_grow_step_size = 0;
+static atomic_uint_fast32_t buffer_max_grow_size = 0;
 
-void set_underrun() {
-  if (!is_underrun) {
-    received_packets = 0;
-    target_buffer_size += buffer_grow_step_size;
-    if (target_buffer_size >= buffer_max_grow_size)
-      target_buffer_size = buffer_max_grow_size;
-    ESP_LOGI(TAG, "Buffer Underflow, New Size: %llu", (unsigned long long)target_buffer_size);
+static uint32_t round_up_pow2(uint32_t v) {
+  uint32_t p = 1;
+  while (p < v) {
+    p <<= 1;
   }
-  is_underrun = true;
+  return p;
 }
 
-bool push_chunk_with_timestamp(uint8_t *chunk, uint64_t timestamp) {
-  uint8_t max_buffer_size = lifecycle_get_max_buffer_size();
-  int write_position = (packet_buffer_pos + packet_buffer_size) % max_buffer_size;
-//  ESP_LOGI(TAG, "memcpy(%p, %p, %i)", packet_buffer[write_position], chunk, PCM_CHUNK_SIZE);
-  taskENTER_CRITICAL(&buffer_mutex);
-  if (packet_buffer_size == max_buffer_size) {
-    packet_buffer_size = target_buffer_size;
-    taskEXIT_CRITICAL(&buffer_mutex);
-    ESP_LOGI(TAG, "Buffer Overflow");
-    return false;
+// True if tag a is newer than tag b (modular comparison in tag space)
+static inline bool tag_newer(uint32_t a, uint32_t b) {
+  return (int32_t)((a - b) << SLOT_STATE_BITS) > 0;
+}
+
+static void playout_timer_cb(void *arg) {
+  (void)arg;
+  TaskHandle_t task = consumer_task;
+  if (task) {
+    xTaskNotifyGive(task);
   }
+}
 
-  write_position = (packet_buffer_pos + packet_buffer_size) % max_buffer_size;
-  memcpy(packet_buffer[write_position].packet_buffer, chunk, PCM_CHUNK_SIZE);
-  packet_buffer[write_position].timestamp = timestamp; // Use provided timestamp directly
-  packet_buffer[write_position].skip_bytes = 0; // Default: no skip
-  packet_buffer_size++;
-  received_packets++;
-  if (received_packets >= target_buffer_size)
-    is_underrun = false;
-  taskEXIT_CRITICAL(&buffer_mutex);
-  return true;
+// Producer: wake the consumer once the condition it blocked on holds. Refill commits below
+// the target leave a CONSUMER_WAIT_READY waiter asleep; the crossing wakes it exactly once.
+static void notify_consumer_if_waiting(void) {
+  uint_fast8_t wait = atomic_load(&consumer_wait);
+  if (wait == CONSUMER_WAIT_NONE) {
+    return;
+  }
+  if (wait == CONSUMER_WAIT_READY && atomic_load_explicit(&underrun, memory_order_relaxed)) {
+    return;
+  }
+  if (atomic_compare_exchange_strong(&consumer_wait, &wait, CONSUMER_WAIT_NONE)) {
+    TaskHandle_t task = consumer_task;
+    if (task) {
+      xTaskNotifyGive(task);
+    }
+  }
 }
 
-bool push_chunk_with_skip(uint8_t *chunk, uint64_t timestamp, uint16_t skip_bytes) {
-  uint8_t max_buffer_size = lifecycle_get_max_buffer_size();
-  int write_position = (packet_buffer_pos + packet_buffer_size) % max_buffer_size;
-  
-  taskENTER_CRITICAL(&buffer_mutex);
-  if (packet_buffer_size == max_buffer_size) {
-    packet_buffer_size = target_buffer_size;
-    taskEXIT_CRITICAL(&buffer_mutex);
-    ESP_LOGI(TAG, "Buffer Overflow");
+// Consumer: block until the producer commits past what we saw (slot word, ring head), or
+// one chunk duration passes, rather than polling the slot every tick
+static void wait_for_commit(uint32_t idx, uint32_t word, uint32_t head) {
+  atomic_store(&consumer_wait, CONSUMER_WAIT_COMMIT);
+  // Re-check after publishing the wait so a concurrent commit can't be missed
+  if (atomic_load_explicit(&slot_state[idx], memory_order_acquire) == word &&
+      atomic_load_explicit(&ring_head, memory_order_acquire) == head) {
+    uint32_t dur = atomic_load_explicit(&chunk_duration_us, memory_order_relaxed);
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(dur / 1000) + 1);
+  }
+  atomic_store(&consumer_wait, CONSUMER_WAIT_NONE);
+}
+
+// Block the consumer until the chunk's playout time using the one-shot timer
+static void wait_until_due(uint64_t due_us) {
+  int64_t now = esp_timer_get_time();
+  while ((int64_t)due_us > now) {
+    uint64_t wait_us = (uint64_t)((int64_t)due_us - now);
+    if (!playout_timer) {
+      vTaskDelay(0);
+    } else {
+      esp_timer_stop(playout_timer);  // May not be running; ignore result
+      if (esp_timer_start_once(playout_timer, wait_us) != ESP_OK) {
+        vTaskDelay(0);
+      } else {
+        // Generous tick timeout as a safety net in case the timer is lost
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_us / 1000) + 2);
+      }
+    }
+    now = esp_timer_get_time();
+  }
+}
+
+static void set_underrun() {
+  // Any underrun restarts the clean period the shrink logic waits for
+  clean_since_us = esp_timer_get_time();
+  if (!atomic_load_explicit(&underrun, memory_order_relaxed)) {
+    metrics_counter_inc(&underrun_count);
+    atomic_store_explicit(&received_packets, 0, memory_order_relaxed);
+    uint32_t step = atomic_load_explicit(&buffer_grow_step_size, memory_order_relaxed);
+    uint32_t max_grow = atomic_load_explicit(&buffer_max_grow_size, memory_order_relaxed);
+    uint32_t target = atomic_load_explicit(&target_buffer_size, memory_order_relaxed) + step;
+    if (target >= max_grow)
+      target = max_grow;
+    atomic_store_explicit(&target_buffer_size, target, memory_order_relaxed);
+    event_trace_freeze(EVENT_TRACE_UNDERRUN, event_trace_u16(target), 0);
+    LOG_RATE_I(TAG, "Buffer Underflow, New Size: %u", (unsigned)target);
+  }
+  atomic_store_explicit(&underrun, true, memory_order_relaxed);
+}
+
+// Consumer: whether the chunk before `rd`, played last, was received digital silence
+static bool played_silence(uint32_t rd) {
+  uint32_t idx = (rd - 1) & ring_mask;
+  const packet_with_ts_t *packet = &packet_buffer[idx];
+  if (atomic_load_explicit(&slot_state[idx], memory_order_acquire) != SLOT_WORD(rd - 1, SLOT_CONSUMED) ||
+      (packet->flags & PACKET_FLAG_CONCEALED)) {
     return false;
   }
+  const uint8_t *p = packet->packet_buffer;
+  uint8_t any = 0;
+  for (uint32_t i = 0; i < ring_chunk_bytes; i++) {
+    any |= p[i];
+  }
+  return any == 0;
+}
+
+// Producer: claim the slot for `seq` (state -> WRITING). On success returns the slot
+// and the previous state word so the claim can be rolled back.
+static buffer_push_result_t claim_slot(uint32_t seq, packet_with_ts_t **out, uint32_t *prev_word) {
+  if (!packet_buffer) {
+    return BUFFER_PUSH_NO_BUFFER;
+  }
+
+  if (!atomic_load_explicit(&anchored, memory_order_acquire)) {
+    // Consumer is idle on an unanchored ring; seed the window from this chunk
+    atomic_store_explicit(&read_seq, seq, memory_order_relaxed);
+    atomic_store_explicit(&ring_head, seq, memory_order_relaxed);
+    atomic_store_explicit(&anchored, true, memory_order_release);
+  }
+
+  uint32_t rd = atomic_load_explicit(&read_seq, memory_order_acquire);
+  uint32_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+  int32_t ahead = (int32_t)(seq - rd);
+
+  if (ahead < 0) {
+    if ((uint32_t)(-ahead) > LATE_WINDOW_SLOTS(ring_capacity)) {
+      atomic_store_explicit(&resync_pending, true, memory_order_relaxed);
+      return BUFFER_PUSH_RESYNC;
+    }
+    atomic_fetch_add_explicit(&stat_late, 1, memory_order_relaxed);
+    return BUFFER_PUSH_LATE;
+  }
+  if ((uint32_t)ahead >= ring_limit) {
+    if ((int32_t)(seq - head) < (int32_t)ring_limit) {
+      // Let the consumer drop back to the target depth; we can't move read_seq from here
+      atomic_store_explicit(&trim_pending, true, memory_order_relaxed);
+      event_trace_freeze(EVENT_TRACE_OVERFLOW, event_trace_u16((int32_t)(head - rd)), (int32_t)seq);
+      LOG_RATE_I(TAG, "Buffer Overflow");
+      return BUFFER_PUSH_OVERFLOW;
+    }
+    atomic_store_explicit(&resync_pending, true, memory_order_relaxed);
+    return BUFFER_PUSH_RESYNC;
+  }
 
-  write_position = (packet_buffer_pos + packet_buffer_size) % max_buffer_size;
-  memcpy(packet_buffer[write_position].packet_buffer, chunk, PCM_CHUNK_SIZE);
-  packet_buffer[write_position].timestamp = timestamp;
-  packet_buffer[write_position].skip_bytes = skip_bytes;  // Set skip bytes
-  packet_buffer_size++;
-  received_packets++;
-  if (received_packets >= target_buffer_size)
-    is_underrun = false;
-  taskEXIT_CRITICAL(&buffer_mutex);
+  uint32_t idx = seq & ring_mask;
+  uint32_t word = atomic_load_explicit(&slot_state[idx], memory_order_acquire);
+  for (;;) {
+    uint32_t state = word & SLOT_STATE_MASK;
+    uint32_t tag = word >> SLOT_STATE_BITS;
+    if (state != SLOT_EMPTY) {
+      if (tag == SLOT_TAG(seq)) {
+        if (state == SLOT_READY) {
+          atomic_fetch_add_explicit(&stat_duplicates, 1, memory_order_relaxed);
+          return BUFFER_PUSH_DUPLICATE;
+        }
+        // Already played or concealed
+        atomic_fetch_add_explicit(&stat_late, 1, memory_order_relaxed);
+        return BUFFER_PUSH_LATE;
+      }
+      if (tag_newer(tag, SLOT_TAG(seq))) {
+        atomic_fetch_add_explicit(&stat_late, 1, memory_order_relaxed);
+        return BUFFER_PUSH_LATE;
+      }
+    }
+    if (atomic_compare_exchange_weak_explicit(&slot_state[idx], &word, SLOT_WORD(seq, SLOT_WRITING),
+                                              memory_order_acquire, memory_order_acquire)) {
+      break;
+    }
+  }
+
+  *out = &packet_buffer[idx];
+  *prev_word = word;
+  return BUFFER_PUSH_OK;
+}
+
+// Producer: publish a slot claimed by claim_slot()
+static void publish_slot(packet_with_ts_t *slot, uint32_t seq, uint64_t timestamp, uint16_t skip_bytes) {
+  slot->timestamp = timestamp;
+  slot->skip_bytes = skip_bytes;
+  slot->flags = 0;
+  slot->arrival_us = (uint64_t)esp_timer_get_time();
+  slot->capture_us = pending_capture_us;
+  slot->sample_rate = (uint32_t)atomic_load_explicit(&stream_rate, memory_order_relaxed);
+  atomic_store_explicit(&slot_state[seq & ring_mask], SLOT_WORD(seq, SLOT_READY), memory_order_release);
+
+  uint32_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+  if ((int32_t)(seq + 1 - head) > 0) {
+    atomic_store_explicit(&ring_head, seq + 1, memory_order_release);
+  } else {
+    // Filled a slot behind the newest chunk: a reordered packet made it in time
+    atomic_fetch_add_explicit(&stat_reordered, 1, memory_order_relaxed);
+  }
+
+  uint32_t received = atomic_fetch_add_explicit(&received_packets, 1, memory_order_relaxed) + 1;
+  if (received >= atomic_load_explicit(&target_buffer_size, memory_order_relaxed)) {
+    atomic_store(&underrun, false);
+    atomic_store_explicit(&paused, false, memory_order_relaxed);
+  }
+  notify_consumer_if_waiting();
+}
+
+buffer_push_result_t buffer_push_chunk_seq(const uint8_t *chunk, uint32_t seq, uint64_t timestamp,
+                                           uint16_t skip_bytes) {
+  packet_with_ts_t *slot = NULL;
+  uint32_t prev_word = 0;
+  buffer_push_result_t result = claim_slot(seq, &slot, &prev_word);
+  if (result != BUFFER_PUSH_OK) {
+    return result;
+  }
+
+  memcpy(slot->packet_buffer, chunk, ring_chunk_bytes);
+  publish_slot(slot, seq, timestamp, skip_bytes);
+  return BUFFER_PUSH_OK;
+}
+
+packet_with_ts_t *buffer_reserve_slot(uint32_t seq) {
+  if (reservation_active) {
+    buffer_cancel_slot();
+  }
+
+  packet_with_ts_t *slot = NULL;
+  uint32_t prev_word = 0;
+  if (claim_slot(seq, &slot, &prev_word) != BUFFER_PUSH_OK) {
+    return NULL;
+  }
+  reservation_active = true;
+  reservation_seq = seq;
+  reservation_prev_word = prev_word;
+  return slot;
+}
+
+bool buffer_commit_slot(uint64_t timestamp, uint16_t skip_bytes) {
+  if (!reservation_active) {
+    return false;
+  }
+  reservation_active = false;
+  publish_slot(&packet_buffer[reservation_seq & ring_mask], reservation_seq, timestamp, skip_bytes);
   return true;
 }
 
+void buffer_set_capture_time(uint64_t capture_us) {
+  pending_capture_us = capture_us;
+}
+
+void buffer_set_stream_rate(uint32_t sample_rate) {
+  atomic_store_explicit(&stream_rate, sample_rate, memory_order_relaxed);
+}
+
+uint32_t buffer_get_stream_rate(void) {
+  return (uint32_t)atomic_load_explicit(&stream_rate, memory_order_relaxed);
+}
+
+void buffer_cancel_slot(void) {
+  if (!reservation_active) {
+    return;
+  }
+  reservation_active = false;
+  atomic_store_explicit(&slot_state[reservation_seq & ring_mask], reservation_prev_word,
+                        memory_order_release);
+}
+
+// Append after the newest chunk (callers without sequence information)
+static uint32_t append_seq(void) {
+  if (!atomic_load_explicit(&anchored, memory_order_acquire)) {
+    return 0;
+  }
+  return atomic_load_explicit(&ring_head, memory_order_relaxed);
+}
+
+bool push_chunk_with_skip(uint8_t *chunk, uint64_t timestamp, uint16_t skip_bytes) {
+  return buffer_push_chunk_seq(chunk, append_seq(), timestamp, skip_bytes) == BUFFER_PUSH_OK;
+}
+
+bool push_chunk_with_timestamp(uint8_t *chunk, uint64_t timestamp) {
+  return push_chunk_with_skip(chunk, timestamp, 0);
+}
+
 bool push_chunk(uint8_t *chunk) {
   // Backward compatible wrapper - maintains current behavior with +5ms delay
-  return push_chunk_with_timestamp(chunk, esp_timer_get_time() + 5000);
+  return push_chunk_with_timestamp(chunk, esp_timer_get_time() + BUFFER_LEGACY_PLAYOUT_DELAY_US);
+}
+
+// Consumer: drop everything and let the producer re-anchor on its next chunk
+static void reset_ring(void) {
+  for (uint32_t i = 0; i < ring_capacity; i++) {
+    uint32_t word = atomic_load_explicit(&slot_state[i], memory_order_acquire);
+    // A slot the producer is writing right now is left alone; its stale tag heals on reuse
+    if ((word & SLOT_STATE_MASK) != SLOT_WRITING) {
+      atomic_compare_exchange_strong(&slot_state[i], &word, SLOT_WORD(0, SLOT_EMPTY));
+    }
+  }
+  atomic_store_explicit(&received_packets, 0, memory_order_relaxed);
+  atomic_store_explicit(&reanchor_pending, false, memory_order_relaxed);
+  atomic_store_explicit(&anchored, false, memory_order_release);
+}
+
+// Consumer: expected playout time of missing sequence `rd`, extrapolated back from
+// the next chunk that did arrive. Returns false if no later chunk is ready yet.
+static bool hole_due_time(uint32_t rd, uint32_t head, uint64_t *due) {
+  uint32_t dur = atomic_load_explicit(&chunk_duration_us, memory_order_relaxed);
+  for (uint32_t m = rd + 1; (int32_t)(head - m) > 0; m++) {
+    uint32_t word = atomic_load_explicit(&slot_state[m & ring_mask], memory_order_acquire);
+    if (word == SLOT_WORD(m, SLOT_READY)) {
+      uint64_t back = (uint64_t)(m - rd) * dur;
+      uint64_t ts = packet_buffer[m & ring_mask].timestamp;
+      *due = (ts > back) ? ts - back : 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Smallest target the controller may shrink to: the initial size, or enough chunks to
+// cover CONFIG_RX_LATENCY_JITTER_MULT times the current jitter plus the chunk in flight
+static uint32_t latency_floor(void) {
+  uint32_t floor = min_target_size;
+  uint32_t dur = atomic_load_explicit(&chunk_duration_us, memory_order_relaxed);
+  uint32_t jitter = atomic_load_explicit(&jitter_us, memory_order_relaxed);
+  if (dur > 0 && jitter > 0) {
+    uint64_t cover_us = (uint64_t)jitter * CONFIG_RX_LATENCY_JITTER_MULT;
+    uint32_t need = (uint32_t)((cover_us + dur - 1) / dur) + 1u;
+    if (need > floor) {
+      floor = need;
+    }
+  }
+  return floor;
+}
+
+// Consumer: step the target down after a sustained clean period
+static void latency_control(void) {
+  int64_t now = esp_timer_get_time();
+  if (now - clean_since_us < (int64_t)CONFIG_RX_LATENCY_SHRINK_CLEAN_MS * 1000) {
+    return;
+  }
+  clean_since_us = now;
+
+  uint32_t target = atomic_load_explicit(&target_buffer_size, memory_order_relaxed);
+  uint32_t floor = latency_floor();
+  if (target > floor) {
+    target--;
+    atomic_store_explicit(&target_buffer_size, target, memory_order_relaxed);
+    ESP_LOGI(TAG, "Buffer stable, New Size: %u (floor %u, jitter %u us)", (unsigned)target,
+             (unsigned)floor, (unsigned)atomic_load_explicit(&jitter_us, memory_order_relaxed));
+  }
+}
+
+// Consumer: trim the head of a chunk while the ring holds more than the target. Only
+// chunks that are already due are trimmed; shortening a chunk that is still scheduled
+// would just leave a gap before the next one.
+static void drain_excess(packet_with_ts_t *packet, uint32_t fill) {
+  if (drain_step_bytes == 0 ||
+      fill <= atomic_load_explicit(&target_buffer_size, memory_order_relaxed) ||
+      (int64_t)packet->timestamp > esp_timer_get_time()) {
+    return;
+  }
+  if ((uint32_t)packet->skip_bytes + drain_step_bytes >= ring_chunk_bytes) {
+    return;
+  }
+  packet->skip_bytes += drain_step_bytes;
+  atomic_fetch_add_explicit(&stat_drained_bytes, drain_step_bytes, memory_order_relaxed);
 }
 
 packet_with_ts_t *pop_chunk() {
-  taskENTER_CRITICAL(&buffer_mutex);
-  if (packet_buffer_size == 0) {
-    taskEXIT_CRITICAL(&buffer_mutex);
-    set_underrun();
+  if (!packet_buffer) {
     return NULL;
   }
-  if (is_underrun) {
-    taskEXIT_CRITICAL(&buffer_mutex);
+
+  consumer_task = xTaskGetCurrentTaskHandle();
+  uint32_t rd = atomic_load_explicit(&read_seq, memory_order_relaxed);
+
+  // Hand the previously returned slot back to the producer
+  if (consumer_holds_slot) {
+    atomic_store_explicit(&slot_state[rd & ring_mask], SLOT_WORD(rd, SLOT_CONSUMED), memory_order_release);
+    rd++;
+    consumer_holds_slot = false;
+    atomic_store_explicit(&read_seq, rd, memory_order_release);
+  }
+
+  bool flush = atomic_exchange_explicit(&flush_pending, false, memory_order_relaxed);
+  bool resync = atomic_exchange_explicit(&resync_pending, false, memory_order_relaxed);
+  if (flush || resync) {
+    if (resync) {
+      event_trace_add(EVENT_TRACE_RESYNC, 0, 0, 0);
+      LOG_RATE_I(TAG, "Buffer resync: sequence jumped outside the jitter window");
+    }
+    reset_ring();
+  }
+
+  if (!atomic_load_explicit(&anchored, memory_order_acquire)) {
+    set_underrun();
     return NULL;
   }
-  uint8_t max_buffer_size = lifecycle_get_max_buffer_size();
-  while (packet_buffer[packet_buffer_pos].timestamp > esp_timer_get_time()) {
-    taskEXIT_CRITICAL(&buffer_mutex);
-    vTaskDelay(0);
-    taskENTER_CRITICAL(&buffer_mutex);
+  rd = atomic_load_explicit(&read_seq, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+  if (atomic_load_explicit(&reanchor_pending, memory_order_relaxed) && (int32_t)(head - rd) > 0) {
+    // The sender's timestamps ran on through its pause: start at the first chunk after it
+    // rather than conceal the gap. Everything before it was played out.
+    atomic_store_explicit(&reanchor_pending, false, memory_order_relaxed);
+    while ((int32_t)(head - rd) > 1 &&
+           atomic_load_explicit(&slot_state[rd & ring_mask], memory_order_acquire) != SLOT_WORD(rd, SLOT_READY)) {
+      rd++;
+    }
+    atomic_store_explicit(&read_seq, rd, memory_order_release);
+  }
+
+  uint32_t retarget = atomic_exchange_explicit(&retarget_size, 0, memory_order_relaxed);
+  if (retarget) {
+    // A deeper target fills in at the next rebuffer; a shallower one drains like a shrink
+    min_target_size = retarget;
+    atomic_store_explicit(&target_buffer_size, retarget, memory_order_relaxed);
+    clean_since_us = esp_timer_get_time();
+  }
+
+  if (!atomic_load_explicit(&underrun, memory_order_relaxed)) {
+    latency_control();
+  }
+
+  if (atomic_exchange_explicit(&trim_pending, false, memory_order_relaxed)) {
+    uint32_t target = atomic_load_explicit(&target_buffer_size, memory_order_relaxed);
+    if ((int32_t)(head - rd) > (int32_t)target) {
+      rd = head - target;
+      atomic_store_explicit(&read_seq, rd, memory_order_release);
+    }
+  }
+
+  for (;;) {
+    if ((int32_t)(head - rd) <= 0) {
+      if (atomic_load_explicit(&paused, memory_order_relaxed)) {
+        return NULL;
+      }
+      if (!atomic_load_explicit(&underrun, memory_order_relaxed) && played_silence(rd)) {
+        // Nothing audible is missed; the sender's next packet is marked and refills from here
+        metrics_counter_inc(&pause_count);
+        event_trace_add(EVENT_TRACE_PAUSE, 0, 0, (int32_t)rd);
+        atomic_store_explicit(&received_packets, 0, memory_order_relaxed);
+        atomic_store_explicit(&paused, true, memory_order_relaxed);
+        atomic_store_explicit(&underrun, true, memory_order_relaxed);
+        return NULL;
+      }
+      set_underrun();
+      return NULL;
+    }
+    if (atomic_load_explicit(&underrun, memory_order_relaxed)) {
+      return NULL;
+    }
+
+    uint32_t idx = rd & ring_mask;
+    packet_with_ts_t *packet = &packet_buffer[idx];
+    uint32_t word = atomic_load_explicit(&slot_state[idx], memory_order_acquire);
+
+    if (word == SLOT_WORD(rd, SLOT_READY) && low_latency && (int32_t)(head - rd) > 1 &&
+        (int64_t)packet->timestamp + (int64_t)CONFIG_RX_LOW_LATENCY_LATE_MS * 1000 < esp_timer_get_time()) {
+      // Playing it would carry the delay forward; a newer chunk is already waiting
+      atomic_store_explicit(&slot_state[idx], SLOT_WORD(rd, SLOT_CONSUMED), memory_order_release);
+      rd++;
+      atomic_store_explicit(&read_seq, rd, memory_order_release);
+      atomic_fetch_add_explicit(&stat_skipped, 1, memory_order_relaxed);
+      continue;
+    }
+
+    if (word == SLOT_WORD(rd, SLOT_READY)) {
+      // Producer never rewrites a READY slot with the same tag, so a plain store is enough
+      atomic_store_explicit(&slot_state[idx], SLOT_WORD(rd, SLOT_PLAYING), memory_order_relaxed);
+      drain_excess(packet, head - rd);
+      metrics_histogram_observe(&depth_hist, head - rd - 1);
+      wait_until_due(packet->timestamp);
+      int64_t late_us = esp_timer_get_time() - (int64_t)packet->timestamp;
+      metrics_histogram_observe(&lateness_hist, late_us > 0 ? (uint32_t)late_us : 0);
+      event_trace_add(EVENT_TRACE_PLAY, 0, event_trace_u16((int32_t)(head - rd - 1)),
+                      late_us > INT32_MAX ? INT32_MAX : (int32_t)late_us);
+      // Slot stays owned by the caller until the next pop_chunk()
+      consumer_holds_slot = true;
+      return packet;
+    }
+
+    uint64_t due = 0;
+    if ((word & SLOT_STATE_MASK) == SLOT_WRITING || !hole_due_time(rd, head, &due)) {
+      // Chunk is being written, or nothing after the gap has landed yet
+      wait_for_commit(idx, word, head);
+      head = atomic_load_explicit(&ring_head, memory_order_acquire);
+      continue;
+    }
+
+    if ((int64_t)due > esp_timer_get_time()) {
+      // Give a reordered packet until the gap's playout time to arrive
+      wait_until_due(due);
+      head = atomic_load_explicit(&ring_head, memory_order_acquire);
+      continue;
+    }
+
+    // Gap is due: claim it so a late write for this sequence is rejected, then conceal
+    if (atomic_compare_exchange_strong_explicit(&slot_state[idx], &word, SLOT_WORD(rd, SLOT_PLAYING),
+                                                memory_order_acquire, memory_order_relaxed)) {
+      memset(packet->packet_buffer, 0, ring_chunk_bytes);
+      packet->timestamp = due;
+      packet->skip_bytes = 0;
+      packet->flags = PACKET_FLAG_CONCEALED;
+      packet->arrival_us = 0;
+      packet->capture_us = 0;
+      packet->sample_rate = 0;
+      event_trace_add(EVENT_TRACE_CONCEAL, 0, event_trace_u16((int32_t)(head - rd)), (int32_t)rd);
+      atomic_fetch_add_explicit(&stat_concealed, 1, memory_order_relaxed);
+      consumer_holds_slot = true;
+      return packet;
+    }
+    // Lost the race with the producer; re-evaluate the slot
+  }
+}
+
+void buffer_restart(void) {
+  if (!packet_buffer) {
+    return;
+  }
+  if (consumer_holds_slot) {
+    uint32_t rd = atomic_load_explicit(&read_seq, memory_order_relaxed);
+    atomic_store_explicit(&slot_state[rd & ring_mask], SLOT_WORD(rd, SLOT_CONSUMED), memory_order_release);
+    atomic_store_explicit(&read_seq, rd + 1, memory_order_release);
+    consumer_holds_slot = false;
   }
-  
-  // Get pointer to current packet
-  packet_with_ts_t *packet = &packet_buffer[packet_buffer_pos];
-  
-  packet_buffer_size--;
-  packet_buffer_pos = (packet_buffer_pos + 1) % max_buffer_size;
-  taskEXIT_CRITICAL(&buffer_mutex);
-  return packet;
+  atomic_store_explicit(&flush_pending, false, memory_order_relaxed);
+  atomic_store_explicit(&resync_pending, false, memory_order_relaxed);
+  reset_ring();
+  // Rebuffering, but not an underrun: the target is left alone
+  clean_since_us = esp_timer_get_time();
+  atomic_store_explicit(&underrun, true, memory_order_relaxed);
+}
+
+void buffer_wait_until(uint64_t due_us) {
+  consumer_task = xTaskGetCurrentTaskHandle();
+  wait_until_due(due_us);
 }
 
 void empty_buffer() {
-	taskENTER_CRITICAL(&buffer_mutex);
-	packet_buffer_size = 0;
-	received_packets = 0;
-	taskEXIT_CRITICAL(&buffer_mutex);
+  atomic_store_explicit(&flush_pending, true, memory_order_relaxed);
+  atomic_store_explicit(&received_packets, 0, memory_order_relaxed);
+}
+
+bool buffer_wait_for_data(uint32_t timeout_ms) {
+  consumer_task = xTaskGetCurrentTaskHandle();
+  atomic_store(&consumer_wait, CONSUMER_WAIT_READY);
+  // Re-check after publishing the wait so a concurrent commit can't be missed
+  bool ready = atomic_load(&anchored) && atomic_load(&ring_head) != atomic_load(&read_seq) &&
+               !atomic_load(&underrun);
+  if (!ready) {
+    ready = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) > 0;
+  }
+  atomic_store(&consumer_wait, CONSUMER_WAIT_NONE);
+  return ready;
+}
+
+void buffer_set_chunk_duration_us(uint32_t duration_us) {
+  if (duration_us > 0) {
+    atomic_store_explicit(&chunk_duration_us, duration_us, memory_order_relaxed);
+  }
+}
+
+uint32_t buffer_get_chunk_size(void) {
+  return ring_chunk_bytes;
+}
+
+void buffer_set_jitter_us(uint32_t jitter) {
+  atomic_store_explicit(&jitter_us, jitter, memory_order_relaxed);
+}
+
+uint32_t buffer_get_drained_bytes(void) {
+  return atomic_load_explicit(&stat_drained_bytes, memory_order_relaxed);
+}
+
+void buffer_get_reorder_stats(buffer_reorder_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+  stats->reordered = atomic_load_explicit(&stat_reordered, memory_order_relaxed);
+  stats->duplicates = atomic_load_explicit(&stat_duplicates, memory_order_relaxed);
+  stats->late = atomic_load_explicit(&stat_late, memory_order_relaxed);
+  stats->concealed = atomic_load_explicit(&stat_concealed, memory_order_relaxed);
+  stats->skipped = atomic_load_explicit(&stat_skipped, memory_order_relaxed);
+}
+
+bool buffer_is_underrun(void) {
+  return atomic_load_explicit(&underrun, memory_order_relaxed);
+}
+
+bool buffer_is_paused(void) {
+  return atomic_load_explicit(&paused, memory_order_relaxed);
+}
+
+void buffer_request_reanchor(void) {
+  atomic_store_explicit(&reanchor_pending, true, memory_order_relaxed);
+}
+
+uint32_t buffer_get_underrun_count(void) {
+  return metrics_counter_get(&underrun_count);
+}
+
+const metrics_histogram_t *buffer_get_lateness_histogram(void) {
+  return &lateness_hist;
+}
+
+uint32_t buffer_get_fill_level(void) {
+  if (!atomic_load_explicit(&anchored, memory_order_acquire)) {
+    return 0;
+  }
+  uint32_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+  uint32_t rd = atomic_load_explicit(&read_seq, memory_order_acquire);
+  int32_t fill = (int32_t)(head - rd);
+  return fill > 0 ? (uint32_t)fill : 0;
 }
 
+uint32_t buffer_get_target_size(void) {
+  return atomic_load_explicit(&target_buffer_size, memory_order_relaxed);
+}
+
+static int64_t metrics_read_fill(void) {
+  return buffer_get_fill_level();
+}
+
+static int64_t metrics_read_target(void) {
+  return buffer_get_target_size();
+}
+
+void buffer_get_depth(buffer_depth_t *depth) {
+  if (!depth) {
+    return;
+  }
+  depth->fill = buffer_get_fill_level();
+  depth->target = atomic_load_explicit(&target_buffer_size, memory_order_relaxed);
+  depth->max_grow = atomic_load_explicit(&buffer_max_grow_size, memory_order_relaxed);
+  depth->limit = ring_limit;
+  depth->chunk_us = atomic_load_explicit(&chunk_duration_us, memory_order_relaxed);
+}
+
+// Buffer depths in chunks, resolved from the configuration
+typedef struct {
+  uint32_t initial;   // Chunks buffered before playback (re)starts
+  uint32_t max_size;  // Ring depth
+  uint32_t max_grow;  // Largest target underrun growth may reach
+} buffer_sizes_t;
+
+// Latency in ms -> whole chunks at the current stream format (rounded up)
+static uint32_t ms_to_chunks(uint32_t ms) {
+  uint32_t dur = atomic_load_explicit(&chunk_duration_us, memory_order_relaxed);
+  if (dur == 0) {
+    return 1;
+  }
+  uint64_t chunks = ((uint64_t)ms * 1000u + dur - 1) / dur;
+  return chunks > BUFFER_MAX_CHUNKS ? BUFFER_MAX_CHUNKS : (uint32_t)chunks;
+}
+
+// Time-based settings (buffer_target_ms / buffer_max_ms) win over the legacy chunk counts,
+// so the latency stays the same whatever the chunk size and sample rate
+static void resolve_buffer_sizes(buffer_sizes_t *sizes) {
+  uint16_t target_ms = lifecycle_get_buffer_target_ms();
+  uint16_t max_ms = lifecycle_get_buffer_max_ms();
+
+  sizes->max_size = max_ms ? ms_to_chunks(max_ms) : lifecycle_get_max_buffer_size();
+  if (sizes->max_size == 0) {
+    sizes->max_size = 1;
+  }
+  if (sizes->max_size > BUFFER_MAX_CHUNKS) {
+    sizes->max_size = BUFFER_MAX_CHUNKS;
+  }
+
+  sizes->initial = target_ms ? ms_to_chunks(target_ms) : lifecycle_get_initial_buffer_size();
+  if (sizes->initial >= sizes->max_size) {
+    sizes->initial = sizes->max_size > 1 ? sizes->max_size - 1 : 1;
+  }
+
+  // With a time-based ring, growth may use all of it but the overflow headroom chunk
+  sizes->max_grow = max_ms ? sizes->max_size - 1 : lifecycle_get_max_grow_size();
+  if (sizes->max_grow < sizes->initial) {
+    sizes->max_grow = sizes->initial;
+  }
+
+  if (low_latency) {
+    // Targets are fixed and small; the ring still has to take a whole packet of the
+    // longest ptime at once without overflowing
+    sizes->initial = CONFIG_RX_LOW_LATENCY_TARGET_CHUNKS;
+    sizes->max_grow = CONFIG_RX_LOW_LATENCY_MAX_CHUNKS;
+    if (sizes->max_grow < sizes->initial) {
+      sizes->max_grow = sizes->initial;
+    }
+    uint32_t need = sizes->max_grow + ms_to_chunks(PCM_PTIME_MAX_MS) + 1u;
+    if (sizes->max_size < need) {
+      sizes->max_size = need;
+    }
+  }
+}
+
+// Chunk memory: the audio arena (else internal RAM) for small rings, PSRAM once
+// the ring outgrows CONFIG_RX_BUFFER_INTERNAL_MAX_KB (or internal RAM is exhausted).
+// Every path returns memory audio_arena_free() takes.
+static uint8_t *alloc_chunk_memory(size_t bytes, bool *in_psram) {
+  uint8_t *mem = NULL;
+  *in_psram = false;
+  if (bytes <= (size_t)CONFIG_RX_BUFFER_INTERNAL_MAX_KB * 1024u) {
+    mem = audio_arena_alloc(AUDIO_ARENA_JITTER, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if (!mem) {
+    mem = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    *in_psram = mem != NULL;
+  }
+  if (!mem) {
+    mem = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+  }
+  return mem;
+}
+
+#ifdef CONFIG_BUFFER_BENCHMARK
+#define BUFFER_BENCH_CHUNKS 4096u
+
+// Cycles per chunk through push and pop at the configured depth, on the freshly set up
+// ring before any stream uses it. Chunks are due on arrival, so nothing waits; the ring,
+// stats and consumer bookkeeping go back to their setup state afterwards.
+static void buffer_benchmark(void) {
+  uint8_t *chunk = malloc(ring_chunk_bytes);
+  if (!chunk) {
+    return;
+  }
+  memset(chunk, 0x5A, ring_chunk_bytes);
+  bool saved_low_latency = low_latency;
+  low_latency = false;  // Its late-drop check would skip chunks the loop has not timed
+
+  uint32_t depth = atomic_load(&target_buffer_size);
+  if (depth == 0 || depth >= ring_limit) {
+    depth = 1;
+  }
+  uint64_t ts = (uint64_t)esp_timer_get_time();
+  uint32_t seq = 0;
+  for (; seq < depth; seq++) {
+    buffer_push_chunk_seq(chunk, seq, ts, 0);
+  }
+
+  uint32_t push_cycles = 0;
+  uint32_t pop_cycles = 0;
+  uint32_t missed = 0;
+  for (uint32_t i = 0; i < BUFFER_BENCH_CHUNKS; i++, seq++) {
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    packet_with_ts_t *packet = pop_chunk();
+    uint32_t t1 = esp_cpu_get_cycle_count();
+    if (buffer_push_chunk_seq(chunk, seq, ts, 0) != BUFFER_PUSH_OK || !packet) {
+      missed++;
+    }
+    push_cycles += esp_cpu_get_cycle_count() - t1;
+    pop_cycles += t1 - t0;
+  }
+
+  reset_ring();
+  atomic_store(&read_seq, 0);
+  atomic_store(&ring_head, 0);
+  atomic_store(&underrun, true);
+  atomic_store(&trim_pending, false);
+  atomic_store(&stat_reordered, 0);
+  atomic_store(&stat_duplicates, 0);
+  atomic_store(&stat_late, 0);
+  atomic_store(&stat_concealed, 0);
+  atomic_store(&stat_skipped, 0);
+  atomic_store(&stat_drained_bytes, 0);
+  consumer_holds_slot = false;
+  consumer_task = NULL;
+  low_latency = saved_low_latency;
+  clean_since_us = esp_timer_get_time();
+  free(chunk);
+
+  uint32_t push = push_cycles / BUFFER_BENCH_CHUNKS;
+  uint32_t pop = pop_cycles / BUFFER_BENCH_CHUNKS;
+  uint32_t per_chunk = push + pop;
+  ESP_LOGI(TAG, "Buffer benchmark: push %u + pop %u cycles/chunk (%u byte chunks, depth %u), "
+           "%u chunks/s per core%s",
+           (unsigned)push, (unsigned)pop, (unsigned)ring_chunk_bytes, (unsigned)depth,
+           (unsigned)(per_chunk ? (CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000u) / per_chunk : 0u),
+           missed ? " (chunks missed, figures unreliable)" : "");
+  metrics_bench_check("buf_push", push);
+  metrics_bench_check("buf_pop", pop);
+}
+#endif
+
 void setup_buffer() {
   ESP_LOGI(TAG, "Allocating buffer");
-  uint8_t initial_buffer_size = lifecycle_get_initial_buffer_size();
-  uint8_t max_buffer_size = lifecycle_get_max_buffer_size();
-  target_buffer_size = initial_buffer_size;
-  
+
+  metrics_register(&underrun_count.base);
+  metrics_register(&pause_count.base);
+  metrics_register(&depth_hist.base);
+  metrics_register(&lateness_hist.base);
+  metrics_register(&fill_gauge.base);
+  metrics_register(&target_gauge.base);
+
+  // Slot size follows the configured packet time (stereo, playout sample width), or
+  // the low-latency chunk length
+  low_latency = lifecycle_get_low_latency();
+  atomic_store(&stream_rate, lifecycle_get_sample_rate());
+  uint32_t bytes_per_frame = 2u * (audio_out_sample_bits() / 8u);
+  uint32_t ptime_ms = low_latency ? CONFIG_RX_LOW_LATENCY_PTIME_MS : lifecycle_get_ptime_ms();
+  ring_chunk_bytes = pcm_chunk_bytes_for_ptime(ptime_ms, lifecycle_get_sample_rate(), bytes_per_frame);
+
+  // Nominal chunk duration for concealment timing (refined by the receiver)
+  uint32_t bytes_per_sec = lifecycle_get_sample_rate() * bytes_per_frame;
+  if (bytes_per_sec > 0) {
+    buffer_set_chunk_duration_us((uint32_t)(((uint64_t)ring_chunk_bytes * 1000000ULL) / bytes_per_sec));
+  }
+
+  buffer_sizes_t sizes;
+  resolve_buffer_sizes(&sizes);
+  uint32_t initial_buffer_size = sizes.initial;
+  uint32_t max_buffer_size = sizes.max_size;
+  atomic_store(&target_buffer_size, initial_buffer_size);
+
   // Initialize cached buffer growth parameters
-  buffer_grow_step_size = lifecycle_get_buffer_grow_step_size();
-  buffer_max_grow_size = lifecycle_get_max_grow_size();
-  
-  ESP_LOGI(TAG, "Buffer sizes: initial=%d, max=%d, chunk=%d bytes",
-           initial_buffer_size, max_buffer_size, PCM_CHUNK_SIZE);
-  ESP_LOGI(TAG, "Buffer growth: step=%d, max_grow=%d",
-           buffer_grow_step_size, buffer_max_grow_size);
-  
+  atomic_store(&buffer_grow_step_size, lifecycle_get_buffer_grow_step_size());
+  atomic_store(&buffer_max_grow_size, sizes.max_grow);
+
+  // Latency controller: shrink floor and per-chunk drain step (whole frames)
+  min_target_size = initial_buffer_size;
+  drain_step_bytes = (uint16_t)(CONFIG_RX_LATENCY_DRAIN_FRAMES * bytes_per_frame);
+#ifdef CONFIG_RX_RESAMPLER_ENABLED
+  if (resampler_available()) {
+    // The resampler brings the depth back by rate instead of trimming
+    drain_step_bytes = 0;
+  }
+#endif
+  clean_since_us = esp_timer_get_time();
+
+  uint32_t chunk_us = atomic_load(&chunk_duration_us);
+  ESP_LOGI(TAG, "Buffer sizes: initial=%u (%u ms), max=%u (%u ms), chunk=%u bytes",
+           (unsigned)initial_buffer_size, (unsigned)((initial_buffer_size * chunk_us) / 1000u),
+           (unsigned)max_buffer_size, (unsigned)((max_buffer_size * chunk_us) / 1000u),
+           (unsigned)ring_chunk_bytes);
+  if (low_latency) {
+    ESP_LOGI(TAG, "Low-latency playout: %u ms chunks, late chunks dropped after %u ms",
+             (unsigned)(chunk_us / 1000u), (unsigned)CONFIG_RX_LOW_LATENCY_LATE_MS);
+  }
+  ESP_LOGI(TAG, "Buffer growth: step=%u, max_grow=%u",
+           (unsigned)atomic_load(&buffer_grow_step_size), (unsigned)atomic_load(&buffer_max_grow_size));
+
+  // Drop any ring left over from a previous receiver mode; freed before the new one
+  // is taken so it lands in the same arena space
+  audio_arena_free(packet_buffer);
+  packet_buffer = NULL;
+  audio_arena_free(packet_memory);
+  packet_memory = NULL;
+  audio_arena_free((void *)slot_state);
+  slot_state = NULL;
+
+  uint32_t capacity = round_up_pow2(max_buffer_size);
+
   // Allocate the array of packet structs
-  packet_buffer = (packet_with_ts_t *)malloc(sizeof(packet_with_ts_t) * max_buffer_size);
-  if (!packet_buffer) {
+  packet_with_ts_t *slots = (packet_with_ts_t *)audio_arena_alloc(AUDIO_ARENA_JITTER,
+      sizeof(packet_with_ts_t) * capacity, MALLOC_CAP_8BIT);
+  if (!slots) {
     ESP_LOGE(TAG, "Failed to allocate packet buffer array");
     return;
   }
-  
+
   // Allocate the actual buffer memory
-  uint8_t *buffer = (uint8_t *)malloc(PCM_CHUNK_SIZE * max_buffer_size);
+  bool in_psram = false;
+  uint8_t *buffer = alloc_chunk_memory((size_t)ring_chunk_bytes * capacity, &in_psram);
   if (!buffer) {
     ESP_LOGE(TAG, "Failed to allocate buffer memory");
-    heap_caps_free(packet_buffer);
-    packet_buffer = NULL;
+    audio_arena_free(slots);
+    return;
+  }
+
+  _Atomic uint32_t *states = (_Atomic uint32_t *)audio_arena_alloc(AUDIO_ARENA_JITTER,
+      sizeof(_Atomic uint32_t) * capacity, MALLOC_CAP_8BIT);
+  if (!states) {
+    ESP_LOGE(TAG, "Failed to allocate slot state array");
+    audio_arena_free(buffer);
+    audio_arena_free(slots);
+    return;
+  }
+
+  memset(buffer, 0, (size_t)ring_chunk_bytes * capacity);
+  for (uint32_t i = 0; i < capacity; i++) {
+    slots[i].packet_buffer = buffer + i * ring_chunk_bytes;
+    slots[i].timestamp = 0;
+    slots[i].skip_bytes = 0;
+    slots[i].flags = 0;
+    slots[i].arrival_us = 0;
+    slots[i].capture_us = 0;
+    slots[i].sample_rate = 0;
+    atomic_init(&states[i], SLOT_WORD(0, SLOT_EMPTY));
+  }
+
+  ring_capacity = capacity;
+  ring_mask = capacity - 1;
+  ring_limit = max_buffer_size;
+  atomic_store(&anchored, false);
+  atomic_store(&read_seq, 0);
+  atomic_store(&ring_head, 0);
+  atomic_store(&received_packets, 0);
+  atomic_store(&trim_pending, false);
+  atomic_store(&flush_pending, false);
+  atomic_store(&resync_pending, false);
+  atomic_store(&reanchor_pending, false);
+  atomic_store(&underrun, true);
+  consumer_holds_slot = false;
+  reservation_active = false;
+  slot_state = states;
+  packet_memory = buffer;
+  packet_buffer = slots;
+
+  if (!playout_timer) {
+    const esp_timer_create_args_t timer_args = {
+      .callback = playout_timer_cb,
+      .name = "playout",
+    };
+    if (esp_timer_create(&timer_args, &playout_timer) != ESP_OK) {
+      ESP_LOGW(TAG, "Failed to create playout timer, falling back to polling");
+      playout_timer = NULL;
+    }
+  }
+
+  ESP_LOGI(TAG, "Buffer allocated with initial size %u, max size %u (ring capacity %u, %u KB in %s)",
+           (unsigned)initial_buffer_size, (unsigned)max_buffer_size, (unsigned)ring_capacity,
+           (unsigned)(((size_t)ring_chunk_bytes * capacity) / 1024u), in_psram ? "PSRAM" : "internal RAM");
+#ifdef CONFIG_BUFFER_BENCHMARK
+  buffer_benchmark();
+#endif
+}
+
+void buffer_retarget(void) {
+  if (!packet_buffer) {
     return;
   }
-  
-  memset(buffer, 0, PCM_CHUNK_SIZE * max_buffer_size);
-  for (int i = 0; i < max_buffer_size; i++) {
-    packet_buffer[i].packet_buffer = buffer + i * PCM_CHUNK_SIZE;
-    packet_buffer[i].timestamp = 0;
-    packet_buffer[i].skip_bytes = 0;
+  buffer_sizes_t sizes;
+  resolve_buffer_sizes(&sizes);
+  // The ring keeps its depth: only targets it can hold
+  uint32_t room = ring_limit > 1 ? ring_limit - 1 : 1;
+  uint32_t initial = sizes.initial < room ? sizes.initial : room;
+  uint32_t max_grow = sizes.max_grow < room ? sizes.max_grow : room;
+  if (max_grow < initial) {
+    max_grow = initial;
   }
-  ESP_LOGI(TAG, "Buffer allocated with initial size %d, max size %d", initial_buffer_size, max_buffer_size);
+  atomic_store(&buffer_max_grow_size, max_grow);
+  atomic_store_explicit(&retarget_size, initial, memory_order_relaxed);
+  ESP_LOGI(TAG, "Buffer retarget: initial=%u, max_grow=%u", (unsigned)initial, (unsigned)max_grow);
 }
 
 esp_err_t buffer_update_growth_params() {
-  uint8_t new_grow_step_size = lifecycle_get_buffer_grow_step_size();
-  uint8_t new_max_grow_size = lifecycle_get_max_grow_size();
-  
-  // Update parameters in thread-safe manner
-  taskENTER_CRITICAL(&buffer_mutex);
-  buffer_grow_step_size = new_grow_step_size;
-  buffer_max_grow_size = new_max_grow_size;
-  
+  buffer_sizes_t sizes;
+  resolve_buffer_sizes(&sizes);
+  uint32_t new_grow_step_size = lifecycle_get_buffer_grow_step_size();
+  uint32_t new_max_grow_size = sizes.max_grow;
+
+  atomic_store(&buffer_grow_step_size, new_grow_step_size);
+  atomic_store(&buffer_max_grow_size, new_max_grow_size);
+
   // Ensure current target_buffer_size doesn't exceed new max grow size
-  if (target_buffer_size > buffer_max_grow_size) {
-    target_buffer_size = buffer_max_grow_size;
-  }
-  taskEXIT_CRITICAL(&buffer_mutex);
-  
-  ESP_LOGI(TAG, "Updated buffer growth params: step=%d, max_grow=%d",
-           new_grow_step_size, new_max_grow_size);
-  
+  if (atomic_load(&target_buffer_size) > new_max_grow_size) {
+    atomic_store(&target_buffer_size, new_max_grow_size);
+  }
+
+  ESP_LOGI(TAG, "Updated buffer growth params: step=%u, max_grow=%u",
+           (unsigned)new_grow_step_size, (unsigned)new_max_grow_size);
+
   return ESP_OK;
 }
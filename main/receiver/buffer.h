@@ -3,27 +3,180 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include "metrics.h"
+
+// packet_with_ts_t.flags
+#define PACKET_FLAG_CONCEALED 0x01  // Chunk never arrived; buffer holds concealment (silence)
 
 // Packet structure with timestamp and skip info
 typedef struct packet_with_ts {
     uint8_t *packet_buffer;
     uint64_t timestamp;
     uint16_t skip_bytes;  // Number of bytes to skip from the beginning
+    uint8_t flags;        // PACKET_FLAG_*
+    uint64_t arrival_us;  // When the chunk was published (esp_timer_get_time()), 0 if concealed
+    uint64_t capture_us;  // Sender's capture time from a latency probe (esp_timer_get_time()), 0 if none
+    uint32_t sample_rate; // Stream rate the chunk was received at (buffer_set_stream_rate()), 0 if concealed
 } packet_with_ts_t;
 
-extern bool is_underrun;
-extern uint64_t received_packets;
-extern uint64_t packet_buffer_size;
-extern uint64_t packet_buffer_pos;
-extern uint64_t target_buffer_size;
+// Result of placing a chunk into the jitter buffer
+typedef enum {
+    BUFFER_PUSH_OK = 0,
+    BUFFER_PUSH_DUPLICATE,  // Sequence already buffered
+    BUFFER_PUSH_LATE,       // Sequence already played or concealed
+    BUFFER_PUSH_OVERFLOW,   // Too far ahead of playout; buffer will trim
+    BUFFER_PUSH_RESYNC,     // Sequence jumped outside the window; buffer will re-anchor
+    BUFFER_PUSH_NO_BUFFER,  // setup_buffer() not called / allocation failed
+} buffer_push_result_t;
+
+// Reorder/loss counters maintained by the jitter buffer
+typedef struct {
+    uint32_t reordered;   // Chunks inserted behind the newest chunk in time
+    uint32_t duplicates;  // Chunks dropped as duplicates
+    uint32_t late;        // Chunks dropped because their slot was already played
+    uint32_t concealed;   // Missing chunks handed out as concealment
+    uint32_t skipped;     // Low-latency mode: due chunks dropped for being too late
+} buffer_reorder_stats_t;
+
+// Playout delay applied to chunks enqueued without an RTCP time mapping
+#define BUFFER_LEGACY_PLAYOUT_DELAY_US 5000
 
 void setup_buffer();
+
+// Bytes per chunk/slot, fixed by setup_buffer() from the ptime setting (<= PCM_CHUNK_MAX_SIZE)
+uint32_t buffer_get_chunk_size(void);
 bool push_chunk(uint8_t *chunk);
 bool push_chunk_with_timestamp(uint8_t *chunk, uint64_t timestamp);
 bool push_chunk_with_skip(uint8_t *chunk, uint64_t timestamp, uint16_t skip_bytes);
+
+/**
+ * @brief Place a chunk at its sequence position (producer only)
+ *
+ * Chunks may arrive in any order; each is stored in the slot for `seq` and
+ * played in sequence order. The push_chunk*() wrappers append after the
+ * newest chunk instead.
+ *
+ * @param chunk buffer_get_chunk_size() bytes of host-order PCM
+ * @param seq Chunk sequence number (consecutive chunks differ by 1)
+ * @param timestamp Playout time (esp_timer_get_time() domain, microseconds)
+ * @param skip_bytes Bytes to skip from the beginning of the chunk
+ * @return BUFFER_PUSH_OK if the chunk was stored, otherwise why it was dropped
+ */
+buffer_push_result_t buffer_push_chunk_seq(const uint8_t *chunk, uint32_t seq, uint64_t timestamp,
+                                           uint16_t skip_bytes);
+
+/**
+ * @brief Reserve the slot for `seq` for in-place filling (producer only)
+ *
+ * The slot's packet_buffer may be written directly (e.g. by recvmsg()).
+ * Nothing is published until buffer_commit_slot() is called. While reserved
+ * the consumer cannot conceal that sequence, so an unused reservation must be
+ * released promptly with buffer_cancel_slot().
+ *
+ * @param seq Chunk sequence number the payload is expected to carry
+ * @return Slot to fill, or NULL if that sequence can't be stored right now
+ */
+packet_with_ts_t *buffer_reserve_slot(uint32_t seq);
+
+/**
+ * @brief Publish the slot returned by buffer_reserve_slot() to the consumer
+ *
+ * @param timestamp Playout time (esp_timer_get_time() domain, microseconds)
+ * @param skip_bytes Bytes to skip from the beginning of the chunk
+ * @return true on success, false if there was no active reservation
+ */
+bool buffer_commit_slot(uint64_t timestamp, uint16_t skip_bytes);
+
+// Drop an outstanding reservation without publishing it (no-op if none)
+void buffer_cancel_slot(void);
+
+// Stamp chunks published from now on with a latency probe's capture time; 0 stops (producer only)
+void buffer_set_capture_time(uint64_t capture_us);
+
+// Stamp chunks published from now on with the stream's sample rate. The consumer
+// moves the outputs to it at the first such chunk, so chunks already queued
+// keep playing at the rate they arrived at. Any task; setup_buffer() starts from
+// the configured rate.
+void buffer_set_stream_rate(uint32_t sample_rate);
+uint32_t buffer_get_stream_rate(void);
+
+// Nominal chunk duration used to time concealment of missing chunks
+void buffer_set_chunk_duration_us(uint32_t duration_us);
+
+void buffer_get_reorder_stats(buffer_reorder_stats_t *stats);
+
+/**
+ * @brief Report the stream's interarrival jitter to the latency controller
+ *
+ * The target depth is never shrunk below what this jitter needs
+ * (CONFIG_RX_LATENCY_JITTER_MULT times the jitter, in whole chunks).
+ *
+ * @param jitter_us Interarrival jitter in microseconds (e.g. from RTCP jitter_ts)
+ */
+void buffer_set_jitter_us(uint32_t jitter_us);
+
+// Total bytes trimmed off due chunks to drain the ring back down to its target
+uint32_t buffer_get_drained_bytes(void);
+
+// Returned slot stays valid until the next pop_chunk() call (consumer owns it).
+// Never polls: blocks on the playout timer until the chunk is due, and on a producer
+// notification (bounded by one chunk duration) while the next slot is being written
+// or a gap has nothing after it yet; late chunks return at once
+// (in low-latency mode, a chunk CONFIG_RX_LOW_LATENCY_LATE_MS late is skipped if a
+// newer one is waiting).
+// Missing chunks come back zeroed with PACKET_FLAG_CONCEALED once they are due.
 packet_with_ts_t *pop_chunk();  // Now returns the whole struct
 void empty_buffer();
 
+/**
+ * @brief Empty the ring now and refill it to the target before playing (consumer only)
+ *
+ * Unlike empty_buffer() this takes effect immediately, so the producer's next
+ * chunk anchors a fresh ring; it is not counted as an underrun and does not
+ * grow the target. Used when the consumer plays from elsewhere meanwhile.
+ */
+void buffer_restart(void);
+
+// Block until due_us (esp_timer_get_time() domain) on the playout timer (consumer only)
+void buffer_wait_until(uint64_t due_us);
+
+/**
+ * @brief Block the consumer task until a chunk may be playable (consumer only)
+ *
+ * Used after pop_chunk() returned NULL instead of polling. The producer wakes
+ * the caller by task notification when its commit brings the fill back to the
+ * target (the underrun clears), so the refill itself causes no wakeups.
+ *
+ * @param timeout_ms Maximum time to wait
+ * @return true if woken by new data, false on timeout
+ */
+bool buffer_wait_for_data(uint32_t timeout_ms);
+
+// Lock-free snapshots of ring state (safe from any task)
+bool buffer_is_underrun(void);
+// Rebuffering after the ring drained on digital silence (a DTX sender's pause), which is
+// not an underrun; buffer_is_underrun() is true meanwhile as well
+bool buffer_is_paused(void);
+// The sender marked a packet after its pause: once it is in, playout starts at it rather
+// than concealing the sequence gap the pause left
+void buffer_request_reanchor(void);
+uint32_t buffer_get_underrun_count(void);   // Underruns (rebuffering events) since boot
+// How late chunks were handed to the output, in us (jitter_buffer_playout_late_us at /metrics)
+const metrics_histogram_t *buffer_get_lateness_histogram(void);
+uint32_t buffer_get_fill_level(void);
+uint32_t buffer_get_target_size(void);
+
+// Depths in chunks for reporting (RTCP XR); chunk_us converts them to time
+typedef struct {
+    uint32_t fill;      // Chunks buffered ahead of playout
+    uint32_t target;    // Current target depth
+    uint32_t max_grow;  // Largest target underrun growth may reach
+    uint32_t limit;     // Ring depth
+    uint32_t chunk_us;  // Nominal chunk duration
+} buffer_depth_t;
+
+void buffer_get_depth(buffer_depth_t *depth);
+
 /**
  * @brief Update buffer growth parameters without requiring a reboot
  *
@@ -33,4 +186,15 @@ void empty_buffer();
  *
  * @return ESP_OK on success
  */
-esp_err_t buffer_update_growth_params();
\ No newline at end of file
+esp_err_t buffer_update_growth_params();
+
+/**
+ * @brief Apply a new buffer_target_ms while playing
+ *
+ * Unlike a full reconfiguration, playout is neither stopped nor flushed: the
+ * initial target (and the floor the latency controller shrinks to) moves to
+ * the new setting at the next pop_chunk(). A shallower target drains like a
+ * latency shrink, a deeper one fills in at the next rebuffer. The ring keeps
+ * its depth, so the target is clamped to it.
+ */
+void buffer_retarget(void);
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "clock_steer.h"
+#include "buffer.h"
+#include "global.h"
+#include "build_config.h"
+#include "lifecycle_manager.h"
+#include "spdif_out.h"
+#ifdef CONFIG_RTCP_ENABLED
+#include "rtcp_receiver.h"
+#include "logging/event_trace.h"
+#endif
+
+/*
+ * Same controller as resampler_update(), with the sign turned around: the
+ * resampler stretches the stream by (1 + ratio) against a fixed clock, so the
+ * equivalent clock offset is -ratio. A sender running slow (positive PLL
+ * estimate) slows the output; a buffer above target speeds it up.
+ */
+
+// Chunks between RTCP PLL queries (each takes the RTCP mutex)
+#define CLOCK_STEER_PLL_POLL_CHUNKS 32
+// Fill average and applied offset follow their inputs with these time constants (2^n chunks)
+#define CLOCK_STEER_FILL_SHIFT      4
+#define CLOCK_STEER_SLEW_SHIFT      6
+// Smallest change worth an APLL write
+#define CLOCK_STEER_MIN_STEP_PPB    100
+
+static int32_t target_ppb = 0;      // Slewed controller output
+static int32_t applied_ppb = 0;     // Last value the clock accepted
+static int32_t pll_ppb = 0;
+static int32_t fill_q8 = -1;        // Averaged buffer fill in chunks, Q8 (-1: unseeded)
+static uint32_t poll_countdown = 0;
+static uint32_t retunes = 0;
+
+bool clock_steer_available(void) {
+    if (lifecycle_get_device_mode() != MODE_RECEIVER_SPDIF) {
+        return false;
+    }
+    if (spdif_set_clock_offset_ppb(0) != ESP_OK) {
+        return false;
+    }
+    target_ppb = 0;
+    applied_ppb = 0;
+    return true;
+}
+
+void clock_steer_reset(void) {
+    fill_q8 = -1;
+    poll_countdown = 0;
+    retunes = 0;
+    // target_ppb and pll_ppb are kept: the sender's drift doesn't change across a rebuffer
+}
+
+void clock_steer_update(void) {
+#ifdef CONFIG_RTCP_ENABLED
+    if (poll_countdown == 0) {
+        poll_countdown = CLOCK_STEER_PLL_POLL_CHUNKS;
+        uint32_t ssrc = 0;
+        float ppm = 0.0f;
+        if (rtcp_get_primary_ssrc(&ssrc) && rtcp_get_pll_slope_ppm(ssrc, &ppm)) {
+            pll_ppb = (int32_t)(ppm * 1000.0f);
+        }
+    }
+    poll_countdown--;
+#endif
+
+    int32_t fill = (int32_t)buffer_get_fill_level() << 8;
+    if (fill_q8 < 0) {
+        fill_q8 = fill;
+    } else {
+        fill_q8 += (fill - fill_q8) >> CLOCK_STEER_FILL_SHIFT;
+    }
+    int32_t error_q8 = fill_q8 - ((int32_t)buffer_get_target_size() << 8);
+
+    const int64_t limit = (int64_t)CONFIG_RX_CLOCK_STEER_MAX_PPM * 1000;
+    int64_t target = -(int64_t)pll_ppb +
+                     (((int64_t)CONFIG_RX_CLOCK_STEER_FILL_GAIN_PPM * 1000 * error_q8) >> 8);
+    if (target > limit) target = limit;
+    if (target < -limit) target = -limit;
+
+    target_ppb += (int32_t)((target - target_ppb) / (1 << CLOCK_STEER_SLEW_SHIFT));
+
+    int32_t delta = target_ppb - applied_ppb;
+    if (delta >= CLOCK_STEER_MIN_STEP_PPB || delta <= -CLOCK_STEER_MIN_STEP_PPB) {
+        if (spdif_set_clock_offset_ppb(target_ppb) == ESP_OK) {
+            applied_ppb = target_ppb;
+            retunes++;
+            event_trace_add(EVENT_TRACE_STEER, 0, 0, applied_ppb);
+        }
+    }
+}
+
+void clock_steer_get_stats(clock_steer_stats_t *stats) {
+    stats->applied_ppb = applied_ppb;
+    stats->pll_ppb = pll_ppb;
+    stats->retunes = retunes;
+}
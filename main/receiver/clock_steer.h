@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Output clock steering for S/PDIF playout (CONFIG_RX_CLOCK_STEER_ENABLED).
+ *
+ * The counterpart of the drift resampler for an output whose clock can be
+ * retuned: the same two inputs (RTCP PLL slope estimate fed forward, jitter
+ * buffer depth error fed back) move the S/PDIF bit clock itself, so the
+ * output physically follows the sender and every sample is played once.
+ * Needs an audio PLL behind the I2S clock (ESP32, ESP32-S2, ESP32-P4); on
+ * the ESP32-S3 clock_steer_available() is false and playout falls back to
+ * the resampler or to trimming. Consumer (pcm_handler) only.
+ */
+
+typedef struct {
+    int32_t applied_ppb;    // Offset the output clock currently runs at
+    int32_t pll_ppb;        // Last RTCP PLL drift estimate (0 until the PLL has updated)
+    uint32_t retunes;       // Clock updates since clock_steer_reset
+} clock_steer_stats_t;
+
+/**
+ * @brief Whether the current output can be steered (S/PDIF mode on an APLL target)
+ *
+ * Leaves the clock at nominal.
+ */
+bool clock_steer_available(void);
+
+/**
+ * @brief Forget the buffer history (stream start / underrun); the clock keeps its offset
+ */
+void clock_steer_reset(void);
+
+/**
+ * @brief Retune for the chunk about to be played (consumer only)
+ *
+ * Reads the jitter buffer depth every call and the RTCP PLL estimate at a
+ * lower rate; the clock follows the combined target slowly and is only
+ * written when it has moved by CLOCK_STEER_MIN_STEP_PPB.
+ */
+void clock_steer_update(void);
+
+void clock_steer_get_stats(clock_steer_stats_t *stats);
@@ -0,0 +1,238 @@
+#include "eq.h"
+#include "build_config.h"
+#include "global.h"
+#include "config/config_manager.h"
+#include "dsps_biquad.h"
+#include "dsps_biquad_gen.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#endif
+
+// Frames converted to float and filtered per pass; keeps the scratch in a few hundred bytes
+#define EQ_BLOCK_FRAMES   96
+// Linkwitz-Riley 4th order: two cascaded Butterworth sections per band
+#define EQ_XOVER_STAGES   2
+#define EQ_XOVER_Q        0.70710678f
+// Running average of the per-chunk cycle count over 2^n chunks
+#define EQ_AVG_SHIFT      4
+
+static atomic_bool reload_pending = true;
+static uint8_t bands = 0;
+static uint16_t xover_hz = 0;
+static uint16_t xover_cfg_hz = 0;       // As configured; xover_hz may be 0 if invalid at this rate
+static uint32_t xover_rate = 0;         // Rate the crossover sections were designed for
+
+static float coeffs[EQ_MAX_BANDS][EQ_COEFFS_PER_BAND];
+static float w[2][EQ_MAX_BANDS][2];     // Per channel, per band delay line
+static float lp_coeffs[EQ_COEFFS_PER_BAND];
+static float hp_coeffs[EQ_COEFFS_PER_BAND];
+static float lp_w[EQ_XOVER_STAGES][2];
+static float hp_w[EQ_XOVER_STAGES][2];
+static float blk_l[EQ_BLOCK_FRAMES] __attribute__((aligned(16)));
+static float blk_r[EQ_BLOCK_FRAMES] __attribute__((aligned(16)));
+
+static uint32_t cycles_last = 0;
+static uint32_t cycles_max = 0;
+static uint32_t cycles_avg = 0;
+static uint32_t budget_cycles = 0;
+
+void eq_reload(void) {
+    atomic_store(&reload_pending, true);
+}
+
+void eq_reset(void) {
+    memset(w, 0, sizeof(w));
+    memset(lp_w, 0, sizeof(lp_w));
+    memset(hp_w, 0, sizeof(hp_w));
+}
+
+static void eq_design_crossover(uint32_t sample_rate) {
+    xover_rate = sample_rate;
+    xover_hz = xover_cfg_hz;
+    if (xover_hz == 0) {
+        return;
+    }
+    if (sample_rate == 0 || xover_hz >= sample_rate / 2) {
+        ESP_LOGW(TAG, "EQ: crossover at %u Hz not possible at %" PRIu32 " Hz, disabled",
+                 xover_cfg_hz, sample_rate);
+        xover_hz = 0;
+        return;
+    }
+    float f = (float)xover_hz / (float)sample_rate;
+    dsps_biquad_gen_lpf_f32(lp_coeffs, f, EQ_XOVER_Q);
+    dsps_biquad_gen_hpf_f32(hp_coeffs, f, EQ_XOVER_Q);
+}
+
+static void eq_apply_config(uint32_t sample_rate) {
+    const eq_config_t *cfg = &config_manager_get_config()->eq;
+    bands = cfg->band_count <= EQ_MAX_BANDS ? cfg->band_count : EQ_MAX_BANDS;
+    memcpy(coeffs, cfg->coeffs, sizeof(coeffs));
+    xover_cfg_hz = cfg->crossover_hz;
+    eq_design_crossover(sample_rate);
+    eq_reset();
+    ESP_LOGI(TAG, "EQ: %u band(s) per channel, crossover %s%u Hz",
+             bands, xover_hz ? "" : "off ", xover_hz);
+}
+
+// Interleaved integer PCM -> per-channel floats in [-1, 1)
+static void eq_load(const uint8_t *p, size_t frames, uint8_t bits) {
+    switch (bits) {
+        case 16: {
+            const int16_t *s = (const int16_t *)p;
+            for (size_t i = 0; i < frames; i++) {
+                blk_l[i] = (float)s[2 * i] * (1.0f / 32768.0f);
+                blk_r[i] = (float)s[2 * i + 1] * (1.0f / 32768.0f);
+            }
+            break;
+        }
+        case 24:
+            for (size_t i = 0; i < frames; i++, p += 6) {
+                int32_t l = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24);
+                int32_t r = (int32_t)((uint32_t)p[3] << 8 | (uint32_t)p[4] << 16 | (uint32_t)p[5] << 24);
+                blk_l[i] = (float)l * (1.0f / 2147483648.0f);
+                blk_r[i] = (float)r * (1.0f / 2147483648.0f);
+            }
+            break;
+        default: {
+            const int32_t *s = (const int32_t *)p;
+            for (size_t i = 0; i < frames; i++) {
+                blk_l[i] = (float)s[2 * i] * (1.0f / 2147483648.0f);
+                blk_r[i] = (float)s[2 * i + 1] * (1.0f / 2147483648.0f);
+            }
+            break;
+        }
+    }
+}
+
+static inline int32_t eq_to_s32(float v) {
+    // Left-justified 32-bit, saturated
+    v *= 2147483648.0f;
+    if (v >= 2147483648.0f) {
+        return INT32_MAX;
+    }
+    if (v < -2147483648.0f) {
+        return INT32_MIN;
+    }
+    return (int32_t)lrintf(v);
+}
+
+static void eq_store(uint8_t *p, size_t frames, uint8_t bits) {
+    switch (bits) {
+        case 16: {
+            int16_t *d = (int16_t *)p;
+            for (size_t i = 0; i < frames; i++) {
+                float l = blk_l[i] * 32768.0f;
+                float r = blk_r[i] * 32768.0f;
+                l = l > 32767.0f ? 32767.0f : (l < -32768.0f ? -32768.0f : l);
+                r = r > 32767.0f ? 32767.0f : (r < -32768.0f ? -32768.0f : r);
+                d[2 * i] = (int16_t)lrintf(l);
+                d[2 * i + 1] = (int16_t)lrintf(r);
+            }
+            break;
+        }
+        case 24:
+            for (size_t i = 0; i < frames; i++, p += 6) {
+                // Round at bit 8 of the left-justified value, saturating at the top
+                int32_t l = eq_to_s32(blk_l[i]);
+                int32_t r = eq_to_s32(blk_r[i]);
+                l = l > INT32_MAX - 0x80 ? INT32_MAX : l + 0x80;
+                r = r > INT32_MAX - 0x80 ? INT32_MAX : r + 0x80;
+                p[0] = (uint8_t)(l >> 8);
+                p[1] = (uint8_t)(l >> 16);
+                p[2] = (uint8_t)(l >> 24);
+                p[3] = (uint8_t)(r >> 8);
+                p[4] = (uint8_t)(r >> 16);
+                p[5] = (uint8_t)(r >> 24);
+            }
+            break;
+        default: {
+            int32_t *d = (int32_t *)p;
+            for (size_t i = 0; i < frames; i++) {
+                d[2 * i] = eq_to_s32(blk_l[i]);
+                d[2 * i + 1] = eq_to_s32(blk_r[i]);
+            }
+            break;
+        }
+    }
+}
+
+static void eq_filter_block(size_t frames) {
+    for (uint8_t b = 0; b < bands; b++) {
+        dsps_biquad_f32(blk_l, blk_l, (int)frames, coeffs[b], w[0][b]);
+        dsps_biquad_f32(blk_r, blk_r, (int)frames, coeffs[b], w[1][b]);
+    }
+    if (xover_hz) {
+        for (size_t i = 0; i < frames; i++) {
+            float m = 0.5f * (blk_l[i] + blk_r[i]);
+            blk_l[i] = m;
+            blk_r[i] = m;
+        }
+        for (int s = 0; s < EQ_XOVER_STAGES; s++) {
+            dsps_biquad_f32(blk_l, blk_l, (int)frames, lp_coeffs, lp_w[s]);
+            dsps_biquad_f32(blk_r, blk_r, (int)frames, hp_coeffs, hp_w[s]);
+        }
+    }
+}
+
+void eq_process(uint8_t *buf, size_t len, uint8_t bits, uint32_t sample_rate) {
+    if (atomic_exchange(&reload_pending, false)) {
+        eq_apply_config(sample_rate);
+    } else if (xover_cfg_hz && sample_rate != xover_rate) {
+        eq_design_crossover(sample_rate);
+        eq_reset();
+    }
+    if (bands == 0 && xover_hz == 0) {
+        return;
+    }
+
+    const size_t frame = 2u * (bits / 8u);
+    size_t frames = frame ? len / frame : 0;
+    if (frames == 0) {
+        return;
+    }
+    uint32_t t0 = esp_cpu_get_cycle_count();
+
+    for (size_t done = 0; done < frames; ) {
+        size_t n = frames - done;
+        if (n > EQ_BLOCK_FRAMES) {
+            n = EQ_BLOCK_FRAMES;
+        }
+        uint8_t *p = buf + done * frame;
+        eq_load(p, n, bits);
+        eq_filter_block(n);
+        eq_store(p, n, bits);
+        done += n;
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+    cycles_last = cycles;
+    if (cycles > cycles_max) {
+        cycles_max = cycles;
+    }
+    cycles_avg = cycles_avg ? (uint32_t)((int64_t)cycles_avg + (((int64_t)cycles - cycles_avg) >> EQ_AVG_SHIFT))
+                            : cycles;
+    if (sample_rate) {
+        budget_cycles = (uint32_t)((uint64_t)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000u * frames / sample_rate);
+    }
+}
+
+void eq_get_stats(eq_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->cycles_last = cycles_last;
+    stats->cycles_max = cycles_max;
+    stats->cycles_avg = cycles_avg;
+    stats->budget_cycles = budget_cycles;
+    stats->bands = bands;
+    stats->crossover_hz = xover_hz;
+    cycles_max = 0;
+}
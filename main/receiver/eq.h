@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Playout EQ and 2-way crossover (CONFIG_RX_EQ_ENABLED).
+ *
+ * Runs the configured biquad cascade (eq_config_t, set through
+ * /api/settings) on each channel of every playout chunk, ahead of the
+ * volume stage, using ESP-DSP's dsps_biquad_f32 (the AES3 SIMD version on
+ * the ESP32-S3). With a crossover frequency set, the EQ'd channels are
+ * summed to mono and split with 4th-order Linkwitz-Riley filters: left
+ * carries the low band, right the high band, for a woofer/tweeter pair.
+ *
+ * Each chunk's cycle count is kept against the chunk's real-time budget;
+ * eq_get_stats() reports the headroom. Consumer (pcm_handler) only, except
+ * eq_reload().
+ */
+
+typedef struct {
+    uint32_t cycles_last;       // Cycles the last chunk took
+    uint32_t cycles_max;        // Worst chunk since the stats were last read
+    uint32_t cycles_avg;        // Running average per chunk
+    uint32_t budget_cycles;     // CPU cycles in one chunk of audio at the last rate
+    uint8_t bands;              // Biquads per channel now running
+    uint16_t crossover_hz;      // 0 when the crossover is off
+} eq_stats_t;
+
+/**
+ * @brief Pick up a changed EQ configuration from any task
+ *
+ * pcm_handler applies it at the start of its next chunk, with fresh filter
+ * state.
+ */
+void eq_reload(void);
+
+/**
+ * @brief Clear filter state (stream start / underrun)
+ */
+void eq_reset(void);
+
+/**
+ * @brief Filter one playout chunk in place
+ *
+ * @param buf Host-order stereo PCM at the playout width
+ * @param len Bytes
+ * @param bits Playout sample width (16, 24 or 32)
+ * @param sample_rate Playout rate
+ */
+void eq_process(uint8_t *buf, size_t len, uint8_t bits, uint32_t sample_rate);
+
+/**
+ * @brief Read the load counters; cycles_max restarts from the next chunk
+ */
+void eq_get_stats(eq_stats_t *stats);
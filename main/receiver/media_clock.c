@@ -0,0 +1,71 @@
+#include "media_clock.h"
+#include "sdkconfig.h"
+#include "build_config.h"
+#include "global.h"
+#include "clock/clock_service.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#ifdef CONFIG_PTP_ENABLED
+#include "ptp_slave.h"
+#endif
+
+#ifndef CONFIG_AES67_LINK_OFFSET_MS
+#define CONFIG_AES67_LINK_OFFSET_MS 20
+#endif
+
+static atomic_bool s_ptp_direct = false;
+static atomic_uint_fast32_t s_offset = 0;
+static atomic_uint_fast32_t s_delay_us = (uint32_t)CONFIG_AES67_LINK_OFFSET_MS * 1000u;
+
+void media_clock_configure(bool ptp_direct, uint32_t offset) {
+#ifdef CONFIG_PTP_ENABLED
+    if (ptp_direct != atomic_load(&s_ptp_direct) || offset != atomic_load(&s_offset)) {
+        ESP_LOGI(TAG, "Media clock: %s (offset %lu)", ptp_direct ? "PTP direct" : "RTCP", (unsigned long)offset);
+    }
+#endif
+    atomic_store(&s_offset, offset);
+    atomic_store(&s_ptp_direct, ptp_direct);
+}
+
+void media_clock_set_delay_ms(uint32_t ms) {
+    atomic_store(&s_delay_us, (ms ? ms : (uint32_t)CONFIG_AES67_LINK_OFFSET_MS) * 1000u);
+}
+
+bool media_clock_active(void) {
+#ifdef CONFIG_PTP_ENABLED
+    return atomic_load(&s_ptp_direct) && clock_service_source() == CLOCK_SOURCE_PTP;
+#else
+    return false;
+#endif
+}
+
+bool media_clock_playout_time(uint32_t rtp_ts, uint32_t sample_rate, uint64_t *playout_time) {
+#ifdef CONFIG_PTP_ENABLED
+    if (!playout_time || sample_rate == 0u || !media_clock_active()) {
+        return false;
+    }
+    // The clock service runs on the PTP servo here, in UTC; the media clock counts TAI
+    int64_t now = esp_timer_get_time();
+    int64_t ptp_us = clock_service_mono_to_master(now) + (int64_t)ptp_slave_utc_offset() * 1000000LL;
+    if (ptp_us < 0) {
+        return false;
+    }
+    // Media clock now: samples of PTP time since the epoch, plus the SDP offset, mod 2^32
+    uint64_t sec = (uint64_t)ptp_us / 1000000ULL;
+    uint64_t rem_us = (uint64_t)ptp_us % 1000000ULL;
+    uint64_t samples = sec * sample_rate + rem_us * sample_rate / 1000000ULL;
+    uint32_t rtp_now = (uint32_t)samples + (uint32_t)atomic_load(&s_offset);
+
+    // Signed distance, so packets from the past (all of them) come out negative
+    int64_t ahead_us = (int64_t)(int32_t)(rtp_ts - rtp_now) * 1000000LL / (int64_t)sample_rate;
+    int64_t playout = now + ahead_us + (int64_t)atomic_load(&s_delay_us);
+    *playout_time = playout > 0 ? (uint64_t)playout : 0u;
+    return true;
+#else
+    (void)rtp_ts;
+    (void)sample_rate;
+    (void)playout_time;
+    return false;
+#endif
+}
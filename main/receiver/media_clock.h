@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * RFC 7273 / AES67 media clock: playout from the RTP timestamp alone.
+ *
+ * An AES67 sender's RTP timestamps count samples of PTP time (TAI since 1970)
+ * plus the offset its SDP gives in a=mediaclk:direct, so with our PTP slave
+ * locked to the same grandmaster a packet's presentation time is known the
+ * moment it arrives: no RTCP sender report is needed, and every receiver in
+ * the venue plays the same sample at the same instant, one link offset after
+ * it was captured.
+ *
+ * The SAP handler configures it from the stream's SDP; the RTP path asks it
+ * for a playout time before falling back to the RTCP mapping. It answers only
+ * while the stream is PTP-referenced and the clock service is running on PTP.
+ */
+
+/**
+ * @brief Set the stream's clock reference from its SDP
+ * @param ptp_direct a=ts-refclk:ptp with a=mediaclk:direct (or none, which RFC 7273 reads as direct=0)
+ * @param offset RTP timestamp at PTP time zero, from a=mediaclk:direct=<offset>
+ */
+void media_clock_configure(bool ptp_direct, uint32_t offset);
+
+/**
+ * @brief Playout delay after the capture instant (0 = CONFIG_AES67_LINK_OFFSET_MS)
+ */
+void media_clock_set_delay_ms(uint32_t ms);
+
+/**
+ * @brief Whether the current stream is PTP-referenced and PTP is locked
+ */
+bool media_clock_active(void);
+
+/**
+ * @brief Local monotonic (esp_timer) playout time of an RTP timestamp
+ * @return false when the media clock is not active
+ */
+bool media_clock_playout_time(uint32_t rtp_ts, uint32_t sample_rate, uint64_t *playout_time);
@@ -0,0 +1,206 @@
+#include "mixer.h"
+#include "buffer.h"
+#include "audio_out.h"
+#include "global.h"
+#include "lifecycle_manager.h"
+#include "dsp/pcm_kernels.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+/*
+ * Each overlay stream is an SPSC FIFO of chunks. The producer fills the slot at
+ * `head` in place (it doubles as the repackaging accumulator) and publishes it
+ * by advancing head; the consumer drains from `tail`. Stream slots are claimed
+ * and recycled by the producer only: a recycled stream's leftover chunks carry
+ * old playout times and are discarded by the consumer as late.
+ */
+
+#define MIX_STREAMS CONFIG_RX_MIX_MAX_STREAMS
+#define MIX_DEPTH   CONFIG_RX_MIX_STREAM_CHUNKS
+
+typedef struct {
+    uint8_t *data;                      // MIX_DEPTH chunks
+    uint64_t playout_us[MIX_DEPTH];     // Playout time of each chunk's first frame
+    atomic_uint_fast32_t head;          // Chunks published (producer)
+    atomic_uint_fast32_t tail;          // Chunks consumed (consumer)
+
+    // Producer-only state
+    uint32_t ssrc;
+    bool in_use;
+    int64_t last_rx_us;
+    uint32_t fill;                      // Bytes accumulated in the slot at head
+} mix_stream_t;
+
+static mix_stream_t streams[MIX_STREAMS];
+static uint8_t *mix_memory = NULL;
+static uint32_t chunk_bytes = 0;
+static uint32_t chunk_us = 0;
+
+static atomic_uint_fast32_t stat_mixed    = 0;
+static atomic_uint_fast32_t stat_late     = 0;
+static atomic_uint_fast32_t stat_overflow = 0;
+static atomic_uint_fast32_t stat_rejected = 0;
+
+esp_err_t mixer_setup(void) {
+    uint32_t bytes = buffer_get_chunk_size();
+    uint32_t bytes_per_sec = lifecycle_get_sample_rate() * 2u * (audio_out_sample_bits() / 8u);
+
+    if (mix_memory) {
+        heap_caps_free(mix_memory);
+        mix_memory = NULL;
+    }
+    chunk_bytes = 0;
+
+    if (audio_out_sample_bits() != 16) {
+        // Overlay chunks are summed as 16-bit samples
+        ESP_LOGW(TAG, "Overlay mixer needs 16-bit playout, disabled at %u bits",
+                 (unsigned)audio_out_sample_bits());
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    size_t total = (size_t)bytes * MIX_DEPTH * MIX_STREAMS;
+    uint8_t *mem = heap_caps_malloc(total, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+        mem = heap_caps_malloc(total, MALLOC_CAP_8BIT);
+    }
+    if (!mem) {
+        ESP_LOGE(TAG, "Failed to allocate overlay mixer (%u bytes)", (unsigned)total);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < MIX_STREAMS; i++) {
+        mix_stream_t *s = &streams[i];
+        s->data = mem + (size_t)i * bytes * MIX_DEPTH;
+        atomic_store(&s->head, 0);
+        atomic_store(&s->tail, 0);
+        s->ssrc = 0;
+        s->in_use = false;
+        s->last_rx_us = 0;
+        s->fill = 0;
+    }
+    mix_memory = mem;
+    chunk_bytes = bytes;
+    chunk_us = bytes_per_sec ? (uint32_t)(((uint64_t)bytes * 1000000ULL) / bytes_per_sec) : 0;
+
+    ESP_LOGI(TAG, "Overlay mixer: %d streams x %d chunks (%u KB)",
+             MIX_STREAMS, MIX_DEPTH, (unsigned)(total / 1024u));
+    return ESP_OK;
+}
+
+// Producer: stream for `ssrc`, claiming a free or idle slot for a new source
+static mix_stream_t *stream_for(uint32_t ssrc, int64_t now) {
+    mix_stream_t *spare = NULL;
+    for (int i = 0; i < MIX_STREAMS; i++) {
+        mix_stream_t *s = &streams[i];
+        if (s->in_use && s->ssrc == ssrc) {
+            return s;
+        }
+        if (!spare && (!s->in_use || now - s->last_rx_us > (int64_t)CONFIG_RX_MIX_IDLE_MS * 1000)) {
+            spare = s;
+        }
+    }
+    if (spare) {
+        ESP_LOGI(TAG, "Overlay stream 0x%08X joined", ssrc);
+        spare->ssrc = ssrc;
+        spare->in_use = true;
+        spare->fill = 0;
+    }
+    return spare;
+}
+
+bool mixer_push(uint32_t ssrc, const uint8_t *pcm, size_t len, uint64_t playout_us) {
+    if (!mix_memory || chunk_bytes == 0) {
+        return false;
+    }
+
+    int64_t now = esp_timer_get_time();
+    mix_stream_t *s = stream_for(ssrc, now);
+    if (!s) {
+        atomic_fetch_add_explicit(&stat_rejected, 1, memory_order_relaxed);
+        return false;
+    }
+    s->last_rx_us = now;
+
+    size_t offset = 0;
+    while (offset < len) {
+        uint32_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+        if (head - tail >= MIX_DEPTH) {
+            // Consumer isn't keeping up (or not playing); drop the rest of this payload
+            atomic_fetch_add_explicit(&stat_overflow, 1, memory_order_relaxed);
+            s->fill = 0;
+            return false;
+        }
+
+        uint32_t idx = head % MIX_DEPTH;
+        if (s->fill == 0) {
+            s->playout_us[idx] = playout_us + ((uint64_t)offset * chunk_us) / chunk_bytes;
+        }
+        size_t to_copy = chunk_bytes - s->fill;
+        if (to_copy > len - offset) {
+            to_copy = len - offset;
+        }
+        memcpy(s->data + (size_t)idx * chunk_bytes + s->fill, pcm + offset, to_copy);
+        s->fill += (uint32_t)to_copy;
+        offset += to_copy;
+
+        if (s->fill == chunk_bytes) {
+            s->fill = 0;
+            atomic_store_explicit(&s->head, head + 1, memory_order_release);
+        }
+    }
+    return true;
+}
+
+void mixer_mix(uint8_t *chunk, size_t len, uint64_t playout_us) {
+    if (!mix_memory || len != chunk_bytes) {
+        return;
+    }
+
+    // Overlay chunks are not phase-locked to the primary; match within half a chunk
+    uint64_t half = chunk_us / 2u;
+    for (int i = 0; i < MIX_STREAMS; i++) {
+        mix_stream_t *s = &streams[i];
+        uint32_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&s->head, memory_order_acquire);
+
+        while (tail != head) {
+            uint32_t idx = tail % MIX_DEPTH;
+            uint64_t due = s->playout_us[idx];
+            if (due + half < playout_us) {
+                atomic_fetch_add_explicit(&stat_late, 1, memory_order_relaxed);
+                tail++;
+                continue;
+            }
+            if (due <= playout_us + half) {
+                pcm_mix_add_sat16((int16_t *)chunk, (const int16_t *)(s->data + (size_t)idx * chunk_bytes),
+                                  len / sizeof(int16_t));
+                atomic_fetch_add_explicit(&stat_mixed, 1, memory_order_relaxed);
+                tail++;
+            }
+            break;  // Head chunk belongs to a later primary chunk
+        }
+        atomic_store_explicit(&s->tail, tail, memory_order_release);
+    }
+}
+
+void mixer_get_stats(mixer_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    uint32_t active = 0;
+    for (int i = 0; i < MIX_STREAMS; i++) {
+        if (streams[i].in_use && now - streams[i].last_rx_us <= (int64_t)CONFIG_RX_MIX_IDLE_MS * 1000) {
+            active++;
+        }
+    }
+    stats->active = active;
+    stats->mixed = atomic_load_explicit(&stat_mixed, memory_order_relaxed);
+    stats->late = atomic_load_explicit(&stat_late, memory_order_relaxed);
+    stats->overflow = atomic_load_explicit(&stat_overflow, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&stat_rejected, memory_order_relaxed);
+}
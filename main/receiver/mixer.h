@@ -0,0 +1,59 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Overlay mixer for additional RTP sources (CONFIG_RX_MIX_ENABLED).
+ *
+ * The primary SSRC keeps the full jitter buffer (buffer.c). Every other SSRC
+ * heard on the port gets a small per-stream FIFO here; the PCM handler sums
+ * the chunks whose playout time matches the primary chunk into it before
+ * output. Producer is the UDP receive task, consumer is the PCM handler.
+ */
+
+// Overlay mixer counters
+typedef struct {
+    uint32_t active;    // Overlay streams currently heard
+    uint32_t mixed;     // Chunks summed into the output
+    uint32_t late;      // Chunks dropped because their playout time had passed
+    uint32_t overflow;  // Chunks dropped because a stream's FIFO was full
+    uint32_t rejected;  // Packets dropped because every stream slot was busy
+} mixer_stats_t;
+
+/**
+ * @brief Size the per-stream FIFOs for the current chunk size
+ *
+ * Call after setup_buffer() when starting a receiver mode.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED unless playout is 16-bit,
+ *         ESP_ERR_NO_MEM if the FIFOs could not be allocated
+ */
+esp_err_t mixer_setup(void);
+
+/**
+ * @brief Queue audio from an overlay SSRC (producer only)
+ *
+ * Payloads of any length are repackaged into chunks; each chunk is stamped
+ * with the playout time of its first frame.
+ *
+ * @param ssrc Source of the payload
+ * @param pcm Host-order interleaved PCM
+ * @param len Payload length in bytes (whole frames)
+ * @param playout_us Playout time of the first frame (esp_timer_get_time() domain)
+ * @return true if the payload was queued
+ */
+bool mixer_push(uint32_t ssrc, const uint8_t *pcm, size_t len, uint64_t playout_us);
+
+/**
+ * @brief Sum the overlay chunks due with a primary chunk into it (consumer only)
+ *
+ * @param chunk Primary chunk (host order), mixed in place with saturation
+ * @param len Chunk length in bytes
+ * @param playout_us Playout time of the primary chunk
+ */
+void mixer_mix(uint8_t *chunk, size_t len, uint64_t playout_us);
+
+void mixer_get_stats(mixer_stats_t *stats);
@@ -1,4 +1,4 @@
-// RTP packet structure: [12-byte RTP header] + [1152-byte PCM audio payload]
+// RTP packet structure: [12-byte RTP header] + [one ptime worth of PCM audio payload]
 // Total packet size: 1164 bytes
 
 #include "sdkconfig.h"
@@ -12,9 +12,14 @@
 #ifdef CONFIG_RTCP_ENABLED
 #include "rtcp_receiver.h"
 #endif
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+#include "rtcp_rr.h"
+#endif
 #include "esp_netif.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
+#include "wifi_manager.h"
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -24,27 +29,60 @@
 #include <arpa/inet.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
+#include "log_rate.h"
+#include "metrics.h"
+#include "metrics_profile.h"
+#include "metrics_bench.h"
 #include "buffer.h"
+#include "plc.h"
+#include "mixer.h"
+#include "stream_switch.h"
+#include "opus_in.h"
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+#include "rtp_rx_lwip.h"
+#endif
+#include "media_clock.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
 #include "config/config_manager.h"
 #include "pcm_visualizer.h"  // For pcm_viz_write
+#include "dsp/pcm_convert.h"
+#include "dsp/pcm_kernels.h"
+#ifdef CONFIG_RTP_FEC_ENABLED
+#include "rtp/rtp_fec.h"
+#include "esp_heap_caps.h"
+#include "lifecycle/cpu_governor.h"
+#endif
+#include "logging/event_trace.h"
+#include "lifecycle/pipeline_topology.h"
+#include "lifecycle/net_iface.h"
+#ifdef CONFIG_RTP_SRTP_ENABLED
+#include "rtp/rtp_srtp.h"
+#endif
+#ifdef CONFIG_RTP_RELAY_ENABLED
+#include "rtp/rtp_relay.h"
+#endif
+#ifdef CONFIG_RTP_LATENCY_PROBE
+#include "rtp/rtp_probe.h"
+#include "clock/clock_service.h"
+#endif
+#include "rtp/rtp_capture.h"
 
 // Low-rate summary interval default if not provided by Kconfig
 #ifndef CONFIG_RTP_RX_LOG_SUMMARY_INTERVAL_MS
 #define CONFIG_RTP_RX_LOG_SUMMARY_INTERVAL_MS 5000
 #endif
 /*
- * Runtime audio bytes-per-ms helper.
+ * Runtime audio bytes-per-ms helper, for the stream as sent (all of its channels).
  * 192 bytes/ms is only true for 48kHz, 16-bit, 2-channel audio (48000 * 2 * 2 / 1000 = 192).
  * Using this helper avoids reintroducing that magic number and adapts to runtime configuration.
  */
 static inline uint32_t rtp_bytes_per_ms(void) {
     uint32_t sample_rate = lifecycle_get_sample_rate();
     uint32_t bit_depth   = lifecycle_get_bit_depth();
-
-    // TODO: If a runtime channels accessor becomes available, use it; default to stereo for now.
-    uint32_t channels = 2;
+    uint32_t channels    = lifecycle_get_stream_channels();
 
     if (sample_rate == 0 || bit_depth == 0 || channels == 0) {
         return 0;
@@ -77,8 +115,8 @@ typedef struct __attribute__((packed)) {
 
 // Network constants
 #define UDP_PORT CONFIG_RTP_PORT
-#define MAX_RTP_PACKET_SIZE (sizeof(rtp_header_t) + (15 * 4) + PCM_CHUNK_SIZE + 512)  // Max: 12 + 60 (CSRCs) + audio + 512 (padding/extensions)
- // PCM chunk size provided by global.h (PCM_CHUNK_SIZE)
+#define MAX_RTP_PACKET_SIZE (sizeof(rtp_header_t) + (15 * 4) + PCM_CHUNK_MAX_SIZE + 512)  // Max: 12 + 60 (CSRCs) + audio + 512 (padding/extensions)
+ // Chunk size is fixed per mode start by setup_buffer() (buffer_get_chunk_size())
 // SAP functionality moved to sap_listener.c
 
 // Socket and task handles
@@ -87,34 +125,232 @@ static int multicast_sock = -1;  // Socket for multicast groups (when in multica
 #ifdef CONFIG_RTCP_ENABLED
 static int rtcp_sock = -1;  // Socket for RTCP packets (port + 1)
 #endif
+#if defined(CONFIG_RX_SCREAM_ENABLED) && CONFIG_RX_SCREAM_PORT != 0 && !defined(CONFIG_RTP_RX_BACKEND_LWIP_RAW)
+#define RX_SCREAM_SOCKET 1
+static int scream_sock = -1;  // Dedicated Scream port: every packet is Scream
+#endif
+static uint16_t rx_port = UDP_PORT;  // Configured RTP port, RTCP on rx_port + 1
+// Silent marked packets dropped while the buffer sat out a DTX pause
+static uint32_t packets_keepalive = 0;
 static TaskHandle_t udp_handler_task = NULL;
-
-// Accumulator to repackage arbitrary RTP payload sizes into PCM_CHUNK_SIZE chunks
-// Avoids dropping "non-standard" payload sizes by buffering and emitting exact 1152-byte blocks.
-static uint8_t  agg_buf[PCM_CHUNK_SIZE];
+// Periodic stats/summary logging, kept off the receive path: the timer only wakes
+// rx_stats_task, which does the RTCP lookups and the logging at low priority
+#define RX_STATS_TASK_STACK 4096
+static esp_timer_handle_t rx_stats_timer = NULL;
+static TaskHandle_t rx_stats_task_handle = NULL;    // Created with the first start and kept
+static SemaphoreHandle_t rx_stats_lock = NULL;      // Held by the task over a report
+static bool rx_stats_running = false;               // Under rx_stats_lock
+
+// Accumulator to repackage arbitrary RTP payload sizes into ring-sized chunks
+// Avoids dropping "non-standard" payload sizes by buffering and emitting exact chunk-sized blocks.
+static uint8_t  agg_buf[PCM_CHUNK_MAX_SIZE];
 static uint16_t agg_len = 0;              // Current fill length in bytes
 static uint32_t agg_rtp_start_ts = 0;     // RTP timestamp corresponding to agg_buf[0]
 static uint32_t agg_last_ssrc = 0;        // Guard to avoid mixing sources across accumulator
+#ifdef CONFIG_RX_MIX_ENABLED
+static int64_t  primary_last_rx_us = 0;   // Last packet from agg_last_ssrc (overlay mixer)
+#endif
 
-// RTP statistics
-static uint32_t packets_received = 0;
-static uint32_t packets_lost = 0;
-// Kept for legacy stats accessor; no longer updated in RTCP path
-static uint32_t packets_dropped_late = 0;
+// Payload -> playout sample conversion, chosen once per stream in network_init()
+#define RX_CHANNELS 2   // Playout channels: the jitter buffer and every sink are stereo
+static struct {
+    pcm_convert_fn convert;
+    uint8_t in_bytes;   // Payload bytes per sample (L16/L24/L32)
+    uint8_t out_bytes;  // Playout bytes per sample (audio_out_sample_bits())
+    uint8_t channels;   // Payload channels per frame (2..PCM_CHANNELS_MAX)
+    uint8_t left;       // Channel map: the payload channels played as the stereo pair
+    uint8_t right;
+    bool extract;       // Payload frames are not the pair already: pick it before converting
+} rx_format;
+
+// Resolve the configured channel map against a stream of `channels`; false when its frames
+// already are the playout pair, in order
+static bool rx_resolve_channel_map(uint8_t channels, uint8_t *left, uint8_t *right) {
+    uint8_t l = lifecycle_get_channel_left();
+    uint8_t r = lifecycle_get_channel_right();
+    if (l >= channels || r >= channels) {
+        ESP_LOGW(TAG, "Channel map %u/%u is outside a %u-channel stream, playing 0/1", l, r, channels);
+        l = 0;
+        r = 1;
+    }
+    *left = l;
+    *right = r;
+    return channels != RX_CHANNELS || l != 0 || r != 1;
+}
+
+// Payload frames -> the playout pair in place, still in the payload's byte order
+static inline void rx_extract_pair(uint8_t *audio_data, uint32_t frames) {
+    if (rx_format.extract) {
+        pcm_extract_pair(audio_data, audio_data, frames, rx_format.channels,
+                         rx_format.left, rx_format.right, rx_format.in_bytes);
+    }
+}
+
+// Payload type routed to the Opus decoder (0 = linear PCM stream). While set, the decoder
+// task is the jitter buffer's producer and udp_handler only forwards payloads.
+static uint8_t rx_opus_pt = 0;
+
+// Chunk sequencing for the jitter buffer: chunk seq = extended RTP timestamp / frames per chunk,
+// so reordered packets and accumulator output share one numbering
+static uint64_t rx_ext_ts = 0;            // Extended (unwrapped) RTP timestamp of the last packet
+static uint32_t rx_last_ts = 0;
+static uint32_t rx_ext_ssrc = 0;
+static bool     rx_ext_valid = false;
+static uint32_t next_chunk_seq = 0;       // Predicted seq of the next in-order chunk (zero-copy target)
+static bool     next_chunk_seq_valid = false;
+
+// RTP statistics (also exported at /metrics)
+static metrics_counter_t packets_received =
+    METRICS_COUNTER_INIT("rtp_rx_packets_total", "RTP packets received");
+static metrics_counter_t packets_lost =
+    METRICS_COUNTER_INIT("rtp_rx_lost_total", "RTP packets lost (sequence gaps)");
+// Chunks that arrived after their jitter-buffer slot was already played
+static metrics_counter_t packets_dropped_late =
+    METRICS_COUNTER_INIT("rtp_rx_late_total", "RTP chunks dropped for arriving after their playout slot");
 
 // Track enqueue path usage (RTCP mapped vs legacy fallback)
-static uint32_t mapped_enqueue_count = 0;
+// Per-stage cycles on the receive task (CONFIG_METRICS_PROFILER)
+static metrics_profile_t prof_recv = METRICS_PROFILE_INIT("rx_recv", "Socket read of one datagram");
+static metrics_profile_t prof_parse = METRICS_PROFILE_INIT("rx_parse", "RTP header, sequence and payload checks");
+static metrics_profile_t prof_convert = METRICS_PROFILE_INIT("rx_convert", "Network order to playout format");
+static metrics_profile_t prof_playout = METRICS_PROFILE_INIT("rx_playout_time", "RTCP playout time mapping");
+static metrics_profile_t prof_push = METRICS_PROFILE_INIT("rx_push_chunk", "Jitter buffer enqueue");
+
+#ifdef CONFIG_RTP_SRTP_ENABLED
+// Keyed per stream in network_init(); inactive (plain RTP) when no key is configured
+static rtp_srtp_t rx_srtp;
+static metrics_profile_t prof_srtp = METRICS_PROFILE_INIT("rx_srtp", "SRTP authentication and decryption");
+static metrics_counter_t packets_rejected =
+    METRICS_COUNTER_INIT("rtp_rx_srtp_rejected_total", "SRTP packets dropped for failed authentication or replay");
+#define RX_SRTP_ACTIVE() rtp_srtp_active(&rx_srtp)
+#else
+#define RX_SRTP_ACTIVE() false
+#endif
+
+static metrics_counter_t mapped_enqueue_count =
+    METRICS_COUNTER_INIT("rtp_rx_mapped_enqueue_total", "Chunks scheduled from the RTCP timestamp mapping");
 static uint32_t legacy_enqueue_count = 0;
+// Chunks received straight into a jitter-buffer slot (no staging copies)
+static uint32_t zero_copy_count = 0;
+
+// Steady-state fast path: once a stream's first well-formed packet is seen, later packets with
+// the same length and header shape (flags, payload type, SSRC) skip re-validation. Primed per
+// stream with the chunk size and sample width of that stream; anything else takes the full parser.
+static struct {
+    bool primed;
+    int len;
+    uint32_t mask[3];    // Over the 12-byte fixed header, in wire byte order
+    uint32_t expect[3];
+} rx_fast;
+static uint32_t fast_path_count = 0;
+#ifdef CONFIG_RTP_FEC_ENABLED
+// Recent media packets as received (wire format), for rebuilding a lost one from parity
+static rtp_fec_entry_t fec_entries[CONFIG_RTP_FEC_WINDOW_PACKETS];
+static rtp_fec_window_t fec_window;
+static uint8_t *fec_bodies = NULL;        // Allocated per stream in network_init()
+static uint8_t fec_scratch[MAX_RTP_PACKET_SIZE];
+// Parity packets whose group lost more than one packet
+static uint32_t fec_unrecoverable = 0;
+#endif
+// Lost packets rebuilt from FEC parity
+static metrics_counter_t packets_recovered =
+    METRICS_COUNTER_INIT("rtp_rx_fec_recovered_total", "Lost RTP packets rebuilt from FEC parity");
+
+#ifdef CONFIG_RTP_RX_REDUNDANT_PATHS
+// Redundant paths (unicast + multicast, or two APs) deliver each packet twice; the first
+// copy wins. Per source, a bitmap of the last RTP_DEDUP_WINDOW extended sequence numbers.
+#define RTP_DEDUP_WINDOW  256
+#define RTP_DEDUP_SOURCES 4   // Primary plus the overlay mixer's sources
+typedef struct {
+    uint32_t ssrc;
+    uint32_t high;            // Highest extended sequence number seen
+    int64_t  last_us;
+    bool     valid;
+    uint32_t seen[RTP_DEDUP_WINDOW / 32];
+} rtp_dedup_source_t;
+static rtp_dedup_source_t dedup_sources[RTP_DEDUP_SOURCES];
+// Second copies dropped
+static uint32_t packets_duplicate = 0;
+
+// True if this (ssrc, seq) was already accepted from either path
+static bool rtp_dedup_seen(uint32_t ssrc, uint16_t seq) {
+    rtp_dedup_source_t *src = NULL;
+    rtp_dedup_source_t *oldest = &dedup_sources[0];
+    for (int i = 0; i < RTP_DEDUP_SOURCES; i++) {
+        if (dedup_sources[i].valid && dedup_sources[i].ssrc == ssrc) {
+            src = &dedup_sources[i];
+            break;
+        }
+        if (!dedup_sources[i].valid ||
+            (oldest->valid && dedup_sources[i].last_us < oldest->last_us)) {
+            oldest = &dedup_sources[i];
+        }
+    }
+    int64_t now_us = esp_timer_get_time();
+    if (!src) {
+        // New source takes the least recently heard entry
+        src = oldest;
+        memset(src, 0, sizeof(*src));
+        src->ssrc = ssrc;
+        src->high = (1u << 16) | seq;  // Offset so sequence numbers just behind stay positive
+        src->valid = true;
+    }
+    src->last_us = now_us;
+
+    int16_t delta = (int16_t)(seq - (uint16_t)src->high);
+    uint32_t ext = src->high + (int32_t)delta;
+    if (delta > 0) {
+        // Moving forward: forget the bits the window slides past
+        if (delta >= RTP_DEDUP_WINDOW) {
+            memset(src->seen, 0, sizeof(src->seen));
+        } else {
+            for (uint32_t e = src->high + 1; e != ext + 1; e++) {
+                src->seen[(e % RTP_DEDUP_WINDOW) / 32] &= ~(1u << (e % 32));
+            }
+        }
+        src->high = ext;
+    } else if (-delta >= RTP_DEDUP_WINDOW) {
+        return false;  // Too old to tell; the jitter buffer will drop it as late
+    }
+
+    uint32_t word = (ext % RTP_DEDUP_WINDOW) / 32;
+    uint32_t bit = 1u << (ext % 32);
+    if (src->seen[word] & bit) {
+        return true;
+    }
+    src->seen[word] |= bit;
+    return false;
+}
+#endif
 // Multicast configuration
 typedef struct {
     bool enabled;
-    char multicast_ip[16];
+    char multicast_ip[NETWORK_IP_STR_MAX];
     uint16_t port;
     uint32_t ssrc_filter;
     bool filter_by_ssrc;
+    bool ipv6;                   // Group joined with MLD
+    // SSM: only `source` is taken on the group. ssm_joined when the stack filters (IGMPv3);
+    // otherwise udp_handler drops the other senders as they arrive.
+    bool source_check;
+    bool ssm_joined;
+    struct in_addr source;
     struct ip_mreq mreq;
+#if defined(CONFIG_RTP_RX_MULTICAST_SSM) && defined(IP_ADD_SOURCE_MEMBERSHIP)
+    struct ip_mreq_source mreq_source;
+#endif
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    struct ipv6_mreq mreq6;
+#endif
 } multicast_config_t;
 
+#ifndef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+// Datagrams on the group socket from a sender other than the SSM source
+static uint32_t packets_foreign = 0;
+static bool multicast_source_allowed(const multicast_config_t *cfg, const struct sockaddr_storage *from);
+static void leave_group(int sock, multicast_config_t *cfg);
+#endif
+
 static multicast_config_t multicast_config = {
     .enabled = false,
     .multicast_ip = "",
@@ -123,10 +359,24 @@ static multicast_config_t multicast_config = {
     .filter_by_ssrc = false
 };
 
+#if defined(CONFIG_RX_GAPLESS_SWITCH) && !defined(CONFIG_RTP_RX_BACKEND_LWIP_RAW)
+#define RX_GAPLESS_SWITCH 1
+// Group being switched to (stream_switch.c): joined on its own socket, prebuffered next to
+// the playing group, and swapped in for it by udp_handler once the output has faded over
+static int switch_sock = -1;
+static multicast_config_t switch_config;
+static int64_t switch_started_us = 0;
+#endif
+
 static void create_udp_server(void) {
     app_config_t* config = config_manager_get_config();
     uint16_t port = config ? config->port : UDP_PORT;
+    rx_port = port;
 
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    // RTP and RTCP ports are bound as raw lwIP PCBs instead
+    rtp_rx_lwip_open(port);
+#else
     struct sockaddr_in dest_addr;
 
     unicast_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
@@ -138,6 +388,7 @@ static void create_udp_server(void) {
     // Set socket options
     int reuse = 1;
     setsockopt(unicast_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    wifi_manager_mark_audio_socket(unicast_sock);
 
     // Set non-blocking
     int flags = fcntl(unicast_sock, F_GETFL, 0);
@@ -158,6 +409,31 @@ static void create_udp_server(void) {
     }
 
     ESP_LOGI(TAG, "UDP server listening on port %d (unicast socket)", port);
+
+#ifdef RX_SCREAM_SOCKET
+    if (CONFIG_RX_SCREAM_PORT != port) {
+        scream_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+        if (scream_sock >= 0) {
+            setsockopt(scream_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            wifi_manager_mark_audio_socket(scream_sock);
+            flags = fcntl(scream_sock, F_GETFL, 0);
+            fcntl(scream_sock, F_SETFL, flags | O_NONBLOCK);
+            memset(&dest_addr, 0, sizeof(dest_addr));
+            dest_addr.sin_family = AF_INET;
+            dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            dest_addr.sin_port = htons(CONFIG_RX_SCREAM_PORT);
+            if (bind(scream_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr)) < 0) {
+                ESP_LOGE(TAG, "Scream socket unable to bind to port %d: errno %d", CONFIG_RX_SCREAM_PORT, errno);
+                close(scream_sock);
+                scream_sock = -1;
+            } else {
+                ESP_LOGI(TAG, "Scream server listening on port %d", CONFIG_RX_SCREAM_PORT);
+            }
+        } else {
+            ESP_LOGE(TAG, "Unable to create Scream socket: errno %d", errno);
+        }
+    }
+#endif
     
 #ifdef CONFIG_RTCP_ENABLED
     // Create RTCP socket on port + 1
@@ -169,6 +445,7 @@ static void create_udp_server(void) {
     
     // Set socket options
     setsockopt(rtcp_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    wifi_manager_mark_audio_socket(rtcp_sock);  // Receiver Reports go out on it
     
     // Set non-blocking
     flags = fcntl(rtcp_sock, F_GETFL, 0);
@@ -190,13 +467,62 @@ static void create_udp_server(void) {
     
     ESP_LOGI(TAG, "RTCP server listening on port %d", port + 1);
 #endif
+#endif  // CONFIG_RTP_RX_BACKEND_LWIP_RAW
+}
+
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+// rtcp_rr transport: reports leave from the RTCP port so the sender can match them up
+static esp_err_t rtcp_rr_transmit(const uint8_t *data, size_t len, uint32_t addr, uint16_t port) {
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    esp_err_t ret = rtp_rx_lwip_send_rtcp(data, len, addr, port);
+    if (ret == ESP_OK) {
+        rtp_capture_packet(RTP_CAPTURE_TX | RTP_CAPTURE_RTCP, data, len, NULL, 0, 0, rx_port + 1, addr, port);
+    }
+    return ret;
+#else
+    if (rtcp_sock < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    struct sockaddr_in dest_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = addr,
+    };
+    ssize_t sent = sendto(rtcp_sock, data, len, 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    if (sent == (ssize_t)len) {
+        rtp_capture_packet(RTP_CAPTURE_TX | RTP_CAPTURE_RTCP, data, len, NULL, 0, 0, rx_port + 1, addr, port);
+    }
+    return sent == (ssize_t)len ? ESP_OK : ESP_FAIL;
+#endif
+}
+#endif
+
+// Sockets plus the RR scheduler that sends from them
+static void open_rtp_session(void) {
+    create_udp_server();
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+    rtcp_rr_start(rtcp_rr_transmit, rtp_bytes_per_ms() * 1000U);
+#endif
 }
 
 static void close_udp_server(void) {
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+    // BYE goes out while the RTCP port is still bound
+    rtcp_rr_stop();
+#endif
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    rtp_rx_lwip_close();
+#endif
     if (unicast_sock >= 0) {
         close(unicast_sock);
         unicast_sock = -1;
     }
+#ifdef RX_SCREAM_SOCKET
+    if (scream_sock >= 0) {
+        close(scream_sock);
+        scream_sock = -1;
+    }
+#endif
 #ifdef CONFIG_RTCP_ENABLED
     if (rtcp_sock >= 0) {
         close(rtcp_sock);
@@ -211,67 +537,978 @@ static void close_multicast_socket(void) {
         multicast_sock = -1;
     }
 }
-// Low-rate RTP structured summary; prints once per CONFIG_RTP_RX_LOG_SUMMARY_INTERVAL_MS
-static void rtp_log_summary_if_due(void) {
+// Interarrival jitter of the primary source (RTCP receiver stats), in microseconds.
+// Returns false when there is no primary source yet.
+static bool rtp_primary_jitter(uint32_t *primary, int32_t *cumlost, uint32_t *jitter_us) {
+    *jitter_us = 0;
+#ifdef CONFIG_RTCP_ENABLED
+    uint32_t jitter_ts = 0;
+    if (!rtcp_get_primary_ssrc(primary)) {
+        return false;
+    }
+    if (!rtcp_get_rx_stats(*primary, NULL, cumlost, &jitter_ts)) {
+        return false;
+    }
+    // Convert RTP tick jitter to microseconds at the stream rate
+    uint32_t rate = lifecycle_get_sample_rate();
+    uint64_t j_us = ((uint64_t)jitter_ts * 1000000u + rate / 2) / rate;
+    *jitter_us = j_us > UINT32_MAX ? UINT32_MAX : (uint32_t)j_us;
+    return true;
+#else
+    (void)primary;
+    (void)cumlost;
+    return false;
+#endif
+}
+
+// Low-rate RTP structured summary; logged by rx_stats_task every CONFIG_RTP_RX_LOG_SUMMARY_INTERVAL_MS
+// with the primary source's stats it has already looked up
+static void rtp_log_summary(bool have_primary, uint32_t primary, int32_t cumlost, uint32_t jitter_us) {
 #ifndef CONFIG_RTCP_LOG_RX_STATS
+    (void)have_primary;
+    (void)primary;
+    (void)cumlost;
+    (void)jitter_us;
     return;
 #else
-    static uint64_t last_sum_us = 0;
-    const uint64_t interval_us = ((uint64_t)CONFIG_RTP_RX_LOG_SUMMARY_INTERVAL_MS) * 1000ULL;
-    uint64_t now = esp_timer_get_time();
-    if (last_sum_us != 0 && (now - last_sum_us) < interval_us) {
-        return;
-    }
-    last_sum_us = now;
-
     const char *mode_str = multicast_config.enabled ? "Multicast" : "Unicast";
-    uint32_t jitter_us = 0;
-    int32_t cumlost = 0;
-    uint32_t primary = 0;
-    bool have_primary = false;
-
-#ifdef CONFIG_RTCP_ENABLED
-    double jitter_ts = 0.0;
-    if (rtcp_get_primary_ssrc(&primary)) {
-        have_primary = rtcp_get_rx_stats(primary, NULL, &cumlost, &jitter_ts);
-        if (have_primary && jitter_ts > 0.0) {
-            // Convert RTP tick jitter to microseconds using nominal a0
-            double j_us = jitter_ts * (1000000.0 / (double)CONFIG_SAMPLE_RATE);
-            if (j_us < 0.0) j_us = 0.0;
-            if (j_us > (double)UINT32_MAX) j_us = (double)UINT32_MAX;
-            jitter_us = (uint32_t)(j_us + 0.5);
-        }
-    }
-#endif
 
     ESP_LOGI(TAG,
-             "RTP sum: rx=%u lost=%u drop=%u mode=%s filter=%d mapped=%u legacy=%u jitter_us=%u cumlost=%d ssrc=0x%08X",
-             packets_received,
-             packets_lost,
-             packets_dropped_late,
+             "RTP sum: rx=%u lost=%u drop=%u mode=%s filter=%d mapped=%u legacy=%u zc=%u fast=%u jitter_us=%u cumlost=%d ssrc=0x%08X",
+             metrics_counter_get(&packets_received),
+             metrics_counter_get(&packets_lost),
+             metrics_counter_get(&packets_dropped_late),
              mode_str,
              multicast_config.filter_by_ssrc ? 1 : 0,
-             mapped_enqueue_count,
+             metrics_counter_get(&mapped_enqueue_count),
              legacy_enqueue_count,
+             zero_copy_count,
+             fast_path_count,
              jitter_us,
              (int)cumlost,
              have_primary ? primary : 0u);
 #endif
 }
 
+// Periodic RX statistics, replaces per-packet counters in udp_handler (rx_stats_task)
+static void rx_stats_report(void) {
+    uint32_t primary = 0;
+    int32_t cumlost = 0;
+    uint32_t jitter_us = 0;
+    bool have_primary = rtp_primary_jitter(&primary, &cumlost, &jitter_us);
+    rtp_log_summary(have_primary, primary, cumlost, jitter_us);
+
+    // Feed the jitter buffer's latency controller
+    if (have_primary) {
+        buffer_set_jitter_us(jitter_us);
+    }
+
+    static uint32_t last_logged_received = 0;
+    uint32_t received = metrics_counter_get(&packets_received);
+    if (received == last_logged_received) {
+        return;  // Idle; nothing new to report
+    }
+    last_logged_received = received;
+
+    float loss_rate = 0.0f;
+    uint32_t lost = metrics_counter_get(&packets_lost);
+    uint32_t total = received + lost;
+    if (total > 0) {
+        loss_rate = (float)lost / (float)total * 100.0f;
+    }
+    buffer_reorder_stats_t reorder = {0};
+    buffer_get_reorder_stats(&reorder);
+    plc_stats_t plc = {0};
+    plc_get_stats(&plc);
+    ESP_LOGI(TAG, "RTP RX Stats: Received=%u, Lost=%u (%.2f%%), Mode=%s, Late=%u, Reordered=%u, Dup=%u, Concealed=%u, Skipped=%u, PLC=%u/%u (burst %u), Target=%u, Drained=%uB",
+            received, lost, loss_rate,
+            multicast_config.enabled ? "Multicast" : "Unicast",
+            metrics_counter_get(&packets_dropped_late), reorder.reordered, reorder.duplicates, reorder.concealed,
+            reorder.skipped, plc.concealed, plc.silenced, plc.max_burst,
+            buffer_get_target_size(), buffer_get_drained_bytes());
+#ifdef CONFIG_RX_OPUS_ENABLED
+    if (rx_opus_pt != 0) {
+        opus_in_stats_t opus = {0};
+        opus_in_get_stats(&opus);
+        ESP_LOGI(TAG, "RTP Opus: Decoded=%u, Concealed=%u, Late=%u, Overflow=%u, Errors=%u",
+                opus.decoded, opus.concealed, opus.late, opus.overflow, opus.errors);
+    }
+#endif
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    if (rtp_rx_lwip_get_overflows() > 0) {
+        ESP_LOGI(TAG, "RTP lwIP: Queue overflows=%u", rtp_rx_lwip_get_overflows());
+    }
+#endif
+#ifdef CONFIG_RTP_RX_MULTICAST_SSM
+    if (multicast_config.source_check) {
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+        uint32_t foreign = rtp_rx_lwip_get_foreign();
+#else
+        uint32_t foreign = packets_foreign;
+#endif
+        ESP_LOGI(TAG, "RTP SSM: Source=%s (%s), Foreign=%u", inet_ntoa(multicast_config.source),
+                 multicast_config.ssm_joined ? "IGMPv3" : "filtered on arrival", foreign);
+    }
+#endif
+    if (packets_keepalive > 0) {
+        ESP_LOGI(TAG, "RTP DTX: Keepalives=%u", packets_keepalive);
+    }
+#ifdef CONFIG_RTP_RX_REDUNDANT_PATHS
+    ESP_LOGI(TAG, "RTP Paths: Duplicates=%u (%s)", packets_duplicate,
+             multicast_config.enabled ? "unicast + multicast" : "unicast only");
+#endif
+#ifdef CONFIG_RTP_FEC_ENABLED
+    uint32_t recovered = metrics_counter_get(&packets_recovered);
+    if (recovered > 0 || fec_unrecoverable > 0) {
+        ESP_LOGI(TAG, "RTP FEC: Recovered=%u, Unrecoverable=%u", recovered, fec_unrecoverable);
+    }
+#endif
+#ifdef RX_GAPLESS_SWITCH
+    stream_switch_stats_t sw = {0};
+    stream_switch_get_stats(&sw);
+    if (sw.switches > 0 || sw.aborted > 0) {
+        ESP_LOGI(TAG, "RTP Switch: Gapless=%u, Aborted=%u, Overflow=%u", sw.switches, sw.aborted, sw.overflow);
+    }
+#endif
+#ifdef CONFIG_RX_MIX_ENABLED
+    mixer_stats_t mix = {0};
+    mixer_get_stats(&mix);
+    if (mix.active > 0 || mix.mixed > 0) {
+        ESP_LOGI(TAG, "RTP Mix: Overlays=%u, Mixed=%u, Late=%u, Overflow=%u, Rejected=%u",
+                mix.active, mix.mixed, mix.late, mix.overflow, mix.rejected);
+    }
+#endif
+}
+
+static void rx_stats_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(rx_stats_lock, portMAX_DELAY);
+        if (rx_stats_running) {
+            rx_stats_report();
+        }
+        xSemaphoreGive(rx_stats_lock);
+    }
+}
+
+// esp_timer callback: only wakes rx_stats_task
+static void rx_stats_timer_cb(void *arg) {
+    (void)arg;
+    xTaskNotifyGive(rx_stats_task_handle);
+}
+
+// Resolve the playout time for one ring chunk starting at rtp_start_ts.
+// Returns false when no RTCP mapping exists and the legacy fixed delay should be used.
+static bool rtp_resolve_playout(uint32_t ssrc, uint32_t rtp_start_ts, uint32_t bytes_per_frame,
+                                uint64_t *playout_time) {
+    // AES67: the timestamp is PTP time, so the playout instant needs no sender report
+    if (media_clock_playout_time(rtp_start_ts, lifecycle_get_sample_rate(), playout_time)) {
+        return true;
+    }
+#ifdef CONFIG_RTCP_ENABLED
+    uint32_t prof_start = metrics_profile_begin();
+    esp_err_t mapped = rtcp_calculate_playout_time(ssrc, rtp_start_ts, playout_time);
+    metrics_profile_end(&prof_playout, prof_start);
+    if (mapped != ESP_OK) {
+        return false;
+    }
+    uint32_t sample_rate = lifecycle_get_sample_rate();
+    uint32_t bytes_per_sec = sample_rate * bytes_per_frame;
+    if (bytes_per_sec > 0u) {
+        uint64_t packet_dur_us = ((uint64_t)buffer_get_chunk_size() * 1000000ULL) / (uint64_t)bytes_per_sec;
+        int64_t error_us = ((int64_t)*playout_time - (int64_t)esp_timer_get_time()) - (int64_t)packet_dur_us;
+        rtcp_pll_observe(ssrc, error_us, (uint32_t)packet_dur_us);
+    }
+    static uint32_t rtcp_sync_counter = 0;
+    if ((++rtcp_sync_counter % 1000u) == 0u) {
+        int64_t delta_us = (int64_t)*playout_time - (int64_t)esp_timer_get_time();
+        ESP_LOGI(TAG, "RTCP sync: enqueued packet with playout in %lld ms",
+                 (long long)(delta_us / 1000));
+    }
+    return true;
+#else
+    (void)ssrc;
+    (void)rtp_start_ts;
+    (void)bytes_per_frame;
+    (void)playout_time;
+    return false;
+#endif
+}
+
+// Extend a packet's 32-bit RTP timestamp; a new SSRC starts a fresh timeline
+static uint64_t rtp_extend_timestamp(uint32_t ssrc, uint32_t rtp_ts) {
+    if (!rx_ext_valid || ssrc != rx_ext_ssrc) {
+        // Offset by 2^32 so reordered packets just before the first one stay positive
+        rx_ext_ts = (1ULL << 32) + rtp_ts;
+        rx_ext_ssrc = ssrc;
+        rx_ext_valid = true;
+        next_chunk_seq_valid = false;
+    } else {
+        rx_ext_ts += (int64_t)(int32_t)(rtp_ts - rx_last_ts);
+    }
+    rx_last_ts = rtp_ts;
+    return rx_ext_ts;
+}
+
+// Chunk sequence number for a chunk whose first frame has RTP timestamp chunk_ts,
+// given the extended timestamp of the packet it came from
+static uint32_t rtp_chunk_seq(uint64_t packet_ext_ts, uint32_t packet_ts, uint32_t chunk_ts,
+                              uint32_t frames_per_chunk) {
+    uint64_t ext = packet_ext_ts + (int64_t)(int32_t)(chunk_ts - packet_ts);
+    return (uint32_t)(ext / frames_per_chunk);
+}
+
+// Account for the outcome of enqueueing chunk `seq` and predict the next in-order chunk
+static void rtp_enqueue_result(buffer_push_result_t result, uint32_t seq) {
+    if (result == BUFFER_PUSH_LATE) {
+        // Arrived after its slot was already played (or concealed)
+        metrics_counter_inc(&packets_dropped_late);
+    }
+    // Only move forward, so a reordered straggler doesn't derail the prediction
+    if (!next_chunk_seq_valid || (int32_t)(seq + 1 - next_chunk_seq) > 0) {
+        next_chunk_seq = seq + 1;
+        next_chunk_seq_valid = true;
+    }
+}
+
+// Enqueue one packet of playout-format audio: overlay it, publish it in place (zero_copy,
+// payload already in the reserved slot) or repackage it into ring-sized chunks.
+// Runs on the jitter buffer's producer task only.
+static void rtp_enqueue_audio(uint32_t ssrc, uint32_t rtp_ts, uint8_t *audio_data, int payload_len,
+                              uint32_t bpf, uint32_t chunk_bytes, packet_with_ts_t *zc_slot,
+                              uint32_t reserved_seq) {
+    const bool zero_copy = zc_slot != NULL;
+
+    // Track SSRC changes to avoid mixing different sources in the accumulator
+#ifdef CONFIG_RX_MIX_ENABLED
+    // While the primary is live, other sources are overlaid instead of replacing it
+    int64_t now_us = esp_timer_get_time();
+    if (agg_last_ssrc != 0 && ssrc != agg_last_ssrc &&
+        now_us - primary_last_rx_us <= (int64_t)CONFIG_RX_MIX_IDLE_MS * 1000) {
+        uint64_t overlay_playout = 0;
+        if (!rtp_resolve_playout(ssrc, rtp_ts, bpf, &overlay_playout)) {
+            overlay_playout = (uint64_t)now_us + BUFFER_LEGACY_PLAYOUT_DELAY_US;
+        }
+        mixer_push(ssrc, audio_data, (size_t)payload_len, overlay_playout);
+        if (zero_copy) {
+            // The payload landed in the primary's reserved slot; give it back
+            buffer_cancel_slot();
+        }
+        return;
+    }
+    primary_last_rx_us = now_us;
+#endif
+    if (agg_len > 0 && agg_last_ssrc != 0 && ssrc != agg_last_ssrc) {
+        ESP_LOGW(TAG, "SSRC changed 0x%08X -> 0x%08X; resetting accumulator (%u bytes discarded)",
+                 agg_last_ssrc, ssrc, (unsigned)agg_len);
+        agg_len = 0;
+    }
+    agg_last_ssrc = ssrc;
+
+    uint64_t ext_ts = rtp_extend_timestamp(ssrc, rtp_ts);
+    uint32_t frames_per_chunk = chunk_bytes / bpf;
+    uint32_t sample_rate = lifecycle_get_sample_rate();
+    if (sample_rate > 0u) {
+        buffer_set_chunk_duration_us((uint32_t)(((uint64_t)frames_per_chunk * 1000000ULL) / sample_rate));
+    }
+
+    if (zero_copy) {
+        // Payload is already in place; just timestamp and publish the slot
+        uint32_t seq = rtp_chunk_seq(ext_ts, rtp_ts, rtp_ts, frames_per_chunk);
+        if (rx_format.out_bytes == 2) {
+            pcm_viz_write(zc_slot->packet_buffer, chunk_bytes);
+        }
+        uint64_t playout_time = 0;
+        if (rtp_resolve_playout(ssrc, rtp_ts, bpf, &playout_time)) {
+            metrics_counter_inc(&mapped_enqueue_count);
+        } else {
+            playout_time = esp_timer_get_time() + BUFFER_LEGACY_PLAYOUT_DELAY_US;
+            legacy_enqueue_count++;
+        }
+        uint32_t prof_start = metrics_profile_begin();
+        if (seq == reserved_seq) {
+            buffer_commit_slot(playout_time, 0);
+            metrics_profile_end(&prof_push, prof_start);
+            rtp_enqueue_result(BUFFER_PUSH_OK, seq);
+            zero_copy_count++;
+        } else {
+            // Out of order: the reserved slot belongs to another sequence, copy instead
+            buffer_push_result_t result = buffer_push_chunk_seq(zc_slot->packet_buffer, seq,
+                                                                playout_time, 0);
+            buffer_cancel_slot();
+            metrics_profile_end(&prof_push, prof_start);
+            rtp_enqueue_result(result, seq);
+        }
+    }
+
+    int bytes_remaining = zero_copy ? 0 : payload_len;
+    int packet_offset = 0;
+
+    while (bytes_remaining > 0) {
+        // When starting a new chunk, compute the RTP timestamp for its first frame
+        if (agg_len == 0) {
+            if (bpf > 0) {
+                uint32_t frames_offset = (uint32_t)(packet_offset / (int)bpf);
+                agg_rtp_start_ts = rtp_ts + frames_offset;
+            } else {
+                agg_rtp_start_ts = rtp_ts;
+            }
+        }
+
+        int to_copy = (int)chunk_bytes - (int)agg_len;
+        if (to_copy > bytes_remaining) {
+            to_copy = bytes_remaining;
+        }
+
+        memcpy(&agg_buf[agg_len], &audio_data[packet_offset], (size_t)to_copy);
+        agg_len += (uint16_t)to_copy;
+        packet_offset += to_copy;
+        bytes_remaining -= to_copy;
+
+        if (agg_len >= chunk_bytes) {
+            // We have one full chunk ready
+            if (rx_format.out_bytes == 2) {
+                pcm_viz_write(agg_buf, chunk_bytes);
+            }
+
+            uint64_t playout_time = 0;
+            if (rtp_resolve_playout(ssrc, agg_rtp_start_ts, bpf, &playout_time)) {
+                metrics_counter_inc(&mapped_enqueue_count);
+            } else {
+                playout_time = esp_timer_get_time() + BUFFER_LEGACY_PLAYOUT_DELAY_US;
+                legacy_enqueue_count++;
+            }
+            uint32_t seq = rtp_chunk_seq(ext_ts, rtp_ts, agg_rtp_start_ts, frames_per_chunk);
+            uint32_t prof_start = metrics_profile_begin();
+            buffer_push_result_t result = buffer_push_chunk_seq(agg_buf, seq, playout_time, 0);
+            metrics_profile_end(&prof_push, prof_start);
+            rtp_enqueue_result(result, seq);
+            agg_len = 0; // Reset for next chunk (may be completed by current packet remainder)
+        }
+    }
+}
+
+void network_in_enqueue_pcm(uint32_t ssrc, uint32_t rtp_ts, uint8_t *pcm, size_t len) {
+    uint32_t bpf = (uint32_t)rx_format.out_bytes * RX_CHANNELS;
+    // Only the Opus decoder feeds this path, always at 16 bits
+    lifecycle_manager_report_audio_peak(pcm_peak_s16((const int16_t *)pcm, len / sizeof(int16_t)));
+    rtp_enqueue_audio(ssrc, rtp_ts, pcm, (int)len, bpf, buffer_get_chunk_size(), NULL, 0);
+}
+
 // SAP handler moved to sap_listener.c
 
+static inline bool rtp_fast_match(const char *hdr, int len) {
+    if (!rx_fast.primed || len != rx_fast.len) {
+        return false;
+    }
+    uint32_t w[3];
+    memcpy(w, hdr, sizeof(w));
+    return (((w[0] & rx_fast.mask[0]) ^ rx_fast.expect[0]) |
+            ((w[1] & rx_fast.mask[1]) ^ rx_fast.expect[1]) |
+            ((w[2] & rx_fast.mask[2]) ^ rx_fast.expect[2])) == 0;
+}
+
+// Match later packets against this one: V/P/X/CC and payload type (not the marker), and SSRC
+static void rtp_fast_prime(const char *hdr, int len) {
+    static const uint8_t mask_bytes[12] = {
+        0xFF, 0x7F, 0x00, 0x00,     // vpxcc, M|PT, sequence
+        0x00, 0x00, 0x00, 0x00,     // timestamp
+        0xFF, 0xFF, 0xFF, 0xFF,     // SSRC
+    };
+    memcpy(rx_fast.mask, mask_bytes, sizeof(rx_fast.mask));
+    memcpy(rx_fast.expect, hdr, sizeof(rx_fast.expect));
+    for (int i = 0; i < 3; i++) {
+        rx_fast.expect[i] &= rx_fast.mask[i];
+    }
+    rx_fast.len = len;
+    rx_fast.primed = true;
+}
+
+// Version and SSRC filter checks of the generic path; false drops the packet
+static bool rtp_validate_header(const char *rx_buffer, int len) {
+    if (len < sizeof(rtp_header_t)) {
+        LOG_RATE_W(TAG, "Packet too small for RTP header: %d bytes", len);
+        return false;
+    }
+
+    // Parse RTP header
+    const rtp_header_t *rtp = (const rtp_header_t *)rx_buffer;
+
+    // Validate RTP version (should be 2)
+    uint8_t version = RTP_VERSION(rtp->vpxcc);
+    if (version != 2) {
+        const uint8_t *b = (const uint8_t *)rx_buffer;  // len >= 12 here
+        LOG_RATE_W(TAG, "Invalid RTP version: %d (%d bytes: %02X %02X %02X %02X %02X %02X %02X %02X ...)",
+                   version, len, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7]);
+        return false;
+    }
+
+    // Filter by SSRC if in multicast mode
+    if (multicast_config.enabled && multicast_config.filter_by_ssrc) {
+        uint32_t packet_ssrc = ntohl(rtp->ssrc);
+        if (packet_ssrc != multicast_config.ssrc_filter) {
+            static uint32_t filtered_count = 0;
+            static uint32_t last_logged_ssrc = 0;
+            filtered_count++;
+
+            // Log different SSRCs we're filtering out (but not too frequently)
+            if (packet_ssrc != last_logged_ssrc || filtered_count % 1000 == 0) {
+                ESP_LOGD(TAG, "Filtering out packet with SSRC 0x%08X (expected 0x%08X), filtered=%u",
+                        packet_ssrc, multicast_config.ssrc_filter, filtered_count);
+                last_logged_ssrc = packet_ssrc;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// Full header length (fixed header, CSRCs, extension), or -1 if the packet is too short
+static int rtp_header_length(const char *rx_buffer, int len) {
+    const rtp_header_t *rtp = (const rtp_header_t *)rx_buffer;
+    uint8_t cc = RTP_CC(rtp->vpxcc);  // CSRC count (0-15)
+
+    int header_size = sizeof(rtp_header_t) + (cc * 4);  // 12 bytes + 4 bytes per CSRC
+
+    if (len < header_size) {
+        LOG_RATE_W(TAG, "Packet too small for RTP header with %d CSRCs: %d bytes", cc, len);
+        return -1;
+    }
+
+    // Handle RTP header extension if present
+    if (RTP_EXTENSION(rtp->vpxcc)) {
+        if (len < header_size + 4) {  // Need at least 4 bytes for extension header
+            LOG_RATE_W(TAG, "Packet too small for RTP extension header");
+            return -1;
+        }
+        // Extension header: 16-bit profile + 16-bit length (in 32-bit words)
+        const uint8_t *ext_ptr = (const uint8_t *)&rx_buffer[header_size];
+        uint16_t ext_length = (uint16_t)((ext_ptr[2] << 8) | ext_ptr[3]);
+        header_size += 4 + (ext_length * 4);  // Add extension header + extension data
+
+        if (len < header_size) {
+            LOG_RATE_W(TAG, "Packet too small for RTP extension data");
+            return -1;
+        }
+    }
+    return header_size;
+}
+
+#ifdef CONFIG_RX_SCREAM_ENABLED
+// Scream: [rate][bits][channels][channel mask, 2 bytes LE], then interleaved little-endian PCM.
+// The rate byte's top bit selects a 44.1 kHz base (else 48 kHz), the rest a multiplier.
+#define SCREAM_HEADER_SIZE 5
+#define SCREAM_SSRC 0x5343524Du  // "SCRM": Scream carries no source id, so all of it is one source
+
+static struct {
+    uint8_t header[SCREAM_HEADER_SIZE];  // Last header parsed; reparsed only when it changes
+    bool valid;
+    bool playable;           // Header matches the playout rate, with a pair to play
+    pcm_convert_fn convert;  // Little-endian payload -> playout format
+    uint8_t in_bytes;
+    uint8_t channels;
+    uint8_t left;            // Channel map resolved against the header's channel count
+    uint8_t right;
+    bool extract;
+    uint32_t ts;             // Timestamp made up for the jitter buffer: frames received so far
+} scream;
+
+static metrics_counter_t scream_packets =
+    METRICS_COUNTER_INIT("scream_rx_packets_total", "Scream packets received");
+
+// Header fields in range and the payload whole frames of them
+static bool scream_header_plausible(const uint8_t *h, int len) {
+    if (len <= SCREAM_HEADER_SIZE || (h[0] & 0x7F) == 0 || h[2] == 0 || h[2] > 8) {
+        return false;
+    }
+    if (h[1] != 16 && h[1] != 24 && h[1] != 32) {
+        return false;
+    }
+    return ((uint32_t)(len - SCREAM_HEADER_SIZE) % ((uint32_t)(h[1] / 8u) * h[2])) == 0;
+}
+
+static void scream_parse_header(const uint8_t *h) {
+    memcpy(scream.header, h, SCREAM_HEADER_SIZE);
+    scream.valid = true;
+    scream.playable = false;
+
+    uint32_t rate = ((h[0] & 0x80) ? 44100u : 48000u) * (h[0] & 0x7Fu);
+    uint8_t bits = h[1];
+    uint8_t channels = h[2];
+    if (rate != lifecycle_get_sample_rate() || channels < RX_CHANNELS) {
+        LOG_RATE_W(TAG, "Scream stream %u Hz, %u channels not playable (need %u Hz, 2 or more channels)",
+                   (unsigned)rate, channels, (unsigned)lifecycle_get_sample_rate());
+        return;
+    }
+    scream.convert = pcm_convert_select_le(bits, rx_format.out_bytes * 8u);
+    if (!scream.convert) {
+        LOG_RATE_W(TAG, "Scream stream %u-bit cannot play at %u bits", bits, rx_format.out_bytes * 8u);
+        return;
+    }
+    scream.in_bytes = bits / 8u;
+    scream.channels = channels;
+    scream.extract = rx_resolve_channel_map(channels, &scream.left, &scream.right);
+    scream.playable = true;
+    ESP_LOGI(TAG, "Scream stream: %u Hz, %u-bit, %u channels", (unsigned)rate, bits, channels);
+}
+
+// Enqueue one Scream packet (header at rx_buffer). in_slot: the payload is in `slot`, which is
+// reserved for chunk reserved_seq and exactly one chunk long; otherwise it follows the header.
+static void scream_handle_packet(char *rx_buffer, int len, packet_with_ts_t *slot, bool in_slot,
+                                 uint32_t reserved_seq, uint32_t chunk_bytes) {
+    uint32_t prof_start = metrics_profile_begin();
+    const uint8_t *h = (const uint8_t *)rx_buffer;
+    if (!scream_header_plausible(h, len)) {
+        LOG_RATE_W(TAG, "Malformed Scream packet: %d bytes", len);
+        return;
+    }
+    if (rx_opus_pt != 0) {
+        // The Opus decoder task is the jitter buffer's producer for now
+        LOG_RATE_D(TAG, "Dropping Scream packet while an Opus stream is configured");
+        return;
+    }
+    if (!scream.valid || memcmp(h, scream.header, SCREAM_HEADER_SIZE) != 0) {
+        scream_parse_header(h);
+    }
+    if (!scream.playable) {
+        return;
+    }
+    metrics_counter_inc(&scream_packets);
+
+    int payload_len = len - SCREAM_HEADER_SIZE;
+    bool zero_copy = in_slot && scream.in_bytes == rx_format.out_bytes && !scream.extract;
+    if (in_slot && !zero_copy) {
+        // Narrowed or channel-mapped below, so it no longer fills the slot: move it next to the header
+        memcpy(&rx_buffer[SCREAM_HEADER_SIZE], slot->packet_buffer, chunk_bytes);
+    }
+    if (slot && !zero_copy) {
+        buffer_cancel_slot();
+    }
+    metrics_profile_end(&prof_parse, prof_start);
+
+    uint8_t *audio_data = zero_copy ? slot->packet_buffer : (uint8_t *)&rx_buffer[SCREAM_HEADER_SIZE];
+    uint32_t frames = (uint32_t)payload_len / ((uint32_t)scream.in_bytes * scream.channels);
+    prof_start = metrics_profile_begin();
+    if (scream.extract) {
+        pcm_extract_pair(audio_data, audio_data, frames, scream.channels, scream.left, scream.right,
+                         scream.in_bytes);
+    }
+    uint16_t peak = scream.convert(audio_data, audio_data, (size_t)frames * RX_CHANNELS);
+    metrics_profile_end(&prof_convert, prof_start);
+    lifecycle_manager_report_audio_peak(peak);
+
+    uint32_t bpf = (uint32_t)rx_format.out_bytes * RX_CHANNELS;
+    uint32_t ts = scream.ts;
+    scream.ts += frames;
+    rtp_enqueue_audio(SCREAM_SSRC, ts, audio_data, (int)(frames * bpf), bpf, chunk_bytes,
+                      zero_copy ? slot : NULL, reserved_seq);
+}
+#endif
+
+// Parse, filter and enqueue one received RTP packet (header at rx_buffer). With zero_copy the
+// payload is already in `slot`, reserved for chunk reserved_seq; otherwise it follows the header.
+static void rtp_handle_packet(char *rx_buffer, int len, packet_with_ts_t *slot, bool zero_copy,
+                              uint32_t reserved_seq, uint32_t chunk_bytes) {
+    // Only packets that reach the conversion are recorded: drops are not the steady-state cost
+    uint32_t prof_start = metrics_profile_begin();
+    // Same shape as the primed stream: header, length and frame alignment are already known good
+    const bool fast = rtp_fast_match(rx_buffer, len);
+#ifdef CONFIG_RX_SCREAM_ENABLED
+    // Not RTP version 2 but shaped like Scream: a Scream source sending to the RTP port
+    // (never while SRTP is active: Scream cannot be authenticated)
+    if (!fast && !RX_SRTP_ACTIVE() && len > SCREAM_HEADER_SIZE && RTP_VERSION((uint8_t)rx_buffer[0]) != 2 &&
+        scream_header_plausible((const uint8_t *)rx_buffer, len)) {
+        scream_handle_packet(rx_buffer, len, slot, false, reserved_seq, chunk_bytes);
+        return;
+    }
+#endif
+    if (!fast && !rtp_validate_header(rx_buffer, len)) {
+        return;
+    }
+    rtp_header_t *rtp = (rtp_header_t *)rx_buffer;
+
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    if (RX_SRTP_ACTIVE()) {
+        // Never fast or zero-copy here: the stream is not primed and no slot is reserved
+        int srtp_hdr = rtp_header_length(rx_buffer, len);
+        if (srtp_hdr < 0) {
+            return;
+        }
+        metrics_profile_end(&prof_parse, prof_start);
+        prof_start = metrics_profile_begin();
+        int plain_len = rtp_srtp_unprotect(&rx_srtp, (uint8_t *)rx_buffer, (size_t)srtp_hdr, (size_t)len);
+        metrics_profile_end(&prof_srtp, prof_start);
+        if (plain_len < 0) {
+            if (plain_len != RTP_SRTP_ERR_SHORT) {
+                metrics_counter_inc(&packets_rejected);
+            }
+            LOG_RATE_W(TAG, "Dropping SRTP packet seq %u: %s", ntohs(rtp->seq_num),
+                       plain_len == RTP_SRTP_ERR_REPLAY ? "replayed" :
+                       plain_len == RTP_SRTP_ERR_AUTH ? "authentication failed" : "too short");
+            return;
+        }
+        len = plain_len;
+        prof_start = metrics_profile_begin();
+    }
+#endif
+
+    // A packet rebuilt from FEC parity is not counted as received (loss is reported before repair)
+    bool fec_recovered = false;
+#ifdef CONFIG_RTP_FEC_ENABLED
+    if (RTP_PT(rtp->mpt) == CONFIG_RTP_FEC_PAYLOAD_TYPE) {
+        // Parity packet: rebuild the group's lost packet in its place, or drop it
+        if (!fec_bodies || (rtp->vpxcc & 0x3F) != 0) {
+            return;
+        }
+        if (zero_copy) {
+            memcpy(&rx_buffer[sizeof(rtp_header_t)], slot->packet_buffer, chunk_bytes);
+            zero_copy = false;
+        }
+        size_t recovered_len = 0;
+        rtp_fec_result_t fec_result = rtp_fec_recover(&fec_window, (const uint8_t *)rx_buffer,
+                                                      (const uint8_t *)&rx_buffer[sizeof(rtp_header_t)],
+                                                      (size_t)len - sizeof(rtp_header_t),
+                                                      fec_scratch, sizeof(fec_scratch), &recovered_len);
+        if (fec_result == RTP_FEC_UNRECOVERABLE) {
+            fec_unrecoverable++;
+        }
+        if (fec_result != RTP_FEC_RECOVERED) {
+            return;
+        }
+        memcpy(rx_buffer, fec_scratch, recovered_len);
+        len = (int)recovered_len;
+        metrics_counter_inc(&packets_recovered);
+        fec_recovered = true;
+    }
+#endif
+
+#ifdef CONFIG_RTP_RX_REDUNDANT_PATHS
+    // Same stream on both paths: keep whichever copy arrived first
+    if (rtp_dedup_seen(ntohl(rtp->ssrc), ntohs(rtp->seq_num))) {
+        packets_duplicate++;
+        return;
+    }
+#endif
+
+    uint8_t cc = RTP_CC(rtp->vpxcc);
+    uint8_t has_padding = RTP_PADDING(rtp->vpxcc);
+    int header_size = fast ? (int)sizeof(rtp_header_t) : rtp_header_length(rx_buffer, len);
+    if (header_size < 0) {
+        return;
+    }
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    // Probed packets carry an extension, so never take the fast or zero-copy path
+    uint64_t capture_us = 0;
+    if (!fast && RTP_EXTENSION(rtp->vpxcc)) {
+        int ext_off = (int)sizeof(rtp_header_t) + cc * 4;
+        int64_t capture_master_us = 0;
+        if (rtp_probe_parse((const uint8_t *)&rx_buffer[ext_off], (size_t)(header_size - ext_off),
+                            CONFIG_RTP_LATENCY_PROBE_EXT_ID, &capture_master_us)) {
+            int64_t mono = clock_service_master_to_mono(capture_master_us);
+            capture_us = mono > 0 ? (uint64_t)mono : 1;
+        }
+    }
+#endif
+
+#ifdef CONFIG_RTP_FEC_ENABLED
+    if (fec_bodies && !fec_recovered) {
+        // Keep the wire bytes for parity recovery; the payload is converted in place below
+        const uint8_t *body = zero_copy ? slot->packet_buffer : (const uint8_t *)&rx_buffer[sizeof(rtp_header_t)];
+        rtp_fec_window_store(&fec_window, (const uint8_t *)rx_buffer, body, (size_t)len - sizeof(rtp_header_t));
+    }
+#endif
+
+    // Track sequence numbers and update RTCP RX stats
+#ifdef CONFIG_RTCP_ENABLED
+    // Capture arrival time as soon as possible and convert to RTP tick units
+    uint64_t arrival_mono_us = esp_timer_get_time();
+    uint32_t arrival_rtp_ticks = (uint32_t)((arrival_mono_us * (uint64_t)lifecycle_get_sample_rate()) / 1000000ULL);
+#endif
+    static uint16_t last_seq = 0;
+    static bool first_packet = true;
+    uint16_t seq = ntohs(rtp->seq_num);
+    event_trace_add(EVENT_TRACE_RX, fec_recovered, seq, len);
+#ifdef CONFIG_RTCP_ENABLED
+    // Update RTCP-backed receiver stats (extended seq, loss, jitter)
+    uint32_t ssrc = ntohl(rtp->ssrc);
+    uint32_t rtp_ts = ntohl(rtp->timestamp);
+    if (!fec_recovered) {
+        rtcp_update_rx_stats(ssrc, seq, rtp_ts, arrival_rtp_ticks);
+    }
+#ifdef CONFIG_RTCP_SEND_NACK
+    // Gaps ask the sender for a resend; a rebuilt packet clears its request
+    rtcp_rr_note_seq(ssrc, seq);
+#endif
+
+    // Primary SSRC hygiene (decimated): consider switching when not filtering by SSRC
+    static uint32_t primary_decimator = 0;
+    if (!multicast_config.filter_by_ssrc) {
+        if ((++primary_decimator & 0xFFu) == 0) {
+            uint32_t new_primary = 0;
+            if (rtcp_consider_primary_switch(ssrc, &new_primary)) {
+#ifdef CONFIG_RTCP_LOG_SSRC
+                ESP_LOGI(TAG, "Primary SSRC switched to 0x%08X by RX activity", new_primary);
+#endif
+            }
+        }
+    }
+#else
+    // Legacy local loss tracking (disabled when RTCP is enabled to avoid double counting)
+    if (fec_recovered) {
+        // Rebuilt after the fact; its loss was already counted
+    } else if (!first_packet) {
+        uint16_t expected_seq = (last_seq + 1) & 0xFFFF;
+        if (seq != expected_seq) {
+            int lost = (seq - expected_seq) & 0xFFFF;
+            if (lost < 1000) {  // Reasonable threshold for loss vs reordering
+                metrics_counter_add(&packets_lost, lost);
+                LOG_RATE_W(TAG, "Packet loss detected: expected seq %u, got %u (lost %d)",
+                           expected_seq, seq, lost);
+            }
+        }
+    } else {
+        first_packet = false;
+    }
+    if (!fec_recovered) {
+        last_seq = seq;
+    }
+#endif
+    if (!fec_recovered) {
+        metrics_counter_inc(&packets_received);
+    }
+    
+#ifdef CONFIG_RTCP_ENABLED
+    // RTCP RX stats were updated earlier with accurate arrival time
+#endif
+
+    // Calculate payload length
+    int payload_len = len - header_size;
+    
+    // Handle padding if present
+    if (has_padding && payload_len > 0) {
+        // Last byte of payload contains padding length
+        uint8_t padding_len = rx_buffer[len - 1];
+        if (padding_len > payload_len) {
+            LOG_RATE_W(TAG, "Invalid padding length: %d (payload_len=%d)", padding_len, payload_len);
+            return;
+        }
+        payload_len -= padding_len;
+    }
+    
+    // Validate payload size (allow some flexibility but warn if unusual)
+    if (payload_len <= 0) {
+        LOG_RATE_W(TAG, "No audio payload in RTP packet");
+        return;
+    }
+
+    if (RTP_MARKER(rtp->mpt) && buffer_is_paused()) {
+        // A DTX sender marks the first packet after each gap. While the buffer sits out its
+        // pause, a silent one is a keepalive: playing it alone would only end the pause
+        const uint8_t *body = zero_copy ? slot->packet_buffer : (const uint8_t *)&rx_buffer[header_size];
+        uint8_t any = 0;
+        for (int i = 0; i < payload_len; i++) {
+            any |= body[i];
+        }
+        if (any == 0) {
+            packets_keepalive++;
+            return;
+        }
+        buffer_request_reanchor();
+    }
+
+#ifdef CONFIG_RX_OPUS_ENABLED
+    if (rx_opus_pt != 0) {
+        // Compressed stream: the decoder task decodes and enqueues
+        if (RTP_PT(rtp->mpt) == rx_opus_pt) {
+            opus_in_push(ntohl(rtp->ssrc), seq, ntohl(rtp->timestamp),
+                         (const uint8_t *)&rx_buffer[header_size], (size_t)payload_len);
+        } else {
+            LOG_RATE_D(TAG, "Dropping payload type %u, expecting Opus on %u", RTP_PT(rtp->mpt), rx_opus_pt);
+        }
+        return;
+    }
+#endif
+    
+    // One chunk of playout audio, in the payload's sample width and channel count
+    uint32_t expected_payload = (chunk_bytes / ((uint32_t)rx_format.out_bytes * RX_CHANNELS)) *
+                                rx_format.in_bytes * rx_format.channels;
+    if (!fast && payload_len != (int)expected_payload) {
+        // Log as info instead of warning if it's a reasonable audio size
+        if (payload_len % 4 == 0 && payload_len > 100 && payload_len < 8192) {
+            LOG_RATE_D(TAG, "Non-standard payload size: %d bytes (expected %u), header_size=%d, CSRCs=%d",
+                       payload_len, expected_payload, header_size, cc);
+        } else {
+            LOG_RATE_W(TAG, "Unexpected payload size: %d bytes (expected %u), header_size=%d, CSRCs=%d",
+                       payload_len, expected_payload, header_size, cc);
+            return;
+        }
+    }
+    
+    // Extract audio data pointer
+    uint8_t *audio_data = zero_copy ? slot->packet_buffer : (uint8_t *)&rx_buffer[header_size];
+
+    // Require whole frames of the stream's sample width; drop malformed payloads
+    uint32_t in_bpf = (uint32_t)rx_format.in_bytes * rx_format.channels;
+    if (!fast && ((uint32_t)payload_len % in_bpf) != 0u) {
+        LOG_RATE_W(TAG, "Payload not aligned to frame size: payload=%d, bpf=%u (dropping)", payload_len, in_bpf);
+        if (zero_copy) {
+            buffer_cancel_slot();
+        }
+        return;
+    }
+
+    if (fast) {
+        fast_path_count++;
+    } else if (!fec_recovered && !RX_SRTP_ACTIVE() && header_size == (int)sizeof(rtp_header_t) &&
+               !has_padding && payload_len == (int)expected_payload) {
+        // Standard packet of the current stream: take the fast path from the next one on
+        rtp_fast_prime(rx_buffer, len);
+    }
+
+    metrics_profile_end(&prof_parse, prof_start);
+
+    // Channel map, then network order -> playout format, in place with the routines
+    // picked in network_init()
+    uint32_t frames = (uint32_t)payload_len / in_bpf;
+    prof_start = metrics_profile_begin();
+    rx_extract_pair(audio_data, frames);
+    uint16_t peak = rx_format.convert(audio_data, audio_data, (size_t)frames * RX_CHANNELS);
+    metrics_profile_end(&prof_convert, prof_start);
+    // Only audible packets hold off (or wake from) sleep; a sender streaming zeros does not
+    lifecycle_manager_report_audio_peak(peak);
+    uint32_t bpf = (uint32_t)rx_format.out_bytes * RX_CHANNELS; // bytes per interleaved playout frame
+    payload_len = (int)(frames * bpf);
+
+    // Unified accumulator-based enqueue to handle arbitrary payload splits and emit ring-sized chunks
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    buffer_set_capture_time(capture_us);
+#endif
+    rtp_enqueue_audio(ntohl(rtp->ssrc), ntohl(rtp->timestamp), audio_data, payload_len, bpf, chunk_bytes,
+                      zero_copy ? slot : NULL, reserved_seq);
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    buffer_set_capture_time(0);
+#endif
+}
+
+#ifdef RX_GAPLESS_SWITCH
+// Queue one packet of the group being switched to: the generic header checks against its
+// SSRC, then the same payload conversion the ring gets. Packets queue in arrival order.
+static void switch_handle_packet(char *rx_buffer, int len) {
+    if (len < (int)sizeof(rtp_header_t) || RTP_VERSION((uint8_t)rx_buffer[0]) != 2) {
+        return;
+    }
+    const rtp_header_t *rtp = (const rtp_header_t *)rx_buffer;
+    uint32_t ssrc = ntohl(rtp->ssrc);
+    if (switch_config.filter_by_ssrc && ssrc != switch_config.ssrc_filter) {
+        return;
+    }
+#ifdef CONFIG_RTP_FEC_ENABLED
+    if (RTP_PT(rtp->mpt) == CONFIG_RTP_FEC_PAYLOAD_TYPE) {
+        return;  // Parity only repairs the ring's stream
+    }
+#endif
+    int header_size = rtp_header_length(rx_buffer, len);
+    if (header_size < 0) {
+        return;
+    }
+    int payload_len = len - header_size;
+    if (RTP_PADDING(rtp->vpxcc) && payload_len > 0) {
+        uint8_t padding_len = (uint8_t)rx_buffer[len - 1];
+        if (padding_len > payload_len) {
+            return;
+        }
+        payload_len -= padding_len;
+    }
+    uint32_t in_bpf = (uint32_t)rx_format.in_bytes * rx_format.channels;
+    if (payload_len <= 0 || ((uint32_t)payload_len % in_bpf) != 0u) {
+        return;
+    }
+
+    uint8_t *audio_data = (uint8_t *)&rx_buffer[header_size];
+    uint32_t frames = (uint32_t)payload_len / in_bpf;
+    rx_extract_pair(audio_data, frames);
+    rx_format.convert(audio_data, audio_data, (size_t)frames * RX_CHANNELS);
+    uint32_t bpf = (uint32_t)rx_format.out_bytes * RX_CHANNELS;
+
+    uint64_t playout_time = 0;
+    if (!rtp_resolve_playout(ssrc, ntohl(rtp->timestamp), bpf, &playout_time)) {
+        playout_time = esp_timer_get_time() + BUFFER_LEGACY_PLAYOUT_DELAY_US;
+    }
+    stream_switch_push(audio_data, (size_t)frames * bpf, playout_time);
+}
+
+// Make the group being switched to the playing one; the ring takes its packets from now on
+static void switch_swap_in(void) {
+    if (multicast_sock >= 0) {
+        leave_group(multicast_sock, &multicast_config);
+        close_multicast_socket();
+    }
+    multicast_config = switch_config;
+    multicast_sock = switch_sock;
+    switch_sock = -1;
+    // The ring's accumulator and prediction belong to the old group's timeline
+    agg_len = 0;
+    next_chunk_seq_valid = false;
+    rx_fast.primed = false;
+    packets_foreign = 0;
+    ESP_LOGI(TAG, "Now receiving multicast group %s:%d", multicast_config.multicast_ip, multicast_config.port);
+}
+
+// Producer side of a gapless switch, run before every receive: leave the old group once the
+// output has faded over, and route the new group into the ring once the consumer emptied it.
+// Both happen between two of the new group's chunks so neither queue nor ring gets half of one.
+static void switch_service(void) {
+    if (switch_sock < 0) {
+        return;
+    }
+    stream_switch_state_t state = stream_switch_get_state();
+    if (state == STREAM_SWITCH_PREBUFFER &&
+        esp_timer_get_time() - switch_started_us > (int64_t)CONFIG_RX_SWITCH_TIMEOUT_MS * 1000) {
+        ESP_LOGW(TAG, "Group %s not prebuffered within %d ms, switching without a fade",
+                 switch_config.multicast_ip, CONFIG_RX_SWITCH_TIMEOUT_MS);
+        stream_switch_cancel();
+        switch_swap_in();
+        return;
+    }
+    if (state == STREAM_SWITCH_IDLE) {
+        // Cancelled from outside mid-switch: keep the group that was asked for last
+        switch_swap_in();
+        return;
+    }
+    if (!stream_switch_at_boundary()) {
+        return;
+    }
+    if (state == STREAM_SWITCH_HANDOVER && multicast_sock >= 0) {
+        leave_group(multicast_sock, &multicast_config);
+        close_multicast_socket();
+        ESP_LOGI(TAG, "Left multicast group %s after the fade", multicast_config.multicast_ip);
+        stream_switch_advance(STREAM_SWITCH_HANDOVER, STREAM_SWITCH_FLUSH);
+    } else if (state == STREAM_SWITCH_REFILL && stream_switch_advance(STREAM_SWITCH_REFILL, STREAM_SWITCH_DRAIN)) {
+        switch_swap_in();
+    }
+}
+#endif
+
+#ifndef CONFIG_RTP_RX_BACKEND_LWIP_RAW
 static void udp_handler(void *pvParameters) {
     // RTP packet buffer - allocate enough for maximum possible RTP packet
     char rx_buffer[MAX_RTP_PACKET_SIZE];
-    struct sockaddr_in source_addr;
-    socklen_t socklen = sizeof(source_addr);
+    // Room for an IPv6 sender on the group socket; every other socket is IPv4
+    union {
+        struct sockaddr_in v4;
+        struct sockaddr_storage any;
+    } source;
+    socklen_t socklen = sizeof(source);
     fd_set read_fds;
     struct timeval tv;
 
     while (1) {
-        // Periodic RTP summary (low rate)
-        rtp_log_summary_if_due();
+        // Release a zero-copy reservation left behind by a packet we dropped
+        buffer_cancel_slot();
+#ifdef RX_GAPLESS_SWITCH
+        switch_service();
+#endif
 
         // Setup select with both sockets
         FD_ZERO(&read_fds);
@@ -288,6 +1525,24 @@ static void udp_handler(void *pvParameters) {
                 max_fd = multicast_sock;
             }
         }
+
+#ifdef RX_GAPLESS_SWITCH
+        if (switch_sock >= 0) {
+            FD_SET(switch_sock, &read_fds);
+            if (switch_sock > max_fd) {
+                max_fd = switch_sock;
+            }
+        }
+#endif
+
+#ifdef RX_SCREAM_SOCKET
+        if (scream_sock >= 0) {
+            FD_SET(scream_sock, &read_fds);
+            if (scream_sock > max_fd) {
+                max_fd = scream_sock;
+            }
+        }
+#endif
         
 #ifdef CONFIG_RTCP_ENABLED
         if (rtcp_sock >= 0) {
@@ -304,30 +1559,44 @@ static void udp_handler(void *pvParameters) {
             continue;
         }
 
-        tv.tv_sec = 0;
-        tv.tv_usec = 0;
+        // Block until data arrives; the timeout only lets us notice socket changes
+        tv.tv_sec = CONFIG_RTP_RX_SELECT_TIMEOUT_MS / 1000;
+        tv.tv_usec = (CONFIG_RTP_RX_SELECT_TIMEOUT_MS % 1000) * 1000;
 
         int select_result = select(max_fd + 1, &read_fds, NULL, NULL, &tv);
         
         if (select_result < 0) {
-            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            LOG_RATE_E(TAG, "select failed: errno %d", errno);
             vTaskDelay(pdMS_TO_TICKS(10));
             continue;
         } else if (select_result == 0) {
-            // Timeout, no data available - yield to other tasks
-            vTaskDelay(0);
+            // Timeout, no data available
             continue;
         }
 
         // Check which socket has data and read from it
         int active_sock = -1;
         bool is_rtcp = false;
+        bool is_scream = false;
+        bool is_switch = false;
         
         if (unicast_sock >= 0 && FD_ISSET(unicast_sock, &read_fds)) {
             active_sock = unicast_sock;
         } else if (multicast_sock >= 0 && FD_ISSET(multicast_sock, &read_fds)) {
             active_sock = multicast_sock;
         }
+#ifdef RX_GAPLESS_SWITCH
+        else if (switch_sock >= 0 && FD_ISSET(switch_sock, &read_fds)) {
+            active_sock = switch_sock;
+            is_switch = true;
+        }
+#endif
+#ifdef RX_SCREAM_SOCKET
+        else if (scream_sock >= 0 && FD_ISSET(scream_sock, &read_fds)) {
+            active_sock = scream_sock;
+            is_scream = true;
+        }
+#endif
 #ifdef CONFIG_RTCP_ENABLED
         else if (rtcp_sock >= 0 && FD_ISSET(rtcp_sock, &read_fds)) {
             active_sock = rtcp_sock;
@@ -339,319 +1608,502 @@ static void udp_handler(void *pvParameters) {
             continue;  // No data available
         }
 
-        // Data is available, read it
-        int len = recvfrom(active_sock, rx_buffer, sizeof(rx_buffer), 0,
-                          (struct sockaddr *)&source_addr, &socklen);
+        // Data is available, read it.
+        // Audio is scattered so the payload of a standard packet (12-byte RTP or 5-byte
+        // Scream header + one chunk) lands directly in the next free jitter-buffer slot;
+        // the header and any excess go to rx_buffer.
+        const uint32_t chunk_bytes = buffer_get_chunk_size();
+#ifdef RX_SCREAM_SOCKET
+        const size_t hdr_len = is_scream ? SCREAM_HEADER_SIZE : sizeof(rtp_header_t);
+#else
+        const size_t hdr_len = sizeof(rtp_header_t);
+#endif
+        uint32_t reserved_seq = next_chunk_seq;
+        // SRTP payloads are decrypted in rx_buffer, with the tag after them, and channel-mapped
+        // payloads shrink to the pair: no slot
+        packet_with_ts_t *slot = (is_rtcp || is_switch || rx_opus_pt != 0 || !next_chunk_seq_valid ||
+                                  (!is_scream && (RX_SRTP_ACTIVE() || rx_format.extract))) ? NULL
+                                 : buffer_reserve_slot(reserved_seq);
+        int len;
+        uint32_t prof_start = metrics_profile_begin();
+        if (slot) {
+            struct iovec iov[3] = {
+                { .iov_base = rx_buffer, .iov_len = hdr_len },
+                { .iov_base = slot->packet_buffer, .iov_len = chunk_bytes },
+                { .iov_base = &rx_buffer[hdr_len + chunk_bytes],
+                  .iov_len = sizeof(rx_buffer) - hdr_len - chunk_bytes },
+            };
+            struct msghdr msg = {
+                .msg_name = &source,
+                .msg_namelen = sizeof(source),
+                .msg_iov = iov,
+                .msg_iovlen = 3,
+            };
+            len = recvmsg(active_sock, &msg, 0);
+        } else {
+            socklen = sizeof(source);
+            len = recvfrom(active_sock, rx_buffer, sizeof(rx_buffer), 0,
+                          (struct sockaddr *)&source, &socklen);
+        }
+        metrics_profile_end(&prof_recv, prof_start);
 
         if (len < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 continue;
             }
-            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
-            break;
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            break;
+        }
+
+        // SSM without IGMPv3 in the stack: another sender to the group goes no further
+        if (active_sock == multicast_sock && !multicast_source_allowed(&multicast_config, &source.any)) {
+            packets_foreign++;
+            continue;
+        }
+
+#ifdef RX_GAPLESS_SWITCH
+        if (is_switch) {
+            if (multicast_source_allowed(&switch_config, &source.any)) {
+                switch_handle_packet(rx_buffer, len);
+            } else {
+                packets_foreign++;
+            }
+            continue;
+        }
+#endif
+
+        // Zero-copy only for the common shape: exact chunk, no CSRC/extension/padding,
+        // and nothing pending in the accumulator that would have to be emitted first.
+        bool zero_copy = false;
+        if (slot) {
+            if (is_scream) {
+                // Scream's sample width is only known from its header; the handler decides
+                zero_copy = len == (int)(hdr_len + chunk_bytes) && agg_len == 0;
+            } else {
+                zero_copy = rx_format.in_bytes == rx_format.out_bytes && !rx_format.extract &&
+                            (len == (int)(sizeof(rtp_header_t) + chunk_bytes)) &&
+                            (((uint8_t)rx_buffer[0] & 0x3F) == 0) && agg_len == 0;
+            }
+            if (!zero_copy && len > (int)hdr_len) {
+                // Odd packet: make rx_buffer contiguous and leave the slot uncommitted
+                size_t in_slot = (size_t)len - hdr_len;
+                if (in_slot > chunk_bytes) {
+                    in_slot = chunk_bytes;
+                }
+                memcpy(&rx_buffer[hdr_len], slot->packet_buffer, in_slot);
+            }
         }
 
 #ifdef CONFIG_RTCP_ENABLED
         // Check if this is an RTCP packet
         if (is_rtcp) {
-            ESP_LOGI(TAG, "Received RTCP packet: %d bytes from %s:%d",
-                    len, inet_ntoa(source_addr.sin_addr), ntohs(source_addr.sin_port));
-            
-            // Parse RTCP packet
-            if (rtcp_parse_packet((uint8_t *)rx_buffer, len) == ESP_OK) {
-                ESP_LOGI(TAG, "RTCP packet parsed successfully");
+            LOG_RATE_D(TAG, "Received RTCP packet: %d bytes from %s:%d",
+                       len, inet_ntoa(source.v4.sin_addr), ntohs(source.v4.sin_port));
+#ifdef CONFIG_RTCP_SEND_RR
+            // Reports go back to whoever sends the SRs
+            if (len >= 2 && (uint8_t)rx_buffer[1] == RTCP_SR) {
+                rtcp_rr_note_peer(source.v4.sin_addr.s_addr, ntohs(source.v4.sin_port), true);
             }
+#endif
+#ifdef CONFIG_RTP_RELAY_ENABLED
+            rtp_relay_forward(true, rx_buffer, (size_t)len, NULL, 0,
+                              source.v4.sin_addr.s_addr, ntohs(source.v4.sin_port));
+#endif
+            rtp_capture_packet(RTP_CAPTURE_RTCP, rx_buffer, (size_t)len, NULL, 0,
+                               source.v4.sin_addr.s_addr, ntohs(source.v4.sin_port), 0, rx_port + 1);
+
+            // Parse RTCP packet
+            rtcp_parse_packet((uint8_t *)rx_buffer, len);
             continue;  // RTCP packets don't contain audio data
         }
 #endif
 
-        if (len < sizeof(rtp_header_t)) {
-            ESP_LOGW(TAG, "Packet too small for RTP header: %d bytes", len);
+#ifdef RX_SCREAM_SOCKET
+        if (is_scream) {
+            uint32_t work_start = cpu_governor_begin();
+            scream_handle_packet(rx_buffer, len, slot, zero_copy, reserved_seq, chunk_bytes);
+            cpu_governor_end(work_start);
             continue;
         }
+#endif
 
-        // Parse RTP header
-        rtp_header_t *rtp = (rtp_header_t *)rx_buffer;
-
-        // Validate RTP version (should be 2)
-        uint8_t version = RTP_VERSION(rtp->vpxcc);
-        if (version != 2) {
-            ESP_LOGW(TAG, "Invalid RTP version: %d (vpxcc=0x%02X)", version, rtp->vpxcc);
-            // Log first few bytes of packet for debugging
-            ESP_LOGW(TAG, "First 16 bytes of packet:");
-            for (int i = 0; i < 16 && i < len; i++) {
-                ESP_LOGW(TAG, "  [%02d]: 0x%02X", i, (uint8_t)rx_buffer[i]);
-            }
-            continue;
-        }
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+        rtcp_rr_note_peer(source.v4.sin_addr.s_addr, ntohs(source.v4.sin_port), false);
+#endif
+#ifdef CONFIG_RTP_RELAY_ENABLED
+        // As received: a zero-copy payload is already in its slot, behind a bare header
+        rtp_relay_forward(false, rx_buffer, zero_copy ? hdr_len : (size_t)len,
+                          zero_copy ? slot->packet_buffer : NULL, zero_copy ? chunk_bytes : 0,
+                          source.v4.sin_addr.s_addr, ntohs(source.v4.sin_port));
+#endif
+        rtp_capture_packet(0, rx_buffer, zero_copy ? hdr_len : (size_t)len,
+                           zero_copy ? slot->packet_buffer : NULL, zero_copy ? chunk_bytes : 0,
+                           source.v4.sin_addr.s_addr, ntohs(source.v4.sin_port),
+                           0, active_sock == multicast_sock ? multicast_config.port : rx_port);
+        uint32_t work_start = cpu_governor_begin();
+        rtp_handle_packet(rx_buffer, len, slot, zero_copy, reserved_seq, chunk_bytes);
+        cpu_governor_end(work_start);
+    }
+    
+    vTaskDelete(NULL);
+}
+#endif
 
-        // Filter by SSRC if in multicast mode
-        if (multicast_config.enabled && multicast_config.filter_by_ssrc) {
-            uint32_t packet_ssrc = ntohl(rtp->ssrc);
-            if (packet_ssrc != multicast_config.ssrc_filter) {
-                static uint32_t filtered_count = 0;
-                static uint32_t last_logged_ssrc = 0;
-                filtered_count++;
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+// Receive loop for the lwIP raw backend: datagrams arrive as pbuf chains, and a
+// standard packet's payload is copied once, straight into its jitter-buffer slot
+static void udp_handler_lwip(void *pvParameters) {
+    char rx_buffer[MAX_RTP_PACKET_SIZE];
 
-                // Log different SSRCs we're filtering out (but not too frequently)
-                if (packet_ssrc != last_logged_ssrc || filtered_count % 1000 == 0) {
-                    ESP_LOGD(TAG, "Filtering out packet with SSRC 0x%08X (expected 0x%08X), filtered=%u",
-                            packet_ssrc, multicast_config.ssrc_filter, filtered_count);
-                    last_logged_ssrc = packet_ssrc;
-                }
-                continue;
-            }
-        }
+    while (1) {
+        // Release a zero-copy reservation left behind by a packet we dropped
+        buffer_cancel_slot();
 
-        // Calculate actual header size based on CSRC count
-        uint8_t cc = RTP_CC(rtp->vpxcc);  // CSRC count (0-15)
-        uint8_t has_extension = RTP_EXTENSION(rtp->vpxcc);
-        uint8_t has_padding = RTP_PADDING(rtp->vpxcc);
-        
-        int header_size = sizeof(rtp_header_t) + (cc * 4);  // 12 bytes + 4 bytes per CSRC
-        
-        if (len < header_size) {
-            ESP_LOGW(TAG, "Packet too small for RTP header with %d CSRCs: %d bytes", cc, len);
+        rtp_rx_lwip_packet_t pkt;
+        if (!rtp_rx_lwip_receive(&pkt, pdMS_TO_TICKS(CONFIG_RTP_RX_SELECT_TIMEOUT_MS))) {
             continue;
         }
-        
-        // Handle RTP header extension if present
-        if (has_extension) {
-            if (len < header_size + 4) {  // Need at least 4 bytes for extension header
-                ESP_LOGW(TAG, "Packet too small for RTP extension header");
-                continue;
-            }
-            // Extension header: 16-bit profile + 16-bit length (in 32-bit words)
-            uint8_t *ext_ptr = (uint8_t *)&rx_buffer[header_size];
-            uint16_t ext_length = ntohs(*(uint16_t *)(ext_ptr + 2));
-            header_size += 4 + (ext_length * 4);  // Add extension header + extension data
-            
-            if (len < header_size) {
-                ESP_LOGW(TAG, "Packet too small for RTP extension data");
-                continue;
-            }
+        size_t total = rtp_rx_lwip_length(&pkt);
+        if (total > sizeof(rx_buffer)) {
+            total = sizeof(rx_buffer);  // Truncate like recvfrom()
         }
 
-        // Track sequence numbers and update RTCP RX stats
+        if (pkt.is_rtcp) {
 #ifdef CONFIG_RTCP_ENABLED
-        // Capture arrival time as soon as possible and convert to RTP tick units
-        uint64_t arrival_mono_us = esp_timer_get_time();
-        uint32_t arrival_rtp_ticks = (uint32_t)((arrival_mono_us * (uint64_t)CONFIG_SAMPLE_RATE) / 1000000ULL);
+            rtp_rx_lwip_copy(&pkt, rx_buffer, total, 0);
+#ifdef CONFIG_RTCP_SEND_RR
+            if (total >= 2 && (uint8_t)rx_buffer[1] == RTCP_SR) {
+                rtcp_rr_note_peer(pkt.src_addr, pkt.src_port, true);
+            }
 #endif
-        static uint16_t last_seq = 0;
-        static bool first_packet = true;
-        uint16_t seq = ntohs(rtp->seq_num);
-#ifdef CONFIG_RTCP_ENABLED
-        // Update RTCP-backed receiver stats (extended seq, loss, jitter)
-        uint32_t ssrc = ntohl(rtp->ssrc);
-        uint32_t rtp_ts = ntohl(rtp->timestamp);
-        rtcp_update_rx_stats(ssrc, seq, rtp_ts, arrival_rtp_ticks);
+#ifdef CONFIG_RTP_RELAY_ENABLED
+            rtp_relay_forward(true, rx_buffer, total, NULL, 0, pkt.src_addr, pkt.src_port);
+#endif
+            rtp_capture_packet(RTP_CAPTURE_RTCP, rx_buffer, total, NULL, 0,
+                               pkt.src_addr, pkt.src_port, 0, rx_port + 1);
+            rtcp_parse_packet((uint8_t *)rx_buffer, (int)total);
+#endif
+            rtp_rx_lwip_release(&pkt);
+            continue;
+        }
 
-        // Primary SSRC hygiene (decimated): consider switching when not filtering by SSRC
-        static uint32_t primary_decimator = 0;
-        if (!multicast_config.filter_by_ssrc) {
-            if ((++primary_decimator & 0xFFu) == 0) {
-                uint32_t new_primary = 0;
-                if (rtcp_consider_primary_switch(ssrc, &new_primary)) {
-#ifdef CONFIG_RTCP_LOG_SSRC
-                    ESP_LOGI(TAG, "Primary SSRC switched to 0x%08X by RX activity", new_primary);
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+        rtcp_rr_note_peer(pkt.src_addr, pkt.src_port, false);
 #endif
-                }
-            }
+        // Header first, to decide where the payload goes
+        uint32_t prof_start = metrics_profile_begin();
+        const uint32_t chunk_bytes = buffer_get_chunk_size();
+        uint32_t reserved_seq = next_chunk_seq;
+        size_t head = rtp_rx_lwip_copy(&pkt, rx_buffer, sizeof(rtp_header_t), 0);
+        packet_with_ts_t *slot = NULL;
+        if (head == sizeof(rtp_header_t) && total == sizeof(rtp_header_t) + chunk_bytes &&
+            (((uint8_t)rx_buffer[0] & 0x3F) == 0) && rx_format.in_bytes == rx_format.out_bytes &&
+            !rx_format.extract && rx_opus_pt == 0 && next_chunk_seq_valid && agg_len == 0 && !RX_SRTP_ACTIVE()) {
+            slot = buffer_reserve_slot(reserved_seq);
         }
-#else
-        // Legacy local loss tracking (disabled when RTCP is enabled to avoid double counting)
-        if (!first_packet) {
-            uint16_t expected_seq = (last_seq + 1) & 0xFFFF;
-            if (seq != expected_seq) {
-                int lost = (seq - expected_seq) & 0xFFFF;
-                if (lost < 1000) {  // Reasonable threshold for loss vs reordering
-                    packets_lost += lost;
-                    ESP_LOGW(TAG, "Packet loss detected: expected seq %u, got %u (lost %d)",
-                            expected_seq, seq, lost);
-                }
-            }
-        } else {
-            first_packet = false;
+        if (slot) {
+            rtp_rx_lwip_copy(&pkt, slot->packet_buffer, chunk_bytes, sizeof(rtp_header_t));
+        } else if (total > head) {
+            rtp_rx_lwip_copy(&pkt, &rx_buffer[head], total - head, head);
         }
-        last_seq = seq;
+        rtp_rx_lwip_release(&pkt);
+        metrics_profile_end(&prof_recv, prof_start);
+
+#ifdef CONFIG_RTP_RELAY_ENABLED
+        rtp_relay_forward(false, rx_buffer, slot ? head : total, slot ? slot->packet_buffer : NULL,
+                          slot ? chunk_bytes : 0, pkt.src_addr, pkt.src_port);
 #endif
-        packets_received++;
-        
-#ifdef CONFIG_RTCP_ENABLED
-        // RTCP RX stats were updated earlier with accurate arrival time
+        rtp_capture_packet(0, rx_buffer, slot ? head : total, slot ? slot->packet_buffer : NULL,
+                           slot ? chunk_bytes : 0, pkt.src_addr, pkt.src_port, 0, rx_port);
+        uint32_t work_start = cpu_governor_begin();
+        rtp_handle_packet(rx_buffer, (int)total, slot, slot != NULL, reserved_seq, chunk_bytes);
+        cpu_governor_end(work_start);
+    }
+}
 #endif
 
-        // Calculate payload length
-        int payload_len = len - header_size;
-        
-        // Handle padding if present
-        if (has_padding && payload_len > 0) {
-            // Last byte of payload contains padding length
-            uint8_t padding_len = rx_buffer[len - 1];
-            if (padding_len > payload_len) {
-                ESP_LOGW(TAG, "Invalid padding length: %d (payload_len=%d)", padding_len, payload_len);
-                continue;
-            }
-            payload_len -= padding_len;
-        }
-        
-        // Validate payload size (allow some flexibility but warn if unusual)
-        if (payload_len <= 0) {
-            ESP_LOGW(TAG, "No audio payload in RTP packet");
+#ifdef CONFIG_RTP_RELAY_ENABLED
+// Receive loop in the relay's listen role: packets come from a forwarding device
+// over ESP-NOW instead of a socket, and are handled as if they had
+static void udp_handler_relay(void *pvParameters) {
+    char rx_buffer[MAX_RTP_PACKET_SIZE];
+
+    while (1) {
+        rtp_relay_meta_t meta;
+        size_t len = rtp_relay_receive(rx_buffer, sizeof(rx_buffer), &meta,
+                                       pdMS_TO_TICKS(CONFIG_RTP_RX_SELECT_TIMEOUT_MS));
+        if (len == 0) {
             continue;
         }
-        
-        if (payload_len != PCM_CHUNK_SIZE) {
-            // Log as info instead of warning if it's a reasonable audio size
-            if (payload_len % 4 == 0 && payload_len > 100 && payload_len < 8192) {
-                ESP_LOGD(TAG, "Non-standard payload size: %d bytes (expected %d), header_size=%d, CSRCs=%d",
-                        payload_len, PCM_CHUNK_SIZE, header_size, cc);
-            } else {
-                ESP_LOGW(TAG, "Unexpected payload size: %d bytes (expected %d), header_size=%d, CSRCs=%d",
-                        payload_len, PCM_CHUNK_SIZE, header_size, cc);
-                continue;
-            }
-        }
-        
-        // Extract audio data pointer
-        uint8_t *audio_data = (uint8_t *)&rx_buffer[header_size];
-        
-        // Convert from network byte order (big-endian) to host byte order (little-endian)
-        // RTP payload is s16be (signed 16-bit big-endian), ESP32 expects s16le
-        uint16_t *samples = (uint16_t *)audio_data;
-        int num_samples = payload_len / 2;  // 2 bytes per sample
-        
-        // Convert all samples from network byte order to host byte order
-        for (int i = 0; i < num_samples; i++) {
-            samples[i] = ntohs(samples[i]);
-        }
-        
-        // Unified accumulator-based enqueue to handle arbitrary payload splits and emit 1152-byte chunks
-        {
-            // Compute alignment by audio frame (channels=2, bytes_per_sample from runtime bit depth)
-            uint32_t bit_depth = lifecycle_get_bit_depth();
-            uint32_t channels = 2; // default stereo unless accessor exists
-            if (bit_depth == 0) {
-                ESP_LOGW(TAG, "Invalid bit depth 0, dropping payload");
-                continue;
-            }
-            uint32_t bytes_per_sample = (bit_depth / 8u);
-            if (bytes_per_sample == 0) {
-                ESP_LOGW(TAG, "Unsupported bit depth %u", bit_depth);
-                continue;
-            }
-            uint32_t bpf = bytes_per_sample * channels; // bytes per interleaved frame
 
-            // Require frame alignment; drop malformed payloads
-            if (((uint32_t)payload_len % bpf) != 0u) {
-                ESP_LOGW(TAG, "Payload not aligned to frame size: payload=%d, bpf=%u (dropping)", payload_len, bpf);
-                continue;
+        if (meta.is_rtcp) {
+#ifdef CONFIG_RTCP_ENABLED
+#ifdef CONFIG_RTCP_SEND_RR
+            // Reports go to the original sender, over Wi-Fi
+            if (len >= 2 && (uint8_t)rx_buffer[1] == RTCP_SR) {
+                rtcp_rr_note_peer(meta.src_addr, meta.src_port, true);
             }
+#endif
+            rtcp_parse_packet((uint8_t *)rx_buffer, (int)len);
+#endif
+            continue;
+        }
 
-            // Track SSRC changes to avoid mixing different sources in the accumulator
-            uint32_t ssrc2 = ntohl(rtp->ssrc);
-            if (agg_len > 0 && agg_last_ssrc != 0 && ssrc2 != agg_last_ssrc) {
-                ESP_LOGW(TAG, "SSRC changed 0x%08X -> 0x%08X; resetting accumulator (%u bytes discarded)",
-                         agg_last_ssrc, ssrc2, (unsigned)agg_len);
-                agg_len = 0;
-            }
-            agg_last_ssrc = ssrc2;
-
-            uint32_t rtp_ts2 = ntohl(rtp->timestamp);
-
-            int bytes_remaining = payload_len;
-            int packet_offset = 0;
-
-            while (bytes_remaining > 0) {
-                // When starting a new 1152-byte chunk, compute the RTP timestamp for its first frame
-                if (agg_len == 0) {
-                    if (bpf > 0) {
-                        uint32_t frames_offset = (uint32_t)(packet_offset / (int)bpf);
-                        agg_rtp_start_ts = rtp_ts2 + frames_offset;
-                    } else {
-                        agg_rtp_start_ts = rtp_ts2;
-                    }
-                }
+#if defined(CONFIG_RTCP_ENABLED) && defined(CONFIG_RTCP_SEND_RR)
+        rtcp_rr_note_peer(meta.src_addr, meta.src_port, false);
+#endif
+        uint32_t work_start = cpu_governor_begin();
+        rtp_handle_packet(rx_buffer, (int)len, NULL, false, next_chunk_seq, buffer_get_chunk_size());
+        cpu_governor_end(work_start);
+    }
+}
+#endif
 
-                int to_copy = (int)PCM_CHUNK_SIZE - (int)agg_len;
-                if (to_copy > bytes_remaining) {
-                    to_copy = bytes_remaining;
-                }
+#ifdef CONFIG_RTP_RX_BENCHMARK
+#define RTP_RX_BENCH_ITERS 2000
+
+// Cycles per packet for the receive path's CPU stages on a synthetic packet of the
+// configured stream: generic header checks, the primed fast match, and payload conversion
+static void rtp_rx_benchmark(void) {
+    uint32_t frames = buffer_get_chunk_size() / ((uint32_t)rx_format.out_bytes * RX_CHANNELS);
+    size_t payload = (size_t)frames * rx_format.channels * rx_format.in_bytes;
+    int len = (int)(sizeof(rtp_header_t) + payload);
+    uint8_t *pkt = malloc((size_t)len);
+    // The extracted pair, still at the payload's width
+    uint8_t *out = malloc((size_t)frames * RX_CHANNELS * rx_format.in_bytes);
+    if (!pkt || !out || frames == 0) {
+        free(pkt);
+        free(out);
+        return;
+    }
 
-                memcpy(&agg_buf[agg_len], &audio_data[packet_offset], (size_t)to_copy);
-                agg_len += (uint16_t)to_copy;
-                packet_offset += to_copy;
-                bytes_remaining -= to_copy;
+    rtp_header_t *hdr = (rtp_header_t *)pkt;
+    hdr->vpxcc = 0x80;
+    hdr->mpt = 0x0B;
+    hdr->seq_num = htons(1);
+    hdr->timestamp = htonl(0);
+    hdr->ssrc = htonl(multicast_config.filter_by_ssrc ? multicast_config.ssrc_filter : 0x5EED5EEDu);
+    uint32_t x = 0x9E3779B9u;
+    for (size_t i = sizeof(rtp_header_t); i < (size_t)len; i++) {
+        x = x * 1664525u + 1013904223u;
+        pkt[i] = (uint8_t)(x >> 24);
+    }
 
-                if (agg_len >= PCM_CHUNK_SIZE) {
-                    // We have one full 1152-byte chunk ready
-                    pcm_viz_write(agg_buf, PCM_CHUNK_SIZE);
+    volatile int sink = 0;
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < RTP_RX_BENCH_ITERS; i++) {
+        sink += rtp_validate_header((const char *)pkt, len) ? rtp_header_length((const char *)pkt, len) : 0;
+    }
+    uint32_t generic = (esp_cpu_get_cycle_count() - t0) / RTP_RX_BENCH_ITERS;
 
-#ifdef CONFIG_RTCP_ENABLED
-                    uint64_t playout_time = 0;
-                    if (rtcp_calculate_playout_time(ssrc2, agg_rtp_start_ts, &playout_time) == ESP_OK) {
-                        // PLL observation identical to the exact-size path
-                        uint32_t sample_rate = lifecycle_get_sample_rate();
-                        uint32_t bytes_per_sec = sample_rate * channels * bytes_per_sample;
-                        if (bytes_per_sec > 0u) {
-                            uint64_t packet_dur_us = ((uint64_t)PCM_CHUNK_SIZE * 1000000ULL) / (uint64_t)bytes_per_sec;
-                            int64_t error_us = ((int64_t)playout_time - (int64_t)esp_timer_get_time()) - (int64_t)packet_dur_us;
-                            rtcp_pll_observe(ssrc2, error_us, (uint32_t)packet_dur_us);
-                        }
-                        push_chunk_with_timestamp(agg_buf, playout_time);
-                        mapped_enqueue_count++;
-                        static uint32_t rtcp_sync_counter = 0;
-                        if ((++rtcp_sync_counter % 1000u) == 0u) {
-                            int64_t delta_us = (int64_t)playout_time - (int64_t)esp_timer_get_time();
-                            ESP_LOGI(TAG, "RTCP sync: enqueued packet with playout in %lld ms",
-                                     (long long)(delta_us / 1000));
-                        }
-                    } else {
-                        push_chunk(agg_buf);
-                        legacy_enqueue_count++;
-                    }
-#else
-                    push_chunk(agg_buf);
-                    legacy_enqueue_count++;
-#endif
-                    agg_len = 0; // Reset for next chunk (may be completed by current packet remainder)
-                }
-            }
-        }
-        
-        // Log statistics periodically
-        static uint32_t stats_counter = 0;
-        if (++stats_counter >= 1000) {
-            float loss_rate = 0.0f;
-            uint32_t total = packets_received + packets_lost;
-            if (total > 0) {
-                loss_rate = (float)packets_lost / (float)total * 100.0f;
-            }
-            ESP_LOGI(TAG, "RTP RX Stats: Received=%u, Lost=%u (%.2f%%), Mode=%s",
-                    packets_received, packets_lost, loss_rate,
-                    multicast_config.enabled ? "Multicast" : "Unicast");
-            stats_counter = 0;
+    rtp_fast_prime((const char *)pkt, len);
+    t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < RTP_RX_BENCH_ITERS; i++) {
+        hdr->seq_num = htons((uint16_t)i);
+        sink += rtp_fast_match((const char *)pkt, len);
+    }
+    uint32_t fast = (esp_cpu_get_cycle_count() - t0) / RTP_RX_BENCH_ITERS;
+    rx_fast.primed = false;
+
+    t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < RTP_RX_BENCH_ITERS; i++) {
+        if (rx_format.extract) {
+            pcm_extract_pair(out, pkt + sizeof(rtp_header_t), frames, rx_format.channels,
+                             rx_format.left, rx_format.right, rx_format.in_bytes);
+            sink += rx_format.convert(out, out, (size_t)frames * RX_CHANNELS);
+        } else {
+            sink += rx_format.convert(out, pkt + sizeof(rtp_header_t), (size_t)frames * RX_CHANNELS);
         }
     }
-    
-    vTaskDelete(NULL);
+    uint32_t convert = (esp_cpu_get_cycle_count() - t0) / RTP_RX_BENCH_ITERS;
+    (void)sink;
+    free(pkt);
+    free(out);
+
+    ESP_LOGI(TAG, "RX benchmark: header %u cycles/packet (fast match %u), convert %u cycles/packet "
+             "(%u frames, L%u/%u ch -> %u-bit stereo)",
+             (unsigned)generic, (unsigned)fast, (unsigned)convert, (unsigned)frames,
+             (unsigned)(rx_format.in_bytes * 8u), (unsigned)rx_format.channels,
+             (unsigned)(rx_format.out_bytes * 8u));
+    metrics_bench_check("rx_header", generic);
+    metrics_bench_check("rx_fast", fast);
+    metrics_bench_check("rx_convert", convert);
 }
+#endif
 
 esp_err_t network_init(void) {
     ESP_LOGI(TAG, "Starting network receiver (RTP mode)");
+
+    metrics_register(&packets_received.base);
+    metrics_register(&packets_lost.base);
+    metrics_register(&packets_dropped_late.base);
+    metrics_register(&packets_recovered.base);
+    metrics_register(&mapped_enqueue_count.base);
+#ifdef CONFIG_RX_SCREAM_ENABLED
+    metrics_register(&scream_packets.base);
+    scream.valid = false;
+#endif
+    metrics_profile_register(&prof_recv);
+    metrics_profile_register(&prof_parse);
+    metrics_profile_register(&prof_convert);
+    metrics_profile_register(&prof_playout);
+    metrics_profile_register(&prof_push);
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    metrics_register(&packets_rejected.base);
+    metrics_profile_register(&prof_srtp);
+
+    // Session keys for this stream; a bad value falls back to plain RTP, loudly
+    rtp_srtp_deinit(&rx_srtp);
+    const char *srtp_crypto = lifecycle_get_srtp_crypto();
+    if (srtp_crypto[0] != '\0') {
+        if (rtp_srtp_init(&rx_srtp, srtp_crypto) == ESP_OK) {
+            ESP_LOGI(TAG, "RX SRTP: %s", rtp_srtp_suite_name(rx_srtp.suite));
+        } else {
+            ESP_LOGE(TAG, "SRTP key is invalid; receiving plain RTP");
+        }
+    }
+#endif
     
 #ifdef CONFIG_RTCP_ENABLED
     // Initialize RTCP receiver
     if (rtcp_init() != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize RTCP receiver");
     }
+    rtcp_set_target_latency_ms(lifecycle_get_low_latency() ? CONFIG_RX_LOW_LATENCY_PLAYOUT_MS : 0);
+    rtcp_set_clock_rate(lifecycle_get_sample_rate());
 #endif
+    media_clock_set_delay_ms(lifecycle_get_low_latency() ? CONFIG_RX_LOW_LATENCY_PLAYOUT_MS : 0);
     
-    create_udp_server();
+    // Fresh jitter buffer: start a new chunk timeline
+    rx_ext_valid = false;
+    next_chunk_seq_valid = false;
+    rx_fast.primed = false;
+#ifdef CONFIG_RTP_RX_REDUNDANT_PATHS
+    memset(dedup_sources, 0, sizeof(dedup_sources));
+#endif
+
+    // Stream sample width -> playout width; both are fixed until the mode restarts
+    uint8_t in_bits = lifecycle_get_bit_depth();
+    uint8_t out_bits = audio_out_sample_bits();
+    rx_format.convert = pcm_convert_select(in_bits, out_bits);
+    if (!rx_format.convert) {
+        ESP_LOGW(TAG, "No L%u -> %u-bit conversion, assuming L16", in_bits, out_bits);
+        in_bits = 16;
+        out_bits = 16;
+        rx_format.convert = pcm_convert_select(in_bits, out_bits);
+    }
+    rx_format.in_bytes = in_bits / 8u;
+    rx_format.out_bytes = out_bits / 8u;
+    rx_format.channels = lifecycle_get_stream_channels();
+    rx_format.extract = rx_resolve_channel_map(rx_format.channels, &rx_format.left, &rx_format.right);
+    ESP_LOGI(TAG, "RX format: L%u payload of %u channels (playing %u/%u), %u-bit playout",
+             in_bits, rx_format.channels, rx_format.left, rx_format.right, out_bits);
+    // Packet buffers are sized for a stereo chunk; wide streams need packets of a shorter ptime
+    size_t stream_packet = sizeof(rtp_header_t) +
+                           (size_t)(buffer_get_chunk_size() / ((size_t)rx_format.out_bytes * RX_CHANNELS)) *
+                           rx_format.in_bytes * rx_format.channels;
+    if (stream_packet > MAX_RTP_PACKET_SIZE) {
+        ESP_LOGW(TAG, "%u-byte packets of %u ms exceed the %u-byte receive buffer; the sender needs a "
+                 "shorter ptime", (unsigned)stream_packet, lifecycle_get_ptime_ms(), (unsigned)MAX_RTP_PACKET_SIZE);
+    }
+
+    rx_opus_pt = lifecycle_get_opus_pt();
+#ifdef CONFIG_RX_OPUS_ENABLED
+    if (rx_opus_pt != 0) {
+        // Decoder output is 16-bit host order stereo, which the L16 -> 16 routine would byte-swap
+        rx_format.in_bytes = 2;
+        rx_format.out_bytes = 2;
+        rx_format.channels = RX_CHANNELS;
+        rx_format.extract = false;
+        if (opus_in_start() == ESP_OK) {
+            ESP_LOGI(TAG, "RX format: Opus on payload type %u", rx_opus_pt);
+        } else {
+            ESP_LOGE(TAG, "Opus stream configured but the decoder is unavailable; its packets will be dropped");
+        }
+    }
+#else
+    if (rx_opus_pt != 0) {
+        ESP_LOGW(TAG, "Opus stream configured (payload type %u) but Opus support is not built in", rx_opus_pt);
+        rx_opus_pt = 0;
+    }
+#endif
+
+#ifdef CONFIG_RTP_FEC_ENABLED
+    // One media payload per window entry, in the stream's wire format
+    size_t fec_body_cap = (size_t)(buffer_get_chunk_size() / ((size_t)rx_format.out_bytes * RX_CHANNELS)) *
+                          rx_format.in_bytes * rx_format.channels;
+    size_t fec_bytes = fec_body_cap * CONFIG_RTP_FEC_WINDOW_PACKETS;
+    heap_caps_free(fec_bodies);
+    fec_bodies = heap_caps_malloc(fec_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!fec_bodies) {
+        fec_bodies = heap_caps_malloc(fec_bytes, MALLOC_CAP_8BIT);
+    }
+    if (fec_bodies) {
+        rtp_fec_window_init(&fec_window, fec_entries, fec_bodies, CONFIG_RTP_FEC_WINDOW_PACKETS,
+                            (uint16_t)fec_body_cap);
+        ESP_LOGI(TAG, "RX FEC: payload type %d, %d-packet window", CONFIG_RTP_FEC_PAYLOAD_TYPE,
+                 CONFIG_RTP_FEC_WINDOW_PACKETS);
+    } else {
+        ESP_LOGW(TAG, "No memory for the FEC window (%u bytes); parity packets will be ignored",
+                 (unsigned)fec_bytes);
+    }
+#endif
 
-    xTaskCreatePinnedToCore(udp_handler, "udp_handler", 6144, NULL,
-                           5, &udp_handler_task, 1);
+#ifdef CONFIG_RTP_RX_BENCHMARK
+    rtp_rx_benchmark();
+#endif
+
+    open_rtp_session();
+
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    // Sockets stay open in the listen role: RTCP reports still leave through them
+    rtp_relay_role_t relay_role = (rtp_relay_role_t)lifecycle_get_relay_role();
+    if (relay_role == RTP_RELAY_LISTEN || relay_role == RTP_RELAY_FORWARD) {
+        esp_err_t relay_err = rtp_relay_start(relay_role, lifecycle_get_relay_peers());
+        if (relay_err != ESP_OK) {
+            ESP_LOGW(TAG, "Relay not started (%s), receiving directly", esp_err_to_name(relay_err));
+        }
+    }
+    if (rtp_relay_role() == RTP_RELAY_LISTEN) {
+        pipeline_task_create(PIPELINE_STAGE_INGEST, udp_handler_relay, "udp_handler", 6144, NULL,
+                             &udp_handler_task);
+    } else
+#endif
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    pipeline_task_create(PIPELINE_STAGE_INGEST, udp_handler_lwip, "udp_handler", 6144, NULL, &udp_handler_task);
+#else
+    pipeline_task_create(PIPELINE_STAGE_INGEST, udp_handler, "udp_handler", 6144, NULL, &udp_handler_task);
+#endif
+
+    if (!rx_stats_task_handle) {
+        rx_stats_lock = xSemaphoreCreateMutex();
+        if (!rx_stats_lock || xTaskCreate(rx_stats_task, "rtp_rx_stats", RX_STATS_TASK_STACK, NULL,
+                                          tskIDLE_PRIORITY + 1, &rx_stats_task_handle) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to start RTP stats task");
+            if (rx_stats_lock) {
+                vSemaphoreDelete(rx_stats_lock);
+                rx_stats_lock = NULL;
+            }
+            rx_stats_task_handle = NULL;
+        }
+    }
+    if (rx_stats_task_handle && !rx_stats_timer) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = rx_stats_timer_cb,
+            .name = "rtp_rx_stats",
+        };
+        if (esp_timer_create(&timer_args, &rx_stats_timer) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to create RTP stats timer");
+            rx_stats_timer = NULL;
+        }
+    }
+    if (rx_stats_timer) {
+        xSemaphoreTake(rx_stats_lock, portMAX_DELAY);
+        rx_stats_running = true;
+        xSemaphoreGive(rx_stats_lock);
+        esp_timer_start_periodic(rx_stats_timer,
+                                 (uint64_t)CONFIG_RTP_RX_LOG_SUMMARY_INTERVAL_MS * 1000ULL);
+    }
 
     // SAP listener functionality moved to sap_listener module
     // It will be started by the lifecycle manager
@@ -663,7 +2115,7 @@ esp_err_t network_init(void) {
 esp_err_t restart_network(void) {
     ESP_LOGI(TAG, "Restarting network (RTP/UDP)...");
     close_udp_server();
-    create_udp_server();
+    open_rtp_session();
     ESP_LOGI(TAG, "Network restarted");
     return ESP_OK;
 }
@@ -686,29 +2138,246 @@ esp_err_t network_update_port(void) {
     vTaskDelay(pdMS_TO_TICKS(10));
     
     // Create new socket with updated port
-    create_udp_server();
+    open_rtp_session();
 
     ESP_LOGI(TAG, "Network port successfully updated to %d", new_port);
     return ESP_OK;
 }
 
-esp_err_t network_join_multicast(const char* multicast_ip, uint16_t port, uint32_t ssrc) {
+#ifndef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+// Non-blocking datagram socket on `port` of every local address of the family
+static int open_group_socket(int family, uint16_t port) {
+    int sock = socket(family, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create multicast socket: errno %d", errno);
+        return -1;
+    }
+
+    // Set socket options for multicast
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    wifi_manager_mark_audio_socket(sock);
+
+    // Set non-blocking
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+    int err;
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    if (family == AF_INET6) {
+        struct sockaddr_in6 addr6;
+        memset(&addr6, 0, sizeof(addr6));  // in6addr_any
+        addr6.sin6_family = AF_INET6;
+        addr6.sin6_port = htons(port);
+        err = bind(sock, (struct sockaddr *)&addr6, sizeof(addr6));
+    } else
+#endif
+    {
+        // Bind to multicast port (use INADDR_ANY to receive multicast)
+        struct sockaddr_in dest_addr;
+        memset(&dest_addr, 0, sizeof(dest_addr));
+        dest_addr.sin_family = AF_INET;
+        dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        dest_addr.sin_port = htons(port);
+        err = bind(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    }
+    if (err < 0) {
+        ESP_LOGE(TAG, "Multicast socket unable to bind to port %d: errno %d", port, errno);
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Join cfg's group on `sock`: source-specific when the stack can, else any-source
+static esp_err_t join_group(int sock, multicast_config_t *cfg, const char *multicast_ip) {
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    if (cfg->ipv6) {
+        // lwIP takes the interface by index; MLD reports leave from its link-local address
+        struct ipv6_mreq *mreq6 = &cfg->mreq6;
+        memset(mreq6, 0, sizeof(*mreq6));
+        inet_pton(AF_INET6, multicast_ip, &mreq6->ipv6mr_multiaddr);
+        esp_netif_t *netif = net_iface_primary();
+        mreq6->ipv6mr_interface = netif ? (unsigned)esp_netif_get_netif_impl_index(netif) : 0;
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_JOIN_GROUP, mreq6, sizeof(*mreq6)) < 0) {
+            ESP_LOGE(TAG, "Failed to join IPv6 multicast group %s: errno %d", multicast_ip, errno);
+            return ESP_FAIL;
+        }
+        return ESP_OK;
+    }
+#endif
+    cfg->mreq.imr_multiaddr.s_addr = inet_addr(multicast_ip);
+    cfg->mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+#if defined(CONFIG_RTP_RX_MULTICAST_SSM) && defined(IP_ADD_SOURCE_MEMBERSHIP)
+    if (cfg->source_check) {
+        struct ip_mreq_source *mreq_source = &cfg->mreq_source;
+        mreq_source->imr_multiaddr = cfg->mreq.imr_multiaddr;
+        mreq_source->imr_sourceaddr = cfg->source;
+        mreq_source->imr_interface = cfg->mreq.imr_interface;
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
+                       mreq_source, sizeof(*mreq_source)) == 0) {
+            cfg->ssm_joined = true;
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Source-specific join refused (errno %d), filtering the source here", errno);
+    }
+#endif
+    if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                   &cfg->mreq, sizeof(cfg->mreq)) < 0) {
+        ESP_LOGE(TAG, "Failed to join multicast group %s: errno %d", multicast_ip, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void leave_group(int sock, multicast_config_t *cfg) {
+    int err;
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    if (cfg->ipv6) {
+        err = setsockopt(sock, IPPROTO_IPV6, IPV6_LEAVE_GROUP,
+                         &cfg->mreq6, sizeof(cfg->mreq6));
+    } else
+#endif
+#if defined(CONFIG_RTP_RX_MULTICAST_SSM) && defined(IP_ADD_SOURCE_MEMBERSHIP)
+    if (cfg->ssm_joined) {
+        err = setsockopt(sock, IPPROTO_IP, IP_DROP_SOURCE_MEMBERSHIP,
+                         &cfg->mreq_source, sizeof(cfg->mreq_source));
+    } else
+#endif
+    {
+        err = setsockopt(sock, IPPROTO_IP, IP_DROP_MEMBERSHIP,
+                         &cfg->mreq, sizeof(cfg->mreq));
+    }
+    if (err < 0) {
+        ESP_LOGW(TAG, "Failed to leave multicast group: errno %d", errno);
+    }
+}
+
+// SSM in software: false for a datagram on a group socket from anyone but cfg's source
+static bool multicast_source_allowed(const multicast_config_t *cfg, const struct sockaddr_storage *from) {
+    if (!cfg->source_check) {
+        return true;
+    }
+    return from->ss_family == AF_INET &&
+           ((const struct sockaddr_in *)from)->sin_addr.s_addr == cfg->source.s_addr;
+}
+#endif
+
+#ifdef RX_GAPLESS_SWITCH
+// Join the new group on a second socket and let udp_handler prebuffer it next to the playing one
+static esp_err_t switch_multicast(const char *multicast_ip, uint16_t port, uint32_t ssrc, bool ipv6,
+                                  struct in_addr source) {
+    multicast_config_t *cfg = &switch_config;
+    memset(cfg, 0, sizeof(*cfg));
+    strncpy(cfg->multicast_ip, multicast_ip, sizeof(cfg->multicast_ip) - 1);
+    cfg->enabled = true;
+    cfg->port = port;
+    cfg->ssrc_filter = ssrc;
+    cfg->filter_by_ssrc = true;
+    cfg->ipv6 = ipv6;
+    cfg->source = source;
+    cfg->source_check = source.s_addr != 0;
+
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    int sock = open_group_socket(ipv6 ? AF_INET6 : AF_INET, port);
+#else
+    int sock = open_group_socket(AF_INET, port);
+#endif
+    if (sock < 0) {
+        return ESP_FAIL;
+    }
+    if (join_group(sock, cfg, multicast_ip) != ESP_OK) {
+        close(sock);
+        return ESP_FAIL;
+    }
+    if (!stream_switch_begin()) {
+        leave_group(sock, cfg);
+        close(sock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    switch_started_us = esp_timer_get_time();
+    switch_sock = sock;  // Published last: udp_handler picks it up on its next select
+    ESP_LOGI(TAG, "Joined multicast group %s:%d alongside %s; switching once it is prebuffered",
+             multicast_ip, port, multicast_config.multicast_ip);
+    return ESP_OK;
+}
+
+// Drop a switch that has not swapped its group in yet
+static void switch_abort(void) {
+    if (switch_sock < 0) {
+        return;
+    }
+    stream_switch_cancel();
+    int sock = switch_sock;
+    switch_sock = -1;
+    leave_group(sock, &switch_config);
+    close(sock);
+    ESP_LOGI(TAG, "Switch to multicast group %s abandoned", switch_config.multicast_ip);
+}
+#endif
+
+esp_err_t network_join_multicast(const char* multicast_ip, const char* source_ip, uint16_t port, uint32_t ssrc) {
     if (!multicast_ip) {
         ESP_LOGE(TAG, "Invalid multicast IP");
         return ESP_ERR_INVALID_ARG;
     }
 
+    // SSM needs an IPv4 group and an IPv4 sender; anything else joins any-source
+    struct in_addr source = { .s_addr = 0 };
+    bool ipv6 = strchr(multicast_ip, ':') != NULL;
+#ifdef CONFIG_RTP_RX_MULTICAST_SSM
+    if (!ipv6 && source_ip && source_ip[0] != '\0' && inet_pton(AF_INET, source_ip, &source) != 1) {
+        source.s_addr = 0;
+    }
+#else
+    (void)source_ip;
+#endif
+#ifndef CONFIG_RTP_RX_MULTICAST_IPV6
+    if (ipv6) {
+        ESP_LOGE(TAG, "IPv6 multicast group %s, but IPv6 multicast receive is not built in", multicast_ip);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+
+#ifdef RX_GAPLESS_SWITCH
+    if (switch_sock >= 0) {
+        if (strcmp(switch_config.multicast_ip, multicast_ip) == 0 && switch_config.port == port &&
+            switch_config.ssrc_filter == ssrc && switch_config.source.s_addr == source.s_addr) {
+            return ESP_OK;  // Already switching to it
+        }
+        ESP_LOGW(TAG, "Switch to %s in progress, not joining %s:%d yet", switch_config.multicast_ip,
+                 multicast_ip, port);
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+
     // Check if we're already connected to this exact multicast group with same parameters
     if (multicast_config.enabled &&
         strcmp(multicast_config.multicast_ip, multicast_ip) == 0 &&
         multicast_config.port == port &&
-        multicast_config.ssrc_filter == ssrc) {
+        multicast_config.ssrc_filter == ssrc &&
+        multicast_config.source.s_addr == source.s_addr) {
         ESP_LOGI(TAG, "Already connected to multicast group %s:%d with SSRC 0x%08X - skipping rejoin",
                 multicast_ip, port, ssrc);
         return ESP_OK;
     }
 
-    ESP_LOGI(TAG, "Joining multicast group %s:%d with SSRC filter 0x%08X", multicast_ip, port, ssrc);
+    ESP_LOGI(TAG, "Joining multicast group %s:%d with SSRC filter 0x%08X, source %s", multicast_ip, port, ssrc,
+             source.s_addr ? inet_ntoa(source) : "any");
+
+#ifdef RX_GAPLESS_SWITCH
+    // A group is playing: prebuffer the new one next to it and fade over instead of rebuffering.
+    // Opus and SRTP streams keep per-stream decoder and key state, so they switch immediately.
+    if (multicast_config.enabled && multicast_sock >= 0 && !buffer_is_underrun() &&
+        rx_opus_pt == 0 && !RX_SRTP_ACTIVE() && stream_switch_available() &&
+        stream_switch_get_state() == STREAM_SWITCH_IDLE) {
+        esp_err_t ret = switch_multicast(multicast_ip, port, ssrc, ipv6, source);
+        if (ret == ESP_OK) {
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Gapless switch failed (%s), switching immediately", esp_err_to_name(ret));
+    }
+#endif
 
     // Leave current multicast group if already joined
     if (multicast_config.enabled) {
@@ -721,55 +2390,44 @@ esp_err_t network_join_multicast(const char* multicast_ip, uint16_t port, uint32
     multicast_config.port = port;
     multicast_config.ssrc_filter = ssrc;
     multicast_config.filter_by_ssrc = true;
-
+    multicast_config.ipv6 = ipv6;
+    multicast_config.source = source;
+    multicast_config.source_check = source.s_addr != 0;
+    multicast_config.ssm_joined = false;
+    rx_fast.primed = false;  // Re-validate against the new SSRC filter
+
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    esp_err_t ret = rtp_rx_lwip_join(multicast_ip, source.s_addr, port);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+#else
     // Close existing multicast socket if any
     close_multicast_socket();
 
     // Create new multicast socket
-    multicast_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    multicast_sock = open_group_socket(ipv6 ? AF_INET6 : AF_INET, port);
+#else
+    multicast_sock = open_group_socket(AF_INET, port);
+#endif
     if (multicast_sock < 0) {
-        ESP_LOGE(TAG, "Unable to create multicast socket: errno %d", errno);
-        return ESP_FAIL;
-    }
-
-    // Set socket options for multicast
-    int reuse = 1;
-    setsockopt(multicast_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-
-    // Set non-blocking
-    int flags = fcntl(multicast_sock, F_GETFL, 0);
-    fcntl(multicast_sock, F_SETFL, flags | O_NONBLOCK);
-
-    // Bind to multicast port (use INADDR_ANY to receive multicast)
-    struct sockaddr_in dest_addr;
-    memset(&dest_addr, 0, sizeof(dest_addr));
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    dest_addr.sin_port = htons(port);
-
-    int err = bind(multicast_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-    if (err < 0) {
-        ESP_LOGE(TAG, "Multicast socket unable to bind to port %d: errno %d", port, errno);
-        close(multicast_sock);
-        multicast_sock = -1;
         return ESP_FAIL;
     }
 
-    // Join multicast group
-    multicast_config.mreq.imr_multiaddr.s_addr = inet_addr(multicast_ip);
-    multicast_config.mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-
-    err = setsockopt(multicast_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
-                     &multicast_config.mreq, sizeof(multicast_config.mreq));
-    if (err < 0) {
-        ESP_LOGE(TAG, "Failed to join multicast group %s: errno %d", multicast_ip, errno);
+    if (join_group(multicast_sock, &multicast_config, multicast_ip) != ESP_OK) {
         close(multicast_sock);
         multicast_sock = -1;
         return ESP_FAIL;
     }
+    packets_foreign = 0;
+#endif
 
     multicast_config.enabled = true;
-    ESP_LOGI(TAG, "Successfully joined multicast group %s:%d (unicast socket remains active)", multicast_ip, port);
+    ESP_LOGI(TAG, "Successfully joined multicast group %s:%d via %s (unicast socket remains active)",
+             multicast_ip, port,
+             ipv6 ? "MLD" : multicast_config.ssm_joined ? "IGMPv3 SSM" :
+             multicast_config.source_check ? "IGMP, source filtered on arrival" : "IGMP");
 
     return ESP_OK;
 }
@@ -782,14 +2440,18 @@ esp_err_t network_leave_multicast(void) {
 
     ESP_LOGI(TAG, "Leaving multicast group %s", multicast_config.multicast_ip);
 
+#ifdef RX_GAPLESS_SWITCH
+    switch_abort();
+#endif
+
+#ifdef CONFIG_RTP_RX_BACKEND_LWIP_RAW
+    rtp_rx_lwip_leave();
+#else
     // Leave multicast group
     if (multicast_sock >= 0) {
-        int err = setsockopt(multicast_sock, IPPROTO_IP, IP_DROP_MEMBERSHIP,
-                            &multicast_config.mreq, sizeof(multicast_config.mreq));
-        if (err < 0) {
-            ESP_LOGW(TAG, "Failed to leave multicast group: errno %d", errno);
-        }
+        leave_group(multicast_sock, &multicast_config);
     }
+#endif
 
     // Close multicast socket
     close_multicast_socket();
@@ -798,7 +2460,12 @@ esp_err_t network_leave_multicast(void) {
     multicast_config.enabled = false;
     multicast_config.filter_by_ssrc = false;
     multicast_config.ssrc_filter = 0;
+    multicast_config.ipv6 = false;
+    multicast_config.source_check = false;
+    multicast_config.ssm_joined = false;
+    multicast_config.source.s_addr = 0;
     memset(multicast_config.multicast_ip, 0, sizeof(multicast_config.multicast_ip));
+    rx_fast.primed = false;
 
     ESP_LOGI(TAG, "Left multicast group (unicast socket remains active)");
     return ESP_OK;
@@ -820,10 +2487,18 @@ void network_get_multicast_info(char* ip, uint16_t* port, uint32_t* ssrc) {
     }
 }
 
-// Check if an IP address is in the multicast range (224.0.0.0 - 239.255.255.255)
+// Check if an IP address is in the multicast range (224.0.0.0 - 239.255.255.255, or ff00::/8)
 static bool is_multicast_ip(const char* ip) {
     if (!ip) return false;
 
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    // IPv6 multicast is ff00::/8
+    struct in6_addr addr6;
+    if (strchr(ip, ':')) {
+        return inet_pton(AF_INET6, ip, &addr6) == 1 && addr6.s6_addr[0] == 0xff;
+    }
+#endif
+
     struct in_addr addr;
     if (inet_pton(AF_INET, ip, &addr) != 1) {
         return false;
@@ -902,7 +2577,8 @@ esp_err_t network_configure_stream(const char* dest_ip, const char* source_ip, u
             ssrc = (last_octet << 16) | port;
         }
 
-        return network_join_multicast(dest_ip, port, ssrc);
+        // The SAP sender is the one source taken on the group (CONFIG_RTP_RX_MULTICAST_SSM)
+        return network_join_multicast(dest_ip, source_ip, port, ssrc);
     } else if (is_local_interface_ip(dest_ip)) {
         ESP_LOGI(TAG, "Destination is local interface address, unicast reception already configured");
 
@@ -923,30 +2599,37 @@ esp_err_t network_configure_stream(const char* dest_ip, const char* source_ip, u
     }
 }
 
-void get_rtp_statistics(uint32_t *received, uint32_t *lost, float *loss_rate) {
+void get_rtp_statistics(uint32_t *received, uint32_t *lost, float *loss_rate, uint32_t *recovered) {
+    uint32_t rx = metrics_counter_get(&packets_received);
+    uint32_t gap = metrics_counter_get(&packets_lost);
     if (received) {
-        *received = packets_received;
+        *received = rx;
     }
     if (lost) {
-        *lost = packets_lost;
+        *lost = gap;
     }
     if (loss_rate) {
-        uint32_t total = packets_received + packets_lost;
+        uint32_t total = rx + gap;
         if (total > 0) {
-            *loss_rate = (float)packets_lost / (float)total * 100.0f;
+            *loss_rate = (float)gap / (float)total * 100.0f;
         } else {
             *loss_rate = 0.0f;
         }
     }
+    if (recovered) {
+        *recovered = metrics_counter_get(&packets_recovered);
+    }
 }
 
 void get_rtp_drop_statistics(uint32_t *dropped, float *drop_rate) {
+    uint32_t late = metrics_counter_get(&packets_dropped_late);
+    uint32_t rx = metrics_counter_get(&packets_received);
     if (dropped) {
-        *dropped = packets_dropped_late;
+        *dropped = late;
     }
     if (drop_rate) {
-        if (packets_received > 0) {
-            *drop_rate = (float)packets_dropped_late / (float)packets_received * 100.0f;
+        if (rx > 0) {
+            *drop_rate = (float)late / (float)rx * 100.0f;
         } else {
             *drop_rate = 0.0f;
         }
@@ -956,13 +2639,39 @@ void get_rtp_drop_statistics(uint32_t *dropped, float *drop_rate) {
 esp_err_t network_deinit(void) {
     ESP_LOGI(TAG, "Stopping network receiver");
     
+    if (rx_stats_timer) {
+        esp_timer_stop(rx_stats_timer);
+        esp_timer_delete(rx_stats_timer);
+        rx_stats_timer = NULL;
+    }
+    if (rx_stats_lock) {
+        // Waits out a report in progress; a wakeup still queued finds nothing to do
+        xSemaphoreTake(rx_stats_lock, portMAX_DELAY);
+        rx_stats_running = false;
+        xSemaphoreGive(rx_stats_lock);
+    }
+
     if (udp_handler_task) {
         vTaskDelete(udp_handler_task);
         udp_handler_task = NULL;
     }
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    rtp_relay_stop();
+#endif
     
     close_udp_server();
+#ifdef RX_GAPLESS_SWITCH
+    switch_abort();
+#endif
     close_multicast_socket();
+
+#ifdef CONFIG_RTP_FEC_ENABLED
+    heap_caps_free(fec_bodies);
+    fec_bodies = NULL;
+#endif
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    rtp_srtp_deinit(&rx_srtp);
+#endif
     
 #ifdef CONFIG_RTCP_ENABLED
     rtcp_deinit();
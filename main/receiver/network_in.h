@@ -4,19 +4,46 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Network receiver functions
 esp_err_t network_init(void);
 esp_err_t restart_network(void);
 esp_err_t network_update_port(void);
 esp_err_t network_deinit(void);
-void get_rtp_statistics(uint32_t *received, uint32_t *lost, float *loss_rate);
+// recovered: lost packets rebuilt from FEC parity (not included in received)
+void get_rtp_statistics(uint32_t *received, uint32_t *lost, float *loss_rate, uint32_t *recovered);
 void get_rtp_drop_statistics(uint32_t *dropped, float *drop_rate);
 
+/**
+ * @brief Enqueue decoded playout-format PCM for a stream (jitter buffer producer only)
+ *
+ * Used by the Opus decoder task; the PCM runs through the same chunk
+ * accumulator, overlay mixer and playout scheduling as RTP L16 payloads.
+ *
+ * @param ssrc Source of the audio
+ * @param rtp_ts RTP timestamp of the first frame
+ * @param pcm Host-order interleaved PCM in the playout sample width
+ * @param len Length in bytes (whole frames)
+ */
+void network_in_enqueue_pcm(uint32_t ssrc, uint32_t rtp_ts, uint8_t *pcm, size_t len);
+
+// Longest address string a group or sender can take (INET6_ADDRSTRLEN)
+#define NETWORK_IP_STR_MAX 46
+
 // Multicast functions
-esp_err_t network_join_multicast(const char* multicast_ip, uint16_t port, uint32_t ssrc);
+/**
+ * @brief Join a multicast group on the RTP port
+ *
+ * @param multicast_ip IPv4 group, or IPv6 group (ff00::/8) when CONFIG_RTP_RX_MULTICAST_IPV6
+ * @param source_ip Sender to accept (CONFIG_RTP_RX_MULTICAST_SSM), or NULL/"" for any-source;
+ *                  IPv4 groups only
+ * @param ssrc SSRC filter, or 0 for none
+ */
+esp_err_t network_join_multicast(const char* multicast_ip, const char* source_ip, uint16_t port, uint32_t ssrc);
 esp_err_t network_leave_multicast(void);
 bool network_is_multicast_enabled(void);
+// ip (if not NULL) must hold NETWORK_IP_STR_MAX bytes
 void network_get_multicast_info(char* ip, uint16_t* port, uint32_t* ssrc);
 
 // Stream configuration function
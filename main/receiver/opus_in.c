@@ -0,0 +1,240 @@
+#include "opus_in.h"
+#include "network_in.h"
+#include "audio_out.h"
+#include "global.h"
+#include "lifecycle_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "audio_arena.h"
+#include "esp_timer.h"
+#include "opus.h"
+#include "lifecycle/pipeline_topology.h"
+
+/*
+ * udp_handler -> decoder is an SPSC ring of packet slots published by advancing
+ * `head`, with a task notification to wake the decoder. The decoder is the jitter
+ * buffer's only producer while an Opus stream is configured (udp_handler stops
+ * reserving slots), so the accumulator in network_in is never shared.
+ *
+ * Opus decoder state is sequential: a packet that turns up after the decoder
+ * moved past it (reordered, or already concealed) is dropped rather than decoded.
+ */
+
+#define OPUS_IN_SAMPLE_RATE 48000
+#define OPUS_IN_CHANNELS    2
+#define OPUS_IN_DEPTH       CONFIG_RX_OPUS_QUEUE_PACKETS
+
+// Largest payload queued; one MTU covers any sane Opus RTP packet
+#ifndef OPUS_IN_MAX_PACKET
+#define OPUS_IN_MAX_PACKET 1500
+#endif
+// Longest packet decoded (60 ms); longer packets are rejected
+#ifndef OPUS_IN_MAX_FRAMES
+#define OPUS_IN_MAX_FRAMES 2880
+#endif
+// Gaps up to this many packets are concealed; longer ones restart the decoder
+#ifndef OPUS_IN_MAX_CONCEAL_PACKETS
+#define OPUS_IN_MAX_CONCEAL_PACKETS 5
+#endif
+// While the current source was heard this recently, other SSRCs are ignored
+#ifndef OPUS_IN_SSRC_IDLE_MS
+#define OPUS_IN_SSRC_IDLE_MS 1000
+#endif
+// The SILK/CELT decoders keep large scratch arrays on the stack
+#ifndef OPUS_IN_TASK_STACK
+#define OPUS_IN_TASK_STACK 16384
+#endif
+
+typedef struct {
+    uint32_t ssrc;
+    uint32_t rtp_ts;
+    uint16_t seq;
+    uint16_t len;
+    uint8_t data[OPUS_IN_MAX_PACKET];
+} opus_in_packet_t;
+
+static opus_in_packet_t *queue = NULL;           // OPUS_IN_DEPTH slots
+static atomic_uint_fast32_t queue_head = 0;      // Packets published (udp_handler)
+static atomic_uint_fast32_t queue_tail = 0;      // Packets consumed (decoder)
+static atomic_bool reset_pending = false;
+
+static TaskHandle_t decoder_task = NULL;
+static OpusDecoder *decoder = NULL;
+static int16_t *pcm = NULL;                      // OPUS_IN_MAX_FRAMES interleaved frames
+
+// Decoder-owned stream position
+static bool     stream_valid = false;
+static uint32_t stream_ssrc = 0;
+static uint16_t next_seq = 0;
+static uint32_t next_ts = 0;
+static int      last_frames = 0;                 // Duration of the last decoded packet
+static int64_t  last_rx_us = 0;
+
+static atomic_uint_fast32_t stat_decoded   = 0;
+static atomic_uint_fast32_t stat_concealed = 0;
+static atomic_uint_fast32_t stat_late      = 0;
+static atomic_uint_fast32_t stat_overflow  = 0;
+static atomic_uint_fast32_t stat_errors    = 0;
+
+// Decode (payload) or conceal (NULL) one packet at rtp_ts and hand the PCM on
+static int decode_and_enqueue(uint32_t ssrc, uint32_t rtp_ts, const uint8_t *data, int len, int frames) {
+    int n = opus_decode(decoder, data, len, pcm, frames, 0);
+    if (n < 0) {
+        atomic_fetch_add_explicit(&stat_errors, 1, memory_order_relaxed);
+        ESP_LOGD(TAG, "Opus decode failed: %s", opus_strerror(n));
+        return n;
+    }
+    network_in_enqueue_pcm(ssrc, rtp_ts, (uint8_t *)pcm, (size_t)n * OPUS_IN_CHANNELS * sizeof(int16_t));
+    return n;
+}
+
+static void process_packet(const opus_in_packet_t *pkt) {
+    int64_t now = esp_timer_get_time();
+    if (stream_valid && pkt->ssrc != stream_ssrc) {
+        if (now - last_rx_us <= (int64_t)OPUS_IN_SSRC_IDLE_MS * 1000) {
+            return;  // One decoder, one source
+        }
+        stream_valid = false;
+    }
+    if (!stream_valid) {
+        ESP_LOGI(TAG, "Opus stream 0x%08X started", pkt->ssrc);
+        opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        stream_ssrc = pkt->ssrc;
+        next_seq = pkt->seq;
+        last_frames = 0;
+        stream_valid = true;
+    }
+    last_rx_us = now;
+
+    int16_t gap = (int16_t)(pkt->seq - next_seq);
+    if (gap < 0) {
+        atomic_fetch_add_explicit(&stat_late, 1, memory_order_relaxed);
+        return;
+    }
+    if (gap > 0) {
+        if (gap <= OPUS_IN_MAX_CONCEAL_PACKETS && last_frames > 0) {
+            // Let the decoder extrapolate the missing packets at their expected times
+            for (int i = 0; i < gap; i++) {
+                int n = decode_and_enqueue(stream_ssrc, next_ts, NULL, 0, last_frames);
+                if (n <= 0) {
+                    break;
+                }
+                next_ts += (uint32_t)n;
+                atomic_fetch_add_explicit(&stat_concealed, 1, memory_order_relaxed);
+            }
+        } else {
+            // Too long to extrapolate; start clean and let the jitter buffer cover the hole
+            opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+        }
+    }
+
+    int frames = opus_packet_get_nb_samples(pkt->data, pkt->len, OPUS_IN_SAMPLE_RATE);
+    if (frames <= 0 || frames > OPUS_IN_MAX_FRAMES) {
+        atomic_fetch_add_explicit(&stat_errors, 1, memory_order_relaxed);
+        next_seq = pkt->seq + 1;
+        return;
+    }
+    int n = decode_and_enqueue(pkt->ssrc, pkt->rtp_ts, pkt->data, pkt->len, OPUS_IN_MAX_FRAMES);
+    next_seq = pkt->seq + 1;
+    if (n > 0) {
+        next_ts = pkt->rtp_ts + (uint32_t)n;
+        last_frames = n;
+        atomic_fetch_add_explicit(&stat_decoded, 1, memory_order_relaxed);
+    }
+}
+
+static void opus_decoder_task(void *pvParameters) {
+    (void)pvParameters;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (atomic_exchange(&reset_pending, false)) {
+            stream_valid = false;
+            atomic_store(&queue_tail, atomic_load(&queue_head));
+        }
+
+        uint32_t tail = atomic_load_explicit(&queue_tail, memory_order_relaxed);
+        while (tail != atomic_load_explicit(&queue_head, memory_order_acquire)) {
+            process_packet(&queue[tail % OPUS_IN_DEPTH]);
+            tail++;
+            atomic_store_explicit(&queue_tail, tail, memory_order_release);
+        }
+    }
+}
+
+esp_err_t opus_in_start(void) {
+    if (lifecycle_get_sample_rate() != OPUS_IN_SAMPLE_RATE || audio_out_sample_bits() != 16) {
+        ESP_LOGE(TAG, "Opus decode needs 48 kHz 16-bit playout (configured %lu Hz, %u-bit)",
+                 (unsigned long)lifecycle_get_sample_rate(), (unsigned)audio_out_sample_bits());
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (decoder_task) {
+        // Decoder task owns its state; have it start over on the next packet
+        atomic_store(&reset_pending, true);
+        xTaskNotifyGive(decoder_task);
+        return ESP_OK;
+    }
+
+    int err = OPUS_OK;
+    decoder = opus_decoder_create(OPUS_IN_SAMPLE_RATE, OPUS_IN_CHANNELS, &err);
+    queue = audio_arena_alloc(AUDIO_ARENA_CODEC, sizeof(opus_in_packet_t) * OPUS_IN_DEPTH, MALLOC_CAP_8BIT);
+    pcm = audio_arena_alloc(AUDIO_ARENA_CODEC, OPUS_IN_MAX_FRAMES * OPUS_IN_CHANNELS * sizeof(int16_t),
+                            MALLOC_CAP_8BIT);
+    if (err != OPUS_OK || !decoder || !queue || !pcm) {
+        ESP_LOGE(TAG, "Failed to create Opus decoder: %s", err != OPUS_OK ? opus_strerror(err) : "no memory");
+        if (decoder) {
+            opus_decoder_destroy(decoder);
+            decoder = NULL;
+        }
+        audio_arena_free(queue);
+        audio_arena_free(pcm);
+        queue = NULL;
+        pcm = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (pipeline_task_create(PIPELINE_STAGE_DECODE, opus_decoder_task, "opus_dec", OPUS_IN_TASK_STACK, NULL,
+                             &decoder_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create Opus decoder task");
+        decoder_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Opus decoder started (%d-packet queue)", OPUS_IN_DEPTH);
+    return ESP_OK;
+}
+
+bool opus_in_push(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, const uint8_t *payload, size_t len) {
+    if (!decoder_task || len == 0 || len > OPUS_IN_MAX_PACKET) {
+        return false;
+    }
+    uint32_t head = atomic_load_explicit(&queue_head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&queue_tail, memory_order_acquire) >= OPUS_IN_DEPTH) {
+        atomic_fetch_add_explicit(&stat_overflow, 1, memory_order_relaxed);
+        return false;
+    }
+    opus_in_packet_t *pkt = &queue[head % OPUS_IN_DEPTH];
+    pkt->ssrc = ssrc;
+    pkt->seq = seq;
+    pkt->rtp_ts = rtp_ts;
+    pkt->len = (uint16_t)len;
+    memcpy(pkt->data, payload, len);
+    atomic_store_explicit(&queue_head, head + 1, memory_order_release);
+    xTaskNotifyGive(decoder_task);
+    return true;
+}
+
+void opus_in_get_stats(opus_in_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->decoded = atomic_load_explicit(&stat_decoded, memory_order_relaxed);
+    stats->concealed = atomic_load_explicit(&stat_concealed, memory_order_relaxed);
+    stats->late = atomic_load_explicit(&stat_late, memory_order_relaxed);
+    stats->overflow = atomic_load_explicit(&stat_overflow, memory_order_relaxed);
+    stats->errors = atomic_load_explicit(&stat_errors, memory_order_relaxed);
+}
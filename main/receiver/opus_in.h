@@ -0,0 +1,51 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Opus ingest for the receiver (CONFIG_RX_OPUS_ENABLED).
+ *
+ * When the opus_pt setting names an Opus payload type (from the SDP rtpmap or
+ * the web settings), udp_handler hands those RTP payloads to opus_in_push()
+ * instead of the linear PCM path. A decoder task on the other core decodes
+ * them to 48 kHz 16-bit stereo and feeds the result to the same chunk
+ * accumulator, jitter buffer and playout scheduler (network_in_enqueue_pcm()).
+ * Lost packets are concealed by the decoder's own PLC before the jitter
+ * buffer would have to.
+ */
+
+// Opus decode counters (since boot)
+typedef struct {
+    uint32_t decoded;     // Packets decoded
+    uint32_t concealed;   // Lost packets synthesized by the decoder's PLC
+    uint32_t late;        // Packets dropped because they arrived behind the decoder
+    uint32_t overflow;    // Packets dropped because the decode queue was full
+    uint32_t errors;      // Packets the decoder rejected
+} opus_in_stats_t;
+
+/**
+ * @brief Start (or restart) the decoder for a receiver mode
+ *
+ * Creates the decoder task on first use; later calls reset its state.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED unless playout is
+ *         48 kHz 16-bit, ESP_ERR_NO_MEM if the decoder could not be created
+ */
+esp_err_t opus_in_start(void);
+
+/**
+ * @brief Queue one Opus RTP payload for decoding (udp_handler only)
+ *
+ * @param ssrc RTP SSRC of the packet
+ * @param seq RTP sequence number
+ * @param rtp_ts RTP timestamp (48 kHz clock)
+ * @param payload Opus packet
+ * @param len Payload length in bytes
+ * @return true if the payload was queued
+ */
+bool opus_in_push(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, const uint8_t *payload, size_t len);
+
+void opus_in_get_stats(opus_in_stats_t *stats);
@@ -0,0 +1,197 @@
+#include "plc.h"
+#include "global.h"
+#include "audio_out.h"
+#include <string.h>
+#include "esp_log.h"
+
+/*
+ * The concealment signal is a periodic extension of the last good chunk:
+ *  - repeat/fade: the whole chunk is the period
+ *  - WSOLA: the period is the lag with the best waveform match between the tail
+ *    of the chunk and earlier audio, so the repeat seam falls on a similar waveform
+ * The extension is faded out over CONFIG_RX_PLC_FADE_CHUNKS consecutive losses, and
+ * every seam (into the loss and back out to real audio) is cross-faded.
+ */
+
+#define PLC_CHANNELS          2
+#define PLC_MAX_FRAMES        (PCM_CHUNK_MAX_SIZE / (sizeof(int16_t) * PLC_CHANNELS))
+#define PLC_XFADE_FRAMES      32   // ~0.7 ms at 48 kHz
+#define PLC_MATCH_FRAMES      64   // Template length for the waveform match
+#define PLC_MIN_PERIOD_FRAMES 32
+
+// History of the last good chunk
+static int16_t history[PLC_MAX_FRAMES * PLC_CHANNELS];
+static uint32_t history_frames = 0;
+
+// Extension state carried across consecutive losses
+static uint32_t period_frames = 0;   // Length of the repeated segment (ends at history end)
+static uint32_t ext_pos = 0;         // Next frame to emit within the period
+static uint32_t burst = 0;           // Consecutive lost chunks so far
+
+static plc_stats_t stats = {0};
+
+void plc_reset(void) {
+    history_frames = 0;
+    period_frames = 0;
+    ext_pos = 0;
+    burst = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void plc_get_stats(plc_stats_t *out) {
+    if (out) {
+        *out = stats;
+    }
+}
+
+// Gain (Q15) at the start of loss number k (0-based) in a burst
+static int32_t fade_gain_q15(uint32_t k) {
+    if (k >= CONFIG_RX_PLC_FADE_CHUNKS) {
+        return 0;
+    }
+    return (int32_t)(((CONFIG_RX_PLC_FADE_CHUNKS - k) * 32768u) / CONFIG_RX_PLC_FADE_CHUNKS);
+}
+
+static inline int16_t sat16(int32_t v) {
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+#ifdef CONFIG_RX_PLC_MODE_WSOLA
+// Lag (in frames) whose segment best matches the last PLC_MATCH_FRAMES of history
+static uint32_t find_period(void) {
+    if (history_frames < PLC_MATCH_FRAMES + PLC_MIN_PERIOD_FRAMES) {
+        return history_frames;
+    }
+    const int16_t *tmpl = &history[(history_frames - PLC_MATCH_FRAMES) * PLC_CHANNELS];
+    uint32_t max_lag = history_frames - PLC_MATCH_FRAMES;
+    uint32_t best_lag = history_frames;
+    float best_score = 0.0f;
+
+    for (uint32_t lag = PLC_MIN_PERIOD_FRAMES; lag <= max_lag; lag++) {
+        const int16_t *cand = tmpl - lag * PLC_CHANNELS;
+        float corr = 0.0f;
+        float energy = 0.0f;
+        for (uint32_t i = 0; i < PLC_MATCH_FRAMES; i++) {
+            // Mono mix is enough to find the period
+            float t = (float)tmpl[i * 2] + (float)tmpl[i * 2 + 1];
+            float c = (float)cand[i * 2] + (float)cand[i * 2 + 1];
+            corr += t * c;
+            energy += c * c;
+        }
+        if (corr <= 0.0f || energy <= 0.0f) {
+            continue;
+        }
+        // Normalized correlation, compared squared to avoid sqrtf
+        float score = (corr * corr) / energy;
+        if (score > best_score) {
+            best_score = score;
+            best_lag = lag;
+        }
+    }
+    return best_lag;
+}
+#endif
+
+// Next frame of the periodic extension, advancing ext_pos
+static inline const int16_t *next_ext_frame(void) {
+    const int16_t *frame = &history[(history_frames - period_frames + ext_pos) * PLC_CHANNELS];
+    if (++ext_pos >= period_frames) {
+        ext_pos = 0;
+    }
+    return frame;
+}
+
+static void conceal(int16_t *out, uint32_t frames) {
+    if (burst == 0) {
+#ifdef CONFIG_RX_PLC_MODE_WSOLA
+        period_frames = find_period();
+#else
+        period_frames = history_frames;
+#endif
+        ext_pos = 0;
+    }
+
+    int32_t g0 = fade_gain_q15(burst);
+    int32_t g1 = fade_gain_q15(burst + 1);
+
+    for (uint32_t i = 0; i < frames; i++) {
+        const int16_t *src = next_ext_frame();
+        int32_t gain = g0 + (int32_t)(((int64_t)(g1 - g0) * i) / frames);
+        for (uint32_t ch = 0; ch < PLC_CHANNELS; ch++) {
+            int32_t s = src[ch];
+            if (burst == 0 && i < PLC_XFADE_FRAMES && i < history_frames) {
+                // Seam into the loss: blend from a mirrored continuation of the last good
+                // frames, which is value-continuous with what was just played
+                int32_t mirror = history[(history_frames - 1 - i) * PLC_CHANNELS + ch];
+                s = (s * (int32_t)i + mirror * (int32_t)(PLC_XFADE_FRAMES - i)) / PLC_XFADE_FRAMES;
+            }
+            out[i * PLC_CHANNELS + ch] = sat16((s * gain) >> 15);
+        }
+    }
+}
+
+// Blend the start of the first good chunk after a loss with the continued extension
+static void recover(int16_t *pcm, uint32_t frames) {
+    int32_t gain = fade_gain_q15(burst);
+    if (gain == 0) {
+        // Extension had faded to silence; just fade the real signal in
+        for (uint32_t i = 0; i < PLC_XFADE_FRAMES && i < frames; i++) {
+            for (uint32_t ch = 0; ch < PLC_CHANNELS; ch++) {
+                int32_t s = pcm[i * PLC_CHANNELS + ch];
+                pcm[i * PLC_CHANNELS + ch] = (int16_t)((s * (int32_t)i) / PLC_XFADE_FRAMES);
+            }
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < PLC_XFADE_FRAMES && i < frames; i++) {
+        const int16_t *ext = next_ext_frame();
+        for (uint32_t ch = 0; ch < PLC_CHANNELS; ch++) {
+            int32_t real = pcm[i * PLC_CHANNELS + ch];
+            int32_t synth = ((int32_t)ext[ch] * gain) >> 15;
+            pcm[i * PLC_CHANNELS + ch] =
+                sat16((real * (int32_t)i + synth * (int32_t)(PLC_XFADE_FRAMES - i)) / PLC_XFADE_FRAMES);
+        }
+    }
+}
+
+void plc_process(uint8_t *pcm, size_t len, bool lost) {
+    uint32_t frame_bytes = sizeof(int16_t) * PLC_CHANNELS;
+    bool supported = audio_out_sample_bits() == 16 && (len % frame_bytes) == 0 &&
+                     (len / frame_bytes) <= PLC_MAX_FRAMES;
+    uint32_t frames = supported ? (uint32_t)(len / frame_bytes) : 0;
+
+#ifdef CONFIG_RX_PLC_MODE_SILENCE
+    supported = false;
+#endif
+
+    if (lost) {
+        if (supported && history_frames > 0 && fade_gain_q15(burst) > 0) {
+            conceal((int16_t *)pcm, frames);
+            stats.concealed++;
+        } else {
+            // Buffer already zeroed the chunk
+            stats.silenced++;
+        }
+        burst++;
+        if (burst > stats.max_burst) {
+            stats.max_burst = burst;
+        }
+        return;
+    }
+
+    if (!supported) {
+        history_frames = 0;
+        burst = 0;
+        return;
+    }
+
+    if (burst > 0 && history_frames > 0) {
+        recover((int16_t *)pcm, frames);
+    }
+    burst = 0;
+
+    memcpy(history, pcm, frames * frame_bytes);
+    history_frames = frames;
+}
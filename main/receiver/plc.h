@@ -0,0 +1,45 @@
+#ifndef PLC_H
+#define PLC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "build_config.h"
+
+/**
+ * Packet loss concealment for the receiver playout path.
+ *
+ * pcm_handler feeds every played chunk through plc_process(). Good chunks are
+ * remembered (and cross-faded in after a loss); chunks the jitter buffer marked
+ * PACKET_FLAG_CONCEALED are synthesized from that history according to
+ * CONFIG_RX_PLC_MODE_*. Only 16-bit interleaved stereo is concealed; other
+ * formats are left as the silence the buffer filled in.
+ */
+
+// PLC counters (all since plc_reset)
+typedef struct {
+    uint32_t concealed;      // Chunks synthesized
+    uint32_t silenced;       // Chunks left silent (no history, fade exhausted or unsupported format)
+    uint32_t max_burst;      // Longest run of consecutive lost chunks
+} plc_stats_t;
+
+/**
+ * @brief Forget history (call on stream start / flush)
+ */
+void plc_reset(void);
+
+/**
+ * @brief Run one playout chunk through the PLC stage (consumer task only)
+ *
+ * @param pcm Chunk of host-order interleaved PCM, modified in place
+ * @param len Chunk length in bytes
+ * @param lost true if the chunk never arrived and must be synthesized
+ */
+void plc_process(uint8_t *pcm, size_t len, bool lost);
+
+/**
+ * @brief Snapshot PLC counters (safe from any task)
+ */
+void plc_get_stats(plc_stats_t *stats);
+
+#endif // PLC_H
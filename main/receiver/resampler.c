@@ -0,0 +1,164 @@
+#include "resampler.h"
+#include "buffer.h"
+#include "audio_out.h"
+#include "global.h"
+#include "build_config.h"
+#ifdef CONFIG_RTCP_ENABLED
+#include "rtcp_receiver.h"
+#endif
+#include <string.h>
+
+/*
+ * Catmull-Rom interpolation on a Q32 phase accumulator. The input is treated as
+ * one continuous stream: the last RESAMPLER_HISTORY frames of each chunk are kept
+ * so the next chunk interpolates across the seam, and `pos` is the integer frame
+ * (into history ++ chunk) left of the next output point. At 0 ppm with zero phase
+ * the output is the input delayed by two frames, bit for bit.
+ */
+
+#define RESAMPLER_HISTORY   3
+#define RESAMPLER_CHANNELS  2
+#define PPB_ONE             1000000000LL
+
+// Chunks between RTCP PLL queries (each takes the RTCP mutex)
+#define RESAMPLER_PLL_POLL_CHUNKS 32
+// Fill average and applied rate follow their inputs with these time constants (2^n chunks)
+#define RESAMPLER_FILL_SHIFT      4
+#define RESAMPLER_SLEW_SHIFT      6
+
+static int16_t history[RESAMPLER_HISTORY][RESAMPLER_CHANNELS];
+static uint32_t pos = 1;            // Integer frame position (0 = oldest history frame)
+static uint32_t frac = 0;           // Fractional position, Q32
+static uint64_t step = 1ULL << 32;  // Input frames per output frame, Q32
+
+static int32_t ratio_ppb = 0;
+static int32_t pll_ppb = 0;
+static int32_t fill_q8 = -1;        // Averaged buffer fill in chunks, Q8 (-1: unseeded)
+static uint32_t poll_countdown = 0;
+static uint32_t frames_in = 0;
+static uint32_t frames_out = 0;
+
+bool resampler_available(void) {
+    return audio_out_sample_bits() == 16;
+}
+
+void resampler_reset(void) {
+    memset(history, 0, sizeof(history));
+    pos = 1;
+    frac = 0;
+    step = 1ULL << 32;
+    ratio_ppb = 0;
+    fill_q8 = -1;
+    poll_countdown = 0;
+    frames_in = 0;
+    frames_out = 0;
+    // pll_ppb is kept: the sender's drift doesn't change across a rebuffer
+}
+
+void resampler_update(void) {
+#ifdef CONFIG_RTCP_ENABLED
+    if (poll_countdown == 0) {
+        poll_countdown = RESAMPLER_PLL_POLL_CHUNKS;
+        uint32_t ssrc = 0;
+        float ppm = 0.0f;
+        if (rtcp_get_primary_ssrc(&ssrc) && rtcp_get_pll_slope_ppm(ssrc, &ppm)) {
+            pll_ppb = (int32_t)(ppm * 1000.0f);
+        }
+    }
+    poll_countdown--;
+#endif
+
+    // Buffer depth error: a surplus lowers the rate so chunks are consumed faster
+    int32_t fill = (int32_t)buffer_get_fill_level() << 8;
+    if (fill_q8 < 0) {
+        fill_q8 = fill;
+    } else {
+        fill_q8 += (fill - fill_q8) >> RESAMPLER_FILL_SHIFT;
+    }
+    int32_t error_q8 = fill_q8 - ((int32_t)buffer_get_target_size() << 8);
+
+    const int64_t limit = (int64_t)CONFIG_RX_RESAMPLER_MAX_PPM * 1000;
+    int64_t target = (int64_t)pll_ppb -
+                     (((int64_t)CONFIG_RX_RESAMPLER_FILL_GAIN_PPM * 1000 * error_q8) >> 8);
+    if (target > limit) target = limit;
+    if (target < -limit) target = -limit;
+
+    ratio_ppb += (int32_t)((target - ratio_ppb) / (1 << RESAMPLER_SLEW_SHIFT));
+
+    // Output runs (1 + ratio) times the input rate
+    step = ((1ULL << 32) * (uint64_t)PPB_ONE) / (uint64_t)(PPB_ONE + ratio_ppb);
+}
+
+// Frame `i` of history ++ chunk
+static inline const int16_t *frame_at(const int16_t *in, uint32_t i) {
+    return (i < RESAMPLER_HISTORY) ? history[i] : in + (size_t)(i - RESAMPLER_HISTORY) * RESAMPLER_CHANNELS;
+}
+
+static inline int16_t catmull_rom(int32_t xm1, int32_t x0, int32_t x1, int32_t x2, int32_t t) {
+    // t in Q15; y = x0 + t/2 * (c + t * (b + t * a))
+    int64_t a = 3 * (x0 - x1) + x2 - xm1;
+    int64_t b = 2 * xm1 - 5 * x0 + 4 * x1 - x2;
+    int64_t c = x1 - xm1;
+    int64_t v = b + ((a * t) >> 15);
+    v = c + ((v * t) >> 15);
+    int32_t y = x0 + (int32_t)((v * t) >> 16);
+    if (y > INT16_MAX) y = INT16_MAX;
+    if (y < INT16_MIN) y = INT16_MIN;
+    return (int16_t)y;
+}
+
+size_t resampler_process(const uint8_t *in_bytes, size_t in_len, uint8_t *out_bytes, size_t out_cap) {
+    const int16_t *in = (const int16_t *)in_bytes;
+    int16_t *out = (int16_t *)out_bytes;
+    const uint32_t frame_bytes = RESAMPLER_CHANNELS * sizeof(int16_t);
+    const uint32_t in_frames = (uint32_t)(in_len / frame_bytes);
+    const uint32_t out_max = (uint32_t)(out_cap / frame_bytes);
+    if (in_frames < RESAMPLER_HISTORY) {
+        // Too short to carry history across; pass through
+        size_t n = in_frames * frame_bytes;
+        memcpy(out_bytes, in_bytes, n < out_cap ? n : out_cap);
+        return n < out_cap ? n : out_cap;
+    }
+
+    uint32_t n_out = 0;
+    uint64_t p = ((uint64_t)pos << 32) | frac;
+    // Interpolating between frames i and i + 1 needs i - 1 .. i + 2
+    while ((uint32_t)(p >> 32) + 2u < in_frames + RESAMPLER_HISTORY && n_out < out_max) {
+        uint32_t i = (uint32_t)(p >> 32);
+        int32_t t = (int32_t)((uint32_t)p >> 17);
+        const int16_t *fm1 = frame_at(in, i - 1);
+        const int16_t *f0 = frame_at(in, i);
+        const int16_t *f1 = frame_at(in, i + 1);
+        const int16_t *f2 = frame_at(in, i + 2);
+        for (int ch = 0; ch < RESAMPLER_CHANNELS; ch++) {
+            out[n_out * RESAMPLER_CHANNELS + ch] = catmull_rom(fm1[ch], f0[ch], f1[ch], f2[ch], t);
+        }
+        n_out++;
+        p += step;
+    }
+
+    // Rebase onto the next chunk: its history is this chunk's last frames
+    memcpy(history, in + (size_t)(in_frames - RESAMPLER_HISTORY) * RESAMPLER_CHANNELS, sizeof(history));
+    if ((uint32_t)(p >> 32) >= in_frames + 1u) {
+        pos = (uint32_t)(p >> 32) - in_frames;
+        frac = (uint32_t)p;
+    } else {
+        // Output buffer filled up early; restart the phase rather than replay input
+        pos = 1;
+        frac = 0;
+    }
+
+    frames_in += in_frames;
+    frames_out += n_out;
+    return (size_t)n_out * frame_bytes;
+}
+
+void resampler_get_stats(resampler_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->ratio_ppb = ratio_ppb;
+    stats->pll_ppb = pll_ppb;
+    stats->frames_in = frames_in;
+    stats->frames_out = frames_out;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Drift-compensating resampler for the playout path (CONFIG_RX_RESAMPLER_ENABLED).
+ *
+ * The sender's sample clock and the local output clock never agree exactly, so
+ * the jitter buffer slowly fills or empties. Instead of trimming frames off due
+ * chunks (buffer.c drain) the PCM handler runs every chunk through a fixed-point
+ * cubic interpolator whose rate is nudged by a few hundred ppm at most: fed
+ * forward from the RTCP PLL's slope estimate and pulled back toward the target
+ * buffer depth. Output chunks come out a frame longer or shorter as needed.
+ * Consumer (pcm_handler) only; 16-bit interleaved stereo playout only.
+ */
+
+// Output headroom beyond the input length; covers the rate range plus carried phase
+#define RESAMPLER_OUT_SLACK_BYTES 16
+
+// Resampler state snapshot
+typedef struct {
+    int32_t ratio_ppb;       // Current output/input rate offset (parts per billion)
+    int32_t pll_ppb;         // Last RTCP PLL drift estimate (0 until the PLL has updated)
+    uint32_t frames_in;      // Frames consumed since resampler_reset
+    uint32_t frames_out;     // Frames produced since resampler_reset
+} resampler_stats_t;
+
+/**
+ * @brief Whether the playout format can be resampled (16-bit stereo)
+ */
+bool resampler_available(void);
+
+/**
+ * @brief Drop history and return to the nominal rate (stream start / underrun)
+ */
+void resampler_reset(void);
+
+/**
+ * @brief Retune the rate for the chunk about to be played (consumer only)
+ *
+ * Reads the jitter buffer depth every call and the RTCP PLL estimate at a
+ * lower rate; the applied rate follows the combined target slowly so the
+ * pitch never moves audibly.
+ */
+void resampler_update(void);
+
+/**
+ * @brief Resample one chunk (consumer only)
+ *
+ * @param in Host-order 16-bit interleaved stereo
+ * @param in_len Input length in bytes (whole frames)
+ * @param out Output buffer, at least in_len + RESAMPLER_OUT_SLACK_BYTES
+ * @param out_cap Size of out in bytes
+ * @return Output length in bytes (whole frames)
+ */
+size_t resampler_process(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_cap);
+
+void resampler_get_stats(resampler_stats_t *stats);
@@ -1,13 +1,24 @@
 #include "rtcp_receiver.h"
 #include "sdkconfig.h"
 #include "esp_log.h"
+#include "log_rate.h"
+#include "metrics.h"
+#include "metrics_bench.h"
+#include "audio_arena.h"
 #include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+#include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <arpa/inet.h>
-#include <math.h>   // for isfinite() check on slope
-#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "clock/clock_service.h"
+#include "logging/event_trace.h"
+#ifdef CONFIG_RTCP_BENCHMARK
+#include "esp_cpu.h"
+#endif
 
 // SR freshness threshold (ms). Use Kconfig if defined; default to 15000 ms.
 #ifndef CONFIG_RTCP_SR_MAX_AGE_MS
@@ -43,6 +54,9 @@
 #ifndef CONFIG_RTCP_SR_OFFSET_STEP_MS
 #define CONFIG_RTCP_SR_OFFSET_STEP_MS 100      // SR-derived offset step detection threshold
 #endif
+#ifndef CONFIG_RTCP_SHARED_CLOCK_MAX_OFFSET_MS
+#define CONFIG_RTCP_SHARED_CLOCK_MAX_OFFSET_MS 20  // SR this close to our master clock: sender shares it
+#endif
 #ifndef CONFIG_RTCP_SR_RESEED_HOLDOFF_MS
 #define CONFIG_RTCP_SR_RESEED_HOLDOFF_MS 200   // Min time between reseeds to avoid thrash
 #endif
@@ -79,9 +93,27 @@
 
 static const char *TAG = "rtcp_receiver";
 
+// Fixed-point mapping and PLL math. The S3 FPU is single precision only, so slope, gains
+// and accumulators are integers: slopes in Q32.32 microseconds per RTP tick, gains in Q32.32
+// (Ka, being ~1e-9, in Q16.48). The gain conversions fold at compile time.
+#define RTCP_Q32_ONE     (1LL << 32)
+// Nominal us per tick at `rate`, rounded up so whole-microsecond tick counts map exactly
+#define RTCP_A0_Q32_AT(rate) ((int64_t)(((1000000ULL << 32) + (rate) - 1) / (rate)))
+#define RTCP_PLL_KB_Q32  ((int64_t)((CONFIG_RTCP_PLL_KB) * 4294967296.0))
+#define RTCP_PLL_KI_Q32  ((int64_t)((CONFIG_RTCP_PLL_KI) * 4294967296.0))
+#define RTCP_PLL_KA_Q48  ((int64_t)((CONFIG_RTCP_PLL_KA) * 281474976710656.0))
+
+// RTCP XR (RFC 3611) block sizes and constants
+#define RTCP_XR_RRTR_SIZE     12
+#define RTCP_XR_SUMMARY_SIZE  40
+#define RTCP_XR_VOIP_SIZE     36
+#define RTCP_XR_GMIN          16      // Burst/gap threshold (packets)
+#define RTCP_XR_UNAVAILABLE   127     // "Not available" for VoIP Metrics level/quality fields
+#define RTCP_XR_JITTER_CAP    0xFFFFFu  // |D| cap for the summary's sum of squares
+
 // RTP unwrap/internal constants (local to this file)
 #define RTP_WRAP_THRESHOLD (0x80000000u / 2)    // half-range to disambiguate wrap
-#define RTP_REORDER_TOL_TICKS (CONFIG_SAMPLE_RATE / 10) // ~100ms worth of RTP ticks at 48kHz
+#define RTP_REORDER_TOL_TICKS (rtcp_clock_rate / 10) // ~100ms worth of RTP ticks
 
 // Optional detailed logging for unwrapping
 #ifdef CONFIG_RTCP_LOG_UNWRAP
@@ -101,21 +133,253 @@ static const char *TAG = "rtcp_receiver";
 #ifndef RX_JITTER_WARN_TICKS
 // Approximate threshold: 3x a nominal packet duration (~6ms at 48kHz => 18ms)
 // This keeps logging conservative without depending on PCM_CHUNK_SIZE here.
-#define RX_JITTER_WARN_TICKS ((uint32_t)((CONFIG_SAMPLE_RATE * 18) / 1000))
+#define RX_JITTER_WARN_TICKS ((uint32_t)((rtcp_clock_rate * 18) / 1000))
 #endif
 
+// Per-packet |D(i-1,i)| in microseconds, exported at /metrics
+static const uint32_t interarrival_bounds[] = { 100, 250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000 };
+static metrics_histogram_t interarrival_hist =
+    METRICS_HISTOGRAM_INIT("rtp_rx_transit_delta_us", "Interarrival transit difference |D| (RFC 3550)", interarrival_bounds);
+
 // RTCP receiver state
 static rtcp_state_t rtcp_state;
 static SemaphoreHandle_t rtcp_mutex = NULL;
+// Playout delay added to the sender timeline; kept across rtcp_init()
+static atomic_uint_fast32_t rtcp_target_latency_ms = CONFIG_RTCP_TARGET_LATENCY_MS;
+// RTP clock of the stream and its nominal slope; kept across rtcp_init(), written under
+// rtcp_mutex (rtcp_set_clock_rate) and published with each mapping
+static uint32_t rtcp_clock_rate = CONFIG_SAMPLE_RATE;
+static int64_t  rtcp_a0_q32 = RTCP_A0_Q32_AT(CONFIG_SAMPLE_RATE);
+
+/*
+ * RTP->playout mapping published per sync_info slot through a seqlock, so the data
+ * path (rtcp_calculate_playout_time, rtcp_is_sync_fresh) never waits on rtcp_mutex.
+ * Writers already hold rtcp_mutex and bump `seq` to odd, copy, then to even; readers
+ * retry on an odd or changed sequence and only after RTCP_MAP_READ_RETRIES fall back
+ * to the mutex, which covers a writer preempted mid-copy on the reader's core.
+ */
+typedef struct {
+    uint32_t ssrc;
+    bool     valid;
+    uint32_t last_sr_rtp32;
+    uint64_t rtp_sr_base64;
+    uint64_t mono_sr_base_us;
+    uint64_t ntp_sr_base_us;
+    int64_t  sender_to_master_us;
+    int64_t  slope_a_q32;
+    int64_t  offset_b_mono_us;
+    int64_t  a0_q32;             // Nominal slope the SR anchor is counted at
+} rtcp_map_t;
+
+typedef struct {
+    atomic_uint seq;     // Odd while a write is in progress
+    rtcp_map_t  map;
+} rtcp_map_slot_t;
+
+#define RTCP_MAP_READ_RETRIES 4
+
+/*
+ * Per-source state and its published mappings, one arena block taken at boot and
+ * kept: lock-free readers may still hold a slot after rtcp_deinit().
+ * Sources are found through an open-addressing index at least twice the table size:
+ * linear probing from a multiplicative hash of the SSRC, 0 for an empty
+ * bucket, else the entry + 1. Removal shifts later entries of the probe run
+ * back, so the index never fills with tombstones. In front of it sits the
+ * entry last found; one stream is nearly every lookup.
+ */
+typedef struct {
+    rtcp_sync_info_t info[RTCP_MAX_SSRC_SOURCES];
+    rtcp_map_slot_t  maps[RTCP_MAX_SSRC_SOURCES];
+} rtcp_tables_t;
+
+#if RTCP_MAX_SSRC_SOURCES <= 4
+#define RTCP_SSRC_HASH_BITS 3
+#elif RTCP_MAX_SSRC_SOURCES <= 8
+#define RTCP_SSRC_HASH_BITS 4
+#elif RTCP_MAX_SSRC_SOURCES <= 16
+#define RTCP_SSRC_HASH_BITS 5
+#elif RTCP_MAX_SSRC_SOURCES <= 32
+#define RTCP_SSRC_HASH_BITS 6
+#else
+#define RTCP_SSRC_HASH_BITS 7
+#endif
+#define RTCP_SSRC_HASH_SIZE (1U << RTCP_SSRC_HASH_BITS)
+#define RTCP_SSRC_HASH_MASK (RTCP_SSRC_HASH_SIZE - 1U)
+_Static_assert(RTCP_MAX_SSRC_SOURCES >= 1 && RTCP_MAX_SSRC_SOURCES <= 64, "index entries are uint8_t");
+
+static rtcp_tables_t *rtcp_tables = NULL;
+static rtcp_map_slot_t *rtcp_maps = NULL;
+static uint8_t rtcp_ssrc_index[RTCP_SSRC_HASH_SIZE];
+static int rtcp_ssrc_last = -1;            // Entry of the last lookup, under rtcp_mutex
+static atomic_int rtcp_map_last = 0;       // Same for the lock-free map readers
 
 // Forward declaration: low-rate RTCP structured summary
 static void rtcp_log_summary_if_due(void);
+static void rtcp_xr_parse_dlrr(const uint8_t *p, size_t len);
+#ifdef CONFIG_RTCP_BENCHMARK
+static void rtcp_benchmark_playout(void);
+static void rtcp_benchmark_pll(void);
+#endif
+
+// RTP ticks -> microseconds at slope a (Q32.32), truncated toward zero. Two 32x32 multiplies
+// instead of a 96-bit product: the slope's integer part times ticks is exact.
+static inline int64_t rtcp_ticks_to_us(int32_t ticks, int64_t a_q32) {
+    uint32_t mag = (ticks < 0) ? (uint32_t)(-(int64_t)ticks) : (uint32_t)ticks;
+    uint64_t us = (uint64_t)mag * (uint64_t)(a_q32 >> 32) +
+                  (((uint64_t)mag * (uint32_t)a_q32) >> 32);
+    return (ticks < 0) ? -(int64_t)us : (int64_t)us;
+}
+
+// Slope deviation from nominal in parts per billion
+static inline int32_t rtcp_slope_ppb(int64_t a_q32) {
+    return (int32_t)(((a_q32 - rtcp_a0_q32) * 1000000000LL) / rtcp_a0_q32);
+}
+
+// Publish slot i's mapping to lock-free readers. Must be called under rtcp_mutex.
+static void rtcp_publish_map_locked(int i) {
+    const rtcp_sync_info_t *s = &rtcp_state.sync_info[i];
+    rtcp_map_slot_t *slot = &rtcp_maps[i];
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1U, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->map.ssrc                      = s->ssrc;
+    slot->map.valid                     = s->valid;
+    slot->map.last_sr_rtp32             = s->last_sr_rtp32;
+    slot->map.rtp_sr_base64             = s->rtp_sr_base64;
+    slot->map.mono_sr_base_us           = s->mono_sr_base_us;
+    slot->map.ntp_sr_base_us            = s->ntp_sr_base_us;
+    slot->map.sender_to_master_us       = s->sender_to_master_us;
+    slot->map.slope_a_q32               = s->slope_a_q32;
+    slot->map.offset_b_mono_us          = s->offset_b_mono_us;
+    slot->map.a0_q32                    = rtcp_a0_q32;
+    atomic_store_explicit(&slot->seq, seq + 2U, memory_order_release);
+}
+
+// Publish every slot (after allocation/eviction may have touched any of them)
+static void rtcp_publish_maps_locked(void) {
+    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
+        rtcp_publish_map_locked(i);
+    }
+}
+
+// Consistent copy of slot i's mapping without taking rtcp_mutex (normally)
+static void rtcp_read_map_slot(int i, rtcp_map_t *out) {
+    rtcp_map_slot_t *slot = &rtcp_maps[i];
+    bool consistent = false;
+    for (int attempt = 0; attempt < RTCP_MAP_READ_RETRIES && !consistent; attempt++) {
+        unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq & 1U) {
+            continue;
+        }
+        *out = slot->map;
+        atomic_thread_fence(memory_order_acquire);
+        consistent = (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq);
+    }
+    if (!consistent) {
+        xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+        *out = slot->map;
+        xSemaphoreGive(rtcp_mutex);
+    }
+}
+
+// Mapping for `ssrc`: the slot that last matched, else a scan (the index moves under
+// rtcp_mutex, so lock-free readers do not probe it)
+static bool rtcp_read_map(uint32_t ssrc, rtcp_map_t *out) {
+    int hint = atomic_load_explicit(&rtcp_map_last, memory_order_relaxed);
+    rtcp_read_map_slot(hint, out);
+    if (out->valid && out->ssrc == ssrc) {
+        return true;
+    }
+    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
+        if (i == hint) {
+            continue;
+        }
+        rtcp_read_map_slot(i, out);
+        if (out->valid && out->ssrc == ssrc) {
+            atomic_store_explicit(&rtcp_map_last, i, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint32_t rtcp_ssrc_home(uint32_t ssrc) {
+    return (ssrc * 0x9E3779B1u) >> (32 - RTCP_SSRC_HASH_BITS);
+}
+
+// Entry tracking `ssrc`, or -1. Must be called under rtcp_mutex.
+static int rtcp_find_locked(uint32_t ssrc) {
+    int last = rtcp_ssrc_last;
+    if (last >= 0 && rtcp_state.sync_info[last].valid && rtcp_state.sync_info[last].ssrc == ssrc) {
+        return last;
+    }
+    for (uint32_t b = rtcp_ssrc_home(ssrc), n = 0; n < RTCP_SSRC_HASH_SIZE; b = (b + 1U) & RTCP_SSRC_HASH_MASK, n++) {
+        uint8_t e = rtcp_ssrc_index[b];
+        if (e == 0) {
+            break;
+        }
+        if (rtcp_state.sync_info[e - 1].valid && rtcp_state.sync_info[e - 1].ssrc == ssrc) {
+            rtcp_ssrc_last = e - 1;
+            return e - 1;
+        }
+    }
+    return -1;
+}
+
+static rtcp_sync_info_t *rtcp_find_sync_locked(uint32_t ssrc) {
+    int i = rtcp_find_locked(ssrc);
+    return (i >= 0) ? &rtcp_state.sync_info[i] : NULL;
+}
+
+// Index entry i under its SSRC; the table holds at most half the buckets, so there is room
+static void rtcp_index_insert_locked(int i) {
+    uint32_t b = rtcp_ssrc_home(rtcp_state.sync_info[i].ssrc);
+    while (rtcp_ssrc_index[b] != 0) {
+        b = (b + 1U) & RTCP_SSRC_HASH_MASK;
+    }
+    rtcp_ssrc_index[b] = (uint8_t)(i + 1);
+}
+
+// Drop entry i from the index, moving back whatever probed past its bucket
+static void rtcp_index_remove_locked(int i) {
+    uint32_t hole = rtcp_ssrc_home(rtcp_state.sync_info[i].ssrc);
+    while (rtcp_ssrc_index[hole] != (uint8_t)(i + 1)) {
+        if (rtcp_ssrc_index[hole] == 0) {
+            return;
+        }
+        hole = (hole + 1U) & RTCP_SSRC_HASH_MASK;
+    }
+    for (uint32_t b = (hole + 1U) & RTCP_SSRC_HASH_MASK; rtcp_ssrc_index[b] != 0; b = (b + 1U) & RTCP_SSRC_HASH_MASK) {
+        uint32_t home = rtcp_ssrc_home(rtcp_state.sync_info[rtcp_ssrc_index[b] - 1].ssrc);
+        // Movable unless its home lies cyclically in (hole, b]
+        bool stays = (hole <= b) ? (home > hole && home <= b) : (home > hole || home <= b);
+        if (!stays) {
+            rtcp_ssrc_index[hole] = rtcp_ssrc_index[b];
+            hole = b;
+        }
+    }
+    rtcp_ssrc_index[hole] = 0;
+}
+
+// Stop tracking entry i. Must be called under rtcp_mutex.
+static void rtcp_release_locked(int i) {
+    rtcp_index_remove_locked(i);
+    rtcp_state.sync_info[i].valid = false;
+    rtcp_publish_map_locked(i);
+    if (rtcp_state.active_sources > 0) {
+        rtcp_state.active_sources--;
+    }
+}
 
-// Helper: Get current system time as Unix microseconds (µs since 1970-01-01 00:00:00 UTC)
-static inline uint64_t get_system_time_us(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return ((uint64_t)tv.tv_sec * 1000000ULL) + (uint64_t)tv.tv_usec;
+// Forget every source: state, index and the published mappings. Must be called under
+// rtcp_mutex, with the tables allocated.
+static void rtcp_reset_tables_locked(void) {
+    memset(&rtcp_state, 0, sizeof(rtcp_state));
+    memset(rtcp_tables->info, 0, sizeof(rtcp_tables->info));
+    memset(rtcp_ssrc_index, 0, sizeof(rtcp_ssrc_index));
+    rtcp_state.sync_info = rtcp_tables->info;
+    rtcp_ssrc_last = -1;
+    rtcp_publish_maps_locked();
 }
 
 // Evict stale/non-pinned entries and optionally force-evict least-recently-active when full.
@@ -134,10 +398,7 @@ static void rtcp_evict_stale_locked(uint64_t now_mono_us) {
                 uint64_t age_ms = (age_us == UINT64_MAX) ? 0ULL : (age_us / 1000ULL);
                 ESP_LOGW(TAG, "Evict stale SSRC 0x%08X age=%llu ms", s->ssrc, (unsigned long long)age_ms);
 #endif
-                s->valid = false;
-                if (rtcp_state.active_sources > 0) {
-                    rtcp_state.active_sources--;
-                }
+                rtcp_release_locked(i);
             }
         }
     }
@@ -165,18 +426,86 @@ static void rtcp_evict_stale_locked(uint64_t now_mono_us) {
             ESP_LOGW(TAG, "Forced eviction (full): SSRC 0x%08X age=%llu ms",
                      rtcp_state.sync_info[victim].ssrc, (unsigned long long)age_ms);
 #endif
-            rtcp_state.sync_info[victim].valid = false;
-            if (rtcp_state.active_sources > 0) {
-                rtcp_state.active_sources--;
-            }
+            rtcp_release_locked(victim);
         }
 #endif
     }
 }
 
 // Initialize RTCP receiver
+void rtcp_set_target_latency_ms(uint32_t ms) {
+    atomic_store(&rtcp_target_latency_ms, ms ? ms : (uint32_t)CONFIG_RTCP_TARGET_LATENCY_MS);
+}
+
+void rtcp_set_clock_rate(uint32_t rate) {
+    if (rate == 0) {
+        return;
+    }
+    if (rtcp_mutex == NULL) {
+        // No mappings yet; the next rtcp_init() starts at this rate
+        rtcp_clock_rate = rate;
+        rtcp_a0_q32 = RTCP_A0_Q32_AT(rate);
+        return;
+    }
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    uint32_t old_rate = rtcp_clock_rate;
+    if (rate == old_rate) {
+        xSemaphoreGive(rtcp_mutex);
+        return;
+    }
+    int64_t old_a0 = rtcp_a0_q32;
+    rtcp_clock_rate = rate;
+    rtcp_a0_q32 = RTCP_A0_Q32_AT(rate);
+
+    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
+        rtcp_sync_info_t *s = &rtcp_state.sync_info[i];
+        if (!s->valid) {
+            continue;
+        }
+        // Move the SR anchor up to the newest packet, the last one counted at the old
+        // rate, so ticks past it map at the new rate until the next SR re-anchors
+        int32_t since_sr = (int32_t)(s->last_rtp32 - s->last_sr_rtp32);
+        if (s->mono_sr_base_us != 0 && s->seq_initialized && since_sr > 0) {
+            s->ntp_sr_base_us += (uint64_t)rtcp_ticks_to_us(since_sr, old_a0);
+            s->rtp_sr_base64 += (uint64_t)since_sr;
+            s->last_sr_rtp32 = s->last_rtp32;
+        }
+        // Same sender drift in the new tick length: the PLL keeps its estimate
+        if (s->slope_a_q32 > 0) {
+            s->slope_a_q32 = s->slope_a_q32 * (int64_t)old_rate / (int64_t)rate;
+            s->pll_slope_ppb = rtcp_slope_ppb(s->slope_a_q32);
+        }
+        // Jitter is kept in ticks; arrival ticks restart at the new rate
+        s->jitter_q4 = (uint32_t)(((uint64_t)s->jitter_q4 * rate) / old_rate);
+        s->transit_stale = true;
+    }
+    rtcp_publish_maps_locked();
+    xSemaphoreGive(rtcp_mutex);
+    ESP_LOGI(TAG, "RTP clock %u -> %u Hz: mappings rescaled", (unsigned)old_rate, (unsigned)rate);
+}
+
+esp_err_t rtcp_alloc_tables(void) {
+    if (rtcp_tables != NULL) {
+        return ESP_OK;
+    }
+    // Touched on every packet, so internal RAM even when it falls back to the heap
+    rtcp_tables = audio_arena_calloc(AUDIO_ARENA_SYNC, sizeof(rtcp_tables_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (rtcp_tables == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate the table for %d sources", RTCP_MAX_SSRC_SOURCES);
+        return ESP_ERR_NO_MEM;
+    }
+    rtcp_maps = rtcp_tables->maps;
+    return ESP_OK;
+}
+
 esp_err_t rtcp_init(void) {
     ESP_LOGI(TAG, "Initializing RTCP receiver");
+    metrics_register(&interarrival_hist.base);
+
+    if (rtcp_alloc_tables() != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
     
     // Create mutex for thread-safe access
     if (rtcp_mutex == NULL) {
@@ -189,69 +518,67 @@ esp_err_t rtcp_init(void) {
     
     // Initialize state
     xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-    memset(&rtcp_state, 0, sizeof(rtcp_state));
+    rtcp_reset_tables_locked();
+    do {
+        rtcp_state.local_ssrc = esp_random();
+    } while (rtcp_state.local_ssrc == 0);
     rtcp_state.initialized = true;
     xSemaphoreGive(rtcp_mutex);
     
-    ESP_LOGI(TAG, "RTCP receiver initialized (max %d sources)", RTCP_MAX_SSRC_SOURCES);
+    ESP_LOGI(TAG, "RTCP receiver initialized (max %d sources, %u byte table)", RTCP_MAX_SSRC_SOURCES,
+             (unsigned)sizeof(rtcp_tables_t));
+#ifdef CONFIG_RTCP_BENCHMARK
+    rtcp_benchmark_playout();
+    rtcp_benchmark_pll();
+#endif
     return ESP_OK;
 }
 
-// Find or allocate sync info for an SSRC
-static rtcp_sync_info_t* find_or_allocate_sync_info(uint32_t ssrc) {
-    // First, look for existing entry
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            return &rtcp_state.sync_info[i];
-        }
+// Take a free entry for `ssrc`, or -1 if none is free
+static int rtcp_allocate_locked(uint32_t ssrc) {
+    if (rtcp_state.active_sources >= RTCP_MAX_SSRC_SOURCES) {
+        return -1;
     }
-
-    // Try to allocate a free slot
     for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
         if (!rtcp_state.sync_info[i].valid) {
             memset(&rtcp_state.sync_info[i], 0, sizeof(rtcp_sync_info_t));
             rtcp_state.sync_info[i].ssrc = ssrc;
             rtcp_state.sync_info[i].valid = true;
             rtcp_state.active_sources++;
+            rtcp_index_insert_locked(i);
+            rtcp_ssrc_last = i;
 
             // Initialize PLL accumulators for this SSRC
-            rtcp_state.sync_info[i].pll_offset_b_us        = (double)rtcp_state.sync_info[i].offset_b_mono_us;
-            rtcp_state.sync_info[i].pll_slope_a_correction = 0.0;
-            rtcp_state.sync_info[i].pll_i_err              = 0.0;
+            rtcp_state.sync_info[i].pll_offset_b_us        = rtcp_state.sync_info[i].offset_b_mono_us;
+            rtcp_state.sync_info[i].pll_slope_ppb          = 0;
+            rtcp_state.sync_info[i].pll_i_err              = 0;
             rtcp_state.sync_info[i].pll_obs_count          = 0;
             rtcp_state.sync_info[i].pll_last_apply_mono    = 0;
-
-#ifdef CONFIG_RTCP_LOG_SSRC
-            ESP_LOGI(TAG, "Allocated sync slot %d for SSRC 0x%08X", i, ssrc);
-#endif
-            return &rtcp_state.sync_info[i];
+            rtcp_publish_map_locked(i);
+            return i;
         }
     }
+    return -1;
+}
 
-    // No free slots: attempt stale eviction (and optional forced eviction if enabled)
-    uint64_t now = esp_timer_get_time();
-    rtcp_evict_stale_locked(now);
-
-    // Retry allocation after eviction
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (!rtcp_state.sync_info[i].valid) {
-            memset(&rtcp_state.sync_info[i], 0, sizeof(rtcp_sync_info_t));
-            rtcp_state.sync_info[i].ssrc = ssrc;
-            rtcp_state.sync_info[i].valid = true;
-            rtcp_state.active_sources++;
-
-            // Initialize PLL accumulators for this SSRC
-            rtcp_state.sync_info[i].pll_offset_b_us        = (double)rtcp_state.sync_info[i].offset_b_mono_us;
-            rtcp_state.sync_info[i].pll_slope_a_correction = 0.0;
-            rtcp_state.sync_info[i].pll_i_err              = 0.0;
-            rtcp_state.sync_info[i].pll_obs_count          = 0;
-            rtcp_state.sync_info[i].pll_last_apply_mono    = 0;
+// Find or allocate sync info for an SSRC
+static rtcp_sync_info_t* find_or_allocate_sync_info(uint32_t ssrc) {
+    int i = rtcp_find_locked(ssrc);
+    if (i >= 0) {
+        return &rtcp_state.sync_info[i];
+    }
 
+    i = rtcp_allocate_locked(ssrc);
+    if (i < 0) {
+        // No free slots: attempt stale eviction (and optional forced eviction if enabled)
+        rtcp_evict_stale_locked(esp_timer_get_time());
+        i = rtcp_allocate_locked(ssrc);
+    }
+    if (i >= 0) {
 #ifdef CONFIG_RTCP_LOG_SSRC
-            ESP_LOGI(TAG, "Allocated sync slot (post-evict) for SSRC 0x%08X", ssrc);
+        ESP_LOGI(TAG, "Allocated sync slot %d for SSRC 0x%08X", i, ssrc);
 #endif
-            return &rtcp_state.sync_info[i];
-        }
+        return &rtcp_state.sync_info[i];
     }
 
     // Still full; respect eviction policy (e.g., all slots may be pinned). Return NULL.
@@ -264,19 +591,18 @@ static rtcp_sync_info_t* find_or_allocate_sync_info(uint32_t ssrc) {
 // Internal helper: reseed mapping and reset PLL under rtcp_mutex
 static void rtcp_reseed_mapping_locked(rtcp_sync_info_t* s, int64_t new_b, bool reset_slope) {
     if (!s) return;
-    const double a0 = 1000000.0 / (double)CONFIG_SAMPLE_RATE;
     // Set new offset b (mono = ntp + b)
     s->offset_b_mono_us = new_b;
 
     // Optionally reset slope back to nominal if requested
     if (reset_slope) {
-        s->slope_a_us_per_tick = a0;
+        s->slope_a_q32 = rtcp_a0_q32;
     }
 
     // Reset PLL accumulators
-    s->pll_offset_b_us        = (double)new_b;
-    s->pll_slope_a_correction = (s->slope_a_us_per_tick / a0) - 1.0;
-    s->pll_i_err              = 0.0;
+    s->pll_offset_b_us        = new_b;
+    s->pll_slope_ppb          = rtcp_slope_ppb(s->slope_a_q32);
+    s->pll_i_err              = 0;
     s->pll_obs_count          = 0;
     s->pll_last_apply_mono    = 0;
 }
@@ -284,7 +610,7 @@ static void rtcp_reseed_mapping_locked(rtcp_sync_info_t* s, int64_t new_b, bool
 // Parse RTCP packet and update synchronization info
 esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
     if (!packet || len < sizeof(rtcp_header_t)) {
-        ESP_LOGW(TAG, "Invalid RTCP packet: too small (%d bytes)", len);
+        LOG_RATE_W(TAG, "Invalid RTCP packet: too small (%u bytes)", (unsigned)len);
         return ESP_ERR_INVALID_ARG;
     }
     
@@ -304,8 +630,8 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
         // Validate RTCP version per sub-packet
         uint8_t version = RTCP_VERSION(header->vprc);
         if (version != RTCP_VERSION_NUM) {
-            ESP_LOGW(TAG, "Invalid RTCP version: %d (expected %d) at offset %u",
-                     version, RTCP_VERSION_NUM, (unsigned)offset);
+            LOG_RATE_W(TAG, "Invalid RTCP version: %d (expected %d) at offset %u",
+                       version, RTCP_VERSION_NUM, (unsigned)offset);
             return ESP_ERR_INVALID_ARG;
         }
 
@@ -316,8 +642,8 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
 
         // Validate sub-packet size and bounds
         if (packet_size < sizeof(rtcp_header_t) || offset + packet_size > len) {
-            ESP_LOGW(TAG, "RTCP sub-packet size invalid: len_words=%u -> bytes=%u, remaining=%u",
-                     (unsigned)length_words, (unsigned)packet_size, (unsigned)(len - offset));
+            LOG_RATE_W(TAG, "RTCP sub-packet size invalid: len_words=%u -> bytes=%u, remaining=%u",
+                       (unsigned)length_words, (unsigned)packet_size, (unsigned)(len - offset));
             return ESP_ERR_INVALID_SIZE;
         }
 
@@ -335,11 +661,12 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
                 uint32_t ntp_frac = ntohl(sr->ntp_frac);
                 uint32_t rtp_ts = ntohl(sr->rtp_timestamp);
 
-                // Convert sender's NTP to microseconds and capture receiver's system time (NTP-synced)
+                // Convert sender's NTP to microseconds; the arrival on our master timeline
                 uint64_t sender_ntp_us = ((uint64_t)(ntp_sec - NTP_EPOCH_OFFSET) * 1000000ULL) +
                                          NTP_FRAC_TO_USEC(ntp_frac);
-                uint64_t receiver_ntp_us = get_system_time_us();
-                uint64_t mono_now = esp_timer_get_time();  // Still needed for staleness tracking
+                uint64_t mono_now = esp_timer_get_time();
+                uint64_t receiver_ntp_us = (uint64_t)clock_service_mono_to_master((int64_t)mono_now);
+                bool clock_locked = clock_service_is_locked();
 
                 // Obtain unwrapped RTP timestamp for SR without holding RTCP mutex
                 uint64_t sr_rtp64 = 0;
@@ -361,12 +688,27 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
                     sync_info->last_sr_ntp_sec  = ntp_sec;
                     sync_info->last_sr_ntp_frac = ntp_frac;
 
-                    // NTP-anchored playout mapping: compute offsets for sender NTP → receiver NTP → monotonic
-                    sync_info->offset_ntp_to_receiver_us = (int64_t)receiver_ntp_us - (int64_t)sender_ntp_us;
-                    sync_info->wall_to_mono_offset_us = (int64_t)mono_now - (int64_t)receiver_ntp_us;
-
                     // Compute offset between receiver and sender NTP clocks (should be small, ±microseconds to milliseconds)
                     int64_t new_b = (int64_t)receiver_ntp_us - (int64_t)sender_ntp_us;
+
+                    // Playout mapping sender NTP -> master -> monotonic. When both ends are locked to
+                    // the same NTP server the SR already carries master time and is used as is, so
+                    // every receiver plays a packet at the same instant regardless of its network
+                    // path; otherwise the sender's clock is pinned to ours at SR arrival. Leaving
+                    // the shared timeline takes twice the entry offset, so SR jitter near the
+                    // threshold does not flip between the two.
+                    int64_t shared_tol_us = (int64_t)CONFIG_RTCP_SHARED_CLOCK_MAX_OFFSET_MS * 1000LL;
+                    if (sync_info->shared_clock) {
+                        shared_tol_us *= 2;
+                    }
+                    bool shared = clock_locked && new_b <= shared_tol_us && new_b >= -shared_tol_us;
+                    if (shared != sync_info->shared_clock) {
+                        ESP_LOGI(TAG, "SSRC 0x%08X: %s (SR offset %lld us)", ssrc,
+                                 shared ? "on the shared NTP timeline" : "anchored at SR arrival",
+                                 (long long)new_b);
+                        sync_info->shared_clock = shared;
+                    }
+                    sync_info->sender_to_master_us = shared ? 0 : new_b;
                     bool seeded = (sync_info->rtp_sr_base64 != 0 && sync_info->ntp_sr_base_us != 0 && sync_info->mono_sr_base_us != 0);
 
                     if (seeded) {
@@ -377,9 +719,9 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
                             uint64_t since = (mono_now >= last_apply) ? (mono_now - last_apply) : 0ULL;
                             if (since > ((uint64_t)CONFIG_RTCP_SR_RESEED_HOLDOFF_MS * 1000ULL)) {
                                 // Treat as clock step and reseed mapping and PLL
-                                const double a0 = 1000000.0 / (double)CONFIG_SAMPLE_RATE;
-                                double ppm_dev = fabs((sync_info->slope_a_us_per_tick / a0) - 1.0) * 1.0e6;
-                                bool reset_slope = (ppm_dev > 50.0);
+                                int64_t a_dev = sync_info->slope_a_q32 - rtcp_a0_q32;
+                                if (a_dev < 0) a_dev = -a_dev;
+                                bool reset_slope = (a_dev * 1000000LL > 50LL * rtcp_a0_q32);  // > 50 ppm
                                 rtcp_reseed_mapping_locked(sync_info, new_b, reset_slope);
 #ifdef CONFIG_RTCP_LOG_SYNC_INFO
                                 static uint32_t reseed_log_counter = 0;
@@ -392,17 +734,6 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
                     } else {
                         // First SR: seed mapping to nominal slope and observed offset
                         rtcp_reseed_mapping_locked(sync_info, new_b, true);
-
-                        // Establish stable NTP→monotonic baseline for multi-speaker sync
-                        if (!sync_info->ntp_to_mono_baseline_valid) {
-                            sync_info->ntp_to_mono_baseline_ntp_us = receiver_ntp_us;
-                            sync_info->ntp_to_mono_baseline_mono_us = mono_now;
-                            sync_info->ntp_to_mono_baseline_valid = true;
-                            ESP_LOGI(TAG, "SSRC 0x%08X: Established NTP→mono baseline at NTP=%llu mono=%llu",
-                                     ssrc,
-                                     (unsigned long long)receiver_ntp_us,
-                                     (unsigned long long)mono_now);
-                        }
                     }
 
                     // Update SR bases for RTP->time mapping
@@ -420,10 +751,13 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
 
                     // Opportunistic stale eviction (decimated)
                     static uint32_t sr_evict_decim = 0;
-                    if (rtcp_state.active_sources >= RTCP_MAX_SSRC_SOURCES || ((++sr_evict_decim & 0xFFu) == 0)) {
+                    if ((++sr_evict_decim & 0xFFu) == 0) {
                         rtcp_evict_stale_locked(mono_now);
                     }
                 }
+                if (sync_info) {
+                    rtcp_publish_map_locked((int)(sync_info - rtcp_state.sync_info));
+                }
                 xSemaphoreGive(rtcp_mutex);
 
 #ifdef CONFIG_RTCP_LOG_SYNC_INFO
@@ -472,21 +806,15 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
                     uint32_t bye_ssrc = ntohl(ssrc_n);
                     ESP_LOGI(TAG, "BYE from SSRC 0x%08X", bye_ssrc);
 
-                    for (int j = 0; j < RTCP_MAX_SSRC_SOURCES; j++) {
-                        if (rtcp_state.sync_info[j].valid &&
-                            rtcp_state.sync_info[j].ssrc == bye_ssrc) {
-                            rtcp_state.sync_info[j].valid = false;
-                            if (rtcp_state.active_sources > 0) {
-                                rtcp_state.active_sources--;
-                            }
-                            // If this was the primary, demote and force re-selection later
-                            if (rtcp_state.primary_valid && rtcp_state.primary_ssrc == bye_ssrc) {
-                                rtcp_state.primary_valid = false;
+                    int j = rtcp_find_locked(bye_ssrc);
+                    if (j >= 0) {
+                        rtcp_release_locked(j);
+                        // If this was the primary, demote and force re-selection later
+                        if (rtcp_state.primary_valid && rtcp_state.primary_ssrc == bye_ssrc) {
+                            rtcp_state.primary_valid = false;
 #ifdef CONFIG_RTCP_LOG_SSRC
-                                ESP_LOGI(TAG, "Primary SSRC 0x%08X cleared due to BYE", bye_ssrc);
+                            ESP_LOGI(TAG, "Primary SSRC 0x%08X cleared due to BYE", bye_ssrc);
 #endif
-                            }
-                            break;
                         }
                     }
                 }
@@ -496,6 +824,24 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
                 break;
             }
 
+            case RTCP_XR: {
+                // Extended Report: only DLRR (the sender answering our RRTR) is used
+                size_t boff = sizeof(rtcp_header_t) + 4U;
+                while (boff + 4U <= packet_size) {
+                    uint8_t bt = ptr[boff];
+                    size_t block_size = (((size_t)ptr[boff + 2] << 8) | ptr[boff + 3]) * 4U + 4U;
+                    if (boff + block_size > packet_size) {
+                        break;
+                    }
+                    if (bt == RTCP_XR_DLRR) {
+                        rtcp_xr_parse_dlrr(ptr + boff + 4U, block_size - 4U);
+                    }
+                    boff += block_size;
+                }
+                parsed_any = true;
+                break;
+            }
+
             default: {
                 // Unknown/APP/other - safely skip
                 ESP_LOGD(TAG, "Received RTCP packet type %d (skipped)", packet_type);
@@ -509,7 +855,7 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len) {
 
     // If there are leftover bytes that can't form a header, treat as malformed
     if (offset != len) {
-        ESP_LOGW(TAG, "Trailing bytes in RTCP compound packet: %u", (unsigned)(len - offset));
+        LOG_RATE_W(TAG, "Trailing bytes in RTCP compound packet: %u", (unsigned)(len - offset));
         return ESP_ERR_INVALID_SIZE;
     }
 
@@ -529,33 +875,16 @@ esp_err_t rtcp_calculate_playout_time(uint32_t ssrc, uint32_t rtp_timestamp, uin
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Snapshot sync info fields under mutex
-    uint32_t last_sr_rtp32 = 0;
-    uint64_t mono_sr_base_us = 0;
-    uint64_t ntp_sr_base_us = 0;
-    int64_t offset_ntp_to_receiver_us = 0;
-    int64_t wall_to_mono_offset_us = 0;
-
-    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-    rtcp_sync_info_t *sync_info = NULL;
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            sync_info = &rtcp_state.sync_info[i];
-            break;
-        }
-    }
-    if (sync_info) {
-        last_sr_rtp32 = sync_info->last_sr_rtp32;
-        mono_sr_base_us = sync_info->mono_sr_base_us;
-        ntp_sr_base_us = sync_info->ntp_sr_base_us;
-        offset_ntp_to_receiver_us = sync_info->offset_ntp_to_receiver_us;
-        wall_to_mono_offset_us = sync_info->wall_to_mono_offset_us;
-    }
-    xSemaphoreGive(rtcp_mutex);
-
-    if (!sync_info) {
+    // Lock-free snapshot of the mapping (seqlock; see rtcp_read_map)
+    rtcp_map_t map;
+    if (!rtcp_read_map(ssrc, &map)) {
         return ESP_ERR_NOT_FOUND;
     }
+    const uint32_t last_sr_rtp32 = map.last_sr_rtp32;
+    const uint64_t mono_sr_base_us = map.mono_sr_base_us;
+    const uint64_t ntp_sr_base_us = map.ntp_sr_base_us;
+    const int64_t sender_to_master_us = map.sender_to_master_us;
+    const int64_t a0_q32 = map.a0_q32;
 
     // Verify SR freshness using existing max-age logic
     uint64_t now_mono_us = esp_timer_get_time();
@@ -579,18 +908,17 @@ esp_err_t rtcp_calculate_playout_time(uint32_t ssrc, uint32_t rtp_timestamp, uin
         return ESP_ERR_NOT_FOUND;
     }
 
-    // NTP-anchored playout mapping: sender_NTP → receiver_NTP → monotonic (wall_to_mono_offset_us)
+    // NTP-anchored playout mapping: sender_NTP → master → monotonic (clock_service)
     // Step 1: Compute sender's NTP time of the packet using SR anchor and nominal slope
     int32_t delta_ticks = (int32_t)(rtp_timestamp - last_sr_rtp32);
-    double a0 = 1000000.0 / (double)CONFIG_SAMPLE_RATE;  // nominal microseconds per RTP tick
-    int64_t packet_sender_ntp_us = (int64_t)ntp_sr_base_us + (int64_t)((double)delta_ticks * a0);
+    int64_t packet_sender_ntp_us = (int64_t)ntp_sr_base_us + rtcp_ticks_to_us(delta_ticks, a0_q32);
     
-    // Step 2: Convert to receiver NTP using offset
-    int64_t packet_receiver_ntp_us = packet_sender_ntp_us + offset_ntp_to_receiver_us;
+    // Step 2: Convert to master time (identity while the sender shares our NTP server)
+    int64_t packet_master_us = packet_sender_ntp_us + sender_to_master_us;
     
     // Step 3: Convert to monotonic scheduling time
-    uint64_t target_latency_us = (uint64_t)CONFIG_RTCP_TARGET_LATENCY_MS * 1000ULL;
-    int64_t playout_i64 = packet_receiver_ntp_us + wall_to_mono_offset_us + (int64_t)target_latency_us;
+    uint64_t target_latency_us = (uint64_t)atomic_load_explicit(&rtcp_target_latency_ms, memory_order_relaxed) * 1000ULL;
+    int64_t playout_i64 = clock_service_master_to_mono(packet_master_us) + (int64_t)target_latency_us;
     
     // Clamp negative values to 0
     if (playout_i64 < 0) {
@@ -625,15 +953,15 @@ esp_err_t rtcp_calculate_playout_time(uint32_t ssrc, uint32_t rtp_timestamp, uin
     // Low-rate diagnostic logging to validate NTP-anchored playout mapping
     static uint32_t log_counter = 0;
     if (++log_counter % 100 == 0) {
-        ESP_LOGI(TAG, "NTP-map: ssrc=0x%08X rtp=%u sr_rtp=%u dt=%ld a0=%.6f ntp_sr=%llu off_ntp=%lld off_w2m=%lld out=%llu now=%llu",
+        ESP_LOGI(TAG, "NTP-map: ssrc=0x%08X rtp=%u sr_rtp=%u dt=%ld a0=%lu.%06lu ntp_sr=%llu off_s2m=%lld out=%llu now=%llu",
                  ssrc,
                  rtp_timestamp,
                  last_sr_rtp32,
                  (long)delta_ticks,
-                 a0,
+                 (unsigned long)(a0_q32 >> 32),
+                 (unsigned long)((((uint64_t)a0_q32 & 0xFFFFFFFFu) * 1000000u) >> 32),
                  (unsigned long long)ntp_sr_base_us,
-                 (long long)offset_ntp_to_receiver_us,
-                 (long long)wall_to_mono_offset_us,
+                 (long long)sender_to_master_us,
                  (unsigned long long)*playout_time,
                  (unsigned long long)now_mono_us);
     }
@@ -642,66 +970,207 @@ esp_err_t rtcp_calculate_playout_time(uint32_t ssrc, uint32_t rtp_timestamp, uin
     return ESP_OK;
 }
 
-// Generate RTCP Receiver Report (single report block for specified SSRC)
-esp_err_t rtcp_generate_rr(uint32_t report_ssrc, uint8_t *buffer, size_t buffer_size, size_t *packet_size) {
-    if (!buffer || !packet_size) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    if (!rtcp_state.initialized) {
-        return ESP_ERR_INVALID_STATE;
-    }
+static inline void rtcp_put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
 
-    const size_t need = sizeof(rtcp_rr_packet_t) + sizeof(rtcp_report_block_t);
-    if (buffer_size < need) {
-        return ESP_ERR_INVALID_SIZE;
+static inline void rtcp_put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t rtcp_isqrt64(uint64_t v) {
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
     }
+    return (uint32_t)r;
+}
 
-    // Snapshot per-SSRC stats under mutex and update RR interval bases atomically
-    uint32_t ext_max_seq = 0;
-    uint32_t seq_base = 0;
-    uint32_t received_pkts = 0;
-    int32_t  cumulative_lost = 0;
-    double   jitter_ts = 0.0;
-    uint64_t last_sr_mono_us = 0;
-    uint32_t last_sr_ntp_sec = 0;
-    uint32_t last_sr_ntp_frac = 0;
-    uint32_t rr_prev_expected = 0;
-    uint32_t rr_prev_received = 0;
-    bool seq_initialized = false;
+// Master clock as 64-bit NTP (seconds since 1900 << 32 | fraction)
+static inline uint64_t rtcp_ntp_now(void) {
+    return clock_service_ntp64_at(esp_timer_get_time());
+}
 
-    uint64_t now_us = esp_timer_get_time();
+// Burst/gap model (RFC 3611 4.7.2, Gmin = 16): one received packet
+static inline void rtcp_xr_received(rtcp_xr_accum_t *x) {
+    x->pkt++;
+}
 
-    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-    rtcp_sync_info_t *sync = NULL;
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == report_ssrc) {
-            sync = &rtcp_state.sync_info[i];
-            break;
+// ... and `n` consecutive losses; after the first, each loss only extends the burst
+static void rtcp_xr_lost(rtcp_xr_accum_t *x, uint32_t n) {
+    if (x->pkt >= RTCP_XR_GMIN) {
+        if (x->lost == 1) x->c14++; else x->c13++;
+        x->lost = 1;
+        x->c11 += x->pkt;
+    } else {
+        x->lost++;
+        if (x->pkt == 0) {
+            x->c33++;
+        } else {
+            x->c23++;
+            x->c22 += x->pkt - 1;
         }
     }
+    x->pkt = 0;
+    x->lost += n - 1;
+    x->c33 += n - 1;
+}
 
-    if (!sync || !sync->seq_initialized) {
-        xSemaphoreGive(rtcp_mutex);
-        return ESP_ERR_NOT_FOUND;
-    }
+static void rtcp_xr_jitter(rtcp_xr_accum_t *x, uint32_t ad) {
+    if (ad > RTCP_XR_JITTER_CAP) ad = RTCP_XR_JITTER_CAP;
+    if (x->jit_count == 0 || ad < x->jit_min) x->jit_min = ad;
+    if (ad > x->jit_max) x->jit_max = ad;
+    x->jit_count++;
+    x->jit_sum += ad;
+    x->jit_sumsq += (uint64_t)ad * ad;
+}
+
+// Statistics Summary block for the interval since the last XR, then start a new one.
+// Caller holds rtcp_mutex.
+static void rtcp_xr_fill_summary_locked(rtcp_sync_info_t *s, uint8_t *p) {
+    rtcp_xr_accum_t *x = &s->xr;
+    uint32_t end_ext_seq = s->ext_max_seq + 1U;  // exclusive
+    int32_t lost = s->cumulative_lost - x->lost_base;
+    uint32_t mean = 0;
+    uint32_t dev = 0;
+    if (x->jit_count) {
+        mean = (uint32_t)(x->jit_sum / x->jit_count);
+        uint64_t sq_mean = x->jit_sumsq / x->jit_count;
+        uint64_t mean_sq = (uint64_t)mean * mean;
+        dev = rtcp_isqrt64(sq_mean > mean_sq ? sq_mean - mean_sq : 0);
+    }
+
+    memset(p, 0, RTCP_XR_SUMMARY_SIZE);
+    p[0] = RTCP_XR_STAT_SUMMARY;
+    p[1] = 0xA0;  // L (lost) and J (jitter) fields valid; no duplicate or TTL data
+    rtcp_put16(p + 2, RTCP_XR_SUMMARY_SIZE / 4 - 1);
+    rtcp_put32(p + 4, s->ssrc);
+    rtcp_put16(p + 8, (uint16_t)x->begin_ext_seq);
+    rtcp_put16(p + 10, (uint16_t)end_ext_seq);
+    rtcp_put32(p + 12, lost > 0 ? (uint32_t)lost : 0);
+    rtcp_put32(p + 20, x->jit_min);
+    rtcp_put32(p + 24, x->jit_max);
+    rtcp_put32(p + 28, mean);
+    rtcp_put32(p + 32, dev);
+
+    x->begin_ext_seq = end_ext_seq;
+    x->lost_base = s->cumulative_lost;
+    x->jit_min = 0;
+    x->jit_max = 0;
+    x->jit_count = 0;
+    x->jit_sum = 0;
+    x->jit_sumsq = 0;
+}
+
+static uint8_t rtcp_xr_rate(uint32_t n, uint32_t expected) {
+    if (expected == 0) return 0;
+    uint64_t r = ((uint64_t)n * 256U) / expected;
+    return (uint8_t)(r > 255U ? 255U : r);
+}
 
-    // Snapshot fields for computation outside the lock
-    ext_max_seq       = sync->ext_max_seq;
-    seq_base          = sync->seq_base;
-    received_pkts     = sync->received_pkts;
-    cumulative_lost   = sync->cumulative_lost;
-    jitter_ts         = sync->jitter_ts;
-    last_sr_mono_us   = sync->last_sr_mono_us;
-    last_sr_ntp_sec   = sync->last_sr_ntp_sec;
-    last_sr_ntp_frac  = sync->last_sr_ntp_frac;
-    rr_prev_expected  = sync->rr_prev_expected;
-    rr_prev_received  = sync->rr_prev_received;
-    seq_initialized   = sync->seq_initialized;
+static uint16_t rtcp_xr_clamp16(uint64_t v) {
+    return (uint16_t)(v > 0xFFFFU ? 0xFFFFU : v);
+}
+
+// VoIP Metrics block (since the start of the stream). Caller holds rtcp_mutex.
+static void rtcp_xr_fill_voip_locked(const rtcp_sync_info_t *s, const rtcp_xr_playout_t *pl,
+                                     uint32_t rtt_q16, uint8_t *p) {
+    const rtcp_xr_accum_t *x = &s->xr;
+    uint32_t expected = (s->ext_max_seq - s->seq_base) + 1U;
+
+    // Burst density 256 * p23 / (p23 + p32), with p23 = c23 / (c22 + c23), p32 = c32 / (c31 + c32 + c33)
+    uint64_t c31 = x->c13;
+    uint64_t c32 = x->c23;
+    uint64_t burst_den = 0;
+    uint64_t pa = x->c23, pb = (uint64_t)x->c22 + x->c23;  // p23 = pa / pb
+    if (pb == 0) {
+        pa = pb = 1;
+    }
+    uint64_t pd = c31 + c32 + x->c33;                      // p32 = c32 / pd
+    if (pd > 0 && (pa * pd + c32 * pb) > 0) {
+        burst_den = 256U * pa * pd / (pa * pd + c32 * pb);
+    }
+    uint64_t gap_den = (x->c11 + x->c14) ? 256ULL * x->c14 / ((uint64_t)x->c11 + x->c14) : 0;
+
+    // Durations in ms: gap = (c11 + c14 + c13) * m / c13, burst = ctotal * m / c13 - gap
+    uint64_t ctotal = (uint64_t)x->c11 + x->c14 + x->c13 + x->c22 + x->c23 + c31 + c32 + x->c33;
+    uint64_t gap_ms = 0;
+    uint64_t burst_ms = 0;
+    if (x->c13 > 0) {
+        gap_ms = ((uint64_t)x->c11 + x->c14 + x->c13) * pl->packet_us / x->c13 / 1000U;
+        uint64_t all_ms = ctotal * pl->packet_us / x->c13 / 1000U;
+        burst_ms = all_ms > gap_ms ? all_ms - gap_ms : 0;
+    } else {
+        gap_ms = ((uint64_t)x->c11 + x->c14 + x->pkt) * pl->packet_us / 1000U;
+    }
+
+    memset(p, 0, RTCP_XR_VOIP_SIZE);
+    p[0] = RTCP_XR_VOIP_METRICS;
+    rtcp_put16(p + 2, RTCP_XR_VOIP_SIZE / 4 - 1);
+    rtcp_put32(p + 4, s->ssrc);
+    p[8]  = rtcp_xr_rate(s->cumulative_lost > 0 ? (uint32_t)s->cumulative_lost : 0, expected);
+    p[9]  = rtcp_xr_rate(pl->discarded, expected);
+    p[10] = (uint8_t)(burst_den > 255U ? 255U : burst_den);
+    p[11] = (uint8_t)(gap_den > 255U ? 255U : gap_den);
+    rtcp_put16(p + 12, rtcp_xr_clamp16(burst_ms));
+    rtcp_put16(p + 14, rtcp_xr_clamp16(gap_ms));
+    rtcp_put16(p + 16, rtcp_xr_clamp16(((uint64_t)rtt_q16 * 1000U) >> 16));
+    rtcp_put16(p + 18, pl->end_system_delay_ms);
+    p[20] = RTCP_XR_UNAVAILABLE;  // signal level
+    p[21] = RTCP_XR_UNAVAILABLE;  // noise level
+    p[22] = RTCP_XR_UNAVAILABLE;  // residual echo return loss
+    p[23] = RTCP_XR_GMIN;
+    p[24] = RTCP_XR_UNAVAILABLE;  // R factor
+    p[25] = RTCP_XR_UNAVAILABLE;  // external R factor
+    p[26] = RTCP_XR_UNAVAILABLE;  // MOS-LQ
+    p[27] = RTCP_XR_UNAVAILABLE;  // MOS-CQ
+    p[28] = (uint8_t)(((pl->plc & 0x3U) << 6) | (pl->adaptive ? 0x30U : 0x20U));
+    rtcp_put16(p + 30, pl->jb_nominal_ms);
+    rtcp_put16(p + 32, pl->jb_max_ms);
+    rtcp_put16(p + 34, pl->jb_abs_max_ms);
+}
+
+// Round trip from a DLRR sub-block answering our RRTR (RFC 3611 4.5)
+static void rtcp_xr_parse_dlrr(const uint8_t *p, size_t len) {
+    uint32_t now_mid = (uint32_t)(rtcp_ntp_now() >> 16);
+    for (size_t off = 0; off + 12U <= len; off += 12U) {
+        uint32_t ssrc = ((uint32_t)p[off] << 24) | ((uint32_t)p[off + 1] << 16) |
+                        ((uint32_t)p[off + 2] << 8) | p[off + 3];
+        uint32_t lrr  = ((uint32_t)p[off + 4] << 24) | ((uint32_t)p[off + 5] << 16) |
+                        ((uint32_t)p[off + 6] << 8) | p[off + 7];
+        uint32_t dlrr = ((uint32_t)p[off + 8] << 24) | ((uint32_t)p[off + 9] << 16) |
+                        ((uint32_t)p[off + 10] << 8) | p[off + 11];
+        if (ssrc != rtcp_state.local_ssrc || lrr == 0) {
+            continue;
+        }
+        int32_t rtt = (int32_t)(now_mid - lrr - dlrr);
+        if (rtt >= 0) {
+            xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+            rtcp_state.rtt_q16 = (uint32_t)rtt;
+            xSemaphoreGive(rtcp_mutex);
+        }
+    }
+}
 
+// Fill one report block for `sync` and start a new RR interval (RFC 3550 6.4.1).
+// Caller holds rtcp_mutex.
+static void rtcp_fill_report_block_locked(rtcp_sync_info_t *sync, rtcp_report_block_t *rb, uint64_t now_us) {
     // Compute current "expected" and interval deltas (RFC 3550)
-    uint32_t expected = (ext_max_seq - seq_base) + 1U;
-    uint32_t expected_interval = expected - rr_prev_expected;
-    uint32_t received_interval = received_pkts - rr_prev_received;
+    uint32_t expected = (sync->ext_max_seq - sync->seq_base) + 1U;
+    uint32_t expected_interval = expected - sync->rr_prev_expected;
+    uint32_t received_interval = sync->received_pkts - sync->rr_prev_received;
     int32_t  lost_interval = (int32_t)expected_interval - (int32_t)received_interval;
 
     // Fraction lost over the last interval (8-bit fixed point, [0,255])
@@ -716,56 +1185,31 @@ esp_err_t rtcp_generate_rr(uint32_t report_ssrc, uint8_t *buffer, size_t buffer_
     // LSR/DLSR
     uint32_t lsr = 0;
     uint32_t dlsr = 0;
-    if (last_sr_mono_us != 0 && last_sr_ntp_sec != 0) {
-        lsr = ((last_sr_ntp_sec & 0xFFFF) << 16) | ((last_sr_ntp_frac >> 16) & 0xFFFF);
-        if (now_us >= last_sr_mono_us) {
-            uint64_t delay_us = now_us - last_sr_mono_us;
-            double d = ((double)delay_us / 1000000.0) * 65536.0;
-            uint64_t d_scaled = (uint64_t)(d + 0.5);
+    if (sync->last_sr_mono_us != 0 && sync->last_sr_ntp_sec != 0) {
+        lsr = ((sync->last_sr_ntp_sec & 0xFFFF) << 16) | ((sync->last_sr_ntp_frac >> 16) & 0xFFFF);
+        if (now_us >= sync->last_sr_mono_us) {
+            uint64_t delay_us = now_us - sync->last_sr_mono_us;
+            // 1/65536 s units, rounded
+            uint64_t d_scaled = (delay_us * 65536ULL + 500000ULL) / 1000000ULL;
             if (d_scaled > 0xFFFFFFFFULL) d_scaled = 0xFFFFFFFFULL;
             dlsr = (uint32_t)d_scaled;
-        } else {
-            dlsr = 0;
         }
     }
 
-    // Update interval bases for next RR
+    // Update interval bases for next RR; keep fraction lost for the summary
     sync->rr_prev_expected = expected;
-    sync->rr_prev_received = received_pkts;
+    sync->rr_prev_received = sync->received_pkts;
     sync->rr_prev_mono_us  = now_us;
-    xSemaphoreGive(rtcp_mutex);
-
-    // Store last computed fraction lost for summary
-    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == report_ssrc) {
-            rtcp_state.sync_info[i].rr_prev_fraction_lost = (uint32_t)fraction_lost;
-            break;
-        }
-    }
-    xSemaphoreGive(rtcp_mutex);
-
-    // Build RR packet with one report block
-    memset(buffer, 0, need);
-    rtcp_rr_packet_t *rr = (rtcp_rr_packet_t *)buffer;
-    rtcp_report_block_t *rb = (rtcp_report_block_t *)(buffer + sizeof(rtcp_rr_packet_t));
-
-    // Header: Version=2, Padding=0, RC=1
-    rr->header.vprc  = (uint8_t)((RTCP_VERSION_NUM << 6) | 0x01);
-    rr->header.pt    = RTCP_RR;
-    rr->header.length = htons((uint16_t)(((uint16_t)(need / 4U)) - 1U));
-
-    // Local receiver SSRC (placeholder until a real one is wired)
-    rr->ssrc = htonl(0x12345678);
+    sync->rr_prev_fraction_lost = (uint32_t)fraction_lost;
 
-    // Report block for the sender SSRC we are reporting on
-    rb->ssrc = htonl(report_ssrc);
+    memset(rb, 0, sizeof(*rb));
+    rb->ssrc = htonl(sync->ssrc);
     rb->fraction_lost = fraction_lost;
 
     // Cumulative lost (24-bit signed, big-endian; clamp to [-8388608, 8388607])
     const int32_t CUM_MIN = -8388608;
     const int32_t CUM_MAX =  8388607;
-    int32_t cum_lost_clamped = cumulative_lost;
+    int32_t cum_lost_clamped = sync->cumulative_lost;
     if (cum_lost_clamped < CUM_MIN) cum_lost_clamped = CUM_MIN;
     if (cum_lost_clamped > CUM_MAX) cum_lost_clamped = CUM_MAX;
     uint32_t cum24 = ((uint32_t)cum_lost_clamped) & 0x00FFFFFFu;
@@ -774,10 +1218,8 @@ esp_err_t rtcp_generate_rr(uint32_t report_ssrc, uint8_t *buffer, size_t buffer_
     rb->cumulative_lost[2] = (uint8_t)(cum24 & 0xFF);
 
     // Extended highest seq and jitter
-    rb->highest_seq = htonl(ext_max_seq);
-    uint32_t jitter_u32 = (jitter_ts <= 0.0) ? 0u :
-                          (jitter_ts >= (double)UINT32_MAX ? UINT32_MAX : (uint32_t)(jitter_ts));
-    rb->jitter = htonl(jitter_u32);
+    rb->highest_seq = htonl(sync->ext_max_seq);
+    rb->jitter = htonl(sync->jitter_q4 >> 4);
 
     // LSR/DLSR
     rb->lsr  = htonl(lsr);
@@ -785,21 +1227,191 @@ esp_err_t rtcp_generate_rr(uint32_t report_ssrc, uint8_t *buffer, size_t buffer_
 
 #ifdef CONFIG_RTCP_LOG_RR
     ESP_LOGI(TAG, "RR: src=0x%08X fl=%u cum=%ld ext=0x%08X jit=%u lsr=0x%08X dlsr=0x%08X exp_i=%u rcv_i=%u",
-             report_ssrc,
+             sync->ssrc,
              (unsigned)fraction_lost,
              (long)cum_lost_clamped,
-             (unsigned)ext_max_seq,
-             (unsigned)jitter_u32,
+             (unsigned)sync->ext_max_seq,
+             (unsigned)(sync->jitter_q4 >> 4),
              (unsigned)lsr,
              (unsigned)dlsr,
              (unsigned)expected_interval,
              (unsigned)received_interval);
 #endif
+}
+
+// Generate RTCP Receiver Report (single report block for specified SSRC)
+esp_err_t rtcp_generate_rr(uint32_t report_ssrc, uint8_t *buffer, size_t buffer_size, size_t *packet_size) {
+    if (!buffer || !packet_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!rtcp_state.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const size_t need = sizeof(rtcp_rr_packet_t) + sizeof(rtcp_report_block_t);
+    if (buffer_size < need) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    rtcp_rr_packet_t *rr = (rtcp_rr_packet_t *)buffer;
+    rtcp_report_block_t *rb = (rtcp_report_block_t *)(buffer + sizeof(rtcp_rr_packet_t));
+    uint64_t now_us = esp_timer_get_time();
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    rtcp_sync_info_t *sync = rtcp_find_sync_locked(report_ssrc);
+
+    if (!sync || !sync->seq_initialized) {
+        xSemaphoreGive(rtcp_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    rtcp_fill_report_block_locked(sync, rb, now_us);
+    rr->ssrc = htonl(rtcp_state.local_ssrc);
+    xSemaphoreGive(rtcp_mutex);
+
+    // Header: Version=2, Padding=0, RC=1
+    rr->header.vprc  = (uint8_t)((RTCP_VERSION_NUM << 6) | 0x01);
+    rr->header.pt    = RTCP_RR;
+    rr->header.length = htons((uint16_t)(((uint16_t)(need / 4U)) - 1U));
 
     *packet_size = need;
     return ESP_OK;
 }
 
+// Generate compound RR + SDES(CNAME) [+ XR] [+ BYE] covering every tracked source
+esp_err_t rtcp_build_report(uint8_t *buffer, size_t buffer_size, const char *cname,
+                            const rtcp_xr_playout_t *xr, bool bye, size_t *packet_size) {
+    if (!buffer || !packet_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!rtcp_state.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // SDES chunk: SSRC, CNAME item (type, length, text), terminating null item, padded to 32 bits
+    size_t cname_len = cname ? strnlen(cname, 255) : 0;
+    size_t sdes_size = (sizeof(rtcp_header_t) + 4U + 2U + cname_len + 1U + 3U) & ~(size_t)3U;
+    size_t bye_size = bye ? sizeof(rtcp_header_t) + 4U : 0;
+    // XR: header + SSRC, RRTR, VoIP Metrics for one source, Statistics Summary per source
+    size_t xr_fixed = xr ? sizeof(rtcp_header_t) + 4U + RTCP_XR_RRTR_SIZE + RTCP_XR_VOIP_SIZE : 0;
+    size_t per_source = sizeof(rtcp_report_block_t) + (xr ? RTCP_XR_SUMMARY_SIZE : 0);
+    size_t fixed = sizeof(rtcp_rr_packet_t) + sdes_size + xr_fixed + bye_size;
+    if (buffer_size < fixed) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t max_blocks = (buffer_size - fixed) / per_source;
+    if (max_blocks > 31U) max_blocks = 31U;  // 5-bit report count
+    if (max_blocks > RTCP_RR_MAX_BLOCKS) max_blocks = RTCP_RR_MAX_BLOCKS;
+
+    uint64_t now_us = esp_timer_get_time();
+    uint64_t ntp_now = rtcp_ntp_now();
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    uint32_t local_ssrc = rtcp_state.local_ssrc;
+    int reported[RTCP_RR_MAX_BLOCKS];
+    size_t count = 0;
+    // The primary stream always gets the first block; the other sources take turns
+    // from rr_cursor when there are more of them than blocks
+    int primary = rtcp_state.primary_valid ? rtcp_find_locked(rtcp_state.primary_ssrc) : -1;
+    if (primary >= 0 && !rtcp_state.sync_info[primary].seq_initialized) {
+        primary = -1;
+    }
+    if (primary >= 0 && max_blocks > 0) {
+        reported[count++] = primary;
+    }
+    uint32_t start = rtcp_state.rr_cursor % RTCP_MAX_SSRC_SOURCES;
+    uint32_t n = 0;
+    for (; n < RTCP_MAX_SSRC_SOURCES && count < max_blocks; n++) {
+        int i = (int)((start + n) % RTCP_MAX_SSRC_SOURCES);
+        rtcp_sync_info_t *sync = &rtcp_state.sync_info[i];
+        if (i != primary && sync->valid && sync->seq_initialized) {
+            reported[count++] = i;
+        }
+    }
+    rtcp_state.rr_cursor = (start + n) % RTCP_MAX_SSRC_SOURCES;
+
+    // Layout: RR | SDES | XR (header, RRTR, summaries, VoIP) | BYE
+    rtcp_report_block_t *blocks = (rtcp_report_block_t *)(buffer + sizeof(rtcp_rr_packet_t));
+    size_t sdes_off = sizeof(rtcp_rr_packet_t) + count * sizeof(rtcp_report_block_t);
+    size_t xr_off = sdes_off + sdes_size;
+    uint8_t *summaries = buffer + xr_off + sizeof(rtcp_header_t) + 4U + RTCP_XR_RRTR_SIZE;
+    for (size_t k = 0; k < count; k++) {
+        rtcp_sync_info_t *sync = &rtcp_state.sync_info[reported[k]];
+        rtcp_fill_report_block_locked(sync, &blocks[k], now_us);
+        if (xr) {
+            rtcp_xr_fill_summary_locked(sync, summaries + k * RTCP_XR_SUMMARY_SIZE);
+        }
+    }
+    bool voip = false;
+    if (xr && count > 0) {
+        // Playout metrics describe the primary stream (the one feeding the buffer): reported[0]
+        int idx = reported[0];
+        rtcp_xr_fill_voip_locked(&rtcp_state.sync_info[idx], xr, rtcp_state.rtt_q16,
+                                 summaries + count * RTCP_XR_SUMMARY_SIZE);
+        voip = true;
+    }
+    rtcp_state.last_rr_sent = now_us;
+    xSemaphoreGive(rtcp_mutex);
+
+    // RR with RC report blocks (RC=0 is a valid empty RR, still required first)
+    rtcp_rr_packet_t *rr = (rtcp_rr_packet_t *)buffer;
+    rr->header.vprc  = (uint8_t)((RTCP_VERSION_NUM << 6) | (uint8_t)count);
+    rr->header.pt    = RTCP_RR;
+    rr->header.length = htons((uint16_t)(sdes_off / 4U - 1U));
+    rr->ssrc = htonl(local_ssrc);
+
+    // SDES with one chunk
+    uint8_t *p = buffer + sdes_off;
+    memset(p, 0, sdes_size);
+    rtcp_header_t *hdr = (rtcp_header_t *)p;
+    hdr->vprc   = (uint8_t)((RTCP_VERSION_NUM << 6) | 0x01);
+    hdr->pt     = RTCP_SDES;
+    hdr->length = htons((uint16_t)(sdes_size / 4U - 1U));
+    rtcp_put32(p + sizeof(rtcp_header_t), local_ssrc);
+    p[sizeof(rtcp_header_t) + 4] = 1;  // CNAME
+    p[sizeof(rtcp_header_t) + 5] = (uint8_t)cname_len;
+    if (cname_len) {
+        memcpy(p + sizeof(rtcp_header_t) + 6, cname, cname_len);
+    }
+    size_t off = xr_off;
+
+    if (xr) {
+        size_t xr_size = sizeof(rtcp_header_t) + 4U + RTCP_XR_RRTR_SIZE +
+                         count * RTCP_XR_SUMMARY_SIZE + (voip ? RTCP_XR_VOIP_SIZE : 0);
+        p = buffer + xr_off;
+        hdr = (rtcp_header_t *)p;
+        hdr->vprc   = (uint8_t)(RTCP_VERSION_NUM << 6);
+        hdr->pt     = RTCP_XR;
+        hdr->length = htons((uint16_t)(xr_size / 4U - 1U));
+        rtcp_put32(p + sizeof(rtcp_header_t), local_ssrc);
+        // RRTR: our NTP time, echoed back by the sender in DLRR for the round trip
+        uint8_t *rrtr = p + sizeof(rtcp_header_t) + 4U;
+        rrtr[0] = RTCP_XR_RRTR;
+        rrtr[1] = 0;
+        rtcp_put16(rrtr + 2, RTCP_XR_RRTR_SIZE / 4 - 1);
+        rtcp_put32(rrtr + 4, (uint32_t)(ntp_now >> 32));
+        rtcp_put32(rrtr + 8, (uint32_t)ntp_now);
+        off += xr_size;
+    }
+
+    if (bye) {
+        p = buffer + off;
+        hdr = (rtcp_header_t *)p;
+        hdr->vprc   = (uint8_t)((RTCP_VERSION_NUM << 6) | 0x01);
+        hdr->pt     = RTCP_BYE;
+        hdr->length = htons(1);
+        rtcp_put32(p + sizeof(rtcp_header_t), local_ssrc);
+        off += bye_size;
+    }
+
+    *packet_size = off;
+    return ESP_OK;
+}
+
+// Local SSRC used in RR/SDES/BYE
+uint32_t rtcp_get_local_ssrc(void) {
+    return rtcp_state.local_ssrc;
+}
+
 // Update RTP statistics for a source
 void rtcp_update_rtp_stats(uint32_t ssrc, uint16_t seq_num) {
     if (!rtcp_state.initialized) {
@@ -808,13 +1420,7 @@ void rtcp_update_rtp_stats(uint32_t ssrc, uint16_t seq_num) {
     
     xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
     
-    rtcp_sync_info_t *sync_info = NULL;
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            sync_info = &rtcp_state.sync_info[i];
-            break;
-        }
-    }
+    rtcp_sync_info_t *sync_info = rtcp_find_sync_locked(ssrc);
     
     if (sync_info) {
         sync_info->packet_count++;
@@ -845,7 +1451,7 @@ void rtcp_update_rx_stats(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, uint32_t
 
     uint64_t now_mono = esp_timer_get_time();
     static uint32_t rx_evict_decim = 0;
-    if (rtcp_state.active_sources >= RTCP_MAX_SSRC_SOURCES || ((++rx_evict_decim & 0xFFu) == 0)) {
+    if ((++rx_evict_decim & 0xFFu) == 0) {
         rtcp_evict_stale_locked(now_mono);
     }
 
@@ -867,6 +1473,9 @@ void rtcp_update_rx_stats(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, uint32_t
         sync->cycles         = 0;
         sync->ext_max_seq    = (uint32_t)seq;
         sync->seq_initialized = true;
+        sync->last_rtp32     = rtp_ts;
+        sync->xr.begin_ext_seq = (uint32_t)seq;
+        rtcp_xr_received(&sync->xr);
     } else {
         uint16_t max16   = (uint16_t)sync->max_seq;
         uint16_t udelta  = (uint16_t)(seq - max16); // modulo-16bit difference
@@ -884,6 +1493,13 @@ void rtcp_update_rx_stats(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, uint32_t
             }
             sync->max_seq = (uint32_t)seq;
             sync->ext_max_seq = (sync->cycles | (uint32_t)((uint16_t)sync->max_seq));
+            if (udelta > 1u) {
+                rtcp_xr_lost(&sync->xr, (uint32_t)udelta - 1u);
+            }
+            if (udelta > 0u) {
+                rtcp_xr_received(&sync->xr);
+                sync->last_rtp32 = rtp_ts;
+            }
         }
         // Else: very large backward jump; ignore for ext_max_seq update
     }
@@ -897,23 +1513,29 @@ void rtcp_update_rx_stats(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, uint32_t
 
     // Interarrival jitter (RFC 3550 A.8) - in RTP tick units
     int32_t transit = (int32_t)((int64_t)arrival_rtp_ticks - (int64_t)rtp_ts);
-    if (sync->received_pkts > 1) {
+    if (sync->received_pkts > 1 && !sync->transit_stale) {
         int32_t d = transit - (int32_t)sync->transit_prev;
         if (d < 0) d = -d;
-        // J = J + (|D(i-1,i)| - J) / 16
-        sync->jitter_ts += ((double)d - sync->jitter_ts) / 16.0;
+        // J = J + (|D(i-1,i)| - J) / 16, with J kept scaled by 16 (RFC 3550 A.8);
+        // |D| is capped so the scaled value can't overflow on garbage timestamps
+        uint32_t ad = ((uint32_t)d > (UINT32_MAX >> 5)) ? (UINT32_MAX >> 5) : (uint32_t)d;
+        sync->jitter_q4 += ad - ((sync->jitter_q4 + 8u) >> 4);
+        rtcp_xr_jitter(&sync->xr, ad);
+        metrics_histogram_observe(&interarrival_hist,
+                                  (uint32_t)(((uint64_t)ad * 1000000u) / rtcp_clock_rate));
     }
     sync->transit_prev = (uint32_t)transit;
+    sync->transit_stale = false;
 
 #ifdef CONFIG_RTCP_LOG_RX_STATS
     if (wrapped) {
         ESP_LOGI(TAG, "SSRC 0x%08X seq wrap: cycles=0x%08X ext_max_seq=0x%08X", ssrc, sync->cycles, sync->ext_max_seq);
     }
     if (large_jump) {
-        ESP_LOGW(TAG, "SSRC 0x%08X large seq jump: max_seq=%u -> %u", ssrc, (uint16_t)(sync->max_seq), seq);
+        LOG_RATE_W(TAG, "SSRC 0x%08X large seq jump: max_seq=%u -> %u", ssrc, (uint16_t)(sync->max_seq), seq);
     }
-    if (sync->jitter_ts > (double)RX_JITTER_WARN_TICKS) {
-        ESP_LOGW(TAG, "SSRC 0x%08X high jitter: J=%.2f ticks (thr=%u)", ssrc, sync->jitter_ts, (unsigned)RX_JITTER_WARN_TICKS);
+    if ((sync->jitter_q4 >> 4) > RX_JITTER_WARN_TICKS) {
+        LOG_RATE_W(TAG, "SSRC 0x%08X high jitter: J=%u ticks (thr=%u)", ssrc, (unsigned)(sync->jitter_q4 >> 4), (unsigned)RX_JITTER_WARN_TICKS);
     }
 #endif
 
@@ -922,7 +1544,7 @@ void rtcp_update_rx_stats(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, uint32_t
 }
 
 // Accessors for RX stats snapshot (for RR generation later)
-bool rtcp_get_rx_stats(uint32_t ssrc, uint32_t *ext_max_seq, int32_t *cumulative_lost, double *jitter_ts) {
+bool rtcp_get_rx_stats(uint32_t ssrc, uint32_t *ext_max_seq, int32_t *cumulative_lost, uint32_t *jitter_ts) {
     if (!rtcp_state.initialized) {
         return false;
     }
@@ -930,15 +1552,12 @@ bool rtcp_get_rx_stats(uint32_t ssrc, uint32_t *ext_max_seq, int32_t *cumulative
     bool found = false;
 
     xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            rtcp_sync_info_t *sync = &rtcp_state.sync_info[i];
-            if (ext_max_seq)      *ext_max_seq = sync->ext_max_seq;
-            if (cumulative_lost)  *cumulative_lost = sync->cumulative_lost;
-            if (jitter_ts)        *jitter_ts = sync->jitter_ts;
-            found = true;
-            break;
-        }
+    rtcp_sync_info_t *sync = rtcp_find_sync_locked(ssrc);
+    if (sync) {
+        if (ext_max_seq)      *ext_max_seq = sync->ext_max_seq;
+        if (cumulative_lost)  *cumulative_lost = sync->cumulative_lost;
+        if (jitter_ts)        *jitter_ts = sync->jitter_q4 >> 4;
+        found = true;
     }
     xSemaphoreGive(rtcp_mutex);
 
@@ -950,14 +1569,11 @@ rtcp_sync_info_t* rtcp_get_sync_info(uint32_t ssrc) {
     if (!rtcp_state.initialized) {
         return NULL;
     }
-    
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            return &rtcp_state.sync_info[i];
-        }
-    }
-    
-    return NULL;
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    rtcp_sync_info_t *sync = rtcp_find_sync_locked(ssrc);
+    xSemaphoreGive(rtcp_mutex);
+    return sync;
 }
 
 // Check if RTCP timing is available for a source
@@ -968,15 +1584,8 @@ bool rtcp_has_timing_info(uint32_t ssrc) {
     
     xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
     
-    bool has_timing = false;
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && 
-            rtcp_state.sync_info[i].ssrc == ssrc &&
-            rtcp_state.sync_info[i].rtp_timestamp != 0) {
-            has_timing = true;
-            break;
-        }
-    }
+    rtcp_sync_info_t *sync = rtcp_find_sync_locked(ssrc);
+    bool has_timing = (sync && sync->rtp_timestamp != 0);
     
     xSemaphoreGive(rtcp_mutex);
     return has_timing;
@@ -1087,10 +1696,11 @@ esp_err_t rtcp_unwrap_rtp_timestamp(uint32_t ssrc, uint32_t rtp32, uint64_t *rtp
        candidate64 = last64; // clamp; do not regress timeline
    }
 
-   // Update stored last seen values; never decrease unwrap_last64
-   sync->unwrap_last32 = rtp32;
+   // Advance the newest timestamp seen; a late packet leaves it alone, or the next
+   // in-order one after a reorder across the wrap would count the wrap again
    if (candidate64 > sync->unwrap_last64) {
        sync->unwrap_last64 = candidate64;
+       sync->unwrap_last32 = rtp32;
    }
 
    *rtp64_out = candidate64;
@@ -1098,12 +1708,81 @@ esp_err_t rtcp_unwrap_rtp_timestamp(uint32_t ssrc, uint32_t rtp32, uint64_t *rtp
    return ESP_OK;
 }
 
+#ifdef CONFIG_RTCP_BENCHMARK
+#define RTCP_BENCH_SSRC   0xB0B0B0B0u
+#define RTCP_BENCH_ITERS  2000
+
+// The double-precision RTP->us mapping this file used before the fixed-point rewrite, kept
+// only as the benchmark's baseline
+static int64_t __attribute__((noinline)) rtcp_bench_map_double(int32_t ticks) {
+    const double a0 = 1000000.0 / (double)rtcp_clock_rate;
+    return (int64_t)((double)ticks * a0);
+}
+
+static int64_t __attribute__((noinline)) rtcp_bench_map_fixed(int32_t ticks) {
+    return rtcp_ticks_to_us(ticks, rtcp_a0_q32);
+}
+
+// Cycles per rtcp_calculate_playout_time() on a synthetic fresh source, plus the mapping
+// arithmetic alone in fixed point and in double; full - fixed + double is the old cost
+static void rtcp_benchmark_playout(void) {
+    uint64_t mono_now = esp_timer_get_time();
+    uint64_t ntp_now = (uint64_t)clock_service_mono_to_master((int64_t)mono_now);
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    rtcp_sync_info_t *s = find_or_allocate_sync_info(RTCP_BENCH_SSRC);
+    if (s) {
+        rtcp_reseed_mapping_locked(s, 0, true);
+        s->last_sr_rtp32 = 0;
+        s->rtp_sr_base64 = 1;
+        s->mono_sr_base_us = mono_now;
+        s->ntp_sr_base_us = ntp_now;
+        s->sender_to_master_us = 0;
+    }
+    rtcp_publish_maps_locked();
+    xSemaphoreGive(rtcp_mutex);
+    if (!s) {
+        return;
+    }
+
+    // RTP timestamps within the outlier window so every call takes the full path
+    const int32_t step = (int32_t)(rtcp_clock_rate / 1000);
+    uint64_t out = 0;
+    uint32_t t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < RTCP_BENCH_ITERS; i++) {
+        rtcp_calculate_playout_time(RTCP_BENCH_SSRC, (uint32_t)((i & 63) * step), &out);
+    }
+    uint32_t full = (esp_cpu_get_cycle_count() - t0) / RTCP_BENCH_ITERS;
+
+    volatile int64_t sink = 0;
+    t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < RTCP_BENCH_ITERS; i++) {
+        sink = rtcp_bench_map_fixed((i & 63) * step - 32 * step);
+    }
+    uint32_t fixed = (esp_cpu_get_cycle_count() - t0) / RTCP_BENCH_ITERS;
+    t0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < RTCP_BENCH_ITERS; i++) {
+        sink = rtcp_bench_map_double((i & 63) * step - 32 * step);
+    }
+    uint32_t dbl = (esp_cpu_get_cycle_count() - t0) / RTCP_BENCH_ITERS;
+    (void)sink;
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    rtcp_release_locked((int)(s - rtcp_state.sync_info));
+    xSemaphoreGive(rtcp_mutex);
+
+    ESP_LOGI(TAG, "Playout benchmark: %u cycles/call (mapping: fixed-point %u, double %u cycles)",
+             (unsigned)full, (unsigned)fixed, (unsigned)dbl);
+    metrics_bench_check("rtcp_playout", full);
+}
+#endif
+
 // Cleanup RTCP receiver
 void rtcp_deinit(void) {
     if (rtcp_mutex) {
         xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
         rtcp_state.initialized = false;
-        memset(&rtcp_state, 0, sizeof(rtcp_state));
+        rtcp_reset_tables_locked();
         xSemaphoreGive(rtcp_mutex);
         
         vSemaphoreDelete(rtcp_mutex);
@@ -1118,20 +1797,13 @@ bool rtcp_is_sync_fresh(uint32_t ssrc) {
         return false;
     }
 
-    uint64_t rtp_sr_base64 = 0;
-    uint64_t ntp_sr_base_us = 0;
-    uint64_t mono_sr_base_us = 0;
-
-    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            rtp_sr_base64 = rtcp_state.sync_info[i].rtp_sr_base64;
-            ntp_sr_base_us = rtcp_state.sync_info[i].ntp_sr_base_us;
-            mono_sr_base_us = rtcp_state.sync_info[i].mono_sr_base_us;
-            break;
-        }
+    rtcp_map_t map;
+    if (!rtcp_read_map(ssrc, &map)) {
+        return false;
     }
-    xSemaphoreGive(rtcp_mutex);
+    uint64_t rtp_sr_base64 = map.rtp_sr_base64;
+    uint64_t ntp_sr_base_us = map.ntp_sr_base_us;
+    uint64_t mono_sr_base_us = map.mono_sr_base_us;
 
     bool seeded = (rtp_sr_base64 != 0 && ntp_sr_base_us != 0 && mono_sr_base_us != 0);
     if (!seeded) {
@@ -1145,36 +1817,8 @@ bool rtcp_is_sync_fresh(uint32_t ssrc) {
     return sr_age_us <= max_age_us;
 }
 
-/**
- * @brief Observe buffer error and gently adjust RTCP mapping (offset b and slope a).
- * Applies a low-rate control loop (PLL) to keep effective buffer delay near a nominal target.
- *
- * Preconditions:
- *  - RTCP mapping must be seeded and fresh (rtcp_is_sync_fresh)
- *  - Holds rtcp_mutex only for minimal state updates
- */
-void rtcp_pll_observe(uint32_t ssrc, int64_t error_us, uint32_t sample_window_us) {
-    if (!rtcp_state.initialized) {
-        return;
-    }
-
-    // Freshness/seed gate (avoid deadlock by checking outside of the RTCP mutex)
-    if (!rtcp_is_sync_fresh(ssrc)) {
-        return;
-    }
-
-    const double Kb = (double)CONFIG_RTCP_PLL_KB;
-    const double Ki = (double)CONFIG_RTCP_PLL_KI;
-    const double Ka = (double)CONFIG_RTCP_PLL_KA;
-    const uint64_t apply_interval_us = (uint64_t)CONFIG_RTCP_PLL_APPLY_INTERVAL_MS * 1000ULL;
-    const double a0 = 1000000.0 / (double)CONFIG_SAMPLE_RATE; // nominal us/tick
-    const double ppm_limit = (double)CONFIG_RTCP_PLL_SLOPE_PPM_LIMIT;
-    const double offset_step_limit_us = (double)CONFIG_RTCP_PLL_OFFSET_STEP_LIMIT_US;
-
-    uint64_t now = esp_timer_get_time();
-    uint32_t window_us = (sample_window_us == 0u) ? 1u : sample_window_us;
-
-    // Skip implausible observations relative to the sample window
+// True when an observation is implausibly far off for its sample window
+static bool rtcp_pll_is_outlier(int64_t error_us, uint32_t window_us) {
     int64_t abs_err = (error_us < 0) ? -error_us : error_us;
     int64_t outlier_thr = (int64_t)((uint64_t)CONFIG_RTCP_PLL_OBS_OUTLIER_FACTOR * (uint64_t)window_us);
     if (abs_err > outlier_thr) {
@@ -1185,39 +1829,27 @@ void rtcp_pll_observe(uint32_t ssrc, int64_t error_us, uint32_t sample_window_us
                      (long long)abs_err, (unsigned)window_us, (long long)outlier_thr);
         }
 #endif
-        return;
+        return true;
     }
+    return false;
+}
+
+/**
+ * @brief One PLL step on a source's mapping: integrate the error and, at most once per
+ * apply interval, move offset b and slope a. The caller holds rtcp_mutex (or owns `sync`)
+ * and publishes the map when this returns true.
+ */
+static bool rtcp_pll_step_locked(rtcp_sync_info_t *sync, int64_t error_us, uint32_t window_us, uint64_t now) {
+    const uint64_t apply_interval_us = (uint64_t)CONFIG_RTCP_PLL_APPLY_INTERVAL_MS * 1000ULL;
+    const int64_t slope_span_q32 = (rtcp_a0_q32 * (int64_t)CONFIG_RTCP_PLL_SLOPE_PPM_LIMIT) / 1000000LL;
+    const int64_t offset_step_limit_q32 = (int64_t)CONFIG_RTCP_PLL_OFFSET_STEP_LIMIT_US * RTCP_Q32_ONE;
 
     // Clamp error contribution into the integrator to avoid wind-up on outliers
-    double target_us = (double)window_us;
-    double err_d = (double)error_us;
-    double err_clamped = err_d;
-    double i_clamp = 4.0 * target_us;
+    int64_t err_clamped = error_us;
+    int64_t i_clamp = 4 * (int64_t)window_us;
     if (err_clamped > i_clamp) err_clamped = i_clamp;
     if (err_clamped < -i_clamp) err_clamped = -i_clamp;
 
-    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
-
-    // Locate SSRC entry
-    rtcp_sync_info_t *sync = NULL;
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == ssrc) {
-            sync = &rtcp_state.sync_info[i];
-            break;
-        }
-    }
-    if (!sync) {
-        xSemaphoreGive(rtcp_mutex);
-        return;
-    }
-
-    // Ensure seeded under lock as well
-    bool seeded = (sync->rtp_sr_base64 != 0 && sync->ntp_sr_base_us != 0 && sync->mono_sr_base_us != 0);
-    if (!seeded) {
-        xSemaphoreGive(rtcp_mutex);
-        return;
-    }
-
     // Update integral term on every observation
     sync->pll_i_err += err_clamped;
 
@@ -1225,64 +1857,197 @@ void rtcp_pll_observe(uint32_t ssrc, int64_t error_us, uint32_t sample_window_us
     if (sync->pll_last_apply_mono != 0) {
         uint64_t elapsed = (now >= sync->pll_last_apply_mono) ? (now - sync->pll_last_apply_mono) : 0ULL;
         if (elapsed < apply_interval_us) {
-            xSemaphoreGive(rtcp_mutex);
-            return;
+            return false;
         }
     }
 
-    // Compute offset (b) correction
-    double window_sec = ((double)window_us) / 1000000.0;
-    double delta_b = (Kb * err_d) + (Ki * (sync->pll_i_err * window_sec));
+    // Compute offset (b) correction, Q32.32 us: Kb * err + Ki * (i_err * window_s).
+    // i_err * window is split around 1e6 so the Ki product stays in 64 bits.
+    int64_t iw = sync->pll_i_err * (int64_t)window_us;
+    int64_t delta_b_q32 = RTCP_PLL_KB_Q32 * error_us +
+                          (iw / 1000000LL) * RTCP_PLL_KI_Q32 +
+                          ((iw % 1000000LL) * RTCP_PLL_KI_Q32) / 1000000LL;
 
     // Bound per-apply offset change to avoid audible steps
-    if (delta_b > offset_step_limit_us) delta_b = offset_step_limit_us;
-    if (delta_b < -offset_step_limit_us) delta_b = -offset_step_limit_us;
-
-    // Compute slope (a) correction in ppm and apply multiplicatively
-    double delta_ppm = Ka * (err_d / (double)window_us) * 1.0e6;
+    if (delta_b_q32 > offset_step_limit_q32) delta_b_q32 = offset_step_limit_q32;
+    if (delta_b_q32 < -offset_step_limit_q32) delta_b_q32 = -offset_step_limit_q32;
 
-    double cur_a = sync->slope_a_us_per_tick;
-    if (!(cur_a > 0.0) || !isfinite(cur_a)) {
-        cur_a = a0;
+    // Slope (a) correction, applied multiplicatively: a *= 1 + Ka * err / window
+    int64_t cur_a = sync->slope_a_q32;
+    if (cur_a <= 0) {
+        cur_a = rtcp_a0_q32;
     }
-    double new_a = cur_a * (1.0 + (delta_ppm / 1.0e6));
+    int64_t a_err = (cur_a * error_us) / (int64_t)window_us;
+    int64_t new_a = cur_a + ((a_err * RTCP_PLL_KA_Q48 + (1LL << 47)) >> 48);
 
     // Hard clamp overall slope around nominal to +/- ppm_limit
-    double min_a = a0 * (1.0 - ppm_limit / 1.0e6);
-    double max_a = a0 * (1.0 + ppm_limit / 1.0e6);
+    int64_t min_a = rtcp_a0_q32 - slope_span_q32;
+    int64_t max_a = rtcp_a0_q32 + slope_span_q32;
     if (new_a < min_a) new_a = min_a;
     if (new_a > max_a) new_a = max_a;
 
-    // Apply updates
-    sync->offset_b_mono_us += (int64_t)delta_b;
-    sync->pll_offset_b_us  += delta_b;
+    // Apply updates (whole microseconds, truncated toward zero)
+    int64_t delta_b_us = delta_b_q32 / RTCP_Q32_ONE;
+    sync->offset_b_mono_us += delta_b_us;
+    sync->pll_offset_b_us  += delta_b_us;
 
-    sync->slope_a_us_per_tick = new_a;
-    sync->pll_slope_a_correction = (new_a / a0) - 1.0; // fractional multiplier minus 1
+    sync->slope_a_q32 = new_a;
+    sync->pll_slope_ppb = rtcp_slope_ppb(new_a);
 
     sync->pll_last_apply_mono = now;
     sync->pll_obs_count++;
 
-    // Track last delta_b applied in int32 range for diagnostics
-    double db = delta_b;
-    if (db > 2147483647.0) db = 2147483647.0;
-    if (db < -2147483648.0) db = -2147483648.0;
-    sync->pll_last_delta_b_us = (int32_t)(db);
+    // Last delta_b applied, for diagnostics (bounded by the step limit)
+    sync->pll_last_delta_b_us = (int32_t)delta_b_us;
 
 #ifdef CONFIG_RTCP_LOG_PLL
-    double total_ppm = ((sync->slope_a_us_per_tick / a0) - 1.0) * 1.0e6;
-    ESP_LOGI(TAG, "PLL: ssrc=0x%08X err=%lldus db=%0.1fus dppm=%+0.2f a=%0.6fus/tick b=%lldus",
-             ssrc,
+    ESP_LOGI(TAG, "PLL: ssrc=0x%08X err=%lldus db=%lldus a=%+ldppb b=%lldus",
+             sync->ssrc,
              (long long)error_us,
-             delta_b,
-             total_ppm,
-             sync->slope_a_us_per_tick,
+             (long long)delta_b_us,
+             (long)sync->pll_slope_ppb,
              (long long)sync->offset_b_mono_us);
 #endif
+    return true;
+}
+
+/**
+ * @brief Observe buffer error and gently adjust RTCP mapping (offset b and slope a).
+ * Applies a low-rate control loop (PLL) to keep effective buffer delay near a nominal target.
+ *
+ * Preconditions:
+ *  - RTCP mapping must be seeded and fresh (rtcp_is_sync_fresh)
+ *  - Holds rtcp_mutex only for minimal state updates
+ */
+void rtcp_pll_observe(uint32_t ssrc, int64_t error_us, uint32_t sample_window_us) {
+    if (!rtcp_state.initialized) {
+        return;
+    }
 
+    // Freshness/seed gate (avoid deadlock by checking outside of the RTCP mutex)
+    if (!rtcp_is_sync_fresh(ssrc)) {
+        return;
+    }
+
+    uint64_t now = esp_timer_get_time();
+    uint32_t window_us = (sample_window_us == 0u) ? 1u : sample_window_us;
+
+    // Skip implausible observations relative to the sample window
+    if (rtcp_pll_is_outlier(error_us, window_us)) {
+        return;
+    }
+
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+
+    // Locate SSRC entry
+    rtcp_sync_info_t *sync = rtcp_find_sync_locked(ssrc);
+    if (!sync) {
+        xSemaphoreGive(rtcp_mutex);
+        return;
+    }
+
+    // Ensure seeded under lock as well
+    bool seeded = (sync->rtp_sr_base64 != 0 && sync->ntp_sr_base_us != 0 && sync->mono_sr_base_us != 0);
+    if (seeded && rtcp_pll_step_locked(sync, error_us, window_us, now)) {
+        int32_t step_us = sync->pll_last_delta_b_us;
+        event_trace_add(EVENT_TRACE_PLL, 0, event_trace_u16(step_us < 0 ? -(int64_t)step_us : step_us),
+                        error_us > INT32_MAX ? INT32_MAX : error_us < INT32_MIN ? INT32_MIN : (int32_t)error_us);
+        rtcp_publish_map_locked((int)(sync - rtcp_state.sync_info));
+    }
     xSemaphoreGive(rtcp_mutex);
 }
 
+#ifdef CONFIG_RTCP_BENCHMARK
+#define RTCP_BENCH_PLL_WINDOW_US  4000      // One 4 ms packet per observation
+#define RTCP_BENCH_PLL_SECONDS    60
+#define RTCP_BENCH_PLL_JITTER_US  500
+#define RTCP_BENCH_PLL_SETTLED_US (RTCP_BENCH_PLL_JITTER_US + 250)
+
+typedef struct {
+    uint32_t settle_ms;     // Last time |error| was outside the settled band
+    uint32_t residual_us;   // Mean |error| over the final second
+    int32_t  slope_ppb;
+    uint32_t step_cycles;
+} rtcp_bench_pll_result_t;
+
+// Steps the PLL control law in simulated time against a source whose clock runs drift_ppm
+// off ours, on a private sync entry (no lock, nothing published). Each packet the loop sees
+// what its corrections leave of the drift, error = drift*t - b - slope_dev*t, plus uniform
+// jitter from a fixed seed so runs are comparable.
+static void rtcp_bench_pll_run(int32_t drift_ppm, rtcp_bench_pll_result_t *r) {
+    static rtcp_sync_info_t sync;   // Too large for the caller's stack
+    memset(&sync, 0, sizeof(sync));
+    sync.ssrc = RTCP_BENCH_SSRC;
+    sync.valid = true;
+    sync.slope_a_q32 = rtcp_a0_q32;
+    const uint32_t steps = RTCP_BENCH_PLL_SECONDS * (1000000u / RTCP_BENCH_PLL_WINDOW_US);
+    const uint32_t tail = 1000000u / RTCP_BENCH_PLL_WINDOW_US;
+    uint32_t x = 0x2545F491u;
+    uint64_t abs_sum = 0;
+    uint64_t last_out = 0;
+    uint32_t cycles = 0;
+
+    for (uint32_t i = 1; i <= steps; i++) {
+        uint64_t t = (uint64_t)i * RTCP_BENCH_PLL_WINDOW_US;
+        x = x * 1664525u + 1013904223u;
+        int64_t jitter = (int64_t)((x >> 8) % (2u * RTCP_BENCH_PLL_JITTER_US + 1u)) - RTCP_BENCH_PLL_JITTER_US;
+        int64_t err = (int64_t)drift_ppm * (int64_t)t / 1000000LL - sync.pll_offset_b_us -
+                      (int64_t)sync.pll_slope_ppb * (int64_t)t / 1000000000LL + jitter;
+
+        if (!rtcp_pll_is_outlier(err, RTCP_BENCH_PLL_WINDOW_US)) {
+            uint32_t t0 = esp_cpu_get_cycle_count();
+            rtcp_pll_step_locked(&sync, err, RTCP_BENCH_PLL_WINDOW_US, t);
+            cycles += esp_cpu_get_cycle_count() - t0;
+        }
+
+        int64_t abs_err = (err < 0) ? -err : err;
+        if (abs_err > RTCP_BENCH_PLL_SETTLED_US) {
+            last_out = t;
+        }
+        if (i > steps - tail) {
+            abs_sum += (uint64_t)abs_err;
+        }
+    }
+
+    r->settle_ms = (uint32_t)(last_out / 1000u);
+    r->residual_us = (uint32_t)(abs_sum / tail);
+    r->slope_ppb = sync.pll_slope_ppb;
+    r->step_cycles = cycles / steps;
+}
+
+// Settling time and residual error of the PLL against a few fixed clock drifts
+static void rtcp_benchmark_pll(void) {
+    static const int32_t drifts_ppm[] = { 0, 50, -100 };
+    for (size_t i = 0; i < sizeof(drifts_ppm) / sizeof(drifts_ppm[0]); i++) {
+        rtcp_bench_pll_result_t r;
+        rtcp_bench_pll_run(drifts_ppm[i], &r);
+        bool settled = r.settle_ms + 1000u < RTCP_BENCH_PLL_SECONDS * 1000u;
+        ESP_LOGI(TAG, "PLL benchmark: drift %+ld ppm %s %u ms, slope %+ldppb, residual %u us, %u cycles/obs",
+                 (long)drifts_ppm[i], settled ? "settled in" : "NOT settled after",
+                 (unsigned)r.settle_ms, (long)r.slope_ppb, (unsigned)r.residual_us, (unsigned)r.step_cycles);
+
+        char key[24];   // Room for any int; the drifts above keep it within NVS's 15 characters
+        snprintf(key, sizeof(key), "pll_settle%+d", (int)drifts_ppm[i]);
+        metrics_bench_check(key, r.settle_ms);
+    }
+}
+#endif
+
+bool rtcp_get_pll_slope_ppm(uint32_t ssrc, float *ppm_out) {
+    if (!rtcp_state.initialized || !ppm_out) {
+        return false;
+    }
+    bool ok = false;
+    xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
+    rtcp_sync_info_t *s = rtcp_find_sync_locked(ssrc);
+    if (s && s->pll_obs_count > 0) {
+        *ppm_out = (float)s->pll_slope_ppb / 1000.0f;
+        ok = true;
+    }
+    xSemaphoreGive(rtcp_mutex);
+    return ok;
+}
+
 // Primary SSRC selection and control APIs (thread-safe)
 bool rtcp_get_primary_ssrc(uint32_t *ssrc_out) {
     if (!rtcp_state.initialized) {
@@ -1293,13 +2058,11 @@ bool rtcp_get_primary_ssrc(uint32_t *ssrc_out) {
     uint64_t now = esp_timer_get_time();
     // Validate current primary
     if (rtcp_state.primary_valid) {
-        for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-            if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == rtcp_state.primary_ssrc) {
-                if (ssrc_out) *ssrc_out = rtcp_state.primary_ssrc;
-                ok = true;
-                xSemaphoreGive(rtcp_mutex);
-                return ok;
-            }
+        if (rtcp_find_locked(rtcp_state.primary_ssrc) >= 0) {
+            if (ssrc_out) *ssrc_out = rtcp_state.primary_ssrc;
+            ok = true;
+            xSemaphoreGive(rtcp_mutex);
+            return ok;
         }
         // Primary no longer valid
         rtcp_state.primary_valid = false;
@@ -1388,14 +2151,8 @@ bool rtcp_consider_primary_switch(uint32_t candidate_ssrc, uint32_t *new_primary
     }
 
     // Locate candidate and current
-    int cand_idx = -1;
-    int cur_idx = -1;
-    for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-        if (rtcp_state.sync_info[i].valid) {
-            if (rtcp_state.sync_info[i].ssrc == candidate_ssrc) cand_idx = i;
-            if (rtcp_state.primary_valid && rtcp_state.sync_info[i].ssrc == rtcp_state.primary_ssrc) cur_idx = i;
-        }
-    }
+    int cand_idx = rtcp_find_locked(candidate_ssrc);
+    int cur_idx = rtcp_state.primary_valid ? rtcp_find_locked(rtcp_state.primary_ssrc) : -1;
 
     if (cand_idx < 0) {
         xSemaphoreGive(rtcp_mutex);
@@ -1463,9 +2220,9 @@ static void rtcp_log_summary_if_due(void) {
 
     // Snapshot per-SSRC fields under lock (primary if valid, else most-recent valid)
     uint32_t ssrc = 0;
-    double   slope_a_us_per_tick = 0.0;
+    int64_t  slope_a_q32 = 0;
     int64_t  offset_b_mono_us = 0;
-    double   jitter_ts = 0.0;
+    uint32_t jitter_ts = 0;
     int32_t  cumulative_lost = 0;
     uint32_t rr_prev_fraction_lost = 0;
     uint64_t mono_sr_base_us = 0;
@@ -1473,18 +2230,13 @@ static void rtcp_log_summary_if_due(void) {
     uint64_t rtp_sr_base64   = 0;
     int32_t  pll_last_delta_b_us = 0;
     uint32_t pll_obs_count = 0;
-    double   pll_slope_corr = 0.0;
+    int32_t  pll_slope_ppb = 0;
     bool     have = false;
 
     xSemaphoreTake(rtcp_mutex, portMAX_DELAY);
     int idx = -1;
     if (rtcp_state.primary_valid) {
-        for (int i = 0; i < RTCP_MAX_SSRC_SOURCES; i++) {
-            if (rtcp_state.sync_info[i].valid && rtcp_state.sync_info[i].ssrc == rtcp_state.primary_ssrc) {
-                idx = i;
-                break;
-            }
-        }
+        idx = rtcp_find_locked(rtcp_state.primary_ssrc);
     }
     if (idx < 0) {
         uint64_t best_last = 0;
@@ -1501,9 +2253,9 @@ static void rtcp_log_summary_if_due(void) {
     if (idx >= 0) {
         rtcp_sync_info_t *s = &rtcp_state.sync_info[idx];
         ssrc                    = s->ssrc;
-        slope_a_us_per_tick     = s->slope_a_us_per_tick;
+        slope_a_q32             = s->slope_a_q32;
         offset_b_mono_us        = s->offset_b_mono_us;
-        jitter_ts               = s->jitter_ts;
+        jitter_ts               = s->jitter_q4 >> 4;
         cumulative_lost         = s->cumulative_lost;
         rr_prev_fraction_lost   = s->rr_prev_fraction_lost;
         mono_sr_base_us         = s->mono_sr_base_us;
@@ -1511,31 +2263,26 @@ static void rtcp_log_summary_if_due(void) {
         rtp_sr_base64           = s->rtp_sr_base64;
         pll_last_delta_b_us     = s->pll_last_delta_b_us;
         pll_obs_count           = s->pll_obs_count;
-        pll_slope_corr          = s->pll_slope_a_correction;
+        pll_slope_ppb           = s->pll_slope_ppb;
         have = true;
     }
     xSemaphoreGive(rtcp_mutex);
     if (!have) return;
 
     // Compute derived values for printing
-    const double a0 = 1000000.0 / (double)CONFIG_SAMPLE_RATE;
-    if (!(slope_a_us_per_tick > 0.0) || !isfinite(slope_a_us_per_tick)) {
-        slope_a_us_per_tick = a0;
+    if (slope_a_q32 <= 0) {
+        slope_a_q32 = rtcp_a0_q32;
     }
     uint64_t sr_age_ms = 0;
     if (mono_sr_base_us != 0 && now >= mono_sr_base_us) {
         sr_age_ms = (now - mono_sr_base_us) / 1000ULL;
     }
-    double a_ppm    = ((slope_a_us_per_tick / a0) - 1.0) * 1.0e6;
-    double pll_ppm  = (pll_slope_corr) * 1.0e6;
-    uint32_t jitter_us = 0;
-    if (jitter_ts > 0.0) {
-        double j_us = jitter_ts * slope_a_us_per_tick; // jitter in RTP ticks -> us
-        if (j_us < 0.0) j_us = 0.0;
-        if (j_us > (double)UINT32_MAX) j_us = (double)UINT32_MAX;
-        jitter_us = (uint32_t)(j_us + 0.5);
-    }
-    double b_ms = ((double)offset_b_mono_us) / 1000.0;
+    // Printing only; the FPU handles single precision
+    float a_ppm    = (float)rtcp_slope_ppb(slope_a_q32) / 1000.0f;
+    float pll_ppm  = (float)pll_slope_ppb / 1000.0f;
+    int64_t j_us = rtcp_ticks_to_us((int32_t)jitter_ts, slope_a_q32); // jitter in RTP ticks -> us
+    uint32_t jitter_us = (j_us > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)j_us;
+    float b_ms = (float)(offset_b_mono_us / 1000) + (float)(offset_b_mono_us % 1000) / 1000.0f;
 
     ESP_LOGI(TAG,
              "RTCP sum: ssrc=0x%08X sr_age=%llums a_ppm=%+0.2f b_ms=%+0.2f jitter_us=%u lost=%d frac=%u/256 pll_db_us=%d pll_ppm=%+0.2f obs=%u",
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "build_config.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,12 +15,26 @@ extern "C" {
 #define RTCP_SDES   202  // Source Description
 #define RTCP_BYE    203  // Goodbye
 #define RTCP_APP    204  // Application-defined
+#define RTCP_RTPFB  205  // Transport-layer feedback (RFC 4585)
+#define RTCP_XR     207  // Extended Report (RFC 3611)
+
+// RTPFB feedback message types (RFC 4585), carried in the count field
+#define RTCP_RTPFB_NACK       1  // Generic NACK
+
+// RTCP XR block types (RFC 3611)
+#define RTCP_XR_RRTR          4  // Receiver Reference Time
+#define RTCP_XR_DLRR          5  // Delay since Last Receiver Report
+#define RTCP_XR_STAT_SUMMARY  6  // Statistics Summary
+#define RTCP_XR_VOIP_METRICS  7  // VoIP Metrics
 
 // RTCP version (always 2 for RFC 3550)
 #define RTCP_VERSION_NUM 2
 
-// Maximum number of simultaneous SSRCs we can track
-#define RTCP_MAX_SSRC_SOURCES 4
+// Maximum number of simultaneous SSRCs we can track (the table is taken from the audio arena)
+#define RTCP_MAX_SSRC_SOURCES CONFIG_RTCP_MAX_SSRC_SOURCES
+
+// Report blocks per compound RR; with more sources, successive reports take turns
+#define RTCP_RR_MAX_BLOCKS (RTCP_MAX_SSRC_SOURCES < 8 ? RTCP_MAX_SSRC_SOURCES : 8)
 
 // RTCP header structure (common to all RTCP packets)
 typedef struct __attribute__((packed)) {
@@ -58,6 +73,23 @@ typedef struct __attribute__((packed)) {
     uint32_t dlsr;           // Delay since last SR
 } rtcp_report_block_t;
 
+// Per-source accumulators behind the XR Statistics Summary and VoIP Metrics blocks
+typedef struct {
+    // Burst/gap model with Gmin = 16 (RFC 3611 4.7.2)
+    uint32_t pkt;                     // packets received since the last loss
+    uint32_t lost;                    // losses in the current burst
+    uint32_t c11, c13, c14, c22, c23, c33;  // state transition counts
+
+    // Statistics Summary interval (reset by each XR)
+    uint32_t begin_ext_seq;           // first extended seq of the interval
+    int32_t  lost_base;               // cumulative_lost at the interval start
+    uint32_t jit_min;                 // |D(i-1,i)| extremes in RTP ticks
+    uint32_t jit_max;
+    uint32_t jit_count;
+    uint64_t jit_sum;
+    uint64_t jit_sumsq;
+} rtcp_xr_accum_t;
+
  // Synchronization info storage per SSRC
  typedef struct {
      uint32_t ssrc;                    // Source SSRC
@@ -73,15 +105,15 @@ typedef struct __attribute__((packed)) {
      uint32_t last_sr_rtp32;           // RTP timestamp from the most recent SR (32-bit) - SR anchor for NTP-anchored playout mapping
 
      // Linear RTP->time mapping (per-SSRC)
-     double   slope_a_us_per_tick;     // nominal microseconds per RTP tick (init to 1e6 / CONFIG_SAMPLE_RATE)
+     int64_t  slope_a_q32;             // microseconds per RTP tick, Q32.32 (init to 1e6 / the RTP clock rate)
      int64_t  offset_b_mono_us;        // maps sender NTP time to local monotonic: mono = ntp_us + offset_b
      uint64_t rtp_sr_base64;           // unwrapped RTP timestamp at the most recent SR
      uint64_t mono_sr_base_us;         // local monotonic time when that SR was received - SR anchor for playout mapping
      uint64_t ntp_sr_base_us;          // sender NTP time (us) carried in that SR - SR anchor for NTP-anchored playout mapping
  
-     // NTP-anchored playout mapping offsets (computed at each SR)
-     int64_t offset_ntp_to_receiver_us;    // receiver_ntp - sender_ntp (computed at last SR)
-     int64_t wall_to_mono_offset_us;       // mono_now - receiver_ntp (computed at last SR)
+     // Sender NTP -> master clock (clock_service) at the last SR
+     int64_t sender_to_master_us;      // 0 while the sender shares our master clock, else master - sender_ntp at SR arrival
+     bool    shared_clock;             // sender's SRs land on our master timeline (both NTP-locked to one server)
  
      // RTP timestamp unwrapping state (per-SSRC)
      uint32_t unwrap_last32;           // last seen RTP 32-bit value
@@ -102,9 +134,11 @@ typedef struct __attribute__((packed)) {
      uint32_t ext_max_seq;             // extended highest sequence = cycles | max_seq
      uint32_t received_pkts;           // number of packets received for this SSRC
      int32_t  cumulative_lost;         // expected - received (signed)
-     double   jitter_ts;               // interarrival jitter in RTP ticks
+     uint32_t jitter_q4;               // interarrival jitter in RTP ticks, scaled by 16 (RFC 3550 A.8)
      uint32_t transit_prev;            // previous transit (R_i - S_i) in RTP ticks
+     bool     transit_stale;           // transit_prev predates a clock rate change; next packet restarts it
      bool     seq_initialized;         // flag for init edge cases
+     uint32_t last_rtp32;              // RTP timestamp of the newest packet (in sequence order)
 
      // RR interval bookkeeping (for fraction-lost over last interval)
      uint32_t rr_prev_expected;        // previous "expected" at last RR
@@ -116,9 +150,9 @@ typedef struct __attribute__((packed)) {
      uint32_t last_sr_ntp_frac;        // last SR NTP fraction (host order)
 
      // PLL accumulators (receiver-side control to stabilize playout latency)
-     double   pll_offset_b_us;        // shadow of mapping offset accumulator (us)
-     double   pll_slope_a_correction; // multiplicative correction on slope; 0.0 => 1.0 multiplier
-     double   pll_i_err;              // integral term accumulator (us)
+     int64_t  pll_offset_b_us;        // shadow of mapping offset accumulator (us)
+     int32_t  pll_slope_ppb;          // slope correction vs nominal (parts per billion); 0 => 1.0 multiplier
+     int64_t  pll_i_err;              // integral term accumulator (us)
      uint32_t pll_obs_count;          // observations since last apply
      uint64_t pll_last_apply_mono;    // last apply time (esp_timer monotonic us)
      int32_t  pll_last_delta_b_us;    // last applied offset step (us) for diagnostics
@@ -128,22 +162,25 @@ typedef struct __attribute__((packed)) {
      uint64_t last_activity_mono_us;  // updated on SR receipt and RTP packet observe
      bool     preferred_pin;          // user/system pin to prevent eviction (default false)
 
-     // Stable NTP→monotonic baseline for multi-speaker sync (established at RTCP lock)
-     uint64_t ntp_to_mono_baseline_ntp_us;   // Receiver NTP time at baseline establishment
-     uint64_t ntp_to_mono_baseline_mono_us;  // Receiver monotonic time at baseline establishment
-     bool     ntp_to_mono_baseline_valid;    // Whether baseline has been established
+     // RTCP XR metrics
+     rtcp_xr_accum_t xr;
  } rtcp_sync_info_t;
 
 // RTCP receiver state
 typedef struct {
-    rtcp_sync_info_t sync_info[RTCP_MAX_SSRC_SOURCES];
+    rtcp_sync_info_t *sync_info;      // RTCP_MAX_SSRC_SOURCES entries (rtcp_alloc_tables)
     uint32_t active_sources;          // Number of active sources
+    uint32_t rr_cursor;               // Entry the next RR starts its report blocks at
     uint64_t last_rr_sent;            // Time when last RR was sent
+    uint32_t local_ssrc;              // Our SSRC in RR/SDES/BYE (random per init)
     bool     initialized;             // Whether RTCP is initialized
 
     // Primary SSRC tracking (for diagnostics/policy hygiene)
     uint32_t primary_ssrc;            // Current primary SSRC selection
     bool     primary_valid;           // Whether primary_ssrc is valid
+
+    // Round trip from XR RRTR/DLRR (0 until the sender answers an RRTR)
+    uint32_t rtt_q16;                 // Last round trip in 1/65536 s
 } rtcp_state_t;
 
 // Helper macros for parsing RTCP header fields
@@ -158,6 +195,15 @@ typedef struct {
 
 // RTCP receiver API functions
 
+/**
+ * @brief Take the per-source tables from the audio arena
+ *
+ * Called once at boot, before any receiver mode places its buffers; the tables
+ * are kept for good. rtcp_init() calls it if boot did not.
+ * @return ESP_OK, or ESP_ERR_NO_MEM
+ */
+esp_err_t rtcp_alloc_tables(void);
+
 /**
  * @brief Initialize RTCP receiver
  * @return ESP_OK on success
@@ -173,7 +219,7 @@ esp_err_t rtcp_init(void);
 esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len);
 
 /**
- * @brief Calculate playout time for an RTP packet
+ * @brief Calculate playout time for an RTP packet (lock-free; reads the published mapping)
  * @param ssrc SSRC of the RTP packet
  * @param rtp_timestamp RTP timestamp from the packet
  * @param playout_time Output: calculated playout time in microseconds (esp_timer reference)
@@ -181,6 +227,22 @@ esp_err_t rtcp_parse_packet(const uint8_t *packet, size_t len);
  */
 esp_err_t rtcp_calculate_playout_time(uint32_t ssrc, uint32_t rtp_timestamp, uint64_t *playout_time);
 
+/**
+ * @brief Set the delay rtcp_calculate_playout_time() adds to the sender's timeline
+ * @param ms Playout delay in milliseconds; 0 restores CONFIG_RTCP_TARGET_LATENCY_MS
+ */
+void rtcp_set_target_latency_ms(uint32_t ms);
+
+/**
+ * @brief Follow a change of the stream's RTP clock rate without dropping sync
+ *
+ * Existing mappings are re-anchored at the newest packet received and their
+ * slope scaled to the new tick length, so playout times stay continuous and
+ * the PLL keeps its drift estimate. Kept across rtcp_init().
+ * @param rate RTP clock rate in Hz (the stream's sample rate)
+ */
+void rtcp_set_clock_rate(uint32_t rate);
+
 /**
  * @brief Generate RTCP Receiver Report (RR) with a single report block for the specified sender SSRC.
  * Builds RFC 3550-compliant RR fields: fraction lost (interval), cumulative lost, extended highest seq,
@@ -194,6 +256,41 @@ esp_err_t rtcp_calculate_playout_time(uint32_t ssrc, uint32_t rtp_timestamp, uin
  */
 esp_err_t rtcp_generate_rr(uint32_t report_ssrc, uint8_t *buffer, size_t buffer_size, size_t *packet_size);
 
+// Playout side of the XR VoIP Metrics block, supplied by the caller (jitter buffer state)
+typedef struct {
+    uint16_t jb_nominal_ms;           // Target buffer depth
+    uint16_t jb_max_ms;               // Deepest the latency controller may grow the target
+    uint16_t jb_abs_max_ms;           // Ring capacity
+    uint16_t end_system_delay_ms;     // Audio currently buffered ahead of the output
+    uint32_t discarded;               // Packets dropped late or as duplicates by the buffer
+    uint32_t packet_us;               // Audio per packet, for burst/gap durations
+    uint8_t  plc;                     // RFC 3611 PLC code: 0 unspecified, 1 disabled, 2 enhanced, 3 standard
+    bool     adaptive;                // Jitter buffer adapts its target
+} rtcp_xr_playout_t;
+
+/**
+ * @brief Generate a compound RTCP packet: RR + SDES(CNAME) [+ XR] [+ BYE].
+ * The RR carries one report block per tracked source with sequence state (up to
+ * RTCP_RR_MAX_BLOCKS, or what fits the buffer), or none: the primary source first, the
+ * rest in turn across reports. Each reported source starts a new RR interval.
+ *
+ * @param buffer      Output buffer (network byte order).
+ * @param buffer_size Size of the output buffer in bytes.
+ * @param cname       CNAME text for the SDES chunk (truncated to 255 bytes); NULL for empty.
+ * @param xr          Append an XR with RRTR, a Statistics Summary per reported source and
+ *                    VoIP Metrics for the primary source; NULL for none.
+ * @param bye         Append a BYE for the local SSRC.
+ * @param packet_size Output: exact number of bytes written into buffer.
+ * @return ESP_OK on success; ESP_ERR_INVALID_SIZE if not even the empty packet fits.
+ */
+esp_err_t rtcp_build_report(uint8_t *buffer, size_t buffer_size, const char *cname,
+                            const rtcp_xr_playout_t *xr, bool bye, size_t *packet_size);
+
+/**
+ * @brief SSRC this receiver reports under (chosen randomly by rtcp_init)
+ */
+uint32_t rtcp_get_local_ssrc(void);
+
 /**
  * @brief Update RTP statistics for a source
  * @param ssrc Source SSRC
@@ -212,9 +309,10 @@ void rtcp_update_rx_stats(uint32_t ssrc, uint16_t seq, uint32_t rtp_ts, uint32_t
 
 /**
  * @brief Get snapshot of receiver-side stats for an SSRC.
+ * @param jitter_ts Output: interarrival jitter in RTP ticks
  * @return true if SSRC found; false otherwise
  */
-bool rtcp_get_rx_stats(uint32_t ssrc, uint32_t *ext_max_seq, int32_t *cumulative_lost, double *jitter_ts);
+bool rtcp_get_rx_stats(uint32_t ssrc, uint32_t *ext_max_seq, int32_t *cumulative_lost, uint32_t *jitter_ts);
 
 /**
  * @brief Get synchronization info for a source
@@ -233,7 +331,7 @@ bool rtcp_has_timing_info(uint32_t ssrc);
 /**
  * @brief Check if the SR-based sync mapping for the given SSRC is fresh.
  * A mapping is fresh if it has been seeded and (now_mono_us - mono_sr_base_us)
- * is less than or equal to CONFIG_RTCP_SR_MAX_AGE_MS * 1000.
+ * is less than or equal to CONFIG_RTCP_SR_MAX_AGE_MS * 1000. Lock-free.
  * @param ssrc Source SSRC
  * @return true if fresh; false otherwise
  */
@@ -255,6 +353,14 @@ esp_err_t rtcp_unwrap_rtp_timestamp(uint32_t ssrc, uint32_t rtp32, uint64_t *rtp
  */
 void rtcp_pll_observe(uint32_t ssrc, int64_t error_us, uint32_t sample_window_us);
 
+/**
+ * @brief Sender clock drift estimated by the PLL (thread-safe)
+ * @param ssrc SSRC of the stream
+ * @param ppm_out Slope correction in ppm; positive when the sender's clock runs slow
+ * @return true if the SSRC has applied at least one PLL update
+ */
+bool rtcp_get_pll_slope_ppm(uint32_t ssrc, float *ppm_out);
+
 /**
  * @brief Primary SSRC selection and control APIs
  */
@@ -0,0 +1,416 @@
+#include "rtcp_rr.h"
+#include "rtcp_receiver.h"
+#include "buffer.h"
+#include "global.h"
+#include "build_config.h"
+#include "lifecycle/net_iface.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_netif.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "log_rate.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+
+// IPv4 + UDP header bytes counted into the average report size (RFC 3550 6.3.1)
+#define RTCP_RR_IP_UDP_OVERHEAD   28
+// Compound packet buffer: RR with up to RTCP_RR_MAX_BLOCKS sources, SDES, XR (RRTR,
+// summary per source, VoIP metrics), BYE
+#define RTCP_RR_BUFFER_SIZE       (8 + 24 * RTCP_RR_MAX_BLOCKS + 8 + 4 + 32 + \
+                                   8 + 12 + 40 * RTCP_RR_MAX_BLOCKS + 36 + 8)
+// Peer packing: address << 32 | from-RTCP flag << 16 | port
+#define RTCP_RR_PEER_FROM_RTCP    (1ULL << 16)
+// Report task: builds and sends off the esp_timer task, which must not block
+#define RTCP_RR_TASK_STACK        4096
+#define RTCP_RR_NOTIFY_REPORT     (1U << 0)   // Timer fired: a report is due
+#define RTCP_RR_NOTIFY_STOP       (1U << 1)   // rtcp_rr_stop(): BYE, then signal rr_stopped
+// How long rtcp_rr_stop() waits for the BYE to leave
+#define RTCP_RR_STOP_WAIT_MS      200
+#ifdef CONFIG_RTCP_SEND_NACK
+// Missing packets followed at once; a longer gap is an outage, not something to resend
+#define RTCP_NACK_PENDING         16
+// Requests per lost packet: the first, then one repeat
+#define RTCP_NACK_TRIES           2
+// RR without blocks, SDES with a 31-byte CNAME, RTPFB with one FCI per pending packet
+#define RTCP_NACK_BUFFER_SIZE     (8 + 44 + 12 + 4 * RTCP_NACK_PENDING)
+#endif
+
+static esp_timer_handle_t rr_timer = NULL;
+static TaskHandle_t rr_task = NULL;        // Created with the timer and kept, like it
+static SemaphoreHandle_t rr_stopped = NULL;
+static rtcp_rr_send_fn_t rr_send = NULL;
+static uint32_t rr_session_bw = 0;         // Bytes per second
+static uint32_t rr_avg_size = 0;           // Average compound size incl. IP/UDP (bytes)
+static bool rr_initial = true;             // No report sent since start
+static atomic_bool rr_running = false;
+static atomic_uint_fast64_t rr_peer = 0;   // 0 until a packet has been seen
+
+#ifdef CONFIG_RTCP_SEND_NACK
+// A lost packet waiting for its retransmission (receive task only)
+typedef struct {
+    uint16_t seq;
+    uint8_t tries;      // NACKs sent for it so far
+    int64_t lost_us;    // When the gap showed it missing
+    int64_t due_us;     // When the next NACK for it is due
+} rtcp_nack_entry_t;
+
+static rtcp_nack_entry_t nack_pending[RTCP_NACK_PENDING];
+static uint8_t nack_count = 0;
+static uint32_t nack_ssrc = 0;
+static uint16_t nack_highest = 0;
+static atomic_bool nack_reset = true;      // Set by rtcp_rr_start(), taken by the receive task
+#endif
+
+static uint64_t rtcp_rr_interval_us(void) {
+    // Receivers share 75% of the RTCP bandwidth, which is 5% of the session
+    uint64_t t_us = 0;
+    if (rr_session_bw > 0) {
+        t_us = (uint64_t)rr_avg_size * 80000000ULL / (3ULL * rr_session_bw);
+    }
+    uint64_t t_min_us = (uint64_t)CONFIG_RTCP_RR_MIN_INTERVAL_MS * 1000ULL;
+    if (rr_initial) {
+        t_min_us /= 2;
+    }
+    if (t_us < t_min_us) {
+        t_us = t_min_us;
+    }
+    // Uniform in [0.5, 1.5] * T, divided by e - 3/2 to compensate for timer reconsideration
+    return t_us * (500000ULL + esp_random() % 1000001U) / 1218282ULL;
+}
+
+// "esp32-rtp@<ip>", refreshed per report since DHCP may hand out a new address
+static void rtcp_rr_cname(char *buf, size_t size) {
+    esp_netif_ip_info_t ip_info = { 0 };
+    esp_netif_t *netif = net_iface_primary();
+    if (netif) {
+        esp_netif_get_ip_info(netif, &ip_info);
+    }
+    snprintf(buf, size, "esp32-rtp@" IPSTR, IP2STR(&ip_info.ip));
+}
+
+#ifdef CONFIG_RTCP_SEND_XR
+static uint16_t rtcp_rr_chunks_ms(uint32_t chunks, uint32_t chunk_us) {
+    uint64_t ms = (uint64_t)chunks * chunk_us / 1000U;
+    return (uint16_t)(ms > 0xFFFFU ? 0xFFFFU : ms);
+}
+
+// Jitter buffer side of the XR VoIP Metrics block
+static void rtcp_rr_playout_metrics(rtcp_xr_playout_t *pl) {
+    buffer_depth_t depth = { 0 };
+    buffer_reorder_stats_t reorder = { 0 };
+    buffer_get_depth(&depth);
+    buffer_get_reorder_stats(&reorder);
+    pl->jb_nominal_ms = rtcp_rr_chunks_ms(depth.target, depth.chunk_us);
+    pl->jb_max_ms = rtcp_rr_chunks_ms(depth.max_grow, depth.chunk_us);
+    pl->jb_abs_max_ms = rtcp_rr_chunks_ms(depth.limit, depth.chunk_us);
+    pl->end_system_delay_ms = rtcp_rr_chunks_ms(depth.fill, depth.chunk_us);
+    pl->discarded = reorder.late + reorder.duplicates;
+    pl->packet_us = depth.chunk_us;
+    pl->adaptive = true;
+#if defined(CONFIG_RX_PLC_MODE_SILENCE)
+    pl->plc = 1;
+#elif defined(CONFIG_RX_PLC_MODE_WSOLA)
+    pl->plc = 2;
+#else
+    pl->plc = 3;
+#endif
+}
+#endif
+
+static void rtcp_rr_send_report(bool bye) {
+    uint64_t peer = atomic_load_explicit(&rr_peer, memory_order_relaxed);
+    if (!rr_send || peer == 0) {
+        return;
+    }
+    uint8_t packet[RTCP_RR_BUFFER_SIZE];
+    char cname[32];
+    size_t len = 0;
+    const rtcp_xr_playout_t *xr = NULL;
+#ifdef CONFIG_RTCP_SEND_XR
+    rtcp_xr_playout_t playout = { 0 };
+    rtcp_rr_playout_metrics(&playout);
+    xr = &playout;
+#endif
+    rtcp_rr_cname(cname, sizeof(cname));
+    if (rtcp_build_report(packet, sizeof(packet), cname, xr, bye, &len) != ESP_OK) {
+        return;
+    }
+
+    esp_err_t err = rr_send(packet, len, (uint32_t)(peer >> 32), (uint16_t)peer);
+    if (err != ESP_OK) {
+        LOG_RATE_W(TAG, "RTCP report send failed: %s", esp_err_to_name(err));
+        return;
+    }
+    // avg_rtcp_size = 1/16 * packet_size + 15/16 * avg_rtcp_size
+    uint32_t size = (uint32_t)len + RTCP_RR_IP_UDP_OVERHEAD;
+    rr_avg_size = rr_initial ? size : (size + 15U * rr_avg_size) / 16U;
+    rr_initial = false;
+}
+
+#ifdef CONFIG_RTCP_SEND_NACK
+// Oldest first, counting back from the highest sequence seen
+static int rtcp_nack_cmp_age(uint16_t a, uint16_t b) {
+    return (int)(uint16_t)(nack_highest - b) - (int)(uint16_t)(nack_highest - a);
+}
+
+// RR (no blocks) + SDES(CNAME) + RTPFB generic NACK (RFC 4585 6.2.1) for every due entry
+static void rtcp_nack_send_due(int64_t now_us) {
+    uint16_t due[RTCP_NACK_PENDING];
+    size_t n = 0;
+    for (uint8_t i = 0; i < nack_count; i++) {
+        rtcp_nack_entry_t *e = &nack_pending[i];
+        if (e->due_us > now_us) {
+            continue;
+        }
+        e->tries++;
+        e->due_us = now_us + (int64_t)CONFIG_RTCP_NACK_RETRY_MS * 1000;
+        // Insertion sort, oldest first, so each FCI's bitmask covers the packets after its PID
+        size_t j = n++;
+        while (j > 0 && rtcp_nack_cmp_age(e->seq, due[j - 1]) < 0) {
+            due[j] = due[j - 1];
+            j--;
+        }
+        due[j] = e->seq;
+    }
+    uint64_t peer = atomic_load_explicit(&rr_peer, memory_order_relaxed);
+    if (n == 0 || !rr_send || peer == 0) {
+        return;
+    }
+
+    uint8_t packet[RTCP_NACK_BUFFER_SIZE];
+    uint32_t local_ssrc = rtcp_get_local_ssrc();
+    char cname[32];
+    rtcp_rr_cname(cname, sizeof(cname));
+    size_t cname_len = strnlen(cname, sizeof(cname) - 1);
+
+    rtcp_rr_packet_t *rr = (rtcp_rr_packet_t *)packet;
+    rr->header.vprc = (uint8_t)(RTCP_VERSION_NUM << 6);
+    rr->header.pt = RTCP_RR;
+    rr->header.length = htons(1);
+    rr->ssrc = htonl(local_ssrc);
+    size_t len = sizeof(*rr);
+
+    // SDES chunk: SSRC, CNAME item, terminating null item, padded to 32 bits
+    size_t sdes_size = (sizeof(rtcp_header_t) + 4U + 2U + cname_len + 1U + 3U) & ~(size_t)3U;
+    uint8_t *p = packet + len;
+    memset(p, 0, sdes_size);
+    rtcp_header_t *hdr = (rtcp_header_t *)p;
+    hdr->vprc = (uint8_t)((RTCP_VERSION_NUM << 6) | 1);
+    hdr->pt = RTCP_SDES;
+    hdr->length = htons((uint16_t)(sdes_size / 4U - 1U));
+    uint32_t ssrc_be = htonl(local_ssrc);
+    memcpy(p + sizeof(rtcp_header_t), &ssrc_be, 4);
+    p[sizeof(rtcp_header_t) + 4] = 1;  // CNAME
+    p[sizeof(rtcp_header_t) + 5] = (uint8_t)cname_len;
+    memcpy(p + sizeof(rtcp_header_t) + 6, cname, cname_len);
+    len += sdes_size;
+
+    // FCI: PID plus a bitmask of the 16 packets after it
+    uint8_t *fb = packet + len;
+    uint32_t media_be = htonl(nack_ssrc);
+    memcpy(fb + 4, &ssrc_be, 4);
+    memcpy(fb + 8, &media_be, 4);
+    size_t fci = 0;
+    for (size_t i = 0; i < n; fci++) {
+        uint16_t pid = due[i++];
+        uint16_t blp = 0;
+        while (i < n && (uint16_t)(due[i] - pid) <= 16U) {
+            blp |= (uint16_t)(1U << ((uint16_t)(due[i] - pid) - 1U));
+            i++;
+        }
+        uint8_t *f = fb + 12 + 4 * fci;
+        f[0] = (uint8_t)(pid >> 8);
+        f[1] = (uint8_t)pid;
+        f[2] = (uint8_t)(blp >> 8);
+        f[3] = (uint8_t)blp;
+    }
+    size_t fb_size = 12 + 4 * fci;
+    hdr = (rtcp_header_t *)fb;
+    hdr->vprc = (uint8_t)((RTCP_VERSION_NUM << 6) | RTCP_RTPFB_NACK);
+    hdr->pt = RTCP_RTPFB;
+    hdr->length = htons((uint16_t)(fb_size / 4U - 1U));
+    len += fb_size;
+
+    esp_err_t err = rr_send(packet, len, (uint32_t)(peer >> 32), (uint16_t)peer);
+    if (err != ESP_OK) {
+        LOG_RATE_W(TAG, "RTCP NACK send failed: %s", esp_err_to_name(err));
+    }
+}
+
+static void rtcp_nack_remove(uint8_t i) {
+    nack_pending[i] = nack_pending[--nack_count];
+}
+#endif
+
+// esp_timer callback: only wakes the report task
+static void rtcp_rr_timer_cb(void *arg) {
+    (void)arg;
+    if (atomic_load(&rr_running)) {
+        xTaskNotify(rr_task, RTCP_RR_NOTIFY_REPORT, eSetBits);
+    }
+}
+
+// Owns the report state (average size, initial flag) while a session runs
+static void rtcp_rr_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        if ((bits & RTCP_RR_NOTIFY_REPORT) && atomic_load(&rr_running)) {
+            rtcp_rr_send_report(false);
+            esp_timer_start_once(rr_timer, rtcp_rr_interval_us());
+        }
+        if (bits & RTCP_RR_NOTIFY_STOP) {
+            // The timer may have been re-armed above after rtcp_rr_stop() stopped it
+            esp_timer_stop(rr_timer);
+            // A BYE is only due from a member that has sent a report (RFC 3550 6.3.7)
+            if (!rr_initial) {
+                rtcp_rr_send_report(true);
+            }
+            xSemaphoreGive(rr_stopped);
+        }
+    }
+}
+
+esp_err_t rtcp_rr_start(rtcp_rr_send_fn_t send, uint32_t session_bytes_per_sec) {
+    if (!send) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!rr_timer) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = rtcp_rr_timer_cb,
+            .name = "rtcp_rr",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &rr_timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create RTCP RR timer");
+            rr_timer = NULL;
+            return err;
+        }
+    }
+    if (!rr_task) {
+        rr_stopped = xSemaphoreCreateBinary();
+        if (!rr_stopped) {
+            return ESP_ERR_NO_MEM;
+        }
+        if (xTaskCreatePinnedToCore(rtcp_rr_task, "rtcp_rr", RTCP_RR_TASK_STACK, NULL, 4, &rr_task, 0) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create RTCP RR task");
+            vSemaphoreDelete(rr_stopped);
+            rr_stopped = NULL;
+            rr_task = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    rtcp_rr_stop();
+
+    rr_send = send;
+    rr_session_bw = session_bytes_per_sec;
+    rr_avg_size = 0;
+    rr_initial = true;
+#ifdef CONFIG_RTCP_SEND_NACK
+    atomic_store(&nack_reset, true);
+#endif
+    atomic_store(&rr_running, true);
+    esp_timer_start_once(rr_timer, rtcp_rr_interval_us());
+    ESP_LOGI(TAG, "RTCP receiver reports enabled (SSRC 0x%08X)", (unsigned)rtcp_get_local_ssrc());
+    return ESP_OK;
+}
+
+void rtcp_rr_stop(void) {
+    if (!atomic_exchange(&rr_running, false)) {
+        return;
+    }
+    esp_timer_stop(rr_timer);
+    // The task sends the BYE; the caller closes the RTCP port once it has left
+    xSemaphoreTake(rr_stopped, 0);
+    xTaskNotify(rr_task, RTCP_RR_NOTIFY_STOP, eSetBits);
+    if (xSemaphoreTake(rr_stopped, pdMS_TO_TICKS(RTCP_RR_STOP_WAIT_MS)) != pdTRUE) {
+        LOG_RATE_W(TAG, "RTCP BYE not sent within %d ms", RTCP_RR_STOP_WAIT_MS);
+    }
+    atomic_store_explicit(&rr_peer, 0, memory_order_relaxed);
+}
+
+void rtcp_rr_note_peer(uint32_t addr, uint16_t port, bool is_rtcp) {
+    uint64_t cur = atomic_load_explicit(&rr_peer, memory_order_relaxed);
+    if (!is_rtcp) {
+        // RTP source: only a guess (port + 1) until the sender's RTCP shows up
+        if ((cur & RTCP_RR_PEER_FROM_RTCP) || addr == 0) {
+            return;
+        }
+        port = (uint16_t)(port + 1);
+    }
+    uint64_t peer = ((uint64_t)addr << 32) | (is_rtcp ? RTCP_RR_PEER_FROM_RTCP : 0) | port;
+    if (peer != cur) {
+        atomic_store_explicit(&rr_peer, peer, memory_order_relaxed);
+    }
+}
+
+#ifdef CONFIG_RTCP_SEND_NACK
+void rtcp_rr_note_seq(uint32_t ssrc, uint16_t seq) {
+    if (!atomic_load_explicit(&rr_running, memory_order_relaxed)) {
+        return;
+    }
+    if (atomic_exchange_explicit(&nack_reset, false, memory_order_relaxed) || ssrc != nack_ssrc) {
+        // New session or source: start following it from this packet
+        nack_ssrc = ssrc;
+        nack_highest = seq;
+        nack_count = 0;
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    buffer_depth_t depth = { 0 };
+    buffer_get_depth(&depth);
+    int64_t window_us = (int64_t)depth.target * depth.chunk_us;
+    int16_t delta = (int16_t)(seq - nack_highest);
+
+    if (delta <= 0) {
+        // Reordered, recovered or resent: no longer missing
+        for (uint8_t i = 0; i < nack_count; i++) {
+            if (nack_pending[i].seq == seq) {
+                rtcp_nack_remove(i);
+                break;
+            }
+        }
+    } else {
+        uint16_t first_missing = (uint16_t)(nack_highest + 1U);
+        nack_highest = seq;
+        if (delta > 1 && delta - 1 <= RTCP_NACK_PENDING &&
+            window_us >= (int64_t)CONFIG_RTCP_NACK_MIN_BUFFER_MS * 1000) {
+            for (uint16_t s = first_missing; s != seq; s++) {
+                if (nack_count == RTCP_NACK_PENDING) {
+                    // Full: the oldest one is the least likely to make it in time
+                    uint8_t oldest = 0;
+                    for (uint8_t i = 1; i < nack_count; i++) {
+                        if (rtcp_nack_cmp_age(nack_pending[i].seq, nack_pending[oldest].seq) < 0) {
+                            oldest = i;
+                        }
+                    }
+                    rtcp_nack_remove(oldest);
+                }
+                nack_pending[nack_count++] = (rtcp_nack_entry_t){
+                    .seq = s, .tries = 0, .lost_us = now_us, .due_us = now_us,
+                };
+            }
+        }
+    }
+
+    // Give up on packets that were asked for enough, or would now arrive after their playout
+    for (uint8_t i = 0; i < nack_count;) {
+        const rtcp_nack_entry_t *e = &nack_pending[i];
+        if ((e->tries >= RTCP_NACK_TRIES && e->due_us <= now_us) || now_us - e->lost_us > window_us) {
+            rtcp_nack_remove(i);
+        } else {
+            i++;
+        }
+    }
+    if (nack_count > 0) {
+        rtcp_nack_send_due(now_us);
+    }
+}
+#endif
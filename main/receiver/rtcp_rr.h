@@ -0,0 +1,67 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * RTCP Receiver Report transmitter (CONFIG_RTCP_SEND_RR).
+ *
+ * An esp_timer one-shot wakes the rtcp_rr task, which sends a compound
+ * RR + SDES(CNAME) packet from the RTCP port every RFC 3550 6.3 interval: at least CONFIG_RTCP_RR_MIN_INTERVAL_MS
+ * (half that before the first report), scaled by the average report size
+ * against the receivers' share of the RTCP bandwidth, and randomized over
+ * [0.5, 1.5] with the 1/(e - 3/2) reconsideration compensation. Nothing runs on
+ * the receive task besides rtcp_rr_note_peer(). Stopping has the task send a BYE.
+ *
+ * With CONFIG_RTCP_SEND_XR each report also carries an RFC 3611 XR: RRTR (so the
+ * sender can answer with DLRR and give us the round trip), a Statistics Summary
+ * per source and VoIP Metrics with the jitter buffer's depth and discards.
+ *
+ * With CONFIG_RTCP_SEND_NACK a gap in the RTP sequence asks the sender for the
+ * missing packets at once with an RFC 4585 generic NACK (RR + SDES + RTPFB),
+ * repeated once after CONFIG_RTCP_NACK_RETRY_MS, for as long as they could
+ * still be played (the jitter buffer target). Gaps longer than 16 packets are
+ * left to concealment.
+ *
+ * Reports go to the source address of the sender's RTCP (SR) packets once one
+ * has arrived, otherwise to the RTP source address at port + 1.
+ */
+
+/**
+ * @brief Transport for a finished RTCP packet
+ * @param addr IPv4 destination, network byte order
+ * @param port Destination port, host order
+ */
+typedef esp_err_t (*rtcp_rr_send_fn_t)(const uint8_t *data, size_t len, uint32_t addr, uint16_t port);
+
+/**
+ * @brief Start scheduling reports
+ * @param send Transport, called from the rtcp_rr task (and the receive task for NACKs)
+ * @param session_bytes_per_sec RTP session bandwidth; RTCP gets 5% of it
+ */
+esp_err_t rtcp_rr_start(rtcp_rr_send_fn_t send, uint32_t session_bytes_per_sec);
+
+/**
+ * @brief Stop scheduling and send a BYE to the current peer, if one is known
+ * Waits for the BYE to leave, then forgets the peer; safe to call when not started.
+ */
+void rtcp_rr_stop(void);
+
+/**
+ * @brief Record where the stream comes from (receive task, per packet)
+ * @param addr IPv4 source, network byte order
+ * @param port Source port, host order
+ * @param is_rtcp Packet arrived on the RTCP port
+ */
+void rtcp_rr_note_peer(uint32_t addr, uint16_t port, bool is_rtcp);
+
+/**
+ * @brief Follow the RTP sequence for gaps and send NACKs (receive task, per packet)
+ * Only built with CONFIG_RTCP_SEND_NACK.
+ * Recovered and retransmitted packets count too: they clear their request.
+ * @param ssrc Source of the packet
+ * @param seq Its RTP sequence number
+ */
+void rtcp_rr_note_seq(uint32_t ssrc, uint16_t seq);
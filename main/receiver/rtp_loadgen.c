@@ -0,0 +1,354 @@
+#include "rtp_loadgen.h"
+#include "sdkconfig.h"
+#include "build_config.h"
+#include "network_in.h"
+#include "buffer.h"
+#include "lifecycle_manager.h"
+#include "config/config_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include "lwip/sockets.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "metrics.h"
+
+#ifndef RTP_LOADGEN_TASK_STACK
+#define RTP_LOADGEN_TASK_STACK 4096
+#endif
+#ifndef RTP_LOADGEN_TASK_PRIO
+#define RTP_LOADGEN_TASK_PRIO 4     // Below udp_handler; core 0 keeps lwIP busy enough
+#endif
+// Largest RTP payload sent, so a datagram fits one Ethernet-sized pbuf
+#ifndef RTP_LOADGEN_MAX_PAYLOAD
+#define RTP_LOADGEN_MAX_PAYLOAD 1440
+#endif
+// Share of sent datagrams the receiver has to count for a step to hold
+#define RTP_LOADGEN_SUSTAIN_PCT 99u
+
+#define RTP_LOADGEN_HEADER_SIZE 12
+#define RTP_LOADGEN_PT          127     // Same dynamic type the sender uses for L16
+
+static rtp_loadgen_report_t s_report;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#ifdef CONFIG_RTP_LOADGEN
+static const char *TAG = "rtp_loadgen";
+
+static TaskHandle_t s_task = NULL;
+static atomic_bool s_stop = false;
+
+typedef struct {
+    int sock;
+    struct sockaddr_in dest;
+    uint32_t sample_rate;
+    uint8_t sample_bytes;
+    uint8_t channels;           // The configured stream's, so channel mapping is in the measured path
+    uint32_t ssrc;
+    uint16_t seq;
+    uint32_t rtp_ts;
+    uint32_t rng;
+    uint8_t pkt[RTP_LOADGEN_HEADER_SIZE + RTP_LOADGEN_MAX_PAYLOAD];
+    uint8_t held[RTP_LOADGEN_HEADER_SIZE + RTP_LOADGEN_MAX_PAYLOAD];
+    int held_len;
+} loadgen_ctx_t;
+
+static uint32_t next_rand(loadgen_ctx_t *g) {
+    g->rng = g->rng * 1664525u + 1013904223u;
+    return g->rng >> 8;
+}
+
+static bool chance(loadgen_ctx_t *g, uint8_t pct) {
+    return pct > 0 && next_rand(g) % 100u < pct;
+}
+
+// Quiet sawtooth in network order; the top two bytes carry the sample at any width
+static void fill_payload(loadgen_ctx_t *g, uint16_t frames) {
+    uint8_t *p = g->pkt + RTP_LOADGEN_HEADER_SIZE;
+    size_t bytes = (size_t)frames * g->channels * g->sample_bytes;
+    memset(p, 0, bytes);
+    for (uint32_t i = 0; i < (uint32_t)frames * g->channels; i++) {
+        int16_t s = (int16_t)((int32_t)((i / g->channels) % 48u) * 40 - 960);
+        p[i * g->sample_bytes] = (uint8_t)((uint16_t)s >> 8);
+        p[i * g->sample_bytes + 1] = (uint8_t)s;
+    }
+}
+
+static void build_header(loadgen_ctx_t *g, uint16_t frames) {
+    uint8_t *h = g->pkt;
+    h[0] = 0x80;
+    h[1] = RTP_LOADGEN_PT;
+    h[2] = (uint8_t)(g->seq >> 8);
+    h[3] = (uint8_t)g->seq;
+    h[4] = (uint8_t)(g->rtp_ts >> 24);
+    h[5] = (uint8_t)(g->rtp_ts >> 16);
+    h[6] = (uint8_t)(g->rtp_ts >> 8);
+    h[7] = (uint8_t)g->rtp_ts;
+    h[8] = (uint8_t)(g->ssrc >> 24);
+    h[9] = (uint8_t)(g->ssrc >> 16);
+    h[10] = (uint8_t)(g->ssrc >> 8);
+    h[11] = (uint8_t)g->ssrc;
+    g->seq++;
+    g->rtp_ts += frames;
+}
+
+static void send_one(loadgen_ctx_t *g, const uint8_t *data, int len, rtp_loadgen_step_t *st) {
+    if (sendto(g->sock, data, len, 0, (struct sockaddr *)&g->dest, sizeof(g->dest)) == len) {
+        st->sent++;
+    } else {
+        st->send_errors++;
+    }
+}
+
+// Upper bound of the bucket holding the 99th percentile of the lateness observed
+// between two snapshots
+static uint32_t lateness_p99(const uint32_t *before, const uint32_t *after) {
+    const metrics_histogram_t *h = buffer_get_lateness_histogram();
+    uint32_t total = 0;
+    for (uint32_t b = 0; b <= h->n_bounds; b++) {
+        total += after[b] - before[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint32_t target = (uint32_t)(((uint64_t)total * 99u + 99u) / 100u);
+    uint32_t seen = 0;
+    for (uint32_t b = 0; b < h->n_bounds; b++) {
+        seen += after[b] - before[b];
+        if (seen >= target) {
+            return h->bounds[b];
+        }
+    }
+    return UINT32_MAX;
+}
+
+// One step at `rate_pps`, continuing the stream's sequence and timeline. Returns false
+// when stopped before the step completed.
+static bool run_step(loadgen_ctx_t *g, const rtp_loadgen_config_t *cfg, uint32_t rate_pps,
+                     uint16_t frames, rtp_loadgen_step_t *st) {
+    memset(st, 0, sizeof(*st));
+    st->frames = frames;
+    // Derived sizes pace by the audio timeline so playout neither starves nor overflows
+    st->rate_pps = cfg->frames ? rate_pps : g->sample_rate / frames;
+    int len = RTP_LOADGEN_HEADER_SIZE + (int)frames * g->channels * g->sample_bytes;
+    fill_payload(g, frames);
+
+    uint32_t rx0 = 0, lost0 = 0;
+    get_rtp_statistics(&rx0, &lost0, NULL, NULL);
+    uint32_t underruns0 = buffer_get_underrun_count();
+    uint32_t late0[CONFIG_METRICS_HIST_MAX_BUCKETS + 1];
+    metrics_histogram_get(buffer_get_lateness_histogram(), late0);
+
+    const int64_t start = esp_timer_get_time();
+    const int64_t end = start + (int64_t)cfg->step_s * 1000000;
+    bool completed = true;
+    for (uint32_t n = 0;; n++) {
+        int64_t due = start + (cfg->frames ? (int64_t)((uint64_t)n * 1000000u / rate_pps)
+                                           : (int64_t)((uint64_t)n * frames * 1000000u / g->sample_rate));
+        if (cfg->jitter_us > 0) {
+            due += next_rand(g) % (cfg->jitter_us + 1u);
+        }
+        if (due >= end) {
+            break;
+        }
+        if (atomic_load(&s_stop)) {
+            completed = false;
+            break;
+        }
+        // Tick-granular pacing: whatever fell due during the last tick goes out as a burst
+        int64_t wait = due - esp_timer_get_time();
+        if (wait >= (int64_t)portTICK_PERIOD_MS * 1000) {
+            vTaskDelay((TickType_t)(wait / ((int64_t)portTICK_PERIOD_MS * 1000)));
+        }
+
+        build_header(g, frames);
+        if (chance(g, cfg->loss_pct)) {
+            continue;
+        }
+        if (g->held_len == 0 && chance(g, cfg->reorder_pct)) {
+            memcpy(g->held, g->pkt, len);
+            g->held_len = len;
+            continue;
+        }
+        send_one(g, g->pkt, len, st);
+        if (g->held_len > 0) {
+            send_one(g, g->held, g->held_len, st);
+            g->held_len = 0;
+        }
+        if (chance(g, cfg->dup_pct)) {
+            send_one(g, g->pkt, len, st);
+        }
+    }
+    if (g->held_len > 0) {
+        send_one(g, g->held, g->held_len, st);
+        g->held_len = 0;
+    }
+
+    uint32_t rx1 = 0, lost1 = 0;
+    get_rtp_statistics(&rx1, &lost1, NULL, NULL);
+    uint32_t late1[CONFIG_METRICS_HIST_MAX_BUCKETS + 1];
+    metrics_histogram_get(buffer_get_lateness_histogram(), late1);
+    st->received = rx1 - rx0;
+    st->lost = lost1 - lost0;
+    st->underruns = buffer_get_underrun_count() - underruns0;
+    st->p99_late_us = lateness_p99(late0, late1);
+    st->sustained = st->sent > 0 && st->underruns == 0 &&
+                    (uint64_t)st->received * 100u >= (uint64_t)st->sent * RTP_LOADGEN_SUSTAIN_PCT;
+    return completed;
+}
+
+static uint16_t frames_for_rate(const loadgen_ctx_t *g, uint32_t rate_pps) {
+    uint32_t frames = g->sample_rate / rate_pps;
+    uint32_t max_frames = RTP_LOADGEN_MAX_PAYLOAD / ((uint32_t)g->channels * g->sample_bytes);
+    if (frames > max_frames) {
+        frames = max_frames;
+    }
+    return (uint16_t)frames;
+}
+
+static void loadgen_task(void *arg) {
+    (void)arg;
+    static loadgen_ctx_t g;
+    rtp_loadgen_config_t cfg;
+    portENTER_CRITICAL(&s_lock);
+    cfg = s_report.config;
+    portEXIT_CRITICAL(&s_lock);
+
+    memset(&g, 0, sizeof(g));
+    g.sample_rate = lifecycle_get_sample_rate();
+    g.sample_bytes = lifecycle_get_bit_depth() / 8u;
+    if (g.sample_bytes < 2 || g.sample_bytes > 4) {
+        g.sample_bytes = 2;
+    }
+    g.channels = lifecycle_get_stream_channels();
+    g.rng = 0x1234ABCDu;
+    g.seq = (uint16_t)esp_random();
+    g.rtp_ts = esp_random();
+    // A multicast receiver listens on the group's port and may filter on its SSRC
+    uint16_t port = lifecycle_get_port();
+    if (network_is_multicast_enabled()) {
+        network_get_multicast_info(NULL, &port, &g.ssrc);
+    }
+    if (g.ssrc == 0) {
+        g.ssrc = esp_random() | 1u;
+    }
+    g.dest.sin_family = AF_INET;
+    g.dest.sin_port = htons(port);
+    g.dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    g.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+
+    if (g.sock < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+    } else {
+        ESP_LOGI(TAG, "Load run to 127.0.0.1:%u: %u..%u pps, %u s steps, loss %u%% dup %u%% reorder %u%% jitter %u us",
+                 (unsigned)port, (unsigned)cfg.rate_pps, (unsigned)cfg.max_rate_pps,
+                 (unsigned)cfg.step_s, cfg.loss_pct, cfg.dup_pct, cfg.reorder_pct, (unsigned)cfg.jitter_us);
+        uint32_t rate = cfg.rate_pps;
+        uint16_t prev_frames = 0;
+        for (int i = 0; i < RTP_LOADGEN_MAX_STEPS; i++) {
+            uint16_t frames = cfg.frames;
+            if (!frames) {
+                frames = frames_for_rate(&g, rate);
+                if (prev_frames && frames >= prev_frames) {
+                    frames = prev_frames - 1;   // Whole frames: make sure the rate moves
+                }
+                if (frames == 0) {
+                    break;
+                }
+            }
+            prev_frames = frames;
+
+            rtp_loadgen_step_t st;
+            if (!run_step(&g, &cfg, rate, frames, &st)) {
+                break;
+            }
+            ESP_LOGI(TAG, "Step %d: %u pps x %u frames: sent %u (%u failed), received %u, lost %u, "
+                     "underruns %u, p99 late %u us: %s",
+                     i, (unsigned)st.rate_pps, (unsigned)st.frames, (unsigned)st.sent,
+                     (unsigned)st.send_errors, (unsigned)st.received, (unsigned)st.lost,
+                     (unsigned)st.underruns, (unsigned)st.p99_late_us, st.sustained ? "held" : "FAILED");
+
+            portENTER_CRITICAL(&s_lock);
+            s_report.step[s_report.steps++] = st;
+            if (st.sustained && st.rate_pps > s_report.max_sustained_pps) {
+                s_report.max_sustained_pps = st.rate_pps;
+            }
+            portEXIT_CRITICAL(&s_lock);
+
+            uint32_t paced = st.rate_pps > rate ? st.rate_pps : rate;
+            uint32_t next = paced + (paced / 4u > 0 ? paced / 4u : 1u);
+            if (!st.sustained || next > cfg.max_rate_pps) {
+                break;
+            }
+            rate = next;
+        }
+        close(g.sock);
+        ESP_LOGI(TAG, "Load run done: max sustained %u pps", (unsigned)s_report.max_sustained_pps);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_report.running = false;
+    s_task = NULL;
+    portEXIT_CRITICAL(&s_lock);
+    vTaskDelete(NULL);
+}
+
+esp_err_t rtp_loadgen_start(const rtp_loadgen_config_t *config) {
+    if (!config || config->rate_pps == 0 || config->step_s == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    device_mode_t mode = lifecycle_get_device_mode();
+    if (mode != MODE_RECEIVER_USB && mode != MODE_RECEIVER_SPDIF) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t sample_bytes = lifecycle_get_bit_depth() / 8u;
+    if (config->frames &&
+        (uint32_t)config->frames * lifecycle_get_stream_channels() * sample_bytes > RTP_LOADGEN_MAX_PAYLOAD) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_report.running) {
+        portEXIT_CRITICAL(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(&s_report, 0, sizeof(s_report));
+    s_report.config = *config;
+    s_report.running = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    atomic_store(&s_stop, false);
+    if (xTaskCreatePinnedToCore(loadgen_task, "rtp_loadgen", RTP_LOADGEN_TASK_STACK, NULL,
+                                RTP_LOADGEN_TASK_PRIO, &s_task, 0) != pdPASS) {
+        portENTER_CRITICAL(&s_lock);
+        s_report.running = false;
+        portEXIT_CRITICAL(&s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void rtp_loadgen_stop(void) {
+    atomic_store(&s_stop, true);
+}
+#else
+esp_err_t rtp_loadgen_start(const rtp_loadgen_config_t *config) {
+    (void)config;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void rtp_loadgen_stop(void) {
+}
+#endif
+
+void rtp_loadgen_get_report(rtp_loadgen_report_t *report) {
+    if (!report) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *report = s_report;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Synthetic RTP load generator (CONFIG_RTP_LOADGEN), for qualifying the
+ * receive path without external senders.
+ *
+ * A task on core 0 sends RTP in the receiver's configured format to
+ * 127.0.0.1 on the RTP port, so packets take the same socket (or raw pcb),
+ * udp_handler, jitter buffer and playout path as a real stream. Loss,
+ * duplication, reordering (a packet held back behind its successor) and
+ * send jitter are drawn per packet from a fixed-seed generator, so runs are
+ * repeatable.
+ *
+ * The run is a series of steps of step_s seconds each. With max_rate_pps
+ * above rate_pps the rate grows by a quarter per step until a step fails or
+ * max_rate_pps is passed; a step is sustained when the receiver counted at
+ * least 99% of the datagrams sent (duplicates included) and no underrun
+ * happened. Each step reports its own counts and the 99th percentile of the
+ * jitter buffer's release lateness.
+ */
+
+#define RTP_LOADGEN_MAX_STEPS 16
+
+typedef struct {
+    uint32_t rate_pps;      // Packets per second (first step when ramping)
+    uint32_t max_rate_pps;  // Ramp up to this; 0 or <= rate_pps = a single step
+    uint16_t frames;        // Frames per packet; 0 = sample_rate / rate, keeping the audio real-time
+    uint16_t step_s;        // Seconds per step
+    uint8_t  loss_pct;      // Packets not sent
+    uint8_t  dup_pct;       // Packets sent twice
+    uint8_t  reorder_pct;   // Packets sent after the one that follows them
+    uint32_t jitter_us;     // Each send delayed by 0..jitter_us
+} rtp_loadgen_config_t;
+
+typedef struct {
+    uint32_t rate_pps;      // Rate actually paced (frames are whole)
+    uint16_t frames;
+    uint32_t sent;          // Datagrams sent, duplicates included
+    uint32_t send_errors;   // Datagrams lwIP refused (generator-side limit)
+    uint32_t received;      // Datagrams the receiver accepted
+    uint32_t lost;          // Gaps the receiver counted
+    uint32_t underruns;
+    uint32_t p99_late_us;   // Bucket upper bound; UINT32_MAX past the largest bound
+    bool     sustained;
+} rtp_loadgen_step_t;
+
+typedef struct {
+    bool     running;
+    rtp_loadgen_config_t config;
+    uint32_t max_sustained_pps;  // 0 until a step holds
+    uint8_t  steps;
+    rtp_loadgen_step_t step[RTP_LOADGEN_MAX_STEPS];
+} rtp_loadgen_report_t;
+
+/**
+ * @brief Start a run, replacing the previous report
+ *
+ * @return ESP_ERR_INVALID_STATE outside receiver mode or while a run is
+ *         going, ESP_ERR_INVALID_ARG for a zero rate or step, ESP_ERR_NOT_SUPPORTED
+ *         with CONFIG_RTP_LOADGEN off
+ */
+esp_err_t rtp_loadgen_start(const rtp_loadgen_config_t *config);
+
+/**
+ * @brief Stop a run; the step in progress is left out of the report
+ */
+void rtp_loadgen_stop(void);
+
+/**
+ * @brief Copy out the current (or last) run's report
+ */
+void rtp_loadgen_get_report(rtp_loadgen_report_t *report);
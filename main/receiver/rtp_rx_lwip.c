@@ -0,0 +1,289 @@
+#include "rtp_rx_lwip.h"
+#include "sdkconfig.h"
+#include "build_config.h"
+#include "global.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+#include "lwip/igmp.h"
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+#include "lwip/mld6.h"
+#endif
+#include "lwip/ip_addr.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"  // tcpip_api_call
+#include "esp_log.h"
+#include "wifi_manager.h"
+#include <stdatomic.h>
+#include <string.h>
+
+/*
+ * The udp_recv callbacks run in the tcpip thread and only queue the pbuf; all
+ * parsing and the jitter-buffer writes stay on udp_handler, which keeps the
+ * buffer's single-producer rule. PCBs are created and removed through
+ * tcpip_api_call(), since the raw API is not thread safe.
+ */
+
+#define RX_LWIP_ARG_RTP   ((void *)0)
+#define RX_LWIP_ARG_RTCP  ((void *)1)
+
+static QueueHandle_t rx_queue = NULL;
+static struct udp_pcb *rtp_pcb = NULL;
+static struct udp_pcb *rtcp_pcb = NULL;
+static struct udp_pcb *mcast_pcb = NULL;    // Group port, when it differs from the RTP port
+static ip_addr_t mcast_group;
+static bool mcast_joined = false;
+static ip4_addr_t mcast_source;             // SSM: the one sender taken on the group (any when zero)
+static uint16_t rtp_port = 0;
+static atomic_uint_fast32_t rx_overflows = 0;
+static atomic_uint_fast32_t rx_foreign = 0;
+
+typedef struct {
+    struct tcpip_api_call_data call;  // Must be first
+    uint16_t port;
+    ip_addr_t group;
+    ip4_addr_t source;
+} rx_lwip_call_t;
+
+typedef struct {
+    struct tcpip_api_call_data call;  // Must be first
+    const void *data;
+    size_t len;
+    uint32_t addr;
+    uint16_t port;
+} rx_lwip_send_t;
+
+// tcpip thread
+static void rx_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    (void)pcb;
+    // lwIP joins any-source (IGMPv2), so other senders to the group stop here, before the queue
+    if (!ip4_addr_isany_val(mcast_source) && ip_addr_ismulticast(ip_current_dest_addr()) &&
+        (!addr || !IP_IS_V4(addr) || !ip4_addr_cmp(ip_2_ip4(addr), &mcast_source))) {
+        pbuf_free(p);
+        atomic_fetch_add_explicit(&rx_foreign, 1, memory_order_relaxed);
+        return;
+    }
+    rtp_rx_lwip_packet_t pkt = {
+        .p = p,
+        .src_addr = (addr && IP_IS_V4(addr)) ? ip_2_ip4(addr)->addr : 0,
+        .src_port = port,
+        .is_rtcp = (arg == RX_LWIP_ARG_RTCP),
+    };
+    if (xQueueSend(rx_queue, &pkt, 0) != pdTRUE) {
+        pbuf_free(p);
+        atomic_fetch_add_explicit(&rx_overflows, 1, memory_order_relaxed);
+    }
+}
+
+static err_t bind_pcb(struct udp_pcb **pcb, uint16_t port, void *arg, u8_t type) {
+    *pcb = udp_new_ip_type(type);
+    if (!*pcb) {
+        return ERR_MEM;
+    }
+    ip_set_option(*pcb, SOF_REUSEADDR);
+    (*pcb)->tos = wifi_manager_audio_tos();
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    err_t err = udp_bind(*pcb, type == IPADDR_TYPE_V6 ? IP6_ADDR_ANY : IP_ADDR_ANY, port);
+#else
+    err_t err = udp_bind(*pcb, IP_ADDR_ANY, port);
+#endif
+    if (err != ERR_OK) {
+        udp_remove(*pcb);
+        *pcb = NULL;
+        return err;
+    }
+    udp_recv(*pcb, rx_recv_cb, arg);
+    return ERR_OK;
+}
+
+static void remove_pcb(struct udp_pcb **pcb) {
+    if (*pcb) {
+        udp_remove(*pcb);
+        *pcb = NULL;
+    }
+}
+
+static err_t open_fn(struct tcpip_api_call_data *call) {
+    rx_lwip_call_t *msg = (rx_lwip_call_t *)call;
+    err_t err = bind_pcb(&rtp_pcb, msg->port, RX_LWIP_ARG_RTP, IPADDR_TYPE_V4);
+#ifdef CONFIG_RTCP_ENABLED
+    if (err == ERR_OK) {
+        err = bind_pcb(&rtcp_pcb, msg->port + 1, RX_LWIP_ARG_RTCP, IPADDR_TYPE_V4);
+        if (err != ERR_OK) {
+            remove_pcb(&rtp_pcb);
+        }
+    }
+#endif
+    return err;
+}
+
+static err_t close_fn(struct tcpip_api_call_data *call) {
+    (void)call;
+    remove_pcb(&rtp_pcb);
+    remove_pcb(&rtcp_pcb);
+    return ERR_OK;
+}
+
+static err_t leave_fn(struct tcpip_api_call_data *call) {
+    (void)call;
+    if (mcast_joined) {
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+        if (IP_IS_V6_VAL(mcast_group)) {
+            mld6_leavegroup(IP6_ADDR_ANY6, ip_2_ip6(&mcast_group));
+        } else
+#endif
+        {
+            igmp_leavegroup(IP4_ADDR_ANY4, ip_2_ip4(&mcast_group));
+        }
+        mcast_joined = false;
+    }
+    ip4_addr_set_any(&mcast_source);
+    remove_pcb(&mcast_pcb);
+    return ERR_OK;
+}
+
+static err_t join_fn(struct tcpip_api_call_data *call) {
+    rx_lwip_call_t *msg = (rx_lwip_call_t *)call;
+    leave_fn(call);
+    err_t err;
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    if (IP_IS_V6_VAL(msg->group)) {
+        // The RTP port's PCB is IPv4 only, so an IPv6 group always gets its own
+        err = bind_pcb(&mcast_pcb, msg->port, RX_LWIP_ARG_RTP, IPADDR_TYPE_V6);
+        if (err == ERR_OK) {
+            err = mld6_joingroup(IP6_ADDR_ANY6, ip_2_ip6(&msg->group));
+        }
+    } else
+#endif
+    {
+        err = msg->port != rtp_port ? bind_pcb(&mcast_pcb, msg->port, RX_LWIP_ARG_RTP, IPADDR_TYPE_V4) : ERR_OK;
+        if (err == ERR_OK) {
+            err = igmp_joingroup(IP4_ADDR_ANY4, ip_2_ip4(&msg->group));
+        }
+    }
+    if (err != ERR_OK) {
+        remove_pcb(&mcast_pcb);
+        return err;
+    }
+    mcast_group = msg->group;
+    mcast_source = msg->source;
+    mcast_joined = true;
+    return ERR_OK;
+}
+
+static err_t send_rtcp_fn(struct tcpip_api_call_data *call) {
+    rx_lwip_send_t *msg = (rx_lwip_send_t *)call;
+    if (!rtcp_pcb) {
+        return ERR_CONN;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)msg->len, PBUF_RAM);
+    if (!p) {
+        return ERR_MEM;
+    }
+    memcpy(p->payload, msg->data, msg->len);
+    ip_addr_t dst;
+    ip_addr_set_ip4_u32_val(dst, msg->addr);
+    err_t err = udp_sendto(rtcp_pcb, p, &dst, msg->port);
+    pbuf_free(p);
+    return err;
+}
+
+esp_err_t rtp_rx_lwip_open(uint16_t port) {
+    if (!rx_queue) {
+        rx_queue = xQueueCreate(CONFIG_RTP_RX_LWIP_QUEUE_PACKETS, sizeof(rtp_rx_lwip_packet_t));
+        if (!rx_queue) {
+            ESP_LOGE(TAG, "Failed to create lwIP RX queue");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    rx_lwip_call_t msg = { .port = port };
+    err_t err = tcpip_api_call(open_fn, &msg.call);
+    if (err != ERR_OK) {
+        ESP_LOGE(TAG, "lwIP RX: unable to bind port %u: err %d", port, err);
+        return err == ERR_MEM ? ESP_ERR_NO_MEM : ESP_FAIL;
+    }
+    rtp_port = port;
+    ESP_LOGI(TAG, "UDP server listening on port %d (lwIP raw)", port);
+    return ESP_OK;
+}
+
+void rtp_rx_lwip_close(void) {
+    rx_lwip_call_t msg = { 0 };
+    tcpip_api_call(close_fn, &msg.call);
+    rtp_port = 0;
+    // Nothing can queue now; drop what the old PCBs left behind
+    rtp_rx_lwip_packet_t pkt;
+    while (rx_queue && xQueueReceive(rx_queue, &pkt, 0) == pdTRUE) {
+        rtp_rx_lwip_release(&pkt);
+    }
+}
+
+esp_err_t rtp_rx_lwip_join(const char *group, uint32_t source, uint16_t port) {
+    rx_lwip_call_t msg = { .port = port };
+    if (!group || !ipaddr_aton(group, &msg.group) || !ip_addr_ismulticast(&msg.group)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#ifndef CONFIG_RTP_RX_MULTICAST_IPV6
+    if (!IP_IS_V4_VAL(msg.group)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+    ip4_addr_set_u32(&msg.source, source);
+    err_t err = tcpip_api_call(join_fn, &msg.call);
+    if (err != ERR_OK) {
+        ESP_LOGE(TAG, "lwIP RX: failed to join %s:%u: err %d", group, port, err);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void rtp_rx_lwip_leave(void) {
+    rx_lwip_call_t msg = { 0 };
+    tcpip_api_call(leave_fn, &msg.call);
+}
+
+bool rtp_rx_lwip_receive(rtp_rx_lwip_packet_t *pkt, TickType_t wait) {
+    if (!rx_queue) {
+        vTaskDelay(wait);
+        return false;
+    }
+    return xQueueReceive(rx_queue, pkt, wait) == pdTRUE;
+}
+
+size_t rtp_rx_lwip_length(const rtp_rx_lwip_packet_t *pkt) {
+    return pkt->p ? pkt->p->tot_len : 0;
+}
+
+size_t rtp_rx_lwip_copy(const rtp_rx_lwip_packet_t *pkt, void *dst, size_t len, size_t offset) {
+    return pbuf_copy_partial(pkt->p, dst, (u16_t)len, (u16_t)offset);
+}
+
+void rtp_rx_lwip_release(rtp_rx_lwip_packet_t *pkt) {
+    if (pkt->p) {
+        pbuf_free(pkt->p);
+        pkt->p = NULL;
+    }
+}
+
+esp_err_t rtp_rx_lwip_send_rtcp(const void *data, size_t len, uint32_t addr, uint16_t port) {
+    if (!data || len == 0 || len > 0xFFFF) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rx_lwip_send_t msg = { .data = data, .len = len, .addr = addr, .port = port };
+    err_t err = tcpip_api_call(send_rtcp_fn, &msg.call);
+    switch (err) {
+        case ERR_OK:   return ESP_OK;
+        case ERR_CONN: return ESP_ERR_INVALID_STATE;
+        case ERR_MEM:  return ESP_ERR_NO_MEM;
+        default:       return ESP_FAIL;
+    }
+}
+
+uint32_t rtp_rx_lwip_get_overflows(void) {
+    return atomic_load_explicit(&rx_overflows, memory_order_relaxed);
+}
+
+uint32_t rtp_rx_lwip_get_foreign(void) {
+    return atomic_load_explicit(&rx_foreign, memory_order_relaxed);
+}
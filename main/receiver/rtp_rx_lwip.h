@@ -0,0 +1,86 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * lwIP raw-API ingest for the receiver (CONFIG_RTP_RX_BACKEND_LWIP_RAW).
+ *
+ * Instead of BSD sockets (pbuf -> socket mailbox -> recvfrom() copy), udp_recv
+ * callbacks on the RTP (and RTCP) ports hand each pbuf chain to udp_handler
+ * through a pointer queue. udp_handler reads the header straight off the
+ * chain and copies the payload once, into its jitter-buffer slot when the
+ * packet has the standard shape. Multicast groups are joined with IGMP
+ * (or MLD, for an IPv6 group) directly; packets for the RTP port arrive on the
+ * same callback.
+ */
+
+struct pbuf;
+
+typedef struct {
+    struct pbuf *p;
+    uint32_t src_addr;      // IPv4 source, network byte order
+    uint16_t src_port;
+    bool is_rtcp;
+} rtp_rx_lwip_packet_t;
+
+/**
+ * @brief Bind the RTP port (and RTP port + 1 for RTCP when enabled)
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM, or ESP_FAIL if a port could not be bound
+ */
+esp_err_t rtp_rx_lwip_open(uint16_t port);
+
+void rtp_rx_lwip_close(void);
+
+/**
+ * @brief Join a multicast group, binding its port too if it isn't the RTP port
+ *
+ * Only one group is joined at a time, like the socket path. An IPv6 group
+ * (CONFIG_RTP_RX_MULTICAST_IPV6) always gets its own PCB.
+ *
+ * @param source IPv4 sender to accept on the group (network byte order), 0 for any;
+ *               others are dropped in the tcpip thread
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a non-multicast group,
+ *         ESP_ERR_NOT_SUPPORTED for an IPv6 group without IPv6 support, or ESP_FAIL
+ */
+esp_err_t rtp_rx_lwip_join(const char *group, uint32_t source, uint16_t port);
+
+void rtp_rx_lwip_leave(void);
+
+/**
+ * @brief Wait for the next datagram (udp_handler only)
+ *
+ * @param wait Ticks to block
+ * @return true if pkt holds a packet, which must be released
+ */
+bool rtp_rx_lwip_receive(rtp_rx_lwip_packet_t *pkt, TickType_t wait);
+
+// Datagram length in bytes
+size_t rtp_rx_lwip_length(const rtp_rx_lwip_packet_t *pkt);
+
+/**
+ * @brief Copy part of the datagram out of the pbuf chain
+ *
+ * @return Bytes copied
+ */
+size_t rtp_rx_lwip_copy(const rtp_rx_lwip_packet_t *pkt, void *dst, size_t len, size_t offset);
+
+void rtp_rx_lwip_release(rtp_rx_lwip_packet_t *pkt);
+
+/**
+ * @brief Send a datagram from the RTCP port (RTP port + 1)
+ *
+ * @param addr IPv4 destination, network byte order
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the port isn't bound, ESP_ERR_NO_MEM or ESP_FAIL
+ */
+esp_err_t rtp_rx_lwip_send_rtcp(const void *data, size_t len, uint32_t addr, uint16_t port);
+
+// Datagrams dropped because udp_handler fell behind
+uint32_t rtp_rx_lwip_get_overflows(void);
+
+// Datagrams to the group from a sender other than the joined source
+uint32_t rtp_rx_lwip_get_foreign(void);
@@ -1,6 +1,9 @@
 #include "sap_listener.h"
 #include "global.h"
 #include "lifecycle_manager.h"
+#include "lifecycle/net_iface.h"
+#include "audio_arena.h"
+#include "rtp/rtp_srtp.h"
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_system.h"
@@ -9,6 +12,7 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/socket.h>
@@ -16,6 +20,22 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+// Announcements are indexed by their SAP key, (originating source, message
+// version), so a periodic repeat is one hash lookup and no SDP parse. The LRU
+// list orders slots by last_seen: eviction takes its head, expiry walks it
+// from the head only as far as the first fresh entry.
+#define SAP_HASH_BUCKETS (SAP_MAX_ANNOUNCEMENTS * 2)
+#define SAP_NO_SLOT (-1)
+
+typedef struct {
+    uint32_t origin;        // Originating source (an IPv6 source folded to 32 bits)
+    uint32_t version;       // Message ID hash, or a hash of the SDP when the sender sends none
+    int16_t hash_next;      // Next slot in the bucket chain
+    int16_t lru_prev;
+    int16_t lru_next;
+    bool keyed;             // Linked into the hash index
+} sap_slot_t;
+
 // Module state
 static struct {
     int socket;
@@ -24,9 +44,13 @@ static struct {
     bool is_running;
     uint32_t timeout_seconds;
     
-    // Announcement tracking
-    sap_announcement_t announcements[SAP_MAX_ANNOUNCEMENTS];
-    size_t announcement_count;
+    // Announcement tracking; the table is cold memory (PSRAM when present), taken at init
+    sap_announcement_t *announcements;
+    size_t announcement_count;      // Slots ever used; [0, count) hold entries
+    sap_slot_t slots[SAP_MAX_ANNOUNCEMENTS];
+    int16_t buckets[SAP_HASH_BUCKETS];
+    int16_t lru_head;               // Least recently seen
+    int16_t lru_tail;
     SemaphoreHandle_t mutex;
 } s_sap_state = {
     .socket = -1,
@@ -42,8 +66,21 @@ static struct {
 static void sap_handler_task(void *pvParameters);
 static void sap_cleanup_task(void *pvParameters);
 static bool parse_sdp_and_get_info(const char *sdp, sap_announcement_t *announcement);
-static void update_or_add_announcement(sap_announcement_t *new_announcement);
+static bool touch_known_announcement(uint32_t origin, uint32_t version, bool deletion,
+                                     sap_announcement_t *out);
+static void update_or_add_announcement(sap_announcement_t *new_announcement, uint32_t origin,
+                                       uint32_t version);
 static void cleanup_expired_announcements(void);
+static void table_reset(void);
+
+#define FNV1A_INIT 2166136261u
+
+static uint32_t fnv1a(const uint8_t *data, size_t len, uint32_t hash) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
 
 esp_err_t sap_listener_init(void) {
 
@@ -54,10 +91,16 @@ esp_err_t sap_listener_init(void) {
         ESP_LOGE(TAG, "Failed to create SAP listener mutex");
         return ESP_FAIL;
     }
+    s_sap_state.announcements = audio_arena_alloc_cold(sizeof(sap_announcement_t) * SAP_MAX_ANNOUNCEMENTS);
+    if (s_sap_state.announcements == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate SAP announcement table");
+        vSemaphoreDelete(s_sap_state.mutex);
+        s_sap_state.mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
     
     // Clear announcement history
-    memset(s_sap_state.announcements, 0, sizeof(s_sap_state.announcements));
-    s_sap_state.announcement_count = 0;
+    table_reset();
     
     return ESP_OK;
 }
@@ -194,6 +237,7 @@ esp_err_t sap_listener_deinit(void) {
         vSemaphoreDelete(s_sap_state.mutex);
         s_sap_state.mutex = NULL;
     }
+    audio_arena_free(s_sap_state.announcements);
     
     // Clear state
     memset(&s_sap_state, 0, sizeof(s_sap_state));
@@ -220,7 +264,7 @@ size_t sap_listener_get_active_announcements(sap_announcement_t* announcements,
     size_t count = 0;
     
     if (xSemaphoreTake(s_sap_state.mutex, portMAX_DELAY) == pdTRUE) {
-        for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS && count < max_count; i++) {
+        for (size_t i = 0; i < s_sap_state.announcement_count && count < max_count; i++) {
             if (s_sap_state.announcements[i].active) {
                 memcpy(&announcements[count], &s_sap_state.announcements[i], sizeof(sap_announcement_t));
                 count++;
@@ -237,6 +281,28 @@ const sap_announcement_t* sap_listener_get_all_announcements(size_t *count) {
     return s_sap_state.announcements;
 }
 
+size_t sap_listener_foreach(bool active_only, sap_announcement_visit_t visit, void *ctx) {
+    if (!visit || s_sap_state.mutex == NULL) {
+        return 0;
+    }
+
+    size_t visited = 0;
+    if (xSemaphoreTake(s_sap_state.mutex, portMAX_DELAY) == pdTRUE) {
+        for (size_t i = 0; i < s_sap_state.announcement_count; i++) {
+            const sap_announcement_t *a = &s_sap_state.announcements[i];
+            if (active_only && !a->active) {
+                continue;
+            }
+            visited++;
+            if (!visit(a, ctx)) {
+                break;
+            }
+        }
+        xSemaphoreGive(s_sap_state.mutex);
+    }
+    return visited;
+}
+
 bool sap_listener_get_announcement_by_name(const char* stream_name, sap_announcement_t* announcement) {
     if (!stream_name || !announcement) {
         return false;
@@ -251,7 +317,7 @@ bool sap_listener_get_announcement_by_name(const char* stream_name, sap_announce
     bool found = false;
     
     if (xSemaphoreTake(s_sap_state.mutex, portMAX_DELAY) == pdTRUE) {
-        for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS; i++) {
+        for (size_t i = 0; i < s_sap_state.announcement_count; i++) {
             if (s_sap_state.announcements[i].active &&
                 strcmp(s_sap_state.announcements[i].stream_name, stream_name) == 0) {
                 memcpy(announcement, &s_sap_state.announcements[i], sizeof(sap_announcement_t));
@@ -273,8 +339,7 @@ void sap_listener_clear_history(void) {
     }
     
     if (xSemaphoreTake(s_sap_state.mutex, portMAX_DELAY) == pdTRUE) {
-        memset(s_sap_state.announcements, 0, sizeof(s_sap_state.announcements));
-        s_sap_state.announcement_count = 0;
+        table_reset();
         xSemaphoreGive(s_sap_state.mutex);
     }
 }
@@ -284,6 +349,14 @@ void sap_listener_set_timeout(uint32_t timeout_seconds) {
     ESP_LOGI(TAG, "SAP announcement timeout set to %lu seconds", timeout_seconds);
 }
 
+// Keys to hand the lifecycle manager: none for plain RTP, NULL when SRTP keys are not announced
+static const char *sap_srtp_crypto(const sap_announcement_t *a) {
+    if (!a->srtp) {
+        return "";
+    }
+    return a->srtp_crypto[0] ? a->srtp_crypto : NULL;
+}
+
 void sap_listener_check_stream_config(void) {
     const char* configured_stream = lifecycle_get_sap_stream_name();
 
@@ -304,7 +377,15 @@ void sap_listener_check_stream_config(void) {
             announcement.multicast_ip,  // Use the multicast IP from SDP
             announcement.source_ip,
             announcement.port,
-            announcement.sample_rate
+            announcement.sample_rate,
+            announcement.bit_depth,
+            announcement.channels,
+            announcement.opus_pt,
+            announcement.ptime_ms,
+            announcement.ptp_clock,
+            announcement.ptp_domain,
+            announcement.mediaclk_offset,
+            sap_srtp_crypto(&announcement)
         );
     } else {
         ESP_LOGI(TAG, "Configured stream '%s' not found in announcements", configured_stream);
@@ -321,7 +402,7 @@ size_t sap_listener_get_active_count(void) {
     size_t count = 0;
     
     if (xSemaphoreTake(s_sap_state.mutex, portMAX_DELAY) == pdTRUE) {
-        for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS; i++) {
+        for (size_t i = 0; i < s_sap_state.announcement_count; i++) {
             if (s_sap_state.announcements[i].active) {
                 count++;
             }
@@ -398,6 +479,13 @@ static void sap_handler_task(void *pvParameters) {
 
         // Check address type (0 = IPv4, 1 = IPv6)
         uint8_t addr_type = (sap_flags >> 4) & 0x01;
+        bool deletion = (sap_flags >> 2) & 0x01;
+        if (sap_flags & 0x03) {
+            // Encrypted or compressed payload: nothing we can read
+            ESP_LOGD(TAG, "Skipping encrypted/compressed SAP packet");
+            continue;
+        }
+        uint16_t msg_id_hash = ((uint16_t)packet[2] << 8) | packet[3];
         
         // Calculate SDP offset
         int sdp_offset = 4; // Basic header
@@ -408,6 +496,10 @@ static void sap_handler_task(void *pvParameters) {
         } else {
             sdp_offset += 16; // IPv6 address
         }
+        if (len < sdp_offset) {
+            continue;
+        }
+        uint32_t origin = fnv1a(packet + 4, sdp_offset - 4, FNV1A_INIT);
         
         // Add authentication data size
         sdp_offset += auth_len * 4;
@@ -425,65 +517,84 @@ static void sap_handler_task(void *pvParameters) {
         
         // Point to SDP payload
         char *sdp_data = rx_buffer + sdp_offset;
-        ESP_LOGI(TAG, "Received SAP announcement from %s, SDP offset %d",
-                 inet_ntoa(source_addr.sin_addr), sdp_offset);
-        ESP_LOGD(TAG, "SDP content: %s", sdp_data);
 
-        // Parse the announcement
-        sap_announcement_t announcement = {0};
-        
-        // Store source IP in a temporary variable (parse_sdp_and_get_info will clear the struct)
-        char source_ip_temp[16];
-        inet_ntop(AF_INET, &source_addr.sin_addr, source_ip_temp, sizeof(source_ip_temp));
-        
-        // Parse SDP content
-        if (parse_sdp_and_get_info(sdp_data, &announcement)) {
-            // Restore the source IP after parsing (since parse_sdp_and_get_info clears the struct)
-            strncpy(announcement.source_ip, source_ip_temp, sizeof(announcement.source_ip) - 1);
-            announcement.source_ip[sizeof(announcement.source_ip) - 1] = '\0';
-            
-            // Check if this is for our device
-            esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-            if (netif) {
-                esp_netif_ip_info_t ip_info;
-                esp_netif_get_ip_info(netif, &ip_info);
-                char my_ip_str[16];
-                sprintf(my_ip_str, IPSTR, IP2STR(&ip_info.ip));
-
-                // Update or add announcement to history
-                update_or_add_announcement(&announcement);
-
-                // If the announcement matches our IP, trigger sample rate change
-                if (strcmp(announcement.source_ip, my_ip_str) == 0) {
-                    ESP_LOGI(TAG, "SAP announcement matches our IP. Detected sample rate: %lu",
-                            announcement.sample_rate);
-                    lifecycle_manager_change_sample_rate(announcement.sample_rate);
-                }
+        // (origin, message ID hash) names one version of one session; a sender
+        // that leaves the hash 0 gets a hash of its SDP instead
+        uint32_t msg_version = msg_id_hash ? msg_id_hash
+                                           : fnv1a((const uint8_t *)sdp_data, len - sdp_offset, FNV1A_INIT);
+
+        sap_announcement_t announcement;
+        bool known = touch_known_announcement(origin, msg_version, deletion, &announcement);
+        if (deletion) {
+            ESP_LOGI(TAG, "SAP deletion from %s%s", inet_ntoa(source_addr.sin_addr),
+                     known ? "" : " (unknown session)");
+            continue;
+        }
+        if (!known) {
+            ESP_LOGI(TAG, "Received SAP announcement from %s, SDP offset %d",
+                     inet_ntoa(source_addr.sin_addr), sdp_offset);
+            ESP_LOGD(TAG, "SDP content: %s", sdp_data);
+
+            // A new session, or a changed one: parse it (this clears the struct)
+            if (!parse_sdp_and_get_info(sdp_data, &announcement)) {
+                ESP_LOGW(TAG, "Failed to parse SDP content");
+                continue;
+            }
+            inet_ntop(AF_INET, &source_addr.sin_addr, announcement.source_ip, sizeof(announcement.source_ip));
+        }
+
+        // Repeats of a known session log at debug level only
+        esp_log_level_t level = known ? ESP_LOG_DEBUG : ESP_LOG_INFO;
+
+        // Check if this is for our device
+        esp_netif_t *netif = net_iface_primary();
+        if (netif) {
+            esp_netif_ip_info_t ip_info;
+            esp_netif_get_ip_info(netif, &ip_info);
+            char my_ip_str[16];
+            sprintf(my_ip_str, IPSTR, IP2STR(&ip_info.ip));
+
+            // Update or add announcement to history
+            if (!known) {
+                update_or_add_announcement(&announcement, origin, msg_version);
+            }
 
-                // Check if this announcement matches configured stream name for auto-join
-                const char* configured_stream = lifecycle_get_sap_stream_name();
-                if (configured_stream && strlen(configured_stream) > 0) {
-                    if (strcmp(announcement.stream_name, configured_stream) == 0) {
-                        ESP_LOGI(TAG, "SAP announcement matches configured stream '%s'. Notifying lifecycle manager.",
-                                configured_stream);
-                        ESP_LOGI(TAG, "Stream details - Multicast IP: %s, Source IP: %s, Port: %d, Sample Rate: %lu",
-                                announcement.multicast_ip, announcement.source_ip,
-                                announcement.port, announcement.sample_rate);
-                        
-                        // Use lifecycle manager to handle the stream configuration
-                        // The lifecycle manager will determine if we need to join multicast or configure unicast
-                        lifecycle_manager_notify_sap_stream(
-                            announcement.stream_name,
-                            announcement.multicast_ip,  // Use the multicast IP from SDP c= line
-                            announcement.source_ip,
-                            announcement.port,
-                            announcement.sample_rate
-                        );
-                    }
+            // If the announcement matches our IP, trigger sample rate change
+            if (strcmp(announcement.source_ip, my_ip_str) == 0) {
+                ESP_LOG_LEVEL_LOCAL(level, TAG, "SAP announcement matches our IP. Detected sample rate: %lu",
+                        announcement.sample_rate);
+                lifecycle_manager_change_sample_rate(announcement.sample_rate);
+            }
+
+            // Check if this announcement matches configured stream name for auto-join
+            const char* configured_stream = lifecycle_get_sap_stream_name();
+            if (configured_stream && strlen(configured_stream) > 0) {
+                if (strcmp(announcement.stream_name, configured_stream) == 0) {
+                    ESP_LOG_LEVEL_LOCAL(level, TAG, "SAP announcement matches configured stream '%s'. Notifying lifecycle manager.",
+                            configured_stream);
+                    ESP_LOG_LEVEL_LOCAL(level, TAG, "Stream details - Multicast IP: %s, Source IP: %s, Port: %d, Sample Rate: %lu",
+                            announcement.multicast_ip, announcement.source_ip,
+                            announcement.port, announcement.sample_rate);
+                    
+                    // Use lifecycle manager to handle the stream configuration
+                    // The lifecycle manager will determine if we need to join multicast or configure unicast
+                    lifecycle_manager_notify_sap_stream(
+                        announcement.stream_name,
+                        announcement.multicast_ip,  // Use the multicast IP from SDP c= line
+                        announcement.source_ip,
+                        announcement.port,
+                        announcement.sample_rate,
+                        announcement.bit_depth,
+                        announcement.channels,
+                        announcement.opus_pt,
+                        announcement.ptime_ms,
+                        announcement.ptp_clock,
+                        announcement.ptp_domain,
+                        announcement.mediaclk_offset,
+                        sap_srtp_crypto(&announcement)
+                    );
                 }
             }
-        } else {
-            ESP_LOGW(TAG, "Failed to parse SDP content");
         }
     }
     
@@ -559,15 +670,26 @@ static bool parse_sdp_and_get_info(const char *sdp, sap_announcement_t *announce
     // Find connection data (c=) and extract multicast IP
     const char *c_line = strstr(sdp, "c=IN IP4 ");
     if (c_line) {
-        // The value starts after "c=IN IP4 "
+        // The value starts after "c=IN IP4 "; stop at a multicast "/<ttl>" suffix
         char ip_addr[16];
-        if (sscanf(c_line + 9, "%15s", ip_addr) == 1) {
+        if (sscanf(c_line + 9, "%15[0-9.]", ip_addr) == 1) {
             // Store the multicast destination IP
             strncpy(announcement->multicast_ip, ip_addr, sizeof(announcement->multicast_ip) - 1);
             announcement->multicast_ip[sizeof(announcement->multicast_ip) - 1] = '\0';
             snprintf(announcement->session_info, sizeof(announcement->session_info), "Connection: %s", ip_addr);
         }
     }
+#ifdef CONFIG_RTP_RX_MULTICAST_IPV6
+    else if ((c_line = strstr(sdp, "c=IN IP6 ")) != NULL) {
+        // IPv6 group (RFC 4566): no TTL suffix, but a "/<count>" may follow
+        char ip_addr[46];
+        if (sscanf(c_line + 9, "%45[0-9a-fA-F:.]", ip_addr) == 1) {
+            strncpy(announcement->multicast_ip, ip_addr, sizeof(announcement->multicast_ip) - 1);
+            announcement->multicast_ip[sizeof(announcement->multicast_ip) - 1] = '\0';
+            snprintf(announcement->session_info, sizeof(announcement->session_info), "Connection: %s", ip_addr);
+        }
+    }
+#endif
 
     // Find the audio media description, which is our anchor
     const char *m_audio_line = strstr(sdp, "m=audio");
@@ -575,7 +697,9 @@ static bool parse_sdp_and_get_info(const char *sdp, sap_announcement_t *announce
         return false; // No audio media found, cannot proceed
     }
 
-    sscanf(m_audio_line, "m=audio %hu", &announcement->port);
+    char proto[16] = {0};
+    sscanf(m_audio_line, "m=audio %hu %15s", &announcement->port, proto);
+    announcement->srtp = strncmp(proto, "RTP/SAVP", 8) == 0;
 
     // *** FIX: Isolate the audio media section ***
     // Find the start of the next media description, if any, to define our boundary.
@@ -593,17 +717,90 @@ static bool parse_sdp_and_get_info(const char *sdp, sap_announcement_t *announce
     
     bool found_rtpmap = false;
 
-    // Now, perform your original searches but only within the isolated audio_section
-    if (strstr(audio_section, "a=rtpmap:127 L16/48000/")) {
+    // Linear PCM rtpmap within the isolated audio_section: a=rtpmap:<pt> L<bits>/<rate>[/<channels>]
+    for (const char *rtpmap_line = strstr(audio_section, "a=rtpmap:"); rtpmap_line && !found_rtpmap;
+         rtpmap_line = strstr(rtpmap_line + 9, "a=rtpmap:")) {
+        // Without a channel count the stream is taken as stereo (mono streams are not playable)
+        unsigned int pt = 0, bits = 0, channels = 2;
+        unsigned long rate = 0;
+        if (sscanf(rtpmap_line + 9, "%u L%u/%lu/%u", &pt, &bits, &rate, &channels) < 3 ||
+            !PCM_BIT_DEPTH_VALID(bits) || !PCM_CHANNELS_VALID(channels)) {
+            continue;
+        }
+        if (rate == 44100 || rate == 48000 || rate == 96000 || rate == 192000) {
+            announcement->sample_rate = (uint32_t)rate;
+            announcement->bit_depth = (uint8_t)bits;
+            announcement->channels = (uint8_t)channels;
+            found_rtpmap = true;
+        }
+    }
+
+    // Opus rtpmap (RFC 7587): a=rtpmap:<pt> opus/48000/2, always a 48 kHz clock
+    for (const char *rtpmap_line = strstr(audio_section, "a=rtpmap:"); rtpmap_line && !found_rtpmap;
+         rtpmap_line = strstr(rtpmap_line + 9, "a=rtpmap:")) {
+        unsigned int pt = 0;
+        char encoding[8] = {0};
+        if (sscanf(rtpmap_line + 9, "%u %7[^/]/", &pt, encoding) != 2 ||
+            strcasecmp(encoding, "opus") != 0 || !RTP_PT_DYNAMIC_VALID(pt)) {
+            continue;
+        }
         announcement->sample_rate = 48000;
+        announcement->bit_depth = 16;
+        announcement->channels = 2;
+        announcement->opus_pt = (uint8_t)pt;
         found_rtpmap = true;
-    } else {
-        const char *rtpmap_line = strstr(audio_section, "a=rtpmap:11 L16/");
-        if (rtpmap_line) {
-            if (strstr(rtpmap_line, "44100")) { announcement->sample_rate = 44100; found_rtpmap = true; }
-            else if (strstr(rtpmap_line, "48000")) { announcement->sample_rate = 48000; found_rtpmap = true; }
-            else if (strstr(rtpmap_line, "96000")) { announcement->sample_rate = 96000; found_rtpmap = true; }
-            else if (strstr(rtpmap_line, "192000")) { announcement->sample_rate = 192000; found_rtpmap = true; }
+    }
+
+    // Packet time (a=ptime:<ms>); 0 when not announced
+    const char *ptime_line = strstr(audio_section, "a=ptime:");
+    if (ptime_line) {
+        unsigned int ptime = 0;
+        if (sscanf(ptime_line + 8, "%u", &ptime) == 1 && ptime <= UINT8_MAX) {
+            announcement->ptime_ms = (uint8_t)ptime;
+        }
+    }
+
+    // SDES keys (RFC 4568): a=crypto:<tag> <suite> inline:<key||salt>[|...]; first usable one wins
+    for (const char *crypto_line = strstr(audio_section, "a=crypto:"); crypto_line && announcement->srtp;
+         crypto_line = strstr(crypto_line + 9, "a=crypto:")) {
+        const char *value = strchr(crypto_line + 9, ' ');
+        const char *eol = strpbrk(crypto_line, "\r\n");
+        if (!value || (eol && value > eol)) {
+            continue;
+        }
+        char crypto[sizeof(announcement->srtp_crypto)];
+        copy_sdp_value(crypto, sizeof(crypto), value, 1);
+        if (rtp_srtp_parse(crypto) != RTP_SRTP_NONE) {
+            memcpy(announcement->srtp_crypto, crypto, sizeof(crypto));
+            break;
+        }
+    }
+
+    // Reference clock (RFC 7273), session or media level:
+    //   a=ts-refclk:ptp=IEEE1588-2008:<gm identity>[:<domain>]   a=mediaclk:direct=<offset>
+    const char *refclk_line = strstr(sdp, "a=ts-refclk:ptp=IEEE1588-20");
+    if (refclk_line) {
+        announcement->ptp_clock = true;
+        announcement->ptp_domain = SAP_PTP_DOMAIN_UNSET;
+        const char *eol = strpbrk(refclk_line, "\r\n");
+        // The domain follows a second colon, after the grandmaster identity
+        const char *domain = NULL;
+        int colons = 0;
+        for (const char *c = refclk_line + 16; *c && c != eol; c++) {
+            if (*c == ':' && ++colons == 2) {
+                domain = c + 1;
+            }
+        }
+        unsigned int ptp_domain = 0;
+        if (domain && sscanf(domain, "%u", &ptp_domain) == 1 && ptp_domain <= 127) {
+            announcement->ptp_domain = (uint8_t)ptp_domain;
+        }
+    }
+    const char *mediaclk_line = strstr(sdp, "a=mediaclk:direct=");
+    if (mediaclk_line) {
+        unsigned long offset = 0;
+        if (sscanf(mediaclk_line + 18, "%lu", &offset) == 1) {
+            announcement->mediaclk_offset = (uint32_t)offset;
         }
     }
 
@@ -612,11 +809,125 @@ static bool parse_sdp_and_get_info(const char *sdp, sap_announcement_t *announce
     return found_rtpmap;
 }
 
-static void update_or_add_announcement(sap_announcement_t *new_announcement) {
+// ---- Announcement table (callers hold the mutex) ----
+
+static void table_reset(void) {
+    memset(s_sap_state.announcements, 0, sizeof(sap_announcement_t) * SAP_MAX_ANNOUNCEMENTS);
+    memset(s_sap_state.slots, 0, sizeof(s_sap_state.slots));
+    for (size_t i = 0; i < SAP_HASH_BUCKETS; i++) {
+        s_sap_state.buckets[i] = SAP_NO_SLOT;
+    }
+    s_sap_state.lru_head = SAP_NO_SLOT;
+    s_sap_state.lru_tail = SAP_NO_SLOT;
+    s_sap_state.announcement_count = 0;
+}
+
+static size_t bucket_of(uint32_t origin, uint32_t version) {
+    return ((origin * 2654435761u) ^ version) % SAP_HASH_BUCKETS;
+}
+
+static int find_slot(uint32_t origin, uint32_t version) {
+    for (int i = s_sap_state.buckets[bucket_of(origin, version)]; i != SAP_NO_SLOT;
+         i = s_sap_state.slots[i].hash_next) {
+        if (s_sap_state.slots[i].origin == origin && s_sap_state.slots[i].version == version) {
+            return i;
+        }
+    }
+    return SAP_NO_SLOT;
+}
+
+static void index_insert(int slot, uint32_t origin, uint32_t version) {
+    sap_slot_t *sl = &s_sap_state.slots[slot];
+    size_t b = bucket_of(origin, version);
+    sl->origin = origin;
+    sl->version = version;
+    sl->hash_next = s_sap_state.buckets[b];
+    sl->keyed = true;
+    s_sap_state.buckets[b] = (int16_t)slot;
+}
+
+static void index_remove(int slot) {
+    sap_slot_t *sl = &s_sap_state.slots[slot];
+    if (!sl->keyed) {
+        return;
+    }
+    int16_t *link = &s_sap_state.buckets[bucket_of(sl->origin, sl->version)];
+    while (*link != SAP_NO_SLOT && *link != slot) {
+        link = &s_sap_state.slots[*link].hash_next;
+    }
+    if (*link == slot) {
+        *link = sl->hash_next;
+    }
+    sl->keyed = false;
+}
+
+static void lru_unlink(int slot) {
+    sap_slot_t *sl = &s_sap_state.slots[slot];
+    if (sl->lru_prev != SAP_NO_SLOT) {
+        s_sap_state.slots[sl->lru_prev].lru_next = sl->lru_next;
+    } else {
+        s_sap_state.lru_head = sl->lru_next;
+    }
+    if (sl->lru_next != SAP_NO_SLOT) {
+        s_sap_state.slots[sl->lru_next].lru_prev = sl->lru_prev;
+    } else {
+        s_sap_state.lru_tail = sl->lru_prev;
+    }
+}
+
+static void lru_append(int slot) {
+    sap_slot_t *sl = &s_sap_state.slots[slot];
+    sl->lru_prev = s_sap_state.lru_tail;
+    sl->lru_next = SAP_NO_SLOT;
+    if (s_sap_state.lru_tail != SAP_NO_SLOT) {
+        s_sap_state.slots[s_sap_state.lru_tail].lru_next = (int16_t)slot;
+    } else {
+        s_sap_state.lru_head = (int16_t)slot;
+    }
+    s_sap_state.lru_tail = (int16_t)slot;
+}
+
+/**
+ * @brief Refresh a known announcement from a repeat, without parsing it
+ *
+ * @param deletion The packet is a SAP deletion: expire the entry instead
+ * @param out Receives a copy of the entry when known
+ * @return true if (origin, version) is in the table
+ */
+static bool touch_known_announcement(uint32_t origin, uint32_t version, bool deletion,
+                                     sap_announcement_t *out) {
+    if (s_sap_state.mutex == NULL) {
+        return false;
+    }
+
+    bool known = false;
+    if (xSemaphoreTake(s_sap_state.mutex, portMAX_DELAY) == pdTRUE) {
+        int slot = find_slot(origin, version);
+        if (slot != SAP_NO_SLOT) {
+            sap_announcement_t *a = &s_sap_state.announcements[slot];
+            known = true;
+            if (deletion) {
+                a->active = false;
+            } else {
+                a->last_seen = time(NULL);
+                a->update_count++;
+                a->active = true;
+                lru_unlink(slot);
+                lru_append(slot);
+            }
+            memcpy(out, a, sizeof(*out));
+        }
+        xSemaphoreGive(s_sap_state.mutex);
+    }
+    return known;
+}
+
+// Add a newly parsed announcement; a known session under a new version replaces its entry
+static void update_or_add_announcement(sap_announcement_t *new_announcement, uint32_t origin,
+                                       uint32_t version) {
     if (!new_announcement || strlen(new_announcement->stream_name) == 0) {
         return;
     }
-    ESP_LOGI(TAG, "Adding announcement for %s", new_announcement->stream_name);
     // Check if module has been initialized
     if (s_sap_state.mutex == NULL) {
         ESP_LOGW(TAG, "SAP listener not initialized, cannot update announcements");
@@ -628,65 +939,49 @@ static void update_or_add_announcement(sap_announcement_t *new_announcement) {
         new_announcement->last_seen = current_time;
         new_announcement->active = true;
         
-        // Check if announcement already exists
-        bool found = false;
-        for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS; i++) {
-            if (strcmp(s_sap_state.announcements[i].stream_name, new_announcement->stream_name) == 0) {
-                // Update existing announcement
-                s_sap_state.announcements[i].last_seen = current_time;
-                s_sap_state.announcements[i].update_count++;
-                s_sap_state.announcements[i].sample_rate = new_announcement->sample_rate;
-                s_sap_state.announcements[i].port = new_announcement->port;
-                s_sap_state.announcements[i].active = true;
-                strncpy(s_sap_state.announcements[i].source_ip, new_announcement->source_ip,
-                        sizeof(s_sap_state.announcements[i].source_ip));
-                strncpy(s_sap_state.announcements[i].multicast_ip, new_announcement->multicast_ip,
-                        sizeof(s_sap_state.announcements[i].multicast_ip));
-                found = true;
-                ESP_LOGI(TAG, "Updated SAP announcement: %s (count=%lu)",
-                        new_announcement->stream_name, s_sap_state.announcements[i].update_count);
-                break;
-            }
-        }
-        
-        if (!found) {
-            // Find slot for new announcement
-            int slot = -1;
-            
-            // First, try to find an expired/inactive slot
-            for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS; i++) {
-                if (!s_sap_state.announcements[i].active || 
-                    strlen(s_sap_state.announcements[i].stream_name) == 0) {
-                    slot = i;
+        // Same session from the same origin under an older version (the SDP
+        // changed). Only new versions get here, so this scan is off the repeat path.
+        int slot = find_slot(origin, version);
+        if (slot == SAP_NO_SLOT) {
+            for (size_t i = 0; i < s_sap_state.announcement_count; i++) {
+                if (s_sap_state.slots[i].origin == origin &&
+                    strcmp(s_sap_state.announcements[i].stream_name, new_announcement->stream_name) == 0) {
+                    slot = (int)i;
                     break;
                 }
             }
-            
-            // If no expired slot, find the oldest one
-            if (slot == -1) {
-                time_t oldest_time = current_time;
-                for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS; i++) {
-                    if (s_sap_state.announcements[i].last_seen < oldest_time) {
-                        oldest_time = s_sap_state.announcements[i].last_seen;
-                        slot = i;
-                    }
-                }
-            }
-
-            if (s_sap_state.announcement_count < SAP_MAX_ANNOUNCEMENTS)
-                s_sap_state.announcement_count++;
-            
-            // Add new announcement
-            if (slot >= 0) {
-                new_announcement->first_seen = current_time;
-                new_announcement->update_count = 1;
-                memcpy(&s_sap_state.announcements[slot], new_announcement, sizeof(sap_announcement_t));
-                ESP_LOGI(TAG, "Added new SAP announcement: %s at %dHz from %s (multicast: %s:%d)",
-                        new_announcement->stream_name, new_announcement->sample_rate,
-                        new_announcement->source_ip, new_announcement->multicast_ip,
-                        new_announcement->port);
+        }
+        
+        if (slot != SAP_NO_SLOT) {
+            // Update existing announcement
+            sap_announcement_t *a = &s_sap_state.announcements[slot];
+            new_announcement->first_seen = a->first_seen;
+            new_announcement->update_count = a->update_count + 1;
+            memcpy(a, new_announcement, sizeof(*a));
+            index_remove(slot);
+            lru_unlink(slot);
+            ESP_LOGI(TAG, "Updated SAP announcement: %s (count=%lu)",
+                    new_announcement->stream_name, a->update_count);
+        } else {
+            if (s_sap_state.announcement_count < SAP_MAX_ANNOUNCEMENTS) {
+                slot = (int)s_sap_state.announcement_count++;
+            } else {
+                // Table full: the least recently seen entry (expired ones first) makes room
+                slot = s_sap_state.lru_head;
+                ESP_LOGI(TAG, "SAP table full, dropping %s", s_sap_state.announcements[slot].stream_name);
+                index_remove(slot);
+                lru_unlink(slot);
             }
+            new_announcement->first_seen = current_time;
+            new_announcement->update_count = 1;
+            memcpy(&s_sap_state.announcements[slot], new_announcement, sizeof(sap_announcement_t));
+            ESP_LOGI(TAG, "Added new SAP announcement: %s at %luHz from %s (multicast: %s:%d)",
+                    new_announcement->stream_name, new_announcement->sample_rate,
+                    new_announcement->source_ip, new_announcement->multicast_ip,
+                    new_announcement->port);
         }
+        index_insert(slot, origin, version);
+        lru_append(slot);
         
         xSemaphoreGive(s_sap_state.mutex);
     }
@@ -703,15 +998,18 @@ static void cleanup_expired_announcements(void) {
         time_t current_time = time(NULL);
         size_t expired_count = 0;
         
-        for (size_t i = 0; i < SAP_MAX_ANNOUNCEMENTS; i++) {
-            if (s_sap_state.announcements[i].active) {
-                time_t age = current_time - s_sap_state.announcements[i].last_seen;
-                if (age > s_sap_state.timeout_seconds) {
-                    s_sap_state.announcements[i].active = false;
-                    expired_count++;
-                    ESP_LOGI(TAG, "SAP announcement expired: %s (age=%ld seconds)",
-                            s_sap_state.announcements[i].stream_name, age);
-                }
+        // Oldest first: stop at the first entry still within the timeout
+        for (int i = s_sap_state.lru_head; i != SAP_NO_SLOT; i = s_sap_state.slots[i].lru_next) {
+            sap_announcement_t *a = &s_sap_state.announcements[i];
+            time_t age = current_time - a->last_seen;
+            if (age <= s_sap_state.timeout_seconds) {
+                break;
+            }
+            if (a->active) {
+                a->active = false;
+                expired_count++;
+                ESP_LOGI(TAG, "SAP announcement expired: %s (age=%ld seconds)",
+                        a->stream_name, age);
             }
         }
         
@@ -16,14 +16,25 @@
 #define SAP_MULTICAST_ADDR_PULSEAUDIO CONFIG_SAP_PULSEAUDIO_ADDR
 #define SAP_BUFFER_SIZE CONFIG_SAP_BUFFER_SIZE
 
+#define SAP_PTP_DOMAIN_UNSET 0xFF
+
 /**
  * @brief SAP announcement structure with expiration tracking
  */
 typedef struct {
     char stream_name[64];        // Stream/session name from SDP
     char source_ip[16];          // Source IP address of the sender
-    char multicast_ip[16];       // Multicast destination IP from SDP c= line
+    char multicast_ip[46];       // Multicast destination IP from SDP c= line (IPv4 or IPv6)
     uint32_t sample_rate;        // Detected sample rate
+    uint8_t bit_depth;           // Sample width from the rtpmap encoding (L16/L24/L32)
+    uint8_t channels;            // Channel count from the rtpmap encoding (0 if no rtpmap)
+    uint8_t opus_pt;             // Payload type of an Opus rtpmap (0 for linear PCM)
+    uint8_t ptime_ms;            // Packet time from a=ptime (0 if not announced)
+    bool ptp_clock;              // a=ts-refclk:ptp=IEEE1588-2008 (AES67): RTP timestamps are PTP time
+    uint8_t ptp_domain;          // PTP domain named in a=ts-refclk (SAP_PTP_DOMAIN_UNSET if not given)
+    uint32_t mediaclk_offset;    // a=mediaclk:direct=<offset>: RTP timestamp at PTP time zero
+    bool srtp;                   // m= line profile is RTP/SAVP (or SAVPF)
+    char srtp_crypto[96];        // First a=crypto value with a supported suite, after its tag (empty if none)
     uint16_t port;               // RTP port
     time_t last_seen;            // Last time this announcement was received
     time_t first_seen;           // First time this announcement was seen
@@ -77,6 +88,25 @@ size_t sap_listener_get_active_announcements(sap_announcement_t* announcements,
  */
 const sap_announcement_t* sap_listener_get_all_announcements(size_t *count);
 
+/**
+ * @brief Announcement visitor for sap_listener_foreach()
+ * @return true to continue, false to stop
+ */
+typedef bool (*sap_announcement_visit_t)(const sap_announcement_t *announcement, void *ctx);
+
+/**
+ * @brief Visit announcements in place, without copying them out
+ *
+ * Runs under the listener lock: the visitor must be quick and must not call
+ * back into the SAP listener.
+ *
+ * @param active_only Skip expired announcements
+ * @param visit Called for each announcement
+ * @param ctx Passed to visit
+ * @return Number of announcements visited
+ */
+size_t sap_listener_foreach(bool active_only, sap_announcement_visit_t visit, void *ctx);
+
 /**
  * @brief Get a specific announcement by stream name
  * @param stream_name Name of the stream to find
@@ -0,0 +1,268 @@
+#include "stream_switch.h"
+#include "audio_out.h"
+#include "global.h"
+#include "lifecycle_manager.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+/*
+ * The producer fills the chunk at `head` in place (it doubles as the
+ * repackaging accumulator) and publishes it by advancing head; the consumer
+ * plays from `tail`. State moves forward by CAS only, so a cancel from the
+ * control task is never overwritten by either side's next step.
+ */
+
+#define SWITCH_DEPTH CONFIG_RX_SWITCH_QUEUE_CHUNKS
+
+static uint8_t *queue_memory = NULL;
+static uint64_t playout_us[SWITCH_DEPTH];
+static uint64_t arrival_us[SWITCH_DEPTH];
+static uint32_t sample_rate[SWITCH_DEPTH];
+static atomic_uint_fast32_t head = 0;
+static atomic_uint_fast32_t tail = 0;
+static atomic_int state = STREAM_SWITCH_IDLE;
+static uint32_t chunk_bytes = 0;
+static uint32_t chunk_us = 0;
+static uint32_t prebuffer_chunks = 0;  // Queue depth that ends PREBUFFER (set by begin)
+
+// Producer-only
+static uint32_t fill = 0;              // Bytes accumulated in the chunk at head
+
+// Consumer-only
+static uint32_t fade_chunks = 0;       // Chunks the cross-fade spans
+static uint32_t fade_pos = 0;          // Chunks faded so far (reset by begin)
+static bool holds_chunk = false;       // stream_switch_pop() handed out the chunk at tail
+static packet_with_ts_t out_packet;
+
+static atomic_uint_fast32_t stat_switches = 0;
+static atomic_uint_fast32_t stat_aborted  = 0;
+static atomic_uint_fast32_t stat_overflow = 0;
+
+esp_err_t stream_switch_setup(void) {
+    uint32_t bytes = buffer_get_chunk_size();
+    uint32_t bytes_per_sec = lifecycle_get_sample_rate() * 2u * (audio_out_sample_bits() / 8u);
+
+    atomic_store(&state, STREAM_SWITCH_IDLE);
+    if (queue_memory) {
+        heap_caps_free(queue_memory);
+        queue_memory = NULL;
+    }
+    chunk_bytes = 0;
+
+    if (audio_out_sample_bits() != 16) {
+        // The cross-fade works on 16-bit samples
+        ESP_LOGW(TAG, "Gapless switching needs 16-bit playout, switching immediately at %u bits",
+                 (unsigned)audio_out_sample_bits());
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    size_t total = (size_t)bytes * SWITCH_DEPTH;
+    uint8_t *mem = heap_caps_malloc(total, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+        mem = heap_caps_malloc(total, MALLOC_CAP_8BIT);
+    }
+    if (!mem) {
+        ESP_LOGE(TAG, "Failed to allocate switch queue (%u bytes)", (unsigned)total);
+        return ESP_ERR_NO_MEM;
+    }
+
+    queue_memory = mem;
+    chunk_bytes = bytes;
+    chunk_us = bytes_per_sec ? (uint32_t)(((uint64_t)bytes * 1000000ULL) / bytes_per_sec) : 0;
+    fade_chunks = chunk_us ? ((uint32_t)CONFIG_RX_SWITCH_FADE_MS * 1000u + chunk_us - 1u) / chunk_us : 0;
+    holds_chunk = false;
+
+    ESP_LOGI(TAG, "Gapless switch: %d chunks queued at most (%u KB), %u-chunk fade",
+             SWITCH_DEPTH, (unsigned)(total / 1024u), (unsigned)fade_chunks);
+    return ESP_OK;
+}
+
+bool stream_switch_available(void) {
+    return queue_memory && chunk_bytes > 0;
+}
+
+bool stream_switch_begin(void) {
+    if (!stream_switch_available() || atomic_load(&state) != STREAM_SWITCH_IDLE) {
+        return false;
+    }
+    uint32_t target = buffer_get_target_size();
+    if (target > SWITCH_DEPTH - 2u) {
+        target = SWITCH_DEPTH - 2u;
+    }
+    prebuffer_chunks = target > 0 ? target : 1u;
+    atomic_store(&head, 0);
+    atomic_store(&tail, 0);
+    fill = 0;
+    fade_pos = 0;
+    atomic_store_explicit(&state, STREAM_SWITCH_PREBUFFER, memory_order_release);
+    ESP_LOGI(TAG, "Switch: prebuffering %u chunks of the new group", (unsigned)prebuffer_chunks);
+    return true;
+}
+
+void stream_switch_cancel(void) {
+    int prev = atomic_exchange(&state, STREAM_SWITCH_IDLE);
+    if (prev == STREAM_SWITCH_PREBUFFER || prev == STREAM_SWITCH_FADE) {
+        atomic_fetch_add_explicit(&stat_aborted, 1, memory_order_relaxed);
+    }
+}
+
+stream_switch_state_t stream_switch_get_state(void) {
+    return (stream_switch_state_t)atomic_load_explicit(&state, memory_order_acquire);
+}
+
+bool stream_switch_advance(stream_switch_state_t from, stream_switch_state_t to) {
+    int expected = from;
+    return atomic_compare_exchange_strong(&state, &expected, to);
+}
+
+void stream_switch_push(const uint8_t *pcm, size_t len, uint64_t playout) {
+    if (!stream_switch_available()) {
+        return;
+    }
+
+    size_t offset = 0;
+    while (offset < len) {
+        uint32_t h = atomic_load_explicit(&head, memory_order_relaxed);
+        uint32_t t = atomic_load_explicit(&tail, memory_order_acquire);
+        if (h - t >= SWITCH_DEPTH) {
+            // Output isn't taking the queue yet (or has stalled); drop the rest of this payload
+            atomic_fetch_add_explicit(&stat_overflow, 1, memory_order_relaxed);
+            fill = 0;
+            return;
+        }
+
+        uint32_t idx = h % SWITCH_DEPTH;
+        if (fill == 0) {
+            playout_us[idx] = playout + ((uint64_t)offset * chunk_us) / chunk_bytes;
+            arrival_us[idx] = (uint64_t)esp_timer_get_time();
+            sample_rate[idx] = buffer_get_stream_rate();
+        }
+        size_t to_copy = chunk_bytes - fill;
+        if (to_copy > len - offset) {
+            to_copy = len - offset;
+        }
+        memcpy(queue_memory + (size_t)idx * chunk_bytes + fill, pcm + offset, to_copy);
+        fill += (uint32_t)to_copy;
+        offset += to_copy;
+
+        if (fill == chunk_bytes) {
+            fill = 0;
+            atomic_store_explicit(&head, h + 1, memory_order_release);
+            if (h + 1 - t >= prebuffer_chunks &&
+                stream_switch_advance(STREAM_SWITCH_PREBUFFER, STREAM_SWITCH_FADE)) {
+                ESP_LOGI(TAG, "Switch: new group prebuffered, fading over");
+            }
+        }
+    }
+}
+
+bool stream_switch_at_boundary(void) {
+    return fill == 0;
+}
+
+void stream_switch_mix(uint8_t *chunk, size_t len) {
+    if (stream_switch_get_state() != STREAM_SWITCH_FADE || len != chunk_bytes) {
+        return;
+    }
+
+    uint32_t t = atomic_load_explicit(&tail, memory_order_relaxed);
+    uint32_t h = atomic_load_explicit(&head, memory_order_acquire);
+    if (t == h) {
+        // New group is behind; hold the fade where it is until it catches up
+        return;
+    }
+    const int16_t *in = (const int16_t *)(queue_memory + (size_t)(t % SWITCH_DEPTH) * chunk_bytes);
+    int16_t *out = (int16_t *)chunk;
+    const uint32_t frames = (uint32_t)len / (2u * sizeof(int16_t));
+    const uint32_t total = fade_chunks * frames;
+
+    for (uint32_t i = 0; i < frames; i++) {
+        // Linear ramp in Q15, one gain step per frame across the whole fade
+        int32_t g = total ? (int32_t)(((uint64_t)(fade_pos * frames + i) << 15) / total) : 32768;
+        for (uint32_t c = 0; c < 2u; c++) {
+            int32_t a = out[2u * i + c];
+            int32_t b = in[2u * i + c];
+            out[2u * i + c] = (int16_t)((a * (32768 - g) + b * g) >> 15);
+        }
+    }
+    atomic_store_explicit(&tail, t + 1, memory_order_release);
+
+    if (++fade_pos >= fade_chunks && stream_switch_advance(STREAM_SWITCH_FADE, STREAM_SWITCH_HANDOVER)) {
+        ESP_LOGI(TAG, "Switch: fade done, playing the new group");
+    }
+}
+
+// Consumer: give the chunk from the last stream_switch_pop() back to the producer
+static void release_chunk(void) {
+    if (holds_chunk) {
+        holds_chunk = false;
+        atomic_store_explicit(&tail, atomic_load_explicit(&tail, memory_order_relaxed) + 1,
+                              memory_order_release);
+    }
+}
+
+bool stream_switch_playing(void) {
+    stream_switch_state_t s = stream_switch_get_state();
+
+    if (s == STREAM_SWITCH_FADE && buffer_is_underrun()) {
+        // Old group ran dry mid-fade: nothing left to fade from
+        if (stream_switch_advance(STREAM_SWITCH_FADE, STREAM_SWITCH_HANDOVER)) {
+            s = STREAM_SWITCH_HANDOVER;
+        }
+    }
+    if (s == STREAM_SWITCH_FLUSH) {
+        // Old group is gone; what is left of it in the ring is never played
+        buffer_restart();
+        if (stream_switch_advance(STREAM_SWITCH_FLUSH, STREAM_SWITCH_REFILL)) {
+            s = STREAM_SWITCH_REFILL;
+        }
+    }
+    if (s == STREAM_SWITCH_DRAIN) {
+        release_chunk();
+        if (atomic_load_explicit(&tail, memory_order_relaxed) == atomic_load_explicit(&head, memory_order_acquire)) {
+            // Queue played out up to the chunk the ring starts with
+            if (stream_switch_advance(STREAM_SWITCH_DRAIN, STREAM_SWITCH_IDLE)) {
+                atomic_fetch_add_explicit(&stat_switches, 1, memory_order_relaxed);
+                ESP_LOGI(TAG, "Switch: complete, ring holds %u chunks", (unsigned)buffer_get_fill_level());
+            }
+            return false;
+        }
+    }
+    if (s < STREAM_SWITCH_HANDOVER) {
+        release_chunk();
+        return false;
+    }
+    return true;
+}
+
+packet_with_ts_t *stream_switch_pop(void) {
+    release_chunk();
+
+    uint32_t t = atomic_load_explicit(&tail, memory_order_relaxed);
+    if (t == atomic_load_explicit(&head, memory_order_acquire)) {
+        return NULL;
+    }
+    uint32_t idx = t % SWITCH_DEPTH;
+    out_packet.packet_buffer = queue_memory + (size_t)idx * chunk_bytes;
+    out_packet.timestamp = playout_us[idx];
+    out_packet.skip_bytes = 0;
+    out_packet.flags = 0;
+    out_packet.arrival_us = arrival_us[idx];
+    out_packet.capture_us = 0;
+    out_packet.sample_rate = sample_rate[idx];
+    holds_chunk = true;
+    buffer_wait_until(out_packet.timestamp);
+    return &out_packet;
+}
+
+void stream_switch_get_stats(stream_switch_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->switches = atomic_load_explicit(&stat_switches, memory_order_relaxed);
+    stats->aborted = atomic_load_explicit(&stat_aborted, memory_order_relaxed);
+    stats->overflow = atomic_load_explicit(&stat_overflow, memory_order_relaxed);
+}
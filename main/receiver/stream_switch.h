@@ -0,0 +1,110 @@
+#pragma once
+
+#include "esp_err.h"
+#include "buffer.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Gapless multicast stream switching (CONFIG_RX_GAPLESS_SWITCH).
+ *
+ * A switch joins the new group on a second socket while the old one keeps
+ * playing. The receive task queues the new group's audio here, in arrival
+ * order, until it holds the jitter buffer's target depth; the PCM handler
+ * then cross-fades from the ring to the queue over CONFIG_RX_SWITCH_FADE_MS,
+ * always at a chunk boundary. After the fade the queue is the output while
+ * the old group is left, the ring emptied and refilled by the new group
+ * (which takes about as long as the queue lasts), so playout continues
+ * without rebuffering.
+ *
+ * Producer is the UDP receive task, consumer is the PCM handler; the queue
+ * is an SPSC FIFO of chunks like the overlay mixer's.
+ */
+
+typedef enum {
+    STREAM_SWITCH_IDLE = 0,
+    STREAM_SWITCH_PREBUFFER,  // New group joined, its chunks queue up (producer)
+    STREAM_SWITCH_FADE,       // Output cross-fades from the ring to the queue (consumer)
+    STREAM_SWITCH_HANDOVER,   // Queue is the output; old group to be left (producer)
+    STREAM_SWITCH_FLUSH,      // Old group left; ring to be emptied (consumer)
+    STREAM_SWITCH_REFILL,     // Ring empty; new group to be routed into it (producer)
+    STREAM_SWITCH_DRAIN,      // New group fills the ring while the queue plays out (consumer)
+} stream_switch_state_t;
+
+// Gapless switch counters
+typedef struct {
+    uint32_t switches;  // Switches that reached the new group without rebuffering
+    uint32_t aborted;   // Switches abandoned (timeout, leave) before the fade finished
+    uint32_t overflow;  // Chunks dropped because the queue was full
+} stream_switch_stats_t;
+
+/**
+ * @brief Size the queue for the current chunk size
+ *
+ * Call after setup_buffer() when starting a receiver mode.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED unless playout is 16-bit,
+ *         ESP_ERR_NO_MEM if the queue could not be allocated
+ */
+esp_err_t stream_switch_setup(void);
+
+// Whether a switch can be faded (queue set up); otherwise switches are immediate
+bool stream_switch_available(void);
+
+/**
+ * @brief Start prebuffering a new group (control task, state must be IDLE)
+ *
+ * @return true if the switch started
+ */
+bool stream_switch_begin(void);
+
+// Abandon a switch in any state (the consumer falls back to the ring)
+void stream_switch_cancel(void);
+
+stream_switch_state_t stream_switch_get_state(void);
+
+// Move from `from` to `to` unless the switch was cancelled meanwhile
+bool stream_switch_advance(stream_switch_state_t from, stream_switch_state_t to);
+
+/**
+ * @brief Queue audio from the new group (producer only)
+ *
+ * Payloads of any length are repackaged into chunks. Reaching the
+ * prebuffer depth moves PREBUFFER to FADE.
+ *
+ * @param pcm Host-order interleaved PCM in the playout sample width
+ * @param len Payload length in bytes (whole frames)
+ * @param playout_us Playout time of the first frame (esp_timer_get_time() domain)
+ */
+void stream_switch_push(const uint8_t *pcm, size_t len, uint64_t playout_us);
+
+// No partial chunk pending: the next payload starts a chunk (producer only)
+bool stream_switch_at_boundary(void);
+
+/**
+ * @brief Cross-fade the queue into a ring chunk during FADE (consumer only)
+ *
+ * @param chunk Ring chunk (host order), faded in place
+ * @param len Chunk length in bytes
+ */
+void stream_switch_mix(uint8_t *chunk, size_t len);
+
+/**
+ * @brief Whether the queue rather than the ring feeds the output (consumer only)
+ *
+ * Also runs the consumer's side of the switch: emptying the ring once the
+ * old group is gone, and returning to the ring when the queue has played out.
+ */
+bool stream_switch_playing(void);
+
+/**
+ * @brief Next queued chunk, released on the next call (consumer only)
+ *
+ * Blocks until the chunk's playout time like pop_chunk().
+ *
+ * @return The chunk, or NULL if the queue is empty
+ */
+packet_with_ts_t *stream_switch_pop(void);
+
+void stream_switch_get_stats(stream_switch_stats_t *stats);
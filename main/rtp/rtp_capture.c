@@ -0,0 +1,340 @@
+#include "rtp_capture.h"
+#include "build_config.h"
+#include <string.h>
+
+#ifdef CONFIG_RTP_CAPTURE_ENABLED
+#include "lifecycle/net_iface.h"
+#include "esp_heap_caps.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+static const char *TAG = "rtp_capture";
+
+#define PCAP_MAGIC_US     0xA1B2C3D4u
+#define PCAP_LINKTYPE_IPV4 228
+#define CAPTURE_IP_UDP_SIZE 28      // Rebuilt IPv4 (20) and UDP (8) headers
+
+// Slot header; the first cap_len bytes of the datagram follow it
+typedef struct {
+    uint32_t seq;                   // Capture index + 1, so a reader can tell it was overwritten
+    int64_t t_us;                   // esp_timer_get_time()
+    uint32_t src_addr;              // Network byte order, 0: this device
+    uint32_t dst_addr;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t orig_len;              // Datagram length
+    uint16_t cap_len;
+    uint8_t flags;                  // RTP_CAPTURE_TX / RTP_CAPTURE_RTCP
+} capture_slot_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+} pcap_file_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+    uint8_t ip[20];
+    uint16_t udp_sport;
+    uint16_t udp_dport;
+    uint16_t udp_len;
+    uint16_t udp_sum;
+} pcap_record_header_t;
+
+atomic_bool rtp_capture_armed = false;
+
+// The ring's geometry and contents are under s_lock: writers only try it, the reader waits
+static SemaphoreHandle_t s_lock = NULL;
+static uint8_t *s_ring = NULL;
+static bool s_in_psram = false;
+static uint32_t s_stride = 0;       // Bytes per slot
+static uint32_t s_slots = 0;
+static uint32_t s_written = 0;      // Packets recorded since the last start
+static uint32_t s_generation = 0;   // Bumped by every start, so a download notices one
+static uint32_t s_ssrc = 0;
+static uint16_t s_port = 0;
+static uint16_t s_snaplen = 0;
+static atomic_uint_fast32_t s_dropped = 0;
+
+static uint32_t capture_local_addr(void) {
+    esp_netif_ip_info_t ip_info = { 0 };
+    esp_netif_t *netif = net_iface_primary();
+    if (netif) {
+        esp_netif_get_ip_info(netif, &ip_info);
+    }
+    return ip_info.ip.addr;
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void rtp_capture_add(uint8_t flags, const void *head, size_t head_len, const void *body, size_t body_len,
+                     uint32_t src_addr, uint16_t src_port, uint32_t dst_addr, uint16_t dst_port) {
+    // Filters first, without the lock: they only change while disarmed
+    if (s_port != 0 && src_port != s_port && dst_port != s_port) {
+        return;
+    }
+    if (s_ssrc != 0) {
+        // RTP carries its SSRC at byte 8, RTCP the sender's at byte 4
+        size_t at = (flags & RTP_CAPTURE_RTCP) ? 4 : 8;
+        if (head_len < at + 4 || read_be32((const uint8_t *)head + at) != s_ssrc) {
+            return;
+        }
+    }
+    int64_t now = esp_timer_get_time();
+    if (xSemaphoreTake(s_lock, 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t index = s_written++;
+    capture_slot_t *slot = (capture_slot_t *)(s_ring + (size_t)(index % s_slots) * s_stride);
+    size_t total = head_len + body_len;
+    size_t cap = total < s_snaplen ? total : s_snaplen;
+    size_t from_head = cap < head_len ? cap : head_len;
+    uint8_t *data = (uint8_t *)(slot + 1);
+    memcpy(data, head, from_head);
+    if (cap > from_head) {
+        memcpy(data + from_head, body, cap - from_head);
+    }
+    slot->t_us = now;
+    slot->src_addr = src_addr;
+    slot->dst_addr = dst_addr;
+    slot->src_port = src_port;
+    slot->dst_port = dst_port;
+    slot->orig_len = (uint16_t)(total < UINT16_MAX ? total : UINT16_MAX);
+    slot->cap_len = (uint16_t)cap;
+    slot->flags = flags;
+    slot->seq = index + 1;
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t rtp_capture_start(uint32_t ssrc, uint16_t port, uint16_t snaplen) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (!s_ring) {
+        const size_t bytes = (size_t)CONFIG_RTP_CAPTURE_RING_KB * 1024u;
+#ifndef CONFIG_RTP_CAPTURE_INTERNAL
+        s_ring = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        s_in_psram = s_ring != NULL;
+#endif
+        if (!s_ring) {
+            s_ring = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if (!s_ring) {
+            ESP_LOGE(TAG, "No memory for a %d KB capture ring", CONFIG_RTP_CAPTURE_RING_KB);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (snaplen == 0) {
+        snaplen = CONFIG_RTP_CAPTURE_SNAPLEN;
+    }
+    if (snaplen < RTP_CAPTURE_SNAPLEN_MIN) {
+        snaplen = RTP_CAPTURE_SNAPLEN_MIN;
+    } else if (snaplen > RTP_CAPTURE_SNAPLEN_MAX) {
+        snaplen = RTP_CAPTURE_SNAPLEN_MAX;
+    }
+
+    atomic_store(&rtp_capture_armed, false);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stride = (uint32_t)((sizeof(capture_slot_t) + snaplen + 7u) & ~7u);
+    s_slots = (uint32_t)(((size_t)CONFIG_RTP_CAPTURE_RING_KB * 1024u) / s_stride);
+    s_written = 0;
+    s_generation++;
+    s_ssrc = ssrc;
+    s_port = port;
+    s_snaplen = snaplen;
+    atomic_store(&s_dropped, 0);
+    xSemaphoreGive(s_lock);
+    atomic_store(&rtp_capture_armed, true);
+
+    ESP_LOGI(TAG, "Capturing %u bytes of each packet, %lu packets kept (%s), SSRC %08lx, port %u",
+             snaplen, (unsigned long)s_slots, s_in_psram ? "PSRAM" : "internal RAM",
+             (unsigned long)ssrc, port);
+    return ESP_OK;
+}
+
+void rtp_capture_stop(void) {
+    if (atomic_exchange(&rtp_capture_armed, false)) {
+        ESP_LOGI(TAG, "Capture stopped after %lu packets", (unsigned long)s_written);
+    }
+}
+
+void rtp_capture_get_status(rtp_capture_status_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->armed = atomic_load(&rtp_capture_armed);
+    if (!s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    out->ssrc = s_ssrc;
+    out->port = s_port;
+    out->snaplen = s_snaplen;
+    out->slots = s_slots;
+    out->captured = s_written;
+    out->in_psram = s_in_psram;
+    xSemaphoreGive(s_lock);
+    out->dropped = atomic_load_explicit(&s_dropped, memory_order_relaxed);
+}
+
+static uint16_t ip_checksum(const uint8_t *hdr, size_t len) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += ((uint32_t)hdr[i] << 8) | hdr[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+// pcap record header plus the IPv4 and UDP headers the datagram had on the wire
+static void build_record_header(pcap_record_header_t *rec, const capture_slot_t *slot, uint32_t index,
+                                int64_t wall_offset_us, uint32_t local_addr) {
+    int64_t wall_us = slot->t_us + wall_offset_us;
+    rec->ts_sec = (uint32_t)(wall_us / 1000000);
+    rec->ts_usec = (uint32_t)(wall_us % 1000000);
+    rec->incl_len = CAPTURE_IP_UDP_SIZE + slot->cap_len;
+    rec->orig_len = CAPTURE_IP_UDP_SIZE + slot->orig_len;
+
+    uint16_t ip_len = (uint16_t)(rec->orig_len < UINT16_MAX ? rec->orig_len : UINT16_MAX);
+    uint32_t src = slot->src_addr ? slot->src_addr : local_addr;
+    uint32_t dst = slot->dst_addr ? slot->dst_addr : local_addr;
+    uint8_t *ip = rec->ip;
+    ip[0] = 0x45;                       // IPv4, 20-byte header
+    ip[1] = 0;
+    ip[2] = (uint8_t)(ip_len >> 8);
+    ip[3] = (uint8_t)ip_len;
+    ip[4] = (uint8_t)(index >> 8);      // Identification
+    ip[5] = (uint8_t)index;
+    ip[6] = 0x40;                       // Don't fragment
+    ip[7] = 0;
+    ip[8] = 64;                         // TTL
+    ip[9] = 17;                         // UDP
+    ip[10] = 0;
+    ip[11] = 0;
+    memcpy(&ip[12], &src, 4);
+    memcpy(&ip[16], &dst, 4);
+    uint16_t sum = ip_checksum(ip, 20);
+    ip[10] = (uint8_t)(sum >> 8);
+    ip[11] = (uint8_t)sum;
+
+    rec->udp_sport = htons(slot->src_port);
+    rec->udp_dport = htons(slot->dst_port);
+    rec->udp_len = htons((uint16_t)(slot->orig_len + 8 < UINT16_MAX ? slot->orig_len + 8 : UINT16_MAX));
+    rec->udp_sum = 0;                   // Optional over IPv4
+}
+
+esp_err_t rtp_capture_write_pcap(rtp_capture_write_fn write, void *ctx) {
+    if (!s_lock || !s_ring) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t generation = s_generation;
+    uint32_t end = s_written;
+    uint32_t slots = s_slots;
+    uint32_t stride = s_stride;
+    uint16_t snaplen = s_snaplen;
+    xSemaphoreGive(s_lock);
+
+    // One slot at a time is copied out under the lock, then written without it
+    capture_slot_t *copy = malloc(stride);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // esp_timer time to wall clock (1970 plus the uptime until SNTP has set it)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t wall_offset_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - esp_timer_get_time();
+    uint32_t local_addr = capture_local_addr();
+
+    const pcap_file_header_t file_header = {
+        .magic = PCAP_MAGIC_US,
+        .version_major = 2,
+        .version_minor = 4,
+        .thiszone = 0,
+        .sigfigs = 0,
+        .snaplen = CAPTURE_IP_UDP_SIZE + snaplen,
+        .network = PCAP_LINKTYPE_IPV4,
+    };
+    esp_err_t ret = write(ctx, &file_header, sizeof(file_header));
+
+    uint32_t sent = 0;
+    uint32_t skipped = 0;
+    for (uint32_t i = end > slots ? end - slots : 0; ret == ESP_OK && i < end; i++) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        if (s_generation != generation) {
+            // Restarted under us: what is left belongs to another capture
+            xSemaphoreGive(s_lock);
+            break;
+        }
+        const capture_slot_t *slot = (const capture_slot_t *)(s_ring + (size_t)(i % slots) * stride);
+        bool current = slot->seq == i + 1;
+        if (current) {
+            memcpy(copy, slot, sizeof(*slot) + slot->cap_len);
+        }
+        xSemaphoreGive(s_lock);
+        if (!current) {
+            skipped++;
+            continue;
+        }
+
+        pcap_record_header_t rec;
+        build_record_header(&rec, copy, i, wall_offset_us, local_addr);
+        ret = write(ctx, &rec, sizeof(rec));
+        if (ret == ESP_OK && copy->cap_len > 0) {
+            ret = write(ctx, copy + 1, copy->cap_len);
+        }
+        sent++;
+    }
+    free(copy);
+
+    ESP_LOGI(TAG, "pcap: %lu packets written, %lu overwritten during the download",
+             (unsigned long)sent, (unsigned long)skipped);
+    return ret;
+}
+
+#else
+
+esp_err_t rtp_capture_start(uint32_t ssrc, uint16_t port, uint16_t snaplen) {
+    (void)ssrc;
+    (void)port;
+    (void)snaplen;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void rtp_capture_stop(void) {
+}
+
+void rtp_capture_get_status(rtp_capture_status_t *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+esp_err_t rtp_capture_write_pcap(rtp_capture_write_fn write, void *ctx) {
+    (void)write;
+    (void)ctx;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Packet capture of the RTP and RTCP traffic (CONFIG_RTP_CAPTURE_ENABLED).
+ *
+ * While armed, the receive loop and the senders record each packet they take
+ * from or put on the network into a ring of fixed-size slots: the first
+ * snaplen bytes of the UDP payload (64 is all the headers, bigger for the
+ * payload too), its length, both endpoints and the esp_timer time. The ring
+ * is allocated at the first arm, in PSRAM unless RTP_CAPTURE_INTERNAL, and
+ * keeps the newest packets. GET /api/capture.pcap streams it as a pcap file
+ * (LINKTYPE_IPV4, with IPv4 and UDP headers rebuilt from the endpoints).
+ *
+ * Disarmed, a hook costs one relaxed load. An SSRC and a port filter drop
+ * other packets before the ring is touched. A writer never waits: a packet
+ * that arrives while another task holds the ring is counted as dropped.
+ */
+
+#define RTP_CAPTURE_TX    0x01      // Sent by this device (else received)
+#define RTP_CAPTURE_RTCP  0x02
+
+#define RTP_CAPTURE_SNAPLEN_MIN 16
+#define RTP_CAPTURE_SNAPLEN_MAX 1472  // A whole datagram on a 1500-byte MTU
+
+typedef struct {
+    bool armed;
+    uint32_t ssrc;          // Filter, 0 for any
+    uint16_t port;          // Filter on either endpoint, 0 for any
+    uint16_t snaplen;       // Payload bytes kept per packet
+    uint32_t slots;         // Packets the ring holds at this snaplen
+    uint32_t captured;      // Packets recorded since armed
+    uint32_t dropped;       // Skipped because the ring was busy
+    bool in_psram;
+} rtp_capture_status_t;
+
+#ifdef CONFIG_RTP_CAPTURE_ENABLED
+extern atomic_bool rtp_capture_armed;
+
+void rtp_capture_add(uint8_t flags, const void *head, size_t head_len, const void *body, size_t body_len,
+                     uint32_t src_addr, uint16_t src_port, uint32_t dst_addr, uint16_t dst_port);
+
+/**
+ * @brief Record one packet, given as a header and an optional separate body
+ *
+ * Safe from any task. Addresses are IPv4 in network byte order, 0 for this
+ * device; ports are host order.
+ */
+static inline void rtp_capture_packet(uint8_t flags, const void *head, size_t head_len,
+                                      const void *body, size_t body_len,
+                                      uint32_t src_addr, uint16_t src_port, uint32_t dst_addr, uint16_t dst_port)
+{
+    if (atomic_load_explicit(&rtp_capture_armed, memory_order_relaxed)) {
+        rtp_capture_add(flags, head, head_len, body, body_len, src_addr, src_port, dst_addr, dst_port);
+    }
+}
+#else
+static inline void rtp_capture_packet(uint8_t flags, const void *head, size_t head_len,
+                                      const void *body, size_t body_len,
+                                      uint32_t src_addr, uint16_t src_port, uint32_t dst_addr, uint16_t dst_port)
+{
+    (void)flags;
+    (void)head;
+    (void)head_len;
+    (void)body;
+    (void)body_len;
+    (void)src_addr;
+    (void)src_port;
+    (void)dst_addr;
+    (void)dst_port;
+}
+#endif
+
+/**
+ * @brief Empty the ring and start recording
+ *
+ * @param ssrc Only packets of this SSRC (RTP, or the sender of an RTCP packet); 0 for all
+ * @param port Only packets to or from this port; 0 for all
+ * @param snaplen Payload bytes kept per packet, clamped to RTP_CAPTURE_SNAPLEN_MIN..MAX,
+ *                0 for CONFIG_RTP_CAPTURE_SNAPLEN
+ * @return ESP_OK, ESP_ERR_NO_MEM if the ring could not be allocated,
+ *         ESP_ERR_NOT_SUPPORTED without CONFIG_RTP_CAPTURE_ENABLED
+ */
+esp_err_t rtp_capture_start(uint32_t ssrc, uint16_t port, uint16_t snaplen);
+
+// Stop recording; what was captured stays downloadable until the next start
+void rtp_capture_stop(void);
+
+void rtp_capture_get_status(rtp_capture_status_t *out);
+
+// Called with each piece of the pcap file in order; nonzero ends the stream
+typedef esp_err_t (*rtp_capture_write_fn)(void *ctx, const void *data, size_t len);
+
+/**
+ * @brief Write the ring, oldest packet first, as a pcap file
+ *
+ * Recording goes on meanwhile; packets written over during the read are
+ * skipped rather than sent torn.
+ *
+ * @return ESP_OK, the writer's error, or ESP_ERR_NOT_FOUND if nothing was ever captured
+ */
+esp_err_t rtp_capture_write_pcap(rtp_capture_write_fn write, void *ctx);
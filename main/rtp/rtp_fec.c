@@ -0,0 +1,211 @@
+#include "rtp_fec.h"
+#include <string.h>
+
+/*
+ * FEC payload layout (RFC 5109 section 7.3/7.4, L = 0):
+ *
+ *   0: E L P X CC     1: M PT recovery    2-3: SN base
+ *   4-7: TS recovery  8-9: length recovery
+ *  10-11: protection length              12-13: mask
+ *  14-: XOR of the protected bodies, zero-padded to the longest
+ */
+
+static inline uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t rd32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void wr16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void wr32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+void rtp_fec_encoder_init(rtp_fec_encoder_t *enc, uint8_t *parity, size_t parity_cap) {
+    memset(enc, 0, sizeof(*enc));
+    enc->parity = parity;
+    enc->parity_cap = parity_cap;
+}
+
+bool rtp_fec_encoder_add(rtp_fec_encoder_t *enc, const uint8_t *packet, size_t len) {
+    if (len <= RTP_FEC_RTP_HEADER || len - RTP_FEC_RTP_HEADER > enc->parity_cap) {
+        return false;
+    }
+    uint16_t seq = rd16(packet + 2);
+    if (enc->count == 0) {
+        enc->sn_base = seq;
+        enc->mask = 0;
+        enc->parity_len = 0;
+        enc->len_rec = 0;
+        enc->ts_rec = 0;
+        enc->hdr_rec[0] = 0;
+        enc->hdr_rec[1] = 0;
+    }
+    uint16_t offset = (uint16_t)(seq - enc->sn_base);
+    if (offset >= RTP_FEC_MAX_GROUP) {
+        return false;
+    }
+
+    const uint8_t *body = packet + RTP_FEC_RTP_HEADER;
+    uint16_t body_len = (uint16_t)(len - RTP_FEC_RTP_HEADER);
+    if (body_len > enc->parity_len) {
+        // Longer than the group so far: earlier bodies are implicitly zero-padded
+        memset(enc->parity + enc->parity_len, 0, body_len - enc->parity_len);
+        enc->parity_len = body_len;
+    }
+    xor_bytes(enc->parity, body, body_len);
+    enc->hdr_rec[0] ^= packet[0];
+    enc->hdr_rec[1] ^= packet[1];
+    enc->ts_rec ^= rd32(packet + 4);
+    enc->len_rec ^= body_len;
+    enc->last_ts = rd32(packet + 4);
+    enc->mask |= (uint16_t)(0x8000u >> offset);
+    enc->count++;
+    return true;
+}
+
+size_t rtp_fec_encoder_finish(rtp_fec_encoder_t *enc, uint8_t *out, size_t out_cap, uint32_t *ts_out) {
+    if (enc->count == 0) {
+        return 0;
+    }
+    enc->count = 0;
+    size_t total = RTP_FEC_HEADER_SIZE + enc->parity_len;
+    if (total > out_cap) {
+        return 0;
+    }
+    out[0] = enc->hdr_rec[0] & 0x3F;  // E = 0, L = 0, then P/X/CC recovery
+    out[1] = enc->hdr_rec[1];
+    wr16(out + 2, enc->sn_base);
+    wr32(out + 4, enc->ts_rec);
+    wr16(out + 8, enc->len_rec);
+    wr16(out + 10, enc->parity_len);
+    wr16(out + 12, enc->mask);
+    memcpy(out + RTP_FEC_HEADER_SIZE, enc->parity, enc->parity_len);
+    if (ts_out) {
+        *ts_out = enc->last_ts;
+    }
+    return total;
+}
+
+void rtp_fec_window_init(rtp_fec_window_t *w, rtp_fec_entry_t *entries, uint8_t *bodies,
+                         uint16_t depth, uint16_t body_cap) {
+    w->entries = entries;
+    w->bodies = bodies;
+    w->depth = depth;
+    w->body_cap = body_cap;
+    rtp_fec_window_reset(w);
+}
+
+void rtp_fec_window_reset(rtp_fec_window_t *w) {
+    if (w->entries) {
+        memset(w->entries, 0, sizeof(rtp_fec_entry_t) * w->depth);
+    }
+}
+
+void rtp_fec_window_store(rtp_fec_window_t *w, const uint8_t *hdr, const uint8_t *body, size_t body_len) {
+    if (!w->entries || w->depth == 0) {
+        return;
+    }
+    uint16_t seq = rd16(hdr + 2);
+    rtp_fec_entry_t *e = &w->entries[seq % w->depth];
+    if (body_len > w->body_cap) {
+        e->valid = false;  // Whatever the slot held is older than this packet anyway
+        return;
+    }
+    e->ssrc = rd32(hdr + 8);
+    e->ts = rd32(hdr + 4);
+    e->seq = seq;
+    e->len = (uint16_t)body_len;
+    e->hdr[0] = hdr[0];
+    e->hdr[1] = hdr[1];
+    memcpy(w->bodies + (size_t)(seq % w->depth) * w->body_cap, body, body_len);
+    e->valid = true;
+}
+
+static const rtp_fec_entry_t *window_find(const rtp_fec_window_t *w, uint32_t ssrc, uint16_t seq) {
+    const rtp_fec_entry_t *e = &w->entries[seq % w->depth];
+    return (e->valid && e->seq == seq && e->ssrc == ssrc) ? e : NULL;
+}
+
+rtp_fec_result_t rtp_fec_recover(rtp_fec_window_t *w, const uint8_t *fec_hdr, const uint8_t *fec,
+                                 size_t fec_len, uint8_t *out, size_t out_cap, size_t *out_len) {
+    if (!w->entries || w->depth < RTP_FEC_MAX_GROUP || fec_len < RTP_FEC_HEADER_SIZE) {
+        return RTP_FEC_INVALID;
+    }
+    if (fec[0] & 0xC0) {
+        return RTP_FEC_INVALID;  // Extension flag or long mask: not produced by our sender
+    }
+    uint32_t ssrc = rd32(fec_hdr + 8);
+    uint16_t sn_base = rd16(fec + 2);
+    uint16_t prot_len = rd16(fec + 10);
+    uint16_t mask = rd16(fec + 12);
+    if ((size_t)prot_len > fec_len - RTP_FEC_HEADER_SIZE) {
+        return RTP_FEC_INVALID;
+    }
+
+    uint8_t hdr0 = fec[0];
+    uint8_t hdr1 = fec[1];
+    uint32_t ts = rd32(fec + 4);
+    uint16_t len = rd16(fec + 8);
+    int missing = 0;
+    uint16_t missing_seq = 0;
+    for (int i = 0; i < RTP_FEC_MAX_GROUP; i++) {
+        if (!(mask & (0x8000u >> i))) {
+            continue;
+        }
+        uint16_t seq = (uint16_t)(sn_base + i);
+        const rtp_fec_entry_t *e = window_find(w, ssrc, seq);
+        if (!e) {
+            missing++;
+            missing_seq = seq;
+            continue;
+        }
+        hdr0 ^= e->hdr[0];
+        hdr1 ^= e->hdr[1];
+        ts ^= e->ts;
+        len ^= e->len;
+    }
+    if (missing == 0) {
+        return RTP_FEC_COMPLETE;
+    }
+    if (missing > 1 || len > prot_len || (size_t)len > w->body_cap ||
+        RTP_FEC_RTP_HEADER + (size_t)len > out_cap) {
+        return RTP_FEC_UNRECOVERABLE;
+    }
+
+    uint8_t *body = out + RTP_FEC_RTP_HEADER;
+    memcpy(body, fec + RTP_FEC_HEADER_SIZE, len);
+    for (int i = 0; i < RTP_FEC_MAX_GROUP; i++) {
+        uint16_t seq = (uint16_t)(sn_base + i);
+        if (!(mask & (0x8000u >> i)) || seq == missing_seq) {
+            continue;
+        }
+        const rtp_fec_entry_t *e = window_find(w, ssrc, seq);
+        const uint8_t *src = w->bodies + (size_t)(seq % w->depth) * w->body_cap;
+        xor_bytes(body, src, e->len < len ? e->len : len);
+    }
+    out[0] = 0x80 | (hdr0 & 0x3F);  // V = 2
+    out[1] = hdr1;
+    wr16(out + 2, missing_seq);
+    wr32(out + 4, ts);
+    wr32(out + 8, ssrc);
+
+    rtp_fec_window_store(w, out, body, len);
+    *out_len = RTP_FEC_RTP_HEADER + (size_t)len;
+    return RTP_FEC_RECOVERED;
+}
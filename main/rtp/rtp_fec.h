@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * RTP parity FEC (RFC 5109 ULPFEC, one protection level, 16-bit mask).
+ *
+ * The sender XORs every group of up to RTP_FEC_MAX_GROUP media packets into one
+ * FEC packet, sent as a separate payload type on the same port and SSRC with
+ * its own sequence numbers. The receiver keeps a short window of raw media
+ * packets (as they came off the wire, before sample conversion) and rebuilds
+ * the one packet of a group that went missing. Two losses in a group are not
+ * recoverable.
+ *
+ * "Body" below is everything after the 12-byte fixed RTP header: CSRCs,
+ * extension, payload and padding, which is what RFC 5109 protects.
+ */
+
+// FEC header (10 bytes) + level 0 header with a short mask (4 bytes)
+#define RTP_FEC_HEADER_SIZE 14
+// Packets one FEC packet can cover (bits in the short mask)
+#define RTP_FEC_MAX_GROUP   16
+#define RTP_FEC_RTP_HEADER  12
+
+typedef struct {
+    uint8_t  *parity;       // XOR of the protected bodies, caller storage
+    size_t   parity_cap;
+    uint16_t parity_len;    // Longest body in the group
+    uint16_t sn_base;       // Sequence number of the first protected packet
+    uint16_t mask;          // Protected packets, MSB = sn_base
+    uint16_t len_rec;       // XOR of body lengths
+    uint32_t ts_rec;        // XOR of timestamps
+    uint32_t last_ts;       // Timestamp of the newest protected packet
+    uint8_t  hdr_rec[2];    // XOR of the first two header bytes
+    uint8_t  count;
+} rtp_fec_encoder_t;
+
+// One media packet as remembered by the receiver
+typedef struct {
+    uint32_t ssrc;
+    uint32_t ts;
+    uint16_t seq;
+    uint16_t len;           // Body length
+    uint8_t  hdr[2];
+    bool     valid;
+} rtp_fec_entry_t;
+
+typedef struct {
+    rtp_fec_entry_t *entries;   // depth entries, indexed by seq % depth
+    uint8_t *bodies;            // depth * body_cap bytes
+    uint16_t depth;
+    uint16_t body_cap;
+} rtp_fec_window_t;
+
+typedef enum {
+    RTP_FEC_COMPLETE,           // Nothing in the group is missing
+    RTP_FEC_RECOVERED,          // The one missing packet was rebuilt
+    RTP_FEC_UNRECOVERABLE,      // More than one packet missing (or not in the window)
+    RTP_FEC_INVALID,            // Malformed or unsupported FEC packet
+} rtp_fec_result_t;
+
+/**
+ * @brief Start an encoder with caller-provided parity storage
+ *
+ * @param parity Buffer for the XOR of the bodies (largest body protected)
+ * @param parity_cap Size of parity in bytes
+ */
+void rtp_fec_encoder_init(rtp_fec_encoder_t *enc, uint8_t *parity, size_t parity_cap);
+
+/**
+ * @brief Add one sent media packet to the current group
+ *
+ * @param packet Complete RTP packet, network order
+ * @param len Packet length in bytes
+ * @return false if the packet could not be protected (too long, or outside the mask)
+ */
+bool rtp_fec_encoder_add(rtp_fec_encoder_t *enc, const uint8_t *packet, size_t len);
+
+static inline uint8_t rtp_fec_encoder_count(const rtp_fec_encoder_t *enc) {
+    return enc->count;
+}
+
+/**
+ * @brief Emit the FEC payload for the current group and start a new one
+ *
+ * @param out FEC header + level header + parity (goes after the FEC packet's RTP header)
+ * @param out_cap Size of out in bytes
+ * @param ts_out Timestamp for the FEC packet's RTP header (newest protected packet)
+ * @return Payload length, or 0 if the group was empty or out is too small
+ */
+size_t rtp_fec_encoder_finish(rtp_fec_encoder_t *enc, uint8_t *out, size_t out_cap, uint32_t *ts_out);
+
+/**
+ * @brief Set up a receive window over caller-provided storage
+ *
+ * @param depth Number of entries; at least RTP_FEC_MAX_GROUP
+ * @param body_cap Largest body remembered; longer packets are not protected
+ */
+void rtp_fec_window_init(rtp_fec_window_t *w, rtp_fec_entry_t *entries, uint8_t *bodies,
+                         uint16_t depth, uint16_t body_cap);
+
+void rtp_fec_window_reset(rtp_fec_window_t *w);
+
+/**
+ * @brief Remember one received media packet
+ *
+ * @param hdr Its 12-byte fixed RTP header
+ * @param body Everything after the fixed header, untouched
+ * @param body_len Length of body in bytes
+ */
+void rtp_fec_window_store(rtp_fec_window_t *w, const uint8_t *hdr, const uint8_t *body, size_t body_len);
+
+/**
+ * @brief Try to rebuild a lost media packet from an FEC packet
+ *
+ * The recovered packet is also added to the window.
+ *
+ * @param fec_hdr 12-byte RTP header of the FEC packet (for the SSRC)
+ * @param fec FEC payload (after the FEC packet's RTP header)
+ * @param fec_len Length of fec in bytes
+ * @param out Rebuilt RTP packet, header included
+ * @param out_cap Size of out in bytes
+ * @param out_len Length of the rebuilt packet (RTP_FEC_RECOVERED only)
+ */
+rtp_fec_result_t rtp_fec_recover(rtp_fec_window_t *w, const uint8_t *fec_hdr, const uint8_t *fec,
+                                 size_t fec_len, uint8_t *out, size_t out_cap, size_t *out_len);
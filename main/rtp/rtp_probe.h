@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * End-to-end latency probe (CONFIG_RTP_LATENCY_PROBE), carried in an RTP
+ * header extension (RFC 8285 one-byte form).
+ *
+ * Every CONFIG_RTP_LATENCY_PROBE_INTERVAL packets the sender sets the X bit
+ * and inserts one element, ID CONFIG_RTP_LATENCY_PROBE_EXT_ID, holding the
+ * master time (Unix microseconds, clock_service) the packet's first sample
+ * was captured, big endian. The element is padded to a whole word:
+ *
+ *   0xBE 0xDE | length = 3 words | ID<<4 | 7 | 8 bytes capture time | 3 x 0
+ *
+ * A receiver that does not know the ID skips the extension like any other;
+ * both ends only agree on when their master clocks are locked to the same
+ * NTP or PTP source.
+ */
+
+#define RTP_PROBE_EXT_PROFILE 0xBEDE
+#define RTP_PROBE_EXT_SIZE    16    // Extension header + one padded element
+
+/**
+ * @brief Write the probe extension (RTP_PROBE_EXT_SIZE bytes) at ext
+ */
+static inline void rtp_probe_write(uint8_t *ext, uint8_t id, int64_t capture_master_us)
+{
+    uint64_t t = (uint64_t)capture_master_us;
+    ext[0] = RTP_PROBE_EXT_PROFILE >> 8;
+    ext[1] = RTP_PROBE_EXT_PROFILE & 0xFF;
+    ext[2] = 0;
+    ext[3] = (RTP_PROBE_EXT_SIZE - 4) / 4;
+    ext[4] = (uint8_t)((id << 4) | 7);   // Length field is bytes - 1
+    for (int i = 0; i < 8; i++) {
+        ext[5 + i] = (uint8_t)(t >> (56 - 8 * i));
+    }
+    ext[13] = ext[14] = ext[15] = 0;
+}
+
+/**
+ * @brief Find the probe element in a header extension
+ *
+ * @param ext     Extension header (profile and length words first)
+ * @param ext_len Extension header plus data, bytes
+ * @return true with *capture_master_us set if an element with the ID is there
+ */
+static inline bool rtp_probe_parse(const uint8_t *ext, size_t ext_len, uint8_t id,
+                                   int64_t *capture_master_us)
+{
+    if (ext_len < 4 || ((ext[0] << 8) | ext[1]) != RTP_PROBE_EXT_PROFILE) {
+        return false;
+    }
+    size_t i = 4;
+    while (i < ext_len) {
+        uint8_t el_id = ext[i] >> 4;
+        size_t el_len = (size_t)(ext[i] & 0x0F) + 1u;
+        if (ext[i] == 0) {
+            i++;            // Padding between elements
+            continue;
+        }
+        if (el_id == 15 || i + 1u + el_len > ext_len) {
+            return false;   // Reserved ID ends the list; truncated element
+        }
+        if (el_id == id && el_len == 8) {
+            uint64_t t = 0;
+            for (size_t b = 0; b < 8; b++) {
+                t = (t << 8) | ext[i + 1u + b];
+            }
+            *capture_master_us = (int64_t)t;
+            return true;
+        }
+        i += 1u + el_len;
+    }
+    return false;
+}
@@ -0,0 +1,339 @@
+#include "rtp_relay.h"
+#include "sdkconfig.h"
+#include "build_config.h"
+#include "global.h"
+#include "lifecycle/net_iface.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_mac.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "log_rate.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#ifdef ESP_NOW_MAX_DATA_LEN_V2
+#define RELAY_FRAME_MAX ESP_NOW_MAX_DATA_LEN_V2
+#else
+#define RELAY_FRAME_MAX ESP_NOW_MAX_DATA_LEN
+#endif
+#define RELAY_MAGIC       0xE5
+#define RELAY_VERSION     1
+#define RELAY_FLAG_RTCP   0x01
+// Ring item overhead (NOSPLIT header, 32-bit aligned) counted into its size
+#define RELAY_RING_ITEM   ((RELAY_FRAME_MAX + 8 + 3) & ~3)
+
+// Ahead of every relayed packet
+typedef struct __attribute__((packed)) {
+    uint8_t  magic;
+    uint8_t  flags;             // Version << 4 | RELAY_FLAG_RTCP
+    uint16_t src_port;          // Network byte order
+    uint32_t src_addr;          // Network byte order
+} relay_header_t;
+
+#define RELAY_PAYLOAD_MAX (RELAY_FRAME_MAX - sizeof(relay_header_t))
+
+static atomic_int s_role = RTP_RELAY_OFF;
+static uint8_t s_peers[RTP_RELAY_MAX_PEERS][6];
+static int s_peer_count = 0;
+static uint32_t s_own_addr = 0;
+static SemaphoreHandle_t s_send_mutex = NULL;
+static uint8_t s_frame[RELAY_FRAME_MAX];        // Under s_send_mutex
+static RingbufHandle_t s_ring = NULL;
+static StaticRingbuffer_t s_ring_struct;
+static uint8_t *s_ring_storage = NULL;
+
+static atomic_uint_fast32_t stat_forwarded = 0;
+static atomic_uint_fast32_t stat_send_errors = 0;
+static atomic_uint_fast32_t stat_oversize = 0;
+static atomic_uint_fast32_t stat_received = 0;
+static atomic_uint_fast32_t stat_overflow = 0;
+static atomic_uint_fast32_t stat_foreign = 0;
+
+static const uint8_t s_broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static const char *const s_role_names[RTP_RELAY_ROLE_COUNT] = {
+    [RTP_RELAY_OFF]     = "off",
+    [RTP_RELAY_FORWARD] = "forward",
+    [RTP_RELAY_LISTEN]  = "listen",
+};
+
+// "aa:bb:cc:dd:ee:ff, ..." -> out (may be NULL); -1 if an entry is malformed or there are too many
+static int relay_parse_peers(const char *list, uint8_t (*out)[6]) {
+    int count = 0;
+    const char *p = list ? list : "";
+    while (*p) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        unsigned b[6];
+        int used = 0;
+        if (count == RTP_RELAY_MAX_PEERS ||
+            sscanf(p, "%2x:%2x:%2x:%2x:%2x:%2x%n", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &used) != 6) {
+            return -1;
+        }
+        for (int i = 0; out && i < 6; i++) {
+            out[count][i] = (uint8_t)b[i];
+        }
+        count++;
+        p += used;
+        if (*p && *p != ',' && *p != ' ') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+static uint32_t relay_local_addr(void) {
+    esp_netif_ip_info_t ip_info = { 0 };
+    esp_netif_t *netif = net_iface_primary();
+    if (netif) {
+        esp_netif_get_ip_info(netif, &ip_info);
+    }
+    return ip_info.ip.addr;
+}
+
+static bool relay_peer_listed(const uint8_t *mac) {
+    for (int i = 0; i < s_peer_count; i++) {
+        if (memcmp(s_peers[i], mac, 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Wi-Fi task: copy the frame into the ring and nothing more
+static void relay_recv_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    if (atomic_load_explicit(&s_role, memory_order_relaxed) != RTP_RELAY_LISTEN || !s_ring) {
+        return;
+    }
+    if (len <= (int)sizeof(relay_header_t) || data[0] != RELAY_MAGIC || (data[1] >> 4) != RELAY_VERSION ||
+        (s_peer_count > 0 && (!info || !relay_peer_listed(info->src_addr)))) {
+        atomic_fetch_add_explicit(&stat_foreign, 1, memory_order_relaxed);
+        return;
+    }
+    if (xRingbufferSend(s_ring, data, (size_t)len, 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&stat_overflow, 1, memory_order_relaxed);
+        return;
+    }
+    atomic_fetch_add_explicit(&stat_received, 1, memory_order_relaxed);
+}
+
+static esp_err_t relay_add_peer(const uint8_t *mac, wifi_interface_t ifidx) {
+    esp_now_peer_info_t peer = {
+        .channel = 0,       // Whatever channel the station (or AP) is on
+        .ifidx = ifidx,
+        .encrypt = false,
+    };
+    memcpy(peer.peer_addr, mac, 6);
+    esp_err_t err = esp_now_add_peer(&peer);
+    if (err != ESP_OK && err != ESP_ERR_ESPNOW_EXIST) {
+        return err;
+    }
+    esp_now_rate_config_t rate = {
+#if defined(CONFIG_RTP_RELAY_RATE_12M)
+        .phymode = WIFI_PHY_MODE_11G,
+        .rate = WIFI_PHY_RATE_12M,
+#elif defined(CONFIG_RTP_RELAY_RATE_MCS5)
+        .phymode = WIFI_PHY_MODE_HT20,
+        .rate = WIFI_PHY_RATE_MCS5_LGI,
+#else
+        .phymode = WIFI_PHY_MODE_HT20,
+        .rate = WIFI_PHY_RATE_MCS3_LGI,
+#endif
+        .ersu = false,
+        .dcm = false,
+    };
+    if (esp_now_set_peer_rate_config(mac, &rate) != ESP_OK) {
+        ESP_LOGW(TAG, "Relay: could not set the PHY rate for " MACSTR ", using the default", MAC2STR(mac));
+    }
+    return ESP_OK;
+}
+
+esp_err_t rtp_relay_start(rtp_relay_role_t role, const char *peers) {
+    rtp_relay_stop();
+    if (role == RTP_RELAY_OFF || role >= RTP_RELAY_ROLE_COUNT) {
+        return ESP_OK;
+    }
+    int count = relay_parse_peers(peers, s_peers);
+    if (count < 0) {
+        ESP_LOGE(TAG, "Relay: malformed peer list \"%s\"", peers);
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_peer_count = count;
+    if (!s_send_mutex) {
+        s_send_mutex = xSemaphoreCreateMutex();
+        if (!s_send_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (role == RTP_RELAY_LISTEN) {
+        size_t size = (size_t)CONFIG_RTP_RELAY_QUEUE_PACKETS * RELAY_RING_ITEM;
+        s_ring_storage = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_ring_storage) {
+            s_ring_storage = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+        }
+        if (!s_ring_storage) {
+            ESP_LOGE(TAG, "Relay: no memory for the receive ring (%u bytes)", (unsigned)size);
+            return ESP_ERR_NO_MEM;
+        }
+        s_ring = xRingbufferCreateStatic(size, RINGBUF_TYPE_NOSPLIT, s_ring_storage, &s_ring_struct);
+    }
+
+    esp_err_t err = esp_now_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Relay: ESP-NOW init failed: %s", esp_err_to_name(err));
+        rtp_relay_stop();
+        return err;
+    }
+
+    wifi_mode_t mode = WIFI_MODE_STA;
+    esp_wifi_get_mode(&mode);
+    wifi_interface_t ifidx = mode == WIFI_MODE_AP ? WIFI_IF_AP : WIFI_IF_STA;
+    if (role == RTP_RELAY_FORWARD) {
+        for (int i = 0; i < s_peer_count && err == ESP_OK; i++) {
+            err = relay_add_peer(s_peers[i], ifidx);
+        }
+        if (err == ESP_OK && s_peer_count == 0) {
+            err = relay_add_peer(s_broadcast, ifidx);
+        }
+    } else {
+        err = esp_now_register_recv_cb(relay_recv_cb);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Relay: ESP-NOW setup failed: %s", esp_err_to_name(err));
+        esp_now_deinit();
+        rtp_relay_stop();
+        return err;
+    }
+
+    s_own_addr = relay_local_addr();
+    atomic_store(&stat_forwarded, 0);
+    atomic_store(&stat_send_errors, 0);
+    atomic_store(&stat_oversize, 0);
+    atomic_store(&stat_received, 0);
+    atomic_store(&stat_overflow, 0);
+    atomic_store(&stat_foreign, 0);
+    atomic_store(&s_role, role);
+    ESP_LOGI(TAG, "Relay: %s over ESP-NOW, %d peer(s)%s, up to %u-byte packets", s_role_names[role],
+             s_peer_count, s_peer_count == 0 ? (role == RTP_RELAY_FORWARD ? " (broadcast)" : " (any)") : "",
+             (unsigned)RELAY_PAYLOAD_MAX);
+    return ESP_OK;
+}
+
+void rtp_relay_stop(void) {
+    int role = atomic_exchange(&s_role, RTP_RELAY_OFF);
+    if (role != RTP_RELAY_OFF) {
+        if (role == RTP_RELAY_LISTEN) {
+            esp_now_unregister_recv_cb();
+        }
+        esp_now_deinit();
+        ESP_LOGI(TAG, "Relay stopped");
+    }
+    if (s_ring) {
+        vRingbufferDelete(s_ring);
+        s_ring = NULL;
+    }
+    if (s_ring_storage) {
+        heap_caps_free(s_ring_storage);
+        s_ring_storage = NULL;
+    }
+}
+
+bool rtp_relay_peers_valid(const char *peers) {
+    return relay_parse_peers(peers, NULL) >= 0;
+}
+
+rtp_relay_role_t rtp_relay_role(void) {
+    return (rtp_relay_role_t)atomic_load_explicit(&s_role, memory_order_relaxed);
+}
+
+void rtp_relay_forward(bool is_rtcp, const void *head, size_t head_len, const void *body, size_t body_len,
+                       uint32_t src_addr, uint16_t src_port) {
+    if (atomic_load_explicit(&s_role, memory_order_relaxed) != RTP_RELAY_FORWARD) {
+        return;
+    }
+    if (head_len + body_len > RELAY_PAYLOAD_MAX) {
+        atomic_fetch_add_explicit(&stat_oversize, 1, memory_order_relaxed);
+        LOG_RATE_W(TAG, "Relay: %u-byte packet does not fit one ESP-NOW frame",
+                   (unsigned)(head_len + body_len));
+        return;
+    }
+    if (src_addr == 0) {
+        if (s_own_addr == 0) {
+            s_own_addr = relay_local_addr();
+        }
+        src_addr = s_own_addr;
+    }
+
+    xSemaphoreTake(s_send_mutex, portMAX_DELAY);
+    relay_header_t *hdr = (relay_header_t *)s_frame;
+    hdr->magic = RELAY_MAGIC;
+    hdr->flags = (uint8_t)((RELAY_VERSION << 4) | (is_rtcp ? RELAY_FLAG_RTCP : 0));
+    hdr->src_port = htons(src_port);
+    hdr->src_addr = src_addr;
+    memcpy(s_frame + sizeof(*hdr), head, head_len);
+    if (body_len > 0) {
+        memcpy(s_frame + sizeof(*hdr) + head_len, body, body_len);
+    }
+    // NULL sends to every listed peer
+    esp_err_t err = esp_now_send(s_peer_count > 0 ? NULL : s_broadcast, s_frame,
+                                 sizeof(*hdr) + head_len + body_len);
+    xSemaphoreGive(s_send_mutex);
+
+    if (err == ESP_OK) {
+        atomic_fetch_add_explicit(&stat_forwarded, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&stat_send_errors, 1, memory_order_relaxed);
+        LOG_RATE_D(TAG, "Relay: send failed: %s", esp_err_to_name(err));
+    }
+}
+
+size_t rtp_relay_receive(void *buf, size_t cap, rtp_relay_meta_t *meta, TickType_t wait) {
+    if (!s_ring) {
+        vTaskDelay(wait);
+        return 0;
+    }
+    size_t item_len = 0;
+    const uint8_t *item = xRingbufferReceive(s_ring, &item_len, wait);
+    if (!item) {
+        return 0;
+    }
+    const relay_header_t *hdr = (const relay_header_t *)item;
+    size_t len = item_len - sizeof(*hdr);
+    if (len > cap) {
+        len = cap;
+    }
+    memcpy(buf, item + sizeof(*hdr), len);
+    meta->src_addr = hdr->src_addr;
+    meta->src_port = ntohs(hdr->src_port);
+    meta->is_rtcp = (hdr->flags & RELAY_FLAG_RTCP) != 0;
+    vRingbufferReturnItem(s_ring, (void *)item);
+    return len;
+}
+
+void rtp_relay_get_stats(rtp_relay_stats_t *out) {
+    if (!out) {
+        return;
+    }
+    out->forwarded = atomic_load_explicit(&stat_forwarded, memory_order_relaxed);
+    out->send_errors = atomic_load_explicit(&stat_send_errors, memory_order_relaxed);
+    out->oversize = atomic_load_explicit(&stat_oversize, memory_order_relaxed);
+    out->received = atomic_load_explicit(&stat_received, memory_order_relaxed);
+    out->overflow = atomic_load_explicit(&stat_overflow, memory_order_relaxed);
+    out->foreign = atomic_load_explicit(&stat_foreign, memory_order_relaxed);
+}
+
+const char *rtp_relay_role_name(rtp_relay_role_t role) {
+    return role < RTP_RELAY_ROLE_COUNT ? s_role_names[role] : "unknown";
+}
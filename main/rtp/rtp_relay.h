@@ -0,0 +1,101 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * ESP-NOW relay between devices (CONFIG_RTP_RELAY_ENABLED).
+ *
+ * A device in the forward role (a receiver, or the sender) passes every RTP
+ * and RTCP packet it takes from (or puts on) the network on to peer ESP32s
+ * over ESP-NOW, unchanged, behind a small header naming where it came from.
+ * Devices in the listen role take their stream from those frames instead of
+ * a socket: the packets carry their own RTP timestamp, sequence number and
+ * SSRC, and the forwarded SRs, so each peer fills its own jitter buffer and
+ * plays on the RTCP-mapped timeline like a directly fed receiver. Their
+ * receiver reports (and NACKs) go straight back to the original sender over
+ * Wi-Fi, using the source address in the header.
+ *
+ * Frames go to the relay_peers MAC addresses (unicast, acknowledged and
+ * retried by the MAC), or broadcast when the list is empty, at the PHY rate
+ * chosen under RTP_RELAY_RATE; a listener with a list only takes frames from
+ * those addresses. Either way the access point carries nothing extra.
+ * Packets longer than one ESP-NOW v2 frame (1470 bytes less the header, so
+ * L16 stereo at 48 kHz up to a 7 ms packet time) are not relayed.
+ *
+ * The receive callback runs on the Wi-Fi task and only copies the frame into
+ * a ring buffer, drained by udp_handler, which keeps the jitter buffer's
+ * single producer.
+ */
+
+typedef enum {
+    RTP_RELAY_OFF = 0,
+    RTP_RELAY_FORWARD,          // Pass the stream on to the peers
+    RTP_RELAY_LISTEN,           // Take the stream from a forwarding device
+    RTP_RELAY_ROLE_COUNT,
+} rtp_relay_role_t;
+
+#define RTP_RELAY_MAX_PEERS 6
+
+// Where a relayed packet originally came from
+typedef struct {
+    uint32_t src_addr;          // IPv4, network byte order
+    uint16_t src_port;
+    bool is_rtcp;
+} rtp_relay_meta_t;
+
+typedef struct {
+    uint32_t forwarded;         // Packets handed to ESP-NOW
+    uint32_t send_errors;       // Refused by ESP-NOW (queue full, peer gone)
+    uint32_t oversize;          // Too long for one frame
+    uint32_t received;          // Frames taken from a forwarding device
+    uint32_t overflow;          // Dropped because the ring was full
+    uint32_t foreign;           // Not from a listed peer, or not a relay frame
+} rtp_relay_stats_t;
+
+/**
+ * @brief Bring up ESP-NOW in a role (Wi-Fi must be started)
+ *
+ * @param role RTP_RELAY_OFF only stops a running relay
+ * @param peers Comma-separated MAC addresses ("aa:bb:cc:dd:ee:ff, ..."); empty for broadcast
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a malformed peer list, ESP_ERR_NO_MEM,
+ *         or the esp_now error
+ */
+esp_err_t rtp_relay_start(rtp_relay_role_t role, const char *peers);
+
+void rtp_relay_stop(void);
+
+// Whether a peer list would be accepted by rtp_relay_start()
+bool rtp_relay_peers_valid(const char *peers);
+
+// The role started, RTP_RELAY_OFF while stopped
+rtp_relay_role_t rtp_relay_role(void);
+
+/**
+ * @brief Pass one packet on, given as a header and an optional separate body (forward role)
+ *
+ * Does nothing in any other role. Safe from any task.
+ *
+ * @param src_addr Original source (network byte order), 0 for this device
+ * @param src_port Original source port; for RTCP, the port reports should go to
+ */
+void rtp_relay_forward(bool is_rtcp, const void *head, size_t head_len, const void *body, size_t body_len,
+                       uint32_t src_addr, uint16_t src_port);
+
+/**
+ * @brief Wait for the next relayed packet (listen role, udp_handler only)
+ *
+ * @param buf Where the packet is copied
+ * @param cap Size of buf; longer packets are truncated like recvfrom()
+ * @param meta Filled with the packet's origin
+ * @param wait Ticks to block
+ * @return Packet length, or 0 if none arrived
+ */
+size_t rtp_relay_receive(void *buf, size_t cap, rtp_relay_meta_t *meta, TickType_t wait);
+
+void rtp_relay_get_stats(rtp_relay_stats_t *out);
+
+const char *rtp_relay_role_name(rtp_relay_role_t role);
@@ -0,0 +1,409 @@
+#include "rtp_srtp.h"
+#include "mbedtls/base64.h"
+#include <string.h>
+
+/*
+ * Key derivation (RFC 3711 4.3, key derivation rate 0): each session key is the
+ * AES-CM keystream of the master key, started at IV = (master salt XOR label
+ * at byte 7) * 2^16. GCM's 12-byte master salt is zero-padded to 14 first, as
+ * RFC 7714 section 11 reuses the same function.
+ *
+ * Packet index i = ROC * 2^16 + SEQ.
+ *   AES-CM IV (16 bytes) = salt * 2^16 XOR SSRC * 2^64 XOR i * 2^16
+ *   HMAC-SHA1 over header || payload || ROC, truncated to the tag length
+ *   GCM IV (12 bytes) = (00 00 || SSRC || ROC || SEQ) XOR salt, AAD = header
+ */
+
+#define SRTP_KEY_LEN      16
+#define SRTP_CM_SALT_LEN  14
+#define SRTP_GCM_SALT_LEN 12
+#define SRTP_AUTH_KEY_LEN 20
+#define SRTP_GCM_TAG_LEN  16
+
+#define SRTP_LABEL_CIPHER 0x00
+#define SRTP_LABEL_AUTH   0x01
+#define SRTP_LABEL_SALT   0x02
+
+static const struct {
+    const char *name;
+    rtp_srtp_suite_t suite;
+    uint8_t salt_len;
+    uint8_t tag_len;
+} s_suites[] = {
+    { "AES_CM_128_HMAC_SHA1_80", RTP_SRTP_AES_CM_128_HMAC_SHA1_80, SRTP_CM_SALT_LEN, 10 },
+    { "AES_CM_128_HMAC_SHA1_32", RTP_SRTP_AES_CM_128_HMAC_SHA1_32, SRTP_CM_SALT_LEN, 4 },
+    { "AEAD_AES_128_GCM",        RTP_SRTP_AEAD_AES_128_GCM,        SRTP_GCM_SALT_LEN, SRTP_GCM_TAG_LEN },
+};
+
+static inline uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t rd32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void wr32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Suite table entry and decoded key || salt; false if malformed
+static bool parse_crypto(const char *crypto, int *entry, uint8_t *key_salt, size_t *key_salt_len) {
+    if (!crypto) {
+        return false;
+    }
+    while (*crypto == ' ') {
+        crypto++;
+    }
+    const char *space = strchr(crypto, ' ');
+    if (!space) {
+        return false;
+    }
+    size_t name_len = (size_t)(space - crypto);
+    *entry = -1;
+    for (int i = 0; i < (int)(sizeof(s_suites) / sizeof(s_suites[0])); i++) {
+        if (strlen(s_suites[i].name) == name_len && memcmp(s_suites[i].name, crypto, name_len) == 0) {
+            *entry = i;
+            break;
+        }
+    }
+    if (*entry < 0) {
+        return false;
+    }
+
+    const char *inl = strstr(space, "inline:");
+    if (!inl) {
+        return false;
+    }
+    const char *b64 = inl + 7;
+    size_t b64_len = strcspn(b64, "| \t\r\n;");
+    size_t out_len = 0;
+    if (mbedtls_base64_decode(key_salt, SRTP_KEY_LEN + SRTP_CM_SALT_LEN, &out_len,
+                              (const unsigned char *)b64, b64_len) != 0) {
+        return false;
+    }
+    *key_salt_len = out_len;
+    return out_len == (size_t)SRTP_KEY_LEN + s_suites[*entry].salt_len;
+}
+
+rtp_srtp_suite_t rtp_srtp_parse(const char *crypto) {
+    int entry = -1;
+    uint8_t key_salt[SRTP_KEY_LEN + SRTP_CM_SALT_LEN];
+    size_t len = 0;
+    bool ok = parse_crypto(crypto, &entry, key_salt, &len);
+    memset(key_salt, 0, sizeof(key_salt));
+    return ok ? s_suites[entry].suite : RTP_SRTP_NONE;
+}
+
+// n bytes of the PRF for `label` (n <= 32)
+static int srtp_kdf(mbedtls_aes_context *master, const uint8_t *salt14, uint8_t label, uint8_t *out, size_t n) {
+    uint8_t ctr[16] = { 0 };
+    uint8_t stream[16];
+    size_t off = 0;
+    memcpy(ctr, salt14, SRTP_CM_SALT_LEN);
+    ctr[7] ^= label;
+    memset(out, 0, n);
+    int ret = mbedtls_aes_crypt_ctr(master, n, &off, ctr, stream, out, out);
+    memset(stream, 0, sizeof(stream));
+    return ret;
+}
+
+esp_err_t rtp_srtp_init(rtp_srtp_t *ctx, const char *crypto) {
+    memset(ctx, 0, sizeof(*ctx));
+    mbedtls_aes_init(&ctx->aes);
+    mbedtls_gcm_init(&ctx->gcm);
+    mbedtls_md_init(&ctx->hmac);
+
+    int entry = -1;
+    uint8_t key_salt[SRTP_KEY_LEN + SRTP_CM_SALT_LEN] = { 0 };
+    size_t key_salt_len = 0;
+    if (!parse_crypto(crypto, &entry, key_salt, &key_salt_len)) {
+        memset(key_salt, 0, sizeof(key_salt));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Master salt padded to 14 bytes (GCM's is 12)
+    uint8_t master_salt[SRTP_CM_SALT_LEN] = { 0 };
+    memcpy(master_salt, key_salt + SRTP_KEY_LEN, key_salt_len - SRTP_KEY_LEN);
+
+    mbedtls_aes_context master;
+    mbedtls_aes_init(&master);
+    uint8_t session_key[SRTP_KEY_LEN];
+    uint8_t auth_key[SRTP_AUTH_KEY_LEN];
+    bool gcm = s_suites[entry].suite == RTP_SRTP_AEAD_AES_128_GCM;
+    int ret = mbedtls_aes_setkey_enc(&master, key_salt, 128);
+    if (ret == 0) {
+        ret = srtp_kdf(&master, master_salt, SRTP_LABEL_CIPHER, session_key, sizeof(session_key));
+    }
+    if (ret == 0) {
+        ret = srtp_kdf(&master, master_salt, SRTP_LABEL_SALT, ctx->salt, s_suites[entry].salt_len);
+    }
+    if (ret == 0 && !gcm) {
+        ret = srtp_kdf(&master, master_salt, SRTP_LABEL_AUTH, auth_key, sizeof(auth_key));
+    }
+    mbedtls_aes_free(&master);
+
+    if (ret == 0 && gcm) {
+        ret = mbedtls_gcm_setkey(&ctx->gcm, MBEDTLS_CIPHER_ID_AES, session_key, 128);
+    } else if (ret == 0) {
+        ret = mbedtls_aes_setkey_enc(&ctx->aes, session_key, 128);
+        if (ret == 0) {
+            ret = mbedtls_md_setup(&ctx->hmac, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+        }
+        if (ret == 0) {
+            ret = mbedtls_md_hmac_starts(&ctx->hmac, auth_key, sizeof(auth_key));
+        }
+    }
+    memset(key_salt, 0, sizeof(key_salt));
+    memset(master_salt, 0, sizeof(master_salt));
+    memset(session_key, 0, sizeof(session_key));
+    memset(auth_key, 0, sizeof(auth_key));
+    if (ret != 0) {
+        rtp_srtp_deinit(ctx);
+        return ESP_FAIL;
+    }
+
+    ctx->suite = s_suites[entry].suite;
+    ctx->tag_len = s_suites[entry].tag_len;
+    return ESP_OK;
+}
+
+void rtp_srtp_deinit(rtp_srtp_t *ctx) {
+    // The mbedtls frees are no-ops on zeroed contexts
+    mbedtls_aes_free(&ctx->aes);
+    mbedtls_gcm_free(&ctx->gcm);
+    mbedtls_md_free(&ctx->hmac);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static rtp_srtp_stream_t *find_stream(rtp_srtp_t *ctx, uint32_t ssrc) {
+    for (int i = 0; i < RTP_SRTP_MAX_STREAMS; i++) {
+        if (ctx->streams[i].used && ctx->streams[i].ssrc == ssrc) {
+            return &ctx->streams[i];
+        }
+    }
+    return NULL;
+}
+
+// Unused slot, else the one seen least recently
+static rtp_srtp_stream_t *new_stream(rtp_srtp_t *ctx) {
+    rtp_srtp_stream_t *oldest = &ctx->streams[0];
+    for (int i = 0; i < RTP_SRTP_MAX_STREAMS; i++) {
+        rtp_srtp_stream_t *s = &ctx->streams[i];
+        if (!s->used) {
+            return s;
+        }
+        if (ctx->packets - s->last_use > ctx->packets - oldest->last_use) {
+            oldest = s;
+        }
+    }
+    return oldest;
+}
+
+// Rollover counter the sender most likely used for seq (RFC 3711 3.3.1)
+static uint32_t guess_roc(const rtp_srtp_stream_t *s, uint16_t seq) {
+    if (s->s_l < 32768) {
+        return ((int32_t)seq - (int32_t)s->s_l > 32768) ? s->roc - 1 : s->roc;
+    }
+    return ((int32_t)s->s_l - 32768 > (int32_t)seq) ? s->roc + 1 : s->roc;
+}
+
+static void cm_iv(const rtp_srtp_t *ctx, uint32_t ssrc, uint32_t roc, uint16_t seq, uint8_t iv[16]) {
+    memcpy(iv, ctx->salt, SRTP_CM_SALT_LEN);
+    iv[14] = 0;
+    iv[15] = 0;
+    iv[4] ^= (uint8_t)(ssrc >> 24);
+    iv[5] ^= (uint8_t)(ssrc >> 16);
+    iv[6] ^= (uint8_t)(ssrc >> 8);
+    iv[7] ^= (uint8_t)ssrc;
+    iv[8] ^= (uint8_t)(roc >> 24);
+    iv[9] ^= (uint8_t)(roc >> 16);
+    iv[10] ^= (uint8_t)(roc >> 8);
+    iv[11] ^= (uint8_t)roc;
+    iv[12] ^= (uint8_t)(seq >> 8);
+    iv[13] ^= (uint8_t)seq;
+}
+
+static void gcm_iv(const rtp_srtp_t *ctx, uint32_t ssrc, uint32_t roc, uint16_t seq, uint8_t iv[12]) {
+    iv[0] = 0;
+    iv[1] = 0;
+    wr32(iv + 2, ssrc);
+    wr32(iv + 6, roc);
+    iv[10] = (uint8_t)(seq >> 8);
+    iv[11] = (uint8_t)seq;
+    for (int i = 0; i < SRTP_GCM_SALT_LEN; i++) {
+        iv[i] ^= ctx->salt[i];
+    }
+}
+
+static int cm_crypt(rtp_srtp_t *ctx, uint32_t ssrc, uint32_t roc, uint16_t seq, uint8_t *data, size_t len) {
+    uint8_t ctr[16];
+    uint8_t stream[16];
+    size_t off = 0;
+    cm_iv(ctx, ssrc, roc, seq, ctr);
+    return mbedtls_aes_crypt_ctr(&ctx->aes, len, &off, ctr, stream, data, data);
+}
+
+// Full 20-byte HMAC-SHA1 of packet || ROC
+static int cm_mac(rtp_srtp_t *ctx, const uint8_t *packet, size_t len, uint32_t roc, uint8_t mac[20]) {
+    uint8_t roc_be[4];
+    wr32(roc_be, roc);
+    int ret = mbedtls_md_hmac_reset(&ctx->hmac);
+    if (ret == 0) {
+        ret = mbedtls_md_hmac_update(&ctx->hmac, packet, len);
+    }
+    if (ret == 0) {
+        ret = mbedtls_md_hmac_update(&ctx->hmac, roc_be, sizeof(roc_be));
+    }
+    if (ret == 0) {
+        ret = mbedtls_md_hmac_finish(&ctx->hmac, mac);
+    }
+    return ret;
+}
+
+int rtp_srtp_protect(rtp_srtp_t *ctx, uint8_t *packet, size_t hdr_len, size_t len, size_t cap) {
+    if (ctx->suite == RTP_SRTP_NONE) {
+        return (int)len;
+    }
+    if (len < hdr_len || len + ctx->tag_len > cap) {
+        return -1;
+    }
+    uint16_t seq = rd16(packet + 2);
+    uint32_t ssrc = rd32(packet + 8);
+    rtp_srtp_stream_t *s = find_stream(ctx, ssrc);
+    if (!s) {
+        s = new_stream(ctx);
+        memset(s, 0, sizeof(*s));
+        s->used = true;
+        s->ssrc = ssrc;
+        s->s_l = seq;
+    } else if (seq < s->s_l && s->s_l - seq > 32768) {
+        s->roc++;  // Sequence number wrapped
+    }
+    s->s_l = seq;
+    s->last_use = ++ctx->packets;
+
+    uint8_t *payload = packet + hdr_len;
+    size_t payload_len = len - hdr_len;
+    if (ctx->suite == RTP_SRTP_AEAD_AES_128_GCM) {
+        uint8_t iv[12];
+        gcm_iv(ctx, ssrc, s->roc, seq, iv);
+        if (mbedtls_gcm_crypt_and_tag(&ctx->gcm, MBEDTLS_GCM_ENCRYPT, payload_len, iv, sizeof(iv),
+                                      packet, hdr_len, payload, payload, SRTP_GCM_TAG_LEN,
+                                      packet + len) != 0) {
+            return -1;
+        }
+        return (int)(len + SRTP_GCM_TAG_LEN);
+    }
+
+    uint8_t mac[20];
+    if (cm_crypt(ctx, ssrc, s->roc, seq, payload, payload_len) != 0 ||
+        cm_mac(ctx, packet, len, s->roc, mac) != 0) {
+        return -1;
+    }
+    memcpy(packet + len, mac, ctx->tag_len);
+    return (int)(len + ctx->tag_len);
+}
+
+// 0 if index is new to the window, RTP_SRTP_ERR_REPLAY otherwise
+static int replay_check(const rtp_srtp_stream_t *s, uint64_t index) {
+    if (s->replay_mask == 0 || index > s->replay_top) {
+        return 0;
+    }
+    uint64_t delta = s->replay_top - index;
+    if (delta >= 64 || (s->replay_mask & (1ULL << delta))) {
+        return RTP_SRTP_ERR_REPLAY;
+    }
+    return 0;
+}
+
+static void replay_accept(rtp_srtp_stream_t *s, uint64_t index) {
+    if (s->replay_mask == 0) {
+        s->replay_top = index;
+        s->replay_mask = 1;
+    } else if (index > s->replay_top) {
+        uint64_t shift = index - s->replay_top;
+        s->replay_mask = shift >= 64 ? 1 : (s->replay_mask << shift) | 1;
+        s->replay_top = index;
+    } else {
+        s->replay_mask |= 1ULL << (s->replay_top - index);
+    }
+}
+
+int rtp_srtp_unprotect(rtp_srtp_t *ctx, uint8_t *packet, size_t hdr_len, size_t len) {
+    if (ctx->suite == RTP_SRTP_NONE) {
+        return (int)len;
+    }
+    if (len < hdr_len + ctx->tag_len) {
+        return RTP_SRTP_ERR_SHORT;
+    }
+    uint16_t seq = rd16(packet + 2);
+    uint32_t ssrc = rd32(packet + 8);
+
+    // A new SSRC only takes a slot once a packet from it authenticates
+    rtp_srtp_stream_t fresh = { .ssrc = ssrc, .s_l = seq, .used = true };
+    rtp_srtp_stream_t *known = find_stream(ctx, ssrc);
+    rtp_srtp_stream_t *s = known ? known : &fresh;
+    uint32_t roc = known ? guess_roc(s, seq) : 0;
+    uint64_t index = ((uint64_t)roc << 16) | seq;
+    if (known && replay_check(s, index) != 0) {
+        ctx->replays++;
+        return RTP_SRTP_ERR_REPLAY;
+    }
+
+    size_t body_len = len - ctx->tag_len;
+    uint8_t *payload = packet + hdr_len;
+    size_t payload_len = body_len - hdr_len;
+    if (ctx->suite == RTP_SRTP_AEAD_AES_128_GCM) {
+        uint8_t iv[12];
+        gcm_iv(ctx, ssrc, roc, seq, iv);
+        if (mbedtls_gcm_auth_decrypt(&ctx->gcm, payload_len, iv, sizeof(iv), packet, hdr_len,
+                                     packet + body_len, SRTP_GCM_TAG_LEN, payload, payload) != 0) {
+            ctx->auth_failures++;
+            return RTP_SRTP_ERR_AUTH;
+        }
+    } else {
+        uint8_t mac[20];
+        if (cm_mac(ctx, packet, body_len, roc, mac) != 0) {
+            ctx->auth_failures++;
+            return RTP_SRTP_ERR_AUTH;
+        }
+        uint8_t diff = 0;
+        for (size_t i = 0; i < ctx->tag_len; i++) {
+            diff |= mac[i] ^ packet[body_len + i];
+        }
+        if (diff != 0) {
+            ctx->auth_failures++;
+            return RTP_SRTP_ERR_AUTH;
+        }
+        if (cm_crypt(ctx, ssrc, roc, seq, payload, payload_len) != 0) {
+            return RTP_SRTP_ERR_AUTH;
+        }
+    }
+
+    if (!known) {
+        s = new_stream(ctx);
+        *s = fresh;
+    }
+    s->last_use = ++ctx->packets;
+    replay_accept(s, index);
+    if (roc == s->roc + 1) {
+        s->roc = roc;
+        s->s_l = seq;
+    } else if (roc == s->roc && seq > s->s_l) {
+        s->s_l = seq;
+    }
+    return (int)body_len;
+}
+
+const char *rtp_srtp_suite_name(rtp_srtp_suite_t suite) {
+    for (size_t i = 0; i < sizeof(s_suites) / sizeof(s_suites[0]); i++) {
+        if (s_suites[i].suite == suite) {
+            return s_suites[i].name;
+        }
+    }
+    return "none";
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md.h"
+
+/*
+ * SRTP (RFC 3711, RFC 7714) for the RTP media path.
+ *
+ * Keys come as an SDES crypto attribute value (RFC 4568), the same text an SDP
+ * a=crypto line carries after its tag:
+ *
+ *   AES_CM_128_HMAC_SHA1_80 inline:<base64 of 16-byte key + 14-byte salt>
+ *   AES_CM_128_HMAC_SHA1_32 inline:<base64 of 16-byte key + 14-byte salt>
+ *   AEAD_AES_128_GCM        inline:<base64 of 16-byte key + 12-byte salt>
+ *
+ * Session keys are derived once (key derivation rate 0); lifetime and MKI
+ * parameters are not supported. Packets are protected and unprotected in
+ * place. The cipher and MAC run through mbedtls, which on the ESP32-S3 hands
+ * them to the AES (DMA) and SHA peripherals rather than computing in software.
+ *
+ * A context serves one direction. It tracks the rollover counter and, when
+ * receiving, a 64-packet replay window for up to RTP_SRTP_MAX_STREAMS SSRCs;
+ * a new SSRC beyond that replaces the one seen least recently. RTCP is not
+ * covered (no SRTCP).
+ */
+
+#define RTP_SRTP_MAX_TAG     16  // Largest authentication tag any suite appends
+#define RTP_SRTP_MAX_STREAMS 4
+
+typedef enum {
+    RTP_SRTP_NONE = 0,
+    RTP_SRTP_AES_CM_128_HMAC_SHA1_80,
+    RTP_SRTP_AES_CM_128_HMAC_SHA1_32,
+    RTP_SRTP_AEAD_AES_128_GCM,
+} rtp_srtp_suite_t;
+
+// Negative results of rtp_srtp_unprotect()
+#define RTP_SRTP_ERR_SHORT  -1  // Shorter than header plus tag
+#define RTP_SRTP_ERR_AUTH   -2  // Authentication failed
+#define RTP_SRTP_ERR_REPLAY -3  // Index already seen, or too old for the window
+
+typedef struct {
+    uint32_t ssrc;
+    uint32_t roc;           // Rollover counter
+    uint16_t s_l;           // Highest sequence number seen under roc
+    bool     used;
+    uint32_t last_use;      // Context-wide packet count at the last packet
+    uint64_t replay_top;    // Highest index authenticated
+    uint64_t replay_mask;   // Bit n: replay_top - n was seen
+} rtp_srtp_stream_t;
+
+typedef struct {
+    rtp_srtp_suite_t suite;
+    uint8_t tag_len;
+    uint8_t salt[14];               // Session salt (12 bytes used by GCM)
+    mbedtls_aes_context aes;        // AES-CM session key
+    mbedtls_gcm_context gcm;        // AEAD session key
+    mbedtls_md_context_t hmac;      // HMAC-SHA1 keyed with the session auth key
+    rtp_srtp_stream_t streams[RTP_SRTP_MAX_STREAMS];
+    uint32_t packets;
+    uint32_t auth_failures;
+    uint32_t replays;
+} rtp_srtp_t;
+
+/**
+ * @brief Check an SDES crypto value without keeping it
+ *
+ * @param crypto "<suite> inline:<key||salt>" as above
+ * @return The suite, or RTP_SRTP_NONE if the value is empty or malformed
+ */
+rtp_srtp_suite_t rtp_srtp_parse(const char *crypto);
+
+/**
+ * @brief Derive session keys from an SDES crypto value
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a malformed value or unknown suite,
+ *         or ESP_FAIL if the cipher could not be set up
+ */
+esp_err_t rtp_srtp_init(rtp_srtp_t *ctx, const char *crypto);
+
+// Wipe keys and state; safe on a context that was never initialised
+void rtp_srtp_deinit(rtp_srtp_t *ctx);
+
+static inline bool rtp_srtp_active(const rtp_srtp_t *ctx) {
+    return ctx->suite != RTP_SRTP_NONE;
+}
+
+static inline size_t rtp_srtp_tag_len(const rtp_srtp_t *ctx) {
+    return ctx->tag_len;
+}
+
+/**
+ * @brief Encrypt an RTP packet and append its tag (sender)
+ *
+ * @param packet Header (hdr_len bytes, including CSRCs and extension) then payload
+ * @param len Packet length
+ * @param cap Buffer size; must leave rtp_srtp_tag_len() bytes after the packet
+ * @return Protected length, or -1 if the buffer is too small
+ */
+int rtp_srtp_protect(rtp_srtp_t *ctx, uint8_t *packet, size_t hdr_len, size_t len, size_t cap);
+
+/**
+ * @brief Authenticate and decrypt an SRTP packet (receiver)
+ *
+ * @param packet Header (hdr_len bytes), encrypted payload, then the tag
+ * @return Length without the tag, or an RTP_SRTP_ERR_* code (drop the packet)
+ */
+int rtp_srtp_unprotect(rtp_srtp_t *ctx, uint8_t *packet, size_t hdr_len, size_t len);
+
+const char *rtp_srtp_suite_name(rtp_srtp_suite_t suite);
@@ -0,0 +1,368 @@
+#include "auto_select.h"
+#include "network_out.h"
+#include "global.h"
+#include "build_config.h"
+#include "lifecycle_manager.h"
+#include "lifecycle/net_iface.h"
+#include "mdns/mdns_discovery.h"
+#ifdef CONFIG_RTCP_SEND_SR
+#include "rtcp_sender.h"
+#endif
+#include "esp_log.h"
+#include "esp_err.h"
+
+#ifdef CONFIG_RTP_TX_AUTO_SELECT
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "ping/ping_sock.h"
+#include "lwip/ip_addr.h"
+#include <arpa/inet.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#undef TAG
+#define TAG "auto_select"
+
+// One probe: a short ping burst to one candidate
+#define PROBE_COUNT       4
+#define PROBE_INTERVAL_MS 100
+#define PROBE_TIMEOUT_MS  500
+// Weight of a new probe in the running averages, 1/2^n
+#define PROBE_EWMA_SHIFT  2
+
+#define SCORE_INELIGIBLE  INT32_MIN
+// Neither RR nor ping yet: assume an ordinary link, so it can be picked but not win a migration
+#define UNPROBED_RTT_MS   50
+
+typedef struct {
+    uint32_t addr;          // 0 = free
+    int32_t rtt_ms;         // Averaged ping round trip; -1 until a reply
+    uint32_t loss_pct;      // Averaged ping loss
+    int64_t updated_us;
+} candidate_stats_t;
+
+typedef struct {
+    esp_ping_handle_t handle;
+    uint32_t addr;
+    atomic_uint replies;
+    atomic_uint rtt_sum_ms;
+    atomic_uint sent;
+    atomic_bool done;
+} probe_t;
+
+static candidate_stats_t s_stats[MAX_DISCOVERED_DEVICES];
+static probe_t s_probe;
+static int64_t s_probe_end_us = 0;
+static size_t s_probe_next = 0;
+static int64_t s_eval_us = 0;
+static uint32_t s_current_addr = 0;     // Receiver the sender was switched to
+static uint32_t s_leader_addr = 0;      // Candidate beating it by the margin
+static uint8_t s_leader_run = 0;        // Evaluations in a row it has
+
+static candidate_stats_t *stats_for(uint32_t addr, bool create)
+{
+    candidate_stats_t *oldest = &s_stats[0];
+    for (size_t i = 0; i < MAX_DISCOVERED_DEVICES; i++) {
+        if (s_stats[i].addr == addr) {
+            return &s_stats[i];
+        }
+        if (s_stats[i].updated_us < oldest->updated_us) {
+            oldest = &s_stats[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    // Devices come and go with mDNS: the one probed longest ago makes room
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->addr = addr;
+    oldest->rtt_ms = -1;
+    return oldest;
+}
+
+static void probe_on_success(esp_ping_handle_t hdl, void *args)
+{
+    probe_t *probe = args;
+    uint32_t gap_ms = 0;
+    esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &gap_ms, sizeof(gap_ms));
+    atomic_fetch_add(&probe->rtt_sum_ms, gap_ms);
+    atomic_fetch_add(&probe->replies, 1);
+}
+
+static void probe_on_end(esp_ping_handle_t hdl, void *args)
+{
+    probe_t *probe = args;
+    uint32_t sent = 0;
+    esp_ping_get_profile(hdl, ESP_PING_PROF_REQUEST, &sent, sizeof(sent));
+    atomic_store(&probe->sent, sent);
+    atomic_store(&probe->done, true);
+}
+
+static void probe_start(uint32_t addr)
+{
+    esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+    config.count = PROBE_COUNT;
+    config.interval_ms = PROBE_INTERVAL_MS;
+    config.timeout_ms = PROBE_TIMEOUT_MS;
+    config.data_size = 16;
+    ip_addr_set_ip4_u32(&config.target_addr, addr);
+
+    esp_ping_callbacks_t callbacks = {
+        .cb_args = &s_probe,
+        .on_ping_success = probe_on_success,
+        .on_ping_timeout = NULL,
+        .on_ping_end = probe_on_end,
+    };
+    s_probe.addr = addr;
+    atomic_store(&s_probe.replies, 0);
+    atomic_store(&s_probe.rtt_sum_ms, 0);
+    atomic_store(&s_probe.sent, 0);
+    atomic_store(&s_probe.done, false);
+    if (esp_ping_new_session(&config, &callbacks, &s_probe.handle) != ESP_OK) {
+        s_probe.handle = NULL;
+        return;
+    }
+    if (esp_ping_start(s_probe.handle) != ESP_OK) {
+        esp_ping_delete_session(s_probe.handle);
+        s_probe.handle = NULL;
+    }
+}
+
+// Fold a finished burst into its candidate's averages
+static void probe_collect(int64_t now)
+{
+    if (!s_probe.handle || !atomic_load(&s_probe.done)) {
+        return;
+    }
+    uint32_t sent = atomic_load(&s_probe.sent);
+    uint32_t replies = atomic_load(&s_probe.replies);
+    candidate_stats_t *st = stats_for(s_probe.addr, true);
+    if (sent > 0) {
+        uint32_t loss = (sent - (replies < sent ? replies : sent)) * 100U / sent;
+        st->loss_pct = st->updated_us ? st->loss_pct - (st->loss_pct >> PROBE_EWMA_SHIFT) +
+                                        (loss >> PROBE_EWMA_SHIFT)
+                                      : loss;
+    }
+    if (replies > 0) {
+        int32_t rtt = (int32_t)(atomic_load(&s_probe.rtt_sum_ms) / replies);
+        st->rtt_ms = st->rtt_ms < 0 ? rtt : st->rtt_ms + ((rtt - st->rtt_ms) >> PROBE_EWMA_SHIFT);
+    }
+    st->updated_us = now;
+    esp_ping_delete_session(s_probe.handle);
+    s_probe.handle = NULL;
+    s_probe_end_us = now;
+}
+
+static uint8_t rate_bit(uint32_t sample_rate)
+{
+    switch (sample_rate) {
+        case 44100: return DISCOVERED_RATE_44100;
+        case 48000: return DISCOVERED_RATE_48000;
+        case 88200: return DISCOVERED_RATE_88200;
+        case 96000: return DISCOVERED_RATE_96000;
+        default:    return 0;
+    }
+}
+
+static uint32_t self_addr(void)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t *netif = net_iface_primary();
+    if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
+        return ip_info.ip.addr;
+    }
+    return 0;
+}
+
+static bool is_candidate(const discovered_device_t *dev, uint32_t self, uint8_t rate)
+{
+    return dev->ip_addr.addr != 0 && dev->ip_addr.addr != self && !dev->is_sender &&
+           (dev->rates == 0 || rate == 0 || (dev->rates & rate));
+}
+
+static int32_t clamp32(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// Weights as in auto_select.h; higher is better
+static int32_t score_device(const discovered_device_t *dev, const void *receivers, size_t receiver_count)
+{
+    const candidate_stats_t *st = stats_for(dev->ip_addr.addr, false);
+    int32_t rtt_ms = st && st->rtt_ms >= 0 ? st->rtt_ms : -1;
+    int32_t loss_pct = st && st->updated_us ? (int32_t)st->loss_pct : 0;
+#ifdef CONFIG_RTCP_SEND_SR
+    // The stream's own reports beat ping for whoever we already send to
+    const rtcp_sender_receiver_t *rx = receivers;
+    for (size_t i = 0; i < receiver_count; i++) {
+        if (rx[i].addr != dev->ip_addr.addr || rx[i].reports == 0) {
+            continue;
+        }
+        if (rx[i].rtt_us >= 0) {
+            rtt_ms = rx[i].rtt_us / 1000;
+        }
+        int32_t rr_loss = rx[i].fraction_lost * 100 / 256;
+        if (rr_loss > loss_pct) {
+            loss_pct = rr_loss;
+        }
+        break;
+    }
+#else
+    (void)receivers;
+    (void)receiver_count;
+#endif
+    if (rtt_ms < 0) {
+        rtt_ms = UNPROBED_RTT_MS;
+    }
+
+    int32_t score = 1000;
+    score -= clamp32(rtt_ms, 0, 200) * 2;
+    score -= clamp32(loss_pct, 0, 40) * 10;
+    if (dev->rssi != 0) {
+        score += clamp32((dev->rssi + 90) * 4, 0, 200) - 100;
+    }
+    if (dev->battery != 0xFF && dev->battery < 20) {
+        score -= (20 - dev->battery) * 5;
+    }
+    return score;
+}
+
+static esp_err_t switch_to(const discovered_device_t *dev, int32_t score, const char *why)
+{
+    ESP_LOGI(TAG, "Sending to %s (%s:%u, score %ld): %s", dev->hostname, inet_ntoa(dev->ip_addr),
+             dev->port, (long)score, why);
+    s_current_addr = dev->ip_addr.addr;
+    s_leader_addr = 0;
+    s_leader_run = 0;
+    return rtp_sender_set_auto_destination(dev->ip_addr.addr, dev->port);
+}
+
+// Score every candidate and switch when the rules of auto_select.h say so (always, if immediate)
+static esp_err_t evaluate(bool immediate)
+{
+    static discovered_device_t devices[MAX_DISCOVERED_DEVICES];
+    size_t found = 0;
+    if (mdns_discovery_get_devices(devices, MAX_DISCOVERED_DEVICES, &found) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t receiver_count = 0;
+#ifdef CONFIG_RTCP_SEND_SR
+    rtcp_sender_receiver_t receivers[RTCP_SENDER_MAX_RECEIVERS];
+    receiver_count = rtcp_sender_get_receivers(receivers, RTCP_SENDER_MAX_RECEIVERS);
+#else
+    const void *receivers = NULL;
+#endif
+
+    uint32_t self = self_addr();
+    uint8_t rate = rate_bit(lifecycle_get_sample_rate());
+    const discovered_device_t *best = NULL;
+    const discovered_device_t *current = NULL;
+    int32_t best_score = SCORE_INELIGIBLE;
+    int32_t current_score = SCORE_INELIGIBLE;
+    for (size_t i = 0; i < found; i++) {
+        if (!is_candidate(&devices[i], self, rate)) {
+            continue;
+        }
+        int32_t score = score_device(&devices[i], receivers, receiver_count);
+        ESP_LOGD(TAG, "%s: score %ld", devices[i].hostname, (long)score);
+        if (score > best_score) {
+            best = &devices[i];
+            best_score = score;
+        }
+        if (devices[i].ip_addr.addr == s_current_addr) {
+            current = &devices[i];
+            current_score = score;
+        }
+    }
+
+    if (!best) {
+        if (s_current_addr != 0) {
+            ESP_LOGW(TAG, "No receiver left, back to multicast");
+            s_current_addr = 0;
+            rtp_sender_set_auto_destination(0, 0);
+        }
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (best == current) {
+        s_leader_run = 0;
+        return ESP_OK;
+    }
+    if (immediate) {
+        return switch_to(best, best_score, "selected");
+    }
+    if (!current) {
+        return switch_to(best, best_score, s_current_addr ? "previous receiver gone" : "first receiver");
+    }
+    if (best_score < current_score + CONFIG_RTP_TX_AUTO_SELECT_MARGIN) {
+        s_leader_run = 0;
+        return ESP_OK;
+    }
+    if (best->ip_addr.addr != s_leader_addr) {
+        s_leader_addr = best->ip_addr.addr;
+        s_leader_run = 0;
+    }
+    if (++s_leader_run >= CONFIG_RTP_TX_AUTO_SELECT_HOLD) {
+        ESP_LOGI(TAG, "%s scored %ld against %ld for %s", best->hostname, (long)best_score,
+                 (long)current_score, current->hostname);
+        return switch_to(best, best_score, "healthier link");
+    }
+    return ESP_OK;
+}
+
+// Next candidate in turn for a ping burst
+static void probe_next(void)
+{
+    static discovered_device_t devices[MAX_DISCOVERED_DEVICES];
+    size_t found = 0;
+    if (mdns_discovery_get_devices(devices, MAX_DISCOVERED_DEVICES, &found) != ESP_OK || found == 0) {
+        return;
+    }
+    uint32_t self = self_addr();
+    uint8_t rate = rate_bit(lifecycle_get_sample_rate());
+    for (size_t n = 0; n < found; n++) {
+        const discovered_device_t *dev = &devices[s_probe_next++ % found];
+        if (is_candidate(dev, self, rate)) {
+            probe_start(dev->ip_addr.addr);
+            return;
+        }
+    }
+}
+
+void rtp_sender_auto_select_tick(void)
+{
+    int64_t now = esp_timer_get_time();
+    probe_collect(now);
+    if (!rtp_sender_is_running() || !rtp_sender_dest_is_auto()) {
+        s_current_addr = 0;
+        s_leader_run = 0;
+        return;
+    }
+    if (!s_probe.handle && now - s_probe_end_us >= (int64_t)CONFIG_RTP_TX_AUTO_SELECT_PROBE_MS * 1000) {
+        s_probe_end_us = now;   // Also paces retries when there is nothing to probe
+        probe_next();
+    }
+    if (now - s_eval_us < (int64_t)CONFIG_RTP_TX_AUTO_SELECT_EVAL_MS * 1000) {
+        return;
+    }
+    s_eval_us = now;
+    evaluate(false);
+}
+
+esp_err_t rtp_sender_auto_select_device(void)
+{
+    return evaluate(true);
+}
+
+#else
+
+void rtp_sender_auto_select_tick(void)
+{
+}
+
+esp_err_t rtp_sender_auto_select_device(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Scored receiver auto-selection (CONFIG_RTP_TX_AUTO_SELECT), active while
+ * sender_destination_ip is "auto".
+ *
+ * Every discovered mDNS receiver is probed in turn with a short ping burst
+ * (one burst in flight, CONFIG_RTP_TX_AUTO_SELECT_PROBE_MS apart), and the
+ * receiver being streamed to also reports loss and round trip in its RTCP RRs.
+ * Each CONFIG_RTP_TX_AUTO_SELECT_EVAL_MS every candidate is scored from:
+ *   - round trip (RR when it has one, else ping), up to -400 at 200 ms
+ *   - loss (the worse of RR fraction lost and ping loss), up to -400 at 40%
+ *   - the RSSI it advertises for its own Wi-Fi link, -100 .. +100
+ *   - a low advertised battery, up to -100 below 20%
+ * Senders, this device and receivers that do not advertise the stream's
+ * sample rate are not candidates.
+ *
+ * With nothing selected, or the current receiver gone or no longer a
+ * candidate, the best one is taken at once. Otherwise another receiver has
+ * to lead by CONFIG_RTP_TX_AUTO_SELECT_MARGIN points for
+ * CONFIG_RTP_TX_AUTO_SELECT_HOLD evaluations in a row before the sender
+ * migrates, so it does not flap between two similar ones.
+ *
+ * rtp_sender_auto_select_tick() runs on the lifecycle task, like the fan-out.
+ */
+
+/**
+ * @brief Probe, and periodically re-evaluate the destination
+ * Does nothing unless the sender is running with an "auto" destination.
+ */
+void rtp_sender_auto_select_tick(void);
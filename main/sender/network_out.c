@@ -9,21 +9,60 @@
 #include "esp_event.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
 #include "lwip/err.h"
 #include "lwip/sockets.h"
 #include <lwip/netdb.h>
 #include <string.h>
+#include <errno.h>
 #include <math.h>
 #include <arpa/inet.h>    // For htons, htonl, ntohs
 #include "esp_rom_sys.h" // For ets_delay_us
 #include "rom/ets_sys.h"
 #include "esp_netif.h"    // For IP address functions
+#include "wifi_manager.h"  // Streaming profile, audio DSCP
 #include "esp_timer.h"    // For timestamp generation
+#include "esp_heap_caps.h"
 #include "spdif_in.h"
 #include "usb_in.h"
+#include "pcm_ring.h"
 #include "config/config_manager.h"  // For device_mode_t enum
 #include "pcm_visualizer.h"  // For pcm_viz_write
+#include "dsp/pcm_kernels.h"
+#include "metrics_profile.h"
+#include "mdns/mdns_discovery.h"  // Receivers for mDNS fan-out
+#include "lifecycle/pipeline_topology.h"
+#include "lifecycle/net_iface.h"
+#include <stdatomic.h>
+#ifdef CONFIG_RTP_FEC_ENABLED
+#include "rtp/rtp_fec.h"
+#endif
+#ifdef CONFIG_RTCP_SEND_SR
+#include "rtcp_sender.h"
+#endif
+#ifdef CONFIG_RTP_LATENCY_PROBE
+#include "rtp/rtp_probe.h"
+#include "clock/clock_service.h"
+#endif
+#ifdef CONFIG_RTP_TX_ADAPT
+#include "tx_adapt.h"
+#endif
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+#include "opus_out.h"
+#endif
+#ifdef CONFIG_RTP_SRTP_ENABLED
+#include "rtp/rtp_srtp.h"
+#endif
+#ifdef CONFIG_RTP_RELAY_ENABLED
+#include "rtp/rtp_relay.h"
+#endif
+#ifdef CONFIG_SENDER_MIX_ENABLED
+#include "dsp/pcm_gain.h"
+#endif
+#if defined(CONFIG_SENDER_MIX_ENABLED) || defined(CONFIG_RTP_TX_DTX)
+#include "metrics.h"
+#endif
+#include "rtp/rtp_capture.h"
 
 // RTP header structure (12 bytes)
 typedef struct __attribute__((packed)) {
@@ -50,7 +89,18 @@ typedef struct __attribute__((packed)) {
 #define RTP_VERSION          2
 #define RTP_PAYLOAD_TYPE     127  // Dynamic payload type for L16/48000/2
 #define RTP_HEADER_SIZE      sizeof(rtp_header_t)  // Use struct size for consistency
-#define RTP_TIMESTAMP_INC    288 // Samples per packet at 48kHz (1152 bytes / 4 bytes per sample)
+#define RTP_SAMPLE_RATE      48000  // L16/48000/2 as announced in SDP
+#define RTP_BYTES_PER_FRAME  4      // 16-bit stereo
+
+#ifdef CONFIG_RTP_FEC_ENABLED
+_Static_assert(CONFIG_RTP_FEC_PAYLOAD_TYPE != RTP_PAYLOAD_TYPE, "FEC payload type must differ from the media one");
+#endif
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+_Static_assert(CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE != RTP_PAYLOAD_TYPE, "Opus payload type must differ from the L16 one");
+#ifdef CONFIG_RTP_FEC_ENABLED
+_Static_assert(CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE != CONFIG_RTP_FEC_PAYLOAD_TYPE, "Opus payload type must differ from the FEC one");
+#endif
+#endif
 
 // SAP constants
 #define SAP_MULTICAST_ADDR   CONFIG_SAP_MULTICAST_ADDR
@@ -62,13 +112,26 @@ typedef struct __attribute__((packed)) {
 // Scream header for 16-bit 48KHz stereo audio
 // static const char header[] = {1, 16, 2, 0, 0};  // Commented out - using RTP header instead
 #define HEADER_SIZE RTP_HEADER_SIZE
-#define CHUNK_SIZE PCM_CHUNK_SIZE
-#define PACKET_SIZE (CHUNK_SIZE + HEADER_SIZE)
+#define CHUNK_MAX_SIZE PCM_CHUNK_MAX_SIZE
+// Header extension room for a latency probe, inserted ahead of the payload
+#ifdef CONFIG_RTP_LATENCY_PROBE
+#define PROBE_EXT_SIZE RTP_PROBE_EXT_SIZE
+#else
+#define PROBE_EXT_SIZE 0
+#endif
+// Room for the SRTP authentication tag after the payload
+#ifdef CONFIG_RTP_SRTP_ENABLED
+#define SRTP_TAG_SIZE RTP_SRTP_MAX_TAG
+#else
+#define SRTP_TAG_SIZE 0
+#endif
+#define PACKET_MAX_SIZE (CHUNK_MAX_SIZE + HEADER_SIZE + PROBE_EXT_SIZE + SRTP_TAG_SIZE)
 
 // Socket options
-#define UDP_TX_BUFFER_SIZE (PCM_CHUNK_SIZE * 4)
+#define UDP_TX_BUFFER_SIZE (PCM_CHUNK_MAX_SIZE * 4)
 #define UDP_SEND_TIMEOUT_MS 10
 #define MAX_SEND_RETRIES 1
+#define SENDER_CAPTURE_POLL_MS 5  // Recheck for the input's capture ring while it starts
 
 // State variables
 static bool s_is_sender_initialized = false;
@@ -77,12 +140,173 @@ static bool s_is_muted = false;
 static uint32_t s_volume = 100;
 static int s_sock = -1;
 static struct sockaddr_in s_dest_addr;
+// Receiver picked by auto-selection while sender_destination_ip is "auto"; empty until one is
+static char s_auto_dest_ip[16] = {0};
+static uint16_t s_auto_dest_port = 0;
 static TaskHandle_t s_sender_task_handle = NULL;
+static pcm_ring_t *volatile s_capture_ring = NULL;   // Set by the sender task once it has one
 
 // RTP state variables
 static uint16_t s_rtp_seq_num = 0;
 static uint32_t s_rtp_timestamp = 0;
 static uint32_t s_rtp_ssrc = 0;
+#ifdef CONFIG_RTP_FEC_ENABLED
+// Parity packets have their own sequence space (RFC 5109 section 9)
+static uint16_t s_fec_seq_num = 0;
+#endif
+
+#ifdef CONFIG_RTP_SRTP_ENABLED
+// Keyed at rtp_sender_start() from the srtp_crypto setting; inactive (plain RTP) without one.
+// FEC parity and Opus share the SSRC, and with it the keystream, so neither is sent while active.
+static rtp_srtp_t s_tx_srtp;
+#define TX_SRTP_ACTIVE() rtp_srtp_active(&s_tx_srtp)
+#else
+#define TX_SRTP_ACTIVE() false
+#endif
+
+// Packetization, fixed at rtp_sender_start() from the ptime setting
+static uint8_t s_ptime_ms = PTIME_MS;
+static uint32_t s_chunk_bytes = PCM_CHUNK_SIZE;
+
+// Packet pacing: each packet is released at a deadline one nominal packet time after the
+// last, and the period is trimmed (by up to CONFIG_RTP_TX_PACE_MAX_PPM) to hold about one
+// packet of audio in the input ring, so the wire follows the input's sample clock
+#define TX_PACE_GAIN_SHIFT 6        // Fill error corrected over ~2^n packets
+typedef struct {
+    esp_timer_handle_t timer;       // One-shot, notifies the sender task at the deadline
+    TaskHandle_t task;
+    int64_t next_due_us;            // 0 = not anchored (start, or after an input gap)
+    uint32_t period_us;             // Nominal packet time
+    uint32_t ring_bytes;            // Capture ring capacity
+} tx_pace_t;
+
+#ifdef CONFIG_SENDER_MIX_ENABLED
+// Mixing sender (sender_mix_usb): the S/PDIF sender captures USB as well and sums both into
+// each packet. The locked S/PDIF input clocks the stream (USB while it is unlocked); the other
+// input is read at that pace and held near half its ring by slipping a frame per packet while
+// its smoothed fill is off target
+#define TX_MIX_SLIP_START_DIV 8     // Start slipping once off target by ring / n...
+#define TX_MIX_SLIP_STOP_DIV 32     // ...and stop back within ring / n
+#define TX_MIX_PEAK_DECAY_SHIFT 5   // Peak meters fall by 1/2^n per packet
+typedef struct {
+    pcm_ring_t *ring;
+    int32_t gain_q30;               // Reached at the end of the last packet, ramp start for the next
+    int32_t avg_fill;               // Smoothed fill while not the clock, bytes << 4
+    int8_t slipping;                // +1 dropping frames, -1 repeating them, 0 on target
+    bool primed;                    // Filled to the target since it last ran dry
+} tx_mix_source_t;
+
+typedef struct {
+    tx_mix_source_t src[RTP_SENDER_MIX_SOURCES];
+    uint8_t clock;
+    pcm_gain_dither_t dither;
+} tx_mix_t;
+
+// Published by the sender task for rtp_sender_get_mix_stats() and /metrics
+static atomic_bool s_mix_active = false;
+static atomic_uint_fast8_t s_mix_clock = RTP_SENDER_MIX_SPDIF;
+static pcm_ring_t *volatile s_mix_rings[RTP_SENDER_MIX_SOURCES];
+static atomic_uint_fast16_t s_mix_peak[RTP_SENDER_MIX_SOURCES];
+static atomic_uint_fast32_t s_mix_slips[RTP_SENDER_MIX_SOURCES];
+static atomic_uint_fast32_t s_mix_underruns[RTP_SENDER_MIX_SOURCES];
+
+static int64_t read_mix_peak_spdif(void)
+{
+    return atomic_load_explicit(&s_mix_peak[RTP_SENDER_MIX_SPDIF], memory_order_relaxed);
+}
+
+static int64_t read_mix_peak_usb(void)
+{
+    return atomic_load_explicit(&s_mix_peak[RTP_SENDER_MIX_USB], memory_order_relaxed);
+}
+
+static metrics_gauge_t s_mix_peak_spdif_metric =
+    METRICS_GAUGE_INIT("tx_mix_spdif_peak", "Mixing sender S/PDIF input peak level (0-32767)", read_mix_peak_spdif);
+static metrics_gauge_t s_mix_peak_usb_metric =
+    METRICS_GAUGE_INIT("tx_mix_usb_peak", "Mixing sender USB input peak level (0-32767)", read_mix_peak_usb);
+#endif
+
+#ifdef CONFIG_RTP_TX_DTX
+// Discontinuous transmission: after CONFIG_RTP_TX_DTX_HANGOVER_MS of digital silence L16
+// packets stop, while the ring is still read and the RTP timestamp advanced at the packet
+// rate. The first packet after a gap (the resumed audio, or a keepalive) carries the marker
+typedef struct {
+    uint32_t silent_us;             // Digital silence sent so far
+    int64_t keepalive_due_us;       // Next keepalive while paused, 0 = none
+    bool paused;
+    bool mark;                      // Set the marker on the next packet sent
+} tx_dtx_t;
+
+static atomic_bool s_dtx_paused = false;
+
+static int64_t read_dtx_paused(void)
+{
+    return atomic_load_explicit(&s_dtx_paused, memory_order_relaxed) ? 1 : 0;
+}
+
+static metrics_gauge_t s_dtx_paused_metric =
+    METRICS_GAUGE_INIT("tx_dtx_paused", "1 while the sender holds packets back on digital silence", read_dtx_paused);
+static metrics_counter_t s_dtx_pauses =
+    METRICS_COUNTER_INIT("tx_dtx_pauses_total", "Sender pauses on digital silence");
+static metrics_counter_t s_dtx_suppressed =
+    METRICS_COUNTER_INIT("tx_dtx_suppressed_packets_total", "Silent packets not sent while paused");
+#endif
+
+// Unicast fan-out: the packet built once is also sent to each of these, after s_dest_addr.
+// Rebuilt by rtp_sender_fanout_tick() (lifecycle task), sent to by rtp_sender_task; the
+// mutex is only held for the merge and the send loop.
+typedef struct {
+    struct sockaddr_in addr;
+    bool from_mdns;
+    bool opus;                      // Gets the Opus stream instead of L16
+    bool active;                    // Cleared after CONFIG_RTP_TX_FANOUT_MAX_FAILS failed sends
+    uint16_t fails;                 // Consecutive ENOMEM/EHOSTUNREACH
+    int64_t dropped_us;             // When it was deactivated, for the retry
+    uint32_t sent;
+    uint32_t errors;
+} tx_fanout_dest_t;
+
+static tx_fanout_dest_t s_fanout[CONFIG_RTP_TX_FANOUT_MAX];
+static size_t s_fanout_count = 0;
+static SemaphoreHandle_t s_fanout_mutex = NULL;
+static atomic_bool s_fanout_reload = true;
+static int64_t s_fanout_refresh_us = 0;
+static uint32_t s_primary_sent = 0;
+static uint32_t s_primary_errors = 0;
+// Codec selection, set by fanout_rebuild(): the destination's own, and whether anyone takes Opus
+static atomic_bool s_primary_opus = false;
+static atomic_bool s_opus_wanted = false;
+
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+// Retransmit cache: the last CONFIG_RTP_TX_RTX_CACHE_PACKETS packets as sent (after SRTP, so
+// a resend authenticates like the original), indexed by sequence number. The sender task
+// writes a slot under its generation count; the RTCP task copies one out and checks the
+// count is unchanged, like s_tx in rtcp_sender.c.
+#define RTX_SLOTS CONFIG_RTP_TX_RTX_CACHE_PACKETS
+// Cost of one resend against the token bucket, and the bucket's depth
+#define RTX_TOKEN_US (1000000 / CONFIG_RTP_TX_RTX_MAX_PER_SEC)
+#define RTX_BURST (CONFIG_RTP_TX_RTX_MAX_PER_SEC / 10 + 2)
+// Receivers on one multicast group NACK the same loss: one resend serves them all
+#define RTX_REPEAT_US 10000
+typedef struct {
+    atomic_uint gen;                // Odd while the sender task rewrites the slot
+    uint16_t seq;
+    uint16_t len;                   // 0 = empty
+    uint16_t resent_seq;            // RTCP task only
+    int64_t resent_us;
+} tx_rtx_slot_t;
+
+static tx_rtx_slot_t s_rtx_slots[RTX_SLOTS];
+static uint8_t *s_rtx_data = NULL;  // RTX_SLOTS * PACKET_MAX_SIZE, allocated on first start
+static uint8_t s_rtx_scratch[PACKET_MAX_SIZE];  // RTCP task only
+static int64_t s_rtx_credit_us = 0;
+static int64_t s_rtx_credit_at_us = 0;
+// Counted by the RTCP task, read by the web server
+static atomic_uint s_rtx_requested = 0;
+static atomic_uint s_rtx_sent = 0;
+static atomic_uint s_rtx_missed = 0;
+static atomic_uint s_rtx_limited = 0;
+#endif
 
 // SAP state variables
 static int s_sap_sock = -1;
@@ -95,12 +319,34 @@ static char s_local_ip[16] = {0};
 static bool is_multicast_address(const char *ip_str);
 static esp_err_t handle_multicast_membership(int sock, const char *multicast_ip, bool join);
 
-static void build_rtp_packet(uint8_t *packet, const uint8_t *audio_data, size_t audio_len)
+// Fill in the RTP header for the payload already swapped into packet + RTP_HEADER_SIZE.
+// Every header byte is written, so the packet buffer never needs clearing.
+bool rtp_sender_dest_is_auto(void)
+{
+    const char *ip = lifecycle_get_sender_destination_ip();
+    return ip && strcasecmp(ip, RTP_SENDER_DEST_AUTO) == 0;
+}
+
+// The configured destination, or with "auto" the selected receiver (the Scream multicast
+// group until one is found)
+static const char *sender_destination_ip(void)
+{
+    if (!rtp_sender_dest_is_auto()) {
+        return lifecycle_get_sender_destination_ip();
+    }
+    return s_auto_dest_ip[0] ? s_auto_dest_ip : "239.255.77.77";
+}
+
+static uint16_t sender_destination_port(void)
+{
+    if (rtp_sender_dest_is_auto() && s_auto_dest_ip[0] && s_auto_dest_port) {
+        return s_auto_dest_port;
+    }
+    return lifecycle_get_sender_destination_port();
+}
+
+static void build_rtp_header(uint8_t *packet)
 {
-    // Clear the packet buffer first to avoid garbage data
-    memset(packet, 0, PACKET_SIZE);
-    
-    // Use the RTP header struct directly for proper alignment and clarity
     rtp_header_t *header = (rtp_header_t *)packet;
     
     // Set header fields with proper network byte order conversion
@@ -112,20 +358,8 @@ static void build_rtp_packet(uint8_t *packet, const uint8_t *audio_data, size_t
     header->timestamp = htonl(s_rtp_timestamp);  // Convert to network byte order
     header->ssrc = htonl(s_rtp_ssrc);  // Convert to network byte order
     
-    // Copy audio data to packet after header
-    memcpy(packet + sizeof(rtp_header_t), audio_data, audio_len);
-    
-    // Convert audio samples to network byte order (big endian) - REQUIRED for L16 per RFC 3551
-    int16_t *samples = (int16_t *)(packet + sizeof(rtp_header_t));
-    size_t sample_count = audio_len / sizeof(int16_t);
-    
-    for (size_t i = 0; i < sample_count; i++) {
-        // Use htons for proper 16-bit network byte order conversion
-        samples[i] = htons(samples[i]);
-    }
-    
-    // Update timestamp for next packet (288 samples per packet)
-    s_rtp_timestamp += RTP_TIMESTAMP_INC;
+    // Update timestamp for next packet (one tick per frame)
+    s_rtp_timestamp += s_chunk_bytes / RTP_BYTES_PER_FRAME;
     
     // Debug logging to verify header values
     static int log_count = 0;
@@ -144,7 +378,7 @@ static int generate_sdp_message(char *sdp_buffer, size_t buffer_size)
     
     // Get local IP address
     esp_netif_ip_info_t ip_info;
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_t *netif = net_iface_primary();
     if (netif == NULL) {
         ESP_LOGE(TAG, "Failed to get network interface");
         return -1;
@@ -153,10 +387,53 @@ static int generate_sdp_message(char *sdp_buffer, size_t buffer_size)
     snprintf(s_local_ip, sizeof(s_local_ip), IPSTR, IP2STR(&ip_info.ip));
     
     // Get destination from lifecycle manager
-    const char* dest_ip = lifecycle_get_sender_destination_ip();
-    uint16_t dest_port = lifecycle_get_sender_destination_port();
+    const char* dest_ip = sender_destination_ip();
+    uint16_t dest_port = sender_destination_port();
     
     // Generate SDP
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+    if (atomic_load(&s_primary_opus)) {
+        // RFC 7587: always opus/48000/2; stereo=1 asks for (and sprop-stereo promises) stereo
+        return snprintf(sdp_buffer, buffer_size,
+            "v=0\r\n"
+            "o=- %u %u IN IP4 %s\r\n"
+            "s=%s\r\n"
+            "i=48kHz Opus Stereo Audio from %s\r\n"
+            "c=IN IP4 %s\r\n"
+            "t=0 0\r\n"
+            "a=recvonly\r\n"
+            "m=audio %u RTP/AVP %d\r\n"
+            "a=rtpmap:%d opus/48000/2\r\n"
+            "a=fmtp:%d stereo=1; sprop-stereo=1; maxaveragebitrate=%u\r\n"
+            "a=ptime:%u\r\n",
+            session_id, session_id, s_local_ip,
+            s_device_name,
+            s_device_name,
+            dest_ip,
+            dest_port,
+            CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE,
+            CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE,
+            CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE, (unsigned)CONFIG_RTP_TX_OPUS_BITRATE_KBPS * 1000u,
+            (unsigned)CONFIG_RTP_TX_OPUS_FRAME_MS
+        );
+    }
+#endif
+#ifdef CONFIG_RTP_FEC_ENABLED
+    char fec_fmt[8];
+    char fec_rtpmap[48];
+    snprintf(fec_fmt, sizeof(fec_fmt), " %d", CONFIG_RTP_FEC_PAYLOAD_TYPE);
+    snprintf(fec_rtpmap, sizeof(fec_rtpmap), "a=rtpmap:%d ulpfec/%d\r\n",
+             CONFIG_RTP_FEC_PAYLOAD_TYPE, RTP_SAMPLE_RATE);
+    if (TX_SRTP_ACTIVE()) {
+        fec_fmt[0] = '\0';
+        fec_rtpmap[0] = '\0';
+    }
+#else
+    const char *fec_fmt = "";
+    const char *fec_rtpmap = "";
+#endif
+    // The key is never announced: receivers get it out of band
+    const char *proto = TX_SRTP_ACTIVE() ? "RTP/SAVP" : "RTP/AVP";
     int len = snprintf(sdp_buffer, buffer_size,
         "v=0\r\n"
         "o=- %u %u IN IP4 %s\r\n"
@@ -165,16 +442,19 @@ static int generate_sdp_message(char *sdp_buffer, size_t buffer_size)
         "c=IN IP4 %s\r\n"
         "t=0 0\r\n"
         "a=recvonly\r\n"
-        "m=audio %u RTP/AVP %d\r\n"
+        "m=audio %u %s %d%s\r\n"
         "a=rtpmap:%d L16/48000/2\r\n"
-        "a=ptime:6\r\n",
+        "%s"
+        "a=ptime:%u\r\n",
         session_id, session_id, s_local_ip,
         s_device_name,
         s_device_name,
         dest_ip,
         dest_port,
+        proto, RTP_PAYLOAD_TYPE, fec_fmt,
         RTP_PAYLOAD_TYPE,
-        RTP_PAYLOAD_TYPE
+        fec_rtpmap,
+        (unsigned)s_ptime_ms
     );
     
     return len;
@@ -194,7 +474,7 @@ static void sap_announcement_task(void *arg)
     
     // Get IP address as 32-bit value
     esp_netif_ip_info_t ip_info;
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_t *netif = net_iface_primary();
     if (netif != NULL) {
         esp_netif_get_ip_info(netif, &ip_info);
         sap_header->origin_src = ip_info.ip.addr;
@@ -268,10 +548,21 @@ static void sap_announcement_task(void *arg)
 
 static void rtp_sender_task(void *arg);
 
+// Sender task stages (CONFIG_METRICS_PROFILER); the send includes the fan-out copies
+static metrics_profile_t prof_build = METRICS_PROFILE_INIT("tx_build", "Gain and byte swap from the capture ring into a packet");
+static metrics_profile_t prof_send = METRICS_PROFILE_INIT("tx_send", "sendto of one packet to every destination");
+#ifdef CONFIG_RTP_SRTP_ENABLED
+static metrics_profile_t prof_srtp = METRICS_PROFILE_INIT("tx_srtp", "SRTP encryption and authentication tag");
+#endif
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+static void send_opus_packet(const uint8_t *packet, size_t len);
+#endif
+
 esp_err_t rtp_sender_init(void)
 {
     if (s_is_sender_initialized) {
-        ESP_LOGW(TAG, "RTP sender already initialized");
+        // Kept through rtp_sender_stop(), e.g. across a switch to a receiver mode and back
+        ESP_LOGI(TAG, "RTP sender already initialized, reusing its sockets");
         return ESP_OK;
     }
     
@@ -281,6 +572,9 @@ esp_err_t rtp_sender_init(void)
     s_rtp_ssrc = esp_random();
     s_rtp_seq_num = esp_random() & 0xFFFF;
     s_rtp_timestamp = 0;  // Start timestamp at 0 for cleaner debugging
+#ifdef CONFIG_RTP_FEC_ENABLED
+    s_fec_seq_num = esp_random() & 0xFFFF;
+#endif
     
     ESP_LOGI(TAG, "RTP SSRC: 0x%08X, Initial seq: %u", s_rtp_ssrc, s_rtp_seq_num);
     
@@ -301,14 +595,8 @@ esp_err_t rtp_sender_init(void)
         ESP_LOGW(TAG, "Failed to set SO_SNDTIMEO: errno %d", errno);
     }
     
-    // Set QoS priority for audio traffic
-    #if defined(IP_TOS) && defined(IPTOS_DSCP_EF)
-    // Use Expedited Forwarding (EF) for real-time audio
-    int opt_val = IPTOS_DSCP_EF;
-    if (setsockopt(s_sock, IPPROTO_IP, IP_TOS, &opt_val, sizeof(opt_val)) < 0) {
-        ESP_LOGW(TAG, "Failed to set IP_TOS: errno %d", errno);
-    }
-    #endif
+    // Set QoS priority for audio traffic (DSCP, and with it the WMM access category)
+    wifi_manager_mark_audio_socket(s_sock);
     
     // Initialize SAP socket for announcements
     ESP_LOGI(TAG, "Initializing SAP socket for announcements");
@@ -335,8 +623,8 @@ esp_err_t rtp_sender_init(void)
     ESP_LOGI(TAG, "SAP socket configured for %s:%d", SAP_MULTICAST_ADDR, SAP_PORT);
     
     // Initialize the destination address from lifecycle manager
-    const char* dest_ip = lifecycle_get_sender_destination_ip();
-    uint16_t dest_port = lifecycle_get_sender_destination_port();
+    const char* dest_ip = sender_destination_ip();
+    uint16_t dest_port = sender_destination_port();
     memset(&s_dest_addr, 0, sizeof(s_dest_addr));
     s_dest_addr.sin_family = AF_INET;
     s_dest_addr.sin_addr.s_addr = inet_addr(dest_ip);
@@ -348,6 +636,13 @@ esp_err_t rtp_sender_init(void)
         handle_multicast_membership(s_sock, dest_ip, true);
     }
 
+    if (!s_fanout_mutex) {
+        s_fanout_mutex = xSemaphoreCreateMutex();
+        if (!s_fanout_mutex) {
+            ESP_LOGW(TAG, "Failed to create fan-out mutex, sending to the destination only");
+        }
+    }
+
     s_is_sender_initialized = true;
     return ESP_OK;
 }
@@ -363,19 +658,96 @@ esp_err_t rtp_sender_start(void)
         ESP_LOGW(TAG, "RTP sender already running");
         return ESP_OK;
     }
+    metrics_profile_register(&prof_build);
+    metrics_profile_register(&prof_send);
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    metrics_register(&s_mix_peak_spdif_metric.base);
+    metrics_register(&s_mix_peak_usb_metric.base);
+#endif
+#ifdef CONFIG_RTP_TX_DTX
+    metrics_register(&s_dtx_paused_metric.base);
+    metrics_register(&s_dtx_pauses.base);
+    metrics_register(&s_dtx_suppressed.base);
+#endif
     
     ESP_LOGI(TAG, "Starting RTP sender");
+
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    metrics_profile_register(&prof_srtp);
+    rtp_srtp_deinit(&s_tx_srtp);
+    const char *srtp_crypto = lifecycle_get_srtp_crypto();
+    if (srtp_crypto[0] != '\0') {
+        if (rtp_srtp_init(&s_tx_srtp, srtp_crypto) != ESP_OK) {
+            // Sending in the clear would defeat the point of configuring a key
+            ESP_LOGE(TAG, "SRTP key is invalid, not starting the sender");
+            return ESP_ERR_INVALID_ARG;
+        }
+        ESP_LOGI(TAG, "TX SRTP: %s (no FEC parity or Opus)", rtp_srtp_suite_name(s_tx_srtp.suite));
+    }
+#endif
     
+    s_ptime_ms = lifecycle_get_ptime_ms();
+    s_chunk_bytes = pcm_chunk_bytes_for_ptime(s_ptime_ms, RTP_SAMPLE_RATE, RTP_BYTES_PER_FRAME);
+    ESP_LOGI(TAG, "Packet time %u ms (%u bytes per packet)", s_ptime_ms, s_chunk_bytes);
+
+#ifdef CONFIG_RTP_TX_ADAPT
+#ifdef CONFIG_RTP_FEC_ENABLED
+    tx_adapt_reset(s_ptime_ms, CONFIG_RTP_FEC_GROUP_PACKETS);
+#else
+    tx_adapt_reset(s_ptime_ms, 0);
+#endif
+#endif
+
+    // Fan-out list is built by the next rtp_sender_fanout_tick()
+    s_fanout_count = 0;
+    s_primary_sent = 0;
+    s_primary_errors = 0;
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+    // Codec selection is known up front, so the first SAP announcement is right
+    atomic_store(&s_primary_opus, lifecycle_get_sender_opus() && !TX_SRTP_ACTIVE());
+#endif
+    rtp_sender_reload_fanout();
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+    rtx_reset();
+#endif
+
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    // A sender can only pass its stream on; listening is for receivers
+    if (lifecycle_get_relay_role() == RTP_RELAY_FORWARD &&
+        rtp_relay_start(RTP_RELAY_FORWARD, lifecycle_get_relay_peers()) != ESP_OK) {
+        ESP_LOGW(TAG, "Relay not started, sending over Wi-Fi only");
+    }
+#endif
+
     s_is_sender_running = true;
 
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+    opus_out_set_complexity(lifecycle_get_sender_opus_complexity());
+    if (TX_SRTP_ACTIVE()) {
+        // Destinations tagged /opus are sent L16 instead (see fanout_rebuild())
+    } else if (opus_out_start(s_rtp_ssrc, send_opus_packet) != ESP_OK) {
+        ESP_LOGW(TAG, "Opus encoder unavailable, Opus destinations get nothing");
+    }
+#endif
+
     // Create the sender task
-    xTaskCreatePinnedToCore(rtp_sender_task, "rtp_sender_task", 8192, NULL, 5, &s_sender_task_handle, 1);
+    pipeline_task_create(PIPELINE_STAGE_SEND, rtp_sender_task, "rtp_sender_task", 8192, NULL, &s_sender_task_handle);
     
     // Create the SAP announcement task - needs more stack for large buffers
     xTaskCreatePinnedToCore(sap_announcement_task, "sap_announce_task",
                            4096, NULL, 5, &s_sap_task_handle, 0);
     
     ESP_LOGI(TAG, "SAP announcement task started");
+
+#ifdef CONFIG_RTCP_SEND_SR
+    // Sender Reports let receivers map our RTP time onto the NTP timeline
+    if (rtcp_sender_start(s_rtp_ssrc, RTP_SAMPLE_RATE) != ESP_OK) {
+        ESP_LOGW(TAG, "RTCP sender reports unavailable, receivers fall back to unsynchronized playout");
+    }
+#endif
+
+    // No modem sleep while streaming: keeps RTCP and acks from waiting for a beacon
+    wifi_manager_set_streaming(true);
     
     return ESP_OK;
 }
@@ -396,6 +768,11 @@ esp_err_t rtp_sender_stop(void)
     
     s_is_sender_running = false;
 
+#ifdef CONFIG_RTCP_SEND_SR
+    // BYE goes out to the destinations before they are forgotten
+    rtcp_sender_stop();
+#endif
+
     // Wait for tasks to self-delete (they both check s_is_sender_running and call vTaskDelete(NULL))
     // Give them time to clean up properly
     if (s_sender_task_handle || s_sap_task_handle) {
@@ -407,16 +784,22 @@ esp_err_t rtp_sender_stop(void)
         s_sap_task_handle = NULL;
     }
 
-    // Clean up sockets
-    if (s_sock != -1) {
-        close(s_sock);
-        s_sock = -1;
-    }
-    
-    if (s_sap_sock != -1) {
-        close(s_sap_sock);
-        s_sap_sock = -1;
-    }
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+    // After the sender task, which pushes to it, and before the socket it sends on
+    opus_out_stop();
+#endif
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    // After the RTCP BYE and the sender task, both of which it passes on
+    rtp_relay_stop();
+#endif
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    rtp_srtp_deinit(&s_tx_srtp);
+#endif
+
+    // The sockets (and any multicast membership) stay open: the sender remains
+    // initialized, and the next rtp_sender_start() sends on them again
+
+    wifi_manager_set_streaming(false);
 
     return ESP_OK;
 }
@@ -429,6 +812,10 @@ bool rtp_sender_is_running(void)
 void rtp_sender_set_mute(bool mute)
 {
     s_is_muted = mute;
+    TaskHandle_t task = s_sender_task_handle;
+    if (s_is_sender_running && task) {
+        xTaskNotifyGive(task);  // Leave the muted wait at once
+    }
     ESP_LOGI(TAG, "RTP sender mute set to %d", mute);
 }
 
@@ -454,8 +841,8 @@ esp_err_t rtp_sender_update_destination(void)
     bool had_multicast = (strlen(prev_dest_ip) > 0 && is_multicast_address(prev_dest_ip));
     
     // Get the destination address from lifecycle manager
-    const char* dest_ip = lifecycle_get_sender_destination_ip();
-    uint16_t dest_port = lifecycle_get_sender_destination_port();
+    const char* dest_ip = sender_destination_ip();
+    uint16_t dest_port = sender_destination_port();
     
     // Validate IP address
     if (dest_ip == NULL || strlen(dest_ip) == 0) {
@@ -515,6 +902,9 @@ esp_err_t rtp_sender_update_destination(void)
     ESP_LOGI(TAG, "Updated RTP sender destination to %s:%u%s",
              dest_ip, dest_port, is_multicast ? " (multicast)" : "");
     
+    // The primary destination is left out of the fan-out list
+    rtp_sender_reload_fanout();
+
     // If sender is running, the changes take effect immediately on the next packet
     if (s_is_sender_running) {
         ESP_LOGI(TAG, "Sender is running, destination changes will take effect immediately");
@@ -523,6 +913,19 @@ esp_err_t rtp_sender_update_destination(void)
     return ESP_OK;
 }
 
+esp_err_t rtp_sender_set_auto_destination(uint32_t addr, uint16_t port)
+{
+    struct in_addr in = { .s_addr = addr };
+    if (addr == 0) {
+        s_auto_dest_ip[0] = '\0';
+    } else {
+        strncpy(s_auto_dest_ip, inet_ntoa(in), sizeof(s_auto_dest_ip) - 1);
+        s_auto_dest_ip[sizeof(s_auto_dest_ip) - 1] = '\0';
+    }
+    s_auto_dest_port = port;
+    return rtp_sender_update_destination();
+}
+
 // Helper function to check if an IP address is multicast
 static bool is_multicast_address(const char *ip_str)
 {
@@ -569,60 +972,908 @@ static esp_err_t handle_multicast_membership(int sock, const char *multicast_ip,
     return ESP_OK;
 }
 
+// Add addr:port to list unless it is the primary destination, this device or already listed
+static void fanout_add(tx_fanout_dest_t *list, size_t *count, uint32_t addr, uint16_t port,
+                       uint32_t self_addr, bool from_mdns, bool opus)
+{
+    if (*count >= CONFIG_RTP_TX_FANOUT_MAX || addr == 0 || addr == self_addr) {
+        return;
+    }
+    if (addr == s_dest_addr.sin_addr.s_addr && htons(port) == s_dest_addr.sin_port) {
+        return;
+    }
+    for (size_t i = 0; i < *count; i++) {
+        if (list[i].addr.sin_addr.s_addr == addr && list[i].addr.sin_port == htons(port)) {
+            return;
+        }
+    }
+    tx_fanout_dest_t *d = &list[(*count)++];
+    memset(d, 0, sizeof(*d));
+    d->addr.sin_family = AF_INET;
+    d->addr.sin_addr.s_addr = addr;
+    d->addr.sin_port = htons(port);
+    d->from_mdns = from_mdns;
+    d->opus = opus;
+    d->active = true;
+}
+
+// Build the destination list from the settings and mDNS, keeping the counters and the
+// dropped state of destinations that stay on it. An address may be tagged "/opus" or
+// "/l16"; untagged ones and mDNS receivers get the same codec as the destination.
+static void fanout_rebuild(void)
+{
+    static tx_fanout_dest_t next[CONFIG_RTP_TX_FANOUT_MAX];
+    static discovered_device_t devices[MAX_DISCOVERED_DEVICES];
+    size_t count = 0;
+    uint16_t port = ntohs(s_dest_addr.sin_port);   // Fan-out shares the destination port
+
+    uint32_t self_addr = 0;
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t *netif = net_iface_primary();
+    if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
+        self_addr = ip_info.ip.addr;
+    }
+
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+    bool primary_opus = lifecycle_get_sender_opus() && !TX_SRTP_ACTIVE();
+#else
+    bool primary_opus = false;
+#endif
+
+    char ips[sizeof(((app_config_t *)0)->sender_fanout_ips)];
+    strncpy(ips, lifecycle_get_sender_fanout_ips(), sizeof(ips) - 1);
+    ips[sizeof(ips) - 1] = '\0';
+    char *save = NULL;
+    for (char *tok = strtok_r(ips, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+        bool opus = primary_opus;
+        char *codec = strchr(tok, '/');
+        if (codec) {
+            *codec++ = '\0';
+            if (strcasecmp(codec, "opus") == 0) {
+                opus = true;
+            } else if (strcasecmp(codec, "l16") == 0) {
+                opus = false;
+            } else {
+                ESP_LOGW(TAG, "Fan-out: unknown codec \"%s\" for %s, using the destination's", codec, tok);
+            }
+        }
+#ifndef CONFIG_RTP_TX_OPUS_ENABLED
+        if (opus) {
+            ESP_LOGW(TAG, "Fan-out: Opus not built in, sending L16 to %s", tok);
+            opus = false;
+        }
+#endif
+        if (opus && TX_SRTP_ACTIVE()) {
+            ESP_LOGW(TAG, "Fan-out: no Opus under SRTP, sending L16 to %s", tok);
+            opus = false;
+        }
+        struct in_addr addr;
+        if (inet_aton(tok, &addr) == 0) {
+            ESP_LOGW(TAG, "Fan-out: ignoring invalid address \"%s\"", tok);
+            continue;
+        }
+        fanout_add(next, &count, addr.s_addr, port, self_addr, false, opus);
+    }
+
+    if (lifecycle_get_sender_fanout_mdns()) {
+        size_t found = 0;
+        if (mdns_discovery_get_devices(devices, MAX_DISCOVERED_DEVICES, &found) == ESP_OK) {
+            for (size_t i = 0; i < found; i++) {
+                fanout_add(next, &count, devices[i].ip_addr.addr, devices[i].port ? devices[i].port : port,
+                           self_addr, true, primary_opus);
+            }
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_fanout_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < s_fanout_count; j++) {
+            const tx_fanout_dest_t *old = &s_fanout[j];
+            if (old->addr.sin_addr.s_addr != next[i].addr.sin_addr.s_addr ||
+                old->addr.sin_port != next[i].addr.sin_port) {
+                continue;
+            }
+            next[i].sent = old->sent;
+            next[i].errors = old->errors;
+            // A dropped destination gets another chance once the retry interval has passed
+            if (!old->active && now - old->dropped_us < (int64_t)CONFIG_RTP_TX_FANOUT_RETRY_MS * 1000) {
+                next[i].active = false;
+                next[i].dropped_us = old->dropped_us;
+            }
+            break;
+        }
+    }
+    bool changed = count != s_fanout_count || primary_opus != atomic_load(&s_primary_opus);
+    size_t opus_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        changed = changed || next[i].addr.sin_addr.s_addr != s_fanout[i].addr.sin_addr.s_addr ||
+                  next[i].addr.sin_port != s_fanout[i].addr.sin_port || next[i].opus != s_fanout[i].opus;
+        opus_count += next[i].opus ? 1 : 0;
+    }
+    bool opus_wanted = primary_opus || opus_count > 0;
+    memcpy(s_fanout, next, count * sizeof(next[0]));
+    s_fanout_count = count;
+    atomic_store(&s_primary_opus, primary_opus);
+    atomic_store(&s_opus_wanted, opus_wanted);
+    xSemaphoreGive(s_fanout_mutex);
+
+    if (changed) {
+        ESP_LOGI(TAG, "Fan-out: %u unicast destination(s) besides %s (%s), %u on Opus", (unsigned)count,
+                 inet_ntoa(s_dest_addr.sin_addr), primary_opus ? "Opus" : "L16", (unsigned)opus_count);
+    }
+}
+
+// Send one built packet to every active fan-out destination on its codec (sender or
+// encoder task)
+static void fanout_send(const uint8_t *packet, size_t len, bool opus)
+{
+    if (!s_fanout_mutex || xSemaphoreTake(s_fanout_mutex, 1) != pdTRUE) {
+        return;
+    }
+    for (size_t i = 0; i < s_fanout_count; i++) {
+        tx_fanout_dest_t *d = &s_fanout[i];
+        if (!d->active || d->opus != opus) {
+            continue;
+        }
+        if (sendto(s_sock, packet, len, 0, (struct sockaddr *)&d->addr, sizeof(d->addr)) >= 0) {
+            d->sent++;
+            d->fails = 0;
+            continue;
+        }
+        int err = errno;
+        d->errors++;
+        if ((err == ENOMEM || err == EHOSTUNREACH) && ++d->fails >= CONFIG_RTP_TX_FANOUT_MAX_FAILS) {
+            d->active = false;
+            d->dropped_us = esp_timer_get_time();
+            ESP_LOGW(TAG, "Fan-out: dropping %s after %u failed sends (errno %d)",
+                     inet_ntoa(d->addr.sin_addr), (unsigned)d->fails, err);
+        }
+    }
+    xSemaphoreGive(s_fanout_mutex);
+}
+
+void rtp_sender_reload_fanout(void)
+{
+    atomic_store(&s_fanout_reload, true);
+}
+
+void rtp_sender_fanout_tick(void)
+{
+    if (!s_is_sender_running || !s_fanout_mutex) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    bool reload = atomic_exchange(&s_fanout_reload, false);
+    // Follow mDNS, and give dropped destinations their retry, without a settings change
+    if (!reload && now - s_fanout_refresh_us < (int64_t)CONFIG_RTP_TX_FANOUT_REFRESH_MS * 1000) {
+        return;
+    }
+    s_fanout_refresh_us = now;
+    fanout_rebuild();
+}
+
+size_t rtp_sender_get_destinations(rtp_sender_dest_stats_t *out, size_t max)
+{
+    if (!out || max == 0) {
+        return 0;
+    }
+    size_t n = 0;
+    out[n++] = (rtp_sender_dest_stats_t){
+        .addr = s_dest_addr.sin_addr.s_addr,
+        .port = ntohs(s_dest_addr.sin_port),
+        .primary = true,
+        .opus = atomic_load(&s_primary_opus),
+        .active = true,
+        .sent = s_primary_sent,
+        .errors = s_primary_errors,
+    };
+    if (!s_fanout_mutex || xSemaphoreTake(s_fanout_mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return n;
+    }
+    for (size_t i = 0; i < s_fanout_count && n < max; i++, n++) {
+        const tx_fanout_dest_t *d = &s_fanout[i];
+        out[n] = (rtp_sender_dest_stats_t){
+            .addr = d->addr.sin_addr.s_addr,
+            .port = ntohs(d->addr.sin_port),
+            .from_mdns = d->from_mdns,
+            .opus = d->opus,
+            .active = d->active,
+            .sent = d->sent,
+            .errors = d->errors,
+        };
+    }
+    xSemaphoreGive(s_fanout_mutex);
+    return n;
+}
+
+bool rtp_sender_get_capture_stats(pcm_ring_stats_t *out)
+{
+    pcm_ring_t *ring = s_capture_ring;
+    pcm_ring_get_stats(ring, out);
+    return ring != NULL;
+}
+
+bool rtp_sender_get_mix_stats(rtp_sender_mix_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    if (!atomic_load_explicit(&s_mix_active, memory_order_relaxed)) {
+        return false;
+    }
+    out->clock = atomic_load_explicit(&s_mix_clock, memory_order_relaxed);
+    for (int i = 0; i < RTP_SENDER_MIX_SOURCES; i++) {
+        pcm_ring_t *ring = s_mix_rings[i];
+        out->source[i].peak = atomic_load_explicit(&s_mix_peak[i], memory_order_relaxed);
+        out->source[i].fill = ring ? (uint32_t)pcm_ring_fill(ring) : 0;
+        out->source[i].slips = atomic_load_explicit(&s_mix_slips[i], memory_order_relaxed);
+        out->source[i].underruns = atomic_load_explicit(&s_mix_underruns[i], memory_order_relaxed);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef CONFIG_RTP_FEC_ENABLED
+// Send the parity packet covering the media packets added to enc since the last one
+static void send_fec_packet(rtp_fec_encoder_t *enc, uint8_t *packet, size_t packet_size)
+{
+    uint32_t ts = 0;
+    size_t fec_len = rtp_fec_encoder_finish(enc, packet + HEADER_SIZE, packet_size - HEADER_SIZE, &ts);
+    if (fec_len == 0) {
+        return;
+    }
+
+    rtp_header_t *header = (rtp_header_t *)packet;
+    header->vpxcc = 0x80;
+    header->mpt = CONFIG_RTP_FEC_PAYLOAD_TYPE;
+    header->seq_num = htons(s_fec_seq_num++);
+    header->timestamp = htonl(ts);
+    header->ssrc = htonl(s_rtp_ssrc);
+
+    // Parity protects the L16 stream only
+    if (!atomic_load_explicit(&s_primary_opus, memory_order_relaxed) &&
+        sendto(s_sock, packet, HEADER_SIZE + fec_len, 0,
+               (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr)) < 0) {
+        ESP_LOGD(TAG, "Failed to send FEC packet: errno %d", errno);
+    }
+    fanout_send(packet, HEADER_SIZE + fec_len, false);
+}
+#endif
+
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+static void rtx_reset(void)
+{
+    if (!s_rtx_data) {
+        s_rtx_data = heap_caps_malloc((size_t)RTX_SLOTS * PACKET_MAX_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_rtx_data) {
+            ESP_LOGW(TAG, "No PSRAM for the retransmit cache (%u packets), NACKs go unanswered",
+                     (unsigned)RTX_SLOTS);
+            return;
+        }
+    }
+    for (size_t i = 0; i < RTX_SLOTS; i++) {
+        atomic_store(&s_rtx_slots[i].gen, 0);
+        s_rtx_slots[i].len = 0;
+        s_rtx_slots[i].resent_us = 0;
+    }
+    s_rtx_credit_us = (int64_t)RTX_BURST * RTX_TOKEN_US;
+    s_rtx_credit_at_us = esp_timer_get_time();
+    atomic_store_explicit(&s_rtx_requested, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_rtx_sent, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_rtx_missed, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_rtx_limited, 0, memory_order_relaxed);
+}
+
+// Keep a copy of a packet as it went out (sender task)
+static void rtx_store(const uint8_t *packet, size_t len)
+{
+    if (!s_rtx_data || len > PACKET_MAX_SIZE) {
+        return;
+    }
+    uint16_t seq = ntohs(((const rtp_header_t *)packet)->seq_num);
+    tx_rtx_slot_t *slot = &s_rtx_slots[seq % RTX_SLOTS];
+    unsigned gen = atomic_load_explicit(&slot->gen, memory_order_relaxed);
+    atomic_store_explicit(&slot->gen, gen + 1U, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(s_rtx_data + (size_t)(seq % RTX_SLOTS) * PACKET_MAX_SIZE, packet, len);
+    slot->seq = seq;
+    slot->len = (uint16_t)len;
+    atomic_store_explicit(&slot->gen, gen + 2U, memory_order_release);
+}
+
+// Where a resend for a NACK from addr goes: the multicast group, or that L16 destination
+static bool rtx_destination(uint32_t addr, struct sockaddr_in *to)
+{
+    bool primary_l16 = !atomic_load_explicit(&s_primary_opus, memory_order_relaxed);
+    if (primary_l16 && (IN_MULTICAST(ntohl(s_dest_addr.sin_addr.s_addr)) ||
+                        s_dest_addr.sin_addr.s_addr == addr)) {
+        *to = s_dest_addr;
+        return true;
+    }
+    bool found = false;
+    if (s_fanout_mutex && xSemaphoreTake(s_fanout_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
+        for (size_t i = 0; i < s_fanout_count && !found; i++) {
+            const tx_fanout_dest_t *d = &s_fanout[i];
+            if (d->active && !d->opus && d->addr.sin_addr.s_addr == addr) {
+                *to = d->addr;
+                found = true;
+            }
+        }
+        xSemaphoreGive(s_fanout_mutex);
+    }
+    return found;
+}
+
+void rtp_sender_retransmit(uint16_t seq, uint32_t addr)
+{
+    if (!s_is_sender_running || !s_rtx_data) {
+        return;
+    }
+    atomic_fetch_add_explicit(&s_rtx_requested, 1, memory_order_relaxed);
+    tx_rtx_slot_t *slot = &s_rtx_slots[seq % RTX_SLOTS];
+    int64_t now = esp_timer_get_time();
+    if (slot->resent_us != 0 && slot->resent_seq == seq && now - slot->resent_us < RTX_REPEAT_US) {
+        atomic_fetch_add_explicit(&s_rtx_limited, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Copy the packet out; a slot rewritten meanwhile has moved on to a newer packet
+    unsigned gen = atomic_load_explicit(&slot->gen, memory_order_acquire);
+    size_t len = slot->len;
+    bool cached = !(gen & 1U) && slot->seq == seq && len > 0;
+    if (cached) {
+        memcpy(s_rtx_scratch, s_rtx_data + (size_t)(seq % RTX_SLOTS) * PACKET_MAX_SIZE, len);
+        atomic_thread_fence(memory_order_acquire);
+        cached = atomic_load_explicit(&slot->gen, memory_order_relaxed) == gen;
+    }
+    if (!cached) {
+        atomic_fetch_add_explicit(&s_rtx_missed, 1, memory_order_relaxed);
+        return;
+    }
+
+    struct sockaddr_in to;
+    if (!rtx_destination(addr, &to)) {
+        atomic_fetch_add_explicit(&s_rtx_missed, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Token bucket: RTX_TOKEN_US of credit per resend, refilled in real time
+    s_rtx_credit_us += now - s_rtx_credit_at_us;
+    s_rtx_credit_at_us = now;
+    if (s_rtx_credit_us > (int64_t)RTX_BURST * RTX_TOKEN_US) {
+        s_rtx_credit_us = (int64_t)RTX_BURST * RTX_TOKEN_US;
+    }
+    if (s_rtx_credit_us < RTX_TOKEN_US) {
+        atomic_fetch_add_explicit(&s_rtx_limited, 1, memory_order_relaxed);
+        return;
+    }
+    s_rtx_credit_us -= RTX_TOKEN_US;
+
+    if (sendto(s_sock, s_rtx_scratch, len, 0, (struct sockaddr *)&to, sizeof(to)) >= 0) {
+        atomic_fetch_add_explicit(&s_rtx_sent, 1, memory_order_relaxed);
+        slot->resent_seq = seq;
+        slot->resent_us = now;
+    } else {
+        ESP_LOGD(TAG, "Retransmit of seq %u failed: errno %d", seq, errno);
+    }
+}
+#endif
+
+void rtp_sender_get_rtx_stats(rtp_sender_rtx_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+    out->requested = atomic_load_explicit(&s_rtx_requested, memory_order_relaxed);
+    out->sent = atomic_load_explicit(&s_rtx_sent, memory_order_relaxed);
+    out->missed = atomic_load_explicit(&s_rtx_missed, memory_order_relaxed);
+    out->limited = atomic_load_explicit(&s_rtx_limited, memory_order_relaxed);
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
+
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+// Send one encoded Opus packet to the destinations on Opus (encoder task)
+static void send_opus_packet(const uint8_t *packet, size_t len)
+{
+    if (atomic_load_explicit(&s_primary_opus, memory_order_relaxed)) {
+        if (sendto(s_sock, packet, len, 0, (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr)) >= 0) {
+            s_primary_sent++;
+        } else {
+            s_primary_errors++;
+            ESP_LOGD(TAG, "Failed to send Opus packet: errno %d", errno);
+        }
+    }
+    fanout_send(packet, len, true);
+}
+#endif
+
+static void tx_pace_timer_cb(void *arg)
+{
+    TaskHandle_t task = ((tx_pace_t *)arg)->task;
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void tx_pace_init(tx_pace_t *pace, pcm_ring_t *ring)
+{
+    memset(pace, 0, sizeof(*pace));
+    pace->task = xTaskGetCurrentTaskHandle();
+    pace->period_us = (uint32_t)((uint64_t)(s_chunk_bytes / RTP_BYTES_PER_FRAME) * 1000000u / RTP_SAMPLE_RATE);
+    pace->ring_bytes = (uint32_t)pcm_ring_size(ring);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = tx_pace_timer_cb,
+        .arg = pace,
+        .name = "rtp_tx_pace",
+    };
+    if (esp_timer_create(&timer_args, &pace->timer) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create pacing timer, falling back to tick delays");
+        pace->timer = NULL;
+    }
+}
+
+static void tx_pace_deinit(tx_pace_t *pace)
+{
+    if (pace->timer) {
+        esp_timer_stop(pace->timer);  // May not be running; ignore result
+        esp_timer_delete(pace->timer);
+        pace->timer = NULL;
+    }
+}
+
+// Block until the next packet's deadline, then schedule the one after it
+static void tx_pace_wait(tx_pace_t *pace, pcm_ring_t *ring)
+{
+    int64_t now = esp_timer_get_time();
+    if (pace->next_due_us == 0 || now > pace->next_due_us + 2 * (int64_t)pace->period_us) {
+        // First packet, or we fell behind (input gap, send stall): restart from now rather
+        // than bursting to catch up
+        pace->next_due_us = now;
+    }
+
+    while (pace->next_due_us > now) {
+        uint64_t wait_us = (uint64_t)(pace->next_due_us - now);
+        if (!pace->timer) {
+            TickType_t ticks = pdMS_TO_TICKS(wait_us / 1000u);
+            vTaskDelay(ticks ? ticks : 1);
+        } else {
+            esp_timer_stop(pace->timer);
+            if (esp_timer_start_once(pace->timer, wait_us) != ESP_OK) {
+                vTaskDelay(1);
+            } else {
+                // Tick timeout only as a safety net in case the timer is lost
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_us / 1000u) + 2);
+            }
+        }
+        now = esp_timer_get_time();
+    }
+
+    // Audio left in the ring after this packet was taken: more than a packet means the input
+    // clock runs ahead of our nominal rate, less that it runs behind
+    int32_t trim = 0;
+    if (ring && pace->ring_bytes) {
+        int32_t fill = (int32_t)pcm_ring_fill(ring);
+        int32_t err = fill - (int32_t)s_chunk_bytes;
+        trim = (int32_t)(((int64_t)err * pace->period_us / (int32_t)s_chunk_bytes) >> TX_PACE_GAIN_SHIFT);
+        int32_t max_trim = (int32_t)((uint64_t)pace->period_us * CONFIG_RTP_TX_PACE_MAX_PPM / 1000000u);
+        if (trim > max_trim) {
+            trim = max_trim;
+        } else if (trim < -max_trim) {
+            trim = -max_trim;
+        }
+    }
+    pace->next_due_us += (int64_t)pace->period_us - trim;
+}
+
+#ifdef CONFIG_RTP_TX_DTX
+// Muted: nothing is sent, so whatever comes next follows a gap
+static void tx_dtx_reset(tx_dtx_t *dtx)
+{
+    memset(dtx, 0, sizeof(*dtx));
+    dtx->mark = true;
+    atomic_store_explicit(&s_dtx_paused, false, memory_order_relaxed);
+}
+
+// Account one packet of audio; true when it is to be held back as part of a pause
+static bool tx_dtx_hold(tx_dtx_t *dtx, bool silent, uint32_t period_us, int64_t now)
+{
+    if (!silent) {
+        if (dtx->paused) {
+            ESP_LOGD(TAG, "DTX: audio resumed");
+            dtx->paused = false;
+            dtx->mark = true;
+            atomic_store_explicit(&s_dtx_paused, false, memory_order_relaxed);
+        }
+        dtx->silent_us = 0;
+        return false;
+    }
+    if (!dtx->paused) {
+        dtx->silent_us += period_us;
+        if (dtx->silent_us < (uint32_t)CONFIG_RTP_TX_DTX_HANGOVER_MS * 1000u) {
+            return false;
+        }
+        ESP_LOGD(TAG, "DTX: pausing after %" PRIu32 " ms of digital silence", dtx->silent_us / 1000u);
+        dtx->paused = true;
+        dtx->keepalive_due_us = CONFIG_RTP_TX_DTX_KEEPALIVE_MS > 0 ?
+                                now + (int64_t)CONFIG_RTP_TX_DTX_KEEPALIVE_MS * 1000 : 0;
+        atomic_store_explicit(&s_dtx_paused, true, memory_order_relaxed);
+        metrics_counter_inc(&s_dtx_pauses);
+    }
+    if (dtx->keepalive_due_us != 0 && now >= dtx->keepalive_due_us) {
+        dtx->keepalive_due_us = now + (int64_t)CONFIG_RTP_TX_DTX_KEEPALIVE_MS * 1000;
+        dtx->mark = true;
+        return false;
+    }
+    metrics_counter_inc(&s_dtx_suppressed);
+    return true;
+}
+#endif
+
+#ifdef CONFIG_SENDER_MIX_ENABLED
+static void tx_mix_init(tx_mix_t *mix)
+{
+    memset(mix, 0, sizeof(*mix));
+    mix->clock = RTP_SENDER_MIX_SPDIF;
+    mix->dither.rng = 0x2545F491u;
+    for (int i = 0; i < RTP_SENDER_MIX_SOURCES; i++) {
+        mix->src[i].gain_q30 = PCM_GAIN_Q30_UNITY;
+        s_mix_rings[i] = NULL;
+        atomic_store_explicit(&s_mix_peak[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&s_mix_slips[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&s_mix_underruns[i], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&s_mix_clock, RTP_SENDER_MIX_SPDIF, memory_order_relaxed);
+}
+
+// Input to clock the next packet from: S/PDIF while it is locked, USB otherwise, so either
+// one on its own still gets through. The rings are looked up per packet: USB may start late
+static uint8_t tx_mix_pick_clock(tx_mix_t *mix)
+{
+    mix->src[RTP_SENDER_MIX_SPDIF].ring = spdif_in_get_capture_ring();
+    mix->src[RTP_SENDER_MIX_USB].ring = usb_in_get_capture_ring();
+    for (int i = 0; i < RTP_SENDER_MIX_SOURCES; i++) {
+        s_mix_rings[i] = mix->src[i].ring;
+    }
+
+    uint8_t clock = RTP_SENDER_MIX_SPDIF;
+    if (spdif_in_get_sample_rate() == 0 && mix->src[RTP_SENDER_MIX_USB].ring) {
+        clock = RTP_SENDER_MIX_USB;
+    }
+    if (clock != mix->clock) {
+        // The input giving up the clock fills to the target again before it is mixed
+        mix->src[mix->clock].primed = false;
+        mix->clock = clock;
+        atomic_store_explicit(&s_mix_clock, clock, memory_order_relaxed);
+    }
+    return clock;
+}
+
+// Fresh start for both inputs (unmute)
+static void tx_mix_reset(tx_mix_t *mix)
+{
+    for (int i = 0; i < RTP_SENDER_MIX_SOURCES; i++) {
+        if (mix->src[i].ring) {
+            pcm_ring_reset(mix->src[i].ring);
+        }
+        mix->src[i].primed = false;
+    }
+}
+
+static void tx_mix_meter(uint8_t id, const int16_t *pcm, size_t samples)
+{
+    uint16_t peak = pcm ? pcm_peak_s16(pcm, samples) : 0;
+    uint16_t held = (uint16_t)atomic_load_explicit(&s_mix_peak[id], memory_order_relaxed);
+    held -= held >> TX_MIX_PEAK_DECAY_SHIFT;
+    atomic_store_explicit(&s_mix_peak[id], peak > held ? peak : held, memory_order_relaxed);
+}
+
+static void tx_mix_gain(tx_mix_t *mix, uint8_t id, int16_t *pcm, size_t frames, uint8_t percent)
+{
+    tx_mix_source_t *s = &mix->src[id];
+    int32_t to = (int32_t)(((int64_t)PCM_GAIN_Q30_UNITY * percent) / 100);
+    // Ramped from the last packet's gain; skipped at unity to stay bit-exact
+    if (s->gain_q30 != PCM_GAIN_Q30_UNITY || to != PCM_GAIN_Q30_UNITY) {
+        pcm_gain_ramp_s16(pcm, frames, s->gain_q30, to, &mix->dither);
+    }
+    s->gain_q30 = to;
+}
+
+// One packet of the input that is not clocking, taken at the clock's pace. It is mixed once
+// its ring is half full, so there is room to follow the drift both ways, until it runs dry.
+// The smoothed fill picks the correction: a frame dropped (ahead) or repeated (behind) per
+// packet until it is back near the target. Returns false while the input adds nothing
+static bool tx_mix_pull(tx_mix_t *mix, uint8_t id, int16_t *dst, size_t bytes)
+{
+    tx_mix_source_t *s = &mix->src[id];
+    if (!s->ring) {
+        return false;
+    }
+    const int32_t size = (int32_t)pcm_ring_size(s->ring);
+    const int32_t target = size / (2 * RTP_BYTES_PER_FRAME) * RTP_BYTES_PER_FRAME;
+    int32_t fill = (int32_t)pcm_ring_fill(s->ring);
+    if (!s->primed) {
+        if (fill < target || fill < (int32_t)bytes) {
+            return false;
+        }
+        s->primed = true;
+        s->avg_fill = fill << 4;
+        s->slipping = 0;
+    } else if (fill < (int32_t)bytes) {
+        // Stopped or starved: silent until it has refilled to the target
+        s->primed = false;
+        atomic_fetch_add_explicit(&s_mix_underruns[id], 1, memory_order_relaxed);
+        return false;
+    }
+
+    s->avg_fill += fill - (s->avg_fill >> 4);
+    int32_t err = (s->avg_fill >> 4) - target;
+    if (s->slipping == 0 && (err > size / TX_MIX_SLIP_START_DIV || err < -size / TX_MIX_SLIP_START_DIV)) {
+        s->slipping = err > 0 ? 1 : -1;
+    } else if (s->slipping != 0 && err < size / TX_MIX_SLIP_STOP_DIV && err > -size / TX_MIX_SLIP_STOP_DIV) {
+        s->slipping = 0;
+    }
+
+    size_t take = s->slipping < 0 ? bytes - RTP_BYTES_PER_FRAME : bytes;
+    size_t copied = 0;
+    while (copied < take) {
+        const uint8_t *span = NULL;
+        size_t n = pcm_ring_peek(s->ring, &span, take - copied);
+        if (n == 0) {
+            break;
+        }
+        memcpy((uint8_t *)dst + copied, span, n);
+        pcm_ring_consume(s->ring, n);
+        copied += n;
+    }
+    if (s->slipping < 0) {
+        memcpy((uint8_t *)dst + take, (uint8_t *)dst + take - RTP_BYTES_PER_FRAME, RTP_BYTES_PER_FRAME);
+        atomic_fetch_add_explicit(&s_mix_slips[id], 1, memory_order_relaxed);
+    } else if (s->slipping > 0 && fill >= (int32_t)(bytes + RTP_BYTES_PER_FRAME)) {
+        const uint8_t *span = NULL;
+        if (pcm_ring_peek(s->ring, &span, RTP_BYTES_PER_FRAME) == RTP_BYTES_PER_FRAME) {
+            pcm_ring_consume(s->ring, RTP_BYTES_PER_FRAME);
+            atomic_fetch_add_explicit(&s_mix_slips[id], 1, memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
+// Sum one packet into payload. primary holds the clock's audio (host order); each input gets
+// its own gain, then volume and network byte order go on in one pass as on the plain path
+static void tx_mix_build(tx_mix_t *mix, uint8_t *payload, int16_t *primary, int16_t *aux,
+                         size_t bytes, int32_t gain_q15)
+{
+    const size_t samples = bytes / sizeof(int16_t);
+    const size_t frames = bytes / RTP_BYTES_PER_FRAME;
+    const uint8_t gain_pct[RTP_SENDER_MIX_SOURCES] = {
+        [RTP_SENDER_MIX_SPDIF] = lifecycle_get_sender_mix_gain_spdif(),
+        [RTP_SENDER_MIX_USB] = lifecycle_get_sender_mix_gain_usb(),
+    };
+    uint8_t clock = mix->clock;
+    uint8_t other = clock == RTP_SENDER_MIX_SPDIF ? RTP_SENDER_MIX_USB : RTP_SENDER_MIX_SPDIF;
+
+    tx_mix_meter(clock, primary, samples);
+    tx_mix_gain(mix, clock, primary, frames, gain_pct[clock]);
+    if (tx_mix_pull(mix, other, aux, bytes)) {
+        tx_mix_meter(other, aux, samples);
+        tx_mix_gain(mix, other, aux, frames, gain_pct[other]);
+        pcm_mix_add_sat16(primary, aux, samples);
+    } else {
+        tx_mix_meter(other, NULL, 0);
+    }
+    // The visualizer shows the mix, before the volume
+    pcm_viz_write((const uint8_t *)primary, bytes);
+    pcm_gain_q15_swap16((int16_t *)payload, primary, samples, gain_q15);
+}
+#endif
+
 static void rtp_sender_task(void *arg)
 {
-    static unsigned char rtp_packet[PACKET_SIZE];
-    char audio_buffer[CHUNK_SIZE];
+    // Word-aligned so the sample kernels can take their two-samples-per-word path
+    // Capture ring spans are swapped straight into the payload, so the audio is touched once
+    // before sendto() hands it to the stack
+    static unsigned char rtp_packet[PACKET_MAX_SIZE] __attribute__((aligned(4)));
+    uint8_t *const payload = rtp_packet + HEADER_SIZE;
+    size_t chunk_bytes = s_chunk_bytes;
     size_t bytes_in_buffer = 0;
+    int32_t gain_q15 = PCM_GAIN_Q15_UNITY;
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    // Mixing takes the clock's spans into host-order staging instead of straight into the payload
+    static int16_t mix_primary[CHUNK_MAX_SIZE / sizeof(int16_t)] __attribute__((aligned(4)));
+    static int16_t mix_aux[CHUNK_MAX_SIZE / sizeof(int16_t)] __attribute__((aligned(4)));
+    tx_mix_t mix;
+    tx_mix_init(&mix);
+#endif
 
-    // For pacing the sender to match the audio rate
-    TickType_t xLastWakeTime;
-    // 1152 bytes per chunk / (48000 samples/sec * 2 channels * 2 bytes/sample) = 6ms per chunk
-    const TickType_t xFrequency = pdMS_TO_TICKS(3); 
-    xLastWakeTime = xTaskGetTickCount();
-
-    RingbufHandle_t pcm_out_buffer = NULL;
+#ifdef CONFIG_RTP_FEC_ENABLED
+    static uint8_t fec_parity[CHUNK_MAX_SIZE + PROBE_EXT_SIZE];
+    static uint8_t fec_packet[HEADER_SIZE + RTP_FEC_HEADER_SIZE + CHUNK_MAX_SIZE + PROBE_EXT_SIZE];
+    rtp_fec_encoder_t fec;
+    rtp_fec_encoder_init(&fec, fec_parity, sizeof(fec_parity));
+    // No parity under SRTP: it would be sent on the media SSRC with its own sequence numbers
+    uint8_t fec_group = TX_SRTP_ACTIVE() ? 0 : CONFIG_RTP_FEC_GROUP_PACKETS;
+    if (fec_group > 0) {
+        ESP_LOGI(TAG, "FEC: one parity packet (PT %d) per %d media packets",
+                 CONFIG_RTP_FEC_PAYLOAD_TYPE, CONFIG_RTP_FEC_GROUP_PACKETS);
+    }
+#endif
+#ifdef CONFIG_RTP_TX_ADAPT
+    uint8_t packet_ptime_ms = s_ptime_ms;
+#endif
+#ifdef CONFIG_RTP_LATENCY_PROBE
+    int64_t capture_us = 0;     // When the packet's first sample was captured
+    uint32_t probe_countdown = 0;
+#endif
+#ifdef CONFIG_RTP_TX_DTX
+    tx_dtx_t dtx = { 0 };
+    uint16_t audible = 0;       // OR of the packet's samples as built: 0 for digital silence
+#endif
 
     device_mode_t current_mode = lifecycle_get_device_mode();
-    ESP_LOGI(TAG, "Waiting for ringbuf, mode: %d", current_mode);
-    // Both USB and SPDIF sender modes use the same ring buffer approach
-    if (!pcm_out_buffer) {
-
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    const bool mix_enabled = current_mode == MODE_SENDER_SPDIF && lifecycle_get_sender_mix_usb();
+#endif
+    ESP_LOGI(TAG, "Waiting for capture ring, mode: %d", current_mode);
+    // Both USB and SPDIF sender modes feed the same kind of lock-free capture ring. The input
+    // creates it as it starts; sleep between checks rather than spinning, and give up if the
+    // sender is stopped first
+    pcm_ring_t *capture = NULL;
+    while (s_is_sender_running) {
         if (current_mode == MODE_SENDER_SPDIF) {
-            while (spdif_in_get_ringbuf() == NULL) vTaskDelay(0);
-            pcm_out_buffer = spdif_in_get_ringbuf();
-        } else  if (current_mode == MODE_SENDER_USB){
-            while (usb_in_get_ringbuf() == NULL) vTaskDelay(0);
-            pcm_out_buffer = usb_in_get_ringbuf();
+            capture = spdif_in_get_capture_ring();
+        } else if (current_mode == MODE_SENDER_USB) {
+            capture = usb_in_get_capture_ring();
         }
+        if (capture) {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENDER_CAPTURE_POLL_MS) + 1);
+    }
+    if (!capture) {
+        ESP_LOGW(TAG, "Sender stopped before the capture ring appeared");
+        s_capture_ring = NULL;
+        vTaskDelete(NULL);
+        return;
     }
 
-    ESP_LOGI(TAG, "Got ringbuf, mode: %d", current_mode);
+    ESP_LOGI(TAG, "Got capture ring, mode: %d", current_mode);
+    s_capture_ring = capture;
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    if (mix_enabled) {
+        ESP_LOGI(TAG, "Mixing USB into the S/PDIF stream");
+        atomic_store_explicit(&s_mix_active, true, memory_order_relaxed);
+    }
+#endif
+
+    // Paced from the input: packets go out one packet time apart, disciplined by the ring fill
+    tx_pace_t pace;
+    tx_pace_init(&pace, capture);
+    // Block on the ring for up to two packet times, so stop requests are still seen promptly
+    TickType_t read_wait = pdMS_TO_TICKS(2u * s_ptime_ms);
+    if (read_wait == 0) {
+        read_wait = 1;
+    }
+    ESP_LOGI(TAG, "Pacing: %" PRIu32 " us per packet, capture ring %" PRIu32 " bytes, trim <= %d ppm",
+             pace.period_us, pace.ring_bytes, CONFIG_RTP_TX_PACE_MAX_PPM);
+#ifdef CONFIG_RTCP_SEND_SR
+    int64_t last_sent_us = 0;
+#endif
     
     while (s_is_sender_running) {
         if (s_is_muted) {
-            vTaskDelay(pdMS_TO_TICKS(100));
+            // rtp_sender_set_mute() wakes us; the timeout also catches a stop request
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
             bytes_in_buffer = 0; // Reset buffer when muted
+            pcm_ring_reset(capture);  // and start from live audio when unmuted
+#ifdef CONFIG_RTP_TX_DTX
+            tx_dtx_reset(&dtx);
+#endif
+#ifdef CONFIG_SENDER_MIX_ENABLED
+            if (mix_enabled) {
+                tx_mix_reset(&mix);
+            }
+#endif
+            pace.next_due_us = 0;
             continue;
         }
 
         // We need to fill the buffer completely before sending
-        if (bytes_in_buffer < CHUNK_SIZE) {
-            size_t bytes_to_read = CHUNK_SIZE - bytes_in_buffer;
+        if (bytes_in_buffer < chunk_bytes) {
+            if (bytes_in_buffer == 0) {
+                // One volume per packet, sampled as it starts filling
+                gain_q15 = pcm_gain_to_q15(lifecycle_get_volume());
+#ifdef CONFIG_RTP_TX_DTX
+                audible = 0;
+#endif
+#ifdef CONFIG_SENDER_MIX_ENABLED
+                if (mix_enabled) {
+                    // Packets are clocked from one input at a time, chosen between packets
+                    uint8_t clock = tx_mix_pick_clock(&mix);
+                    pcm_ring_t *ring = mix.src[clock].ring;
+                    if (ring && ring != capture) {
+                        ESP_LOGI(TAG, "Mix clocked by the %s input",
+                                 clock == RTP_SENDER_MIX_USB ? "USB" : "S/PDIF");
+                        capture = ring;
+                        s_capture_ring = ring;
+                        pace.ring_bytes = (uint32_t)pcm_ring_size(ring);
+                        pace.next_due_us = 0;
+                    }
+                }
+#endif
+#ifdef CONFIG_RTP_TX_ADAPT
+                // Packetization follows the receivers' reports, between packets only
+                uint8_t ptime_ms = tx_adapt_ptime_ms();
+                if (ptime_ms != packet_ptime_ms) {
+                    packet_ptime_ms = ptime_ms;
+                    chunk_bytes = pcm_chunk_bytes_for_ptime(ptime_ms, RTP_SAMPLE_RATE, RTP_BYTES_PER_FRAME);
+                    s_chunk_bytes = chunk_bytes;
+                    pace.period_us = (uint32_t)((uint64_t)(chunk_bytes / RTP_BYTES_PER_FRAME) * 1000000u /
+                                                RTP_SAMPLE_RATE);
+                    read_wait = pdMS_TO_TICKS(2u * ptime_ms);
+                    if (read_wait == 0) {
+                        read_wait = 1;
+                    }
+                }
+#ifdef CONFIG_RTP_FEC_ENABLED
+                uint8_t group = TX_SRTP_ACTIVE() ? 0 : tx_adapt_fec_group();
+                if (group != fec_group || (group == 0 && rtp_fec_encoder_count(&fec) > 0)) {
+                    // Close the group at the old size (or for good, with no parity at this level)
+                    if (rtp_fec_encoder_count(&fec) > 0) {
+                        send_fec_packet(&fec, fec_packet, sizeof(fec_packet));
+                    }
+                    fec_group = group;
+                }
+#endif
+#endif
+            }
+            size_t bytes_to_read = chunk_bytes - bytes_in_buffer;
             int bytes_read = 0;
 
-            size_t item_size;
-            // Try to receive up to bytes_to_read from the ring buffer
-            uint8_t *item = (uint8_t *)xRingbufferReceiveUpTo(
-                pcm_out_buffer,  // Ring buffer populated by either usb_in or spdif_in
-                &item_size,
-                pdMS_TO_TICKS(1),
-                bytes_to_read
-            );
-            if (item != NULL) {
-                memcpy((uint8_t*)audio_buffer + bytes_in_buffer, item, item_size);
-                bytes_read = item_size;
-                vRingbufferReturnItem(pcm_out_buffer, (void *)item);
+            // Sleep until the capture side has the rest of the packet (one wakeup per packet,
+            // not per USB transfer); after read_wait take whatever is there
+            pcm_ring_wait(capture, bytes_to_read, read_wait);
+            const uint8_t *span = NULL;
+            size_t span_size = pcm_ring_peek(capture, &span, bytes_to_read);
+#ifdef CONFIG_RTP_LATENCY_PROBE
+            if (span_size > 0 && bytes_in_buffer == 0) {
+                // The oldest byte in the ring was captured one ring fill ago
+                capture_us = esp_timer_get_time() -
+                             (int64_t)((uint64_t)(pcm_ring_fill(capture) / RTP_BYTES_PER_FRAME) *
+                                       1000000u / RTP_SAMPLE_RATE);
+            }
+#endif
+            if (span_size > 0) {
+#ifdef CONFIG_SENDER_MIX_ENABLED
+                if (mix_enabled) {
+                    // Summed with the other input once the packet is complete
+                    memcpy((uint8_t *)mix_primary + bytes_in_buffer, span, span_size);
+                } else
+#endif
+                {
+                    // Feed PCM data to visualizer (source level, before volume and byte swap)
+                    pcm_viz_write(span, span_size);
+                    // Volume and network byte order (big endian, REQUIRED for L16 per RFC 3551)
+                    // applied in a single pass from the ring into the packet
+                    uint32_t prof_start = metrics_profile_begin();
+#ifdef CONFIG_RTP_TX_DTX
+                    // The silence test rides along with the conversion
+                    audible |= pcm_gain_q15_swap16_any((int16_t *)(payload + bytes_in_buffer),
+                                                       (const int16_t *)span,
+                                                       span_size / sizeof(int16_t), gain_q15);
+#else
+                    pcm_gain_q15_swap16((int16_t *)(payload + bytes_in_buffer), (const int16_t *)span,
+                                        span_size / sizeof(int16_t), gain_q15);
+#endif
+                    metrics_profile_end(&prof_build, prof_start);
+                }
+                bytes_read = span_size;
+                pcm_ring_consume(capture, span_size);
             } else {
                 bytes_read = 0;
             }
@@ -630,34 +1881,106 @@ static void rtp_sender_task(void *arg)
             if (bytes_read > 0) {
                 bytes_in_buffer += bytes_read;
             } else {
-                // No data, wait a bit to avoid busy-looping
-                vTaskDelay(pdMS_TO_TICKS(1));
+                // Input stalled: re-anchor the pacing when it comes back
+                pace.next_due_us = 0;
+#ifdef CONFIG_SENDER_MIX_ENABLED
+                if (mix_enabled) {
+                    // Start the packet over so the clock can move to the other input
+                    bytes_in_buffer = 0;
+                }
+#endif
                 continue;
             }
         }
 
         // If we have a full chunk, send it
-        if (bytes_in_buffer == CHUNK_SIZE) {
-            // Apply volume
-            float volume = lifecycle_get_volume();
-            if (volume < 1.0f) {
-                int16_t *samples = (int16_t*)audio_buffer;
-                int num_samples = CHUNK_SIZE / 2;
-                for (int i = 0; i < num_samples; i++) {
-                    samples[i] = (int16_t)(samples[i] * volume);
-                }
+        if (bytes_in_buffer == chunk_bytes) {
+#ifdef CONFIG_SENDER_MIX_ENABLED
+            if (mix_enabled) {
+                uint32_t prof_start = metrics_profile_begin();
+                tx_mix_build(&mix, payload, mix_primary, mix_aux, chunk_bytes, gain_q15);
+#ifdef CONFIG_RTP_TX_DTX
+                audible = pcm_peak_s16((const int16_t *)payload, chunk_bytes / sizeof(int16_t));
+#endif
+                metrics_profile_end(&prof_build, prof_start);
             }
+#endif
+            // Hold the packet until its slot on the packet clock
+            tx_pace_wait(&pace, capture);
 
-            // Feed PCM data to visualizer (after volume adjustment, before RTP packet construction)
-            pcm_viz_write((const uint8_t*)audio_buffer, CHUNK_SIZE);
-
-            // Build RTP packet
-            build_rtp_packet(rtp_packet, (uint8_t*)audio_buffer, CHUNK_SIZE);
+#ifdef CONFIG_RTCP_SEND_SR
+            // The RTP clock keeps running through an input gap (RFC 3550 5.1), so the
+            // timeline the SRs describe still matches the packets after it
+            int64_t sent_us = esp_timer_get_time();
+            if (last_sent_us != 0 && sent_us - last_sent_us > 2 * (int64_t)pace.period_us) {
+                s_rtp_timestamp += (uint32_t)((uint64_t)(sent_us - last_sent_us - pace.period_us) *
+                                              RTP_SAMPLE_RATE / 1000000ULL);
+            }
+            last_sent_us = sent_us;
+            uint32_t packet_ts = s_rtp_timestamp;
+#endif
+#ifdef CONFIG_RTP_TX_DTX
+            if (tx_dtx_hold(&dtx, audible == 0, pace.period_us, esp_timer_get_time())) {
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+                // Opus destinations keep their stream
+                if (atomic_load_explicit(&s_opus_wanted, memory_order_relaxed)) {
+                    opus_out_push(payload, chunk_bytes, s_rtp_timestamp);
+                }
+#endif
+                // The packet's time passes on the RTP clock without a sequence number
+                s_rtp_timestamp += chunk_bytes / RTP_BYTES_PER_FRAME;
+                bytes_in_buffer = 0;
+                continue;
+            }
+#endif
+            build_rtp_header(rtp_packet);
+#ifdef CONFIG_RTP_TX_DTX
+            if (dtx.mark) {
+                // First packet after a gap in the stream (RFC 3551 4.1)
+                rtp_packet[1] |= 0x80;
+                dtx.mark = false;
+            }
+#endif
 
-            int sent = -1;
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+            // The encoder on the other core takes its copy before ours goes to the stack
+            if (atomic_load_explicit(&s_opus_wanted, memory_order_relaxed)) {
+                opus_out_push(payload, chunk_bytes, ntohl(((const rtp_header_t *)rtp_packet)->timestamp));
+            }
+#endif
+            size_t packet_len = HEADER_SIZE + chunk_bytes;
+#ifdef CONFIG_RTP_LATENCY_PROBE
+            if (probe_countdown-- == 0) {
+                // Make room for the extension between the header and the payload
+                probe_countdown = CONFIG_RTP_LATENCY_PROBE_INTERVAL - 1;
+                memmove(payload + RTP_PROBE_EXT_SIZE, payload, chunk_bytes);
+                rtp_probe_write(payload, CONFIG_RTP_LATENCY_PROBE_EXT_ID,
+                                clock_service_mono_to_master(capture_us));
+                rtp_packet[0] |= 0x10;  // X bit
+                packet_len += RTP_PROBE_EXT_SIZE;
+            }
+#endif
+#ifdef CONFIG_RTP_SRTP_ENABLED
+            if (TX_SRTP_ACTIVE()) {
+                // Header (and any probe extension) stays in the clear and authenticated
+                uint32_t srtp_start = metrics_profile_begin();
+                int protected_len = rtp_srtp_protect(&s_tx_srtp, rtp_packet, packet_len - chunk_bytes,
+                                                     packet_len, sizeof(rtp_packet));
+                metrics_profile_end(&prof_srtp, srtp_start);
+                if (protected_len < 0) {
+                    bytes_in_buffer = 0;
+                    continue;
+                }
+                packet_len = (size_t)protected_len;
+            }
+#endif
+            // A destination on Opus gets its packets from the encoder instead
+            bool primary_l16 = !atomic_load_explicit(&s_primary_opus, memory_order_relaxed);
+            uint32_t prof_start = metrics_profile_begin();
+            int sent = primary_l16 ? -1 : 0;
             int retry_count = 0;
             while (sent < 0 && retry_count < MAX_SEND_RETRIES) {
-                sent = sendto(s_sock, rtp_packet, PACKET_SIZE, 0,
+                sent = sendto(s_sock, rtp_packet, packet_len, 0,
                              (struct sockaddr *)&s_dest_addr, sizeof(s_dest_addr));
                 vTaskDelay(0);
                if (sent > 0) {
@@ -667,16 +1990,47 @@ static void rtp_sender_task(void *arg)
                    retry_count++;
                }
             }
+            if (primary_l16 && sent > 0) {
+                s_primary_sent++;
+                // The socket is unbound, so the source port is left for the stack to pick
+                rtp_capture_packet(RTP_CAPTURE_TX, rtp_packet, packet_len, NULL, 0, 0, 0,
+                                   s_dest_addr.sin_addr.s_addr, ntohs(s_dest_addr.sin_port));
+            } else if (primary_l16) {
+                s_primary_errors++;
+            }
+#ifdef CONFIG_RTCP_SEND_SR
+            rtcp_sender_note_packet(packet_ts, chunk_bytes);
+#endif
+            // Same packet, built once, to each unicast fan-out destination
+            fanout_send(rtp_packet, packet_len, false);
+#ifdef CONFIG_RTP_RELAY_ENABLED
+            rtp_relay_forward(false, rtp_packet, packet_len, NULL, 0, 0, sender_destination_port());
+#endif
+            metrics_profile_end(&prof_send, prof_start);
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+            rtx_store(rtp_packet, packet_len);
+#endif
+
+#ifdef CONFIG_RTP_FEC_ENABLED
+            // Protect every packet, sent or not: a failed send is just another loss to repair
+            if (fec_group > 0) {
+                rtp_fec_encoder_add(&fec, rtp_packet, packet_len);
+                if (rtp_fec_encoder_count(&fec) >= fec_group) {
+                    send_fec_packet(&fec, fec_packet, sizeof(fec_packet));
+                }
+            }
+#endif
 
             // Reset buffer for next chunk
             bytes_in_buffer = 0;
-            // Pace the sender to match the audio data rate. This prevents sending bursts of packets
-            // that can overwhelm the network stack and cause ENOMEM (errno 12) errors.
-            vTaskDelayUntil(&xLastWakeTime, xFrequency);
         }
-        vTaskDelay(0);
     }
-    
+
+    tx_pace_deinit(&pace);
+    s_capture_ring = NULL;
+#ifdef CONFIG_SENDER_MIX_ENABLED
+    atomic_store_explicit(&s_mix_active, false, memory_order_relaxed);
+#endif
     ESP_LOGI(TAG, "RTP sender task exiting, deleting task");
     vTaskDelete(NULL);
 }
@@ -1,8 +1,47 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "pcm_ring.h"
+
+// One destination the sender transmits to, as reported by rtp_sender_get_destinations()
+typedef struct {
+    uint32_t addr;      // IPv4, network byte order
+    uint16_t port;
+    bool primary;       // The configured destination (unicast or multicast)
+    bool from_mdns;     // Fan-out destination found by mDNS discovery
+    bool opus;          // Sent the Opus stream instead of L16
+    bool active;        // false while dropped after repeated send failures
+    uint32_t sent;      // Packets sent since the sender started
+    uint32_t errors;    // Failed sends
+} rtp_sender_dest_stats_t;
+
+// Answering receivers' NACKs (CONFIG_RTP_TX_RTX_ENABLED), since the sender started
+typedef struct {
+    uint32_t requested;  // Packets asked for
+    uint32_t sent;       // Resent
+    uint32_t missed;     // No longer in the cache
+    uint32_t limited;    // Dropped by the rate limit, or already resent just now
+} rtp_sender_rtx_stats_t;
+
+// Inputs of the mixing sender (CONFIG_SENDER_MIX_ENABLED, sender_mix_usb)
+enum {
+    RTP_SENDER_MIX_SPDIF = 0,
+    RTP_SENDER_MIX_USB,
+    RTP_SENDER_MIX_SOURCES,
+};
+
+typedef struct {
+    uint8_t clock;              // Input pacing the stream
+    struct {
+        uint16_t peak;          // Decaying peak level, 0-32767, before the input's gain
+        uint32_t fill;          // Bytes waiting in the input's capture ring
+        uint32_t slips;         // Frames dropped or repeated to follow the other clock
+        uint32_t underruns;     // Times the input ran dry and went silent until refilled
+    } source[RTP_SENDER_MIX_SOURCES];
+} rtp_sender_mix_stats_t;
 
 /**
  * Initialize the RTP sender functionality
@@ -22,7 +61,8 @@ esp_err_t rtp_sender_start(void);
 
 /**
  * Stop the RTP sender
- * This halts capture and network sending
+ * This halts capture and network sending; the sockets stay open for the
+ * next rtp_sender_start()
  *
  * @return ESP_OK on success, or an error code on failure
  */
@@ -56,11 +96,85 @@ void rtp_sender_set_volume(uint32_t volume);
  * @return ESP_OK on success, or an error code on failure
  */
 
+esp_err_t rtp_sender_update_destination(void);
+
+// sender_destination_ip value that hands the destination to auto-selection
+#define RTP_SENDER_DEST_AUTO "auto"
+
+/**
+ * Whether sender_destination_ip is RTP_SENDER_DEST_AUTO
+ */
+bool rtp_sender_dest_is_auto(void);
+
+/**
+ * Send to a receiver picked by auto-selection (only used while the
+ * destination setting is "auto"); addr 0 returns to the Scream multicast group
+ *
+ * @param addr IPv4, network byte order
+ * @param port RTP port; 0 for the configured destination port
+ * @return As rtp_sender_update_destination()
+ */
+esp_err_t rtp_sender_set_auto_destination(uint32_t addr, uint16_t port);
+
 /**
  * Auto-select the best available Scream device
- * This function scans discovered mDNS devices and selects the most suitable receiver
+ * Scores the discovered mDNS receivers (see auto_select.h) and switches to
+ * the best one now, without the hysteresis of the periodic re-evaluation
  *
  * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no suitable device, or other error codes
  */
 esp_err_t rtp_sender_auto_select_device(void);
-esp_err_t rtp_sender_update_destination(void);
+
+/**
+ * Rebuild the unicast fan-out list (sender_fanout_ips / sender_fanout_mdns)
+ * on the next rtp_sender_fanout_tick(). Safe from any task.
+ */
+void rtp_sender_reload_fanout(void);
+
+/**
+ * Background work for fan-out: applies a pending reload, and every
+ * CONFIG_RTP_TX_FANOUT_REFRESH_MS follows mDNS discovery and retries dropped
+ * destinations. Called from the lifecycle task, never the sender task, since
+ * the mDNS snapshot may block.
+ */
+void rtp_sender_fanout_tick(void);
+
+/**
+ * Snapshot per-destination send counters
+ *
+ * @param out Entries to fill; the first is the primary destination
+ * @param max Capacity of out
+ * @return Number of entries written
+ */
+size_t rtp_sender_get_destinations(rtp_sender_dest_stats_t *out, size_t max);
+
+/**
+ * Snapshot the capture ring the sender reads (fill, drops, wakeups)
+ *
+ * @param out Filled in; zeroed while the sender has no ring
+ * @return true if the sender is reading a capture ring
+ */
+bool rtp_sender_get_capture_stats(pcm_ring_stats_t *out);
+
+/**
+ * Snapshot the mixing sender's per-input levels and drift correction
+ *
+ * @param out Filled in while mixing
+ * @return true if the sender is mixing USB into the S/PDIF stream
+ */
+bool rtp_sender_get_mix_stats(rtp_sender_mix_stats_t *out);
+
+/**
+ * Resend a recently sent packet a receiver NACKed (RTCP task)
+ * Goes to the L16 destination at addr, or to the group when the primary
+ * destination is multicast. Only built with CONFIG_RTP_TX_RTX_ENABLED.
+ *
+ * @param seq RTP sequence number of the lost packet
+ * @param addr IPv4 the NACK came from, network byte order
+ */
+void rtp_sender_retransmit(uint16_t seq, uint32_t addr);
+
+/**
+ * Snapshot the retransmission counters (zero without CONFIG_RTP_TX_RTX_ENABLED)
+ */
+void rtp_sender_get_rtx_stats(rtp_sender_rtx_stats_t *out);
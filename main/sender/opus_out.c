@@ -0,0 +1,272 @@
+#include "opus_out.h"
+#include "global.h"
+#include "build_config.h"
+#include "dsp/pcm_kernels.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include <string.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "opus.h"
+#include "lifecycle/pipeline_topology.h"
+#ifdef CONFIG_RTP_TX_ADAPT
+#include "tx_adapt.h"
+#include "lifecycle/cpu_governor.h"
+#endif
+
+/*
+ * sender task -> encoder is a no-split FreeRTOS ring of {rtp_ts, len, payload}
+ * items, written in place with xRingbufferSendAcquire() so the sender task only
+ * copies the payload once and never waits. The encoder task owns the encoder,
+ * the frame accumulator and the Opus sequence numbers.
+ *
+ * The encoder runs CELT only (OPUS_APPLICATION_RESTRICTED_LOWDELAY): music
+ * at these bitrates needs nothing else, it keeps under 3 ms of algorithmic
+ * delay, and its cost per frame stays predictable.
+ */
+
+#define OPUS_OUT_SAMPLE_RATE 48000
+#define OPUS_OUT_CHANNELS    2
+#define OPUS_OUT_FRAMES      (OPUS_OUT_SAMPLE_RATE / 1000 * CONFIG_RTP_TX_OPUS_FRAME_MS)
+#define OPUS_OUT_RTP_HEADER  12
+
+// A few sender packets of slack while a frame is being encoded
+#ifndef OPUS_OUT_RING_BYTES
+#define OPUS_OUT_RING_BYTES (4 * (PCM_CHUNK_MAX_SIZE + 16))
+#endif
+// Largest Opus packet for one frame (RFC 6716 section 3.2.1)
+#define OPUS_OUT_MAX_PACKET  1275
+// Adaptation never takes the bitrate below this
+#ifndef OPUS_OUT_MIN_BITRATE
+#define OPUS_OUT_MIN_BITRATE 32000
+#endif
+// The CELT encoder keeps its analysis buffers on the stack
+#ifndef OPUS_OUT_TASK_STACK
+#define OPUS_OUT_TASK_STACK 20480
+#endif
+
+typedef struct {
+    uint32_t rtp_ts;
+    uint32_t len;
+} opus_out_item_t;
+
+static RingbufHandle_t ring = NULL;
+static TaskHandle_t encoder_task = NULL;
+static OpusEncoder *encoder = NULL;
+static opus_out_send_fn_t send_fn = NULL;
+static atomic_bool running = false;
+static atomic_uint complexity_req = CONFIG_RTP_TX_OPUS_COMPLEXITY;
+
+// Encoder-owned state
+static int16_t pcm[OPUS_OUT_FRAMES * OPUS_OUT_CHANNELS];
+static uint8_t packet[OPUS_OUT_RTP_HEADER + OPUS_OUT_MAX_PACKET];
+static size_t pcm_frames = 0;           // Frames accumulated for the next encode
+static uint32_t pcm_ts = 0;             // RTP timestamp of pcm[0]
+static uint32_t stream_ssrc = 0;
+static uint16_t seq = 0;
+static uint32_t cur_bitrate = 0;
+static uint8_t cur_complexity = 0;
+
+static atomic_uint_fast32_t stat_encoded = 0;
+static atomic_uint_fast32_t stat_overflow = 0;
+static atomic_uint_fast32_t stat_errors = 0;
+
+static uint32_t opus_out_target_bitrate(void) {
+    uint32_t bitrate = (uint32_t)CONFIG_RTP_TX_OPUS_BITRATE_KBPS * 1000u;
+#ifdef CONFIG_RTP_TX_ADAPT
+    // Past ptime and parity, a smaller bitrate is what Opus can give a lossy link
+    for (uint8_t level = tx_adapt_level(); level > 0; level--) {
+        bitrate = bitrate * 3u / 4u;
+    }
+#endif
+    return bitrate < OPUS_OUT_MIN_BITRATE ? OPUS_OUT_MIN_BITRATE : bitrate;
+}
+
+static void opus_out_apply_settings(void) {
+    uint8_t complexity = (uint8_t)atomic_load_explicit(&complexity_req, memory_order_relaxed);
+    if (complexity != cur_complexity) {
+        opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(complexity));
+        cur_complexity = complexity;
+        ESP_LOGI(TAG, "Opus TX: complexity %u", complexity);
+    }
+    uint32_t bitrate = opus_out_target_bitrate();
+    if (bitrate != cur_bitrate) {
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE((opus_int32)bitrate));
+        cur_bitrate = bitrate;
+        ESP_LOGI(TAG, "Opus TX: %u kbit/s", (unsigned)(bitrate / 1000u));
+    }
+}
+
+static void opus_out_encode_frame(void) {
+    opus_out_apply_settings();
+
+    uint32_t work_start = cpu_governor_begin();
+    int n = opus_encode(encoder, pcm, OPUS_OUT_FRAMES, packet + OPUS_OUT_RTP_HEADER, OPUS_OUT_MAX_PACKET);
+    cpu_governor_end(work_start);
+    if (n < 0) {
+        atomic_fetch_add_explicit(&stat_errors, 1, memory_order_relaxed);
+        ESP_LOGD(TAG, "Opus encode failed: %s", opus_strerror(n));
+        return;
+    }
+    packet[0] = 0x80;                                   // V=2, no padding, extension or CSRC
+    packet[1] = CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE & 0x7F;
+    uint16_t seq_be = htons(seq++);
+    uint32_t ts_be = htonl(pcm_ts);
+    uint32_t ssrc_be = htonl(stream_ssrc);
+    memcpy(packet + 2, &seq_be, sizeof(seq_be));
+    memcpy(packet + 4, &ts_be, sizeof(ts_be));
+    memcpy(packet + 8, &ssrc_be, sizeof(ssrc_be));
+    send_fn(packet, OPUS_OUT_RTP_HEADER + (size_t)n);
+    atomic_fetch_add_explicit(&stat_encoded, 1, memory_order_relaxed);
+}
+
+// Append one L16 payload to the frame accumulator, encoding each frame it completes
+static void opus_out_process(const opus_out_item_t *item, const uint8_t *payload) {
+    const size_t frame_bytes = OPUS_OUT_CHANNELS * sizeof(int16_t);
+    size_t frames = item->len / frame_bytes;
+    uint32_t ts = item->rtp_ts;
+
+    if (pcm_frames > 0 && ts != pcm_ts + (uint32_t)pcm_frames) {
+        // Input gap or timeline jump: the partial frame would straddle it
+        pcm_frames = 0;
+    }
+    while (frames > 0) {
+        if (pcm_frames == 0) {
+            pcm_ts = ts;
+        }
+        size_t take = OPUS_OUT_FRAMES - pcm_frames;
+        if (take > frames) {
+            take = frames;
+        }
+        // Back to host order for the encoder
+        pcm_swap16(pcm + pcm_frames * OPUS_OUT_CHANNELS, (const int16_t *)payload, take * OPUS_OUT_CHANNELS);
+        pcm_frames += take;
+        payload += take * frame_bytes;
+        frames -= take;
+        ts += (uint32_t)take;
+        if (pcm_frames == OPUS_OUT_FRAMES) {
+            opus_out_encode_frame();
+            pcm_frames = 0;
+        }
+    }
+}
+
+static void opus_encoder_task(void *pvParameters) {
+    (void)pvParameters;
+    ESP_LOGI(TAG, "Opus TX: %d ms frames, PT %d, complexity %u, core %d",
+             CONFIG_RTP_TX_OPUS_FRAME_MS, CONFIG_RTP_TX_OPUS_PAYLOAD_TYPE, cur_complexity, xPortGetCoreID());
+    while (atomic_load(&running)) {
+        size_t size = 0;
+        // Bounded wait so a stop request is noticed without a final push
+        uint8_t *item = (uint8_t *)xRingbufferReceive(ring, &size, pdMS_TO_TICKS(100));
+        if (!item) {
+            continue;
+        }
+        const opus_out_item_t *hdr = (const opus_out_item_t *)item;
+        if (size >= sizeof(*hdr) && hdr->len <= size - sizeof(*hdr)) {
+            opus_out_process(hdr, item + sizeof(*hdr));
+        }
+        vRingbufferReturnItem(ring, item);
+    }
+    encoder_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t opus_out_start(uint32_t ssrc, opus_out_send_fn_t send) {
+    if (encoder_task) {
+        return ESP_OK;
+    }
+    _Static_assert(CONFIG_RTP_TX_OPUS_FRAME_MS == 5 || CONFIG_RTP_TX_OPUS_FRAME_MS == 10 ||
+                   CONFIG_RTP_TX_OPUS_FRAME_MS == 20, "Opus frames are 5, 10 or 20 ms");
+
+    int err = OPUS_OK;
+    encoder = opus_encoder_create(OPUS_OUT_SAMPLE_RATE, OPUS_OUT_CHANNELS,
+                                  OPUS_APPLICATION_RESTRICTED_LOWDELAY, &err);
+    ring = xRingbufferCreate(OPUS_OUT_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    if (err != OPUS_OK || !encoder || !ring) {
+        ESP_LOGE(TAG, "Failed to create Opus encoder: %s", err != OPUS_OK ? opus_strerror(err) : "no memory");
+        opus_out_stop();
+        return ESP_ERR_NO_MEM;
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC));
+    opus_encoder_ctl(encoder, OPUS_SET_VBR(1));
+    cur_complexity = (uint8_t)atomic_load(&complexity_req);
+    cur_bitrate = opus_out_target_bitrate();
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(cur_complexity));
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE((opus_int32)cur_bitrate));
+
+    send_fn = send;
+    stream_ssrc = ssrc;
+    seq = (uint16_t)esp_random();
+    pcm_frames = 0;
+    atomic_store(&stat_encoded, 0);
+    atomic_store(&stat_overflow, 0);
+    atomic_store(&stat_errors, 0);
+    atomic_store(&running, true);
+
+    if (pipeline_task_create(PIPELINE_STAGE_ENCODE, opus_encoder_task, "opus_enc", OPUS_OUT_TASK_STACK, NULL,
+                             &encoder_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create Opus encoder task");
+        atomic_store(&running, false);
+        encoder_task = NULL;
+        opus_out_stop();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void opus_out_stop(void) {
+    atomic_store(&running, false);
+    // The task exits within one receive timeout
+    for (int i = 0; encoder_task && i < 50; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (encoder_task) {
+        ESP_LOGW(TAG, "Opus encoder task did not stop, leaving it allocated");
+        return;
+    }
+    if (ring) {
+        vRingbufferDelete(ring);
+        ring = NULL;
+    }
+    if (encoder) {
+        opus_encoder_destroy(encoder);
+        encoder = NULL;
+    }
+    send_fn = NULL;
+}
+
+bool opus_out_push(const uint8_t *payload, size_t len, uint32_t rtp_ts) {
+    if (!atomic_load_explicit(&running, memory_order_relaxed) || !ring || len == 0) {
+        return false;
+    }
+    void *slot = NULL;
+    if (xRingbufferSendAcquire(ring, &slot, sizeof(opus_out_item_t) + len, 0) != pdTRUE || !slot) {
+        atomic_fetch_add_explicit(&stat_overflow, 1, memory_order_relaxed);
+        return false;
+    }
+    opus_out_item_t *hdr = (opus_out_item_t *)slot;
+    hdr->rtp_ts = rtp_ts;
+    hdr->len = (uint32_t)len;
+    memcpy((uint8_t *)slot + sizeof(*hdr), payload, len);
+    xRingbufferSendComplete(ring, slot);
+    return true;
+}
+
+void opus_out_set_complexity(uint8_t complexity) {
+    atomic_store(&complexity_req, complexity > 10 ? 10u : complexity);
+}
+
+void opus_out_get_stats(opus_out_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->encoded = (uint32_t)atomic_load_explicit(&stat_encoded, memory_order_relaxed);
+    stats->overflow = (uint32_t)atomic_load_explicit(&stat_overflow, memory_order_relaxed);
+    stats->errors = (uint32_t)atomic_load_explicit(&stat_errors, memory_order_relaxed);
+    stats->bitrate = cur_bitrate;
+    stats->complexity = cur_complexity;
+}
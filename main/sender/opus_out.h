@@ -0,0 +1,66 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Opus encoding for the on-device sender (CONFIG_RTP_TX_OPUS_ENABLED).
+ *
+ * rtp_sender_task keeps building and pacing its L16 packets; for destinations
+ * that take Opus it also hands each payload to opus_out_push(). An encoder
+ * task on the core not used by USB capture and the sender task collects
+ * CONFIG_RTP_TX_OPUS_FRAME_MS of audio, encodes it (RFC 7587, 48 kHz stereo)
+ * and passes the RTP packet to the send callback. Opus packets carry the same
+ * SSRC and RTP clock as the L16 stream, with their own sequence numbers, so
+ * the sender's RTCP reports describe both. A gap in the RTP timestamps drops
+ * the partial frame and starts a new one.
+ *
+ * Complexity can change while running; with CONFIG_RTP_TX_ADAPT the bitrate
+ * steps down a quarter per adaptation level above 0.
+ */
+
+// Opus encode counters (since the encoder started)
+typedef struct {
+    uint32_t encoded;     // Packets produced
+    uint32_t overflow;    // Input packets dropped because the encode queue was full
+    uint32_t errors;      // Frames the encoder rejected
+    uint32_t bitrate;     // Current target, bits/s
+    uint8_t complexity;   // Current complexity, 0-10
+} opus_out_stats_t;
+
+/**
+ * @brief Callback sending one finished Opus RTP packet (encoder task)
+ */
+typedef void (*opus_out_send_fn_t)(const uint8_t *packet, size_t len);
+
+/**
+ * @brief Create the encoder and its task
+ * @param ssrc SSRC of the sender's stream
+ * @param send Called with each Opus RTP packet
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the encoder could not be created
+ */
+esp_err_t opus_out_start(uint32_t ssrc, opus_out_send_fn_t send);
+
+/**
+ * @brief Stop the encoder task and free the encoder
+ * Safe to call when not started.
+ */
+void opus_out_stop(void);
+
+/**
+ * @brief Queue one L16 payload for encoding (sender task, never blocks)
+ * @param payload Network byte order 16-bit stereo PCM
+ * @param len Payload length in bytes
+ * @param rtp_ts RTP timestamp of the payload's first frame
+ * @return true if the payload was queued
+ */
+bool opus_out_push(const uint8_t *payload, size_t len, uint32_t rtp_ts);
+
+/**
+ * @brief Set the encoder complexity (0-10), applied before the next frame
+ */
+void opus_out_set_complexity(uint8_t complexity);
+
+void opus_out_get_stats(opus_out_stats_t *stats);
@@ -0,0 +1,538 @@
+#include "rtcp_sender.h"
+#include "network_out.h"
+#include "receiver/rtcp_receiver.h"   // RTCP packet layouts and constants
+#include "global.h"
+#include "build_config.h"
+#include "clock/clock_service.h"
+#include "lifecycle/net_iface.h"
+#ifdef CONFIG_RTP_TX_ADAPT
+#include "tx_adapt.h"
+#endif
+#ifdef CONFIG_RTP_RELAY_ENABLED
+#include "rtp/rtp_relay.h"
+#endif
+#include "rtp/rtp_capture.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_netif.h"
+#include "esp_log.h"
+#include "log_rate.h"
+#include "wifi_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+// SR with no report blocks, SDES with a CNAME of up to 31 bytes, XR DLRR for every
+// receiver, BYE
+#define RTCP_SR_BUFFER_SIZE       (sizeof(rtcp_sr_packet_t) + 44 + 8 + 12 * RTCP_SENDER_MAX_RECEIVERS + 8)
+#define RTCP_SR_RX_BUFFER_SIZE    512
+// Receivers report at least every CONFIG_RTCP_RR_MIN_INTERVAL_MS * 1.5; five missed
+// reports and they are gone (RFC 3550 6.3.5)
+#define RTCP_SENDER_RECEIVER_TIMEOUT_MS (CONFIG_RTCP_RR_MIN_INTERVAL_MS * 15 / 2)
+// No SR while the last packet is older than this: the RTP clock is not running
+#define RTCP_SR_STREAM_IDLE_US    200000
+
+typedef struct {
+    rtcp_sender_receiver_t info;
+    int64_t last_report_us;
+    uint32_t rrtr_lrr;              // Middle 32 bits of its last XR RRTR, 0 = none pending
+    int64_t rrtr_rx_us;             // When that RRTR arrived
+} rtcp_sender_peer_t;
+
+// Last packet sent, written by the sender task and read by the RTCP task
+typedef struct {
+    atomic_uint seq;                // Odd while a write is in progress
+    uint32_t rtp_ts;
+    int64_t sent_us;
+    uint32_t packets;
+    uint32_t octets;
+} rtcp_sender_tx_t;
+
+static rtcp_sender_tx_t s_tx;
+static rtcp_sender_peer_t s_peers[RTCP_SENDER_MAX_RECEIVERS];
+static SemaphoreHandle_t s_peers_mutex = NULL;
+static TaskHandle_t s_task = NULL;
+static int s_sock = -1;
+static uint16_t s_local_port = 0;   // Where s_sock is bound: reports to relayed SRs come back here
+static uint32_t s_ssrc = 0;
+static uint32_t s_clock_rate = 0;
+static atomic_bool s_running = false;
+
+// Sender clock as 64-bit NTP (seconds since 1900 << 32 | fraction): master time from the clock
+// service, so receivers locked to the same server see our SRs on their timeline
+static inline uint64_t rtcp_sender_ntp_at(int64_t mono_us) {
+    return clock_service_ntp64_at(mono_us);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void put_header(uint8_t *p, uint8_t count, uint8_t pt, size_t size) {
+    rtcp_header_t *hdr = (rtcp_header_t *)p;
+    hdr->vprc = (uint8_t)((RTCP_VERSION_NUM << 6) | count);
+    hdr->pt = pt;
+    hdr->length = htons((uint16_t)(size / 4U - 1U));
+}
+
+void rtcp_sender_note_packet(uint32_t rtp_ts, uint32_t payload_bytes) {
+    unsigned seq = atomic_load_explicit(&s_tx.seq, memory_order_relaxed);
+    atomic_store_explicit(&s_tx.seq, seq + 1U, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s_tx.rtp_ts = rtp_ts;
+    s_tx.sent_us = esp_timer_get_time();
+    s_tx.packets++;
+    s_tx.octets += payload_bytes;
+    atomic_store_explicit(&s_tx.seq, seq + 2U, memory_order_release);
+}
+
+static void rtcp_sender_read_tx(rtcp_sender_tx_t *out) {
+    for (int attempt = 0; attempt < 8; attempt++) {
+        unsigned seq = atomic_load_explicit(&s_tx.seq, memory_order_acquire);
+        if (seq & 1U) {
+            taskYIELD();
+            continue;
+        }
+        out->rtp_ts = s_tx.rtp_ts;
+        out->sent_us = s_tx.sent_us;
+        out->packets = s_tx.packets;
+        out->octets = s_tx.octets;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s_tx.seq, memory_order_relaxed) == seq) {
+            return;
+        }
+    }
+}
+
+// "esp32-rtp@<ip>", as the receivers name themselves
+static void rtcp_sender_cname(char *buf, size_t size) {
+    esp_netif_ip_info_t ip_info = { 0 };
+    esp_netif_t *netif = net_iface_primary();
+    if (netif) {
+        esp_netif_get_ip_info(netif, &ip_info);
+    }
+    snprintf(buf, size, "esp32-rtp@" IPSTR, IP2STR(&ip_info.ip));
+}
+
+// SR (no report blocks: we receive nothing) + SDES(CNAME) [+ XR DLRR] [+ BYE]
+static size_t rtcp_sender_build(uint8_t *buf, bool bye) {
+    rtcp_sender_tx_t tx = { 0 };
+    rtcp_sender_read_tx(&tx);
+    int64_t now_us = esp_timer_get_time();
+    uint64_t ntp = rtcp_sender_ntp_at(now_us);
+    // RTP time now, from where the last packet sat on the RTP clock
+    uint32_t rtp_now = tx.rtp_ts + (uint32_t)((uint64_t)(now_us - tx.sent_us) * s_clock_rate / 1000000ULL);
+
+    rtcp_sr_packet_t *sr = (rtcp_sr_packet_t *)buf;
+    put_header(buf, 0, RTCP_SR, sizeof(*sr));
+    sr->ssrc = htonl(s_ssrc);
+    sr->ntp_sec = htonl((uint32_t)(ntp >> 32));
+    sr->ntp_frac = htonl((uint32_t)ntp);
+    sr->rtp_timestamp = htonl(rtp_now);
+    sr->packet_count = htonl(tx.packets);
+    sr->octet_count = htonl(tx.octets);
+    size_t off = sizeof(*sr);
+
+    char cname[32];
+    rtcp_sender_cname(cname, sizeof(cname));
+    size_t cname_len = strnlen(cname, sizeof(cname) - 1);
+    size_t sdes_size = (sizeof(rtcp_header_t) + 4U + 2U + cname_len + 1U + 3U) & ~(size_t)3U;
+    uint8_t *p = buf + off;
+    memset(p, 0, sdes_size);
+    put_header(p, 1, RTCP_SDES, sdes_size);
+    put32(p + sizeof(rtcp_header_t), s_ssrc);
+    p[sizeof(rtcp_header_t) + 4] = 1;  // CNAME
+    p[sizeof(rtcp_header_t) + 5] = (uint8_t)cname_len;
+    memcpy(p + sizeof(rtcp_header_t) + 6, cname, cname_len);
+    off += sdes_size;
+
+    // DLRR sub-block per receiver with an RRTR pending (RFC 3611 4.5), so it gets its round trip
+    uint8_t *xr = buf + off;
+    size_t blocks = 0;
+    xSemaphoreTake(s_peers_mutex, portMAX_DELAY);
+    for (int i = 0; i < RTCP_SENDER_MAX_RECEIVERS; i++) {
+        rtcp_sender_peer_t *peer = &s_peers[i];
+        if (peer->info.ssrc == 0 || peer->rrtr_lrr == 0) {
+            continue;
+        }
+        uint8_t *sub = xr + sizeof(rtcp_header_t) + 8U + blocks * 12U;
+        put32(sub, peer->info.ssrc);
+        put32(sub + 4, peer->rrtr_lrr);
+        put32(sub + 8, (uint32_t)(((uint64_t)(now_us - peer->rrtr_rx_us) << 16) / 1000000ULL));
+        peer->rrtr_lrr = 0;
+        blocks++;
+    }
+    xSemaphoreGive(s_peers_mutex);
+    if (blocks > 0) {
+        size_t xr_size = sizeof(rtcp_header_t) + 8U + blocks * 12U;
+        put_header(xr, 0, RTCP_XR, xr_size);
+        put32(xr + sizeof(rtcp_header_t), s_ssrc);
+        xr[sizeof(rtcp_header_t) + 4] = RTCP_XR_DLRR;
+        xr[sizeof(rtcp_header_t) + 5] = 0;
+        xr[sizeof(rtcp_header_t) + 6] = (uint8_t)((blocks * 3U) >> 8);
+        xr[sizeof(rtcp_header_t) + 7] = (uint8_t)(blocks * 3U);
+        off += xr_size;
+    }
+
+    if (bye) {
+        put_header(buf + off, 1, RTCP_BYE, sizeof(rtcp_header_t) + 4U);
+        put32(buf + off + sizeof(rtcp_header_t), s_ssrc);
+        off += sizeof(rtcp_header_t) + 4U;
+    }
+    return off;
+}
+
+// One report to the RTCP port of every destination the RTP goes to
+static void rtcp_sender_send(bool bye) {
+    static uint8_t packet[RTCP_SR_BUFFER_SIZE];
+    rtp_sender_dest_stats_t dests[1 + CONFIG_RTP_TX_FANOUT_MAX];
+    size_t count = rtp_sender_get_destinations(dests, sizeof(dests) / sizeof(dests[0]));
+    size_t len = rtcp_sender_build(packet, bye);
+
+    for (size_t i = 0; i < count; i++) {
+        if (!dests[i].active || dests[i].addr == 0) {
+            continue;
+        }
+        struct sockaddr_in to = {
+            .sin_family = AF_INET,
+            .sin_addr.s_addr = dests[i].addr,
+            .sin_port = htons((uint16_t)(dests[i].port + 1)),
+        };
+        if (sendto(s_sock, packet, len, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+            LOG_RATE_W(TAG, "RTCP SR send to " IPSTR " failed: errno %d",
+                       IP2STR((esp_ip4_addr_t *)&to.sin_addr.s_addr), errno);
+            continue;
+        }
+        rtp_capture_packet(RTP_CAPTURE_TX | RTP_CAPTURE_RTCP, packet, len, NULL, 0,
+                           0, s_local_port, dests[i].addr, (uint16_t)(dests[i].port + 1));
+    }
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    // Relay listeners take the timeline from the same SR, and answer it over Wi-Fi
+    rtp_relay_forward(true, packet, len, NULL, 0, 0, s_local_port);
+#endif
+}
+
+static rtcp_sender_peer_t *rtcp_sender_peer_locked(uint32_t ssrc, uint32_t addr, uint16_t port, bool create) {
+    rtcp_sender_peer_t *free_slot = NULL;
+    for (int i = 0; i < RTCP_SENDER_MAX_RECEIVERS; i++) {
+        rtcp_sender_peer_t *peer = &s_peers[i];
+        if (peer->info.ssrc == ssrc) {
+            return peer;
+        }
+        if (peer->info.ssrc == 0 && !free_slot) {
+            free_slot = peer;
+        }
+    }
+    if (!create || !free_slot) {
+        return NULL;
+    }
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->info.ssrc = ssrc;
+    free_slot->info.addr = addr;
+    free_slot->info.port = port;
+    free_slot->info.rtt_us = -1;
+    ESP_LOGI(TAG, "RTCP: receiver 0x%08X reporting from " IPSTR ":%u", (unsigned)ssrc,
+             IP2STR((esp_ip4_addr_t *)&addr), port);
+    return free_slot;
+}
+
+// Report blocks about our SSRC, from a receiver's RR or SR
+static void rtcp_sender_parse_blocks(uint32_t from_ssrc, const uint8_t *p, size_t count, size_t avail,
+                                     uint32_t addr, uint16_t port) {
+    uint32_t now_mid = (uint32_t)(rtcp_sender_ntp_at(esp_timer_get_time()) >> 16);
+    for (size_t k = 0; k < count && (k + 1U) * sizeof(rtcp_report_block_t) <= avail; k++) {
+        const uint8_t *rb = p + k * sizeof(rtcp_report_block_t);
+        if (get32(rb) != s_ssrc) {
+            continue;
+        }
+        int32_t cum = (int32_t)(get32(rb + 4) << 8) >> 8;   // 24-bit signed
+        uint32_t lsr = get32(rb + 16);
+        uint32_t dlsr = get32(rb + 20);
+
+        xSemaphoreTake(s_peers_mutex, portMAX_DELAY);
+        rtcp_sender_peer_t *peer = rtcp_sender_peer_locked(from_ssrc, addr, port, true);
+        if (peer) {
+            peer->info.addr = addr;
+            peer->info.port = port;
+            peer->info.fraction_lost = rb[4];
+            peer->info.cumulative_lost = cum;
+            peer->info.ext_highest_seq = get32(rb + 8);
+            peer->info.jitter = get32(rb + 12);
+            if (lsr != 0) {
+                int32_t rtt = (int32_t)(now_mid - lsr - dlsr);
+                if (rtt >= 0) {
+                    peer->info.rtt_us = (int32_t)(((uint64_t)(uint32_t)rtt * 1000000ULL) >> 16);
+                }
+            }
+            peer->info.reports++;
+            peer->last_report_us = esp_timer_get_time();
+        }
+        xSemaphoreGive(s_peers_mutex);
+    }
+}
+
+// XR RRTR (RFC 3611 4.4): remember it for the DLRR in our next report
+static void rtcp_sender_parse_xr(uint32_t from_ssrc, const uint8_t *p, size_t size) {
+    size_t boff = sizeof(rtcp_header_t) + 4U;
+    while (boff + 4U <= size) {
+        size_t block_size = (((size_t)p[boff + 2] << 8) | p[boff + 3]) * 4U + 4U;
+        if (boff + block_size > size) {
+            break;
+        }
+        if (p[boff] == RTCP_XR_RRTR && block_size >= 12U) {
+            uint32_t lrr = (get32(p + boff + 4) << 16) | (get32(p + boff + 8) >> 16);
+            xSemaphoreTake(s_peers_mutex, portMAX_DELAY);
+            rtcp_sender_peer_t *peer = rtcp_sender_peer_locked(from_ssrc, 0, 0, false);
+            if (peer) {
+                peer->rrtr_lrr = lrr;
+                peer->rrtr_rx_us = esp_timer_get_time();
+            }
+            xSemaphoreGive(s_peers_mutex);
+        }
+        boff += block_size;
+    }
+}
+
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+// Generic NACK (RFC 4585 6.2.1): resend each packet the FCI entries name
+static void rtcp_sender_parse_nack(const uint8_t *p, size_t size, uint32_t addr) {
+    if (size < sizeof(rtcp_header_t) + 8U || get32(p + sizeof(rtcp_header_t) + 4U) != s_ssrc) {
+        return;
+    }
+    for (size_t off = sizeof(rtcp_header_t) + 8U; off + 4U <= size; off += 4U) {
+        uint16_t pid = (uint16_t)((p[off] << 8) | p[off + 1]);
+        uint16_t blp = (uint16_t)((p[off + 2] << 8) | p[off + 3]);
+        rtp_sender_retransmit(pid, addr);
+        for (unsigned bit = 0; bit < 16U; bit++) {
+            if (blp & (1U << bit)) {
+                rtp_sender_retransmit((uint16_t)(pid + bit + 1U), addr);
+            }
+        }
+    }
+}
+#endif
+
+static void rtcp_sender_parse(const uint8_t *packet, size_t len, uint32_t addr, uint16_t port) {
+    size_t offset = 0;
+    while (offset + sizeof(rtcp_header_t) + 4U <= len) {
+        const uint8_t *p = packet + offset;
+        const rtcp_header_t *hdr = (const rtcp_header_t *)p;
+        size_t size = ((size_t)ntohs(hdr->length) + 1U) * 4U;
+        if (RTCP_VERSION(hdr->vprc) != RTCP_VERSION_NUM || offset + size > len) {
+            LOG_RATE_W(TAG, "RTCP: malformed report from " IPSTR, IP2STR((esp_ip4_addr_t *)&addr));
+            return;
+        }
+        uint32_t from_ssrc = get32(p + sizeof(rtcp_header_t));
+        uint8_t rc = RTCP_RC(hdr->vprc);
+        switch (hdr->pt) {
+            case RTCP_RR:
+                rtcp_sender_parse_blocks(from_ssrc, p + sizeof(rtcp_rr_packet_t), rc,
+                                         size > sizeof(rtcp_rr_packet_t) ? size - sizeof(rtcp_rr_packet_t) : 0,
+                                         addr, port);
+                break;
+            case RTCP_SR:
+                if (size >= sizeof(rtcp_sr_packet_t)) {
+                    rtcp_sender_parse_blocks(from_ssrc, p + sizeof(rtcp_sr_packet_t), rc,
+                                             size - sizeof(rtcp_sr_packet_t), addr, port);
+                }
+                break;
+            case RTCP_XR:
+                rtcp_sender_parse_xr(from_ssrc, p, size);
+                break;
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+            case RTCP_RTPFB:
+                if (rc == RTCP_RTPFB_NACK) {
+                    rtcp_sender_parse_nack(p, size, addr);
+                }
+                break;
+#endif
+            case RTCP_BYE:
+                xSemaphoreTake(s_peers_mutex, portMAX_DELAY);
+                for (uint8_t i = 0; i < rc && sizeof(rtcp_header_t) + 4U * (i + 1U) <= size; i++) {
+                    rtcp_sender_peer_t *peer =
+                        rtcp_sender_peer_locked(get32(p + sizeof(rtcp_header_t) + 4U * i), 0, 0, false);
+                    if (peer) {
+                        ESP_LOGI(TAG, "RTCP: receiver 0x%08X left", (unsigned)peer->info.ssrc);
+                        peer->info.ssrc = 0;
+                    }
+                }
+                xSemaphoreGive(s_peers_mutex);
+                break;
+            default:
+                break;
+        }
+        offset += size;
+    }
+}
+
+static void rtcp_sender_expire(int64_t now_us) {
+    xSemaphoreTake(s_peers_mutex, portMAX_DELAY);
+    for (int i = 0; i < RTCP_SENDER_MAX_RECEIVERS; i++) {
+        rtcp_sender_peer_t *peer = &s_peers[i];
+        if (peer->info.ssrc != 0 &&
+            now_us - peer->last_report_us > (int64_t)RTCP_SENDER_RECEIVER_TIMEOUT_MS * 1000) {
+            ESP_LOGI(TAG, "RTCP: receiver 0x%08X timed out", (unsigned)peer->info.ssrc);
+            peer->info.ssrc = 0;
+        }
+    }
+    xSemaphoreGive(s_peers_mutex);
+}
+
+// Uniform in [0.5, 1.5] * CONFIG_RTCP_SR_INTERVAL_MS
+static int64_t rtcp_sender_interval_us(void) {
+    return (int64_t)CONFIG_RTCP_SR_INTERVAL_MS * (500 + (int64_t)(esp_random() % 1001U));
+}
+
+static void rtcp_sender_task(void *arg) {
+    (void)arg;
+    static uint8_t rx[RTCP_SR_RX_BUFFER_SIZE];
+    int64_t next_sr_us = esp_timer_get_time() + (int64_t)CONFIG_RTCP_SR_INTERVAL_MS * 250;
+
+    while (atomic_load(&s_running)) {
+        int64_t now = esp_timer_get_time();
+        if (now >= next_sr_us) {
+            rtcp_sender_tx_t tx = { 0 };
+            rtcp_sender_read_tx(&tx);
+            // Only while packets flow, or the extrapolated RTP time drifts from the stream
+            if (tx.packets > 0 && now - tx.sent_us < RTCP_SR_STREAM_IDLE_US) {
+                rtcp_sender_send(false);
+            }
+            rtcp_sender_expire(now);
+            next_sr_us = now + rtcp_sender_interval_us();
+        }
+
+        int64_t wait_us = next_sr_us - esp_timer_get_time();
+        if (wait_us < 0) {
+            wait_us = 0;
+        }
+        // Short enough that a stop request is seen promptly
+        if (wait_us > 100000) {
+            wait_us = 100000;
+        }
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(s_sock, &fds);
+        struct timeval tv = { .tv_sec = 0, .tv_usec = (long)wait_us };
+        if (select(s_sock + 1, &fds, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(s_sock, rx, sizeof(rx), 0, (struct sockaddr *)&from, &from_len);
+        if (n > 0) {
+            rtp_capture_packet(RTP_CAPTURE_RTCP, rx, (size_t)n, NULL, 0,
+                               from.sin_addr.s_addr, ntohs(from.sin_port), 0, s_local_port);
+            rtcp_sender_parse(rx, (size_t)n, from.sin_addr.s_addr, ntohs(from.sin_port));
+#ifdef CONFIG_RTP_TX_ADAPT
+            rtcp_sender_receiver_t receivers[RTCP_SENDER_MAX_RECEIVERS];
+            size_t count = rtcp_sender_get_receivers(receivers, RTCP_SENDER_MAX_RECEIVERS);
+            tx_adapt_update(receivers, count, s_clock_rate);
+#endif
+        }
+    }
+
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t rtcp_sender_start(uint32_t ssrc, uint32_t clock_rate) {
+    if (atomic_load(&s_running)) {
+        return ESP_OK;
+    }
+    if (!s_peers_mutex) {
+        s_peers_mutex = xSemaphoreCreateMutex();
+        if (!s_peers_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (s_sock < 0) {
+        ESP_LOGE(TAG, "Unable to create RTCP socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    // Any local port: receivers answer the source address of our SRs
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+        .sin_port = 0,
+    };
+    if (bind(s_sock, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        ESP_LOGE(TAG, "RTCP socket unable to bind: errno %d", errno);
+        close(s_sock);
+        s_sock = -1;
+        return ESP_FAIL;
+    }
+    wifi_manager_mark_audio_socket(s_sock);
+    socklen_t local_len = sizeof(local);
+    s_local_port = getsockname(s_sock, (struct sockaddr *)&local, &local_len) == 0 ? ntohs(local.sin_port) : 0;
+
+    s_ssrc = ssrc;
+    s_clock_rate = clock_rate;
+    atomic_store(&s_tx.seq, 0);
+    s_tx.packets = 0;
+    s_tx.octets = 0;
+    memset(s_peers, 0, sizeof(s_peers));
+    atomic_store(&s_running, true);
+    if (xTaskCreatePinnedToCore(rtcp_sender_task, "rtcp_sender", 4096, NULL, 4, &s_task, 0) != pdPASS) {
+        atomic_store(&s_running, false);
+        close(s_sock);
+        s_sock = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "RTCP sender reports enabled (SSRC 0x%08X, every ~%d ms)", (unsigned)ssrc,
+             CONFIG_RTCP_SR_INTERVAL_MS);
+    return ESP_OK;
+}
+
+void rtcp_sender_stop(void) {
+    if (!atomic_exchange(&s_running, false)) {
+        return;
+    }
+    // The task leaves within one select timeout
+    for (int i = 0; i < 20 && s_task; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    // A BYE is only due from a member that has sent a report (RFC 3550 6.3.7)
+    rtcp_sender_tx_t tx = { 0 };
+    rtcp_sender_read_tx(&tx);
+    if (tx.packets > 0) {
+        rtcp_sender_send(true);
+    }
+    close(s_sock);
+    s_sock = -1;
+}
+
+size_t rtcp_sender_get_receivers(rtcp_sender_receiver_t *out, size_t max) {
+    if (!out || max == 0 || !s_peers_mutex) {
+        return 0;
+    }
+    int64_t now = esp_timer_get_time();
+    size_t n = 0;
+    xSemaphoreTake(s_peers_mutex, portMAX_DELAY);
+    for (int i = 0; i < RTCP_SENDER_MAX_RECEIVERS && n < max; i++) {
+        const rtcp_sender_peer_t *peer = &s_peers[i];
+        if (peer->info.ssrc == 0 || peer->info.reports == 0) {
+            continue;
+        }
+        out[n] = peer->info;
+        out[n].age_ms = (uint32_t)((now - peer->last_report_us) / 1000);
+        n++;
+    }
+    xSemaphoreGive(s_peers_mutex);
+    return n;
+}
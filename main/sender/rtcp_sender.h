@@ -0,0 +1,70 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * RTCP for the on-device sender (CONFIG_RTCP_SEND_SR).
+ *
+ * A task on its own socket sends an SR + SDES(CNAME) compound packet to the
+ * RTCP port (RTP port + 1) of every destination the sender transmits to, every
+ * CONFIG_RTCP_SR_INTERVAL_MS randomized over [0.5, 1.5] (the first one after a
+ * quarter interval, so receivers lock quickly). The SR's NTP time comes from
+ * the NTP client's PLL (ntp_local_to_master), falling back to the system
+ * clock, and its RTP timestamp is extrapolated from the last packet sent:
+ * receivers mapping RTP time through it play in step with each other. No SR
+ * goes out while the stream is stalled. Stopping sends a BYE.
+ *
+ * Reports coming back about our SSRC (RR, or report blocks in a receiver's SR)
+ * are kept per receiver: loss, jitter and the round trip from LSR/DLSR. An XR
+ * RRTR is answered with a DLRR block in the next report. A BYE, or no report
+ * for RTCP_SENDER_RECEIVER_TIMEOUT_MS, forgets the receiver. With
+ * CONFIG_RTP_TX_RTX_ENABLED a generic NACK (RTPFB) about our SSRC has the
+ * sender resend the packets it names (rtp_sender_retransmit()).
+ */
+
+#define RTCP_SENDER_MAX_RECEIVERS 8
+
+// What one receiver last reported about our stream
+typedef struct {
+    uint32_t ssrc;              // Receiver's SSRC
+    uint32_t addr;              // IPv4 its reports come from, network byte order
+    uint16_t port;
+    uint8_t fraction_lost;      // Loss since its previous report, 1/256 units
+    int32_t cumulative_lost;
+    uint32_t ext_highest_seq;
+    uint32_t jitter;            // Interarrival jitter in RTP ticks
+    int32_t rtt_us;             // Round trip from LSR/DLSR; -1 until a report carries LSR
+    uint32_t reports;           // Reports received
+    uint32_t age_ms;            // Since its last report
+} rtcp_sender_receiver_t;
+
+/**
+ * @brief Open the RTCP socket and start reporting on a stream
+ * @param ssrc SSRC of the RTP stream (the SR's sender SSRC)
+ * @param clock_rate RTP clock rate, for extrapolating the SR's RTP timestamp
+ */
+esp_err_t rtcp_sender_start(uint32_t ssrc, uint32_t clock_rate);
+
+/**
+ * @brief Send a BYE to every destination, stop the task and close the socket
+ * Safe to call when not started.
+ */
+void rtcp_sender_stop(void);
+
+/**
+ * @brief Record a sent RTP packet (sender task, per packet)
+ * @param rtp_ts The packet's RTP timestamp
+ * @param payload_bytes Payload octets, for the SR's octet count
+ */
+void rtcp_sender_note_packet(uint32_t rtp_ts, uint32_t payload_bytes);
+
+/**
+ * @brief Snapshot the receivers currently reporting
+ * @param out Entries to fill
+ * @param max Capacity of out
+ * @return Number of entries written
+ */
+size_t rtcp_sender_get_receivers(rtcp_sender_receiver_t *out, size_t max);
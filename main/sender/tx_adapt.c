@@ -0,0 +1,125 @@
+#include "tx_adapt.h"
+#include "global.h"
+#include "build_config.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+
+// Base FEC group, half of it, 2, then the base ptime doubled until CONFIG_RTP_TX_ADAPT_MAX_PTIME_MS
+#define TX_ADAPT_MAX_LEVELS 8
+// Bad evaluations in a row before stepping up
+#define TX_ADAPT_UP_REPORTS 2
+
+typedef struct {
+    uint8_t ptime_ms;
+    uint8_t fec_group;
+} tx_adapt_step_t;
+
+static tx_adapt_step_t s_steps[TX_ADAPT_MAX_LEVELS];
+static uint8_t s_step_count = 1;
+static uint8_t s_level = 0;
+static uint8_t s_bad_run = 0;
+static uint8_t s_good_run = 0;
+static uint32_t s_reports_seen = 0;
+// ptime << 8 | fec_group of the current level, for the sender task
+static atomic_uint s_current = 0;
+
+static void tx_adapt_publish(void) {
+    const tx_adapt_step_t *step = &s_steps[s_level];
+    atomic_store_explicit(&s_current, ((unsigned)step->ptime_ms << 8) | step->fec_group, memory_order_relaxed);
+}
+
+static void tx_adapt_add_step(uint8_t ptime_ms, uint8_t fec_group) {
+    if (s_step_count >= TX_ADAPT_MAX_LEVELS) {
+        return;
+    }
+    const tx_adapt_step_t *last = &s_steps[s_step_count - 1];
+    if (last->ptime_ms == ptime_ms && last->fec_group == fec_group) {
+        return;
+    }
+    s_steps[s_step_count++] = (tx_adapt_step_t){ .ptime_ms = ptime_ms, .fec_group = fec_group };
+}
+
+void tx_adapt_reset(uint8_t base_ptime_ms, uint8_t base_fec_group) {
+    s_step_count = 1;
+    s_steps[0] = (tx_adapt_step_t){ .ptime_ms = base_ptime_ms, .fec_group = base_fec_group };
+    if (base_fec_group > 0) {
+        tx_adapt_add_step(base_ptime_ms, base_fec_group / 2 >= 2 ? base_fec_group / 2 : 2);
+        tx_adapt_add_step(base_ptime_ms, 2);
+    }
+    for (unsigned p = (unsigned)base_ptime_ms * 2; p <= CONFIG_RTP_TX_ADAPT_MAX_PTIME_MS; p *= 2) {
+        tx_adapt_add_step((uint8_t)p, 0);
+    }
+    // A last step at the cap itself when doubling skips past it
+    if (base_ptime_ms < CONFIG_RTP_TX_ADAPT_MAX_PTIME_MS) {
+        tx_adapt_add_step(CONFIG_RTP_TX_ADAPT_MAX_PTIME_MS, 0);
+    }
+    s_level = 0;
+    s_bad_run = 0;
+    s_good_run = 0;
+    s_reports_seen = 0;
+    tx_adapt_publish();
+}
+
+bool tx_adapt_update(const rtcp_sender_receiver_t *rx, size_t count, uint32_t clock_rate) {
+    if (!rx || count == 0 || clock_rate == 0) {
+        return false;
+    }
+    // Only act on new evidence: the same reports read twice are not two bad intervals
+    uint32_t reports = 0;
+    uint32_t worst_loss = 0;
+    uint32_t worst_jitter = 0;
+    for (size_t i = 0; i < count; i++) {
+        reports += rx[i].reports;
+        if (rx[i].fraction_lost > worst_loss) {
+            worst_loss = rx[i].fraction_lost;
+        }
+        if (rx[i].jitter > worst_jitter) {
+            worst_jitter = rx[i].jitter;
+        }
+    }
+    if (reports == s_reports_seen) {
+        return false;
+    }
+    s_reports_seen = reports;
+
+    uint32_t loss_permille = worst_loss * 1000u / 256u;
+    uint32_t jitter_us = (uint32_t)((uint64_t)worst_jitter * 1000000u / clock_rate);
+    bool bad = loss_permille >= CONFIG_RTP_TX_ADAPT_LOSS_UP_PERMILLE ||
+               jitter_us > (uint32_t)CONFIG_RTP_TX_ADAPT_JITTER_UP_MS * 1000u;
+    bool good = loss_permille <= CONFIG_RTP_TX_ADAPT_LOSS_DOWN_PERMILLE &&
+                jitter_us <= (uint32_t)CONFIG_RTP_TX_ADAPT_JITTER_UP_MS * 500u;
+
+    s_bad_run = bad ? (uint8_t)(s_bad_run + 1) : 0;
+    s_good_run = good ? (uint8_t)(s_good_run + 1) : 0;
+
+    uint8_t level = s_level;
+    if (s_bad_run >= TX_ADAPT_UP_REPORTS && level + 1 < s_step_count) {
+        level++;
+    } else if (s_good_run >= CONFIG_RTP_TX_ADAPT_HOLD_REPORTS && level > 0) {
+        level--;
+    }
+    if (level == s_level) {
+        return false;
+    }
+    // Each level gets a full dwell before the next move
+    s_bad_run = 0;
+    s_good_run = 0;
+    s_level = level;
+    tx_adapt_publish();
+    ESP_LOGI(TAG, "TX adapt: level %u (ptime %u ms, FEC group %u) after loss %u/1000, jitter %u us",
+             level, s_steps[level].ptime_ms, s_steps[level].fec_group,
+             (unsigned)loss_permille, (unsigned)jitter_us);
+    return true;
+}
+
+uint8_t tx_adapt_ptime_ms(void) {
+    return (uint8_t)(atomic_load_explicit(&s_current, memory_order_relaxed) >> 8);
+}
+
+uint8_t tx_adapt_fec_group(void) {
+    return (uint8_t)atomic_load_explicit(&s_current, memory_order_relaxed);
+}
+
+uint8_t tx_adapt_level(void) {
+    return s_level;
+}
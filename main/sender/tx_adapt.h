@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "rtcp_sender.h"
+
+/*
+ * Sender link adaptation from receiver reports (CONFIG_RTP_TX_ADAPT).
+ *
+ * A ladder of packetization levels runs from the configured ptime and FEC
+ * group (level 0) towards more robust ones: first smaller FEC groups (more
+ * parity), then longer packets, which cut the packet rate and so the Wi-Fi
+ * contention behind most loss and jitter. Receivers only protect bodies up to
+ * their own chunk size, so levels with a longer ptime send no parity.
+ *
+ * Each evaluation with fresh reports takes the worst receiver's fraction lost
+ * and jitter. Two bad evaluations in a row step one level up; it takes
+ * CONFIG_RTP_TX_ADAPT_HOLD_REPORTS good ones to step back down, so a link on
+ * the edge does not flap. SAP keeps announcing the configured ptime;
+ * receivers re-chunk packets of any length.
+ *
+ * tx_adapt_update() runs on the RTCP task; the getters may be called from any
+ * task (the sender reads them once per packet).
+ */
+
+/**
+ * @brief Start from level 0
+ * @param base_ptime_ms Configured packet time
+ * @param base_fec_group Configured media packets per parity packet; 0 without FEC
+ */
+void tx_adapt_reset(uint8_t base_ptime_ms, uint8_t base_fec_group);
+
+/**
+ * @brief Evaluate the latest receiver reports
+ * @param rx Receivers, as rtcp_sender_get_receivers()
+ * @param count Entries in rx
+ * @param clock_rate RTP clock rate, for the jitter
+ * @return true if the level changed
+ */
+bool tx_adapt_update(const rtcp_sender_receiver_t *rx, size_t count, uint32_t clock_rate);
+
+/**
+ * @brief Packet time for the next packet
+ */
+uint8_t tx_adapt_ptime_ms(void);
+
+/**
+ * @brief Media packets per parity packet for the next group; 0 for none
+ */
+uint8_t tx_adapt_fec_group(void);
+
+/**
+ * @brief Current level, 0 = as configured
+ */
+uint8_t tx_adapt_level(void);
@@ -0,0 +1,255 @@
+#include "capture_routes.h"
+#include "rtp/rtp_capture.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "capture_routes";
+
+// Longest JSON body accepted for a start request
+#define CAPTURE_BODY_MAX 256
+#define CAPTURE_CHUNK_SIZE 2048   // Records are batched into chunks of this size
+
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    char buf[CAPTURE_CHUNK_SIZE];
+} capture_chunk_t;
+
+static esp_err_t chunk_flush(capture_chunk_t *chunk)
+{
+    esp_err_t ret = ESP_OK;
+    if (chunk->len > 0) {
+        ret = httpd_resp_send_chunk(chunk->req, chunk->buf, chunk->len);
+        chunk->len = 0;
+    }
+    return ret;
+}
+
+static esp_err_t chunk_write(void *ctx, const void *data, size_t len)
+{
+    capture_chunk_t *chunk = (capture_chunk_t *)ctx;
+    if (chunk->len + len > sizeof(chunk->buf)) {
+        esp_err_t ret = chunk_flush(chunk);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    if (len > sizeof(chunk->buf)) {
+        return httpd_resp_send_chunk(chunk->req, data, len);
+    }
+    memcpy(chunk->buf + chunk->len, data, len);
+    chunk->len += len;
+    return ESP_OK;
+}
+
+static esp_err_t send_json(httpd_req_t *req, cJSON *root)
+{
+    char *json_str = root ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON string");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+    return ret;
+}
+
+static esp_err_t send_status(httpd_req_t *req)
+{
+    rtp_capture_status_t status;
+    rtp_capture_get_status(&status);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON response");
+        return ESP_FAIL;
+    }
+#ifdef CONFIG_RTP_CAPTURE_ENABLED
+    cJSON_AddBoolToObject(root, "enabled", true);
+#else
+    cJSON_AddBoolToObject(root, "enabled", false);
+#endif
+    cJSON_AddBoolToObject(root, "armed", status.armed);
+    cJSON_AddNumberToObject(root, "ssrc", status.ssrc);
+    cJSON_AddNumberToObject(root, "port", status.port);
+    cJSON_AddNumberToObject(root, "snaplen", status.snaplen);
+    cJSON_AddNumberToObject(root, "slots", status.slots);
+    cJSON_AddNumberToObject(root, "captured", status.captured);
+    cJSON_AddNumberToObject(root, "kept", status.captured < status.slots ? status.captured : status.slots);
+    cJSON_AddNumberToObject(root, "dropped", status.dropped);
+    cJSON_AddBoolToObject(root, "in_psram", status.in_psram);
+    return send_json(req, root);
+}
+
+/**
+ * GET handler for /api/capture
+ *
+ * kept is how many of the captured packets the ring still holds.
+ */
+static esp_err_t capture_get_handler(httpd_req_t *req)
+{
+    return send_status(req);
+}
+
+static uint32_t json_uint(const cJSON *root, const char *name, uint32_t def, uint32_t max)
+{
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(root, name);
+    if (!cJSON_IsNumber(item) || item->valuedouble < 0) {
+        return def;
+    }
+    return item->valuedouble > (double)max ? max : (uint32_t)item->valuedouble;
+}
+
+/**
+ * POST handler for /api/capture
+ *
+ * {"action":"start","ssrc":0,"port":0,"snaplen":0} or {"action":"stop"}.
+ * Missing fields take the values shown: every SSRC, every port and the
+ * configured snap length. Answers with the state, as GET does.
+ */
+static esp_err_t capture_post_handler(httpd_req_t *req)
+{
+    if (req->content_len == 0 || req->content_len > CAPTURE_BODY_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or oversized body");
+        return ESP_FAIL;
+    }
+    char body[CAPTURE_BODY_MAX + 1];
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, body + received, req->content_len - received);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(req);
+            }
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    body[received] = '\0';
+
+    cJSON *root = cJSON_Parse(body);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON payload");
+        return ESP_FAIL;
+    }
+    const cJSON *action = cJSON_GetObjectItemCaseSensitive(root, "action");
+    if (cJSON_IsString(action) && strcmp(action->valuestring, "stop") == 0) {
+        cJSON_Delete(root);
+        rtp_capture_stop();
+        return send_status(req);
+    }
+    if (!cJSON_IsString(action) || strcmp(action->valuestring, "start") != 0) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "action must be start or stop");
+        return ESP_FAIL;
+    }
+
+    uint32_t ssrc = json_uint(root, "ssrc", 0, UINT32_MAX);
+    uint16_t port = (uint16_t)json_uint(root, "port", 0, UINT16_MAX);
+    uint16_t snaplen = (uint16_t)json_uint(root, "snaplen", 0, RTP_CAPTURE_SNAPLEN_MAX);
+    cJSON_Delete(root);
+
+    esp_err_t err = rtp_capture_start(ssrc, port, snaplen);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Capture not started: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, err == ESP_ERR_NOT_SUPPORTED ? HTTPD_404_NOT_FOUND : HTTPD_500_INTERNAL_SERVER_ERROR,
+                            err == ESP_ERR_NOT_SUPPORTED ? "Packet capture not built in (CONFIG_RTP_CAPTURE_ENABLED)" :
+                            "No memory for the capture ring");
+        return ESP_FAIL;
+    }
+    return send_status(req);
+}
+
+/**
+ * GET handler for /api/capture.pcap
+ *
+ * The ring, oldest packet first, as a pcap file Wireshark opens directly
+ * (Decode As RTP on the stream's port, if it was not announced with SIP or RTSP).
+ */
+static esp_err_t capture_pcap_handler(httpd_req_t *req)
+{
+#ifdef CONFIG_RTP_CAPTURE_ENABLED
+    capture_chunk_t *chunk = malloc(sizeof(*chunk));
+    if (!chunk) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+        return ESP_FAIL;
+    }
+    chunk->req = req;
+    chunk->len = 0;
+
+    rtp_capture_status_t status;
+    rtp_capture_get_status(&status);
+    if (status.slots == 0) {
+        free(chunk);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Nothing captured yet");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/vnd.tcpdump.pcap");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"capture.pcap\"");
+    esp_err_t ret = rtp_capture_write_pcap(chunk_write, chunk);
+    if (ret == ESP_OK) {
+        ret = chunk_flush(chunk);
+    }
+    free(chunk);
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Capture download aborted: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+#else
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Packet capture disabled (CONFIG_RTP_CAPTURE_ENABLED)");
+    return ESP_FAIL;
+#endif
+}
+
+esp_err_t register_capture_routes(httpd_handle_t server)
+{
+    if (!server) {
+        ESP_LOGE(TAG, "Invalid server handle");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_uri_t get_uri = {
+        .uri       = "/api/capture",
+        .method    = HTTP_GET,
+        .handler   = capture_get_handler,
+        .user_ctx  = NULL
+    };
+    esp_err_t ret = httpd_register_uri_handler(server, &get_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/capture: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t post_uri = {
+        .uri       = "/api/capture",
+        .method    = HTTP_POST,
+        .handler   = capture_post_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &post_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/capture: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t pcap_uri = {
+        .uri       = "/api/capture.pcap",
+        .method    = HTTP_GET,
+        .handler   = capture_pcap_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &pcap_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/capture.pcap: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,18 @@
+#ifndef CAPTURE_ROUTES_H
+#define CAPTURE_ROUTES_H
+
+#include "esp_http_server.h"
+
+/**
+ * Register the RTP/RTCP packet capture (GET and POST /api/capture, GET /api/capture.pcap)
+ *
+ * GET returns the capture's state; POST starts one with the filters in its
+ * JSON body, or stops it with {"action":"stop"}. The pcap download works
+ * while recording as well as after.
+ *
+ * @param server HTTP server handle
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t register_capture_routes(httpd_handle_t server);
+
+#endif // CAPTURE_ROUTES_H
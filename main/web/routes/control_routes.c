@@ -0,0 +1,201 @@
+#include "control_routes.h"
+#include "build_config.h"
+#include "esp_log.h"
+
+static const char *TAG = "control_routes";
+
+#ifdef CONFIG_WEB_CONTROL_WS
+#include "json_stream.h"
+#include "lifecycle_manager.h"
+#include "receiver/audio_out.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+// Longest command frame; a larger one closes the channel
+#define CONTROL_FRAME_MAX 256
+// Sockets the server may have open (web_server.c)
+#define CONTROL_SOCKETS_MAX 8
+// SAP stream names are 63 characters at most, each at most 6 once escaped
+#define CONTROL_STREAM_ESCAPED_MAX (63 * 6 + 1)
+
+// Handlers run on the HTTP server task only, so the frame buffers can be static
+static char s_frame[CONTROL_FRAME_MAX + 1];
+static char s_state[CONTROL_STREAM_ESCAPED_MAX + 128];
+
+static void json_escape(const char *src, char *dst, size_t size) {
+    size_t n = 0;
+    for (; *src && n + 7 < size; src++) {
+        unsigned char c = (unsigned char)*src;
+        if (c == '"' || c == '\\') {
+            dst[n++] = '\\';
+            dst[n++] = (char)c;
+        } else if (c < 0x20) {
+            n += (size_t)snprintf(dst + n, size - n, "\\u%04x", c);
+        } else {
+            dst[n++] = (char)c;
+        }
+    }
+    dst[n] = '\0';
+}
+
+static size_t control_format_state(void) {
+    char stream[CONTROL_STREAM_ESCAPED_MAX];
+    json_escape(lifecycle_get_sap_stream_name(), stream, sizeof(stream));
+    int len = snprintf(s_state, sizeof(s_state),
+                       "{\"volume\":%.3f,\"muted\":%s,\"buffer_target_ms\":%u,\"stream\":\"%s\"}",
+                       lifecycle_get_volume(), audio_out_is_muted() ? "true" : "false",
+                       lifecycle_get_buffer_target_ms(), stream);
+    return len < (int)sizeof(s_state) ? (size_t)len : sizeof(s_state) - 1;
+}
+
+static size_t control_list_channels(httpd_handle_t hd, int *fds) {
+    size_t count = CONTROL_SOCKETS_MAX;
+    if (httpd_get_client_list(hd, &count, fds) != ESP_OK) {
+        return 0;
+    }
+    size_t channels = 0;
+    for (size_t i = 0; i < count; i++) {
+        // The only WebSocket URI is this one
+        if (httpd_ws_get_fd_info(hd, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            fds[channels++] = fds[i];
+        }
+    }
+    return channels;
+}
+
+static void control_broadcast_state(httpd_handle_t hd) {
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)s_state,
+        .len = control_format_state(),
+    };
+    int fds[CONTROL_SOCKETS_MAX];
+    size_t channels = control_list_channels(hd, fds);
+    for (size_t i = 0; i < channels; i++) {
+        httpd_ws_send_frame_async(hd, fds[i], &frame);
+    }
+}
+
+// Apply one command object; false if it is not well-formed JSON
+static bool control_apply(const char *payload, size_t len) {
+    json_stream_t js;
+    json_stream_init_buffer(&js, payload, len);
+    if (json_stream_next(&js) != JSON_STREAM_OBJECT_START) {
+        return false;
+    }
+    for (;;) {
+        json_stream_token_t tok = json_stream_next(&js);
+        if (tok == JSON_STREAM_OBJECT_END) {
+            return json_stream_next(&js) == JSON_STREAM_END;
+        }
+        if (tok != JSON_STREAM_KEY) {
+            return false;
+        }
+        char key[24];
+        strlcpy(key, js.text, sizeof(key));
+        tok = json_stream_next(&js);
+
+        if (strcmp(key, "volume") == 0 && tok == JSON_STREAM_NUMBER &&
+            js.number >= 0.0 && js.number <= 1.0) {
+            lifecycle_set_volume((float)js.number);
+        } else if (strcmp(key, "mute") == 0 && (tok == JSON_STREAM_TRUE || tok == JSON_STREAM_FALSE)) {
+            audio_out_set_muted(tok == JSON_STREAM_TRUE);
+        } else if (strcmp(key, "stream") == 0 && tok == JSON_STREAM_STRING &&
+                   !js.truncated && js.text_len < sizeof(((app_config_t *)0)->sap_stream_name)) {
+            lifecycle_set_sap_stream_name(js.text);
+        } else if (strcmp(key, "buffer_target_ms") == 0 && tok == JSON_STREAM_NUMBER &&
+                   js.number >= 0 && js.number <= UINT16_MAX) {
+            lifecycle_set_buffer_target_ms((uint16_t)js.number);
+        } else if (tok != JSON_STREAM_ERROR) {
+            ESP_LOGW(TAG, "Ignoring invalid %s", key);
+        }
+        if (!json_stream_skip(&js, tok)) {
+            return false;
+        }
+    }
+}
+
+/**
+ * WebSocket handler for /api/control: the handshake, then one call per frame
+ */
+static esp_err_t control_ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    if (req->method == HTTP_GET) {
+        int fds[CONTROL_SOCKETS_MAX];
+        if (control_list_channels(req->handle, fds) > CONFIG_WEB_CONTROL_MAX_CLIENTS) {
+            ESP_LOGW(TAG, "Control channel limit (%d) reached, closing socket %d",
+                     CONFIG_WEB_CONTROL_MAX_CLIENTS, fd);
+            httpd_sess_trigger_close(req->handle, fd);
+            return ESP_OK;
+        }
+        ESP_LOGI(TAG, "Control channel opened (socket %d)", fd);
+        httpd_ws_frame_t frame = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_TEXT,
+            .payload = (uint8_t *)s_state,
+            .len = control_format_state(),
+        };
+        return httpd_ws_send_frame(req, &frame);
+    }
+
+    httpd_ws_frame_t frame = { 0 };
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (frame.len > CONTROL_FRAME_MAX) {
+        ESP_LOGW(TAG, "Control frame of %u bytes on socket %d, closing", (unsigned)frame.len, fd);
+        return ESP_FAIL;
+    }
+    frame.payload = (uint8_t *)s_frame;
+    if (frame.len > 0) {
+        ret = httpd_ws_recv_frame(req, &frame, frame.len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    if (frame.type != HTTPD_WS_TYPE_TEXT) {
+        return ESP_OK;
+    }
+    s_frame[frame.len] = '\0';
+
+    int64_t start_us = esp_timer_get_time();
+    if (!control_apply(s_frame, frame.len)) {
+        ESP_LOGW(TAG, "Malformed control frame on socket %d", fd);
+    }
+    ESP_LOGD(TAG, "Control frame applied in %lld us", (long long)(esp_timer_get_time() - start_us));
+
+    // Every channel follows, the sender included (a rejected value snaps back)
+    control_broadcast_state(req->handle);
+    return ESP_OK;
+}
+#endif
+
+/**
+ * Register the control channel route
+ */
+esp_err_t register_control_routes(httpd_handle_t server)
+{
+#ifdef CONFIG_WEB_CONTROL_WS
+    httpd_uri_t control_ws = {
+        .uri          = "/api/control",
+        .method       = HTTP_GET,
+        .handler      = control_ws_handler,
+        .user_ctx     = NULL,
+        .is_websocket = true,
+    };
+    esp_err_t ret = httpd_register_uri_handler(server, &control_ws);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register WS /api/control: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Control channel registered at /api/control");
+#else
+    (void)server;
+    (void)TAG;
+#endif
+    return ESP_OK;
+}
@@ -0,0 +1,21 @@
+#ifndef CONTROL_ROUTES_H
+#define CONTROL_ROUTES_H
+
+#include "esp_http_server.h"
+
+/**
+ * Register the WebSocket control channel (GET /api/control, CONFIG_WEB_CONTROL_WS)
+ *
+ * Text frames carry a JSON object with any of "volume" (0.0-1.0), "mute",
+ * "stream" (SAP stream name, "" for none) and "buffer_target_ms". Each is
+ * applied in memory as it arrives; the stored settings follow through the
+ * debounced settings save. Every open channel is sent the resulting state,
+ * and a new channel gets it right after the handshake. A no-op without the
+ * option.
+ *
+ * @param server HTTP server handle
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t register_control_routes(httpd_handle_t server);
+
+#endif // CONTROL_ROUTES_H
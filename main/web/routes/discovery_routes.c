@@ -33,6 +33,11 @@ static esp_err_t scream_devices_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
+    // Waits up to a second for the discovery service's device list
+    if (!route_async_in_worker()) {
+        return route_async_submit(req, scream_devices_handler);
+    }
+
     // Set CORS headers for GET request
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_set_type(req, "application/json");
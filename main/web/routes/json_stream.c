@@ -0,0 +1,371 @@
+#include "json_stream.h"
+#include <stdlib.h>
+
+#define CH_EOF   -1
+#define CH_ERROR -2
+
+// What the next non-whitespace character may be
+enum {
+    EXPECT_VALUE,           // Top level, after ':' or after ',' in an array
+    EXPECT_VALUE_OR_END,    // After '['
+    EXPECT_KEY_OR_END,      // After '{'
+    EXPECT_KEY,             // After ',' in an object
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_END,
+    EXPECT_DONE,            // Top-level value complete: only whitespace may follow
+    EXPECT_FAILED,
+};
+
+void json_stream_init(json_stream_t *js, httpd_req_t *req) {
+    *js = (json_stream_t){
+        .req = req,
+        .remaining = req->content_len,
+        .peeked = -1,
+        .expect = EXPECT_VALUE,
+    };
+    js->data = js->window;
+}
+
+void json_stream_init_buffer(json_stream_t *js, const char *data, size_t len) {
+    *js = (json_stream_t){
+        .data = data,
+        .len = len,
+        .peeked = -1,
+        .expect = EXPECT_VALUE,
+    };
+}
+
+static int stream_getc(json_stream_t *js) {
+    if (js->peeked >= 0) {
+        int c = js->peeked;
+        js->peeked = -1;
+        return c;
+    }
+    if (js->pos == js->len) {
+        if (js->remaining == 0 || !js->req) {
+            return CH_EOF;
+        }
+        size_t want = js->remaining < sizeof(js->window) ? js->remaining : sizeof(js->window);
+        int ret = httpd_req_recv(js->req, js->window, want);
+        if (ret <= 0) {
+            js->recv_error = ret ? ret : HTTPD_SOCK_ERR_FAIL;
+            return CH_ERROR;
+        }
+        js->remaining -= (size_t)ret;
+        js->pos = 0;
+        js->len = (size_t)ret;
+    }
+    return (unsigned char)js->data[js->pos++];
+}
+
+static int stream_getc_nonspace(json_stream_t *js) {
+    int c;
+    do {
+        c = stream_getc(js);
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    return c;
+}
+
+static json_stream_token_t stream_fail(json_stream_t *js) {
+    js->expect = EXPECT_FAILED;
+    return JSON_STREAM_ERROR;
+}
+
+static bool top_is_array(const json_stream_t *js) {
+    return (js->in_array >> (js->depth - 1)) & 1;
+}
+
+static void after_value(json_stream_t *js) {
+    js->expect = js->depth == 0 ? EXPECT_DONE : EXPECT_COMMA_OR_END;
+}
+
+static bool push_container(json_stream_t *js, bool array) {
+    if (js->depth >= JSON_STREAM_MAX_DEPTH) {
+        return false;
+    }
+    if (array) {
+        js->in_array |= (uint16_t)(1u << js->depth);
+    } else {
+        js->in_array &= (uint16_t)~(1u << js->depth);
+    }
+    js->depth++;
+    js->expect = array ? EXPECT_VALUE_OR_END : EXPECT_KEY_OR_END;
+    return true;
+}
+
+static json_stream_token_t close_container(json_stream_t *js, int c) {
+    if (js->depth == 0) {
+        return stream_fail(js);
+    }
+    bool array = top_is_array(js);
+    if (c != (array ? ']' : '}')) {
+        return stream_fail(js);
+    }
+    js->depth--;
+    after_value(js);
+    return array ? JSON_STREAM_ARRAY_END : JSON_STREAM_OBJECT_END;
+}
+
+// Multi-byte sequences are kept whole or dropped, never split by truncation
+static void text_append(json_stream_t *js, const char *bytes, size_t n) {
+    if (js->text_len + n > JSON_STREAM_TEXT_MAX) {
+        js->truncated = true;
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        js->text[js->text_len++] = bytes[i];
+    }
+}
+
+static int read_hex4(json_stream_t *js) {
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = stream_getc(js);
+        int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return -1;
+        }
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+// \uXXXX (a surrogate pair is two of them) to UTF-8
+static bool read_unicode_escape(json_stream_t *js) {
+    int cp = read_hex4(js);
+    if (cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF)) {
+        return false;
+    }
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        if (stream_getc(js) != '\\' || stream_getc(js) != 'u') {
+            return false;
+        }
+        int low = read_hex4(js);
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return false;
+        }
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    char utf8[4];
+    size_t n;
+    if (cp < 0x80) {
+        utf8[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        utf8[0] = (char)(0xC0 | (cp >> 6));
+        utf8[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        utf8[0] = (char)(0xE0 | (cp >> 12));
+        utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        utf8[0] = (char)(0xF0 | (cp >> 18));
+        utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+    text_append(js, utf8, n);
+    return true;
+}
+
+// Opening quote already consumed
+static bool read_string(json_stream_t *js) {
+    js->text_len = 0;
+    js->truncated = false;
+    for (;;) {
+        int c = stream_getc(js);
+        if (c < 0x20) {
+            // EOF, receive error or an unescaped control character
+            return false;
+        }
+        if (c == '"') {
+            break;
+        }
+        if (c == '\\') {
+            char unescaped;
+            switch (stream_getc(js)) {
+                case '"':  unescaped = '"';  break;
+                case '\\': unescaped = '\\'; break;
+                case '/':  unescaped = '/';  break;
+                case 'b':  unescaped = '\b'; break;
+                case 'f':  unescaped = '\f'; break;
+                case 'n':  unescaped = '\n'; break;
+                case 'r':  unescaped = '\r'; break;
+                case 't':  unescaped = '\t'; break;
+                case 'u':
+                    if (!read_unicode_escape(js)) {
+                        return false;
+                    }
+                    continue;
+                default:
+                    return false;
+            }
+            text_append(js, &unescaped, 1);
+            continue;
+        }
+        char ch = (char)c;
+        text_append(js, &ch, 1);
+    }
+    js->text[js->text_len] = '\0';
+    return true;
+}
+
+// First character already consumed; the one that ends the number is pushed back
+static bool read_number(json_stream_t *js, int c) {
+    char digits[32];
+    size_t n = 0;
+    while ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+        if (n == sizeof(digits) - 1) {
+            return false;
+        }
+        digits[n++] = (char)c;
+        c = stream_getc(js);
+    }
+    if (c == CH_ERROR) {
+        return false;
+    }
+    if (c != CH_EOF) {
+        js->peeked = c;
+    }
+    digits[n] = '\0';
+
+    char *end;
+    js->number = strtod(digits, &end);
+    return end == digits + n;
+}
+
+static bool read_literal(json_stream_t *js, const char *rest) {
+    for (; *rest; rest++) {
+        if (stream_getc(js) != *rest) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static json_stream_token_t read_value(json_stream_t *js, int c) {
+    json_stream_token_t tok;
+    switch (c) {
+        case '{':
+            return push_container(js, false) ? JSON_STREAM_OBJECT_START : stream_fail(js);
+        case '[':
+            return push_container(js, true) ? JSON_STREAM_ARRAY_START : stream_fail(js);
+        case '"':
+            if (!read_string(js)) {
+                return stream_fail(js);
+            }
+            tok = JSON_STREAM_STRING;
+            break;
+        case 't':
+            if (!read_literal(js, "rue")) {
+                return stream_fail(js);
+            }
+            tok = JSON_STREAM_TRUE;
+            break;
+        case 'f':
+            if (!read_literal(js, "alse")) {
+                return stream_fail(js);
+            }
+            tok = JSON_STREAM_FALSE;
+            break;
+        case 'n':
+            if (!read_literal(js, "ull")) {
+                return stream_fail(js);
+            }
+            tok = JSON_STREAM_NULL;
+            break;
+        default:
+            if (c != '-' && (c < '0' || c > '9')) {
+                return stream_fail(js);
+            }
+            if (!read_number(js, c)) {
+                return stream_fail(js);
+            }
+            tok = JSON_STREAM_NUMBER;
+            break;
+    }
+    after_value(js);
+    return tok;
+}
+
+json_stream_token_t json_stream_next(json_stream_t *js) {
+    for (;;) {
+        if (js->expect == EXPECT_FAILED) {
+            return JSON_STREAM_ERROR;
+        }
+        int c = stream_getc_nonspace(js);
+        if (c == CH_ERROR) {
+            return stream_fail(js);
+        }
+        switch (js->expect) {
+            case EXPECT_DONE:
+                return c == CH_EOF ? JSON_STREAM_END : stream_fail(js);
+            case EXPECT_COLON:
+                if (c != ':') {
+                    return stream_fail(js);
+                }
+                js->expect = EXPECT_VALUE;
+                continue;
+            case EXPECT_COMMA_OR_END:
+                if (c == ',') {
+                    js->expect = top_is_array(js) ? EXPECT_VALUE : EXPECT_KEY;
+                    continue;
+                }
+                return close_container(js, c);
+            case EXPECT_KEY_OR_END:
+                if (c == '}') {
+                    return close_container(js, c);
+                }
+                /* fall through */
+            case EXPECT_KEY:
+                if (c != '"' || !read_string(js)) {
+                    return stream_fail(js);
+                }
+                js->expect = EXPECT_COLON;
+                return JSON_STREAM_KEY;
+            case EXPECT_VALUE_OR_END:
+                if (c == ']') {
+                    return close_container(js, c);
+                }
+                /* fall through */
+            case EXPECT_VALUE:
+                return read_value(js, c);
+            default:
+                return stream_fail(js);
+        }
+    }
+}
+
+bool json_stream_skip(json_stream_t *js, json_stream_token_t tok) {
+    switch (tok) {
+        case JSON_STREAM_STRING:
+        case JSON_STREAM_NUMBER:
+        case JSON_STREAM_TRUE:
+        case JSON_STREAM_FALSE:
+        case JSON_STREAM_NULL:
+            return true;
+        case JSON_STREAM_OBJECT_START:
+        case JSON_STREAM_ARRAY_START: {
+            uint8_t outer = js->depth - 1;
+            while (js->depth > outer) {
+                tok = json_stream_next(js);
+                if (tok == JSON_STREAM_ERROR || tok == JSON_STREAM_END) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
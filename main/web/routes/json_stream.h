@@ -0,0 +1,95 @@
+/**
+ * @file json_stream.h
+ * @brief Pull tokenizer for JSON request bodies
+ *
+ * Reads the body of a request through a small fixed window as it is
+ * tokenized, so a handler can validate fields as they arrive instead of
+ * receiving the whole body and building a cJSON tree first. The grammar is
+ * checked as it goes (nesting, separators, literals, escapes); values are
+ * handed out one token at a time. A payload already in memory (a WebSocket
+ * frame) is tokenized in place.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include "esp_http_server.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_STREAM_WINDOW    128   // Body bytes received per httpd_req_recv()
+#define JSON_STREAM_TEXT_MAX  128   // Longest key or string kept; longer ones are truncated
+#define JSON_STREAM_MAX_DEPTH 8     // Nested objects/arrays
+
+typedef enum {
+    JSON_STREAM_ERROR,          // Malformed JSON or receive failure (see recv_error)
+    JSON_STREAM_END,            // Body fully consumed after the top-level value
+    JSON_STREAM_OBJECT_START,
+    JSON_STREAM_OBJECT_END,
+    JSON_STREAM_ARRAY_START,
+    JSON_STREAM_ARRAY_END,
+    JSON_STREAM_KEY,            // Object member name, in text
+    JSON_STREAM_STRING,         // In text (unescaped, NUL-terminated)
+    JSON_STREAM_NUMBER,         // In number
+    JSON_STREAM_TRUE,
+    JSON_STREAM_FALSE,
+    JSON_STREAM_NULL,
+} json_stream_token_t;
+
+typedef struct {
+    httpd_req_t *req;
+    size_t remaining;                       // Body bytes not received yet
+    int recv_error;                         // Last httpd_req_recv() error (0: none)
+    char window[JSON_STREAM_WINDOW];
+    const char *data;                       // window, or the payload of json_stream_init_buffer()
+    size_t pos;
+    size_t len;
+    int peeked;                             // Character pushed back (-1: none)
+
+    uint8_t depth;
+    uint16_t in_array;                      // Bit per depth: container is an array
+    uint8_t expect;                         // Parser state (json_stream.c)
+
+    char text[JSON_STREAM_TEXT_MAX + 1];    // Last key or string
+    size_t text_len;
+    bool truncated;                         // text lost characters beyond JSON_STREAM_TEXT_MAX
+    double number;                          // Last number
+} json_stream_t;
+
+/**
+ * @brief Start tokenizing the body of req (req->content_len bytes)
+ */
+void json_stream_init(json_stream_t *js, httpd_req_t *req);
+
+/**
+ * @brief Start tokenizing len bytes at data (kept until the stream is done)
+ */
+void json_stream_init_buffer(json_stream_t *js, const char *data, size_t len);
+
+/**
+ * @brief Next token of the body
+ *
+ * After a JSON_STREAM_ERROR the stream stays in error.
+ */
+json_stream_token_t json_stream_next(json_stream_t *js);
+
+/**
+ * @brief Skip the rest of the value that tok (just returned) starts
+ *
+ * Scalars are complete already; for an object or array the tokens up to its
+ * end are consumed.
+ *
+ * @return false if tok does not start a value or the JSON is malformed
+ */
+bool json_stream_skip(json_stream_t *js, json_stream_token_t tok);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_STREAM_H */
@@ -0,0 +1,115 @@
+#include "lifecycle_routes.h"
+#include "build_config.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include "lifecycle/trace.h"
+#include "lifecycle/state_machine.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "lifecycle_routes";
+
+static const char *kind_name(uint8_t kind)
+{
+    switch (kind) {
+        case LIFECYCLE_TRACE_EVENT: return "event";
+        case LIFECYCLE_TRACE_EXIT:  return "exit";
+        case LIFECYCLE_TRACE_ENTRY: return "entry";
+        case LIFECYCLE_TRACE_STEP:  return "step";
+        default:                    return "unknown";
+    }
+}
+
+/**
+ * GET handler for /api/lifecycle/trace
+ *
+ * Times are milliseconds since boot; durations and queue waits are
+ * milliseconds with microsecond resolution.
+ */
+static esp_err_t lifecycle_trace_get_handler(httpd_req_t *req)
+{
+    lifecycle_trace_record_t *records = malloc(CONFIG_LIFECYCLE_TRACE_DEPTH * sizeof(*records));
+    if (!records) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    size_t count = lifecycle_trace_snapshot(records, CONFIG_LIFECYCLE_TRACE_DEPTH);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *list = root ? cJSON_AddArrayToObject(root, "records") : NULL;
+    if (!list) {
+        cJSON_Delete(root);
+        free(records);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON response");
+        return ESP_FAIL;
+    }
+    cJSON_AddNumberToObject(root, "now_ms", esp_timer_get_time() / 1000.0);
+    cJSON_AddStringToObject(root, "state",
+                            lifecycle_trace_state_name(lifecycle_state_machine_get_current_state()));
+
+    for (size_t i = 0; i < count; i++) {
+        const lifecycle_trace_record_t *rec = &records[i];
+        cJSON *item = cJSON_CreateObject();
+        if (!item) {
+            break;
+        }
+        cJSON_AddNumberToObject(item, "seq", rec->seq);
+        cJSON_AddStringToObject(item, "kind", kind_name(rec->kind));
+        cJSON_AddNumberToObject(item, "at_ms", rec->start_us / 1000.0);
+        cJSON_AddNumberToObject(item, "duration_ms", rec->duration_us / 1000.0);
+        cJSON_AddStringToObject(item, "state", lifecycle_trace_state_name(rec->state));
+        switch (rec->kind) {
+            case LIFECYCLE_TRACE_EVENT:
+                cJSON_AddStringToObject(item, "event", lifecycle_trace_event_name(rec->arg));
+                cJSON_AddNumberToObject(item, "queue_wait_ms", rec->wait_us / 1000.0);
+                break;
+            case LIFECYCLE_TRACE_EXIT:
+                cJSON_AddStringToObject(item, "next_state", lifecycle_trace_state_name(rec->arg));
+                break;
+            case LIFECYCLE_TRACE_ENTRY:
+                cJSON_AddStringToObject(item, "previous_state", lifecycle_trace_state_name(rec->arg));
+                break;
+            case LIFECYCLE_TRACE_STEP:
+                cJSON_AddStringToObject(item, "step", rec->step ? rec->step : "");
+                break;
+        }
+        cJSON_AddItemToArray(list, item);
+    }
+    free(records);
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON string");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+    return ret;
+}
+
+esp_err_t register_lifecycle_routes(httpd_handle_t server)
+{
+    if (!server) {
+        ESP_LOGE(TAG, "Invalid server handle");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_uri_t trace_uri = {
+        .uri = "/api/lifecycle/trace",
+        .method = HTTP_GET,
+        .handler = lifecycle_trace_get_handler,
+        .user_ctx = NULL
+    };
+
+    esp_err_t ret = httpd_register_uri_handler(server, &trace_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register /api/lifecycle/trace handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Lifecycle routes registered successfully");
+    return ESP_OK;
+}
@@ -0,0 +1,14 @@
+#ifndef LIFECYCLE_ROUTES_H
+#define LIFECYCLE_ROUTES_H
+
+#include "esp_http_server.h"
+
+/**
+ * Register the lifecycle state machine trace (GET /api/lifecycle/trace)
+ * 
+ * @param server HTTP server handle
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t register_lifecycle_routes(httpd_handle_t server);
+
+#endif // LIFECYCLE_ROUTES_H
@@ -0,0 +1,209 @@
+#include "loadgen_routes.h"
+#include "receiver/rtp_loadgen.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "loadgen_routes";
+
+// Longest JSON body accepted for a start request
+#define LOADGEN_BODY_MAX 512
+
+static esp_err_t send_json(httpd_req_t *req, cJSON *root)
+{
+    char *json_str = root ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON string");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+    return ret;
+}
+
+/**
+ * GET handler for /api/loadgen
+ *
+ * p99_late_us is null when the 99th percentile fell past the largest
+ * lateness bucket.
+ */
+static esp_err_t loadgen_get_handler(httpd_req_t *req)
+{
+    rtp_loadgen_report_t *report = malloc(sizeof(*report));
+    if (!report) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    rtp_loadgen_get_report(report);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *steps = root ? cJSON_AddArrayToObject(root, "steps") : NULL;
+    if (!steps) {
+        cJSON_Delete(root);
+        free(report);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON response");
+        return ESP_FAIL;
+    }
+#ifdef CONFIG_RTP_LOADGEN
+    cJSON_AddBoolToObject(root, "enabled", true);
+#else
+    cJSON_AddBoolToObject(root, "enabled", false);
+#endif
+    cJSON_AddBoolToObject(root, "running", report->running);
+    cJSON_AddNumberToObject(root, "max_sustained_pps", report->max_sustained_pps);
+
+    const rtp_loadgen_config_t *cfg = &report->config;
+    cJSON *config = cJSON_AddObjectToObject(root, "config");
+    if (config) {
+        cJSON_AddNumberToObject(config, "rate_pps", cfg->rate_pps);
+        cJSON_AddNumberToObject(config, "max_rate_pps", cfg->max_rate_pps);
+        cJSON_AddNumberToObject(config, "frames", cfg->frames);
+        cJSON_AddNumberToObject(config, "step_s", cfg->step_s);
+        cJSON_AddNumberToObject(config, "loss_pct", cfg->loss_pct);
+        cJSON_AddNumberToObject(config, "dup_pct", cfg->dup_pct);
+        cJSON_AddNumberToObject(config, "reorder_pct", cfg->reorder_pct);
+        cJSON_AddNumberToObject(config, "jitter_us", cfg->jitter_us);
+    }
+
+    for (uint8_t i = 0; i < report->steps; i++) {
+        const rtp_loadgen_step_t *st = &report->step[i];
+        cJSON *item = cJSON_CreateObject();
+        if (!item) {
+            break;
+        }
+        cJSON_AddNumberToObject(item, "rate_pps", st->rate_pps);
+        cJSON_AddNumberToObject(item, "frames", st->frames);
+        cJSON_AddNumberToObject(item, "sent", st->sent);
+        cJSON_AddNumberToObject(item, "send_errors", st->send_errors);
+        cJSON_AddNumberToObject(item, "received", st->received);
+        cJSON_AddNumberToObject(item, "lost", st->lost);
+        cJSON_AddNumberToObject(item, "underruns", st->underruns);
+        if (st->p99_late_us == UINT32_MAX) {
+            cJSON_AddNullToObject(item, "p99_late_us");
+        } else {
+            cJSON_AddNumberToObject(item, "p99_late_us", st->p99_late_us);
+        }
+        cJSON_AddBoolToObject(item, "sustained", st->sustained);
+        cJSON_AddItemToArray(steps, item);
+    }
+    free(report);
+    return send_json(req, root);
+}
+
+static uint32_t json_uint(const cJSON *root, const char *name, uint32_t def, uint32_t max)
+{
+    const cJSON *item = cJSON_GetObjectItemCaseSensitive(root, name);
+    if (!cJSON_IsNumber(item) || item->valuedouble < 0) {
+        return def;
+    }
+    return item->valuedouble > (double)max ? max : (uint32_t)item->valuedouble;
+}
+
+/**
+ * POST handler for /api/loadgen
+ *
+ * {"action":"start","rate_pps":500,"max_rate_pps":8000,"frames":0,"step_s":10,
+ *  "loss_pct":0,"dup_pct":0,"reorder_pct":0,"jitter_us":0} or {"action":"stop"}.
+ * Missing fields take the values shown (frames 0: sized for real-time
+ * audio at each rate).
+ */
+static esp_err_t loadgen_post_handler(httpd_req_t *req)
+{
+    if (req->content_len == 0 || req->content_len > LOADGEN_BODY_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or oversized body");
+        return ESP_FAIL;
+    }
+    char body[LOADGEN_BODY_MAX + 1];
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, body + received, req->content_len - received);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(req);
+            }
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    body[received] = '\0';
+
+    cJSON *root = cJSON_Parse(body);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON payload");
+        return ESP_FAIL;
+    }
+    const cJSON *action = cJSON_GetObjectItemCaseSensitive(root, "action");
+    if (cJSON_IsString(action) && strcmp(action->valuestring, "stop") == 0) {
+        cJSON_Delete(root);
+        rtp_loadgen_stop();
+        cJSON *resp = cJSON_CreateObject();
+        if (resp) {
+            cJSON_AddBoolToObject(resp, "success", true);
+        }
+        return send_json(req, resp);
+    }
+
+    rtp_loadgen_config_t cfg = {
+        .rate_pps = json_uint(root, "rate_pps", 500, 100000),
+        .max_rate_pps = json_uint(root, "max_rate_pps", 0, 100000),
+        .frames = (uint16_t)json_uint(root, "frames", 0, UINT16_MAX),
+        .step_s = (uint16_t)json_uint(root, "step_s", 10, 3600),
+        .loss_pct = (uint8_t)json_uint(root, "loss_pct", 0, 100),
+        .dup_pct = (uint8_t)json_uint(root, "dup_pct", 0, 100),
+        .reorder_pct = (uint8_t)json_uint(root, "reorder_pct", 0, 100),
+        .jitter_us = json_uint(root, "jitter_us", 0, 1000000),
+    };
+    cJSON_Delete(root);
+
+    esp_err_t err = rtp_loadgen_start(&cfg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Load run not started: %s", esp_err_to_name(err));
+        httpd_resp_send_err(req, err == ESP_ERR_NO_MEM ? HTTPD_500_INTERNAL_SERVER_ERROR : HTTPD_400_BAD_REQUEST,
+                            err == ESP_ERR_NOT_SUPPORTED ? "Load generator not built in (CONFIG_RTP_LOADGEN)" :
+                            err == ESP_ERR_INVALID_STATE ? "Not in receiver mode, or a run is in progress" :
+                            "Could not start the load generator");
+        return ESP_FAIL;
+    }
+    cJSON *resp = cJSON_CreateObject();
+    if (resp) {
+        cJSON_AddBoolToObject(resp, "success", true);
+    }
+    return send_json(req, resp);
+}
+
+esp_err_t register_loadgen_routes(httpd_handle_t server)
+{
+    if (!server) {
+        ESP_LOGE(TAG, "Invalid server handle");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_uri_t get_uri = {
+        .uri       = "/api/loadgen",
+        .method    = HTTP_GET,
+        .handler   = loadgen_get_handler,
+        .user_ctx  = NULL
+    };
+    esp_err_t ret = httpd_register_uri_handler(server, &get_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/loadgen: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t post_uri = {
+        .uri       = "/api/loadgen",
+        .method    = HTTP_POST,
+        .handler   = loadgen_post_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &post_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/loadgen: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,17 @@
+#ifndef LOADGEN_ROUTES_H
+#define LOADGEN_ROUTES_H
+
+#include "esp_http_server.h"
+
+/**
+ * Register the synthetic RTP load generator (GET and POST /api/loadgen)
+ *
+ * GET returns the current or last run's per-step report; POST starts a run
+ * with the parameters in its JSON body, or stops one with {"action":"stop"}.
+ *
+ * @param server HTTP server handle
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t register_loadgen_routes(httpd_handle_t server);
+
+#endif // LOADGEN_ROUTES_H
@@ -1,14 +1,55 @@
 #include "logs_routes.h"
 #include "route_helpers.h"
 #include "logging/log_buffer.h"
+#include "logging/event_trace.h"
 #include <esp_log.h>
 #include <cJSON.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <strings.h>
 
 static const char *TAG = "logs_routes";
 
+#define LOGS_TAIL_CHUNK      512     // Stack buffer per chunk; longer than any log line
+#define LOGS_TAIL_DEFAULT    2048    // Bytes of backlog sent to a client without a cursor
+
+/**
+ * @brief Whether a log line passes a display level filter
+ *
+ * Lines without an ESP-IDF level prefix ("X (") are always shown.
+ */
+static bool line_passes_level(const char *line, size_t len, esp_log_level_t min_level)
+{
+    if (len < 3 || line[1] != ' ' || line[2] != '(') {
+        return true;
+    }
+    switch (line[0]) {
+        case 'E': return ESP_LOG_ERROR <= min_level;
+        case 'W': return ESP_LOG_WARN <= min_level;
+        case 'I': return ESP_LOG_INFO <= min_level;
+        case 'D': return ESP_LOG_DEBUG <= min_level;
+        case 'V': return ESP_LOG_VERBOSE <= min_level;
+        default:  return true;
+    }
+}
+
+static esp_log_level_t parse_level(const char *name, esp_log_level_t fallback)
+{
+    if (strcasecmp(name, "ERROR") == 0) {
+        return ESP_LOG_ERROR;
+    } else if (strcasecmp(name, "WARN") == 0) {
+        return ESP_LOG_WARN;
+    } else if (strcasecmp(name, "INFO") == 0) {
+        return ESP_LOG_INFO;
+    } else if (strcasecmp(name, "DEBUG") == 0) {
+        return ESP_LOG_DEBUG;
+    } else if (strcasecmp(name, "VERBOSE") == 0) {
+        return ESP_LOG_VERBOSE;
+    }
+    return fallback;
+}
+
 /**
  * @brief Handler for GET /api/logs
  * 
@@ -26,8 +67,11 @@ static const char *TAG = "logs_routes";
  *   "overflow": true/false,
  *   "buffer_used": 1234,
  *   "buffer_size": 8192,
- *   "capture_level": "INFO"
+ *   "capture_level": "INFO",
+ *   "cursor": 123456
  * }
+ *
+ * "cursor" can be passed to GET /api/logs/tail to follow the log from here.
  */
 static esp_err_t logs_get_handler(httpd_req_t *req)
 {
@@ -59,35 +103,14 @@ static esp_err_t logs_get_handler(httpd_req_t *req)
     // Parse 'level' parameter for display filtering (ERROR, WARN, INFO, DEBUG, VERBOSE)
     esp_log_level_t display_min_level = ESP_LOG_VERBOSE;  // Default to show all
     if (httpd_query_key_value(query_buf, "level", param_buf, sizeof(param_buf)) == ESP_OK) {
-        if (strcasecmp(param_buf, "ERROR") == 0) {
-            display_min_level = ESP_LOG_ERROR;
-        } else if (strcasecmp(param_buf, "WARN") == 0) {
-            display_min_level = ESP_LOG_WARN;
-        } else if (strcasecmp(param_buf, "INFO") == 0) {
-            display_min_level = ESP_LOG_INFO;
-        } else if (strcasecmp(param_buf, "DEBUG") == 0) {
-            display_min_level = ESP_LOG_DEBUG;
-        } else if (strcasecmp(param_buf, "VERBOSE") == 0) {
-            display_min_level = ESP_LOG_VERBOSE;
-        }
+        display_min_level = parse_level(param_buf, ESP_LOG_VERBOSE);
         ESP_LOGI(TAG, "Display filter level set to: %d", display_min_level);
     }
 
     // Parse 'capture_level' parameter to change what gets stored in buffer
     if (httpd_query_key_value(query_buf, "capture_level", param_buf, sizeof(param_buf)) == ESP_OK) {
-        esp_log_level_t new_capture_level = ESP_LOG_INFO;  // Default
-        if (strcasecmp(param_buf, "ERROR") == 0) {
-            new_capture_level = ESP_LOG_ERROR;
-        } else if (strcasecmp(param_buf, "WARN") == 0) {
-            new_capture_level = ESP_LOG_WARN;
-        } else if (strcasecmp(param_buf, "INFO") == 0) {
-            new_capture_level = ESP_LOG_INFO;
-        } else if (strcasecmp(param_buf, "DEBUG") == 0) {
-            new_capture_level = ESP_LOG_DEBUG;
-        } else if (strcasecmp(param_buf, "VERBOSE") == 0) {
-            new_capture_level = ESP_LOG_VERBOSE;
-        }
-        
+        esp_log_level_t new_capture_level = parse_level(param_buf, ESP_LOG_INFO);
+
         // Set the new capture level
         esp_err_t err = log_buffer_set_min_level(new_capture_level);
         if (err == ESP_OK) {
@@ -106,6 +129,7 @@ static esp_err_t logs_get_handler(httpd_req_t *req)
     size_t buffer_size = log_buffer_get_size();
     bool has_overflowed = log_buffer_has_overflowed();
     esp_log_level_t current_capture_level = log_buffer_get_min_level();
+    uint64_t cursor = log_buffer_get_cursor();
 
     // Limit read size to what's actually available
     if (max_read_size > buffer_used) {
@@ -145,20 +169,7 @@ static esp_err_t logs_get_handler(httpd_req_t *req)
                 *line_end = '\0';  // Temporarily null-terminate the line
                 
                 // Check if this line should be displayed based on level
-                bool should_display = true;
-                
-                // Check for ESP-IDF log level prefixes (E/W/I/D/V)
-                if (line_start[0] == 'E' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_ERROR >= display_min_level);
-                } else if (line_start[0] == 'W' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_WARN >= display_min_level);
-                } else if (line_start[0] == 'I' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_INFO >= display_min_level);
-                } else if (line_start[0] == 'D' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_DEBUG >= display_min_level);
-                } else if (line_start[0] == 'V' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_VERBOSE >= display_min_level);
-                }
+                bool should_display = line_passes_level(line_start, strlen(line_start), display_min_level);
                 
                 // Add line to filtered output if it passes the filter
                 if (should_display) {
@@ -176,19 +187,7 @@ static esp_err_t logs_get_handler(httpd_req_t *req)
             
             // Handle last line if it doesn't end with newline
             if (*line_start != '\0') {
-                bool should_display = true;
-                
-                if (line_start[0] == 'E' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_ERROR >= display_min_level);
-                } else if (line_start[0] == 'W' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_WARN >= display_min_level);
-                } else if (line_start[0] == 'I' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_INFO >= display_min_level);
-                } else if (line_start[0] == 'D' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_DEBUG >= display_min_level);
-                } else if (line_start[0] == 'V' && line_start[1] == ' ' && line_start[2] == '(') {
-                    should_display = (ESP_LOG_VERBOSE >= display_min_level);
-                }
+                bool should_display = line_passes_level(line_start, strlen(line_start), display_min_level);
                 
                 if (should_display) {
                     size_t line_len = strlen(line_start);
@@ -271,6 +270,7 @@ static esp_err_t logs_get_handler(httpd_req_t *req)
             break;
     }
     cJSON_AddStringToObject(root, "capture_level", capture_level_str);
+    cJSON_AddNumberToObject(root, "cursor", (double)cursor);
 
     // Convert to string and send
     char *json_str = cJSON_Print(root);
@@ -289,6 +289,195 @@ static esp_err_t logs_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief Handler for GET /api/logs/tail
+ *
+ * Streams the log history from a byte cursor as chunked text/plain, straight
+ * from the log ring through one stack buffer: no heap, no JSON. A client
+ * polls with the X-Log-Cursor of its previous response and gets only the
+ * lines written since.
+ *
+ * Query parameters:
+ * - cursor: Stream offset to start at (default: the last LOGS_TAIL_DEFAULT bytes)
+ * - level: Only lines at this level or more severe (default: all)
+ *
+ * Response headers:
+ * - X-Log-Cursor: Cursor for the next request
+ * - X-Log-Start: Where this response starts; above the cursor sent when older
+ *   lines were overwritten (or the buffer cleared) in between
+ */
+static esp_err_t logs_tail_handler(httpd_req_t *req)
+{
+    char query_buf[128] = {0};
+    char param_buf[32] = {0};
+    httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf));
+
+    uint64_t end = log_buffer_get_cursor();
+    uint64_t cursor;
+    bool mid_line = false;
+    if (httpd_query_key_value(query_buf, "cursor", param_buf, sizeof(param_buf)) == ESP_OK) {
+        cursor = strtoull(param_buf, NULL, 10);
+    } else {
+        size_t used = log_buffer_get_used();
+        cursor = end - (used < LOGS_TAIL_DEFAULT ? used : LOGS_TAIL_DEFAULT);
+        mid_line = used > LOGS_TAIL_DEFAULT;
+    }
+    uint64_t requested = cursor;
+
+    esp_log_level_t display_min_level = ESP_LOG_VERBOSE;
+    if (httpd_query_key_value(query_buf, "level", param_buf, sizeof(param_buf)) == ESP_OK) {
+        display_min_level = parse_level(param_buf, ESP_LOG_VERBOSE);
+    }
+
+    char chunk[LOGS_TAIL_CHUNK];
+
+    // Resolve the start first (a stale cursor snaps to the oldest byte held), so
+    // both cursors can go out as headers ahead of the body
+    size_t len = 0;
+    if (cursor != end) {
+        len = log_buffer_read_from(&cursor, chunk, sizeof(chunk));
+        cursor -= len;
+    }
+
+    // Starting somewhere other than where the client left off, in a ring that has
+    // wrapped, lands inside a line: begin at the next one
+    if (len > 0 && (mid_line || cursor != requested) && log_buffer_has_overflowed()) {
+        char *nl = memchr(chunk, '\n', len);
+        if (nl) {
+            size_t skip = (size_t)(nl + 1 - chunk);
+            memmove(chunk, nl + 1, len - skip);
+            len -= skip;
+            cursor += skip;
+        }
+    }
+    if (cursor + len > end) {
+        end = cursor + len;
+    }
+
+    char start_hdr[24];
+    char end_hdr[24];
+    snprintf(start_hdr, sizeof(start_hdr), "%llu", (unsigned long long)cursor);
+    snprintf(end_hdr, sizeof(end_hdr), "%llu", (unsigned long long)end);
+    httpd_resp_set_type(req, "text/plain; charset=utf-8");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(req, "X-Log-Start", start_hdr);
+    httpd_resp_set_hdr(req, "X-Log-Cursor", end_hdr);
+
+    while (cursor < end) {
+        if (len == 0) {
+            size_t want = end - cursor < sizeof(chunk) ? (size_t)(end - cursor) : sizeof(chunk);
+            len = log_buffer_read_from(&cursor, chunk, want);
+            cursor -= len;
+            if (len == 0) {
+                break;
+            }
+        }
+        if (cursor + len > end) {
+            len = (size_t)(end - cursor);
+        }
+
+        // Hold back a trailing partial line for the next chunk, so each line is
+        // filtered whole
+        size_t send_len = len;
+        if (cursor + len < end) {
+            while (send_len > 0 && chunk[send_len - 1] != '\n') {
+                send_len--;
+            }
+            if (send_len == 0) {
+                send_len = len;
+            }
+        }
+        cursor += send_len;
+
+        esp_err_t ret = ESP_OK;
+        if (display_min_level >= ESP_LOG_VERBOSE) {
+            ret = httpd_resp_send_chunk(req, chunk, send_len);
+        } else {
+            // Compact the passing lines in place, then send them together
+            size_t out = 0;
+            size_t pos = 0;
+            while (pos < send_len) {
+                const char *nl = memchr(chunk + pos, '\n', send_len - pos);
+                size_t line_len = nl ? (size_t)(nl - (chunk + pos)) + 1 : send_len - pos;
+                if (line_passes_level(chunk + pos, line_len, display_min_level)) {
+                    memmove(chunk + out, chunk + pos, line_len);
+                    out += line_len;
+                }
+                pos += line_len;
+            }
+            if (out > 0) {
+                ret = httpd_resp_send_chunk(req, chunk, out);
+            }
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGD(TAG, "Log tail client went away");
+            return ESP_FAIL;
+        }
+        len = 0;
+    }
+
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * @brief Handler for GET /api/trace
+ *
+ * Sends the glitch trace (see event_trace.h) as a binary download: the
+ * ring as frozen by the last underrun or overflow, or with live=1 as it is
+ * now. decode_trace.py reads the file.
+ */
+static esp_err_t trace_get_handler(httpd_req_t *req)
+{
+    char query_buf[32] = {0};
+    char param_buf[8] = {0};
+    bool live = false;
+    if (httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf)) == ESP_OK &&
+        httpd_query_key_value(query_buf, "live", param_buf, sizeof(param_buf)) == ESP_OK) {
+        live = strcmp(param_buf, "1") == 0 || strcmp(param_buf, "true") == 0;
+    }
+
+#ifdef CONFIG_EVENT_TRACE
+    event_trace_record_t *live_buf = NULL;
+    if (live) {
+        live_buf = malloc(sizeof(event_trace_record_t) * CONFIG_EVENT_TRACE_DEPTH);
+        if (!live_buf) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+            return ESP_FAIL;
+        }
+    }
+
+    event_trace_header_t header;
+    const event_trace_record_t *records = NULL;
+    if (!event_trace_read(live, &header, &records, live_buf)) {
+        free(live_buf);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No trace frozen yet");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       live ? "attachment; filename=\"trace-live.bin\"" : "attachment; filename=\"trace.bin\"");
+    esp_err_t ret = httpd_resp_send_chunk(req, (const char *)&header, sizeof(header));
+    if (ret == ESP_OK && header.count > 0) {
+        ret = httpd_resp_send_chunk(req, (const char *)records, sizeof(*records) * header.count);
+    }
+    if (!live) {
+        event_trace_release();
+    }
+    free(live_buf);
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Trace client went away");
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+#else
+    (void)live;
+    httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Glitch trace disabled (CONFIG_EVENT_TRACE)");
+    return ESP_FAIL;
+#endif
+}
+
 /**
  * @brief Register logs-related HTTP routes
  */
@@ -312,6 +501,32 @@ esp_err_t register_logs_routes(httpd_handle_t server)
         return ret;
     }
 
+    httpd_uri_t logs_tail_uri = {
+        .uri       = "/api/logs/tail",
+        .method    = HTTP_GET,
+        .handler   = logs_tail_handler,
+        .user_ctx  = NULL
+    };
+
+    ret = httpd_register_uri_handler(server, &logs_tail_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/logs/tail: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t trace_get_uri = {
+        .uri       = "/api/trace",
+        .method    = HTTP_GET,
+        .handler   = trace_get_handler,
+        .user_ctx  = NULL
+    };
+
+    ret = httpd_register_uri_handler(server, &trace_get_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/trace: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
     ESP_LOGI(TAG, "Registered logs routes");
     return ESP_OK;
 }
\ No newline at end of file
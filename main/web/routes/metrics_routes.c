@@ -0,0 +1,331 @@
+#include "metrics_routes.h"
+#include "metrics.h"
+#include "metrics_profile.h"
+#include "lifecycle/task_stats.h"
+#include "audio_arena.h"
+#include "esp_private/esp_clk.h"
+#include "cJSON.h"
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "metrics_routes";
+
+#define METRICS_CHUNK_SIZE 1024   // Lines are batched into chunks of this size
+#define PROFILE_MAX_STAGES 24     // Every profiled stage the firmware defines, with room
+
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    char buf[METRICS_CHUNK_SIZE];
+} metrics_chunk_t;
+
+static esp_err_t chunk_flush(metrics_chunk_t *chunk)
+{
+    esp_err_t ret = ESP_OK;
+    if (chunk->len > 0) {
+        ret = httpd_resp_send_chunk(chunk->req, chunk->buf, chunk->len);
+        chunk->len = 0;
+    }
+    return ret;
+}
+
+static esp_err_t chunk_write(void *ctx, const char *data, size_t len)
+{
+    metrics_chunk_t *chunk = (metrics_chunk_t *)ctx;
+    if (chunk->len + len > sizeof(chunk->buf)) {
+        esp_err_t ret = chunk_flush(chunk);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    // A line never exceeds the buffer (the exporter caps lines well below it)
+    memcpy(chunk->buf + chunk->len, data, len);
+    chunk->len += len;
+    return ESP_OK;
+}
+
+/**
+ * GET handler for /metrics
+ *
+ * Reading the registry is lock-free, so a scrape never stalls the audio path.
+ */
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    metrics_chunk_t chunk = { .req = req, .len = 0 };
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    esp_err_t ret = metrics_write_prometheus(chunk_write, &chunk);
+    if (ret == ESP_OK) {
+        ret = chunk_flush(&chunk);
+    }
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    } else {
+        ESP_LOGW(TAG, "Scrape aborted: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t send_json(httpd_req_t *req, cJSON *root)
+{
+    char *json_str = root ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON string");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
+    return ret;
+}
+
+/**
+ * GET handler for /api/profile
+ *
+ * Per-stage cycle counts since boot or the last reset. histogram[i] counts
+ * samples of 2^(i-1) to 2^i - 1 cycles (histogram[0]: zero), trimmed after
+ * the last non-empty bucket. cpu_mhz is the clock now, not necessarily the
+ * one every sample ran at.
+ */
+static esp_err_t profile_get_handler(httpd_req_t *req)
+{
+    metrics_profile_stats_t *stats = malloc(PROFILE_MAX_STAGES * sizeof(*stats));
+    if (!stats) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    size_t count = metrics_profile_snapshot(stats, PROFILE_MAX_STAGES);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *list = root ? cJSON_AddArrayToObject(root, "stages") : NULL;
+    if (!list) {
+        cJSON_Delete(root);
+        free(stats);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON response");
+        return ESP_FAIL;
+    }
+#ifdef CONFIG_METRICS_PROFILER
+    cJSON_AddBoolToObject(root, "enabled", true);
+#else
+    cJSON_AddBoolToObject(root, "enabled", false);
+#endif
+    cJSON_AddNumberToObject(root, "cpu_mhz", esp_clk_cpu_freq() / 1000000);
+
+    for (size_t i = 0; i < count; i++) {
+        const metrics_profile_stats_t *st = &stats[i];
+        cJSON *item = cJSON_CreateObject();
+        if (!item) {
+            break;
+        }
+        cJSON_AddStringToObject(item, "name", st->name);
+        cJSON_AddStringToObject(item, "help", st->help ? st->help : "");
+        cJSON_AddNumberToObject(item, "count", st->count);
+        cJSON_AddNumberToObject(item, "min_cycles", st->min_cycles);
+        cJSON_AddNumberToObject(item, "avg_cycles", st->avg_cycles);
+        cJSON_AddNumberToObject(item, "p99_cycles", st->p99_cycles);
+        cJSON_AddNumberToObject(item, "max_cycles", st->max_cycles);
+        int used = METRICS_PROFILE_BUCKETS;
+        while (used > 0 && st->buckets[used - 1] == 0) {
+            used--;
+        }
+        cJSON *hist = cJSON_AddArrayToObject(item, "histogram");
+        for (int b = 0; hist && b < used; b++) {
+            cJSON_AddItemToArray(hist, cJSON_CreateNumber(st->buckets[b]));
+        }
+        cJSON_AddItemToArray(list, item);
+    }
+    free(stats);
+    return send_json(req, root);
+}
+
+/**
+ * POST handler for /api/profile/reset
+ *
+ * Stages start over from their next sample.
+ */
+static esp_err_t profile_reset_post_handler(httpd_req_t *req)
+{
+    metrics_profile_reset();
+    cJSON *root = cJSON_CreateObject();
+    if (root) {
+        cJSON_AddBoolToObject(root, "success", true);
+    }
+    return send_json(req, root);
+}
+
+/**
+ * GET handler for /api/tasks
+ *
+ * The last task snapshot: per-core load and, per task, its share of one core
+ * over the period (per mille), affinity (-1: either core), priority and least
+ * free stack.
+ */
+static esp_err_t tasks_get_handler(httpd_req_t *req)
+{
+    task_stats_snapshot_t *snap = malloc(sizeof(*snap));
+    if (!snap) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    bool have = task_stats_get(snap);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        free(snap);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON response");
+        return ESP_FAIL;
+    }
+#ifdef CONFIG_TASK_STATS
+    cJSON_AddBoolToObject(root, "enabled", true);
+#else
+    cJSON_AddBoolToObject(root, "enabled", false);
+#endif
+    if (have) {
+        cJSON_AddNumberToObject(root, "period_ms", snap->period_ms);
+        cJSON_AddBoolToObject(root, "truncated", snap->truncated);
+        cJSON *cores = cJSON_AddArrayToObject(root, "core_load_permille");
+        for (int c = 0; cores && c < SOC_CPU_CORES_NUM; c++) {
+            cJSON_AddItemToArray(cores, cJSON_CreateNumber(snap->core_load_permille[c]));
+        }
+        cJSON *list = cJSON_AddArrayToObject(root, "tasks");
+        for (uint8_t i = 0; list && i < snap->task_count; i++) {
+            const task_stats_task_t *t = &snap->tasks[i];
+            cJSON *item = cJSON_CreateObject();
+            if (!item) {
+                break;
+            }
+            cJSON_AddStringToObject(item, "name", t->name);
+            cJSON_AddNumberToObject(item, "core", t->core == TASK_STATS_NO_CORE ? -1 : t->core);
+            cJSON_AddNumberToObject(item, "priority", t->priority);
+            cJSON_AddNumberToObject(item, "load_permille", t->load_permille);
+            cJSON_AddNumberToObject(item, "stack_free_bytes", t->stack_free_bytes);
+            cJSON_AddItemToArray(list, item);
+        }
+    }
+    free(snap);
+    return send_json(req, root);
+}
+
+/**
+ * GET handler for /api/memory
+ *
+ * Audio arena use (bytes per buffer kind, largest block left, heap fallbacks),
+ * the internal heap outside it with its fragmentation, and PSRAM (size 0
+ * without).
+ */
+static esp_err_t memory_get_handler(httpd_req_t *req)
+{
+    audio_arena_stats_t stats;
+    audio_arena_get_stats(&stats);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create JSON response");
+        return ESP_FAIL;
+    }
+    cJSON *arena = cJSON_AddObjectToObject(root, "arena");
+    if (arena) {
+        cJSON_AddNumberToObject(arena, "size", stats.size);
+        cJSON_AddNumberToObject(arena, "used", stats.used);
+        cJSON_AddNumberToObject(arena, "free", stats.size - stats.used);
+        cJSON_AddNumberToObject(arena, "peak_used", stats.peak_used);
+        cJSON_AddNumberToObject(arena, "largest_free", stats.largest_free);
+        cJSON_AddNumberToObject(arena, "blocks", stats.blocks);
+        cJSON_AddNumberToObject(arena, "fallbacks", stats.fallbacks);
+        cJSON_AddNumberToObject(arena, "failures", stats.failures);
+        cJSON *kinds = cJSON_AddObjectToObject(arena, "kinds");
+        for (int k = 0; kinds && k < AUDIO_ARENA_KIND_COUNT; k++) {
+            cJSON_AddNumberToObject(kinds, audio_arena_kind_name((audio_arena_kind_t)k), stats.kind_bytes[k]);
+        }
+    }
+    cJSON *heap = cJSON_AddObjectToObject(root, "heap_internal");
+    if (heap) {
+        cJSON_AddNumberToObject(heap, "free", stats.heap_internal_free);
+        cJSON_AddNumberToObject(heap, "largest_free", stats.heap_internal_largest_free);
+        cJSON_AddNumberToObject(heap, "fragmentation_pct", stats.heap_internal_frag_pct);
+    }
+    cJSON *psram = cJSON_AddObjectToObject(root, "psram");
+    if (psram) {
+        cJSON_AddNumberToObject(psram, "size", stats.psram_size);
+        cJSON_AddNumberToObject(psram, "free", stats.psram_free);
+        cJSON_AddNumberToObject(psram, "largest_free", stats.psram_largest_free);
+    }
+    return send_json(req, root);
+}
+
+esp_err_t register_metrics_routes(httpd_handle_t server)
+{
+    if (!server) {
+        ESP_LOGE(TAG, "Invalid server handle");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_uri_t metrics_uri = {
+        .uri       = "/metrics",
+        .method    = HTTP_GET,
+        .handler   = metrics_get_handler,
+        .user_ctx  = NULL
+    };
+
+    esp_err_t ret = httpd_register_uri_handler(server, &metrics_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /metrics: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t profile_uri = {
+        .uri       = "/api/profile",
+        .method    = HTTP_GET,
+        .handler   = profile_get_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &profile_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/profile: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t profile_reset_uri = {
+        .uri       = "/api/profile/reset",
+        .method    = HTTP_POST,
+        .handler   = profile_reset_post_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &profile_reset_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register POST /api/profile/reset: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t tasks_uri = {
+        .uri       = "/api/tasks",
+        .method    = HTTP_GET,
+        .handler   = tasks_get_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &tasks_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/tasks: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    httpd_uri_t memory_uri = {
+        .uri       = "/api/memory",
+        .method    = HTTP_GET,
+        .handler   = memory_get_handler,
+        .user_ctx  = NULL
+    };
+    ret = httpd_register_uri_handler(server, &memory_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /api/memory: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Metrics routes registered successfully");
+    return ESP_OK;
+}
@@ -0,0 +1,20 @@
+#ifndef METRICS_ROUTES_H
+#define METRICS_ROUTES_H
+
+#include <esp_http_server.h>
+
+/**
+ * @brief Register the Prometheus scrape endpoint (GET /metrics), the
+ *        hot-path profiler (GET /api/profile, POST /api/profile/reset) and
+ *        the task snapshot (GET /api/tasks)
+ *
+ * Serves every metric in the metrics registry in Prometheus text format, the
+ * per-stage cycle histograms of CONFIG_METRICS_PROFILER and the per-task load
+ * and stack figures of CONFIG_TASK_STATS as JSON.
+ *
+ * @param server HTTP server handle
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t register_metrics_routes(httpd_handle_t server);
+
+#endif // METRICS_ROUTES_H
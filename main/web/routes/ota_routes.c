@@ -1,5 +1,6 @@
 #include "ota_routes.h"
 #include "ota/ota_manager.h"
+#include "route_helpers.h"
 #include "version.h"
 #include "esp_log.h"
 #include "cJSON.h"
@@ -30,6 +31,12 @@ static esp_err_t ota_upload_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
+    // The upload is received and flashed for tens of seconds; the worker runs this
+    // handler again from the top, headers included
+    if (!route_async_in_worker()) {
+        return route_async_submit(req, ota_upload_handler);
+    }
+
     // Check if OTA is already in progress
     // Note: We allow new updates if previous state was SUCCESS or ERROR
     ota_state_t current_state = ota_manager_get_state();
@@ -83,65 +90,85 @@ static esp_err_t ota_upload_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    // Allocate buffer for receiving data
-    const size_t buffer_size = 4096;
-    uint8_t *buffer = malloc(buffer_size);
-    if (!buffer) {
-        ESP_LOGE(TAG, "Failed to allocate OTA buffer");
+    // Receive into one buffer while the writer task flashes the previous one
+    err = ota_manager_pipeline_begin();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start OTA writer: 0x%x", err);
         ota_manager_abort();
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
         return ESP_FAIL;
     }
 
     size_t received = 0;
-    int remaining = content_len;
+    size_t remaining = content_len;
     bool ota_failed = false;
-
-    // Receive and write firmware data in chunks
-    while (remaining > 0) {
-        // Receive chunk
-        int recv_len = httpd_req_recv(req, (char *)buffer,
-                                     remaining < buffer_size ? remaining : buffer_size);
-        
-        if (recv_len < 0) {
-            if (recv_len == HTTPD_SOCK_ERR_TIMEOUT) {
-                ESP_LOGE(TAG, "Socket timeout during OTA upload");
-                httpd_resp_send_408(req);
-            } else {
-                ESP_LOGE(TAG, "Failed to receive data: %d", recv_len);
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive data");
-            }
+    bool responded = false;
+    uint8_t last_progress = 0;
+
+    // Receive and write firmware data in sector-aligned chunks
+    while (remaining > 0 && !ota_failed) {
+        size_t capacity = 0;
+        uint8_t *buffer = ota_manager_pipeline_get_buffer(&capacity);
+        if (!buffer) {
             ota_failed = true;
             break;
         }
 
-        // Write to OTA partition
-        err = ota_manager_write(buffer, recv_len);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to write OTA data: 0x%x", err);
-            httpd_resp_set_status(req, "500 Internal Server Error");
-            httpd_resp_set_type(req, "application/json");
-            char error_msg[128];
-            snprintf(error_msg, sizeof(error_msg),
-                    "{\"error\":\"Failed to write OTA data: %s\"}", esp_err_to_name(err));
-            httpd_resp_sendstr(req, error_msg);
+        // Fill the whole buffer (httpd_req_recv returns what one read gives)
+        size_t want = remaining < capacity ? remaining : capacity;
+        size_t filled = 0;
+        while (filled < want) {
+            int recv_len = httpd_req_recv(req, (char *)buffer + filled, want - filled);
+            if (recv_len <= 0) {
+                if (recv_len == HTTPD_SOCK_ERR_TIMEOUT) {
+                    ESP_LOGE(TAG, "Socket timeout during OTA upload");
+                    httpd_resp_send_408(req);
+                } else {
+                    ESP_LOGE(TAG, "Failed to receive data: %d", recv_len);
+                    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive data");
+                }
+                ota_failed = true;
+                responded = true;
+                break;
+            }
+            filled += recv_len;
+        }
+        if (ota_failed) {
+            break;  // The partial buffer is not written; pipeline_end frees it
+        }
+
+        if (ota_manager_pipeline_submit(buffer, filled) != ESP_OK) {
             ota_failed = true;
             break;
         }
 
-        received += recv_len;
-        remaining -= recv_len;
+        received += filled;
+        remaining -= filled;
 
         // Log progress every 10%
         uint8_t progress = (received * 100) / content_len;
-        static uint8_t last_progress = 0;
         if (progress >= last_progress + 10) {
             ESP_LOGI(TAG, "OTA progress: %d%% (%zu/%zu bytes)", progress, received, content_len);
             last_progress = progress;
         }
     }
 
-    free(buffer);
+    // Drains the writer; reports a flash error even if the receive finished
+    err = ota_manager_pipeline_end();
+    if (err != ESP_OK) {
+        ota_failed = true;
+    } else if (ota_failed && !responded) {
+        err = ESP_ERR_TIMEOUT;  // No buffer came back within the OTA timeout
+    }
+    if (ota_failed && !responded) {
+        ESP_LOGE(TAG, "Failed to write OTA data: 0x%x", err);
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_set_type(req, "application/json");
+        char error_msg[128];
+        snprintf(error_msg, sizeof(error_msg),
+                "{\"error\":\"Failed to write OTA data: %s\"}", esp_err_to_name(err));
+        httpd_resp_sendstr(req, error_msg);
+    }
 
     // Handle completion or failure
     if (ota_failed) {
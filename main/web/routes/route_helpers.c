@@ -5,14 +5,31 @@
 
 #include "route_helpers.h"
 #include "esp_log.h"
+#include "log_rate.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "wifi_manager.h"
 #include <string.h>
 #include <stdlib.h>
 #include "visualizer_task.h"
+#include "build_config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 static const char *TAG = "route_helpers";
 
+// Async handler workers: same stack as the HTTP server task, whose handlers they run
+#define ROUTE_ASYNC_STACK 6144
+
+typedef struct {
+    httpd_req_t *req;                         // Async copy, owned by the worker
+    esp_err_t (*handler)(httpd_req_t *req);
+} route_async_job_t;
+
+static QueueHandle_t s_async_queue = NULL;
+static TaskHandle_t s_async_workers[CONFIG_WEB_ASYNC_WORKERS];
+
 /**
  * Chunked sending of HTML with placeholder replacement
  * This function sends HTML in chunks to avoid large memory allocations
@@ -154,6 +171,34 @@ esp_err_t send_html_chunked(httpd_req_t *req, const char* html_start, size_t htm
     return ret;
 }
 
+/**
+ * Chunked sending of static content straight from flash
+ * Content type and any extra headers are the caller's
+ */
+esp_err_t send_static_chunked(httpd_req_t *req, const uint8_t *data_start, size_t data_size)
+{
+    // Chunks are sent from the embedded data in place; no copy is made
+    #define STATIC_CHUNK_SIZE 4096
+
+    size_t offset = 0;
+    esp_err_t ret = ESP_OK;
+
+    while (offset < data_size && ret == ESP_OK) {
+        size_t chunk_size = (data_size - offset > STATIC_CHUNK_SIZE) ? STATIC_CHUNK_SIZE : (data_size - offset);
+        ret = httpd_resp_send_chunk(req, (const char *)data_start + offset, chunk_size);
+        offset += chunk_size;
+    }
+
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    } else {
+        ESP_LOGW(TAG, "Static send stopped at %zu of %zu bytes", offset, data_size);
+    }
+
+    #undef STATIC_CHUNK_SIZE
+    return ret;
+}
+
 /**
  * URL decode a string (application/x-www-form-urlencoded)
  * Converts '+' to space and '%XX' hex sequences to actual characters
@@ -194,4 +239,87 @@ esp_err_t url_decode(const char *src, char *dst, size_t dst_size)
     
     *dst_ptr = '\0';
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+static void route_async_worker(void *arg)
+{
+    (void)arg;
+    route_async_job_t job;
+    for (;;) {
+        if (xQueueReceive(s_async_queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        const char *uri = job.req->uri;
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t ret = job.handler(job.req);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Async handler for %s failed: %s", uri, esp_err_to_name(ret));
+        }
+        ESP_LOGD(TAG, "Async %s took %lld ms", uri, (esp_timer_get_time() - start_us) / 1000);
+        // Returns the socket to the server task (and closes it if the handler failed)
+        httpd_req_async_handler_complete(job.req);
+    }
+}
+
+esp_err_t route_async_init(void)
+{
+    if (s_async_queue) {
+        return ESP_OK;
+    }
+
+    s_async_queue = xQueueCreate(CONFIG_WEB_ASYNC_QUEUE_LEN, sizeof(route_async_job_t));
+    if (!s_async_queue) {
+        ESP_LOGE(TAG, "Failed to create async handler queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < CONFIG_WEB_ASYNC_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "httpd_async%d", i);
+        if (xTaskCreate(route_async_worker, name, ROUTE_ASYNC_STACK, NULL,
+                        CONFIG_WEB_ASYNC_TASK_PRIORITY, &s_async_workers[i]) != pdPASS) {
+            // Workers already started keep serving the queue
+            ESP_LOGE(TAG, "Failed to start async handler worker %d", i);
+            s_async_workers[i] = NULL;
+            return i > 0 ? ESP_OK : ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGI(TAG, "Async handlers: %d workers, queue of %d",
+             CONFIG_WEB_ASYNC_WORKERS, CONFIG_WEB_ASYNC_QUEUE_LEN);
+    return ESP_OK;
+}
+
+bool route_async_in_worker(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < CONFIG_WEB_ASYNC_WORKERS; i++) {
+        if (s_async_workers[i] == self) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t route_async_submit(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req))
+{
+    if (!s_async_queue || !s_async_workers[0]) {
+        // No workers: serve inline as before rather than fail the request
+        return handler(req);
+    }
+
+    route_async_job_t job = { .req = NULL, .handler = handler };
+    if (httpd_req_async_handler_begin(req, &job.req) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to detach %s for async handling", req->uri);
+        return httpd_resp_send_500(req);
+    }
+
+    if (xQueueSend(s_async_queue, &job, 0) != pdTRUE) {
+        LOG_RATE_W(TAG, "Async handlers busy, rejecting %s", req->uri);
+        httpd_resp_set_status(job.req, "503 Service Unavailable");
+        httpd_resp_set_hdr(job.req, "Retry-After", "1");
+        httpd_resp_sendstr(job.req, "Busy, try again");
+        httpd_req_async_handler_complete(job.req);
+    }
+    return ESP_OK;
+}
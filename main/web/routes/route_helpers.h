@@ -12,6 +12,7 @@
 #include "esp_http_server.h"
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -64,6 +65,39 @@ esp_err_t send_static_chunked(httpd_req_t *req, const uint8_t *data_start, size_
  */
 esp_err_t url_decode(const char *src, char *dst, size_t dst_size);
 
+/**
+ * @brief Start the async handler workers (idempotent)
+ *
+ * Handlers that block (Wi-Fi scans, OTA receive, NVS commits) hand their
+ * request to a small pool of worker tasks instead of holding the single
+ * HTTP server task, which keeps serving other clients meanwhile.
+ */
+esp_err_t route_async_init(void);
+
+/**
+ * @brief Whether the caller is running on an async handler worker
+ */
+bool route_async_in_worker(void);
+
+/**
+ * @brief Re-run a handler for this request on a worker task
+ *
+ * Use at the top of a slow handler:
+ *
+ *   if (!route_async_in_worker()) {
+ *       return route_async_submit(req, my_handler);
+ *   }
+ *
+ * The worker calls handler with an async copy of the request (it may
+ * receive and send as usual) and completes it afterwards. When every worker
+ * is busy and the queue is full, the client gets a 503 instead.
+ *
+ * @param req HTTP request structure (server task)
+ * @param handler Handler to run on the worker
+ * @return ESP_OK when queued or answered with 503
+ */
+esp_err_t route_async_submit(httpd_req_t *req, esp_err_t (*handler)(httpd_req_t *req));
+
 #ifdef __cplusplus
 }
 #endif
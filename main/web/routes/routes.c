@@ -12,6 +12,12 @@ esp_err_t register_all_routes(httpd_handle_t server)
 {
     esp_err_t ret;
 
+    // Workers for slow handlers; they outlive server restarts
+    ret = route_async_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Async handlers unavailable, slow routes run inline: %s", esp_err_to_name(ret));
+    }
+
     // Register static file routes
     ret = register_static_routes(server);
     if (ret != ESP_OK) {
@@ -33,6 +39,13 @@ esp_err_t register_all_routes(httpd_handle_t server)
         return ret;
     }
 
+    // Register the WebSocket control channel
+    ret = register_control_routes(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register control routes: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
     // Register device discovery routes
     ret = register_discovery_routes(server);
     if (ret != ESP_OK) {
@@ -75,6 +88,41 @@ esp_err_t register_all_routes(httpd_handle_t server)
         return ret;
     }
 
+    // Register live stats stream
+    ret = register_stream_routes(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register stream routes: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Register Prometheus metrics endpoint
+    ret = register_metrics_routes(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register metrics routes: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Register lifecycle state machine trace
+    ret = register_lifecycle_routes(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register lifecycle routes: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Register the synthetic RTP load generator
+    ret = register_loadgen_routes(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register load generator routes: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Register the RTP/RTCP packet capture
+    ret = register_capture_routes(server);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register capture routes: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
     // IMPORTANT: Register captive portal routes LAST
     // The captive portal contains catch-all handlers (/* route) that must
     // be registered after all specific routes to avoid shadowing them
@@ -16,12 +16,18 @@
 #include "static_routes.h"
 #include "wifi_routes.h"
 #include "settings_routes.h"
+#include "control_routes.h"
 #include "discovery_routes.h"
 #include "pairing_routes.h"
 #include "battery_routes.h"
 #include "ota_routes.h"
 #include "logs_routes.h"
 #include "sap_routes.h"
+#include "stream_routes.h"
+#include "metrics_routes.h"
+#include "lifecycle_routes.h"
+#include "loadgen_routes.h"
+#include "capture_routes.h"
 #include "captive_portal_routes.h"
 
 /**
@@ -2,11 +2,79 @@
 #include "esp_log.h"
 #include "cJSON.h"
 #include "receiver/sap_listener.h"
+#include <stdlib.h>
 #include <time.h>
 #include <string.h>
 
 static const char *TAG = "sap_routes";
 
+typedef struct {
+    cJSON *array;
+    time_t now;
+} sap_json_ctx_t;
+
+// Runs under the SAP listener lock: reads the announcement in place
+static bool add_announcement_json(const sap_announcement_t *a, void *arg)
+{
+    sap_json_ctx_t *ctx = (sap_json_ctx_t *)arg;
+    cJSON *announcement = cJSON_CreateObject();
+    if (!announcement) {
+        return false;
+    }
+    
+    cJSON_AddStringToObject(announcement, "stream_name", a->stream_name);
+    cJSON_AddStringToObject(announcement, "source_ip", a->source_ip);
+    
+    // Extract destination IP from session_info if available
+    char dest_ip[16] = "";
+    if (strlen(a->session_info) > 0) {
+        // Parse "Connection: x.x.x.x" format
+        const char* conn_prefix = "Connection: ";
+        char* ip_start = strstr(a->session_info, conn_prefix);
+        if (ip_start) {
+            ip_start += strlen(conn_prefix);
+            int octet1, octet2, octet3, octet4;
+            if (sscanf(ip_start, "%d.%d.%d.%d", &octet1, &octet2, &octet3, &octet4) == 4) {
+                snprintf(dest_ip, sizeof(dest_ip), "%d.%d.%d.%d", octet1, octet2, octet3, octet4);
+            }
+        }
+    }
+    cJSON_AddStringToObject(announcement, "destination_ip", dest_ip);
+    
+    cJSON_AddNumberToObject(announcement, "port", a->port);
+    cJSON_AddNumberToObject(announcement, "sample_rate", a->sample_rate);
+    cJSON_AddNumberToObject(announcement, "ptime_ms", a->ptime_ms);
+    cJSON_AddNumberToObject(announcement, "bit_depth", a->bit_depth);
+    cJSON_AddNumberToObject(announcement, "channels", a->channels);
+    cJSON_AddNumberToObject(announcement, "opus_pt", a->opus_pt);
+    cJSON_AddBoolToObject(announcement, "ptp_clock", a->ptp_clock);
+    // Whether the stream is SRTP and announces usable keys; the keys themselves stay here
+    cJSON_AddBoolToObject(announcement, "srtp", a->srtp);
+    cJSON_AddBoolToObject(announcement, "srtp_keyed", a->srtp_crypto[0] != '\0');
+    cJSON_AddBoolToObject(announcement, "active", a->active);
+    cJSON_AddNumberToObject(announcement, "first_seen", a->first_seen);
+    cJSON_AddNumberToObject(announcement, "last_seen", a->last_seen);
+    cJSON_AddNumberToObject(announcement, "update_count", a->update_count);
+    
+    // Add relative times for easier display
+    if (a->last_seen > 0) {
+        cJSON_AddNumberToObject(announcement, "seconds_since_last_seen",
+                               ctx->now - a->last_seen);
+    }
+    if (a->first_seen > 0) {
+        cJSON_AddNumberToObject(announcement, "seconds_since_first_seen",
+                               ctx->now - a->first_seen);
+    }
+    
+    // Add session info if available
+    if (strlen(a->session_info) > 0) {
+        cJSON_AddStringToObject(announcement, "session_info", a->session_info);
+    }
+    
+    cJSON_AddItemToArray(ctx->array, announcement);
+    return true;
+}
+
 /**
  * GET handler for SAP announcements API endpoint
  */
@@ -19,10 +87,6 @@ static esp_err_t sap_get_handler(httpd_req_t *req)
         ESP_LOGE(TAG, "Invalid request pointer");
         return ESP_FAIL;
     }
-    // Get all SAP announcements
-    size_t count;
-    const sap_announcement_t *announcements = sap_listener_get_all_announcements(&count);
-
     // Create JSON response
     cJSON *root = cJSON_CreateObject();
     if (!root) {
@@ -30,7 +94,6 @@ static esp_err_t sap_get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    cJSON_AddNumberToObject(root, "count", count);
     cJSON_AddBoolToObject(root, "is_running", sap_listener_is_running());
     
     cJSON *announcements_array = cJSON_CreateArray();
@@ -40,58 +103,9 @@ static esp_err_t sap_get_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    time_t current_time = time(NULL);
-    
-    for (size_t i = 0; i < count; i++) {
-        cJSON *announcement = cJSON_CreateObject();
-        if (!announcement) {
-            continue;
-        }
-        
-        cJSON_AddStringToObject(announcement, "stream_name", announcements[i].stream_name);
-        cJSON_AddStringToObject(announcement, "source_ip", announcements[i].source_ip);
-        
-        // Extract destination IP from session_info if available
-        char dest_ip[16] = "";
-        if (strlen(announcements[i].session_info) > 0) {
-            // Parse "Connection: x.x.x.x" format
-            const char* conn_prefix = "Connection: ";
-            char* ip_start = strstr(announcements[i].session_info, conn_prefix);
-            if (ip_start) {
-                ip_start += strlen(conn_prefix);
-                int octet1, octet2, octet3, octet4;
-                if (sscanf(ip_start, "%d.%d.%d.%d", &octet1, &octet2, &octet3, &octet4) == 4) {
-                    snprintf(dest_ip, sizeof(dest_ip), "%d.%d.%d.%d", octet1, octet2, octet3, octet4);
-                }
-            }
-        }
-        cJSON_AddStringToObject(announcement, "destination_ip", dest_ip);
-        
-        cJSON_AddNumberToObject(announcement, "port", announcements[i].port);
-        cJSON_AddNumberToObject(announcement, "sample_rate", announcements[i].sample_rate);
-        cJSON_AddNumberToObject(announcement, "bit_depth", 16);  // L16 is always 16-bit
-        cJSON_AddBoolToObject(announcement, "active", announcements[i].active);
-        cJSON_AddNumberToObject(announcement, "first_seen", announcements[i].first_seen);
-        cJSON_AddNumberToObject(announcement, "last_seen", announcements[i].last_seen);
-        cJSON_AddNumberToObject(announcement, "update_count", announcements[i].update_count);
-        
-        // Add relative times for easier display
-        if (announcements[i].last_seen > 0) {
-            cJSON_AddNumberToObject(announcement, "seconds_since_last_seen",
-                                   current_time - announcements[i].last_seen);
-        }
-        if (announcements[i].first_seen > 0) {
-            cJSON_AddNumberToObject(announcement, "seconds_since_first_seen",
-                                   current_time - announcements[i].first_seen);
-        }
-        
-        // Add session info if available
-        if (strlen(announcements[i].session_info) > 0) {
-            cJSON_AddStringToObject(announcement, "session_info", announcements[i].session_info);
-        }
-        
-        cJSON_AddItemToArray(announcements_array, announcement);
-    }
+    sap_json_ctx_t ctx = { .array = announcements_array, .now = time(NULL) };
+    size_t count = sap_listener_foreach(false, add_announcement_json, &ctx);
+    cJSON_AddNumberToObject(root, "count", count);
     
     cJSON_AddItemToObject(root, "announcements", announcements_array);
     
@@ -104,6 +118,7 @@ static esp_err_t sap_get_handler(httpd_req_t *req)
     }
     httpd_resp_set_type(req, "application/json");   
     httpd_resp_send(req, json_str, strlen(json_str));
+    free(json_str);
     cJSON_Delete(root);
     
     return ESP_OK;
@@ -1,10 +1,37 @@
 #include "settings_routes.h"
+#include "route_helpers.h"
+#include "json_stream.h"
+#include "build_config.h"
 #include "lifecycle_manager.h"
 #include "lifecycle/config.h"
 #include "wifi_manager.h"
 #include "cJSON.h"
 #include "config.h"
+#include "global.h"
 #include "esp_log.h"
+#include "receiver/eq.h"
+#include "receiver/audio_out.h"
+#include "lifecycle/pipeline_topology.h"
+#include "sender/network_out.h"
+#include "rtp/rtp_srtp.h"
+#include "rtp/rtp_relay.h"
+#include "spdif_in.h"
+#include "ntp_client.h"
+#ifdef CONFIG_PTP_ENABLED
+#include "ptp_slave.h"
+#endif
+#ifdef CONFIG_RTCP_SEND_SR
+#include "sender/rtcp_sender.h"
+#endif
+#ifdef CONFIG_RTP_TX_ADAPT
+#include "sender/tx_adapt.h"
+#endif
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+#include "sender/opus_out.h"
+#endif
+#include "esp_netif.h"
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define TAG "settings_routes"
@@ -42,10 +69,17 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(root, "buffer_grow_step_size", lifecycle_get_buffer_grow_step_size());
     cJSON_AddNumberToObject(root, "max_buffer_size", lifecycle_get_max_buffer_size());
     cJSON_AddNumberToObject(root, "max_grow_size", lifecycle_get_max_grow_size());
+    cJSON_AddNumberToObject(root, "buffer_target_ms", lifecycle_get_buffer_target_ms());
+    cJSON_AddNumberToObject(root, "buffer_max_ms", lifecycle_get_buffer_max_ms());
 
     // Audio settings
     cJSON_AddNumberToObject(root, "sample_rate", lifecycle_get_sample_rate());
     cJSON_AddNumberToObject(root, "bit_depth", lifecycle_get_bit_depth());
+    cJSON_AddNumberToObject(root, "stream_channels", lifecycle_get_stream_channels());
+    cJSON_AddNumberToObject(root, "channel_left", lifecycle_get_channel_left());
+    cJSON_AddNumberToObject(root, "channel_right", lifecycle_get_channel_right());
+    cJSON_AddNumberToObject(root, "ptime_ms", lifecycle_get_ptime_ms());
+    cJSON_AddNumberToObject(root, "opus_pt", lifecycle_get_opus_pt());
     cJSON_AddNumberToObject(root, "volume", lifecycle_get_volume());
     
     // Device mode
@@ -61,11 +95,174 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     // Sender settings
     cJSON_AddStringToObject(root, "sender_destination_ip", lifecycle_get_sender_destination_ip());
     cJSON_AddNumberToObject(root, "sender_destination_port", lifecycle_get_sender_destination_port());
+    cJSON_AddStringToObject(root, "sender_fanout_ips", lifecycle_get_sender_fanout_ips());
+    cJSON_AddBoolToObject(root, "sender_fanout_mdns", lifecycle_get_sender_fanout_mdns());
+    cJSON_AddBoolToObject(root, "sender_opus", lifecycle_get_sender_opus());
+    cJSON_AddNumberToObject(root, "sender_opus_complexity", lifecycle_get_sender_opus_complexity());
+    cJSON_AddBoolToObject(root, "sender_mix_usb", lifecycle_get_sender_mix_usb());
+    cJSON_AddNumberToObject(root, "sender_mix_gain_spdif", lifecycle_get_sender_mix_gain_spdif());
+    cJSON_AddNumberToObject(root, "sender_mix_gain_usb", lifecycle_get_sender_mix_gain_usb());
+    if (rtp_sender_is_running()) {
+        rtp_sender_dest_stats_t dests[1 + CONFIG_RTP_TX_FANOUT_MAX];
+        size_t dest_count = rtp_sender_get_destinations(dests, sizeof(dests) / sizeof(dests[0]));
+        cJSON *dest_array = cJSON_AddArrayToObject(root, "sender_destinations");
+        for (size_t i = 0; dest_array && i < dest_count; i++) {
+            cJSON *dest = cJSON_CreateObject();
+            char ip_str[16];
+            esp_ip4_addr_t ip = { .addr = dests[i].addr };
+            snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip));
+            cJSON_AddStringToObject(dest, "ip_address", ip_str);
+            cJSON_AddNumberToObject(dest, "port", dests[i].port);
+            cJSON_AddBoolToObject(dest, "primary", dests[i].primary);
+            cJSON_AddBoolToObject(dest, "mdns", dests[i].from_mdns);
+            cJSON_AddBoolToObject(dest, "opus", dests[i].opus);
+            cJSON_AddBoolToObject(dest, "active", dests[i].active);
+            cJSON_AddNumberToObject(dest, "sent", dests[i].sent);
+            cJSON_AddNumberToObject(dest, "errors", dests[i].errors);
+            cJSON_AddItemToArray(dest_array, dest);
+        }
+        pcm_ring_stats_t capture;
+        if (rtp_sender_get_capture_stats(&capture)) {
+            cJSON *cap = cJSON_AddObjectToObject(root, "sender_capture");
+            if (cap) {
+                cJSON_AddNumberToObject(cap, "fill", capture.fill);
+                cJSON_AddNumberToObject(cap, "peak_fill", capture.peak_fill);
+                cJSON_AddNumberToObject(cap, "size", capture.size);
+                cJSON_AddNumberToObject(cap, "dropped_frames", capture.dropped_frames);
+                cJSON_AddNumberToObject(cap, "dropped_writes", capture.dropped_writes);
+                cJSON_AddNumberToObject(cap, "wakeups", capture.wakeups);
+            }
+        }
+        rtp_sender_mix_stats_t mix;
+        if (rtp_sender_get_mix_stats(&mix)) {
+            static const char *const mix_names[RTP_SENDER_MIX_SOURCES] = { "spdif", "usb" };
+            cJSON *m = cJSON_AddObjectToObject(root, "sender_mix");
+            if (m) {
+                cJSON_AddStringToObject(m, "clock", mix_names[mix.clock]);
+                for (int i = 0; i < RTP_SENDER_MIX_SOURCES; i++) {
+                    cJSON *src = cJSON_AddObjectToObject(m, mix_names[i]);
+                    if (src) {
+                        cJSON_AddNumberToObject(src, "peak", mix.source[i].peak);
+                        cJSON_AddNumberToObject(src, "fill", mix.source[i].fill);
+                        cJSON_AddNumberToObject(src, "slips", mix.source[i].slips);
+                        cJSON_AddNumberToObject(src, "underruns", mix.source[i].underruns);
+                    }
+                }
+            }
+        }
+        if (lifecycle_get_device_mode() == MODE_SENDER_SPDIF) {
+            spdif_in_stats_t spdif;
+            spdif_in_get_stats(&spdif);
+            cJSON *in = cJSON_AddObjectToObject(root, "sender_spdif_in");
+            if (in) {
+                cJSON_AddBoolToObject(in, "locked", spdif.locked);
+                cJSON_AddNumberToObject(in, "sample_rate", spdif.sample_rate);
+                cJSON_AddBoolToObject(in, "non_audio", spdif.non_audio);
+                cJSON_AddNumberToObject(in, "frames", spdif.frames);
+                cJSON_AddNumberToObject(in, "parity_errors", spdif.parity_errors);
+                cJSON_AddNumberToObject(in, "coding_errors", spdif.coding_errors);
+                cJSON_AddNumberToObject(in, "relocks", spdif.relocks);
+                cJSON_AddNumberToObject(in, "cpu_permille", spdif.cpu_permille);
+            }
+        }
+#ifdef CONFIG_RTCP_SEND_SR
+        // What the receivers report back about the stream
+        rtcp_sender_receiver_t rx[RTCP_SENDER_MAX_RECEIVERS];
+        size_t rx_count = rtcp_sender_get_receivers(rx, RTCP_SENDER_MAX_RECEIVERS);
+        cJSON *rx_array = cJSON_AddArrayToObject(root, "sender_receivers");
+        for (size_t i = 0; rx_array && i < rx_count; i++) {
+            cJSON *item = cJSON_CreateObject();
+            char ip_str[16];
+            esp_ip4_addr_t ip = { .addr = rx[i].addr };
+            snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip));
+            cJSON_AddStringToObject(item, "ip_address", ip_str);
+            cJSON_AddNumberToObject(item, "ssrc", rx[i].ssrc);
+            cJSON_AddNumberToObject(item, "fraction_lost", rx[i].fraction_lost / 256.0);
+            cJSON_AddNumberToObject(item, "cumulative_lost", rx[i].cumulative_lost);
+            cJSON_AddNumberToObject(item, "jitter_ms", rx[i].jitter * 1000.0 / 48000.0);
+            cJSON_AddNumberToObject(item, "rtt_ms", rx[i].rtt_us >= 0 ? rx[i].rtt_us / 1000.0 : -1);
+            cJSON_AddNumberToObject(item, "age_ms", rx[i].age_ms);
+            cJSON_AddItemToArray(rx_array, item);
+        }
+#endif
+#ifdef CONFIG_RTP_TX_RTX_ENABLED
+        rtp_sender_rtx_stats_t rtx_stats;
+        rtp_sender_get_rtx_stats(&rtx_stats);
+        cJSON *rtx = cJSON_AddObjectToObject(root, "sender_rtx");
+        if (rtx) {
+            cJSON_AddNumberToObject(rtx, "requested", rtx_stats.requested);
+            cJSON_AddNumberToObject(rtx, "sent", rtx_stats.sent);
+            cJSON_AddNumberToObject(rtx, "missed", rtx_stats.missed);
+            cJSON_AddNumberToObject(rtx, "limited", rtx_stats.limited);
+        }
+#endif
+#ifdef CONFIG_RTP_TX_ADAPT
+        cJSON *adapt = cJSON_AddObjectToObject(root, "sender_adapt");
+        if (adapt) {
+            cJSON_AddNumberToObject(adapt, "level", tx_adapt_level());
+            cJSON_AddNumberToObject(adapt, "ptime_ms", tx_adapt_ptime_ms());
+            cJSON_AddNumberToObject(adapt, "fec_group", tx_adapt_fec_group());
+        }
+#endif
+#ifdef CONFIG_RTP_TX_OPUS_ENABLED
+        opus_out_stats_t opus_stats;
+        opus_out_get_stats(&opus_stats);
+        cJSON *opus = cJSON_AddObjectToObject(root, "sender_opus_stats");
+        if (opus) {
+            cJSON_AddNumberToObject(opus, "encoded", opus_stats.encoded);
+            cJSON_AddNumberToObject(opus, "overflow", opus_stats.overflow);
+            cJSON_AddNumberToObject(opus, "errors", opus_stats.errors);
+            cJSON_AddNumberToObject(opus, "bitrate", opus_stats.bitrate);
+            cJSON_AddNumberToObject(opus, "complexity", opus_stats.complexity);
+        }
+#endif
+    }
     
     // NTP settings
     cJSON_AddBoolToObject(root, "ntp_screamrouter_mode", lifecycle_get_ntp_screamrouter_mode());
     cJSON_AddStringToObject(root, "ntp_server_host", lifecycle_get_ntp_server_host());
     cJSON_AddNumberToObject(root, "ntp_server_port", lifecycle_get_ntp_server_port());
+    ntp_convergence_status_t ntp;
+    ntp_get_convergence_status(&ntp);
+    cJSON *sync = cJSON_AddObjectToObject(root, "ntp_sync");
+    if (sync) {
+        cJSON_AddBoolToObject(sync, "valid", ntp.valid);
+        cJSON_AddBoolToObject(sync, "converged", ntp.converged);
+        cJSON_AddNumberToObject(sync, "offset_sigma_us", ntp.offset_sigma_us);
+        cJSON_AddNumberToObject(sync, "skew_ppm", ntp.skew_ppm);
+        cJSON_AddNumberToObject(sync, "skew_sigma_ppm", ntp.skew_sigma_ppm);
+        cJSON_AddNumberToObject(sync, "innovation_us", (double)ntp.last_innovation_us);
+        cJSON_AddNumberToObject(sync, "rtt_floor_us", (double)ntp.rtt_floor_us);
+        cJSON_AddNumberToObject(sync, "rtt_us", (double)ntp.last_rtt_us);
+        cJSON_AddNumberToObject(sync, "probe_interval_ms", ntp.probe_interval_ms);
+        cJSON_AddNumberToObject(sync, "samples", ntp.samples);
+        cJSON_AddNumberToObject(sync, "rejected", ntp.rejected);
+        cJSON_AddNumberToObject(sync, "resets", ntp.resets);
+    }
+#ifdef CONFIG_PTP_ENABLED
+    ptp_slave_stats_t ptp;
+    ptp_slave_get_stats(&ptp);
+    cJSON *ptp_sync = cJSON_AddObjectToObject(root, "ptp_sync");
+    if (ptp_sync) {
+        char gm[24];
+        snprintf(gm, sizeof(gm), "%02x%02x%02x.%02x%02x.%02x%02x%02x",
+                 ptp.gm_identity[0], ptp.gm_identity[1], ptp.gm_identity[2], ptp.gm_identity[3],
+                 ptp.gm_identity[4], ptp.gm_identity[5], ptp.gm_identity[6], ptp.gm_identity[7]);
+        cJSON_AddBoolToObject(ptp_sync, "locked", ptp.locked);
+        cJSON_AddBoolToObject(ptp_sync, "have_master", ptp.have_master);
+        cJSON_AddNumberToObject(ptp_sync, "domain", ptp.domain);
+        cJSON_AddStringToObject(ptp_sync, "grandmaster", ptp.have_master ? gm : "");
+        cJSON_AddNumberToObject(ptp_sync, "clock_class", ptp.gm_clock_class);
+        cJSON_AddNumberToObject(ptp_sync, "utc_offset_s", ptp.utc_offset_s);
+        cJSON_AddNumberToObject(ptp_sync, "offset_ns", (double)ptp.offset_ns);
+        cJSON_AddNumberToObject(ptp_sync, "path_delay_ns", (double)ptp.path_delay_ns);
+        cJSON_AddNumberToObject(ptp_sync, "skew_ppb", ptp.skew_ppb);
+        cJSON_AddNumberToObject(ptp_sync, "syncs", ptp.syncs);
+        cJSON_AddNumberToObject(ptp_sync, "delay_resps", ptp.delay_resps);
+        cJSON_AddNumberToObject(ptp_sync, "steps", ptp.steps);
+        cJSON_AddNumberToObject(ptp_sync, "timeouts", ptp.timeouts);
+    }
+#endif
     
     // Sleep settings
     cJSON_AddNumberToObject(root, "silence_threshold_ms", lifecycle_get_silence_threshold_ms());
@@ -76,9 +273,97 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
 
     // Use Direct Write
     cJSON_AddBoolToObject(root, "use_direct_write", lifecycle_get_use_direct_write());
+
+    // Core/priority preset of the audio tasks
+    cJSON_AddNumberToObject(root, "pipeline_topology", lifecycle_get_pipeline_topology());
+
+    // Low-latency playout, and the wire-to-output latency actually measured
+    cJSON_AddBoolToObject(root, "low_latency", lifecycle_get_low_latency());
+    audio_out_latency_t lat;
+    audio_out_get_latency(&lat);
+    cJSON *latency = cJSON_AddObjectToObject(root, "measured_latency");
+    if (latency) {
+        cJSON_AddNumberToObject(latency, "avg_us", lat.avg_us);
+        cJSON_AddNumberToObject(latency, "min_us", lat.min_us);
+        cJSON_AddNumberToObject(latency, "max_us", lat.max_us);
+#ifdef CONFIG_RTP_LATENCY_PROBE
+        // Capture-to-output breakdown from the sender's latency probes
+        audio_out_probe_latency_t pl;
+        audio_out_get_probe_latency(&pl);
+        cJSON *probe = cJSON_AddObjectToObject(latency, "probe");
+        if (probe) {
+            cJSON_AddNumberToObject(probe, "probes", pl.probes);
+            const struct { const char *name; const audio_out_latency_t *stage; } stages[] = {
+                { "network", &pl.network }, { "buffer", &pl.buffer },
+                { "output", &pl.output }, { "total", &pl.total },
+            };
+            for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+                cJSON *stage = cJSON_AddObjectToObject(probe, stages[i].name);
+                if (stage) {
+                    cJSON_AddNumberToObject(stage, "avg_us", stages[i].stage->avg_us);
+                    cJSON_AddNumberToObject(stage, "min_us", stages[i].stage->min_us);
+                    cJSON_AddNumberToObject(stage, "max_us", stages[i].stage->max_us);
+                }
+            }
+        }
+#endif
+    }
     
     // SAP stream name (for automatic connection to specific SAP streams)
     cJSON_AddStringToObject(root, "sap_stream_name", lifecycle_get_sap_stream_name());
+
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    // SRTP: report the suite only; the key stays on the device
+    cJSON_AddStringToObject(root, "srtp_suite",
+                            rtp_srtp_suite_name(rtp_srtp_parse(lifecycle_get_srtp_crypto())));
+#endif
+
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    // ESP-NOW relay: settings, and what the running relay has passed on or taken in
+    cJSON_AddNumberToObject(root, "relay_role", lifecycle_get_relay_role());
+    cJSON_AddStringToObject(root, "relay_peers", lifecycle_get_relay_peers());
+    if (rtp_relay_role() != RTP_RELAY_OFF) {
+        rtp_relay_stats_t rs;
+        rtp_relay_get_stats(&rs);
+        cJSON *relay = cJSON_AddObjectToObject(root, "relay");
+        if (relay) {
+            cJSON_AddStringToObject(relay, "role", rtp_relay_role_name(rtp_relay_role()));
+            cJSON_AddNumberToObject(relay, "forwarded", rs.forwarded);
+            cJSON_AddNumberToObject(relay, "send_errors", rs.send_errors);
+            cJSON_AddNumberToObject(relay, "oversize", rs.oversize);
+            cJSON_AddNumberToObject(relay, "received", rs.received);
+            cJSON_AddNumberToObject(relay, "overflow", rs.overflow);
+            cJSON_AddNumberToObject(relay, "foreign", rs.foreign);
+        }
+    }
+#endif
+
+    // Playout EQ: biquad sections as [b0, b1, b2, a1, a2], plus crossover
+    const eq_config_t *eq_cfg = lifecycle_get_eq();
+    cJSON *eq = cJSON_AddObjectToObject(root, "eq");
+    if (eq) {
+        cJSON *eq_bands = cJSON_AddArrayToObject(eq, "bands");
+        for (uint8_t b = 0; eq_bands && b < eq_cfg->band_count && b < EQ_MAX_BANDS; b++) {
+            cJSON *band = cJSON_CreateArray();
+            for (int c = 0; band && c < EQ_COEFFS_PER_BAND; c++) {
+                cJSON_AddItemToArray(band, cJSON_CreateNumber(eq_cfg->coeffs[b][c]));
+            }
+            cJSON_AddItemToArray(eq_bands, band);
+        }
+        cJSON_AddNumberToObject(eq, "crossover_hz", eq_cfg->crossover_hz);
+    }
+#ifdef CONFIG_RX_EQ_ENABLED
+    eq_stats_t es;
+    eq_get_stats(&es);
+    cJSON *eq_stats = cJSON_AddObjectToObject(root, "eq_stats");
+    if (eq_stats) {
+        cJSON_AddNumberToObject(eq_stats, "cycles_avg", es.cycles_avg);
+        cJSON_AddNumberToObject(eq_stats, "cycles_max", es.cycles_max);
+        cJSON_AddNumberToObject(eq_stats, "budget_cycles", es.budget_cycles);
+        cJSON_AddNumberToObject(eq_stats, "load_pct",
+                                es.budget_cycles ? 100.0 * es.cycles_avg / es.budget_cycles : 0.0);
+    }
+#endif
     
     // Setup wizard status
     cJSON_AddBoolToObject(root, "setup_wizard_completed", lifecycle_get_setup_wizard_completed());
@@ -127,305 +412,408 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     return ret;
 }
 
-/**
- * POST handler for updating device settings
+/*
+ * POST /api/settings is tokenized as it is received and validated straight into
+ * one lifecycle_config_update_t, applied by a single lifecycle_update_config_batch():
+ * one NVS commit and one CONFIGURATION_CHANGED pass, whatever the request holds.
  */
-static esp_err_t settings_post_handler(httpd_req_t *req)
-{
-    ESP_LOGI(TAG, "Handling POST request for /api/settings");
-
-    // Get content length
-    size_t content_len = req->content_len;
-    if (content_len >= 2048) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
-        return ESP_FAIL;
-    }
-
-    // Read the data
-    char *buf = malloc(content_len + 1);
-    if (!buf) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
-        return ESP_FAIL;
-    }
-
-    int ret = httpd_req_recv(req, buf, content_len);
-    if (ret <= 0) {
-        free(buf);
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-            httpd_resp_send_408(req);
-        }
-        return ESP_FAIL;
-    }
-    buf[content_len] = '\0';
-
-    // Parse the JSON data
-    cJSON *root = cJSON_Parse(buf);
-    free(buf); // We don't need the raw data anymore
-
-    if (!root) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
-        return ESP_FAIL;
-    }
 
-    // Suspend LED visualizer during configuration writes to avoid RMT/IRAM issues during NVS commits
-//    bool viz_was_active = visualizer_is_active();
-   // if (viz_was_active) {
-//        visualizer_suspend();
-    //}
-
-    // Prepare batch update structure
-    lifecycle_config_update_t updates = (lifecycle_config_update_t){0};
-
-    // Parse and prepare updates for port
-    cJSON *port = cJSON_GetObjectItem(root, "port");
-    if (port && cJSON_IsNumber(port)) {
-        updates.update_port = true;
-        updates.port = (uint16_t)port->valueint;
-    }
-
-    // Hostname
-    cJSON *hostname = cJSON_GetObjectItem(root, "hostname");
-    if (hostname && cJSON_IsString(hostname)) {
-        updates.update_hostname = true;
-        updates.hostname = hostname->valuestring;
-    }
-
-    // WiFi AP SSID
-    cJSON *ap_ssid = cJSON_GetObjectItem(root, "ap_ssid");
-    if (ap_ssid && cJSON_IsString(ap_ssid)) {
-        updates.update_ap_ssid = true;
-        updates.ap_ssid = ap_ssid->valuestring;
-    }
+// Strings of the update point in here: every string setting at its longest fits
+#define SETTINGS_STRINGS_SIZE 768
+
+#define CONFIG_STRLEN(field) (sizeof(((app_config_t *)0)->field) - 1)
+
+typedef enum {
+    SETTING_BOOL,
+    SETTING_U8,
+    SETTING_U16,
+    SETTING_U32,
+    SETTING_FLOAT,
+    SETTING_STRING,
+} setting_type_t;
+
+typedef struct {
+    const char *key;
+    setting_type_t type;
+    size_t flag;        // offsetof the update_* flag
+    size_t value;       // offsetof the value
+    double min;         // Numbers: accepted range; strings: longest length in max
+    double max;
+} setting_field_t;
+
+#define SETTING(name, type, lo, hi) \
+    { #name, type, offsetof(lifecycle_config_update_t, update_##name), \
+      offsetof(lifecycle_config_update_t, name), lo, hi }
+
+// Plain fields; device_mode, srtp_crypto, relay_peers and eq are parsed on their own
+static const setting_field_t s_setting_fields[] = {
+    SETTING(port,                          SETTING_U16,    1, UINT16_MAX),
+    SETTING(hostname,                      SETTING_STRING, 0, CONFIG_STRLEN(hostname)),
+    SETTING(ap_ssid,                       SETTING_STRING, 0, CONFIG_STRLEN(ap_ssid)),
+    SETTING(ap_password,                   SETTING_STRING, 0, CONFIG_STRLEN(ap_password)),
+    SETTING(hide_ap_when_connected,        SETTING_BOOL,   0, 0),
+
+    SETTING(initial_buffer_size,           SETTING_U8,     0, UINT8_MAX),
+    SETTING(buffer_grow_step_size,         SETTING_U8,     0, UINT8_MAX),
+    SETTING(max_buffer_size,               SETTING_U8,     0, UINT8_MAX),
+    SETTING(max_grow_size,                 SETTING_U8,     0, UINT8_MAX),
+    SETTING(buffer_target_ms,              SETTING_U16,    0, UINT16_MAX),
+    SETTING(buffer_max_ms,                 SETTING_U16,    0, UINT16_MAX),
+
+    SETTING(sample_rate,                   SETTING_U32,    8000, 192000),
+    SETTING(ptime_ms,                      SETTING_U8,     0, UINT8_MAX),
+    SETTING(bit_depth,                     SETTING_U8,     0, UINT8_MAX),
+    SETTING(stream_channels,               SETTING_U8,     2, PCM_CHANNELS_MAX),
+    SETTING(channel_left,                  SETTING_U8,     0, PCM_CHANNELS_MAX - 1),
+    SETTING(channel_right,                 SETTING_U8,     0, PCM_CHANNELS_MAX - 1),
+    SETTING(opus_pt,                       SETTING_U8,     0, UINT8_MAX),
+    SETTING(volume,                        SETTING_FLOAT,  0, 1),
+
+    SETTING(silence_threshold_ms,          SETTING_U32,    0, UINT32_MAX),
+    SETTING(network_check_interval_ms,     SETTING_U32,    0, UINT32_MAX),
+    SETTING(activity_threshold_packets,    SETTING_U8,     0, UINT8_MAX),
+    SETTING(silence_amplitude_threshold,   SETTING_U16,    0, UINT16_MAX),
+    SETTING(network_inactivity_timeout_ms, SETTING_U32,    0, UINT32_MAX),
+
+    // Legacy mode flags: the batch only uses them without device_mode
+    SETTING(enable_usb_sender,             SETTING_BOOL,   0, 0),
+    SETTING(enable_spdif_sender,           SETTING_BOOL,   0, 0),
+
+    SETTING(sender_destination_ip,         SETTING_STRING, 0, CONFIG_STRLEN(sender_destination_ip)),
+    SETTING(sender_destination_port,       SETTING_U16,    1, UINT16_MAX),
+    SETTING(sender_fanout_ips,             SETTING_STRING, 0, CONFIG_STRLEN(sender_fanout_ips)),
+    SETTING(sender_fanout_mdns,            SETTING_BOOL,   0, 0),
+    SETTING(sender_opus,                   SETTING_BOOL,   0, 0),
+    SETTING(sender_opus_complexity,        SETTING_U8,     0, 10),
+    SETTING(sender_mix_usb,                SETTING_BOOL,   0, 0),
+    SETTING(sender_mix_gain_spdif,         SETTING_U8,     0, 100),
+    SETTING(sender_mix_gain_usb,           SETTING_U8,     0, 100),
+
+    SETTING(spdif_data_pin,                SETTING_U8,     0, 39),
+    SETTING(use_direct_write,              SETTING_BOOL,   0, 0),
+    SETTING(low_latency,                   SETTING_BOOL,   0, 0),
+    SETTING(pipeline_topology,             SETTING_U8,     0, PIPELINE_TOPOLOGY_COUNT - 1),
+    SETTING(sap_stream_name,               SETTING_STRING, 0, CONFIG_STRLEN(sap_stream_name)),
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    SETTING(relay_role,                    SETTING_U8,     0, RTP_RELAY_ROLE_COUNT - 1),
+#endif
+
+    SETTING(ntp_screamrouter_mode,         SETTING_BOOL,   0, 0),
+    SETTING(ntp_server_host,               SETTING_STRING, 0, CONFIG_STRLEN(ntp_server_host)),
+    SETTING(ntp_server_port,               SETTING_U16,    0, UINT16_MAX),
+
+    SETTING(setup_wizard_completed,        SETTING_BOOL,   0, 0),
+};
+
+typedef struct {
+    json_stream_t js;
+    lifecycle_config_update_t updates;
+    char strings[SETTINGS_STRINGS_SIZE];
+    size_t strings_used;
+    uint16_t applied;       // Fields taken into updates
+    uint16_t ignored;       // Fields that failed validation
+} settings_parse_t;
+
+static void setting_ignored(settings_parse_t *p, const char *key) {
+    ESP_LOGW(TAG, "Ignoring invalid %s", key);
+    p->ignored++;
+}
 
-    // WiFi AP password
-    cJSON *ap_password = cJSON_GetObjectItem(root, "ap_password");
-    if (ap_password && cJSON_IsString(ap_password)) {
-        updates.update_ap_password = true;
-        updates.ap_password = ap_password->valuestring;
+// Copy the string just tokenized to the request's string area
+static const char *setting_keep_string(settings_parse_t *p) {
+    size_t size = p->js.text_len + 1;
+    if (p->strings_used + size > sizeof(p->strings)) {
+        return NULL;
     }
+    char *kept = p->strings + p->strings_used;
+    memcpy(kept, p->js.text, size);
+    p->strings_used += size;
+    return kept;
+}
 
-    // Hide AP when connected setting
-    cJSON *hide_ap_when_connected = cJSON_GetObjectItem(root, "hide_ap_when_connected");
-    if (hide_ap_when_connected && cJSON_IsBool(hide_ap_when_connected)) {
-        updates.update_hide_ap_when_connected = true;
-        updates.hide_ap_when_connected = cJSON_IsTrue(hide_ap_when_connected);
-    }
+static void setting_apply_field(settings_parse_t *p, const setting_field_t *field, json_stream_token_t tok) {
+    uint8_t *base = (uint8_t *)&p->updates;
+    void *value = base + field->value;
 
-    // Buffer settings
-    cJSON *initial_buffer_size = cJSON_GetObjectItem(root, "initial_buffer_size");
-    if (initial_buffer_size && cJSON_IsNumber(initial_buffer_size)) {
-        updates.update_initial_buffer_size = true;
-        updates.initial_buffer_size = (uint8_t)initial_buffer_size->valueint;
-    }
-
-    cJSON *buffer_grow_step_size = cJSON_GetObjectItem(root, "buffer_grow_step_size");
-    if (buffer_grow_step_size && cJSON_IsNumber(buffer_grow_step_size)) {
-        updates.update_buffer_grow_step_size = true;
-        updates.buffer_grow_step_size = (uint8_t)buffer_grow_step_size->valueint;
+    if (field->type == SETTING_BOOL) {
+        if (tok != JSON_STREAM_TRUE && tok != JSON_STREAM_FALSE) {
+            setting_ignored(p, field->key);
+            return;
+        }
+        *(bool *)value = tok == JSON_STREAM_TRUE;
+    } else if (field->type == SETTING_STRING) {
+        if (tok != JSON_STREAM_STRING || p->js.truncated || p->js.text_len > field->max) {
+            setting_ignored(p, field->key);
+            return;
+        }
+        const char *kept = setting_keep_string(p);
+        if (!kept) {
+            setting_ignored(p, field->key);
+            return;
+        }
+        *(const char **)value = kept;
+    } else {
+        double v = p->js.number;
+        if (tok != JSON_STREAM_NUMBER || v < field->min || v > field->max) {
+            setting_ignored(p, field->key);
+            return;
+        }
+        switch (field->type) {
+            case SETTING_U8:    *(uint8_t *)value = (uint8_t)v;   break;
+            case SETTING_U16:   *(uint16_t *)value = (uint16_t)v; break;
+            case SETTING_U32:   *(uint32_t *)value = (uint32_t)v; break;
+            default:            *(float *)value = (float)v;       break;
+        }
     }
+    *(bool *)(base + field->flag) = true;
+    p->applied++;
+}
 
-    cJSON *max_buffer_size = cJSON_GetObjectItem(root, "max_buffer_size");
-    if (max_buffer_size && cJSON_IsNumber(max_buffer_size)) {
-        updates.update_max_buffer_size = true;
-        updates.max_buffer_size = (uint8_t)max_buffer_size->valueint;
+// Bands array just opened: [[b0, b1, b2, a1, a2], ...]
+static bool settings_parse_eq_bands(settings_parse_t *p, eq_config_t *eq, bool *valid) {
+    json_stream_t *js = &p->js;
+    memset(eq->coeffs, 0, sizeof(eq->coeffs));
+    uint8_t count = 0;
+    for (;;) {
+        json_stream_token_t tok = json_stream_next(js);
+        if (tok == JSON_STREAM_ARRAY_END) {
+            break;
+        }
+        if (tok != JSON_STREAM_ARRAY_START || count >= EQ_MAX_BANDS) {
+            *valid = false;
+            if (!json_stream_skip(js, tok)) {
+                return false;
+            }
+            continue;
+        }
+        int c = 0;
+        for (;;) {
+            tok = json_stream_next(js);
+            if (tok == JSON_STREAM_ARRAY_END) {
+                break;
+            }
+            if (tok == JSON_STREAM_NUMBER && c < EQ_COEFFS_PER_BAND) {
+                eq->coeffs[count][c++] = (float)js->number;
+                continue;
+            }
+            *valid = false;
+            if (!json_stream_skip(js, tok)) {
+                return false;
+            }
+        }
+        if (c != EQ_COEFFS_PER_BAND) {
+            *valid = false;
+        }
+        count++;
     }
+    eq->band_count = count;
+    return true;
+}
 
-    cJSON *max_grow_size = cJSON_GetObjectItem(root, "max_grow_size");
-    if (max_grow_size && cJSON_IsNumber(max_grow_size)) {
-        updates.update_max_grow_size = true;
-        updates.max_grow_size = (uint8_t)max_grow_size->valueint;
+// Playout EQ object just opened; an absent part keeps its stored value
+static bool settings_parse_eq(settings_parse_t *p) {
+    json_stream_t *js = &p->js;
+    eq_config_t eq = *lifecycle_get_eq();
+    bool valid = true;
+    for (;;) {
+        json_stream_token_t tok = json_stream_next(js);
+        if (tok == JSON_STREAM_OBJECT_END) {
+            break;
+        }
+        if (tok != JSON_STREAM_KEY) {
+            return false;
+        }
+        bool bands = strcmp(js->text, "bands") == 0;
+        bool crossover = strcmp(js->text, "crossover_hz") == 0;
+        tok = json_stream_next(js);
+        if (bands && tok == JSON_STREAM_ARRAY_START) {
+            if (!settings_parse_eq_bands(p, &eq, &valid)) {
+                return false;
+            }
+        } else if (crossover && tok == JSON_STREAM_NUMBER) {
+            if (js->number < 0 || js->number > UINT16_MAX) {
+                valid = false;
+            } else {
+                eq.crossover_hz = (uint16_t)js->number;
+            }
+        } else if (!json_stream_skip(js, tok)) {
+            return false;
+        }
     }
-
-    // Audio settings
-    // Sample rate is handled separately after batch update
-    cJSON *sample_rate = cJSON_GetObjectItem(root, "sample_rate");
-
-    cJSON *bit_depth = cJSON_GetObjectItem(root, "bit_depth");
-    if (bit_depth && cJSON_IsNumber(bit_depth)) {
-        // Bit depth is fixed at 16, nothing to update
+    if (valid) {
+        p->updates.update_eq = true;
+        p->updates.eq = eq;
+        p->applied++;
+    } else {
+        setting_ignored(p, "eq");
     }
+    return true;
+}
 
-    cJSON *volume = cJSON_GetObjectItem(root, "volume");
-    if (volume && cJSON_IsNumber(volume)) {
-        updates.update_volume = true;
-        updates.volume = (float)volume->valuedouble;
+// Fields that need more than a range check
+static bool settings_parse_special(settings_parse_t *p, const char *key, json_stream_token_t tok, bool *handled) {
+    json_stream_t *js = &p->js;
+    lifecycle_config_update_t *updates = &p->updates;
+    *handled = true;
+
+    if (strcmp(key, "device_mode") == 0) {
+        if (tok == JSON_STREAM_NUMBER && js->number >= MODE_RECEIVER_USB && js->number <= MODE_SENDER_SPDIF) {
+            updates->update_device_mode = true;
+            updates->device_mode = (device_mode_t)js->number;
+            p->applied++;
+            ESP_LOGI(TAG, "Updating device_mode to: %d", updates->device_mode);
+        } else {
+            setting_ignored(p, key);
+        }
+        return json_stream_skip(js, tok);
     }
 
-    // Sleep settings
-    cJSON *silence_threshold_ms = cJSON_GetObjectItem(root, "silence_threshold_ms");
-    if (silence_threshold_ms && cJSON_IsNumber(silence_threshold_ms)) {
-        updates.update_silence_threshold_ms = true;
-        updates.silence_threshold_ms = (uint32_t)silence_threshold_ms->valueint;
+    if (strcmp(key, "eq") == 0) {
+        if (tok == JSON_STREAM_OBJECT_START) {
+            return settings_parse_eq(p);
+        }
+        setting_ignored(p, key);
+        return json_stream_skip(js, tok);
     }
 
-    cJSON *network_check_interval_ms = cJSON_GetObjectItem(root, "network_check_interval_ms");
-    if (network_check_interval_ms && cJSON_IsNumber(network_check_interval_ms)) {
-        updates.update_network_check_interval_ms = true;
-        updates.network_check_interval_ms = (uint32_t)network_check_interval_ms->valueint;
+#ifdef CONFIG_RTP_SRTP_ENABLED
+    // SRTP keys: "off" (or "none") returns to plain RTP, anything else must parse
+    if (strcmp(key, "srtp_crypto") == 0) {
+        if (tok == JSON_STREAM_STRING && js->text_len == 0) {
+            return true;
+        }
+        if (tok == JSON_STREAM_STRING && !js->truncated &&
+            (strcmp(js->text, "off") == 0 || strcmp(js->text, "none") == 0)) {
+            updates->update_srtp_crypto = true;
+            updates->srtp_crypto = "";
+        } else if (tok == JSON_STREAM_STRING && !js->truncated &&
+                   js->text_len <= CONFIG_STRLEN(srtp_crypto) &&
+                   rtp_srtp_parse(js->text) != RTP_SRTP_NONE) {
+            updates->srtp_crypto = setting_keep_string(p);
+            updates->update_srtp_crypto = updates->srtp_crypto != NULL;
+        }
+        if (updates->update_srtp_crypto) {
+            p->applied++;
+            ESP_LOGI(TAG, "SRTP suite updated to: %s", rtp_srtp_suite_name(rtp_srtp_parse(updates->srtp_crypto)));
+        } else {
+            setting_ignored(p, key);
+        }
+        return json_stream_skip(js, tok);
     }
+#endif
 
-    cJSON *activity_threshold_packets = cJSON_GetObjectItem(root, "activity_threshold_packets");
-    if (activity_threshold_packets && cJSON_IsNumber(activity_threshold_packets)) {
-        updates.update_activity_threshold_packets = true;
-        updates.activity_threshold_packets = (uint8_t)activity_threshold_packets->valueint;
+#ifdef CONFIG_RTP_RELAY_ENABLED
+    if (strcmp(key, "relay_peers") == 0) {
+        if (tok == JSON_STREAM_STRING && !js->truncated &&
+            js->text_len <= CONFIG_STRLEN(relay_peers) && rtp_relay_peers_valid(js->text)) {
+            updates->relay_peers = setting_keep_string(p);
+            updates->update_relay_peers = updates->relay_peers != NULL;
+        }
+        if (updates->update_relay_peers) {
+            p->applied++;
+        } else {
+            setting_ignored(p, key);
+        }
+        return json_stream_skip(js, tok);
     }
+#endif
 
-    cJSON *silence_amplitude_threshold = cJSON_GetObjectItem(root, "silence_amplitude_threshold");
-    if (silence_amplitude_threshold && cJSON_IsNumber(silence_amplitude_threshold)) {
-        updates.update_silence_amplitude_threshold = true;
-        updates.silence_amplitude_threshold = (uint16_t)silence_amplitude_threshold->valueint;
-    }
+    *handled = false;
+    return true;
+}
 
-    cJSON *network_inactivity_timeout_ms = cJSON_GetObjectItem(root, "network_inactivity_timeout_ms");
-    if (network_inactivity_timeout_ms && cJSON_IsNumber(network_inactivity_timeout_ms)) {
-        updates.update_network_inactivity_timeout_ms = true;
-        updates.network_inactivity_timeout_ms = (uint32_t)network_inactivity_timeout_ms->valueint;
+// Whole body into p->updates; false if it is not a well-formed JSON object
+static bool settings_parse_body(settings_parse_t *p) {
+    json_stream_t *js = &p->js;
+    if (json_stream_next(js) != JSON_STREAM_OBJECT_START) {
+        return false;
     }
-
-    // Device mode setting (new preferred way)
-    cJSON *device_mode = cJSON_GetObjectItem(root, "device_mode");
-    if (device_mode && cJSON_IsNumber(device_mode)) {
-        device_mode_t mode = (device_mode_t)device_mode->valueint;
-        if (mode >= MODE_RECEIVER_USB && mode <= MODE_SENDER_SPDIF) {
-            updates.update_device_mode = true;
-            updates.device_mode = mode;
-            ESP_LOGI(TAG, "Updating device_mode to: %d", mode);
+    for (;;) {
+        json_stream_token_t tok = json_stream_next(js);
+        if (tok == JSON_STREAM_OBJECT_END) {
+            return json_stream_next(js) == JSON_STREAM_END;
         }
-    }
-    
-    // Legacy USB Sender settings (for backward compatibility)
-    cJSON *enable_usb_sender = cJSON_GetObjectItem(root, "enable_usb_sender");
-    if (enable_usb_sender && cJSON_IsBool(enable_usb_sender)) {
-        if (!device_mode) {  // Only use if device_mode wasn't provided
-            updates.update_enable_usb_sender = true;
-            updates.enable_usb_sender = cJSON_IsTrue(enable_usb_sender);
-            ESP_LOGI(TAG, "Updating USB sender enabled to: %d", updates.enable_usb_sender);
+        if (tok != JSON_STREAM_KEY) {
+            return false;
+        }
+        // The value's token reuses the text buffer
+        char key[32];
+        strlcpy(key, js->text, sizeof(key));
+        tok = json_stream_next(js);
+        if (tok == JSON_STREAM_ERROR) {
+            return false;
         }
-    }
 
-    cJSON *sender_destination_ip = cJSON_GetObjectItem(root, "sender_destination_ip");
-    if (sender_destination_ip && cJSON_IsString(sender_destination_ip)) {
-        updates.update_sender_destination_ip = true;
-        updates.sender_destination_ip = sender_destination_ip->valuestring;
-        ESP_LOGI(TAG, "Updating sender destination IP to: %s", updates.sender_destination_ip);
+        bool handled;
+        if (!settings_parse_special(p, key, tok, &handled)) {
+            return false;
+        }
+        if (handled) {
+            continue;
+        }
+        size_t i;
+        for (i = 0; i < sizeof(s_setting_fields) / sizeof(s_setting_fields[0]); i++) {
+            if (strcmp(key, s_setting_fields[i].key) == 0) {
+                setting_apply_field(p, &s_setting_fields[i], tok);
+                break;
+            }
+        }
+        // Unknown keys (read-only fields echoed back by the UI) are skipped
+        if (!json_stream_skip(js, tok)) {
+            return false;
+        }
     }
+}
 
-    cJSON *sender_destination_port = cJSON_GetObjectItem(root, "sender_destination_port");
-    if (sender_destination_port && cJSON_IsNumber(sender_destination_port)) {
-        updates.update_sender_destination_port = true;
-        updates.sender_destination_port = (uint16_t)sender_destination_port->valueint;
-        ESP_LOGI(TAG, "Updating sender destination port to: %d", updates.sender_destination_port);
+/**
+ * POST handler for updating device settings
+ */
+static esp_err_t settings_post_handler(httpd_req_t *req)
+{
+    // Applying settings commits to NVS and may restart modes
+    if (!route_async_in_worker()) {
+        return route_async_submit(req, settings_post_handler);
     }
 
-    // SPDIF settings
-    cJSON *spdif_data_pin = cJSON_GetObjectItem(root, "spdif_data_pin");
-    if (spdif_data_pin && cJSON_IsNumber(spdif_data_pin)) {
-        // Limit the pin number to valid GPIO range (0-39 for ESP32)
-        uint8_t pin = (uint8_t)spdif_data_pin->valueint;
-        if (pin <= 39) {
-            updates.update_spdif_data_pin = true;
-            updates.spdif_data_pin = pin;
-        }
-    }
+    ESP_LOGI(TAG, "Handling POST request for /api/settings");
 
-    // Legacy SPDIF sender setting (for backward compatibility)
-    cJSON *enable_spdif_sender = cJSON_GetObjectItem(root, "enable_spdif_sender");
-    if (enable_spdif_sender && cJSON_IsBool(enable_spdif_sender)) {
-        if (!device_mode) {  // Only use if device_mode wasn't provided
-            updates.update_enable_spdif_sender = true;
-            updates.enable_spdif_sender = cJSON_IsTrue(enable_spdif_sender);
-            ESP_LOGI(TAG, "Updating S/PDIF sender enabled to: %d", updates.enable_spdif_sender);
-        }
+    // Room for the full settings object including EQ_MAX_BANDS sets of coefficients
+    if (req->content_len >= 4096) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
     }
 
-    // Handle direct write setting
-    cJSON *use_direct_write = cJSON_GetObjectItem(root, "use_direct_write");
-    ESP_LOGI(TAG, "Got use_direct_write from JSON: %p", use_direct_write);
-    if (use_direct_write) {
-        ESP_LOGI(TAG, "use_direct_write type: %d", use_direct_write->type);
-    }
-    if (use_direct_write && cJSON_IsBool(use_direct_write)) {
-        bool old_value = lifecycle_get_use_direct_write();
-        updates.update_use_direct_write = true;
-        updates.use_direct_write = cJSON_IsTrue(use_direct_write);
-        ESP_LOGI(TAG, "Direct write mode changed from %d to %d", old_value, updates.use_direct_write);
-    } else {
-        ESP_LOGW(TAG, "Invalid or missing use_direct_write in request");
-    }
-    
-    // Handle SAP stream name for automatic connection
-    cJSON *sap_stream_name = cJSON_GetObjectItem(root, "sap_stream_name");
-    if (sap_stream_name && cJSON_IsString(sap_stream_name)) {
-        updates.update_sap_stream_name = true;
-        updates.sap_stream_name = sap_stream_name->valuestring;
-        ESP_LOGI(TAG, "SAP stream name updated to: %s", updates.sap_stream_name);
-    }
-    
-    // NTP configuration
-    cJSON *ntp_mdns = cJSON_GetObjectItem(root, "ntp_screamrouter_mode");
-    if (ntp_mdns && cJSON_IsBool(ntp_mdns)) {
-        updates.update_ntp_screamrouter_mode = true;
-        updates.ntp_screamrouter_mode = cJSON_IsTrue(ntp_mdns);
-    }
-    cJSON *ntp_host = cJSON_GetObjectItem(root, "ntp_server_host");
-    if (ntp_host && cJSON_IsString(ntp_host)) {
-        updates.update_ntp_server_host = true;
-        updates.ntp_server_host = ntp_host->valuestring;
-    }
-    cJSON *ntp_port = cJSON_GetObjectItem(root, "ntp_server_port");
-    if (ntp_port && cJSON_IsNumber(ntp_port)) {
-        updates.update_ntp_server_port = true;
-        updates.ntp_server_port = (uint16_t)ntp_port->valueint;
+    // One fixed block however large the body: it is never held whole
+    settings_parse_t *p = calloc(1, sizeof(*p));
+    if (!p) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Memory allocation failed");
+        return ESP_FAIL;
     }
+    json_stream_init(&p->js, req);
 
-    // Handle setup wizard completed flag
-    cJSON *setup_wizard_completed = cJSON_GetObjectItem(root, "setup_wizard_completed");
-    esp_err_t err = ESP_OK;
-    if (setup_wizard_completed && cJSON_IsBool(setup_wizard_completed)) {
-        bool completed = cJSON_IsTrue(setup_wizard_completed);
-        err = lifecycle_set_setup_wizard_completed(completed);
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to set setup wizard completed status: %s", esp_err_to_name(err));
-            cJSON_Delete(root);
-//            if (viz_was_active) visualizer_resume();
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set setup wizard status");
-            return ESP_FAIL;
-        }
-        ESP_LOGI(TAG, "Setup wizard completed status changed to %d", completed);
+    if (!settings_parse_body(p)) {
+        int recv_error = p->js.recv_error;
+        free(p);
+        if (recv_error == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        } else if (recv_error == 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        }
+        return ESP_FAIL;
     }
+    ESP_LOGI(TAG, "Applying %u setting(s), %u ignored", p->applied, p->ignored);
 
-    // Apply batch updates through lifecycle_manager
-    err = lifecycle_update_config_batch(&updates);
+    // One commit for every field; the unified handler then applies them in one pass
+    esp_err_t err = lifecycle_update_config_batch(&p->updates);
+    free(p);
     if (err != ESP_OK) {
-        cJSON_Delete(root);
-//        if (viz_was_active) visualizer_resume();
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to update configuration");
         return ESP_FAIL;
     }
 
-    // Handle sample rate separately if changed
-    if (sample_rate && cJSON_IsNumber(sample_rate)) {
-        uint32_t new_rate = (uint32_t)sample_rate->valueint;
-        uint32_t current_rate = lifecycle_get_sample_rate();
-        if (new_rate != current_rate) {
-            ESP_LOGI(TAG, "Sample rate change requested: %lu Hz", new_rate);
-            err = lifecycle_manager_change_sample_rate(new_rate);
-            if (err != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to change sample rate: 0x%x", err);
-            }
-        }
-    }
-
-    // Post configuration changed event to lifecycle manager
-    // The unified handler will apply all immediate changes
     ESP_LOGI(TAG, "Configuration saved, posting event to lifecycle manager");
     lifecycle_manager_post_event(LIFECYCLE_EVENT_CONFIGURATION_CHANGED);
 
-    cJSON_Delete(root);
-
-    // Resume visualizer after configuration save/update completes
-//    if (viz_was_active) visualizer_resume();
-
     // Send success response
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"status\":\"ok\",\"message\":\"Settings saved successfully\"}");
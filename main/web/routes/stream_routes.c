@@ -0,0 +1,298 @@
+#include "stream_routes.h"
+#include "build_config.h"
+#include "receiver/buffer.h"
+#include "receiver/network_in.h"
+#include "receiver/clock_steer.h"
+#include "lifecycle/task_stats.h"
+#ifdef CONFIG_RTCP_ENABLED
+#include "receiver/rtcp_receiver.h"
+#endif
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "stream_routes";
+
+#define STREAM_MAX_HZ          20
+#define STREAM_TASK_STACK      4096
+#define STREAM_LINE_MAX        512
+
+// Per-task CPU comes from the task snapshot (CONFIG_TASK_STATS)
+#ifdef CONFIG_TASK_STATS
+#define STREAM_TASK_CPU        1
+#define STREAM_CPU_PERIOD_MS   CONFIG_TASK_STATS_PERIOD_MS
+#define STREAM_CPU_LINE_MAX    (64 + TASK_STATS_MAX_TASKS * (configMAX_TASK_NAME_LEN + 16))
+#else
+#define STREAM_TASK_CPU        0
+#endif
+
+// Stats event fields; a field is sent only when it changed since the last event
+typedef enum {
+    F_RX = 0,     // Packets received
+    F_LOST,       // Packets lost
+    F_LATE,       // Packets dropped late
+    F_RECOVERED,  // Packets recovered (FEC)
+    F_PPS,        // Packets per second over the last period
+    F_JITTER_US,  // Interarrival jitter of the primary source
+    F_FILL,       // Jitter buffer depth (chunks)
+    F_TARGET,     // Target depth (chunks)
+    F_CHUNK_US,   // Duration of one chunk
+    F_UNDERRUN,   // 1 while rebuffering
+    F_UNDERRUNS,  // Underruns since boot
+    F_CONCEALED,  // Chunks concealed
+    F_PLL_PPB,    // RTCP PLL drift estimate of the primary source
+    F_STEER_PPB,  // Offset the output clock is steered to
+    F_COUNT
+} stream_field_t;
+
+static const char *const s_field_names[F_COUNT] = {
+    "rx", "lost", "late", "recovered", "pps", "jitter_us", "fill", "target",
+    "chunk_us", "underrun", "underruns", "concealed", "pll_ppb", "steer_ppb",
+};
+
+typedef struct {
+    httpd_req_t *req;              // Async copy; owned by the stream task
+    uint32_t period_ms;
+    bool have_prev;
+    int64_t prev[F_COUNT];
+    uint32_t prev_rx;
+    int64_t prev_us;
+#if STREAM_TASK_CPU
+    int64_t cpu_next_us;
+    task_stats_snapshot_t cpu_snap;
+    char cpu_line[STREAM_CPU_LINE_MAX];
+#endif
+} stream_conn_t;
+
+static atomic_int s_active = 0;
+
+static void sample_fields(stream_conn_t *conn, int64_t now_us, int64_t *v)
+{
+    uint32_t received = 0, lost = 0, recovered = 0, dropped = 0;
+    get_rtp_statistics(&received, &lost, NULL, &recovered);
+    get_rtp_drop_statistics(&dropped, NULL);
+    v[F_RX] = received;
+    v[F_LOST] = lost;
+    v[F_LATE] = dropped;
+    v[F_RECOVERED] = recovered;
+
+    int64_t dt_us = now_us - conn->prev_us;
+    v[F_PPS] = (conn->prev_us && dt_us > 0)
+        ? ((int64_t)(uint32_t)(received - conn->prev_rx) * 1000000 + dt_us / 2) / dt_us : 0;
+    conn->prev_rx = received;
+    conn->prev_us = now_us;
+
+    buffer_depth_t depth;
+    buffer_get_depth(&depth);
+    v[F_FILL] = depth.fill;
+    v[F_TARGET] = depth.target;
+    v[F_CHUNK_US] = depth.chunk_us;
+    v[F_UNDERRUN] = buffer_is_underrun();
+    v[F_UNDERRUNS] = buffer_get_underrun_count();
+
+    buffer_reorder_stats_t reorder;
+    buffer_get_reorder_stats(&reorder);
+    v[F_CONCEALED] = reorder.concealed;
+
+    v[F_JITTER_US] = 0;
+    v[F_PLL_PPB] = 0;
+#ifdef CONFIG_RTCP_ENABLED
+    uint32_t primary;
+    if (rtcp_get_primary_ssrc(&primary)) {
+        uint32_t jitter_ts = 0;
+        if (rtcp_get_rx_stats(primary, NULL, NULL, &jitter_ts)) {
+            v[F_JITTER_US] = ((int64_t)jitter_ts * 1000000 + CONFIG_SAMPLE_RATE / 2) / CONFIG_SAMPLE_RATE;
+        }
+        float ppm;
+        if (rtcp_get_pll_slope_ppm(primary, &ppm)) {
+            v[F_PLL_PPB] = (int64_t)(ppm * 1000.0f);
+        }
+    }
+#endif
+
+    clock_steer_stats_t steer;
+    clock_steer_get_stats(&steer);
+    v[F_STEER_PPB] = steer.applied_ppb;
+}
+
+// "data: {...}\n\n" with the time and every field that changed; returns the length
+static int format_stats_event(stream_conn_t *conn, char *line, size_t cap)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t v[F_COUNT];
+    sample_fields(conn, now_us, v);
+
+    int len = snprintf(line, cap, "data: {\"t\":%lld", (long long)(now_us / 1000));
+    for (int i = 0; i < F_COUNT && len < (int)cap; i++) {
+        if (!conn->have_prev || v[i] != conn->prev[i]) {
+            len += snprintf(line + len, cap - len, ",\"%s\":%lld", s_field_names[i], (long long)v[i]);
+        }
+        conn->prev[i] = v[i];
+    }
+    conn->have_prev = true;
+    if (len < (int)cap) {
+        len += snprintf(line + len, cap - len, "}\n\n");
+    }
+    return len < (int)cap ? len : -1;
+}
+
+#if STREAM_TASK_CPU
+// "event: cpu" from the last task snapshot: core loads and each task's share of one core
+// (per mille) and least free stack (bytes)
+static int format_cpu_event(stream_conn_t *conn, char *line, size_t cap)
+{
+    task_stats_snapshot_t *snap = &conn->cpu_snap;
+    if (!task_stats_get(snap) || snap->period_ms == 0) {
+        return 0;
+    }
+
+    int len = snprintf(line, cap, "event: cpu\ndata: {\"cores\":[");
+    for (int c = 0; c < SOC_CPU_CORES_NUM && len < (int)cap; c++) {
+        len += snprintf(line + len, cap - len, "%s%u", c ? "," : "", snap->core_load_permille[c]);
+    }
+    if (len < (int)cap) {
+        len += snprintf(line + len, cap - len, "],\"tasks\":{");
+    }
+    for (uint8_t i = 0; i < snap->task_count && len < (int)cap; i++) {
+        const task_stats_task_t *t = &snap->tasks[i];
+        len += snprintf(line + len, cap - len, "%s\"%s\":[%u,%lu]", i ? "," : "",
+                        t->name, t->load_permille, (unsigned long)t->stack_free_bytes);
+    }
+    if (len < (int)cap) {
+        len += snprintf(line + len, cap - len, "}}\n\n");
+    }
+    return len < (int)cap ? len : -1;
+}
+#endif
+
+static void stream_task(void *arg)
+{
+    stream_conn_t *conn = (stream_conn_t *)arg;
+    httpd_req_t *req = conn->req;
+    char line[STREAM_LINE_MAX];
+
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    // EventSource reconnects on its own; ask it to wait a little when it does
+    static const char hello[] = "retry: 3000\n\n";
+    esp_err_t ret = httpd_resp_send_chunk(req, hello, sizeof(hello) - 1);
+
+    TickType_t wake = xTaskGetTickCount();
+    while (ret == ESP_OK) {
+        int len = format_stats_event(conn, line, sizeof(line));
+        if (len > 0) {
+            ret = httpd_resp_send_chunk(req, line, len);
+        }
+#if STREAM_TASK_CPU
+        int64_t now_us = esp_timer_get_time();
+        if (ret == ESP_OK && now_us >= conn->cpu_next_us) {
+            conn->cpu_next_us = now_us + (int64_t)STREAM_CPU_PERIOD_MS * 1000;
+            len = format_cpu_event(conn, conn->cpu_line, sizeof(conn->cpu_line));
+            if (len > 0) {
+                ret = httpd_resp_send_chunk(req, conn->cpu_line, len);
+            }
+        }
+#endif
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(conn->period_ms));
+    }
+
+    ESP_LOGI(TAG, "Stats stream closed");
+    httpd_req_async_handler_complete(req);
+    free(conn);
+    atomic_fetch_sub(&s_active, 1);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Handler for GET /stream
+ *
+ * Query parameters:
+ * - hz: Events per second (default CONFIG_WEB_STREAM_DEFAULT_HZ, max 20)
+ *
+ * Events:
+ * - (default) data: {"t":<ms since boot>, <each changed field>: <int>, ...}
+ *   The first event carries every field; clients merge the rest into it.
+ * - cpu (CONFIG_TASK_STATS): {"cores": [<load per mille>, ...],
+ *   "tasks": {"<task>": [<per mille of one core>, <least free stack bytes>], ...}}
+ *   once per task snapshot period
+ */
+static esp_err_t stream_get_handler(httpd_req_t *req)
+{
+    char query_buf[32] = {0};
+    char param_buf[8] = {0};
+    uint32_t hz = CONFIG_WEB_STREAM_DEFAULT_HZ;
+    if (httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf)) == ESP_OK &&
+        httpd_query_key_value(query_buf, "hz", param_buf, sizeof(param_buf)) == ESP_OK) {
+        int parsed = atoi(param_buf);
+        if (parsed >= 1 && parsed <= STREAM_MAX_HZ) {
+            hz = (uint32_t)parsed;
+        }
+    }
+
+    // Each stream holds a socket and a task; bound them
+    int active = atomic_load(&s_active);
+    do {
+        if (active >= CONFIG_WEB_STREAM_MAX_CLIENTS) {
+            ESP_LOGW(TAG, "Refusing stats stream: %d already open", active);
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            return httpd_resp_sendstr(req, "Too many open streams");
+        }
+    } while (!atomic_compare_exchange_weak(&s_active, &active, active + 1));
+
+    stream_conn_t *conn = calloc(1, sizeof(*conn));
+    if (!conn) {
+        atomic_fetch_sub(&s_active, 1);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    conn->period_ms = 1000 / hz;
+
+    // Take the request off the server task, which goes back to serving others
+    if (httpd_req_async_handler_begin(req, &conn->req) != ESP_OK) {
+        free(conn);
+        atomic_fetch_sub(&s_active, 1);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start stream");
+    }
+
+    if (xTaskCreate(stream_task, "stats_stream", STREAM_TASK_STACK, conn,
+                    CONFIG_WEB_STREAM_TASK_PRIORITY, NULL) != pdPASS) {
+        httpd_resp_send_err(conn->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start stream");
+        httpd_req_async_handler_complete(conn->req);
+        free(conn);
+        atomic_fetch_sub(&s_active, 1);
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Stats stream opened at %lu Hz", (unsigned long)hz);
+    return ESP_OK;
+}
+
+esp_err_t register_stream_routes(httpd_handle_t server)
+{
+    if (!server) {
+        ESP_LOGE(TAG, "Invalid server handle");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_uri_t stream_uri = {
+        .uri       = "/stream",
+        .method    = HTTP_GET,
+        .handler   = stream_get_handler,
+        .user_ctx  = NULL
+    };
+
+    esp_err_t ret = httpd_register_uri_handler(server, &stream_uri);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register GET /stream: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Registered stream routes");
+    return ESP_OK;
+}
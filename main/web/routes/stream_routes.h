@@ -0,0 +1,20 @@
+#ifndef STREAM_ROUTES_H
+#define STREAM_ROUTES_H
+
+#include <esp_http_server.h>
+
+/**
+ * @brief Register the live stats stream (GET /stream)
+ *
+ * Server-Sent Events: one persistent connection per browser tab carries
+ * receiver stats (packet rate, loss, jitter, buffer fill against target,
+ * PLL and clock steering, underruns) as JSON deltas at ?hz=N, instead of
+ * the tab polling several JSON endpoints. Each connection is served from
+ * its own low-priority task, so the HTTP server stays free.
+ *
+ * @param server HTTP server handle
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t register_stream_routes(httpd_handle_t server);
+
+#endif // STREAM_ROUTES_H
@@ -2,10 +2,16 @@
 #include "route_helpers.h"
 #include "wifi_manager.h"
 #include "lifecycle_manager.h"
+#include "lifecycle/net_iface.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "esp_netif.h"
 #include "cJSON.h"
+#include "build_config.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
 #include <string.h>
 
 #include "usb/uac_host.h"
@@ -16,18 +22,71 @@ static const char *TAG = "wifi_routes";
 // Maximum number of networks to return in scan
 #define MAX_SCAN_RESULTS 20
 
+// Last scan result, reused for CONFIG_WEB_SCAN_CACHE_TTL_MS. The lock is held
+// across a scan, so requests arriving meanwhile wait for it and share the result.
+static struct {
+    SemaphoreHandle_t lock;
+    wifi_network_info_t networks[MAX_SCAN_RESULTS];
+    size_t count;
+    int64_t time_us;
+    bool valid;
+} s_scan_cache;
+
+/**
+ * Copy the cached scan into networks, scanning first if it is stale or refresh is set
+ */
+static esp_err_t scan_cached(wifi_network_info_t *networks, size_t *count, bool refresh)
+{
+    if (!s_scan_cache.lock) {
+        return wifi_manager_scan_networks(networks, MAX_SCAN_RESULTS, count);
+    }
+
+    xSemaphoreTake(s_scan_cache.lock, portMAX_DELAY);
+    esp_err_t ret = ESP_OK;
+    int64_t age_ms = (esp_timer_get_time() - s_scan_cache.time_us) / 1000;
+    if (refresh || !s_scan_cache.valid || age_ms >= CONFIG_WEB_SCAN_CACHE_TTL_MS) {
+        size_t found = 0;
+        ret = wifi_manager_scan_networks(s_scan_cache.networks, MAX_SCAN_RESULTS, &found);
+        s_scan_cache.valid = ret == ESP_OK;
+        s_scan_cache.count = s_scan_cache.valid ? found : 0;
+        s_scan_cache.time_us = esp_timer_get_time();
+    } else {
+        ESP_LOGI(TAG, "Scan served from cache (%lld ms old)", age_ms);
+    }
+    if (ret == ESP_OK) {
+        memcpy(networks, s_scan_cache.networks, s_scan_cache.count * sizeof(networks[0]));
+        *count = s_scan_cache.count;
+    }
+    xSemaphoreGive(s_scan_cache.lock);
+    return ret;
+}
+
 /**
  * GET handler for scanning available WiFi networks
+ *
+ * Query parameters:
+ * - refresh=1: scan now instead of answering from the cache
  */
 static esp_err_t scan_get_handler(httpd_req_t *req)
 {
+    // A scan takes seconds; keep it off the server task
+    if (!route_async_in_worker()) {
+        return route_async_submit(req, scan_get_handler);
+    }
+
     ESP_LOGI(TAG, "Handling GET request for /scan");
 
+    char query[32];
+    char value[4];
+    bool refresh = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                   httpd_query_key_value(query, "refresh", value, sizeof(value)) == ESP_OK &&
+                   value[0] == '1';
+
     // Scan for networks
     wifi_network_info_t networks[MAX_SCAN_RESULTS];
     size_t networks_found = 0;
 
-    esp_err_t ret = wifi_manager_scan_networks(networks, MAX_SCAN_RESULTS, &networks_found);
+    esp_err_t ret = scan_cached(networks, &networks_found, refresh);
     if (ret != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to scan networks");
         return ESP_FAIL;
@@ -110,6 +169,11 @@ static esp_err_t scan_get_handler(httpd_req_t *req)
  */
 static esp_err_t connect_post_handler(httpd_req_t *req)
 {
+    // Saves credentials to NVS and may hold the response for the deep sleep delay
+    if (!route_async_in_worker()) {
+        return route_async_submit(req, connect_post_handler);
+    }
+
     ESP_LOGI(TAG, "Handling POST request for /connect");
 
     // Get content length
@@ -266,6 +330,21 @@ static esp_err_t status_get_handler(httpd_req_t *req)
         }
     }
 
+#ifdef CONFIG_NET_ETHERNET_ENABLED
+    // Wired link: carries the streams while it has an address
+    cJSON *eth = cJSON_AddObjectToObject(root, "ethernet");
+    if (eth) {
+        bool up = net_iface_eth_up();
+        cJSON_AddBoolToObject(eth, "up", up);
+        esp_netif_ip_info_t eth_ip;
+        if (up && esp_netif_get_ip_info(net_iface_primary(), &eth_ip) == ESP_OK) {
+            char ip_str[16];
+            snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&eth_ip.ip));
+            cJSON_AddStringToObject(eth, "ip", ip_str);
+        }
+    }
+#endif
+
     // Convert JSON to string
     char *json_str = cJSON_Print(root);
     if (!json_str) {
@@ -327,6 +406,10 @@ esp_err_t register_wifi_routes(httpd_handle_t server)
 {
     esp_err_t ret;
 
+    if (!s_scan_cache.lock) {
+        s_scan_cache.lock = xSemaphoreCreateMutex();
+    }
+
     // Register scan endpoint
     httpd_uri_t scan = {
         .uri       = "/scan",
@@ -285,10 +285,95 @@ document.addEventListener('DOMContentLoaded', function() {
     initializeExportImport();
     initializeHelpTooltips();
     initializeKeyboardShortcuts();
+    initializeControlChannel();
     
     restoreTabState();
 });
 
+// ===== Live Control Channel (/api/control) =====
+// Volume, mute and buffer target go over one WebSocket as they change; the
+// device applies them at once and saves them itself after a quiet period.
+const Control = {
+    socket: null,
+    retryMs: 1000,
+    dragging: false
+};
+
+function controlSend(command) {
+    if (Control.socket && Control.socket.readyState === WebSocket.OPEN) {
+        Control.socket.send(JSON.stringify(command));
+    }
+}
+
+function controlShowState(st) {
+    const volume = $('#control-volume');
+    if (volume && !Control.dragging) volume.value = Math.round(st.volume * 100);
+    const volumeValue = $('#control-volume-value');
+    if (volumeValue) volumeValue.textContent = `${Math.round(st.volume * 100)}%`;
+    const mute = $('#control-mute');
+    if (mute) mute.checked = !!st.muted;
+    const target = $('#control-buffer-target');
+    if (target && document.activeElement !== target) target.value = st.buffer_target_ms;
+    const stream = $('#control-stream');
+    if (stream) stream.textContent = st.stream || 'none';
+}
+
+function controlSetEnabled(enabled, status) {
+    ['#control-volume', '#control-mute', '#control-buffer-target'].forEach(sel => {
+        const el = $(sel);
+        if (el) el.disabled = !enabled;
+    });
+    const statusEl = $('#control-status');
+    if (statusEl) statusEl.textContent = status;
+}
+
+function controlConnect() {
+    if (!('WebSocket' in window)) {
+        controlSetEnabled(false, 'not supported by this browser');
+        return;
+    }
+    const scheme = location.protocol === 'https:' ? 'wss' : 'ws';
+    const socket = new WebSocket(`${scheme}://${location.host}/api/control`);
+    Control.socket = socket;
+    socket.onopen = () => {
+        Control.retryMs = 1000;
+        controlSetEnabled(true, 'live');
+    };
+    socket.onmessage = (event) => {
+        try {
+            controlShowState(JSON.parse(event.data));
+        } catch (e) {
+            console.warn('Bad control state', e);
+        }
+    };
+    socket.onclose = () => {
+        controlSetEnabled(false, 'reconnecting…');
+        setTimeout(controlConnect, Control.retryMs);
+        Control.retryMs = Math.min(Control.retryMs * 2, 30000);
+    };
+}
+
+function initializeControlChannel() {
+    const volume = $('#control-volume');
+    if (!volume) return;
+
+    volume.addEventListener('pointerdown', () => { Control.dragging = true; });
+    volume.addEventListener('pointerup', () => { Control.dragging = false; });
+    volume.addEventListener('input', () => {
+        $('#control-volume-value').textContent = `${volume.value}%`;
+        controlSend({ volume: volume.value / 100 });
+    });
+    $('#control-mute').addEventListener('change', (e) => {
+        controlSend({ mute: e.target.checked });
+    });
+    $('#control-buffer-target').addEventListener('change', (e) => {
+        const ms = parseInt(e.target.value, 10);
+        if (!isNaN(ms)) controlSend({ buffer_target_ms: ms });
+    });
+
+    controlConnect();
+}
+
 // ===== Tab System with Hash Support =====
 function initializeTabSystem() {
     const tabs = $$('.tab');
@@ -1018,12 +1103,15 @@ function loadSettings() {
                 // Mode settings (receiver)
                 'sample_rate': 'mode-settings-form',
                 'bit_depth': 'mode-settings-form',
+                'ptime_ms': 'mode-settings-form',
                 'volume': 'mode-settings-form',
                 'use_direct_write': 'mode-settings-form',
                 'initial_buffer_size': 'mode-settings-form',
                 'buffer_grow_step_size': 'mode-settings-form',
                 'max_buffer_size': 'mode-settings-form',
                 'max_grow_size': 'mode-settings-form',
+                'buffer_target_ms': 'mode-settings-form',
+                'buffer_max_ms': 'mode-settings-form',
                 'spdif_data_pin': 'mode-settings-form',
                 
                 // Mode settings (sender)
@@ -1044,7 +1132,22 @@ function loadSettings() {
                 'silence_amplitude_threshold': 'advanced-settings-form',
                 'network_check_interval_ms': 'advanced-settings-form',
                 'activity_threshold_packets': 'advanced-settings-form',
-                'network_inactivity_timeout_ms': 'advanced-settings-form'
+                'network_inactivity_timeout_ms': 'advanced-settings-form',
+                'low_latency': 'advanced-settings-form',
+                'pipeline_topology': 'advanced-settings-form',
+                'stream_channels': 'advanced-settings-form',
+                'channel_left': 'advanced-settings-form',
+                'channel_right': 'advanced-settings-form',
+                'sender_fanout_ips': 'advanced-settings-form',
+                'sender_fanout_mdns': 'advanced-settings-form',
+                'sender_opus': 'advanced-settings-form',
+                'sender_opus_complexity': 'advanced-settings-form',
+                'sender_mix_usb': 'advanced-settings-form',
+                'sender_mix_gain_spdif': 'advanced-settings-form',
+                'sender_mix_gain_usb': 'advanced-settings-form',
+                'srtp_crypto': 'advanced-settings-form',
+                'relay_role': 'advanced-settings-form',
+                'relay_peers': 'advanced-settings-form'
             };
             
             // Apply settings to form fields
@@ -1073,6 +1176,39 @@ function loadSettings() {
                 }
             });
             
+            // Measured latency is read-only
+            const latencyEl = document.getElementById('measured-latency');
+            const lat = settings.measured_latency;
+            if (latencyEl) {
+                latencyEl.textContent = (lat && lat.avg_us > 0)
+                    ? `${(lat.avg_us / 1000).toFixed(1)} ms (min ${(lat.min_us / 1000).toFixed(1)}, max ${(lat.max_us / 1000).toFixed(1)})`
+                    : 'not playing';
+            }
+
+            // The key itself is never sent back, only the suite it selects
+            const srtpEl = document.getElementById('srtp-status');
+            if (srtpEl) {
+                srtpEl.textContent = settings.srtp_suite || 'not built in';
+            }
+            const srtpInput = document.getElementById('srtp_crypto');
+            if (srtpInput) {
+                srtpInput.value = '';
+            }
+
+            const relayEl = document.getElementById('relay-status');
+            if (relayEl) {
+                if (settings.relay_role === undefined) {
+                    relayEl.textContent = 'not built in';
+                } else if (settings.relay) {
+                    const r = settings.relay;
+                    relayEl.textContent = r.role === 'listen'
+                        ? `listening, ${r.received} received, ${r.overflow} dropped`
+                        : `forwarding, ${r.forwarded} sent, ${r.send_errors} failed, ${r.oversize} too long`;
+                } else {
+                    relayEl.textContent = 'off';
+                }
+            }
+
             // Update sender fields visibility
             updateSenderOptionsVisibility();
             
@@ -1104,7 +1240,12 @@ function saveSettings(event) {
         
         // Convert form data to JSON object
         for (let [key, value] of formData.entries()) {
-            if (!isNaN(value) && key !== 'ap_password') {
+            if (key === 'srtp_crypto') {
+                // Left empty: keep the stored key
+                if (value !== '') settings[key] = value;
+                continue;
+            }
+            if (!isNaN(value) && key !== 'ap_password' && key !== 'relay_peers') {
                 if (key === 'volume') {
                     settings[key] = parseFloat(value);
                 } else {
@@ -1643,8 +1784,8 @@ function selectOTAFile(file) {
     resetOTAInterface();
     
     // Basic validation
-    if (!file.name.endsWith('.bin')) {
-        showOTAError('Invalid file type. Please select a .bin firmware file.');
+    if (!/\.(bin|gz|delta)$/.test(file.name)) {
+        showOTAError('Invalid file type. Please select a .bin, .bin.gz or .delta.gz firmware file.');
         return;
     }
     
@@ -1653,7 +1794,8 @@ function selectOTAFile(file) {
         return;
     }
     
-    if (file.size < 1024) { // Less than 1KB is suspicious
+    // Less than 1KB is suspicious for an image; a delta for a small change can be tiny
+    if (file.size < (file.name.endsWith('.bin') ? 1024 : 32)) {
         showOTAError('File too small. This doesn\'t appear to be a valid firmware file.');
         return;
     }
@@ -1696,10 +1838,15 @@ function validateOTAFile(file) {
         const buffer = e.target.result;
         const view = new Uint8Array(buffer);
         
-        // Check for ESP32 firmware magic byte (0xE9)
-        if (view.length > 0 && view[0] === 0xE9) {
+        // ESP32 image (0xE9), gzip (1F 8B) or delta patch ("EDP1"); the device decodes the last two
+        const isImage = view.length > 0 && view[0] === 0xE9;
+        const isGzip = view.length > 1 && view[0] === 0x1F && view[1] === 0x8B;
+        const isDelta = view.length > 3 && String.fromCharCode(view[0], view[1], view[2], view[3]) === 'EDP1';
+        if (isImage || isGzip || isDelta) {
             typeCheck.querySelector('.check-icon').textContent = '✅';
-            typeCheck.querySelector('.check-text').textContent = 'Valid ESP32 firmware detected';
+            typeCheck.querySelector('.check-text').textContent = isImage
+                ? 'Valid ESP32 firmware detected'
+                : (isGzip ? 'Compressed firmware or delta detected' : 'Firmware delta detected');
             typeCheck.classList.add('valid');
         } else if (view.length > 0) {
             // Allow upload anyway but warn
@@ -2149,7 +2296,8 @@ const LogsViewer = {
     autoScroll: true,
     autoRefresh: true,
     lineCount: 50,
-    lastLogPosition: 0,
+    cursor: null,         // X-Log-Cursor of the last tail response
+    logText: '',          // Last lineCount lines received
     isRefreshing: false
 };
 
@@ -2186,13 +2334,24 @@ function refreshLogs() {
     if (statusIndicator) statusIndicator.className = 'status-indicator loading';
     if (statusText) statusText.textContent = 'Loading...';
     
-    // Build query parameters
-    const params = new URLSearchParams({
-        lines: LogsViewer.lineCount
-    });
+    // Only fetch what was written since the last response
+    const params = new URLSearchParams();
+    if (LogsViewer.cursor !== null) {
+        params.set('cursor', LogsViewer.cursor);
+    }
     
-    queueRequest(`/api/logs?${params}`)
-        .then(response => response.json())
+    queueRequest(`/api/logs/tail?${params}`)
+        .then(async response => {
+            const text = await response.text();
+            const start = response.headers.get('X-Log-Start');
+            if (LogsViewer.cursor !== null && start !== LogsViewer.cursor) {
+                // Lines were lost in between (overwritten, cleared or rebooted)
+                LogsViewer.logText = '';
+            }
+            LogsViewer.cursor = response.headers.get('X-Log-Cursor');
+            LogsViewer.logText = keepLastLines(LogsViewer.logText + text, LogsViewer.lineCount);
+            return { logs: LogsViewer.logText };
+        })
         .then(data => {
             displayLogs(data);
             updateLogsStatus('success', 'Updated');
@@ -2211,6 +2370,24 @@ function refreshLogs() {
         });
 }
 
+// Last count lines of text (a trailing partial line counts as one)
+function keepLastLines(text, count) {
+    let pos = text.length;
+    if (text.endsWith('\n')) {
+        pos--;
+    }
+    for (let i = 0; i < count && pos >= 0; i++) {
+        pos = text.lastIndexOf('\n', pos - 1);
+    }
+    return pos >= 0 ? text.slice(pos + 1) : text;
+}
+
+// Drop what has been received so the next refresh starts from the device's backlog
+function resetLogsTail() {
+    LogsViewer.cursor = null;
+    LogsViewer.logText = '';
+}
+
 // Display logs in the UI
 function displayLogs(data) {
     const logsContent = $('#logs-content');
@@ -2291,6 +2468,7 @@ function clearLogs() {
         queueRequest('/api/logs?clear=true', 'DELETE')
             .then(response => response.json())
             .then(data => {
+                resetLogsTail();
                 $('#logs-content').textContent = 'Logs cleared.';
                 updateLogsStatus('success', 'Logs cleared');
                 showToast('Logs cleared successfully', 'success');
@@ -2306,6 +2484,43 @@ function clearLogs() {
     });
 }
 
+// Packet capture: arm or stop the RTP/RTCP ring served at /api/capture.pcap
+function showCaptureStatus(data) {
+    const el = $('#capture-status');
+    if (!el) return;
+    if (!data.enabled) {
+        el.textContent = 'not built in';
+    } else if (data.slots === 0) {
+        el.textContent = '';
+    } else {
+        el.textContent = `${data.armed ? 'recording' : 'stopped'}, ${data.kept} of ${data.slots} packets` +
+            (data.dropped ? `, ${data.dropped} dropped` : '');
+    }
+}
+
+function captureRequest(action) {
+    queueRequest('/api/capture', 'POST', JSON.stringify({ action }), {
+        'Content-Type': 'application/json'
+    })
+        .then(response => response.json())
+        .then(data => {
+            showCaptureStatus(data);
+            showToast(action === 'start' ? 'Capture started' : 'Capture stopped', 'success');
+        })
+        .catch(error => {
+            console.error('Capture request failed:', error);
+            showToast('Capture ' + action + ' failed: ' + error.message, 'error');
+        });
+}
+
+function startCapture() {
+    captureRequest('start');
+}
+
+function stopCapture() {
+    captureRequest('stop');
+}
+
 // Toggle auto-refresh
 function toggleAutoRefresh() {
     const checkbox = $('#log-auto-refresh');
@@ -2341,6 +2556,7 @@ function updateLogLineCount() {
     LogsViewer.lineCount = parseInt(select?.value || 50);
     
     // Refresh with new line count
+    resetLogsTail();
     refreshLogs();
 }
 